@@ -75,14 +75,38 @@ int main(int argc, char** argv) {
              "of a specific type with subjectname")
             ("unresolved,u", "Retrieve all unresolved relations")
             ("recursive,r", "Retrieve the whole subtree for each returned object")
+            ("depth,d", po::value<int>()->default_value(0),
+             "Limit recursive retrieval to the specified number of levels "
+             "of children (default unlimited)")
+            ("child-class", po::value<std::vector<string> >(),
+             "Limit recursive retrieval to the children of the specified "
+             "class; may be given more than once")
+            ("where", po::value<std::vector<string> >(),
+             "Only retrieve the objects of class queries where a property "
+             "has a value, in the form property=value")
+            ("page-size", po::value<int>()->default_value(0),
+             "Retrieve the objects of class queries in pages of the "
+             "specified size (default a single page)")
             ("follow-refs,f", "Follow references in returned objects")
+            ("store-stats", "Retrieve approximate memory use per class")
+            ("watch", po::value<string>()->implicit_value(""),
+             "Print changes to objects as they happen, optionally only "
+             "for objects of a class and under a URI, in the form "
+             "subjectname or subjectname,uri.  Requires the change "
+             "journal on the agent")
+            ("interval", po::value<int>()->default_value(1000),
+             "Poll for changes at the specified interval in milliseconds "
+             "when watching (default 1000)")
             ("load", po::value<std::string>()->default_value(""),
              "Load managed objects from the specified file into the MODB view")
+            ("load-image", po::value<std::string>()->default_value(""),
+             "Load a binary MODB image written with --type image into the "
+             "MODB view")
             ("output,o", po::value<std::string>()->default_value(""),
              "Output the results to the specified file (default standard out)")
             ("type,t", po::value<std::string>()->default_value("tree"),
-             "Specify the output format: tree, asciitree, list, or dump "
-             "(default tree)")
+             "Specify the output format: tree, asciitree, list, dump, "
+             "or image (default tree)")
             ("props,p", "Include object properties in output")
             ("width,w", po::value<int>()->default_value(w.ws_col - 1),
              "Truncate output to the specified number of characters")
@@ -98,15 +122,24 @@ int main(int argc, char** argv) {
 
     string socket;
     std::vector<string> queries;
+    std::vector<string> filters;
+    std::vector<string> childClasses;
     string out_file;
     string load_file;
+    string load_image;
     string type;
 
     bool props = false;
     bool recursive = false;
     bool followRefs = false;
     int truncate = 0;
+    int depth = 0;
+    int pageSize = 0;
     bool unresolved = false;
+    bool storeStats = false;
+    bool watch = false;
+    string watchSpec;
+    int interval = 1000;
     po::variables_map vm;
     try {
         po::store(po::command_line_parser(argc, argv).
@@ -131,6 +164,12 @@ int main(int argc, char** argv) {
             followRefs = true;
         if (vm.count("unresolved"))
             unresolved = true;
+        if (vm.count("store-stats"))
+            storeStats = true;
+        if (vm.count("watch")) {
+            watch = true;
+            watchSpec = vm["watch"].as<string>();
+        }
 
         log_file = vm["log"].as<string>();
         level_str = vm["level"].as<string>();
@@ -140,10 +179,18 @@ int main(int argc, char** argv) {
         socket = vm["socket"].as<string>();
         out_file = vm["output"].as<string>();
         load_file = vm["load"].as<string>();
+        load_image = vm["load-image"].as<string>();
         type = vm["type"].as<string>();
         if (vm.count("query"))
             queries = vm["query"].as<std::vector<string> >();
+        if (vm.count("where"))
+            filters = vm["where"].as<std::vector<string> >();
+        if (vm.count("child-class"))
+            childClasses = vm["child-class"].as<std::vector<string> >();
+        depth = vm["depth"].as<int>();
+        pageSize = vm["page-size"].as<int>();
         truncate = vm["width"].as<int>();
+        interval = vm["interval"].as<int>();
     } catch (const po::unknown_option& e) {
         std::cerr << e.what() << std::endl;
         return 1;
@@ -156,15 +203,19 @@ int main(int argc, char** argv) {
     }
 
     if (truncate < 0) truncate = 0;
+    if (depth < 0) depth = 0;
+    if (pageSize < 0) pageSize = 0;
+    if (interval < 1) interval = 1;
 
     initLogging(level_str, log_to_syslog, log_file, "gbp-inspect");
 
-    if (queries.size() == 0 && load_file == "") {
+    if (queries.size() == 0 && load_file == "" && load_image == "" &&
+        !storeStats && !watch) {
         LOG(ERROR) << "No queries specified";
         return 1;
     }
     if (type != "tree" && type != "asciitree" &&
-        type != "dump" && type != "list") {
+        type != "dump" && type != "list" && type != "image") {
         LOG(ERROR) << "Invalid output type: " << type;
         return 1;
     }
@@ -175,6 +226,20 @@ int main(int argc, char** argv) {
                                                 modelgbp::getMetadata()));
         client->setRecursive(recursive);
         client->setFollowRefs(followRefs);
+        client->setDepth(depth);
+        for (const string& childClass : childClasses)
+            client->addChildClass(childClass);
+        client->setPageSize(pageSize);
+        for (string filter : filters) {
+            size_t ei = filter.find_first_of("=");
+            if (ei == string::npos || ei == 0) {
+                LOG(ERROR) << "Invalid filter: " << filter <<
+                    ": must be in the form property=value";
+                return 1;
+            }
+            client->addFilter(filter.substr(0, ei),
+                              filter.substr(ei+1, string::npos));
+        }
 
         if(unresolved) {
             client->setUnresolved(true);
@@ -203,9 +268,12 @@ int main(int argc, char** argv) {
             }
             client->loadFromFile(inf);
         }
-
-        if (queries.size() > 0)
-            client->execute();
+        if (load_image != "") {
+            if (client->loadFromImage(load_image) == 0) {
+                LOG(ERROR) << "Could not load MODB image " << load_image;
+                return 1;
+            }
+        }
 
         FILE* outf = stdout;
         if (out_file != "") {
@@ -218,8 +286,38 @@ int main(int argc, char** argv) {
         }
         stream<file_descriptor_sink> outs(fileno(outf), close_handle);
 
+        if (watch) {
+            // runs until the connection closes
+            size_t ci = watchSpec.find_first_of(",");
+            client->addWatch(watchSpec.substr(0, ci),
+                             ci == string::npos ? "" :
+                             watchSpec.substr(ci+1, string::npos),
+                             outs, props, interval);
+            client->execute();
+            outs.flush();
+            fclose(outf);
+            return 0;
+        }
+
+        if (storeStats)
+            client->addStoreStatsQuery();
+
+        if (queries.size() > 0 || storeStats)
+            client->execute();
+
+        if (storeStats) {
+            client->printStoreStats(outs);
+            if (queries.size() == 0 && load_file == "" && load_image == "") {
+                outs.flush();
+                fclose(outf);
+                return 0;
+            }
+        }
+
         if (type == "dump")
             client->dumpToFile(outf);
+        else if (type == "image")
+            client->dumpToImage(outf);
         else if (type == "list")
             client->prettyPrint(outs, false, props, true, truncate);
         else if (type == "asciitree")
@@ -13,12 +13,11 @@
 #endif
 
 #include <opflexagent/MulticastListener.h>
+#include <opflexagent/MulticastGroupJournal.h>
 #include <opflexagent/FSWatcher.h>
 #include <opflexagent/logging.h>
 #include <opflexagent/cmd.h>
 
-#include <boost/property_tree/ptree.hpp>
-#include <boost/property_tree/json_parser.hpp>
 #include <boost/program_options.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/asio/io_service.hpp>
@@ -27,6 +26,7 @@
 #include <string>
 #include <iostream>
 #include <unordered_map>
+#include <vector>
 #include <memory>
 #include <thread>
 #include <functional>
@@ -35,13 +35,11 @@
 #include <cstring>
 
 using std::string;
-using boost::optional;
 using std::shared_ptr;
 using std::unique_ptr;
-using std::unordered_set;
 using std::unordered_map;
+using std::vector;
 namespace po = boost::program_options;
-namespace pt = boost::property_tree;
 using namespace opflexagent;
 
 void sighandler(int sig) {
@@ -58,56 +56,82 @@ public:
     // FSWatcher::Watcher::updated
     virtual void updated(const boost::filesystem::path& filePath) {
         string fstr = filePath.filename().string();
-        if (!boost::algorithm::ends_with(fstr, ".json") ||
-            boost::algorithm::starts_with(fstr, "."))
+        if (boost::algorithm::starts_with(fstr, "."))
             return;
-        readConfig(filePath.string());
+
+        vector<string> joins;
+        vector<string> leaves;
+        if (boost::algorithm::ends_with(fstr, JOURNAL_SUFFIX)) {
+            // Read only the lines appended since the last read.  A
+            // journal without its snapshot is read with the snapshot.
+            string snapshot = filePath.string();
+            snapshot.resize(snapshot.size() - JOURNAL_SUFFIX.size());
+            auto it = readers.find(snapshot);
+            if (it == readers.end())
+                return;
+            it->second->readJournal(joins, leaves);
+        } else if (boost::algorithm::ends_with(fstr, ".json")) {
+            unique_ptr<MulticastGroupReader>& reader =
+                readers[filePath.string()];
+            if (!reader)
+                reader.reset(new MulticastGroupReader(filePath.string()));
+            reader->readSnapshot(joins, leaves);
+        } else {
+            return;
+        }
+        apply(joins, leaves);
     }
 
     // FSWatcher::Watcher::deleted
     virtual void deleted(const boost::filesystem::path& filePath) {
-        addresses.erase(filePath.string());
-        sync();
+        auto it = readers.find(filePath.string());
+        if (it == readers.end())
+            return;
+
+        vector<string> joins;
+        vector<string> leaves;
+        it->second->clear(leaves);
+        readers.erase(it);
+        apply(joins, leaves);
     }
 
 private:
     boost::asio::io_service& io;
     MulticastListener& listener;
 
-    typedef unordered_map<string, unordered_set<string> > file_addr_map_t;
-    file_addr_map_t addresses;
-
-    void sync() {
-        shared_ptr<unordered_set<string > > addrs(new unordered_set<string >());
-        for (const file_addr_map_t::value_type& faddr : addresses) {
-            addrs->insert(faddr.second.begin(), faddr.second.end());
+    const string JOURNAL_SUFFIX = MulticastGroupJournal::JOURNAL_SUFFIX;
+
+    typedef unordered_map<string, unique_ptr<MulticastGroupReader> >
+        reader_map_t;
+    reader_map_t readers;
+
+    /* The number of files listing each group */
+    unordered_map<string, size_t> refCounts;
+
+    /*
+     * Pass the groups joined and left by a file on to the listener,
+     * only for the groups no other file lists, in one dispatch
+     */
+    void apply(const vector<string>& joins, const vector<string>& leaves) {
+        shared_ptr<vector<string> > nj(new vector<string>());
+        shared_ptr<vector<string> > nl(new vector<string>());
+        for (const string& addr : joins) {
+            if (++refCounts[addr] == 1)
+                nj->push_back(addr);
         }
-
-        io.dispatch([this, addrs]() { listener.sync(addrs); });
-    }
-
-    void readConfig(const std::string& filePath) {
-        static const std::string MULTICAST_GROUPS("multicast-groups");
-
-        unordered_set<string>& fileAddrs = addresses[filePath];
-        fileAddrs.clear();
-
-        try {
-            pt::ptree properties;
-            pt::read_json(filePath, properties);
-            optional<pt::ptree&> groups =
-                properties.get_child_optional(MULTICAST_GROUPS);
-            if (groups) {
-                for (const pt::ptree::value_type &v : groups.get())
-                    fileAddrs.insert(v.second.data());
+        for (const string& addr : leaves) {
+            auto it = refCounts.find(addr);
+            if (it == refCounts.end()) continue;
+            if (--it->second == 0) {
+                refCounts.erase(it);
+                nl->push_back(addr);
             }
-        } catch (pt::json_parser_error& e) {
-            LOG(ERROR) << "Could not parse multicast group file: " << e.what();
         }
+        if (nj->empty() && nl->empty())
+            return;
 
-        sync();
+        io.dispatch([this, nj, nl]() { listener.update(nj, nl); });
     }
-
 };
 
 #define DEFAULT_WATCH LOCALSTATEDIR"/lib/opflex-agent-ovs/mcast/"
@@ -13,6 +13,7 @@
 #endif
 #include <opflexagent/Agent.h>
 #include <opflexagent/cmd.h>
+#include <opflexagent/AllocStats.h>
 
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/program_options.hpp>
@@ -23,6 +24,8 @@
 
 #include <condition_variable>
 
+#include <unistd.h>
+
 using std::string;
 namespace po = boost::program_options;
 namespace fs = boost::filesystem;
@@ -45,7 +48,7 @@ private:
     }
 };
 
-static void readConfig(Agent& agent, const string& configFile) {
+static pt::ptree readConfig(const string& configFile) {
     pt::ptree properties;
 
     LOG(INFO) << "Reading configuration from " << configFile;
@@ -63,7 +66,7 @@ static void readConfig(Agent& agent, const string& configFile) {
                    << e.line() << "): " << e.message();
         throw;
     }
-    agent.setProperties(properties);
+    return properties;
 }
 
 bool isConfigPath(const fs::path& file) {
@@ -109,10 +112,18 @@ public:
                 configure(agent);
                 agent.start();
 
-                cond.wait(lock, [this]{ return stopped || need_reload; });
-                if (!stopped && need_reload) {
-                    LOG(INFO) << "Reloading agent because of " <<
-                        "configuration update";
+                // apply configuration updates in place when the agent
+                // can, and restart it otherwise
+                while (true) {
+                    cond.wait(lock, [this]{ return stopped || need_reload; });
+                    if (stopped)
+                        break;
+                    need_reload = false;
+                    if (!reloadConfig(agent)) {
+                        LOG(INFO) << "Reloading agent because of " <<
+                            "configuration update";
+                        break;
+                    }
                 }
 
                 agent.stop();
@@ -121,7 +132,6 @@ public:
                     configWatcher.stop();
                     return 0;
                 }
-                need_reload = false;
             }
 
         } catch (pt::json_parser_error& e) {
@@ -139,18 +149,22 @@ public:
         if (!isConfigPath(filePath))
             return;
 
+        LOG(INFO) << "Triggering reload because of change to " << filePath;
+        reload();
+    }
+
+    void deleted(const boost::filesystem::path& filePath) override {
+        updated(filePath);
+    }
+
+    void reload() {
         {
-            LOG(INFO) << "Triggering reload because of change to " << filePath;
             std::unique_lock<std::mutex> lock(mutex);
             need_reload = true;
         }
         cond.notify_all();
     }
 
-    void deleted(const boost::filesystem::path& filePath) override {
-        updated(filePath);
-    }
-
     void stop() {
         {
             std::unique_lock<std::mutex> lock(mutex);
@@ -179,7 +193,8 @@ private:
         }
     }
 
-    void configure(Agent& agent) {
+    std::vector<string> getConfigFiles() {
+        std::vector<string> result;
         for (const string& configFile : configFiles) {
             if (fs::is_directory(configFile)) {
                 LOG(INFO) << "Reading configuration from config directory "
@@ -193,16 +208,36 @@ private:
                         files.insert(it->path().string());
                     }
                 }
-                for (const std::string& fstr : files) {
-                    readConfig(agent, fstr);
-                }
+                result.insert(result.end(), files.begin(), files.end());
             } else {
-                readConfig(agent, configFile);
+                result.push_back(configFile);
             }
         }
+        return result;
+    }
+
+    void configure(Agent& agent) {
+        for (const string& file : getConfigFiles())
+            agent.setProperties(readConfig(file));
 
         agent.applyProperties();
     }
+
+    /**
+     * Apply the changed configuration to the running agent.  Return
+     * false if it can be applied only by restarting the agent.
+     */
+    bool reloadConfig(Agent& agent) {
+        std::vector<pt::ptree> properties;
+        try {
+            for (const string& file : getConfigFiles())
+                properties.push_back(readConfig(file));
+        } catch (pt::json_parser_error& e) {
+            LOG(ERROR) << "Keeping the current configuration";
+            return true;
+        }
+        return agent.reloadProperties(properties);
+    }
 };
 
 int main(int argc, char** argv) {
@@ -225,6 +260,10 @@ int main(int argc, char** argv) {
              "Use the specified log level (default info). "
              "Overridden by log level in configuration file")
             ("syslog", "Log to syslog instead of file or standard out")
+            ("heap-profile",
+             po::value<string>()->default_value(""),
+             "Write a heap profile to a file with the specified prefix "
+             "on SIGUSR2 (default disabled)")
             ("daemon", "Run the agent as a daemon");
     } catch (const boost::bad_lexical_cast& e) {
         std::cerr << e.what() << std::endl;
@@ -236,6 +275,7 @@ int main(int argc, char** argv) {
     bool logToSyslog = false;
     std::string log_file;
     std::string level_str;
+    std::string heap_profile;
 
     po::variables_map vm;
     try {
@@ -261,6 +301,7 @@ int main(int argc, char** argv) {
         }
         log_file = vm["log"].as<string>();
         level_str = vm["level"].as<string>();
+        heap_profile = vm["heap-profile"].as<string>();
         if (vm.count("syslog")) {
             logToSyslog = true;
         }
@@ -290,12 +331,35 @@ int main(int argc, char** argv) {
     sigemptyset(&waitset);
     sigaddset(&waitset, SIGINT);
     sigaddset(&waitset, SIGTERM);
+    sigaddset(&waitset, SIGUSR2);
+    sigaddset(&waitset, SIGHUP);
     sigprocmask(SIG_BLOCK, &waitset, nullptr);
     LogParams _logParams = std::make_tuple(level_str, logToSyslog, log_file);
     AgentLauncher launcher(watch, configFiles, _logParams);
-    std::thread signal_thread([&launcher, &waitset]() {
+    std::thread signal_thread([&launcher, &waitset, &heap_profile]() {
             int sig;
-            int result = sigwait(&waitset, &sig);
+            unsigned dumps = 0;
+            int result;
+            // SIGUSR2 writes a heap profile and SIGHUP reloads the
+            // configuration, and both keep running
+            while ((result = sigwait(&waitset, &sig)) == 0 &&
+                   (sig == SIGUSR2 || sig == SIGHUP)) {
+                if (sig == SIGHUP) {
+                    LOG(INFO) << "Triggering reload because of SIGHUP";
+                    launcher.reload();
+                    continue;
+                }
+                if (heap_profile.empty()) {
+                    LOG(INFO) << "Ignoring SIGUSR2 because no heap profile "
+                              << "prefix is configured";
+                    continue;
+                }
+                string file = heap_profile + "." +
+                    std::to_string(getpid()) + "." + std::to_string(dumps++);
+                if (AllocStats::dumpHeapProfile(file))
+                    LOG(INFO) << "Wrote " << AllocStats::getAllocatorName()
+                              << " heap profile to " << file;
+            }
             if (result == 0) {
                 LOG(INFO) << "Got " << strsignal(sig) << " signal";
             } else {
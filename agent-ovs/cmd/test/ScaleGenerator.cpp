@@ -0,0 +1,383 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for ScaleGenerator
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <modelgbp/dmtree/Root.hpp>
+#include <modelgbp/l2/EtherTypeEnumT.hpp>
+#include <modelgbp/gbp/ConnTrackEnumT.hpp>
+#include <modelgbp/gbp/DirectionEnumT.hpp>
+#include <opflex/modb/Mutator.h>
+#include <opflex/modb/URIBuilder.h>
+
+#include "ScaleGenerator.h"
+
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/asio/ip/address_v4.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include <cstdio>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+namespace opflexagent {
+
+using std::shared_ptr;
+using std::string;
+using boost::property_tree::ptree;
+using opflex::modb::Mutator;
+using opflex::modb::URI;
+using opflex::modb::URIBuilder;
+
+using namespace modelgbp;
+using namespace modelgbp::gbp;
+using namespace modelgbp::gbpe;
+using namespace modelgbp::l2;
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+/* endpoint subnets are carved out of 10.0.0.0/8 */
+const uint32_t EP_NET = 0x0a000000;
+const unsigned EP_NET_BITS = 24;
+/* service addresses come from 172.16.0.0/12 */
+const uint32_t SVC_NET = 0xac100000;
+const uint32_t SVC_NET_SIZE = 1 << 20;
+/* SNAT addresses come from 100.64.0.0/10 */
+const uint32_t SNAT_NET = 0x64400000;
+const uint32_t SNAT_NET_SIZE = 1 << 22;
+
+/* the first TCP port allowed by the contract rules */
+const uint16_t RULE_PORT_BASE = 1000;
+
+string toIP(uint32_t addr) {
+    return boost::asio::ip::address_v4(addr).to_string();
+}
+
+string toMAC(uint8_t prefix, uint32_t index) {
+    char buf[18];
+    std::snprintf(buf, sizeof(buf), "02:%02x:%02x:%02x:%02x:%02x",
+                  prefix, (index >> 24) & 0xff, (index >> 16) & 0xff,
+                  (index >> 8) & 0xff, index & 0xff);
+    return buf;
+}
+
+/* the number of address bits needed for a subnet of each group */
+unsigned subnetBits(const ScaleGenerator::Params& params) {
+    size_t groups = params.tenants * params.epgs;
+    size_t perGroup = (params.endpoints + groups - 1) / groups;
+    // the network and router addresses come first
+    size_t addrs = perGroup * params.ips + 2;
+    unsigned bits = 8;
+    while (bits < EP_NET_BITS && (size_t(1) << bits) <= addrs)
+        ++bits;
+    return bits;
+}
+
+ptree array(const std::vector<string>& values) {
+    ptree result;
+    for (const string& v : values) {
+        ptree item;
+        item.put_value(v);
+        result.push_back(std::make_pair("", item));
+    }
+    return result;
+}
+
+void writeFile(const fs::path& path, const ptree& properties) {
+    boost::property_tree::write_json(path.string(), properties);
+}
+
+} /* anonymous namespace */
+
+void ScaleGenerator::Params::parse(const string& spec) {
+    std::map<string, size_t*> fields = {
+        {"tenants", &tenants},
+        {"epgs", &epgs},
+        {"contracts", &contracts},
+        {"providers", &providers},
+        {"consumers", &consumers},
+        {"rules", &rules},
+        {"endpoints", &endpoints},
+        {"ips", &ips},
+        {"services", &services},
+        {"backends", &backends},
+        {"snats", &snats},
+    };
+
+    std::vector<string> pairs;
+    boost::split(pairs, spec, boost::is_any_of(","));
+    for (const string& pair : pairs) {
+        if (pair.empty()) continue;
+        size_t eq = pair.find('=');
+        auto it = fields.find(pair.substr(0, eq));
+        if (eq == string::npos || it == fields.end())
+            throw std::invalid_argument("Invalid scale parameter: " + pair);
+        try {
+            size_t pos;
+            unsigned long value = std::stoul(pair.substr(eq + 1), &pos);
+            if (pos != pair.size() - eq - 1)
+                throw std::invalid_argument(pair);
+            *it->second = value;
+        } catch (const std::logic_error&) {
+            throw std::invalid_argument("Invalid scale value: " + pair);
+        }
+    }
+}
+
+ScaleGenerator::ScaleGenerator(const Params& params_)
+    : params(params_) {
+    if (params.tenants == 0 || params.epgs == 0)
+        throw std::invalid_argument("At least one group is needed");
+    if (params.ips == 0)
+        throw std::invalid_argument("Endpoints need at least one address");
+    size_t groups = params.tenants * params.epgs;
+    unsigned bits = subnetBits(params);
+    size_t perGroup = (params.endpoints + groups - 1) / groups;
+    if ((perGroup * params.ips + 2) >= (size_t(1) << bits) ||
+        (groups << bits) > (size_t(1) << EP_NET_BITS))
+        throw std::invalid_argument("Too many endpoint addresses");
+    if (params.services > SVC_NET_SIZE - 2)
+        throw std::invalid_argument("Too many services");
+    if (params.services > 0 && params.endpoints == 0)
+        throw std::invalid_argument("Services need endpoints");
+    if (params.snats > SNAT_NET_SIZE - 2)
+        throw std::invalid_argument("Too many SNAT addresses");
+}
+
+string ScaleGenerator::getTenantName(size_t tenant) {
+    return "tenant" + std::to_string(tenant);
+}
+
+URI ScaleGenerator::getEpgURI(size_t tenant, size_t epg) {
+    return URIBuilder()
+        .addElement("PolicyUniverse").addElement("PolicySpace")
+        .addElement(getTenantName(tenant))
+        .addElement("GbpEpGroup").addElement("epg" + std::to_string(epg))
+        .build();
+}
+
+URI ScaleGenerator::getContractURI(size_t tenant, size_t contract) {
+    return URIBuilder()
+        .addElement("PolicyUniverse").addElement("PolicySpace")
+        .addElement(getTenantName(tenant))
+        .addElement("GbpContract")
+        .addElement("contract" + std::to_string(contract))
+        .build();
+}
+
+size_t ScaleGenerator::getEndpointGroup(size_t endpoint) const {
+    return endpoint % (params.tenants * params.epgs);
+}
+
+string ScaleGenerator::getEndpointIP(size_t endpoint, size_t ip) const {
+    size_t groups = params.tenants * params.epgs;
+    size_t group = getEndpointGroup(endpoint);
+    uint32_t subnet = EP_NET + (uint32_t(group) << subnetBits(params));
+    return toIP(subnet + 2 + (endpoint / groups) * params.ips + ip);
+}
+
+void ScaleGenerator::writePolicy(opflex::ofcore::OFFramework& framework)
+    const {
+    unsigned bits = subnetBits(params);
+    shared_ptr<policy::Universe> universe =
+        policy::Universe::resolve(framework).get();
+
+    for (size_t t = 0; t < params.tenants; ++t) {
+        Mutator mutator(framework, "policyreg");
+        shared_ptr<policy::Space> space =
+            universe->addPolicySpace(getTenantName(t));
+
+        shared_ptr<RoutingDomain> rd = space->addGbpRoutingDomain("rd");
+        rd->addGbpeInstContext()->setEncapId(0x300000 + t);
+
+        shared_ptr<AllowDenyAction> allow =
+            space->addGbpAllowDenyAction("allow");
+        allow->setAllow(1).setOrder(1);
+
+        std::vector<shared_ptr<L24Classifier> > classifiers;
+        for (size_t r = 0; r < params.rules; ++r) {
+            shared_ptr<L24Classifier> classifier =
+                space->addGbpeL24Classifier("tcp" + std::to_string(r));
+            classifier->setOrder(100 + r)
+                .setEtherT(EtherTypeEnumT::CONST_IPV4)
+                .setProt(6)
+                .setDFromPort(RULE_PORT_BASE + r)
+                .setDToPort(RULE_PORT_BASE + r)
+                .setConnectionTracking(ConnTrackEnumT::CONST_REFLEXIVE);
+            classifiers.push_back(classifier);
+        }
+
+        std::vector<shared_ptr<EpGroup> > groups;
+        for (size_t e = 0; e < params.epgs; ++e) {
+            size_t g = t * params.epgs + e;
+            string idx = std::to_string(e);
+
+            shared_ptr<BridgeDomain> bd =
+                space->addGbpBridgeDomain("bd" + idx);
+            bd->addGbpBridgeDomainToNetworkRSrc()
+                ->setTargetRoutingDomain(rd->getURI());
+            bd->addGbpeInstContext()->setEncapId(0x200000 + g);
+            bd->addGbpeInstContext()->setClassid(0x200000 + g);
+
+            shared_ptr<FloodDomain> fd =
+                space->addGbpFloodDomain("fd" + idx);
+            fd->addGbpFloodDomainToNetworkRSrc()
+                ->setTargetBridgeDomain(bd->getURI());
+
+            uint32_t subnet = EP_NET + (uint32_t(g) << bits);
+            shared_ptr<Subnets> subnets =
+                space->addGbpSubnets("subnets" + idx);
+            subnets->addGbpSubnet("subnet" + idx)
+                ->setAddress(toIP(subnet))
+                .setPrefixLen(32 - bits)
+                .setVirtualRouterIp(toIP(subnet + 1));
+            fd->addGbpForwardingBehavioralGroupToSubnetsRSrc()
+                ->setTargetSubnets(subnets->getURI());
+            rd->addGbpRoutingDomainToIntSubnetsRSrc(subnets->getURI()
+                                                    .toString());
+
+            shared_ptr<EpGroup> epg = space->addGbpEpGroup("epg" + idx);
+            epg->addGbpEpGroupToNetworkRSrc()
+                ->setTargetFloodDomain(fd->getURI());
+            epg->addGbpeInstContext()->setEncapId(0x100000 + g);
+            epg->addGbpeInstContext()->setClassid(0x100000 + g);
+            groups.push_back(epg);
+        }
+
+        for (size_t c = 0; c < params.contracts; ++c) {
+            shared_ptr<Contract> contract =
+                space->addGbpContract("contract" + std::to_string(c));
+            shared_ptr<Subject> subject =
+                contract->addGbpSubject("subject");
+            for (size_t r = 0; r < params.rules; ++r) {
+                shared_ptr<Rule> rule =
+                    subject->addGbpRule("rule" + std::to_string(r));
+                rule->setOrder(r + 1)
+                    .setDirection(DirectionEnumT::CONST_IN)
+                    .addGbpRuleToClassifierRSrc(classifiers[r]->getURI()
+                                                .toString());
+                rule->addGbpRuleToActionRSrcAllowDenyAction(allow->getURI()
+                                                            .toString());
+            }
+
+            const string curi = contract->getURI().toString();
+            for (size_t p = 0; p < params.providers; ++p)
+                groups[(c + p) % params.epgs]
+                    ->addGbpEpGroupToProvContractRSrc(curi);
+            for (size_t p = 0; p < params.consumers; ++p)
+                groups[(c + params.providers + p) % params.epgs]
+                    ->addGbpEpGroupToConsContractRSrc(curi);
+        }
+
+        mutator.commit();
+    }
+}
+
+size_t ScaleGenerator::writeEndpoints(const string& dir) const {
+    fs::create_directories(dir);
+    for (size_t i = 0; i < params.endpoints; ++i) {
+        size_t group = getEndpointGroup(i);
+        string uuid = "scale-ep-" + std::to_string(i);
+
+        ptree ep;
+        ep.put("uuid", uuid);
+        ep.put("mac", toMAC(0, i));
+        std::vector<string> ips;
+        for (size_t ip = 0; ip < params.ips; ++ip)
+            ips.push_back(getEndpointIP(i, ip));
+        ep.add_child("ip", array(ips));
+        ep.put("interface-name", "veth" + std::to_string(i));
+        ep.put("policy-space-name", getTenantName(group / params.epgs));
+        ep.put("endpoint-group-name",
+               "epg" + std::to_string(group % params.epgs));
+        if (params.snats > 0)
+            ep.add_child("snat-uuids",
+                         array({"scale-snat-" +
+                                std::to_string(i % params.snats)}));
+        ep.put("attributes.vm-name", "vm" + std::to_string(i));
+
+        writeFile(fs::path(dir) / (uuid + ".ep"), ep);
+    }
+    return params.endpoints;
+}
+
+size_t ScaleGenerator::writeServices(const string& dir) const {
+    fs::create_directories(dir);
+    size_t groups = params.tenants * params.epgs;
+    for (size_t s = 0; s < params.services; ++s) {
+        string uuid = "scale-svc-" + std::to_string(s);
+        // the backends share a group, so that they are in the routing
+        // domain of the service
+        size_t first = s % params.endpoints;
+        std::vector<string> nextHops;
+        for (size_t b = 0; b < params.backends; ++b) {
+            size_t ep = first + b * groups;
+            if (ep >= params.endpoints) break;
+            nextHops.push_back(getEndpointIP(ep));
+        }
+
+        ptree svc;
+        svc.put("uuid", uuid);
+        svc.put("service-mode", "loadbalancer");
+        svc.put("service-mac", toMAC(1, s));
+        svc.put("domain-policy-space",
+                getTenantName(getEndpointGroup(first) / params.epgs));
+        svc.put("domain-name", "rd");
+
+        ptree mapping;
+        mapping.put("service-ip", toIP(SVC_NET + 1 + s));
+        mapping.put("service-proto", "tcp");
+        mapping.put("service-port", RULE_PORT_BASE);
+        mapping.add_child("next-hop-ips", array(nextHops));
+        mapping.put("next-hop-port", RULE_PORT_BASE);
+        mapping.put("conntrack-enabled", true);
+        ptree mappings;
+        mappings.push_back(std::make_pair("", mapping));
+        svc.add_child("service-mapping", mappings);
+        svc.put("attributes.name", uuid);
+        svc.put("attributes.namespace",
+                getTenantName(getEndpointGroup(first) / params.epgs));
+
+        writeFile(fs::path(dir) / (uuid + ".service"), svc);
+    }
+    return params.services;
+}
+
+size_t ScaleGenerator::writeSnats(const string& dir) const {
+    fs::create_directories(dir);
+    for (size_t n = 0; n < params.snats; ++n) {
+        string uuid = "scale-snat-" + std::to_string(n);
+
+        ptree snat;
+        snat.put("uuid", uuid);
+        snat.put("snat-ip", toIP(SNAT_NET + 1 + n));
+        snat.put("interface-name", "uplink");
+        snat.put("interface-mac", toMAC(2, n));
+        snat.put("local", true);
+        snat.add_child("dest", array({"0.0.0.0/0"}));
+        snat.put("zone", 8191);
+        ptree range;
+        range.put("start", 5000);
+        range.put("end", 65000);
+        ptree ranges;
+        ranges.push_back(std::make_pair("", range));
+        snat.add_child("port-range", ranges);
+
+        writeFile(fs::path(dir) / (uuid + ".snat"), snat);
+    }
+    return params.snats;
+}
+
+} /* namespace opflexagent */
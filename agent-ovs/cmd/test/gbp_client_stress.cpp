@@ -60,9 +60,18 @@ public:
     Status ListObjects(ServerContext* context,
                        const Version* version,
                        ServerWriter<GBPOperation>* writer) override {
+        // The policy file is the whole database at version 1, so a
+        // client that already holds it is up to date
+        if (version->number() >= POLICY_VERSION) {
+            std::cout << "client is up to date at version "
+                      << version->number() << std::endl;
+            return Status::OK;
+        }
+
         Value::ConstValueIterator moit;
         GBPOperation oper;
         oper.set_opcode(GBPOperation::REPLACE);
+        oper.mutable_version()->set_number(POLICY_VERSION);
         size_t i = 0;
         for (moit = doc.Begin(); moit != doc.End(); ++ moit) {
             const Value& mo = *moit;
@@ -164,6 +173,7 @@ public:
     }
 
 private:
+    static const int32_t POLICY_VERSION = 1;
     Document doc;
     int objectsInMsg;
     int sleepDuration;
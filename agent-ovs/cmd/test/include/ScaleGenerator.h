@@ -0,0 +1,163 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for the synthetic policy and endpoint generator
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflex/ofcore/OFFramework.h>
+#include <opflex/modb/URI.h>
+
+#include <cstddef>
+#include <string>
+
+#pragma once
+#ifndef OPFLEXAGENT_TEST_SCALEGENERATOR_H
+#define OPFLEXAGENT_TEST_SCALEGENERATOR_H
+
+namespace opflexagent {
+
+/**
+ * Generate policy, endpoint, service and SNAT files at a chosen
+ * scale, for tests and benchmarks.
+ *
+ * Each tenant is a policy space with one routing domain.  Each
+ * endpoint group has its own flood domain, bridge domain and subnet
+ * in that routing domain.  The contracts of a tenant are provided and
+ * consumed by groups picked round robin, and each rule of a contract
+ * allows one TCP port.  Endpoints, services and SNATs are spread over
+ * the groups and tenants the same way.  The output depends only on
+ * the parameters, so runs with the same parameters can be compared.
+ */
+class ScaleGenerator {
+public:
+    /**
+     * The size of the generated configuration
+     */
+    struct Params {
+        /** the number of policy spaces */
+        size_t tenants = 1;
+        /** the number of endpoint groups in each tenant */
+        size_t epgs = 4;
+        /** the number of contracts in each tenant */
+        size_t contracts = 2;
+        /** the number of groups providing each contract */
+        size_t providers = 1;
+        /** the number of groups consuming each contract */
+        size_t consumers = 1;
+        /** the number of rules in each contract */
+        size_t rules = 2;
+        /** the total number of local endpoints */
+        size_t endpoints = 16;
+        /** the number of IP addresses of each endpoint */
+        size_t ips = 1;
+        /** the total number of load balanced services */
+        size_t services = 0;
+        /** the number of endpoints backing each service */
+        size_t backends = 2;
+        /** the total number of SNAT addresses */
+        size_t snats = 0;
+
+        /**
+         * Parse a comma separated list of name=value pairs, such as
+         * "tenants=2,epgs=100,endpoints=5000", into the parameters.
+         * The names are those of the fields.
+         *
+         * @param spec the list to parse
+         * @throws std::invalid_argument if a name or value is not valid
+         */
+        void parse(const std::string& spec);
+    };
+
+    /**
+     * Create a generator
+     *
+     * @param params the size of the configuration
+     * @throws std::invalid_argument if the endpoints or services do
+     * not fit in the address space used
+     */
+    explicit ScaleGenerator(const Params& params);
+
+    /**
+     * Get the parameters
+     */
+    const Params& getParams() const { return params; }
+
+    /**
+     * Write the policy into an MODB.  The universes must already
+     * exist, for example written by Policies::writeBasicInit or by
+     * starting an agent.
+     *
+     * @param framework the framework to write to
+     */
+    void writePolicy(opflex::ofcore::OFFramework& framework) const;
+
+    /**
+     * Write one endpoint file per endpoint to a directory, creating it
+     * if needed
+     *
+     * @param dir the directory to write to
+     * @return the number of files written
+     */
+    size_t writeEndpoints(const std::string& dir) const;
+
+    /**
+     * Write one service file per service to a directory, creating it
+     * if needed
+     *
+     * @param dir the directory to write to
+     * @return the number of files written
+     */
+    size_t writeServices(const std::string& dir) const;
+
+    /**
+     * Write one SNAT file per SNAT address to a directory, creating it
+     * if needed
+     *
+     * @param dir the directory to write to
+     * @return the number of files written
+     */
+    size_t writeSnats(const std::string& dir) const;
+
+    /**
+     * Get the name of the policy space of a tenant
+     */
+    static std::string getTenantName(size_t tenant);
+
+    /**
+     * Get the URI of an endpoint group
+     *
+     * @param tenant the index of the tenant
+     * @param epg the index of the group within the tenant
+     */
+    static opflex::modb::URI getEpgURI(size_t tenant, size_t epg);
+
+    /**
+     * Get the URI of a contract
+     *
+     * @param tenant the index of the tenant
+     * @param contract the index of the contract within the tenant
+     */
+    static opflex::modb::URI getContractURI(size_t tenant, size_t contract);
+
+    /**
+     * Get the IPv4 address of an endpoint
+     *
+     * @param endpoint the index of the endpoint
+     * @param ip the index of the address of the endpoint
+     */
+    std::string getEndpointIP(size_t endpoint, size_t ip = 0) const;
+
+private:
+    Params params;
+
+    size_t getEndpointGroup(size_t endpoint) const;
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_TEST_SCALEGENERATOR_H */
@@ -28,6 +28,7 @@
 #include <opflexagent/logging.h>
 #include <opflexagent/cmd.h>
 #include "Policies.h"
+#include "ScaleGenerator.h"
 #include <opflexagent/Agent.h>
 
 using std::string;
@@ -63,6 +64,12 @@ int main(int argc, char** argv) {
              "Use the specified log level (default info)")
             ("sample", po::value<string>()->default_value(""),
              "Output a sample policy to the given file then exit")
+            ("scale", po::value<string>(),
+             "Make the sample policy a generated one of the given size, "
+             "as a list such as tenants=2,epgs=100,endpoints=5000")
+            ("scale_dir", po::value<string>(),
+             "With --scale, also write the generated endpoint, service "
+             "and SNAT files to subdirectories of the given directory")
             ("daemon", "Run the opflex server as a daemon")
             ("policy,p", po::value<string>()->default_value(""),
              "Read the specified policy file to seed the MODB")
@@ -91,6 +98,8 @@ int main(int argc, char** argv) {
     boost::filesystem::path pf_path;
     boost::filesystem::path pf_dir;
     std::string sample_file;
+    boost::optional<ScaleGenerator::Params> scale;
+    std::string scale_dir;
     std::string ssl_castore;
     std::string ssl_key;
     std::string ssl_pass;
@@ -118,6 +127,12 @@ int main(int argc, char** argv) {
         level_str = vm["level"].as<string>();
         policy_file = vm["policy"].as<string>();
         sample_file = vm["sample"].as<string>();
+        if (vm.count("scale")) {
+            scale = ScaleGenerator::Params();
+            scale->parse(vm["scale"].as<string>());
+        }
+        if (vm.count("scale_dir"))
+            scale_dir = vm["scale_dir"].as<string>();
         ssl_castore = vm["ssl_castore"].as<string>();
         ssl_key = vm["ssl_key"].as<string>();
         ssl_pass = vm["ssl_pass"].as<string>();
@@ -134,6 +149,9 @@ int main(int argc, char** argv) {
     } catch (const std::bad_cast& e) {
         std::cerr << e.what() << std::endl;
         return 3;
+    } catch (const std::invalid_argument& e) {
+        std::cerr << e.what() << std::endl;
+        return 4;
     }
 
     if (daemon)
@@ -147,7 +165,18 @@ int main(int argc, char** argv) {
             mframework.setModel(modelgbp::getMetadata());
             mframework.start();
             Policies::writeBasicInit(mframework);
-            Policies::writeTestPolicy(mframework);
+            if (scale) {
+                ScaleGenerator generator(scale.get());
+                generator.writePolicy(mframework);
+                if (!scale_dir.empty()) {
+                    boost::filesystem::path dir(scale_dir);
+                    generator.writeEndpoints((dir / "endpoints").string());
+                    generator.writeServices((dir / "services").string());
+                    generator.writeSnats((dir / "snats").string());
+                }
+            } else {
+                Policies::writeTestPolicy(mframework);
+            }
 
             mframework.dumpMODB(sample_file);
 
@@ -0,0 +1,566 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Offline replay benchmark for the OVS renderer.  Loads a recorded
+ * MODB dump and directories of endpoint and service files, or
+ * generates them with ScaleGenerator, computes the integration bridge
+ * flows against a switch that acknowledges every write at once, and
+ * reports the throughput, the time spent per handler and the peak
+ * memory use as one JSON object per line.
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include "IntFlowManager.h"
+#include "SwitchManager.h"
+#include "FlowExecutor.h"
+#include "CtZoneManager.h"
+#include "MockFlowReader.h"
+#include "ovs-ofputil.h"
+#include "ScaleGenerator.h"
+
+#include <opflexagent/Agent.h>
+#include <opflexagent/FSEndpointSource.h>
+#include <opflexagent/FSServiceSource.h>
+#include <opflexagent/FSWatcher.h>
+#include <opflexagent/IdGenerator.h>
+#include <opflexagent/TunnelEpManager.h>
+#include <opflexagent/logging.h>
+#include <opflex/ofcore/OFFramework.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using std::string;
+using opflexagent::FlowEdit;
+using opflexagent::GroupEdit;
+using opflexagent::TlvEdit;
+using opflexagent::ERROR;
+namespace po = boost::program_options;
+
+typedef std::chrono::steady_clock bench_clock;
+
+/**
+ * The time of the last flow write or task, used to tell when the
+ * renderer has settled
+ */
+class Activity {
+public:
+    Activity() { touch(); }
+
+    void touch() {
+        last = bench_clock::now().time_since_epoch().count();
+    }
+
+    bench_clock::time_point getLast() const {
+        return bench_clock::time_point(bench_clock::duration(last.load()));
+    }
+
+private:
+    std::atomic<bench_clock::rep> last;
+};
+
+/**
+ * A flow executor that counts the changes written and acknowledges
+ * them at once, as if the switch took no time
+ */
+class ReplayFlowExecutor : public opflexagent::FlowExecutor {
+public:
+    ReplayFlowExecutor(Activity& activity_)
+        : activity(activity_), writes(0), adds(0), mods(0), deletes(0),
+          groups(0) {}
+
+    virtual bool Execute(const FlowEdit& fe) {
+        count(GroupEdit(), fe, GroupEdit());
+        return true;
+    }
+    virtual bool Execute(const GroupEdit& ge) {
+        count(ge, FlowEdit(), GroupEdit());
+        return true;
+    }
+    virtual bool Execute(const TlvEdit& te) {
+        activity.touch();
+        return true;
+    }
+    virtual bool Execute(const GroupEdit& before, const FlowEdit& fe,
+                         const GroupEdit& after) {
+        count(before, fe, after);
+        return true;
+    }
+    virtual bool ExecuteNoBlock(const FlowEdit& fe) { return Execute(fe); }
+    virtual bool ExecuteNoBlock(const GroupEdit& ge) { return Execute(ge); }
+    virtual bool ExecuteNoBlock(const TlvEdit& te) { return Execute(te); }
+    using FlowExecutor::ExecuteAsync;
+    virtual bool ExecuteAsync(const GroupEdit& before, const FlowEdit& fe,
+                              const GroupEdit& after,
+                              const Completion& done) {
+        count(before, fe, after);
+        done(0);
+        return true;
+    }
+
+    uint64_t getEdits() const { return adds + mods + deletes; }
+    uint64_t getFlows() const { return adds - deletes; }
+
+    Activity& activity;
+    std::atomic<uint64_t> writes;
+    std::atomic<uint64_t> adds;
+    std::atomic<uint64_t> mods;
+    std::atomic<uint64_t> deletes;
+    std::atomic<uint64_t> groups;
+
+private:
+    void count(const GroupEdit& before, const FlowEdit& fe,
+               const GroupEdit& after) {
+        size_t counts[FlowEdit::DEL + 1] = {0, 0, 0};
+        for (const FlowEdit::Entry& e : fe.edits)
+            counts[e.first] += 1;
+        adds += counts[FlowEdit::ADD];
+        mods += counts[FlowEdit::MOD];
+        deletes += counts[FlowEdit::DEL];
+        groups += before.edits.size() + after.edits.size();
+        writes += 1;
+        activity.touch();
+    }
+};
+
+/**
+ * A switch connection that is always connected and drops the
+ * messages sent to it, such as advertisements
+ */
+class ReplaySwitchConnection : public opflexagent::SwitchConnection {
+public:
+    ReplaySwitchConnection(const string& swName)
+        : SwitchConnection(swName), connected(false) {}
+
+    virtual int Connect(int protoVer) {
+        connected = true;
+        notifyConnectListeners();
+        return 0;
+    }
+    virtual bool IsConnected() { return connected; }
+    virtual int GetProtocolVersion() { return OFP13_VERSION; }
+    virtual int SendMessage(OfpBuf& msg) { return 0; }
+    virtual int SendMessages(std::vector<OfpBuf>& msgs) {
+        return 0;
+    }
+
+private:
+    bool connected;
+};
+
+class ReplaySwitchManager : public opflexagent::SwitchManager {
+public:
+    ReplaySwitchManager(opflexagent::Agent& agent,
+                        opflexagent::FlowExecutor& flowExecutor,
+                        opflexagent::FlowReader& flowReader,
+                        opflexagent::PortMapper& portMapper)
+        : SwitchManager(agent, flowExecutor, flowReader, portMapper) {}
+
+    virtual void start(const string& swName) {
+        connection.reset(new ReplaySwitchConnection(swName));
+    }
+};
+
+/**
+ * A port mapper on which every interface exists, so that the flows
+ * of every endpoint are computed
+ */
+class ReplayPortMapper : public opflexagent::PortMapper {
+public:
+    ReplayPortMapper() : nextPort(1) {}
+
+    virtual uint32_t FindPort(const string& name) {
+        std::lock_guard<std::mutex> guard(mutex);
+        auto it = ports.find(name);
+        if (it != ports.end())
+            return it->second;
+        uint32_t port = nextPort++;
+        ports[name] = port;
+        names[port] = name;
+        return port;
+    }
+
+    virtual string FindPort(uint32_t of_port_no) {
+        std::lock_guard<std::mutex> guard(mutex);
+        auto it = names.find(of_port_no);
+        return it != names.end() ? it->second : string();
+    }
+
+private:
+    std::mutex mutex;
+    uint32_t nextPort;
+    std::unordered_map<string, uint32_t> ports;
+    std::unordered_map<uint32_t, string> names;
+};
+
+/**
+ * The time spent in the tasks of the integration flow manager,
+ * grouped by the kind of object they update
+ */
+class HandlerTimes {
+public:
+    HandlerTimes(Activity& activity_) : activity(activity_) {}
+
+    struct Times {
+        Times() : calls(0), total(0), max(0) {}
+        size_t calls;
+        bench_clock::duration total;
+        bench_clock::duration max;
+    };
+    typedef std::map<string, Times> times_t;
+
+    void observe(const string& taskId, bench_clock::duration elapsed) {
+        const string kind = getKind(taskId);
+        std::lock_guard<std::mutex> guard(mutex);
+        Times& t = times[kind];
+        t.calls += 1;
+        t.total += elapsed;
+        if (elapsed > t.max)
+            t.max = elapsed;
+        activity.touch();
+    }
+
+    void take(times_t& result) {
+        std::lock_guard<std::mutex> guard(mutex);
+        result.clear();
+        result.swap(times);
+    }
+
+private:
+    /*
+     * Tasks updating an object from the policy are keyed by its URI,
+     * whose next to last element names its class; the others are
+     * keyed by a UUID, or by a fixed name for batched work.
+     */
+    static string getKind(const string& taskId) {
+        if (!taskId.empty() && taskId[0] == '/') {
+            std::vector<string> elements;
+            opflex::modb::URI(taskId).getElements(elements);
+            if (elements.size() >= 2)
+                return elements[elements.size() - 2];
+            if (!elements.empty())
+                return elements.back();
+        }
+        if (taskId.size() == 36 && std::count(taskId.begin(),
+                                              taskId.end(), '-') == 4)
+            return "uuid";
+        return taskId;
+    }
+
+    Activity& activity;
+    std::mutex mutex;
+    times_t times;
+};
+
+static double to_seconds(bench_clock::duration d) {
+    return std::chrono::duration<double>(d).count();
+}
+
+static long getMaxRss() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+    return usage.ru_maxrss;
+}
+
+/**
+ * Wait until no flow was written and no task ran for the settle
+ * time, and return when the last of them happened
+ */
+static bool waitSettled(const Activity& activity,
+                        std::chrono::milliseconds settle,
+                        std::chrono::seconds timeout,
+                        bench_clock::time_point& last) {
+    auto deadline = bench_clock::now() + timeout;
+    while (true) {
+        auto now = bench_clock::now();
+        last = activity.getLast();
+        if (now - last >= settle)
+            return true;
+        if (now >= deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+/**
+ * The state when a phase starts, which counts as activity so that
+ * the phase waits for the settle time from then on
+ */
+struct PhaseStart {
+    PhaseStart(ReplayFlowExecutor& exec)
+        : time(bench_clock::now()), edits(exec.getEdits()),
+          writes(exec.writes) {
+        exec.activity.touch();
+    }
+
+    bench_clock::time_point time;
+    uint64_t edits;
+    uint64_t writes;
+};
+
+static void reportPhase(const string& name, const PhaseStart& start,
+                        bench_clock::time_point end,
+                        const ReplayFlowExecutor& exec,
+                        HandlerTimes& handlers) {
+    double seconds = end > start.time ? to_seconds(end - start.time) : 0;
+    uint64_t edits = exec.getEdits() - start.edits;
+    std::printf("{\"name\":\"replay.%s\",\"ops\":%llu,\"seconds\":%.6f,"
+                "\"ops_per_sec\":%.1f,\"writes\":%llu,\"flows\":%llu,"
+                "\"max_rss_kb\":%ld}\n",
+                name.c_str(), (unsigned long long)edits, seconds,
+                seconds > 0 ? edits / seconds : 0,
+                (unsigned long long)(exec.writes - start.writes),
+                (unsigned long long)exec.getFlows(), getMaxRss());
+
+    HandlerTimes::times_t times;
+    handlers.take(times);
+    for (auto& t : times) {
+        double total = to_seconds(t.second.total);
+        std::printf("{\"name\":\"replay.%s.%s\",\"ops\":%zu,"
+                    "\"seconds\":%.6f,\"ops_per_sec\":%.1f,"
+                    "\"max_ms\":%.3f}\n",
+                    name.c_str(), t.first.c_str(), t.second.calls, total,
+                    total > 0 ? t.second.calls / total : 0,
+                    to_seconds(t.second.max) * 1000);
+    }
+    std::fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+    // Parse command line options
+    po::options_description desc("Allowed options");
+    try {
+        desc.add_options()
+            ("help,h", "Print this help message")
+            ("level", po::value<string>()->default_value("error"),
+             "Use the specified log level (default error).")
+            ("modb,m", po::value<string>(),
+             "The MODB dump or store image to replay")
+            ("endpoints,e", po::value<string>(),
+             "A directory of endpoint files to replay")
+            ("services,s", po::value<string>(),
+             "A directory of service files to replay")
+            ("generate,g", po::value<string>(),
+             "Generate the policy, endpoints and services instead of "
+             "loading them, at a size given as a list such as "
+             "tenants=2,epgs=100,endpoints=5000,services=100")
+            ("encap", po::value<string>()->default_value("vxlan"),
+             "The encapsulation to use: vxlan, ivxlan or vlan")
+            ("threads", po::value<size_t>()->default_value(0),
+             "The number of threads that compute the policy flows")
+            ("settle", po::value<long>()->default_value(1000),
+             "Milliseconds without flow writes or tasks after which "
+             "a phase is done")
+            ("timeout", po::value<long>()->default_value(600),
+             "Seconds to wait for a phase before giving up");
+    } catch (const boost::bad_lexical_cast& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    string level_str;
+    string modb_file;
+    string ep_dir;
+    string svc_dir;
+    boost::optional<opflexagent::ScaleGenerator> generator;
+    string encap;
+    size_t threads;
+    std::chrono::milliseconds settle;
+    std::chrono::seconds timeout;
+
+    po::variables_map vm;
+    try {
+        po::store(po::command_line_parser(argc, argv).
+                  options(desc).run(), vm);
+        po::notify(vm);
+        if (vm.count("help") ||
+            (!vm.count("modb") && !vm.count("generate"))) {
+            std::cout << "Usage: " << argv[0] << " [options]\n";
+            std::cout << desc;
+            std::cout << "Results are written to standard output as one "
+                      << "JSON object per line:\nfor each phase, the flow "
+                      << "changes written, then the tasks run\nper kind "
+                      << "of object they update." << std::endl;
+            return vm.count("help") ? 0 : 1;
+        }
+        level_str = vm["level"].as<string>();
+        if (vm.count("modb"))
+            modb_file = vm["modb"].as<string>();
+        if (vm.count("generate")) {
+            opflexagent::ScaleGenerator::Params params;
+            params.parse(vm["generate"].as<string>());
+            generator = opflexagent::ScaleGenerator(params);
+        }
+        if (vm.count("endpoints"))
+            ep_dir = vm["endpoints"].as<string>();
+        if (vm.count("services"))
+            svc_dir = vm["services"].as<string>();
+        encap = vm["encap"].as<string>();
+        threads = vm["threads"].as<size_t>();
+        settle = std::chrono::milliseconds(vm["settle"].as<long>());
+        timeout = std::chrono::seconds(vm["timeout"].as<long>());
+    } catch (const po::unknown_option& e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    } catch (const std::bad_cast& e) {
+        std::cerr << e.what() << std::endl;
+        return 3;
+    } catch (const std::invalid_argument& e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    }
+
+    opflexagent::IntFlowManager::EncapType encapType;
+    if (encap == "vxlan") {
+        encapType = opflexagent::IntFlowManager::ENCAP_VXLAN;
+    } else if (encap == "ivxlan") {
+        encapType = opflexagent::IntFlowManager::ENCAP_IVXLAN;
+    } else if (encap == "vlan") {
+        encapType = opflexagent::IntFlowManager::ENCAP_VLAN;
+    } else {
+        std::cerr << "Unknown encapsulation " << encap << std::endl;
+        return 2;
+    }
+
+    opflexagent::initLogging(level_str, false, "");
+
+    // the generated files are written before the run so that writing
+    // them is not measured
+    boost::filesystem::path gen_dir;
+    if (generator) {
+        gen_dir = boost::filesystem::temp_directory_path() /
+            boost::filesystem::unique_path("ovs-replay-%%%%-%%%%");
+        if (ep_dir.empty() && generator->getParams().endpoints > 0) {
+            ep_dir = (gen_dir / "endpoints").string();
+            generator->writeEndpoints(ep_dir);
+        }
+        if (svc_dir.empty() && generator->getParams().services > 0) {
+            svc_dir = (gen_dir / "services").string();
+            generator->writeServices(svc_dir);
+        }
+    }
+
+    opflex::ofcore::MockOFFramework framework;
+    opflexagent::Agent agent(framework, std::make_tuple(level_str, false, ""));
+    agent.start();
+
+    Activity activity;
+    HandlerTimes handlers(activity);
+    ReplayFlowExecutor exec(activity);
+    opflexagent::MockFlowReader reader;
+    ReplayPortMapper portMapper;
+    ReplaySwitchManager switchManager(agent, exec, reader, portMapper);
+    opflexagent::IdGenerator idGen;
+    opflexagent::CtZoneManager ctZoneManager(idGen);
+    opflexagent::TunnelEpManager tunnelEpManager(&agent);
+    opflexagent::IntFlowManager intFlowManager(agent, switchManager, idGen,
+                                               ctZoneManager,
+                                               tunnelEpManager);
+
+    ctZoneManager.setCtZoneRange(1, 65534);
+    ctZoneManager.init("conntrack");
+    intFlowManager.enableConnTrack();
+    intFlowManager.setEncapType(encapType);
+    intFlowManager.setEncapIface("br-int_vxlan0");
+    intFlowManager.setUplinkIface("uplink");
+    intFlowManager.setFloodScope(opflexagent::IntFlowManager::ENDPOINT_GROUP);
+    if (encapType != opflexagent::IntFlowManager::ENCAP_VLAN)
+        intFlowManager.setTunnel("10.0.0.1", 4789);
+    intFlowManager.setVirtualRouter(true, true, "00:22:bd:f8:19:ff");
+    intFlowManager.setVirtualDHCP(true, "00:22:bd:f8:19:ff");
+    intFlowManager.setFlowComputeThreads(threads);
+    intFlowManager.setTaskTimer([&handlers](const string& taskId,
+                                            bench_clock::duration elapsed) {
+            handlers.observe(taskId, elapsed);
+        });
+
+    switchManager.setSyncDelayOnConnect(0);
+    switchManager.registerStateHandler(&intFlowManager);
+    switchManager.start("br-int");
+    intFlowManager.start();
+    intFlowManager.registerModbListeners();
+    switchManager.enableSync();
+    switchManager.connect();
+
+    int result = 0;
+    bench_clock::time_point end;
+    {
+        // the static flows written once connected
+        PhaseStart start(exec);
+        if (!waitSettled(activity, settle, timeout, end))
+            result = 4;
+        reportPhase("connect", start, end, exec, handlers);
+    }
+    if (result == 0) {
+        PhaseStart start(exec);
+        size_t objs = 1;
+        if (generator)
+            generator->writePolicy(framework);
+        else
+            objs = framework.loadMODB(modb_file);
+        activity.touch();
+        if (objs == 0) {
+            LOG(ERROR) << "No managed objects loaded from " << modb_file;
+            result = 5;
+        } else if (!waitSettled(activity, settle, timeout, end)) {
+            result = 4;
+        }
+        reportPhase("policy", start, end, exec, handlers);
+    }
+
+    // a watcher per directory, so that each phase scans only its own
+    opflexagent::FSWatcher epWatcher;
+    opflexagent::FSWatcher svcWatcher;
+    std::unique_ptr<opflexagent::FSEndpointSource> epSource;
+    std::unique_ptr<opflexagent::FSServiceSource> svcSource;
+    if (result == 0 && !ep_dir.empty()) {
+        PhaseStart start(exec);
+        epSource.reset(new opflexagent::
+                       FSEndpointSource(&agent.getEndpointManager(),
+                                        epWatcher, ep_dir));
+        epWatcher.start();
+        if (!waitSettled(activity, settle, timeout, end))
+            result = 4;
+        reportPhase("endpoints", start, end, exec, handlers);
+    }
+    if (result == 0 && !svc_dir.empty()) {
+        PhaseStart start(exec);
+        svcSource.reset(new opflexagent::
+                        FSServiceSource(&agent.getServiceManager(),
+                                        svcWatcher, svc_dir));
+        svcWatcher.start();
+        if (!waitSettled(activity, settle, timeout, end))
+            result = 4;
+        reportPhase("services", start, end, exec, handlers);
+    }
+    if (result == 4)
+        LOG(ERROR) << "Flows did not settle within " << timeout.count()
+                   << " seconds";
+
+    svcWatcher.stop();
+    epWatcher.stop();
+    intFlowManager.stop();
+    switchManager.stop();
+    agent.stop();
+    if (!gen_dir.empty())
+        boost::filesystem::remove_all(gen_dir);
+    return result;
+}
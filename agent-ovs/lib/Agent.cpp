@@ -14,6 +14,7 @@
 #endif
 
 #include <boost/algorithm/string/join.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_generators.hpp>
 #include <boost/uuid/uuid_io.hpp>
@@ -22,6 +23,7 @@
 #include <opflexagent/cmd.h>
 #include <opflexagent/Agent.h>
 #include <opflexagent/FSEndpointSource.h>
+#include <opflexagent/DBEndpointSource.h>
 #include <opflexagent/ModelEndpointSource.h>
 #include <opflexagent/FSServiceSource.h>
 #include <opflexagent/FSRDConfigSource.h>
@@ -36,12 +38,16 @@
 #include <opflexagent/FSFaultSource.h>
 #include <opflexagent/FaultSource.h>
 
+#include <opflex/util/ThreadSettings.h>
+
 #include <mutex>
 #include <condition_variable>
 #include <chrono>
+#include <map>
 #include <random>
 
 #include <dlfcn.h>
+#include <pthread.h>
 #include <cstdlib>
 
 namespace opflexagent {
@@ -58,7 +64,8 @@ using boost::uuids::to_string;
 using boost::uuids::basic_random_generator;
 
 Agent::Agent(OFFramework& framework_, const LogParams& _logParams)
-    : framework(framework_),
+    : startupPeerListener(startupTimeline),
+      statsIOThreads(1), framework(framework_),
       prometheusManager(*this, framework),
       policyManager(framework, agent_io),
       endpointManager(*this, framework, policyManager, prometheusManager),
@@ -72,15 +79,19 @@ Agent::Agent(OFFramework& framework_, const LogParams& _logParams)
       netflowManager(framework,agent_io),
       qosManager(*this,framework, agent_io),
       sysStatsEnabled(true),
-      sysStatsInterval(10000),
+      sysStatsInterval(10000), sysClassStatsInterval(300000),
       prometheusEnabled(true),
       prometheusExposeLocalHostOnly(false),
       prometheusExposeEpSvcNan(false),
+      prometheusExposeGroupPaths(false),
       behaviorL34FlowsWithoutSubnet(true),
       logParams(_logParams) {
     std::random_device rng;
     std::mt19937 urng(rng());
     uuid = to_string(basic_random_generator<std::mt19937>(urng)());
+    policyManager.setWatchdog(taskWatchdog);
+    spanManager.setWatchdog(taskWatchdog);
+    netflowManager.setWatchdog(taskWatchdog);
 }
 
 Agent::~Agent() {
@@ -138,26 +149,54 @@ void Agent::loadPlugin(const std::string& name) {
               << boost::algorithm::join(names, ",");
 }
 
+static void getPeers(const ptree& properties,
+                     std::set<std::pair<std::string, int> >& peers) {
+    static const std::string OPFLEX_PEERS("opflex.peers");
+    static const std::string HOSTNAME("hostname");
+    static const std::string PORT("port");
+
+    optional<const ptree&> peerTree =
+        properties.get_child_optional(OPFLEX_PEERS);
+    if (!peerTree) return;
+    for (const ptree::value_type &v : peerTree.get()) {
+        optional<std::string> h =
+            v.second.get_optional<std::string>(HOSTNAME);
+        optional<int> p =
+            v.second.get_optional<int>(PORT);
+        if (h && p) {
+            peers.insert(make_pair(h.get(), p.get()));
+        }
+    }
+}
+
 void Agent::setProperties(const boost::property_tree::ptree& properties) {
+    StartupTimeline::Phase phase(startupTimeline, "config");
+    configProperties.push_back(properties);
     static const std::string LOG_LEVEL("log.level");
+    static const std::string LOG_ASYNC("log.async");
+    static const std::string THREADS("threads");
     static const std::string PROMETHEUS_ENABLED("prometheus.enabled");
     static const std::string PROMETHEUS_LOCALHOST_ONLY("prometheus.localhost-only");
     static const std::string PROMETHEUS_EXPOSE_EPSVC_NAN("prometheus.expose-epsvc-nan");
+    static const std::string PROMETHEUS_EXPOSE_GROUP_PATHS("prometheus.expose-group-paths");
+    static const std::string PROMETHEUS_MAX_EPS("prometheus.max-endpoints");
+    static const std::string PROMETHEUS_MAX_SVC_TARGETS("prometheus.max-svc-targets");
+    static const std::string PROMETHEUS_LAZY_EP_METRICS("prometheus.lazy-ep-metrics");
+    static const std::string PROMETHEUS_EP_EXPORT("prometheus.ep-export");
     static const std::string PROMETHEUS_EP_ATTRIBUTES("prometheus.ep-attributes");
     static const std::string ENDPOINT_SOURCE_FSPATH("endpoint-sources.filesystem");
     static const std::string ENDPOINT_SOURCE_MODEL_LOCAL("endpoint-sources.model-local");
+    static const std::string ENDPOINT_SOURCE_DATABASE("endpoint-sources.database");
     static const std::string SERVICE_SOURCE_PATH("service-sources.filesystem");
     static const std::string SNAT_SOURCE_PATH("snat-sources.filesystem");
     static const std::string DROP_LOG_CFG_SOURCE_FSPATH("drop-log-config-sources.filesystem");
     static const std::string FAULT_SOURCE_FSPATH("host-agent-fault-sources.filesystem");
+    static const std::string FS_WATCH_DEBOUNCE("filesystem-watch.debounce");
     static const std::string PACKET_EVENT_NOTIF_SOCK("packet-event-notif.socket-name");
-    static const std::string OPFLEX_PEERS("opflex.peers");
     static const std::string OPFLEX_SSL_MODE("opflex.ssl.mode");
     static const std::string OPFLEX_SSL_CA_STORE("opflex.ssl.ca-store");
     static const std::string OPFLEX_SSL_CERT_PATH("opflex.ssl.client-cert.path");
     static const std::string OPFLEX_SSL_CERT_PASS("opflex.ssl.client-cert.password");
-    static const std::string HOSTNAME("hostname");
-    static const std::string PORT("port");
     static const std::string OPFLEX_INSPECTOR("opflex.inspector.enabled");
     static const std::string OPFLEX_INSPECTOR_SOCK("opflex.inspector.socket-name");
     static const std::string OPFLEX_NOTIF("opflex.notif.enabled");
@@ -165,6 +204,7 @@ void Agent::setProperties(const boost::property_tree::ptree& properties) {
     static const std::string OPFLEX_NOTIF_OWNER("opflex.notif.socket-owner");
     static const std::string OPFLEX_NOTIF_GROUP("opflex.notif.socket-group");
     static const std::string OPFLEX_NOTIF_PERMS("opflex.notif.socket-permissions");
+    static const std::string OPFLEX_NOTIF_MAX_QUEUED("opflex.notif.max-queued");
 
     static const std::string OPFLEX_NAME("opflex.name");
     static const std::string OPFLEX_DOMAIN("opflex.domain");
@@ -178,13 +218,30 @@ void Agent::setProperties(const boost::property_tree::ptree& properties) {
     static const std::string OPFLEX_STATS_MODE("opflex.statistics.mode");
     static const std::string OPFLEX_STATS_SYSTEM_ENABLED("opflex.statistics.system.enabled");
     static const std::string OPFLEX_STATS_SYSTEM_INTERVAL("opflex.statistics.system.interval");
+    static const std::string OPFLEX_STATS_SYSTEM_CLASS_INTERVAL("opflex.statistics.system.class-interval");
+    static const std::string OPFLEX_STATS_IO_THREADS("opflex.statistics.io-threads");
     static const std::string OPFLEX_PRR_INTERVAL("opflex.timers.prr");
+    static const std::string OPFLEX_ENDPOINT_LEASE("opflex.timers.endpoint-lease");
+    static const std::string OPFLEX_RENEWAL_BUCKETS("opflex.timers.renewal-buckets");
     static const std::string OPFLEX_HANDSHAKE("opflex.timers.handshake-timeout");
     static const std::string OPFLEX_KEEPALIVE("opflex.timers.keepalive-timeout");
+    static const std::string OPFLEX_SLOW_TASK("opflex.timers.slow-task-threshold");
     static const std::string DISABLED_FEATURES("feature.disabled");
     static const std::string BEHAVIOR_L34FLOWS_WITHOUT_SUBNET("behavior.l34flows-without-subnet");
     static const std::string OPFLEX_ASYC_JSON("opflex.asyncjson.enabled");
     static const std::string OVS_ASYNC_JSON("ovs.asyncjson.enabled");
+    static const std::string OPFLEX_URI_INTERNING("opflex.modb.uri-interning");
+    static const std::string OPFLEX_NOTIF_WORKERS("opflex.modb.notification-workers");
+    static const std::string OPFLEX_JOURNAL_SIZE("opflex.modb.journal-size");
+    static const std::string OPFLEX_PROC_THREADS("opflex.processor.threads");
+    static const std::string OPFLEX_LOAD_SHARING("opflex.processor.load-sharing");
+    static const std::string OPFLEX_COMPRESSION("opflex.compression");
+    static const std::string OPFLEX_BINARY_ENCODING("opflex.binary-encoding");
+    static const std::string OPFLEX_PARSE_OFFLOAD("opflex.parse-offload");
+    static const std::string OPFLEX_REPORT_INTERVAL("opflex.statereport.interval");
+    static const std::string OPFLEX_REPORT_BUDGET("opflex.statereport.byte-budget");
+    static const std::string OPFLEX_POLICY_CACHE_FILE("opflex.policy-cache.file");
+    static const std::string OPFLEX_POLICY_CACHE_INTERVAL("opflex.policy-cache.interval");
 
     // set feature flags to true
     clearFeatureFlags();
@@ -200,6 +257,31 @@ void Agent::setProperties(const boost::property_tree::ptree& properties) {
         logParams = std::make_tuple(level_str, toSyslog, log_file);
     }
 
+    // apply the thread settings before the first threads are started
+    optional<const ptree&> threads = properties.get_child_optional(THREADS);
+    if (threads) {
+        opflex::util::clearThreadSettings();
+        for (const ptree::value_type& v : threads.get()) {
+            opflex::util::ThreadSettings settings;
+            optional<const ptree&> cpus =
+                v.second.get_child_optional("cpus");
+            if (cpus) {
+                for (const ptree::value_type& c : cpus.get())
+                    settings.cpus.push_back(c.second.get_value<int>());
+            }
+            settings.policy =
+                v.second.get_optional<std::string>("policy");
+            settings.priority = v.second.get<int>("priority", 0);
+            settings.nice = v.second.get_optional<int>("nice");
+            opflex::util::setThreadSettings(v.first == "default"
+                                            ? "" : v.first, settings);
+        }
+    }
+
+    optional<bool> logAsync = properties.get_optional<bool>(LOG_ASYNC);
+    if (logAsync)
+        setAsyncLogging(logAsync.get());
+
     optional<std::string> ofName =
         properties.get_optional<std::string>(OPFLEX_NAME);
     if (ofName) opflexName = ofName;
@@ -224,6 +306,8 @@ void Agent::setProperties(const boost::property_tree::ptree& properties) {
         properties.get_optional<std::string>(OPFLEX_NOTIF_GROUP);
     optional<std::string> notPerms =
         properties.get_optional<std::string>(OPFLEX_NOTIF_PERMS);
+    optional<size_t> notMaxQueued =
+        properties.get_optional<size_t>(OPFLEX_NOTIF_MAX_QUEUED);
     optional<const ptree&> statChild = properties.get_child_optional(OPFLEX_STATS);
     optional<std::string> statMode_json;
     if (statChild)
@@ -234,6 +318,7 @@ void Agent::setProperties(const boost::property_tree::ptree& properties) {
     if (notOwner) notifOwner = notOwner;
     if (notGrp) notifGroup = notGrp;
     if (notPerms) notifPerms = notPerms;
+    if (notMaxQueued) notifMaxQueued = notMaxQueued;
     if (statMode_json) {
         statMode = getStatModeFromString(statMode_json.get());
     }
@@ -257,6 +342,10 @@ void Agent::setProperties(const boost::property_tree::ptree& properties) {
     if (sysStatsInterval <= 0) {
         sysStatsEnabled = false;
     }
+    sysClassStatsInterval =
+        properties.get<long>(OPFLEX_STATS_SYSTEM_CLASS_INTERVAL, 300000);
+    statsIOThreads =
+        std::max<size_t>(1, properties.get<size_t>(OPFLEX_STATS_IO_THREADS, 1));
 
     optional<bool> prometheusIsEnabled =
                 properties.get_optional<bool>(PROMETHEUS_ENABLED);
@@ -279,6 +368,35 @@ void Agent::setProperties(const boost::property_tree::ptree& properties) {
             prometheusExposeEpSvcNan = true;
     }
 
+    optional<bool> prometheusGroupPaths =
+                properties.get_optional<bool>(PROMETHEUS_EXPOSE_GROUP_PATHS);
+    if (prometheusGroupPaths) {
+        if (prometheusGroupPaths.get() == true)
+            prometheusExposeGroupPaths = true;
+    }
+
+    prometheusBudget.maxEps =
+        properties.get<size_t>(PROMETHEUS_MAX_EPS, prometheusBudget.maxEps);
+    prometheusBudget.maxSvcTargets =
+        properties.get<size_t>(PROMETHEUS_MAX_SVC_TARGETS,
+                               prometheusBudget.maxSvcTargets);
+    prometheusBudget.lazyEpGauges =
+        properties.get<bool>(PROMETHEUS_LAZY_EP_METRICS,
+                             prometheusBudget.lazyEpGauges);
+    optional<std::string> epExport =
+        properties.get_optional<std::string>(PROMETHEUS_EP_EXPORT);
+    if (epExport) {
+        if (epExport.get() == "top-drops")
+            prometheusBudget.epExportMode =
+                AgentPrometheusManager::EP_EXPORT_TOP_DROPS;
+        else if (epExport.get() == "first")
+            prometheusBudget.epExportMode =
+                AgentPrometheusManager::EP_EXPORT_FIRST;
+        else
+            LOG(ERROR) << "Invalid " << PROMETHEUS_EP_EXPORT << ": "
+                       << epExport.get();
+    }
+
     optional<const ptree&> epAttributes =
         properties.get_child_optional(PROMETHEUS_EP_ATTRIBUTES);
     if (epAttributes) {
@@ -302,6 +420,14 @@ void Agent::setProperties(const boost::property_tree::ptree& properties) {
             endpointSourceModelLocalNames.insert(v.second.data());
     }
 
+    optional<const ptree&> dbEndpointSource =
+        properties.get_child_optional(ENDPOINT_SOURCE_DATABASE);
+
+    if (dbEndpointSource) {
+        for (const ptree::value_type &v : dbEndpointSource.get())
+            endpointSourceDBPaths.insert(v.second.data());
+    }
+
     optional<const ptree&> serviceSource =
         properties.get_child_optional(SERVICE_SOURCE_PATH);
 
@@ -333,6 +459,14 @@ void Agent::setProperties(const boost::property_tree::ptree& properties) {
         for (const ptree::value_type &v : hostAgentFaultSrc.get())
             hostAgentFaultPaths.insert(v.second.data());
     }
+
+    optional<uint64_t> fsWatchDebounce =
+        properties.get_optional<uint64_t>(FS_WATCH_DEBOUNCE);
+    if (fsWatchDebounce) {
+        fsWatcher.setDebounce(fsWatchDebounce.get());
+        LOG(INFO) << "Filesystem event debounce set to "
+                  << fsWatchDebounce.get() << " ms";
+    }
     
     optional<const ptree&> packetEventNotifSock =
         properties.get_child_optional(PACKET_EVENT_NOTIF_SOCK);
@@ -342,19 +476,7 @@ void Agent::setProperties(const boost::property_tree::ptree& properties) {
             packetEventNotifSockPath = v.second.data();
     }
 
-    optional<const ptree&> peers =
-        properties.get_child_optional(OPFLEX_PEERS);
-    if (peers) {
-        for (const ptree::value_type &v : peers.get()) {
-            optional<std::string> h =
-                v.second.get_optional<std::string>(HOSTNAME);
-            optional<int> p =
-                v.second.get_optional<int>(PORT);
-            if (h && p) {
-                opflexPeers.insert(make_pair(h.get(), p.get()));
-            }
-        }
-    }
+    getPeers(properties, opflexPeers);
 
     optional<std::string> confSslMode =
         properties.get_optional<std::string>(OPFLEX_SSL_MODE);
@@ -453,12 +575,30 @@ void Agent::setProperties(const boost::property_tree::ptree& properties) {
         LOG(INFO) << "prr timer set to " << prr_timer << " secs";
     }
 
+    optional<uint64_t> endpointLeaseOpt =
+        properties.get_optional<uint64_t>(OPFLEX_ENDPOINT_LEASE);
+    if (endpointLeaseOpt) {
+        endpointLease = endpointLeaseOpt.get();
+        LOG(INFO) << "endpoint lease set to " << endpointLease << " secs";
+    }
+    optional<size_t> renewalBucketsOpt =
+        properties.get_optional<size_t>(OPFLEX_RENEWAL_BUCKETS);
+    if (renewalBucketsOpt) {
+        renewalBuckets = renewalBucketsOpt.get();
+    }
+
     optional<uint32_t> handshakeOpt = properties.get_optional<uint32_t>(OPFLEX_HANDSHAKE);
     if (handshakeOpt) {
         peerHandshakeTimeout = handshakeOpt.get();
         LOG(INFO) << "peer handshake timeout set to " << peerHandshakeTimeout << " ms";
     }
 
+    optional<uint32_t> slowTaskOpt = properties.get_optional<uint32_t>(OPFLEX_SLOW_TASK);
+    if (slowTaskOpt) {
+        taskWatchdog.setThreshold(std::chrono::milliseconds(slowTaskOpt.get()));
+        LOG(INFO) << "slow task threshold set to " << slowTaskOpt.get() << " ms";
+    }
+
     optional<uint32_t> keepaliveOpt = properties.get_optional<uint32_t>(OPFLEX_KEEPALIVE);
     if (keepaliveOpt) {
         keepaliveTimeout = keepaliveOpt.get();
@@ -487,9 +627,311 @@ void Agent::setProperties(const boost::property_tree::ptree& properties) {
         if (ovsAsyncJsonEnabled.get() == true)
             setenv("OVS_USE_ASYNC_JSON", "", true);
     }
+
+    optional<bool> uriInterning =
+        properties.get_optional<bool>(OPFLEX_URI_INTERNING);
+    if (uriInterning) {
+        opflex::modb::URI::setInterning(uriInterning.get());
+        LOG(INFO) << "URI interning "
+                  << (uriInterning.get() ? "enabled" : "disabled");
+    }
+
+    optional<size_t> notifWorkersOpt =
+        properties.get_optional<size_t>(OPFLEX_NOTIF_WORKERS);
+    if (notifWorkersOpt) {
+        if (notifWorkersOpt.get() < 1) {
+            LOG(ERROR) << "Ignoring invalid number of notification workers: "
+                       << notifWorkersOpt.get();
+        } else {
+            notifWorkers = notifWorkersOpt.get();
+            LOG(INFO) << "MODB notification workers set to " << notifWorkers;
+        }
+    }
+
+    optional<size_t> journalSizeOpt =
+        properties.get_optional<size_t>(OPFLEX_JOURNAL_SIZE);
+    if (journalSizeOpt) {
+        journalSize = journalSizeOpt.get();
+        LOG(INFO) << "MODB change journal size set to " << journalSize;
+    }
+
+    optional<size_t> procThreadsOpt =
+        properties.get_optional<size_t>(OPFLEX_PROC_THREADS);
+    if (procThreadsOpt) {
+        if (procThreadsOpt.get() < 1) {
+            LOG(ERROR) << "Ignoring invalid number of processing threads: "
+                       << procThreadsOpt.get();
+        } else {
+            procThreads = procThreadsOpt.get();
+            LOG(INFO) << "OpFlex processing threads set to " << procThreads;
+        }
+    }
+
+    optional<bool> loadSharingOpt =
+        properties.get_optional<bool>(OPFLEX_LOAD_SHARING);
+    if (loadSharingOpt) {
+        loadSharing = loadSharingOpt.get();
+        LOG(INFO) << "OpFlex peer load sharing "
+                  << (loadSharing ? "enabled" : "disabled");
+    }
+
+    optional<bool> compressionOpt =
+        properties.get_optional<bool>(OPFLEX_COMPRESSION);
+    if (compressionOpt) {
+        compression = compressionOpt.get();
+        LOG(INFO) << "OpFlex compression "
+                  << (compression ? "enabled" : "disabled");
+    }
+
+    optional<bool> binaryEncodingOpt =
+        properties.get_optional<bool>(OPFLEX_BINARY_ENCODING);
+    if (binaryEncodingOpt) {
+        binaryEncoding = binaryEncodingOpt.get();
+        LOG(INFO) << "OpFlex binary encoding "
+                  << (binaryEncoding ? "enabled" : "disabled");
+    }
+
+    optional<size_t> parseOffloadOpt =
+        properties.get_optional<size_t>(OPFLEX_PARSE_OFFLOAD);
+    if (parseOffloadOpt) {
+        parseOffload = parseOffloadOpt.get();
+        LOG(INFO) << "OpFlex messages of at least " << parseOffload
+                  << " bytes parsed off the connection thread";
+    }
+
+    optional<uint64_t> reportIntervalOpt =
+        properties.get_optional<uint64_t>(OPFLEX_REPORT_INTERVAL);
+    if (reportIntervalOpt) {
+        stateReportInterval = reportIntervalOpt.get();
+        LOG(INFO) << "State report interval set to "
+                  << stateReportInterval << " ms";
+    }
+
+    optional<uint64_t> reportBudgetOpt =
+        properties.get_optional<uint64_t>(OPFLEX_REPORT_BUDGET);
+    if (reportBudgetOpt) {
+        stateReportBudget = reportBudgetOpt.get();
+        LOG(INFO) << "State report byte budget set to "
+                  << stateReportBudget << " bytes per second";
+    }
+
+    optional<std::string> policyCacheFileOpt =
+        properties.get_optional<std::string>(OPFLEX_POLICY_CACHE_FILE);
+    if (policyCacheFileOpt) {
+        policyCacheFile = policyCacheFileOpt.get();
+        LOG(INFO) << "Policy cache file set to \"" << policyCacheFile << "\"";
+    }
+
+    optional<uint64_t> policyCacheIntervalOpt =
+        properties.get_optional<uint64_t>(OPFLEX_POLICY_CACHE_INTERVAL);
+    if (policyCacheIntervalOpt) {
+        policyCacheInterval = policyCacheIntervalOpt.get();
+        LOG(INFO) << "Policy cache interval set to "
+                  << policyCacheInterval << " ms";
+    }
+}
+
+typedef std::map<std::string, std::string> flat_config_t;
+
+/* map the path of each value in a configuration tree to the value;
+   the elements of arrays are named by their index */
+static void flattenConfig(const ptree& tree, const std::string& prefix,
+                          flat_config_t& flat) {
+    if (tree.empty()) {
+        flat[prefix] = tree.data();
+        return;
+    }
+    size_t index = 0;
+    for (const ptree::value_type& v : tree) {
+        std::string key = v.first.empty() ? std::to_string(index) : v.first;
+        index += 1;
+        flattenConfig(v.second, prefix.empty() ? key : prefix + "." + key,
+                      flat);
+    }
+}
+
+/* the paths of the values that differ between two configurations */
+static void getChangedPaths(const std::vector<ptree>& oldConfig,
+                            const std::vector<ptree>& newConfig,
+                            std::set<std::string>& paths) {
+    for (size_t i = 0; i < std::max(oldConfig.size(), newConfig.size()); ++i) {
+        flat_config_t oldFlat, newFlat;
+        if (i < oldConfig.size())
+            flattenConfig(oldConfig[i], "", oldFlat);
+        if (i < newConfig.size())
+            flattenConfig(newConfig[i], "", newFlat);
+        for (const flat_config_t::value_type& v : oldFlat) {
+            auto it = newFlat.find(v.first);
+            if (it == newFlat.end() || it->second != v.second)
+                paths.insert(v.first);
+        }
+        for (const flat_config_t::value_type& v : newFlat) {
+            if (oldFlat.find(v.first) == oldFlat.end())
+                paths.insert(v.first);
+        }
+    }
+}
+
+/* the value of a setting in the last configuration file that has it */
+template <typename T>
+static optional<T> getLastValue(const std::vector<ptree>& properties,
+                                const std::string& path) {
+    optional<T> value;
+    for (const ptree& p : properties) {
+        optional<T> v = p.get_optional<T>(path);
+        if (v) value = v;
+    }
+    return value;
+}
+
+optional<ptree>
+Agent::getRendererConfig(const std::vector<ptree>& properties,
+                         const std::string& name) const {
+    static const std::string RENDERERS("renderers");
+    static const std::string OPFLEX_STATS("opflex.statistics");
+
+    // as in setProperties, the last file that configures the
+    // renderer wins
+    optional<ptree> config;
+    for (const ptree& p : properties) {
+        optional<const ptree&> rendConfig = p.get_child_optional(RENDERERS);
+        if (!rendConfig) continue;
+        optional<const ptree&> rtree =
+            rendConfig.get().get_child_optional(name);
+        if (!rtree) continue;
+        config = rtree.get();
+        optional<const ptree&> statChild = p.get_child_optional(OPFLEX_STATS);
+        if (statMode == StatMode::REAL && statChild)
+            config.get().add_child("statistics", statChild.get());
+    }
+    return config;
+}
+
+bool Agent::reloadProperties(const std::vector<ptree>& properties) {
+    static const std::string LOG_LEVEL("log.level");
+    static const std::string OPFLEX_SLOW_TASK("opflex.timers.slow-task-threshold");
+    static const std::string OPFLEX_PEERS("opflex.peers");
+    static const std::string RENDERERS("renderers");
+    static const std::string OPFLEX_STATS("opflex.statistics");
+    static const std::string OPFLEX_STATS_MODE("opflex.statistics.mode");
+    static const std::string OPFLEX_STATS_SYSTEM("opflex.statistics.system");
+    static const std::string OPFLEX_STATS_IO_THREADS("opflex.statistics.io-threads");
+
+    auto isUnder = [](const std::string& path, const std::string& prefix) {
+        return path == prefix || boost::starts_with(path, prefix + ".");
+    };
+    // the name of the renderer that a path configures, if any
+    auto rendererOf = [](const std::string& path) {
+        if (!boost::starts_with(path, RENDERERS + "."))
+            return std::string();
+        size_t start = RENDERERS.size() + 1;
+        return path.substr(start, path.find('.', start) - start);
+    };
+
+    std::set<std::string> changed;
+    getChangedPaths(configProperties, properties, changed);
+    if (changed.empty()) {
+        LOG(INFO) << "Configuration is unchanged";
+        return true;
+    }
+
+    bool logChanged = false, slowTaskChanged = false;
+    bool peersChanged = false, rendChanged = false;
+    for (const std::string& path : changed) {
+        if (path == LOG_LEVEL) {
+            logChanged = true;
+        } else if (path == OPFLEX_SLOW_TASK) {
+            slowTaskChanged = true;
+        } else if (isUnder(path, OPFLEX_PEERS)) {
+            peersChanged = true;
+        } else if (renderers.find(rendererOf(path)) != renderers.end()) {
+            rendChanged = true;
+        } else if (isUnder(path, OPFLEX_STATS) &&
+                   !isUnder(path, OPFLEX_STATS_MODE) &&
+                   !isUnder(path, OPFLEX_STATS_SYSTEM) &&
+                   !isUnder(path, OPFLEX_STATS_IO_THREADS)) {
+            // the renderers get the statistics settings
+            rendChanged = true;
+        } else {
+            LOG(INFO) << "Configuration change to " << path
+                      << " requires a restart";
+            return false;
+        }
+    }
+
+    // settings that are removed go back to their defaults, which
+    // only a restart applies
+    optional<std::string> logLevel =
+        getLastValue<std::string>(properties, LOG_LEVEL);
+    optional<uint32_t> slowTask =
+        getLastValue<uint32_t>(properties, OPFLEX_SLOW_TASK);
+    if ((logChanged && !logLevel) || (slowTaskChanged && !slowTask)) {
+        LOG(INFO) << "Removing a setting requires a restart";
+        return false;
+    }
+
+    std::set<host_t> newPeers;
+    for (const ptree& p : properties)
+        getPeers(p, newPeers);
+    if (peersChanged) {
+        if (rendererFwdMode == opflex::ofcore::OFConstants::TRANSPORT_MODE) {
+            LOG(INFO) << "Changing the peers in transport mode "
+                      << "requires a restart";
+            return false;
+        }
+        for (const host_t& h : opflexPeers) {
+            if (newPeers.find(h) == newPeers.end()) {
+                LOG(INFO) << "Removing peer " << h.first << ":" << h.second
+                          << " requires a restart";
+                return false;
+            }
+        }
+    }
+
+    if (rendChanged) {
+        for (const rend_map_t::value_type& v : rendPlugins) {
+            optional<ptree> oldConfig =
+                getRendererConfig(configProperties, v.first);
+            optional<ptree> newConfig =
+                getRendererConfig(properties, v.first);
+            if (oldConfig == newConfig) continue;
+
+            auto it = renderers.find(v.first);
+            if (it == renderers.end() || !newConfig ||
+                !it->second->reloadProperties(newConfig.get())) {
+                LOG(INFO) << "Configuration change to renderer "
+                          << v.first << " requires a restart";
+                return false;
+            }
+        }
+    }
+
+    if (logChanged) {
+        setLoggingLevel(logLevel.get());
+        std::string level_str, log_file;
+        bool toSyslog;
+        std::tie(level_str, toSyslog, log_file) = logParams;
+        logParams = std::make_tuple(getLogLevelString(), toSyslog, log_file);
+        LOG(INFO) << "Log level set to " << getLogLevelString();
+    }
+    if (slowTaskChanged) {
+        taskWatchdog.setThreshold(std::chrono::milliseconds(slowTask.get()));
+        LOG(INFO) << "slow task threshold set to " << slowTask.get() << " ms";
+    }
+    for (const host_t& h : newPeers) {
+        if (!opflexPeers.insert(h).second) continue;
+        LOG(INFO) << "Adding peer " << h.first << ":" << h.second;
+        if (started)
+            framework.addPeer(h.first, h.second);
+    }
+
+    configProperties = properties;
+    LOG(INFO) << "Applied configuration changes without restart";
+    return true;
 }
 
 void Agent::applyProperties() {
+    StartupTimeline::Phase phase(startupTimeline, "apply-config");
     if (!opflexName || !opflexDomain) {
         LOG(ERROR) << "Opflex name and domain must be set";
         throw std::runtime_error("Opflex name and domain must be set");
@@ -500,7 +942,8 @@ void Agent::applyProperties() {
     }
 
     if (endpointSourceFSPaths.empty() &&
-        endpointSourceModelLocalNames.empty())
+        endpointSourceModelLocalNames.empty() &&
+        endpointSourceDBPaths.empty())
         LOG(ERROR) << "No endpoint sources found in configuration.";
     if (serviceSourcePaths.empty())
         LOG(INFO) << "No service sources found in configuration.";
@@ -524,6 +967,8 @@ void Agent::applyProperties() {
             notifServer.setSocketGroup(notifGroup.get());
         if (notifPerms)
             notifServer.setSocketPerms(notifPerms.get());
+        if (notifMaxQueued)
+            notifServer.setMaxQueued(notifMaxQueued.get());
     }
 
     if (sslMode && sslMode.get() != "disabled") {
@@ -542,15 +987,42 @@ void Agent::applyProperties() {
     }
      
     framework.setPrrTimerDuration(prr_timer);
+    framework.setEndpointLease(endpointLease);
+    framework.setRenewalBuckets(renewalBuckets);
     framework.setHandshakeTimeout(peerHandshakeTimeout);
     framework.setKeepaliveTimeout(keepaliveTimeout);
+    if (!started) {
+        framework.setNotificationWorkers(notifWorkers);
+        framework.setProcessingThreads(procThreads);
+        framework.setPolicyCache(policyCacheFile, policyCacheInterval);
+    }
+    framework.setJournalSize(journalSize);
+    framework.setLoadSharing(loadSharing);
+    framework.setCompression(compression);
+    framework.setBinaryEncoding(binaryEncoding);
+    framework.setParseOffload(parseOffload);
+    framework.setStateReportInterval(stateReportInterval);
+    framework.setStateReportBudget(stateReportBudget);
 }
 
 void Agent::start() {
     LOG(INFO) << "Starting OpFlex Agent " << uuid;
     started = true;
 
+    startupTimeline.setConvergedCallback(
+        [this](const std::vector<StartupTimeline::Event>& events) {
+            LOG(INFO) << "Agent startup converged:" << std::endl << events;
+            if (!prometheusEnabled) return;
+            for (const StartupTimeline::Event& e : events)
+                prometheusManager.addNUpdateStartupStats(e.name,
+                    e.milestone ? e.start : e.end - e.start);
+        });
+    if (!opflexPeers.empty())
+        startupTimeline.expect("opflex-ready");
+    framework.registerPeerStatusListener(&startupPeerListener);
+
     // instantiate the opflex framework
+    startupTimeline.beginPhase("framework-start");
     framework.setModel(modelgbp::getMetadata());
     framework.setElementMode(this->rendererFwdMode);
     framework.start();
@@ -560,11 +1032,15 @@ void Agent::start() {
         modelgbp::dmtree::Root::createRootElement(framework);
     Agent::createUniverse(root);
     mutator.commit();
+    startupTimeline.endPhase("framework-start");
 
     // instantiate other components
+    startupTimeline.beginPhase("components-start");
     if (prometheusEnabled) {
+        prometheusManager.setCardinalityBudget(prometheusBudget);
         prometheusManager.start(prometheusExposeLocalHostOnly,
-                          prometheusExposeEpSvcNan);
+                          prometheusExposeEpSvcNan,
+                          prometheusExposeGroupPaths);
     } else {
         LOG(DEBUG) << "prometheus not enabled";
     }
@@ -576,14 +1052,27 @@ void Agent::start() {
     netflowManager.start();
     qosManager.start();
     if (sysStatsEnabled)
-        sysStatsManager.start(sysStatsInterval);
+        sysStatsManager.start(sysStatsInterval, sysClassStatsInterval);
+    startupTimeline.endPhase("components-start");
+    startupTimeline.beginPhase("renderers-start");
     for (auto& r : renderers) {
         r.second->start();
     }
+    startupTimeline.endPhase("renderers-start");
 
     io_work.reset(new io_service::work(agent_io));
-    io_service_thread.reset(new thread([this]() { agent_io.run(); }));
-
+    io_service_thread.reset(new thread(
+        opflex::util::startThread("agent_io", [this]() { agent_io.run(); })));
+    stats_io_work.reset(new io_service::work(stats_io));
+    for (size_t i = 0; i < statsIOThreads; ++i)
+        stats_io_threads.emplace_back(
+            opflex::util::startThread("agent_stats",
+                                      [this]() { stats_io.run(); }));
+    taskWatchdog.monitor("agent_io", agent_io);
+    taskWatchdog.monitor("agent_stats", stats_io);
+    taskWatchdog.start();
+
+    startupTimeline.beginPhase("sources-start");
     for (const std::string& path : endpointSourceFSPaths) {
         {
             EndpointSource* source =
@@ -613,6 +1102,12 @@ void Agent::start() {
                                         endpointSourceModelLocalNames);
         endpointSources.emplace_back(source);
     }
+    for (const std::string& path : endpointSourceDBPaths) {
+        DBEndpointSource* source =
+            new DBEndpointSource(&endpointManager, path);
+        dbEndpointSources.emplace_back(source);
+        source->start();
+    }
     for (const std::string& path : serviceSourcePaths) {
         ServiceSource* source =
             new FSServiceSource(&serviceManager, fsWatcher, path);
@@ -636,6 +1131,7 @@ void Agent::start() {
         faultSources.emplace_back(source);
     }
     fsWatcher.start();
+    startupTimeline.endPhase("sources-start");
 
     for (const host_t& h : opflexPeers)
         framework.addPeer(h.first, h.second);
@@ -693,6 +1189,8 @@ void Agent::stop() {
     } catch (const std::runtime_error& e) {
         LOG(WARNING) << "failed to stop fswatcher: " << e.what();
     }
+    for (auto& source : dbEndpointSources)
+        source->stop();
 
     notifServer.stop();
     endpointManager.stop();
@@ -705,6 +1203,7 @@ void Agent::stop() {
     prometheusManager.stop();
     LOG(DEBUG) << "Prometheus Manager stopped";
 
+    taskWatchdog.stop();
     if (io_work) {
         io_work.reset();
     }
@@ -713,9 +1212,17 @@ void Agent::stop() {
         io_service_thread.reset();
 	    LOG(DEBUG) << "IO service thread stopped";
     }
+    stats_io_work.reset();
+    for (thread& t : stats_io_threads)
+        t.join();
+    if (!stats_io_threads.empty()) {
+        stats_io_threads.clear();
+        LOG(DEBUG) << "Stats IO service threads stopped";
+    }
 
     framework.stop();
     endpointSources.clear();
+    dbEndpointSources.clear();
     rdConfigSources.clear();
     serviceSources.clear();
 
@@ -727,6 +1234,14 @@ void Agent::stop() {
     LOG(INFO) << "Agent stopped";
 }
 
+void Agent::StartupPeerListener::peerStatusUpdated(const std::string&, int,
+                                                   PeerStatus peerStatus) {
+    if (peerStatus == CONNECTED || peerStatus == READY)
+        timeline.mark("opflex-connected");
+    if (peerStatus == READY)
+        timeline.mark("opflex-ready");
+}
+
 void Agent::createUniverse (std::shared_ptr<modelgbp::dmtree::Root> root)
 {
     if (!root)
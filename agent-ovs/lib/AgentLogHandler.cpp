@@ -21,6 +21,7 @@ AgentLogHandler::~AgentLogHandler() { }
 
 void AgentLogHandler::setLevel(Level loggerLevel) {
     logLevel_ = loggerLevel;
+    OFLogHandler::setMinimumLevel(loggerLevel);
 }
 
 void AgentLogHandler::setLevelString(const std::string &levelstr) {
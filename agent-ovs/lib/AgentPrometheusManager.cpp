@@ -182,6 +182,111 @@ static string modb_count_family_help[] =
   "number of security groups"
 };
 
+static string modb_class_family_names[] =
+{
+  "opflex_modb_class_instances",
+  "opflex_modb_class_bytes"
+};
+
+static string modb_class_family_help[] =
+{
+  "number of managed object instances per model class",
+  "approximate bytes of memory used per model class"
+};
+
+static string processor_family_name = "opflex_processor_items";
+static string processor_family_help =
+  "number of managed objects tracked by the opflex processor per state";
+
+static string process_family_name = "opflex_agent_process";
+static string process_family_help =
+  "CPU time in seconds, resident memory in bytes, thread count and "
+  "memory allocator bytes and fragmentation of the agent process";
+
+static string thread_cpu_family_name = "opflex_agent_thread_cpu_seconds";
+static string thread_cpu_family_help =
+  "CPU time in seconds of the agent threads per thread name";
+
+static string startup_family_name = "opflex_agent_startup_seconds";
+static string startup_family_help =
+  "duration in seconds of the agent startup phases and time in seconds "
+  "from the start of the agent to its startup milestones";
+
+static string flow_table_family_name = "opflex_agent_flow_table";
+static string flow_table_family_help =
+  "flows added, modified and deleted by the agent, and flows the agent "
+  "keeps, per bridge and flow table";
+
+static string notif_family_name = "opflex_notif_server";
+static string notif_family_help =
+  "notifications sent, coalesced and dropped by the agent notification "
+  "server, with its session and slow consumer counts";
+
+static string latency_family_names[] =
+{
+  "opflex_peer_policy_resolve_latency_ms",
+  "opflex_peer_ep_declare_latency_ms",
+  "opflex_peer_keepalive_rtt_ms",
+  "opflex_peer_request_latency_ms",
+  "opflex_processor_item_time_us",
+  "opflex_processor_policy_resolve_latency_ms",
+  "opflex_agent_dataplane_latency_ms",
+  "opflex_agent_flow_write_changes",
+  "opflex_agent_flow_barrier_latency_ms",
+  "opflex_agent_task_time_ms",
+  "opflex_agent_event_loop_lag_ms"
+};
+
+static string latency_family_help[] =
+{
+  "latency of policy resolve requests to the opflex peer in milliseconds",
+  "latency of endpoint declare requests to the opflex peer in milliseconds",
+  "round-trip time of keep-alive echoes to the opflex peer in milliseconds",
+  "latency of requests to the opflex peer per method in milliseconds",
+  "time spent by the opflex processor on each item in microseconds",
+  "latency of policy resolve requests per model class in milliseconds",
+  "latency from policy and endpoint changes to the flows acknowledged by "
+  "the switch per stage in milliseconds",
+  "flow and group changes per write to the switch per bridge",
+  "time for the switch to acknowledge a write per bridge in milliseconds",
+  "time spent running each task per task queue in milliseconds",
+  "delay of a periodic probe past its deadline per event loop in "
+  "milliseconds"
+};
+
+// name of the label identifying each histogram of a metric
+static string latency_label_names[] =
+{
+  "peer",
+  "peer",
+  "peer",
+  "peer",
+  "",
+  "class",
+  "stage",
+  "bridge",
+  "bridge",
+  "queue",
+  "loop"
+};
+
+// name of the optional second label identifying each histogram of a
+// metric
+static string latency_sublabel_names[] =
+{
+  "",
+  "",
+  "",
+  "method",
+  "",
+  "",
+  "",
+  "",
+  "",
+  "",
+  ""
+};
+
 static string rddrop_family_names[] =
 {
   "opflex_policy_drop_bytes",
@@ -234,6 +339,15 @@ static string table_drop_family_help[] =
   "opflex table drop packets"
 };
 
+static string registry_group_paths[] =
+{
+  "/metrics/agent",
+  "/metrics/endpoint",
+  "/metrics/service",
+  "/metrics/policy",
+  "/metrics/drop"
+};
+
 #define RETURN_IF_DISABLED  if (disabled) {return;}
 
 // construct AgentPrometheusManager for opflex agent
@@ -262,14 +376,14 @@ void AgentPrometheusManager::createStaticCounterFamiliesEp (void)
                          .Name("opflex_endpoint_created_total")
                          .Help("Total number of local endpoint creates")
                          .Labels({})
-                         .Register(*registry_ptr);
+                         .Register(*group_registry_ptr[REGISTRY_EP]);
     counter_ep_create_family_ptr = &counter_ep_create_family;
 
     auto& counter_ep_remove_family = BuildCounter()
                          .Name("opflex_endpoint_removed_total")
                          .Help("Total number of local endpoint deletes")
                          .Labels({})
-                         .Register(*registry_ptr);
+                         .Register(*group_registry_ptr[REGISTRY_EP]);
     counter_ep_remove_family_ptr = &counter_ep_remove_family;
 }
 
@@ -287,14 +401,14 @@ void AgentPrometheusManager::createStaticCounterFamiliesSvc (void)
                          .Name("opflex_svc_created_total")
                          .Help("Total number of SVC creates")
                          .Labels({})
-                         .Register(*registry_ptr);
+                         .Register(*group_registry_ptr[REGISTRY_SVC]);
     counter_svc_create_family_ptr = &counter_svc_create_family;
 
     auto& counter_svc_remove_family = BuildCounter()
                          .Name("opflex_svc_removed_total")
                          .Help("Total number of SVC deletes")
                          .Labels({})
-                         .Register(*registry_ptr);
+                         .Register(*group_registry_ptr[REGISTRY_SVC]);
     counter_svc_remove_family_ptr = &counter_svc_remove_family;
 }
 
@@ -395,6 +509,48 @@ void AgentPrometheusManager::removeDynamicGauges ()
         removeDynamicGaugeMoDBCount();
     }
 
+    // Remove ModbClassStats related gauges
+    {
+        const lock_guard<mutex> lock(modb_class_mutex);
+        removeDynamicGaugeModbClass();
+    }
+
+    // Remove ProcessorStats related gauges
+    {
+        const lock_guard<mutex> lock(processor_mutex);
+        removeDynamicGaugeProcessor();
+    }
+
+    // Remove FlowTableStats related gauges
+    {
+        const lock_guard<mutex> lock(flow_table_mutex);
+        removeDynamicGaugeFlowTable();
+    }
+
+    // Remove NotifStats related gauges
+    {
+        const lock_guard<mutex> lock(notif_mutex);
+        removeDynamicGaugeNotif();
+    }
+
+    // Remove ProcessStats and ThreadCpu related gauges
+    {
+        const lock_guard<mutex> lock(proc_mutex);
+        removeDynamicGaugeProc();
+    }
+
+    // Remove StartupStats related gauges
+    {
+        const lock_guard<mutex> lock(startup_mutex);
+        removeDynamicGaugeStartup();
+    }
+
+    // Remove latency histogram related gauges
+    {
+        const lock_guard<mutex> lock(latency_mutex);
+        removeDynamicGaugeLatency();
+    }
+
     // Remove RDDropCounter related gauges
     {
         const lock_guard<mutex> lock(rddrop_stats_mutex);
@@ -466,7 +622,7 @@ void AgentPrometheusManager::createStaticGaugeFamiliesOFPeer (void)
                              .Name(ofpeer_family_names[metric])
                              .Help(ofpeer_family_help[metric])
                              .Labels({})
-                             .Register(*registry_ptr);
+                             .Register(*group_registry_ptr[REGISTRY_AGENT]);
         gauge_ofpeer_family_ptr[metric] = &gauge_ofpeer_family;
     }
 }
@@ -486,7 +642,7 @@ void AgentPrometheusManager::createStaticGaugeFamiliesContractClassifier (void)
                              .Name(contract_family_names[metric])
                              .Help(contract_family_help[metric])
                              .Labels({})
-                             .Register(*registry_ptr);
+                             .Register(*group_registry_ptr[REGISTRY_POLICY]);
         gauge_contract_family_ptr[metric] = &gauge_contract_family;
     }
 }
@@ -506,7 +662,7 @@ void AgentPrometheusManager::createStaticGaugeFamiliesSGClassifier (void)
                              .Name(sgclassifier_family_names[metric])
                              .Help(sgclassifier_family_help[metric])
                              .Labels({})
-                             .Register(*registry_ptr);
+                             .Register(*group_registry_ptr[REGISTRY_POLICY]);
         gauge_sgclassifier_family_ptr[metric] = &gauge_sgclassifier_family;
     }
 }
@@ -526,7 +682,7 @@ void AgentPrometheusManager::createStaticGaugeFamiliesMoDBCount (void)
                              .Name(modb_count_family_names[metric])
                              .Help(modb_count_family_help[metric])
                              .Labels({})
-                             .Register(*registry_ptr);
+                             .Register(*group_registry_ptr[REGISTRY_AGENT]);
         gauge_modb_count_family_ptr[metric] = &gauge_modb_count_family;
 
         // metrics per family will be created later
@@ -534,6 +690,117 @@ void AgentPrometheusManager::createStaticGaugeFamiliesMoDBCount (void)
     }
 }
 
+// create all ModbClassStats specific gauge families during start
+void AgentPrometheusManager::createStaticGaugeFamiliesModbClass (void)
+{
+    // add a new gauge family to the registry (families combine values with the
+    // same name, but distinct label dimensions)
+    // Note: There is a unique ptr allocated and referencing the below reference
+    // during Register().
+
+    for (MODB_CLASS_METRICS metric=MODB_CLASS_METRICS_MIN;
+            metric <= MODB_CLASS_METRICS_MAX;
+                metric = MODB_CLASS_METRICS(metric+1)) {
+        auto& gauge_modb_class_family = BuildGauge()
+                             .Name(modb_class_family_names[metric])
+                             .Help(modb_class_family_help[metric])
+                             .Labels({})
+                             .Register(*group_registry_ptr[REGISTRY_AGENT]);
+        gauge_modb_class_family_ptr[metric] = &gauge_modb_class_family;
+    }
+}
+
+// create the ProcessorStats gauge family during start
+void AgentPrometheusManager::createStaticGaugeFamiliesProcessor (void)
+{
+    auto& gauge_processor_family = BuildGauge()
+                         .Name(processor_family_name)
+                         .Help(processor_family_help)
+                         .Labels({})
+                         .Register(*group_registry_ptr[REGISTRY_AGENT]);
+    gauge_processor_family_ptr = &gauge_processor_family;
+}
+
+// create the FlowTableStats gauge family during start
+void AgentPrometheusManager::createStaticGaugeFamiliesFlowTable (void)
+{
+    auto& gauge_flow_table_family = BuildGauge()
+                         .Name(flow_table_family_name)
+                         .Help(flow_table_family_help)
+                         .Labels({})
+                         .Register(*group_registry_ptr[REGISTRY_AGENT]);
+    gauge_flow_table_family_ptr = &gauge_flow_table_family;
+}
+
+// create the NotifStats gauge family during start
+void AgentPrometheusManager::createStaticGaugeFamiliesNotif (void)
+{
+    auto& gauge_notif_family = BuildGauge()
+                         .Name(notif_family_name)
+                         .Help(notif_family_help)
+                         .Labels({})
+                         .Register(*group_registry_ptr[REGISTRY_AGENT]);
+    gauge_notif_family_ptr = &gauge_notif_family;
+}
+
+// create the ProcessStats and ThreadCpu gauge families during start
+void AgentPrometheusManager::createStaticGaugeFamiliesProc (void)
+{
+    auto& gauge_process_family = BuildGauge()
+                         .Name(process_family_name)
+                         .Help(process_family_help)
+                         .Labels({})
+                         .Register(*group_registry_ptr[REGISTRY_AGENT]);
+    gauge_process_family_ptr = &gauge_process_family;
+
+    auto& gauge_thread_cpu_family = BuildGauge()
+                         .Name(thread_cpu_family_name)
+                         .Help(thread_cpu_family_help)
+                         .Labels({})
+                         .Register(*group_registry_ptr[REGISTRY_AGENT]);
+    gauge_thread_cpu_family_ptr = &gauge_thread_cpu_family;
+}
+
+// create the StartupStats gauge family during start
+void AgentPrometheusManager::createStaticGaugeFamiliesStartup (void)
+{
+    auto& gauge_startup_family = BuildGauge()
+                         .Name(startup_family_name)
+                         .Help(startup_family_help)
+                         .Labels({})
+                         .Register(*group_registry_ptr[REGISTRY_AGENT]);
+    gauge_startup_family_ptr = &gauge_startup_family;
+}
+
+// create the latency histogram gauge families during start
+void AgentPrometheusManager::createStaticGaugeFamiliesLatency (void)
+{
+    for (LATENCY_METRICS metric=LATENCY_METRICS_MIN;
+            metric <= LATENCY_METRICS_MAX;
+                metric = LATENCY_METRICS(metric+1)) {
+        const string& name = latency_family_names[metric];
+        const string& help = latency_family_help[metric];
+        auto& gauge_bucket_family = BuildGauge()
+                             .Name(name + "_bucket")
+                             .Help(help)
+                             .Labels({})
+                             .Register(*group_registry_ptr[REGISTRY_AGENT]);
+        gauge_latency_bucket_family_ptr[metric] = &gauge_bucket_family;
+        auto& gauge_sum_family = BuildGauge()
+                             .Name(name + "_sum")
+                             .Help(help)
+                             .Labels({})
+                             .Register(*group_registry_ptr[REGISTRY_AGENT]);
+        gauge_latency_sum_family_ptr[metric] = &gauge_sum_family;
+        auto& gauge_count_family = BuildGauge()
+                             .Name(name + "_count")
+                             .Help(help)
+                             .Labels({})
+                             .Register(*group_registry_ptr[REGISTRY_AGENT]);
+        gauge_latency_count_family_ptr[metric] = &gauge_count_family;
+    }
+}
+
 // create all RDDrop specific gauge families during start
 void AgentPrometheusManager::createStaticGaugeFamiliesRDDrop (void)
 {
@@ -549,7 +816,7 @@ void AgentPrometheusManager::createStaticGaugeFamiliesRDDrop (void)
                              .Name(rddrop_family_names[metric])
                              .Help(rddrop_family_help[metric])
                              .Labels({})
-                             .Register(*registry_ptr);
+                             .Register(*group_registry_ptr[REGISTRY_DROP]);
         gauge_rddrop_family_ptr[metric] = &gauge_rddrop_family;
     }
 }
@@ -568,7 +835,7 @@ void AgentPrometheusManager::createStaticGaugeFamiliesEp (void)
                              .Name(ep_family_names[metric])
                              .Help(ep_family_help[metric])
                              .Labels({})
-                             .Register(*registry_ptr);
+                             .Register(*group_registry_ptr[REGISTRY_EP]);
         gauge_ep_family_ptr[metric] = &gauge_ep_family;
     }
 }
@@ -588,7 +855,7 @@ void AgentPrometheusManager::createStaticGaugeFamiliesSvcTarget (void)
                              .Name(svc_target_family_names[metric])
                              .Help(svc_target_family_help[metric])
                              .Labels({})
-                             .Register(*registry_ptr);
+                             .Register(*group_registry_ptr[REGISTRY_SVC]);
         gauge_svc_target_family_ptr[metric] = &gauge_svc_target_family;
     }
 }
@@ -607,7 +874,7 @@ void AgentPrometheusManager::createStaticGaugeFamiliesSvc (void)
                              .Name(svc_family_names[metric])
                              .Help(svc_family_help[metric])
                              .Labels({})
-                             .Register(*registry_ptr);
+                             .Register(*group_registry_ptr[REGISTRY_SVC]);
         gauge_svc_family_ptr[metric] = &gauge_svc_family;
     }
 }
@@ -627,7 +894,7 @@ void AgentPrometheusManager::createStaticGaugeFamiliesPodSvc (void)
                              .Name(podsvc_family_names[metric])
                              .Help(podsvc_family_help[metric])
                              .Labels({})
-                             .Register(*registry_ptr);
+                             .Register(*group_registry_ptr[REGISTRY_SVC]);
         gauge_podsvc_family_ptr[metric] = &gauge_podsvc_family;
     }
 }
@@ -646,7 +913,7 @@ void AgentPrometheusManager::createStaticGaugeFamiliesTableDrop(void) {
                              .Name(table_drop_family_names[metric])
                              .Help(table_drop_family_help[metric])
                              .Labels({})
-                             .Register(*registry_ptr);
+                             .Register(*group_registry_ptr[REGISTRY_DROP]);
         gauge_table_drop_family_ptr[metric] = &gauge_table_drop_family;
     }
 }
@@ -704,6 +971,41 @@ void AgentPrometheusManager::createStaticGaugeFamilies (void)
         createStaticGaugeFamiliesMoDBCount();
     }
 
+    {
+        const lock_guard<mutex> lock(modb_class_mutex);
+        createStaticGaugeFamiliesModbClass();
+    }
+
+    {
+        const lock_guard<mutex> lock(processor_mutex);
+        createStaticGaugeFamiliesProcessor();
+    }
+
+    {
+        const lock_guard<mutex> lock(flow_table_mutex);
+        createStaticGaugeFamiliesFlowTable();
+    }
+
+    {
+        const lock_guard<mutex> lock(notif_mutex);
+        createStaticGaugeFamiliesNotif();
+    }
+
+    {
+        const lock_guard<mutex> lock(proc_mutex);
+        createStaticGaugeFamiliesProc();
+    }
+
+    {
+        const lock_guard<mutex> lock(startup_mutex);
+        createStaticGaugeFamiliesStartup();
+    }
+
+    {
+        const lock_guard<mutex> lock(latency_mutex);
+        createStaticGaugeFamiliesLatency();
+    }
+
     {
         const lock_guard<mutex> lock(rddrop_stats_mutex);
         createStaticGaugeFamiliesRDDrop();
@@ -731,13 +1033,16 @@ void AgentPrometheusManager::removeStaticGauges ()
 }
 
 // Start of AgentPrometheusManager instance
-void AgentPrometheusManager::start (bool exposeLocalHostOnly, bool exposeEpSvcNan_)
+void AgentPrometheusManager::start (bool exposeLocalHostOnly,
+                                    bool exposeEpSvcNan_,
+                                    bool exposeGroupPaths)
 {
     disabled = false;
     exposeEpSvcNan = exposeEpSvcNan_;
     LOG(DEBUG) << "starting prometheus manager,"
                << " exposeLHOnly: " << exposeLocalHostOnly
-               << " exposeEpSvcNan: " << exposeEpSvcNan;
+               << " exposeEpSvcNan: " << exposeEpSvcNan
+               << " exposeGroupPaths: " << exposeGroupPaths;
     /**
      * create an http server running on port 9612
      * Note: The third argument is the total worker thread count. Prometheus
@@ -747,7 +1052,11 @@ void AgentPrometheusManager::start (bool exposeLocalHostOnly, bool exposeEpSvcNa
      * Note: Port #9612 has been reserved for opflex here:
      * https://github.com/prometheus/prometheus/wiki/Default-port-allocations
      */
-    registry_ptr = make_shared<Registry>();
+    for (REGISTRY_GROUP group=REGISTRY_GROUP_MIN;
+            group <= REGISTRY_GROUP_MAX;
+                group = REGISTRY_GROUP(group+1)) {
+        group_registry_ptr[group] = make_shared<Registry>();
+    }
     if (exposeLocalHostOnly)
         exposer_ptr = unique_ptr<Exposer>(new Exposer{"127.0.0.1:9612", 1});
     else
@@ -761,8 +1070,18 @@ void AgentPrometheusManager::start (bool exposeLocalHostOnly, bool exposeEpSvcNa
     // Add static metrics
     createStaticCounters();
 
-    // ask the exposer to scrape the registry on incoming scrapes
-    exposer_ptr->RegisterCollectable(registry_ptr);
+    // ask the exposer to scrape the registries on incoming scrapes. A
+    // scrape of the default path collects every group, while the path
+    // of a group only collects its own families, so that a scraper
+    // interested in a few groups need not serialize every endpoint.
+    for (REGISTRY_GROUP group=REGISTRY_GROUP_MIN;
+            group <= REGISTRY_GROUP_MAX;
+                group = REGISTRY_GROUP(group+1)) {
+        exposer_ptr->RegisterCollectable(group_registry_ptr[group]);
+        if (exposeGroupPaths)
+            exposer_ptr->RegisterCollectable(group_registry_ptr[group],
+                                             registry_group_paths[group]);
+    }
 
     string allowed;
     for (const auto& allow : agent.getPrometheusEpAttributes())
@@ -836,6 +1155,52 @@ void AgentPrometheusManager::init ()
         }
     }
 
+    {
+        const lock_guard<mutex> lock(modb_class_mutex);
+        for (MODB_CLASS_METRICS metric=MODB_CLASS_METRICS_MIN;
+                metric <= MODB_CLASS_METRICS_MAX;
+                    metric = MODB_CLASS_METRICS(metric+1)) {
+            gauge_modb_class_family_ptr[metric] = nullptr;
+        }
+    }
+
+    {
+        const lock_guard<mutex> lock(processor_mutex);
+        gauge_processor_family_ptr = nullptr;
+    }
+
+    {
+        const lock_guard<mutex> lock(flow_table_mutex);
+        gauge_flow_table_family_ptr = nullptr;
+    }
+
+    {
+        const lock_guard<mutex> lock(notif_mutex);
+        gauge_notif_family_ptr = nullptr;
+    }
+
+    {
+        const lock_guard<mutex> lock(proc_mutex);
+        gauge_process_family_ptr = nullptr;
+        gauge_thread_cpu_family_ptr = nullptr;
+    }
+
+    {
+        const lock_guard<mutex> lock(startup_mutex);
+        gauge_startup_family_ptr = nullptr;
+    }
+
+    {
+        const lock_guard<mutex> lock(latency_mutex);
+        for (LATENCY_METRICS metric=LATENCY_METRICS_MIN;
+                metric <= LATENCY_METRICS_MAX;
+                    metric = LATENCY_METRICS(metric+1)) {
+            gauge_latency_bucket_family_ptr[metric] = nullptr;
+            gauge_latency_sum_family_ptr[metric] = nullptr;
+            gauge_latency_count_family_ptr[metric] = nullptr;
+        }
+    }
+
     {
         const lock_guard<mutex> lock(rddrop_stats_mutex);
         for (RDDROP_METRICS metric=RDDROP_METRICS_MIN;
@@ -900,8 +1265,36 @@ void AgentPrometheusManager::stop ()
     exposer_ptr.reset();
     exposer_ptr = nullptr;
 
-    registry_ptr.reset();
-    registry_ptr = nullptr;
+    for (REGISTRY_GROUP group=REGISTRY_GROUP_MIN;
+            group <= REGISTRY_GROUP_MAX;
+                group = REGISTRY_GROUP(group+1)) {
+        group_registry_ptr[group].reset();
+    }
+}
+
+// Set limits on dynamic metrics
+void AgentPrometheusManager::setCardinalityBudget (const CardinalityBudget& budget_)
+{
+    LOG(DEBUG) << "prometheus cardinality budget,"
+               << " maxEps: " << budget_.maxEps
+               << " maxSvcTargets: " << budget_.maxSvcTargets
+               << " lazyEpGauges: " << budget_.lazyEpGauges
+               << " epExportMode: " << budget_.epExportMode;
+    {
+        const lock_guard<mutex> lock(ep_counter_mutex);
+        budget.maxEps = budget_.maxEps;
+        budget.lazyEpGauges = budget_.lazyEpGauges;
+        budget.epExportMode = budget_.epExportMode;
+        ep_drops_rank.clear();
+        if (budget.epExportMode == EP_EXPORT_TOP_DROPS) {
+            for (const auto& ep : ep_gauge_map)
+                ep_drops_rank.insert(make_pair(ep.second.drops, ep.first));
+        }
+    }
+    {
+        const lock_guard<mutex> lock(svc_target_counter_mutex);
+        budget.maxSvcTargets = budget_.maxSvcTargets;
+    }
 }
 
 // Increment Ep count
@@ -1163,6 +1556,28 @@ void AgentPrometheusManager::createDynamicGaugeMoDBCount (MODB_COUNT_METRICS met
     modb_count_gauge_map[metric] = &gauge;
 }
 
+// Create ModbClassStats gauge given metric type, class name
+void AgentPrometheusManager::createDynamicGaugeModbClass (MODB_CLASS_METRICS metric,
+                                                          const string& className)
+{
+    // Retrieve the Gauge if its already created
+    if (getDynamicGaugeModbClass(metric, className))
+        return;
+
+    auto& gauge = gauge_modb_class_family_ptr[metric]->Add({{"class", className}});
+    if (gauge_check.is_dup(&gauge)) {
+        LOG(WARNING) << "duplicate modb class dyn gauge family"
+                   << " metric: " << metric
+                   << " class: " << className;
+        return;
+    }
+    LOG(DEBUG) << "created modb class dyn gauge family"
+               << " metric: " << metric
+               << " class: " << className;
+    gauge_check.add(&gauge);
+    modb_class_gauge_map[metric][className] = &gauge;
+}
+
 // Create RDDropCounter gauge given metric type, rdURI
 void AgentPrometheusManager::createDynamicGaugeRDDrop (RDDROP_METRICS metric,
                                                        const string& rdURI)
@@ -1378,22 +1793,26 @@ void AgentPrometheusManager::createDynamicGaugePodSvc (PODSVC_METRICS metric,
     podsvc_gauge_map[metric][uuid] = make_pair(std::move(label_map), &gauge);
 }
 
-// Create EpCounter gauge given metric type and an uuid
-bool AgentPrometheusManager::createDynamicGaugeEp (EP_METRICS metric,
-                                                  const string& uuid,
-                                                  const string& ep_name,
-                                                  bool annotate_ep_name,
-                                                  const size_t& attr_hash,
-                        const unordered_map<string, string>&    attr_map)
+// Create EpCounter gauges of every metric type given an uuid
+AgentPrometheusManager::EpGauges *
+AgentPrometheusManager::createDynamicGaugeEp (const string& uuid,
+                                              const string& ep_name,
+                                              bool annotate_ep_name,
+                                              const size_t& attr_hash,
+                        const unordered_map<string, string>&    attr_map,
+                                              bool& created)
 {
     /**
      * We create a hash of all the key, value pairs in label attr_map
-     * and then maintain a map of uuid to another pair of all attr hash
-     * and gauge ptr
-     * {uuid: pair(old_all_attr_hash, gauge_ptr)}
+     * and then maintain a map of uuid to the hash and the gauges of
+     * every metric, so that an update of the counters of an ep with
+     * unchanged attributes costs a single lookup.
+     * {uuid: (old_all_attr_hash, gauge_ptrs)}
      */
-    auto hgauge = getDynamicGaugeEp(metric, uuid);
-    if (hgauge) {
+    created = false;
+    auto egauges = getDynamicGaugeEp(uuid);
+    bool existed = egauges != nullptr;
+    if (existed) {
         /**
          * Detect attribute change by comparing hashes:
          * Check incoming hash with the cached hash to detect attribute change
@@ -1406,54 +1825,95 @@ bool AgentPrometheusManager::createDynamicGaugeEp (EP_METRICS metric,
          * - by not doing del/add of metric for every attribute change, we reduce
          * # of metric+label creation in prometheus.
          */
-        if (attr_hash == hgauge.get().first)
-            return false;
-        else {
-            LOG(DEBUG) << "addNupdate epcounter: " << ep_name
-                       << " incoming attr_hash: " << attr_hash << "\n"
-                       << "existing ep metric, but deleting: hash modified;"
-                       << " metric: " << ep_family_names[metric]
-                       << " hash: " << hgauge.get().first
-                       << " gaugeptr: " << hgauge.get().second;
-            removeDynamicGaugeEp(metric, uuid);
-        }
+        if (attr_hash == egauges->hash)
+            return egauges;
+
+        LOG(DEBUG) << "addNupdate epcounter: " << ep_name
+                   << " incoming attr_hash: " << attr_hash << "\n"
+                   << "existing ep metric, but deleting: hash modified;"
+                   << " hash: " << egauges->hash;
+        removeDynamicGaugeEp(uuid);
     }
 
+    // The label map is the same for every metric of the ep
     auto label_map = createLabelMapFromEpAttr(ep_name,
                                               annotate_ep_name,
                                               attr_map,
                                               agent.getPrometheusEpAttributes());
-    auto hash = hash_labels(label_map);
-    auto& gauge = gauge_ep_family_ptr[metric]->Add(label_map);
-    if (gauge_check.is_dup(&gauge)) {
-        // Suppressing below log for all the other metrics of this EP
-        if (metric == EP_METRICS_MIN) {
+    EpGauges gauges;
+    gauges.hash = hash_labels(label_map);
+    gauges.drops = 0;
+    for (EP_METRICS metric=EP_METRICS_MIN;
+            metric < EP_METRICS_MAX;
+                metric = EP_METRICS(metric+1)) {
+        auto& gauge = gauge_ep_family_ptr[metric]->Add(label_map);
+        if (gauge_check.is_dup(&gauge)) {
             LOG(WARNING) << "duplicate ep dyn gauge family: " << ep_name
                        << " uuid: " << uuid
-                       << " label hash: " << hash
+                       << " label hash: " << gauges.hash
                        << " gaugeptr: " << &gauge;
+            // The gauges added before this one are our own, the
+            // duplicate belongs to another ep
+            for (EP_METRICS added=EP_METRICS_MIN;
+                    added < metric;
+                        added = EP_METRICS(added+1)) {
+                gauge_check.remove(gauges.gauge[added]);
+                gauge_ep_family_ptr[added]->Remove(gauges.gauge[added]);
+            }
+            // the old gauges of the ep are gone, so it no longer
+            // counts as active
+            if (existed)
+                incStaticCounterEpRemove();
+            return nullptr;
         }
-
-        // Note: return true so that: if metrics are created before and later
-        // result in duplication due to change in attributes, the pre-duplicated
-        // metrics can get freed.
-        return true;
+        gauge_check.add(&gauge);
+        gauges.gauge[metric] = &gauge;
     }
-    LOG(DEBUG) << "created ep dyn gauge family: " << ep_name
-               << " metric: " << metric
+    LOG(DEBUG) << "created ep dyn gauges: " << ep_name
                << " uuid: " << uuid
-               << " label hash: " << hash
-               << " gaugeptr: " << &gauge;
-    gauge_check.add(&gauge);
+               << " label hash: " << gauges.hash;
+
+    // If the gauges were present and got recreated due to attribute
+    // change, then the active ep count and total created ep count dont
+    // change
+    created = !existed;
+    auto& entry = ep_gauge_map[uuid];
+    entry = gauges;
+    if (budget.epExportMode == EP_EXPORT_TOP_DROPS)
+        ep_drops_rank.insert(make_pair(entry.drops, uuid));
+    return &entry;
+}
+
+// Check if a new ep can get gauges without exceeding the cardinality budget
+bool AgentPrometheusManager::admitDynamicGaugeEp (const string& uuid,
+                                                  const EpCounters& counters)
+{
+    if (budget.lazyEpGauges &&
+        !counters.rxBytes && !counters.txBytes &&
+        !counters.rxPackets && !counters.txPackets &&
+        !counters.rxDrop && !counters.txDrop) {
+        LOG(TRACE) << "not creating ep gauges with zero counters: " << uuid;
+        return false;
+    }
 
-    ep_gauge_map[metric][uuid] = make_pair(hash, &gauge);
+    if (!budget.maxEps || ep_gauge_map.size() < budget.maxEps)
+        return true;
 
-    // If the gauge is already present and if we created last new metric due to
-    // attribute change, then return false so that the active ep count and total
-    // created ep count dont change
-    if (hgauge && (metric == (EP_METRICS_MAX-1)))
+    // In top-drops mode, the new ep replaces the one with least drops if
+    // it has more
+    uint64_t drops = counters.rxDrop + counters.txDrop;
+    if (budget.epExportMode != EP_EXPORT_TOP_DROPS ||
+        ep_drops_rank.empty() ||
+        ep_drops_rank.begin()->first >= drops) {
+        LOG(TRACE) << "ep metric budget exceeded, not creating: " << uuid;
         return false;
+    }
 
+    const string evicted = ep_drops_rank.begin()->second;
+    LOG(DEBUG) << "ep metric budget exceeded, replacing " << evicted
+               << " with " << uuid;
+    if (removeDynamicGaugeEp(evicted))
+        incStaticCounterEpRemove();
     return true;
 }
 
@@ -1689,6 +2149,23 @@ Gauge * AgentPrometheusManager::getDynamicGaugeSGClassifier (SGCLASSIFIER_METRIC
     return pgauge;
 }
 
+// Get ModbClassStats gauge given the metric, class name
+Gauge * AgentPrometheusManager::getDynamicGaugeModbClass (MODB_CLASS_METRICS metric,
+                                                          const string& className)
+{
+    Gauge *pgauge = nullptr;
+    auto itr = modb_class_gauge_map[metric].find(className);
+    if (itr == modb_class_gauge_map[metric].end()) {
+        LOG(TRACE) << "Dyn Gauge ModbClassStats not found"
+                   << " metric: " << metric
+                   << " class: " << className;
+    } else {
+        pgauge = itr->second;
+    }
+
+    return pgauge;
+}
+
 // Get MoDBCount gauge given the metric
 Gauge * AgentPrometheusManager::getDynamicGaugeMoDBCount (MODB_COUNT_METRICS metric)
 {
@@ -1763,19 +2240,17 @@ mgauge_pair_t AgentPrometheusManager::getDynamicGaugePodSvc (PODSVC_METRICS metr
     return mgauge;
 }
 
-// Get EpCounter gauge given the metric, uuid of EP
-hgauge_pair_t AgentPrometheusManager::getDynamicGaugeEp (EP_METRICS metric,
-                                                        const string& uuid)
+// Get EpCounter gauges given the uuid of EP
+AgentPrometheusManager::EpGauges *
+AgentPrometheusManager::getDynamicGaugeEp (const string& uuid)
 {
-    hgauge_pair_t hgauge = boost::none;
-    auto itr = ep_gauge_map[metric].find(uuid);
-    if (itr == ep_gauge_map[metric].end()) {
+    auto itr = ep_gauge_map.find(uuid);
+    if (itr == ep_gauge_map.end()) {
         LOG(TRACE) << "Dyn Gauge EpCounter not found " << uuid;
-    } else {
-        hgauge = itr->second;
+        return nullptr;
     }
 
-    return hgauge;
+    return &itr->second;
 }
 
 // Remove dynamic ContractClassifierCounter gauge given a metic type and
@@ -1901,6 +2376,155 @@ void AgentPrometheusManager::removeDynamicGaugeMoDBCount ()
     }
 }
 
+// Remove dynamic ModbClassStats gauge given a metic type and class name
+bool AgentPrometheusManager::removeDynamicGaugeModbClass (MODB_CLASS_METRICS metric,
+                                                          const string& className)
+{
+    Gauge *pgauge = getDynamicGaugeModbClass(metric, className);
+    if (pgauge) {
+        modb_class_gauge_map[metric].erase(className);
+        gauge_check.remove(pgauge);
+        gauge_modb_class_family_ptr[metric]->Remove(pgauge);
+    } else {
+        LOG(DEBUG) << "remove dynamic gauge modb class stats not found class:"
+                   << className;
+        return false;
+    }
+    return true;
+}
+
+// Remove dynamic ModbClassStats gauge given a metric type
+void AgentPrometheusManager::removeDynamicGaugeModbClass (MODB_CLASS_METRICS metric)
+{
+    auto itr = modb_class_gauge_map[metric].begin();
+    while (itr != modb_class_gauge_map[metric].end()) {
+        LOG(DEBUG) << "Delete ModbClassStats class: " << itr->first
+                   << " Gauge: " << itr->second;
+        gauge_check.remove(itr->second);
+        gauge_modb_class_family_ptr[metric]->Remove(itr->second);
+        itr++;
+    }
+
+    modb_class_gauge_map[metric].clear();
+}
+
+// Remove dynamic ModbClassStats gauges for all metrics
+void AgentPrometheusManager::removeDynamicGaugeModbClass ()
+{
+    for (MODB_CLASS_METRICS metric=MODB_CLASS_METRICS_MIN;
+            metric <= MODB_CLASS_METRICS_MAX;
+                metric = MODB_CLASS_METRICS(metric+1)) {
+        removeDynamicGaugeModbClass(metric);
+    }
+}
+
+// Remove dynamic ProcessorStats gauges for all item states
+void AgentPrometheusManager::removeDynamicGaugeProcessor ()
+{
+    for (auto& entry : processor_gauge_map) {
+        LOG(DEBUG) << "Delete ProcessorStats state: " << entry.first
+                   << " Gauge: " << entry.second;
+        gauge_check.remove(entry.second);
+        gauge_processor_family_ptr->Remove(entry.second);
+    }
+    processor_gauge_map.clear();
+}
+
+// Remove dynamic FlowTableStats gauges for all tables
+void AgentPrometheusManager::removeDynamicGaugeFlowTable ()
+{
+    for (auto& entry : flow_table_gauge_map) {
+        for (Gauge* pgauge : entry.second) {
+            if (!pgauge)
+                continue;
+            gauge_check.remove(pgauge);
+            gauge_flow_table_family_ptr->Remove(pgauge);
+        }
+    }
+    flow_table_gauge_map.clear();
+}
+
+// Remove dynamic NotifStats gauges for all counters
+void AgentPrometheusManager::removeDynamicGaugeNotif ()
+{
+    for (auto& entry : notif_gauge_map) {
+        LOG(DEBUG) << "Delete NotifStats counter: " << entry.first
+                   << " Gauge: " << entry.second;
+        gauge_check.remove(entry.second);
+        gauge_notif_family_ptr->Remove(entry.second);
+    }
+    notif_gauge_map.clear();
+}
+
+// Remove dynamic ProcessStats and ThreadCpu gauges
+void AgentPrometheusManager::removeDynamicGaugeProc ()
+{
+    for (auto& entry : process_gauge_map) {
+        LOG(DEBUG) << "Delete ProcessStats stat: " << entry.first
+                   << " Gauge: " << entry.second;
+        gauge_check.remove(entry.second);
+        gauge_process_family_ptr->Remove(entry.second);
+    }
+    process_gauge_map.clear();
+
+    for (auto& entry : thread_cpu_gauge_map) {
+        LOG(DEBUG) << "Delete ThreadCpu thread: " << entry.first
+                   << " Gauge: " << entry.second;
+        gauge_check.remove(entry.second);
+        gauge_thread_cpu_family_ptr->Remove(entry.second);
+    }
+    thread_cpu_gauge_map.clear();
+}
+
+// Remove dynamic StartupStats gauges
+void AgentPrometheusManager::removeDynamicGaugeStartup ()
+{
+    for (auto& entry : startup_gauge_map) {
+        LOG(DEBUG) << "Delete StartupStats event: " << entry.first
+                   << " Gauge: " << entry.second;
+        gauge_check.remove(entry.second);
+        gauge_startup_family_ptr->Remove(entry.second);
+    }
+    startup_gauge_map.clear();
+}
+
+// Remove the gauges of a latency histogram given its label values
+void AgentPrometheusManager::removeDynamicGaugeLatency (LATENCY_METRICS metric,
+                                                       const string& label,
+                                                       const string& sublabel)
+{
+    auto itr = latency_gauge_map[metric].find(make_pair(label, sublabel));
+    if (itr == latency_gauge_map[metric].end()) {
+        LOG(TRACE) << "Latency gauges not found for " << label
+                   << " " << sublabel;
+        return;
+    }
+
+    latency_gauges_t& gauges = itr->second;
+    for (size_t b = 0; b <= OFLatencyHistogram::BUCKETS; ++b) {
+        gauge_check.remove(gauges.bucket[b]);
+        gauge_latency_bucket_family_ptr[metric]->Remove(gauges.bucket[b]);
+    }
+    gauge_check.remove(gauges.sum);
+    gauge_latency_sum_family_ptr[metric]->Remove(gauges.sum);
+    gauge_check.remove(gauges.count);
+    gauge_latency_count_family_ptr[metric]->Remove(gauges.count);
+    latency_gauge_map[metric].erase(itr);
+}
+
+// Remove all dynamic latency histogram gauges
+void AgentPrometheusManager::removeDynamicGaugeLatency ()
+{
+    for (LATENCY_METRICS metric=LATENCY_METRICS_MIN;
+            metric <= LATENCY_METRICS_MAX;
+                metric = LATENCY_METRICS(metric+1)) {
+        while (!latency_gauge_map[metric].empty()) {
+            const auto& key = latency_gauge_map[metric].begin()->first;
+            removeDynamicGaugeLatency(metric, key.first, key.second);
+        }
+    }
+}
+
 // Remove dynamic RDDropCounter gauge given a metic type and rdURI
 bool AgentPrometheusManager::removeDynamicGaugeRDDrop (RDDROP_METRICS metric,
                                                        const string& rdURI)
@@ -2115,50 +2739,43 @@ void AgentPrometheusManager::removeDynamicGaugePodSvc ()
     }
 }
 
-// Remove dynamic EpCounter gauge given a metic type and ep uuid
-bool AgentPrometheusManager::removeDynamicGaugeEp (EP_METRICS metric,
-                                                   const string& uuid)
+// Remove dynamic EpCounter gauges given an ep uuid
+bool AgentPrometheusManager::removeDynamicGaugeEp (const string& uuid)
 {
-    auto hgauge = getDynamicGaugeEp(metric, uuid);
-    if (hgauge) {
-        ep_gauge_map[metric].erase(uuid);
-        gauge_check.remove(hgauge.get().second);
-        gauge_ep_family_ptr[metric]->Remove(hgauge.get().second);
-    } else {
+    auto itr = ep_gauge_map.find(uuid);
+    if (itr == ep_gauge_map.end()) {
         LOG(DEBUG) << "remove dynamic gauge ep not found uuid:" << uuid;
         return false;
     }
-    return true;
-}
 
-// Remove dynamic EpCounter gauge given a metic type
-void AgentPrometheusManager::removeDynamicGaugeEp (EP_METRICS metric)
-{
-    auto itr = ep_gauge_map[metric].begin();
-    while (itr != ep_gauge_map[metric].end()) {
-        LOG(DEBUG) << "Delete Ep uuid: " << itr->first
-                   << " hash: " << itr->second.get().first
-                   << " Gauge: " << itr->second.get().second;
-        gauge_check.remove(itr->second.get().second);
-        gauge_ep_family_ptr[metric]->Remove(itr->second.get().second);
-        itr++;
-
-        if (metric == (EP_METRICS_MAX-1)) {
-            incStaticCounterEpRemove();
-        }
+    for (EP_METRICS metric=EP_METRICS_MIN;
+            metric < EP_METRICS_MAX;
+                metric = EP_METRICS(metric+1)) {
+        gauge_check.remove(itr->second.gauge[metric]);
+        gauge_ep_family_ptr[metric]->Remove(itr->second.gauge[metric]);
     }
-
-    ep_gauge_map[metric].clear();
+    ep_drops_rank.erase(make_pair(itr->second.drops, uuid));
+    ep_gauge_map.erase(itr);
+    return true;
 }
 
 // Remove dynamic EpCounter gauges for all metrics
 void AgentPrometheusManager::removeDynamicGaugeEp ()
 {
-    for (EP_METRICS metric=EP_METRICS_MIN;
-            metric < EP_METRICS_MAX;
-                metric = EP_METRICS(metric+1)) {
-        removeDynamicGaugeEp(metric);
+    for (const auto& ep : ep_gauge_map) {
+        LOG(DEBUG) << "Delete Ep uuid: " << ep.first
+                   << " hash: " << ep.second.hash;
+        for (EP_METRICS metric=EP_METRICS_MIN;
+                metric < EP_METRICS_MAX;
+                    metric = EP_METRICS(metric+1)) {
+            gauge_check.remove(ep.second.gauge[metric]);
+            gauge_ep_family_ptr[metric]->Remove(ep.second.gauge[metric]);
+        }
+        incStaticCounterEpRemove();
     }
+
+    ep_gauge_map.clear();
+    ep_drops_rank.clear();
 }
 
 // Remove all dynamically allocated counter families
@@ -2245,6 +2862,59 @@ void AgentPrometheusManager::removeStaticGaugeFamiliesMoDBCount ()
     }
 }
 
+// Remove all statically allocated ModbClassStats gauge families
+void AgentPrometheusManager::removeStaticGaugeFamiliesModbClass ()
+{
+    for (MODB_CLASS_METRICS metric=MODB_CLASS_METRICS_MIN;
+            metric <= MODB_CLASS_METRICS_MAX;
+                metric = MODB_CLASS_METRICS(metric+1)) {
+        gauge_modb_class_family_ptr[metric] = nullptr;
+    }
+}
+
+// Remove the statically allocated ProcessorStats gauge family
+void AgentPrometheusManager::removeStaticGaugeFamiliesProcessor ()
+{
+    gauge_processor_family_ptr = nullptr;
+}
+
+// Remove the statically allocated FlowTableStats gauge family
+void AgentPrometheusManager::removeStaticGaugeFamiliesFlowTable ()
+{
+    gauge_flow_table_family_ptr = nullptr;
+}
+
+// Remove the statically allocated NotifStats gauge family
+void AgentPrometheusManager::removeStaticGaugeFamiliesNotif ()
+{
+    gauge_notif_family_ptr = nullptr;
+}
+
+// Remove the statically allocated ProcessStats and ThreadCpu gauge families
+void AgentPrometheusManager::removeStaticGaugeFamiliesProc ()
+{
+    gauge_process_family_ptr = nullptr;
+    gauge_thread_cpu_family_ptr = nullptr;
+}
+
+// Remove the statically allocated StartupStats gauge family
+void AgentPrometheusManager::removeStaticGaugeFamiliesStartup ()
+{
+    gauge_startup_family_ptr = nullptr;
+}
+
+// Remove the statically allocated latency histogram gauge families
+void AgentPrometheusManager::removeStaticGaugeFamiliesLatency ()
+{
+    for (LATENCY_METRICS metric=LATENCY_METRICS_MIN;
+            metric <= LATENCY_METRICS_MAX;
+                metric = LATENCY_METRICS(metric+1)) {
+        gauge_latency_bucket_family_ptr[metric] = nullptr;
+        gauge_latency_sum_family_ptr[metric] = nullptr;
+        gauge_latency_count_family_ptr[metric] = nullptr;
+    }
+}
+
 // Remove all statically allocated RDDrop gauge families
 void AgentPrometheusManager::removeStaticGaugeFamiliesRDDrop ()
 {
@@ -2344,6 +3014,48 @@ void AgentPrometheusManager::removeStaticGaugeFamilies()
         removeStaticGaugeFamiliesMoDBCount();
     }
 
+    // ModbClassStats specific
+    {
+        const lock_guard<mutex> lock(modb_class_mutex);
+        removeStaticGaugeFamiliesModbClass();
+    }
+
+    // ProcessorStats specific
+    {
+        const lock_guard<mutex> lock(processor_mutex);
+        removeStaticGaugeFamiliesProcessor();
+    }
+
+    // FlowTableStats specific
+    {
+        const lock_guard<mutex> lock(flow_table_mutex);
+        removeStaticGaugeFamiliesFlowTable();
+    }
+
+    // NotifStats specific
+    {
+        const lock_guard<mutex> lock(notif_mutex);
+        removeStaticGaugeFamiliesNotif();
+    }
+
+    // ProcessStats and ThreadCpu specific
+    {
+        const lock_guard<mutex> lock(proc_mutex);
+        removeStaticGaugeFamiliesProc();
+    }
+
+    // StartupStats specific
+    {
+        const lock_guard<mutex> lock(startup_mutex);
+        removeStaticGaugeFamiliesStartup();
+    }
+
+    // Latency histogram specific
+    {
+        const lock_guard<mutex> lock(latency_mutex);
+        removeStaticGaugeFamiliesLatency();
+    }
+
     // RDDropCounter specific
     {
         const lock_guard<mutex> lock(rddrop_stats_mutex);
@@ -2493,6 +3205,15 @@ void AgentPrometheusManager::addNUpdateSvcTargetCounter (const string& uuid,
     const lock_guard<mutex> lock(svc_target_counter_mutex);
 
     const string& key = uuid+nhip;
+    if (createIfNotPresent && budget.maxSvcTargets &&
+        !getDynamicGaugeSvcTarget(SVC_TARGET_METRICS_MIN, key) &&
+        svc_target_gauge_map[SVC_TARGET_METRICS_MIN].size()
+            >= budget.maxSvcTargets) {
+        LOG(TRACE) << "svc-target metric budget exceeded, not creating: "
+                   << key;
+        return;
+    }
+
     // Create the gauge counters if they arent present already
     for (SVC_TARGET_METRICS metric=SVC_TARGET_METRICS_MIN;
             metric <= SVC_TARGET_METRICS_MAX;
@@ -2920,29 +3641,35 @@ void AgentPrometheusManager::addNUpdateEpCounter (const string& uuid,
 
     const lock_guard<mutex> lock(ep_counter_mutex);
 
+    if (!getDynamicGaugeEp(uuid) && !admitDynamicGaugeEp(uuid, counters))
+        return;
+
     // Create the gauge counters if they arent present already
-    for (EP_METRICS metric=EP_METRICS_MIN;
-            metric < EP_METRICS_MAX;
-                metric = EP_METRICS(metric+1)) {
-        if (!createDynamicGaugeEp(metric,
-                                  uuid,
-                                  ep_name,
-                                  annotate_ep_name,
-                                  attr_hash,
-                                  attr_map)) {
-            break;
-        }
+    bool created;
+    auto gauges = createDynamicGaugeEp(uuid,
+                                       ep_name,
+                                       annotate_ep_name,
+                                       attr_hash,
+                                       attr_map,
+                                       created);
+    if (!gauges) {
+        LOG(WARNING) << "ep stats invalid update for uuid: " << uuid;
+        return;
+    }
+    if (created)
+        incStaticCounterEpCreate();
 
-        if (metric == (EP_METRICS_MAX-1)) {
-            incStaticCounterEpCreate();
-        }
+    uint64_t drops = counters.rxDrop + counters.txDrop;
+    if (budget.epExportMode == EP_EXPORT_TOP_DROPS && drops != gauges->drops) {
+        ep_drops_rank.erase(make_pair(gauges->drops, uuid));
+        ep_drops_rank.insert(make_pair(drops, uuid));
     }
+    gauges->drops = drops;
 
     // Update the metrics
     for (EP_METRICS metric=EP_METRICS_MIN;
             metric < EP_METRICS_MAX;
                 metric = EP_METRICS(metric+1)) {
-        hgauge_pair_t hgauge = getDynamicGaugeEp(metric, uuid);
         optional<uint64_t>   metric_opt;
         switch (metric) {
         case EP_RX_BYTES:
@@ -2984,12 +3711,8 @@ void AgentPrometheusManager::addNUpdateEpCounter (const string& uuid,
         default:
             LOG(WARNING) << "Unhandled metric: " << metric;
         }
-        if (metric_opt && hgauge)
-            hgauge.get().second->Set(static_cast<double>(metric_opt.get()));
-        if (!hgauge) {
-            LOG(WARNING) << "ep stats invalid update for uuid: " << uuid;
-            break;
-        }
+        if (metric_opt)
+            gauges->gauge[metric]->Set(static_cast<double>(metric_opt.get()));
     }
 }
 
@@ -3070,16 +3793,8 @@ void AgentPrometheusManager::removeEpCounter (const string& uuid,
     const lock_guard<mutex> lock(ep_counter_mutex);
     LOG(DEBUG) << "remove ep counter " << ep_name;
 
-    for (EP_METRICS metric=EP_METRICS_MIN;
-            metric < EP_METRICS_MAX;
-                metric = EP_METRICS(metric+1)) {
-        if (!removeDynamicGaugeEp(metric, uuid))
-            break;
-
-        if (metric == (EP_METRICS_MAX-1)) {
-            incStaticCounterEpRemove();
-        }
-    }
+    if (removeDynamicGaugeEp(uuid))
+        incStaticCounterEpRemove();
 }
 
 // Function to remove MoDBCounts
@@ -3096,6 +3811,416 @@ void AgentPrometheusManager::removeMoDBCounts ()
     }
 }
 
+/* Function called from SysStatsManager to update ModbClassStats */
+void AgentPrometheusManager::addNUpdateModbClassStats (const string& className,
+                                                       const opflex::modb::ClassStats& stats)
+{
+    RETURN_IF_DISABLED
+    const lock_guard<mutex> lock(modb_class_mutex);
+
+    // Create gauge metrics if they arent present already
+    for (MODB_CLASS_METRICS metric=MODB_CLASS_METRICS_MIN;
+            metric <= MODB_CLASS_METRICS_MAX;
+                metric = MODB_CLASS_METRICS(metric+1))
+        createDynamicGaugeModbClass(metric, className);
+
+    // Update the metrics
+    for (MODB_CLASS_METRICS metric=MODB_CLASS_METRICS_MIN;
+            metric <= MODB_CLASS_METRICS_MAX;
+                metric = MODB_CLASS_METRICS(metric+1)) {
+        Gauge *pgauge = getDynamicGaugeModbClass(metric, className);
+        if (!pgauge) {
+            LOG(WARNING) << "Invalid modb class update class: " << className;
+            break;
+        }
+        switch (metric) {
+        case MODB_CLASS_INSTANCES:
+            pgauge->Set(static_cast<double>(stats.instances));
+            break;
+        case MODB_CLASS_BYTES:
+            pgauge->Set(static_cast<double>(stats.getBytes()));
+            break;
+        default:
+            LOG(WARNING) << "Unhandled modb class metric: " << metric;
+        }
+    }
+}
+
+/* Function called from SysStatsManager to update ProcessorStats */
+void AgentPrometheusManager::addNUpdateProcessorStats (const string& state,
+                                                       uint64_t count)
+{
+    RETURN_IF_DISABLED
+    const lock_guard<mutex> lock(processor_mutex);
+
+    Gauge *pgauge = nullptr;
+    auto itr = processor_gauge_map.find(state);
+    if (itr != processor_gauge_map.end()) {
+        pgauge = itr->second;
+    } else {
+        auto& gauge = gauge_processor_family_ptr->Add({{"state", state}});
+        if (gauge_check.is_dup(&gauge)) {
+            LOG(WARNING) << "duplicate processor dyn gauge family"
+                         << " state: " << state;
+            return;
+        }
+        LOG(DEBUG) << "created processor dyn gauge family"
+                   << " state: " << state;
+        gauge_check.add(&gauge);
+        processor_gauge_map[state] = &gauge;
+        pgauge = &gauge;
+    }
+    pgauge->Set(static_cast<double>(count));
+}
+
+/* Function called from SysStatsManager to update FlowTableStats and the
+ * flow write histograms */
+void AgentPrometheusManager::addNUpdateFlowProgrammingStats (
+    const FlowProgrammingStats& stats)
+{
+    RETURN_IF_DISABLED
+    FlowProgrammingStats::bridge_map_t bridges;
+    stats.getBridges(bridges);
+
+    {
+        const lock_guard<mutex> lock(flow_table_mutex);
+        for (const auto& br : bridges) {
+            for (size_t t = 0; t < br.second->getTableCount(); ++t) {
+                flow_table_gauges_t* gauges = nullptr;
+                for (FlowProgrammingStats::Counter c =
+                         FlowProgrammingStats::ADDS;
+                     c <= FlowProgrammingStats::COUNTER_MAX;
+                     c = FlowProgrammingStats::Counter(c+1)) {
+                    uint64_t value = br.second->get(t, c);
+                    // tables the agent never wrote have no gauges
+                    if (!gauges) {
+                        auto itr =
+                            flow_table_gauge_map.find(make_pair(br.first, t));
+                        if (itr != flow_table_gauge_map.end())
+                            gauges = &itr->second;
+                        else if (value == 0)
+                            continue;
+                        else
+                            gauges = &flow_table_gauge_map[make_pair(br.first,
+                                                                     t)];
+                    }
+                    Gauge*& pgauge = (*gauges)[c];
+                    if (!pgauge) {
+                        auto& gauge = gauge_flow_table_family_ptr->Add(
+                            {{"bridge", br.first},
+                             {"table", to_string(t)},
+                             {"counter",
+                              FlowProgrammingStats::getCounterName(c)}});
+                        if (gauge_check.is_dup(&gauge)) {
+                            LOG(WARNING) << "duplicate flow table dyn gauge"
+                                         << " bridge: " << br.first
+                                         << " table: " << t;
+                            continue;
+                        }
+                        gauge_check.add(&gauge);
+                        pgauge = &gauge;
+                    }
+                    pgauge->Set(static_cast<double>(value));
+                }
+            }
+        }
+    }
+
+    const lock_guard<mutex> lock(latency_mutex);
+    for (const auto& br : bridges) {
+        updateDynamicGaugeLatency(LATENCY_FLOW_WRITE_CHANGES, br.first,
+                                  br.second->getEditSize());
+        updateDynamicGaugeLatency(LATENCY_FLOW_BARRIER, br.first,
+                                  br.second->getBarrierLatency());
+    }
+}
+
+/* Function called from SysStatsManager to update NotifStats */
+void AgentPrometheusManager::addNUpdateNotifStats (const string& counter,
+                                                   uint64_t count)
+{
+    RETURN_IF_DISABLED
+    const lock_guard<mutex> lock(notif_mutex);
+
+    Gauge *pgauge = nullptr;
+    auto itr = notif_gauge_map.find(counter);
+    if (itr != notif_gauge_map.end()) {
+        pgauge = itr->second;
+    } else {
+        auto& gauge = gauge_notif_family_ptr->Add({{"counter", counter}});
+        if (gauge_check.is_dup(&gauge)) {
+            LOG(WARNING) << "duplicate notif dyn gauge family"
+                         << " counter: " << counter;
+            return;
+        }
+        LOG(DEBUG) << "created notif dyn gauge family"
+                   << " counter: " << counter;
+        gauge_check.add(&gauge);
+        notif_gauge_map[counter] = &gauge;
+        pgauge = &gauge;
+    }
+    pgauge->Set(static_cast<double>(count));
+}
+
+/* Function called from SysStatsManager to update ProcessStats */
+void AgentPrometheusManager::addNUpdateProcessStats (const string& stat,
+                                                     double value)
+{
+    RETURN_IF_DISABLED
+    const lock_guard<mutex> lock(proc_mutex);
+
+    Gauge *pgauge = nullptr;
+    auto itr = process_gauge_map.find(stat);
+    if (itr != process_gauge_map.end()) {
+        pgauge = itr->second;
+    } else {
+        auto& gauge = gauge_process_family_ptr->Add({{"stat", stat}});
+        if (gauge_check.is_dup(&gauge)) {
+            LOG(WARNING) << "duplicate process dyn gauge family"
+                         << " stat: " << stat;
+            return;
+        }
+        LOG(DEBUG) << "created process dyn gauge family"
+                   << " stat: " << stat;
+        gauge_check.add(&gauge);
+        process_gauge_map[stat] = &gauge;
+        pgauge = &gauge;
+    }
+    pgauge->Set(value);
+}
+
+/* Function called from Agent to update StartupStats */
+void AgentPrometheusManager::addNUpdateStartupStats (const string& event,
+                                                     double seconds)
+{
+    RETURN_IF_DISABLED
+    const lock_guard<mutex> lock(startup_mutex);
+
+    Gauge *pgauge = nullptr;
+    auto itr = startup_gauge_map.find(event);
+    if (itr != startup_gauge_map.end()) {
+        pgauge = itr->second;
+    } else {
+        auto& gauge = gauge_startup_family_ptr->Add({{"event", event}});
+        if (gauge_check.is_dup(&gauge)) {
+            LOG(WARNING) << "duplicate startup dyn gauge family"
+                         << " event: " << event;
+            return;
+        }
+        LOG(DEBUG) << "created startup dyn gauge family"
+                   << " event: " << event;
+        gauge_check.add(&gauge);
+        startup_gauge_map[event] = &gauge;
+        pgauge = &gauge;
+    }
+    pgauge->Set(seconds);
+}
+
+/* Function called from SysStatsManager to update ThreadCpu */
+void AgentPrometheusManager::addNUpdateThreadCpu (const string& thread,
+                                                  double seconds)
+{
+    RETURN_IF_DISABLED
+    const lock_guard<mutex> lock(proc_mutex);
+
+    Gauge *pgauge = nullptr;
+    auto itr = thread_cpu_gauge_map.find(thread);
+    if (itr != thread_cpu_gauge_map.end()) {
+        pgauge = itr->second;
+    } else {
+        auto& gauge = gauge_thread_cpu_family_ptr->Add({{"thread", thread}});
+        if (gauge_check.is_dup(&gauge)) {
+            LOG(WARNING) << "duplicate thread cpu dyn gauge family"
+                         << " thread: " << thread;
+            return;
+        }
+        LOG(DEBUG) << "created thread cpu dyn gauge family"
+                   << " thread: " << thread;
+        gauge_check.add(&gauge);
+        thread_cpu_gauge_map[thread] = &gauge;
+        pgauge = &gauge;
+    }
+    pgauge->Set(seconds);
+}
+
+/* Function called from SysStatsManager to remove ThreadCpu */
+void AgentPrometheusManager::removeThreadCpu (const string& thread)
+{
+    RETURN_IF_DISABLED
+    const lock_guard<mutex> lock(proc_mutex);
+    auto itr = thread_cpu_gauge_map.find(thread);
+    if (itr == thread_cpu_gauge_map.end())
+        return;
+    LOG(DEBUG) << "Delete ThreadCpu thread: " << thread;
+    gauge_check.remove(itr->second);
+    gauge_thread_cpu_family_ptr->Remove(itr->second);
+    thread_cpu_gauge_map.erase(itr);
+}
+
+// Create or update the gauges of a latency histogram
+void AgentPrometheusManager::updateDynamicGaugeLatency (LATENCY_METRICS metric,
+                                                       const string& label,
+                                             const OFLatencyHistogram& hist,
+                                                       const string& sublabel)
+{
+    const auto key = make_pair(label, sublabel);
+    auto itr = latency_gauge_map[metric].find(key);
+    if (itr == latency_gauge_map[metric].end()) {
+        map<string, string> labels;
+        if (!latency_label_names[metric].empty())
+            labels[latency_label_names[metric]] = label;
+        if (!latency_sublabel_names[metric].empty())
+            labels[latency_sublabel_names[metric]] = sublabel;
+
+        latency_gauges_t gauges;
+        for (size_t b = 0; b <= OFLatencyHistogram::BUCKETS; ++b) {
+            map<string, string> bucket_labels(labels);
+            bucket_labels["le"] = (b < OFLatencyHistogram::BUCKETS)
+                ? to_string(OFLatencyHistogram::getBound(b)) : "+Inf";
+            auto& gauge =
+                gauge_latency_bucket_family_ptr[metric]->Add(bucket_labels);
+            if (gauge_check.is_dup(&gauge)) {
+                LOG(WARNING) << "duplicate latency dyn gauge family"
+                             << " metric: " << metric
+                             << " label: " << label;
+                // undo the buckets added so far
+                for (size_t i = 0; i < b; ++i) {
+                    gauge_check.remove(gauges.bucket[i]);
+                    gauge_latency_bucket_family_ptr[metric]
+                        ->Remove(gauges.bucket[i]);
+                }
+                return;
+            }
+            gauge_check.add(&gauge);
+            gauges.bucket[b] = &gauge;
+        }
+        gauges.sum = &gauge_latency_sum_family_ptr[metric]->Add(labels);
+        gauge_check.add(gauges.sum);
+        gauges.count = &gauge_latency_count_family_ptr[metric]->Add(labels);
+        gauge_check.add(gauges.count);
+        LOG(DEBUG) << "created latency dyn gauge family"
+                   << " metric: " << metric
+                   << " label: " << label;
+        itr = latency_gauge_map[metric].emplace(key, gauges).first;
+    }
+
+    latency_gauges_t& gauges = itr->second;
+    for (size_t b = 0; b <= OFLatencyHistogram::BUCKETS; ++b) {
+        gauges.bucket[b]->Set(
+            static_cast<double>(hist.getCumulativeCount(b)));
+    }
+    gauges.sum->Set(static_cast<double>(hist.getSum()));
+    gauges.count->Set(static_cast<double>(hist.getCount()));
+}
+
+/* Function called from SysStatsManager to update peer latency histograms */
+void AgentPrometheusManager::addNUpdateOFPeerLatency (const string& peer,
+                                const std::shared_ptr<OFAgentStats> stats)
+{
+    RETURN_IF_DISABLED
+    if (!stats)
+        return;
+    const lock_guard<mutex> lock(latency_mutex);
+    updateDynamicGaugeLatency(LATENCY_PEER_POL_RESOLVE, peer,
+                              stats->getPolResolveLatency());
+    updateDynamicGaugeLatency(LATENCY_PEER_EP_DECLARE, peer,
+                              stats->getEpDeclareLatency());
+    updateDynamicGaugeLatency(LATENCY_PEER_KEEPALIVE_RTT, peer,
+                              stats->getKeepAliveRtt());
+    OFMethodLatency::method_map_t methodLatency;
+    stats->getMethodLatency().getLatency(methodLatency);
+    for (const auto& l : methodLatency) {
+        if (l.second)
+            updateDynamicGaugeLatency(LATENCY_PEER_METHOD, peer,
+                                      *l.second, l.first);
+    }
+}
+
+/* Function called from SysStatsManager to remove peer latency histograms */
+void AgentPrometheusManager::removeOFPeerLatency (const string& peer)
+{
+    RETURN_IF_DISABLED
+    LOG(DEBUG) << "Deleting latency histograms for peer: " << peer;
+    const lock_guard<mutex> lock(latency_mutex);
+    removeDynamicGaugeLatency(LATENCY_PEER_POL_RESOLVE, peer);
+    removeDynamicGaugeLatency(LATENCY_PEER_EP_DECLARE, peer);
+    removeDynamicGaugeLatency(LATENCY_PEER_KEEPALIVE_RTT, peer);
+    // the method histograms of the peer are adjacent in the map
+    auto& methodGauges = latency_gauge_map[LATENCY_PEER_METHOD];
+    auto itr = methodGauges.lower_bound(make_pair(peer, string()));
+    while (itr != methodGauges.end() && itr->first.first == peer) {
+        const string method = (itr++)->first.second;
+        removeDynamicGaugeLatency(LATENCY_PEER_METHOD, peer, method);
+    }
+}
+
+/* Function called from SysStatsManager to update processor latencies */
+void AgentPrometheusManager::addNUpdateProcessorLatency (
+    const OFLatencyHistogram& processTime,
+    const unordered_map<string,
+            std::shared_ptr<const OFLatencyHistogram>>&
+        resolveLatency)
+{
+    RETURN_IF_DISABLED
+    const lock_guard<mutex> lock(latency_mutex);
+    updateDynamicGaugeLatency(LATENCY_PROCESS_TIME, "", processTime);
+    for (const auto& l : resolveLatency) {
+        if (l.second)
+            updateDynamicGaugeLatency(LATENCY_CLASS_RESOLVE, l.first,
+                                      *l.second);
+    }
+}
+
+/* Function called from SysStatsManager to update dataplane latencies */
+void AgentPrometheusManager::addNUpdateDataplaneLatency (
+    const DataplaneLatency& latency)
+{
+    RETURN_IF_DISABLED
+    const lock_guard<mutex> lock(latency_mutex);
+    for (DataplaneLatency::Stage stage = DataplaneLatency::NOTIFY;
+            stage <= DataplaneLatency::STAGE_MAX;
+                stage = DataplaneLatency::Stage(stage+1)) {
+        updateDynamicGaugeLatency(LATENCY_DATAPLANE,
+                                  DataplaneLatency::getStageName(stage),
+                                  latency.getHistogram(stage));
+    }
+}
+
+/* Function called from SysStatsManager to update task watchdog stats */
+void AgentPrometheusManager::addNUpdateTaskWatchdogStats (
+    const TaskWatchdog& watchdog)
+{
+    RETURN_IF_DISABLED
+    TaskWatchdog::hist_map_t taskTimes;
+    TaskWatchdog::hist_map_t loopLag;
+    watchdog.getTaskTimes(taskTimes);
+    watchdog.getLoopLag(loopLag);
+
+    const lock_guard<mutex> lock(latency_mutex);
+    for (const auto& t : taskTimes) {
+        if (t.second)
+            updateDynamicGaugeLatency(LATENCY_TASK_TIME, t.first, *t.second);
+    }
+    for (const auto& l : loopLag) {
+        if (l.second)
+            updateDynamicGaugeLatency(LATENCY_LOOP_LAG, l.first, *l.second);
+    }
+}
+
+// Function called from SysStatsManager to remove ModbClassStats
+void AgentPrometheusManager::removeModbClassStats (const string& className)
+{
+    RETURN_IF_DISABLED
+    LOG(DEBUG) << "Deleting ModbClassStats for class: " << className;
+    const lock_guard<mutex> lock(modb_class_mutex);
+    for (MODB_CLASS_METRICS metric=MODB_CLASS_METRICS_MIN;
+            metric <= MODB_CLASS_METRICS_MAX;
+                metric = MODB_CLASS_METRICS(metric+1)) {
+        if (!removeDynamicGaugeModbClass(metric, className))
+            break;
+    }
+}
+
 // Function called from PolicyStatsManager to remove OFPeerStats
 void AgentPrometheusManager::removeOFPeerStats (const string& peer)
 {
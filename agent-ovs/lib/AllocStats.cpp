@@ -0,0 +1,206 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for AllocStats class.
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <opflexagent/AllocStats.h>
+#include <opflexagent/logging.h>
+
+#if defined(HAVE_JEMALLOC)
+#include <jemalloc/jemalloc.h>
+#elif defined(HAVE_TCMALLOC)
+#include <gperftools/heap-profiler.h>
+#include <gperftools/malloc_extension.h>
+#else
+#include <malloc.h>
+#endif
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace opflexagent {
+
+namespace {
+
+/*
+ * Create the profile file, failing if anything already exists at the
+ * path so that a symlink or file planted there is never written to
+ */
+int createProfile(const std::string& path) {
+    int fd = open(path.c_str(),
+                  O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC,
+                  0600);
+    if (fd < 0)
+        LOG(ERROR) << "Could not create heap profile " << path
+                   << ": " << strerror(errno);
+    return fd;
+}
+
+#if !defined(HAVE_JEMALLOC)
+/* Create the profile file and open a stream on it */
+FILE* openProfile(const std::string& path) {
+    int fd = createProfile(path);
+    if (fd < 0) return nullptr;
+    FILE* f = fdopen(fd, "w");
+    if (!f) close(fd);
+    return f;
+}
+#endif
+
+} /* anonymous namespace */
+
+#if defined(HAVE_JEMALLOC)
+
+namespace {
+
+bool readStat(const char* name, uint64_t& value) {
+    size_t v;
+    size_t len = sizeof(v);
+    if (mallctl(name, &v, &len, nullptr, 0) != 0)
+        return false;
+    value = v;
+    return true;
+}
+
+} /* anonymous namespace */
+
+const char* AllocStats::getAllocatorName() { return "jemalloc"; }
+
+bool AllocStats::sample() {
+    // the statistics are cached until the epoch is advanced
+    uint64_t epoch = 1;
+    size_t len = sizeof(epoch);
+    if (mallctl("epoch", &epoch, &len, &epoch, len) != 0)
+        return false;
+    return readStat("stats.allocated", allocated) &&
+        readStat("stats.active", active) &&
+        readStat("stats.resident", resident);
+}
+
+void AllocStats::releaseFreeMemory() {
+#ifdef MALLCTL_ARENAS_ALL
+    std::string purge =
+        "arena." + std::to_string(MALLCTL_ARENAS_ALL) + ".purge";
+    if (mallctl(purge.c_str(), nullptr, nullptr, nullptr, 0) != 0)
+        LOG(DEBUG) << "Could not purge jemalloc arenas";
+#endif
+}
+
+bool AllocStats::dumpHeapProfile(const std::string& path) {
+    // jemalloc opens the file by name itself, so have it write to the
+    // file created here through its descriptor
+    int fd = createProfile(path);
+    if (fd < 0) return false;
+    std::string fdPath = "/proc/self/fd/" + std::to_string(fd);
+    const char* file = fdPath.c_str();
+    int rc = mallctl("prof.dump", nullptr, nullptr, &file, sizeof(file));
+    close(fd);
+    if (rc != 0) {
+        LOG(ERROR) << "Could not dump heap profile to " << path
+                   << ": " << rc << " (is MALLOC_CONF=prof:true set?)";
+        return false;
+    }
+    return true;
+}
+
+#elif defined(HAVE_TCMALLOC)
+
+namespace {
+
+uint64_t readStat(const char* name) {
+    size_t v = 0;
+    MallocExtension::instance()->GetNumericProperty(name, &v);
+    return v;
+}
+
+} /* anonymous namespace */
+
+const char* AllocStats::getAllocatorName() { return "tcmalloc"; }
+
+bool AllocStats::sample() {
+    allocated = readStat("generic.current_allocated_bytes");
+    uint64_t heap = readStat("generic.heap_size");
+    uint64_t pageFree = readStat("tcmalloc.pageheap_free_bytes");
+    uint64_t unmapped = readStat("tcmalloc.pageheap_unmapped_bytes");
+    resident = heap > unmapped ? heap - unmapped : 0;
+    active = resident > pageFree ? resident - pageFree : 0;
+    return true;
+}
+
+void AllocStats::releaseFreeMemory() {
+    MallocExtension::instance()->ReleaseFreeMemory();
+}
+
+bool AllocStats::dumpHeapProfile(const std::string& path) {
+    if (!IsHeapProfilerRunning()) {
+        LOG(ERROR) << "Could not dump heap profile to " << path
+                   << ": heap profiler is not running"
+                   << " (is HEAPPROFILE set?)";
+        return false;
+    }
+    FILE* f = openProfile(path);
+    if (!f) return false;
+    char* profile = GetHeapProfile();
+    bool ok = fputs(profile, f) >= 0;
+    if (fclose(f) != 0) ok = false;
+    free(profile);
+    if (!ok)
+        LOG(ERROR) << "Could not write heap profile to " << path;
+    return ok;
+}
+
+#else
+
+const char* AllocStats::getAllocatorName() { return "libc"; }
+
+bool AllocStats::sample() {
+#if defined(__GLIBC__) && \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 mi = mallinfo2();
+#else
+    // the counters wrap at 4GB
+    struct mallinfo mi = mallinfo();
+#endif
+    // chunks in use in the arenas and mmapped chunks
+    allocated = uint64_t(mi.uordblks) + uint64_t(mi.hblkhd);
+    // the arenas and mmapped chunks, of which the top chunk of the
+    // main arena could be released by a trim
+    resident = uint64_t(mi.arena) + uint64_t(mi.hblkhd);
+    active = resident > uint64_t(mi.keepcost)
+        ? resident - uint64_t(mi.keepcost) : resident;
+    return true;
+}
+
+void AllocStats::releaseFreeMemory() {
+    malloc_trim(0);
+}
+
+bool AllocStats::dumpHeapProfile(const std::string& path) {
+    FILE* f = openProfile(path);
+    if (!f) return false;
+    bool ok = malloc_info(0, f) == 0;
+    if (fclose(f) != 0) ok = false;
+    if (!ok)
+        LOG(ERROR) << "Could not write heap statistics to " << path;
+    return ok;
+}
+
+#endif
+
+} /* namespace opflexagent */
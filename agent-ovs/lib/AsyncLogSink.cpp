@@ -0,0 +1,165 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for AsyncLogSink class.
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/AsyncLogSink.h>
+#include <opflex/util/ThreadSettings.h>
+
+#include <algorithm>
+#include <sstream>
+
+namespace opflexagent {
+
+using std::chrono::system_clock;
+
+namespace {
+
+/* how long the writer sleeps when it is not woken up */
+const std::chrono::milliseconds WRITER_POLL(50);
+
+std::atomic<uint64_t> nextSinkId(1);
+
+/* the ring of the current thread and the sink it belongs to */
+struct ThreadRing {
+    uint64_t sinkId = 0;
+    std::shared_ptr<void> ring;
+};
+thread_local ThreadRing threadRing;
+
+} /* anonymous namespace */
+
+AsyncLogSink::AsyncLogSink(LogSink& sink_, size_t ringSize_)
+    : sink(sink_), ringSize(ringSize_), id(nextSinkId++),
+      flushRequested(0), flushDone(0), stopping(false),
+      pending(false), dropped(0) {
+    writer = opflex::util::startThread("log_writer", [this]() { run(); });
+}
+
+AsyncLogSink::~AsyncLogSink() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cond.notify_one();
+    writer.join();
+}
+
+AsyncLogSink::Ring& AsyncLogSink::getRing() {
+    if (threadRing.sinkId != id) {
+        auto ring = std::make_shared<Ring>(ringSize);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            rings.push_back(ring);
+        }
+        threadRing.sinkId = id;
+        threadRing.ring = ring;
+    }
+    return *static_cast<Ring*>(threadRing.ring.get());
+}
+
+void AsyncLogSink::write(LogLevel level, const char *filename, int lineno,
+                         const char *functionName,
+                         const std::string& message) {
+    write(system_clock::now(), level, filename, lineno, functionName,
+          message);
+}
+
+void AsyncLogSink::write(const system_clock::time_point& time,
+                         LogLevel level, const char *filename, int lineno,
+                         const char *functionName,
+                         const std::string& message) {
+    if (level == FATAL) {
+        flush();
+        sink.write(time, level, filename, lineno, functionName, message);
+        return;
+    }
+
+    Record r{time, level, filename, lineno, functionName, message};
+    bool wasEmpty = false;
+    if (!getRing().push(std::move(r), &wasEmpty)) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (wasEmpty && !pending.exchange(true))
+        cond.notify_one();
+}
+
+void AsyncLogSink::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    uint64_t request = ++flushRequested;
+    cond.notify_one();
+    flushCond.wait(lock, [this, request]() {
+            return flushDone >= request || stopping;
+        });
+}
+
+size_t AsyncLogSink::drain(const std::vector<std::shared_ptr<Ring> >& toDrain) {
+    size_t count = 0;
+    Record r;
+    for (const auto& ring : toDrain) {
+        while (ring->pop(r)) {
+            sink.write(r.time, r.level, r.filename.c_str(), r.lineno,
+                       r.functionName.c_str(), r.message);
+            ++count;
+        }
+    }
+    return count;
+}
+
+void AsyncLogSink::run() {
+    std::vector<std::shared_ptr<Ring> > toDrain;
+    uint64_t reported = 0;
+    while (true) {
+        uint64_t flushing;
+        bool stop;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait_for(lock, WRITER_POLL, [this]() {
+                    return stopping || pending.load() ||
+                        flushRequested != flushDone;
+                });
+            // forget the rings of threads that have exited once they
+            // are empty
+            rings.erase(std::remove_if(rings.begin(), rings.end(),
+                                       [](const std::shared_ptr<Ring>& r) {
+                                           return r.use_count() == 1 &&
+                                               r->empty();
+                                       }),
+                        rings.end());
+            toDrain = rings;
+            flushing = flushRequested;
+            stop = stopping;
+        }
+
+        // keep draining until a pass finds nothing, so that the
+        // messages queued before a flush request are written
+        pending = false;
+        while (drain(toDrain) > 0) {}
+
+        uint64_t d = dropped.load();
+        if (d != reported) {
+            std::stringstream msg;
+            msg << "Dropped " << (d - reported)
+                << " log messages because the log queue was full";
+            sink.write(system_clock::now(), WARNING, __FILE__, __LINE__,
+                       __FUNCTION__, msg.str());
+            reported = d;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            flushDone = flushing;
+        }
+        flushCond.notify_all();
+        if (stop) break;
+    }
+}
+
+} /* namespace opflexagent */
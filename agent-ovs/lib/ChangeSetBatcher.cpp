@@ -0,0 +1,174 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for ChangeSetBatcher class.
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/ChangeSetBatcher.h>
+#include <opflexagent/Agent.h>
+#include <opflexagent/logging.h>
+
+namespace opflexagent {
+
+using std::string;
+using std::unordered_set;
+using opflex::modb::URI;
+using opflex::modb::class_id_t;
+
+static const string CHANGE_SET_TASK("changeset");
+
+ChangeSetBatcher::ChangeSetBatcher(Agent& agent_,
+                                   boost::asio::io_service& io_service)
+    : agent(agent_), taskQueue(io_service), delay(0), maxDelay(0),
+      started(false) {
+    taskQueue.setWatchdog(&agent.getTaskWatchdog(), "changeset");
+}
+
+ChangeSetBatcher::~ChangeSetBatcher() {
+    stop();
+}
+
+void ChangeSetBatcher::registerListener(ChangeSetListener* listener) {
+    listeners.push_back(listener);
+}
+
+void ChangeSetBatcher::start() {
+    if (started) return;
+    started = true;
+
+    agent.getEndpointManager().registerListener(this);
+    agent.getServiceManager().registerListener(this);
+    agent.getPolicyManager().registerListener(this);
+}
+
+void ChangeSetBatcher::stop() {
+    if (!started) return;
+    started = false;
+
+    agent.getEndpointManager().unregisterListener(this);
+    agent.getServiceManager().unregisterListener(this);
+    agent.getPolicyManager().unregisterListener(this);
+}
+
+void ChangeSetBatcher::schedule() {
+    taskQueue.dispatchDebounced(CHANGE_SET_TASK, delay,
+                                [this]() { deliver(); }, maxDelay);
+}
+
+void ChangeSetBatcher::endpointUpdated(const string& uuid) {
+    {
+        std::lock_guard<std::mutex> guard(pendingMutex);
+        pendingEndpoints.insert(uuid);
+    }
+    schedule();
+}
+
+void ChangeSetBatcher::endpointsUpdated(const unordered_set<string>& uuids) {
+    {
+        std::lock_guard<std::mutex> guard(pendingMutex);
+        pendingEndpoints.insert(uuids.begin(), uuids.end());
+    }
+    schedule();
+}
+
+void ChangeSetBatcher::serviceUpdated(const string& uuid) {
+    {
+        std::lock_guard<std::mutex> guard(pendingMutex);
+        pendingServices.insert(uuid);
+    }
+    schedule();
+}
+
+void ChangeSetBatcher::egDomainUpdated(const URI& egURI) {
+    {
+        std::lock_guard<std::mutex> guard(pendingMutex);
+        pendingGroups.insert(egURI);
+    }
+    schedule();
+}
+
+void ChangeSetBatcher::domainUpdated(class_id_t cid, const URI& domURI) {
+    {
+        std::lock_guard<std::mutex> guard(pendingMutex);
+        pendingDomains[domURI] = cid;
+    }
+    schedule();
+}
+
+void ChangeSetBatcher::contractUpdated(const URI& contractURI) {
+    {
+        std::lock_guard<std::mutex> guard(pendingMutex);
+        pendingContracts.insert(contractURI);
+    }
+    schedule();
+}
+
+void ChangeSetBatcher::secGroupUpdated(const URI& secGroupURI) {
+    {
+        std::lock_guard<std::mutex> guard(pendingMutex);
+        pendingSecGroups.insert(secGroupURI);
+    }
+    schedule();
+}
+
+void ChangeSetBatcher::deliver() {
+    if (!started) return;
+
+    unordered_set<string> endpoints;
+    unordered_set<string> services;
+    unordered_set<URI> groups;
+    unordered_set<URI> contracts;
+    unordered_set<URI> secGroups;
+    ChangeSet changes;
+    {
+        std::lock_guard<std::mutex> guard(pendingMutex);
+        endpoints.swap(pendingEndpoints);
+        services.swap(pendingServices);
+        groups.swap(pendingGroups);
+        contracts.swap(pendingContracts);
+        secGroups.swap(pendingSecGroups);
+        changes.domains.swap(pendingDomains);
+    }
+
+    // Take the snapshots outside the lock, so that updates keep
+    // gathering into the next change set meanwhile
+    EndpointManager& epMgr = agent.getEndpointManager();
+    for (const string& uuid : endpoints)
+        changes.endpoints[uuid] = epMgr.getEndpoint(uuid);
+
+    ServiceManager& svcMgr = agent.getServiceManager();
+    for (const string& uuid : services)
+        changes.services[uuid] = svcMgr.getService(uuid);
+
+    for (const URI& uri : groups) {
+        using modelgbp::gbp::EpGroup;
+        boost::optional<std::shared_ptr<EpGroup> > epg =
+            EpGroup::resolve(agent.getFramework(), uri);
+        changes.groups[uri] = epg ? epg.get() : nullptr;
+    }
+
+    PolicyManager& polMgr = agent.getPolicyManager();
+    for (const URI& uri : contracts)
+        polMgr.getContractRules(uri, changes.contracts[uri]);
+    for (const URI& uri : secGroups)
+        polMgr.getSecGroupRules(uri, changes.secGroups[uri]);
+
+    if (changes.empty()) return;
+
+    LOG(DEBUG) << "Delivering change set with "
+               << changes.endpoints.size() << " endpoints, "
+               << changes.services.size() << " services, "
+               << changes.groups.size() << " groups, "
+               << changes.contracts.size() << " contracts, "
+               << changes.secGroups.size() << " security groups and "
+               << changes.domains.size() << " domains";
+    for (ChangeSetListener* listener : listeners)
+        listener->changesUpdated(changes);
+}
+
+} /* namespace opflexagent */
@@ -0,0 +1,199 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for DBEndpointSource class.
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/DBEndpointSource.h>
+#include <opflexagent/FSEndpointSource.h>
+#include <opflexagent/logging.h>
+#include <opflex/modb/TraceContext.h>
+#include <opflex/util/ThreadSettings.h>
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <unordered_set>
+
+namespace opflexagent {
+
+using std::string;
+
+DBEndpointSource::DBEndpointSource(EndpointManager* manager_,
+                                   const string& path_,
+                                   long pollInterval_)
+    : EndpointSource(manager_), path(path_), pollInterval(pollInterval_),
+      reader(path_), sockFd(-1), stopPipe{-1, -1}, running(false) {
+    LOG(INFO) << "Reading endpoint data from database " << path;
+}
+
+DBEndpointSource::~DBEndpointSource() {
+    stop();
+}
+
+void DBEndpointSource::openSocket() {
+    string sockPath = EndpointDB::getSocketPath(path);
+    struct sockaddr_un addr;
+    if (sockPath.size() >= sizeof(addr.sun_path)) {
+        LOG(WARNING) << "Endpoint database socket path " << sockPath
+                     << " is too long; polling " << path << " instead";
+        return;
+    }
+    sockFd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (sockFd < 0) {
+        LOG(ERROR) << "Could not create endpoint database socket: "
+                   << std::strerror(errno);
+        return;
+    }
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, sockPath.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(sockPath.c_str());
+    if (bind(sockFd, reinterpret_cast<struct sockaddr*>(&addr),
+             sizeof(addr)) < 0) {
+        LOG(ERROR) << "Could not bind endpoint database socket "
+                   << sockPath << ": " << std::strerror(errno)
+                   << "; polling " << path << " instead";
+        close(sockFd);
+        sockFd = -1;
+    }
+}
+
+void DBEndpointSource::start() {
+    if (running) return;
+    sync();
+
+    if (pipe2(stopPipe, O_CLOEXEC) < 0) {
+        LOG(ERROR) << "Could not create pipe: " << std::strerror(errno);
+        return;
+    }
+    openSocket();
+    running = true;
+    thread = opflex::util::startThread("ep_db", [this]() { run(); });
+}
+
+void DBEndpointSource::stop() {
+    if (!running) return;
+    running = false;
+    char c = 0;
+    if (write(stopPipe[1], &c, 1) < 0) {
+        LOG(ERROR) << "Could not stop endpoint database thread: "
+                   << std::strerror(errno);
+    }
+    thread.join();
+    close(stopPipe[0]);
+    close(stopPipe[1]);
+    if (sockFd >= 0) {
+        close(sockFd);
+        unlink(EndpointDB::getSocketPath(path).c_str());
+        sockFd = -1;
+    }
+}
+
+void DBEndpointSource::run() {
+    struct pollfd fds[2];
+    fds[0].fd = stopPipe[0];
+    fds[0].events = POLLIN;
+    fds[1].fd = sockFd;
+    fds[1].events = POLLIN;
+    nfds_t nfds = sockFd >= 0 ? 2 : 1;
+
+    while (running) {
+        int rc = poll(fds, nfds, pollInterval);
+        if (rc < 0 && errno != EINTR) {
+            LOG(ERROR) << "Could not wait for endpoint database changes: "
+                       << std::strerror(errno);
+            break;
+        }
+        if (!running) break;
+        if (rc > 0 && (fds[1].revents & POLLIN)) {
+            // a batch of signals needs one read of the file
+            char buf[64];
+            while (recv(sockFd, buf, sizeof(buf), 0) > 0) {}
+        }
+        sync();
+    }
+}
+
+void DBEndpointSource::sync() {
+    using boost::property_tree::ptree;
+    const opflex::modb::TraceContext::Scope
+        trace(opflex::modb::TraceContext::clock::now());
+    std::lock_guard<std::mutex> guard(mutex);
+
+    std::unordered_set<string> seen;
+    size_t updated = 0;
+    size_t removed = 0;
+    bool reset = reader.read([&](EndpointDB::Op op, const string& uuid,
+                                 const char* json, size_t length) {
+            seen.insert(uuid);
+            if (op == EndpointDB::REMOVE) {
+                seen.erase(uuid);
+                if (knownEps.erase(uuid)) {
+                    removeEndpoint(uuid);
+                    ++removed;
+                }
+                return;
+            }
+
+            auto it = knownEps.find(uuid);
+            if (it != knownEps.end() &&
+                it->second.compare(0, string::npos, json, length) == 0)
+                return;
+            string contents(json, length);
+            try {
+                ptree properties;
+                std::istringstream is(contents);
+                read_json(is, properties);
+                Endpoint newep;
+                if (!FSEndpointSource::parseEndpoint(manager, properties,
+                                                     newep, path))
+                    return;
+                if (newep.getUUID() != uuid) {
+                    LOG(ERROR) << "Endpoint " << newep.getUUID()
+                               << " stored as " << uuid << " in " << path;
+                    return;
+                }
+                knownEps[uuid] = std::move(contents);
+                updateEndpoint(newep);
+                ++updated;
+            } catch (const std::exception& ex) {
+                LOG(ERROR) << "Could not load endpoint " << uuid
+                           << " from " << path << ": " << ex.what();
+            }
+        });
+
+    if (reset) {
+        // the file was replaced, so endpoints that are not in the new
+        // file are gone
+        for (auto it = knownEps.begin(); it != knownEps.end(); ) {
+            if (seen.count(it->first)) {
+                ++it;
+                continue;
+            }
+            removeEndpoint(it->first);
+            it = knownEps.erase(it);
+            ++removed;
+        }
+    }
+    if (updated || removed) {
+        LOG(INFO) << "Updated " << updated << " and removed " << removed
+                  << " endpoints from " << path;
+    }
+}
+
+} /* namespace opflexagent */
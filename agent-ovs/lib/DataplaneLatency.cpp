@@ -0,0 +1,27 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for DataplaneLatency class.
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/DataplaneLatency.h>
+
+namespace opflexagent {
+
+const char* DataplaneLatency::getStageName(Stage stage) {
+    static const char* names[STAGE_MAX + 1] =
+        { "notify", "queue", "compute", "barrier", "total" };
+    return names[stage];
+}
+
+void DataplaneLatency::observe(Stage stage, clock::duration duration) {
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(duration);
+    histograms[stage].observe(ms.count() > 0 ? ms.count() : 0);
+}
+
+} /* namespace opflexagent */
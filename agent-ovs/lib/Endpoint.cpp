@@ -16,6 +16,8 @@
 #include <boost/functional/hash.hpp>
 
 #include <opflexagent/Endpoint.h>
+#include <opflexagent/Interner.h>
+#include <opflexagent/logging.h>
 
 namespace opflexagent {
 
@@ -98,7 +100,7 @@ std::ostream & operator<<(std::ostream &os, const Endpoint& ep) {
     if (ep.getDHCPv6Config())
         os << ",dhcpv6";
 
-    auto attr_map = ep.getAttributes();
+    const Endpoint::attr_map_t& attr_map = ep.getAttributes();
     os << ",attr={";
     for (auto &p : attr_map)
         os << "(" << p.first << "," << p.second << ")";
@@ -123,6 +125,177 @@ void Endpoint::addIPAddressMapping(const IPAddressMapping& ipAddressMapping) {
     ipAddressMappings.insert(ipAddressMapping);
 }
 
+void Endpoint::addAttribute(const std::string& name,
+                            const std::string& value) {
+    // the map may be shared with copies of this endpoint or, once
+    // interned, with other endpoints
+    std::shared_ptr<attr_map_t> attrs;
+    if (attributes)
+        attrs = std::make_shared<attr_map_t>(*attributes);
+    else
+        attrs = std::make_shared<attr_map_t>();
+    (*attrs)[name] = value;
+    attributes = attrs;
+    attributesInterned = false;
+}
+
+const Endpoint::attr_map_t& Endpoint::getAttributes() const {
+    static const attr_map_t empty;
+    return attributes ? *attributes : empty;
+}
+
+namespace {
+
+struct AttrMapHash {
+    size_t operator()(const Endpoint::attr_map_t& m) const noexcept {
+        // independent of the iteration order of the map
+        size_t v = m.size();
+        for (const auto& a : m) {
+            size_t e = 0;
+            boost::hash_combine(e, a.first);
+            boost::hash_combine(e, a.second);
+            v += e;
+        }
+        return v;
+    }
+};
+
+template <typename T>
+void hash_opt(size_t& v, const boost::optional<T>& o) {
+    boost::hash_combine(v, static_cast<bool>(o));
+    if (o)
+        boost::hash_combine(v, o.get());
+}
+
+void hash_dhcp(size_t& v, const Endpoint::DHCPConfig& c) {
+    boost::hash_range(v, c.getDnsServers().begin(), c.getDnsServers().end());
+}
+
+struct DHCPv4Hash {
+    size_t operator()(const Endpoint::DHCPv4Config& c) const noexcept {
+        size_t v = 0;
+        hash_dhcp(v, c);
+        hash_opt(v, c.getIpAddress());
+        hash_opt(v, c.getPrefixLen());
+        hash_opt(v, c.getServerIp());
+        boost::hash_range(v, c.getRouters().begin(), c.getRouters().end());
+        hash_opt(v, c.getDomain());
+        boost::hash_combine(v, c.getStaticRoutes().size());
+        hash_opt(v, c.getInterfaceMtu());
+        hash_opt(v, c.getLeaseTime());
+        return v;
+    }
+};
+
+struct DHCPv4Equal {
+    bool operator()(const Endpoint::DHCPv4Config& a,
+                    const Endpoint::DHCPv4Config& b) const {
+        if (a.getStaticRoutes().size() != b.getStaticRoutes().size())
+            return false;
+        for (size_t i = 0; i < a.getStaticRoutes().size(); ++i) {
+            const auto& ra = a.getStaticRoutes()[i];
+            const auto& rb = b.getStaticRoutes()[i];
+            if (ra.dest != rb.dest || ra.prefixLen != rb.prefixLen ||
+                ra.nextHop != rb.nextHop)
+                return false;
+        }
+        return a.getDnsServers() == b.getDnsServers() &&
+            a.getIpAddress() == b.getIpAddress() &&
+            a.getPrefixLen() == b.getPrefixLen() &&
+            a.getServerIp() == b.getServerIp() &&
+            a.getServerMac() == b.getServerMac() &&
+            a.getRouters() == b.getRouters() &&
+            a.getDomain() == b.getDomain() &&
+            a.getInterfaceMtu() == b.getInterfaceMtu() &&
+            a.getLeaseTime() == b.getLeaseTime();
+    }
+};
+
+struct DHCPv6Hash {
+    size_t operator()(const Endpoint::DHCPv6Config& c) const noexcept {
+        size_t v = 0;
+        hash_dhcp(v, c);
+        boost::hash_range(v, c.getSearchList().begin(),
+                          c.getSearchList().end());
+        hash_opt(v, c.getT1());
+        hash_opt(v, c.getT2());
+        hash_opt(v, c.getValidLifetime());
+        hash_opt(v, c.getPreferredLifetime());
+        return v;
+    }
+};
+
+struct DHCPv6Equal {
+    bool operator()(const Endpoint::DHCPv6Config& a,
+                    const Endpoint::DHCPv6Config& b) const {
+        return a.getDnsServers() == b.getDnsServers() &&
+            a.getSearchList() == b.getSearchList() &&
+            a.getT1() == b.getT1() &&
+            a.getT2() == b.getT2() &&
+            a.getValidLifetime() == b.getValidLifetime() &&
+            a.getPreferredLifetime() == b.getPreferredLifetime();
+    }
+};
+
+Interner<Endpoint::attr_map_t, AttrMapHash> attrInterner;
+Interner<Endpoint::DHCPv4Config, DHCPv4Hash, DHCPv4Equal> dhcpv4Interner;
+Interner<Endpoint::DHCPv6Config, DHCPv6Hash, DHCPv6Equal> dhcpv6Interner;
+
+} /* anonymous namespace */
+
+void Endpoint::intern() {
+    if (attributes && !attributesInterned) {
+        attributes = attrInterner.intern(*attributes);
+        attributesInterned = true;
+    }
+    if (dhcpv4Config)
+        dhcpv4Config = dhcpv4Interner.intern(*dhcpv4Config);
+    if (dhcpv6Config)
+        dhcpv6Config = dhcpv6Interner.intern(*dhcpv6Config);
+}
+
+void Endpoint::addIP(const std::string& ip) {
+    if (!ips.insert(ip).second) return;
+    network::cidr_t cidr;
+    if (network::cidr_from_string(ip, cidr, false))
+        ipCidrs.push_back(cidr);
+    else
+        LOG(WARNING) << "Invalid endpoint IP: " << ip;
+}
+
+void Endpoint::addAnycastReturnIP(const std::string& ip) {
+    if (!anycastReturnIps.insert(ip).second) return;
+    boost::system::error_code ec;
+    boost::asio::ip::address addr =
+        boost::asio::ip::address::from_string(ip, ec);
+    if (!ec)
+        anycastReturnAddrs.push_back(addr);
+    else
+        LOG(WARNING) << "Invalid anycast return IP: " << ip
+                     << ": " << ec.message();
+}
+
+void Endpoint::addServiceIP(const std::string& ip) {
+    if (!serviceIps.insert(ip).second) return;
+    boost::system::error_code ec;
+    boost::asio::ip::address addr =
+        boost::asio::ip::address::from_string(ip, ec);
+    if (!ec)
+        serviceAddrs.push_back(addr);
+    else
+        LOG(WARNING) << "Invalid service IP: " << ip
+                     << ": " << ec.message();
+}
+
+void Endpoint::addVirtualIP(const virt_ip_t& virtualIp) {
+    if (!virtualIps.insert(virtualIp).second) return;
+    network::cidr_t cidr;
+    if (network::cidr_from_string(virtualIp.second, cidr))
+        virtualIpCidrs.emplace_back(virtualIp.first, cidr);
+    else
+        LOG(WARNING) << "Invalid endpoint VIP (CIDR): " << virtualIp.second;
+}
+
 bool operator==(const Endpoint::IPAddressMapping& lhs,
                 const Endpoint::IPAddressMapping& rhs) {
     return lhs.getUUID() == rhs.getUUID();
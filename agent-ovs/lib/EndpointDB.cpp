@@ -0,0 +1,446 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for the endpoint database
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/EndpointDB.h>
+#include <opflexagent/logging.h>
+
+#include <boost/crc.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace opflexagent {
+
+using std::string;
+using std::runtime_error;
+
+namespace {
+
+const char MAGIC[8] = {'O', 'F', 'E', 'P', 'D', 'B', 0, 0};
+const uint32_t VERSION = 1;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+};
+
+struct RecordHeader {
+    uint32_t length;
+    uint32_t crc;
+    uint8_t op;
+    uint8_t reserved[3];
+    uint32_t uuidLength;
+};
+
+static_assert(sizeof(FileHeader) == 16, "Unexpected file header size");
+static_assert(sizeof(RecordHeader) == 16, "Unexpected record header size");
+
+/* the CRC covers the record header after the CRC and the payload */
+uint32_t recordCrc(const RecordHeader& h, const char* payload) {
+    boost::crc_32_type crc;
+    const char* rest = reinterpret_cast<const char*>(&h.op);
+    crc.process_bytes(rest, sizeof(RecordHeader) -
+                      offsetof(RecordHeader, op));
+    crc.process_bytes(payload, h.length);
+    return crc.checksum();
+}
+
+/* larger records are taken to be corrupt */
+const uint32_t MAX_RECORD_SIZE = 16 * 1024 * 1024;
+
+/* compact once the records that are no longer needed take most of
+   the file */
+const size_t COMPACT_MIN_SIZE = 1024 * 1024;
+
+string errnoString() {
+    return std::strerror(errno);
+}
+
+void writeAll(int fd, const char* buf, size_t len, off_t offset) {
+    while (len > 0) {
+        ssize_t n = pwrite(fd, buf, len, offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw runtime_error("Could not write endpoint database: " +
+                                errnoString());
+        }
+        buf += n;
+        len -= n;
+        offset += n;
+    }
+}
+
+bool readAll(int fd, char* buf, size_t len, off_t offset) {
+    while (len > 0) {
+        ssize_t n = pread(fd, buf, len, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        buf += n;
+        len -= n;
+        offset += n;
+    }
+    return true;
+}
+
+} /* anonymous namespace */
+
+string EndpointDB::getSocketPath(const string& path) {
+    return path + ".sock";
+}
+
+EndpointDBWriter::EndpointDBWriter(const string& path_)
+    : path(path_), fd(-1), fileSize(0), liveSize(0) {
+    openFile();
+}
+
+EndpointDBWriter::~EndpointDBWriter() {
+    if (fd >= 0)
+        ::close(fd);
+}
+
+void EndpointDBWriter::openFile() {
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+        throw runtime_error("Could not open endpoint database " + path +
+                            ": " + errnoString());
+    struct stat st;
+    if (fstat(fd, &st) < 0)
+        throw runtime_error("Could not stat endpoint database " + path +
+                            ": " + errnoString());
+
+    index.clear();
+    liveSize = 0;
+    FileHeader fh;
+    if (st.st_size == 0) {
+        std::memcpy(fh.magic, MAGIC, sizeof(MAGIC));
+        fh.version = VERSION;
+        fh.reserved = 0;
+        writeAll(fd, reinterpret_cast<const char*>(&fh), sizeof(fh), 0);
+        fileSize = sizeof(fh);
+        return;
+    }
+    if (!readAll(fd, reinterpret_cast<char*>(&fh), sizeof(fh), 0) ||
+        std::memcmp(fh.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        fh.version != VERSION)
+        throw runtime_error(path + " is not an endpoint database");
+
+    // rebuild the index.  Only a torn write at the end, made by a
+    // writer that died, is dropped: a corrupt record followed by
+    // valid ones is skipped as the readers skip it
+    off_t offset = sizeof(fh);
+    off_t badStart = -1;
+    bool unreadable = false;
+    std::vector<char> payload;
+    while (true) {
+        RecordHeader h;
+        if (!readAll(fd, reinterpret_cast<char*>(&h), sizeof(h), offset))
+            break;
+        if (h.length > MAX_RECORD_SIZE) {
+            unreadable = true;
+            break;
+        }
+        off_t end = offset + sizeof(h) + h.length;
+        if (end > st.st_size)
+            break;
+        payload.resize(h.length);
+        if (!readAll(fd, payload.data(), h.length, offset + sizeof(h)))
+            break;
+        if (h.uuidLength > h.length ||
+            recordCrc(h, payload.data()) != h.crc) {
+            if (badStart < 0)
+                badStart = offset;
+            offset = end;
+            continue;
+        }
+        if (badStart >= 0) {
+            LOG(ERROR) << "Skipping corrupt records from offset " << badStart
+                       << " to " << offset << " of endpoint database "
+                       << path;
+            badStart = -1;
+        }
+        string uuid(payload.data(), h.uuidLength);
+        auto it = index.find(uuid);
+        if (it != index.end()) {
+            liveSize -= sizeof(h) + it->second.length;
+            index.erase(it);
+        }
+        if (h.op == EndpointDB::UPDATE) {
+            index[uuid] = Entry{offset, h.length};
+            liveSize += sizeof(h) + h.length;
+        }
+        offset = end;
+    }
+    // corrupt records with no valid record after them are the torn
+    // write
+    if (badStart >= 0)
+        offset = badStart;
+    if (unreadable) {
+        // the records after a corrupt length cannot be found, so keep
+        // a copy of the file and rewrite the records that were read
+        string corruptPath = path + ".corrupt";
+        LOG(ERROR) << "Corrupt record at offset " << offset
+                   << " of endpoint database " << path
+                   << "; saving a copy to " << corruptPath;
+        unlink(corruptPath.c_str());
+        if (link(path.c_str(), corruptPath.c_str()) < 0)
+            LOG(ERROR) << "Could not save " << corruptPath << ": "
+                       << errnoString();
+        fileSize = st.st_size;
+        compact();
+        return;
+    }
+    if (offset < st.st_size) {
+        LOG(WARNING) << "Discarding " << (st.st_size - offset)
+                     << " bytes of incomplete records at the end of "
+                     << path;
+        if (ftruncate(fd, offset) < 0)
+            throw runtime_error("Could not truncate endpoint database " +
+                                path + ": " + errnoString());
+    }
+    fileSize = offset;
+}
+
+void EndpointDBWriter::append(EndpointDB::Op op, const string& uuid,
+                              const string& json) {
+    RecordHeader h;
+    std::memset(&h, 0, sizeof(h));
+    h.length = uuid.size() + json.size();
+    h.op = op;
+    h.uuidLength = uuid.size();
+
+    // one write per record, so that a reader never sees a record
+    // with a header but without its payload for long
+    std::vector<char> buf(sizeof(h) + h.length);
+    std::memcpy(buf.data() + sizeof(h), uuid.data(), uuid.size());
+    std::memcpy(buf.data() + sizeof(h) + uuid.size(), json.data(),
+                json.size());
+    h.crc = recordCrc(h, buf.data() + sizeof(h));
+    std::memcpy(buf.data(), &h, sizeof(h));
+    writeAll(fd, buf.data(), buf.size(), fileSize);
+
+    auto it = index.find(uuid);
+    if (it != index.end()) {
+        liveSize -= sizeof(h) + it->second.length;
+        index.erase(it);
+    }
+    if (op == EndpointDB::UPDATE) {
+        index[uuid] = Entry{static_cast<off_t>(fileSize), h.length};
+        liveSize += buf.size();
+    }
+    fileSize += buf.size();
+
+    if (fileSize > COMPACT_MIN_SIZE && fileSize > 2 * liveSize)
+        compact();
+}
+
+void EndpointDBWriter::update(const string& uuid, const string& json) {
+    append(EndpointDB::UPDATE, uuid, json);
+}
+
+void EndpointDBWriter::remove(const string& uuid) {
+    if (index.find(uuid) == index.end())
+        return;
+    append(EndpointDB::REMOVE, uuid, "");
+}
+
+void EndpointDBWriter::compact() {
+    string tmpPath = path + ".tmp";
+    int tmp = ::open(tmpPath.c_str(),
+                     O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (tmp < 0)
+        throw runtime_error("Could not create " + tmpPath + ": " +
+                            errnoString());
+    try {
+        FileHeader fh;
+        std::memcpy(fh.magic, MAGIC, sizeof(MAGIC));
+        fh.version = VERSION;
+        fh.reserved = 0;
+        writeAll(tmp, reinterpret_cast<const char*>(&fh), sizeof(fh), 0);
+
+        off_t offset = sizeof(fh);
+        std::vector<char> buf;
+        for (auto& e : index) {
+            size_t size = sizeof(RecordHeader) + e.second.length;
+            buf.resize(size);
+            if (!readAll(fd, buf.data(), size, e.second.offset))
+                throw runtime_error("Could not read endpoint database " +
+                                    path);
+            writeAll(tmp, buf.data(), size, offset);
+            e.second.offset = offset;
+            offset += size;
+        }
+        if (fsync(tmp) < 0 || rename(tmpPath.c_str(), path.c_str()) < 0)
+            throw runtime_error("Could not replace endpoint database " +
+                                path + ": " + errnoString());
+        ::close(fd);
+        fd = tmp;
+        fileSize = offset;
+        liveSize = offset - sizeof(fh);
+    } catch (...) {
+        ::close(tmp);
+        unlink(tmpPath.c_str());
+        throw;
+    }
+}
+
+void EndpointDBWriter::notify() {
+    string sockPath = EndpointDB::getSocketPath(path);
+    struct sockaddr_un addr;
+    if (sockPath.size() >= sizeof(addr.sun_path))
+        return;
+    int s = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (s < 0)
+        return;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, sockPath.c_str(), sizeof(addr.sun_path) - 1);
+    // the reader may not be running; it reads everything when it starts
+    char c = 0;
+    (void)sendto(s, &c, 1, MSG_DONTWAIT,
+                 reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+    ::close(s);
+}
+
+EndpointDBReader::EndpointDBReader(const string& path_)
+    : path(path_), fd(-1), dev(0), ino(0), map(nullptr), mapSize(0),
+      offset(0), corrupt(0), lastCorrupt(0) {}
+
+EndpointDBReader::~EndpointDBReader() {
+    close();
+}
+
+void EndpointDBReader::close() {
+    if (map)
+        munmap(const_cast<char*>(map), mapSize);
+    map = nullptr;
+    mapSize = 0;
+    if (fd >= 0)
+        ::close(fd);
+    fd = -1;
+    offset = 0;
+}
+
+bool EndpointDBReader::read(const callback_t& cb) {
+    bool reset = false;
+    struct stat st;
+    if (stat(path.c_str(), &st) < 0) {
+        // the file is gone; keep reading the old one until a new one
+        // appears
+        if (fd < 0) return false;
+        if (fstat(fd, &st) < 0) return false;
+    } else if (fd < 0 || st.st_dev != dev || st.st_ino != ino) {
+        close();
+        fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            LOG(ERROR) << "Could not open endpoint database " << path
+                       << ": " << std::strerror(errno);
+            return false;
+        }
+        if (fstat(fd, &st) < 0) {
+            close();
+            return false;
+        }
+        dev = st.st_dev;
+        ino = st.st_ino;
+        reset = true;
+    }
+
+    size_t size = st.st_size;
+    if (size == 0)
+        return reset;
+    if (size < offset) {
+        // truncated in place
+        LOG(WARNING) << "Endpoint database " << path << " was truncated";
+        munmap(const_cast<char*>(map), mapSize);
+        map = nullptr;
+        mapSize = 0;
+        offset = 0;
+        reset = true;
+    }
+    if (size != mapSize) {
+        if (map)
+            munmap(const_cast<char*>(map), mapSize);
+        void* m = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (m == MAP_FAILED) {
+            LOG(ERROR) << "Could not map endpoint database " << path
+                       << ": " << std::strerror(errno);
+            map = nullptr;
+            mapSize = 0;
+            return reset;
+        }
+        map = static_cast<const char*>(m);
+        mapSize = size;
+    }
+
+    if (offset == 0) {
+        if (mapSize < sizeof(FileHeader))
+            return reset;
+        FileHeader fh;
+        std::memcpy(&fh, map, sizeof(fh));
+        if (std::memcmp(fh.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+            fh.version != VERSION) {
+            LOG(ERROR) << path << " is not an endpoint database";
+            return reset;
+        }
+        offset = sizeof(fh);
+    }
+
+    while (offset + sizeof(RecordHeader) <= mapSize) {
+        RecordHeader h;
+        std::memcpy(&h, map + offset, sizeof(h));
+        if (h.length > MAX_RECORD_SIZE) {
+            // the length cannot be trusted, so the records after this
+            // one cannot be found until the file is compacted
+            if (corrupt == 0 || lastCorrupt != offset) {
+                LOG(ERROR) << "Corrupt record at offset " << offset
+                           << " of endpoint database " << path;
+                corrupt += 1;
+                lastCorrupt = offset;
+            }
+            break;
+        }
+        size_t end = offset + sizeof(h) + h.length;
+        if (end > mapSize)
+            break;
+        const char* payload = map + offset + sizeof(h);
+        if (h.uuidLength > h.length || recordCrc(h, payload) != h.crc) {
+            // the last record may still be being written; a bad
+            // record followed by others is corrupt
+            if (end == mapSize)
+                break;
+            LOG(ERROR) << "Skipping corrupt record at offset " << offset
+                       << " of endpoint database " << path;
+            corrupt += 1;
+            offset = end;
+            continue;
+        }
+        offset = end;
+        if (h.op != EndpointDB::UPDATE && h.op != EndpointDB::REMOVE)
+            continue;
+        cb(static_cast<EndpointDB::Op>(h.op),
+           string(payload, h.uuidLength),
+           payload + h.uuidLength, h.length - h.uuidLength);
+    }
+    return reset;
+}
+
+} /* namespace opflexagent */
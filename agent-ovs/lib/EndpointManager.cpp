@@ -15,6 +15,8 @@
 
 #include <set>
 #include <algorithm>
+#include <sstream>
+#include <tuple>
 
 #include <opflex/modb/Mutator.h>
 #include <modelgbp/ascii/StringMatchTypeEnumT.hpp>
@@ -104,15 +106,25 @@ void EndpointManager::stop() {
     ext_ep_map.clear();
     group_ep_map.clear();
     group_remote_ep_map.clear();
-    remote_ep_group_map.clear();
+    remote_ep_state_map.clear();
+    rd_remote_ip_map.clear();
     remote_ep_uuid_map.clear();
     secgrp_ep_map.clear();
     ipm_group_ep_map.clear();
     ipm_nexthop_if_ep_map.clear();
     iface_ep_map.clear();
+    iface_mac_ep_map.clear();
+    vip_ep_map.clear();
+    ip_local_ep_map.clear();
     access_iface_ep_map.clear();
     access_uplink_ep_map.clear();
     epgmapping_ep_map.clear();
+    epg_mapping_cache.clear();
+    for (EndpointShard& shard : ep_shards) {
+        unique_lock<mutex> shard_guard(shard.mutex);
+        shard.local.clear();
+        shard.external.clear();
+    }
 }
 
 void EndpointManager::registerListener(EndpointListener* listener) {
@@ -132,10 +144,19 @@ void EndpointManager::notifyListeners(const string& uuid) {
     }
 }
 
-void EndpointManager::notifyRemoteListeners(const string& uuid) {
+void EndpointManager::notifyListeners(const unordered_set<string>& uuids) {
+    if (uuids.empty()) return;
+    unique_lock<mutex> guard(listener_mutex);
+    for (EndpointListener* listener : endpointListeners) {
+        listener->endpointsUpdated(uuids);
+    }
+}
+
+void EndpointManager::notifyRemoteListeners(const unordered_set<string>& uuids) {
+    if (uuids.empty()) return;
     unique_lock<mutex> guard(listener_mutex);
     for (EndpointListener* listener : endpointListeners) {
-        listener->remoteEndpointUpdated(uuid);
+        listener->remoteEndpointsUpdated(uuids);
     }
 }
 
@@ -167,38 +188,67 @@ Agent& EndpointManager::getAgent (void)
     return agent;
 }
 
+EndpointManager::EndpointShard&
+EndpointManager::getShard(const string& uuid) {
+    return ep_shards[std::hash<string>()(uuid) % EP_SHARDS];
+}
+
+void EndpointManager::publishEndpoint(const string& uuid,
+                                      const EndpointState* es,
+                                      bool external) {
+    EndpointShard& shard = getShard(uuid);
+    unique_lock<mutex> guard(shard.mutex);
+    ep_snapshot_map_t& snapshots = external ? shard.external : shard.local;
+    if (es) {
+        EndpointSnapshot& snapshot = snapshots[uuid];
+        snapshot.endpoint = es->endpoint;
+        snapshot.egURI = es->egURI;
+    } else {
+        snapshots.erase(uuid);
+    }
+}
+
 shared_ptr<const Endpoint> EndpointManager::getEndpoint(const string& uuid) {
-    unique_lock<mutex> guard(ep_mutex);
+    EndpointShard& shard = getShard(uuid);
+    unique_lock<mutex> guard(shard.mutex);
 
-    ep_map_t::const_iterator it = ep_map.find(uuid);
-    if (it != ep_map.end())
+    auto it = shard.local.find(uuid);
+    if (it != shard.local.end())
         return it->second.endpoint;
-    it = ext_ep_map.find(uuid);
-    if (it != ext_ep_map.end())
+    it = shard.external.find(uuid);
+    if (it != shard.external.end())
         return it->second.endpoint;
     return shared_ptr<const Endpoint>();
 }
 
 optional<URI> EndpointManager::getComputedEPG(const string& uuid) {
-    unique_lock<mutex> guard(ep_mutex);
-    ep_map_t::const_iterator it = ep_map.find(uuid);
-    if (it != ep_map.end())
+    EndpointShard& shard = getShard(uuid);
+    unique_lock<mutex> guard(shard.mutex);
+
+    auto it = shard.local.find(uuid);
+    if (it != shard.local.end())
         return it->second.egURI;
-    it = ext_ep_map.find(uuid);
-    if (it != ext_ep_map.end())
+    it = shard.external.find(uuid);
+    if (it != shard.external.end())
         return it->second.egURI;
     return boost::none;
 }
 
-static bool validateIp(const string& ip, bool allowLinkLocal = false) {
+static bool validateIp(const string& ip, address& addr,
+                       bool allowLinkLocal = false) {
     boost::system::error_code ec;
-    address addr = address::from_string(ip, ec);
+    addr = address::from_string(ip, ec);
     if (ec) return false;
     if (!allowLinkLocal && network::is_link_local(addr))
         return false;
     return true;
 }
 
+static bool validateIp(const string& ip, bool allowLinkLocal = false) {
+    address addr;
+    return validateIp(ip, addr, allowLinkLocal);
+}
+
 template <typename T>
 static void updateEpMap(const optional<string>& oldVal,
                         const optional<string>& val,
@@ -217,11 +267,69 @@ static void updateEpMap(const optional<string>& oldVal,
     }
 }
 
+template <typename M>
+static void eraseUuid(M& macs, const MAC& mac, const string& uuid) {
+    auto it = macs.find(mac);
+    if (it == macs.end()) return;
+    it->second.erase(uuid);
+    if (it->second.empty())
+        macs.erase(it);
+}
+
+void EndpointManager::updateMacIndexes(const string& uuid,
+                                       const Endpoint& oldEp,
+                                       const Endpoint* newEp) {
+    const optional<string>& oldIface = oldEp.getInterfaceName();
+    if (oldIface) {
+        auto it = iface_mac_ep_map.find(oldIface.get());
+        if (it != iface_mac_ep_map.end()) {
+            if (oldEp.getMAC())
+                eraseUuid(it->second, oldEp.getMAC().get(), uuid);
+            for (const Endpoint::virt_ip_t& vip : oldEp.getVirtualIPs())
+                eraseUuid(it->second, vip.first, uuid);
+            if (it->second.empty())
+                iface_mac_ep_map.erase(it);
+        }
+    }
+    for (const Endpoint::virt_ip_t& vip : oldEp.getVirtualIPs()) {
+        network::cidr_t cidr;
+        if (!network::cidr_from_string(vip.second, cidr)) continue;
+        mac_ep_map_t* macs = vip_ep_map.find(cidr.first, cidr.second);
+        if (!macs) continue;
+        eraseUuid(*macs, vip.first, uuid);
+        if (macs->empty())
+            vip_ep_map.erase(cidr.first, cidr.second);
+    }
+
+    if (!newEp) return;
+
+    const optional<string>& iface = newEp->getInterfaceName();
+    if (iface) {
+        mac_ep_map_t& macs = iface_mac_ep_map[iface.get()];
+        if (newEp->getMAC())
+            macs[newEp->getMAC().get()].insert(uuid);
+        for (const Endpoint::virt_ip_t& vip : newEp->getVirtualIPs())
+            macs[vip.first].insert(uuid);
+        if (macs.empty())
+            iface_mac_ep_map.erase(iface.get());
+    }
+    for (const Endpoint::virt_ip_t& vip : newEp->getVirtualIPs()) {
+        network::cidr_t cidr;
+        if (!network::cidr_from_string(vip.second, cidr)) continue;
+        vip_ep_map.insert(cidr.first, cidr.second)[vip.first].insert(uuid);
+    }
+}
+
 void EndpointManager::updateEndpoint(const Endpoint& endpoint) {
     using namespace modelgbp::gbp;
     using namespace modelgbp::gbpe;
     using namespace modelgbp::epdr;
 
+    // start resolving the policy of a new group before the local
+    // endpoint objects reference it
+    if (endpoint.getEgURI())
+        policyManager.prefetchGroup(endpoint.getEgURI().get());
+
     unique_lock<mutex> guard(ep_mutex);
     const string& uuid = endpoint.getUUID();
     EndpointState& es = ep_map[uuid];
@@ -231,9 +339,10 @@ void EndpointManager::updateEndpoint(const Endpoint& endpoint) {
     // Refresh IP to EP map for this endpoint, to track delete/update
     // of this IP list
     for (const string& ip : es.endpoint->getIPs()) {
-        if (!validateIp(ip))
+        address addr;
+        if (!validateIp(ip, addr))
             continue;
-        ip_local_ep_map.erase(ip);
+        ip_local_ep_map.erase(addr, 128);
     }
 
 
@@ -261,6 +370,7 @@ void EndpointManager::updateEndpoint(const Endpoint& endpoint) {
     const optional<string>& oldIface = es.endpoint->getInterfaceName();
     const optional<string>& iface = endpoint.getInterfaceName();
     updateEpMap(oldIface, iface, iface_ep_map, uuid);
+    updateMacIndexes(uuid, *es.endpoint, &endpoint);
 
     // update access interface name to endpoint mapping
     const optional<string>& oldAccess = es.endpoint->getAccessInterface();
@@ -294,7 +404,9 @@ void EndpointManager::updateEndpoint(const Endpoint& endpoint) {
     const optional<string>& epgmap = endpoint.getEgMappingAlias();
     updateEpMap(oldEpgmap, epgmap, epgmapping_ep_map, uuid);
 
-    es.endpoint = make_shared<const Endpoint>(endpoint);
+    shared_ptr<Endpoint> ep = make_shared<Endpoint>(endpoint);
+    ep->intern();
+    es.endpoint = ep;
     optional<EndpointListener::uri_set_t &> extDomSets(notifyExtDomSets);
     updateEndpointLocal(uuid, extDomSets);
     guard.unlock();
@@ -334,9 +446,10 @@ void EndpointManager::removeEndpoint(const string& uuid) {
             LocalL3Ep::remove(framework, locall3ep);
         }
         for (const string& ip : es.endpoint->getIPs()) {
-            if (!validateIp(ip))
+            address addr;
+            if (!validateIp(ip, addr))
                 continue;
-            ip_local_ep_map.erase(ip);
+            ip_local_ep_map.erase(addr, 128);
         }
         for (const URI& l2ep : es.l2EPs) {
             // The contained objects dont get deleted during make check tests.
@@ -410,6 +523,7 @@ void EndpointManager::removeEndpoint(const string& uuid) {
 
         updateEpMap(es.endpoint->getInterfaceName(), boost::none,
                     iface_ep_map, uuid);
+        updateMacIndexes(uuid, *es.endpoint, NULL);
         updateEpMap(es.endpoint->getAccessInterface(), boost::none,
                     access_iface_ep_map, uuid);
         updateEpMap(es.endpoint->getAccessUplinkInterface(), boost::none,
@@ -429,6 +543,7 @@ void EndpointManager::removeEndpoint(const string& uuid) {
                     epgmapping_ep_map, uuid);
 
         ep_map.erase(it);
+        publishEndpoint(uuid, NULL, false);
     }
     mutator.commit();
     guard.unlock();
@@ -441,133 +556,265 @@ void EndpointManager::removeEndpoint(const string& uuid) {
     }
 }
 
-optional<URI> EndpointManager::resolveEpgMapping(EndpointState& es) {
+bool EndpointManager::CompiledEpgMapping::Rule::
+matches(const string& value) const {
+    using namespace modelgbp::ascii;
+    bool m;
+    switch (matchType) {
+    case StringMatchTypeEnumT::CONST_CONTAINS:
+        m = contains(value, matchString);
+        break;
+    case StringMatchTypeEnumT::CONST_STARTSWITH:
+        m = starts_with(value, matchString);
+        break;
+    case StringMatchTypeEnumT::CONST_ENDSWITH:
+        m = ends_with(value, matchString);
+        break;
+    case StringMatchTypeEnumT::CONST_EQUALS:
+        m = (value == matchString);
+        break;
+    default:
+        // unknown match always fails
+        m = negated;
+        break;
+    }
+    return m != negated;
+}
+
+shared_ptr<const EndpointManager::CompiledEpgMapping>
+EndpointManager::getEpgMapping(const string& name) {
     using namespace modelgbp::gbpe;
     using namespace modelgbp::ascii;
+
+    auto cit = epg_mapping_cache.find(name);
+    if (cit != epg_mapping_cache.end())
+        return cit->second;
+
+    shared_ptr<CompiledEpgMapping> compiled;
+    optional<shared_ptr<EpgMapping> > mapping =
+        EpgMapping::resolve(framework, name);
+    if (mapping) {
+        compiled = make_shared<CompiledEpgMapping>();
+
+        vector<shared_ptr<AttributeMappingRule> > rules;
+        mapping.get()->resolveGbpeAttributeMappingRule(rules);
+
+        OrderComparator<shared_ptr<AttributeMappingRule> > ruleComp;
+        stable_sort(rules.begin(), rules.end(), ruleComp);
+
+        for (shared_ptr<AttributeMappingRule>& rule : rules) {
+            optional<const string&> attrName = rule->getAttributeName();
+            optional<const string&> matchString = rule->getMatchString();
+            if (!attrName || !matchString) continue;
+
+            CompiledEpgMapping::Rule r;
+            r.attrName = attrName.get();
+            r.matchString = matchString.get();
+            r.matchType =
+                rule->getMatchType(StringMatchTypeEnumT::CONST_EQUALS);
+            r.negated = 0 != rule->getNegated(0);
+            optional<shared_ptr<MappingRuleToGroupRSrc> > egSrc =
+                rule->resolveGbpeMappingRuleToGroupRSrc();
+            if (egSrc && egSrc.get()->isTargetSet())
+                r.egURI = egSrc.get()->getTargetURI().get();
+            compiled->attrNames.insert(r.attrName);
+            compiled->rules.push_back(std::move(r));
+        }
+
+        optional<shared_ptr<EpgMappingToDefaultGroupRSrc> > egSrc =
+            mapping.get()->resolveGbpeEpgMappingToDefaultGroupRSrc();
+        if (egSrc && egSrc.get()->isTargetSet())
+            compiled->defaultEgURI = egSrc.get()->getTargetURI().get();
+    }
+    epg_mapping_cache[name] = compiled;
+    return compiled;
+}
+
+optional<URI> EndpointManager::resolveEpgMapping(EndpointState& es) {
     if(es.endpoint->isExternal()) {
         return boost::none;
     }
     const optional<string>& mappingAlias = es.endpoint->getEgMappingAlias();
     if (!mappingAlias) return boost::none;
-    optional<shared_ptr<EpgMapping> > mapping =
-        EpgMapping::resolve(framework, mappingAlias.get());
+    shared_ptr<const CompiledEpgMapping> mapping =
+        getEpgMapping(mappingAlias.get());
     if (!mapping) return boost::none;
 
-    vector<shared_ptr<AttributeMappingRule> > rules;
-    mapping.get()->resolveGbpeAttributeMappingRule(rules);
-
-    OrderComparator<shared_ptr<AttributeMappingRule> > ruleComp;
-    stable_sort(rules.begin(), rules.end(), ruleComp);
-
-    for (shared_ptr<AttributeMappingRule>& rule : rules) {
-        optional<const string&> attrName = rule->getAttributeName();
-        optional<const string&> matchString = rule->getMatchString();
-        if (!attrName || !matchString) continue;
-        uint8_t type = rule->getMatchType(StringMatchTypeEnumT::CONST_EQUALS);
-        bool negated = 0 != rule->getNegated(0);
-
+    static const string empty;
+    const Endpoint::attr_map_t& attrs = es.endpoint->getAttributes();
+    for (const CompiledEpgMapping::Rule& rule : mapping->rules) {
         // Get value of attribute from endpoint index
-        string attrValue;
-        auto it = es.endpoint->getAttributes().find(attrName.get());
-        if (it != es.endpoint->getAttributes().end())
-            attrValue = it->second;
+        const string* attrValue = &empty;
+        auto it = attrs.find(rule.attrName);
+        if (it != attrs.end())
+            attrValue = &it->second;
         else {
-            it = es.epAttrs.find(attrName.get());
+            it = es.epAttrs.find(rule.attrName);
             if (it != es.epAttrs.end())
-                attrValue = it->second;
-        }
-
-        // apply the match
-        bool matches;
-        switch (type) {
-        case StringMatchTypeEnumT::CONST_CONTAINS:
-            matches = contains(attrValue, matchString.get());
-            break;
-        case StringMatchTypeEnumT::CONST_STARTSWITH:
-            matches = starts_with(attrValue, matchString.get());
-            break;
-        case StringMatchTypeEnumT::CONST_ENDSWITH:
-            matches = ends_with(attrValue, matchString.get());
-            break;
-        case StringMatchTypeEnumT::CONST_EQUALS:
-            matches = (attrValue == matchString.get());
-            break;
-        default:
-            // unknown match always fails
-            matches = negated;
-            break;
+                attrValue = &it->second;
         }
-        matches = (matches != negated);
 
-        if (matches) {
-            optional<shared_ptr<MappingRuleToGroupRSrc> > egSrc =
-                rule->resolveGbpeMappingRuleToGroupRSrc();
-            if (egSrc && egSrc.get()->isTargetSet())
-                return egSrc.get()->getTargetURI().get();
-        }
+        if (rule.matches(*attrValue) && rule.egURI)
+            return rule.egURI;
     }
 
     // No matching rule, use default mapping
-    optional<shared_ptr<EpgMappingToDefaultGroupRSrc> > egSrc =
-        mapping.get()->resolveGbpeEpgMappingToDefaultGroupRSrc();
-    if (egSrc && egSrc.get()->isTargetSet())
-        return egSrc.get()->getTargetURI().get();
+    return mapping->defaultEgURI;
+}
 
-    return boost::none;
+void EndpointManager::readRemoteEp(modelgbp::inv::RemoteInventoryEp& ep,
+                                   RemoteEpState& state) {
+    std::ostringstream sig;
+    if (ep.isMacSet())
+        sig << "m" << ep.getMac().get();
+    if (ep.isProxyMacSet())
+        sig << "p" << ep.getProxyMac().get();
+    if (ep.isNextHopTunnelSet())
+        sig << "t" << ep.getNextHopTunnel().get();
+    sig << "b" << ep.getAddBounce(false);
+
+    auto epg = ep.resolveInvRemoteInventoryEpToGroupRSrc();
+    if (epg)
+        state.egURI = epg.get()->getTargetURI();
+    if (state.egURI)
+        sig << "g" << state.egURI.get();
+
+    vector<shared_ptr<modelgbp::inv::NextHopLink>> tnls;
+    ep.resolveInvNextHopLink(tnls);
+    for (const auto& tnl : tnls) {
+        if (tnl->isIpSet())
+            sig << "l" << tnl->getIp().get();
+    }
+
+    vector<shared_ptr<modelgbp::inv::RemoteIp>> invIps;
+    ep.resolveInvRemoteIp(invIps);
+    for (const auto& invIp : invIps) {
+        if (!invIp->isIpSet()) continue;
+        sig << "i" << invIp->getIp().get() << "/"
+            << (int)invIp->getPrefixLen(0);
+
+        boost::system::error_code ec;
+        address addr = address::from_string(invIp->getIp().get(), ec);
+        if (ec) continue;
+        uint8_t prefixLen = addr.is_v4() ? 32 : 128;
+        if (invIp->isPrefixLenSet())
+            prefixLen = std::min(prefixLen, invIp->getPrefixLen().get());
+        state.ips.emplace_back(addr, prefixLen);
+    }
+    state.signature = sig.str();
 }
 
-void EndpointManager::updateEndpointRemote(const URI& uri) {
-    LOG(DEBUG) << "Remote endpoint updated " << uri;
-    auto ep = modelgbp::inv::RemoteInventoryEp::resolve(framework, uri);
+void EndpointManager::indexRemoteIps(const string& uuid,
+                                     const RemoteEpState& state) {
+    if (!state.rdURI || state.ips.empty()) return;
+    PrefixTrie<string>& ips = rd_remote_ip_map[state.rdURI.get()];
+    for (const auto& ip : state.ips)
+        ips.insert(ip.first, ip.second) = uuid;
+}
 
-    optional<string> uuid;
+void EndpointManager::unindexRemoteIps(const string& uuid,
+                                       const RemoteEpState& state) {
+    if (!state.rdURI) return;
+    auto it = rd_remote_ip_map.find(state.rdURI.get());
+    if (it == rd_remote_ip_map.end()) return;
+    for (const auto& ip : state.ips) {
+        // another endpoint may have claimed the prefix since
+        string* owner = it->second.find(ip.first, ip.second);
+        if (owner && *owner == uuid)
+            it->second.erase(ip.first, ip.second);
+    }
+    if (it->second.empty())
+        rd_remote_ip_map.erase(it);
+}
 
+void EndpointManager::updateEndpointsRemote(const unordered_set<URI>& uris) {
+    // Read the inventory before taking the endpoint lock
+    vector<std::tuple<URI, optional<string>, RemoteEpState>> eps;
+    eps.reserve(uris.size());
+    for (const URI& uri : uris) {
+        LOG(DEBUG) << "Remote endpoint updated " << uri;
+        auto ep = modelgbp::inv::RemoteInventoryEp::resolve(framework, uri);
+        RemoteEpState state;
+        optional<string> uuid;
+        if (ep && ep.get()->isUuidSet()) {
+            uuid = ep.get()->getUuid().get();
+            readRemoteEp(*ep.get(), state);
+            if (state.egURI) {
+                auto rd = policyManager.getRDForGroup(state.egURI.get());
+                if (rd)
+                    state.rdURI = rd.get()->getURI();
+            }
+        }
+        eps.emplace_back(uri, std::move(uuid), std::move(state));
+    }
+
+    unordered_set<string> notify;
     unique_lock<mutex> guard(ep_mutex);
-    if (!ep || !ep.get()->isUuidSet()) {
+    for (auto& e : eps) {
+        const URI& uri = std::get<0>(e);
+        const optional<string>& uuid = std::get<1>(e);
+        RemoteEpState& state = std::get<2>(e);
+
         auto it = remote_ep_uuid_map.find(uri);
-        if (it != remote_ep_uuid_map.end()) {
-            // removed endpoint
-            uuid = it->second;
-            auto git = remote_ep_group_map.find(uuid.get());
-            if (git != remote_ep_group_map.end()) {
-                group_remote_ep_map.erase(git->second);
-                remote_ep_group_map.erase(git);
+        if (it != remote_ep_uuid_map.end() &&
+            (!uuid || it->second != uuid.get())) {
+            // removed endpoint, or one whose UUID changed
+            const string& oldUuid = it->second;
+            auto sit = remote_ep_state_map.find(oldUuid);
+            if (sit != remote_ep_state_map.end()) {
+                if (sit->second.egURI) {
+                    auto git = group_remote_ep_map.find(sit->second.egURI.get());
+                    if (git != group_remote_ep_map.end()) {
+                        git->second.erase(oldUuid);
+                        if (git->second.empty())
+                            group_remote_ep_map.erase(git);
+                    }
+                }
+                unindexRemoteIps(oldUuid, sit->second);
+                remote_ep_state_map.erase(sit);
             }
+            notify.insert(oldUuid);
             remote_ep_uuid_map.erase(it);
         }
-    } else {
+        if (!uuid) continue;
+
         // added or updated endpoint
-        uuid = ep.get()->getUuid().get();
         remote_ep_uuid_map.emplace(uri, uuid.get());
+        RemoteEpState& cur = remote_ep_state_map[uuid.get()];
+        bool isNew = cur.signature.empty();
+        if (!isNew && cur.signature == state.signature &&
+            cur.rdURI == state.rdURI)
+            continue;
 
-        optional<URI> egUri, oldEgUri;
-        auto epg = ep.get()->resolveInvRemoteInventoryEpToGroupRSrc();
-        if (epg)
-            egUri = epg.get()->getTargetURI();
-
-        auto uit = remote_ep_group_map.find(uuid.get());
-        if (uit != remote_ep_group_map.end())
-            oldEgUri = uit->second;
-
-        if (oldEgUri != egUri) {
-            if (oldEgUri) {
-                unordered_set<string>& eps =
-                    group_remote_ep_map[oldEgUri.get()];
-                eps.erase(uuid.get());
-                if (eps.empty())
-                    group_remote_ep_map.erase(oldEgUri.get());
-            }
-            if (egUri) {
-                group_remote_ep_map[egUri.get()].insert(uuid.get());
-                remote_ep_group_map.emplace(uuid.get(), egUri.get());
-            } else {
-                remote_ep_group_map.erase(uuid.get());
+        if (cur.egURI != state.egURI) {
+            if (cur.egURI) {
+                unordered_set<string>& geps = group_remote_ep_map[cur.egURI.get()];
+                geps.erase(uuid.get());
+                if (geps.empty())
+                    group_remote_ep_map.erase(cur.egURI.get());
             }
+            if (state.egURI)
+                group_remote_ep_map[state.egURI.get()].insert(uuid.get());
         }
+        unindexRemoteIps(uuid.get(), cur);
+        indexRemoteIps(uuid.get(), state);
+        cur = std::move(state);
+        notify.insert(uuid.get());
     }
     guard.unlock();
-    if (uuid)
-        notifyRemoteListeners(uuid.get());
+    notifyRemoteListeners(notify);
+}
+
+optional<string>
+EndpointManager::findRemoteEndpoint(const URI& rdURI, const address& addr) {
+    unique_lock<mutex> guard(ep_mutex);
+    auto it = rd_remote_ip_map.find(rdURI);
+    if (it == rd_remote_ip_map.end())
+        return boost::none;
+    string* uuid = it->second.longestMatch(addr, addr.is_v4() ? 32 : 128);
+    if (!uuid)
+        return boost::none;
+    return *uuid;
 }
 
 void EndpointManager::updateEndpointExternal(const Endpoint& endpoint) {
@@ -622,6 +869,7 @@ void EndpointManager::updateEndpointExternal(const Endpoint& endpoint) {
     const optional<string>& oldIface = es.endpoint->getInterfaceName();
     const optional<string>& iface = endpoint.getInterfaceName();
     updateEpMap(oldIface, iface, iface_ep_map, uuid);
+    updateMacIndexes(uuid, *es.endpoint, &endpoint);
 
     // update access interface name to endpoint mapping
     const optional<string>& oldAccess = es.endpoint->getAccessInterface();
@@ -638,6 +886,7 @@ void EndpointManager::updateEndpointExternal(const Endpoint& endpoint) {
     // External EP
 
     shared_ptr<Endpoint> ep = make_shared<Endpoint>(endpoint);
+    ep->intern();
     // Update ExternalEndpoint object in the MODB, which will trigger
     // resolution of the external interface and external domain, if
     // needed.
@@ -650,7 +899,8 @@ void EndpointManager::updateEndpointExternal(const Endpoint& endpoint) {
         /*There should be a single IP for an external endpoint*/
         for (const string& ip : ep->getIPs()) {
             if (!validateIp(ip)) {
-                LOG(ERROR) << "Invalid address: " << ip;
+                LOG_RATE_LIMITED_DEFAULT(ERROR)
+                    << "Invalid address: " << ip;
                 continue;
             }
             extL3Ep->setIp(ip);
@@ -697,6 +947,7 @@ void EndpointManager::updateEndpointExternal(const Endpoint& endpoint) {
         }
     }
     es.endpoint = ep;
+    publishEndpoint(uuid, &es, true);
     mutator.commit();
     guard.unlock();
     notifyExternalEndpointListeners(uuid);
@@ -762,12 +1013,14 @@ void EndpointManager::removeEndpointExternal(const string& uuid) {
         }
         updateEpMap(es.endpoint->getInterfaceName(), boost::none,
                     iface_ep_map, uuid);
+        updateMacIndexes(uuid, *es.endpoint, NULL);
         updateEpMap(es.endpoint->getAccessInterface(), boost::none,
                     access_iface_ep_map, uuid);
         updateEpMap(es.endpoint->getAccessUplinkInterface(), boost::none,
                     access_uplink_ep_map, uuid);
 
         ext_ep_map.erase(it);
+        publishEndpoint(uuid, NULL, true);
     }
     mutator.commit();
     guard.unlock();
@@ -830,6 +1083,7 @@ bool EndpointManager::updateEndpointLocal(const string& uuid,
         es.egURI = egURI;
         updated = true;
     }
+    publishEndpoint(uuid, &es, false);
 
     unordered_set<URI> newlocall3eps;
     unordered_set<URI> newlocall2eps;
@@ -944,9 +1198,10 @@ bool EndpointManager::updateEndpointLocal(const string& uuid,
     }
 
     for (const string& ip : es.endpoint->getIPs()) {
-        if (!validateIp(ip))
+        address addr;
+        if (!validateIp(ip, addr))
             continue;
-        ip_local_ep_map[ip] = es.endpoint;
+        ip_local_ep_map.insert(addr, 128) = es.endpoint;
     }
 
     // remove any stale local EPs
@@ -1219,6 +1474,10 @@ bool EndpointManager::updateEndpointReg(const string& uuid) {
 void EndpointManager::egDomainUpdated(const URI& egURI) {
     unordered_set<string> notify;
     unordered_set<string> remoteNotify;
+    optional<URI> rdURI;
+    auto rd = policyManager.getRDForGroup(egURI);
+    if (rd)
+        rdURI = rd.get()->getURI();
     unique_lock<mutex> guard(ep_mutex);
 
     group_ep_map_t::const_iterator it = group_ep_map.find(egURI);
@@ -1233,6 +1492,14 @@ void EndpointManager::egDomainUpdated(const URI& egURI) {
     if (rit != group_remote_ep_map.end()) {
         for (const string& uuid : rit->second) {
             remoteNotify.insert(uuid);
+            // the group may have moved to another routing domain
+            auto sit = remote_ep_state_map.find(uuid);
+            if (sit != remote_ep_state_map.end() &&
+                sit->second.rdURI != rdURI) {
+                unindexRemoteIps(uuid, sit->second);
+                sit->second.rdURI = rdURI;
+                indexRemoteIps(uuid, sit->second);
+            }
         }
     }
 
@@ -1245,12 +1512,8 @@ void EndpointManager::egDomainUpdated(const URI& egURI) {
     }
     guard.unlock();
 
-    for (const string& uuid : notify) {
-        notifyListeners(uuid);
-    }
-    for (const string& uuid : remoteNotify) {
-        notifyRemoteListeners(uuid);
-    }
+    notifyListeners(notify);
+    notifyRemoteListeners(remoteNotify);
 }
 
 void EndpointManager::externalInterfaceUpdated(const URI& extIntURI) {
@@ -1346,11 +1609,33 @@ void EndpointManager::getEndpointsByIface(const string& ifaceName,
     getEps(ifaceName, iface_ep_map, eps);
 }
 
+void EndpointManager::getEndpointsByIfaceMac(const string& ifaceName,
+                                             const MAC& mac,
+                                             /* out */ str_uset_t& eps) {
+    unique_lock<mutex> guard(ep_mutex);
+    auto it = iface_mac_ep_map.find(ifaceName);
+    if (it != iface_mac_ep_map.end())
+        getEps(mac, it->second, eps);
+}
+
+void EndpointManager::getEndpointsByVirtualIp(const MAC& mac,
+                                              const address& ip,
+                                              /* out */ str_uset_t& eps) {
+    unique_lock<mutex> guard(ep_mutex);
+    vip_ep_map.visitMatches(ip, [&mac, &eps](uint8_t, mac_ep_map_t& macs) {
+            getEps(mac, macs, eps);
+        });
+}
+
 shared_ptr<const Endpoint> EndpointManager::getEpFromLocalMap (const string& ip) {
+    boost::system::error_code ec;
+    address addr = address::from_string(ip, ec);
+    if (ec) return nullptr;
+
     unique_lock<mutex> guard(ep_mutex);
-    const auto& itr = ip_local_ep_map.find(ip);
-    if (itr != ip_local_ep_map.end()) {
-        return itr->second;
+    const shared_ptr<const Endpoint>* ep = ip_local_ep_map.find(addr, 128);
+    if (ep) {
+        return *ep;
     }
     return nullptr;
 }
@@ -1437,7 +1722,8 @@ void EndpointManager::updateEndpointCounters(const string& uuid,
                                                   es.endpoint->getAttributes(),
                                                   newVals);
         else
-            LOG(ERROR) << "ep name not found for uuid:" << uuid;
+            LOG_RATE_LIMITED_DEFAULT(ERROR)
+                << "ep name not found for uuid:" << uuid;
     }
 }
 
@@ -1446,75 +1732,128 @@ EndpointManager::EPGMappingListener::EPGMappingListener(EndpointManager& epmgr_)
 
 EndpointManager::EPGMappingListener::~EPGMappingListener() {}
 
-void EndpointManager::EPGMappingListener::objectUpdated(class_id_t classId,
-                                                        const URI& uri) {
+void EndpointManager::EPGMappingListener::
+updateAttributeSet(const URI& uri, /* out */ unordered_set<string>& notify) {
     using namespace modelgbp::gbpe;
 
-    if (classId == EpAttributeSet::CLASS_ID) {
-        unique_lock<mutex> guard(epmanager.ep_mutex);
-        optional<shared_ptr<EpAttributeSet> > attrSet =
-            EpAttributeSet::resolve(epmanager.framework, uri);
-        if (!attrSet) return;
+    optional<shared_ptr<EpAttributeSet> > attrSet =
+        EpAttributeSet::resolve(epmanager.framework, uri);
+    if (!attrSet) return;
 
-        optional<const string&> uuid = attrSet.get()->getUuid();
-        if (!uuid) return;
+    optional<const string&> uuid = attrSet.get()->getUuid();
+    if (!uuid) return;
 
-        auto it = epmanager.ep_map.find(uuid.get());
-        if (it == epmanager.ep_map.end()) return;
+    auto it = epmanager.ep_map.find(uuid.get());
+    if (it == epmanager.ep_map.end()) return;
 
-        EndpointState& es = it->second;
-        es.epAttrs.clear();
-
-        vector<shared_ptr<EpAttribute> > attrs;
-        attrSet.get()->resolveGbpeEpAttribute(attrs);
-        for (shared_ptr<EpAttribute>& attr : attrs) {
-            optional<const string&> name = attr->getName();
-            optional<const string&> value = attr->getValue();
-
-            if (!name) continue;
-            if (value)
-                es.epAttrs[name.get()] = value.get();
-            else
-                es.epAttrs[name.get()] = "";
-        }
+    EndpointState& es = it->second;
+    Endpoint::attr_map_t epAttrs;
+
+    vector<shared_ptr<EpAttribute> > attrs;
+    attrSet.get()->resolveGbpeEpAttribute(attrs);
+    for (shared_ptr<EpAttribute>& attr : attrs) {
+        optional<const string&> name = attr->getName();
+        optional<const string&> value = attr->getValue();
 
-        if (epmanager.updateEndpointLocal(uuid.get())) {
-            guard.unlock();
-            epmanager.notifyListeners(uuid.get());
+        if (!name) continue;
+        if (value)
+            epAttrs[name.get()] = value.get();
+        else
+            epAttrs[name.get()] = "";
+    }
+    if (epAttrs == es.epAttrs) return;
+
+    // The attributes only matter to the epg mapping, and only the
+    // ones its rules read that the endpoint does not override
+    bool relevant = false;
+    const optional<string>& alias = es.endpoint->getEgMappingAlias();
+    if (alias && !es.endpoint->getEgURI()) {
+        auto mapping = epmanager.getEpgMapping(alias.get());
+        if (mapping) {
+            const Endpoint::attr_map_t& epOwn = es.endpoint->getAttributes();
+            for (const string& name : mapping->attrNames) {
+                if (epOwn.count(name)) continue;
+                auto oit = es.epAttrs.find(name);
+                auto nit = epAttrs.find(name);
+                bool oldSet = oit != es.epAttrs.end();
+                bool newSet = nit != epAttrs.end();
+                if (oldSet != newSet ||
+                    (oldSet && oit->second != nit->second)) {
+                    relevant = true;
+                    break;
+                }
+            }
         }
-    } else if (classId == EpgMapping::CLASS_ID) {
-        unique_lock<mutex> guard(epmanager.ep_mutex);
-        optional<shared_ptr<EpgMapping> > epgMapping =
-            EpgMapping::resolve(epmanager.framework, uri);
-        if (!epgMapping) return;
+    }
+    es.epAttrs.swap(epAttrs);
 
-        optional<const string&> name = epgMapping.get()->getName();
-        if (!name) return;
+    if (relevant && epmanager.updateEndpointLocal(uuid.get()))
+        notify.insert(uuid.get());
+}
 
-        auto it = epmanager.epgmapping_ep_map.find(name.get());
-        if (it == epmanager.epgmapping_ep_map.end()) return;
+void EndpointManager::EPGMappingListener::
+updateEpgMapping(const URI& uri, /* out */ unordered_set<string>& notify) {
+    using namespace modelgbp::gbpe;
 
-        unordered_set<string> notify;
-        for (const string& uuid : it->second) {
-            if (epmanager.updateEndpointLocal(uuid)) {
-                notify.insert(uuid);
-            }
+    // The name is the last element of the URI, so that a removed
+    // mapping can be found as well
+    vector<string> elements;
+    uri.getElements(elements);
+    if (elements.empty()) return;
+    const string& name = elements.back();
+
+    // the mapping or one of its rules changed
+    epmanager.epg_mapping_cache.erase(name);
+
+    auto it = epmanager.epgmapping_ep_map.find(name);
+    if (it == epmanager.epgmapping_ep_map.end()) return;
+
+    for (const string& uuid : it->second) {
+        if (epmanager.updateEndpointLocal(uuid)) {
+            notify.insert(uuid);
         }
+    }
+}
+
+void EndpointManager::EPGMappingListener::objectUpdated(class_id_t classId,
+                                                        const URI& uri) {
+    objectsUpdated(update_list_t(1, std::make_pair(classId, uri)));
+}
 
-        guard.unlock();
-        for (const string& uuid : notify) {
-            epmanager.notifyListeners(uuid);
+void EndpointManager::EPGMappingListener::
+objectsUpdated(const update_list_t& updates) {
+    using namespace modelgbp::gbpe;
+
+    // Attribute and mapping changes only touch local endpoint state,
+    // so process all of them under a single lock
+    unordered_set<string> notify;
+    {
+        unique_lock<mutex> guard(epmanager.ep_mutex);
+        for (const update_list_t::value_type& u : updates) {
+            if (u.first == EpAttributeSet::CLASS_ID)
+                updateAttributeSet(u.second, notify);
+            else if (u.first == EpgMapping::CLASS_ID)
+                updateEpgMapping(u.second, notify);
         }
-    } else if (classId == modelgbp::inv::RemoteInventoryEp::CLASS_ID) {
-        epmanager.updateEndpointRemote(uri);
-    } else if (classId == modelgbp::inv::RemoteIp::CLASS_ID) {
-        boost::filesystem::path puri(uri.toString());
-        puri = puri.parent_path()
-                   .parent_path()
-                   .parent_path();
-        URI curi(puri.string() + "/");
-        epmanager.updateEndpointRemote(curi);
-   }
+    }
+    epmanager.notifyListeners(notify);
+
+    // A remote inventory update often touches an endpoint and all of
+    // its IPs, so collect the endpoints and process each once
+    unordered_set<URI> remotes;
+    for (const update_list_t::value_type& u : updates) {
+        if (u.first == modelgbp::inv::RemoteInventoryEp::CLASS_ID) {
+            remotes.insert(u.second);
+        } else if (u.first == modelgbp::inv::RemoteIp::CLASS_ID) {
+            boost::filesystem::path puri(u.second.toString());
+            puri = puri.parent_path()
+                       .parent_path()
+                       .parent_path();
+            remotes.emplace(puri.string() + "/");
+        }
+    }
+    if (!remotes.empty())
+        epmanager.updateEndpointsRemote(remotes);
 }
 
 void EndpointManager::configUpdated(const URI& uri) {
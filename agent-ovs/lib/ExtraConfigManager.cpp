@@ -105,6 +105,10 @@ void ExtraConfigManager::notifyPacketDropPruneConfigListeners(const std::string
 void ExtraConfigManager::packetDropLogConfigUpdated(PacketDropLogConfig &dropCfg) {
     using modelgbp::observer::DropLogConfig;
 
+    unique_lock<mutex> guard(prune_mutex);
+    dropLogSampling = dropCfg.sampling;
+    guard.unlock();
+
     Mutator mutator(framework, "policyelement");
     optional<shared_ptr<modelgbp::policy::Universe>> polUni =
             modelgbp::policy::Universe::resolve(framework);
@@ -261,4 +265,9 @@ bool ExtraConfigManager::getPacketDropPruneSpec(const std::string &pruneFilter,
     return ret;
 }
 
+PacketDropLogSampling ExtraConfigManager::getPacketDropLogSampling() {
+    unique_lock<mutex> guard(prune_mutex);
+    return dropLogSampling;
+}
+
 } /* namespace opflexagent */
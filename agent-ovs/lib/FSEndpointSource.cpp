@@ -18,11 +18,14 @@
 
 #include <stdexcept>
 #include <sstream>
+#include <fstream>
+#include <functional>
 
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <opflex/modb/URIBuilder.h>
+#include <opflex/modb/TraceContext.h>
 
 #include <opflexagent/FSEndpointSource.h>
 #include <opflexagent/Agent.h>
@@ -54,9 +57,10 @@ static bool isep(fs::path filePath) {
             !boost::algorithm::starts_with(fstr, "."));
 }
 
-void FSEndpointSource::updated(const fs::path& filePath) {
-    if (!isep(filePath)) return;
-
+bool
+FSEndpointSource::parseEndpoint(EndpointManager* manager,
+                                const boost::property_tree::ptree& properties,
+                                Endpoint& newep, const std::string& source) {
     static const std::string EP_UUID("uuid");
     static const std::string EP_MAC("mac");
     static const std::string EP_IP("ip");
@@ -119,401 +123,432 @@ void FSEndpointSource::updated(const fs::path& filePath) {
 
     static const std::string NEUTRON_NW("neutron-network");
 
-    try {
-        using boost::property_tree::ptree;
-        Endpoint newep;
-        ptree properties;
-
-        string pathstr = filePath.string();
-
-        read_json(pathstr, properties);
-        newep.setUUID(properties.get<string>(EP_UUID));
-        optional<string> mac = properties.get_optional<string>(EP_MAC);
-        if (mac) {
-            newep.setMAC(MAC(mac.get()));
-        }
-        optional<ptree&> ips = properties.get_child_optional(EP_IP);
-        if (ips) {
-            for (const ptree::value_type &v : ips.get())
-                newep.addIP(v.second.data());
-        }
-        optional<ptree&> anycastReturnIps =
-            properties.get_child_optional(EP_ANYCAST_RETURN_IP);
-        if (anycastReturnIps) {
-            for (const ptree::value_type &v : anycastReturnIps.get())
-                newep.addAnycastReturnIP(v.second.data());
-        }
-        optional<ptree&> serviceIps =
-            properties.get_child_optional(EP_SERVICE_IP);
-        if (serviceIps) {
-            for (const ptree::value_type &v : serviceIps.get())
-                newep.addServiceIP(v.second.data());
-        }
-        optional<ptree&> virtualIps =
-            properties.get_child_optional(EP_VIRTUAL_IP);
-        if (virtualIps) {
-            for (const ptree::value_type &v : virtualIps.get()) {
-                 optional<string> vmac =
-                     v.second.get_optional<string>(EP_MAC);
-                 optional<string> vip =
-                     v.second.get_optional<string>(EP_IP);
-                 if (vip) {
-                     if (vmac) {
-                         newep.addVirtualIP(make_pair(MAC(vmac.get()),
-                                                      vip.get()));
-                     } else if (mac) {
-                         newep.addVirtualIP(make_pair(MAC(mac.get()),
-                                                      vip.get()));
-                     }
+    using boost::property_tree::ptree;
+    newep.setUUID(properties.get<string>(EP_UUID));
+    optional<string> mac = properties.get_optional<string>(EP_MAC);
+    if (mac) {
+        newep.setMAC(MAC(mac.get()));
+    }
+    optional<const ptree&> ips = properties.get_child_optional(EP_IP);
+    if (ips) {
+        for (const ptree::value_type &v : ips.get())
+            newep.addIP(v.second.data());
+    }
+    optional<const ptree&> anycastReturnIps =
+        properties.get_child_optional(EP_ANYCAST_RETURN_IP);
+    if (anycastReturnIps) {
+        for (const ptree::value_type &v : anycastReturnIps.get())
+            newep.addAnycastReturnIP(v.second.data());
+    }
+    optional<const ptree&> serviceIps =
+        properties.get_child_optional(EP_SERVICE_IP);
+    if (serviceIps) {
+        for (const ptree::value_type &v : serviceIps.get())
+            newep.addServiceIP(v.second.data());
+    }
+    optional<const ptree&> virtualIps =
+        properties.get_child_optional(EP_VIRTUAL_IP);
+    if (virtualIps) {
+        for (const ptree::value_type &v : virtualIps.get()) {
+             optional<string> vmac =
+                 v.second.get_optional<string>(EP_MAC);
+             optional<string> vip =
+                 v.second.get_optional<string>(EP_IP);
+             if (vip) {
+                 if (vmac) {
+                     newep.addVirtualIP(make_pair(MAC(vmac.get()),
+                                                  vip.get()));
+                 } else if (mac) {
+                     newep.addVirtualIP(make_pair(MAC(mac.get()),
+                                                  vip.get()));
                  }
-            }
+             }
         }
+    }
 
-        optional<string> eg =
-            properties.get_optional<string>(EP_GROUP);
-        if (eg) {
-            newep.setEgURI(URI(eg.get()));
+    optional<string> eg =
+        properties.get_optional<string>(EP_GROUP);
+    if (eg) {
+        newep.setEgURI(URI(eg.get()));
+    } else {
+        optional<string> eg_name =
+            properties.get_optional<string>(EP_GROUP_NAME);
+        optional<string> ps_name =
+            properties.get_optional<string>(EG_POLICY_SPACE);
+        if (!ps_name)
+            ps_name = properties.get_optional<string>(POLICY_SPACE_NAME);
+        if (eg_name && ps_name) {
+            newep.setEgURI(opflex::modb::URIBuilder()
+                           .addElement("PolicyUniverse")
+                           .addElement("PolicySpace")
+                           .addElement(ps_name.get())
+                           .addElement("GbpEpGroup")
+                           .addElement(eg_name.get()).build());
         } else {
-            optional<string> eg_name =
-                properties.get_optional<string>(EP_GROUP_NAME);
-            optional<string> ps_name =
-                properties.get_optional<string>(EG_POLICY_SPACE);
-            if (!ps_name)
-                ps_name = properties.get_optional<string>(POLICY_SPACE_NAME);
-            if (eg_name && ps_name) {
-                newep.setEgURI(opflex::modb::URIBuilder()
-                               .addElement("PolicyUniverse")
-                               .addElement("PolicySpace")
-                               .addElement(ps_name.get())
-                               .addElement("GbpEpGroup")
-                               .addElement(eg_name.get()).build());
-            } else {
-                optional<string> eg_mapping_alias =
-                    properties.get_optional<string>(EG_MAPPING_ALIAS);
-                if (eg_mapping_alias) {
-                    newep.setEgMappingAlias(eg_mapping_alias.get());
-                }
+            optional<string> eg_mapping_alias =
+                properties.get_optional<string>(EG_MAPPING_ALIAS);
+            if (eg_mapping_alias) {
+                newep.setEgMappingAlias(eg_mapping_alias.get());
             }
         }
+    }
 
-        optional<ptree&> secGrps =
-            properties.get_child_optional(EP_SEC_GROUP);
-        if (secGrps) {
-            for (const ptree::value_type &v : secGrps.get()) {
-                optional<string> secGrpPS =
-                    v.second.get_optional<string>(SEC_GROUP_POLICY_SPACE);
-                optional<string> secGrpName =
-                    v.second.get_optional<string>(SEC_GROUP_NAME);
-                if (secGrpName && secGrpPS) {
-                    newep.addSecurityGroup(opflex::modb::URIBuilder()
-                                           .addElement("PolicyUniverse")
-                                           .addElement("PolicySpace")
-                                           .addElement(secGrpPS.get())
-                                           .addElement("GbpSecGroup")
-                                           .addElement(secGrpName.get())
-                                           .build());
-                }
+    optional<const ptree&> secGrps =
+        properties.get_child_optional(EP_SEC_GROUP);
+    if (secGrps) {
+        for (const ptree::value_type &v : secGrps.get()) {
+            optional<string> secGrpPS =
+                v.second.get_optional<string>(SEC_GROUP_POLICY_SPACE);
+            optional<string> secGrpName =
+                v.second.get_optional<string>(SEC_GROUP_NAME);
+            if (secGrpName && secGrpPS) {
+                newep.addSecurityGroup(opflex::modb::URIBuilder()
+                                       .addElement("PolicyUniverse")
+                                       .addElement("PolicySpace")
+                                       .addElement(secGrpPS.get())
+                                       .addElement("GbpSecGroup")
+                                       .addElement(secGrpName.get())
+                                       .build());
             }
         }
+    }
 
-        optional<ptree&> qosPol =
-            properties.get_child_optional(QOS_POLICY);
-        if (qosPol){
-            optional<string> qosPolicySpace =
-                qosPol.get().get_optional<string>(SEC_GROUP_POLICY_SPACE);
-            optional<string> qosPolicyName =
-                qosPol.get().get_optional<string>(SEC_GROUP_NAME);
-            if (qosPolicyName && qosPolicySpace) {
-                newep.setQosPolicy(opflex::modb::URIBuilder()
-                        .addElement("PolicyUniverse")
-                        .addElement("PolicySpace")
-                        .addElement(qosPolicySpace.get())
-                        .addElement("QosRequirement")
-                        .addElement(qosPolicyName.get())
-                        .build());
-            }
+    optional<const ptree&> qosPol =
+        properties.get_child_optional(QOS_POLICY);
+    if (qosPol){
+        optional<string> qosPolicySpace =
+            qosPol.get().get_optional<string>(SEC_GROUP_POLICY_SPACE);
+        optional<string> qosPolicyName =
+            qosPol.get().get_optional<string>(SEC_GROUP_NAME);
+        if (qosPolicyName && qosPolicySpace) {
+            newep.setQosPolicy(opflex::modb::URIBuilder()
+                    .addElement("PolicyUniverse")
+                    .addElement("PolicySpace")
+                    .addElement(qosPolicySpace.get())
+                    .addElement("QosRequirement")
+                    .addElement(qosPolicyName.get())
+                    .build());
         }
+    }
 
-        optional<string> iface =
-            properties.get_optional<string>(EP_IFACE_NAME);
-        if (iface)
-            newep.setInterfaceName(iface.get());
-        optional<string> accessIface =
-            properties.get_optional<string>(EP_ACCESS_IFACE);
-        if (accessIface)
-            newep.setAccessInterface(accessIface.get());
-        optional<uint16_t> accessIfaceVlan =
-            properties.get_optional<uint16_t>(EP_ACCESS_IFACE_VLAN);
-        if (accessIfaceVlan)
-            newep.setAccessIfaceVlan(accessIfaceVlan.get());
-        optional<string> accessUplinkIface =
-            properties.get_optional<string>(EP_ACCESS_UPLINK_IFACE);
-        if (accessUplinkIface)
-            newep.setAccessUplinkInterface(accessUplinkIface.get());
-        optional<bool> promisc =
-            properties.get_optional<bool>(EP_PROMISCUOUS);
-        if (promisc)
-            newep.setPromiscuousMode(promisc.get());
-        optional<bool> discprox =
-            properties.get_optional<bool>(EP_DISC_PROXY);
-        if (discprox)
-            newep.setDiscoveryProxyMode(discprox.get());
-        optional<bool> natMode =
-            properties.get_optional<bool>(EP_NAT_MODE);
-        if (natMode)
-            newep.setNatMode(natMode.get());
-
-        optional<ptree&> attrs =
-            properties.get_child_optional(EP_ATTRIBUTES);
-        if (attrs) {
-            for (const ptree::value_type &v : attrs.get()) {
-                newep.addAttribute(v.first, v.second.data());
-                if (v.first == EP_ATTRIBUTE_VM_NAME &&
-                    // vm-name attribute starts with snat|
-                    v.second.data().rfind("snat|", 0) == 0) {
-                    newep.setNatMode(true);
-                }
+    optional<string> iface =
+        properties.get_optional<string>(EP_IFACE_NAME);
+    if (iface)
+        newep.setInterfaceName(iface.get());
+    optional<string> accessIface =
+        properties.get_optional<string>(EP_ACCESS_IFACE);
+    if (accessIface)
+        newep.setAccessInterface(accessIface.get());
+    optional<uint16_t> accessIfaceVlan =
+        properties.get_optional<uint16_t>(EP_ACCESS_IFACE_VLAN);
+    if (accessIfaceVlan)
+        newep.setAccessIfaceVlan(accessIfaceVlan.get());
+    optional<string> accessUplinkIface =
+        properties.get_optional<string>(EP_ACCESS_UPLINK_IFACE);
+    if (accessUplinkIface)
+        newep.setAccessUplinkInterface(accessUplinkIface.get());
+    optional<bool> promisc =
+        properties.get_optional<bool>(EP_PROMISCUOUS);
+    if (promisc)
+        newep.setPromiscuousMode(promisc.get());
+    optional<bool> discprox =
+        properties.get_optional<bool>(EP_DISC_PROXY);
+    if (discprox)
+        newep.setDiscoveryProxyMode(discprox.get());
+    optional<bool> natMode =
+        properties.get_optional<bool>(EP_NAT_MODE);
+    if (natMode)
+        newep.setNatMode(natMode.get());
+
+    optional<const ptree&> attrs =
+        properties.get_child_optional(EP_ATTRIBUTES);
+    if (attrs) {
+        for (const ptree::value_type &v : attrs.get()) {
+            newep.addAttribute(v.first, v.second.data());
+            if (v.first == EP_ATTRIBUTE_VM_NAME &&
+                // vm-name attribute starts with snat|
+                v.second.data().rfind("snat|", 0) == 0) {
+                newep.setNatMode(true);
             }
         }
+    }
 
-        optional<string> isOpenStack = properties.get_optional<string>(NEUTRON_NW);
-        if (isOpenStack) {
-            newep.setAnnotateEpName(true);
+    optional<string> isOpenStack = properties.get_optional<string>(NEUTRON_NW);
+    if (isOpenStack) {
+        newep.setAnnotateEpName(true);
+    }
+    auto acc_intf = newep.getAccessInterface();
+    if (acc_intf) {
+        newep.setAttributeHash(
+            AgentPrometheusManager::calcHashEpAttributes(
+                                        acc_intf.get(),
+                                        newep.isAnnotateEpName(),
+                                        newep.getAttributes(),
+                                        manager->getAgent().getPrometheusEpAttributes()));
+    }
+
+    optional<const ptree&> dhcp4 = properties.get_child_optional(DHCP4);
+    if (dhcp4) {
+        Endpoint::DHCPv4Config c;
+
+        optional<string> ip =
+            dhcp4.get().get_optional<string>(DHCP_IP);
+        if (ip)
+            c.setIpAddress(ip.get());
+
+        optional<string> serverIp =
+            dhcp4.get().get_optional<string>(DHCP_SERVER_IP);
+        if (serverIp)
+            c.setServerIp(serverIp.get());
+
+        optional<string> serverMac =
+            dhcp4.get().get_optional<string>(DHCP_SERVER_MAC);
+        if (serverMac)
+            c.setServerMac(MAC(serverMac.get()));
+
+        optional<uint8_t> prefix =
+            dhcp4.get().get_optional<uint8_t>(DHCP_PREFIX_LEN);
+        if (prefix)
+            c.setPrefixLen(prefix.get());
+
+        optional<const ptree&> routers =
+            dhcp4.get().get_child_optional(DHCP_ROUTERS);
+        if (routers) {
+            for (const ptree::value_type &u : routers.get())
+                c.addRouter(u.second.data());
         }
-        auto acc_intf = newep.getAccessInterface();
-        if (acc_intf) {
-            newep.setAttributeHash(
-                AgentPrometheusManager::calcHashEpAttributes(
-                                            acc_intf.get(),
-                                            newep.isAnnotateEpName(),
-                                            newep.getAttributes(),
-                                            manager->getAgent().getPrometheusEpAttributes()));
+
+        optional<const ptree&> dns =
+            dhcp4.get().get_child_optional(DHCP_DNS_SERVERS);
+        if (dns) {
+            for (const ptree::value_type &u : dns.get())
+                c.addDnsServer(u.second.data());
         }
 
-        optional<ptree&> dhcp4 = properties.get_child_optional(DHCP4);
-        if (dhcp4) {
-            Endpoint::DHCPv4Config c;
-
-            optional<string> ip =
-                dhcp4.get().get_optional<string>(DHCP_IP);
-            if (ip)
-                c.setIpAddress(ip.get());
-
-            optional<string> serverIp =
-                dhcp4.get().get_optional<string>(DHCP_SERVER_IP);
-            if (serverIp)
-                c.setServerIp(serverIp.get());
-
-            optional<string> serverMac =
-                dhcp4.get().get_optional<string>(DHCP_SERVER_MAC);
-            if (serverMac)
-                c.setServerMac(MAC(serverMac.get()));
-
-            optional<uint8_t> prefix =
-                dhcp4.get().get_optional<uint8_t>(DHCP_PREFIX_LEN);
-            if (prefix)
-                c.setPrefixLen(prefix.get());
-
-            optional<ptree&> routers =
-                dhcp4.get().get_child_optional(DHCP_ROUTERS);
-            if (routers) {
-                for (const ptree::value_type &u : routers.get())
-                    c.addRouter(u.second.data());
+        optional<string> domain =
+            dhcp4.get().get_optional<string>(DHCP_DOMAIN);
+        if (domain)
+            c.setDomain(domain.get());
+
+        optional<const ptree&> staticRoutes =
+            dhcp4.get().get_child_optional(DHCP_STATIC_ROUTES);
+        if (staticRoutes) {
+            for (const ptree::value_type &u : staticRoutes.get()) {
+                optional<string> dst = u.second.get_optional<string>
+                    (DHCP_STATIC_ROUTE_DEST);
+                uint8_t dstPrefix =
+                    u.second.get<uint8_t>
+                    (DHCP_STATIC_ROUTE_DEST_PREFIX, 32);
+                optional<string> nextHop = u.second.get_optional<string>
+                    (DHCP_STATIC_ROUTE_NEXTHOP);
+                if (dst && nextHop)
+                        c.addStaticRoute(dst.get(),
+                                         dstPrefix,
+                                         nextHop.get());
             }
+        }
 
-            optional<ptree&> dns =
-                dhcp4.get().get_child_optional(DHCP_DNS_SERVERS);
-            if (dns) {
-                for (const ptree::value_type &u : dns.get())
-                    c.addDnsServer(u.second.data());
-            }
+        optional<uint16_t> interfaceMtu =
+            dhcp4.get().get_optional<uint16_t>(DHCP_INTERFACE_MTU);
+        if (interfaceMtu)
+            c.setInterfaceMtu(interfaceMtu.get());
 
-            optional<string> domain =
-                dhcp4.get().get_optional<string>(DHCP_DOMAIN);
-            if (domain)
-                c.setDomain(domain.get());
-
-            optional<ptree&> staticRoutes =
-                dhcp4.get().get_child_optional(DHCP_STATIC_ROUTES);
-            if (staticRoutes) {
-                for (const ptree::value_type &u : staticRoutes.get()) {
-                    optional<string> dst = u.second.get_optional<string>
-                        (DHCP_STATIC_ROUTE_DEST);
-                    uint8_t dstPrefix =
-                        u.second.get<uint8_t>
-                        (DHCP_STATIC_ROUTE_DEST_PREFIX, 32);
-                    optional<string> nextHop = u.second.get_optional<string>
-                        (DHCP_STATIC_ROUTE_NEXTHOP);
-                    if (dst && nextHop)
-                            c.addStaticRoute(dst.get(),
-                                             dstPrefix,
-                                             nextHop.get());
-                }
-            }
+        optional<uint32_t> leaseTime =
+            dhcp4.get().get_optional<uint32_t>(DHCP_LEASE_TIME);
+        if (leaseTime)
+            c.setLeaseTime(leaseTime.get());
 
-            optional<uint16_t> interfaceMtu =
-                dhcp4.get().get_optional<uint16_t>(DHCP_INTERFACE_MTU);
-            if (interfaceMtu)
-                c.setInterfaceMtu(interfaceMtu.get());
+        newep.setDHCPv4Config(c);
+    }
 
-            optional<uint32_t> leaseTime =
-                dhcp4.get().get_optional<uint32_t>(DHCP_LEASE_TIME);
-            if (leaseTime)
-                c.setLeaseTime(leaseTime.get());
+    optional<const ptree&> dhcp6 = properties.get_child_optional(DHCP6);
+    if (dhcp6) {
+        Endpoint::DHCPv6Config c;
 
-            newep.setDHCPv4Config(c);
+        optional<const ptree&> searchPath =
+            dhcp6.get().get_child_optional(DHCP_SEARCH_LIST);
+        if (searchPath) {
+            for (const ptree::value_type &u : searchPath.get())
+                c.addSearchListEntry(u.second.data());
         }
 
-        optional<ptree&> dhcp6 = properties.get_child_optional(DHCP6);
-        if (dhcp6) {
-            Endpoint::DHCPv6Config c;
+        optional<const ptree&> dns =
+            dhcp6.get().get_child_optional(DHCP_DNS_SERVERS);
+        if (dns) {
+            for (const ptree::value_type &u : dns.get())
+                c.addDnsServer(u.second.data());
+        }
 
-            optional<ptree&> searchPath =
-                dhcp6.get().get_child_optional(DHCP_SEARCH_LIST);
-            if (searchPath) {
-                for (const ptree::value_type &u : searchPath.get())
-                    c.addSearchListEntry(u.second.data());
-            }
+        optional<uint32_t> t1 =
+            dhcp6.get().get_optional<uint32_t>(DHCP_T1);
+        if (t1)
+            c.setT1(t1.get());
 
-            optional<ptree&> dns =
-                dhcp6.get().get_child_optional(DHCP_DNS_SERVERS);
-            if (dns) {
-                for (const ptree::value_type &u : dns.get())
-                    c.addDnsServer(u.second.data());
-            }
+        optional<uint32_t> t2 =
+            dhcp6.get().get_optional<uint32_t>(DHCP_T2);
+        if (t2)
+            c.setT2(t2.get());
+
+        optional<uint32_t> validLifetime =
+            dhcp6.get().get_optional<uint32_t>(DHCP_VALID_LIFETIME);
+        if (validLifetime)
+            c.setValidLifetime(validLifetime.get());
 
-            optional<uint32_t> t1 =
-                dhcp6.get().get_optional<uint32_t>(DHCP_T1);
-            if (t1)
-                c.setT1(t1.get());
+        optional<uint32_t> preferredLifetime =
+            dhcp6.get().get_optional<uint32_t>(DHCP_PREFERRED_LIFETIME);
+        if (preferredLifetime)
+            c.setPreferredLifetime(preferredLifetime.get());
 
-            optional<uint32_t> t2 =
-                dhcp6.get().get_optional<uint32_t>(DHCP_T2);
-            if (t2)
-                c.setT2(t2.get());
+        newep.setDHCPv6Config(c);
+    }
 
-            optional<uint32_t> validLifetime =
-                dhcp6.get().get_optional<uint32_t>(DHCP_VALID_LIFETIME);
-            if (validLifetime)
-                c.setValidLifetime(validLifetime.get());
+    optional<const ptree&> ipms =
+        properties.get_child_optional(IP_ADDRESS_MAPPING);
+    if (ipms) {
+        for (const ptree::value_type &v : ipms.get()) {
+            optional<string> fuuid =
+                v.second.get_optional<string>(EP_UUID);
+            if (!fuuid) continue;
+
+            Endpoint::IPAddressMapping ipm(fuuid.get());
+
+            optional<string> floatingIp =
+                v.second.get_optional<string>(IPM_FLOATING_IP);
+            if (floatingIp)
+                ipm.setFloatingIP(floatingIp.get());
+
+            optional<string> mappedIp =
+                v.second.get_optional<string>(IPM_MAPPED_IP);
+            if (mappedIp)
+                ipm.setMappedIP(mappedIp.get());
+
+            optional<string> feg =
+                v.second.get_optional<string>(EP_GROUP);
+            if (feg) {
+                ipm.setEgURI(URI(feg.get()));
+            } else {
+                optional<string> feg_name =
+                    v.second.get_optional<string>(EP_GROUP_NAME);
+                optional<string> fps_name =
+                    v.second.get_optional<string>(POLICY_SPACE_NAME);
+                if (feg_name && fps_name) {
+                    ipm.setEgURI(opflex::modb::URIBuilder()
+                                 .addElement("PolicyUniverse")
+                                 .addElement("PolicySpace")
+                                 .addElement(fps_name.get())
+                                 .addElement("GbpEpGroup")
+                                 .addElement(feg_name.get()).build());
+                }
+            }
 
-            optional<uint32_t> preferredLifetime =
-                dhcp6.get().get_optional<uint32_t>(DHCP_PREFERRED_LIFETIME);
-            if (preferredLifetime)
-                c.setPreferredLifetime(preferredLifetime.get());
+            optional<string> nextHopIf =
+                v.second.get_optional<string>(IPM_NEXTHOP_IF);
+            if (nextHopIf)
+                ipm.setNextHopIf(nextHopIf.get());
 
-            newep.setDHCPv6Config(c);
+            optional<string> nextHopMac =
+                v.second.get_optional<string>(IPM_NEXTHOP_MAC);
+            if (nextHopMac) {
+                ipm.setNextHopMAC(MAC(nextHopMac.get()));
+            }
+
+            if (ipm.getMappedIP())
+                newep.addIPAddressMapping(ipm);
         }
+    }
 
-        optional<ptree&> ipms =
-            properties.get_child_optional(IP_ADDRESS_MAPPING);
-        if (ipms) {
-            for (const ptree::value_type &v : ipms.get()) {
-                optional<string> fuuid =
-                    v.second.get_optional<string>(EP_UUID);
-                if (!fuuid) continue;
-
-                Endpoint::IPAddressMapping ipm(fuuid.get());
-
-                optional<string> floatingIp =
-                    v.second.get_optional<string>(IPM_FLOATING_IP);
-                if (floatingIp)
-                    ipm.setFloatingIP(floatingIp.get());
-
-                optional<string> mappedIp =
-                    v.second.get_optional<string>(IPM_MAPPED_IP);
-                if (mappedIp)
-                    ipm.setMappedIP(mappedIp.get());
-
-                optional<string> feg =
-                    v.second.get_optional<string>(EP_GROUP);
-                if (feg) {
-                    ipm.setEgURI(URI(feg.get()));
-                } else {
-                    optional<string> feg_name =
-                        v.second.get_optional<string>(EP_GROUP_NAME);
-                    optional<string> fps_name =
-                        v.second.get_optional<string>(POLICY_SPACE_NAME);
-                    if (feg_name && fps_name) {
-                        ipm.setEgURI(opflex::modb::URIBuilder()
-                                     .addElement("PolicyUniverse")
-                                     .addElement("PolicySpace")
-                                     .addElement(fps_name.get())
-                                     .addElement("GbpEpGroup")
-                                     .addElement(feg_name.get()).build());
-                    }
-                }
+    optional<const ptree&> snats =
+        properties.get_child_optional(SNAT_UUIDS);
 
-                optional<string> nextHopIf =
-                    v.second.get_optional<string>(IPM_NEXTHOP_IF);
-                if (nextHopIf)
-                    ipm.setNextHopIf(nextHopIf.get());
+    if (snats) {
+        for (const ptree::value_type &v : snats.get())
+            newep.addSnatUuid(v.second.data());
+    }
 
-                optional<string> nextHopMac =
-                    v.second.get_optional<string>(IPM_NEXTHOP_MAC);
-                if (nextHopMac) {
-                    ipm.setNextHopMAC(MAC(nextHopMac.get()));
-                }
+    optional<bool> aapModeAA =
+        properties.get_optional<bool>(ACTIVE_ACTIVE_AAP);
+    if (aapModeAA)
+        newep.setAapModeAA(aapModeAA.get());
+
+    optional<bool> disableAdv =
+        properties.get_optional<bool>(EP_DISABLE_ADV);
+    if (disableAdv)
+        newep.setDisableAdv(disableAdv.get());
+
+    optional<bool> accessAllowUntagged =
+        properties.get_optional<bool>(EP_ACCESS_ALLOW_UNTAGGED);
+    if (accessAllowUntagged)
+        newep.setAccessAllowUntagged(accessAllowUntagged.get());
+
+    optional<bool> provider_vlan =
+            properties.get_optional<bool>(EP_PROVIDER_VLAN_FLAG);
+    if(provider_vlan && provider_vlan.get()) {
+        newep.setExternal();
+    }
 
-                if (ipm.getMappedIP())
-                    newep.addIPAddressMapping(ipm);
-            }
-        }
+    if(newep.isExternal() && !newep.getEgURI()) {
+        LOG(ERROR) << "endpoint-group not specified for external endpoint";
+        return false;
+    }
+    std::string ext_encap_type = properties.get(EP_EXT_ENCAP_TYPE,"vlan");
+    if(ext_encap_type != "vlan") {
+        LOG(ERROR) << "No encap other than vlan is supported for external EP";
+        return false;
+    }
+    optional<uint32_t> ext_encap =
+            properties.get_optional<uint32_t>(EP_EXT_ENCAP_ID);
+    if(ext_encap) {
+        newep.setExtEncap(ext_encap.get());
+    } else if(newep.isExternal()) {
+        LOG(ERROR) << EP_EXT_ENCAP_ID << " not provided for external EP: "
+                << source;
+        return false;
+    }
+    return true;
+}
 
-        optional<ptree&> snats =
-            properties.get_child_optional(SNAT_UUIDS);
+void FSEndpointSource::updated(const fs::path& filePath) {
+    if (!isep(filePath)) return;
+    const opflex::modb::TraceContext::Scope
+        trace(opflex::modb::TraceContext::clock::now());
 
-        if (snats) {
-            for (const ptree::value_type &v : snats.get())
-                newep.addSnatUuid(v.second.data());
-        }
+    try {
+        using boost::property_tree::ptree;
+        Endpoint newep;
+        ptree properties;
 
-        optional<bool> aapModeAA =
-            properties.get_optional<bool>(ACTIVE_ACTIVE_AAP);
-        if (aapModeAA)
-            newep.setAapModeAA(aapModeAA.get());
-
-        optional<bool> disableAdv =
-            properties.get_optional<bool>(EP_DISABLE_ADV);
-        if (disableAdv)
-            newep.setDisableAdv(disableAdv.get());
-
-        optional<bool> accessAllowUntagged =
-            properties.get_optional<bool>(EP_ACCESS_ALLOW_UNTAGGED);
-        if (accessAllowUntagged)
-            newep.setAccessAllowUntagged(accessAllowUntagged.get());
-
-        optional<bool> provider_vlan =
-                properties.get_optional<bool>(EP_PROVIDER_VLAN_FLAG);
-        if(provider_vlan && provider_vlan.get()) {
-            newep.setExternal();
-        }
+        string pathstr = filePath.string();
 
-        if(newep.isExternal() && !newep.getEgURI()) {
-            LOG(ERROR) << "endpoint-group not specified for external endpoint";
-            return;
-        }
-        std::string ext_encap_type = properties.get(EP_EXT_ENCAP_TYPE,"vlan");
-        if(ext_encap_type != "vlan") {
-            LOG(ERROR) << "No encap other than vlan is supported for external EP";
-            return;
+        std::ifstream file(pathstr);
+        if (!file)
+            throw runtime_error("Cannot open file");
+        std::stringstream contents;
+        contents << file.rdbuf();
+        string contentStr = contents.str();
+        {
+            std::lock_guard<std::recursive_mutex> guard(mutex);
+            ep_map_t::const_iterator it = knownEps.find(pathstr);
+            if (it != knownEps.end() &&
+                it->second.contents == contentStr) {
+                LOG(DEBUG) << "Endpoint " << it->second.uuid
+                           << " unchanged in " << filePath;
+                return;
+            }
         }
-        optional<uint32_t> ext_encap =
-                properties.get_optional<uint32_t>(EP_EXT_ENCAP_ID);
-        if(ext_encap) {
-            newep.setExtEncap(ext_encap.get());
-        } else if(newep.isExternal()) {
-            LOG(ERROR) << EP_EXT_ENCAP_ID << " not provided for external EP: "
-                    << filePath;
+
+        read_json(contents, properties);
+        if (!parseEndpoint(manager, properties, newep, pathstr))
             return;
-        }
 
+        std::lock_guard<std::recursive_mutex> guard(mutex);
         ep_map_t::const_iterator it = knownEps.find(pathstr);
         if (it != knownEps.end()) {
-            if (newep.getUUID() != it->second)
+            if (newep.getUUID() != it->second.uuid)
                 deleted(filePath);
         }
-        knownEps[pathstr] = newep.getUUID();
+        KnownEp& known = knownEps[pathstr];
+        known.uuid = newep.getUUID();
+        known.contents = std::move(contentStr);
         updateEndpoint(newep);
 
         LOG(INFO) << "Updated endpoint " << newep
@@ -530,14 +565,17 @@ void FSEndpointSource::updated(const fs::path& filePath) {
 }
 
 void FSEndpointSource::deleted(const fs::path& filePath) {
+    const opflex::modb::TraceContext::Scope
+        trace(opflex::modb::TraceContext::clock::now());
     try {
+        std::lock_guard<std::recursive_mutex> guard(mutex);
         string pathstr = filePath.string();
         ep_map_t::iterator it = knownEps.find(pathstr);
         if (it != knownEps.end()) {
             LOG(INFO) << "Removed endpoint "
-                      << it->second
+                      << it->second.uuid
                       << " at " << filePath;
-            removeEndpoint(it->second);
+            removeEndpoint(it->second.uuid);
             knownEps.erase(it);
         }
     } catch (const std::exception& ex) {
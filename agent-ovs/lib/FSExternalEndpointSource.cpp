@@ -308,6 +308,7 @@ void FSExternalEndpointSource::updated(const fs::path& filePath) {
         if (accessAllowUntagged)
             newep.setAccessAllowUntagged(accessAllowUntagged.get());
 
+        std::lock_guard<std::recursive_mutex> guard(mutex);
         ep_map_t::const_iterator it = knownEps.find(pathstr);
         if (it != knownEps.end()) {
             if (newep.getUUID() != it->second)
@@ -333,6 +334,7 @@ void FSExternalEndpointSource::updated(const fs::path& filePath) {
 
 void FSExternalEndpointSource::deleted(const fs::path& filePath) {
     try {
+        std::lock_guard<std::recursive_mutex> guard(mutex);
         string pathstr = filePath.string();
         ep_map_t::iterator it = knownEps.find(pathstr);
         if (it != knownEps.end()) {
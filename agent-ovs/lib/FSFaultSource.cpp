@@ -31,7 +31,7 @@ using opflex::modb::MAC;
 
 FSFaultSource::FSFaultSource(FaultManager* manager_,
                              FSWatcher& listener,
-                             const std::string& faultSourceDir, Agent& agent_): FaultSource(manager_),agent(agent_),faultManager(manager_){
+                             const std::string& faultSourceDir, Agent& agent_): FaultSource(manager_),agent(agent_),faultManager(manager_),inBatch(false){
     LOG(INFO) << "Watching " << faultSourceDir << " for fault objects";
     listener.addWatch(faultSourceDir, *this);
 }
@@ -98,22 +98,25 @@ void FSFaultSource::updated(const fs::path& filePath) {
                                  .addElement(ps_name)
                                  .addElement("GbpEpGroup")
                                  .addElement(eg_name).build());
-            faultManager->createEpFault(newfs);
+        }
 
-        } else {
-             faultManager->createPlatformFault(newfs);
-          }
         std::unique_lock<std::mutex> lock(lock_map_mutex);
+        if (ep_uuid)
+            batchEpFaults.push_back(newfs);
+        else
+            batchPlatformFaults.push_back(newfs);
         fault_map_t::const_iterator it =  knownFaults.find(pathstr);
         if (it != knownFaults.end()) {
             if (newfs.getFSUUID() != it->second) {
-                deleted(filePath);
+                // the file now describes a different fault
+                batchRemoved.push_back(it->second);
                 faultManager->clearPendingFaults(it->second); 
             }
         }
  
         knownFaults[pathstr] = newfs.getFSUUID();
-        LOG(INFO) << "Updated Faults " << newfs << " from " << filePath;
+        LOG(DEBUG) << "Updated Faults " << newfs << " from " << filePath;
+        flush(lock);
     } catch (const std::exception& ex) {
           LOG(ERROR) << "Could not load Faults from: "
                      << filePath << ": "
@@ -128,11 +131,12 @@ void FSFaultSource::deleted(const fs::path& filePath){
             std::unique_lock<std::mutex> lock(lock_map_mutex);
             fault_map_t::const_iterator it =  knownFaults.find(pathstr);
             if (it != knownFaults.end()) {
-                LOG(INFO) << "Removed Fault "
-                          << it->second
-                          << " at " << filePath;
-                faultManager->removeFault(it->second);
+                LOG(DEBUG) << "Removed Fault "
+                           << it->second
+                           << " at " << filePath;
+                batchRemoved.push_back(it->second);
                 knownFaults.erase(it);
+                flush(lock);
            }
         }
     } catch (const std::exception& ex) {
@@ -145,6 +149,38 @@ void FSFaultSource::deleted(const fs::path& filePath){
     }
 }
 
+void FSFaultSource::beginBatch() {
+    std::unique_lock<std::mutex> lock(lock_map_mutex);
+    inBatch = true;
+}
+
+void FSFaultSource::endBatch() {
+    try {
+        std::unique_lock<std::mutex> lock(lock_map_mutex);
+        inBatch = false;
+        flush(lock);
+    } catch (const std::exception& ex) {
+        LOG(ERROR) << "Could not update Faults: " << ex.what();
+    }
+}
+
+void FSFaultSource::flush(std::unique_lock<std::mutex>& lock) {
+    if (inBatch) return;
+    std::vector<Fault> platformFaults;
+    std::vector<Fault> epFaults;
+    std::vector<string> removed;
+    platformFaults.swap(batchPlatformFaults);
+    epFaults.swap(batchEpFaults);
+    removed.swap(batchRemoved);
+    lock.unlock();
+
+    if (platformFaults.empty() && epFaults.empty() && removed.empty())
+        return;
+    faultManager->updateFaults(platformFaults, epFaults, removed);
+    LOG(INFO) << "Updated " << (platformFaults.size() + epFaults.size())
+              << " and removed " << removed.size() << " Faults";
+}
+
 void FSFaultSource::getFaultUUID (string& uuid, const string& pathstr){
     std::unique_lock<std::mutex> lock(lock_map_mutex);
     fault_map_t::const_iterator it = knownFaults.find(pathstr);
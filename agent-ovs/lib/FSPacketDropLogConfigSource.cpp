@@ -164,6 +164,15 @@ static int validatePrefix(int filter_idx, const std::string & arg,
     return ret;
 }
 
+static bool validateProbability(double p, const string &inputField) {
+    if(!(p >= 0 && p <= 1)) {
+        LOG(ERROR) << "Probability " << inputField << " " << p
+                   << " should be between 0 and 1";
+        return false;
+    }
+    return true;
+}
+
 void FSPacketDropLogConfigSource::updated(const fs::path& filePath) {
     using boost::property_tree::ptree;
     ptree properties;
@@ -188,6 +197,10 @@ void FSPacketDropLogConfigSource::updated(const fs::path& filePath) {
             const std::string SPORT("sport");
             const std::string DPORT("dport");
             const std::string FLT_NAME("name");
+            const std::string SAMPLE("sample");
+            const std::string DROP_LOG_SAMPLING("drop-log-sampling");
+            const std::string PROBABILITY("probability");
+            const std::string TABLES("tables");
 
             dropCfg.dropLogEnable =
                 properties.get<bool>(DROP_LOG_ENABLE, false);
@@ -201,6 +214,25 @@ void FSPacketDropLogConfigSource::updated(const fs::path& filePath) {
                 LOG(ERROR) << "Unknown drop-log-mode: " << dropLogMode;
                 return;
             }
+            PacketDropLogSampling sampling;
+            auto samplingCfg = properties.get_child_optional(DROP_LOG_SAMPLING);
+            if(samplingCfg) {
+                sampling.probability =
+                    samplingCfg.get().get<double>(PROBABILITY, 1.0);
+                if(!validateProbability(sampling.probability, PROBABILITY)) {
+                    return;
+                }
+                if(samplingCfg.get().get_child_optional(TABLES)) {
+                    for (auto& table: samplingCfg.get().get_child(TABLES)) {
+                        double p = table.second.get_value<double>();
+                        if(!validateProbability(p, table.first)) {
+                            return;
+                        }
+                        sampling.tables[table.first] = p;
+                    }
+                }
+            }
+            dropCfg.sampling = sampling;
             dropCfg.filePath = pathStr;
             manager->packetDropLogConfigUpdated(dropCfg);
             std::shared_ptr<drop_prune_set_t> newPruneSet(new drop_prune_set_t);
@@ -237,6 +269,11 @@ void FSPacketDropLogConfigSource::updated(const fs::path& filePath) {
                     if(child.second.get_optional<uint16_t>(DPORT)) {
                         pruneSpec->dport = child.second.get<uint16_t>(DPORT);
                     }
+                    pruneSpec->sample = child.second.get_optional<double>(SAMPLE);
+                    if(pruneSpec->sample &&
+                       !validateProbability(pruneSpec->sample.get(), SAMPLE)) {
+                        continue;
+                    }
                     manager->packetDropPruneConfigUpdated(pruneSpec);
                     newPruneSet->insert(flt);
                     if(dropPruneCfgSet) {
@@ -336,6 +373,7 @@ void FSPacketDropLogConfigSource::deleted(const fs::path& filePath) {
             dropCfg.filePath.clear();
             dropCfg.dropLogEnable = false;
             dropCfg.dropLogMode = DropLogModeEnumT::CONST_UNFILTERED_DROP_LOG;
+            dropCfg.sampling = PacketDropLogSampling();
             manager->packetDropLogConfigUpdated(dropCfg);
             for(auto itr: *dropPruneCfgSet) {
                 manager->packetDropPruneConfigDeleted(itr);
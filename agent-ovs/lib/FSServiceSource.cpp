@@ -70,6 +70,7 @@ void FSServiceSource::updated(const fs::path& filePath) {
     static const std::string SM_GATEWAY_IP("gateway-ip");
     static const std::string SM_NEXT_HOP_IP("next-hop-ip");
     static const std::string SM_NEXT_HOP_IPS("next-hop-ips");
+    static const std::string SM_NEXT_HOP_WEIGHTS("next-hop-weights");
     static const std::string SM_NEXT_HOP_PORT("next-hop-port");
     static const std::string SM_NODE_PORT("node-port");
     static const std::string SM_CONNTRACK("conntrack-enabled");
@@ -238,6 +239,17 @@ void FSServiceSource::updated(const fs::path& filePath) {
                     }
                 }
 
+                optional<const ptree&> nhweights =
+                    v.second.get_child_optional(SM_NEXT_HOP_WEIGHTS);
+                if (nhweights) {
+                    for (auto& nhw : nhweights.get()) {
+                        optional<uint16_t> weight =
+                            nhw.second.get_value_optional<uint16_t>();
+                        if (weight)
+                            sm.setNextHopWeight(nhw.first, weight.get());
+                    }
+                }
+
                 optional<uint16_t> nextHopPort =
                     v.second.get_optional<uint16_t>(SM_NEXT_HOP_PORT);
                 if (nextHopPort)
@@ -269,6 +281,7 @@ void FSServiceSource::updated(const fs::path& filePath) {
             }
         }
 
+        std::lock_guard<std::recursive_mutex> guard(mutex);
         serv_map_t::const_iterator it = knownServs.find(pathstr);
         if (it != knownServs.end()) {
             if (newserv.getUUID() != it->second)
@@ -293,6 +306,7 @@ void FSServiceSource::updated(const fs::path& filePath) {
 
 void FSServiceSource::deleted(const fs::path& filePath) {
     try {
+        std::lock_guard<std::recursive_mutex> guard(mutex);
         string pathstr = filePath.string();
         serv_map_t::iterator it = knownServs.find(pathstr);
         if (it != knownServs.end()) {
@@ -150,6 +150,7 @@ void FSSnatSource::updated(const fs::path& filePath) {
             }
         }
 
+        std::lock_guard<std::recursive_mutex> guard(mutex);
         snat_map_t::const_iterator it = knownSnats.find(pathstr);
         if (it != knownSnats.end()) {
             if (newsnat.getUUID() != it->second)
@@ -174,6 +175,7 @@ void FSSnatSource::updated(const fs::path& filePath) {
 
 void FSSnatSource::deleted(const fs::path& filePath) {
     try {
+        std::lock_guard<std::recursive_mutex> guard(mutex);
         string pathstr = filePath.string();
         snat_map_t::iterator it = knownSnats.find(pathstr);
         if (it != knownSnats.end()) {
@@ -16,18 +16,24 @@
 
 #include <stdexcept>
 #include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <unordered_set>
 
 #ifdef USE_INOTIFY
 #include <sys/inotify.h>
 #include <sys/eventfd.h>
 #endif
 #include <poll.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include <opflex/modb/URIBuilder.h>
 
 #include <opflexagent/FSWatcher.h>
 #include <opflexagent/logging.h>
+#include <opflex/util/ThreadSettings.h>
 
 namespace opflexagent {
 
@@ -40,7 +46,13 @@ namespace fs = boost::filesystem;
 using opflex::modb::URI;
 using opflex::modb::MAC;
 
-FSWatcher::FSWatcher() : eventFd(-1), initialScan(true) {
+const long FSWatcher::DEFAULT_DEBOUNCE_MS;
+
+FSWatcher::FSWatcher()
+    : eventFd(-1), stopping(false), rescanRequested(false),
+      initialScan(true),
+      scanThreads(std::max(1u, thread::hardware_concurrency())),
+      debounce(DEFAULT_DEBOUNCE_MS) {
 
 }
 
@@ -60,6 +72,14 @@ void FSWatcher::setInitialScan(bool scan) {
     this->initialScan = scan;
 }
 
+void FSWatcher::setScanThreads(size_t threads) {
+    this->scanThreads = std::max<size_t>(1, threads);
+}
+
+void FSWatcher::setDebounce(long ms) {
+    this->debounce = std::chrono::milliseconds(std::max(0L, ms));
+}
+
 void FSWatcher::start() {
 #ifdef USE_INOTIFY
     if (regWatches.empty()) return;
@@ -83,7 +103,8 @@ void FSWatcher::start() {
                             strerror(errno));
     }
 
-    pollThread.reset(new thread(std::ref(*this)));
+    pollThread.reset(new thread(
+        opflex::util::startThread("fs_watcher", [this]() { (*this)(); })));
 #endif /* USE_INOTIFY */
 }
 
@@ -92,6 +113,7 @@ void FSWatcher::stop() {
     if (pollThread) {
         LOG(DEBUG) << "Stopping FSWatcher";
 
+        stopping = true;
         uint64_t u = 1;
         ssize_t s = write(eventFd, &u, sizeof(uint64_t));
         if (s != sizeof(uint64_t))
@@ -103,6 +125,7 @@ void FSWatcher::stop() {
 
         close(eventFd);
         eventFd = -1;
+        stopping = false;
 
         LOG(DEBUG) << "FSWatcher stopped";
     }
@@ -110,6 +133,18 @@ void FSWatcher::stop() {
 #endif /* USE_INOTIFY */
 }
 
+void FSWatcher::requestRescan() {
+#ifdef USE_INOTIFY
+    if (!pollThread) return;
+    rescanRequested = true;
+    uint64_t u = 1;
+    ssize_t s = write(eventFd, &u, sizeof(uint64_t));
+    if (s != sizeof(uint64_t))
+        throw runtime_error(string("Could not signal polling thread: ") +
+                            strerror(errno));
+#endif /* USE_INOTIFY */
+}
+
 FSWatcher::~FSWatcher() {
     try {
         stop();
@@ -118,18 +153,177 @@ FSWatcher::~FSWatcher() {
     }
 }
 
-void FSWatcher::scanPath(const WatchState* ws,
-                         const boost::filesystem::path& watchPath) {
-    if (fs::is_directory(watchPath)) {
+void FSWatcher::scanUpdate(const scan_item_t& item) {
+    try {
+        item.first->updated(item.second);
+    } catch (const std::exception& e) {
+        LOG(ERROR) << "Failed to load " << item.second << ": " << e.what();
+    }
+}
+
+void FSWatcher::scanWatches() {
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<scan_item_t> serial;
+    std::vector<scan_item_t> concurrent;
+    std::unordered_set<Watcher*> batch;
+    for (const path_map_t::value_type& w : regWatches) {
+        batch.insert(w.second.watchers.begin(), w.second.watchers.end());
+        if (!fs::is_directory(w.first)) continue;
         fs::directory_iterator end;
-        for (fs::directory_iterator it(watchPath); it != end; ++it) {
-            if (fs::is_regular_file(it->status())) {
-                for (Watcher* watcher : ws->watchers) {
-                    watcher->updated(it->path());
-                }
+        for (fs::directory_iterator it(w.first); it != end; ++it) {
+            if (!fs::is_regular_file(it->status())) continue;
+            file_time_t time;
+            if (fileTime(it->path(), time))
+                knownFiles[it->path()] = time;
+            for (Watcher* watcher : w.second.watchers) {
+                if (watcher->concurrentUpdates())
+                    concurrent.emplace_back(watcher, it->path());
+                else
+                    serial.emplace_back(watcher, it->path());
             }
         }
     }
+
+    // The files are parsed in parallel, and the watchers hand the
+    // results to their managers, whose listeners coalesce the
+    // resulting updates.
+    std::atomic<size_t> next(0);
+    auto work = [&concurrent, &next]() {
+        size_t i;
+        while ((i = next++) < concurrent.size())
+            scanUpdate(concurrent[i]);
+    };
+    for (Watcher* watcher : batch)
+        watcher->beginBatch();
+    std::vector<thread> pool;
+    size_t nthreads = std::min(scanThreads, concurrent.size());
+    for (size_t i = 1; i < nthreads; ++i)
+        pool.emplace_back(work);
+    for (const scan_item_t& item : serial)
+        scanUpdate(item);
+    work();
+    for (thread& t : pool)
+        t.join();
+    for (Watcher* watcher : batch)
+        watcher->endBatch();
+
+    LOG(INFO) << "Initial scan loaded "
+              << (serial.size() + concurrent.size()) << " files in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>
+                 (std::chrono::steady_clock::now() - start).count()
+              << "ms using " << std::max<size_t>(nthreads, 1) << " threads";
+}
+
+bool FSWatcher::fileTime(const fs::path& filePath, file_time_t& time) {
+    struct stat st;
+    if (::stat(filePath.c_str(), &st) != 0)
+        return false;
+    time = std::make_pair((int64_t)st.st_mtim.tv_sec,
+                          (long)st.st_mtim.tv_nsec);
+    return true;
+}
+
+void FSWatcher::queueEvent(const WatchState* ws, const fs::path& filePath,
+                           bool deleted) {
+    // a later event for the same path replaces the pending one and
+    // restarts its window
+    PendingEvent& pe = pendingEvents[filePath];
+    pe.ws = ws;
+    pe.deleted = deleted;
+    pe.due = std::chrono::steady_clock::now() + debounce;
+}
+
+int FSWatcher::pollTimeout() const {
+    if (pendingEvents.empty())
+        return -1;
+    auto due = pendingEvents.begin()->second.due;
+    for (const auto& pe : pendingEvents)
+        due = std::min(due, pe.second.due);
+    auto wait = std::chrono::duration_cast<std::chrono::milliseconds>
+        (due - std::chrono::steady_clock::now()).count();
+    // round up, so that the events are due when the poll returns
+    return wait < 0 ? 0 : (int)wait + 1;
+}
+
+void FSWatcher::dispatchEvents() {
+    auto now = std::chrono::steady_clock::now();
+    std::vector<std::pair<fs::path, PendingEvent>> due;
+    for (auto it = pendingEvents.begin(); it != pendingEvents.end(); ) {
+        if (it->second.due <= now) {
+            due.emplace_back(it->first, it->second);
+            it = pendingEvents.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    std::unordered_set<Watcher*> batch;
+    for (const auto& e : due)
+        batch.insert(e.second.ws->watchers.begin(),
+                     e.second.ws->watchers.end());
+    for (Watcher* watcher : batch)
+        watcher->beginBatch();
+
+    for (const auto& e : due) {
+        const fs::path& filePath = e.first;
+        if (e.second.deleted) {
+            knownFiles.erase(filePath);
+        } else {
+            file_time_t time;
+            if (fileTime(filePath, time))
+                knownFiles[filePath] = time;
+        }
+        for (Watcher* watcher : e.second.ws->watchers) {
+            if (e.second.deleted)
+                watcher->deleted(filePath);
+            else
+                watcher->updated(filePath);
+        }
+    }
+
+    for (Watcher* watcher : batch)
+        watcher->endBatch();
+}
+
+void FSWatcher::rescan() {
+    size_t changes = pendingEvents.size();
+    for (const path_map_t::value_type& w : regWatches) {
+        std::unordered_set<fs::path, PathHash> seen;
+        boost::system::error_code ec;
+        fs::directory_iterator it(w.first, ec), end;
+        if (ec) {
+            LOG(ERROR) << "Could not rescan " << w.first << ": "
+                       << ec.message();
+            continue;
+        }
+        for (; it != end; it.increment(ec)) {
+            if (ec) break;
+            if (!fs::is_regular_file(it->status())) continue;
+            const fs::path& filePath = it->path();
+            seen.insert(filePath);
+
+            file_time_t time;
+            if (!fileTime(filePath, time)) continue;
+            auto kit = knownFiles.find(filePath);
+            if (kit == knownFiles.end() || kit->second != time)
+                queueEvent(&w.second, filePath, false);
+        }
+        if (ec) {
+            // leave the known files alone rather than reporting
+            // files as deleted from a partial listing
+            LOG(ERROR) << "Could not rescan " << w.first << ": "
+                       << ec.message();
+            continue;
+        }
+        for (const auto& known : knownFiles) {
+            if (known.first.parent_path() == w.first &&
+                seen.find(known.first) == seen.end())
+                queueEvent(&w.second, known.first, true);
+        }
+    }
+    LOG(INFO) << "Rescan found "
+              << (pendingEvents.size() - changes) << " changed files";
 }
 
 void FSWatcher::operator()() {
@@ -138,7 +332,8 @@ void FSWatcher::operator()() {
 #define EVENT_BUF_LEN     ( 1024 * ( EVENT_SIZE + 16 ) )
     struct pollfd fds[2];
     nfds_t nfds;
-    char buf[EVENT_BUF_LEN];
+    char buf[EVENT_BUF_LEN]
+        __attribute__ ((aligned(__alignof__(struct inotify_event))));
 
     int fd = inotify_init1(IN_NONBLOCK);
     if (fd < 0) {
@@ -157,9 +352,11 @@ void FSWatcher::operator()() {
             goto cleanup;
         }
         activeWatches[wd] = &w.second;
-        if (initialScan)
-            scanPath(&w.second, w.first);
     }
+    // watches are in place before the scan, so that no change is
+    // missed
+    if (initialScan)
+        scanWatches();
 
     nfds = 2;
     // eventfd input
@@ -171,7 +368,7 @@ void FSWatcher::operator()() {
     fds[1].events = POLLIN;
 
     while (true) {
-        int poll_num = poll(fds, nfds, -1);
+        int poll_num = poll(fds, nfds, pollTimeout());
         if (poll_num < 0) {
             if (errno == EINTR)
                 continue;
@@ -182,8 +379,16 @@ void FSWatcher::operator()() {
         if (poll_num > 0) {
             if (fds[0].revents & POLLIN) {
                 // notification on eventfd descriptor; exit the
-                // thread
-                break;
+                // thread or rescan
+                uint64_t u;
+                if (read(eventFd, &u, sizeof(u)) < 0 && errno != EAGAIN) {
+                    LOG(ERROR) << "Error while reading eventfd: "
+                               << strerror(errno);
+                    break;
+                }
+                if (stopping) break;
+                if (rescanRequested.exchange(false))
+                    rescan();
             }
             if (fds[1].revents & POLLIN) {
                 // inotify events are available
@@ -195,36 +400,42 @@ void FSWatcher::operator()() {
                         goto cleanup;
                     }
 
-                    if (len < 0) break;
+                    if (len <= 0) break;
 
                     const struct inotify_event *event;
                     for (char* ptr = buf; ptr < buf + len;
                          ptr += sizeof(struct inotify_event) + event->len) {
                         event = (const struct inotify_event *) ptr;
 
-                        if (event->len) {
-                            char *nullterm_event = (char *)malloc(sizeof(char)*(len+1));
-                            memcpy(nullterm_event,event->name,len);
-                            if(event->name[len-1] != '\0') {
-                                nullterm_event[len] = '\0';
-                            }
-                            const WatchState* ws = activeWatches.at(event->wd);
-                            for (Watcher* watcher : ws->watchers) {
-                                if ((event->mask & IN_CLOSE_WRITE) ||
-                                    (event->mask & IN_MOVED_TO)) {
-                                    watcher->updated(ws->watchPath / nullterm_event);
-                                } else if ((event->mask & IN_DELETE) ||
-                                           (event->mask & IN_MOVED_FROM)) {
-                                    watcher->deleted(ws->watchPath / nullterm_event);
-                                }
-                            }
-                            free(nullterm_event);
+                        if (event->mask & IN_Q_OVERFLOW) {
+                            // events were dropped, so find the
+                            // changes by comparing with the files
+                            // seen so far
+                            LOG(WARNING) << "Filesystem event queue "
+                                         << "overflowed, rescanning";
+                            rescan();
+                            continue;
+                        }
+                        if (!event->len) continue;
+
+                        auto wit = activeWatches.find(event->wd);
+                        if (wit == activeWatches.end()) continue;
+                        const WatchState* ws = wit->second;
+                        // the name is padded with null bytes
+                        fs::path filePath = ws->watchPath /
+                            string(event->name);
+                        if ((event->mask & IN_CLOSE_WRITE) ||
+                            (event->mask & IN_MOVED_TO)) {
+                            queueEvent(ws, filePath, false);
+                        } else if ((event->mask & IN_DELETE) ||
+                                   (event->mask & IN_MOVED_FROM)) {
+                            queueEvent(ws, filePath, true);
                         }
                     }
                 }
             }
         }
-
+        dispatchEvents();
     }
  cleanup:
 
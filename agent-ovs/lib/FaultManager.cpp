@@ -35,31 +35,28 @@ void FaultManager::endpointUpdated(const std::string& uuid) {
 void FaultManager::handleEndpointUpdate(const std::string& uuid) {
     shared_ptr<const Endpoint> ep = agent.getEndpointManager().getEndpoint(uuid);
     if (!ep) return;
-    lock_guard<recursive_mutex> lock(map_mutex);
-    for (auto it=pendingFaults.begin(); it != pendingFaults.end(); it++) {
-        if (it->second.getEPUUID() == uuid) {
-            createEpFault(it->second);
+    std::vector<Fault> epFaults;
+    {
+        lock_guard<recursive_mutex> lock(map_mutex);
+        for (auto it=pendingFaults.begin(); it != pendingFaults.end(); it++) {
+            if (it->second.getEPUUID() == uuid) {
+                epFaults.push_back(it->second);
+            }
         }
     }
+    if (!epFaults.empty())
+        updateFaults({}, epFaults, {});
 }
 
 void FaultManager::createPlatformFault(const Fault& fs) {
-    const string& opflex_domain = agent.getPolicyManager().getOpflexDomain();
-    URI compute_node_uri = URIBuilder()
-                           .addElement("PolicyUniverse")
-                           .addElement("PlatformConfig")
-                           .addElement(opflex_domain).build(); 
-    Mutator mutator_policyelem(agent.getFramework(), "policyelement");
-    auto fu = modelgbp::fault::Universe::resolve(agent.getFramework());
-    auto fi = fu.get()->addFaultInstance(fs.getFSUUID());
-    fi->setSeverity(fs.getSeverity());
-    fi->setDescription(fs.getDescription());
-    fi->setFaultCode(fs.getFaultcode());
-    fi->setAffectedObject(compute_node_uri.toString());
-    mutator_policyelem.commit();
+    updateFaults({fs}, {}, {});
 }
 
 void FaultManager::createEpFault(const Fault& fs) {
+    updateFaults({}, {fs}, {});
+}
+
+optional<URI> FaultManager::getAffectedEp(const Fault& fs) {
     const boost::optional<opflex::modb::URI>& epURI = fs.getEgURI();
     optional<shared_ptr<modelgbp::gbp::BridgeDomain> > bd;
     bd = agent.getPolicyManager().getBDForGroup(epURI.get());
@@ -73,34 +70,70 @@ void FaultManager::createEpFault(const Fault& fs) {
                    .addElement(fs.getMAC().get()).build();
 
         auto l2Ep = L2Ep::resolve(agent.getFramework(), l2epr);
-        if (l2Ep) {
-            const URI& epURI = l2Ep.get()->getURI();
-            Mutator mutator_policyelem(agent.getFramework(), "policyelement");
-            auto fu = modelgbp::fault::Universe::resolve(agent.getFramework());
-            auto fi = fu.get()->addFaultInstance(fs.getFSUUID());
-            fi->setSeverity(fs.getSeverity());
-            fi->setDescription(fs.getDescription());
-            fi->setFaultCode(fs.getFaultcode());
-            fi->setAffectedObject(epURI.toString());
-            mutator_policyelem.commit();
-            lock_guard<recursive_mutex> lock(map_mutex);
-            pendingFaults.erase(fs.getFSUUID()); 
-        } else {
-            LOG(INFO) << "Not able to create a Fault : l2EP was not resolved "
-                      << "MAC " << fs.getMAC();
-            lock_guard<recursive_mutex> lock(map_mutex);
-            pendingFaults.insert(pair <std::string, Fault> (fs.getFSUUID(), fs));
-       }
-   } else {
+        if (l2Ep)
+            return l2Ep.get()->getURI();
+        LOG(INFO) << "Not able to create a Fault : l2EP was not resolved "
+                  << "MAC " << fs.getMAC();
+    } else {
        if (!bd) LOG(INFO) << "Not able to create a Fault : BD not found " 
                           << "FaultUUID = " << fs.getFSUUID() << "EPUUID = " << fs.getEPUUID();
        if (!ep) LOG(INFO) << "Not able to create a Fault : Endpoint not found " 
 	                  << "FaultUUID = " << fs.getFSUUID() << "EPUUID = " << fs.getEPUUID();	
-       lock_guard<recursive_mutex> lock(map_mutex);
-       pendingFaults.insert(pair <std::string, Fault> (fs.getFSUUID(), fs));
-     }
+    }
+    return boost::none;
 }
 
+void FaultManager::updateFaults(const std::vector<Fault>& platformFaults,
+                                const std::vector<Fault>& epFaults,
+                                const std::vector<std::string>& removed) {
+    // resolve the affected objects before the mutator is active
+    std::vector<std::pair<const Fault*, URI> > created;
+    if (!platformFaults.empty()) {
+        const string& opflex_domain = agent.getPolicyManager().getOpflexDomain();
+        URI compute_node_uri = URIBuilder()
+                               .addElement("PolicyUniverse")
+                               .addElement("PlatformConfig")
+                               .addElement(opflex_domain).build(); 
+        for (const Fault& fs : platformFaults)
+            created.emplace_back(&fs, compute_node_uri);
+    }
+    for (const Fault& fs : epFaults) {
+        optional<URI> affected = getAffectedEp(fs);
+        lock_guard<recursive_mutex> lock(map_mutex);
+        if (affected) {
+            created.emplace_back(&fs, affected.get());
+            pendingFaults.erase(fs.getFSUUID());
+        } else {
+            pendingFaults.insert(pair <std::string, Fault> (fs.getFSUUID(), fs));
+        }
+    }
+
+    size_t removes = 0;
+    Mutator mutator_policyelem(agent.getFramework(), "policyelement");
+    for (const std::string& uuid : removed) {
+        auto fi = modelgbp::fault::Instance::resolve(agent.getFramework(), uuid);
+        if (fi) {
+            modelgbp::fault::Instance::remove(agent.getFramework(), uuid);
+            removes += 1;
+        }
+    }
+    if (!created.empty()) {
+        auto fu = modelgbp::fault::Universe::resolve(agent.getFramework());
+        for (const auto& c : created) {
+            const Fault& fs = *c.first;
+            auto fi = fu.get()->addFaultInstance(fs.getFSUUID());
+            fi->setSeverity(fs.getSeverity());
+            fi->setDescription(fs.getDescription());
+            fi->setFaultCode(fs.getFaultcode());
+            fi->setAffectedObject(c.second.toString());
+        }
+    }
+    if (created.empty() && removes == 0)
+        return;
+    mutator_policyelem.commit();
+    LOG(DEBUG) << "Committed " << created.size() << " new and "
+               << removes << " removed faults";
+}
 
 void FaultManager::clearPendingFaults(const std::string& faultUUID) {
     lock_guard<recursive_mutex> lock(map_mutex);
@@ -108,12 +141,7 @@ void FaultManager::clearPendingFaults(const std::string& faultUUID) {
 }
 
 void FaultManager::removeFault(const std::string& uuid){
-    Mutator mutator_policyelem(agent.getFramework(), "policyelement");
-    auto fu = modelgbp::fault::Instance::resolve(agent.getFramework(),uuid);
-    if (fu){
-        fu.get()->remove(agent.getFramework(), uuid);
-        mutator_policyelem.commit();
-    }
+    updateFaults({}, {}, {uuid});
 }
 
 bool FaultManager::hasPendingFault(const std::string& faultUUID) {
@@ -0,0 +1,62 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for FlowProgrammingStats class.
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/FlowProgrammingStats.h>
+
+namespace opflexagent {
+
+const char* FlowProgrammingStats::getCounterName(Counter counter) {
+    static const char* names[COUNTER_MAX + 1] =
+        { "adds", "mods", "deletes", "flows" };
+    return names[counter];
+}
+
+FlowProgrammingStats::BridgeStats::BridgeStats(size_t tables_)
+    : tables(tables_),
+      counters(new std::atomic<uint64_t>[tables_ * (COUNTER_MAX + 1)]) {
+    for (size_t i = 0; i < tables * (COUNTER_MAX + 1); ++i)
+        counters[i] = 0;
+}
+
+void FlowProgrammingStats::BridgeStats::countEdits(size_t table,
+                                                   size_t adds,
+                                                   size_t mods,
+                                                   size_t deletes,
+                                                   size_t flows) {
+    if (table >= tables) return;
+    std::atomic<uint64_t>* c = &counters[table * (COUNTER_MAX + 1)];
+    c[ADDS] += adds;
+    c[MODS] += mods;
+    c[DELETES] += deletes;
+    c[FLOWS] = flows;
+}
+
+void FlowProgrammingStats::BridgeStats::
+observeWrite(size_t changes, std::chrono::steady_clock::duration barrier) {
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(barrier);
+    editSize.observe(changes);
+    barrierLatency.observe(ms.count() > 0 ? ms.count() : 0);
+}
+
+std::shared_ptr<FlowProgrammingStats::BridgeStats>
+FlowProgrammingStats::addBridge(const std::string& bridge, size_t tables) {
+    auto stats = std::make_shared<BridgeStats>(tables);
+    std::lock_guard<std::mutex> guard(mutex);
+    bridges[bridge] = stats;
+    return stats;
+}
+
+void FlowProgrammingStats::getBridges(bridge_map_t& result) const {
+    std::lock_guard<std::mutex> guard(mutex);
+    result = bridges;
+}
+
+} /* namespace opflexagent */
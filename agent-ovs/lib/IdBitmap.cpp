@@ -0,0 +1,112 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation of IdBitmap class
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/IdBitmap.h>
+
+namespace opflexagent {
+
+static const uint64_t FULL = ~(uint64_t)0;
+
+static inline uint64_t bit(uint64_t index) {
+    return (uint64_t)1 << (index % 64);
+}
+
+IdBitmap::IdBitmap(uint64_t size) {
+    reset(size);
+}
+
+void IdBitmap::reset(uint64_t size) {
+    nbits = size;
+    nset = 0;
+    size_t depth = 1;
+    for (uint64_t span = 64; span < size; span *= 64)
+        depth += 1;
+    levels.assign(depth, std::vector<uint64_t>());
+    levels.back().resize(1);
+}
+
+void IdBitmap::grow(uint64_t index) {
+    for (std::vector<uint64_t>& level : levels) {
+        index /= 64;
+        if (level.size() <= index)
+            level.resize(index + 1);
+    }
+}
+
+bool IdBitmap::test(uint64_t index) const {
+    const std::vector<uint64_t>& level = levels.front();
+    return index / 64 < level.size() && (level[index / 64] & bit(index));
+}
+
+void IdBitmap::set(uint64_t index) {
+    if (test(index)) return;
+    grow(index);
+    nset += 1;
+    for (std::vector<uint64_t>& level : levels) {
+        uint64_t& word = level[index / 64];
+        word |= bit(index);
+        if (word != FULL) break;
+        index /= 64;
+    }
+}
+
+void IdBitmap::clear(uint64_t index) {
+    if (!test(index)) return;
+    nset -= 1;
+    for (std::vector<uint64_t>& level : levels) {
+        uint64_t& word = level[index / 64];
+        bool wasFull = word == FULL;
+        word &= ~bit(index);
+        if (!wasFull) break;
+        index /= 64;
+    }
+}
+
+uint64_t IdBitmap::findFirstClear() const {
+    // index is the word to look at in the current level
+    uint64_t index = 0;
+    for (size_t l = levels.size(); l-- > 0; ) {
+        const std::vector<uint64_t>& level = levels[l];
+        // past the words allocated so far, which are all free, or
+        // past the top word, which is only full when its whole span
+        // is in use
+        bool beyond = index >= level.size();
+        if (beyond || level[index] == FULL) {
+            if (!beyond) index += 1;
+            for (size_t i = 0; i <= l && index < nbits; ++i)
+                index *= 64;
+            return index < nbits ? index : nbits;
+        }
+        index = index * 64 + __builtin_ctzll(~level[index]);
+    }
+    return index < nbits ? index : nbits;
+}
+
+uint64_t IdBitmap::freeRangeCount() const {
+    const std::vector<uint64_t>& level = levels.front();
+    uint64_t ranges = 0;
+    bool prevFree = false;
+    for (size_t i = 0; i < level.size() && i * 64 < nbits; ++i) {
+        uint64_t valid = nbits - i * 64 >= 64
+            ? FULL : bit(nbits - i * 64) - 1;
+        uint64_t free = ~level[i] & valid;
+        // a run starts at each free bit following a bit in use
+        uint64_t starts = free & ~((free << 1) | (prevFree ? 1 : 0));
+        ranges += __builtin_popcountll(starts);
+        prevFree = (free >> 63) & 1;
+    }
+    // the indexes past the allocated words are all free
+    if (level.size() * 64 < nbits && !prevFree)
+        ranges += 1;
+    return ranges;
+}
+
+} /* namespace opflexagent */
@@ -9,6 +9,11 @@
 
 #include <fstream>
 #include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <opflexagent/IdGenerator.h>
 #include <opflexagent/logging.h>
@@ -19,12 +24,23 @@ using std::string;
 using std::lock_guard;
 using std::mutex;
 
-IdGenerator::IdGenerator() : cleanupInterval(duration(5*60*1000)) {
+/* the original ID file format, which holds only assignments */
+static const uint32_t FORMAT_VERSION_ASSIGNMENTS = 1;
+
+/* the ID file format in which each record starts with its type */
+static const uint32_t FORMAT_VERSION_JOURNAL = 2;
+
+/* the file is rewritten when it holds more than this many records
+   and more than twice as many as there are IDs assigned */
+static const size_t COMPACT_MIN_RECORDS = 1024;
+
+IdGenerator::IdGenerator()
+    : cleanupInterval(duration(5*60*1000)), journalFrees(false) {
 
 }
 
 IdGenerator::IdGenerator(duration cleanupInterval_)
-    : cleanupInterval(cleanupInterval_) {
+    : cleanupInterval(cleanupInterval_), journalFrees(false) {
 
 }
 
@@ -40,6 +56,47 @@ void IdGenerator::setAllocHook(const std::string& nmspc,
     nitr->second.allocHook = allocHook;
 }
 
+void IdGenerator::setFreeHook(const std::string& nmspc,
+                              free_hook_t& freeHook) {
+    lock_guard<mutex> guard(id_mutex);
+    NamespaceMap::iterator nitr = namespaces.find(nmspc);
+    if (nitr == namespaces.end()) {
+        LOG(ERROR) << "Cannot set hook for uninitialized namespace: " << nmspc;
+        return;
+    }
+
+    nitr->second.freeHook = freeHook;
+}
+
+void IdGenerator::releaseId(const std::string& nmspc, uint32_t id) {
+    lock_guard<mutex> guard(id_mutex);
+    NamespaceMap::iterator nitr = namespaces.find(nmspc);
+    if (nitr == namespaces.end()) {
+        return;
+    }
+
+    IdMap& idmap = nitr->second;
+    if (id < idmap.minId || id - idmap.minId >= idmap.usedIds.size())
+        return;
+    // an ID still reserved has no string assigned
+    if (idmap.reverseMap.find(id) != idmap.reverseMap.end())
+        return;
+    idmap.usedIds.clear(id - idmap.minId);
+}
+
+bool IdGenerator::isIdUsed(const std::string& nmspc, uint32_t id) {
+    lock_guard<mutex> guard(id_mutex);
+    NamespaceMap::iterator nitr = namespaces.find(nmspc);
+    if (nitr == namespaces.end()) {
+        return false;
+    }
+
+    IdMap& idmap = nitr->second;
+    if (id < idmap.minId || id - idmap.minId >= idmap.usedIds.size())
+        return false;
+    return idmap.usedIds.test(id - idmap.minId);
+}
+
 // The below method doesnt do any alloc if ID isnt created already
 uint32_t IdGenerator::getIdNoAlloc (const string& nmspc, const string& str) {
     lock_guard<mutex> guard(id_mutex);
@@ -80,27 +137,25 @@ uint32_t IdGenerator::getId(const string& nmspc, const string& str) {
 
     IdMap::Str2IdMap::const_iterator it = idmap.ids.find(str);
     if (it == idmap.ids.end()) {
-        if (idmap.freeIds.empty()) {
+        uint64_t offset = idmap.usedIds.findFirstClear();
+        if (offset >= idmap.usedIds.size()) {
             LOG(ERROR) << "No free IDS in namespace: " << nmspc;
             return -1;
         }
-        id_range start = *idmap.freeIds.begin();
-        uint32_t newId = idmap.ids[str] = start.start;
+        uint32_t newId = idmap.ids[str] = idmap.minId + offset;
         if (idmap.allocHook) {
             if (!idmap.allocHook.get()(str, newId)) {
                 LOG(ERROR) << "ID allocation canceled by allocation hook";
                 return -1;
             }
         }
-        idmap.freeIds.erase(start);
-        if (start.start < start.end)
-            idmap.freeIds.insert(id_range(start.start + 1, start.end));
+        idmap.usedIds.set(offset);
 
         idmap.reverseMap[newId] = str;
 
         LOG(DEBUG) << "Assigned " << nmspc << ":" << newId
             << " to id: " << str;
-        persist(nmspc, idmap);
+        journal(nmspc, idmap, RECORD_ALLOC, newId, str);
 
         return newId;
     }
@@ -141,7 +196,9 @@ void IdGenerator::erase(const string& nmspc, const string& str) {
     IdMap& idmap = nitr->second;
     IdMap::Str2EIdMap::const_iterator it = idmap.erasedIds.find(str);
     if (it == idmap.erasedIds.end()) {
-        idmap.erasedIds[str] = std::chrono::steady_clock::now();
+        time_point now = std::chrono::steady_clock::now();
+        idmap.erasedIds[str] = now;
+        idmap.quarantine.emplace_back(now, str);
     }
 }
 
@@ -158,7 +215,7 @@ uint32_t IdGenerator::getFreeRangeCount(const std::string& nmspc) {
     }
 
     IdMap& idmap = nitr->second;
-    return idmap.freeIds.size();
+    return idmap.usedIds.freeRangeCount();
 }
 
 uint32_t IdGenerator::getRemainingIdsLocked(const std::string& nmspc) {
@@ -168,65 +225,28 @@ uint32_t IdGenerator::getRemainingIdsLocked(const std::string& nmspc) {
     }
 
     IdMap& idmap = nitr->second;
-    uint32_t remaining = 0;
-    for (const id_range& r : idmap.freeIds) {
-        remaining += r.end - r.start + 1;
-    }
-    return remaining;
+    return idmap.usedIds.size() - idmap.usedIds.count();
 }
 
 void IdGenerator::cleanup() {
     lock_guard<mutex> guard(id_mutex);
     time_point now = std::chrono::steady_clock::now();
     for (NamespaceMap::value_type& nmv : namespaces) {
-        bool changed = false;
         IdMap& idmap = nmv.second;
-        IdMap::Str2EIdMap::iterator it = idmap.erasedIds.begin();
-        while (it != idmap.erasedIds.end()) {
-            if ((now - it->second) > cleanupInterval) {
+        while (!idmap.quarantine.empty() &&
+               (now - idmap.quarantine.front().first) > cleanupInterval) {
+            const std::pair<time_point, string>& q = idmap.quarantine.front();
+            IdMap::Str2EIdMap::iterator it = idmap.erasedIds.find(q.second);
+            if (it != idmap.erasedIds.end() && it->second == q.first) {
                 IdMap::Str2IdMap::iterator iit = idmap.ids.find(it->first);
                 if (iit != idmap.ids.end()) {
                     uint32_t erasedId = iit->second;
 
-                    // return erasedId to free set
-                    std::set<id_range>::iterator ub =
-                        std::upper_bound(idmap.freeIds.begin(),
-                                         idmap.freeIds.end(),
-                                         id_range(erasedId, erasedId));
-                    std::set<id_range>::iterator prev;
-                    if (ub != idmap.freeIds.end()) {
-                        prev = ub;
-                        --prev;
-                    } else {
-                        prev = idmap.freeIds.begin();
-                    }
-
-                    if (prev != idmap.freeIds.end() &&
-                        ub != idmap.freeIds.end() &&
-                        prev->end + 1 == erasedId &&
-                        erasedId + 1 == ub->start) {
-                        // merge prev and upper bound
-                        id_range newr(prev->start, ub->end);
-                        idmap.freeIds.erase(*prev);
-                        idmap.freeIds.erase(*ub);
-                        idmap.freeIds.insert(newr);
-                    } else if (prev != idmap.freeIds.end() &&
-                               prev->end + 1 == erasedId) {
-                        // extend prev bound range to include erased id
-                        id_range newprev(prev->start, erasedId);
-                        idmap.freeIds.erase(*prev);
-                        idmap.freeIds.insert(newprev);
-                    } else if (ub != idmap.freeIds.end() &&
-                               erasedId + 1 == ub->start) {
-                        // extend ub range to include erased Id
-                        id_range newub(erasedId, ub->end);
-                        idmap.freeIds.erase(*ub);
-                        idmap.freeIds.insert(newub);
-                    } else {
-                        // add new range for just this value
-                        idmap.freeIds.insert(id_range(erasedId, erasedId));
-                    }
-                    changed = true;
+                    // return erasedId to free set, unless the
+                    // free hook keeps it reserved
+                    if (!idmap.freeHook ||
+                        idmap.freeHook.get()(it->first, erasedId))
+                        idmap.usedIds.clear(erasedId - idmap.minId);
 
                     IdMap::Id2StrMap::iterator irmt =
                         idmap.reverseMap.find(iit->second);
@@ -235,22 +255,22 @@ void IdGenerator::cleanup() {
                     }
 
                     idmap.ids.erase(iit);
+                    journal(nmv.first, idmap, RECORD_FREE,
+                            erasedId, it->first);
 
                     LOG(DEBUG) << "Cleaned up ID " << it->first
                                << " in namespace " << nmv.first;
                 }
-                it = idmap.erasedIds.erase(it);
-                continue;
+                idmap.erasedIds.erase(it);
             }
-            ++it;
+            idmap.quarantine.pop_front();
         }
-        if (changed)
-            persist(nmv.first, nmv.second);
+        if (idmap.rewritePending)
+            persist(nmv.first, idmap);
 
         LOG(DEBUG) << "Remaining IDs for namespace "
                    << nmv.first << ": "
-                   << getRemainingIdsLocked(nmv.first)
-                   << " in " << idmap.freeIds.size() << " range(s)";
+                   << getRemainingIdsLocked(nmv.first);
     }
 }
 
@@ -259,41 +279,110 @@ string IdGenerator::getNamespaceFile(const string& nmspc) {
     return persistDir + "/" + nmspc + ".id";
 }
 
+static bool writeRecord(std::ostream& file, uint32_t version, uint8_t type,
+                        uint32_t id, const string& str) {
+    if (str.size() > UINT16_MAX) {
+        LOG(ERROR) << "ID string length exceeds maximum";
+        return true;
+    }
+    uint16_t len = str.size();
+    return !((version != FORMAT_VERSION_ASSIGNMENTS &&
+              file.write((const char *)&type, sizeof(type)).fail()) ||
+             file.write((const char *)&id, sizeof(id)).fail() ||
+             file.write((const char *)&len, sizeof(len)).fail() ||
+             file.write(str.c_str(), len).fail());
+}
+
 void IdGenerator::persist(const std::string& nmspc, IdMap& idmap) {
+    idmap.journal.reset();
+    idmap.rewritePending = false;
     if (persistDir.empty()) {
         return;
     }
+    idmap.fileVersion = journalFrees
+        ? FORMAT_VERSION_JOURNAL : FORMAT_VERSION_ASSIGNMENTS;
 
+    // write a new file and move it over the old one, so that the old
+    // file remains intact if the write fails
     string fname = getNamespaceFile(nmspc);
-    std::ofstream file(fname.c_str(), std::ios_base::binary);
-    if (!file.is_open()) {
+    string tmpname = fname + ".tmp";
+    {
+        std::ofstream file(tmpname.c_str(), std::ios_base::binary);
+        if (!file.is_open()) {
+            LOG(ERROR) << "Unable to open file " << tmpname << " for writing";
+            return;
+        }
+        if (file.write("opflexid", 8).fail() ||
+            file.write((const char*)&idmap.fileVersion,
+                       sizeof(idmap.fileVersion)).fail()) {
+            LOG(ERROR) << "Failed to write to file: " << tmpname;
+            return;
+        }
+        for (const IdMap::Str2IdMap::value_type& kv : idmap.ids) {
+            if (!writeRecord(file, idmap.fileVersion, RECORD_ALLOC,
+                             kv.second, kv.first)) {
+                LOG(ERROR) << "Failed to write to file: " << tmpname;
+                return;
+            }
+        }
+        file.close();
+        if (file.fail()) {
+            LOG(ERROR) << "Failed to write to file: " << tmpname;
+            return;
+        }
+    }
+    int fd = ::open(tmpname.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+    if (std::rename(tmpname.c_str(), fname.c_str())) {
+        LOG(ERROR) << "Unable to rename " << tmpname << " to " << fname
+                   << ": " << strerror(errno);
+        return;
+    }
+
+    idmap.journal.reset(new std::ofstream(fname.c_str(),
+                                          std::ios_base::binary |
+                                          std::ios_base::app));
+    if (!idmap.journal->is_open()) {
         LOG(ERROR) << "Unable to open file " << fname << " for writing";
+        idmap.journal.reset();
+    }
+    idmap.journalRecords = idmap.ids.size();
+    LOG(DEBUG) << "Wrote " << idmap.ids.size() << " entries to file " << fname;
+}
+
+void IdGenerator::journal(const std::string& nmspc, IdMap& idmap,
+                          RecordType type, uint32_t id, const string& str) {
+    if (persistDir.empty()) {
         return;
     }
-    uint32_t formatVersion = 0x1;
-    if (file.write("opflexid", 8).fail() ||
-        file.write((char*)&formatVersion, sizeof(formatVersion)).fail()) {
-        LOG(ERROR) << "Failed to write to file: " << fname;
+    if (!idmap.journal ||
+        (idmap.journalRecords >= COMPACT_MIN_RECORDS &&
+         idmap.journalRecords >= 2 * idmap.ids.size())) {
+        // the new assignments are already in the map
+        persist(nmspc, idmap);
+        return;
+    }
+    if (type == RECORD_FREE &&
+        idmap.fileVersion == FORMAT_VERSION_ASSIGNMENTS) {
+        // the original format cannot record a free, so the file is
+        // rewritten once the cleanup pass is done
+        idmap.rewritePending = true;
         return;
     }
-    for (const IdMap::Str2IdMap::value_type& kv : idmap.ids) {
-        const uint32_t& id = kv.second;
-        const string& str = kv.first;
-        if (str.size() > UINT16_MAX) {
-            LOG(ERROR) << "ID string length exceeds maximum";
-            continue;
-        }
-        uint16_t len = str.size();
 
-        if (file.write((const char *)&id, sizeof(id)).fail() ||
-            file.write((const char *)&len, sizeof(len)).fail() ||
-            file.write(str.c_str(), len).fail()) {
-            LOG(ERROR) << "Failed to write to file: " << fname;
-            break;
-        }
+    // each record is handed to the kernel at once, so that it
+    // survives a crash of the agent, but the file is only synced to
+    // disk when it is rewritten
+    if (!writeRecord(*idmap.journal, idmap.fileVersion, type, id, str) ||
+        idmap.journal->flush().fail()) {
+        LOG(ERROR) << "Failed to write to file: " << getNamespaceFile(nmspc);
+        persist(nmspc, idmap);
+        return;
     }
-    file.close();
-    LOG(DEBUG) << "Wrote " << idmap.ids.size() << " entries to file " << fname;
+    idmap.journalRecords += 1;
 }
 
 void IdGenerator::initNamespace(const std::string& nmspc,
@@ -301,7 +390,13 @@ void IdGenerator::initNamespace(const std::string& nmspc,
     lock_guard<mutex> guard(id_mutex);
     IdMap& idmap = namespaces[nmspc];
     idmap.ids.clear();
-    idmap.freeIds.insert(id_range(minId, maxId));
+    idmap.reverseMap.clear();
+    idmap.erasedIds.clear();
+    idmap.quarantine.clear();
+    idmap.journal.reset();
+    idmap.rewritePending = false;
+    idmap.minId = minId;
+    idmap.usedIds.reset(maxId >= minId ? (uint64_t)maxId - minId + 1 : 0);
 
     if (persistDir.empty()) {
         return;
@@ -325,18 +420,22 @@ void IdGenerator::initNamespace(const std::string& nmspc,
         LOG(ERROR) << fname << " is not an ID file";
         return;
     }
-    if (formatVersion != 1) {
+    if (formatVersion != FORMAT_VERSION_ASSIGNMENTS &&
+        formatVersion != FORMAT_VERSION_JOURNAL) {
         LOG(ERROR) << fname << ": Unsupported ID file format version: "
                    << formatVersion;
         return;
     }
 
-    std::set<uint32_t> usedIds;
-
+    // version 1 files hold only assignments, while later versions
+    // are a journal of assignments and frees to replay in order
     while (!file.fail()) {
+        uint8_t type = RECORD_ALLOC;
         uint32_t id;
         uint16_t len;
-        if (file.read((char *)&id, sizeof(id)).eof() ||
+        if ((formatVersion != FORMAT_VERSION_ASSIGNMENTS &&
+             file.read((char *)&type, sizeof(type)).eof()) ||
+            file.read((char *)&id, sizeof(id)).eof() ||
             file.read((char *)&len, sizeof(len)).eof()) {
             break;
         }
@@ -345,7 +444,20 @@ void IdGenerator::initNamespace(const std::string& nmspc,
             LOG(DEBUG) << "Unexpected EOF while reading string";
             break;
         }
-        if (usedIds.find(id) != usedIds.end()) {
+        if (type == RECORD_FREE) {
+            IdMap::Id2StrMap::iterator rit = idmap.reverseMap.find(id);
+            if (rit != idmap.reverseMap.end()) {
+                idmap.ids.erase(rit->second);
+                idmap.reverseMap.erase(rit);
+                idmap.usedIds.clear(id - minId);
+            }
+            continue;
+        } else if (type != RECORD_ALLOC) {
+            LOG(WARNING) << "ID file corrupt: unknown record type "
+                         << (int)type;
+            break;
+        }
+        if (id >= minId && id <= maxId && idmap.usedIds.test(id - minId)) {
             LOG(WARNING) << "ID file corrupt: " << id << " seen more than once";
         } else if (id > maxId) {
             LOG(WARNING) << "ID file corrupt: " << id << " above maximum";
@@ -354,27 +466,19 @@ void IdGenerator::initNamespace(const std::string& nmspc,
         } else {
             idmap.ids[*str] = id;
             idmap.reverseMap[id] = *str;
+            idmap.usedIds.set(id - minId);
         }
-        usedIds.insert(id);
         LOG(DEBUG) << "Loaded str: " << *str << ", "
                    << nmspc << ":" << id;
     }
     file.close();
 
-    uint32_t cur = minId;
-    idmap.freeIds.clear();
-    for (auto id : usedIds) {
-        if (id > cur)
-            idmap.freeIds.insert(id_range(cur, id - 1));
-        cur = id + 1;
-    }
-    if (cur < maxId)
-        idmap.freeIds.insert(id_range(cur, maxId));
-
     LOG(DEBUG) << "Loaded " << idmap.ids.size()
-               << " entries from " << fname << " with "
-               << idmap.freeIds.size() << " free range(s)";
+               << " entries from " << fname;
 
+    // start a new file holding only the current assignments, in the
+    // format chosen by setJournal
+    persist(nmspc, idmap);
 }
 
 void IdGenerator::collectGarbage(const std::string& ns,
@@ -394,23 +498,12 @@ void IdGenerator::collectGarbage(const std::string& ns,
 
         IdMap::Str2EIdMap::const_iterator it = map.erasedIds.find(uit->first);
         if (it == map.erasedIds.end()) {
-            map.erasedIds[uit->first] = std::chrono::steady_clock::now();
+            time_point now = std::chrono::steady_clock::now();
+            map.erasedIds[uit->first] = now;
+            map.quarantine.emplace_back(now, uit->first);
             LOG(DEBUG) << "Found garbage " << uit->first << " in " << ns;
         }
     }
 }
 
-bool operator<(const IdGenerator::id_range& lhs,
-               const IdGenerator::id_range& rhs) {
-    return lhs.start < rhs.start;
-}
-bool operator==(const IdGenerator::id_range& lhs,
-                const IdGenerator::id_range& rhs) {
-    return lhs.start == rhs.start && lhs.end == rhs.end;
-}
-bool operator!=(const IdGenerator::id_range& lhs,
-                const IdGenerator::id_range& rhs) {
-    return !(lhs == rhs);
-}
-
 } // namespace opflexagent
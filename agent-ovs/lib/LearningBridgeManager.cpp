@@ -12,6 +12,9 @@
 #include <opflexagent/LearningBridgeManager.h>
 #include <opflexagent/logging.h>
 
+#include <algorithm>
+#include <cstdint>
+
 namespace opflexagent {
 
 using std::unique_lock;
@@ -71,19 +74,92 @@ void LearningBridgeManager::removeIfaces(const LearningBridgeIface& iface) {
     }
 }
 
-void LearningBridgeManager::removeVlans(const LearningBridgeIface& iface,
-                                        range_set_t& notify) {
-    const std::string& uuid = iface.getUUID();
+namespace {
+
+typedef std::set<LearningBridgeIface::vlan_range_t> range_set_t;
+
+/*
+ * Merge overlapping and adjacent ranges, so that each VLAN is in
+ * exactly one range
+ */
+range_set_t normalize(const range_set_t& ranges) {
+    range_set_t result;
+    auto cur = ranges.begin();
+    if (cur == ranges.end()) return result;
+    LearningBridgeIface::vlan_range_t m = *cur;
+    for (++cur; cur != ranges.end(); ++cur) {
+        if (cur->first <= uint32_t(m.second) + 1) {
+            m.second = std::max(m.second, cur->second);
+        } else {
+            result.insert(m);
+            m = *cur;
+        }
+    }
+    result.insert(m);
+    return result;
+}
+
+/*
+ * Compute the VLANs in a that are not in b, both normalized
+ */
+range_set_t subtract(const range_set_t& a, const range_set_t& b) {
+    range_set_t result;
+    auto bit = b.begin();
+    for (auto r : a) {
+        uint32_t start = r.first;
+        while (bit != b.end() && bit->second < start)
+            ++bit;
+        for (auto it = bit; it != b.end() && it->first <= r.second; ++it) {
+            if (it->first > start)
+                result.emplace(start, it->first - 1);
+            start = uint32_t(it->second) + 1;
+            if (start > r.second) break;
+        }
+        if (start <= r.second)
+            result.emplace(start, r.second);
+    }
+    return result;
+}
+
+} /* anonymous namespace */
+
+void LearningBridgeManager::splitRange(uint16_t vlan, range_set_t& notify) {
+    // the range containing the VLAN is the last that starts at or
+    // before it
+    auto it = range_lbi_map.upper_bound(vlan_range_t(vlan, vlan));
+    if (it == range_lbi_map.begin()) return;
+    --it;
+    if (it->first.first == vlan || it->first.second < vlan) return;
+
+    vlan_range_t l = it->first;
+    std::unordered_set<std::string> uuids = it->second;
+    notify.insert(l);
+    it = range_lbi_map.erase(it);
+
+    vlan_range_t nr1(l.first, vlan - 1);
+    vlan_range_t nr2(vlan, l.second);
+    range_lbi_map.insert(it, make_pair(nr1, uuids));
+    range_lbi_map.insert(it, make_pair(nr2, std::move(uuids)));
+    notify.insert(nr1);
+    notify.insert(nr2);
+}
 
-    for (auto r : iface.getTrunkVlans()) {
-        auto it = range_lbi_map.find(r);
+void LearningBridgeManager::removeVlans(const std::string& uuid,
+                                        const range_set_t& vlans,
+                                        range_set_t& notify) {
+    for (auto r : vlans) {
+        // the VLANs may be only part of a range in the index
+        splitRange(r.first, notify);
+        if (r.second < UINT16_MAX)
+            splitRange(r.second + 1, notify);
 
+        auto it = range_lbi_map.lower_bound(r);
         while (it != range_lbi_map.end()) {
             if (r.second < it->first.second)
                 break;
 
-            notify.insert(it->first);
-            it->second.erase(uuid);
+            if (it->second.erase(uuid))
+                notify.insert(it->first);
             if (it->second.empty()) {
                 it = range_lbi_map.erase(it);
             } else {
@@ -93,11 +169,26 @@ void LearningBridgeManager::removeVlans(const LearningBridgeIface& iface,
     }
 }
 
-void LearningBridgeManager::addVlans(const LearningBridgeIface& iface,
-                                     range_set_t& notify) {
-    const std::string& uuid = iface.getUUID();
+void LearningBridgeManager::getIndexedRanges(const range_set_t& vlans,
+                                             range_set_t& ranges) {
+    for (auto r : vlans) {
+        auto it = range_lbi_map.upper_bound(vlan_range_t(r.first, r.first));
+        if (it != range_lbi_map.begin()) {
+            --it;
+            if (it->first.second < r.first)
+                ++it;
+        }
+        for (; it != range_lbi_map.end() && it->first.first <= r.second;
+             ++it) {
+            ranges.insert(it->first);
+        }
+    }
+}
 
-    for (auto r : iface.getTrunkVlans()) {
+void LearningBridgeManager::addVlans(const std::string& uuid,
+                                     const range_set_t& vlans,
+                                     range_set_t& notify) {
+    for (auto r : vlans) {
         // find all the ranges superceded by this update and replace
         // as needed
         auto lit = range_lbi_map.lower_bound(r);
@@ -280,12 +371,20 @@ void LearningBridgeManager::updateLBIface(const LearningBridgeIface& iface) {
         iface_lbi_map[iface.getInterfaceName().get()].insert(uuid);
     }
 
-    // update VLAN to iface mapping
-    if (lbi.iface &&
-        lbi.iface->getTrunkVlans() != iface.getTrunkVlans()) {
-        removeVlans(*lbi.iface, range_notify);
+    // update VLAN to iface mapping, touching only the VLANs that
+    // were added or removed
+    range_set_t newVlans = normalize(iface.getTrunkVlans());
+    if (lbi.iface) {
+        range_set_t oldVlans = normalize(lbi.iface->getTrunkVlans());
+        removeVlans(uuid, subtract(oldVlans, newVlans), range_notify);
+        addVlans(uuid, subtract(newVlans, oldVlans), range_notify);
+
+        // the flows for the ranges depend on the interface name
+        if (lbi.iface->getInterfaceName() != iface.getInterfaceName())
+            getIndexedRanges(newVlans, range_notify);
+    } else {
+        addVlans(uuid, newVlans, range_notify);
     }
-    addVlans(iface, range_notify);
 
     lbi.iface = std::make_shared<const LearningBridgeIface>(iface);
 
@@ -303,7 +402,8 @@ void LearningBridgeManager::removeLBIface(const std::string& uuid) {
         // update interface name to iface mapping
         removeIfaces(*it->second.iface);
         // update VLAN to iface mapping
-        removeVlans(*it->second.iface, range_notify);
+        removeVlans(uuid, normalize(it->second.iface->getTrunkVlans()),
+                    range_notify);
         lbi_map.erase(it);
     }
 
@@ -336,23 +436,13 @@ getIfacesByVlanRange(vlan_range_t range,
 
 void LearningBridgeManager::
 getVlanRangesByIface(const std::string& uuid,
-                     /* out */ std::set<vlan_range_t> ranges) {
+                     /* out */ std::set<vlan_range_t>& ranges) {
     unique_lock<mutex> guard(iface_mutex);
     auto it = lbi_map.find(uuid);
     if (it == lbi_map.end()) return;
 
     LOG(DEBUG) << "getVlanRangesByIface for " << uuid;
-    for (auto r : it->second.iface->getTrunkVlans()) {
-        auto it = range_lbi_map.find(r);
-
-        while (it != range_lbi_map.end()) {
-            if (r.second < it->first.second)
-                break;
-
-            ranges.insert(it->first);
-            it++;
-        }
-    }
+    getIndexedRanges(it->second.iface->getTrunkVlans(), ranges);
 }
 
 void LearningBridgeManager::forEachVlanRange(const vlanCb& func) {
@@ -0,0 +1,253 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for MulticastGroupJournal classes.
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/MulticastGroupJournal.h>
+#include <opflexagent/logging.h>
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/filesystem.hpp>
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <unordered_map>
+
+namespace opflexagent {
+
+namespace pt = boost::property_tree;
+namespace fs = boost::filesystem;
+using std::string;
+using std::unordered_set;
+using std::unordered_map;
+using std::vector;
+
+static const string MULTICAST_GROUPS("multicast-groups");
+static const string GENERATION("generation");
+
+const char* const MulticastGroupJournal::JOURNAL_SUFFIX = ".journal";
+
+string MulticastGroupJournal::getJournalPath(const string& snapshot) {
+    return snapshot + JOURNAL_SUFFIX;
+}
+
+/*
+ * Get a path in the directory of the file, hidden from the watchers
+ * of the directory, to write the file to before renaming it
+ */
+static string getTempPath(const string& file) {
+    fs::path path(file);
+    return (path.parent_path() / ("." + path.filename().string() +
+                                  ".tmp")).string();
+}
+
+MulticastGroupWriter::MulticastGroupWriter(const string& snapshot)
+    : snapshotPath(snapshot),
+      journalPath(MulticastGroupJournal::getJournalPath(snapshot)),
+      journal(false), minJournalLines(1024), started(false),
+      generation(0), journalLines(0) {}
+
+bool MulticastGroupWriter::writeSnapshot(const unordered_set<string>& groups) {
+    // A restarted writer must not reuse the generation of the journal
+    // lines it left behind
+    uint64_t next = generation + 1;
+    if (!started) {
+        next = std::chrono::duration_cast<std::chrono::microseconds>
+            (std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    pt::ptree tree;
+    pt::ptree groupTree;
+    for (const string& group : groups)
+        groupTree.push_back(std::make_pair("", pt::ptree(group)));
+    tree.add_child(MULTICAST_GROUPS, groupTree);
+    tree.put(GENERATION, next);
+
+    string temp = getTempPath(snapshotPath);
+    try {
+        pt::write_json(temp, tree);
+        fs::rename(temp, snapshotPath);
+    } catch (pt::json_parser_error& e) {
+        LOG(ERROR) << "Could not write multicast group file "
+                   << e.what();
+        return false;
+    } catch (fs::filesystem_error& e) {
+        LOG(ERROR) << "Could not write multicast group file "
+                   << e.what();
+        return false;
+    }
+    started = true;
+    generation = next;
+    written = groups;
+    journalLines = 0;
+
+    if (journal) {
+        // Replace the journal rather than truncating it, so that a
+        // reader can tell a new journal from one that grew past its
+        // position
+        string tempJournal = getTempPath(journalPath);
+        std::ofstream out(tempJournal, std::ios::trunc);
+        out.close();
+        boost::system::error_code ec;
+        if (out)
+            fs::rename(tempJournal, journalPath, ec);
+        if (!out || ec)
+            LOG(ERROR) << "Could not reset multicast group journal "
+                       << journalPath;
+    }
+    return true;
+}
+
+bool MulticastGroupWriter::write(const unordered_set<string>& groups,
+                                 bool snapshot) {
+    if (!journal || !started || snapshot)
+        return writeSnapshot(groups);
+
+    string lines;
+    size_t changes = 0;
+    string prefix = std::to_string(generation);
+    for (const string& group : written) {
+        if (groups.find(group) != groups.end()) continue;
+        lines += prefix + " -" + group + "\n";
+        changes += 1;
+    }
+    for (const string& group : groups) {
+        if (written.find(group) != written.end()) continue;
+        lines += prefix + " +" + group + "\n";
+        changes += 1;
+    }
+    if (changes == 0) return true;
+
+    if (journalLines + changes > std::max(minJournalLines, groups.size()))
+        return writeSnapshot(groups);
+
+    std::ofstream out(journalPath, std::ios::app);
+    out << lines;
+    out.close();
+    if (!out) {
+        LOG(ERROR) << "Could not append to multicast group journal "
+                   << journalPath;
+        return writeSnapshot(groups);
+    }
+    written = groups;
+    journalLines += changes;
+    return true;
+}
+
+MulticastGroupReader::MulticastGroupReader(const string& snapshot)
+    : snapshotPath(snapshot),
+      journalPath(MulticastGroupJournal::getJournalPath(snapshot)),
+      haveGeneration(false), generation(0), journalInode(0),
+      journalOffset(0) {}
+
+static void diffGroups(const unordered_set<string>& prev,
+                       const unordered_set<string>& next,
+                       vector<string>& joins,
+                       vector<string>& leaves) {
+    for (const string& group : prev) {
+        if (next.find(group) == next.end())
+            leaves.push_back(group);
+    }
+    for (const string& group : next) {
+        if (prev.find(group) == prev.end())
+            joins.push_back(group);
+    }
+}
+
+void MulticastGroupReader::readSnapshot(vector<string>& joins,
+                                        vector<string>& leaves) {
+    unordered_set<string> next;
+    try {
+        pt::ptree properties;
+        pt::read_json(snapshotPath, properties);
+        boost::optional<pt::ptree&> groupTree =
+            properties.get_child_optional(MULTICAST_GROUPS);
+        if (groupTree) {
+            for (const pt::ptree::value_type &v : groupTree.get())
+                next.insert(v.second.data());
+        }
+        boost::optional<uint64_t> gen =
+            properties.get_optional<uint64_t>(GENERATION);
+        haveGeneration = bool(gen);
+        generation = gen ? gen.get() : 0;
+    } catch (pt::ptree_error& e) {
+        LOG(ERROR) << "Could not parse multicast group file: " << e.what();
+        haveGeneration = false;
+    }
+
+    unordered_set<string> prev;
+    prev.swap(groups);
+    groups.swap(next);
+    journalInode = 0;
+    journalOffset = 0;
+    vector<string> journalJoins, journalLeaves;
+    readJournal(journalJoins, journalLeaves);
+    diffGroups(prev, groups, joins, leaves);
+}
+
+void MulticastGroupReader::readJournal(vector<string>& joins,
+                                       vector<string>& leaves) {
+    struct stat st;
+    if (::stat(journalPath.c_str(), &st) != 0)
+        return;
+    if (st.st_ino != journalInode ||
+        static_cast<uint64_t>(st.st_size) < journalOffset) {
+        journalInode = st.st_ino;
+        journalOffset = 0;
+    }
+
+    std::ifstream in(journalPath);
+    if (!in) return;
+    in.seekg(journalOffset);
+
+    // Report only the net change of each group read, whatever the
+    // number of lines about it
+    unordered_map<string, bool> before;
+    string line;
+    while (std::getline(in, line)) {
+        if (in.eof()) break; // the writer has not finished the line
+        journalOffset += line.size() + 1;
+
+        size_t sp = line.find(' ');
+        if (sp == string::npos || sp + 2 > line.size()) continue;
+        if (!haveGeneration ||
+            std::strtoull(line.c_str(), NULL, 10) != generation)
+            continue;
+
+        string group = line.substr(sp + 2);
+        before.emplace(group, groups.find(group) != groups.end());
+        if (line[sp + 1] == '+')
+            groups.insert(group);
+        else if (line[sp + 1] == '-')
+            groups.erase(group);
+    }
+
+    for (const auto& kv : before) {
+        bool now = groups.find(kv.first) != groups.end();
+        if (now && !kv.second)
+            joins.push_back(kv.first);
+        else if (!now && kv.second)
+            leaves.push_back(kv.first);
+    }
+}
+
+void MulticastGroupReader::clear(vector<string>& leaves) {
+    leaves.insert(leaves.end(), groups.begin(), groups.end());
+    groups.clear();
+    haveGeneration = false;
+    journalInode = 0;
+    journalOffset = 0;
+}
+
+} /* namespace opflexagent */
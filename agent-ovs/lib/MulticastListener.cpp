@@ -24,6 +24,7 @@ using std::shared_ptr;
 using std::unique_ptr;
 using std::unordered_set;
 using std::string;
+using std::vector;
 
 #define LISTEN_PORT 34242
 
@@ -163,4 +164,16 @@ void MulticastListener::sync(const shared_ptr<unordered_set<string> >& naddrs) {
     }
 }
 
+void MulticastListener::update(const shared_ptr<const vector<string> >& joins,
+                               const shared_ptr<const vector<string> >& leaves) {
+    for (const std::string& addr : *leaves) {
+        if (addresses.erase(addr) > 0)
+            leave(addr);
+    }
+    for (const std::string& addr : *joins) {
+        if (addresses.insert(addr).second)
+            join(addr);
+    }
+}
+
 } /* namespace opflexagent */
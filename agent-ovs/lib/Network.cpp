@@ -13,6 +13,7 @@
 #include <boost/algorithm/string/split.hpp>
 #include <boost/lexical_cast.hpp>
 
+#include <algorithm>
 #include <vector>
 
 #include <endian.h>
@@ -242,6 +243,81 @@ bool prefix_match(const boost::asio::ip::address& addr,
     return false;
 }
 
+/* the longest prefix, other than the prefix itself, containing it */
+static prefix_actions_t::const_iterator
+find_cover(const prefix_actions_t& prefixes, const cidr_t& prefix) {
+    for (int len = prefix.second - 1; len >= 0; --len) {
+        auto it = prefixes.find(std::make_pair(mask_address(prefix.first, len),
+                                               (uint8_t)len));
+        if (it != prefixes.end())
+            return it;
+    }
+    return prefixes.end();
+}
+
+/* the other half of the parent of a prefix of nonzero length */
+static address sibling_address(const address& addr, uint8_t prefixLen) {
+    if (addr.is_v4()) {
+        return address_v4(addr.to_v4().to_ulong() ^
+                          (UINT32_C(1) << (32 - prefixLen)));
+    }
+    address_v6::bytes_type data = addr.to_v6().to_bytes();
+    data[(prefixLen - 1) / 8] ^= (uint8_t)(0x80 >> ((prefixLen - 1) % 8));
+    return address_v6(data);
+}
+
+void aggregate_prefixes(prefix_actions_t& prefixes) {
+    prefix_actions_t result;
+    std::vector<std::vector<cidr_t> > byLen(129);
+    for (const auto& p : prefixes) {
+        uint8_t len = std::min<uint8_t>(p.first.second,
+                                        p.first.first.is_v4() ? 32 : 128);
+        cidr_t cidr(mask_address(p.first.first, len), len);
+        if (result.find(cidr) == result.end())
+            byLen[len].push_back(cidr);
+        result[cidr] = p.second;
+    }
+
+    // Going from the longest prefixes up, a merge only replaces two
+    // prefixes with a parent of the same action, so the prefixes
+    // already visited keep the action of their longest cover.
+    for (int len = 128; len >= 0; --len) {
+        for (size_t i = 0; i < byLen[len].size(); ++i) {
+            const cidr_t cidr = byLen[len][i];
+            auto it = result.find(cidr);
+            if (it == result.end())
+                continue;
+            uint32_t action = it->second;
+
+            auto cover = find_cover(result, cidr);
+            if (cover != result.end() && cover->second == action) {
+                result.erase(it);
+                continue;
+            }
+            if (len == 0)
+                continue;
+
+            auto sib = result.find(cidr_t(sibling_address(cidr.first, len),
+                                          len));
+            if (sib == result.end() || sib->second != action)
+                continue;
+            result.erase(it);
+            result.erase(sib);
+
+            // a parent with another action is hidden by its halves
+            cidr_t parent(mask_address(cidr.first, len - 1), len - 1);
+            auto pit = result.find(parent);
+            if (pit == result.end()) {
+                result[parent] = action;
+                byLen[len - 1].push_back(parent);
+            } else {
+                pit->second = action;
+            }
+        }
+    }
+    prefixes.swap(result);
+}
+
 void append(service_ports_t &current, boost::optional<const service_ports_t &>addendum) {
     if(!addendum) return;
     for (const auto &toAdd:addendum.get()) {
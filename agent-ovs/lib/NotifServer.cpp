@@ -25,6 +25,9 @@
 #include <grp.h>
 #include <pwd.h>
 
+#include <algorithm>
+#include <deque>
+
 namespace opflexagent {
 
 namespace ba = boost::asio;
@@ -36,7 +39,8 @@ using rapidjson::Writer;
 using rapidjson::Value;
 
 NotifServer::NotifServer(ba::io_service& io_service_)
-    : io_service(io_service_), running(false) {
+    : io_service(io_service_), running(false), maxQueued(256),
+      stats(std::make_shared<Stats>()) {
 
 }
 
@@ -60,12 +64,27 @@ void NotifServer::setSocketPerms(const std::string& perms) {
     notifSocketPerms = perms;
 }
 
+void NotifServer::setMaxQueued(size_t maxQueued_) {
+    maxQueued = std::max(maxQueued_, (size_t)1);
+}
+
+void NotifServer::getStats(std::unordered_map<std::string,
+                                              uint64_t>& counts) {
+    counts["sent"] = stats->sent;
+    counts["coalesced"] = stats->coalesced;
+    counts["dropped"] = stats->dropped;
+    counts["slow-consumers"] = stats->slowConsumers;
+    counts["sessions"] = stats->sessions;
+}
+
 class NotifServer::session
     : public std::enable_shared_from_this<session> {
 public:
-    session(ba::io_service& io_service_, std::set<session_ptr>& sessions_)
+    session(ba::io_service& io_service_, std::set<session_ptr>& sessions_,
+            shared_ptr<Stats> stats_, size_t maxQueued_)
         : io_service(io_service_), socket(io_service),
-          sessions(sessions_), msg_len(0) { }
+          sessions(sessions_), stats(stats_), maxQueued(maxQueued_),
+          closed(false), writing(false), slow(false), msg_len(0) { }
 
     stream_protocol::socket& get_socket() {
         return socket;
@@ -74,11 +93,16 @@ public:
     void start() {
         LOG(INFO) << "New notification connection";
         sessions.insert(shared_from_this());
+        stats->sessions++;
         read();
     }
 
     void close() {
+        if (closed) return;
+        closed = true;
         socket.close();
+        outq.clear();
+        stats->sessions--;
         sessions.erase(shared_from_this());
     }
 
@@ -160,6 +184,11 @@ public:
 
                 if (request.HasMember("id")) {
                     shared_ptr<StringBuffer> sb(new StringBuffer());
+                    // leave room to fill in message size later
+                    sb->Put('\0');
+                    sb->Put('\0');
+                    sb->Put('\0');
+                    sb->Put('\0');
                     Writer<StringBuffer> writer(*sb);
                     writer.StartObject();
                     writer.Key("result");
@@ -169,7 +198,7 @@ public:
                     request["id"].Accept(writer);
                     writer.EndObject();
 
-                    write(sb);
+                    send("", sb);
                 }
             }
 
@@ -181,71 +210,106 @@ public:
         }
     }
 
-    void handle_write(const boost::system::error_code& ec) {
-        if (ec) {
-            if (ec != ba::error::operation_aborted) {
-                LOG(ERROR) << "Could not write to notif socket: "
-                           << ec.message();
-                close();
-            }
-            return;
-        }
-    }
-
     bool subscribed(const std::string& type) {
         return subscriptions.find(type) != subscriptions.end();
     }
 
-    void dispatch(shared_ptr<StringBuffer> message) {
-        shared_ptr<session> s(shared_from_this());
-        io_service.dispatch([s, message]() { s->write(message); });
+    /**
+     * Queue a message to write to the session.  A message with a
+     * non-empty key replaces a queued message with the same key.
+     * When the queue is full the oldest message without a key is
+     * dropped to make room, or the oldest message if all have keys.
+     */
+    void send(const std::string& key, shared_ptr<StringBuffer> message) {
+        if (closed) return;
+        // the message at the front is being written
+        auto first = outq.begin() + (writing ? 1 : 0);
+        if (!key.empty()) {
+            for (auto it = first; it != outq.end(); ++it) {
+                if (it->first == key) {
+                    it->second = message;
+                    stats->coalesced++;
+                    return;
+                }
+            }
+        }
+        if (outq.size() >= maxQueued && first != outq.end()) {
+            auto it = first;
+            while (it != outq.end() && !it->first.empty())
+                ++it;
+            outq.erase(it != outq.end() ? it : first);
+            stats->dropped++;
+            if (!slow) {
+                slow = true;
+                stats->slowConsumers++;
+                LOG(WARNING) << "Notification listener is not "
+                             << "keeping up; dropping notifications";
+            }
+        }
+        outq.emplace_back(key, message);
+        if (!writing)
+            write_next();
     }
 
 private:
     ba::io_service& io_service;
     stream_protocol::socket socket;
     std::set<session_ptr>& sessions;
+    shared_ptr<Stats> stats;
+    size_t maxQueued;
+    bool closed;
+    bool writing;
+    bool slow;
 
     std::unordered_set<std::string> subscriptions;
     uint32_t msg_len;
     std::vector<uint8_t> buffer;
 
-    class write_ctx {
-    public:
-        write_ctx(shared_ptr<StringBuffer> message_,
-                  session_ptr session_)
-            : message(message_), session(session_) {}
+    /* messages waiting to be written with their coalescing keys; the
+       front one is being written if writing is set */
+    std::deque<std::pair<std::string, shared_ptr<StringBuffer> > > outq;
 
-        void handle_error(const boost::system::error_code& ec) {
-            if (ec != ba::error::operation_aborted) {
-                LOG(ERROR) << "Could not write to notif socket: "
-                           << ec.message();
-                session->close();
-            }
-        }
-        void operator()(const boost::system::error_code& ec, std::size_t) {
-            if (ec) {
-                handle_error(ec);
-                return;
-            }
+    void write_next() {
+        if (outq.empty()) {
+            writing = false;
+            return;
         }
-
-        shared_ptr<StringBuffer> message;
-        session_ptr session;
-    };
-
-    void write(shared_ptr<StringBuffer> message) {
+        writing = true;
+        shared_ptr<StringBuffer> message = outq.front().second;
         // write message length to first 4 bytes of message
         *reinterpret_cast<uint32_t*>(const_cast<char*>(message->GetString())) =
             htonl(message->GetSize() - 4);
+        shared_ptr<session> s(shared_from_this());
         ba::async_write(socket, ba::buffer(message->GetString(),
                                            message->GetSize()),
-                        write_ctx(message, shared_from_this()));
+                        [s, message](const boost::system::error_code& ec,
+                                     size_t) {
+                            s->handle_write(ec);
+                        });
+    }
+
+    void handle_write(const boost::system::error_code& ec) {
+        if (closed) return;
+        if (ec) {
+            writing = false;
+            if (ec != ba::error::operation_aborted) {
+                LOG(ERROR) << "Could not write to notif socket: "
+                           << ec.message();
+                close();
+            }
+            return;
+        }
+        stats->sent++;
+        outq.pop_front();
+        if (outq.empty())
+            slow = false;
+        write_next();
     }
 };
 
 void NotifServer::accept() {
-    session_ptr new_session(new session(io_service, sessions));
+    session_ptr new_session(new session(io_service, sessions, stats,
+                                        maxQueued));
     acceptor->
         async_accept(new_session->get_socket(),
                      [this, new_session](const boost::system::error_code& ec) {
@@ -360,10 +424,11 @@ void NotifServer::stop() {
 
 static void do_dispatch(shared_ptr<StringBuffer> buffer,
                         const std::set<NotifServer::session_ptr>& sessions,
-                        const std::string& type) {
+                        const std::string& type,
+                        const std::string& key) {
     for (const NotifServer::session_ptr& sp : sessions) {
         if (!sp->subscribed(type)) continue;
-        sp->dispatch(buffer);
+        sp->send(key, buffer);
     }
 }
 
@@ -398,7 +463,12 @@ void NotifServer::dispatchVirtualIp(const std::unordered_set<std::string>& uuids
     writer.EndObject();
     writer.EndObject();
 
-    do_dispatch(sb, sessions, "virtual-ip");
+    // the sessions are only touched from the io_service, so the
+    // caller never waits for a listener
+    std::string key = "virtual-ip|" + mstr + "|" + ipAddr;
+    io_service.dispatch([this, sb, key]() {
+            do_dispatch(sb, sessions, "virtual-ip", key);
+        });
 }
 
 } /* namespace opflexagent */
@@ -18,6 +18,7 @@
 #include <modelgbp/epdr/DnsEntry.hpp>
 #include <modelgbp/epdr/DnsDemand.hpp>
 #include <opflex/modb/URIBuilder.h>
+#include <opflex/modb/ReadLock.h>
 
 #include <opflexagent/logging.h>
 #include <opflexagent/PolicyManager.h>
@@ -48,6 +49,9 @@ using boost::asio::ip::address;
 //TODO: This should depend on the EGP being used.
 #define POLICYMANAGER_DYNAMIC_ROUTE_COST 140
 
+// how long prefetched policy is kept while nothing references it (ms)
+static const uint64_t PREFETCH_HOLD = 30*1000;
+
 PolicyManager::PolicyManager(OFFramework& framework_,
                              boost::asio::io_service& agent_io_)
     : framework(framework_), opflexDomain("default"), taskQueue(agent_io_),
@@ -168,6 +172,8 @@ void PolicyManager::stop() {
     group_map.clear();
     vnid_map.clear();
     redirGrpMap.clear();
+    contractDeltas.clear();
+    secGrpDeltas.clear();
 }
 
 void PolicyManager::registerListener(PolicyListener* listener) {
@@ -223,16 +229,40 @@ void PolicyManager::notifyDomain(class_id_t cid, const URI& domURI) {
 }
 
 void PolicyManager::notifyContract(const URI& contractURI) {
+    optional<ContractDelta> delta;
+    {
+        lock_guard<mutex> guard(state_mutex);
+        auto it = contractDeltas.find(contractURI);
+        if (it != contractDeltas.end()) {
+            delta = std::move(it->second);
+            contractDeltas.erase(it);
+        }
+    }
     lock_guard<mutex> guard(listener_mutex);
     for (PolicyListener *listener : policyListeners) {
-        listener->contractUpdated(contractURI);
+        if (delta)
+            listener->contractDeltaUpdated(contractURI, delta.get());
+        else
+            listener->contractUpdated(contractURI);
     }
 }
 
 void PolicyManager::notifySecGroup(const URI& secGroupURI) {
+    optional<SecGroupDelta> delta;
+    {
+        lock_guard<mutex> guard(state_mutex);
+        auto it = secGrpDeltas.find(secGroupURI);
+        if (it != secGrpDeltas.end()) {
+            delta = std::move(it->second);
+            secGrpDeltas.erase(it);
+        }
+    }
     lock_guard<mutex> guard(listener_mutex);
     for (PolicyListener *listener : policyListeners) {
-        listener->secGroupUpdated(secGroupURI);
+        if (delta)
+            listener->secGroupDeltaUpdated(secGroupURI, delta.get());
+        else
+            listener->secGroupUpdated(secGroupURI);
     }
 }
 
@@ -376,6 +406,7 @@ bool PolicyManager::updateEPGDomains(const URI& egURI, bool& toRemove) {
     optional<shared_ptr<EndpointRetention> > newl2epretpolicy;
     optional<shared_ptr<EndpointRetention> > newl3epretpolicy;
     optional<URI> nEpRetURI;
+    vector<URI> subnetsURIs;
 
     optional<opflex::modb::class_id_t> domainClass = boost::none;
     optional<URI> domainURI = boost::none;
@@ -391,6 +422,7 @@ bool PolicyManager::updateEPGDomains(const URI& egURI, bool& toRemove) {
     optional<shared_ptr<EpGroupToSubnetsRSrc> > egSns =
         epg.get()->resolveGbpEpGroupToSubnetsRSrc();
     if (egSns && egSns.get()->isTargetSet()) {
+        subnetsURIs.push_back(egSns.get()->getTargetURI().get());
         optional<shared_ptr<Subnets> > sns =
             Subnets::resolve(framework,
                              egSns.get()->getTargetURI().get());
@@ -482,6 +514,7 @@ bool PolicyManager::updateEPGDomains(const URI& egURI, bool& toRemove) {
         // Update the subnet map for the group with all the subnets it
         // could access.
         if (fwdSns && fwdSns.get()->isTargetSet()) {
+            subnetsURIs.push_back(fwdSns.get()->getTargetURI().get());
             optional<shared_ptr<Subnets> > sns =
                 Subnets::resolve(framework,
                                  fwdSns.get()->getTargetURI().get());
@@ -523,6 +556,28 @@ bool PolicyManager::updateEPGDomains(const URI& egURI, bool& toRemove) {
     gs.l2EpRetPolicy = newl2epretpolicy;
     gs.l3EpRetPolicy = newl3epretpolicy;
 
+    // remember what the group needed for prefetching it when it is
+    // referenced again while unresolved
+    PrefetchState& ps = prefetch_map[egURI];
+    ps.domains.clear();
+    if (newrd)
+        ps.domains.emplace_back(RoutingDomain::CLASS_ID,
+                                newrd.get()->getURI());
+    if (newbd)
+        ps.domains.emplace_back(BridgeDomain::CLASS_ID,
+                                newbd.get()->getURI());
+    if (newfd)
+        ps.domains.emplace_back(FloodDomain::CLASS_ID,
+                                newfd.get()->getURI());
+    for (const URI& u : subnetsURIs)
+        ps.domains.emplace_back(Subnets::CLASS_ID, u);
+    if (newl2epretpolicy)
+        ps.domains.emplace_back(EndpointRetention::CLASS_ID,
+                                newl2epretpolicy.get()->getURI());
+    if (newl3epretpolicy)
+        ps.domains.emplace_back(EndpointRetention::CLASS_ID,
+                                newl3epretpolicy.get()->getURI());
+
     return updated;
 }
 
@@ -620,6 +675,48 @@ void PolicyManager::getGroups(uri_set_t& epURIs) {
     }
 }
 
+// the part of an endpoint group URI that names its policy space
+static string getSpacePrefix(const URI& egURI) {
+    const string& u = egURI.toString();
+    return u.substr(0, u.find("/GbpEpGroup/"));
+}
+
+void PolicyManager::prefetchGroup(const URI& egURI) {
+    using namespace modelgbp::gbp;
+    vector<std::pair<class_id_t, URI> > refs;
+    {
+        lock_guard<mutex> guard(state_mutex);
+        auto git = group_map.find(egURI);
+        if (git != group_map.end() && git->second.epGroup)
+            return;
+
+        refs.emplace_back(EpGroup::CLASS_ID, egURI);
+        auto pit = prefetch_map.find(egURI);
+        if (pit != prefetch_map.end()) {
+            refs.insert(refs.end(), pit->second.domains.begin(),
+                        pit->second.domains.end());
+            for (const URI& u : pit->second.contracts)
+                refs.emplace_back(Contract::CLASS_ID, u);
+        } else {
+            // a group not seen before most likely shares a routing
+            // domain with the other groups of its policy space
+            const string space = getSpacePrefix(egURI);
+            uri_set_t rds;
+            for (const group_map_t::value_type& kv : group_map) {
+                if (kv.second.routingDomain &&
+                    getSpacePrefix(kv.first) == space)
+                    rds.insert(kv.second.routingDomain.get()->getURI());
+            }
+            for (const URI& u : rds)
+                refs.emplace_back(RoutingDomain::CLASS_ID, u);
+        }
+    }
+
+    LOG(DEBUG) << "Prefetching " << refs.size()
+               << " objects for group " << egURI;
+    framework.prefetch(refs, PREFETCH_HOLD);
+}
+
 void PolicyManager::getRoutingDomains(uri_set_t& rdURIs) {
     lock_guard<mutex> guard(state_mutex);
     for (const rd_map_t::value_type& kv : rd_map) {
@@ -730,6 +827,13 @@ void PolicyManager::updateGroupContracts(class_id_t groupType,
         CALC_DIFF(gcs.contractsConsumed, newConsumed, consAdded, consRemoved);
         CALC_DIFF(gcs.contractsIntra, newIntra, intraAdded, intraRemoved);
 #undef CALC_DIFF
+        if (groupType == EpGroup::CLASS_ID) {
+            uri_set_t& contracts = prefetch_map[groupURI].contracts;
+            contracts.clear();
+            contracts.insert(newProvided.begin(), newProvided.end());
+            contracts.insert(newConsumed.begin(), newConsumed.end());
+            contracts.insert(newIntra.begin(), newIntra.end());
+        }
         gcs.contractsProvided.swap(newProvided);
         gcs.contractsConsumed.swap(newConsumed);
         gcs.contractsIntra.swap(newIntra);
@@ -746,28 +850,34 @@ void PolicyManager::updateGroupContracts(class_id_t groupType,
 
     for (const URI& u : provAdded) {
         contractMap[u].providerGroups.insert(groupURI);
+        contractDeltas[u].providersAdded.insert(groupURI);
         LOG(DEBUG) << u << ": prov add: " << groupURI;
     }
     for (const URI& u : consAdded) {
         contractMap[u].consumerGroups.insert(groupURI);
+        contractDeltas[u].consumersAdded.insert(groupURI);
         LOG(DEBUG) << u << ": cons add: " << groupURI;
     }
     for (const URI& u : intraAdded) {
         contractMap[u].intraGroups.insert(groupURI);
+        contractDeltas[u].intraAdded.insert(groupURI);
         LOG(DEBUG) << u << ": intra add: " << groupURI;
     }
     for (const URI& u : provRemoved) {
         contractMap[u].providerGroups.erase(groupURI);
+        contractDeltas[u].providersRemoved.insert(groupURI);
         LOG(DEBUG) << u << ": prov remove: " << groupURI;
         removeContractIfRequired(u);
     }
     for (const URI& u : consRemoved) {
         contractMap[u].consumerGroups.erase(groupURI);
+        contractDeltas[u].consumersRemoved.insert(groupURI);
         LOG(DEBUG) << u << ": cons remove: " << groupURI;
         removeContractIfRequired(u);
     }
     for (const URI& u : intraRemoved) {
         contractMap[u].intraGroups.erase(groupURI);
+        contractDeltas[u].intraRemoved.insert(groupURI);
         LOG(DEBUG) << u << ": intra remove: " << groupURI;
         removeContractIfRequired(u);
     }
@@ -1208,7 +1318,10 @@ void PolicyManager::updateDnsPolicies(const class_id_t class_id,const URI &uri,
 	LOG(DEBUG) << "Clear DNS cache for " << elements.back();
         auto itr = dns_demand_map.find(elements.back());
         if(itr != dns_demand_map.end()) {
-	    itr->second.resolved.clear();
+            {
+                lock_guard<mutex> dnsGuard(dns_mutex);
+                itr->second.resolved.clear();
+            }
             notifyContracts = itr->second.secGrpSet;
 	    for(auto &secGrp: notifyContracts) {
 		bool notFound;
@@ -1268,7 +1381,10 @@ void PolicyManager::updateDnsPolicies(const class_id_t class_id,const URI &uri,
     }
 
     if(itr->second.resolved != newResolved) {
-        itr->second.resolved = newResolved;
+        {
+            lock_guard<mutex> dnsGuard(dns_mutex);
+            itr->second.resolved = newResolved;
+        }
         notifyContracts = itr->second.secGrpSet;
 	for(auto &secGrp: notifyContracts) {
 	    bool notFound;
@@ -1278,11 +1394,11 @@ void PolicyManager::updateDnsPolicies(const class_id_t class_id,const URI &uri,
     }
 }
 
-/*Call this while holding the stateMutex*/
 void PolicyManager::getDnsResolvedNamedServicePorts(
         const std::string &domainName,
         network::service_ports_t &egressDnsResolved)
 {
+    lock_guard<mutex> guard(dns_mutex);
     auto itr = dns_demand_map.find(domainName);
     if(itr != dns_demand_map.end()) {
         boost::optional<const network::service_ports_t &> res(itr->second.resolved);
@@ -1293,8 +1409,10 @@ void PolicyManager::getDnsResolvedNamedServicePorts(
 /*Call this while holding the stateMutex*/
 void PolicyManager::createDnsAsk(const URI &uri, const std::string &domainName)
 {
-    dns_demand_map[domainName];
-    dns_demand_map[domainName].secGrpSet.insert(uri);
+    {
+        lock_guard<mutex> guard(dns_mutex);
+        dns_demand_map[domainName].secGrpSet.insert(uri);
+    }
     auto dDemandU = modelgbp::epdr::DnsDemand::resolve(framework);
     opflex::modb::Mutator mutator(framework,"policyelement");
     dDemandU.get()->addEpdrDnsAsk(domainName);
@@ -1307,7 +1425,10 @@ void PolicyManager::deleteDnsAsk(const URI &uri, const std::string &domainName)
     if(dns_demand_map.find(domainName) == dns_demand_map.end()) {
         return;
     }
-    dns_demand_map[domainName].secGrpSet.erase(uri);
+    {
+        lock_guard<mutex> guard(dns_mutex);
+        dns_demand_map[domainName].secGrpSet.erase(uri);
+    }
     if(dns_demand_map[domainName].secGrpSet.empty()) {
         opflex::modb::Mutator mutator(framework,"policyelement");
         modelgbp::epdr::DnsAsk::remove(framework,domainName);
@@ -1475,17 +1596,57 @@ static bool updatePolicyRules(PolicyManager &pMgr, OFFramework& framework,
     return updated;
 }
 
-bool PolicyManager::updateSecGrpRules(const URI& secGrpURI, bool& notFound) {
+/* rules are the same only if they render to the same flows */
+static bool sameRule(const PolicyRule& lhs, const PolicyRule& rhs) {
+    return lhs == rhs &&
+        lhs.getPriority() == rhs.getPriority() &&
+        lhs.getRedirect() == rhs.getRedirect();
+}
+
+template <typename Delta>
+static void diffRules(const PolicyManager::rule_list_t& oldRules,
+                      const PolicyManager::rule_list_t& newRules,
+                      /* out */ Delta& delta) {
+    PolicyManager::rule_list_t::const_iterator oi = oldRules.begin();
+    PolicyManager::rule_list_t::const_iterator ni = newRules.begin();
+    while (oi != oldRules.end() && ni != newRules.end() &&
+           sameRule(**oi, **ni)) {
+        ++oi;
+        ++ni;
+    }
+    PolicyManager::rule_list_t added(ni, newRules.end());
+    for (; oi != oldRules.end(); ++oi) {
+        auto it = std::find_if(added.begin(), added.end(),
+                               [&oi](const shared_ptr<PolicyRule>& r) {
+                                   return sameRule(**oi, *r);
+                               });
+        if (it == added.end())
+            delta.rulesRemoved.push_back(*oi);
+        else
+            added.erase(it);
+    }
+    delta.rulesAdded.splice(delta.rulesAdded.end(), added);
+}
+
+void PolicyManager::resolveSecGrpRules(const URI& secGrpURI,
+                                       ResolvedRules& resolved) {
     using namespace modelgbp::gbp;
-    uri_set_t oldRedirGrps, newRedirGrps;
-    PolicyManager::named_addr_set_t newDnsRefs;
-    PolicyManager::named_addr_set_t &oldDnsRefs = secGrpMap[secGrpURI].dnsAsks;
-    bool log = false;
-    bool updated =  updatePolicyRules<SecGroup, SecGroupSubject,
-                             SecGroupRule>(*this, framework, secGrpURI,
-                                           notFound, secGrpMap[secGrpURI].rules,
-                                           oldRedirGrps, log, newRedirGrps,
-                                           newDnsRefs);
+    resolved.updated = updatePolicyRules<SecGroup, SecGroupSubject,
+                                         SecGroupRule>(*this, framework,
+                                                       secGrpURI,
+                                                       resolved.notFound,
+                                                       resolved.rules,
+                                                       resolved.oldRedirGrps,
+                                                       false,
+                                                       resolved.newRedirGrps,
+                                                       resolved.dnsRefs);
+}
+
+bool PolicyManager::applySecGrpRules(const URI& secGrpURI,
+                                     ResolvedRules& resolved) {
+    SecGrpState& sg = secGrpMap[secGrpURI];
+    PolicyManager::named_addr_set_t &oldDnsRefs = sg.dnsAsks;
+    PolicyManager::named_addr_set_t &newDnsRefs = resolved.dnsRefs;
     for (auto s : oldDnsRefs) {
         /*lost Dns Ref*/
         if(dns_demand_map.find(s) != dns_demand_map.end() && (newDnsRefs.find(s) == newDnsRefs.end())) {
@@ -1498,53 +1659,97 @@ bool PolicyManager::updateSecGrpRules(const URI& secGrpURI, bool& notFound) {
             createDnsAsk(secGrpURI, s);
         }
     }
-    secGrpMap[secGrpURI].dnsAsks = newDnsRefs;
-    return updated;
+    sg.dnsAsks = newDnsRefs;
+    if (resolved.updated)
+        sg.rules.swap(resolved.rules);
+    return resolved.updated;
+}
+
+bool PolicyManager::updateSecGrpRules(const URI& secGrpURI, bool& notFound) {
+    ResolvedRules resolved;
+    resolved.rules = secGrpMap[secGrpURI].rules;
+    resolveSecGrpRules(secGrpURI, resolved);
+    notFound = resolved.notFound;
+    if (!applySecGrpRules(secGrpURI, resolved))
+        return false;
+    // the old rules were swapped into resolved
+    diffRules(resolved.rules, secGrpMap[secGrpURI].rules,
+              secGrpDeltas[secGrpURI]);
+    return true;
 }
 
-bool PolicyManager::updateContractRules(const URI& contrURI, bool& notFound) {
+void PolicyManager::resolveContractRules(const URI& contrURI,
+                                         ResolvedRules& resolved) {
     using namespace modelgbp::gbp;
-    uri_set_t oldRedirGrps, newRedirGrps;
-    ContractState& cs = contractMap[contrURI];
-    named_addr_set_t newDnsRef;
-    bool log = false;
-    bool updated = updatePolicyRules<Contract, Subject,
-                                     Rule>(*this, framework, contrURI,
-                                           notFound, cs.rules,
-                                           oldRedirGrps, log,
-                                           newRedirGrps,
-                                           newDnsRef);
-    for (const URI& u : oldRedirGrps) {
+    resolved.updated = updatePolicyRules<Contract, Subject,
+                                         Rule>(*this, framework, contrURI,
+                                               resolved.notFound,
+                                               resolved.rules,
+                                               resolved.oldRedirGrps, false,
+                                               resolved.newRedirGrps,
+                                               resolved.dnsRefs);
+}
+
+bool PolicyManager::applyContractRules(const URI& contrURI,
+                                       ResolvedRules& resolved) {
+    for (const URI& u : resolved.oldRedirGrps) {
         if(redirGrpMap.find(u) != redirGrpMap.end()) {
             redirGrpMap[u].ctrctSet.erase(contrURI);
         }
     }
-    for (const URI& u : newRedirGrps) {
+    for (const URI& u : resolved.newRedirGrps) {
         redirGrpMap[u].ctrctSet.insert(contrURI);
     }
-    return updated;
+    if (resolved.updated)
+        contractMap[contrURI].rules.swap(resolved.rules);
+    return resolved.updated;
 }
 
 void PolicyManager::updateContracts() {
-    unique_lock<mutex> guard(state_mutex);
+    typedef std::unordered_map<URI, ResolvedRules> resolved_map_t;
+    resolved_map_t resolved;
     uri_set_t contractsToNotify;
 
-    /* recompute the rules for all contracts if a policy
-       object changed */
+    /* recompute the rules for all contracts if a policy object
+       changed.  The rules are resolved from the MODB without holding
+       the state lock, so that renderers are not blocked meanwhile.
+       Only this task writes the rules; a contract added in between
+       queues another run. */
+    {
+        lock_guard<mutex> guard(state_mutex);
+        for (const contract_map_t::value_type& kv : contractMap) {
+            resolved[kv.first].rules = kv.second.rules;
+        }
+    }
+    for (resolved_map_t::value_type& kv : resolved) {
+        resolveContractRules(kv.first, kv.second);
+    }
+
+    unique_lock<mutex> guard(state_mutex);
     for (auto itr = contractMap.begin();
          itr != contractMap.end();) {
 
-        bool notFound = false;
-        if (updateContractRules(itr->first, notFound)) {
+        auto rit = resolved.find(itr->first);
+        if (rit == resolved.end()) {
+            ++itr;
+            continue;
+        }
+        ResolvedRules& r = rit->second;
+        const rule_list_t oldRules(itr->second.rules);
+        if (applyContractRules(itr->first, r)) {
             contractsToNotify.insert(itr->first);
+            diffRules(oldRules, itr->second.rules,
+                      contractDeltas[itr->first]);
         }
         /*
          * notFound == true may happen if the contract was
          * removed or there is a reference from a group to
          * a contract that has not been received yet.
          */
-        if (notFound) {
+        if (r.notFound) {
             contractsToNotify.insert(itr->first);
+            // listeners must recheck the whole contract
+            contractDeltas.erase(itr->first);
             // if contract has providers/consumers, only
             // clear the rules
             if (itr->second.providerGroups.empty() &&
@@ -1567,19 +1772,40 @@ void PolicyManager::updateContracts() {
 }
 
 void PolicyManager::updateSecGrps() {
+    typedef std::unordered_map<URI, ResolvedRules> resolved_map_t;
+    resolved_map_t resolved;
+    uri_set_t toNotify;
+
     /* recompute the rules for all security groups if a policy
-       object changed */
-    unique_lock<mutex> guard(state_mutex);
+       object changed, resolving them without the state lock */
+    {
+        lock_guard<mutex> guard(state_mutex);
+        for (const secgrp_map_t::value_type& kv : secGrpMap) {
+            resolved[kv.first].rules = kv.second.rules;
+        }
+    }
+    for (resolved_map_t::value_type& kv : resolved) {
+        resolveSecGrpRules(kv.first, kv.second);
+    }
 
-    uri_set_t toNotify;
+    unique_lock<mutex> guard(state_mutex);
     auto it = secGrpMap.begin();
     while (it != secGrpMap.end()) {
-        bool notfound = false;
-        if (updateSecGrpRules(it->first, notfound)) {
+        auto rit = resolved.find(it->first);
+        if (rit == resolved.end()) {
+            ++it;
+            continue;
+        }
+        if (applySecGrpRules(it->first, rit->second)) {
             toNotify.insert(it->first);
+            // the old rules were swapped into resolved
+            diffRules(rit->second.rules, it->second.rules,
+                      secGrpDeltas[it->first]);
         }
-        if (notfound) {
+        if (rit->second.notFound) {
             toNotify.insert(it->first);
+            // listeners must recheck the whole security group
+            secGrpDeltas.erase(it->first);
             it = secGrpMap.erase(it);
         } else {
             ++it;
@@ -2241,12 +2467,22 @@ void PolicyManager::updateDomain(class_id_t class_id, const URI& uri) {
     if (class_id == modelgbp::gbp::ExternalInterface::CLASS_ID) {
         ext_int_map[uri];
     }
-    for (auto itr = group_map.begin(); itr != group_map.end(); ) {
-        bool toRemove = false;
-        if (updateEPGDomains(itr->first, toRemove)) {
-            notifyGroups.insert(itr->first);
+    {
+        // each group resolves a chain of a dozen or so objects, so
+        // lock the store once for the whole walk
+        const opflex::modb::ReadLock readLock(framework);
+        for (auto itr = group_map.begin(); itr != group_map.end(); ) {
+            bool toRemove = false;
+            if (updateEPGDomains(itr->first, toRemove)) {
+                notifyGroups.insert(itr->first);
+            }
+            if (toRemove) {
+                prefetch_map.erase(itr->first);
+                itr = group_map.erase(itr);
+            } else {
+                ++itr;
+            }
         }
-        itr = (toRemove ? group_map.erase(itr) : ++itr);
     }
     // Determine routing-domains that may be affected by changes to NAT EPG
     for (const URI& u : notifyGroups) {
@@ -3091,10 +3327,9 @@ PolicyManager::ContractListener::ContractListener(PolicyManager& pmanager_)
 
 PolicyManager::ContractListener::~ContractListener() {}
 
-void PolicyManager::ContractListener::objectUpdated(class_id_t classId,
+bool PolicyManager::ContractListener::dispatchUpdate(class_id_t classId,
                                                     const URI& uri) {
     using namespace modelgbp::gbp;
-    LOG(DEBUG) << "ContractListener update for URI " << uri;
 
     if (classId == EpGroup::CLASS_ID ||
         classId == L3ExternalNetwork::CLASS_ID) {
@@ -3124,13 +3359,54 @@ void PolicyManager::ContractListener::objectUpdated(class_id_t classId,
             });
         });
     } else {
-        {
-            unique_lock<mutex> guard(pmanager.state_mutex);
-            if (classId == Contract::CLASS_ID) {
-                pmanager.contractMap[uri];
-            }
+        return false;
+    }
+    return true;
+}
+
+void PolicyManager::ContractListener::objectUpdated(class_id_t classId,
+                                                    const URI& uri) {
+    using namespace modelgbp::gbp;
+    LOG(DEBUG) << "ContractListener update for URI " << uri;
+
+    if (dispatchUpdate(classId, uri))
+        return;
+
+    {
+        unique_lock<mutex> guard(pmanager.state_mutex);
+        if (classId == Contract::CLASS_ID) {
+            pmanager.contractMap[uri];
         }
+    }
+
+    pmanager.taskQueue.dispatch("contract", [this]() {
+            pmanager.updateContracts();
+        });
+}
+
+void PolicyManager::ContractListener::objectsUpdated(
+        const update_list_t& updates) {
+    using namespace modelgbp::gbp;
+    LOG(DEBUG) << "ContractListener update for " << updates.size()
+               << " URIs";
+
+    // Updates to contracts and their rules all funnel into a single
+    // updateContracts task, so only take the state lock once
+    bool contractsChanged = false;
+    {
+        unique_lock<mutex> guard(pmanager.state_mutex);
+        for (const update_list_t::value_type& u : updates) {
+            if (u.first == Contract::CLASS_ID)
+                pmanager.contractMap[u.second];
+        }
+    }
+
+    for (const update_list_t::value_type& u : updates) {
+        if (!dispatchUpdate(u.first, u.second))
+            contractsChanged = true;
+    }
 
+    if (contractsChanged) {
         pmanager.taskQueue.dispatch("contract", [this]() {
                 pmanager.updateContracts();
             });
@@ -3145,21 +3421,39 @@ PolicyManager::SecGroupListener::~SecGroupListener() {}
 void PolicyManager::SecGroupListener::objectUpdated(class_id_t classId,
                                                     const URI& uri) {
     LOG(DEBUG) << "SecGroupListener update for URI " << uri;
-    if (classId == modelgbp::epdr::DnsAnswer::CLASS_ID) {
+    objectsUpdated(update_list_t(1, std::make_pair(classId, uri)));
+}
+
+void PolicyManager::SecGroupListener::objectsUpdated(
+        const update_list_t& updates) {
+    bool secGrpsChanged = false;
+    {
+        unique_lock<mutex> guard(pmanager.state_mutex);
+        for (const update_list_t::value_type& u : updates) {
+            if (u.first == modelgbp::epdr::DnsAnswer::CLASS_ID)
+                continue;
+            if (u.first == modelgbp::gbp::SecGroup::CLASS_ID)
+                pmanager.secGrpMap[u.second];
+            secGrpsChanged = true;
+        }
+    }
+
+    for (const update_list_t::value_type& u : updates) {
+        if (u.first != modelgbp::epdr::DnsAnswer::CLASS_ID)
+            continue;
+        class_id_t classId = u.first;
+        const URI& uri = u.second;
         pmanager.taskQueue.dispatch("cl"+uri.toString(), [=]() {
             pmanager.executeAndNotifySecGroup([&](uri_set_t& notif) {
                 pmanager.updateDnsPolicies(classId, uri, notif);
             });
         });
-    } else {
-        unique_lock<mutex> guard(pmanager.state_mutex);
-        if (classId == modelgbp::gbp::SecGroup::CLASS_ID) {
-            pmanager.secGrpMap[uri];
-        }
+    }
 
-	pmanager.taskQueue.dispatch("secgroup", [this]() {
-		pmanager.updateSecGrps();
-	    });
+    if (secGrpsChanged) {
+        pmanager.taskQueue.dispatch("secgroup", [this]() {
+                pmanager.updateSecGrps();
+            });
     }
 }
 
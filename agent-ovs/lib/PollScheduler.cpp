@@ -0,0 +1,32 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for PollScheduler class.
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/PollScheduler.h>
+
+#include <cmath>
+
+namespace opflexagent {
+
+/* the fractional part of the golden ratio */
+static const double PHASE_STEP = 0.6180339887498949;
+
+PollScheduler::PollScheduler() : pollers(0) {
+}
+
+long PollScheduler::firstDelay(long interval) {
+    unsigned k = pollers.fetch_add(1);
+    double integral;
+    double phase = std::modf(k * PHASE_STEP, &integral);
+    long delay = interval - (long)(phase * interval);
+    return delay > 0 ? delay : 1;
+}
+
+} /* namespace opflexagent */
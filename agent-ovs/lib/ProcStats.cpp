@@ -0,0 +1,202 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for ProcStats class.
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/ProcStats.h>
+#include <opflexagent/logging.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <unordered_set>
+
+namespace opflexagent {
+
+namespace {
+
+/* large enough for the stat file of a process */
+const size_t STAT_BUF_SIZE = 1024;
+
+/* fields of the stat file counted from the first one after the
+   command name, which is field 3 in proc(5) */
+enum {
+    STAT_UTIME = 14 - 3,
+    STAT_STIME = 15 - 3,
+    STAT_NUM_THREADS = 20 - 3,
+    STAT_RSS = 24 - 3,
+    STAT_FIELDS
+};
+
+struct StatFields {
+    const char* comm;
+    size_t commLen;
+    uint64_t values[STAT_FIELDS];
+};
+
+/*
+ * Parse the contents of a stat file.  The command name is in
+ * parentheses and may itself contain spaces and parentheses, so the
+ * other fields are counted from the last closing parenthesis.
+ * Fields that are not unsigned numbers, such as the state, are read
+ * as zero.
+ */
+bool parseStat(const char* buf, size_t len, StatFields& f) {
+    const char* end = buf + len;
+    const char* open = buf;
+    while (open < end && *open != '(') ++open;
+    const char* close = end;
+    while (close > open && *(close - 1) != ')') --close;
+    if (open >= end || close <= open + 1)
+        return false;
+    f.comm = open + 1;
+    f.commLen = close - 1 - f.comm;
+
+    const char* p = close;
+    size_t field = 0;
+    while (field < STAT_FIELDS) {
+        while (p < end && *p == ' ') ++p;
+        if (p >= end || *p == '\n')
+            break;
+        uint64_t value = 0;
+        bool number = true;
+        for (; p < end && *p != ' ' && *p != '\n'; ++p) {
+            if (*p >= '0' && *p <= '9')
+                value = value * 10 + (*p - '0');
+            else
+                number = false;
+        }
+        f.values[field++] = number ? value : 0;
+    }
+    return field == STAT_FIELDS;
+}
+
+bool readStat(int fd, StatFields& f, char* buf) {
+    ssize_t len = pread(fd, buf, STAT_BUF_SIZE, 0);
+    return len > 0 && parseStat(buf, len, f);
+}
+
+} /* anonymous namespace */
+
+ProcStats::ProcStats(const std::string& procDir_)
+    : procDir(procDir_), statFd(-1), cpuSeconds(0), rssBytes(0),
+      threadCount(0) {
+    long ticks = sysconf(_SC_CLK_TCK);
+    ticksPerSecond = ticks > 0 ? ticks : 100;
+    long page = sysconf(_SC_PAGESIZE);
+    pageSize = page > 0 ? page : 4096;
+}
+
+ProcStats::~ProcStats() {
+    if (statFd >= 0)
+        close(statFd);
+    closeTasks();
+}
+
+void ProcStats::closeTasks() {
+    for (auto& t : tasks) {
+        if (t.second.fd >= 0)
+            close(t.second.fd);
+    }
+    tasks.clear();
+}
+
+bool ProcStats::sample() {
+    char buf[STAT_BUF_SIZE];
+    StatFields f;
+
+    if (statFd < 0) {
+        statFd = open((procDir + "/stat").c_str(), O_RDONLY | O_CLOEXEC);
+        if (statFd < 0) {
+            LOG(DEBUG) << "Could not open " << procDir << "/stat";
+            return false;
+        }
+    }
+    if (!readStat(statFd, f, buf))
+        return false;
+    cpuSeconds = (f.values[STAT_UTIME] + f.values[STAT_STIME]) /
+        ticksPerSecond;
+    rssBytes = f.values[STAT_RSS] * pageSize;
+    threadCount = f.values[STAT_NUM_THREADS];
+
+    bool rescan = tasks.size() != threadCount;
+    for (auto& t : tasks) {
+        Task& task = t.second;
+        if (!readStat(task.fd, f, buf)) {
+            rescan = true;
+            continue;
+        }
+        task.ticks = f.values[STAT_UTIME] + f.values[STAT_STIME];
+        // threads may name themselves after they start
+        if (task.name.compare(0, std::string::npos,
+                              f.comm, f.commLen) != 0)
+            task.name.assign(f.comm, f.commLen);
+    }
+    if (rescan)
+        scanTasks();
+    return true;
+}
+
+void ProcStats::scanTasks() {
+    const std::string taskDir = procDir + "/task";
+    DIR* dir = opendir(taskDir.c_str());
+    if (dir == NULL) {
+        closeTasks();
+        return;
+    }
+
+    char buf[STAT_BUF_SIZE];
+    StatFields f;
+    std::unordered_set<long> seen;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        char* endp;
+        long tid = strtol(entry->d_name, &endp, 10);
+        if (*endp != '\0' || endp == entry->d_name)
+            continue;
+        seen.insert(tid);
+        if (tasks.find(tid) != tasks.end())
+            continue;
+
+        const std::string path =
+            taskDir + "/" + entry->d_name + "/stat";
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            continue;
+        if (!readStat(fd, f, buf)) {
+            close(fd);
+            continue;
+        }
+        Task& task = tasks[tid];
+        task.fd = fd;
+        task.name.assign(f.comm, f.commLen);
+        task.ticks = f.values[STAT_UTIME] + f.values[STAT_STIME];
+    }
+    closedir(dir);
+
+    for (auto it = tasks.begin(); it != tasks.end(); ) {
+        if (seen.find(it->first) == seen.end()) {
+            close(it->second.fd);
+            it = tasks.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void ProcStats::getThreadCpuSeconds(std::unordered_map<std::string,
+                                                       double>& cpu) const {
+    cpu.clear();
+    for (const auto& t : tasks)
+        cpu[t.second.name] += t.second.ticks / ticksPerSecond;
+}
+
+} /* namespace opflexagent */
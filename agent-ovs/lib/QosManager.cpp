@@ -37,6 +37,7 @@ namespace opflexagent {
                              boost::asio::io_service& agent_io_) :
             qosUniverseListener(*this), agent(agent_), framework(framework_),
             taskQueue(agent_io_),stopping(false){
+        taskQueue.setWatchdog(&agent.getTaskWatchdog(), "qos");
     }
 
     void QosManager::start() {
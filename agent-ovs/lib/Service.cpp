@@ -115,6 +115,10 @@ operator()(const Service::ServiceMapping& m) const noexcept {
     for (const auto& ip : m.getNextHopIPs()) {
         boost::hash_combine(v, ip);
     }
+    for (const auto& w : m.getNextHopWeights()) {
+        boost::hash_combine(v, w.first);
+        boost::hash_combine(v, w.second);
+    }
     return v;
 }
 
@@ -129,6 +133,7 @@ bool operator==(const Service::ServiceMapping& lhs,
             lhs.getServicePort() == rhs.getServicePort() &&
             lhs.getGatewayIP() == rhs.getGatewayIP() &&
             lhs.getNextHopIPs() == rhs.getNextHopIPs() &&
+            lhs.getNextHopWeights() == rhs.getNextHopWeights() &&
             lhs.getNextHopPort() == rhs.getNextHopPort() &&
             lhs.isConntrackMode() == rhs.isConntrackMode());
 }
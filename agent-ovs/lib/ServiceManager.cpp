@@ -46,10 +46,11 @@ void ServiceManager::unregisterListener(ServiceListener* listener) {
     serviceListeners.remove(listener);
 }
 
-void ServiceManager::notifyListeners(const string& uuid) {
+void ServiceManager::notifyListeners(const string& uuid,
+                                     const ServiceDelta& delta) {
     unique_lock<mutex> guard(listener_mutex);
     for (ServiceListener* listener : serviceListeners) {
-        listener->serviceUpdated(uuid);
+        listener->serviceChanged(uuid, delta);
     }
 }
 
@@ -90,6 +91,116 @@ void ServiceManager::removeDomains(const Service& service) {
     }
 }
 
+static string mappingKey(const string& ip, const string& proto,
+                         uint16_t port) {
+    return ip + "/" + proto + "/" + std::to_string(port);
+}
+
+static string mappingKey(const Service::ServiceMapping& sm) {
+    return mappingKey(sm.getServiceIP().get(),
+                      sm.getServiceProto().get_value_or(""),
+                      sm.getServicePort().get_value_or(0));
+}
+
+void ServiceManager::addMappings(const Service& service) {
+    for (const auto& sm : service.getServiceMappings()) {
+        if (!sm.getServiceIP())
+            continue;
+        mapping_aserv_map[mappingKey(sm)].insert(service.getUUID());
+        for (const string& ip : sm.getNextHopIPs())
+            nexthop_aserv_map[ip].insert(service.getUUID());
+    }
+}
+
+static void removeIndex(std::unordered_map<string, unordered_set<string> >& map,
+                        const string& key, const string& uuid) {
+    auto it = map.find(key);
+    if (it != map.end()) {
+        it->second.erase(uuid);
+        if (it->second.empty())
+            map.erase(it);
+    }
+}
+
+void ServiceManager::removeMappings(const Service& service) {
+    for (const auto& sm : service.getServiceMappings()) {
+        if (!sm.getServiceIP())
+            continue;
+        removeIndex(mapping_aserv_map, mappingKey(sm), service.getUUID());
+        for (const string& ip : sm.getNextHopIPs())
+            removeIndex(nexthop_aserv_map, ip, service.getUUID());
+    }
+}
+
+// The equality of service mappings leaves out a few settings that
+// still change the flows of the mapping
+static bool sameMapping(const Service::ServiceMapping& lhs,
+                        const Service::ServiceMapping& rhs) {
+    return (lhs == rhs &&
+            lhs.getNodePort() == rhs.getNodePort() &&
+            lhs.getClientAffinity() == rhs.getClientAffinity());
+}
+
+static void getNextHops(const Service& service,
+                        /* out */ unordered_set<string>& nextHops) {
+    for (const auto& sm : service.getServiceMappings())
+        nextHops.insert(sm.getNextHopIPs().begin(), sm.getNextHopIPs().end());
+}
+
+void ServiceManager::computeDelta(const Service* oldService,
+                                  const Service* newService,
+                                  /* out */ ServiceDelta& delta) {
+    if (!oldService || !newService) {
+        const Service* service = oldService ? oldService : newService;
+        if (!service)
+            return;
+        delta.otherChanged = true;
+        auto& mappings =
+            oldService ? delta.removedMappings : delta.addedMappings;
+        mappings.insert(mappings.end(),
+                        service->getServiceMappings().begin(),
+                        service->getServiceMappings().end());
+        getNextHops(*service, delta.changedNextHops);
+        return;
+    }
+
+    delta.otherChanged =
+        !(oldService->getDomainURI() == newService->getDomainURI() &&
+          oldService->getInterfaceName() == newService->getInterfaceName() &&
+          oldService->getIfaceVlan() == newService->getIfaceVlan() &&
+          oldService->getServiceMAC() == newService->getServiceMAC() &&
+          oldService->getIfaceIP() == newService->getIfaceIP() &&
+          oldService->getServiceMode() == newService->getServiceMode() &&
+          oldService->getServiceType() == newService->getServiceType() &&
+          oldService->getAttributes() == newService->getAttributes());
+
+    const Service::sm_set& oldMappings = oldService->getServiceMappings();
+    const Service::sm_set& newMappings = newService->getServiceMappings();
+    for (const auto& sm : newMappings) {
+        auto it = oldMappings.find(sm);
+        if (it == oldMappings.end() || !sameMapping(*it, sm))
+            delta.addedMappings.push_back(sm);
+    }
+    for (const auto& sm : oldMappings) {
+        auto it = newMappings.find(sm);
+        if (it == newMappings.end() || !sameMapping(*it, sm))
+            delta.removedMappings.push_back(sm);
+    }
+
+    unordered_set<string> oldNextHops;
+    unordered_set<string> newNextHops;
+    getNextHops(*oldService, oldNextHops);
+    getNextHops(*newService, newNextHops);
+    for (const string& ip : oldNextHops) {
+        if (newNextHops.find(ip) == newNextHops.end())
+            delta.changedNextHops.insert(ip);
+    }
+    for (const string& ip : newNextHops) {
+        if (oldNextHops.find(ip) == oldNextHops.end())
+            delta.changedNextHops.insert(ip);
+    }
+}
+
 void ServiceManager::clearSvcCounterStats (const Service& service,
                                            shared_ptr<SvcCounter> pSvc,
                                            shared_ptr<SvcTargetCounter> pSvcTgt)
@@ -472,10 +583,20 @@ void ServiceManager::updateService(const Service& service) {
     const string& uuid = service.getUUID();
     ServiceState& as = aserv_map[uuid];
 
+    ServiceDelta delta;
+    computeDelta(as.service.get(), &service, delta);
+    if (delta.empty()) {
+        // Service files get rewritten without changes, for instance
+        // when a source resyncs; nothing to do
+        LOG(DEBUG) << "Service " << uuid << " unchanged";
+        return;
+    }
+
     // update interface name to service mapping
     if (as.service) {
         removeIfaces(*as.service);
         removeDomains(*as.service);
+        removeMappings(*as.service);
     }
     if (service.getInterfaceName()) {
         iface_aserv_map[service.getInterfaceName().get()].insert(uuid);
@@ -483,6 +604,7 @@ void ServiceManager::updateService(const Service& service) {
     if (service.getDomainURI()) {
         domain_aserv_map[service.getDomainURI().get()].insert(uuid);
     }
+    addMappings(service);
 
     as.service = make_shared<const Service>(service);
 
@@ -500,25 +622,30 @@ void ServiceManager::updateService(const Service& service) {
     updateSvcObserverMoDB(service, true);
 
     guard.unlock();
-    notifyListeners(uuid);
+    notifyListeners(uuid, delta);
 }
 
 void ServiceManager::removeService(const string& uuid) {
     unique_lock<mutex> guard(serv_mutex);
+    ServiceDelta delta;
     auto it = aserv_map.find(uuid);
     if (it != aserv_map.end()) {
         // update interface name to service mapping
         ServiceState& as = it->second;
+        computeDelta(as.service.get(), NULL, delta);
         updateSvcObserverMoDB(*as.service, false);
         updateConfigMoDB(*as.service, false);
         removeIfaces(*as.service);
         removeDomains(*as.service);
+        removeMappings(*as.service);
 
         aserv_map.erase(it);
+    } else {
+        delta.otherChanged = true;
     }
 
     guard.unlock();
-    notifyListeners(uuid);
+    notifyListeners(uuid, delta);
 }
 
 void ServiceManager::getServicesByIface(const string& ifaceName,
@@ -539,6 +666,27 @@ void ServiceManager::getServicesByDomain(const opflex::modb::URI& domain,
     }
 }
 
+void ServiceManager::getServicesByMapping(const string& ip,
+                                          const string& proto,
+                                          uint16_t port,
+                                          /*out*/ unordered_set<string>& servs) {
+    unique_lock<mutex> guard(serv_mutex);
+    string_serv_map_t::const_iterator it =
+        mapping_aserv_map.find(mappingKey(ip, proto, port));
+    if (it != mapping_aserv_map.end()) {
+        servs.insert(it->second.begin(), it->second.end());
+    }
+}
+
+void ServiceManager::getServicesByNextHop(const string& ip,
+                                          /*out*/ unordered_set<string>& servs) {
+    unique_lock<mutex> guard(serv_mutex);
+    string_serv_map_t::const_iterator it = nexthop_aserv_map.find(ip);
+    if (it != nexthop_aserv_map.end()) {
+        servs.insert(it->second.begin(), it->second.end());
+    }
+}
+
 template <typename M>
 static void getSvcs(const M& map, /* out */ unordered_set<string>& svcs) {
     for (const auto& elem : map) {
@@ -33,10 +33,11 @@ void SnatManager::unregisterListener(SnatListener* listener) {
     snatListeners.remove(listener);
 }
 
-void SnatManager::notifyListeners(const string& uuid) {
+void SnatManager::notifyListeners(const string& uuid,
+                                  bool endpointsAffected) {
     unique_lock<mutex> guard(listener_mutex);
     for (SnatListener* listener : snatListeners) {
-        listener->snatUpdated(uuid);
+        listener->snatChanged(uuid, endpointsAffected);
     }
 }
 
@@ -62,20 +63,84 @@ void SnatManager::removeIfaces(const Snat& snat) {
     }
 }
 
+void SnatManager::addPorts(const Snat& snat) {
+    ip_snats_map[snat.getSnatIP()].insert(snat.getUUID());
+    PortIndex& index = port_index_map[snat.getSnatIP()];
+    for (const auto& it : snat.getPortRangeMap()) {
+        for (const auto& pr : it.second) {
+            if (pr.end < pr.start)
+                continue;
+            index.ranges[make_pair(pr.start, pr.end)].insert(snat.getUUID());
+            index.maxLength = std::max(index.maxLength,
+                                       (uint32_t)(pr.end - pr.start));
+        }
+    }
+}
+
+void SnatManager::removePorts(const Snat& snat) {
+    auto iit = ip_snats_map.find(snat.getSnatIP());
+    if (iit != ip_snats_map.end()) {
+        iit->second.erase(snat.getUUID());
+        if (iit->second.empty())
+            ip_snats_map.erase(iit);
+    }
+
+    auto pit = port_index_map.find(snat.getSnatIP());
+    if (pit == port_index_map.end())
+        return;
+    PortIndex& index = pit->second;
+    for (const auto& it : snat.getPortRangeMap()) {
+        for (const auto& pr : it.second) {
+            auto rit = index.ranges.find(make_pair(pr.start, pr.end));
+            if (rit == index.ranges.end())
+                continue;
+            rit->second.erase(snat.getUUID());
+            if (rit->second.empty())
+                index.ranges.erase(rit);
+        }
+    }
+    if (index.ranges.empty())
+        port_index_map.erase(pit);
+}
+
+/*
+ * Check whether two versions of a snat give the same flows for the
+ * endpoints using it, which only depend on its local port ranges
+ */
+static bool sameEndpointState(const Snat& lhs, const Snat& rhs) {
+    return lhs.getSnatIP() == rhs.getSnatIP() &&
+        lhs.isLocal() == rhs.isLocal() &&
+        lhs.getInterfaceName() == rhs.getInterfaceName() &&
+        lhs.getInterfaceMAC() == rhs.getInterfaceMAC() &&
+        lhs.getIfaceVlan() == rhs.getIfaceVlan() &&
+        lhs.getDest() == rhs.getDest() &&
+        lhs.getZone() == rhs.getZone() &&
+        lhs.getPortRanges("local") == rhs.getPortRanges("local");
+}
+
 void SnatManager::updateSnat(const Snat& snat) {
     unique_lock<mutex> guard(snat_mutex);
     const string& uuid = snat.getUUID();
     SnatState& as = snat_map[uuid];
+    bool endpointsAffected = true;
 
     if (as.snat) {
+        endpointsAffected = !sameEndpointState(*as.snat, snat);
+        if (!endpointsAffected &&
+            as.snat->getPortRangeMap() == snat.getPortRangeMap()) {
+            LOG(DEBUG) << "Snat " << uuid << " unchanged";
+            return;
+        }
         removeIfaces(*as.snat);
+        removePorts(*as.snat);
     }
 
     iface_snats_map[snat.getInterfaceName()].insert(uuid);
+    addPorts(snat);
     as.snat = make_shared<const Snat>(snat);
 
     guard.unlock();
-    notifyListeners(uuid);
+    notifyListeners(uuid, endpointsAffected);
 }
 
 void SnatManager::removeSnat(const string& uuid) {
@@ -84,11 +149,12 @@ void SnatManager::removeSnat(const string& uuid) {
     if (it != snat_map.end()) {
         SnatState& as = it->second;
         removeIfaces(*as.snat);
+        removePorts(*as.snat);
         snat_map.erase(it);
     }
 
     guard.unlock();
-    notifyListeners(uuid);
+    notifyListeners(uuid, true);
 }
 
 void SnatManager::addEndpoint(const string& uuid,
@@ -104,24 +170,24 @@ void SnatManager::addEndpoint(const string& uuid,
         return;
 
     epset.insert(epUuid);
+    ep_snats_map[epUuid].insert(uuid);
 }
 
 void SnatManager::delEndpoint(const string& epUuid) {
     unique_lock<mutex> guard(snat_mutex);
-    auto it1 = ep_map.begin();
-
-    while(it1 != ep_map.end()) {
-        ep_set_t& epset = it1->second;
-
-        auto it2 = epset.find(epUuid);
-        if (it2 != epset.end())
-            epset.erase(it2);
+    auto it1 = ep_snats_map.find(epUuid);
+    if (it1 == ep_snats_map.end())
+        return;
 
-        if (epset.empty())
-            it1 = ep_map.erase(it1);
-        else
-            it1++;
+    for (const string& uuid : it1->second) {
+        auto it2 = ep_map.find(uuid);
+        if (it2 == ep_map.end())
+            continue;
+        it2->second.erase(epUuid);
+        if (it2->second.empty())
+            ep_map.erase(it2);
     }
+    ep_snats_map.erase(it1);
 }
 
 void SnatManager::getEndpoints(const string& uuid,
@@ -142,4 +208,30 @@ void SnatManager::getSnatsByIface(const std::string& ifaceName,
         snats.insert(it->second.begin(), it->second.end());
     }
 }
+
+void SnatManager::getSnatsByIp(const std::string& snatIp,
+                               /* out */ snats_t& snats) {
+    unique_lock<mutex> guard(snat_mutex);
+    iface_snats_map_t::const_iterator it = ip_snats_map.find(snatIp);
+    if (it != ip_snats_map.end()) {
+        snats.insert(it->second.begin(), it->second.end());
+    }
+}
+
+void SnatManager::getSnatsByPort(const std::string& snatIp, uint16_t port,
+                                 /* out */ snats_t& snats) {
+    unique_lock<mutex> guard(snat_mutex);
+    port_index_map_t::const_iterator pit = port_index_map.find(snatIp);
+    if (pit == port_index_map.end())
+        return;
+    const PortIndex& index = pit->second;
+    auto it = index.ranges.upper_bound(make_pair(port, (uint16_t)UINT16_MAX));
+    while (it != index.ranges.begin()) {
+        --it;
+        if ((uint32_t)it->first.first + index.maxLength < port)
+            break;
+        if (it->first.second >= port)
+            snats.insert(it->second.begin(), it->second.end());
+    }
+}
 } /* namespace opflexagent */
@@ -98,8 +98,8 @@ namespace opflexagent {
                 Session::resolve(spanmanager.framework, uri);
             if (sess) {
                 LOG(DEBUG) << "update on session " << sess.get()->getURI();
-                spanmanager.processSession(sess.get());
-                spanmanager.notifyUpdate.insert(uri);
+                if (spanmanager.processSession(sess.get()))
+                    spanmanager.notifyUpdate.insert(uri);
             } else {
                 LOG(DEBUG) << "session removed " << uri;
                 shared_ptr<SessionState> sessState;
@@ -161,7 +161,11 @@ namespace opflexagent {
         }
     }
 
-    void SpanManager::processSession(const shared_ptr<Session>& sess) {
+    bool SpanManager::processSession(const shared_ptr<Session>& sess) {
+        shared_ptr<SessionState> oldState;
+        auto it = sess_map.find(sess->getURI());
+        if (it != sess_map.end())
+            oldState = it->second;
         shared_ptr<SessionState> sessState =
             make_shared<SessionState>(sess->getURI(), sess->getName().get());
         sess_map[sess->getURI()] = sessState;
@@ -177,6 +181,21 @@ namespace opflexagent {
         for (const shared_ptr<DstGrp>& dstGrp : dstGrpVec) {
             processDstGrp(dstGrp, sess->getURI());
         }
+
+        if (!oldState)
+            return true;
+        // only the changes to the session are rendered, so an update
+        // that changes nothing is not passed on
+        size_t added = sessState->countSrcEndpointsNotIn(*oldState);
+        size_t removed = oldState->countSrcEndpointsNotIn(*sessState);
+        LOG(DEBUG) << "session " << sess->getURI() << ": " << added
+                   << " source endpoints added, " << removed << " removed";
+        return added != 0 || removed != 0 ||
+            sessState->getAdminState() != oldState->getAdminState() ||
+            sessState->getDestination() != oldState->getDestination() ||
+            sessState->getDestPort() != oldState->getDestPort() ||
+            sessState->getVersion() != oldState->getVersion() ||
+            sessState->getSessionId() != oldState->getSessionId();
     }
 
     void SpanManager::processSrcGrp(const shared_ptr<SrcGrp>& srcGrp) {
@@ -261,6 +280,20 @@ namespace opflexagent {
         return !srcEndpoints.empty();
     }
 
+    size_t SessionState::countSrcEndpointsNotIn(SessionState& other) {
+        lock_guard<recursive_mutex> guard(opflexagent::SpanManager::updates);
+        size_t count = 0;
+        for (const auto& src : srcEndpoints) {
+            // the endpoints are keyed by port, so compare the
+            // direction too
+            auto it = other.srcEndpoints.find(src);
+            if (it == other.srcEndpoints.end() ||
+                it->getDirection() != src.getDirection())
+                count += 1;
+        }
+        return count;
+    }
+
     void SessionState::getSrcEndpointSet(srcEpSet& ep) {
         lock_guard<recursive_mutex> guard(opflexagent::SpanManager::updates);
         ep.insert(srcEndpoints.begin(), srcEndpoints.end());
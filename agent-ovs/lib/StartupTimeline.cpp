@@ -0,0 +1,113 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for StartupTimeline class.
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/StartupTimeline.h>
+
+#include <iomanip>
+
+namespace opflexagent {
+
+const std::string StartupTimeline::CONVERGED("converged");
+
+StartupTimeline::StartupTimeline()
+    : created(clock::now()), converged(false) {}
+
+double StartupTimeline::now() const {
+    return std::chrono::duration<double>(clock::now() - created).count();
+}
+
+StartupTimeline::Event* StartupTimeline::find(const std::string& name,
+                                              bool milestone) {
+    for (Event& e : events) {
+        if (e.milestone == milestone && e.name == name)
+            return &e;
+    }
+    return NULL;
+}
+
+void StartupTimeline::beginPhase(const std::string& name) {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (converged || find(name, false)) return;
+    double t = now();
+    events.push_back({name, t, t, false});
+}
+
+void StartupTimeline::endPhase(const std::string& name) {
+    std::lock_guard<std::mutex> guard(mutex);
+    Event* e = converged ? NULL : find(name, false);
+    if (e)
+        e->end = now();
+}
+
+void StartupTimeline::markLocked(const std::string& name,
+                                 std::unique_lock<std::mutex>& guard) {
+    if (converged || find(name, true)) return;
+    double t = now();
+    events.push_back({name, t, t, true});
+    expected.erase(name);
+    if (!expected.empty() || name == CONVERGED)
+        return;
+
+    converged = true;
+    events.push_back({CONVERGED, t, t, true});
+    converged_cb_t cb = convergedCb;
+    std::vector<Event> copy = events;
+    guard.unlock();
+    if (cb) cb(copy);
+}
+
+void StartupTimeline::mark(const std::string& name) {
+    std::unique_lock<std::mutex> guard(mutex);
+    markLocked(name, guard);
+}
+
+void StartupTimeline::expect(const std::string& name) {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (converged || find(name, true)) return;
+    expected.insert(name);
+}
+
+void StartupTimeline::setConvergedCallback(const converged_cb_t& callback) {
+    std::lock_guard<std::mutex> guard(mutex);
+    convergedCb = callback;
+}
+
+bool StartupTimeline::isConverged() {
+    std::lock_guard<std::mutex> guard(mutex);
+    return converged;
+}
+
+void StartupTimeline::getEvents(std::vector<Event>& result) {
+    std::lock_guard<std::mutex> guard(mutex);
+    result = events;
+}
+
+std::ostream& operator<<(std::ostream& os,
+                         const std::vector<StartupTimeline::Event>& events) {
+    std::ios_base::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    os << std::fixed << std::setprecision(3);
+    bool first = true;
+    for (const StartupTimeline::Event& e : events) {
+        if (first) first = false;
+        else os << std::endl;
+        os << std::setw(9) << e.start << "s ";
+        if (e.milestone)
+            os << e.name;
+        else
+            os << e.name << " (" << (e.end - e.start) << "s)";
+    }
+    os.flags(flags);
+    os.precision(precision);
+    return os;
+}
+
+} /* namespace opflexagent */
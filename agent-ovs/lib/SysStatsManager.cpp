@@ -25,21 +25,29 @@ SysStatsManager::SysStatsManager (Agent* agent_) :
                                   agent(agent_),
     prometheusManager(agent->getPrometheusManager()),
                                   timer_interval(0),
+                                  class_stats_interval(0),
                                   stopping(true) {
 }
 
 SysStatsManager::~SysStatsManager() {
 }
 
-void SysStatsManager::start (long timer_interval_) {
+void SysStatsManager::start (long timer_interval_,
+                             long class_stats_interval_) {
     stopping = false;
     timer_interval = timer_interval_;
+    class_stats_interval = class_stats_interval_;
+    next_class_stats = std::chrono::steady_clock::time_point();
     LOG(DEBUG) << "Starting sys stats manager ("
-               << timer_interval << " ms)";
+               << timer_interval << " ms, class stats "
+               << class_stats_interval << " ms)";
     std::lock_guard<std::mutex> lock(timer_mutex);
-    timer.reset(new deadline_timer(agent->getAgentIOService(),
+    timer.reset(new deadline_timer(agent->getStatsIOService(),
                                    milliseconds(timer_interval)));
-    timer->async_wait(bind(&SysStatsManager::on_timer, this, error));
+    strand.reset(new boost::asio::io_service::strand(
+                     agent->getStatsIOService()));
+    timer->async_wait(strand->wrap(
+        bind(&SysStatsManager::on_timer, this, error)));
 }
 
 void SysStatsManager::stop () {
@@ -71,12 +79,25 @@ void SysStatsManager::on_timer(const error_code& ec) {
 
     updateOpflexPeerStats();
     updateMoDBCounts();
+    // the class stats walk every object in the store, so they run on
+    // their own longer interval
+    auto now = std::chrono::steady_clock::now();
+    if (now >= next_class_stats) {
+        updateModbClassStats();
+        next_class_stats =
+            now + std::chrono::milliseconds(class_stats_interval);
+    }
+    updateProcessorStats();
+    updateNotifStats();
+    updateProcStats();
+    updateAllocStats();
 
     if (!stopping) {
         std::lock_guard<std::mutex> lock(timer_mutex);
         if (timer) {
             timer->expires_from_now(milliseconds(timer_interval));
-            timer->async_wait(bind(&SysStatsManager::on_timer, this, error));
+            timer->async_wait(strand->wrap(
+                bind(&SysStatsManager::on_timer, this, error)));
         }
     }
 }
@@ -113,6 +134,7 @@ void SysStatsManager::updateOpflexPeerStats()
                     .setStateReportErrs(peerStat.second->getStateReportErrs())
                     .setPolUnresolvedCount(peerStat.second->getPolUnresolvedCount());
             prometheusManager.addNUpdateOFPeerStats(peerStat.first, peerStat.second);
+            prometheusManager.addNUpdateOFPeerLatency(peerStat.first, peerStat.second);
         }
         // Remove mos for deleted connections
         std::vector<std::shared_ptr<modelgbp::observer::OpflexAgentCounter> > out;
@@ -124,6 +146,7 @@ void SysStatsManager::updateOpflexPeerStats()
                 if (stats.find(peer.get()) == stats.end()) {
                     peerCounter->remove();
                     prometheusManager.removeOFPeerStats(peer.get());
+                    prometheusManager.removeOFPeerLatency(peer.get());
                 }
             }
         }
@@ -131,6 +154,93 @@ void SysStatsManager::updateOpflexPeerStats()
     mutator.commit();
 }
 
+// Update approximate memory accounting per class in MoDB
+void SysStatsManager::updateModbClassStats()
+{
+    opflex::modb::class_stats_map_t stats;
+    agent->getFramework().getStoreStats(stats);
+
+    std::unordered_set<std::string> classes;
+    for (const auto& cs : stats) {
+        if (cs.second.instances == 0) continue;
+        classes.insert(cs.first);
+        prometheusManager.addNUpdateModbClassStats(cs.first, cs.second);
+    }
+    for (const std::string& c : modbClasses) {
+        if (classes.find(c) == classes.end())
+            prometheusManager.removeModbClassStats(c);
+    }
+    modbClasses.swap(classes);
+}
+
+// Update the processor backlog per item state, its latency histograms
+// and the dataplane latency histograms
+void SysStatsManager::updateProcessorStats()
+{
+    std::unordered_map<std::string, uint64_t> counts;
+    agent->getFramework().getProcessorStats(counts);
+    for (const auto& c : counts)
+        prometheusManager.addNUpdateProcessorStats(c.first, c.second);
+
+    std::unordered_map<std::string,
+        std::shared_ptr<const OFLatencyHistogram> > latency;
+    agent->getFramework().getResolveLatencyStats(latency);
+    prometheusManager.addNUpdateProcessorLatency(
+        agent->getFramework().getProcessTimeStats(), latency);
+    prometheusManager.addNUpdateDataplaneLatency(
+        agent->getDataplaneLatency());
+    prometheusManager.addNUpdateFlowProgrammingStats(
+        agent->getFlowProgrammingStats());
+    prometheusManager.addNUpdateTaskWatchdogStats(agent->getTaskWatchdog());
+}
+
+// Update the counters of the notification server
+void SysStatsManager::updateNotifStats()
+{
+    std::unordered_map<std::string, uint64_t> counts;
+    agent->getNotifServer().getStats(counts);
+    for (const auto& c : counts)
+        prometheusManager.addNUpdateNotifStats(c.first, c.second);
+}
+
+// Update the CPU and memory use of the agent and the CPU time per thread
+void SysStatsManager::updateProcStats()
+{
+    if (!procStats.sample())
+        return;
+    prometheusManager.addNUpdateProcessStats("cpu_seconds",
+                                             procStats.getCpuSeconds());
+    prometheusManager.addNUpdateProcessStats("rss_bytes",
+                                             procStats.getRssBytes());
+    prometheusManager.addNUpdateProcessStats("threads",
+                                             procStats.getThreadCount());
+
+    std::unordered_map<std::string, double> cpu;
+    procStats.getThreadCpuSeconds(cpu);
+    for (const auto& c : cpu)
+        prometheusManager.addNUpdateThreadCpu(c.first, c.second);
+    for (const auto& c : threadCpu) {
+        if (cpu.find(c.first) == cpu.end())
+            prometheusManager.removeThreadCpu(c.first);
+    }
+    threadCpu.swap(cpu);
+}
+
+// Update the bytes held by the memory allocator and its fragmentation
+void SysStatsManager::updateAllocStats()
+{
+    if (!allocStats.sample())
+        return;
+    prometheusManager.addNUpdateProcessStats("alloc_allocated_bytes",
+        allocStats.getAllocatedBytes());
+    prometheusManager.addNUpdateProcessStats("alloc_active_bytes",
+        allocStats.getActiveBytes());
+    prometheusManager.addNUpdateProcessStats("alloc_resident_bytes",
+        allocStats.getResidentBytes());
+    prometheusManager.addNUpdateProcessStats("alloc_fragmentation",
+        allocStats.getFragmentation());
+}
+
 // Update total count per object type in MoDB
 void SysStatsManager::updateMoDBCounts()
 {
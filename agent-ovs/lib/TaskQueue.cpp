@@ -12,16 +12,12 @@
 namespace opflexagent {
 
 TaskQueue::TaskQueue(boost::asio::io_service& io_service_)
-    : io_service(io_service_) {
+    : io_service(io_service_), latency(NULL), watchdog(NULL) {
 
 }
 
 void TaskQueue::run_task(const std::string& taskId,
                          const std::function<void ()>& task) {
-    {
-        std::unique_lock<std::mutex> guard(queueMutex);
-        queuedItems.erase(taskId);
-    }
     try {
         task();
     } catch (const std::exception& e) {
@@ -32,13 +28,146 @@ void TaskQueue::run_task(const std::string& taskId,
     }
 }
 
+void TaskQueue::run_next() {
+    Item item;
+    {
+        std::unique_lock<std::mutex> guard(queueMutex);
+        for (int p = HIGH; p >= LOW; --p) {
+            if (!lanes[p].empty()) {
+                item = std::move(lanes[p].front());
+                lanes[p].pop_front();
+                break;
+            }
+        }
+        if (!item.task) return;
+
+        if (runningItems.find(item.taskId) != runningItems.end()) {
+            // still queued, so it is not dispatched again meanwhile
+            std::string taskId = item.taskId;
+            deferredItems.emplace(taskId, std::move(item));
+            return;
+        }
+        queuedItems.erase(item.taskId);
+        runningItems.insert(item.taskId);
+    }
+
+    {
+        using opflex::modb::TraceContext;
+        const TraceContext::Scope trace(item.origin);
+        if (latency && TraceContext::isTraced()) {
+            latency->observe(DataplaneLatency::NOTIFY,
+                             item.queued - item.origin);
+            latency->observe(DataplaneLatency::QUEUE,
+                             TraceContext::getStart() - item.queued);
+        }
+        uint64_t token = watchdog ? watchdog->begin(name, item.taskId) : 0;
+        if (timer) {
+            auto start = std::chrono::steady_clock::now();
+            run_task(item.taskId, item.task);
+            timer(item.taskId, std::chrono::steady_clock::now() - start);
+        } else {
+            run_task(item.taskId, item.task);
+        }
+        if (watchdog)
+            watchdog->end(token);
+    }
+
+    bool requeued = false;
+    {
+        std::unique_lock<std::mutex> guard(queueMutex);
+        runningItems.erase(item.taskId);
+        auto it = deferredItems.find(item.taskId);
+        if (it != deferredItems.end()) {
+            Item& next = it->second;
+            lanes[next.priority].push_front(std::move(next));
+            deferredItems.erase(it);
+            requeued = true;
+        }
+    }
+    if (requeued)
+        io_service.post([this]() { run_next(); });
+}
+
+void TaskQueue::drain_inbox() {
+    size_t queued = 0;
+    {
+        std::unique_lock<std::mutex> guard(queueMutex);
+        // drained under the lock so that batches are queued in order
+        Item* item = inbox.drain();
+        while (item) {
+            std::unique_ptr<Item> owned(item);
+            item = item->next;
+            // the first request for a task ID wins until it starts
+            if (!queuedItems.insert(owned->taskId).second) continue;
+            lanes[owned->priority].push_back(std::move(*owned));
+            queued += 1;
+        }
+    }
+    for (size_t i = 0; i < queued; ++i)
+        io_service.post([this]() { run_next(); });
+}
+
 void TaskQueue::dispatch(const std::string& taskId,
-                         const std::function<void ()>& task) {
+                         const std::function<void ()>& task,
+                         Priority priority) {
+    Item* item = new Item(taskId, task, priority);
+    item->origin = opflex::modb::TraceContext::getOrigin();
+    if (item->origin != DataplaneLatency::clock::time_point())
+        item->queued = DataplaneLatency::clock::now();
+    if (inbox.push(item))
+        io_service.post([this]() { drain_inbox(); });
+}
+
+void TaskQueue::dispatchDebounced(const std::string& taskId,
+                                  std::chrono::milliseconds delay,
+                                  const std::function<void ()>& task,
+                                  std::chrono::milliseconds maxDelay,
+                                  Priority priority) {
+    if (delay.count() <= 0) {
+        dispatch(taskId, task, priority);
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> guard(queueMutex);
+    DebouncedItem& item = debouncedItems[taskId];
+    item.task = task;
+    item.priority = priority;
+    if (!item.timer) {
+        item.first = now;
+        item.timer.reset(new boost::asio::steady_timer(io_service));
+    }
+    if (item.origin == DataplaneLatency::clock::time_point())
+        item.origin = opflex::modb::TraceContext::getOrigin();
+    // this cancels the current wait, if any
+    item.timer->expires_at(std::min(now + delay, item.first + maxDelay));
+    item.timer->async_wait([this, taskId](const boost::system::error_code& ec) {
+            on_debounce(taskId, ec);
+        });
+}
+
+void TaskQueue::on_debounce(const std::string& taskId,
+                            const boost::system::error_code& ec) {
+    if (ec) return;
+
+    std::function<void ()> task;
+    Priority priority;
+    DataplaneLatency::clock::time_point origin;
     {
         std::unique_lock<std::mutex> guard(queueMutex);
-        if (!queuedItems.insert(taskId).second) return;
+        auto it = debouncedItems.find(taskId);
+        // a wait that completed just as a new request moved the
+        // deadline finds it still in the future
+        if (it == debouncedItems.end() ||
+            it->second.timer->expires_at() > std::chrono::steady_clock::now())
+            return;
+        task = std::move(it->second.task);
+        priority = it->second.priority;
+        origin = it->second.origin;
+        debouncedItems.erase(it);
     }
-    io_service.post([=]() { TaskQueue::run_task(taskId, task); });
+    const opflex::modb::TraceContext::Scope trace(origin);
+    dispatch(taskId, task, priority);
 }
 
 } // namespace opflexagent
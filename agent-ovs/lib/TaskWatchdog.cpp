@@ -0,0 +1,179 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for TaskWatchdog class.
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/TaskWatchdog.h>
+#include <opflexagent/logging.h>
+#include <opflex/util/ThreadSettings.h>
+
+#include <algorithm>
+
+namespace opflexagent {
+
+using std::chrono::milliseconds;
+using std::chrono::duration_cast;
+
+/* how often the lag of an io_service is measured */
+static const milliseconds PROBE_INTERVAL(1000);
+
+static uint64_t toMs(TaskWatchdog::clock::duration d) {
+    auto ms = duration_cast<milliseconds>(d).count();
+    return ms > 0 ? ms : 0;
+}
+
+TaskWatchdog::TaskWatchdog()
+    : threshold(1000), running(false), nextToken(0), slowTasks(0) {}
+
+TaskWatchdog::~TaskWatchdog() {
+    stop();
+}
+
+void TaskWatchdog::setThreshold(milliseconds threshold_) {
+    std::lock_guard<std::mutex> guard(mutex);
+    threshold = threshold_;
+}
+
+void TaskWatchdog::start() {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (running) return;
+    running = true;
+    thread = opflex::util::startThread("watchdog", [this]() { run(); });
+}
+
+void TaskWatchdog::stop() {
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        // destroying the timers cancels the probes
+        for (auto& l : loops)
+            l.second.timer.reset();
+        if (!running) return;
+        running = false;
+    }
+    cond.notify_all();
+    thread.join();
+}
+
+void TaskWatchdog::monitor(const std::string& name,
+                           boost::asio::io_service& io_service) {
+    std::lock_guard<std::mutex> guard(mutex);
+    Loop& loop = loops[name];
+    if (!loop.lag)
+        loop.lag = std::make_shared<OFLatencyHistogram>();
+    loop.timer.reset(new boost::asio::steady_timer(io_service));
+    schedule(name, loop);
+}
+
+// must hold mutex
+void TaskWatchdog::schedule(const std::string& name, Loop& loop) {
+    loop.deadline = clock::now() + PROBE_INTERVAL;
+    loop.reported = false;
+    loop.timer->expires_at(loop.deadline);
+    loop.timer->async_wait([this, name](const boost::system::error_code& ec) {
+            probe(name, ec);
+        });
+}
+
+void TaskWatchdog::probe(const std::string& name,
+                         const boost::system::error_code& ec) {
+    if (ec) return;
+    auto now = clock::now();
+    std::lock_guard<std::mutex> guard(mutex);
+    auto it = loops.find(name);
+    if (it == loops.end() || !it->second.timer) return;
+    Loop& loop = it->second;
+    uint64_t lag = toMs(now - loop.deadline);
+    loop.lag->observe(lag);
+    if (loop.reported) {
+        LOG(WARNING) << "Event loop " << name << " ran again after "
+                     << lag << " ms";
+    }
+    schedule(name, loop);
+}
+
+uint64_t TaskWatchdog::begin(const std::string& queue,
+                             const std::string& taskId) {
+    std::lock_guard<std::mutex> guard(mutex);
+    uint64_t token = ++nextToken;
+    tasks.emplace(token, Running{queue, taskId, clock::now(), false});
+    return token;
+}
+
+void TaskWatchdog::end(uint64_t token) {
+    auto now = clock::now();
+    std::lock_guard<std::mutex> guard(mutex);
+    auto it = tasks.find(token);
+    if (it == tasks.end()) return;
+    const Running& task = it->second;
+    uint64_t elapsed = toMs(now - task.start);
+
+    std::shared_ptr<OFLatencyHistogram>& hist = taskTimes[task.queue];
+    if (!hist)
+        hist = std::make_shared<OFLatencyHistogram>();
+    hist->observe(elapsed);
+
+    if (threshold.count() > 0 &&
+        elapsed > static_cast<uint64_t>(threshold.count())) {
+        slowTasks += 1;
+        LOG(WARNING) << "Slow task " << task.taskId << " on queue "
+                     << task.queue << " ran for " << elapsed << " ms";
+    }
+    tasks.erase(it);
+}
+
+void TaskWatchdog::getTaskTimes(/* out */ hist_map_t& hists) const {
+    std::lock_guard<std::mutex> guard(mutex);
+    for (const auto& t : taskTimes)
+        hists[t.first] = t.second;
+}
+
+void TaskWatchdog::getLoopLag(/* out */ hist_map_t& hists) const {
+    std::lock_guard<std::mutex> guard(mutex);
+    for (const auto& l : loops)
+        hists[l.first] = l.second.lag;
+}
+
+uint64_t TaskWatchdog::getSlowTaskCount() const {
+    std::lock_guard<std::mutex> guard(mutex);
+    return slowTasks;
+}
+
+void TaskWatchdog::run() {
+    std::unique_lock<std::mutex> guard(mutex);
+    while (running) {
+        milliseconds wait = threshold.count() > 0
+            ? std::max(milliseconds(100), std::min(threshold / 2,
+                                                   PROBE_INTERVAL))
+            : PROBE_INTERVAL;
+        cond.wait_for(guard, wait);
+        if (!running || threshold.count() <= 0) continue;
+
+        // report what is stalled now, once per task or stall
+        auto now = clock::now();
+        for (auto& t : tasks) {
+            Running& task = t.second;
+            if (task.reported || now - task.start <= threshold) continue;
+            task.reported = true;
+            LOG(WARNING) << "Task " << task.taskId << " on queue "
+                         << task.queue << " has been running for "
+                         << toMs(now - task.start) << " ms";
+        }
+        for (auto& l : loops) {
+            Loop& loop = l.second;
+            if (!loop.timer || loop.reported ||
+                now - loop.deadline <= threshold) continue;
+            loop.reported = true;
+            LOG(WARNING) << "Event loop " << l.first
+                         << " has not run for "
+                         << toMs(now - loop.deadline) << " ms";
+        }
+    }
+}
+
+} /* namespace opflexagent */
@@ -14,6 +14,12 @@
 #include <arpa/inet.h>
 #include <ifaddrs.h>
 #endif
+#ifdef HAVE_LINUX_RTNETLINK_H
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#endif
 #include <fstream>
 #include <cerrno>
 #include <random>
@@ -46,11 +52,19 @@ using boost::asio::placeholders::error;
 using boost::posix_time::milliseconds;
 using boost::system::error_code;
 
+/*
+ * The time to wait after an rtnetlink event before discovering the
+ * uplink address, so that the events of a single change, such as an
+ * interface coming up with its addresses and routes, lead to a single
+ * discovery
+ */
+static const long EVENT_DELAY_MS = 100;
+
 TunnelEpManager::TunnelEpManager(Agent* agent_, long timer_interval_)
     : agent(agent_), renderer(nullptr),
       agent_io(agent_->getAgentIOService()),
-      timer_interval(timer_interval_), stopping(false), uplinkVlan(0),
-      terminationIpIsV4(false) {
+      timer_interval(timer_interval_), polling(true), updatePending(false),
+      stopping(false), uplinkVlan(0), terminationIpIsV4(false) {
     std::random_device rng;
     std::mt19937 urng(rng());
     tunnelEpUUID = to_string(basic_random_generator<std::mt19937>(urng)());
@@ -72,8 +86,13 @@ void TunnelEpManager::start() {
     mutator.commit();
 
 #ifdef HAVE_IFADDRS_H
+    // events are subscribed to before the initial discovery, so that
+    // no change goes unnoticed
+    polling = (renderer && renderer->isUplinkAddressImplemented()) ||
+        !openNetlink();
     const std::lock_guard<std::mutex> guard(timer_mutex);
     timer.reset(new deadline_timer(agent_io, milliseconds(0)));
+    updatePending = true;
     timer->async_wait(bind(&TunnelEpManager::on_timer, this, error));
 #else
     LOG(ERROR) << "Cannot enumerate interfaces: unsupported platform";
@@ -89,6 +108,10 @@ void TunnelEpManager::stop() {
     if (timer) {
         timer->cancel();
     }
+    if (nlSocket) {
+        error_code ec;
+        nlSocket->cancel(ec);
+    }
 }
 
 const std::string& TunnelEpManager::getTerminationIp(const std::string& uuid) {
@@ -168,6 +191,141 @@ static string getInterfaceAddressV4(const string& iface) {
 }
 #endif
 
+bool TunnelEpManager::openNetlink() {
+#ifdef HAVE_LINUX_RTNETLINK_H
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0) {
+        int err = errno;
+        LOG(WARNING) << "Could not open rtnetlink socket, polling for "
+                     << "the uplink address: " << strerror(err);
+        return false;
+    }
+    struct sockaddr_nl addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR |
+        RTMGRP_IPV4_ROUTE | RTMGRP_IPV6_ROUTE;
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        int err = errno;
+        close(fd);
+        LOG(WARNING) << "Could not subscribe to rtnetlink events, polling "
+                     << "for the uplink address: " << strerror(err);
+        return false;
+    }
+
+    const std::lock_guard<std::mutex> guard(timer_mutex);
+    nlBuffer.resize(32768);
+    nlSocket.reset(new boost::asio::posix::stream_descriptor(agent_io, fd));
+    readNetlink();
+    return true;
+#else
+    return false;
+#endif
+}
+
+void TunnelEpManager::readNetlink() {
+    nlSocket->async_read_some(boost::asio::buffer(nlBuffer),
+        [this](const error_code& ec, size_t len) {
+            if (ec == boost::asio::error::no_buffer_space) {
+                // the socket overflowed, so events may have been lost
+                LOG(WARNING) << "rtnetlink events lost, rediscovering "
+                             << "the uplink address";
+                scheduleUpdate();
+            } else if (ec) {
+                const std::lock_guard<std::mutex> guard(timer_mutex);
+                nlSocket.reset();
+                if (stopping || ec == boost::asio::error::operation_aborted)
+                    return;
+                LOG(ERROR) << "Could not read rtnetlink events, polling "
+                           << "for the uplink address: " << ec.message();
+                polling = true;
+                if (timer && !updatePending) {
+                    updatePending = true;
+                    timer->expires_from_now(milliseconds(timer_interval));
+                    timer->async_wait(bind(&TunnelEpManager::on_timer,
+                                           this, error));
+                }
+                return;
+            } else if (isUplinkEvent(len)) {
+                scheduleUpdate();
+            }
+
+            const std::lock_guard<std::mutex> guard(timer_mutex);
+            if (nlSocket && !stopping)
+                readNetlink();
+        });
+}
+
+bool TunnelEpManager::isUplinkEvent(size_t len) {
+#ifdef HAVE_LINUX_RTNETLINK_H
+    // without an uplink interface, any interface may hold the address
+    // to use; the uplink interface may also be gone, and come back
+    // with another index
+    int uplinkIndex = 0;
+    if (!uplinkIface.empty())
+        uplinkIndex = if_nametoindex(uplinkIface.c_str());
+    if (uplinkIndex == 0)
+        return true;
+    return isInterfaceEvent(nlBuffer.data(), len, uplinkIndex);
+#else
+    return false;
+#endif
+}
+
+bool TunnelEpManager::isInterfaceEvent(const char* buf, size_t len,
+                                       int ifIndex) {
+#ifdef HAVE_LINUX_RTNETLINK_H
+    for (const struct nlmsghdr* nh = (const struct nlmsghdr*)buf;
+         NLMSG_OK(nh, len); nh = NLMSG_NEXT(nh, len)) {
+        int index = 0;
+        switch (nh->nlmsg_type) {
+        case RTM_NEWLINK:
+        case RTM_DELLINK:
+            if (NLMSG_PAYLOAD(nh, 0) < sizeof(struct ifinfomsg))
+                continue;
+            index = ((const struct ifinfomsg*)NLMSG_DATA(nh))->ifi_index;
+            break;
+        case RTM_NEWADDR:
+        case RTM_DELADDR:
+            if (NLMSG_PAYLOAD(nh, 0) < sizeof(struct ifaddrmsg))
+                continue;
+            index = ((const struct ifaddrmsg*)NLMSG_DATA(nh))->ifa_index;
+            break;
+        case RTM_NEWROUTE:
+        case RTM_DELROUTE: {
+            if (NLMSG_PAYLOAD(nh, 0) < sizeof(struct rtmsg))
+                continue;
+            // a route is for the interface if it goes out of it
+            const struct rtattr* rta = RTM_RTA(NLMSG_DATA(nh));
+            int rtaLen = RTM_PAYLOAD(nh);
+            for (; RTA_OK(rta, rtaLen); rta = RTA_NEXT(rta, rtaLen)) {
+                if (rta->rta_type == RTA_OIF &&
+                    RTA_PAYLOAD(rta) >= sizeof(int)) {
+                    index = *(const int*)RTA_DATA(rta);
+                    break;
+                }
+            }
+            break;
+        }
+        default:
+            continue;
+        }
+        if (index == ifIndex)
+            return true;
+    }
+#endif
+    return false;
+}
+
+void TunnelEpManager::scheduleUpdate() {
+    const std::lock_guard<std::mutex> guard(timer_mutex);
+    if (stopping || !timer || updatePending)
+        return;
+    updatePending = true;
+    timer->expires_from_now(milliseconds(EVENT_DELAY_MS));
+    timer->async_wait(bind(&TunnelEpManager::on_timer, this, error));
+}
+
 void TunnelEpManager::on_timer(const error_code& ec) {
     if (ec) {
         // shut down the timer when we get a cancellation
@@ -175,6 +333,11 @@ void TunnelEpManager::on_timer(const error_code& ec) {
         timer.reset();
         return;
     }
+    {
+        // an event during the discovery schedules another one
+        const std::lock_guard<std::mutex> guard(timer_mutex);
+        updatePending = false;
+    }
 
     string bestAddress;
     string bestIface;
@@ -307,8 +470,9 @@ void TunnelEpManager::on_timer(const error_code& ec) {
         notifyListeners(tunnelEpUUID);
     }
 
-    if (!stopping) {
-        const std::lock_guard<std::mutex> guard(timer_mutex);
+    const std::lock_guard<std::mutex> guard(timer_mutex);
+    if (!stopping && polling && !updatePending) {
+        updatePending = true;
         timer->expires_at(timer->expires_at() + milliseconds(timer_interval));
         timer->async_wait(bind(&TunnelEpManager::on_timer, this, error));
     }
@@ -0,0 +1,120 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for WorkerPool class.
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/WorkerPool.h>
+#include <opflex/util/ThreadSettings.h>
+
+namespace opflexagent {
+
+typedef std::unique_lock<std::mutex> mutex_guard;
+
+WorkerPool::WorkerPool(const std::string& name_)
+    : name(name_), stopping(false), loop(NULL), loopSize(0), generation(0), busy(0),
+      nextIndex(0) {
+}
+
+WorkerPool::~WorkerPool() {
+    stop();
+}
+
+void WorkerPool::start(size_t count) {
+    mutex_guard lock(mutex);
+    stopping = false;
+    for (size_t i = 0; i < count; ++i)
+        threads.emplace_back(
+            opflex::util::startThread(name, [this]() { run(); }));
+}
+
+void WorkerPool::stop() {
+    const std::lock_guard<std::mutex> loopLock(loopMutex);
+    {
+        mutex_guard lock(mutex);
+        stopping = true;
+    }
+    workCond.notify_all();
+    for (std::thread& t : threads)
+        t.join();
+    threads.clear();
+}
+
+void WorkerPool::runIterations(const std::function<void (size_t)>& func,
+                               size_t n) {
+    size_t i;
+    while ((i = nextIndex.fetch_add(1)) < n) {
+        try {
+            func(i);
+        } catch (...) {
+            mutex_guard lock(mutex);
+            if (!error)
+                error = std::current_exception();
+        }
+    }
+}
+
+void WorkerPool::run() {
+    size_t seen = 0;
+    mutex_guard lock(mutex);
+    while (true) {
+        workCond.wait(lock, [this, &seen]() {
+                return stopping || generation != seen;
+            });
+        if (stopping)
+            return;
+        seen = generation;
+        // the loop may be over by the time this thread wakes up
+        if (!loop)
+            continue;
+
+        const std::function<void (size_t)>& func = *loop;
+        size_t n = loopSize;
+        busy += 1;
+        lock.unlock();
+        runIterations(func, n);
+        lock.lock();
+        if (--busy == 0)
+            doneCond.notify_all();
+    }
+}
+
+void WorkerPool::forEach(size_t n, const std::function<void (size_t)>& func) {
+    const std::lock_guard<std::mutex> loopLock(loopMutex);
+    if (threads.empty() || n < 2) {
+        for (size_t i = 0; i < n; ++i)
+            func(i);
+        return;
+    }
+
+    {
+        mutex_guard lock(mutex);
+        loop = &func;
+        loopSize = n;
+        nextIndex = 0;
+        error = nullptr;
+        generation += 1;
+    }
+    workCond.notify_all();
+
+    runIterations(func, n);
+
+    std::exception_ptr e;
+    {
+        mutex_guard lock(mutex);
+        // workers that did not join yet will not
+        loop = NULL;
+        doneCond.wait(lock, [this]() { return busy == 0; });
+        e = error;
+        error = nullptr;
+    }
+    if (e)
+        std::rethrow_exception(e);
+}
+
+} /* namespace opflexagent */
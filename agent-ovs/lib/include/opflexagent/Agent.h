@@ -28,6 +28,11 @@
 #include <opflexagent/NetFlowManager.h>
 #include <opflexagent/QosManager.h>
 #include <opflexagent/SysStatsManager.h>
+#include <opflexagent/StartupTimeline.h>
+#include <opflexagent/DataplaneLatency.h>
+#include <opflexagent/FlowProgrammingStats.h>
+#include <opflexagent/PollScheduler.h>
+#include <opflexagent/TaskWatchdog.h>
 
 #include <opflexagent/PrometheusManager.h>
 
@@ -37,6 +42,7 @@
 #include <boost/noncopyable.hpp>
 #include <opflex/ofcore/OFFramework.h>
 #include <opflex/ofcore/OFConstants.h>
+#include <opflex/ofcore/PeerStatusListener.h>
 #include <modelgbp/metadata/metadata.hpp>
 
 #include <atomic>
@@ -56,6 +62,7 @@ namespace opflexagent {
 class Renderer;
 class RendererPlugin;
 class EndpointSource;
+class DBEndpointSource;
 class FaultSource;
 class ServiceSource;
 class FSRDConfigSource;
@@ -108,6 +115,21 @@ public:
      */
     void applyProperties();
 
+    /**
+     * Apply a new configuration to the running agent in place.  The
+     * trees are those of the configuration files, in the order they
+     * would be passed to setProperties.  Only the settings that differ
+     * from the current configuration are applied: the log level, the
+     * slow task threshold, new OpFlex peers, and the settings of the
+     * renderers that they can apply in place.
+     *
+     * @param properties the new configuration
+     * @return true if the configuration was applied, or false without
+     * applying the agent settings if the agent must be restarted to
+     * apply it
+     */
+    bool reloadProperties(const std::vector<boost::property_tree::ptree>& properties);
+
     /**
      * Start the agent
      */
@@ -227,6 +249,25 @@ public:
      */
     boost::asio::io_service& getAgentIOService() { return agent_io; }
 
+    /**
+     * Get the ASIO service for periodic statistics collection.  It is
+     * run by its own pool of threads, so that polling for statistics
+     * does not delay the tasks of the agent io service thread.  A
+     * manager whose handlers must not run concurrently should wrap
+     * them in its own strand.
+     *
+     * @return the asio io service for statistics
+     */
+    boost::asio::io_service& getStatsIOService() { return stats_io; }
+
+    /**
+     * Get the scheduler that spreads the polls of the statistics
+     * managers across their intervals
+     *
+     * @return the poll scheduler
+     */
+    PollScheduler& getStatsPollScheduler() { return statsPollScheduler; }
+
     /**
      * Get a unique identifer for the agent incarnation
      */
@@ -283,6 +324,30 @@ public:
         return prometheusEpAttributes;
     }
 
+    /**
+     * Get the timeline of the startup phases and milestones of this
+     * agent
+     */
+    StartupTimeline& getStartupTimeline() { return startupTimeline; }
+
+    /**
+     * Get the histograms of the latency from policy and endpoint
+     * changes to the flows acknowledged by the switch
+     */
+    DataplaneLatency& getDataplaneLatency() { return dataplaneLatency; }
+
+    /**
+     * Get the statistics of the flows programmed into each bridge
+     */
+    FlowProgrammingStats& getFlowProgrammingStats() {
+        return flowProgrammingStats;
+    }
+
+    /**
+     * Get the watchdog timing the tasks and event loops of this agent
+     */
+    TaskWatchdog& getTaskWatchdog() { return taskWatchdog; }
+
     /**
      * Get packet event notification socket file name
      */
@@ -295,8 +360,33 @@ public:
     static void createUniverse(std::shared_ptr<modelgbp::dmtree::Root> root);
 
 private:
+    StartupTimeline startupTimeline;
+
+    /**
+     * Record the opflex milestones of the startup
+     */
+    class StartupPeerListener : public opflex::ofcore::PeerStatusListener {
+    public:
+        StartupPeerListener(StartupTimeline& timeline_)
+            : timeline(timeline_) {}
+        virtual void peerStatusUpdated(const std::string& peerHostname,
+                                       int peerPort,
+                                       PeerStatus peerStatus) override;
+    private:
+        StartupTimeline& timeline;
+    };
+    StartupPeerListener startupPeerListener;
+    DataplaneLatency dataplaneLatency;
+    FlowProgrammingStats flowProgrammingStats;
+
     boost::asio::io_service agent_io;
     std::unique_ptr<boost::asio::io_service::work> io_work;
+    boost::asio::io_service stats_io;
+    std::unique_ptr<boost::asio::io_service::work> stats_io_work;
+    /* after the io_services, as its probes must be destroyed first */
+    TaskWatchdog taskWatchdog;
+    PollScheduler statsPollScheduler;
+    size_t statsIOThreads;
 
     opflex::ofcore::OFFramework& framework;
     AgentPrometheusManager prometheusManager;
@@ -322,21 +412,50 @@ private:
     boost::optional<std::string> notifOwner;
     boost::optional<std::string> notifGroup;
     boost::optional<std::string> notifPerms;
+    boost::optional<size_t> notifMaxQueued;
     // stats simulation
     StatMode statMode = StatMode::REAL;
 
     // timers
     // prr timer - policy resolve request timer
     boost::uint_t<64>::fast prr_timer = 7200;  /* seconds */
+    /* endpoint lease to request from the peer; 0 uses the prr timer */
+    uint64_t endpointLease = 0;  /* seconds */
+    /* buckets the endpoint lease renewals are grouped into */
+    size_t renewalBuckets = 16;
     /* handshake timeout */
     uint32_t peerHandshakeTimeout = 45000;
     /* keepalive timeout */
     uint32_t keepaliveTimeout = 120000;
+    /* threads delivering MODB notifications */
+    size_t notifWorkers = 1;
+    /* changes retained in the MODB change journal */
+    size_t journalSize = 0;
+    /* threads processing OpFlex object synchronization */
+    size_t procThreads = 1;
+    /* share resolves and declares across the ready peers */
+    bool loadSharing = false;
+    /* offer compression to the OpFlex peers */
+    bool compression = false;
+    /* offer the binary encoding to the OpFlex peers */
+    bool binaryEncoding = false;
+    /* size from which OpFlex messages are parsed on worker threads */
+    size_t parseOffload = 0;
+    /* minimum interval between state reports of an observable (ms) */
+    uint64_t stateReportInterval = 0;
+    /* bytes of state reports sent to each observer per second */
+    uint64_t stateReportBudget = 0;
+    /* file caching the resolved policy across restarts */
+    std::string policyCacheFile;
+    /* interval between writes of the policy cache (ms) */
+    uint64_t policyCacheInterval = 5*60*1000;
 
     std::set<std::string> endpointSourceFSPaths;
     std::set<std::string> disabledFeaturesSet;
     std::set<std::string> endpointSourceModelLocalNames;
     std::vector<std::unique_ptr<EndpointSource>> endpointSources;
+    std::set<std::string> endpointSourceDBPaths;
+    std::vector<std::unique_ptr<DBEndpointSource>> dbEndpointSources;
     std::vector<std::unique_ptr<FSRDConfigSource>> rdConfigSources;
     std::vector<std::unique_ptr<LearningBridgeSource>> learningBridgeSources;
     std::string dropLogCfgSourcePath;
@@ -369,6 +488,11 @@ private:
      */
     std::unique_ptr<std::thread> io_service_thread;
 
+    /**
+     * Threads for statistics collection
+     */
+    std::vector<std::thread> stats_io_threads;
+
     std::atomic<bool> started;
     opflex_elem_t presetFwdMode;
 
@@ -378,6 +502,13 @@ private:
 
     static StatMode getStatModeFromString(const std::string& mode);
 
+    /* the configuration trees passed to setProperties, in order */
+    std::vector<boost::property_tree::ptree> configProperties;
+
+    boost::optional<boost::property_tree::ptree>
+    getRendererConfig(const std::vector<boost::property_tree::ptree>& properties,
+                      const std::string& name) const;
+
     SpanManager spanManager;
     NetFlowManager netflowManager;
     QosManager qosManager;
@@ -385,6 +516,7 @@ private:
     // System Stats
     bool sysStatsEnabled;
     long sysStatsInterval;
+    long sysClassStatsInterval;
 
     // feature flag array
     bool featureFlag[FeatureList::MAX];
@@ -393,6 +525,8 @@ private:
     bool prometheusEnabled;
     bool prometheusExposeLocalHostOnly;
     bool prometheusExposeEpSvcNan;
+    bool prometheusExposeGroupPaths;
+    AgentPrometheusManager::CardinalityBudget prometheusBudget;
     std::unordered_set<std::string> prometheusEpAttributes;
     bool behaviorL34FlowsWithoutSubnet;
     LogParams logParams;
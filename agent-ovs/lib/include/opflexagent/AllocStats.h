@@ -0,0 +1,102 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for AllocStats
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_ALLOCSTATS_H
+#define OPFLEXAGENT_ALLOCSTATS_H
+
+#include <cstdint>
+#include <string>
+
+namespace opflexagent {
+
+/**
+ * Query and control the memory allocator the agent is linked with.
+ *
+ * The agent can be built against jemalloc or tcmalloc, which report
+ * detailed statistics and can write heap profiles; otherwise the
+ * statistics of the C library allocator are used.
+ */
+class AllocStats {
+public:
+    /**
+     * Read the current statistics of the allocator
+     *
+     * @return false if the allocator does not report statistics
+     */
+    bool sample();
+
+    /**
+     * Get the name of the allocator in use
+     *
+     * @return "jemalloc", "tcmalloc" or "libc"
+     */
+    static const char* getAllocatorName();
+
+    /**
+     * Get the bytes allocated by the application as of the last
+     * sample
+     */
+    uint64_t getAllocatedBytes() const { return allocated; }
+
+    /**
+     * Get the bytes in pages the allocator has handed out for
+     * allocations as of the last sample, which includes the free space
+     * within them
+     */
+    uint64_t getActiveBytes() const { return active; }
+
+    /**
+     * Get the bytes the allocator holds in memory as of the last
+     * sample, including free pages not yet returned to the system
+     */
+    uint64_t getResidentBytes() const { return resident; }
+
+    /**
+     * Get the fraction of the resident memory not used by
+     * allocations as of the last sample
+     *
+     * @return a ratio between 0 and 1
+     */
+    double getFragmentation() const {
+        return resident > allocated
+            ? double(resident - allocated) / resident : 0;
+    }
+
+    /**
+     * Return free memory held by the allocator to the system.  This
+     * is worth doing after a burst of allocations, such as a full
+     * resynchronization, has been freed.
+     */
+    static void releaseFreeMemory();
+
+    /**
+     * Write a heap profile of the process to a file.  With jemalloc
+     * this requires profiling to be enabled with MALLOC_CONF and with
+     * tcmalloc the heap profiler to be running; the C library
+     * allocator only writes its per-arena statistics.  The file is
+     * created with owner-only permissions and is not written if
+     * anything, including a symlink, already exists at the path.
+     *
+     * @param path the file to create
+     * @return false if the profile could not be written
+     */
+    static bool dumpHeapProfile(const std::string& path);
+
+private:
+    uint64_t allocated = 0;
+    uint64_t active = 0;
+    uint64_t resident = 0;
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_ALLOCSTATS_H */
@@ -0,0 +1,132 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for AsyncLogSink
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_ASYNCLOGSINK_H
+#define OPFLEXAGENT_ASYNCLOGSINK_H
+
+#include <opflexagent/logging.h>
+#include <opflexagent/SPSCRing.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace opflexagent {
+
+/**
+ * A log sink that queues messages and writes them to another sink
+ * from a background thread.
+ *
+ * Each thread that logs gets its own ring, so logging takes no lock
+ * and never waits for the destination.  When the ring of a thread is
+ * full the message is dropped and counted, and the writer logs the
+ * number of messages dropped.  Messages keep the time they were
+ * logged.  The messages of a thread are written in order, but the
+ * messages of different threads may be interleaved differently than
+ * they were logged.  Fatal messages are written directly once the
+ * messages queued before them are written.
+ */
+class AsyncLogSink : public LogSink, private boost::noncopyable {
+public:
+    /**
+     * Create a sink and start its writer thread
+     *
+     * @param sink the sink to write the messages to
+     * @param ringSize the number of messages each thread may queue
+     */
+    explicit AsyncLogSink(LogSink& sink, size_t ringSize = 4096);
+
+    /**
+     * Write the queued messages and stop the writer thread
+     */
+    virtual ~AsyncLogSink();
+
+    /**
+     * Queue a message for the writer thread
+     */
+    virtual void write(LogLevel level, const char *filename, int lineno,
+                       const char *functionName,
+                       const std::string& message) override;
+
+    /**
+     * Queue a message logged at an earlier time for the writer thread
+     */
+    virtual void write(const std::chrono::system_clock::time_point& time,
+                       LogLevel level, const char *filename, int lineno,
+                       const char *functionName,
+                       const std::string& message) override;
+
+    /**
+     * Wait until the messages queued by all threads before the call
+     * are written
+     */
+    void flush();
+
+    /**
+     * Get the sink the messages are written to
+     *
+     * @return the destination sink
+     */
+    LogSink& getSink() { return sink; }
+
+    /**
+     * Get the number of messages dropped because a ring was full
+     *
+     * @return the number of messages dropped
+     */
+    uint64_t getDropped() const { return dropped.load(); }
+
+private:
+    struct Record {
+        std::chrono::system_clock::time_point time;
+        LogLevel level;
+        std::string filename;
+        int lineno;
+        std::string functionName;
+        std::string message;
+    };
+    typedef SPSCRing<Record> Ring;
+
+    LogSink& sink;
+    size_t ringSize;
+    /* identifies the sink to the rings cached by each thread */
+    uint64_t id;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::condition_variable flushCond;
+    /* the rings of the threads that have logged, guarded by mutex */
+    std::vector<std::shared_ptr<Ring> > rings;
+    /* flush requests made and served, guarded by mutex */
+    uint64_t flushRequested;
+    uint64_t flushDone;
+    bool stopping;
+
+    /* set by a thread that pushed onto its empty ring */
+    std::atomic<bool> pending;
+    std::atomic<uint64_t> dropped;
+
+    std::thread writer;
+
+    Ring& getRing();
+    size_t drain(const std::vector<std::shared_ptr<Ring> >& toDrain);
+    void run();
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_ASYNCLOGSINK_H */
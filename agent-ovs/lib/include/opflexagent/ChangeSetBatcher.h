@@ -0,0 +1,142 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for ChangeSetBatcher
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_CHANGESETBATCHER_H
+#define OPFLEXAGENT_CHANGESETBATCHER_H
+
+#include <opflexagent/ChangeSetListener.h>
+#include <opflexagent/EndpointListener.h>
+#include <opflexagent/PolicyListener.h>
+#include <opflexagent/ServiceListener.h>
+#include <opflexagent/TaskQueue.h>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace opflexagent {
+
+class Agent;
+
+/**
+ * Gathers the updates to the endpoints, services and policy made
+ * through the single item listener interfaces, and hands them to
+ * change set listeners in batches, with snapshots of the objects
+ * taken once per batch.  Updates made while a batch is delivered
+ * gather into the next one, and an object updated several times
+ * appears once.
+ *
+ * A renderer can use a batcher instead of registering each of its
+ * components with the endpoint, service and policy managers:
+ *
+ *     ChangeSetBatcher batcher(agent, agent.getAgentIOService());
+ *     batcher.registerListener(&myListener);
+ *     batcher.start();
+ */
+class ChangeSetBatcher : public EndpointListener,
+                         public ServiceListener,
+                         public PolicyListener,
+                         private boost::noncopyable {
+public:
+    /**
+     * Create a batcher that delivers its change sets on the given
+     * io_service
+     *
+     * @param agent the agent whose managers to listen to
+     * @param io_service the io_service to deliver change sets on
+     */
+    ChangeSetBatcher(Agent& agent, boost::asio::io_service& io_service);
+
+    /**
+     * Destroy the batcher
+     */
+    virtual ~ChangeSetBatcher();
+
+    /**
+     * Set how long to wait after an update for further updates
+     * before delivering a change set, and how long to wait at most
+     * while updates keep coming.  By default change sets are
+     * delivered as soon as the io_service gets to them.  Set it
+     * before starting the batcher.
+     *
+     * @param delay the time to wait after the last update
+     * @param maxDelay the longest time to wait after the first update
+     */
+    void setDelay(std::chrono::milliseconds delay,
+                  std::chrono::milliseconds maxDelay) {
+        this->delay = delay;
+        this->maxDelay = maxDelay;
+    }
+
+    /**
+     * Register a listener for change sets.  Register the listeners
+     * before starting the batcher.
+     *
+     * @param listener the listener to register
+     */
+    void registerListener(ChangeSetListener* listener);
+
+    /**
+     * Start listening to the endpoint, service and policy managers
+     */
+    void start();
+
+    /**
+     * Stop listening, and stop delivering change sets
+     */
+    void stop();
+
+    /* Interface: EndpointListener */
+    virtual void endpointUpdated(const std::string& uuid) override;
+    virtual void endpointsUpdated(const std::unordered_set<std::string>& uuids)
+        override;
+
+    /* Interface: ServiceListener */
+    virtual void serviceUpdated(const std::string& uuid) override;
+
+    /* Interface: PolicyListener */
+    virtual void egDomainUpdated(const opflex::modb::URI& egURI) override;
+    virtual void domainUpdated(opflex::modb::class_id_t cid,
+                               const opflex::modb::URI& domURI) override;
+    virtual void contractUpdated(const opflex::modb::URI& contractURI)
+        override;
+    virtual void secGroupUpdated(const opflex::modb::URI& secGroupURI)
+        override;
+
+private:
+    Agent& agent;
+    TaskQueue taskQueue;
+    std::chrono::milliseconds delay;
+    std::chrono::milliseconds maxDelay;
+    std::vector<ChangeSetListener*> listeners;
+    std::atomic<bool> started;
+
+    std::mutex pendingMutex;
+    std::unordered_set<std::string> pendingEndpoints;
+    std::unordered_set<std::string> pendingServices;
+    std::unordered_set<opflex::modb::URI> pendingGroups;
+    std::unordered_set<opflex::modb::URI> pendingContracts;
+    std::unordered_set<opflex::modb::URI> pendingSecGroups;
+    ChangeSet::domain_map_t pendingDomains;
+
+    void schedule();
+    void deliver();
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_CHANGESETBATCHER_H */
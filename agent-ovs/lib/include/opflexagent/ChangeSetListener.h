@@ -0,0 +1,137 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for change set listener
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_CHANGESETLISTENER_H
+#define OPFLEXAGENT_CHANGESETLISTENER_H
+
+#include <opflexagent/Endpoint.h>
+#include <opflexagent/Service.h>
+#include <opflexagent/PolicyManager.h>
+
+#include <opflex/modb/URI.h>
+#include <opflex/modb/PropertyInfo.h>
+#include <modelgbp/gbp/EpGroup.hpp>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace opflexagent {
+
+/**
+ * The changes made to the endpoints, services and policy since the
+ * last change set, each change carrying a snapshot of the object as
+ * it was when the change set was built.  A snapshot is null if the
+ * object was removed.  The snapshots are not updated afterwards, so
+ * a change set can be read from any thread without locking.
+ */
+struct ChangeSet {
+    /**
+     * A map from endpoint UUID to the endpoint
+     */
+    typedef std::unordered_map<std::string,
+                               std::shared_ptr<const Endpoint> > ep_map_t;
+
+    /**
+     * A map from service UUID to the service
+     */
+    typedef std::unordered_map<std::string,
+                               std::shared_ptr<const Service> > svc_map_t;
+
+    /**
+     * A map from endpoint group URI to the group
+     */
+    typedef std::unordered_map<opflex::modb::URI,
+                               std::shared_ptr<const modelgbp::gbp::EpGroup> >
+        group_map_t;
+
+    /**
+     * A map from contract or security group URI to its rules, which
+     * are empty if it was removed
+     */
+    typedef std::unordered_map<opflex::modb::URI,
+                               PolicyManager::rule_list_t> rule_map_t;
+
+    /**
+     * A map from the URI of a forwarding domain to its class ID
+     */
+    typedef std::unordered_map<opflex::modb::URI,
+                               opflex::modb::class_id_t> domain_map_t;
+
+    /**
+     * The local endpoints added, updated or removed
+     */
+    ep_map_t endpoints;
+
+    /**
+     * The services added, updated or removed
+     */
+    svc_map_t services;
+
+    /**
+     * The endpoint groups whose domain, or forwarding behavior,
+     * changed
+     */
+    group_map_t groups;
+
+    /**
+     * The contracts whose rules changed
+     */
+    rule_map_t contracts;
+
+    /**
+     * The security groups whose rules changed
+     */
+    rule_map_t secGroups;
+
+    /**
+     * The forwarding domains, such as bridge and routing domains,
+     * that changed.  Read them through the policy manager.
+     */
+    domain_map_t domains;
+
+    /**
+     * Check whether the change set holds no change
+     *
+     * @return true if there is no change
+     */
+    bool empty() const {
+        return endpoints.empty() && services.empty() && groups.empty() &&
+            contracts.empty() && secGroups.empty() && domains.empty();
+    }
+};
+
+/**
+ * An abstract interface for renderers that take the changes to the
+ * endpoints, services and policy in batches
+ *
+ * @see ChangeSetBatcher
+ */
+class ChangeSetListener {
+public:
+    /**
+     * Destroy the change set listener and clean up all state
+     */
+    virtual ~ChangeSetListener() {};
+
+    /**
+     * Called with the changes made since the last call.  Calls are
+     * never made concurrently.
+     *
+     * @param changes the changes
+     */
+    virtual void changesUpdated(const ChangeSet& changes) = 0;
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_CHANGESETLISTENER_H */
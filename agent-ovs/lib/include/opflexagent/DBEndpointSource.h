@@ -0,0 +1,89 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for endpoint database endpoint source
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_DBENDPOINTSOURCE_H
+#define OPFLEXAGENT_DBENDPOINTSOURCE_H
+
+#include <opflexagent/EndpointSource.h>
+#include <opflexagent/EndpointDB.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <string>
+#include <unordered_map>
+
+namespace opflexagent {
+
+/**
+ * An endpoint source that reads endpoints from an endpoint database
+ * file.  The file is read when a writer signals the change socket of
+ * the database, and otherwise once per poll interval.
+ */
+class DBEndpointSource : public EndpointSource, private boost::noncopyable {
+public:
+    /**
+     * Create an endpoint source for a database
+     *
+     * @param manager the endpoint manager to update
+     * @param path the path of the database file
+     * @param pollInterval the interval in milliseconds at which to
+     * check the file when there are no signals
+     */
+    DBEndpointSource(EndpointManager* manager, const std::string& path,
+                     long pollInterval = 1000);
+
+    /**
+     * Stop reading and destroy the source
+     */
+    virtual ~DBEndpointSource();
+
+    /**
+     * Read the database, then start the thread that follows it
+     */
+    void start();
+
+    /**
+     * Stop the thread that follows the database
+     */
+    void stop();
+
+    /**
+     * Read the records appended to the database since the last read
+     * and apply them.  Called by the thread, and by tests.
+     */
+    void sync();
+
+private:
+    std::string path;
+    long pollInterval;
+    /* serializes the reads of the database */
+    std::mutex mutex;
+    EndpointDBReader reader;
+
+    /* the description of each known endpoint */
+    std::unordered_map<std::string, std::string> knownEps;
+
+    int sockFd;
+    int stopPipe[2];
+    std::thread thread;
+    std::atomic<bool> running;
+
+    void openSocket();
+    void run();
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_DBENDPOINTSOURCE_H */
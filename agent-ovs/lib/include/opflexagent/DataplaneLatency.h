@@ -0,0 +1,91 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for DataplaneLatency
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_DATAPLANELATENCY_H
+#define OPFLEXAGENT_DATAPLANELATENCY_H
+
+#include <opflex/ofcore/OFAgentStats.h>
+#include <opflex/modb/TraceContext.h>
+
+#include <boost/noncopyable.hpp>
+
+namespace opflexagent {
+
+/**
+ * Histograms of the latency from a policy update or an endpoint file
+ * change to the flows it causes being acknowledged by the switch, in
+ * milliseconds per stage.
+ *
+ * The origin of the change is carried to the renderer by the trace
+ * context of libopflex, through the MODB notifications and the task
+ * queues.  Each write of flows made while handling a traced change
+ * records one sample of the compute, barrier and total stages.
+ *
+ * The histograms are thread safe.
+ */
+class DataplaneLatency : private boost::noncopyable {
+public:
+    /**
+     * The clock used for the latencies
+     */
+    typedef opflex::modb::TraceContext::clock clock;
+
+    /**
+     * The stages of the latency
+     */
+    enum Stage {
+        /** from the origin to the renderer task being queued */
+        NOTIFY,
+        /** from the renderer task being queued to it running */
+        QUEUE,
+        /** from the renderer task running to the flows being written */
+        COMPUTE,
+        /** from the flows being written to the barrier reply */
+        BARRIER,
+        /** from the origin to the barrier reply */
+        TOTAL,
+        STAGE_MAX = TOTAL
+    };
+
+    /**
+     * Get the name of a stage
+     *
+     * @param stage the stage
+     * @return the name of the stage
+     */
+    static const char* getStageName(Stage stage);
+
+    /**
+     * Record a sample for a stage
+     *
+     * @param stage the stage
+     * @param duration the time spent in the stage
+     */
+    void observe(Stage stage, clock::duration duration);
+
+    /**
+     * Get the histogram of a stage
+     *
+     * @param stage the stage
+     * @return the histogram, in milliseconds
+     */
+    const OFLatencyHistogram& getHistogram(Stage stage) const {
+        return histograms[stage];
+    }
+
+private:
+    OFLatencyHistogram histograms[STAGE_MAX + 1];
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_DATAPLANELATENCY_H */
@@ -15,9 +15,11 @@
 
 #include <opflex/modb/URI.h>
 #include <opflex/modb/MAC.h>
+#include <opflexagent/Network.h>
 
 #include <boost/optional.hpp>
 
+#include <memory>
 #include <string>
 #include <vector>
 #include <unordered_set>
@@ -41,6 +43,7 @@ public:
                  external(false), aapModeAA(false), disableAdv(false),
                  accessAllowUntagged(false), extEncap(0) {
         annotateEpName = false;
+        attributesInterned = false;
         attr_hash = 0;
     }
 
@@ -56,6 +59,7 @@ public:
           external(false), aapModeAA(false), disableAdv(false),
           accessAllowUntagged(false), extEncap(0) {
         annotateEpName = false;
+        attributesInterned = false;
         attr_hash = 0;
     }
 
@@ -167,8 +171,17 @@ public:
      *
      * @param ip the IP address to add
      */
-    void addIP(const std::string& ip) {
-        this->ips.insert(ip);
+    void addIP(const std::string& ip);
+
+    /**
+     * Get the IP addresses associated with this endpoint, parsed when
+     * they were added.  IP addresses that could not be parsed are not
+     * included.
+     *
+     * @return the IP addresses with their prefix lengths, unmasked
+     */
+    const std::vector<network::cidr_t>& getIPCidrs() const {
+        return ipCidrs;
     }
 
     /**
@@ -187,8 +200,17 @@ public:
      *
      * @param ip the IP address to add
      */
-    void addAnycastReturnIP(const std::string& ip) {
-        this->anycastReturnIps.insert(ip);
+    void addAnycastReturnIP(const std::string& ip);
+
+    /**
+     * Get the IP addresses that are valid sources for anycast service
+     * addresses, parsed when they were added
+     *
+     * @return the list of IP addresses
+     */
+    const std::vector<boost::asio::ip::address>&
+    getAnycastReturnAddresses() const {
+        return anycastReturnAddrs;
     }
 
     /**
@@ -205,8 +227,17 @@ public:
      *
      * @param ip the IP address to add
      */
-    void addServiceIP(const std::string& ip) {
-        this->serviceIps.insert(ip);
+    void addServiceIP(const std::string& ip);
+
+    /**
+     * Get the Service IPs this endpoint is backend for, parsed when
+     * they were added
+     *
+     * @return the list of IP addresses
+     */
+    const std::vector<boost::asio::ip::address>&
+    getServiceAddresses() const {
+        return serviceAddrs;
     }
 
     /**
@@ -244,8 +275,22 @@ public:
      *
      * @param virtualIp the IP address to add
      */
-    void addVirtualIP(const virt_ip_t& virtualIp) {
-        this->virtualIps.insert(virtualIp);
+    void addVirtualIP(const virt_ip_t& virtualIp);
+
+    /**
+     * A virtual IP with its address parsed into a masked CIDR
+     */
+    typedef std::pair<opflex::modb::MAC, network::cidr_t> virt_cidr_t;
+
+    /**
+     * Get the virtual IP addresses associated with this endpoint,
+     * parsed when they were added.  Virtual IPs that could not be
+     * parsed are not included.
+     *
+     * @return the list of virtual IP addresses
+     */
+    const std::vector<virt_cidr_t>& getVirtualIPCidrs() const {
+        return virtualIpCidrs;
     }
 
     /**
@@ -527,7 +572,8 @@ public:
      * Clear the attribute map
      */
     void clearAttributes() {
-        attributes.clear();
+        attributes.reset();
+        attributesInterned = false;
     }
 
     /**
@@ -536,9 +582,7 @@ public:
      * @param name the name of the attribute to set
      * @param value the new value for the attribute
      */
-    void addAttribute(const std::string& name, const std::string& value) {
-        attributes[name] = value;
-    }
+    void addAttribute(const std::string& name, const std::string& value);
 
     /**
      * A string to string mapping
@@ -580,9 +624,7 @@ public:
      *
      * @return a map of name/value attribute pairs
      */
-    const attr_map_t& getAttributes() const {
-        return attributes;
-    }
+    const attr_map_t& getAttributes() const;
 
     /**
      * Base class for DHCP configuration
@@ -979,15 +1021,16 @@ public:
      * @param dhcpConfig the DHCP config to add
      */
     void setDHCPv4Config(const DHCPv4Config& dhcpConfig) {
-        this->dhcpv4Config = dhcpConfig;
+        this->dhcpv4Config = std::make_shared<const DHCPv4Config>(dhcpConfig);
     }
 
     /**
      * Get the DHCPv4 configuration
      *
-     * @return the DHCPv4Config object
+     * @return the DHCPv4Config object, or an empty pointer if there
+     * is none
      */
-    const boost::optional<DHCPv4Config>& getDHCPv4Config() const {
+    const std::shared_ptr<const DHCPv4Config>& getDHCPv4Config() const {
         return dhcpv4Config;
     }
 
@@ -997,15 +1040,16 @@ public:
      * @param dhcpConfig the DHCP config to add
      */
     void setDHCPv6Config(const DHCPv6Config& dhcpConfig) {
-        this->dhcpv6Config = dhcpConfig;
+        this->dhcpv6Config = std::make_shared<const DHCPv6Config>(dhcpConfig);
     }
 
     /**
      * Get the DHCPv6 configuration
      *
-     * @return the DHCPv6Config object
+     * @return the DHCPv6Config object, or an empty pointer if there
+     * is none
      */
-    const boost::optional<DHCPv6Config>& getDHCPv6Config() const {
+    const std::shared_ptr<const DHCPv6Config>& getDHCPv6Config() const {
         return dhcpv6Config;
     }
 
@@ -1317,6 +1361,15 @@ public:
         return this->extNodeURI;
     }
 
+    /**
+     * Replace the attribute map and the DHCP configurations with
+     * copies shared by all the endpoints that have equal ones.  This
+     * is done by the endpoint manager when it stores an endpoint, as
+     * many endpoints on a network carry the same attributes and DHCP
+     * options.
+     */
+    void intern();
+
 private:
     std::string uuid;
     boost::optional<opflex::modb::MAC> mac;
@@ -1324,6 +1377,11 @@ private:
     std::unordered_set<std::string> anycastReturnIps;
     std::unordered_set<std::string> serviceIps;
     virt_ip_set virtualIps;
+    /* the addresses above parsed once, for the renderers */
+    std::vector<network::cidr_t> ipCidrs;
+    std::vector<boost::asio::ip::address> anycastReturnAddrs;
+    std::vector<boost::asio::ip::address> serviceAddrs;
+    std::vector<virt_cidr_t> virtualIpCidrs;
     boost::optional<std::string> egMappingAlias;
     boost::optional<opflex::modb::URI> egURI;
     boost::optional<opflex::modb::URI> qosPolicy;
@@ -1344,7 +1402,10 @@ private:
     bool aapModeAA;
     bool disableAdv;
     bool accessAllowUntagged;
-    attr_map_t attributes;
+    /* shared with other endpoints once interned; copied before it
+       is changed */
+    std::shared_ptr<const attr_map_t> attributes;
+    bool attributesInterned;
     bool annotateEpName;
     /**
      * Hash of all the ep attributes. Will be used to detect any
@@ -1352,8 +1413,8 @@ private:
      * manager.
      */
     size_t    attr_hash;
-    boost::optional<DHCPv4Config> dhcpv4Config;
-    boost::optional<DHCPv6Config> dhcpv6Config;
+    std::shared_ptr<const DHCPv4Config> dhcpv4Config;
+    std::shared_ptr<const DHCPv6Config> dhcpv6Config;
     ipam_set ipAddressMappings;
     std::vector<std::string> snatUuids;
     uint32_t extEncap;
@@ -0,0 +1,209 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for the endpoint database
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_ENDPOINTDB_H
+#define OPFLEXAGENT_ENDPOINTDB_H
+
+#include <boost/noncopyable.hpp>
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+namespace opflexagent {
+
+/**
+ * The endpoint database is a single append-only file that holds the
+ * same JSON descriptions as the endpoint files, so that a node with
+ * many endpoints does not need a file, a watch and a parse per
+ * endpoint.
+ *
+ * The file starts with a 16 byte header: the magic "OFEPDB\0\0", a
+ * 32 bit version and 32 reserved bits.  Records follow, each with a
+ * 16 byte header and a payload:
+ *  - the 32 bit length of the payload
+ *  - the CRC-32 of the rest of the record header and the payload
+ *  - the operation: 1 to add or update, 2 to remove an endpoint
+ *  - 3 reserved bytes
+ *  - the 32 bit length of the UUID
+ *  - the payload: the UUID, then the JSON description for an update
+ * Integers are in host byte order.  The latest record for a UUID
+ * wins.  A record at the end of the file that is not complete or
+ * whose CRC does not match is ignored until it is complete.
+ *
+ * Writers compact the file by writing the live records to a new
+ * file and renaming it over the old one; readers notice the new
+ * file and read it from the start.  After appending, writers send a
+ * datagram to a Unix socket next to the file so that the reader
+ * does not need to poll.
+ */
+namespace EndpointDB {
+
+/** The operation of a record */
+enum Op {
+    /** Add or update an endpoint */
+    UPDATE = 1,
+    /** Remove an endpoint */
+    REMOVE = 2
+};
+
+/**
+ * Get the path of the change notification socket of a database
+ *
+ * @param path the path of the database file
+ * @return the path of the socket
+ */
+std::string getSocketPath(const std::string& path);
+
+} /* namespace EndpointDB */
+
+/**
+ * Appends endpoint records to an endpoint database and compacts it.
+ * Only one writer may use a database at a time.
+ */
+class EndpointDBWriter : private boost::noncopyable {
+public:
+    /**
+     * Open a database, creating it if it does not exist.  An
+     * incomplete record left at the end of the file is discarded.
+     *
+     * @param path the path of the database file
+     * @throws std::runtime_error if the file cannot be opened or is
+     * not an endpoint database
+     */
+    explicit EndpointDBWriter(const std::string& path);
+
+    /**
+     * Close the database
+     */
+    ~EndpointDBWriter();
+
+    /**
+     * Add or update an endpoint
+     *
+     * @param uuid the UUID of the endpoint
+     * @param json the JSON description of the endpoint
+     */
+    void update(const std::string& uuid, const std::string& json);
+
+    /**
+     * Remove an endpoint.  Nothing is written if the endpoint is not
+     * in the database.
+     *
+     * @param uuid the UUID of the endpoint
+     */
+    void remove(const std::string& uuid);
+
+    /**
+     * Rewrite the database with only the latest record of each
+     * endpoint.  This is done automatically once most of the file is
+     * made of records that are no longer needed.
+     */
+    void compact();
+
+    /**
+     * Wake up the reader of the database.  Call this after a batch
+     * of updates.
+     */
+    void notify();
+
+    /**
+     * Get the number of endpoints in the database
+     */
+    size_t getCount() const { return index.size(); }
+
+    /**
+     * Get the size of the database file
+     */
+    size_t getFileSize() const { return fileSize; }
+
+private:
+    struct Entry {
+        off_t offset;
+        uint32_t length;
+    };
+
+    std::string path;
+    int fd;
+    size_t fileSize;
+    /* the bytes taken by the latest record of each endpoint */
+    size_t liveSize;
+    std::unordered_map<std::string, Entry> index;
+
+    void openFile();
+    void append(EndpointDB::Op op, const std::string& uuid,
+                const std::string& json);
+};
+
+/**
+ * Reads the records of an endpoint database as they are appended,
+ * without copying the file.
+ */
+class EndpointDBReader : private boost::noncopyable {
+public:
+    /**
+     * A callback for each record read
+     *
+     * @param op the operation of the record
+     * @param uuid the UUID of the endpoint
+     * @param json the JSON description for an update
+     * @param length the length of the JSON description
+     */
+    typedef std::function<void(EndpointDB::Op op, const std::string& uuid,
+                               const char* json, size_t length)> callback_t;
+
+    /**
+     * Create a reader for a database that may not exist yet
+     *
+     * @param path the path of the database file
+     */
+    explicit EndpointDBReader(const std::string& path);
+
+    /**
+     * Unmap and close the database
+     */
+    ~EndpointDBReader();
+
+    /**
+     * Read the records added since the last call.  If the file was
+     * replaced or truncated it is read again from the start.
+     *
+     * @param cb the callback for each record
+     * @return true if the file was read from the start
+     */
+    bool read(const callback_t& cb);
+
+    /**
+     * Get the number of records skipped because they were corrupt
+     */
+    uint64_t getCorruptCount() const { return corrupt; }
+
+private:
+    std::string path;
+    int fd;
+    dev_t dev;
+    ino_t ino;
+    const char* map;
+    size_t mapSize;
+    size_t offset;
+    uint64_t corrupt;
+    size_t lastCorrupt;
+
+    void close();
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_ENDPOINTDB_H */
@@ -16,6 +16,7 @@
 #include <opflex/modb/URI.h>
 
 #include <string>
+#include <unordered_set>
 
 namespace opflexagent {
 
@@ -42,6 +43,18 @@ public:
      */
     virtual void endpointUpdated(const std::string& uuid) = 0;
 
+    /**
+     * Called when several endpoints are added, updated, or removed
+     * together.  The default implementation calls endpointUpdated
+     * for each of them.
+     *
+     * @param uuids the UUIDs for the endpoints
+     */
+    virtual void endpointsUpdated(const std::unordered_set<std::string>& uuids) {
+        for (const std::string& uuid : uuids)
+            endpointUpdated(uuid);
+    }
+
     /**
      * Called when a remote endpoint is added, updated, or removed.
      *
@@ -49,6 +62,18 @@ public:
      */
     virtual void remoteEndpointUpdated(const std::string& uuid) {};
 
+    /**
+     * Called when several remote endpoints are added, updated, or
+     * removed together.  The default implementation calls
+     * remoteEndpointUpdated for each of them.
+     *
+     * @param uuids the UUIDs for the endpoints
+     */
+    virtual void remoteEndpointsUpdated(const std::unordered_set<std::string>& uuids) {
+        for (const std::string& uuid : uuids)
+            remoteEndpointUpdated(uuid);
+    }
+
     /**
      * Called when a external endpoint is added, updated, or removed.
      *
@@ -21,6 +21,7 @@
 #include <opflexagent/EndpointListener.h>
 #include <opflexagent/PolicyManager.h>
 #include <opflexagent/PrometheusManager.h>
+#include <opflexagent/PrefixTrie.h>
 
 #include <opflex/ofcore/OFFramework.h>
 #include <opflex/modb/ObjectListener.h>
@@ -33,13 +34,16 @@
 #include <memory>
 #include <mutex>
 
+namespace modelgbp {
+namespace inv {
+class RemoteInventoryEp;
+}
+}
+
 namespace opflexagent {
 
 class Agent;
 
-typedef std::unordered_map<std::string,
-                        std::shared_ptr<const Endpoint>> ip_ep_map_t;
-
 /**
  * Counter values for endpoint stats
  */
@@ -227,6 +231,33 @@ public:
     void getEndpointsByIface(const std::string& ifaceName,
                              /* out */ std::unordered_set<std::string>& eps);
 
+    /**
+     * Get the endpoints on a particular integration interface that
+     * use a MAC address, either as their own MAC or as the MAC of one
+     * of their virtual IPs
+     *
+     * @param ifaceName the name of the interface
+     * @param mac the MAC address
+     * @param eps a set that will be filled with the UUIDs of matching
+     * endpoints.
+     */
+    void getEndpointsByIfaceMac(const std::string& ifaceName,
+                                const opflex::modb::MAC& mac,
+                                /* out */ std::unordered_set<std::string>& eps);
+
+    /**
+     * Get the endpoints with a virtual IP for a MAC address whose
+     * subnet contains an IP address
+     *
+     * @param mac the MAC address of the virtual IP
+     * @param ip the IP address
+     * @param eps a set that will be filled with the UUIDs of matching
+     * endpoints.
+     */
+    void getEndpointsByVirtualIp(const opflex::modb::MAC& mac,
+                                 const boost::asio::ip::address& ip,
+                                 /* out */ std::unordered_set<std::string>& eps);
+
     /**
      * Get all endpoints
      *
@@ -367,6 +398,19 @@ public:
         return remote_ep_uuid_map.size();
     }
 
+    /**
+     * Find the remote endpoint whose IP address or prefix in the
+     * given routing domain is the longest match for an address
+     *
+     * @param rdURI the URI of the routing domain
+     * @param addr the address to look up
+     * @return the UUID of the remote endpoint, or boost::none if no
+     * remote endpoint matches
+     */
+    boost::optional<std::string>
+    findRemoteEndpoint(const opflex::modb::URI& rdURI,
+                       const boost::asio::ip::address& addr);
+
 private:
     /**
      * Add or update the endpoint state with new information about an
@@ -384,9 +428,41 @@ private:
             const boost::optional<EndpointListener::uri_set_t &> extDomSet = boost::none);
 
     /**
-     * Update the remote endpoint entries associated with an endpoint
+     * Update the remote endpoint entries for a batch of remote
+     * inventory endpoints, and notify the listeners once for the
+     * endpoints that changed
+     *
+     * @param uris the URIs of the remote inventory endpoints
+     */
+    void updateEndpointsRemote(const std::unordered_set<opflex::modb::URI>& uris);
+
+    /**
+     * The state of a remote endpoint as last read from the inventory
      */
-    void updateEndpointRemote(const opflex::modb::URI& uri);
+    struct RemoteEpState {
+        /** the endpoint group of the endpoint */
+        boost::optional<opflex::modb::URI> egURI;
+        /** the routing domain of the group when last indexed */
+        boost::optional<opflex::modb::URI> rdURI;
+        /** the IP prefixes of the endpoint */
+        std::vector<std::pair<boost::asio::ip::address, uint8_t> > ips;
+        /** a description of the inventory object and its children,
+            compared to skip updates that change nothing */
+        std::string signature;
+    };
+
+    /**
+     * Read the state of a remote inventory endpoint
+     */
+    static void readRemoteEp(modelgbp::inv::RemoteInventoryEp& ep,
+                             RemoteEpState& state);
+
+    /**
+     * Add or remove the IP prefixes of a remote endpoint in the index
+     * of its routing domain
+     */
+    void indexRemoteIps(const std::string& uuid, const RemoteEpState& state);
+    void unindexRemoteIps(const std::string& uuid, const RemoteEpState& state);
 
     /**
      * Update the external endpoint entries associated with an endpoint
@@ -463,12 +539,58 @@ private:
      * epg mapping, if present
      */
     boost::optional<opflex::modb::URI> resolveEpgMapping(EndpointState& es);
+
+    /**
+     * An epg mapping read from the store, with its rules in the order
+     * in which they are evaluated
+     */
+    struct CompiledEpgMapping {
+        /** A rule that maps an attribute match to a group */
+        struct Rule {
+            std::string attrName;
+            std::string matchString;
+            uint8_t matchType;
+            bool negated;
+            boost::optional<opflex::modb::URI> egURI;
+
+            /** Check whether an attribute value matches the rule */
+            bool matches(const std::string& value) const;
+        };
+        std::vector<Rule> rules;
+        /** the group used when no rule matches */
+        boost::optional<opflex::modb::URI> defaultEgURI;
+        /** the names of the attributes the rules read */
+        std::unordered_set<std::string> attrNames;
+    };
+
+    /**
+     * Get the compiled epg mapping with the given name, compiling it
+     * if it is not cached.  Must hold ep_mutex.
+     *
+     * @return the mapping, or an empty pointer if there is no mapping
+     * with the name
+     */
+    std::shared_ptr<const CompiledEpgMapping>
+    getEpgMapping(const std::string& name);
+
+    /**
+     * Update the MAC and virtual IP indexes for an endpoint
+     *
+     * @param uuid the UUID of the endpoint
+     * @param oldEp the endpoint as currently indexed
+     * @param newEp the endpoint to index, or NULL if it is removed
+     */
+    void updateMacIndexes(const std::string& uuid, const Endpoint& oldEp,
+                          const Endpoint* newEp);
+
     typedef std::unordered_map<std::string, EndpointState> ep_map_t;
     typedef std::unordered_set<std::string> str_uset_t;
     typedef std::unordered_map<opflex::modb::URI, str_uset_t> group_ep_map_t;
     typedef std::unordered_map<std::string, opflex::modb::URI> ep_group_map_t;
     typedef std::unordered_map<opflex::modb::URI, std::string> ep_uuid_map_t;
     typedef std::unordered_map<std::string, str_uset_t> string_ep_map_t;
+    typedef std::unordered_map<opflex::modb::MAC, str_uset_t> mac_ep_map_t;
+    typedef std::unordered_map<std::string, mac_ep_map_t> iface_mac_ep_map_t;
     typedef std::unordered_map<EndpointListener::uri_set_t,
                                str_uset_t> secgrp_ep_map_t;
     typedef std::unordered_map<std::string,
@@ -478,6 +600,65 @@ private:
 
     std::mutex ep_mutex;
 
+    /**
+     * The endpoint object and computed endpoint group of an
+     * endpoint, as published to readers
+     */
+    struct EndpointSnapshot {
+        /**
+         * The endpoint object
+         */
+        std::shared_ptr<const Endpoint> endpoint;
+
+        /**
+         * The computed endpoint group
+         */
+        boost::optional<opflex::modb::URI> egURI;
+    };
+    typedef std::unordered_map<std::string, EndpointSnapshot> ep_snapshot_map_t;
+
+    /**
+     * A shard of the endpoint snapshots, keyed by UUID.  Writers
+     * update a snapshot while holding ep_mutex, once the endpoint
+     * state it mirrors is final, so that getEndpoint and
+     * getComputedEPG only take the lock of a single shard and do not
+     * wait behind endpoint updates.
+     */
+    struct EndpointShard {
+        /**
+         * Lock for the snapshots in the shard
+         */
+        std::mutex mutex;
+
+        /**
+         * Snapshots of local endpoints
+         */
+        ep_snapshot_map_t local;
+
+        /**
+         * Snapshots of external endpoints
+         */
+        ep_snapshot_map_t external;
+    };
+
+    static const size_t EP_SHARDS = 16;
+    EndpointShard ep_shards[EP_SHARDS];
+
+    /**
+     * Get the snapshot shard for an endpoint
+     */
+    EndpointShard& getShard(const std::string& uuid);
+
+    /**
+     * Publish the snapshot of an endpoint, or remove it
+     *
+     * @param uuid the UUID of the endpoint
+     * @param es the state of the endpoint, or NULL if it is removed
+     * @param external true for an external endpoint
+     */
+    void publishEndpoint(const std::string& uuid, const EndpointState* es,
+                         bool external);
+
     /**
      * Map endpoint UUID to endpoint state object
      */
@@ -491,7 +672,13 @@ private:
     /**
      * Map IPs to local endpoints
      */
-    ip_ep_map_t ip_local_ep_map;
+    PrefixTrie<std::shared_ptr<const Endpoint>> ip_local_ep_map;
+
+    /**
+     * Map virtual IP subnets to the MACs using them, and those to a
+     * set of endpoint UUIDs
+     */
+    PrefixTrie<mac_ep_map_t> vip_ep_map;
 
     /**
      * Map remote endpoint URI to remote endpoint uuid
@@ -504,9 +691,16 @@ private:
     group_ep_map_t group_remote_ep_map;
 
     /**
-     * Map remote endpoint UUID to endpoint group URI
+     * Map remote endpoint UUID to its state
+     */
+    std::unordered_map<std::string, RemoteEpState> remote_ep_state_map;
+
+    /**
+     * Map routing domain URI to the IP prefixes of the remote
+     * endpoints in it, and those to a remote endpoint UUID
      */
-    ep_group_map_t remote_ep_group_map;
+    std::unordered_map<opflex::modb::URI,
+                       PrefixTrie<std::string> > rd_remote_ip_map;
 
     /**
      * Map sets of security groups to a set of endpoint UUIDs
@@ -523,6 +717,12 @@ private:
      */
     string_ep_map_t iface_ep_map;
 
+    /**
+     * Map endpoint interface names and the MACs used on them to a set
+     * of endpoint UUIDs
+     */
+    iface_mac_ep_map_t iface_mac_ep_map;
+
     /**
      * Map endpoint access interface names to a set of endpoint UUIDs
      */
@@ -546,6 +746,15 @@ private:
      */
     string_ep_map_t epgmapping_ep_map;
 
+    /**
+     * Compiled epg mappings by name, including an empty pointer for
+     * names with no mapping.  Entries are dropped when the mapping or
+     * its rules change.
+     */
+    std::unordered_map<std::string,
+                       std::shared_ptr<const CompiledEpgMapping> >
+        epg_mapping_cache;
+
     /**
      * Map endpoint UUID to endpoint state object
      */
@@ -567,7 +776,8 @@ private:
     std::mutex listener_mutex;
 
     void notifyListeners(const std::string& uuid);
-    void notifyRemoteListeners(const std::string& uuid);
+    void notifyListeners(const std::unordered_set<std::string>& uuids);
+    void notifyRemoteListeners(const std::unordered_set<std::string>& uuids);
     void notifyListeners(const EndpointListener::uri_set_t& secGroups);
     void notifyExternalEndpointListeners(const std::string& uuid);
     void notifyLocalExternalDomainListeners(const opflex::modb::URI& uri);
@@ -581,7 +791,15 @@ private:
 
         virtual void objectUpdated(opflex::modb::class_id_t class_id,
                                    const opflex::modb::URI& uri);
+        virtual void objectsUpdated(const update_list_t& updates);
     private:
+        // Update endpoint state for the given object.  Must hold
+        // ep_mutex.
+        void updateAttributeSet(const opflex::modb::URI& uri,
+                                std::unordered_set<std::string>& notify);
+        void updateEpgMapping(const opflex::modb::URI& uri,
+                              std::unordered_set<std::string>& notify);
+
         EndpointManager& epmanager;
     };
     EPGMappingListener epgMappingListener;
@@ -74,6 +74,15 @@ public:
      */
     bool getPacketDropPruneSpec(const std::string &pruneFilter, std::shared_ptr<PacketDropLogPruneSpec> &pruneSpec);
 
+    /**
+     * Get the sampling of the packets dropped at the end of the flow
+     * tables
+     *
+     * @return the sampling config, which logs every packet when no
+     * drop log config is present
+     */
+    PacketDropLogSampling getPacketDropLogSampling();
+
 private:
     opflex::ofcore::OFFramework& framework;
 
@@ -156,6 +165,7 @@ private:
 
     std::mutex prune_mutex;
     drop_prune_map_t dropPruneMap;
+    PacketDropLogSampling dropLogSampling;
     /**
      * The extraConfig listeners that have been registered
      */
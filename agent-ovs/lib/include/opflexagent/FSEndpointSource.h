@@ -17,8 +17,10 @@
 #include <opflexagent/FSWatcher.h>
 
 #include <boost/filesystem.hpp>
+#include <boost/property_tree/ptree.hpp>
 
 #include <unordered_map>
+#include <mutex>
 #include <string>
 
 namespace opflexagent {
@@ -48,14 +50,49 @@ public:
     virtual void updated(const boost::filesystem::path& filePath);
     // See Watcher
     virtual void deleted(const boost::filesystem::path& filePath);
+    // See Watcher
+    virtual bool concurrentUpdates() const { return true; }
+
+    /**
+     * Fill in an endpoint from its JSON description, in the format of
+     * the endpoint files
+     *
+     * @param manager the endpoint manager the endpoint is for
+     * @param properties the parsed JSON description
+     * @param newep the endpoint to fill in
+     * @param source where the description came from, for logging
+     * @return false if the description is not valid
+     * @throws boost::property_tree::ptree_error if a required field
+     * is missing or a field has the wrong type
+     */
+    static bool parseEndpoint(EndpointManager* manager,
+                              const boost::property_tree::ptree& properties,
+                              Endpoint& newep, const std::string& source);
 
 private:
-    typedef std::unordered_map<std::string, std::string> ep_map_t;
+    /**
+     * An endpoint loaded from a file
+     */
+    struct KnownEp {
+        /** the UUID of the endpoint */
+        std::string uuid;
+        /** the file contents it was loaded from */
+        std::string contents;
+    };
+    typedef std::unordered_map<std::string, KnownEp> ep_map_t;
 
     /**
-     * EPs that are known to the filesystem watcher
+     * EPs that are known to the filesystem watcher, with the contents
+     * of their file so that a file rewritten with the same contents
+     * is not parsed and applied again
      */
     ep_map_t knownEps;
+
+    /**
+     * Lock for the known files, which are updated by several threads
+     * during the initial scan
+     */
+    std::recursive_mutex mutex;
 };
 
 } /* namespace opflexagent */
@@ -19,6 +19,7 @@
 #include <boost/filesystem.hpp>
 
 #include <unordered_map>
+#include <mutex>
 #include <string>
 
 namespace opflexagent {
@@ -48,6 +49,8 @@ public:
     virtual void updated(const boost::filesystem::path& filePath);
     // See Watcher
     virtual void deleted(const boost::filesystem::path& filePath);
+    // See Watcher
+    virtual bool concurrentUpdates() const { return true; }
 
 private:
     typedef std::unordered_map<std::string, std::string> ep_map_t;
@@ -56,6 +59,12 @@ private:
      * EPs that are known to the filesystem watcher
      */
     ep_map_t knownEps;
+
+    /**
+     * Lock for the known files, which are updated by several threads
+     * during the initial scan
+     */
+    std::recursive_mutex mutex;
 };
 
 } /* namespace opflexagent */
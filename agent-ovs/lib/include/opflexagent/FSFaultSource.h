@@ -5,10 +5,12 @@
 #include <opflexagent/FSWatcher.h>
 #include <opflexagent/FaultSource.h>
 #include <opflexagent/Agent.h>
+#include <opflexagent/Fault.h>
 #include <boost/filesystem.hpp>
 #include <string>
 #include <unordered_map>
 #include <mutex>
+#include <vector>
 
 namespace opflexagent {
 
@@ -34,6 +36,10 @@ public:
    virtual void updated(const boost::filesystem::path& filePath);
    // See Watcher
    virtual void deleted(const boost::filesystem::path& filePath);
+   // See Watcher
+   virtual void beginBatch();
+   // See Watcher
+   virtual void endBatch();
  
    void getFaultUUID (string& uuid, const string& pathstr);
 
@@ -44,6 +50,17 @@ private:
    typedef std::unordered_map<std::string, std::string> fault_map_t;
    fault_map_t knownFaults;
    std::mutex lock_map_mutex;
+
+   /* the changes collected while a batch is in progress, applied in
+      one commit when it ends */
+   bool inBatch;
+   std::vector<Fault> batchPlatformFaults;
+   std::vector<Fault> batchEpFaults;
+   std::vector<std::string> batchRemoved;
+
+   /* apply the changes collected so far unless a batch is in
+      progress; called with lock_map_mutex held */
+   void flush(std::unique_lock<std::mutex>& lock);
 };
 }
 
@@ -18,6 +18,7 @@
 
 #include <boost/filesystem.hpp>
 
+#include <mutex>
 #include <string>
 #include <unordered_map>
 
@@ -48,6 +49,8 @@ public:
     virtual void updated(const boost::filesystem::path& filePath);
     // See Watcher
     virtual void deleted(const boost::filesystem::path& filePath);
+    // See Watcher
+    virtual bool concurrentUpdates() const { return true; }
 
 private:
     // Map filePath to <snat-uuid>
@@ -57,6 +60,12 @@ private:
      * Snats that are known to the filesystem watcher
      */
     snat_map_t knownSnats;
+
+    /**
+     * Lock for the known files, which are updated by several threads
+     * during the initial scan
+     */
+    std::recursive_mutex mutex;
 };
 
 } /* namespace opflexagent */
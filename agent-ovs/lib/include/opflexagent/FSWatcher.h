@@ -18,9 +18,13 @@
 #include <boost/filesystem.hpp>
 #include <boost/noncopyable.hpp>
 
+#include <atomic>
+#include <chrono>
 #include <string>
 #include <unordered_map>
 #include <thread>
+#include <utility>
+#include <vector>
 
 namespace opflexagent {
 
@@ -48,6 +52,25 @@ public:
          * Called when the specified path is deleted
          */
         virtual void deleted(const boost::filesystem::path& filePath) = 0;
+        /**
+         * Check whether updated may be called for different paths
+         * from several threads at once, which lets the initial scan
+         * load the files in parallel
+         *
+         * @return true if updated is safe to call concurrently
+         */
+        virtual bool concurrentUpdates() const { return false; }
+        /**
+         * Called before a pass that delivers a batch of events, such
+         * as the initial scan or the events whose debounce windows
+         * ended together, so that the watcher can apply the whole
+         * batch at once when endBatch is called
+         */
+        virtual void beginBatch() {}
+        /**
+         * Called after the last event of a batch
+         */
+        virtual void endBatch() {}
     };
 
     /**
@@ -63,6 +86,31 @@ public:
      */
     void setInitialScan(bool scan);
 
+    /**
+     * Set the number of threads that load the files found by the
+     * initial scan, for the watchers that allow concurrent updates.
+     *
+     * @param threads the number of threads.  Default the number of
+     * CPUs.
+     */
+    void setScanThreads(size_t threads);
+
+    /**
+     * Set the time to wait after an event for a path before notifying
+     * the watchers.  Each new event for the path restarts the wait,
+     * and only the last one is delivered, so a file written several
+     * times or replaced through a rename is handled once.
+     *
+     * @param ms the wait in milliseconds, or 0 to notify after each
+     * read of the events.  Default 50.
+     */
+    void setDebounce(long ms);
+
+    /**
+     * The default wait after an event before notifying the watchers
+     */
+    static const long DEFAULT_DEBOUNCE_MS = 50;
+
     /**
      * Start the listener on the currently registered set of watchers
      */
@@ -73,6 +121,14 @@ public:
      */
     void stop();
 
+    /**
+     * Compare the watched directories with the files the watchers
+     * were last notified of, and notify them of the files that are
+     * new, changed or gone, as is done when the kernel drops events.
+     * The rescan runs on the polling thread.
+     */
+    void requestRescan();
+
     /**
      * Polling thread function
      */
@@ -116,10 +172,63 @@ private:
      * File descriptor for communicating with the polling thread
      */
     int eventFd;
+    std::atomic<bool> stopping;
+    std::atomic<bool> rescanRequested;
     bool initialScan;
+    size_t scanThreads;
+
+    typedef std::pair<Watcher*, boost::filesystem::path> scan_item_t;
 
-    static void scanPath(const WatchState* ws,
-                         const boost::filesystem::path& watchPath);
+    /**
+     * Notify the watchers of every file in the watched directories,
+     * loading the files for concurrent watchers on a pool of threads
+     */
+    void scanWatches();
+
+    static void scanUpdate(const scan_item_t& item);
+
+    /**
+     * The modification time of a file, in seconds and nanoseconds
+     */
+    typedef std::pair<int64_t, long> file_time_t;
+
+    /**
+     * An event waiting for its debounce window to pass
+     */
+    struct PendingEvent {
+        const WatchState* ws;
+        bool deleted;
+        std::chrono::steady_clock::time_point due;
+    };
+
+    std::chrono::milliseconds debounce;
+
+    /**
+     * Events waiting to be delivered, by path
+     */
+    std::unordered_map<boost::filesystem::path,
+                       PendingEvent, PathHash> pendingEvents;
+
+    /**
+     * The files delivered to the watchers and their modification
+     * times, compared against the directories when events are lost
+     */
+    std::unordered_map<boost::filesystem::path,
+                       file_time_t, PathHash> knownFiles;
+
+    static bool fileTime(const boost::filesystem::path& filePath,
+                         file_time_t& time);
+    void queueEvent(const WatchState* ws,
+                    const boost::filesystem::path& filePath, bool deleted);
+    int pollTimeout() const;
+    void dispatchEvents();
+
+    /**
+     * Queue events for the differences between the watched
+     * directories and the known files, after the kernel dropped
+     * events
+     */
+    void rescan();
 };
 
 } /* namespace opflexagent */
@@ -10,6 +10,7 @@
 #include <opflexagent/Fault.h> 
 #include <opflexagent/EndpointListener.h>
 #include <mutex>
+#include <vector>
 
 namespace opflexagent {
 
@@ -44,6 +45,21 @@ public:
     */
    void createEpFault(const Fault& fs);
 
+   /**
+    * Remove and create a batch of faults in a single commit to the
+    * managed object store, so that a storm of faults causes one
+    * round of notifications rather than one per fault.  The removals
+    * are applied first.
+    *
+    * @param platformFaults the faults to create against the platform
+    * @param epFaults the faults to create against endpoints.  Those
+    * whose endpoint cannot be resolved yet are kept pending.
+    * @param removed the UUIDs of the faults to remove
+    */
+   void updateFaults(const std::vector<Fault>& platformFaults,
+                     const std::vector<Fault>& epFaults,
+                     const std::vector<std::string>& removed);
+
    /* Interface: EndpointListener */
    virtual void endpointUpdated(const std::string& uuid);
 
@@ -65,6 +81,10 @@ public:
 
 private:
    std::recursive_mutex map_mutex;
+
+   /* get the URI of the endpoint affected by a fault, or boost::none
+      if it cannot be resolved yet */
+   boost::optional<opflex::modb::URI> getAffectedEp(const Fault& fs);
 };
 
 } /* namespace opflexagent */
@@ -0,0 +1,170 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for FlowProgrammingStats
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_FLOWPROGRAMMINGSTATS_H
+#define OPFLEXAGENT_FLOWPROGRAMMINGSTATS_H
+
+#include <opflex/ofcore/OFAgentStats.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace opflexagent {
+
+/**
+ * Statistics of the flows programmed into each bridge: the flow
+ * changes made per table, the number of flows each table should
+ * hold, and histograms of the number of changes per write and of
+ * the time the switch takes to acknowledge a write.
+ *
+ * The statistics are thread safe.
+ */
+class FlowProgrammingStats : private boost::noncopyable {
+public:
+    /**
+     * The values kept per table
+     */
+    enum Counter {
+        /** flows added */
+        ADDS,
+        /** flows modified */
+        MODS,
+        /** flows deleted */
+        DELETES,
+        /** flows the table should hold, which is a gauge */
+        FLOWS,
+        COUNTER_MAX = FLOWS
+    };
+
+    /**
+     * Get the name of a counter
+     *
+     * @param counter the counter
+     * @return the name of the counter
+     */
+    static const char* getCounterName(Counter counter);
+
+    /**
+     * The statistics of a bridge, updated by the switch manager of
+     * the bridge
+     */
+    class BridgeStats : private boost::noncopyable {
+    public:
+        /**
+         * Create the statistics of a bridge
+         *
+         * @param tables the number of flow tables of the bridge
+         */
+        explicit BridgeStats(size_t tables);
+
+        /**
+         * Count the changes written to a table
+         *
+         * @param table the table
+         * @param adds the flows added
+         * @param mods the flows modified
+         * @param deletes the flows deleted
+         * @param flows the flows the table now holds
+         */
+        void countEdits(size_t table, size_t adds, size_t mods,
+                        size_t deletes, size_t flows);
+
+        /**
+         * Record a write of flow and group changes
+         *
+         * @param changes the number of changes written
+         * @param barrier the time until the switch acknowledged them
+         */
+        void observeWrite(size_t changes,
+                          std::chrono::steady_clock::duration barrier);
+
+        /**
+         * Get the number of tables of the bridge
+         *
+         * @return the number of tables
+         */
+        size_t getTableCount() const { return tables; }
+
+        /**
+         * Get a value of a table
+         *
+         * @param table the table, less than the number of tables
+         * @param counter the value to get
+         * @return the value
+         */
+        uint64_t get(size_t table, Counter counter) const {
+            return counters[table * (COUNTER_MAX + 1) + counter];
+        }
+
+        /**
+         * Get the histogram of the number of changes per write
+         *
+         * @return the histogram
+         */
+        const OFLatencyHistogram& getEditSize() const { return editSize; }
+
+        /**
+         * Get the histogram of the time the switch takes to
+         * acknowledge a write
+         *
+         * @return the histogram, in milliseconds
+         */
+        const OFLatencyHistogram& getBarrierLatency() const {
+            return barrierLatency;
+        }
+
+    private:
+        size_t tables;
+        std::unique_ptr<std::atomic<uint64_t>[]> counters;
+        OFLatencyHistogram editSize;
+        OFLatencyHistogram barrierLatency;
+    };
+
+    /**
+     * A map from bridge name to its statistics
+     */
+    typedef std::unordered_map<std::string,
+                               std::shared_ptr<const BridgeStats> >
+        bridge_map_t;
+
+    /**
+     * Start keeping the statistics of a bridge, replacing those kept
+     * for a bridge of the same name
+     *
+     * @param bridge the name of the bridge
+     * @param tables the number of flow tables of the bridge
+     * @return the statistics of the bridge
+     */
+    std::shared_ptr<BridgeStats> addBridge(const std::string& bridge,
+                                           size_t tables);
+
+    /**
+     * Get the statistics of every bridge
+     *
+     * @param bridges the map to fill
+     */
+    void getBridges(bridge_map_t& bridges) const;
+
+private:
+    mutable std::mutex mutex;
+    bridge_map_t bridges;
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_FLOWPROGRAMMINGSTATS_H */
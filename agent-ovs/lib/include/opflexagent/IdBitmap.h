@@ -0,0 +1,114 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for IdBitmap
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_IDBITMAP_H
+#define OPFLEXAGENT_IDBITMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace opflexagent {
+
+/**
+ * A hierarchical bitmap tracking which of a range of indexes are in
+ * use, which finds the lowest free index in time bounded by the
+ * depth of the hierarchy.  Each bit of a level above the first is set
+ * when the corresponding word of the level below is full.
+ *
+ * Storage grows with the highest index ever set rather than with the
+ * size of the range, so that a large range used from the bottom
+ * stays small.
+ *
+ * The bitmap is not thread safe.
+ */
+class IdBitmap {
+public:
+    /**
+     * Create a bitmap for the given number of indexes, all free
+     *
+     * @param size the number of indexes
+     */
+    explicit IdBitmap(uint64_t size = 0);
+
+    /**
+     * Free every index and change the number of indexes
+     *
+     * @param size the number of indexes
+     */
+    void reset(uint64_t size);
+
+    /**
+     * Check whether an index is in use
+     *
+     * @param index the index to check
+     * @return true if the index is in use
+     */
+    bool test(uint64_t index) const;
+
+    /**
+     * Mark an index in use
+     *
+     * @param index the index, which must be less than size()
+     */
+    void set(uint64_t index);
+
+    /**
+     * Mark an index free
+     *
+     * @param index the index
+     */
+    void clear(uint64_t index);
+
+    /**
+     * Find the lowest free index
+     *
+     * @return the index, or size() if every index is in use
+     */
+    uint64_t findFirstClear() const;
+
+    /**
+     * Get the number of indexes in the range
+     *
+     * @return the number of indexes
+     */
+    uint64_t size() const { return nbits; }
+
+    /**
+     * Get the number of indexes in use
+     *
+     * @return the number of indexes in use
+     */
+    uint64_t count() const { return nset; }
+
+    /**
+     * Count the runs of consecutive free indexes.  This scans the
+     * bitmap and is only useful for testing purposes.
+     *
+     * @return the number of runs of free indexes
+     */
+    uint64_t freeRangeCount() const;
+
+private:
+    uint64_t nbits;
+    uint64_t nset;
+
+    /* levels[0] holds a bit per index, and each level above it a bit
+       per word of the level below; the top level is a single word */
+    std::vector<std::vector<uint64_t> > levels;
+
+    void grow(uint64_t index);
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_IDBITMAP_H */
@@ -12,11 +12,14 @@
 #define OPFLEXAGENT_IDGENERATOR_H_
 
 #include <opflex/ofcore/OFFramework.h>
+#include <opflexagent/IdBitmap.h>
 
 #include <boost/optional.hpp>
 
+#include <deque>
+#include <fstream>
+#include <memory>
 #include <string>
-#include <set>
 #include <unordered_map>
 #include <mutex>
 #include <chrono>
@@ -122,6 +125,41 @@ public:
      */
     void setAllocHook(const std::string& nmspc, alloc_hook_t& allocHook);
 
+    /**
+     * Function that can be registered as a hook for freeing the ID
+     * of an erased string.  A false return value indicates the ID
+     * must stay reserved until it is released with releaseId.
+     */
+    typedef std::function<bool(const std::string&, uint32_t)> free_hook_t;
+
+    /**
+     * Set a callback hook called when cleanup frees the ID of an
+     * erased string.  The hook is called with the generator locked,
+     * so it must not call back into the generator.
+     *
+     * @param nmspc the namespace to register the hook for
+     * @param freeHook the callback to register
+     */
+    void setFreeHook(const std::string& nmspc, free_hook_t& freeHook);
+
+    /**
+     * Release an ID kept reserved by the free hook, so that it can
+     * be allocated again
+     *
+     * @param nmspc the namespace of the ID
+     * @param id the ID to release
+     */
+    void releaseId(const std::string& nmspc, uint32_t id);
+
+    /**
+     * Check whether an ID is assigned to a string or kept reserved
+     *
+     * @param nmspc the namespace of the ID
+     * @param id the ID to check
+     * @return true if the ID cannot be allocated
+     */
+    bool isIdUsed(const std::string& nmspc, uint32_t id);
+
     /**
      * Gets the name of the file used for persisting IDs.
      *
@@ -139,6 +177,24 @@ public:
         persistDir = dir;
     }
 
+    /**
+     * Write the ID files in format version 2, which records the IDs
+     * freed by cleanup as well as the assignments, so that neither
+     * rewrites the file.  Otherwise the files are written in format
+     * version 1: assignments are appended, but a cleanup that frees
+     * IDs rewrites the file.  Both formats are read.  Agents that
+     * predate format version 2 cannot read it, so enabling this is a
+     * one-way migration for rollbacks unless it is disabled again
+     * before the rollback, which rewrites the files in version 1 as
+     * each namespace is loaded.  Must be called before the namespaces
+     * are initialized.
+     *
+     * @param enabled true to write format version 2
+     */
+    void setJournal(bool enabled) {
+        journalFrees = enabled;
+    }
+
     /**
      * The garbage collection callback.  Arguments are the namespace
      * and the string to check.  Returns true if the string remains
@@ -190,18 +246,6 @@ private:
     typedef std::chrono::steady_clock::time_point time_point;
     typedef std::chrono::milliseconds duration;
 
-    struct id_range {
-        id_range(uint32_t start_, uint32_t end_) :
-            start(start_), end(end_) { }
-
-        uint32_t start;
-        uint32_t end;
-    };
-
-    friend bool operator<(const id_range& lhs, const id_range& rhs);
-    friend bool operator==(const id_range& lhs, const id_range& rhs);
-    friend bool operator!=(const id_range& lhs, const id_range& rhs);
-
     /**
      * Keeps track of IDs assignments in a namespace.
      */
@@ -212,24 +256,88 @@ private:
         typedef std::unordered_map<std::string, uint32_t> Str2IdMap;
         Str2IdMap ids;
 
-        std::set<id_range> freeIds;
+        /**
+         * The lowest ID of the namespace
+         */
+        uint32_t minId = 1;
+
+        /**
+         * The IDs in use, offset by the lowest ID
+         */
+        IdBitmap usedIds;
 
         typedef std::unordered_map<std::string, time_point> Str2EIdMap;
         Str2EIdMap erasedIds;
 
+        /**
+         * Erased strings in the order they were erased, so that
+         * cleanup stops at the first one that is too recent.  Strings
+         * resurrected or erased again since are skipped when their
+         * time no longer matches erasedIds.
+         */
+        std::deque<std::pair<time_point, std::string> > quarantine;
+
         typedef std::unordered_map<uint32_t, std::string> Id2StrMap;
         Id2StrMap  reverseMap;
 
         boost::optional<alloc_hook_t> allocHook;
+        boost::optional<free_hook_t> freeHook;
+
+        /**
+         * The ID file opened for appending records
+         */
+        std::unique_ptr<std::ofstream> journal;
+
+        /**
+         * The number of records in the ID file
+         */
+        size_t journalRecords = 0;
+
+        /**
+         * The format version of the ID file
+         */
+        uint32_t fileVersion = 1;
+
+        /**
+         * The ID file must be rewritten at the end of the cleanup
+         * pass, since its format cannot record the IDs freed
+         */
+        bool rewritePending = false;
     };
 
     /**
-     * Save ID assignment to file (which determined from the namespace).
+     * The types of the records in the ID file
+     */
+    enum RecordType {
+        /** an ID was assigned to a string */
+        RECORD_ALLOC = 1,
+        /** the ID of a string was freed */
+        RECORD_FREE = 2
+    };
+
+    /**
+     * Save ID assignment to file (which determined from the namespace),
+     * replacing its contents, and keep the file open to append later
+     * changes.
      *
      * @param nmspc Namespace to save
      * @param idmap Assignments to save
      */
     void persist(const std::string& nmspc, IdMap& idmap);
+
+    /**
+     * Append a change of an ID assignment to the ID file of a
+     * namespace, and rewrite the file once most of its records are
+     * stale.
+     *
+     * @param nmspc Namespace of the ID
+     * @param idmap Assignments of the namespace
+     * @param type the type of the change
+     * @param id the ID
+     * @param str the string of the ID
+     */
+    void journal(const std::string& nmspc, IdMap& idmap,
+                 RecordType type, uint32_t id, const std::string& str);
     uint32_t getRemainingIdsLocked(const std::string& nmspc);
 
     std::mutex id_mutex;
@@ -242,6 +350,7 @@ private:
 
     std::string persistDir;
     duration cleanupInterval;
+    bool journalFrees;
 };
 
 
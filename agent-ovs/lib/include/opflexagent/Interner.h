@@ -0,0 +1,111 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for Interner
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_INTERNER_H
+#define OPFLEXAGENT_INTERNER_H
+
+#include <boost/noncopyable.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace opflexagent {
+
+/**
+ * Share a single immutable copy of equal values, so that objects
+ * holding the same value hold the same pointer.
+ *
+ * The interner only keeps weak references: a value is freed once the
+ * last object holding it goes away, and its entry is dropped the next
+ * time its hash is looked up or the table is swept.  The table is
+ * swept when it has doubled in size since the last sweep.
+ *
+ * The interner is thread safe.
+ *
+ * @param T the type of the values
+ * @param Hash the hash function for the values
+ * @param Equal the equality function for the values
+ */
+template <typename T,
+          typename Hash = std::hash<T>,
+          typename Equal = std::equal_to<T> >
+class Interner : private boost::noncopyable {
+public:
+    /**
+     * Get the shared copy of a value, creating it if no equal value
+     * is held
+     *
+     * @param value the value to look up
+     * @return a pointer to a value equal to the given one
+     */
+    std::shared_ptr<const T> intern(const T& value) {
+        size_t h = Hash()(value);
+        std::lock_guard<std::mutex> guard(mutex);
+        auto range = entries.equal_range(h);
+        for (auto it = range.first; it != range.second; ) {
+            std::shared_ptr<const T> held = it->second.lock();
+            if (!held) {
+                it = entries.erase(it);
+            } else if (Equal()(*held, value)) {
+                return held;
+            } else {
+                ++it;
+            }
+        }
+
+        std::shared_ptr<const T> held = std::make_shared<const T>(value);
+        entries.emplace(h, held);
+        if (entries.size() >= sweepAt) {
+            sweep();
+            sweepAt = std::max(MIN_SWEEP, 2 * entries.size());
+        }
+        return held;
+    }
+
+    /**
+     * Get the number of entries in the table, which may include
+     * values that have been freed but not yet swept
+     *
+     * @return the number of entries
+     */
+    size_t size() {
+        std::lock_guard<std::mutex> guard(mutex);
+        return entries.size();
+    }
+
+private:
+    static const size_t MIN_SWEEP = 64;
+
+    std::mutex mutex;
+    std::unordered_multimap<size_t, std::weak_ptr<const T> > entries;
+    size_t sweepAt = MIN_SWEEP;
+
+    void sweep() {
+        for (auto it = entries.begin(); it != entries.end(); ) {
+            if (it->second.expired())
+                it = entries.erase(it);
+            else
+                ++it;
+        }
+    }
+};
+
+template <typename T, typename Hash, typename Equal>
+const size_t Interner<T, Hash, Equal>::MIN_SWEEP;
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_INTERNER_H */
@@ -15,6 +15,12 @@
 
 #include <boost/noncopyable.hpp>
 
+#include <time.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
 #include <string>
 #include <unordered_set>
 #include <mutex>
@@ -112,6 +118,251 @@ private:
     }
 };
 
+/**
+ * Read a monotonic clock with a resolution of a few milliseconds,
+ * which is cheaper than a precise clock on a hot path
+ *
+ * @return the time in milliseconds
+ */
+inline uint64_t coarseMonotonicMs() {
+    struct timespec ts;
+#ifdef CLOCK_MONOTONIC_COARSE
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * A keyed rate limiter with the same behavior as KeyedRateLimiter
+ * that can be used from several threads under heavy load.  Keys are
+ * spread over NSHARDS shards by their hash, each with its own lock
+ * and buckets, and the time is read from a coarse clock.
+ *
+ * To bound the memory used when a flood brings many distinct keys,
+ * each bucket of a shard remembers at most MAX_KEYS keys exactly and
+ * the rest in a Bloom filter.  A key that collides in the filter with
+ * other overflowing keys is limited as if it had been seen, so under
+ * such a flood a few new keys may be limited too early, but none is
+ * ever let through too often.
+ *
+ * @param K the key type; must be hashable
+ * @param NBUCKETS the number of buckets for the rate limiter
+ * @param BUCKET_TIME the amount of time to allow for each "tick" on
+ * the buckets in milliseconds
+ * @param NSHARDS the number of shards
+ * @param MAX_KEYS the number of keys each bucket of a shard
+ * remembers exactly
+ */
+template <typename K,
+          const size_t NBUCKETS,
+          const uint64_t BUCKET_TIME,
+          const size_t NSHARDS = 16,
+          const size_t MAX_KEYS = 1024>
+class ShardedKeyedRateLimiter : private boost::noncopyable {
+public:
+    /**
+     * Instantiate a sharded keyed rate limiter
+     */
+    ShardedKeyedRateLimiter() {
+        clear();
+    }
+
+    /**
+     * Clear the rate limiter and reset its state to the initial state
+     */
+    void clear() {
+        uint64_t now = coarseMonotonicMs();
+        for (Shard& shard : shards) {
+            std::lock_guard<std::mutex> guard(shard.mtx);
+            shard.clear(now);
+        }
+    }
+
+    /**
+     * Apply the rate limiter to the given key.  Returns true if the
+     * key has not occurred too recently
+     *
+     * @param key the key to check
+     * @return true to indicate the event should be handled, otherwise
+     * false.
+     */
+    bool event(const K& key) {
+        size_t hash = std::hash<K>()(key);
+        Shard& shard = shards[hash % NSHARDS];
+        // the shard is chosen by the low bits, so mix the hash again
+        // for the filter
+        uint64_t fhash = (uint64_t)hash * 0x9e3779b97f4a7c15ULL;
+        uint64_t now = coarseMonotonicMs();
+
+        std::lock_guard<std::mutex> guard(shard.mtx);
+        if (shard.curBucketStart + BUCKET_TIME * NBUCKETS < now) {
+            // special case for very slow rate
+            shard.clear(now);
+        } else {
+            // advance the timer
+            while (shard.curBucketStart + BUCKET_TIME < now) {
+                shard.curBucketStart += BUCKET_TIME;
+                shard.curBucket = (shard.curBucket + 1) % NBUCKETS;
+                shard.buckets[shard.curBucket].clear();
+            }
+            for (Bucket& b : shard.buckets) {
+                if (b.contains(key, fhash))
+                    return false;
+            }
+        }
+
+        shard.buckets[shard.curBucket].insert(key, fhash);
+        return true;
+    }
+
+private:
+    /* bits of the Bloom filter of a bucket, and the number of bits
+       set for each key */
+    static const size_t FILTER_BITS = 8 * MAX_KEYS;
+    static const size_t FILTER_HASHES = 3;
+
+    class Bucket {
+    public:
+        Bucket() : overflowed(false) {}
+
+        bool contains(const K& key, uint64_t fhash) const {
+            if (keys.find(key) != keys.end())
+                return true;
+            if (!overflowed)
+                return false;
+            for (size_t i = 0; i < FILTER_HASHES; ++i) {
+                size_t bit = bitFor(fhash, i);
+                if (!(filter[bit / 64] & ((uint64_t)1 << (bit % 64))))
+                    return false;
+            }
+            return true;
+        }
+
+        void insert(const K& key, uint64_t fhash) {
+            if (keys.size() < MAX_KEYS) {
+                keys.insert(key);
+                return;
+            }
+            if (filter.empty())
+                filter.resize(FILTER_BITS / 64);
+            overflowed = true;
+            for (size_t i = 0; i < FILTER_HASHES; ++i) {
+                size_t bit = bitFor(fhash, i);
+                filter[bit / 64] |= (uint64_t)1 << (bit % 64);
+            }
+        }
+
+        void clear() {
+            keys.clear();
+            if (overflowed) {
+                std::fill(filter.begin(), filter.end(), 0);
+                overflowed = false;
+            }
+        }
+
+    private:
+        std::unordered_set<K> keys;
+        std::vector<uint64_t> filter;
+        bool overflowed;
+
+        static size_t bitFor(uint64_t fhash, size_t i) {
+            // double hashing from the two halves of the hash
+            uint32_t h1 = fhash >> 32;
+            uint32_t h2 = (uint32_t)fhash | 1;
+            return (h1 + i * h2) % FILTER_BITS;
+        }
+    };
+
+    class Shard {
+    public:
+        Shard() : curBucket(0), curBucketStart(0) {}
+
+        void clear(uint64_t now) {
+            for (Bucket& b : buckets)
+                b.clear();
+            curBucket = 0;
+            curBucketStart = now;
+        }
+
+        std::mutex mtx;
+        std::array<Bucket, NBUCKETS> buckets;
+        size_t curBucket;
+        uint64_t curBucketStart;
+    };
+
+    std::array<Shard, NSHARDS> shards;
+};
+
+/**
+ * A limit on the rate of events of one kind, as a bucket of tokens
+ * refilled at a fixed rate.  Each event takes a token, and events
+ * that find the bucket empty are limited.  The time is read from a
+ * coarse clock.
+ */
+class TokenBucket : private boost::noncopyable {
+public:
+    /**
+     * Instantiate a token bucket
+     *
+     * @param rate the events allowed per second, or 0 for no limit
+     * @param burst the most events allowed at once, or 0 to allow
+     * as many as the rate
+     */
+    explicit TokenBucket(uint64_t rate = 0, uint64_t burst = 0) {
+        setRate(rate, burst);
+    }
+
+    /**
+     * Set the rate of the events and fill the bucket
+     *
+     * @param rate the events allowed per second, or 0 for no limit
+     * @param burst the most events allowed at once, or 0 to allow
+     * as many as the rate
+     */
+    void setRate(uint64_t rate, uint64_t burst = 0) {
+        std::lock_guard<std::mutex> guard(mtx);
+        this->rate = rate;
+        capacity = (burst ? burst : rate) * TOKEN;
+        tokens = capacity;
+        last = coarseMonotonicMs();
+    }
+
+    /**
+     * Apply the limit to an event
+     *
+     * @return true to indicate the event should be handled, otherwise
+     * false.
+     */
+    bool event() {
+        std::lock_guard<std::mutex> guard(mtx);
+        if (rate == 0)
+            return true;
+        uint64_t now = coarseMonotonicMs();
+        if (now > last) {
+            // a rate per second is the same number of thousandths
+            // of a token per millisecond
+            tokens = std::min(capacity, tokens + (now - last) * rate);
+            last = now;
+        }
+        if (tokens < TOKEN)
+            return false;
+        tokens -= TOKEN;
+        return true;
+    }
+
+private:
+    /* tokens are counted in thousandths */
+    static const uint64_t TOKEN = 1000;
+
+    std::mutex mtx;
+    uint64_t rate;
+    uint64_t capacity;
+    uint64_t tokens;
+    uint64_t last;
+};
+
 } /* namespace opflexagent */
 
 #endif /* OPFLEXAGENT_KEYED_RATE_LIMITER */
@@ -103,7 +103,7 @@ public:
      * @param ranges the set of relevent VLAN ranges
      */
     void getVlanRangesByIface(const std::string& uuid,
-                              /* out */ std::set<vlan_range_t> ranges);
+                              /* out */ std::set<vlan_range_t>& ranges);
 
     /**
      * Callback function for forEachVlanRange
@@ -174,6 +174,9 @@ private:
 
     /**
      * Map vlan ranges to a set of interfaces that use those ranges.
+     * The ranges do not overlap, so this is an index of disjoint
+     * intervals: the ranges of an interface are split where they
+     * overlap the ranges of other interfaces.
      */
     range_lbi_map_t range_lbi_map;
 
@@ -186,8 +189,12 @@ private:
     void notifyListeners(const std::string& uuid);
     void notifyListeners(const range_set_t& notify);
     void removeIfaces(const LearningBridgeIface& lbi);
-    void addVlans(const LearningBridgeIface& lbi, range_set_t& notify);
-    void removeVlans(const LearningBridgeIface& lbi, range_set_t& notify);
+    void addVlans(const std::string& uuid, const range_set_t& vlans,
+                  range_set_t& notify);
+    void removeVlans(const std::string& uuid, const range_set_t& vlans,
+                     range_set_t& notify);
+    void splitRange(uint16_t vlan, range_set_t& notify);
+    void getIndexedRanges(const range_set_t& vlans, range_set_t& ranges);
 
     friend class LearningBridgeSource;
 };
@@ -0,0 +1,97 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for MPSCQueue
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_MPSCQUEUE_H
+#define OPFLEXAGENT_MPSCQUEUE_H
+
+#include <boost/noncopyable.hpp>
+
+#include <atomic>
+
+namespace opflexagent {
+
+/**
+ * A lock-free queue of intrusive nodes with any number of producers
+ * and a single consumer that takes all the queued nodes at once.
+ *
+ * Producers push onto a shared list with a compare-and-swap, and are
+ * told when they pushed onto an empty queue, so that exactly one of
+ * them wakes up the consumer for each batch.  The consumer takes the
+ * whole list with one exchange and gets it back in the order the
+ * nodes were pushed.  Since nodes are never popped one at a time,
+ * the list does not suffer from ABA.
+ *
+ * The queue owns the nodes pushed onto it until they are drained,
+ * and deletes those that are left when it is destroyed.
+ *
+ * @param T the type of the nodes, which must have a public member
+ * "T* next" for the use of the queue
+ */
+template <typename T>
+class MPSCQueue : private boost::noncopyable {
+public:
+    MPSCQueue() : head(nullptr) {}
+
+    ~MPSCQueue() {
+        T* node = drain();
+        while (node) {
+            T* next = node->next;
+            delete node;
+            node = next;
+        }
+    }
+
+    /**
+     * Push a node onto the queue.  May be called from any thread.
+     *
+     * @param node the node to push; the queue takes ownership
+     * @return true if the queue was empty, in which case the caller
+     * must make sure the consumer drains it
+     */
+    bool push(T* node) {
+        T* old = head.load(std::memory_order_relaxed);
+        do {
+            node->next = old;
+        } while (!head.compare_exchange_weak(old, node,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed));
+        return old == nullptr;
+    }
+
+    /**
+     * Take all the nodes from the queue.  Must only be called from
+     * one thread at a time.
+     *
+     * @return the first node in the order they were pushed, linked
+     * through their next member, or NULL if the queue is empty.  The
+     * caller takes ownership of the nodes.
+     */
+    T* drain() {
+        T* node = head.exchange(nullptr, std::memory_order_acquire);
+        T* first = nullptr;
+        while (node) {
+            T* next = node->next;
+            node->next = first;
+            first = node;
+            node = next;
+        }
+        return first;
+    }
+
+private:
+    /* the last node pushed */
+    std::atomic<T*> head;
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_MPSCQUEUE_H */
@@ -0,0 +1,183 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for MulticastGroupJournal
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_MULTICASTGROUPJOURNAL_H
+#define OPFLEXAGENT_MULTICASTGROUPJOURNAL_H
+
+#include <boost/noncopyable.hpp>
+
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace opflexagent {
+
+/**
+ * The multicast groups to subscribe to are kept in a JSON snapshot
+ * file listing the groups under "multicast-groups", and in a journal
+ * next to it, named after the snapshot with a ".journal" suffix, that
+ * holds one line per group joined or left since the snapshot:
+ *
+ *     <generation> +<group>
+ *     <generation> -<group>
+ *
+ * Each snapshot carries a generation, and only the journal lines of
+ * the generation of the snapshot apply to it.  Once the journal grows
+ * past the size of the snapshot, the writer replaces the snapshot
+ * with a new generation and truncates the journal, so a reader that
+ * sees them in either order ends up with the same groups.
+ */
+class MulticastGroupJournal {
+public:
+    /**
+     * Get the path of the journal of a snapshot file
+     *
+     * @param snapshot the path of the snapshot
+     * @return the path of its journal
+     */
+    static std::string getJournalPath(const std::string& snapshot);
+
+    /**
+     * The suffix of journal files
+     */
+    static const char* const JOURNAL_SUFFIX;
+};
+
+/**
+ * Writes the multicast groups to subscribe to as a snapshot file and
+ * its journal.  The writer is not thread safe.
+ */
+class MulticastGroupWriter : private boost::noncopyable {
+public:
+    /**
+     * Create a writer for the given snapshot file.  The first write
+     * always writes a snapshot.
+     *
+     * @param snapshot the path of the snapshot file
+     */
+    explicit MulticastGroupWriter(const std::string& snapshot);
+
+    /**
+     * Set whether changes are appended to the journal.  Without the
+     * journal, every write replaces the snapshot.
+     *
+     * @param enabled true to use the journal
+     */
+    void setJournal(bool enabled) { journal = enabled; }
+
+    /**
+     * Set the number of journal lines beyond which the snapshot is
+     * written again, if the snapshot holds fewer groups
+     *
+     * @param lines the minimum journal size before compaction
+     */
+    void setMinJournalLines(size_t lines) { minJournalLines = lines; }
+
+    /**
+     * Write the groups to subscribe to, appending the groups joined
+     * and left since the last write to the journal, in one write, or
+     * writing a new snapshot
+     *
+     * @param groups the groups to subscribe to
+     * @param snapshot true to write a new snapshot in any case
+     * @return true if the groups were written
+     */
+    bool write(const std::unordered_set<std::string>& groups,
+               bool snapshot = false);
+
+    /**
+     * Get the generation of the current snapshot
+     *
+     * @return the generation
+     */
+    uint64_t getGeneration() const { return generation; }
+
+private:
+    std::string snapshotPath;
+    std::string journalPath;
+    bool journal;
+    size_t minJournalLines;
+    bool started;
+    uint64_t generation;
+    size_t journalLines;
+    std::unordered_set<std::string> written;
+
+    bool writeSnapshot(const std::unordered_set<std::string>& groups);
+};
+
+/**
+ * Follows a snapshot file of multicast groups and its journal, and
+ * reports the groups joined and left as they change.  The reader is
+ * not thread safe.
+ */
+class MulticastGroupReader : private boost::noncopyable {
+public:
+    /**
+     * Create a reader of the given snapshot file
+     *
+     * @param snapshot the path of the snapshot file
+     */
+    explicit MulticastGroupReader(const std::string& snapshot);
+
+    /**
+     * Read the snapshot again, then its whole journal
+     *
+     * @param joins the groups joined since the last read are
+     * appended to this vector
+     * @param leaves the groups left since the last read are appended
+     * to this vector
+     */
+    void readSnapshot(std::vector<std::string>& joins,
+                      std::vector<std::string>& leaves);
+
+    /**
+     * Read the lines appended to the journal since the last read, or
+     * the whole journal if it was truncated
+     *
+     * @param joins the groups joined since the last read are
+     * appended to this vector
+     * @param leaves the groups left since the last read are appended
+     * to this vector
+     */
+    void readJournal(std::vector<std::string>& joins,
+                     std::vector<std::string>& leaves);
+
+    /**
+     * Forget the groups, as when the snapshot file is deleted
+     *
+     * @param leaves the groups are appended to this vector
+     */
+    void clear(std::vector<std::string>& leaves);
+
+    /**
+     * Get the groups currently subscribed to
+     *
+     * @return the groups
+     */
+    const std::unordered_set<std::string>& getGroups() const {
+        return groups;
+    }
+
+private:
+    std::string snapshotPath;
+    std::string journalPath;
+    bool haveGeneration;
+    uint64_t generation;
+    uint64_t journalInode;
+    uint64_t journalOffset;
+    std::unordered_set<std::string> groups;
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_MULTICASTGROUPJOURNAL_H */
@@ -15,6 +15,7 @@
 
 #include <memory>
 #include <unordered_set>
+#include <vector>
 
 #include <boost/noncopyable.hpp>
 #include <boost/asio/io_service.hpp>
@@ -50,6 +51,17 @@ public:
      */
     void sync(const std::shared_ptr<std::unordered_set<std::string> >& addrs);
 
+    /**
+     * Join and leave only the given groups, leaving the other
+     * subscriptions alone.  Groups already joined or not joined are
+     * skipped.
+     *
+     * @param joins the groups to join
+     * @param leaves the groups to leave
+     */
+    void update(const std::shared_ptr<const std::vector<std::string> >& joins,
+                const std::shared_ptr<const std::vector<std::string> >& leaves);
+
 private:
     boost::asio::io_service& io_service;
     std::unique_ptr<boost::asio::ip::udp::socket> socket_v4;
@@ -57,6 +57,16 @@ public:
      */
     ~NetFlowManager() {};
 
+    /**
+     * Report the tasks of this manager to a watchdog.  Set it before
+     * starting the manager.
+     *
+     * @param watchdog the watchdog
+     */
+    void setWatchdog(TaskWatchdog& watchdog) {
+        taskQueue.setWatchdog(&watchdog, "netflow");
+    }
+
     /**
      * Start the NetFlowManager
      */
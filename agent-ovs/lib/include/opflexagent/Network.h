@@ -15,6 +15,7 @@
 #include <utility>
 #include <string>
 #include <unordered_set>
+#include <map>
 
 #include <boost/asio/ip/address.hpp>
 #include <boost/optional.hpp>
@@ -224,6 +225,24 @@ bool prefix_match(const boost::asio::ip::address& addr,
                   uint32_t tgtPfxLen,
                   bool &is_exact_match);
 
+/**
+ * A map from the prefixes of a longest-prefix-match table to the
+ * identifier of the action taken for the addresses they contain
+ */
+typedef std::map<cidr_t, uint32_t> prefix_actions_t;
+
+/**
+ * Aggregate the prefixes of a longest-prefix-match table, so that
+ * every address matches the same action with fewer prefixes.  A
+ * prefix is removed when the longest prefix containing it has the
+ * same action, and two sibling prefixes with the same action are
+ * replaced by their parent.  The addresses of the prefixes are
+ * masked to their length, and IPv4 and IPv6 prefixes never merge.
+ *
+ * @param prefixes the prefixes to aggregate in place
+ */
+void aggregate_prefixes(prefix_actions_t& prefixes);
+
 } /* namespace packets */
 } /* namespace opflexagent */
 
@@ -13,7 +13,9 @@
 #ifndef OPFLEXAGENT_NOTIF_SERVER_H
 #define OPFLEXAGENT_NOTIF_SERVER_H
 
+#include <atomic>
 #include <memory>
+#include <unordered_map>
 #include <unordered_set>
 #include <set>
 
@@ -30,6 +32,14 @@ namespace opflexagent {
 /**
  * A server that listens to a UNIX socket and sends notifications to
  * listeners that connect and register on the socket.
+ *
+ * Each session has its own bounded queue of outgoing messages, which
+ * it writes one at a time from the io_service, so a slow listener
+ * never holds up the others or the thread dispatching the
+ * notification.  A queued notification is replaced by a newer one
+ * for the same subject.  When the queue is full the oldest queued
+ * message that has no subject, such as a reply, is dropped, or the
+ * oldest notification if there is none.
  */
 class NotifServer : private boost::noncopyable {
 public:
@@ -73,6 +83,26 @@ public:
      */
     void setSocketPerms(const std::string& perms);
 
+    /**
+     * Set the maximum number of notifications queued for a session
+     * before older ones are dropped.  This must be set before the
+     * server is started.
+     *
+     * @param maxQueued the maximum number of queued notifications
+     */
+    void setMaxQueued(size_t maxQueued);
+
+    /**
+     * Get the counters of the server: "sent", "coalesced" and
+     * "dropped" notifications, the number of "slow-consumers" that
+     * had notifications dropped, and the current number of
+     * "sessions"
+     *
+     * @param counts a map that will be filled with the counters
+     */
+    void getStats(/* out */ std::unordered_map<std::string,
+                                               uint64_t>& counts);
+
     /**
      * Start the server
      */
@@ -106,6 +136,22 @@ public:
      */
     typedef std::shared_ptr<session> session_ptr;
 
+    /**
+     * Counters shared by the sessions of the server
+     */
+    struct Stats {
+        /** notifications written to a session */
+        std::atomic<uint64_t> sent{0};
+        /** queued notifications replaced by a newer one */
+        std::atomic<uint64_t> coalesced{0};
+        /** notifications dropped from a full queue */
+        std::atomic<uint64_t> dropped{0};
+        /** sessions that had notifications dropped */
+        std::atomic<uint64_t> slowConsumers{0};
+        /** sessions currently connected */
+        std::atomic<uint64_t> sessions{0};
+    };
+
 private:
     boost::asio::io_service& io_service;
     std::string notifSocketPath;
@@ -113,12 +159,14 @@ private:
     std::string notifSocketGroup;
     std::string notifSocketPerms;
     std::atomic<bool> running;
+    size_t maxQueued;
 
     std::set<session_ptr> sessions;
+    std::shared_ptr<Stats> stats;
 
     std::unique_ptr<boost::asio::local::stream_protocol::acceptor> acceptor;
 
-    KeyedRateLimiter<std::string, 3, 5000> vipLimiter;
+    ShardedKeyedRateLimiter<std::string, 3, 5000> vipLimiter;
 
     void accept();
     void do_stop();
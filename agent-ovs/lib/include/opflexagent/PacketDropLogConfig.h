@@ -34,6 +34,38 @@ namespace opflexagent {
             optional<opflex::modb::MAC> srcMac, srcMacMask, dstMac, dstMacMask;
             optional<uint8_t> ipProto;
             optional<uint16_t> sport, dport;
+            /**
+             * Fraction of the packets matching the filter that are
+             * logged anyway, or none to prune all of them
+             */
+            optional<double> sample;
+    };
+    /**
+     * Sampling of the packets dropped at the end of the flow tables
+     */
+    class PacketDropLogSampling {
+    public:
+        PacketDropLogSampling(): probability(1.0) {};
+        /**
+         * Fraction of the dropped packets to log in the tables without
+         * a probability of their own
+         */
+        double probability;
+        /**
+         * Probability for each table, keyed by the name of the table in
+         * the drop reason, such as "Int-POL_TABLE"
+         */
+        std::map<std::string, double> tables;
+        /**
+         * Get the fraction of the packets dropped in a table to log
+         *
+         * @param table the name of the table in the drop reason
+         * @return the probability
+         */
+        double getProbability(const std::string& table) const {
+            auto it = tables.find(table);
+            return it != tables.end() ? it->second : probability;
+        }
     };
     /**
      * Collect Packet Drop Log Configuration
@@ -65,6 +97,10 @@ typedef modelgbp::observer::DropLogModeEnumT DropLogMode;
          * Whether Drop logging is enabled/disabled
          */
         bool dropLogEnable;
+        /**
+         * Sampling of the dropped packets
+         */
+        PacketDropLogSampling sampling;
     };
     /**
      * Collect Packet Drop Flow Specification
@@ -12,12 +12,117 @@
 #include <opflex/modb/URI.h>
 #include <opflex/modb/PropertyInfo.h>
 
+#include <list>
+#include <memory>
+#include <unordered_set>
+
 #pragma once
 #ifndef OPFLEXAGENT_POLICYLISTENER_H
 #define OPFLEXAGENT_POLICYLISTENER_H
 
 namespace opflexagent {
 
+class PolicyRule;
+
+/**
+ * The changes made to a policy contract by an update
+ */
+struct ContractDelta {
+    /**
+     * A set of group URIs
+     */
+    typedef std::unordered_set<opflex::modb::URI> uri_set_t;
+
+    /**
+     * A list of rules
+     */
+    typedef std::list<std::shared_ptr<PolicyRule> > rule_list_t;
+
+    /**
+     * Groups that started providing the contract
+     */
+    uri_set_t providersAdded;
+
+    /**
+     * Groups that stopped providing the contract
+     */
+    uri_set_t providersRemoved;
+
+    /**
+     * Groups that started consuming the contract
+     */
+    uri_set_t consumersAdded;
+
+    /**
+     * Groups that stopped consuming the contract
+     */
+    uri_set_t consumersRemoved;
+
+    /**
+     * Groups that started using the contract for intra-group traffic
+     */
+    uri_set_t intraAdded;
+
+    /**
+     * Groups that stopped using the contract for intra-group traffic
+     */
+    uri_set_t intraRemoved;
+
+    /**
+     * Rules new to the contract, including rules whose priority
+     * changed
+     */
+    rule_list_t rulesAdded;
+
+    /**
+     * Rules no longer in the contract, including rules whose priority
+     * changed
+     */
+    rule_list_t rulesRemoved;
+
+    /**
+     * Check whether the rules of the contract changed
+     * @return true if rules were added or removed
+     */
+    bool rulesChanged() const {
+        return !rulesAdded.empty() || !rulesRemoved.empty();
+    }
+
+    /**
+     * Add the groups whose relationship with the contract changed
+     * @param groups the set to add the groups to
+     */
+    void getChangedGroups(/* out */ uri_set_t& groups) const {
+        for (const uri_set_t* s : {&providersAdded, &providersRemoved,
+                                   &consumersAdded, &consumersRemoved,
+                                   &intraAdded, &intraRemoved}) {
+            groups.insert(s->begin(), s->end());
+        }
+    }
+};
+
+/**
+ * The changes made to the rules of a security group by an update
+ */
+struct SecGroupDelta {
+    /**
+     * A list of rules
+     */
+    typedef std::list<std::shared_ptr<PolicyRule> > rule_list_t;
+
+    /**
+     * Rules new to the security group, including rules whose
+     * priority changed
+     */
+    rule_list_t rulesAdded;
+
+    /**
+     * Rules no longer in the security group, including rules whose
+     * priority changed
+     */
+    rule_list_t rulesRemoved;
+};
+
 /**
  * An abstract interface for classes interested in updates related to
  * the policy and the indices.
@@ -68,12 +173,44 @@ public:
      */
     virtual void contractUpdated(const opflex::modb::URI&) {}
 
+    /**
+     * Called instead of contractUpdated() when the policy manager
+     * knows exactly what changed in the contract, so that only the
+     * state for the affected rules and groups needs updating.  The
+     * changes of several updates may be merged into one delta.  By
+     * default this calls contractUpdated().
+     *
+     * @param contractURI the URI of the contract
+     * @param delta the changes made to the contract
+     */
+    virtual void contractDeltaUpdated(const opflex::modb::URI& contractURI,
+                                      const ContractDelta& delta) {
+        contractUpdated(contractURI);
+    }
+
     /**
      * Called when a security group is updated, including changes to
      * the rules that compose the security group.
      */
     virtual void secGroupUpdated(const opflex::modb::URI&) {}
 
+    /**
+     * Called instead of secGroupUpdated() when the policy manager
+     * knows which rules of the security group changed, so that only
+     * the state for these rules needs updating.  The changes of
+     * several updates may be merged into one delta, in which a rule
+     * can be both added and removed.  By default this calls
+     * secGroupUpdated().
+     *
+     * @param secGroupURI the URI of the security group
+     * @param delta the changes made to the rules of the security
+     * group
+     */
+    virtual void secGroupDeltaUpdated(const opflex::modb::URI& secGroupURI,
+                                      const SecGroupDelta& delta) {
+        secGroupUpdated(secGroupURI);
+    }
+
     /**
      * Called when the platform config object is updated
      */
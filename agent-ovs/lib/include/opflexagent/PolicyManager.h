@@ -386,6 +386,16 @@ public:
      */
     ~PolicyManager();
 
+    /**
+     * Report the tasks of this manager to a watchdog.  Set it before
+     * starting the manager.
+     *
+     * @param watchdog the watchdog
+     */
+    void setWatchdog(TaskWatchdog& watchdog) {
+        taskQueue.setWatchdog(&watchdog, "policy");
+    }
+
     /**
      * Set the opflex domain for the policy manager
      *
@@ -630,6 +640,19 @@ public:
      */
     typedef std::unordered_set<opflex::modb::URI> uri_set_t;
 
+    /**
+     * Resolve the policy an endpoint group is expected to need as
+     * soon as a local source references the group, rather than one
+     * level of references per round trip.  The group is prefetched
+     * along with the forwarding domains, subnets and contracts it
+     * had when it was last resolved or, for a group not seen before,
+     * the routing domains of the other groups in its policy space.
+     * Nothing is done if the group is already resolved.
+     *
+     * @param egURI the URI of the endpoint group
+     */
+    void prefetchGroup(const opflex::modb::URI& egURI);
+
     /**
      * Get all known endpoint groups.
      *
@@ -848,7 +871,7 @@ public:
     typedef std::unordered_set<std::string> named_addr_set_t;
     /**
      * Get cached Dns resolved addresses:ports for a given domain name.
-     * if they exist in the cache. Call with the state mutex held.
+     * if they exist in the cache.
      * @param domainName
      * @param egressDnsResolved resolved address set
      */
@@ -933,6 +956,23 @@ private:
      */
     group_map_t group_map;
 
+    /**
+     * The policy an endpoint group referenced when it was last
+     * resolved
+     */
+    struct PrefetchState {
+        std::vector<std::pair<opflex::modb::class_id_t,
+                              opflex::modb::URI> > domains;
+        uri_set_t contracts;
+    };
+
+    /**
+     * A map from EPG URI to the policy to prefetch for it.  Entries
+     * are removed with the group, so a group that is gone is
+     * prefetched with the routing domains of its policy space.
+     */
+    std::unordered_map<opflex::modb::URI, PrefetchState> prefetch_map;
+
     /**
      * A map from EPG vnid to EPG URI
      */
@@ -976,6 +1016,13 @@ private:
     std::mutex state_mutex;
     std::mutex subnets_rd_mutex;
 
+    /**
+     * Guards writes to dns_demand_map against the rule resolution
+     * that runs without the state mutex.  Writers must also hold the
+     * state mutex, so readers under the state mutex need not take it.
+     */
+    std::mutex dns_mutex;
+
     // Listen to changes related to forwarding domains
     class DomainListener : public opflex::modb::ObjectListener {
     public:
@@ -1028,12 +1075,26 @@ private:
      */
     contract_map_t contractMap;
 
+    /**
+     * Map of Contract URI to the changes made to the contract that
+     * listeners have not been notified of yet.  A contract notified
+     * with no entry here gets a full update.
+     */
+    std::unordered_map<opflex::modb::URI, ContractDelta> contractDeltas;
+
     struct SecGrpState {
         std::unordered_set<std::string> dnsAsks;
         rule_list_t rules;
     };
     typedef std::unordered_map<opflex::modb::URI, SecGrpState> secgrp_map_t;
 
+    /**
+     * Map of security group URI to the changes made to its rules that
+     * listeners have not been notified of yet.  A security group
+     * notified with no entry here gets a full update.
+     */
+    std::unordered_map<opflex::modb::URI, SecGroupDelta> secGrpDeltas;
+
     /**
      * Map of security group URI to its rules
      */
@@ -1049,7 +1110,13 @@ private:
 
         virtual void objectUpdated(opflex::modb::class_id_t class_id,
                                     const opflex::modb::URI& uri);
+        virtual void objectsUpdated(const update_list_t& updates);
     private:
+        // dispatch a per-URI update task; returns false if the update
+        // should instead trigger a full contract update
+        bool dispatchUpdate(opflex::modb::class_id_t class_id,
+                            const opflex::modb::URI& uri);
+
         PolicyManager& pmanager;
     };
     ContractListener contractListener;
@@ -1064,6 +1131,7 @@ private:
 
         virtual void objectUpdated(opflex::modb::class_id_t class_id,
                                     const opflex::modb::URI& uri);
+        virtual void objectsUpdated(const update_list_t& updates);
     private:
         PolicyManager& pmanager;
     };
@@ -1192,15 +1260,91 @@ private:
                               uri_set_t& updatedContracts);
 
     /**
-     * Update the classifier rules associated with a contract.
+     * The rules of a contract or security group resolved from the
+     * MODB, ready to replace its current rules
+     */
+    struct ResolvedRules {
+        /**
+         * The current rules on input, the new rules if updated
+         */
+        rule_list_t rules;
+
+        /**
+         * True if the rules changed
+         */
+        bool updated = false;
+
+        /**
+         * True if the contract or security group could not be resolved
+         */
+        bool notFound = false;
+
+        /**
+         * Redirect destination groups referenced by the current rules
+         */
+        uri_set_t oldRedirGrps;
+
+        /**
+         * Redirect destination groups referenced by the new rules
+         */
+        uri_set_t newRedirGrps;
+
+        /**
+         * DNS names referenced by the new rules
+         */
+        named_addr_set_t dnsRefs;
+    };
+
+    /**
+     * Resolve the classifier rules associated with a contract.  Does
+     * not need the state mutex.
+     *
+     * @param contractURI URI of contract to resolve
+     * @param resolved the current rules, replaced with the result
+     */
+    void resolveContractRules(const opflex::modb::URI& contractURI,
+                              ResolvedRules& resolved);
+
+    /**
+     * Install the resolved rules of a contract.  Call with the state
+     * mutex held.
      *
      * @param contractURI URI of contract to update
-     * @param notFound set to true if contract could not be resolved
+     * @param resolved the result of resolveContractRules()
      * @return true if rules for this contract were updated
      */
-    bool updateContractRules(const opflex::modb::URI& contractURI,
-            bool& notFound);
+    bool applyContractRules(const opflex::modb::URI& contractURI,
+                            ResolvedRules& resolved);
 
+    /**
+     * Resolve the classifier rules associated with a security group.
+     * Does not need the state mutex.
+     *
+     * @param secGrpURI URI of security group to resolve
+     * @param resolved the current rules, replaced with the result
+     */
+    void resolveSecGrpRules(const opflex::modb::URI& secGrpURI,
+                            ResolvedRules& resolved);
+
+    /**
+     * Install the resolved rules of a security group.  Call with the
+     * state mutex held.
+     *
+     * @param secGrpURI URI of security group to update
+     * @param resolved the result of resolveSecGrpRules()
+     * @return true if rules for this security group were updated
+     */
+    bool applySecGrpRules(const opflex::modb::URI& secGrpURI,
+                          ResolvedRules& resolved);
+
+    /**
+     * Update the classifier rules associated with a security group.
+     * Call with the state mutex held.
+     *
+     * @param secGrpURI URI of security group to update
+     * @param notFound set to true if the group could not be resolved
+     * @return true if rules for this security group were updated
+     */
     bool updateSecGrpRules(const opflex::modb::URI& secGrpURI,
                            bool& notFound);
 
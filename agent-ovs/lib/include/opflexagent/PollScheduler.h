@@ -0,0 +1,52 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for PollScheduler
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_POLLSCHEDULER_H
+#define OPFLEXAGENT_POLLSCHEDULER_H
+
+#include <boost/noncopyable.hpp>
+
+#include <atomic>
+
+namespace opflexagent {
+
+/**
+ * Spreads the polls of the statistics managers across their polling
+ * intervals.  The managers start together and mostly share the same
+ * interval, so otherwise their requests reach the switch at the same
+ * moment of every interval.
+ *
+ * Each poller that starts takes the next phase of a low-discrepancy
+ * sequence, which keeps any number of pollers evenly spread without
+ * knowing how many there will be.  Pollers that keep their interval
+ * after the first poll keep their phase.
+ */
+class PollScheduler : private boost::noncopyable {
+public:
+    PollScheduler();
+
+    /**
+     * Get the delay before the first poll of a new poller.  The first
+     * poller gets the full interval.
+     *
+     * @param interval the polling interval, in milliseconds
+     * @return the delay, between 1 and interval milliseconds
+     */
+    long firstDelay(long interval);
+
+private:
+    std::atomic<unsigned> pollers;
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_POLLSCHEDULER_H */
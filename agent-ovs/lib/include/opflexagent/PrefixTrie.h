@@ -0,0 +1,286 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for PrefixTrie
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_PREFIX_TRIE_H
+#define OPFLEXAGENT_PREFIX_TRIE_H
+
+#include <boost/asio/ip/address.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
+
+#include <array>
+#include <cstring>
+#include <memory>
+
+namespace opflexagent {
+
+/**
+ * A path-compressed binary trie mapping IPv4 and IPv6 prefixes to
+ * values, which finds the value of an exact prefix or the prefixes
+ * containing an address in time bounded by the length of the address
+ * rather than by the number of prefixes stored.  A host address is
+ * simply a prefix of the full address length.  IPv4 and IPv6
+ * prefixes live in separate tries, and the bits of a prefix past its
+ * length are ignored.
+ *
+ * The trie is not thread safe.
+ *
+ * @param T the type of the values
+ */
+template <typename T>
+class PrefixTrie : private boost::noncopyable {
+public:
+    /**
+     * Instantiate an empty trie
+     */
+    PrefixTrie() : count(0) {}
+
+    /**
+     * Get the value of a prefix, adding a default-constructed value
+     * if the prefix is not present
+     *
+     * @param addr the address of the prefix
+     * @param prefixLen the length of the prefix, clamped to the
+     * length of the address
+     * @return the value of the prefix
+     */
+    T& insert(const boost::asio::ip::address& addr, uint8_t prefixLen) {
+        key_t key;
+        uint8_t len = makeKey(addr, prefixLen, key);
+        std::unique_ptr<Node>* link = &root(addr);
+        while (*link) {
+            Node* n = link->get();
+            uint8_t common = commonLen(n->key, key, std::min(n->len, len));
+            if (common < n->len) {
+                // the prefix diverges from this node or ends above
+                // it, so a new node goes in its place
+                std::unique_ptr<Node> split(new Node(key, common));
+                Node* added = split.get();
+                split->child[bit(n->key, common)] = std::move(*link);
+                if (common < len) {
+                    added = new Node(key, len);
+                    split->child[bit(key, common)].reset(added);
+                }
+                *link = std::move(split);
+                return setValue(added);
+            }
+            if (n->len == len)
+                return setValue(n);
+            link = &n->child[bit(key, n->len)];
+        }
+        link->reset(new Node(key, len));
+        return setValue(link->get());
+    }
+
+    /**
+     * Find the value of an exact prefix
+     *
+     * @param addr the address of the prefix
+     * @param prefixLen the length of the prefix
+     * @return the value, or NULL if the prefix is not present
+     */
+    T* find(const boost::asio::ip::address& addr, uint8_t prefixLen) {
+        key_t key;
+        uint8_t len = makeKey(addr, prefixLen, key);
+        Node* n = root(addr).get();
+        while (n && n->len <= len &&
+               commonLen(n->key, key, n->len) == n->len) {
+            if (n->len == len)
+                return n->value ? n->value.get_ptr() : NULL;
+            n = n->child[bit(key, n->len)].get();
+        }
+        return NULL;
+    }
+
+    /**
+     * Find the value of the longest prefix containing an address
+     *
+     * @param addr the address
+     * @param prefixLen if not NULL, set to the length of the matching
+     * prefix
+     * @return the value, or NULL if no prefix contains the address
+     */
+    T* longestMatch(const boost::asio::ip::address& addr,
+                    uint8_t* prefixLen = NULL) {
+        Node* best = NULL;
+        visit(addr, [&best](Node* n) { best = n; });
+        if (!best) return NULL;
+        if (prefixLen) *prefixLen = best->len;
+        return best->value.get_ptr();
+    }
+
+    /**
+     * Call a function with the length and value of every prefix
+     * containing an address, shortest first
+     *
+     * @param addr the address
+     * @param f the function to call as f(uint8_t prefixLen, T& value)
+     */
+    template <typename F>
+    void visitMatches(const boost::asio::ip::address& addr, F f) {
+        visit(addr, [&f](Node* n) { f(n->len, n->value.get()); });
+    }
+
+    /**
+     * Remove a prefix
+     *
+     * @param addr the address of the prefix
+     * @param prefixLen the length of the prefix
+     * @return true if the prefix was present
+     */
+    bool erase(const boost::asio::ip::address& addr, uint8_t prefixLen) {
+        key_t key;
+        uint8_t len = makeKey(addr, prefixLen, key);
+        std::unique_ptr<Node>* parent = NULL;
+        std::unique_ptr<Node>* link = &root(addr);
+        while (*link && (*link)->len < len &&
+               commonLen((*link)->key, key, (*link)->len) == (*link)->len) {
+            parent = link;
+            link = &(*link)->child[bit(key, (*link)->len)];
+        }
+        Node* n = link->get();
+        if (!n || n->len != len || !n->value ||
+            commonLen(n->key, key, len) != len)
+            return false;
+
+        n->value = boost::none;
+        count -= 1;
+        compact(*link);
+        if (parent)
+            compact(*parent);
+        return true;
+    }
+
+    /**
+     * Get the number of prefixes in the trie
+     *
+     * @return the number of prefixes
+     */
+    size_t size() const { return count; }
+
+    /**
+     * Check whether the trie is empty
+     *
+     * @return true if there are no prefixes in the trie
+     */
+    bool empty() const { return count == 0; }
+
+    /**
+     * Remove all prefixes
+     */
+    void clear() {
+        v4root.reset();
+        v6root.reset();
+        count = 0;
+    }
+
+private:
+    typedef std::array<uint8_t, 16> key_t;
+
+    struct Node {
+        Node(const key_t& key_, uint8_t len_) : key(key_), len(len_) {
+            // clear the bits past the prefix
+            size_t i = len / 8;
+            if (i < key.size()) {
+                key[i] &= (uint8_t)(0xff00 >> (len % 8));
+                std::memset(key.data() + i + 1, 0, key.size() - i - 1);
+            }
+        }
+
+        key_t key;
+        uint8_t len;
+        boost::optional<T> value;
+        std::unique_ptr<Node> child[2];
+    };
+
+    std::unique_ptr<Node> v4root;
+    std::unique_ptr<Node> v6root;
+    size_t count;
+
+    std::unique_ptr<Node>& root(const boost::asio::ip::address& addr) {
+        return addr.is_v4() ? v4root : v6root;
+    }
+
+    static uint8_t makeKey(const boost::asio::ip::address& addr,
+                           uint8_t prefixLen, key_t& key) {
+        key.fill(0);
+        if (addr.is_v4()) {
+            auto bytes = addr.to_v4().to_bytes();
+            std::copy(bytes.begin(), bytes.end(), key.begin());
+            return std::min<uint8_t>(prefixLen, 32);
+        }
+        auto bytes = addr.to_v6().to_bytes();
+        std::copy(bytes.begin(), bytes.end(), key.begin());
+        return std::min<uint8_t>(prefixLen, 128);
+    }
+
+    static uint8_t maxLen(const boost::asio::ip::address& addr) {
+        return addr.is_v4() ? 32 : 128;
+    }
+
+    static int bit(const key_t& key, uint8_t pos) {
+        return (key[pos / 8] >> (7 - pos % 8)) & 1;
+    }
+
+    /* the number of leading bits, up to max, that two keys share */
+    static uint8_t commonLen(const key_t& a, const key_t& b, uint8_t max) {
+        uint8_t len = 0;
+        for (size_t i = 0; len < max; ++i, len += 8) {
+            uint8_t diff = a[i] ^ b[i];
+            if (diff) {
+                while (!(diff & 0x80)) {
+                    diff <<= 1;
+                    len += 1;
+                }
+                break;
+            }
+        }
+        return std::min(len, max);
+    }
+
+    T& setValue(Node* n) {
+        if (!n->value) {
+            n->value = T();
+            count += 1;
+        }
+        return n->value.get();
+    }
+
+    /* call f with every node holding a value whose prefix contains
+       the address, shortest first */
+    template <typename F>
+    void visit(const boost::asio::ip::address& addr, F f) {
+        key_t key;
+        uint8_t len = makeKey(addr, maxLen(addr), key);
+        Node* n = root(addr).get();
+        while (n && commonLen(n->key, key, n->len) == n->len) {
+            if (n->value)
+                f(n);
+            if (n->len == len) break;
+            n = n->child[bit(key, n->len)].get();
+        }
+    }
+
+    /* remove a node that holds no value and no longer branches */
+    static void compact(std::unique_ptr<Node>& link) {
+        Node* n = link.get();
+        if (!n || n->value || (n->child[0] && n->child[1]))
+            return;
+        std::unique_ptr<Node> next =
+            std::move(n->child[0] ? n->child[0] : n->child[1]);
+        link = std::move(next);
+    }
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_PREFIX_TRIE_H */
@@ -0,0 +1,118 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for ProcStats
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_PROCSTATS_H
+#define OPFLEXAGENT_PROCSTATS_H
+
+#include <boost/noncopyable.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace opflexagent {
+
+/**
+ * Sample the CPU and memory use of a process and the CPU time of
+ * each of its threads from procfs.
+ *
+ * The stat files of the process and its threads are kept open and
+ * read again from the start on each sample into a fixed buffer, so a
+ * sample costs one read per thread and does not allocate.  The task
+ * directory is only listed again when the number of threads changes
+ * or a thread goes away.
+ *
+ * The sampler is not thread safe.
+ */
+class ProcStats : private boost::noncopyable {
+public:
+    /**
+     * Create a sampler for a process
+     *
+     * @param procDir the procfs directory of the process
+     */
+    explicit ProcStats(const std::string& procDir = "/proc/self");
+
+    /**
+     * Close the procfs files
+     */
+    ~ProcStats();
+
+    /**
+     * Read the current stats of the process and its threads
+     *
+     * @return false if the stats of the process could not be read
+     */
+    bool sample();
+
+    /**
+     * Get the user and system CPU time of the process as of the last
+     * sample
+     *
+     * @return the CPU time in seconds
+     */
+    double getCpuSeconds() const { return cpuSeconds; }
+
+    /**
+     * Get the resident set size of the process as of the last sample
+     *
+     * @return the resident set size in bytes
+     */
+    uint64_t getRssBytes() const { return rssBytes; }
+
+    /**
+     * Get the number of threads of the process as of the last sample
+     *
+     * @return the number of threads
+     */
+    uint64_t getThreadCount() const { return threadCount; }
+
+    /**
+     * Get the user and system CPU time of the threads as of the last
+     * sample, summed over the threads sharing a name
+     *
+     * @param cpu a map that will be filled with the CPU time in
+     * seconds per thread name
+     */
+    void getThreadCpuSeconds(/* out */
+                             std::unordered_map<std::string, double>& cpu)
+        const;
+
+private:
+    struct Task {
+        Task() : fd(-1), ticks(0) {}
+
+        int fd;
+        std::string name;
+        uint64_t ticks;
+    };
+
+    std::string procDir;
+    int statFd;
+    double ticksPerSecond;
+    uint64_t pageSize;
+
+    double cpuSeconds;
+    uint64_t rssBytes;
+    uint64_t threadCount;
+
+    /* the threads of the process by thread ID */
+    std::unordered_map<long, Task> tasks;
+
+    void scanTasks();
+    void closeTasks();
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_PROCSTATS_H */
@@ -15,12 +15,17 @@
 
 #include <opflex/ofcore/OFFramework.h>
 #include <opflexagent/logging.h>
+#include <opflexagent/DataplaneLatency.h>
+#include <opflexagent/FlowProgrammingStats.h>
+#include <opflexagent/TaskWatchdog.h>
+#include <array>
 #include <unordered_map>
 #include <unordered_set>
 #include <memory>
 #include <string>
 #include <mutex>
 #include <regex>
+#include <set>
 
 #include <prometheus/gauge.h>
 #include <prometheus/counter.h>
@@ -28,6 +33,7 @@
 #include <prometheus/registry.h>
 
 #include <modelgbp/observer/ModbCounts.hpp>
+#include <opflex/modb/ClassStats.h>
 
 class OFServerStats;
 namespace opflexagent {
@@ -53,8 +59,6 @@ using namespace modelgbp::observer;
 class Agent;
 struct EpCounters;
 
-// Optional pair of label attr hash and Gauge ptr
-typedef optional<pair<size_t, Gauge *> >  hgauge_pair_t;
 // Optional pair of label attr map and Gauge ptr
 typedef optional<pair<map<string, string>, Gauge *> >  mgauge_pair_t;
 
@@ -251,6 +255,39 @@ public:
      */
     void removeOFAgentStats(const std::string& agent);
 
+    /**
+     * A snapshot of the stats of every connected agent, keyed by the
+     * agent IP+port
+     */
+    typedef std::unordered_map<std::string, std::shared_ptr<OFServerStats> >
+        agent_stats_map_t;
+
+    /**
+     * Update the OFAgentStats and latency histograms of every agent
+     * in the snapshot, taking each lock once, and remove the metrics
+     * of the agents no longer in it
+     *
+     * @param stats   the stats of every connected agent
+     */
+    void updateOFAgentStats(const agent_stats_map_t& stats);
+
+    /* Latency histogram related APIs */
+    /**
+     * Create the latency histograms of an opflex agent if not present.
+     * Update the latency histograms if already present
+     *
+     * @param agent   the opflex agent; typically the agentIp:port
+     * @param stats   opflex stats corresponding to the agent
+     */
+    void addNUpdateOFAgentLatency(const std::string& agent,
+                                  const std::shared_ptr<OFServerStats> stats);
+    /**
+     * Remove the latency histograms of an opflex agent
+     *
+     * @param agent   the opflex agent; typically the agentIp:port
+     */
+    void removeOFAgentLatency(const std::string& agent);
+
 private:
     // Init state
     virtual void init(void) override;
@@ -296,28 +333,91 @@ private:
     // remove any ofagent stats gauge metric families during stop
     void removeStaticGaugeFamiliesOFAgent(void);
 
+    /**
+     * The gauges of every OFAgentStats metric for one agent
+     */
+    struct ofagent_gauges_t {
+        Gauge* gauge[OFAGENT_METRICS_MAX+1];
+    };
+
     // Dynamic Metric families and metrics
-    // CRUD for every OFAgent counter metric
-    // func to create gauge for OFAgentStats given metric type,
+    // CRUD for the OFAgent counter metrics of an agent
+    // func to create the gauges for OFAgentStats given the
     // agent: the unique agent (IP,port) tuple
-    void createDynamicGaugeOFAgent(OFAGENT_METRICS metric,
-                                  const string& agent);
+    ofagent_gauges_t* createDynamicGaugeOFAgent(const string& agent);
 
-    // func to get label map and Gauge for OFAgentStats given metric type, agent
-    Gauge * getDynamicGaugeOFAgent(OFAGENT_METRICS metric, const string& agent);
+    // func to get the gauges for OFAgentStats given the agent
+    ofagent_gauges_t* getDynamicGaugeOFAgent(const string& agent);
 
-    // func to remove gauge for OFAgentStats given metric type, agent
-    bool removeDynamicGaugeOFAgent(OFAGENT_METRICS metric, const string& agent);
-    // func to remove all gauge of every OFAgentStats for a metric type
-    void removeDynamicGaugeOFAgent(OFAGENT_METRICS metric);
+    // func to set the gauges of an agent from its stats
+    void updateDynamicGaugeOFAgent(ofagent_gauges_t& gauges,
+                                   OFServerStats& stats);
+
+    // func to remove the gauges for OFAgentStats given the agent
+    bool removeDynamicGaugeOFAgent(const string& agent);
     // func to remove all gauges of every OFAgentStats
     void removeDynamicGaugeOFAgent(void);
 
     /**
-     * cache Gauge ptr for every agent metric
+     * cache the gauges of every agent, so that an update looks the
+     * agent up once for all of its metrics
      */
-    unordered_map<string, Gauge*> ofagent_gauge_map[OFAGENT_METRICS_MAX+1];
+    unordered_map<string, ofagent_gauges_t> ofagent_gauge_map;
     /* End of OFAgentStats related apis and state */
+
+
+    /* Start of latency histogram related apis and state */
+    // Lock to safe guard latency histogram related state
+    mutex latency_mutex;
+
+    enum LATENCY_METRICS {
+        LATENCY_METRICS_MIN,
+        LATENCY_AGENT_KEEPALIVE_RTT = LATENCY_METRICS_MIN,
+        LATENCY_AGENT_METHOD,
+        LATENCY_METRICS_MAX = LATENCY_AGENT_METHOD
+    };
+
+    /**
+     * The gauges exported for one histogram: a cumulative count per
+     * bucket with an "le" label, the sum and the count
+     */
+    struct latency_gauges_t {
+        Gauge* bucket[OFLatencyHistogram::BUCKETS+1];
+        Gauge* sum;
+        Gauge* count;
+    };
+
+    // metric families to track the buckets, sum and count per metric
+    Family<Gauge>      *gauge_latency_bucket_family_ptr[LATENCY_METRICS_MAX+1];
+    Family<Gauge>      *gauge_latency_sum_family_ptr[LATENCY_METRICS_MAX+1];
+    Family<Gauge>      *gauge_latency_count_family_ptr[LATENCY_METRICS_MAX+1];
+
+    // create latency gauge metric families during start
+    void createStaticGaugeFamiliesLatency(void);
+    // remove latency gauge metric families during stop
+    void removeStaticGaugeFamiliesLatency(void);
+    // func to create or update the gauges of a histogram
+    void updateDynamicGaugeLatency(LATENCY_METRICS metric,
+                                   const string& agent,
+                                   const OFLatencyHistogram& hist,
+                                   const string& method = "");
+    // func to create or update every histogram of an agent
+    void updateDynamicGaugeLatency(const string& agent,
+                                   OFServerStats& stats);
+    // func to remove the gauges of a histogram
+    void removeDynamicGaugeLatency(LATENCY_METRICS metric,
+                                   const string& agent,
+                                   const string& method = "");
+    // func to remove all latency histogram gauges
+    void removeDynamicGaugeLatency(void);
+
+    /**
+     * cache the gauges of every histogram per metric, keyed by the
+     * agent and, for per method metrics, the method
+     */
+    map<pair<string, string>, latency_gauges_t>
+        latency_gauge_map[LATENCY_METRICS_MAX+1];
+    /* End of latency histogram related apis and state */
 };
 
 class AgentPrometheusManager : private PrometheusManager {
@@ -337,13 +437,57 @@ public:
      *                                should be bound with local host only.
      * @param exposeEpSvcNan          flag to indicate if Nan ep<-->svc
      *                                metrics need to be exposed.
+     * @param exposeGroupPaths        flag to indicate if each group of
+     *                                metric families should also be
+     *                                exposed on its own path, such as
+     *                                /metrics/endpoint
      */
-    void start(bool exposeLocalHostOnly, bool exposeEpSvcNan);
+    void start(bool exposeLocalHostOnly, bool exposeEpSvcNan,
+               bool exposeGroupPaths = false);
     /**
      * Stop the prometheus manager
      */
     void stop();
 
+    /**
+     * Which endpoints get metrics once the endpoint budget is used up
+     */
+    enum EP_EXPORT_MODE {
+        /** Keep the endpoints that got metrics first */
+        EP_EXPORT_FIRST,
+        /** Keep the endpoints with the most dropped packets */
+        EP_EXPORT_TOP_DROPS
+    };
+
+    /**
+     * Limits on the number of dynamic metrics, to bound the memory
+     * used by metric families on large nodes
+     */
+    struct CardinalityBudget {
+        CardinalityBudget()
+            : maxEps(0), maxSvcTargets(0), lazyEpGauges(false),
+              epExportMode(EP_EXPORT_FIRST) {}
+
+        /** Maximum number of endpoints with metrics; 0 for no limit */
+        size_t maxEps;
+        /** Maximum number of service targets with metrics; 0 for no
+            limit */
+        size_t maxSvcTargets;
+        /** Create the metrics of an endpoint only once one of its
+            counters is non-zero */
+        bool lazyEpGauges;
+        /** Endpoints to export once maxEps is reached */
+        EP_EXPORT_MODE epExportMode;
+    };
+
+    /**
+     * Set the limits on dynamic metrics. Metrics that already exist
+     * are kept.
+     *
+     * @param budget the new limits
+     */
+    void setCardinalityBudget(const CardinalityBudget& budget);
+
     /* EpCounter related APIs */
     /**
      * Return a rolling hash of attribute map for the ep
@@ -519,6 +663,135 @@ public:
      */
     void removeMoDBCounts(void);
 
+    /* MoDB class memory accounting related APIs */
+    /**
+     * Create ModbClassStats metrics for a class if not present.
+     * Update ModbClassStats metrics if already present
+     *
+     * @param className  name of the model class
+     * @param stats      approximate memory accounting for the class
+     */
+    void addNUpdateModbClassStats(const string& className,
+                                  const opflex::modb::ClassStats& stats);
+    /**
+     * Remove ModbClassStats metrics for a class
+     *
+     * @param className  name of the model class
+     */
+    void removeModbClassStats(const string& className);
+
+    /* Processor backlog related APIs */
+    /**
+     * Create ProcessorStats metric for an item state if not present.
+     * Update ProcessorStats metric if already present
+     *
+     * @param state  name of the processor item state
+     * @param count  number of objects in that state
+     */
+    void addNUpdateProcessorStats(const string& state, uint64_t count);
+
+    /* Notification server related APIs */
+    /**
+     * Create NotifStats metric for a counter if not present.
+     * Update NotifStats metric if already present
+     *
+     * @param counter  name of the notification server counter
+     * @param count    value of the counter
+     */
+    void addNUpdateNotifStats(const string& counter, uint64_t count);
+
+    /* Process and thread usage related APIs */
+    /**
+     * Create ProcessStats metric for a process stat if not present.
+     * Update ProcessStats metric if already present
+     *
+     * @param stat   name of the stat, such as "cpu_seconds"
+     * @param value  value of the stat
+     */
+    void addNUpdateProcessStats(const string& stat, double value);
+    /**
+     * Create ThreadCpu metric for a thread name if not present.
+     * Update ThreadCpu metric if already present
+     *
+     * @param thread   name of the thread
+     * @param seconds  CPU time of the threads with that name
+     */
+    void addNUpdateThreadCpu(const string& thread, double seconds);
+    /**
+     * Remove ThreadCpu metric for a thread name
+     *
+     * @param thread   name of the thread
+     */
+    void removeThreadCpu(const string& thread);
+
+    /* Startup timeline related APIs */
+    /**
+     * Create StartupStats metric for a startup phase or milestone if
+     * not present. Update StartupStats metric if already present
+     *
+     * @param event    name of the phase or milestone
+     * @param seconds  duration of the phase, or time from the start
+     *                 of the agent to the milestone
+     */
+    void addNUpdateStartupStats(const string& event, double seconds);
+
+    /* Latency histogram related APIs */
+    /**
+     * Create the latency histograms of an opflex peer if not present.
+     * Update the latency histograms if already present
+     *
+     * @param peer    the opflex peer; typically the peerIp:port
+     * @param stats   opflex stats corresponding to the peer
+     */
+    void addNUpdateOFPeerLatency(const std::string& peer,
+                                 const std::shared_ptr<OFAgentStats> stats);
+    /**
+     * Remove the latency histograms of an opflex peer
+     *
+     * @param peer    the opflex peer; typically the peerIp:port
+     */
+    void removeOFPeerLatency(const std::string& peer);
+    /**
+     * Create the processor latency histograms if not present.
+     * Update the processor latency histograms if already present
+     *
+     * @param processTime     time spent processing each item, in
+     *                        microseconds
+     * @param resolveLatency  policy resolve latency per model class, in
+     *                        milliseconds
+     */
+    void addNUpdateProcessorLatency(
+        const OFLatencyHistogram& processTime,
+        const unordered_map<string,
+            std::shared_ptr<const OFLatencyHistogram>>&
+            resolveLatency);
+    /**
+     * Create the dataplane latency histograms if not present.
+     * Update the dataplane latency histograms if already present
+     *
+     * @param latency  latency per stage from policy and endpoint
+     *                 changes to the flows acknowledged by the switch,
+     *                 in milliseconds
+     */
+    void addNUpdateDataplaneLatency(const DataplaneLatency& latency);
+    /**
+     * Create the flow table gauges and the flow write histograms of
+     * each bridge if not present.  Update them if already present
+     *
+     * @param stats    flow changes and flows kept per bridge and
+     *                 table, and the changes per write and barrier
+     *                 latency per bridge
+     */
+    void addNUpdateFlowProgrammingStats(const FlowProgrammingStats& stats);
+    /**
+     * Create the task time and event loop lag histograms if not
+     * present.  Update them if already present
+     *
+     * @param watchdog the watchdog timing the tasks per queue and the
+     *                 lag per event loop, in milliseconds
+     */
+    void addNUpdateTaskWatchdogStats(const TaskWatchdog& watchdog);
+
     /* RDDropCounter related APIs */
     /**
      * Create RDDropCounter metric family if its not present.
@@ -692,29 +965,47 @@ private:
     void removeStaticCountersEp(void);
 
     // Dynamic Metric families and metrics
-    // CRUD for every EP Counter metric
-    // func to create gauge for EpCounter given metric type, uuid & attr map
-    bool createDynamicGaugeEp(EP_METRICS metric,
-                              const string& uuid,
-                              const string& ep_name,
-                              bool annotate_ep_name,
-                              const size_t& attr_hash,
-        const unordered_map<string, string>&    attr_map);
-    // func to get gauge for EpCounter given metric type, uuid
-    hgauge_pair_t getDynamicGaugeEp(EP_METRICS metric, const string& uuid);
-    // func to remove gauge for EpCounter given metric type, uuid
-    bool removeDynamicGaugeEp(EP_METRICS metric, const string& uuid);
-    // func to remove all gauge of every EpCounter for a metric type
-    void removeDynamicGaugeEp(EP_METRICS metric);
+    // The gauges of every EP Counter metric for an ep, created together
+    // with the same labels
+    struct EpGauges {
+        // hash of the label map of the gauges
+        size_t hash;
+        // rx+tx drops of the last update, for top-drops export
+        uint64_t drops;
+        // gauge ptr for every metric
+        Gauge *gauge[EP_METRICS_MAX];
+    };
+    // func to check if a new ep can get gauges within the budget,
+    // evicting the ep with the least drops if needed in top-drops mode
+    bool admitDynamicGaugeEp(const string& uuid, const EpCounters& counters);
+    // func to get the gauges for EpCounter given uuid & attr map,
+    // creating them if they are absent or the attributes changed. Sets
+    // created if the ep had no gauges before
+    EpGauges *createDynamicGaugeEp(const string& uuid,
+                                   const string& ep_name,
+                                   bool annotate_ep_name,
+                                   const size_t& attr_hash,
+        const unordered_map<string, string>&    attr_map,
+                                   bool& created);
+    // func to get the gauges for EpCounter given uuid
+    EpGauges *getDynamicGaugeEp(const string& uuid);
+    // func to remove the gauges for EpCounter given uuid
+    bool removeDynamicGaugeEp(const string& uuid);
     // func to remove all gauges of every EpCounter
     void removeDynamicGaugeEp(void);
 
     /**
-     * cache the pair of (label map hash, gauge ptr) for every ep uuid
+     * cache the label map hash and gauge ptrs for every ep uuid
      * The hash is created utilizing prometheus lib, which is basically
      * a rolling hash  of all the key,value pairs of the ep attributes.
+     * Endpoint sources precompute the same hash, so a counter update
+     * for an ep whose attributes didnt change needs a single lookup and
+     * no label map.
      */
-    unordered_map<string, hgauge_pair_t> ep_gauge_map[EP_METRICS_MAX];
+    unordered_map<string, EpGauges> ep_gauge_map;
+    // (drops, uuid) of every ep in ep_gauge_map in top-drops mode, so
+    // that the ep with the least drops is first
+    std::set<pair<uint64_t, string> > ep_drops_rank;
 
     //Utility apis
     // Create a label map that can be used for annotation, given the ep attr map
@@ -1031,6 +1322,221 @@ private:
     /* End of MoDBCount related apis and state */
 
 
+    /* Start of ModbClassStats related apis and state */
+    // Lock to safe guard ModbClassStats related state
+    mutex modb_class_mutex;
+
+    enum MODB_CLASS_METRICS {
+        MODB_CLASS_METRICS_MIN,
+        MODB_CLASS_INSTANCES = MODB_CLASS_METRICS_MIN,
+        MODB_CLASS_BYTES,
+        MODB_CLASS_METRICS_MAX = MODB_CLASS_BYTES
+    };
+
+    // Static Metric families and metrics
+    // metric families to track all ModbClassStats metrics
+    Family<Gauge>      *gauge_modb_class_family_ptr[MODB_CLASS_METRICS_MAX+1];
+
+    // create any modb class gauge metric families during start
+    void createStaticGaugeFamiliesModbClass(void);
+    // remove any modb class gauge metric families during stop
+    void removeStaticGaugeFamiliesModbClass(void);
+
+    // Dynamic Metric families and metrics
+    // CRUD for every modb class metric
+    // func to create gauge for ModbClassStats given metric type, class
+    void createDynamicGaugeModbClass(MODB_CLASS_METRICS metric,
+                                     const string& className);
+
+    // func to get Gauge for ModbClassStats given metric type, class
+    Gauge * getDynamicGaugeModbClass(MODB_CLASS_METRICS metric,
+                                     const string& className);
+
+    // func to remove gauge for ModbClassStats given metric type, class
+    bool removeDynamicGaugeModbClass(MODB_CLASS_METRICS metric,
+                                     const string& className);
+    // func to remove all gauge of every class for a metric type
+    void removeDynamicGaugeModbClass(MODB_CLASS_METRICS metric);
+    // func to remove all gauges of every ModbClassStats
+    void removeDynamicGaugeModbClass(void);
+
+    /**
+     * cache Gauge ptr for every class per metric
+     */
+    unordered_map<string, Gauge*> modb_class_gauge_map[MODB_CLASS_METRICS_MAX+1];
+    /* End of ModbClassStats related apis and state */
+
+
+    /* Start of ProcessorStats related apis and state */
+    // Lock to safe guard ProcessorStats related state
+    mutex processor_mutex;
+
+    // metric family to track the processor items per state
+    Family<Gauge>      *gauge_processor_family_ptr;
+
+    // create processor gauge metric family during start
+    void createStaticGaugeFamiliesProcessor(void);
+    // remove processor gauge metric family during stop
+    void removeStaticGaugeFamiliesProcessor(void);
+    // func to remove all gauges of every processor item state
+    void removeDynamicGaugeProcessor(void);
+
+    /**
+     * cache Gauge ptr for every item state
+     */
+    unordered_map<string, Gauge*> processor_gauge_map;
+    /* End of ProcessorStats related apis and state */
+
+
+    /* Start of FlowTableStats related apis and state */
+    // Lock to safe guard FlowTableStats related state
+    mutex flow_table_mutex;
+
+    // metric family to track the flow changes and flows per table
+    Family<Gauge>      *gauge_flow_table_family_ptr;
+
+    // create flow table gauge metric family during start
+    void createStaticGaugeFamiliesFlowTable(void);
+    // remove flow table gauge metric family during stop
+    void removeStaticGaugeFamiliesFlowTable(void);
+    // func to remove all gauges of every flow table
+    void removeDynamicGaugeFlowTable(void);
+
+    // the gauges of a table per counter, NULL until the counter is set
+    typedef std::array<Gauge*, FlowProgrammingStats::COUNTER_MAX+1>
+        flow_table_gauges_t;
+    /**
+     * cache Gauge ptrs for every bridge and table
+     */
+    map<pair<string, size_t>, flow_table_gauges_t> flow_table_gauge_map;
+    /* End of FlowTableStats related apis and state */
+
+
+    /* Start of NotifStats related apis and state */
+    // Lock to safe guard NotifStats related state
+    mutex notif_mutex;
+
+    // metric family to track the notification server counters
+    Family<Gauge>      *gauge_notif_family_ptr;
+
+    // create notif gauge metric family during start
+    void createStaticGaugeFamiliesNotif(void);
+    // remove notif gauge metric family during stop
+    void removeStaticGaugeFamiliesNotif(void);
+    // func to remove all gauges of every notif counter
+    void removeDynamicGaugeNotif(void);
+
+    /**
+     * cache Gauge ptr for every notif counter
+     */
+    unordered_map<string, Gauge*> notif_gauge_map;
+    /* End of NotifStats related apis and state */
+
+
+    /* Start of ProcessStats and ThreadCpu related apis and state */
+    // Lock to safe guard ProcessStats and ThreadCpu related state
+    mutex proc_mutex;
+
+    // metric families to track the process stats and thread CPU time
+    Family<Gauge>      *gauge_process_family_ptr;
+    Family<Gauge>      *gauge_thread_cpu_family_ptr;
+
+    // create process gauge metric families during start
+    void createStaticGaugeFamiliesProc(void);
+    // remove process gauge metric families during stop
+    void removeStaticGaugeFamiliesProc(void);
+    // func to remove all process and thread gauges
+    void removeDynamicGaugeProc(void);
+
+    /**
+     * cache Gauge ptr for every process stat and thread name
+     */
+    unordered_map<string, Gauge*> process_gauge_map;
+    unordered_map<string, Gauge*> thread_cpu_gauge_map;
+    /* End of ProcessStats and ThreadCpu related apis and state */
+
+
+    /* Start of StartupStats related apis and state */
+    // Lock to safe guard StartupStats related state
+    mutex startup_mutex;
+
+    // metric family to track the startup timeline
+    Family<Gauge>      *gauge_startup_family_ptr;
+
+    // create startup gauge metric family during start
+    void createStaticGaugeFamiliesStartup(void);
+    // remove startup gauge metric family during stop
+    void removeStaticGaugeFamiliesStartup(void);
+    // func to remove all startup gauges
+    void removeDynamicGaugeStartup(void);
+
+    /**
+     * cache Gauge ptr for every startup phase and milestone
+     */
+    unordered_map<string, Gauge*> startup_gauge_map;
+    /* End of StartupStats related apis and state */
+
+
+    /* Start of latency histogram related apis and state */
+    // Lock to safe guard latency histogram related state
+    mutex latency_mutex;
+
+    enum LATENCY_METRICS {
+        LATENCY_METRICS_MIN,
+        LATENCY_PEER_POL_RESOLVE = LATENCY_METRICS_MIN,
+        LATENCY_PEER_EP_DECLARE,
+        LATENCY_PEER_KEEPALIVE_RTT,
+        LATENCY_PEER_METHOD,
+        LATENCY_PROCESS_TIME,
+        LATENCY_CLASS_RESOLVE,
+        LATENCY_DATAPLANE,
+        LATENCY_FLOW_WRITE_CHANGES,
+        LATENCY_FLOW_BARRIER,
+        LATENCY_TASK_TIME,
+        LATENCY_LOOP_LAG,
+        LATENCY_METRICS_MAX = LATENCY_LOOP_LAG
+    };
+
+    /**
+     * The gauges exported for one histogram: a cumulative count per
+     * bucket with an "le" label, the sum and the count
+     */
+    struct latency_gauges_t {
+        Gauge* bucket[OFLatencyHistogram::BUCKETS+1];
+        Gauge* sum;
+        Gauge* count;
+    };
+
+    // metric families to track the buckets, sum and count per metric
+    Family<Gauge>      *gauge_latency_bucket_family_ptr[LATENCY_METRICS_MAX+1];
+    Family<Gauge>      *gauge_latency_sum_family_ptr[LATENCY_METRICS_MAX+1];
+    Family<Gauge>      *gauge_latency_count_family_ptr[LATENCY_METRICS_MAX+1];
+
+    // create latency gauge metric families during start
+    void createStaticGaugeFamiliesLatency(void);
+    // remove latency gauge metric families during stop
+    void removeStaticGaugeFamiliesLatency(void);
+    // func to create or update the gauges of a histogram
+    void updateDynamicGaugeLatency(LATENCY_METRICS metric,
+                                   const string& label,
+                                   const OFLatencyHistogram& hist,
+                                   const string& sublabel = "");
+    // func to remove the gauges of a histogram
+    void removeDynamicGaugeLatency(LATENCY_METRICS metric,
+                                   const string& label,
+                                   const string& sublabel = "");
+    // func to remove all latency histogram gauges
+    void removeDynamicGaugeLatency(void);
+
+    /**
+     * cache the gauges of every histogram per metric, keyed by the
+     * values of the metric specific label and sublabel
+     */
+    map<pair<string, string>, latency_gauges_t>
+        latency_gauge_map[LATENCY_METRICS_MAX+1];
+    /* End of latency histogram related apis and state */
+
+
     /* Start of RDDropCounter related apis and state */
     // Lock to safe guard RDDropCounter related state
     mutex rddrop_stats_mutex;
@@ -1241,6 +1747,28 @@ private:
      * True if Nan ep<-->svc metrics can be exposed
      */
     std::atomic<bool> exposeEpSvcNan;
+
+    /**
+     * Limits on dynamic metrics. Changes of the budget are made under
+     * ep_counter_mutex and svc_target_counter_mutex.
+     */
+    CardinalityBudget budget;
+
+    /**
+     * Groups of metric families. Each group has a registry of its own,
+     * so that it can be scraped apart from the others.
+     */
+    enum REGISTRY_GROUP {
+        REGISTRY_GROUP_MIN,
+        REGISTRY_AGENT = REGISTRY_GROUP_MIN, REGISTRY_EP, REGISTRY_SVC,
+        REGISTRY_POLICY, REGISTRY_DROP,
+        REGISTRY_GROUP_MAX = REGISTRY_DROP
+    };
+
+    /**
+     * Registry which keeps track of the metric families of each group
+     */
+    shared_ptr<Registry> group_registry_ptr[REGISTRY_GROUP_MAX+1];
     /* TODO: Other Counter related apis and state */
 };
 
@@ -49,6 +49,19 @@ public:
      */
     virtual void setProperties(const boost::property_tree::ptree& properties) = 0;
 
+    /**
+     * Apply a changed configuration to the running renderer in place.
+     * The default implementation applies nothing.
+     *
+     * @param properties the new configuration subtree, as it would be
+     * passed to setProperties
+     * @return true if the configuration was applied, or false if the
+     * renderer must be restarted to apply it
+     */
+    virtual bool reloadProperties(const boost::property_tree::ptree& properties) {
+        return false;
+    }
+
     /**
      * Start the renderer
      */
@@ -0,0 +1,129 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for SPSCRing
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_SPSCRING_H
+#define OPFLEXAGENT_SPSCRING_H
+
+#include <boost/noncopyable.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace opflexagent {
+
+/**
+ * A lock-free ring buffer of fixed capacity with a single producer
+ * and a single consumer.
+ *
+ * The producer is told when it pushed onto an empty ring, so that it
+ * can wake up a consumer waiting for items; the consumer must check
+ * that the ring is empty after it has popped, before waiting.  When
+ * the ring is full, push fails and the item is left to the caller.
+ *
+ * @param T the type of the items, which must be default constructible
+ * and movable
+ */
+template <typename T>
+class SPSCRing : private boost::noncopyable {
+public:
+    /**
+     * Create a ring
+     *
+     * @param capacity the number of items the ring holds, rounded up
+     * to a power of two
+     */
+    explicit SPSCRing(size_t capacity) : head(0), tail(0) {
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    /**
+     * Push an item onto the ring.  Must only be called from the
+     * producer thread.
+     *
+     * @param item the item to push, moved from if it is pushed
+     * @param wasEmpty if not NULL, set to true if the consumer could
+     * have found the ring empty before this item, in which case the
+     * caller must make sure the consumer wakes up
+     * @return false if the ring is full
+     */
+    bool push(T&& item, bool* wasEmpty = NULL) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == slots.size())
+            return false;
+        slots[t & mask] = std::move(item);
+        tail.store(t + 1);
+        if (wasEmpty)
+            *wasEmpty = (head.load() == t);
+        return true;
+    }
+
+    /**
+     * Pop an item from the ring.  Must only be called from the
+     * consumer thread.
+     *
+     * @param item set to the item popped
+     * @return false if the ring is empty
+     */
+    bool pop(T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return false;
+        item = std::move(slots[h & mask]);
+        head.store(h + 1);
+        return true;
+    }
+
+    /**
+     * Check whether the ring is empty
+     *
+     * @return true if there is no item to pop
+     */
+    bool empty() const {
+        return tail.load() == head.load();
+    }
+
+    /**
+     * Get the number of items in the ring, which may be out of date
+     * as soon as it is returned
+     *
+     * @return the number of items
+     */
+    size_t size() const {
+        return tail.load() - head.load();
+    }
+
+    /**
+     * Get the capacity of the ring
+     *
+     * @return the number of items the ring holds
+     */
+    size_t capacity() const { return slots.size(); }
+
+private:
+    std::vector<T> slots;
+    size_t mask;
+
+    /* the next item to pop, written by the consumer */
+    alignas(64) std::atomic<size_t> head;
+    /* the next item to push, written by the producer */
+    alignas(64) std::atomic<size_t> tail;
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_SPSCRING_H */
@@ -14,6 +14,7 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <set>
+#include <map>
 
 #include <boost/optional.hpp>
 #include <opflex/modb/URI.h>
@@ -415,6 +416,28 @@ public:
             this->nextHopIps.insert(nextHopIp);
         }
 
+        /**
+         * Get the weights of the next hops that have one.  A next hop
+         * without a weight has weight 1.  The weights are only used
+         * when services are load balanced with select groups
+         *
+         * @return the weights by next hop IP address
+         */
+        const std::map<std::string, uint16_t>& getNextHopWeights() const {
+            return nextHopWeights;
+        }
+
+        /**
+         * Set the weight of a next hop for the service mapping.  A
+         * next hop with weight 0 gets no new connections
+         *
+         * @param nextHopIp the IP address of the next hop
+         * @param weight the weight
+         */
+        void setNextHopWeight(const std::string& nextHopIp, uint16_t weight) {
+            nextHopWeights[nextHopIp] = weight;
+        }
+
         /**
          * Port number when the service traffic is delivered to the
          * service endpoint.  If unspecified the next hop port is the
@@ -517,6 +540,7 @@ public:
         boost::optional<uint16_t> servicePort;
         boost::optional<std::string> gatewayIp;
         std::set<std::string> nextHopIps;
+        std::map<std::string, uint16_t> nextHopWeights;
         boost::optional<uint16_t> nextHopPort;
         boost::optional<uint16_t> nodePort;
         boost::optional<uint32_t> saTimeoutSecs;
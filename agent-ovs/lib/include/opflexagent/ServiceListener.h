@@ -13,8 +13,59 @@
 #ifndef OPFLEXAGENT_SERVICELISTENER_H
 #define OPFLEXAGENT_SERVICELISTENER_H
 
+#include <opflexagent/Service.h>
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
 namespace opflexagent {
 
+/**
+ * The changes made to a service by an add, update or remove
+ */
+struct ServiceDelta {
+    /**
+     * Create a delta for a service with no changes
+     */
+    ServiceDelta() : otherChanged(false) {}
+
+    /**
+     * Service mappings of the new service that the old service did
+     * not have.  A mapping whose settings or next hops changed is
+     * both removed and added.
+     */
+    std::vector<Service::ServiceMapping> addedMappings;
+
+    /**
+     * Service mappings of the old service that the new service does
+     * not have
+     */
+    std::vector<Service::ServiceMapping> removedMappings;
+
+    /**
+     * Next hop IPs that are in a service mapping of only one of the
+     * old and the new service
+     */
+    std::unordered_set<std::string> changedNextHops;
+
+    /**
+     * True if anything other than the service mappings changed,
+     * including the service being added or removed
+     */
+    bool otherChanged;
+
+    /**
+     * Check if the delta has no changes
+     *
+     * @return true if nothing changed
+     */
+    bool empty() const {
+        return !otherChanged && addedMappings.empty() &&
+            removedMappings.empty();
+    }
+};
+
 /**
  * An abstract interface for classes interested in updates related to
  * the services
@@ -37,6 +88,20 @@ public:
      * @param uuid the UUID for the service
      */
     virtual void serviceUpdated(const std::string& uuid) = 0;
+
+    /**
+     * Called when a service is added, updated, or removed, with the
+     * changes to its service mappings, so that a listener can limit
+     * its work to the mappings and next hops that changed.  The
+     * default implementation calls serviceUpdated().
+     *
+     * @param uuid the UUID for the service
+     * @param delta the changes to the service
+     */
+    virtual void serviceChanged(const std::string& uuid,
+                                const ServiceDelta& delta) {
+        serviceUpdated(uuid);
+    }
 };
 
 } /* namespace opflexagent */
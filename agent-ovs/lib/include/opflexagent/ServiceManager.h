@@ -105,6 +105,45 @@ public:
     void getServicesByDomain(const opflex::modb::URI& domain,
                              /* out */ std::unordered_set<std::string>& servs);
 
+    /**
+     * Get the services with a service mapping for the given service
+     * IP, protocol and port
+     *
+     * @param ip the service IP address
+     * @param proto the protocol, "tcp" or "udp"
+     * @param port the service port
+     * @param servs a set that will be filled with the UUIDs of
+     * matching services.
+     */
+    void getServicesByMapping(const std::string& ip,
+                              const std::string& proto,
+                              uint16_t port,
+                              /* out */ std::unordered_set<std::string>& servs);
+
+    /**
+     * Get the services with a service mapping that has the given next
+     * hop IP
+     *
+     * @param ip the next hop IP address
+     * @param servs a set that will be filled with the UUIDs of
+     * matching services.
+     */
+    void getServicesByNextHop(const std::string& ip,
+                              /* out */ std::unordered_set<std::string>& servs);
+
+    /**
+     * Compute the changes between two versions of a service
+     *
+     * @param oldService the service before the change, or NULL if it
+     * is being added
+     * @param newService the service after the change, or NULL if it
+     * is being removed
+     * @param delta the delta to fill in
+     */
+    static void computeDelta(const Service* oldService,
+                             const Service* newService,
+                             /* out */ ServiceDelta& delta);
+
     /**
      * Get the total number of Services
      *
@@ -200,15 +239,27 @@ private:
      */
     uri_serv_map_t domain_aserv_map;
 
+    /**
+     * Map service IP, protocol and port keys to a set of service UUIDs
+     */
+    string_serv_map_t mapping_aserv_map;
+
+    /**
+     * Map next hop IPs to a set of service UUIDs
+     */
+    string_serv_map_t nexthop_aserv_map;
+
     /**
      * The service listeners that have been registered
      */
     std::list<ServiceListener*> serviceListeners;
     std::mutex listener_mutex;
 
-    void notifyListeners(const std::string& uuid);
+    void notifyListeners(const std::string& uuid, const ServiceDelta& delta);
     void removeIfaces(const Service& service);
     void removeDomains(const Service& service);
+    void addMappings(const Service& service);
+    void removeMappings(const Service& service);
 
     friend class ServiceSource;
     friend class DummyServiceSrc;
@@ -37,6 +37,22 @@ public:
      * @param uuid the uuid of the snat object
      */
     virtual void snatUpdated(const std::string& uuid) = 0;
+
+    /**
+     * Called when a snat is added, updated, or removed, with an
+     * indication of whether the flows of the endpoints using it are
+     * affected.  Only the remote port ranges of a snat are used
+     * solely by the flows of the snat itself.  The default
+     * implementation calls snatUpdated().
+     *
+     * @param uuid the uuid of the snat object
+     * @param endpointsAffected false if only the remote port ranges
+     * of the snat changed
+     */
+    virtual void snatChanged(const std::string& uuid,
+                             bool endpointsAffected) {
+        snatUpdated(uuid);
+    }
 };
 
 } /* namespace opflexagent */
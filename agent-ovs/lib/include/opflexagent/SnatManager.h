@@ -21,6 +21,7 @@
 
 #include <unordered_set>
 #include <unordered_map>
+#include <map>
 #include <mutex>
 
 namespace opflexagent {
@@ -104,6 +105,26 @@ public:
      */
     void getSnatsByIface(const std::string& ifaceName,
                          /* out */ snats_t& snats);
+
+    /**
+     * Get the snats that use a particular snat IP
+     *
+     * @param snatIp the snat IP address
+     * @param snats a set of snat uuids using the snat IP
+     */
+    void getSnatsByIp(const std::string& snatIp,
+                      /* out */ snats_t& snats);
+
+    /**
+     * Get the snats with a local or remote port range on a snat IP
+     * that contains the given port
+     *
+     * @param snatIp the snat IP address
+     * @param port the port to look up
+     * @param snats a set of snat uuids with a matching port range
+     */
+    void getSnatsByPort(const std::string& snatIp, uint16_t port,
+                        /* out */ snats_t& snats);
 private:
     /**
      * Add or update the snat state with new information about an
@@ -128,6 +149,23 @@ private:
     typedef std::unordered_set<std::string> ep_set_t;
     typedef std::unordered_map<std::string, ep_set_t> ep_map_t;
     typedef std::unordered_map<std::string, snats_t> iface_snats_map_t;
+
+    /*
+     * The port ranges used on a snat IP, ordered by their start, with
+     * the snats using each range.  Ranges from different snats may
+     * overlap, so a lookup walks back from the last range starting
+     * at or before the port for as long as the longest range could
+     * still reach it.
+     */
+    class PortIndex {
+    public:
+        PortIndex() : maxLength(0) {}
+
+        typedef std::pair<uint16_t, uint16_t> range_t;
+        std::map<range_t, snats_t> ranges;
+        uint32_t maxLength;
+    };
+    typedef std::unordered_map<std::string, PortIndex> port_index_map_t;
     std::mutex snat_mutex;
 
     /**
@@ -145,14 +183,31 @@ private:
      */
     iface_snats_map_t iface_snats_map;
 
+    /**
+     * Map snat IP to set of uuids that share the snat IP
+     */
+    iface_snats_map_t ip_snats_map;
+
+    /**
+     * Map snat IP to the port ranges used on it
+     */
+    port_index_map_t port_index_map;
+
+    /**
+     * Map endpoint to the snats it uses
+     */
+    ep_map_t ep_snats_map;
+
     /**
      * The snat listeners that have been registered
      */
     std::list<SnatListener*> snatListeners;
     std::mutex listener_mutex;
 
-    void notifyListeners(const std::string& uuid);
+    void notifyListeners(const std::string& uuid, bool endpointsAffected);
     void removeIfaces(const Snat& snat);
+    void addPorts(const Snat& snat);
+    void removePorts(const Snat& snat);
 
     friend class SnatSource;
 };
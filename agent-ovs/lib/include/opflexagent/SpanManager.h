@@ -61,6 +61,16 @@ public:
      */
     ~SpanManager() {};
 
+    /**
+     * Report the tasks of this manager to a watchdog.  Set it before
+     * starting the manager.
+     *
+     * @param watchdog the watchdog
+     */
+    void setWatchdog(TaskWatchdog& watchdog) {
+        taskQueue.setWatchdog(&watchdog, "span");
+    }
+
     /**
      * Start the span manager
      */
@@ -152,8 +162,9 @@ public:
     /**
      * process session update
      * @param[in] sess shared pointer to a Session object
+     * @return true if the session is new or its config changed
      */
-    void processSession(const shared_ptr<Session>& sess);
+    bool processSession(const shared_ptr<Session>& sess);
 
     /**
     * process source group update
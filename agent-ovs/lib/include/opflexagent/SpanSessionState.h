@@ -147,6 +147,15 @@ class SessionState {
          */
         bool hasSrcEndpoints() const;
 
+        /**
+         * count the source endpoints of this session missing from
+         * another, with their direction
+         * @param other the other session
+         * @return the number of source endpoints not in the other
+         * session
+         */
+        size_t countSrcEndpointsNotIn(SessionState& other);
+
         /**
          * get a copy of the source end points
          * @param ep reference to end point set
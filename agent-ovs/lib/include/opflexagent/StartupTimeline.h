@@ -0,0 +1,185 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for StartupTimeline
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_STARTUPTIMELINE_H
+#define OPFLEXAGENT_STARTUPTIMELINE_H
+
+#include <boost/noncopyable.hpp>
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace opflexagent {
+
+/**
+ * Record when the phases of agent startup run and when its
+ * milestones are reached, relative to the creation of the timeline.
+ *
+ * Phases have a start and an end; a phase that runs more than once,
+ * such as reading each configuration file, spans from its first start
+ * to its last end.  Milestones are recorded the first time they are
+ * reached only.  The startup has converged when a milestone is
+ * reached and no expected milestone is still missing, at which point
+ * the "converged" milestone is recorded and the converged callback
+ * runs once.  The timeline does not change after that, so that later
+ * reconfigurations do not stretch its phases.
+ *
+ * The timeline is thread safe.
+ */
+class StartupTimeline : private boost::noncopyable {
+public:
+    /**
+     * A phase or milestone of the timeline
+     */
+    struct Event {
+        /** the name of the phase or milestone */
+        std::string name;
+        /** seconds from the creation of the timeline to the start of
+            the phase, or to the milestone */
+        double start;
+        /** seconds from the creation of the timeline to the end of
+            the phase; equal to start for a milestone */
+        double end;
+        /** true if this is a milestone rather than a phase */
+        bool milestone;
+    };
+
+    /**
+     * Callback run when the startup has converged
+     */
+    typedef std::function<void (const std::vector<Event>&)> converged_cb_t;
+
+    /**
+     * The milestone recorded when the startup has converged
+     */
+    static const std::string CONVERGED;
+
+    /**
+     * Create a timeline that starts now
+     */
+    StartupTimeline();
+
+    /**
+     * Record the start of a phase
+     *
+     * @param name the name of the phase
+     */
+    void beginPhase(const std::string& name);
+
+    /**
+     * Record the end of a phase
+     *
+     * @param name the name of the phase
+     */
+    void endPhase(const std::string& name);
+
+    /**
+     * Record a phase for the lifetime of the object
+     */
+    class Phase : private boost::noncopyable {
+    public:
+        /**
+         * Record the start of the phase
+         *
+         * @param timeline_ the timeline to record to
+         * @param name_ the name of the phase
+         */
+        Phase(StartupTimeline& timeline_, const std::string& name_)
+            : timeline(timeline_), name(name_) {
+            timeline.beginPhase(name);
+        }
+
+        /**
+         * Record the end of the phase
+         */
+        ~Phase() {
+            timeline.endPhase(name);
+        }
+
+    private:
+        StartupTimeline& timeline;
+        std::string name;
+    };
+
+    /**
+     * Record that a milestone has been reached, unless it already
+     * was
+     *
+     * @param name the name of the milestone
+     */
+    void mark(const std::string& name);
+
+    /**
+     * Make the convergence of the startup wait for a milestone.  A
+     * milestone that was already reached, or an expectation made
+     * after the startup converged, has no effect.
+     *
+     * @param name the name of the milestone
+     */
+    void expect(const std::string& name);
+
+    /**
+     * Set the callback to run when the startup converges
+     *
+     * @param callback the callback, which gets the events of the
+     * timeline
+     */
+    void setConvergedCallback(const converged_cb_t& callback);
+
+    /**
+     * Check whether the startup has converged
+     *
+     * @return true if every expected milestone has been reached
+     */
+    bool isConverged();
+
+    /**
+     * Get the events of the timeline in the order they started
+     *
+     * @param events a vector that will be filled with the events
+     */
+    void getEvents(/* out */ std::vector<Event>& events);
+
+private:
+    typedef std::chrono::steady_clock clock;
+
+    std::mutex mutex;
+    clock::time_point created;
+    std::vector<Event> events;
+    std::unordered_set<std::string> expected;
+    bool converged;
+    converged_cb_t convergedCb;
+
+    double now() const;
+    Event* find(const std::string& name, bool milestone);
+    void markLocked(const std::string& name,
+                    std::unique_lock<std::mutex>& guard);
+};
+
+/**
+ * Print the events of a timeline to an ostream, one per line
+ *
+ * @param os the stream
+ * @param events the events
+ * @return the stream
+ */
+std::ostream& operator<<(std::ostream& os,
+                         const std::vector<StartupTimeline::Event>& events);
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_STARTUPTIMELINE_H */
@@ -0,0 +1,176 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for SuffixTrie
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_SUFFIX_TRIE_H
+#define OPFLEXAGENT_SUFFIX_TRIE_H
+
+#include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace opflexagent {
+
+/**
+ * A trie over the reversed characters of strings, mapping suffixes
+ * to values, which finds the stored suffixes of a string in time
+ * bounded by the length of the string rather than by the number of
+ * suffixes stored.  Suited to wildcard domain names, where the
+ * suffix after the wildcard is stored.
+ *
+ * The trie is not thread safe.
+ *
+ * @param T the type of the values
+ */
+template <typename T>
+class SuffixTrie : private boost::noncopyable {
+public:
+    /**
+     * Instantiate an empty trie
+     */
+    SuffixTrie() : count(0) {}
+
+    /**
+     * Get the value of a suffix, adding a default-constructed value
+     * if the suffix is not present
+     *
+     * @param suffix the suffix, which may be empty to match any
+     * string
+     * @return the value of the suffix
+     */
+    T& insert(const std::string& suffix) {
+        Node* n = &root;
+        for (auto it = suffix.rbegin(); it != suffix.rend(); ++it) {
+            auto c = childPos(n, *it);
+            if (c == n->children.end() || c->first != *it)
+                c = n->children.emplace(c, *it,
+                                        std::unique_ptr<Node>(new Node()));
+            n = c->second.get();
+        }
+        if (!n->value) {
+            n->value = T();
+            count += 1;
+        }
+        return n->value.get();
+    }
+
+    /**
+     * Find the value of an exact suffix
+     *
+     * @param suffix the suffix
+     * @return the value, or NULL if the suffix is not present
+     */
+    T* find(const std::string& suffix) {
+        Node* n = &root;
+        for (auto it = suffix.rbegin(); n && it != suffix.rend(); ++it)
+            n = child(n, *it);
+        return (n && n->value) ? n->value.get_ptr() : NULL;
+    }
+
+    /**
+     * Call a function with the value of every stored suffix of a
+     * string, shortest first
+     *
+     * @param str the string
+     * @param f the function to call as f(T& value)
+     */
+    template <typename F>
+    void visitMatches(const std::string& str, F f) {
+        Node* n = &root;
+        if (n->value) f(n->value.get());
+        for (auto it = str.rbegin(); it != str.rend(); ++it) {
+            n = child(n, *it);
+            if (!n) break;
+            if (n->value) f(n->value.get());
+        }
+    }
+
+    /**
+     * Remove a suffix
+     *
+     * @param suffix the suffix
+     * @return true if the suffix was present
+     */
+    bool erase(const std::string& suffix) {
+        if (!erase(&root, suffix, suffix.rbegin()))
+            return false;
+        count -= 1;
+        return true;
+    }
+
+    /**
+     * Get the number of suffixes stored
+     *
+     * @return the number of suffixes
+     */
+    size_t size() const { return count; }
+
+    /**
+     * Remove all the suffixes
+     */
+    void clear() {
+        root.children.clear();
+        root.value = boost::none;
+        count = 0;
+    }
+
+private:
+    struct Node;
+    /* children sorted by character */
+    typedef std::vector<std::pair<char, std::unique_ptr<Node>>> children_t;
+
+    struct Node {
+        children_t children;
+        boost::optional<T> value;
+    };
+
+    Node root;
+    size_t count;
+
+    static typename children_t::iterator childPos(Node* n, char c) {
+        return std::lower_bound(n->children.begin(), n->children.end(), c,
+                                [](const typename children_t::value_type& e,
+                                   char k) { return e.first < k; });
+    }
+
+    static Node* child(Node* n, char c) {
+        auto it = childPos(n, c);
+        return (it != n->children.end() && it->first == c)
+            ? it->second.get() : NULL;
+    }
+
+    /* remove the suffix below n and prune the nodes left empty */
+    static bool erase(Node* n, const std::string& suffix,
+                      std::string::const_reverse_iterator it) {
+        if (it == suffix.rend()) {
+            if (!n->value) return false;
+            n->value = boost::none;
+            return true;
+        }
+        auto c = childPos(n, *it);
+        if (c == n->children.end() || c->first != *it)
+            return false;
+        if (!erase(c->second.get(), suffix, it + 1))
+            return false;
+        if (!c->second->value && c->second->children.empty())
+            n->children.erase(c);
+        return true;
+    }
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_SUFFIX_TRIE_H */
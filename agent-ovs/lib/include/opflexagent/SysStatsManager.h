@@ -14,13 +14,19 @@
 #define OPFLEXAGENT_SysStatsManager_H
 
 #include <boost/asio.hpp>
+#include <chrono>
 #include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
 
 #include <opflexagent/PrometheusManager.h>
+#include <opflexagent/ProcStats.h>
+#include <opflexagent/AllocStats.h>
 
 namespace opflexagent {
 
@@ -47,8 +53,13 @@ public:
      * Start the sys stats manager
      * @param timer_interval the interval for the stats timer in
      * milliseconds
+     * @param class_stats_interval the interval for the per-class
+     * MODB stats in milliseconds.  These walk every object in the
+     * store, so they are updated on the first timer tick after each
+     * interval rather than on every tick.
      */
-    void start(long timer_interval = 10000);
+    void start(long timer_interval = 10000,
+               long class_stats_interval = 300000);
 
     /**
      * Stop the sys stats manager
@@ -63,6 +74,11 @@ public:
 private:
     void updateOpflexPeerStats();
     void updateMoDBCounts();
+    void updateModbClassStats();
+    void updateProcessorStats();
+    void updateNotifStats();
+    void updateProcStats();
+    void updateAllocStats();
 
     /**
      * The agent object
@@ -84,15 +100,48 @@ private:
      */
     std::unique_ptr<boost::asio::deadline_timer> timer;
 
+    /**
+     * strand serializing the timer handlers on the stats io_service,
+     * which may be run by several threads
+     */
+    std::unique_ptr<boost::asio::io_service::strand> strand;
+
     /**
      * The timer interval to use for querying stats
      */
     long timer_interval;
 
+    /**
+     * The interval for the per-class MODB stats, and when they are
+     * next due
+     */
+    long class_stats_interval;
+    std::chrono::steady_clock::time_point next_class_stats;
+
     /**
      * True if shutting down
      */
     std::atomic<bool> stopping;
+
+    /**
+     * Classes with instances as of the last class stats update
+     */
+    std::unordered_set<std::string> modbClasses;
+
+    /**
+     * Sampler for the CPU and memory use of the agent process
+     */
+    ProcStats procStats;
+
+    /**
+     * Sampler for the statistics of the memory allocator
+     */
+    AllocStats allocStats;
+
+    /**
+     * CPU time per thread name as of the last process stats update
+     */
+    std::unordered_map<std::string, double> threadCpu;
 };
 
 } /* namespace opflexagent */
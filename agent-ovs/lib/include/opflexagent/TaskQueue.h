@@ -11,9 +11,18 @@
 #ifndef OPFLEXAGENT_TASK_QUEUE_H_
 #define OPFLEXAGENT_TASK_QUEUE_H_
 
+#include <opflexagent/DataplaneLatency.h>
+#include <opflexagent/MPSCQueue.h>
+#include <opflexagent/TaskWatchdog.h>
+
 #include <boost/asio/io_service.hpp>
+#include <boost/asio/steady_timer.hpp>
 
+#include <chrono>
+#include <deque>
+#include <memory>
 #include <unordered_set>
+#include <unordered_map>
 #include <string>
 #include <mutex>
 #include <functional>
@@ -22,36 +31,175 @@ namespace opflexagent {
 
 /**
  * Queue tasks using a boost::asio::io_service so that the same task
- * is not queued multiple times
+ * is not queued multiple times.
+ *
+ * Queued tasks run in order of priority, and in the order they were
+ * queued within a priority.  If the io_service is run by several
+ * threads, tasks with different IDs may run concurrently, but tasks
+ * with the same ID never do: a task queued while another with its ID
+ * is running waits for that one to finish.
+ *
+ * Dispatching a task without a debounce delay does not take a lock:
+ * tasks are pushed onto a lock-free inbox, and the first task pushed
+ * onto an empty inbox posts a single handler to the io_service that
+ * moves the whole batch onto the queue.
+ *
+ * A task runs with the trace context of the thread that queued it,
+ * or the oldest one if it was requested several times before it ran.
  */
 class TaskQueue {
 public:
+    /**
+     * The priority of a task
+     */
+    enum Priority {
+        /** Background work that can wait for everything else */
+        LOW,
+        /** The default priority */
+        NORMAL,
+        /** Work that affects forwarding and should run first */
+        HIGH
+    };
+
     /**
      * Initialize a task queue using the specified io_service
      * @param io_service the io service to use
      */
     TaskQueue(boost::asio::io_service& io_service);
 
+    /**
+     * Record the time traced tasks spend before they run in the
+     * notify and queue stages of the given latency histograms
+     *
+     * @param latency_ the histograms to record to, or NULL to stop
+     * recording
+     */
+    void setLatency(DataplaneLatency* latency_) { latency = latency_; }
+
+    /**
+     * A callback told how long each task ran
+     */
+    typedef std::function<void (const std::string& taskId,
+                                std::chrono::steady_clock::duration elapsed)>
+        TaskTimer;
+
+    /**
+     * Time every task and report it to the given callback once the
+     * task returns.  The callback is called from the thread that ran
+     * the task, so it must be thread safe if the io_service is run by
+     * several threads.  Set it before any task is dispatched.
+     *
+     * @param timer_ the callback, or an empty function to stop timing
+     */
+    void setTaskTimer(const TaskTimer& timer_) { timer = timer_; }
+
+    /**
+     * Report every task to a watchdog, which times it and logs it if
+     * it runs too long.  Set it before any task is dispatched.
+     *
+     * @param watchdog_ the watchdog, or NULL to stop reporting
+     * @param name_ the name of this queue in the logs and metrics of
+     * the watchdog
+     */
+    void setWatchdog(TaskWatchdog* watchdog_, const std::string& name_) {
+        watchdog = watchdog_;
+        name = name_;
+    }
+
     /**
      * Dispatch the given task with the specified task ID.  If a task
      * with the given task ID has already been queued and not been
      * executed, the task will not be queued again.  The task can be
-     * queued again once it has begun executing.
+     * queued again once it has begun executing.  May be called from
+     * any thread.
      *
      * @param taskId a unique ID for the task
      * @param task a function to execute for the task.  This will be
      * copied onto the task queue
+     * @param priority the priority of the task
      */
     void dispatch(const std::string& taskId,
-                  const std::function<void ()>& task);
+                  const std::function<void ()>& task,
+                  Priority priority = NORMAL);
+
+    /**
+     * Dispatch the given task once no request for its task ID has
+     * been made for the given delay, so that a burst of requests
+     * results in a single run of the last task requested.  The task
+     * is dispatched no later than the maximum delay after the first
+     * request of the burst, however many requests follow it.
+     *
+     * @param taskId a unique ID for the task
+     * @param delay the time to wait after the last request.  If zero,
+     * the task is dispatched at once.
+     * @param task a function to execute for the task.  This will be
+     * copied onto the task queue
+     * @param maxDelay the longest time to wait after the first request
+     * @param priority the priority of the task
+     */
+    void dispatchDebounced(const std::string& taskId,
+                           std::chrono::milliseconds delay,
+                           const std::function<void ()>& task,
+                           std::chrono::milliseconds maxDelay,
+                           Priority priority = NORMAL);
 
 private:
+    struct Item {
+        Item() : priority(NORMAL), next(NULL) {}
+        Item(const std::string& taskId_,
+             const std::function<void ()>& task_,
+             Priority priority_)
+            : taskId(taskId_), task(task_), priority(priority_),
+              next(NULL) {}
+
+        std::string taskId;
+        std::function<void ()> task;
+        Priority priority;
+        /* the trace origin, and when a traced task was queued */
+        DataplaneLatency::clock::time_point origin;
+        DataplaneLatency::clock::time_point queued;
+        /* the link in the inbox */
+        Item* next;
+    };
+
+    struct DebouncedItem {
+        std::unique_ptr<boost::asio::steady_timer> timer;
+        std::chrono::steady_clock::time_point first;
+        std::function<void ()> task;
+        Priority priority;
+        DataplaneLatency::clock::time_point origin;
+    };
+
+    void drain_inbox();
+    void run_next();
+    void on_debounce(const std::string& taskId,
+                     const boost::system::error_code& ec);
     void run_task(const std::string& taskId,
                   const std::function<void ()>& task);
 
     boost::asio::io_service& io_service;
+    DataplaneLatency* latency;
+    TaskTimer timer;
+    TaskWatchdog* watchdog;
+    std::string name;
+
+    /* tasks dispatched and not yet moved onto their lane */
+    MPSCQueue<Item> inbox;
+
     std::mutex queueMutex;
+
+    /* tasks queued and not yet started */
     std::unordered_set<std::string> queuedItems;
+    /* tasks running now */
+    std::unordered_set<std::string> runningItems;
+    /* the tasks waiting to run, by priority; one call to run_next is
+       posted to the io_service for each of them */
+    std::deque<Item> lanes[HIGH + 1];
+    /* tasks taken off their lane while a task with the same ID was
+       running, to put back once it is done */
+    std::unordered_map<std::string, Item> deferredItems;
+    /* tasks waiting for their debounce delay to pass */
+    std::unordered_map<std::string, DebouncedItem> debouncedItems;
 };
 
 } // namespace opflexagent
@@ -0,0 +1,167 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for TaskWatchdog
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_TASKWATCHDOG_H
+#define OPFLEXAGENT_TASKWATCHDOG_H
+
+#include <opflex/ofcore/OFAgentStats.h>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace opflexagent {
+
+/**
+ * Find the tasks and event loops that hold up the agent.
+ *
+ * Task queues report each task they run, and the time it takes goes
+ * into a histogram per queue.  A task that runs longer than the
+ * threshold is logged with its ID when it returns, and a thread
+ * checking the running tasks logs it while it is still running, so
+ * that a task that never returns is found as well.
+ *
+ * Each monitored io_service runs a probe at a fixed interval, and the
+ * delay of the probe past its deadline, the lag of the event loop, goes
+ * into a histogram per io_service.  The lag includes the time spent by
+ * every handler, not only by the tasks of task queues.  An io_service
+ * whose probe is late by more than the threshold is logged while it is
+ * stalled.
+ *
+ * The methods are thread safe.
+ */
+class TaskWatchdog : private boost::noncopyable {
+public:
+    /**
+     * The clock used for the timings
+     */
+    typedef std::chrono::steady_clock clock;
+
+    /**
+     * The histograms of a set of queues or io_services, in milliseconds
+     */
+    typedef std::unordered_map<std::string,
+                               std::shared_ptr<const OFLatencyHistogram> >
+        hist_map_t;
+
+    TaskWatchdog();
+    ~TaskWatchdog();
+
+    /**
+     * Set the time after which a task or a stalled io_service is
+     * logged
+     *
+     * @param threshold the threshold, or zero to log nothing
+     */
+    void setThreshold(std::chrono::milliseconds threshold);
+
+    /**
+     * Start the thread that looks for stalled tasks and io_services
+     */
+    void start();
+
+    /**
+     * Stop the thread and the probes of the io_services
+     */
+    void stop();
+
+    /**
+     * Measure the lag of an io_service.  The io_service must outlive
+     * the watchdog or the call to stop.
+     *
+     * @param name the name of the io_service in the logs and metrics
+     * @param io_service the io_service
+     */
+    void monitor(const std::string& name,
+                 boost::asio::io_service& io_service);
+
+    /**
+     * Record that a task started running
+     *
+     * @param queue the name of the task queue
+     * @param taskId the ID of the task
+     * @return a token to pass to end
+     */
+    uint64_t begin(const std::string& queue, const std::string& taskId);
+
+    /**
+     * Record that a task returned
+     *
+     * @param token the token returned by begin
+     */
+    void end(uint64_t token);
+
+    /**
+     * Get the histograms of the time spent running tasks per queue
+     *
+     * @param hists the map to fill
+     */
+    void getTaskTimes(/* out */ hist_map_t& hists) const;
+
+    /**
+     * Get the histograms of the lag per io_service
+     *
+     * @param hists the map to fill
+     */
+    void getLoopLag(/* out */ hist_map_t& hists) const;
+
+    /**
+     * Get the number of tasks that ran longer than the threshold
+     */
+    uint64_t getSlowTaskCount() const;
+
+private:
+    struct Running {
+        std::string queue;
+        std::string taskId;
+        clock::time_point start;
+        bool reported;
+    };
+
+    struct Loop {
+        std::unique_ptr<boost::asio::steady_timer> timer;
+        clock::time_point deadline;
+        bool reported;
+        std::shared_ptr<OFLatencyHistogram> lag;
+    };
+
+    void probe(const std::string& name,
+               const boost::system::error_code& ec);
+    void schedule(const std::string& name, Loop& loop);
+    void run();
+
+    mutable std::mutex mutex;
+    std::condition_variable cond;
+    std::chrono::milliseconds threshold;
+    bool running;
+    std::thread thread;
+
+    uint64_t nextToken;
+    std::unordered_map<uint64_t, Running> tasks;
+    std::unordered_map<std::string, std::shared_ptr<OFLatencyHistogram> >
+        taskTimes;
+    uint64_t slowTasks;
+
+    std::unordered_map<std::string, Loop> loops;
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_TASKWATCHDOG_H */
@@ -0,0 +1,128 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for TimerWheel
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_TIMER_WHEEL_H
+#define OPFLEXAGENT_TIMER_WHEEL_H
+
+#include <boost/noncopyable.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace opflexagent {
+
+/**
+ * A hashed timer wheel, which schedules keys to come due at a tick
+ * and hands out the keys due as the wheel advances, in time bounded
+ * by the number of keys in the slots passed rather than by the number
+ * of keys scheduled.  Keys due more than a turn of the wheel away
+ * stay in their slot until their turn comes.
+ *
+ * A key may be scheduled several times, and then comes due as many
+ * times; there is no cancellation, so the owner of the wheel checks
+ * whether a key that comes due is still of interest.
+ *
+ * The wheel is not thread safe.
+ *
+ * @param K the type of the keys
+ */
+template <typename K>
+class TimerWheel : private boost::noncopyable {
+public:
+    /**
+     * Instantiate an empty wheel at tick 0
+     *
+     * @param slots the number of slots of the wheel
+     */
+    explicit TimerWheel(size_t slots = 256)
+        : wheel(std::max<size_t>(slots, 1)), now(0), count(0) {}
+
+    /**
+     * Schedule a key
+     *
+     * @param key the key
+     * @param tick the tick when the key comes due, moved to the next
+     * tick if it is not after the current tick
+     */
+    void schedule(const K& key, uint64_t tick) {
+        if (tick <= now)
+            tick = now + 1;
+        wheel[tick % wheel.size()].emplace_back(tick, key);
+        count += 1;
+    }
+
+    /**
+     * Advance the wheel, removing the keys that come due
+     *
+     * @param tick the tick to advance to; the wheel does not go back
+     * @param due the keys that came due, in no particular order, are
+     * appended to this vector
+     */
+    void advance(uint64_t tick, std::vector<K>& due) {
+        if (tick <= now)
+            return;
+        uint64_t steps = std::min<uint64_t>(tick - now, wheel.size());
+        for (uint64_t i = 1; i <= steps; ++i) {
+            slot_t& slot = wheel[(now + i) % wheel.size()];
+            auto keep = slot.begin();
+            for (auto it = slot.begin(); it != slot.end(); ++it) {
+                if (it->first <= tick) {
+                    due.push_back(std::move(it->second));
+                } else {
+                    if (keep != it)
+                        *keep = std::move(*it);
+                    ++keep;
+                }
+            }
+            count -= slot.end() - keep;
+            slot.erase(keep, slot.end());
+        }
+        now = tick;
+    }
+
+    /**
+     * Get the current tick
+     *
+     * @return the tick the wheel last advanced to
+     */
+    uint64_t current() const { return now; }
+
+    /**
+     * Get the number of keys scheduled
+     *
+     * @return the number of keys that did not come due yet
+     */
+    size_t size() const { return count; }
+
+    /**
+     * Remove all the keys and go back to tick 0
+     */
+    void clear() {
+        for (slot_t& slot : wheel)
+            slot.clear();
+        now = 0;
+        count = 0;
+    }
+
+private:
+    typedef std::vector<std::pair<uint64_t, K>> slot_t;
+
+    std::vector<slot_t> wheel;
+    uint64_t now;
+    size_t count;
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_TIMER_WHEEL_H */
@@ -17,6 +17,7 @@
 #include <boost/asio.hpp>
 
 #include <mutex>
+#include <vector>
 
 #pragma once
 #ifndef OPFLEXAGENT_TUNNELEPMANAGER_H
@@ -31,12 +32,22 @@ class Renderer;
  * The tunnel endpoint manager creates a tunnel termination endpoint
  * for renderers that require it.  This is the tunnel destination IP
  * that should be used for sending encapsulated traffic to the host.
+ *
+ * Where rtnetlink is available, the manager discovers the uplink
+ * address once at start and again whenever a link, address or route
+ * event concerns the uplink interface, or any interface if none is
+ * set.  Otherwise, or if the renderer reports the uplink address
+ * itself, it polls on a timer.
  */
 class TunnelEpManager : private boost::noncopyable {
 public:
     /**
      * Instantiate a new tunnelEp manager using the specified framework
      * instance.
+     *
+     * @param agent the agent
+     * @param timer_interval the interval in milliseconds between
+     * discoveries when the manager polls for the uplink address
      */
     TunnelEpManager(Agent* agent, long timer_interval = 5000);
 
@@ -110,6 +121,19 @@ public:
      */
     const std::string& getTerminationMac(const std::string& uuid);
 
+    /**
+     * Check whether a buffer of rtnetlink messages holds a link,
+     * address or route event for an interface.  A route is for the
+     * interface if it goes out of it.  Other messages, and messages
+     * too short for their type, are ignored.
+     *
+     * @param buf the messages, as read from the socket
+     * @param len the length of the messages
+     * @param ifIndex the index of the interface
+     * @return true if a message concerns the interface
+     */
+    static bool isInterfaceEvent(const char* buf, size_t len, int ifIndex);
+
     /**
      * Register a listener for tunnelEp change events
      *
@@ -148,6 +172,23 @@ private:
 
     void on_timer(const boost::system::error_code& ec);
 
+    /**
+     * Whether the uplink address is polled for rather than
+     * discovered on rtnetlink events
+     */
+    bool polling;
+    /**
+     * Whether a discovery is waiting on the timer
+     */
+    bool updatePending;
+    std::unique_ptr<boost::asio::posix::stream_descriptor> nlSocket;
+    std::vector<char> nlBuffer;
+
+    bool openNetlink();
+    void readNetlink();
+    bool isUplinkEvent(size_t len);
+    void scheduleUpdate();
+
     std::atomic<bool> stopping;
 
     /**
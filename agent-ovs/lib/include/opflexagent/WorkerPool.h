@@ -0,0 +1,108 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for WorkerPool
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_WORKERPOOL_H
+#define OPFLEXAGENT_WORKERPOOL_H
+
+#include <boost/noncopyable.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace opflexagent {
+
+/**
+ * A pool of threads that share out the iterations of a loop with the
+ * thread that runs it, for computations that can be split into
+ * independent parts.
+ *
+ * Only one loop runs at a time; a thread that calls forEach while
+ * another loop runs waits for it to finish.  Without worker threads,
+ * loops run on the calling thread alone.
+ */
+class WorkerPool : private boost::noncopyable {
+public:
+    /**
+     * Create a worker pool
+     *
+     * @param name the name given to the worker threads
+     */
+    explicit WorkerPool(const std::string& name = "worker");
+    ~WorkerPool();
+
+    /**
+     * Start the worker threads
+     *
+     * @param threads the number of threads to start besides the
+     * threads that call forEach
+     */
+    void start(size_t threads);
+
+    /**
+     * Stop the worker threads once the running loop is done
+     */
+    void stop();
+
+    /**
+     * Get the number of worker threads
+     *
+     * @return the number of threads started besides the callers
+     */
+    size_t size() const { return threads.size(); }
+
+    /**
+     * Call the function for each index from 0 to n - 1, spread across
+     * the calling thread and the worker threads, and return once all
+     * the calls have returned.  The calls may run in any order.  If a
+     * call throws, the first exception is rethrown once all the calls
+     * are done.
+     *
+     * @param n the number of iterations
+     * @param func the function to call with the index of each
+     * iteration
+     */
+    void forEach(size_t n, const std::function<void (size_t)>& func);
+
+private:
+    void run();
+    void runIterations(const std::function<void (size_t)>& func, size_t n);
+
+    std::string name;
+    std::vector<std::thread> threads;
+
+    /* serializes the loops */
+    std::mutex loopMutex;
+
+    std::mutex mutex;
+    std::condition_variable workCond;
+    std::condition_variable doneCond;
+    bool stopping;
+    /* the running loop, if any, counted by generation */
+    const std::function<void (size_t)>* loop;
+    size_t loopSize;
+    size_t generation;
+    /* the number of worker threads in the running loop */
+    size_t busy;
+    std::exception_ptr error;
+
+    std::atomic<size_t> nextIndex;
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_WORKERPOOL_H */
@@ -13,6 +13,9 @@
 #ifndef AGENT_LOGGING_H
 #define AGENT_LOGGING_H
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <string>
 #include <iostream>
 #include <sstream>
@@ -32,6 +35,8 @@ extern LogLevel logLevel;
  */
 class LogSink {
 public:
+    virtual ~LogSink() {}
+
     /**
      * Write a log message to the log destination alongwith information about
      * its origin (source file, line number etc).
@@ -45,6 +50,26 @@ public:
     virtual
     void write(LogLevel level, const char *filename, int lineno,
                const char *functionName, const std::string& message) = 0;
+
+    /**
+     * Write a log message that was logged at an earlier time, such as
+     * one that was queued for a background writer.  Sinks that stamp
+     * messages with the time should use the time given; by default
+     * it is ignored.
+     *
+     * @param time the time the message was logged
+     * @param level The log level of the message
+     * @param filename Name of source file that generated the message
+     * @param lineno Line number in source file that generated the message
+     * @param functionName Name of function that generated the message
+     * @param message The log message to write
+     */
+    virtual
+    void write(const std::chrono::system_clock::time_point& time,
+               LogLevel level, const char *filename, int lineno,
+               const char *functionName, const std::string& message) {
+        write(level, filename, lineno, functionName, message);
+    }
 };
 
 /**
@@ -60,6 +85,25 @@ void initLogging(const std::string& level, bool toSyslog,
                  const std::string& log_file,
                  const std::string& syslog_name = "opflex-agent");
 
+/**
+ * Queue log messages on per-thread rings that a background thread
+ * writes to the log destination, so that logging does not block the
+ * threads that log.  Messages are dropped and counted when the ring
+ * of a thread is full.  Fatal messages are still written before
+ * returning.  This may be turned on and off at runtime.
+ *
+ * @param async true to write log messages from a background thread
+ */
+void setAsyncLogging(bool async);
+
+/**
+ * Get the number of log messages dropped because the ring of the
+ * logging thread was full while asynchronous logging was enabled
+ *
+ * @return the number of messages dropped
+ */
+uint64_t getDroppedLogCount();
+
 /**
  * Change the logging level of the agent.
  *
@@ -137,6 +181,159 @@ private:
     if (lvl <= opflexagent::logLevel)                                      \
         opflexagent::Logger(lvl, __FILE__, __LINE__, __FUNCTION__).stream()
 
+/**
+ * Whether a message at a rate limited or sampled call site may be
+ * logged, and how many messages were left out since the last one
+ * that was
+ */
+struct LogAllowance {
+    /**
+     * True if the message may be logged
+     */
+    bool allowed;
+    /**
+     * The number of messages left out before this one
+     */
+    uint64_t suppressed;
+
+    /**
+     * Check whether the message may be logged
+     */
+    explicit operator bool() const { return allowed; }
+};
+
+/**
+ * Write a note about the messages left out, if there are any
+ */
+inline std::ostream& operator<<(std::ostream& os, const LogAllowance& a) {
+    if (a.suppressed)
+        os << "[" << a.suppressed << " similar messages suppressed] ";
+    return os;
+}
+
+/**
+ * The number of messages LOG_RATE_LIMITED_DEFAULT lets through per
+ * interval
+ */
+const uint32_t DEFAULT_LOG_RATE_LIMIT = 10;
+
+/**
+ * The interval in milliseconds of LOG_RATE_LIMITED_DEFAULT
+ */
+const uint32_t DEFAULT_LOG_RATE_INTERVAL_MS = 10000;
+
+/**
+ * Let through a number of messages per interval at a call site and
+ * count the others.  Use through LOG_RATE_LIMITED.
+ */
+class LogRateLimiter {
+public:
+    /**
+     * Create a limiter
+     *
+     * @param limit_ the number of messages to log per interval
+     * @param intervalMs the length of the interval in milliseconds
+     */
+    LogRateLimiter(uint32_t limit_, uint32_t intervalMs)
+        : limit(limit_), interval(int64_t(intervalMs) * 1000000),
+          windowStart(INT64_MIN / 2), count(0), suppressed(0) {}
+
+    /**
+     * Count a message and check whether it may be logged
+     *
+     * @return whether the message may be logged and how many were
+     * suppressed before it
+     */
+    LogAllowance allow() {
+        int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>
+            (std::chrono::steady_clock::now().time_since_epoch()).count();
+        int64_t start = windowStart.load(std::memory_order_relaxed);
+        if (now - start >= interval &&
+            windowStart.compare_exchange_strong(start, now))
+            count.store(0, std::memory_order_relaxed);
+        if (count.fetch_add(1, std::memory_order_relaxed) < limit)
+            return {true, suppressed.exchange(0)};
+        suppressed.fetch_add(1, std::memory_order_relaxed);
+        return {false, 0};
+    }
+
+private:
+    const uint32_t limit;
+    const int64_t interval;
+    std::atomic<int64_t> windowStart;
+    std::atomic<uint32_t> count;
+    std::atomic<uint64_t> suppressed;
+};
+
+/**
+ * Let through one in a number of messages at a call site.  Use
+ * through LOG_SAMPLED.
+ */
+class LogSampler {
+public:
+    /**
+     * Create a sampler
+     *
+     * @param rate_ log one in this many messages
+     */
+    explicit LogSampler(uint32_t rate_) : rate(rate_ ? rate_ : 1), count(0) {}
+
+    /**
+     * Count a message and check whether it may be logged
+     *
+     * @return whether the message may be logged and how many were
+     * left out before it
+     */
+    LogAllowance allow() {
+        uint64_t n = count.fetch_add(1, std::memory_order_relaxed);
+        if (n % rate != 0)
+            return {false, 0};
+        return {true, n ? rate - 1 : 0};
+    }
+
+private:
+    const uint32_t rate;
+    std::atomic<uint64_t> count;
+};
+
+/**
+ * Log at most limit messages per intervalMs milliseconds from this
+ * call site.  The first message logged after some were dropped notes
+ * how many were.  Use for messages that can repeat for every packet
+ * or object during an incident.
+ */
+#define LOG_RATE_LIMITED(lvl, limit, intervalMs)                        \
+    if (!(lvl <= opflexagent::logLevel)) {} else                        \
+    if (opflexagent::LogAllowance _log_allowance =                      \
+        []() -> opflexagent::LogRateLimiter& {                          \
+            static opflexagent::LogRateLimiter l(limit, intervalMs);    \
+            return l;                                                   \
+        }().allow())                                                    \
+        opflexagent::Logger(lvl, __FILE__, __LINE__, __FUNCTION__).stream() \
+            << _log_allowance
+
+/**
+ * Log at most DEFAULT_LOG_RATE_LIMIT messages per
+ * DEFAULT_LOG_RATE_INTERVAL_MS milliseconds from this call site
+ */
+#define LOG_RATE_LIMITED_DEFAULT(lvl)                                   \
+    LOG_RATE_LIMITED(lvl, opflexagent::DEFAULT_LOG_RATE_LIMIT,          \
+                     opflexagent::DEFAULT_LOG_RATE_INTERVAL_MS)
+
+/**
+ * Log one in every rate messages from this call site, noting how many
+ * were left out
+ */
+#define LOG_SAMPLED(lvl, rate)                                          \
+    if (!(lvl <= opflexagent::logLevel)) {} else                        \
+    if (opflexagent::LogAllowance _log_allowance =                      \
+        []() -> opflexagent::LogSampler& {                              \
+            static opflexagent::LogSampler s(rate);                     \
+            return s;                                                   \
+        }().allow())                                                    \
+        opflexagent::Logger(lvl, __FILE__, __LINE__, __FUNCTION__).stream() \
+            << _log_allowance
+
 #define LOG1(lvl, filename, lineNo, functionName, message)              \
     if (lvl <= opflexagent::logLevel)                                      \
         opflexagent::getLogSink()->write(lvl, filename, lineNo,            \
@@ -15,12 +15,17 @@
 
 #include <opflexagent/logging.h>
 #include <opflexagent/AgentLogHandler.h>
+#include <opflexagent/AsyncLogSink.h>
 
 #include <opflex/logging/OFLogHandler.h>
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/date_time/c_local_time_adjustor.hpp>
 
+#include <atomic>
 #include <fstream>
+#include <memory>
 #include <mutex>
+#include <vector>
 
 #include <syslog.h>
 
@@ -65,6 +70,27 @@ public:
     virtual
     void write(LogLevel level, const char *filename, int lineno,
                const char *functionName, const std::string& message) {
+        writeAt(boost::posix_time::microsec_clock::local_time(),
+                level, filename, lineno, functionName, message);
+    }
+
+    virtual
+    void write(const std::chrono::system_clock::time_point& time,
+               LogLevel level, const char *filename, int lineno,
+               const char *functionName, const std::string& message) {
+        using namespace boost::posix_time;
+        typedef boost::date_time::c_local_adjustor<ptime> local_adj;
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>
+            (time.time_since_epoch()).count();
+        ptime utc = from_time_t(us / 1000000) + microseconds(us % 1000000);
+        writeAt(local_adj::utc_to_local(utc),
+                level, filename, lineno, functionName, message);
+    }
+
+private:
+    void writeAt(const boost::posix_time::ptime& time,
+                 LogLevel level, const char *filename, int lineno,
+                 const char *functionName, const std::string& message) {
         const char *levelStr = LEVEL_STR_DEBUG;
         switch (level) {
         case TRACE:   levelStr = LEVEL_STR_TRACE; break;
@@ -75,12 +101,11 @@ public:
         case FATAL:   levelStr = LEVEL_STR_FATAL; break;
         }
         std::lock_guard<std::mutex> lock(logMtx);
-        (*out) << "[" << boost::posix_time::microsec_clock::local_time()
+        (*out) << "[" << time
             << "] [" << levelStr << "] [" << filename << ":" << lineno << ":"
             << functionName << "] " << message << std::endl;
     }
 
-private:
     std::fstream fileStream;
     std::ostream *out;
     std::mutex logMtx;
@@ -133,10 +158,39 @@ private:
 };
 
 static OStreamLogSink consoleLogSink(std::cout);
-static LogSink * currentLogSink = &consoleLogSink;
+static std::atomic<LogSink*> currentLogSink(&consoleLogSink);
+static std::mutex asyncMutex;
+static std::shared_ptr<AsyncLogSink> asyncLogSink;
+/* replaced async sinks, which threads that loaded them before the
+   switch may still be writing to, so they are never destroyed */
+static std::vector<std::shared_ptr<AsyncLogSink> > retiredAsyncLogSinks;
 
 LogSink * getLogSink() {
-    return currentLogSink;
+    return currentLogSink.load(std::memory_order_acquire);
+}
+
+void setAsyncLogging(bool async) {
+    std::lock_guard<std::mutex> lock(asyncMutex);
+    LogSink* current = currentLogSink.load();
+    if (async) {
+        if (asyncLogSink && current == asyncLogSink.get())
+            return;
+        if (!asyncLogSink || &asyncLogSink->getSink() != current) {
+            if (asyncLogSink)
+                retiredAsyncLogSinks.push_back(asyncLogSink);
+            asyncLogSink = std::make_shared<AsyncLogSink>(*current);
+        }
+        currentLogSink = asyncLogSink.get();
+    } else if (asyncLogSink && current == asyncLogSink.get()) {
+        // threads may still be queueing messages, so the sink is kept
+        currentLogSink = &asyncLogSink->getSink();
+        asyncLogSink->flush();
+    }
+}
+
+uint64_t getDroppedLogCount() {
+    std::lock_guard<std::mutex> lock(asyncMutex);
+    return asyncLogSink ? asyncLogSink->getDropped() : 0;
 }
 
 void initLogging(const std::string& levelstr,
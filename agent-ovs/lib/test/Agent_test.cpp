@@ -0,0 +1,69 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Test suite for the agent configuration
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/test/BaseFixture.h>
+#include <opflexagent/logging.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace opflexagent {
+
+using boost::property_tree::ptree;
+
+BOOST_AUTO_TEST_SUITE(Agent_test)
+
+BOOST_FIXTURE_TEST_CASE(reload, BaseFixture) {
+    ptree props;
+    props.put("log.level", "debug");
+    props.put("opflex.name", "test-agent");
+    props.put("opflex.domain", "test-domain");
+    ptree peer;
+    peer.put("hostname", "127.0.0.1");
+    peer.put("port", 8009);
+    ptree peers;
+    peers.push_back(std::make_pair("", peer));
+    props.add_child("opflex.peers", peers);
+    agent.setProperties(props);
+
+    // an unchanged configuration applies
+    BOOST_CHECK(agent.reloadProperties({props}));
+
+    // the log level and slow task threshold change in place
+    ptree updated(props);
+    updated.put("log.level", "info");
+    updated.put("opflex.timers.slow-task-threshold", 500);
+    BOOST_CHECK(agent.reloadProperties({updated}));
+    BOOST_CHECK_EQUAL("info", getLogLevelString());
+
+    // removing a peer, changing the domain or removing a setting
+    // need a restart and change nothing
+    ptree noPeers(updated);
+    noPeers.get_child("opflex").erase("peers");
+    noPeers.put("log.level", "warning");
+    BOOST_CHECK(!agent.reloadProperties({noPeers}));
+    ptree domain(updated);
+    domain.put("opflex.domain", "other-domain");
+    BOOST_CHECK(!agent.reloadProperties({domain}));
+    BOOST_CHECK(!agent.reloadProperties({props}));
+    BOOST_CHECK_EQUAL("info", getLogLevelString());
+
+    // a setting moved to another file applies in place
+    ptree first(updated), second;
+    first.erase("log");
+    second.put("log.level", "info");
+    BOOST_CHECK(agent.reloadProperties({first, second}));
+
+    setLoggingLevel("debug");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace opflexagent */
@@ -0,0 +1,68 @@
+/*
+ * Test suite for class AllocStats
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/AllocStats.h>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace opflexagent {
+
+namespace fs = boost::filesystem;
+
+BOOST_AUTO_TEST_SUITE(AllocStats_test)
+
+BOOST_AUTO_TEST_CASE(sample) {
+    AllocStats stats;
+    BOOST_REQUIRE(stats.sample());
+    uint64_t before = stats.getAllocatedBytes();
+
+    std::vector<std::unique_ptr<char[]> > blocks;
+    for (int i = 0; i < 64; ++i) {
+        blocks.emplace_back(new char[64 * 1024]);
+        blocks.back()[0] = 1;
+    }
+    BOOST_REQUIRE(stats.sample());
+    BOOST_CHECK_GE(stats.getAllocatedBytes(), before + 64 * 64 * 1024);
+    BOOST_CHECK_GE(stats.getResidentBytes(), stats.getActiveBytes());
+    BOOST_CHECK_GE(stats.getActiveBytes(), stats.getAllocatedBytes());
+    BOOST_CHECK_GE(stats.getFragmentation(), 0);
+    BOOST_CHECK_LT(stats.getFragmentation(), 1);
+
+    blocks.clear();
+    AllocStats::releaseFreeMemory();
+    BOOST_REQUIRE(stats.sample());
+    BOOST_CHECK_LT(stats.getAllocatedBytes(), before + 64 * 64 * 1024);
+}
+
+BOOST_AUTO_TEST_CASE(dump) {
+    if (std::string("libc") != AllocStats::getAllocatorName())
+        return;
+    fs::path temp(fs::temp_directory_path() / fs::unique_path());
+    BOOST_CHECK(AllocStats::dumpHeapProfile(temp.string()));
+    BOOST_CHECK_GT(fs::file_size(temp), 0);
+
+    // an existing file or symlink is not written to
+    BOOST_CHECK(!AllocStats::dumpHeapProfile(temp.string()));
+    fs::path link(temp.string() + ".link");
+    fs::create_symlink(temp, link);
+    BOOST_CHECK(!AllocStats::dumpHeapProfile(link.string()));
+    fs::remove(link);
+    fs::remove(temp);
+
+    BOOST_CHECK(!AllocStats::dumpHeapProfile((temp / "missing").string()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace opflexagent */
@@ -0,0 +1,96 @@
+/*
+ * Test suite for class AsyncLogSink
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/AsyncLogSink.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace opflexagent {
+
+BOOST_AUTO_TEST_SUITE(AsyncLogSink_test)
+
+class CaptureSink : public LogSink {
+public:
+    virtual void write(LogLevel level, const char *filename, int lineno,
+                       const char *functionName,
+                       const std::string& message) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        levels.push_back(level);
+        messages.push_back(message);
+        threads.insert(std::this_thread::get_id());
+    }
+
+    std::mutex mutex;
+    std::vector<LogLevel> levels;
+    std::vector<std::string> messages;
+    std::set<std::thread::id> threads;
+};
+
+BOOST_AUTO_TEST_CASE(order) {
+    CaptureSink capture;
+    {
+        AsyncLogSink async(capture);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&async, t]() {
+                    for (int i = 0; i < 100; ++i)
+                        async.write(INFO, __FILE__, __LINE__, __FUNCTION__,
+                                    std::to_string(t * 1000 + i));
+                });
+        }
+        for (auto& t : threads) t.join();
+        async.flush();
+        BOOST_CHECK_EQUAL(400, capture.messages.size());
+        BOOST_CHECK_EQUAL(0, async.getDropped());
+
+        // the messages of each thread are written in order
+        std::vector<int> last(4, -1);
+        for (const std::string& m : capture.messages) {
+            int v = std::stoi(m);
+            BOOST_CHECK_GT(v % 1000, last[v / 1000]);
+            last[v / 1000] = v % 1000;
+        }
+        BOOST_CHECK(capture.threads.count(std::this_thread::get_id()) == 0);
+
+        // fatal messages are written before returning
+        async.write(FATAL, __FILE__, __LINE__, __FUNCTION__, "fatal");
+        BOOST_CHECK_EQUAL("fatal", capture.messages.back());
+        async.write(DEBUG, __FILE__, __LINE__, __FUNCTION__, "last");
+    }
+    // the queued messages are written when the sink is destroyed
+    BOOST_CHECK_EQUAL("last", capture.messages.back());
+}
+
+BOOST_AUTO_TEST_CASE(drop) {
+    CaptureSink capture;
+    AsyncLogSink async(capture, 4);
+    {
+        // hold up the writer so that the ring fills
+        std::unique_lock<std::mutex> lock(capture.mutex);
+        for (int i = 0; i < 100; ++i)
+            async.write(INFO, __FILE__, __LINE__, __FUNCTION__, "m");
+    }
+    async.flush();
+    // the writer may take one message off the ring before it blocks
+    BOOST_CHECK_GE(async.getDropped(), 100 - 5);
+    BOOST_CHECK_LE(async.getDropped(), 100 - 4);
+    BOOST_CHECK_EQUAL(100 - async.getDropped() + 1,
+                      capture.messages.size());
+    BOOST_CHECK_EQUAL(WARNING, capture.levels.back());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace opflexagent */
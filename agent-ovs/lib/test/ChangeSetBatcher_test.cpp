@@ -0,0 +1,89 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Test suite for class ChangeSetBatcher
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/ChangeSetBatcher.h>
+#include <opflexagent/test/ModbFixture.h>
+#include <opflexagent/logging.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <mutex>
+
+namespace opflexagent {
+
+using std::string;
+using std::shared_ptr;
+using opflex::modb::URI;
+
+class CollectingListener : public ChangeSetListener {
+public:
+    CollectingListener() : calls(0) {}
+
+    virtual void changesUpdated(const ChangeSet& changes) override {
+        std::lock_guard<std::mutex> guard(mutex);
+        calls += 1;
+        for (const auto& kv : changes.endpoints)
+            endpoints[kv.first] = kv.second;
+        for (const auto& kv : changes.groups)
+            groups[kv.first] = kv.second;
+    }
+
+    bool hasEndpoint(const string& uuid, bool present) {
+        std::lock_guard<std::mutex> guard(mutex);
+        auto it = endpoints.find(uuid);
+        return it != endpoints.end() && bool(it->second) == present;
+    }
+
+    bool hasGroup(const URI& uri) {
+        std::lock_guard<std::mutex> guard(mutex);
+        auto it = groups.find(uri);
+        return it != groups.end() && it->second;
+    }
+
+    size_t getCalls() {
+        std::lock_guard<std::mutex> guard(mutex);
+        return calls;
+    }
+
+private:
+    std::mutex mutex;
+    size_t calls;
+    ChangeSet::ep_map_t endpoints;
+    ChangeSet::group_map_t groups;
+};
+
+BOOST_AUTO_TEST_SUITE(ChangeSetBatcher_test)
+
+BOOST_FIXTURE_TEST_CASE(batch, ModbFixture) {
+    CollectingListener listener;
+    ChangeSetBatcher batcher(agent, agent.getAgentIOService());
+    batcher.setDelay(std::chrono::milliseconds(50),
+                     std::chrono::milliseconds(200));
+    batcher.registerListener(&listener);
+    batcher.start();
+
+    createObjects();
+    WAIT_FOR(listener.hasEndpoint(ep0->getUUID(), true), 500);
+    WAIT_FOR(listener.hasEndpoint(ep2->getUUID(), true), 500);
+    WAIT_FOR(listener.hasGroup(epg0->getURI()), 500);
+
+    // all of the objects arrive in far fewer change sets than updates
+    BOOST_CHECK(listener.getCalls() < 5);
+
+    epSrc.removeEndpoint(ep0->getUUID());
+    WAIT_FOR(listener.hasEndpoint(ep0->getUUID(), false), 500);
+
+    batcher.stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -0,0 +1,244 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Test suite for the endpoint database and DBEndpointSource
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/test/BaseFixture.h>
+#include <opflexagent/EndpointDB.h>
+#include <opflexagent/DBEndpointSource.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <fstream>
+#include <map>
+
+namespace opflexagent {
+
+namespace fs = boost::filesystem;
+using std::string;
+
+class EndpointDBFixture : public BaseFixture {
+public:
+    EndpointDBFixture()
+        : temp(fs::temp_directory_path() / fs::unique_path()),
+          dbPath((temp / "endpoints.db").string()) {
+        fs::create_directory(temp);
+    }
+
+    ~EndpointDBFixture() {
+        fs::remove_all(temp);
+    }
+
+    /* read the database and return the latest record for each uuid */
+    bool readAll(EndpointDBReader& reader,
+                 std::map<string, string>& records) {
+        return reader.read([&](EndpointDB::Op op, const string& uuid,
+                               const char* json, size_t length) {
+                if (op == EndpointDB::REMOVE)
+                    records.erase(uuid);
+                else
+                    records[uuid] = string(json, length);
+            });
+    }
+
+    static string epJson(const string& uuid, const string& mac) {
+        return "{\"uuid\": \"" + uuid + "\", \"mac\": \"" + mac +
+            "\", \"interface-name\": \"veth-" + uuid + "\"}";
+    }
+
+    fs::path temp;
+    string dbPath;
+};
+
+BOOST_AUTO_TEST_SUITE(EndpointDB_test)
+
+BOOST_FIXTURE_TEST_CASE(readwrite, EndpointDBFixture) {
+    EndpointDBReader reader(dbPath);
+    std::map<string, string> records;
+    BOOST_CHECK(!readAll(reader, records));
+    BOOST_CHECK(records.empty());
+
+    EndpointDBWriter writer(dbPath);
+    writer.update("ep1", "{\"a\": 1}");
+    writer.update("ep2", "{\"b\": 2}");
+    BOOST_CHECK(readAll(reader, records));
+    BOOST_CHECK_EQUAL(2, records.size());
+    BOOST_CHECK_EQUAL("{\"a\": 1}", records["ep1"]);
+
+    // only new records are read
+    writer.update("ep1", "{\"a\": 3}");
+    writer.remove("ep2");
+    writer.remove("ep3");
+    std::map<string, string> newRecords;
+    BOOST_CHECK(!readAll(reader, newRecords));
+    BOOST_CHECK_EQUAL(1, newRecords.size());
+    BOOST_CHECK_EQUAL("{\"a\": 3}", newRecords["ep1"]);
+    BOOST_CHECK_EQUAL(1, writer.getCount());
+
+    // a new writer rebuilds the index from the file
+    EndpointDBWriter writer2(dbPath);
+    BOOST_CHECK_EQUAL(1, writer2.getCount());
+    BOOST_CHECK_EQUAL(writer.getFileSize(), writer2.getFileSize());
+}
+
+BOOST_FIXTURE_TEST_CASE(incomplete, EndpointDBFixture) {
+    size_t size;
+    {
+        EndpointDBWriter writer(dbPath);
+        writer.update("ep1", "{\"a\": 1}");
+        size = writer.getFileSize();
+    }
+    {
+        // a record cut short by a crashed writer
+        std::ofstream os(dbPath, std::ios::app | std::ios::binary);
+        const char partial[] = {20, 0, 0, 0, 1, 2, 3, 4, 1};
+        os.write(partial, sizeof(partial));
+    }
+
+    EndpointDBReader reader(dbPath);
+    std::map<string, string> records;
+    readAll(reader, records);
+    BOOST_CHECK_EQUAL(1, records.size());
+    BOOST_CHECK_EQUAL(0, reader.getCorruptCount());
+
+    EndpointDBWriter writer(dbPath);
+    BOOST_CHECK_EQUAL(size, writer.getFileSize());
+    writer.update("ep2", "{\"b\": 2}");
+    readAll(reader, records);
+    BOOST_CHECK_EQUAL(2, records.size());
+}
+
+BOOST_FIXTURE_TEST_CASE(corrupt, EndpointDBFixture) {
+    size_t size;
+    {
+        EndpointDBWriter writer(dbPath);
+        writer.update("ep1", "{\"a\": 1}");
+        size = writer.getFileSize();
+        writer.update("ep2", "{\"b\": 2}");
+        writer.update("ep3", "{\"c\": 3}");
+    }
+    {
+        // damage the payload of the middle record
+        std::fstream f(dbPath, std::ios::in | std::ios::out |
+                       std::ios::binary);
+        f.seekp(size + 20);
+        f.put('x');
+    }
+
+    // the corrupt record is skipped and the records after it are kept
+    EndpointDBReader reader(dbPath);
+    std::map<string, string> records;
+    readAll(reader, records);
+    BOOST_CHECK_EQUAL(2, records.size());
+    BOOST_CHECK_EQUAL(1, reader.getCorruptCount());
+
+    size_t fileSize = fs::file_size(dbPath);
+    EndpointDBWriter writer(dbPath);
+    BOOST_CHECK_EQUAL(fileSize, writer.getFileSize());
+    BOOST_CHECK_EQUAL(2, writer.getCount());
+
+    // a corrupt final record is taken to be torn and dropped
+    writer.update("ep4", "{\"d\": 4}");
+    {
+        std::fstream f(dbPath, std::ios::in | std::ios::out |
+                       std::ios::binary);
+        f.seekp(fileSize + 20);
+        f.put('x');
+    }
+    EndpointDBWriter writer2(dbPath);
+    BOOST_CHECK_EQUAL(fileSize, writer2.getFileSize());
+    BOOST_CHECK_EQUAL(2, writer2.getCount());
+
+    // the records after a corrupt length cannot be found, so the
+    // file is saved and rewritten with the records before it
+    {
+        std::fstream f(dbPath, std::ios::in | std::ios::out |
+                       std::ios::binary);
+        f.seekp(size);
+        const char length[] = {0, 0, 0, 0x7f};
+        f.write(length, sizeof(length));
+    }
+    EndpointDBWriter writer3(dbPath);
+    BOOST_CHECK_EQUAL(1, writer3.getCount());
+    BOOST_CHECK(fs::exists(dbPath + ".corrupt"));
+}
+
+BOOST_FIXTURE_TEST_CASE(compact, EndpointDBFixture) {
+    EndpointDBWriter writer(dbPath);
+    for (int i = 0; i < 10; ++i)
+        writer.update("ep1", "{\"a\": " + std::to_string(i) + "}");
+    writer.update("ep2", "{\"b\": 2}");
+
+    EndpointDBReader reader(dbPath);
+    std::map<string, string> records;
+    BOOST_CHECK(readAll(reader, records));
+    size_t before = writer.getFileSize();
+
+    writer.compact();
+    BOOST_CHECK(writer.getFileSize() < before);
+    BOOST_CHECK_EQUAL(2, writer.getCount());
+
+    // the reader sees the replaced file and reads it from the start
+    records.clear();
+    BOOST_CHECK(readAll(reader, records));
+    BOOST_CHECK_EQUAL(2, records.size());
+    BOOST_CHECK_EQUAL("{\"a\": 9}", records["ep1"]);
+}
+
+BOOST_FIXTURE_TEST_CASE(source, EndpointDBFixture) {
+    EndpointManager& epMgr = agent.getEndpointManager();
+    EndpointDBWriter writer(dbPath);
+    writer.update("ep1", epJson("ep1", "00:00:00:00:00:01"));
+    writer.update("ep2", epJson("ep2", "00:00:00:00:00:02"));
+
+    DBEndpointSource source(&epMgr, dbPath);
+    source.sync();
+    BOOST_CHECK_EQUAL(2, epMgr.getEpCount());
+    BOOST_REQUIRE(epMgr.getEndpoint("ep2"));
+    BOOST_CHECK_EQUAL("veth-ep2",
+                      epMgr.getEndpoint("ep2")->getInterfaceName().get());
+
+    // an unchanged record is not applied again, but a change of the
+    // same size is
+    std::shared_ptr<const Endpoint> ep2 = epMgr.getEndpoint("ep2");
+    writer.update("ep2", epJson("ep2", "00:00:00:00:00:02"));
+    source.sync();
+    BOOST_CHECK(epMgr.getEndpoint("ep2") == ep2);
+    writer.update("ep2", epJson("ep2", "00:00:00:00:00:12"));
+    source.sync();
+    BOOST_REQUIRE(epMgr.getEndpoint("ep2"));
+    BOOST_CHECK(epMgr.getEndpoint("ep2") != ep2);
+    BOOST_CHECK_EQUAL("00:00:00:00:00:12",
+                      epMgr.getEndpoint("ep2")->getMAC().get().toString());
+
+    writer.remove("ep1");
+    writer.update("ep3", epJson("ep3", "00:00:00:00:00:03"));
+    source.sync();
+    BOOST_CHECK_EQUAL(2, epMgr.getEpCount());
+    BOOST_CHECK(!epMgr.getEndpoint("ep1"));
+
+    // endpoints missing from a replaced file are removed
+    writer.remove("ep2");
+    writer.compact();
+    source.sync();
+    BOOST_CHECK_EQUAL(1, epMgr.getEpCount());
+    BOOST_CHECK(epMgr.getEndpoint("ep3"));
+
+    // the thread follows the changes signaled by the writer
+    source.start();
+    writer.update("ep4", epJson("ep4", "00:00:00:00:00:04"));
+    writer.notify();
+    WAIT_FOR(epMgr.getEpCount() == 2, 1000);
+    source.stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace opflexagent */
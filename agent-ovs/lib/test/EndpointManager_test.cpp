@@ -391,6 +391,11 @@ BOOST_FIXTURE_TEST_CASE( basic, EndpointFixture ) {
     agent.getEndpointManager().getEndpointsForGroup(epgu, epUuids);
     BOOST_CHECK_EQUAL(1, epUuids.size());
     BOOST_CHECK(epUuids.find(ep1.getUUID()) != epUuids.end());
+    BOOST_CHECK(!agent.getEndpointManager().getEndpoint(ep2.getUUID()));
+    BOOST_CHECK(!agent.getEndpointManager().getComputedEPG(ep2.getUUID()));
+    BOOST_REQUIRE(agent.getEndpointManager().getEndpoint(ep1.getUUID()));
+    BOOST_CHECK(agent.getEndpointManager().getComputedEPG(ep1.getUUID()) ==
+                epgu);
 
     epSource.updateEndpoint(ep2);
 
@@ -452,6 +457,138 @@ BOOST_FIXTURE_TEST_CASE( basic, EndpointFixture ) {
     WAIT_FOR(!hasEPREntry<L3Ep>(framework, l3epr2_ipm), 500);
 }
 
+BOOST_AUTO_TEST_CASE( parsedaddresses ) {
+    using boost::asio::ip::address;
+    Endpoint ep("e82e883b-851d-4cc6-bedb-fb5e27530043");
+    ep.addIP("10.1.1.2");
+    ep.addIP("10.1.1.2");
+    ep.addIP("fd00::2/64");
+    ep.addIP("not-an-ip");
+    ep.addAnycastReturnIP("10.1.1.3");
+    ep.addAnycastReturnIP("10.1.1");
+    ep.addServiceIP("169.254.1.1");
+    ep.addVirtualIP(std::make_pair(MAC("42:00:00:00:00:01"), "10.1.1.7/24"));
+    ep.addVirtualIP(std::make_pair(MAC("42:00:00:00:00:01"), "bad/24"));
+
+    // the strings are kept as given, invalid ones included
+    BOOST_CHECK_EQUAL(3, ep.getIPs().size());
+    BOOST_CHECK_EQUAL(2, ep.getVirtualIPs().size());
+
+    const std::vector<network::cidr_t>& cidrs = ep.getIPCidrs();
+    BOOST_REQUIRE_EQUAL(2, cidrs.size());
+    BOOST_CHECK_EQUAL(address::from_string("10.1.1.2"), cidrs[0].first);
+    BOOST_CHECK_EQUAL(32, cidrs[0].second);
+    BOOST_CHECK_EQUAL(address::from_string("fd00::2"), cidrs[1].first);
+    BOOST_CHECK_EQUAL(64, cidrs[1].second);
+
+    BOOST_REQUIRE_EQUAL(1, ep.getAnycastReturnAddresses().size());
+    BOOST_CHECK_EQUAL(address::from_string("10.1.1.3"),
+                      ep.getAnycastReturnAddresses()[0]);
+    BOOST_REQUIRE_EQUAL(1, ep.getServiceAddresses().size());
+    BOOST_CHECK_EQUAL(address::from_string("169.254.1.1"),
+                      ep.getServiceAddresses()[0]);
+
+    // virtual IPs are masked like the subnets they stand for
+    BOOST_REQUIRE_EQUAL(1, ep.getVirtualIPCidrs().size());
+    BOOST_CHECK_EQUAL(MAC("42:00:00:00:00:01"),
+                      ep.getVirtualIPCidrs()[0].first);
+    BOOST_CHECK_EQUAL(address::from_string("10.1.1.0"),
+                      ep.getVirtualIPCidrs()[0].second.first);
+    BOOST_CHECK_EQUAL(24, ep.getVirtualIPCidrs()[0].second.second);
+
+    // copies keep the parsed forms
+    Endpoint copy(ep);
+    BOOST_CHECK_EQUAL(2, copy.getIPCidrs().size());
+}
+
+BOOST_AUTO_TEST_CASE( interned ) {
+    Endpoint::DHCPv6Config v6;
+    v6.addDnsServer("fd00::53");
+    v6.addSearchListEntry("example.com");
+    Endpoint ep1("e82e883b-851d-4cc6-bedb-fb5e27530043");
+    Endpoint ep2("72ffb982-b2d5-4ae4-91ac-0dd61daf527a");
+    for (Endpoint* ep : {&ep1, &ep2}) {
+        ep->addAttribute("vm-name", "coke");
+        ep->addAttribute("namespace", "default");
+        ep->setDHCPv6Config(v6);
+    }
+    BOOST_CHECK(ep1.getDHCPv6Config() != ep2.getDHCPv6Config());
+
+    ep1.intern();
+    ep2.intern();
+    BOOST_CHECK_EQUAL(&ep1.getAttributes(), &ep2.getAttributes());
+    BOOST_CHECK(ep1.getDHCPv6Config() == ep2.getDHCPv6Config());
+
+    // changing a shared map leaves the other endpoints alone
+    ep1.addAttribute("vm-name", "pepsi");
+    BOOST_CHECK_EQUAL("pepsi", ep1.getAttributes().at("vm-name"));
+    BOOST_CHECK_EQUAL("coke", ep2.getAttributes().at("vm-name"));
+    ep1.clearAttributes();
+    BOOST_CHECK(ep1.getAttributes().empty());
+    BOOST_CHECK_EQUAL(2, ep2.getAttributes().size());
+
+    // a copy does not share changes with the endpoint it came from
+    Endpoint ep3(ep2);
+    ep3.addAttribute("vm-name", "pepsi");
+    BOOST_CHECK_EQUAL("coke", ep2.getAttributes().at("vm-name"));
+}
+
+BOOST_FIXTURE_TEST_CASE( macindex, EndpointFixture ) {
+    using boost::asio::ip::address;
+    EndpointManager& epMgr = agent.getEndpointManager();
+    Endpoint ep1("e82e883b-851d-4cc6-bedb-fb5e27530043");
+    ep1.setMAC(MAC("00:00:00:00:00:01"));
+    ep1.addIP("10.1.1.2");
+    ep1.setInterfaceName("veth1");
+    ep1.addVirtualIP(std::make_pair(MAC("42:00:00:00:00:01"), "10.1.1.0/24"));
+    Endpoint ep2("72ffb982-b2d5-4ae4-91ac-0dd61daf527a");
+    ep2.setMAC(MAC("00:00:00:00:00:02"));
+    ep2.addIP("10.1.1.4");
+    ep2.setInterfaceName("veth1");
+    ep2.addVirtualIP(std::make_pair(MAC("42:00:00:00:00:01"),
+                                    "10.1.1.128/25"));
+
+    epSource.updateEndpoint(ep1);
+    epSource.updateEndpoint(ep2);
+
+    std::unordered_set<std::string> uuids;
+    epMgr.getEndpointsByIfaceMac("veth1", MAC("00:00:00:00:00:01"), uuids);
+    BOOST_CHECK((std::unordered_set<std::string>{ep1.getUUID()}) == uuids);
+    uuids.clear();
+    epMgr.getEndpointsByIfaceMac("veth1", MAC("42:00:00:00:00:01"), uuids);
+    BOOST_CHECK_EQUAL(2, uuids.size());
+    uuids.clear();
+    epMgr.getEndpointsByIfaceMac("veth2", MAC("00:00:00:00:00:01"), uuids);
+    BOOST_CHECK(uuids.empty());
+
+    epMgr.getEndpointsByVirtualIp(MAC("42:00:00:00:00:01"),
+                                  address::from_string("10.1.1.10"), uuids);
+    BOOST_CHECK((std::unordered_set<std::string>{ep1.getUUID()}) == uuids);
+    uuids.clear();
+    epMgr.getEndpointsByVirtualIp(MAC("42:00:00:00:00:01"),
+                                  address::from_string("10.1.1.200"), uuids);
+    BOOST_CHECK_EQUAL(2, uuids.size());
+    uuids.clear();
+    epMgr.getEndpointsByVirtualIp(MAC("42:00:00:00:00:02"),
+                                  address::from_string("10.1.1.200"), uuids);
+    BOOST_CHECK(uuids.empty());
+
+    BOOST_REQUIRE(epMgr.getEpFromLocalMap("10.1.1.4"));
+    BOOST_CHECK_EQUAL(ep2.getUUID(),
+                      epMgr.getEpFromLocalMap("10.1.1.4")->getUUID());
+    BOOST_CHECK(!epMgr.getEpFromLocalMap("10.1.1.5"));
+    BOOST_CHECK(!epMgr.getEpFromLocalMap("not-an-ip"));
+
+    epSource.removeEndpoint(ep2.getUUID());
+    BOOST_CHECK(!epMgr.getEpFromLocalMap("10.1.1.4"));
+    epMgr.getEndpointsByVirtualIp(MAC("42:00:00:00:00:01"),
+                                  address::from_string("10.1.1.200"), uuids);
+    BOOST_CHECK((std::unordered_set<std::string>{ep1.getUUID()}) == uuids);
+    uuids.clear();
+    epMgr.getEndpointsByIfaceMac("veth1", MAC("00:00:00:00:00:02"), uuids);
+    BOOST_CHECK(uuids.empty());
+}
+
 BOOST_FIXTURE_TEST_CASE( epgmapping, EndpointFixture ) {
     URI epgu = URI("/PolicyUniverse/PolicySpace/test/GbpEpGroup/epg/");
     URI epg2u = URI("/PolicyUniverse/PolicySpace/test/GbpEpGroup/epg2/");
@@ -563,6 +700,12 @@ BOOST_FIXTURE_TEST_CASE( epgmapping, EndpointFixture ) {
     WAIT_FOR(0 == getEGSize(agent.getEndpointManager(), epg2u), 500);
     WAIT_FOR(1 == getEGSize(agent.getEndpointManager(), epgu), 500);
 
+    // removing the mapping also removes the group it assigned
+    EpgMapping::remove(framework, "testmapping");
+    mutator.commit();
+    WAIT_FOR(0 == getEGSize(agent.getEndpointManager(), epgu), 500);
+    BOOST_CHECK_EQUAL(0, getEGSize(agent.getEndpointManager(), epgu));
+
     epSource.removeEndpoint(ep2.getUUID());
     WAIT_FOR(!hasEPREntry<L2Ep>(framework, l2epr2), 500);
     WAIT_FOR(!hasEPREntry<L3Ep>(framework, l3epr2_4), 500);
@@ -1006,6 +1149,137 @@ BOOST_FIXTURE_TEST_CASE( fssource, FSEndpointFixture ) {
     watcher.stop();
 }
 
+BOOST_FIXTURE_TEST_CASE( epmetricbudget, FSEndpointFixture ) {
+    AgentPrometheusManager::CardinalityBudget budget;
+    budget.maxEps = 1;
+    budget.lazyEpGauges = true;
+    budget.epExportMode = AgentPrometheusManager::EP_EXPORT_TOP_DROPS;
+    agent.getPrometheusManager().setCardinalityBudget(budget);
+
+    const string uuid1 = "83f18f0b-80f7-46e2-b06c-4d9487b0c754";
+    const string uuid2 = "83f18f0b-80f7-46e2-b06c-4d9487b0c755";
+    int i = 0;
+    for (const string& uuid : {uuid1, uuid2}) {
+        fs::ofstream os(temp / (uuid + ".ep"));
+        os << "{"
+           << "\"uuid\":\"" << uuid << "\","
+           << "\"mac\":\"10:ff:00:a3:01:0" << i << "\","
+           << "\"interface-name\":\"veth" << i << "\","
+           << "\"access-interface\":\"veth" << i << "-acc\","
+           << "\"endpoint-group\":\"/PolicyUniverse/PolicySpace/test/GbpEpGroup/epg/\""
+           << "}" << std::endl;
+        i++;
+    }
+
+    FSWatcher watcher;
+    FSEndpointSource source(&agent.getEndpointManager(), watcher,
+                             temp.string());
+    watcher.start();
+    EndpointManager& epMgr = agent.getEndpointManager();
+    WAIT_FOR(epMgr.getEndpoint(uuid1) && epMgr.getEndpoint(uuid2), 500);
+
+    const string cmd = "curl --proxy \"\" --compressed --silent http://127.0.0.1:9612/metrics 2>&1;";
+    opflexagent::EpCounters counters;
+    memset(&counters, 0, sizeof(counters));
+
+    // no metrics with zero counters
+    epMgr.updateEndpointCounters(uuid1, counters);
+    const string& output0 = BaseFixture::getOutputFromCommand(cmd);
+    BOOST_CHECK_NE(output0.find("opflex_endpoint_created_total 0"),
+                   std::string::npos);
+
+    counters.rxDrop = 5;
+    epMgr.updateEndpointCounters(uuid1, counters);
+    // over budget with fewer drops
+    counters.rxDrop = 1;
+    epMgr.updateEndpointCounters(uuid2, counters);
+    const string& output1 = BaseFixture::getOutputFromCommand(cmd);
+    BOOST_CHECK_NE(output1.find("opflex_endpoint_created_total 1"),
+                   std::string::npos);
+    BOOST_CHECK_NE(output1.find("name=\"veth0-acc\"} 5"),
+                   std::string::npos);
+    BOOST_CHECK_EQUAL(output1.find("veth1-acc"), std::string::npos);
+
+    // more drops replace the ep with the least drops
+    counters.rxDrop = 10;
+    epMgr.updateEndpointCounters(uuid2, counters);
+    const string& output2 = BaseFixture::getOutputFromCommand(cmd);
+    BOOST_CHECK_NE(output2.find("opflex_endpoint_created_total 2"),
+                   std::string::npos);
+    BOOST_CHECK_NE(output2.find("opflex_endpoint_removed_total 1"),
+                   std::string::npos);
+    BOOST_CHECK_NE(output2.find("name=\"veth1-acc\"} 10"),
+                   std::string::npos);
+    BOOST_CHECK_EQUAL(output2.find("veth0-acc"), std::string::npos);
+
+    watcher.stop();
+}
+
+BOOST_FIXTURE_TEST_CASE( epmetricduplicate, FSEndpointFixture ) {
+    const string uuid1 = "83f18f0b-80f7-46e2-b06c-4d9487b0c754";
+    const string uuid2 = "83f18f0b-80f7-46e2-b06c-4d9487b0c755";
+    auto writeEp = [this](const string& uuid, int i, const string& vmName) {
+        fs::ofstream os(temp / (uuid + ".ep"));
+        os << "{"
+           << "\"uuid\":\"" << uuid << "\","
+           << "\"mac\":\"10:ff:00:a3:01:0" << i << "\","
+           << "\"interface-name\":\"veth" << i << "\","
+           << "\"access-interface\":\"veth" << i << "-acc\","
+           << "\"endpoint-group\":\"/PolicyUniverse/PolicySpace/test/GbpEpGroup/epg/\"";
+        if (!vmName.empty())
+            os << ",\"attributes\":{\"vm-name\":\"" << vmName << "\"}";
+        os << "}" << std::endl;
+    };
+    writeEp(uuid1, 0, "pod");
+    writeEp(uuid2, 1, "");
+
+    FSWatcher watcher;
+    FSEndpointSource source(&agent.getEndpointManager(), watcher,
+                             temp.string());
+    watcher.start();
+    EndpointManager& epMgr = agent.getEndpointManager();
+    WAIT_FOR(epMgr.getEndpoint(uuid1) && epMgr.getEndpoint(uuid2), 500);
+
+    const string cmd = "curl --proxy \"\" --compressed --silent http://127.0.0.1:9612/metrics 2>&1;";
+    opflexagent::EpCounters counters;
+    memset(&counters, 0, sizeof(counters));
+    counters.rxPackets = 100;
+    epMgr.updateEndpointCounters(uuid1, counters);
+    counters.rxPackets = 200;
+    epMgr.updateEndpointCounters(uuid2, counters);
+    const string& output0 = BaseFixture::getOutputFromCommand(cmd);
+    BOOST_CHECK_NE(output0.find("opflex_endpoint_created_total 2"),
+                   std::string::npos);
+    BOOST_CHECK_NE(output0.find("opflex_endpoint_removed_total 0"),
+                   std::string::npos);
+    BOOST_CHECK_NE(output0.find("opflex_endpoint_rx_packets{name=\"pod\"} 100"),
+                   std::string::npos);
+
+    // the new labels of the second ep clash with those of the first,
+    // so its gauges go away and it counts as removed
+    writeEp(uuid2, 1, "pod");
+    WAIT_FOR(epMgr.getEndpoint(uuid2) &&
+             epMgr.getEndpoint(uuid2)->getAttributes().count("vm-name"), 500);
+    epMgr.updateEndpointCounters(uuid2, counters);
+    const string& output1 = BaseFixture::getOutputFromCommand(cmd);
+    BOOST_CHECK_NE(output1.find("opflex_endpoint_created_total 2"),
+                   std::string::npos);
+    BOOST_CHECK_NE(output1.find("opflex_endpoint_removed_total 1"),
+                   std::string::npos);
+    BOOST_CHECK_NE(output1.find("opflex_endpoint_rx_packets{name=\"pod\"} 100"),
+                   std::string::npos);
+    BOOST_CHECK_EQUAL(output1.find("veth1-acc"), std::string::npos);
+
+    // removing the ep later does not count it again
+    fs::remove(temp / (uuid2 + ".ep"));
+    WAIT_FOR(!epMgr.getEndpoint(uuid2), 500);
+    const string& output2 = BaseFixture::getOutputFromCommand(cmd);
+    BOOST_CHECK_NE(output2.find("opflex_endpoint_removed_total 1"),
+                   std::string::npos);
+
+    watcher.stop();
+}
+
 class MockEndpointListener : public EndpointListener {
 public:
     virtual void endpointUpdated(const std::string& uuid) {};
@@ -1103,6 +1377,72 @@ BOOST_FIXTURE_TEST_CASE( remoteEndpoint, BaseFixture ) {
     agent.getEndpointManager().unregisterListener(&listener);
 }
 
+BOOST_FIXTURE_TEST_CASE( remoteEndpointIndex, BaseFixture ) {
+    EndpointManager& epMgr = agent.getEndpointManager();
+    MockEndpointListener listener;
+    epMgr.registerListener(&listener);
+
+    Mutator m(framework, "policyreg");
+    auto universe = policy::Universe::resolve(framework).get();
+    auto space = universe->addPolicySpace("tenant0");
+    auto rd0 = space->addGbpRoutingDomain("rd0");
+    auto bd0 = space->addGbpBridgeDomain("bd0");
+    bd0->addGbpBridgeDomainToNetworkRSrc()
+        ->setTargetRoutingDomain(rd0->getURI());
+    auto epg0 = space->addGbpEpGroup("epg0");
+    epg0->addGbpEpGroupToNetworkRSrc()
+        ->setTargetBridgeDomain(bd0->getURI());
+    auto invu = modelgbp::inv::Universe::resolve(framework);
+    auto inv = invu.get()->addInvRemoteEndpointInventory();
+    auto rep1 = inv->addInvRemoteInventoryEp("ep1");
+    rep1->setMac(MAC("ab:cd:ef:ab:cd:ef"))
+        .setNextHopTunnel("5.6.7.8")
+        .addInvRemoteInventoryEpToGroupRSrc()
+        ->setTargetEpGroup(epg0->getURI());
+    rep1->addInvRemoteIp("10.1.0.0")->setPrefixLen(16);
+    auto rep2 = inv->addInvRemoteInventoryEp("ep2");
+    rep2->setMac(MAC("ab:cd:ef:ab:cd:ff"))
+        .setNextHopTunnel("5.6.7.9")
+        .addInvRemoteInventoryEpToGroupRSrc()
+        ->setTargetEpGroup(epg0->getURI());
+    rep2->addInvRemoteIp("10.1.1.5");
+    m.commit();
+
+    WAIT_FOR(agent.getPolicyManager().getRDForGroup(epg0->getURI()), 500);
+    WAIT_FOR(epMgr.findRemoteEndpoint(rd0->getURI(),
+                                      address::from_string("10.1.1.5")),
+             500);
+    BOOST_CHECK_EQUAL("ep2",
+                      epMgr.findRemoteEndpoint(rd0->getURI(),
+                          address::from_string("10.1.1.5")).get());
+    BOOST_CHECK_EQUAL("ep1",
+                      epMgr.findRemoteEndpoint(rd0->getURI(),
+                          address::from_string("10.1.2.3")).get());
+    BOOST_CHECK(!epMgr.findRemoteEndpoint(rd0->getURI(),
+                    address::from_string("10.2.0.1")));
+
+    // an update that changes nothing is not passed to the listeners
+    struct timespec ts;
+    ts.tv_sec = 0;
+    ts.tv_nsec = 100000000L;
+    nanosleep(&ts, NULL);
+    listener.clear();
+    rep1->setNextHopTunnel("5.6.7.8");
+    m.commit();
+    nanosleep(&ts, NULL);
+    BOOST_CHECK_EQUAL(0, listener.numUpdates());
+
+    // removing an endpoint removes its addresses
+    rep2->remove();
+    m.commit();
+    WAIT_FOR(epMgr.findRemoteEndpoint(rd0->getURI(),
+                                      address::from_string("10.1.1.5"))
+             .get_value_or("") == "ep1", 500);
+    BOOST_CHECK_EQUAL(1, listener.numUpdates());
+
+    epMgr.unregisterListener(&listener);
+}
+
 BOOST_FIXTURE_TEST_CASE( fsextsource, FSEndpointFixture ) {
 
     // check already existing
@@ -1366,6 +1706,42 @@ BOOST_FIXTURE_TEST_CASE( testotherparams, FSEndpointFixture ) {
     agent.stop();
 }
 
+BOOST_FIXTURE_TEST_CASE( fsunchanged, FSEndpointFixture ) {
+    const string uuid = "83f18f0b-80f7-46e2-b06c-4d9487b0c754";
+    fs::path path(temp / (uuid + ".ep"));
+    auto writeEp = [&](const string& iface) {
+        fs::ofstream os(path);
+        os << "{"
+           << "\"uuid\":\"" << uuid << "\","
+           << "\"mac\":\"10:ff:00:a3:01:00\","
+           << "\"interface-name\":\"" << iface << "\","
+           << "\"endpoint-group\":\"/PolicyUniverse/PolicySpace/test/GbpEpGroup/epg/\""
+           << "}" << std::endl;
+    };
+    writeEp("veth0");
+
+    FSWatcher watcher;
+    FSEndpointSource source(&agent.getEndpointManager(), watcher,
+                            temp.string());
+    EndpointManager& epMgr = agent.getEndpointManager();
+    source.updated(path);
+    std::shared_ptr<const Endpoint> ep = epMgr.getEndpoint(uuid);
+    BOOST_REQUIRE(ep);
+
+    // a file rewritten with the same contents is not applied again
+    writeEp("veth0");
+    source.updated(path);
+    BOOST_CHECK(epMgr.getEndpoint(uuid) == ep);
+
+    // a change of the same size is
+    writeEp("veth1");
+    source.updated(path);
+    std::shared_ptr<const Endpoint> changed = epMgr.getEndpoint(uuid);
+    BOOST_REQUIRE(changed);
+    BOOST_CHECK(changed != ep);
+    BOOST_CHECK_EQUAL("veth1", changed->getInterfaceName().get());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } /* namespace opflexagent */
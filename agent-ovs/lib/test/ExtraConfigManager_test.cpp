@@ -96,6 +96,51 @@ BOOST_FIXTURE_TEST_CASE( droplogconfigsource, FSConfigFixture ) {
     watcher.stop();
 }
 
+BOOST_FIXTURE_TEST_CASE( droplogsamplingconfigsource, FSConfigFixture ) {
+    using modelgbp::observer::DropLogConfig;
+    ExtraConfigManager& ecm = agent.getExtraConfigManager();
+    fs::path path(temp / "c.droplogcfg");
+    fs::ofstream os(path);
+    os << "{"
+       << "\"drop-log-enable\": true,\n"
+       << "\"drop-log-sampling\": {\n"
+       << "\"probability\": 0.01,\n"
+       << "\"tables\": {\"Int-POL_TABLE\": 0.5, \"Acc-OUT_TABLE\": 0}\n"
+       << "},\n"
+       << "\"drop-log-pruning\": {\n"
+       << "\"flt1\":{\"name\":\"flt1\",\"ip_proto\":6,\"sample\":0.1},\n"
+       << "\"flt2\":{\"name\":\"flt2\",\"ip_proto\":17,\"sample\":2}\n"
+       << "}\n"
+       << "}" << std::endl;
+    os.close();
+    FSWatcher watcher;
+    opflex::modb::URI uri =
+        opflex::modb::URIBuilder().addElement("PolicyUniverse")
+            .addElement("ObserverDropLogConfig").build();
+    FSPacketDropLogConfigSource source(&ecm, watcher, temp.string(), uri);
+    watcher.start();
+
+    WAIT_FOR(DropLogConfig::resolve(agent.getFramework(), uri), 500);
+    PacketDropLogSampling sampling = ecm.getPacketDropLogSampling();
+    BOOST_CHECK_EQUAL(0.01, sampling.getProbability("Int-PORT_SECURITY_TABLE"));
+    BOOST_CHECK_EQUAL(0.5, sampling.getProbability("Int-POL_TABLE"));
+    BOOST_CHECK_EQUAL(0, sampling.getProbability("Acc-OUT_TABLE"));
+
+    std::shared_ptr<PacketDropLogPruneSpec> pruneSpec;
+    WAIT_FOR(ecm.getPacketDropPruneSpec("flt1", pruneSpec), 500);
+    BOOST_REQUIRE(pruneSpec->sample);
+    BOOST_CHECK_EQUAL(0.1, pruneSpec->sample.get());
+    /* a probability out of range skips the filter */
+    BOOST_CHECK(!ecm.getPacketDropPruneSpec("flt2", pruneSpec));
+
+    /* every drop is logged again once the config is removed */
+    fs::remove(path);
+    WAIT_FOR(!(DropLogConfig::resolve(agent.getFramework(), uri)), 500);
+    BOOST_CHECK_EQUAL(1, ecm.getPacketDropLogSampling()
+                      .getProbability("Int-POL_TABLE"));
+    watcher.stop();
+}
+
 BOOST_FIXTURE_TEST_CASE( droplogpruneconfigsource, FSConfigFixture ) {
     using modelgbp::observer::DropLogConfig;
     using modelgbp::observer::DropLogModeEnumT;
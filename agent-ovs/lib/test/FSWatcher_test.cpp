@@ -0,0 +1,200 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Test suite for class FSWatcher
+ *
+ * Copyright (c) 2014 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/test/BaseFixture.h>
+#include <opflexagent/FSWatcher.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+
+namespace opflexagent {
+
+namespace fs = boost::filesystem;
+using std::string;
+
+/**
+ * Count the notifications for each file name
+ */
+class CountingWatcher : public FSWatcher::Watcher {
+public:
+    virtual void updated(const fs::path& filePath) {
+        std::lock_guard<std::mutex> guard(mutex);
+        updates[filePath.filename().string()] += 1;
+    }
+
+    virtual void deleted(const fs::path& filePath) {
+        std::lock_guard<std::mutex> guard(mutex);
+        deletes[filePath.filename().string()] += 1;
+    }
+
+    int getUpdates(const string& name) {
+        std::lock_guard<std::mutex> guard(mutex);
+        return updates[name];
+    }
+
+    int getDeletes(const string& name) {
+        std::lock_guard<std::mutex> guard(mutex);
+        return deletes[name];
+    }
+
+private:
+    std::mutex mutex;
+    std::map<string, int> updates;
+    std::map<string, int> deletes;
+};
+
+/**
+ * Count the notifications from a scan that loads the files on
+ * several threads, and the threads that delivered them
+ */
+class ConcurrentWatcher : public CountingWatcher {
+public:
+    virtual void updated(const fs::path& filePath) {
+        CountingWatcher::updated(filePath);
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            threads.insert(std::this_thread::get_id());
+        }
+        // slow enough that the scan threads share the files
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    virtual bool concurrentUpdates() const { return true; }
+
+    size_t getThreads() {
+        std::lock_guard<std::mutex> guard(mutex);
+        return threads.size();
+    }
+
+private:
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+};
+
+class FSWatcherFixture {
+public:
+    FSWatcherFixture()
+        : temp(fs::temp_directory_path() / fs::unique_path()) {
+        fs::create_directory(temp);
+        watcher.addWatch(temp.string(), counter);
+    }
+
+    ~FSWatcherFixture() {
+        watcher.stop();
+        fs::remove_all(temp);
+    }
+
+    void writeFile(const string& name, const string& content) {
+        fs::ofstream os(temp / name);
+        os << content;
+    }
+
+    fs::path temp;
+    CountingWatcher counter;
+    FSWatcher watcher;
+};
+
+BOOST_AUTO_TEST_SUITE(FSWatcher_test)
+
+BOOST_FIXTURE_TEST_CASE(debounce, FSWatcherFixture) {
+    watcher.setDebounce(200);
+    watcher.start();
+
+    // the writes fall in one window, so only the last is delivered
+    for (int i = 0; i < 5; ++i)
+        writeFile("a.ep", std::to_string(i));
+    WAIT_FOR(counter.getUpdates("a.ep") == 1, 2000);
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+    BOOST_CHECK_EQUAL(1, counter.getUpdates("a.ep"));
+
+    // a file written and removed in one window is only deleted
+    writeFile("b.ep", "b");
+    fs::remove(temp / "b.ep");
+    WAIT_FOR(counter.getDeletes("b.ep") == 1, 2000);
+    BOOST_CHECK_EQUAL(0, counter.getUpdates("b.ep"));
+}
+
+BOOST_FIXTURE_TEST_CASE(rescan, FSWatcherFixture) {
+    writeFile("same.ep", "same");
+    writeFile("changed.ep", "changed");
+    writeFile("gone.ep", "gone");
+    watcher.setDebounce(0);
+    watcher.start();
+    WAIT_FOR(counter.getUpdates("same.ep") == 1, 2000);
+    WAIT_FOR(counter.getUpdates("changed.ep") == 1, 2000);
+    WAIT_FOR(counter.getUpdates("gone.ep") == 1, 2000);
+
+    // change the files while no events are read, as when the kernel
+    // drops them
+    watcher.stop();
+    writeFile("changed.ep", "changed again");
+    fs::last_write_time(temp / "changed.ep",
+                        fs::last_write_time(temp / "changed.ep") + 10);
+    writeFile("new.ep", "new");
+    fs::remove(temp / "gone.ep");
+    watcher.setInitialScan(false);
+    watcher.start();
+
+    // only the differences from the files seen so far are reported
+    watcher.requestRescan();
+    WAIT_FOR(counter.getUpdates("changed.ep") == 2, 2000);
+    WAIT_FOR(counter.getUpdates("new.ep") == 1, 2000);
+    WAIT_FOR(counter.getDeletes("gone.ep") == 1, 2000);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    BOOST_CHECK_EQUAL(1, counter.getUpdates("same.ep"));
+    BOOST_CHECK_EQUAL(0, counter.getDeletes("same.ep"));
+}
+
+BOOST_FIXTURE_TEST_CASE(parallel_scan, FSWatcherFixture) {
+    static const int DIRS = 3;
+    static const int FILES = 20;
+    ConcurrentWatcher concurrent;
+    FSWatcher scanner;
+    for (int d = 0; d < DIRS; ++d) {
+        fs::path dir = temp / ("dir" + std::to_string(d));
+        fs::create_directory(dir);
+        for (int f = 0; f < FILES; ++f) {
+            string name = std::to_string(d) + "-" + std::to_string(f) + ".ep";
+            fs::ofstream os(dir / name);
+            os << name;
+        }
+        scanner.addWatch(dir.string(), concurrent);
+    }
+    scanner.setScanThreads(4);
+    scanner.start();
+
+    // every file in every directory is reported exactly once
+    for (int d = 0; d < DIRS; ++d) {
+        for (int f = 0; f < FILES; ++f) {
+            string name = std::to_string(d) + "-" + std::to_string(f) + ".ep";
+            WAIT_FOR(concurrent.getUpdates(name) == 1, 2000);
+        }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    for (int d = 0; d < DIRS; ++d) {
+        for (int f = 0; f < FILES; ++f) {
+            string name = std::to_string(d) + "-" + std::to_string(f) + ".ep";
+            BOOST_CHECK_EQUAL(1, concurrent.getUpdates(name));
+        }
+    }
+    BOOST_CHECK(concurrent.getThreads() > 1);
+    scanner.stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace opflexagent */
@@ -254,5 +254,59 @@ BOOST_FIXTURE_TEST_CASE( epPendingFaultCheck, FSFaultFixture ) {
    BOOST_CHECK_EQUAL(true, has_fault);
    watcher.stop();
 }
+static void writePlatformFault(const fs::path& path, const string& uuid) {
+    fs::ofstream os(path);
+    os << "{"
+       << "\"fault_uuid\":\"" << uuid << "\","
+       << "\"faultCode\":\"1\","
+       << "\"description\":\"Uplink down\","
+       << "\"severity\":\"major\""
+       << "}" << std::endl;
+}
+
+BOOST_FIXTURE_TEST_CASE( faultbatch, FSFaultFixture ) {
+    FSWatcher watcher;
+    FSFaultSource fu_source(&agent.getFaultManager(), watcher, temp.string(), agent);
+    auto fu_instance = modelgbp::fault::Universe::resolve(agent.getFramework());
+    BOOST_REQUIRE(fu_instance);
+
+    vector<string> uuids;
+    for (int i = 0; i < 5; i++)
+        uuids.push_back("83f18f0b-80f7-46e2-b06c-4d9487b0c754-b" +
+                        std::to_string(i));
+
+    // nothing is committed until the batch ends
+    fu_source.beginBatch();
+    for (const string& uuid : uuids) {
+        fs::path path(temp / (uuid + ".fs"));
+        writePlatformFault(path, uuid);
+        fu_source.updated(path);
+    }
+    BOOST_CHECK(!fu_instance.get()->resolveFaultInstance(uuids[0]));
+    fu_source.endBatch();
+    for (const string& uuid : uuids)
+        BOOST_CHECK(fu_instance.get()->resolveFaultInstance(uuid));
+
+    // a file that now describes another fault replaces it
+    fs::path path0(temp / (uuids[0] + ".fs"));
+    const string replaced = "83f18f0b-80f7-46e2-b06c-4d9487b0c754-b9";
+    writePlatformFault(path0, replaced);
+    fu_source.updated(path0);
+    BOOST_CHECK(!fu_instance.get()->resolveFaultInstance(uuids[0]));
+    BOOST_CHECK(fu_instance.get()->resolveFaultInstance(replaced));
+
+    fu_source.beginBatch();
+    for (const string& uuid : uuids) {
+        fs::path path(temp / (uuid + ".fs"));
+        fs::remove(path);
+        fu_source.deleted(path);
+    }
+    BOOST_CHECK(fu_instance.get()->resolveFaultInstance(uuids[1]));
+    fu_source.endBatch();
+    BOOST_CHECK(!fu_instance.get()->resolveFaultInstance(replaced));
+    for (const string& uuid : uuids)
+        BOOST_CHECK(!fu_instance.get()->resolveFaultInstance(uuid));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 } /* namespace opflexagent */ 
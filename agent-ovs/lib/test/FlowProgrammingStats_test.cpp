@@ -0,0 +1,59 @@
+/*
+ * Test suite for class FlowProgrammingStats
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/FlowProgrammingStats.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace opflexagent {
+
+BOOST_AUTO_TEST_SUITE(FlowProgrammingStats_test)
+
+BOOST_AUTO_TEST_CASE(bridge) {
+    FlowProgrammingStats stats;
+    auto br = stats.addBridge("br-int", 2);
+    BOOST_CHECK_EQUAL(2, br->getTableCount());
+
+    br->countEdits(1, 3, 1, 0, 3);
+    br->countEdits(1, 1, 0, 2, 2);
+    // out of range tables are ignored
+    br->countEdits(2, 1, 1, 1, 1);
+    BOOST_CHECK_EQUAL(0, br->get(0, FlowProgrammingStats::ADDS));
+    BOOST_CHECK_EQUAL(4, br->get(1, FlowProgrammingStats::ADDS));
+    BOOST_CHECK_EQUAL(1, br->get(1, FlowProgrammingStats::MODS));
+    BOOST_CHECK_EQUAL(2, br->get(1, FlowProgrammingStats::DELETES));
+    BOOST_CHECK_EQUAL(2, br->get(1, FlowProgrammingStats::FLOWS));
+
+    br->observeWrite(4, std::chrono::milliseconds(3));
+    br->observeWrite(200, std::chrono::milliseconds(0));
+    BOOST_CHECK_EQUAL(2, br->getEditSize().getCount());
+    BOOST_CHECK_EQUAL(204, br->getEditSize().getSum());
+    BOOST_CHECK_EQUAL(2, br->getBarrierLatency().getCount());
+    BOOST_CHECK_EQUAL(3, br->getBarrierLatency().getSum());
+
+    FlowProgrammingStats::bridge_map_t bridges;
+    stats.getBridges(bridges);
+    BOOST_REQUIRE_EQUAL(1, bridges.size());
+    BOOST_CHECK(bridges["br-int"] == br);
+
+    // a bridge added again starts over
+    auto br2 = stats.addBridge("br-int", 1);
+    stats.getBridges(bridges);
+    BOOST_CHECK(bridges["br-int"] == br2);
+    BOOST_CHECK_EQUAL(0, br2->get(0, FlowProgrammingStats::FLOWS));
+    BOOST_CHECK_EQUAL("deletes",
+                      std::string(FlowProgrammingStats::
+                                  getCounterName(FlowProgrammingStats::
+                                                 DELETES)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -0,0 +1,108 @@
+/*
+ * Test suite for class IdBitmap
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/IdBitmap.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdlib>
+#include <set>
+
+namespace opflexagent {
+
+BOOST_AUTO_TEST_SUITE(IdBitmap_test)
+
+BOOST_AUTO_TEST_CASE(basic) {
+    IdBitmap b(20);
+    BOOST_CHECK_EQUAL(20, b.size());
+    BOOST_CHECK_EQUAL(0, b.findFirstClear());
+    BOOST_CHECK_EQUAL(1, b.freeRangeCount());
+
+    for (uint64_t i = 0; i < 20; ++i) {
+        BOOST_CHECK_EQUAL(i, b.findFirstClear());
+        b.set(i);
+    }
+    BOOST_CHECK_EQUAL(20, b.count());
+    BOOST_CHECK_EQUAL(20, b.findFirstClear());
+    BOOST_CHECK_EQUAL(0, b.freeRangeCount());
+
+    b.clear(10);
+    b.clear(5);
+    b.clear(6);
+    BOOST_CHECK(!b.test(5));
+    BOOST_CHECK(b.test(7));
+    BOOST_CHECK_EQUAL(17, b.count());
+    BOOST_CHECK_EQUAL(5, b.findFirstClear());
+    BOOST_CHECK_EQUAL(2, b.freeRangeCount());
+
+    // setting or clearing twice changes nothing
+    b.set(5);
+    b.set(5);
+    b.clear(10);
+    BOOST_CHECK_EQUAL(18, b.count());
+    BOOST_CHECK_EQUAL(6, b.findFirstClear());
+
+    b.reset(20);
+    BOOST_CHECK_EQUAL(0, b.count());
+    BOOST_CHECK(!b.test(7));
+}
+
+BOOST_AUTO_TEST_CASE(large) {
+    // a range too big to allocate in full
+    IdBitmap b((uint64_t)1 << 31);
+    for (uint64_t i = 0; i < 64 * 64 + 1; ++i)
+        b.set(i);
+    BOOST_CHECK_EQUAL(64 * 64 + 1, b.findFirstClear());
+    BOOST_CHECK_EQUAL(1, b.freeRangeCount());
+
+    b.set(((uint64_t)1 << 31) - 1);
+    BOOST_CHECK_EQUAL(1, b.freeRangeCount());
+    b.clear(64 * 64 + 1);
+    b.clear(100);
+    BOOST_CHECK_EQUAL(100, b.findFirstClear());
+    BOOST_CHECK_EQUAL(2, b.freeRangeCount());
+}
+
+BOOST_AUTO_TEST_CASE(random) {
+    // compare with a set over a range spanning three levels
+    const uint64_t size = 64 * 64 * 3 + 17;
+    IdBitmap b(size);
+    std::set<uint64_t> used;
+    srand(42);
+    for (int i = 0; i < 100000; ++i) {
+        uint64_t index = rand() % size;
+        if (rand() % 3) {
+            b.set(index);
+            used.insert(index);
+        } else {
+            b.clear(index);
+            used.erase(index);
+        }
+        if (i % 97 == 0) {
+            uint64_t first = 0;
+            for (uint64_t u : used) {
+                if (u != first) break;
+                first += 1;
+            }
+            BOOST_CHECK_EQUAL(first, b.findFirstClear());
+            BOOST_CHECK_EQUAL(used.size(), b.count());
+        }
+    }
+
+    // fill the rest through the search
+    while (b.findFirstClear() < size)
+        b.set(b.findFirstClear());
+    BOOST_CHECK_EQUAL(size, b.count());
+    BOOST_CHECK_EQUAL(0, b.freeRangeCount());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -14,6 +14,7 @@
 #include <boost/test/unit_test.hpp>
 
 #include <cstdio>
+#include <fstream>
 #include <sstream>
 #include <thread>
 #include <chrono>
@@ -193,6 +194,45 @@ BOOST_AUTO_TEST_CASE(free_range) {
     BOOST_CHECK_EQUAL(5, idgen.getFreeRangeCount(nmspc));
 }
 
+BOOST_AUTO_TEST_CASE(free_hook) {
+    IdGenerator idgen(std::chrono::milliseconds(15));
+    string nmspc("idtest");
+    const string u1("/uri/one");
+    const string u2("/uri/two");
+    idgen.initNamespace(nmspc, 1, 2);
+
+    vector<uint32_t> freed;
+    IdGenerator::free_hook_t hook =
+        [&freed](const std::string&, uint32_t id) {
+            freed.push_back(id);
+            return false;
+        };
+    idgen.setFreeHook(nmspc, hook);
+
+    BOOST_CHECK_EQUAL(1, idgen.getId(nmspc, u1));
+    BOOST_CHECK_EQUAL(2, idgen.getId(nmspc, u2));
+    idgen.erase(nmspc, u1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    idgen.cleanup();
+
+    // the freed ID stays reserved until it is released
+    BOOST_REQUIRE_EQUAL(1, freed.size());
+    BOOST_CHECK_EQUAL(1, freed[0]);
+    BOOST_CHECK(!idgen.getStringForId(nmspc, 1));
+    BOOST_CHECK_EQUAL(0, idgen.getRemainingIds(nmspc));
+    BOOST_CHECK_EQUAL(-1, idgen.getId(nmspc, u1));
+    BOOST_CHECK(idgen.isIdUsed(nmspc, 1));
+
+    // an ID in use is not released
+    idgen.releaseId(nmspc, 2);
+    BOOST_CHECK_EQUAL(0, idgen.getRemainingIds(nmspc));
+
+    idgen.releaseId(nmspc, 1);
+    BOOST_CHECK(!idgen.isIdUsed(nmspc, 1));
+    BOOST_CHECK_EQUAL(1, idgen.getRemainingIds(nmspc));
+    BOOST_CHECK_EQUAL(1, idgen.getId(nmspc, u1));
+}
+
 BOOST_AUTO_TEST_CASE(persist_range) {
     string dir(".");
     string nmspc("idtest");
@@ -305,4 +345,122 @@ BOOST_AUTO_TEST_CASE(persist_range) {
 
 }
 
+BOOST_AUTO_TEST_CASE(journal) {
+    string dir(".");
+    string nmspc("idjournal");
+
+    {
+        // a file in the original format, holding only assignments
+        IdGenerator idgen;
+        idgen.setPersistLocation(dir);
+        std::ofstream file(idgen.getNamespaceFile(nmspc).c_str(),
+                           std::ios_base::binary);
+        uint32_t version = 1;
+        file.write("opflexid", 8);
+        file.write((const char*)&version, sizeof(version));
+        for (uint32_t id = 1; id <= 2; id++) {
+            string str = "/uri/" + std::to_string(id);
+            uint16_t len = str.size();
+            file.write((const char*)&id, sizeof(id));
+            file.write((const char*)&len, sizeof(len));
+            file.write(str.data(), len);
+        }
+    }
+
+    {
+        IdGenerator idgen(std::chrono::milliseconds(0));
+        idgen.setPersistLocation(dir);
+        idgen.setJournal(true);
+        idgen.initNamespace(nmspc, 1, 100);
+        BOOST_CHECK_EQUAL(1, idgen.getId(nmspc, "/uri/1"));
+        BOOST_CHECK_EQUAL(2, idgen.getId(nmspc, "/uri/2"));
+
+        // enough churn to rewrite the file several times
+        for (int i = 0; i < 3000; i++) {
+            string str = "/churn/" + std::to_string(i);
+            BOOST_CHECK_EQUAL(3, idgen.getId(nmspc, str));
+            idgen.erase(nmspc, str);
+            std::this_thread::sleep_for(std::chrono::microseconds(1));
+            idgen.cleanup();
+        }
+        // the 6000 records appended were compacted along the way
+        std::ifstream file(idgen.getNamespaceFile(nmspc).c_str(),
+                           std::ios_base::binary | std::ios_base::ate);
+        BOOST_CHECK(file.tellg() < 1100 * 20);
+
+        BOOST_CHECK_EQUAL(3, idgen.getId(nmspc, "/uri/3"));
+        idgen.erase(nmspc, "/uri/1");
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        idgen.cleanup();
+    }
+
+    {
+        IdGenerator idgen;
+        idgen.setPersistLocation(dir);
+        idgen.initNamespace(nmspc, 1, 100);
+        BOOST_CHECK(!idgen.getStringForId(nmspc, 1));
+        BOOST_CHECK_EQUAL("/uri/2", idgen.getStringForId(nmspc, 2).get());
+        BOOST_CHECK_EQUAL("/uri/3", idgen.getStringForId(nmspc, 3).get());
+        BOOST_CHECK_EQUAL(98, idgen.getRemainingIds(nmspc));
+        BOOST_CHECK_EQUAL(1, idgen.getId(nmspc, "/uri/4"));
+
+        if (!remove(idgen.getNamespaceFile(nmspc).c_str()))
+            LOG(ERROR) << "unable to remove " << idgen.getNamespaceFile(nmspc);
+    }
+}
+
+static uint32_t fileVersion(const string& fname) {
+    std::ifstream file(fname.c_str(), std::ios_base::binary);
+    char magic[8];
+    uint32_t version = 0;
+    file.read(magic, sizeof(magic));
+    file.read((char*)&version, sizeof(version));
+    return version;
+}
+
+BOOST_AUTO_TEST_CASE(format_version) {
+    string dir(".");
+    string nmspc("idformat");
+
+    {
+        // without the journal, the file stays readable by older
+        // agents
+        IdGenerator idgen(std::chrono::milliseconds(0));
+        idgen.setPersistLocation(dir);
+        idgen.initNamespace(nmspc, 1, 100);
+        BOOST_CHECK_EQUAL(1, idgen.getId(nmspc, "/uri/1"));
+        BOOST_CHECK_EQUAL(2, idgen.getId(nmspc, "/uri/2"));
+        idgen.erase(nmspc, "/uri/1");
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        idgen.cleanup();
+        BOOST_CHECK_EQUAL(3, idgen.getId(nmspc, "/uri/3"));
+        BOOST_CHECK_EQUAL(1, fileVersion(idgen.getNamespaceFile(nmspc)));
+    }
+
+    {
+        // enabling the journal converts the file when it is loaded
+        IdGenerator idgen;
+        idgen.setPersistLocation(dir);
+        idgen.setJournal(true);
+        idgen.initNamespace(nmspc, 1, 100);
+        BOOST_CHECK(!idgen.getStringForId(nmspc, 1));
+        BOOST_CHECK_EQUAL(2, idgen.getId(nmspc, "/uri/2"));
+        BOOST_CHECK_EQUAL(3, idgen.getId(nmspc, "/uri/3"));
+        BOOST_CHECK_EQUAL(2, fileVersion(idgen.getNamespaceFile(nmspc)));
+    }
+
+    {
+        // and disabling it converts the file back
+        IdGenerator idgen;
+        idgen.setPersistLocation(dir);
+        idgen.initNamespace(nmspc, 1, 100);
+        BOOST_CHECK_EQUAL(2, idgen.getId(nmspc, "/uri/2"));
+        BOOST_CHECK_EQUAL(3, idgen.getId(nmspc, "/uri/3"));
+        BOOST_CHECK_EQUAL(1, fileVersion(idgen.getNamespaceFile(nmspc)));
+
+        if (!remove(idgen.getNamespaceFile(nmspc).c_str()))
+            LOG(ERROR) << "unable to remove " << idgen.getNamespaceFile(nmspc);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,73 @@
+/*
+ * Test suite for class Interner
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/Interner.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+
+namespace opflexagent {
+
+BOOST_AUTO_TEST_SUITE(Interner_test)
+
+BOOST_AUTO_TEST_CASE(share) {
+    Interner<std::string> interner;
+    std::shared_ptr<const std::string> a = interner.intern("value");
+    std::shared_ptr<const std::string> b = interner.intern(std::string("value"));
+    std::shared_ptr<const std::string> c = interner.intern("other");
+
+    BOOST_CHECK(a == b);
+    BOOST_CHECK(a != c);
+    BOOST_CHECK_EQUAL("value", *a);
+    BOOST_CHECK_EQUAL("other", *c);
+    BOOST_CHECK_EQUAL(2, interner.size());
+}
+
+BOOST_AUTO_TEST_CASE(release) {
+    Interner<std::string> interner;
+    {
+        std::shared_ptr<const std::string> a = interner.intern("value");
+        BOOST_CHECK_EQUAL(1, a.use_count());
+    }
+    // the freed value is replaced when it is looked up again
+    std::shared_ptr<const std::string> b = interner.intern("value");
+    BOOST_CHECK_EQUAL(1, interner.size());
+
+    // freed values are swept as the table grows
+    for (int i = 0; i < 1000; ++i)
+        interner.intern(std::to_string(i));
+    BOOST_CHECK(interner.size() < 200);
+    BOOST_CHECK(b == interner.intern("value"));
+}
+
+// a hash with collisions so that equal hashes are told apart
+struct FirstCharHash {
+    size_t operator()(const std::string& s) const {
+        return s.empty() ? 0 : s[0];
+    }
+};
+
+BOOST_AUTO_TEST_CASE(collision) {
+    Interner<std::string, FirstCharHash> interner;
+    std::vector<std::shared_ptr<const std::string> > held;
+    held.push_back(interner.intern("abc"));
+    held.push_back(interner.intern("abd"));
+    held.push_back(interner.intern("abc"));
+
+    BOOST_CHECK(held[0] == held[2]);
+    BOOST_CHECK(held[0] != held[1]);
+    BOOST_CHECK_EQUAL("abd", *held[1]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
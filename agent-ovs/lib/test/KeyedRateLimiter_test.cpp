@@ -13,8 +13,10 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <atomic>
 #include <thread>
 #include <chrono>
+#include <vector>
 
 namespace opflexagent {
 
@@ -33,6 +35,69 @@ BOOST_AUTO_TEST_CASE(limit) {
     BOOST_CHECK(l.event("test"));
 }
 
+BOOST_AUTO_TEST_CASE(sharded) {
+    ShardedKeyedRateLimiter<std::string, 5, 10> l;
+    BOOST_CHECK(l.event("test"));
+    BOOST_CHECK_EQUAL(false, l.event("test"));
+    BOOST_CHECK(l.event("other"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    BOOST_CHECK_EQUAL(false, l.event("test"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    BOOST_CHECK(l.event("test"));
+
+    l.clear();
+    BOOST_CHECK(l.event("other"));
+}
+
+BOOST_AUTO_TEST_CASE(overflow) {
+    // past the exact keys, keys are remembered approximately
+    ShardedKeyedRateLimiter<int, 3, 5000, 2, 16> l;
+    int passed = 0;
+    for (int i = 0; i < 200; ++i) {
+        if (l.event(i)) passed += 1;
+    }
+    BOOST_CHECK(passed > 150);
+    for (int i = 0; i < 200; ++i)
+        BOOST_CHECK_EQUAL(false, l.event(i));
+}
+
+BOOST_AUTO_TEST_CASE(threads) {
+    ShardedKeyedRateLimiter<int, 3, 5000> l;
+    std::atomic<int> passed(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&l, &passed]() {
+                for (int i = 0; i < 10000; ++i) {
+                    if (l.event(i)) passed += 1;
+                }
+            });
+    }
+    for (auto& t : threads)
+        t.join();
+    BOOST_CHECK_EQUAL(10000, passed);
+}
+
+BOOST_AUTO_TEST_CASE(token_bucket) {
+    TokenBucket unlimited;
+    for (int i = 0; i < 100; ++i)
+        BOOST_CHECK(unlimited.event());
+
+    TokenBucket b(20, 2);
+    BOOST_CHECK(b.event());
+    BOOST_CHECK(b.event());
+    BOOST_CHECK_EQUAL(false, b.event());
+    // one token every 50 ms
+    std::this_thread::sleep_for(std::chrono::milliseconds(70));
+    BOOST_CHECK(b.event());
+    BOOST_CHECK_EQUAL(false, b.event());
+
+    // the bucket holds no more than the burst
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    BOOST_CHECK(b.event());
+    BOOST_CHECK(b.event());
+    BOOST_CHECK_EQUAL(false, b.event());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }
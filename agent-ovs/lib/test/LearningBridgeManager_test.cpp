@@ -232,6 +232,62 @@ BOOST_FIXTURE_TEST_CASE( vlans, LBFixture ) {
     }
 }
 
+BOOST_FIXTURE_TEST_CASE( vlanupdate, LBFixture ) {
+    typedef LearningBridgeIface::vlan_range_t vlan_range_t;
+    LearningBridgeManager& lbMgr = agent.getLearningBridgeManager();
+    auto ranges = [&lbMgr]() {
+        range_set_t r;
+        lbMgr.forEachVlanRange([&r](vlan_range_t range,
+                                    const std::unordered_set<std::string>&) {
+                                   r.insert(range);
+                               });
+        return r;
+    };
+
+    MockLBListener listener;
+    lbMgr.registerListener(&listener);
+
+    LearningBridgeIface a;
+    a.setUUID("a");
+    a.setInterfaceName("veth0");
+    a.addTrunkVlans({10,100});
+    lbSource.updateLBIface(a);
+    LearningBridgeIface b;
+    b.setUUID("b");
+    b.addTrunkVlans({50,60});
+    lbSource.updateLBIface(b);
+    BOOST_CHECK(range_set_t({{10,49}, {50,60}, {61,100}}) == ranges());
+    listener.clear();
+
+    // only the VLANs that were removed are touched
+    a.setTrunkVlans({{10,80}});
+    lbSource.updateLBIface(a);
+    listener.logUpdates();
+    BOOST_CHECK(range_set_t({{61,100}, {61,80}, {81,100}}) ==
+                listener.getVlanUpdates());
+    BOOST_CHECK(range_set_t({{10,49}, {50,60}, {61,80}}) == ranges());
+    listener.clear();
+
+    // overlapping ranges in an update are the same VLANs
+    a.setTrunkVlans({{10,40}, {30,80}});
+    lbSource.updateLBIface(a);
+    BOOST_CHECK(listener.getVlanUpdates().empty());
+    listener.clear();
+
+    // a new interface name changes the flows for all its ranges
+    a.setInterfaceName("veth1");
+    lbSource.updateLBIface(a);
+    BOOST_CHECK(range_set_t({{10,49}, {50,60}, {61,80}}) ==
+                listener.getVlanUpdates());
+    listener.clear();
+
+    range_set_t bRanges;
+    lbMgr.getVlanRangesByIface("b", bRanges);
+    BOOST_CHECK(range_set_t({{50,60}}) == bRanges);
+
+    lbMgr.unregisterListener(&listener);
+}
+
 BOOST_FIXTURE_TEST_CASE( fssource, FSLBFixture ) {
     // check already existing
     {
@@ -0,0 +1,99 @@
+/*
+ * Test suite for class MPSCQueue
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/MPSCQueue.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace opflexagent {
+
+BOOST_AUTO_TEST_SUITE(MPSCQueue_test)
+
+struct Node {
+    Node(int producer_, int value_)
+        : producer(producer_), value(value_), next(NULL) {}
+
+    int producer;
+    int value;
+    Node* next;
+};
+
+BOOST_AUTO_TEST_CASE(order) {
+    MPSCQueue<Node> queue;
+    BOOST_CHECK(queue.drain() == NULL);
+
+    BOOST_CHECK(queue.push(new Node(0, 1)));
+    BOOST_CHECK(!queue.push(new Node(0, 2)));
+    BOOST_CHECK(!queue.push(new Node(0, 3)));
+
+    std::vector<int> values;
+    Node* node = queue.drain();
+    while (node) {
+        values.push_back(node->value);
+        Node* next = node->next;
+        delete node;
+        node = next;
+    }
+    BOOST_CHECK((std::vector<int>{1, 2, 3}) == values);
+
+    // empty again after a drain
+    BOOST_CHECK(queue.push(new Node(0, 4)));
+}
+
+BOOST_AUTO_TEST_CASE(producers) {
+    const int PRODUCERS = 4;
+    const int COUNT = 20000;
+    MPSCQueue<Node> queue;
+    std::atomic<int> wakeups(0);
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < PRODUCERS; ++p) {
+        threads.emplace_back([&, p]() {
+                for (int i = 0; i < COUNT; ++i) {
+                    if (queue.push(new Node(p, i)))
+                        wakeups++;
+                }
+            });
+    }
+
+    // every producer's nodes come out in the order it pushed them
+    std::vector<int> last(PRODUCERS, -1);
+    int received = 0;
+    int batches = 0;
+    bool ordered = true;
+    while (received < PRODUCERS * COUNT) {
+        Node* node = queue.drain();
+        if (node) batches++;
+        while (node) {
+            if (node->value != last[node->producer] + 1)
+                ordered = false;
+            last[node->producer] = node->value;
+            received++;
+            Node* next = node->next;
+            delete node;
+            node = next;
+        }
+    }
+    for (auto& t : threads)
+        t.join();
+
+    BOOST_CHECK(ordered);
+    BOOST_CHECK_EQUAL(PRODUCERS * COUNT, received);
+    // one wakeup for each batch drained
+    BOOST_CHECK_EQUAL(batches, wakeups.load());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -0,0 +1,137 @@
+/*
+ * Test suite for the MulticastGroupJournal classes
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/MulticastGroupJournal.h>
+#include <opflexagent/test/BaseFixture.h>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <fstream>
+
+namespace opflexagent {
+
+using std::string;
+using std::vector;
+using std::unordered_set;
+namespace fs = boost::filesystem;
+
+BOOST_AUTO_TEST_SUITE(MulticastGroupJournal_test)
+
+static vector<string> sorted(vector<string> v) {
+    std::sort(v.begin(), v.end());
+    return v;
+}
+
+#define CHECK_GROUPS(actual, ...)                                       \
+    {                                                                   \
+        vector<string> expected({__VA_ARGS__});                         \
+        vector<string> a = sorted(actual);                              \
+        BOOST_CHECK_EQUAL_COLLECTIONS(a.begin(), a.end(),               \
+                                      expected.begin(), expected.end()); \
+    }
+
+BOOST_AUTO_TEST_CASE(journal) {
+    TempGuard tg;
+    string path = (tg.temp_dir / "mcast.json").string();
+    string journalPath = MulticastGroupJournal::getJournalPath(path);
+
+    MulticastGroupWriter writer(path);
+    writer.setJournal(true);
+    writer.setMinJournalLines(4);
+    MulticastGroupReader reader(path);
+    vector<string> joins, leaves;
+
+    // the first write is a snapshot
+    BOOST_REQUIRE(writer.write({"224.1.1.1", "224.1.1.2"}));
+    BOOST_CHECK(fs::exists(path));
+    BOOST_CHECK_EQUAL(0, fs::file_size(journalPath));
+    reader.readSnapshot(joins, leaves);
+    CHECK_GROUPS(joins, "224.1.1.1", "224.1.1.2");
+    CHECK_GROUPS(leaves);
+
+    // changes are appended to the journal
+    uint64_t gen = writer.getGeneration();
+    BOOST_REQUIRE(writer.write({"224.1.1.1", "224.1.1.3"}));
+    BOOST_CHECK_EQUAL(gen, writer.getGeneration());
+    joins.clear();
+    reader.readJournal(joins, leaves);
+    CHECK_GROUPS(joins, "224.1.1.3");
+    CHECK_GROUPS(leaves, "224.1.1.2");
+
+    // a reader starting late reads the snapshot and the journal
+    {
+        MulticastGroupReader late(path);
+        vector<string> j, l;
+        late.readSnapshot(j, l);
+        CHECK_GROUPS(j, "224.1.1.1", "224.1.1.3");
+        CHECK_GROUPS(l);
+    }
+
+    // a partial line is left for the next read
+    {
+        std::ofstream out(journalPath, std::ios::app);
+        out << gen << " +224.1.1.4";
+    }
+    joins.clear(); leaves.clear();
+    reader.readJournal(joins, leaves);
+    CHECK_GROUPS(joins);
+    {
+        std::ofstream out(journalPath, std::ios::app);
+        out << "\n" << gen << " -224.1.1.4\n" << (gen - 1) << " +224.1.1.5\n";
+    }
+    reader.readJournal(joins, leaves);
+    CHECK_GROUPS(joins);
+    CHECK_GROUPS(leaves);
+
+    // a journal grown past the snapshot is compacted
+    BOOST_REQUIRE(writer.write({"224.1.1.6", "224.1.1.7"}));
+    BOOST_CHECK_EQUAL(gen + 1, writer.getGeneration());
+    BOOST_CHECK_EQUAL(0, fs::file_size(journalPath));
+    reader.readJournal(joins, leaves);
+    CHECK_GROUPS(joins);
+    reader.readSnapshot(joins, leaves);
+    CHECK_GROUPS(joins, "224.1.1.6", "224.1.1.7");
+    CHECK_GROUPS(leaves, "224.1.1.1", "224.1.1.3");
+
+    // a new journal is read from its start
+    BOOST_REQUIRE(writer.write({"224.1.1.6"}));
+    joins.clear(); leaves.clear();
+    reader.readJournal(joins, leaves);
+    CHECK_GROUPS(joins);
+    CHECK_GROUPS(leaves, "224.1.1.7");
+    BOOST_CHECK_EQUAL(1, reader.getGroups().size());
+
+    leaves.clear();
+    reader.clear(leaves);
+    CHECK_GROUPS(leaves, "224.1.1.6");
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_only) {
+    TempGuard tg;
+    string path = (tg.temp_dir / "mcast.json").string();
+
+    MulticastGroupWriter writer(path);
+    BOOST_REQUIRE(writer.write({"224.1.1.1"}));
+    uint64_t gen = writer.getGeneration();
+    BOOST_REQUIRE(writer.write({"224.1.1.2"}));
+    BOOST_CHECK_EQUAL(gen + 1, writer.getGeneration());
+    BOOST_CHECK(!fs::exists(MulticastGroupJournal::getJournalPath(path)));
+
+    MulticastGroupReader reader(path);
+    vector<string> joins, leaves;
+    reader.readSnapshot(joins, leaves);
+    CHECK_GROUPS(joins, "224.1.1.2");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -156,4 +156,62 @@ BOOST_AUTO_TEST_CASE(test_solicited_node) {
 #undef cni
 }
 
+static void add_prefix(prefix_actions_t& prefixes,
+                       const std::string& cidrStr, uint32_t action) {
+    cidr_t cidr;
+    BOOST_REQUIRE(cidr_from_string(cidrStr, cidr));
+    prefixes[cidr] = action;
+}
+
+static bool has_prefix(const prefix_actions_t& prefixes,
+                       const std::string& cidrStr, uint32_t action) {
+    cidr_t cidr;
+    BOOST_REQUIRE(cidr_from_string(cidrStr, cidr));
+    auto it = prefixes.find(cidr);
+    return it != prefixes.end() && it->second == action;
+}
+
+BOOST_AUTO_TEST_CASE(test_aggregate_prefixes) {
+    prefix_actions_t prefixes;
+    // covered by a prefix with the same action
+    add_prefix(prefixes, "10.0.0.0/8", 1);
+    add_prefix(prefixes, "10.1.0.0/16", 1);
+    add_prefix(prefixes, "10.1.2.0/24", 2);
+    add_prefix(prefixes, "10.1.2.128/25", 1);
+    // siblings merging up twice
+    add_prefix(prefixes, "192.168.0.0/24", 3);
+    add_prefix(prefixes, "192.168.1.0/24", 3);
+    add_prefix(prefixes, "192.168.2.0/23", 3);
+    // siblings with different actions
+    add_prefix(prefixes, "172.16.0.0/24", 3);
+    add_prefix(prefixes, "172.16.1.0/24", 4);
+    // the same bits in another family
+    add_prefix(prefixes, "a00::/8", 1);
+    add_prefix(prefixes, "a00::/9", 1);
+    add_prefix(prefixes, "a80::/9", 2);
+    add_prefix(prefixes, "b00::/9", 2);
+    add_prefix(prefixes, "b80::/9", 2);
+
+    aggregate_prefixes(prefixes);
+    BOOST_CHECK_EQUAL(9, prefixes.size());
+    BOOST_CHECK(has_prefix(prefixes, "10.0.0.0/8", 1));
+    BOOST_CHECK(has_prefix(prefixes, "10.1.2.0/24", 2));
+    BOOST_CHECK(has_prefix(prefixes, "10.1.2.128/25", 1));
+    BOOST_CHECK(has_prefix(prefixes, "192.168.0.0/22", 3));
+    BOOST_CHECK(has_prefix(prefixes, "172.16.0.0/24", 3));
+    BOOST_CHECK(has_prefix(prefixes, "172.16.1.0/24", 4));
+    BOOST_CHECK(has_prefix(prefixes, "a00::/8", 1));
+    BOOST_CHECK(has_prefix(prefixes, "a80::/9", 2));
+    BOOST_CHECK(has_prefix(prefixes, "b00::/8", 2));
+
+    // a parent hidden by its halves takes their action
+    prefixes.clear();
+    add_prefix(prefixes, "10.0.0.0/23", 1);
+    add_prefix(prefixes, "10.0.0.0/24", 2);
+    add_prefix(prefixes, "10.0.1.5/24", 2);
+    aggregate_prefixes(prefixes);
+    BOOST_CHECK_EQUAL(1, prefixes.size());
+    BOOST_CHECK(has_prefix(prefixes, "10.0.0.0/23", 2));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
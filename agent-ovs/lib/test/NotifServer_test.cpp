@@ -22,7 +22,9 @@
 
 #include <opflex/modb/MAC.h>
 
+#include <chrono>
 #include <cstdio>
+#include <thread>
 
 namespace opflexagent {
 
@@ -38,10 +40,11 @@ static const std::string SOCK_NAME("/tmp/notif_test.sock");
 
 class NotifFixture {
 public:
-    NotifFixture() : notif(io) {
+    NotifFixture(size_t maxQueued = 256) : notif(io) {
         if (!std::remove(SOCK_NAME.c_str()))
             LOG(ERROR) << "unable to remove " << SOCK_NAME;
         notif.setSocketName(SOCK_NAME);
+        notif.setMaxQueued(maxQueued);
         notif.start();
         io_service_thread.reset(new std::thread([this]() { io.run(); }));
     }
@@ -62,6 +65,11 @@ public:
     std::unique_ptr<std::thread> io_service_thread;
 };
 
+class SmallQueueFixture : public NotifFixture {
+public:
+    SmallQueueFixture() : NotifFixture(4) {}
+};
+
 void readMessage(stream_protocol::socket& s, Document& result) {
     uint32_t rsize;
     (void)ba::read(s, ba::buffer(&rsize, 4));
@@ -75,16 +83,7 @@ void readMessage(stream_protocol::socket& s, Document& result) {
 
 }
 
-BOOST_FIXTURE_TEST_CASE(subscribe, NotifFixture) {
-
-    struct stat buffer;
-    WAIT_FOR(stat(SOCK_NAME.c_str(), &buffer) == 0, 500);
-
-    LOG(INFO) << "Connecting";
-
-    stream_protocol::socket s(io);
-    s.connect(stream_protocol::endpoint(SOCK_NAME));
-
+static void sendSubscribe(stream_protocol::socket& s) {
     StringBuffer r;
     Writer<StringBuffer> writer(r);
     writer.StartObject();
@@ -104,9 +103,26 @@ BOOST_FIXTURE_TEST_CASE(subscribe, NotifFixture) {
     uint32_t size = htonl(r.GetSize());
     ba::write(s, ba::buffer(&size, 4));
     ba::write(s, ba::buffer(r.GetString(), r.GetSize()));
+}
+
+static void subscribe(stream_protocol::socket& s) {
+    sendSubscribe(s);
 
     Document rdoc;
     readMessage(s, rdoc);
+    BOOST_CHECK(rdoc.HasMember("result"));
+}
+
+BOOST_FIXTURE_TEST_CASE(subscribe, NotifFixture) {
+
+    struct stat buffer;
+    WAIT_FOR(stat(SOCK_NAME.c_str(), &buffer) == 0, 500);
+
+    LOG(INFO) << "Connecting";
+
+    stream_protocol::socket s(io);
+    s.connect(stream_protocol::endpoint(SOCK_NAME));
+    subscribe(s);
 
     {
         std::unordered_set<std::string> uuids;
@@ -152,6 +168,61 @@ BOOST_FIXTURE_TEST_CASE(subscribe, NotifFixture) {
     BOOST_CHECK(us.find("1cc9483a-8d7a-48d5-9c23-862401691e01") != us.end());
 }
 
+BOOST_FIXTURE_TEST_CASE(slowconsumer, SmallQueueFixture) {
+    struct stat buffer;
+    WAIT_FOR(stat(SOCK_NAME.c_str(), &buffer) == 0, 500);
+
+    // one listener never reads, the other reads everything
+    stream_protocol::socket slow(io);
+    slow.connect(stream_protocol::endpoint(SOCK_NAME));
+    subscribe(slow);
+    stream_protocol::socket fast(io);
+    fast.connect(stream_protocol::endpoint(SOCK_NAME));
+    subscribe(fast);
+
+    std::unordered_set<std::string> uuids;
+    uuids.insert("4412dcd2-0cd0-4741-99d1-d8b3946e1fa9");
+    opflex::modb::MAC mac("11:22:33:44:55:66");
+    std::string last;
+    std::thread reader([&fast, &last]() {
+            Document n;
+            while (last != "10.0.100.0") {
+                readMessage(fast, n);
+                if (n.HasMember("params") && n["params"].IsObject() &&
+                    n["params"].HasMember("ip"))
+                    last = n["params"]["ip"].GetString();
+            }
+        });
+    for (int i = 0; i <= 100; ++i) {
+        for (int j = 0; j < (i == 100 ? 1 : 100); ++j) {
+            notif.dispatchVirtualIp(uuids, mac,
+                                    "10.0." + std::to_string(i) + "." +
+                                    std::to_string(j));
+        }
+        // let the fast listener keep up
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    reader.join();
+    BOOST_CHECK_EQUAL("10.0.100.0", last);
+
+    std::unordered_map<std::string, uint64_t> counts;
+    WAIT_FOR_DO(counts["dropped"] > 0, 500, notif.getStats(counts));
+    BOOST_CHECK(counts["slow-consumers"] >= 1);
+    BOOST_CHECK_EQUAL(2, counts["sessions"]);
+
+    // a repeated notification replaces the one still queued
+    notif.dispatchVirtualIp(uuids, mac, "10.0.100.1");
+    notif.dispatchVirtualIp(uuids, mac, "10.0.100.1");
+    WAIT_FOR_DO(counts["coalesced"] > 0, 500, notif.getStats(counts));
+
+    // replies are bounded by the same queue
+    uint64_t dropped = counts["dropped"];
+    for (int i = 0; i < 10; ++i)
+        sendSubscribe(slow);
+    WAIT_FOR_DO(counts["dropped"] >= dropped + 10, 500,
+                notif.getStats(counts));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }
@@ -266,6 +266,32 @@ public:
         onUpdate(contractURI);
     }
 
+    void contractDeltaUpdated(const opflex::modb::URI& contractURI,
+                              const ContractDelta& delta) {
+        {
+            lock_guard<mutex> guard(notifMutex);
+            ContractDelta::uri_set_t& groups = deltaGroups[contractURI];
+            delta.getChangedGroups(groups);
+            if (delta.rulesChanged())
+                rulesChanged.insert(contractURI);
+        }
+        onUpdate(contractURI);
+    }
+
+    void secGroupDeltaUpdated(const opflex::modb::URI& secGroupURI,
+                              const SecGroupDelta& delta) {
+        {
+            lock_guard<mutex> guard(notifMutex);
+            for (const auto& r : delta.rulesAdded)
+                secGrpRulesAdded[secGroupURI]
+                    .insert(r->getL24Classifier()->getURI());
+            for (const auto& r : delta.rulesRemoved)
+                secGrpRulesRemoved[secGroupURI]
+                    .insert(r->getL24Classifier()->getURI());
+        }
+        onUpdate(secGroupURI);
+    }
+
     void configUpdated(const opflex::modb::URI& configURI) {
          onUpdate(configURI);
     }
@@ -279,9 +305,31 @@ public:
         return notifRcvd.find(uri) != notifRcvd.end();
     }
 
+    bool hasDeltaGroup(const URI& uri, const URI& groupUri) {
+        lock_guard<mutex> guard(notifMutex);
+        auto it = deltaGroups.find(uri);
+        return it != deltaGroups.end() && it->second.count(groupUri);
+    }
+
+    bool hasSecGrpRule(const URI& uri, const URI& clsUri, bool added) {
+        lock_guard<mutex> guard(notifMutex);
+        auto& m = added ? secGrpRulesAdded : secGrpRulesRemoved;
+        auto it = m.find(uri);
+        return it != m.end() && it->second.count(clsUri);
+    }
+
+    bool hasRulesChanged(const URI& uri) {
+        lock_guard<mutex> guard(notifMutex);
+        return rulesChanged.find(uri) != rulesChanged.end();
+    }
+
     void clear() {
         lock_guard<mutex> guard(notifMutex);
         notifRcvd.clear();
+        deltaGroups.clear();
+        rulesChanged.clear();
+        secGrpRulesAdded.clear();
+        secGrpRulesRemoved.clear();
     }
 
 private:
@@ -293,6 +341,10 @@ private:
 
     PolicyManager& pm;
     PolicyManager::uri_set_t notifRcvd;
+    std::unordered_map<URI, ContractDelta::uri_set_t> deltaGroups;
+    PolicyManager::uri_set_t rulesChanged;
+    std::unordered_map<URI, PolicyManager::uri_set_t> secGrpRulesAdded;
+    std::unordered_map<URI, PolicyManager::uri_set_t> secGrpRulesRemoved;
     mutex notifMutex;
 };
 
@@ -448,6 +500,65 @@ BOOST_FIXTURE_TEST_CASE( group_contract_update, PolicyFixture ) {
         egs.clear(); pm.getContractIntra(con3->getURI(), egs));
 }
 
+BOOST_FIXTURE_TEST_CASE( group_contract_delta, PolicyFixture ) {
+    PolicyManager& pm = agent.getPolicyManager();
+
+    PolicyManager::uri_set_t egs;
+    WAIT_FOR_DO(egs.size() == 1, 500,
+        egs.clear(); pm.getContractConsumers(con2->getURI(), egs));
+
+    MockListener lsnr(pm);
+    Mutator mutator(framework, "policyreg");
+    eg3->addGbpEpGroupToConsContractRSrc(con2->getURI().toString());
+    mutator.commit();
+
+    WAIT_FOR(lsnr.hasDeltaGroup(con2->getURI(), eg3->getURI()), 500);
+    BOOST_CHECK(!lsnr.hasRulesChanged(con2->getURI()));
+    egs.clear();
+    pm.getContractConsumers(con2->getURI(), egs);
+    BOOST_CHECK(checkContains(egs, eg3->getURI()));
+}
+
+BOOST_FIXTURE_TEST_CASE( secgroup_rules_delta, PolicyFixture ) {
+    PolicyManager& pm = agent.getPolicyManager();
+    MockListener lsnr(pm);
+
+    Mutator mutator(framework, "policyreg");
+    shared_ptr<SecGroup> sec2 = space->addGbpSecGroup("sec2");
+    sec2->addGbpSecGroupSubject("sec2_sub1")
+        ->addGbpSecGroupRule("sec2_sub1_rule1")
+        ->setOrder(10).setDirection(DirectionEnumT::CONST_IN)
+        .addGbpRuleToClassifierRSrc(classifier1->getURI().toString());
+    mutator.commit();
+    WAIT_FOR(lsnr.hasSecGrpRule(sec2->getURI(), classifier1->getURI(),
+                                true), 500);
+    BOOST_CHECK(!lsnr.hasSecGrpRule(sec2->getURI(), classifier1->getURI(),
+                                    false));
+
+    // only the edited rule is in the delta
+    lsnr.clear();
+    sec2->addGbpSecGroupSubject("sec2_sub1")
+        ->addGbpSecGroupRule("sec2_sub1_rule2")
+        ->setOrder(20).setDirection(DirectionEnumT::CONST_OUT)
+        .addGbpRuleToClassifierRSrc(classifier2->getURI().toString());
+    mutator.commit();
+    WAIT_FOR(lsnr.hasSecGrpRule(sec2->getURI(), classifier2->getURI(),
+                                true), 500);
+    BOOST_CHECK(!lsnr.hasSecGrpRule(sec2->getURI(), classifier1->getURI(),
+                                    true));
+    BOOST_CHECK(!lsnr.hasSecGrpRule(sec2->getURI(), classifier1->getURI(),
+                                    false));
+
+    lsnr.clear();
+    sec2->addGbpSecGroupSubject("sec2_sub1")
+        ->addGbpSecGroupRule("sec2_sub1_rule1")->remove();
+    mutator.commit();
+    WAIT_FOR(lsnr.hasSecGrpRule(sec2->getURI(), classifier1->getURI(),
+                                false), 500);
+    BOOST_CHECK(!lsnr.hasSecGrpRule(sec2->getURI(), classifier2->getURI(),
+                                    false));
+}
+
 static bool checkRules(const PolicyManager::rule_list_t& lhs,
                        const list<shared_ptr<L24Classifier> >& rhs,
                        const list<bool>& rhs_allow,
@@ -0,0 +1,50 @@
+/*
+ * Test suite for class PollScheduler
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/PollScheduler.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <vector>
+
+namespace opflexagent {
+
+BOOST_AUTO_TEST_SUITE(PollScheduler_test)
+
+BOOST_AUTO_TEST_CASE(spread) {
+    PollScheduler scheduler;
+    BOOST_CHECK_EQUAL(10000, scheduler.firstDelay(10000));
+
+    std::vector<long> delays = { 10000 };
+    for (int i = 1; i < 8; ++i) {
+        long delay = scheduler.firstDelay(10000);
+        BOOST_CHECK(delay >= 1 && delay <= 10000);
+        delays.push_back(delay);
+    }
+
+    // no two pollers are closer than a fraction of the interval
+    std::sort(delays.begin(), delays.end());
+    for (size_t i = 1; i < delays.size(); ++i) {
+        BOOST_CHECK(delays[i] - delays[i - 1] >= 10000 / 16);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(short_interval) {
+    PollScheduler scheduler;
+    for (int i = 0; i < 16; ++i) {
+        long delay = scheduler.firstDelay(1);
+        BOOST_CHECK_EQUAL(1, delay);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace opflexagent */
@@ -0,0 +1,111 @@
+/*
+ * Test suite for class PrefixTrie
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/PrefixTrie.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+
+namespace opflexagent {
+
+using boost::asio::ip::address;
+
+BOOST_AUTO_TEST_SUITE(PrefixTrie_test)
+
+BOOST_AUTO_TEST_CASE(exact) {
+    PrefixTrie<std::string> t;
+    t.insert(address::from_string("10.0.0.1"), 32) = "host";
+    t.insert(address::from_string("10.0.0.0"), 24) = "subnet";
+    t.insert(address::from_string("10.0.1.0"), 24) = "other";
+    BOOST_CHECK_EQUAL(3, t.size());
+
+    BOOST_REQUIRE(t.find(address::from_string("10.0.0.1"), 32));
+    BOOST_CHECK_EQUAL("host", *t.find(address::from_string("10.0.0.1"), 32));
+    // bits past the prefix length are ignored
+    BOOST_REQUIRE(t.find(address::from_string("10.0.0.77"), 24));
+    BOOST_CHECK_EQUAL("subnet",
+                      *t.find(address::from_string("10.0.0.77"), 24));
+    BOOST_CHECK(!t.find(address::from_string("10.0.0.2"), 32));
+    // the branch node created for the two subnets holds no value
+    BOOST_CHECK(!t.find(address::from_string("10.0.0.0"), 23));
+    BOOST_CHECK(!t.find(address::from_string("::a00:1"), 128));
+
+    // inserting again returns the existing value
+    BOOST_CHECK_EQUAL("host", t.insert(address::from_string("10.0.0.1"), 32));
+    BOOST_CHECK_EQUAL(3, t.size());
+}
+
+BOOST_AUTO_TEST_CASE(longest) {
+    PrefixTrie<int> t;
+    t.insert(address::from_string("0.0.0.0"), 0) = 0;
+    t.insert(address::from_string("10.0.0.0"), 8) = 8;
+    t.insert(address::from_string("10.1.0.0"), 16) = 16;
+    t.insert(address::from_string("10.1.2.3"), 32) = 32;
+    t.insert(address::from_string("fd00::"), 8) = 608;
+    t.insert(address::from_string("fd00::1"), 128) = 6128;
+
+    uint8_t len = 0;
+    BOOST_REQUIRE(t.longestMatch(address::from_string("10.1.2.3"), &len));
+    BOOST_CHECK_EQUAL(32, *t.longestMatch(address::from_string("10.1.2.3")));
+    BOOST_CHECK_EQUAL(32, len);
+    BOOST_CHECK_EQUAL(16, *t.longestMatch(address::from_string("10.1.2.4")));
+    BOOST_CHECK_EQUAL(8, *t.longestMatch(address::from_string("10.2.0.1")));
+    BOOST_CHECK_EQUAL(0, *t.longestMatch(address::from_string("11.0.0.1"),
+                                         &len));
+    BOOST_CHECK_EQUAL(0, len);
+
+    BOOST_CHECK_EQUAL(6128, *t.longestMatch(address::from_string("fd00::1")));
+    BOOST_CHECK_EQUAL(608, *t.longestMatch(address::from_string("fd12::1")));
+    BOOST_CHECK(!t.longestMatch(address::from_string("fe80::1")));
+
+    std::vector<int> matches;
+    t.visitMatches(address::from_string("10.1.2.3"),
+                   [&matches](uint8_t prefixLen, int& v) {
+                       BOOST_CHECK_EQUAL(prefixLen, v);
+                       matches.push_back(v);
+                   });
+    BOOST_CHECK((std::vector<int>{0, 8, 16, 32}) == matches);
+}
+
+BOOST_AUTO_TEST_CASE(erase) {
+    PrefixTrie<int> t;
+    t.insert(address::from_string("192.168.0.0"), 16) = 1;
+    t.insert(address::from_string("192.168.1.1"), 32) = 2;
+    t.insert(address::from_string("192.168.2.1"), 32) = 3;
+
+    BOOST_CHECK(!t.erase(address::from_string("192.168.3.1"), 32));
+    BOOST_CHECK(!t.erase(address::from_string("192.168.0.0"), 22));
+    BOOST_CHECK(t.erase(address::from_string("192.168.1.1"), 32));
+    BOOST_CHECK(!t.erase(address::from_string("192.168.1.1"), 32));
+    BOOST_CHECK_EQUAL(2, t.size());
+    BOOST_CHECK_EQUAL(1, *t.longestMatch(address::from_string("192.168.1.1")));
+    BOOST_CHECK_EQUAL(3, *t.longestMatch(address::from_string("192.168.2.1")));
+
+    BOOST_CHECK(t.erase(address::from_string("192.168.0.0"), 16));
+    BOOST_CHECK(!t.longestMatch(address::from_string("192.168.1.1")));
+    BOOST_CHECK_EQUAL(3, *t.find(address::from_string("192.168.2.1"), 32));
+
+    t.insert(address::from_string("192.168.1.1"), 32) = 4;
+    BOOST_CHECK_EQUAL(4, *t.find(address::from_string("192.168.1.1"), 32));
+    BOOST_CHECK(t.erase(address::from_string("192.168.2.1"), 32));
+    BOOST_CHECK(t.erase(address::from_string("192.168.1.1"), 32));
+    BOOST_CHECK(t.empty());
+
+    t.insert(address::from_string("::1"), 128) = 5;
+    t.clear();
+    BOOST_CHECK(t.empty());
+    BOOST_CHECK(!t.find(address::from_string("::1"), 128));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -0,0 +1,92 @@
+/*
+ * Test suite for class ProcStats
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/ProcStats.h>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace opflexagent {
+
+namespace fs = boost::filesystem;
+
+BOOST_AUTO_TEST_SUITE(ProcStats_test)
+
+BOOST_AUTO_TEST_CASE(parse) {
+    fs::path temp(fs::temp_directory_path() / fs::unique_path());
+    fs::create_directories(temp / "task" / "43");
+    long tick = sysconf(_SC_CLK_TCK);
+    long page = sysconf(_SC_PAGESIZE);
+    {
+        fs::ofstream os(temp / "stat");
+        os << "42 (a (b) c) S 1 42 42 0 -1 4194560 100 0 0 0 "
+           << 3 * tick << " " << tick << " 0 0 20 0 2 0 100 1000000 10 "
+           << "18446744073709551615 1 1 0 0 0 0 0 0 0 0 0 0 17 1\n";
+    }
+    {
+        fs::ofstream os(temp / "task" / "43" / "stat");
+        os << "43 (worker) R 1 42 42 0 -1 4194560 100 0 0 0 "
+           << tick << " " << tick << " 0 0 20 0 2 0 100 1000000 10\n";
+    }
+
+    ProcStats stats(temp.string());
+    BOOST_REQUIRE(stats.sample());
+    BOOST_CHECK_EQUAL(4, stats.getCpuSeconds());
+    BOOST_CHECK_EQUAL(10 * page, stats.getRssBytes());
+    BOOST_CHECK_EQUAL(2, stats.getThreadCount());
+    std::unordered_map<std::string, double> cpu;
+    stats.getThreadCpuSeconds(cpu);
+    BOOST_CHECK_EQUAL(1, cpu.size());
+    BOOST_CHECK_EQUAL(2, cpu["worker"]);
+
+    fs::remove_all(temp);
+    BOOST_CHECK(!ProcStats(temp.string()).sample());
+}
+
+BOOST_AUTO_TEST_CASE(self) {
+    std::atomic<bool> stop(false);
+    std::thread burner([&stop]() {
+            pthread_setname_np(pthread_self(), "burner");
+            volatile uint64_t count = 0;
+            while (!stop)
+                count += 1;
+        });
+
+    ProcStats stats;
+    BOOST_REQUIRE(stats.sample());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    BOOST_REQUIRE(stats.sample());
+    BOOST_CHECK(stats.getRssBytes() > 0);
+    BOOST_CHECK(stats.getThreadCount() >= 2);
+    std::unordered_map<std::string, double> cpu;
+    stats.getThreadCpuSeconds(cpu);
+    BOOST_CHECK(cpu["burner"] > 0);
+    BOOST_CHECK(stats.getCpuSeconds() >= cpu["burner"]);
+
+    // the thread that exited is gone after the next sample
+    stop = true;
+    burner.join();
+    BOOST_REQUIRE(stats.sample());
+    stats.getThreadCpuSeconds(cpu);
+    BOOST_CHECK(cpu.find("burner") == cpu.end());
+    BOOST_CHECK(!cpu.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -0,0 +1,94 @@
+/*
+ * Test suite for class SPSCRing
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/SPSCRing.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace opflexagent {
+
+BOOST_AUTO_TEST_SUITE(SPSCRing_test)
+
+BOOST_AUTO_TEST_CASE(full) {
+    SPSCRing<std::string> ring(3);
+    BOOST_CHECK_EQUAL(4, ring.capacity());
+    BOOST_CHECK(ring.empty());
+
+    bool wasEmpty = false;
+    BOOST_CHECK(ring.push("a", &wasEmpty));
+    BOOST_CHECK(wasEmpty);
+    BOOST_CHECK(ring.push("b", &wasEmpty));
+    BOOST_CHECK(!wasEmpty);
+    BOOST_CHECK(ring.push("c"));
+    BOOST_CHECK(ring.push("d"));
+    std::string item("e");
+    BOOST_CHECK(!ring.push(std::move(item)));
+    BOOST_CHECK_EQUAL("e", item);
+    BOOST_CHECK_EQUAL(4, ring.size());
+
+    BOOST_CHECK(ring.pop(item));
+    BOOST_CHECK_EQUAL("a", item);
+    BOOST_CHECK(ring.push("e"));
+    for (const char* expected : {"b", "c", "d", "e"}) {
+        BOOST_CHECK(ring.pop(item));
+        BOOST_CHECK_EQUAL(expected, item);
+    }
+    BOOST_CHECK(!ring.pop(item));
+    BOOST_CHECK(ring.empty());
+}
+
+BOOST_AUTO_TEST_CASE(threads) {
+    const int COUNT = 100000;
+    SPSCRing<int> ring(64);
+    std::mutex mutex;
+    std::condition_variable cond;
+
+    std::thread producer([&]() {
+            for (int i = 0; i < COUNT; ++i) {
+                bool wasEmpty;
+                int item = i;
+                while (!ring.push(std::move(item), &wasEmpty))
+                    std::this_thread::yield();
+                if (wasEmpty) {
+                    { std::lock_guard<std::mutex> guard(mutex); }
+                    cond.notify_one();
+                }
+            }
+        });
+
+    // items come out in order, and the consumer is always woken up
+    int expected = 0;
+    bool ordered = true;
+    while (expected < COUNT) {
+        int item;
+        while (ring.pop(item)) {
+            if (item != expected)
+                ordered = false;
+            expected++;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&]() {
+                return expected == COUNT || !ring.empty();
+            });
+    }
+    producer.join();
+
+    BOOST_CHECK(ordered);
+    BOOST_CHECK_EQUAL(COUNT, expected);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
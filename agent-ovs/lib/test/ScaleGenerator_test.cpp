@@ -0,0 +1,119 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Test suite for class ScaleGenerator
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/test/BaseFixture.h>
+#include <opflexagent/FSEndpointSource.h>
+#include <opflexagent/FSServiceSource.h>
+#include <opflexagent/FSWatcher.h>
+#include "ScaleGenerator.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+namespace opflexagent {
+
+namespace fs = boost::filesystem;
+using opflex::modb::URI;
+
+class ScaleFixture : public BaseFixture {
+public:
+    ScaleFixture()
+        : temp(fs::temp_directory_path() / fs::unique_path()) {
+        fs::create_directory(temp);
+    }
+
+    ~ScaleFixture() {
+        fs::remove_all(temp);
+    }
+
+    fs::path temp;
+};
+
+BOOST_AUTO_TEST_SUITE(ScaleGenerator_test)
+
+BOOST_AUTO_TEST_CASE(parse) {
+    ScaleGenerator::Params params;
+    params.parse("tenants=3,epgs=10,endpoints=500,services=7");
+    BOOST_CHECK_EQUAL(3, params.tenants);
+    BOOST_CHECK_EQUAL(10, params.epgs);
+    BOOST_CHECK_EQUAL(500, params.endpoints);
+    BOOST_CHECK_EQUAL(7, params.services);
+    BOOST_CHECK_EQUAL(2, params.contracts);
+
+    BOOST_CHECK_THROW(params.parse("groups=1"), std::invalid_argument);
+    BOOST_CHECK_THROW(params.parse("epgs=ten"), std::invalid_argument);
+    BOOST_CHECK_THROW(params.parse("epgs"), std::invalid_argument);
+
+    ScaleGenerator::Params tooBig;
+    tooBig.parse("epgs=100000");
+    BOOST_CHECK_THROW(ScaleGenerator generator(tooBig),
+                      std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(addresses) {
+    ScaleGenerator::Params params;
+    params.parse("tenants=2,epgs=2,endpoints=10,ips=2");
+    ScaleGenerator generator(params);
+    // endpoints are spread round robin over the four groups
+    BOOST_CHECK_EQUAL("10.0.0.2", generator.getEndpointIP(0));
+    BOOST_CHECK_EQUAL("10.0.0.3", generator.getEndpointIP(0, 1));
+    BOOST_CHECK_EQUAL("10.0.1.2", generator.getEndpointIP(1));
+    BOOST_CHECK_EQUAL("10.0.0.4", generator.getEndpointIP(4));
+}
+
+BOOST_FIXTURE_TEST_CASE(generate, ScaleFixture) {
+    ScaleGenerator::Params params;
+    params.parse("tenants=2,epgs=5,contracts=3,providers=2,consumers=2,"
+                 "endpoints=40,services=4,backends=3,snats=2");
+    ScaleGenerator generator(params);
+    generator.writePolicy(framework);
+
+    PolicyManager& pm = agent.getPolicyManager();
+    PolicyManager::uri_set_t groups;
+    WAIT_FOR_DO(groups.size() == 10, 1000,
+                groups.clear(); pm.getGroups(groups));
+    BOOST_CHECK(groups.count(ScaleGenerator::getEpgURI(1, 4)));
+
+    URI contract = ScaleGenerator::getContractURI(1, 2);
+    PolicyManager::uri_set_t providers;
+    PolicyManager::uri_set_t consumers;
+    WAIT_FOR_DO(providers.size() == 2 && consumers.size() == 2, 1000,
+                providers.clear(); consumers.clear();
+                pm.getContractProviders(contract, providers);
+                pm.getContractConsumers(contract, consumers));
+    BOOST_CHECK(providers.count(ScaleGenerator::getEpgURI(1, 2)));
+    BOOST_CHECK(consumers.count(ScaleGenerator::getEpgURI(1, 4)));
+
+    BOOST_CHECK_EQUAL(40, generator.writeEndpoints((temp / "eps").string()));
+    BOOST_CHECK_EQUAL(4, generator.writeServices((temp / "svcs").string()));
+    BOOST_CHECK_EQUAL(2, generator.writeSnats((temp / "snats").string()));
+
+    FSWatcher watcher;
+    FSEndpointSource epSource(&agent.getEndpointManager(), watcher,
+                              (temp / "eps").string());
+    FSServiceSource svcSource(&agent.getServiceManager(), watcher,
+                              (temp / "svcs").string());
+    watcher.start();
+
+    EndpointManager& epMgr = agent.getEndpointManager();
+    WAIT_FOR(epMgr.getEpCount() == 40, 1000);
+    std::unordered_set<std::string> eps;
+    WAIT_FOR_DO(eps.size() == 4, 1000, eps.clear();
+                epMgr.getEndpointsForGroup(ScaleGenerator::getEpgURI(0, 1),
+                                           eps));
+    WAIT_FOR(agent.getServiceManager().getServiceCount() == 4, 1000);
+
+    watcher.stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace opflexagent */
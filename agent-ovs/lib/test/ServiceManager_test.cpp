@@ -26,6 +26,8 @@
 #endif
 #include <opflexagent/PrometheusManager.h>
 
+#include <mutex>
+
 namespace opflexagent {
 
 using boost::optional;
@@ -554,6 +556,67 @@ BOOST_FIXTURE_TEST_CASE(testUpdate, ServiceManagerFixture) {
     LOG(DEBUG) << "############# SERVICE UPDATE END ############";
 }
 
+class DeltaListener : public ServiceListener {
+public:
+    DeltaListener() : changes(0) {}
+
+    virtual void serviceUpdated(const std::string& uuid) {}
+    virtual void serviceChanged(const std::string& uuid,
+                                const ServiceDelta& delta) {
+        std::lock_guard<std::mutex> guard(mutex);
+        changes += 1;
+        last = delta;
+    }
+
+    std::mutex mutex;
+    int changes;
+    ServiceDelta last;
+};
+
+BOOST_FIXTURE_TEST_CASE(testIndexAndDelta, ServiceManagerFixture) {
+    ServiceManager& serviceMgr = agent.getServiceManager();
+    DeltaListener listener;
+    serviceMgr.registerListener(&listener);
+    const string uuid("ed84daef-1696-4b98-8c80-6b22d85f4dc2");
+
+    createServices(true);
+    WAIT_FOR(listener.changes == 1, 500);
+    std::unordered_set<string> servs;
+    serviceMgr.getServicesByMapping("169.254.169.254", "udp", 53, servs);
+    BOOST_CHECK_EQUAL(1, servs.count(uuid));
+    servs.clear();
+    serviceMgr.getServicesByNextHop("169.254.169.2", servs);
+    BOOST_CHECK_EQUAL(1, servs.count(uuid));
+
+    // the same service again is not an update
+    servSrc.updateService(as);
+    BOOST_CHECK_EQUAL(1, listener.changes);
+
+    updateServices(true);
+    WAIT_FOR(listener.changes == 2, 500);
+    {
+        std::lock_guard<std::mutex> guard(listener.mutex);
+        BOOST_CHECK_EQUAL(2, listener.last.addedMappings.size());
+        BOOST_CHECK_EQUAL(2, listener.last.removedMappings.size());
+        BOOST_CHECK_EQUAL(1, listener.last.changedNextHops
+                          .count("169.254.169.4"));
+        BOOST_CHECK_EQUAL(0, listener.last.changedNextHops
+                          .count("10.20.44.2"));
+    }
+    servs.clear();
+    serviceMgr.getServicesByMapping("169.254.169.254", "udp", 53, servs);
+    BOOST_CHECK(servs.empty());
+    serviceMgr.getServicesByMapping("169.254.169.254", "udp", 54, servs);
+    BOOST_CHECK_EQUAL(1, servs.count(uuid));
+
+    removeServiceObjects();
+    WAIT_FOR(listener.changes == 3, 500);
+    servs.clear();
+    serviceMgr.getServicesByNextHop("10.20.44.2", servs);
+    BOOST_CHECK(servs.empty());
+    serviceMgr.unregisterListener(&listener);
+}
+
 BOOST_FIXTURE_TEST_CASE(testDeleteLBNodePort, ServiceManagerFixture) {
     LOG(DEBUG) << "#### SERVICE CREATE START ####";
     createServices(true, true);
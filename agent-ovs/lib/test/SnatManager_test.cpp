@@ -153,6 +153,20 @@ BOOST_FIXTURE_TEST_CASE( fsextsvisource, FSSnatFixture ) {
   
     BOOST_CHECK(extSnat->getSnatIP() == "10.0.0.1");
 
+    SnatManager::snats_t snats;
+    snatMgr.getSnatsByIp("10.0.0.1", snats);
+    BOOST_CHECK(snats.count(uuid) == 1);
+    snats.clear();
+    snatMgr.getSnatsByPort("10.0.0.1", 8000, snats);
+    BOOST_CHECK(snats.count(uuid) == 1);
+    snats.clear();
+    snatMgr.getSnatsByPort("10.0.0.1", 10999, snats);
+    BOOST_CHECK(snats.count(uuid) == 1);
+    snats.clear();
+    snatMgr.getSnatsByPort("10.0.0.1", 11000, snats);
+    snatMgr.getSnatsByPort("10.0.0.2", 8000, snats);
+    BOOST_CHECK(snats.empty());
+
     const std::string epUuid = " 9b7295f4-07a8-41ac-a681-e0ee82560262";
     snatMgr.addEndpoint(uuid, epUuid);
 
@@ -167,6 +181,9 @@ BOOST_FIXTURE_TEST_CASE( fsextsvisource, FSSnatFixture ) {
     // check for removing a Snat
     fs::remove(path1);
     WAIT_FOR((agent.getSnatManager().getSnat(uuid) == nullptr), 500);
+    snats.clear();
+    snatMgr.getSnatsByPort("10.0.0.1", 8000, snats);
+    BOOST_CHECK(snats.empty());
 
     watcher.stop();
 }
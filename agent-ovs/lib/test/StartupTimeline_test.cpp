@@ -0,0 +1,108 @@
+/*
+ * Test suite for class StartupTimeline
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/StartupTimeline.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace opflexagent {
+
+BOOST_AUTO_TEST_SUITE(StartupTimeline_test)
+
+BOOST_AUTO_TEST_CASE(phases) {
+    StartupTimeline timeline;
+    {
+        StartupTimeline::Phase p(timeline, "config");
+    }
+    double firstEnd;
+    {
+        std::vector<StartupTimeline::Event> events;
+        timeline.getEvents(events);
+        BOOST_REQUIRE_EQUAL(1, events.size());
+        firstEnd = events[0].end;
+    }
+    timeline.beginPhase("config");
+    timeline.endPhase("config");
+    timeline.endPhase("unknown");
+
+    std::vector<StartupTimeline::Event> events;
+    timeline.getEvents(events);
+    BOOST_REQUIRE_EQUAL(1, events.size());
+    BOOST_CHECK_EQUAL("config", events[0].name);
+    BOOST_CHECK(!events[0].milestone);
+    BOOST_CHECK(events[0].start <= firstEnd);
+    BOOST_CHECK(events[0].end >= firstEnd);
+}
+
+BOOST_AUTO_TEST_CASE(milestones) {
+    StartupTimeline timeline;
+    timeline.expect("ready");
+    timeline.mark("connected");
+    timeline.mark("connected");
+
+    std::vector<StartupTimeline::Event> events;
+    timeline.getEvents(events);
+    BOOST_REQUIRE_EQUAL(1, events.size());
+    BOOST_CHECK_EQUAL("connected", events[0].name);
+    BOOST_CHECK(events[0].milestone);
+    BOOST_CHECK_EQUAL(events[0].start, events[0].end);
+    BOOST_CHECK(!timeline.isConverged());
+}
+
+BOOST_AUTO_TEST_CASE(converged) {
+    StartupTimeline timeline;
+    int calls = 0;
+    std::vector<StartupTimeline::Event> seen;
+    timeline.setConvergedCallback(
+        [&](const std::vector<StartupTimeline::Event>& events) {
+            calls += 1;
+            seen = events;
+        });
+    timeline.expect("ready");
+    timeline.expect("synced br-int");
+    timeline.beginPhase("start");
+
+    timeline.mark("ready");
+    BOOST_CHECK(!timeline.isConverged());
+    BOOST_CHECK_EQUAL(0, calls);
+
+    timeline.endPhase("start");
+    timeline.mark("synced br-int");
+    BOOST_CHECK(timeline.isConverged());
+    BOOST_CHECK_EQUAL(1, calls);
+    BOOST_REQUIRE_EQUAL(4, seen.size());
+    BOOST_CHECK_EQUAL("start", seen[0].name);
+    BOOST_CHECK_EQUAL("ready", seen[1].name);
+    BOOST_CHECK_EQUAL("synced br-int", seen[2].name);
+    BOOST_CHECK_EQUAL(StartupTimeline::CONVERGED, seen[3].name);
+
+    // the timeline does not change once converged
+    timeline.expect("other");
+    timeline.mark("other");
+    timeline.beginPhase("reload");
+    BOOST_CHECK_EQUAL(1, calls);
+    std::vector<StartupTimeline::Event> events;
+    timeline.getEvents(events);
+    BOOST_CHECK_EQUAL(4, events.size());
+
+    std::stringstream ss;
+    ss << events;
+    BOOST_CHECK(ss.str().find("start (") != std::string::npos);
+    BOOST_CHECK(ss.str().find(StartupTimeline::CONVERGED) !=
+                std::string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
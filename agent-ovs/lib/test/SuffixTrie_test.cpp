@@ -0,0 +1,82 @@
+/*
+ * Test suite for class SuffixTrie
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/SuffixTrie.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+
+namespace opflexagent {
+
+BOOST_AUTO_TEST_SUITE(SuffixTrie_test)
+
+static std::vector<std::string> matches(SuffixTrie<std::string>& trie,
+                                        const std::string& str) {
+    std::vector<std::string> result;
+    trie.visitMatches(str, [&result](std::string& v) { result.push_back(v); });
+    return result;
+}
+
+BOOST_AUTO_TEST_CASE(match) {
+    SuffixTrie<std::string> trie;
+    trie.insert(".example.com") = "*.example.com";
+    trie.insert("example.com") = "*example.com";
+    trie.insert(".org") = "*.org";
+    BOOST_CHECK_EQUAL(3, trie.size());
+
+    std::vector<std::string> expected = { "*example.com", "*.example.com" };
+    std::vector<std::string> result = matches(trie, "www.example.com");
+    BOOST_CHECK_EQUAL_COLLECTIONS(result.begin(), result.end(),
+                                  expected.begin(), expected.end());
+    expected = { "*example.com" };
+    result = matches(trie, "myexample.com");
+    BOOST_CHECK_EQUAL_COLLECTIONS(result.begin(), result.end(),
+                                  expected.begin(), expected.end());
+    result = matches(trie, "example.com");
+    BOOST_CHECK_EQUAL_COLLECTIONS(result.begin(), result.end(),
+                                  expected.begin(), expected.end());
+    BOOST_CHECK(matches(trie, "example.net").empty());
+    BOOST_CHECK(matches(trie, "org").empty());
+
+    // the empty suffix matches anything
+    trie.insert("") = "*";
+    expected = { "*", "*.org" };
+    result = matches(trie, "opflex.org");
+    BOOST_CHECK_EQUAL_COLLECTIONS(result.begin(), result.end(),
+                                  expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(erase) {
+    SuffixTrie<int> trie;
+    trie.insert("b.c") = 1;
+    trie.insert("a.b.c") = 2;
+    BOOST_CHECK(trie.find("b.c") != NULL);
+    BOOST_CHECK(trie.find(".b.c") == NULL);
+
+    BOOST_CHECK(!trie.erase(".c"));
+    BOOST_CHECK(trie.erase("b.c"));
+    BOOST_CHECK(!trie.erase("b.c"));
+    BOOST_CHECK_EQUAL(1, trie.size());
+    BOOST_CHECK(trie.find("b.c") == NULL);
+    BOOST_REQUIRE(trie.find("a.b.c") != NULL);
+    BOOST_CHECK_EQUAL(2, *trie.find("a.b.c"));
+
+    BOOST_CHECK(trie.erase("a.b.c"));
+    BOOST_CHECK_EQUAL(0, trie.size());
+    int count = 0;
+    trie.visitMatches("a.b.c", [&count](int&) { count += 1; });
+    BOOST_CHECK_EQUAL(0, count);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -267,5 +267,107 @@ BOOST_FIXTURE_TEST_CASE(testMoDBCounts, SysStatsManagerFixture) {
     LOG(DEBUG) << "### MoDBCounts end";
 }
 
+BOOST_FIXTURE_TEST_CASE(testModbClassStats, SysStatsManagerFixture) {
+
+    LOG(DEBUG) << "### ModbClassStats start";
+    const std::string className = "GbpEpGroup";
+    opflex::modb::ClassStats stats;
+    stats.instances = 3;
+    stats.propBytes = 100;
+    stats.indexBytes = 20;
+    stats.uriBytes = 5;
+    agent.getPrometheusManager().addNUpdateModbClassStats(className, stats);
+
+    std::string output = BaseFixture::getOutputFromCommand(cmd);
+    size_t pos = output.find("opflex_modb_class_instances{class=\""
+                             + className + "\"} 3");
+    BaseFixture::expPosition(true, pos);
+    pos = output.find("opflex_modb_class_bytes{class=\""
+                      + className + "\"} 125");
+    BaseFixture::expPosition(true, pos);
+
+    agent.getPrometheusManager().removeModbClassStats(className);
+    output = BaseFixture::getOutputFromCommand(cmd);
+    pos = output.find("opflex_modb_class_instances{class=\""
+                      + className + "\"}");
+    BaseFixture::expPosition(false, pos);
+    LOG(DEBUG) << "### ModbClassStats end";
+}
+
+BOOST_FIXTURE_TEST_CASE(testProcessorStats, SysStatsManagerFixture) {
+
+    LOG(DEBUG) << "### ProcessorStats start";
+    agent.getPrometheusManager().addNUpdateProcessorStats("unresolved", 7);
+
+    std::string output = BaseFixture::getOutputFromCommand(cmd);
+    size_t pos = output.find("opflex_processor_items{state=\"unresolved\"} 7");
+    BaseFixture::expPosition(true, pos);
+
+    agent.getPrometheusManager().addNUpdateProcessorStats("unresolved", 2);
+    output = BaseFixture::getOutputFromCommand(cmd);
+    pos = output.find("opflex_processor_items{state=\"unresolved\"} 2");
+    BaseFixture::expPosition(true, pos);
+    LOG(DEBUG) << "### ProcessorStats end";
+}
+
+BOOST_FIXTURE_TEST_CASE(testProcessorLatency, SysStatsManagerFixture) {
+
+    LOG(DEBUG) << "### ProcessorLatency start";
+    OFLatencyHistogram processTime;
+    processTime.observe(3);
+    processTime.observe(40);
+    std::unordered_map<std::string,
+        std::shared_ptr<const OFLatencyHistogram> > resolveLatency;
+    auto hist = std::make_shared<OFLatencyHistogram>();
+    hist->observe(7);
+    resolveLatency["GbpEpGroup"] = hist;
+    agent.getPrometheusManager()
+        .addNUpdateProcessorLatency(processTime, resolveLatency);
+
+    std::string output = BaseFixture::getOutputFromCommand(cmd);
+    size_t pos = output.find("opflex_processor_item_time_us_bucket{le=\"5\"} 1");
+    BaseFixture::expPosition(true, pos);
+    pos = output.find("opflex_processor_item_time_us_bucket{le=\"+Inf\"} 2");
+    BaseFixture::expPosition(true, pos);
+    pos = output.find("opflex_processor_item_time_us_sum 43");
+    BaseFixture::expPosition(true, pos);
+    pos = output.find("opflex_processor_item_time_us_count 2");
+    BaseFixture::expPosition(true, pos);
+    pos = output.find("opflex_processor_policy_resolve_latency_ms_bucket"
+                      "{class=\"GbpEpGroup\",le=\"10\"} 1");
+    BaseFixture::expPosition(true, pos);
+
+    auto stats = std::make_shared<OFAgentStats>();
+    stats->getPolResolveLatency().observe(30);
+    stats->getKeepAliveRtt().observe(2);
+    stats->getMethodLatency().observe("policy_resolve", 30);
+    stats->getMethodLatency().observe("send_identity", 1);
+    agent.getPrometheusManager().addNUpdateOFPeerLatency("127.0.0.1:8009",
+                                                         stats);
+    output = BaseFixture::getOutputFromCommand(cmd);
+    pos = output.find("opflex_peer_policy_resolve_latency_ms_count"
+                      "{peer=\"127.0.0.1:8009\"} 1");
+    BaseFixture::expPosition(true, pos);
+    pos = output.find("opflex_peer_keepalive_rtt_ms_sum"
+                      "{peer=\"127.0.0.1:8009\"} 2");
+    BaseFixture::expPosition(true, pos);
+    pos = output.find("opflex_peer_request_latency_ms_bucket"
+                      "{le=\"50\",method=\"policy_resolve\","
+                      "peer=\"127.0.0.1:8009\"} 1");
+    BaseFixture::expPosition(true, pos);
+    pos = output.find("opflex_peer_request_latency_ms_count"
+                      "{method=\"send_identity\",peer=\"127.0.0.1:8009\"} 1");
+    BaseFixture::expPosition(true, pos);
+
+    agent.getPrometheusManager().removeOFPeerLatency("127.0.0.1:8009");
+    output = BaseFixture::getOutputFromCommand(cmd);
+    pos = output.find("opflex_peer_policy_resolve_latency_ms_count"
+                      "{peer=\"127.0.0.1:8009\"}");
+    BaseFixture::expPosition(false, pos);
+    pos = output.find("opflex_peer_request_latency_ms_count");
+    BaseFixture::expPosition(false, pos);
+    LOG(DEBUG) << "### ProcessorLatency end";
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }
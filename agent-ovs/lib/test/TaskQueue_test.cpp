@@ -0,0 +1,222 @@
+/*
+ * Test suite for class TaskQueue
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/TaskQueue.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace opflexagent {
+
+BOOST_AUTO_TEST_SUITE(TaskQueue_test)
+
+BOOST_AUTO_TEST_CASE(priority) {
+    boost::asio::io_service io;
+    TaskQueue queue(io);
+    std::vector<std::string> order;
+    auto task = [&order](const std::string& id) {
+        return [&order, id]() { order.push_back(id); };
+    };
+
+    queue.dispatch("low", task("low"), TaskQueue::LOW);
+    queue.dispatch("normal1", task("normal1"));
+    queue.dispatch("high", task("high"), TaskQueue::HIGH);
+    queue.dispatch("normal2", task("normal2"));
+    // already queued
+    queue.dispatch("normal1", task("again"), TaskQueue::HIGH);
+    io.run();
+
+    BOOST_CHECK((std::vector<std::string>
+                 {"high", "normal1", "normal2", "low"}) == order);
+}
+
+BOOST_AUTO_TEST_CASE(serialize) {
+    boost::asio::io_service io;
+    TaskQueue queue(io);
+    std::atomic<int> running[4];
+    std::atomic<int> runs(0);
+    std::atomic<bool> overlap(false);
+    for (auto& r : running) r = 0;
+
+    std::function<void (int)> task = [&](int key) {
+        if (running[key]++ != 0)
+            overlap = true;
+        // queue the same task again while this one runs
+        if (++runs < 2000)
+            queue.dispatch(std::to_string(key),
+                           [&task, key]() { task(key); });
+        std::this_thread::yield();
+        running[key]--;
+    };
+
+    {
+        boost::asio::io_service::work work(io);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; ++i)
+            threads.emplace_back([&io]() { io.run(); });
+        for (int key = 0; key < 4; ++key)
+            queue.dispatch(std::to_string(key),
+                           [&task, key]() { task(key); });
+        while (runs < 2000)
+            std::this_thread::yield();
+        io.stop();
+        for (auto& t : threads)
+            t.join();
+    }
+    BOOST_CHECK(!overlap);
+}
+
+BOOST_AUTO_TEST_CASE(debounce) {
+    using std::chrono::milliseconds;
+    boost::asio::io_service io;
+    TaskQueue queue(io);
+    std::vector<int> runs;
+
+    // requests closer than the delay are coalesced into the last one
+    for (int i = 0; i < 5; ++i)
+        queue.dispatchDebounced("a", milliseconds(50),
+                                [&runs, i]() { runs.push_back(i); },
+                                milliseconds(1000));
+    io.run();
+    BOOST_CHECK((std::vector<int>{4}) == runs);
+
+    // a steady stream of requests still runs within the maximum delay
+    runs.clear();
+    io.reset();
+    auto start = std::chrono::steady_clock::now();
+    std::thread requests([&queue, &runs]() {
+            for (int i = 0; i < 30; ++i) {
+                queue.dispatchDebounced("a", milliseconds(20),
+                                        [&runs, i]() { runs.push_back(i); },
+                                        milliseconds(100));
+                std::this_thread::sleep_for(milliseconds(10));
+            }
+        });
+    {
+        boost::asio::io_service::work work(io);
+        std::thread worker([&io]() { io.run(); });
+        requests.join();
+        std::this_thread::sleep_for(milliseconds(50));
+        io.stop();
+        worker.join();
+    }
+    BOOST_CHECK(runs.size() >= 2);
+    BOOST_CHECK(runs.size() < 30);
+    BOOST_CHECK_EQUAL(29, runs.back());
+    BOOST_CHECK(std::chrono::steady_clock::now() - start < milliseconds(1000));
+}
+
+BOOST_AUTO_TEST_CASE(trace) {
+    using opflex::modb::TraceContext;
+    using std::chrono::milliseconds;
+    boost::asio::io_service io;
+    TaskQueue queue(io);
+    DataplaneLatency latency;
+    queue.setLatency(&latency);
+
+    const TraceContext::clock::time_point origin =
+        TraceContext::clock::now() - milliseconds(20);
+    std::vector<TraceContext::clock::time_point> seen;
+    auto task = [&seen]() { seen.push_back(TraceContext::getOrigin()); };
+    {
+        const TraceContext::Scope trace(origin);
+        queue.dispatch("traced", task);
+        queue.dispatchDebounced("debounced", milliseconds(1), task,
+                                milliseconds(10));
+    }
+    queue.dispatch("untraced", task);
+    io.run();
+
+    BOOST_REQUIRE_EQUAL(3, seen.size());
+    BOOST_CHECK(seen[0] == origin);
+    BOOST_CHECK(seen[1] == TraceContext::clock::time_point());
+    BOOST_CHECK(seen[2] == origin);
+    BOOST_CHECK(!TraceContext::isTraced());
+
+    const OFLatencyHistogram& notify =
+        latency.getHistogram(DataplaneLatency::NOTIFY);
+    BOOST_CHECK_EQUAL(2, notify.getCount());
+    BOOST_CHECK(notify.getSum() >= 40);
+    BOOST_CHECK_EQUAL(2, latency.getHistogram(DataplaneLatency::QUEUE)
+                      .getCount());
+    BOOST_CHECK_EQUAL(0, latency.getHistogram(DataplaneLatency::TOTAL)
+                      .getCount());
+}
+
+BOOST_AUTO_TEST_CASE(task_timer) {
+    using std::chrono::milliseconds;
+    boost::asio::io_service io;
+    TaskQueue queue(io);
+    std::vector<std::pair<std::string,
+                          std::chrono::steady_clock::duration> > timed;
+    queue.setTaskTimer([&timed](const std::string& taskId,
+                                std::chrono::steady_clock::duration elapsed) {
+            timed.emplace_back(taskId, elapsed);
+        });
+    queue.dispatch("slow", []() {
+            std::this_thread::sleep_for(milliseconds(20));
+        });
+    queue.dispatch("fails", []() { throw std::runtime_error("failed"); });
+    io.run();
+
+    BOOST_REQUIRE_EQUAL(2, timed.size());
+    BOOST_CHECK_EQUAL("slow", timed[0].first);
+    BOOST_CHECK(timed[0].second >= milliseconds(20));
+    // a task that throws is timed too
+    BOOST_CHECK_EQUAL("fails", timed[1].first);
+}
+
+BOOST_AUTO_TEST_CASE(watchdog) {
+    using std::chrono::milliseconds;
+    boost::asio::io_service io;
+    TaskQueue queue(io);
+    TaskWatchdog watchdog;
+    watchdog.setThreshold(milliseconds(10));
+    queue.setWatchdog(&watchdog, "test");
+    queue.dispatch("slow", []() {
+            std::this_thread::sleep_for(milliseconds(20));
+        });
+    queue.dispatch("fast", []() {});
+    io.run();
+
+    TaskWatchdog::hist_map_t times;
+    watchdog.getTaskTimes(times);
+    BOOST_REQUIRE(times["test"]);
+    BOOST_CHECK_EQUAL(2, times["test"]->getCount());
+    BOOST_CHECK(times["test"]->getSum() >= 20);
+    BOOST_CHECK_EQUAL(1, watchdog.getSlowTaskCount());
+
+    // a probe measures the lag of the event loop
+    io.reset();
+    watchdog.monitor("io", io);
+    std::thread worker([&io]() { io.run(); });
+    TaskWatchdog::hist_map_t lag;
+    for (int i = 0; i < 300; ++i) {
+        lag.clear();
+        watchdog.getLoopLag(lag);
+        if (lag["io"] && lag["io"]->getCount() > 0) break;
+        std::this_thread::sleep_for(milliseconds(10));
+    }
+    watchdog.stop();
+    worker.join();
+    BOOST_REQUIRE(lag["io"]);
+    BOOST_CHECK(lag["io"]->getCount() > 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
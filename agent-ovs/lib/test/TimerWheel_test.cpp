@@ -0,0 +1,88 @@
+/*
+ * Test suite for class TimerWheel
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/TimerWheel.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace opflexagent {
+
+BOOST_AUTO_TEST_SUITE(TimerWheel_test)
+
+BOOST_AUTO_TEST_CASE(due) {
+    TimerWheel<std::string> wheel(4);
+    wheel.schedule("a", 1);
+    wheel.schedule("b", 3);
+    // more than a turn of the wheel away
+    wheel.schedule("c", 7);
+    // in the past
+    wheel.schedule("d", 0);
+    BOOST_CHECK_EQUAL(4, wheel.size());
+
+    std::vector<std::string> due;
+    wheel.advance(1, due);
+    std::sort(due.begin(), due.end());
+    std::vector<std::string> expected = { "a", "d" };
+    BOOST_CHECK_EQUAL_COLLECTIONS(due.begin(), due.end(),
+                                  expected.begin(), expected.end());
+
+    due.clear();
+    wheel.advance(3, due);
+    expected = { "b" };
+    BOOST_CHECK_EQUAL_COLLECTIONS(due.begin(), due.end(),
+                                  expected.begin(), expected.end());
+
+    // the slot of c comes around before it is due
+    due.clear();
+    wheel.advance(6, due);
+    BOOST_CHECK(due.empty());
+    BOOST_CHECK_EQUAL(1, wheel.size());
+    wheel.advance(7, due);
+    expected = { "c" };
+    BOOST_CHECK_EQUAL_COLLECTIONS(due.begin(), due.end(),
+                                  expected.begin(), expected.end());
+    BOOST_CHECK_EQUAL(0, wheel.size());
+}
+
+BOOST_AUTO_TEST_CASE(jump) {
+    TimerWheel<int> wheel(4);
+    for (int i = 1; i <= 20; ++i)
+        wheel.schedule(i, i);
+    wheel.schedule(0, 100);
+
+    // advancing past several turns at once
+    std::vector<int> due;
+    wheel.advance(20, due);
+    std::sort(due.begin(), due.end());
+    BOOST_CHECK_EQUAL(20, due.size());
+    BOOST_CHECK_EQUAL(1, due.front());
+    BOOST_CHECK_EQUAL(20, due.back());
+    BOOST_CHECK_EQUAL(20, wheel.current());
+
+    due.clear();
+    wheel.advance(10, due);
+    BOOST_CHECK(due.empty());
+    BOOST_CHECK_EQUAL(20, wheel.current());
+    wheel.advance(100, due);
+    BOOST_CHECK_EQUAL(1, due.size());
+
+    wheel.schedule(1, 200);
+    wheel.clear();
+    BOOST_CHECK_EQUAL(0, wheel.size());
+    BOOST_CHECK_EQUAL(0, wheel.current());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
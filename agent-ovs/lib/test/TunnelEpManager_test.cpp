@@ -0,0 +1,164 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Test suite for class TunnelEpManager
+ *
+ * Copyright (c) 2014 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <opflexagent/TunnelEpManager.h>
+
+#include <boost/test/unit_test.hpp>
+
+#ifdef HAVE_LINUX_RTNETLINK_H
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#endif
+
+#include <cstring>
+#include <vector>
+
+namespace opflexagent {
+
+#ifdef HAVE_LINUX_RTNETLINK_H
+
+/**
+ * Build a buffer of rtnetlink messages as read from the socket
+ */
+class NetlinkBuffer {
+public:
+    /**
+     * Append a message
+     * @param type the message type
+     * @param payload the payload of the message
+     * @param len the length of the payload
+     */
+    void add(uint16_t type, const void* payload, size_t len) {
+        size_t off = buf.size();
+        buf.resize(off + NLMSG_SPACE(len));
+        struct nlmsghdr* nh = (struct nlmsghdr*)&buf[off];
+        nh->nlmsg_len = NLMSG_LENGTH(len);
+        nh->nlmsg_type = type;
+        memcpy(NLMSG_DATA(nh), payload, len);
+    }
+
+    void addLink(uint16_t type, int index) {
+        struct ifinfomsg ifi;
+        memset(&ifi, 0, sizeof(ifi));
+        ifi.ifi_index = index;
+        add(type, &ifi, sizeof(ifi));
+    }
+
+    void addAddr(uint16_t type, int index) {
+        struct ifaddrmsg ifa;
+        memset(&ifa, 0, sizeof(ifa));
+        ifa.ifa_index = index;
+        add(type, &ifa, sizeof(ifa));
+    }
+
+    /* a route with a table and an output interface attribute */
+    void addRoute(uint16_t type, int oif) {
+        std::vector<char> p(NLMSG_ALIGN(sizeof(struct rtmsg)) +
+                            2 * RTA_SPACE(sizeof(int)));
+        struct rtattr* rta =
+            (struct rtattr*)(&p[0] + NLMSG_ALIGN(sizeof(struct rtmsg)));
+        rta->rta_type = RTA_TABLE;
+        rta->rta_len = RTA_LENGTH(sizeof(int));
+        *(int*)RTA_DATA(rta) = RT_TABLE_MAIN;
+        rta = (struct rtattr*)((char*)rta + RTA_SPACE(sizeof(int)));
+        rta->rta_type = RTA_OIF;
+        rta->rta_len = RTA_LENGTH(sizeof(int));
+        *(int*)RTA_DATA(rta) = oif;
+        add(type, &p[0], p.size());
+    }
+
+    bool isEvent(int index) {
+        return TunnelEpManager::isInterfaceEvent(buf.data(), buf.size(),
+                                                 index);
+    }
+
+    std::vector<char> buf;
+};
+
+#endif
+
+BOOST_AUTO_TEST_SUITE(TunnelEpManager_test)
+
+#ifdef HAVE_LINUX_RTNETLINK_H
+
+BOOST_AUTO_TEST_CASE(linkAddr) {
+    NetlinkBuffer link;
+    link.addLink(RTM_NEWLINK, 3);
+    BOOST_CHECK(link.isEvent(3));
+    BOOST_CHECK(!link.isEvent(4));
+
+    NetlinkBuffer addr;
+    addr.addAddr(RTM_DELADDR, 4);
+    BOOST_CHECK(addr.isEvent(4));
+    BOOST_CHECK(!addr.isEvent(3));
+
+    NetlinkBuffer none;
+    BOOST_CHECK(!none.isEvent(3));
+}
+
+BOOST_AUTO_TEST_CASE(route) {
+    NetlinkBuffer route;
+    route.addRoute(RTM_NEWROUTE, 5);
+    BOOST_CHECK(route.isEvent(5));
+    BOOST_CHECK(!route.isEvent(6));
+
+    // a route without an output interface matches none
+    NetlinkBuffer noOif;
+    struct rtmsg rtm;
+    memset(&rtm, 0, sizeof(rtm));
+    noOif.add(RTM_DELROUTE, &rtm, sizeof(rtm));
+    BOOST_CHECK(!noOif.isEvent(5));
+}
+
+BOOST_AUTO_TEST_CASE(batch) {
+    // the matching message may follow any others in the buffer
+    NetlinkBuffer b;
+    b.addLink(RTM_NEWLINK, 1);
+    b.addAddr(RTM_NEWADDR, 2);
+    b.addRoute(RTM_NEWROUTE, 3);
+    BOOST_CHECK(b.isEvent(1));
+    BOOST_CHECK(b.isEvent(2));
+    BOOST_CHECK(b.isEvent(3));
+    BOOST_CHECK(!b.isEvent(4));
+}
+
+BOOST_AUTO_TEST_CASE(ignored) {
+    // other message types are skipped, even with a matching index
+    NetlinkBuffer other;
+    struct ifinfomsg ifi;
+    memset(&ifi, 0, sizeof(ifi));
+    ifi.ifi_index = 7;
+    other.add(RTM_NEWNEIGH, &ifi, sizeof(ifi));
+    other.add(NLMSG_DONE, &ifi, sizeof(ifi));
+    BOOST_CHECK(!other.isEvent(7));
+
+    // a message too short for its type is skipped
+    NetlinkBuffer shortMsg;
+    int index = 7;
+    shortMsg.add(RTM_NEWLINK, &index, sizeof(index));
+    BOOST_CHECK(!shortMsg.isEvent(7));
+
+    // a message cut off by the end of the read is not parsed
+    NetlinkBuffer torn;
+    torn.addAddr(RTM_NEWADDR, 7);
+    BOOST_CHECK(!TunnelEpManager::isInterfaceEvent(torn.buf.data(),
+                                                   torn.buf.size() - 1, 7));
+}
+
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace opflexagent */
@@ -0,0 +1,63 @@
+/*
+ * Test suite for class WorkerPool
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/WorkerPool.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+namespace opflexagent {
+
+BOOST_AUTO_TEST_SUITE(WorkerPool_test)
+
+BOOST_AUTO_TEST_CASE(inline_loop) {
+    WorkerPool pool;
+    std::vector<size_t> order;
+    pool.forEach(4, [&order](size_t i) { order.push_back(i); });
+    std::vector<size_t> expected = { 0, 1, 2, 3 };
+    BOOST_CHECK_EQUAL_COLLECTIONS(order.begin(), order.end(),
+                                  expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(parallel) {
+    WorkerPool pool;
+    pool.start(3);
+    BOOST_CHECK_EQUAL(3, pool.size());
+
+    for (size_t round = 0; round < 100; ++round) {
+        std::vector<std::atomic<int>> counts(1000);
+        for (auto& c : counts) c = 0;
+        pool.forEach(counts.size(), [&counts](size_t i) { counts[i] += 1; });
+        for (auto& c : counts)
+            BOOST_REQUIRE_EQUAL(1, c.load());
+    }
+
+    pool.stop();
+    BOOST_CHECK_EQUAL(0, pool.size());
+}
+
+BOOST_AUTO_TEST_CASE(exception) {
+    WorkerPool pool;
+    pool.start(2);
+    std::atomic<size_t> calls(0);
+    BOOST_CHECK_THROW(pool.forEach(100, [&calls](size_t i) {
+                calls += 1;
+                if (i == 42)
+                    throw std::runtime_error("failed");
+            }), std::runtime_error);
+    BOOST_CHECK_EQUAL(100, calls.load());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace opflexagent */
@@ -0,0 +1,79 @@
+/*
+ * Test suite for the rate limited and sampled logging
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/logging.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+#include <thread>
+
+namespace opflexagent {
+
+BOOST_AUTO_TEST_SUITE(logging_test)
+
+BOOST_AUTO_TEST_CASE(rate_limit) {
+    LogRateLimiter limiter(2, 100);
+    BOOST_CHECK(limiter.allow());
+    BOOST_CHECK(limiter.allow());
+    for (int i = 0; i < 5; ++i)
+        BOOST_CHECK(!limiter.allow());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    LogAllowance a = limiter.allow();
+    BOOST_CHECK(a);
+    BOOST_CHECK_EQUAL(5, a.suppressed);
+    std::stringstream ss;
+    ss << a;
+    BOOST_CHECK_EQUAL("[5 similar messages suppressed] ", ss.str());
+    a = limiter.allow();
+    BOOST_CHECK(a);
+    BOOST_CHECK_EQUAL(0, a.suppressed);
+    ss.str("");
+    ss << a;
+    BOOST_CHECK_EQUAL("", ss.str());
+}
+
+BOOST_AUTO_TEST_CASE(sample) {
+    LogSampler sampler(3);
+    LogAllowance a = sampler.allow();
+    BOOST_CHECK(a);
+    BOOST_CHECK_EQUAL(0, a.suppressed);
+    BOOST_CHECK(!sampler.allow());
+    BOOST_CHECK(!sampler.allow());
+    a = sampler.allow();
+    BOOST_CHECK(a);
+    BOOST_CHECK_EQUAL(2, a.suppressed);
+}
+
+BOOST_AUTO_TEST_CASE(macros) {
+    LogLevel saved = logLevel;
+    logLevel = FATAL;
+    int evaluated = 0;
+    for (int i = 0; i < 10; ++i) {
+        LOG_RATE_LIMITED(DEBUG, 1, 1000) << ++evaluated;
+        LOG_SAMPLED(DEBUG, 2) << ++evaluated;
+    }
+    // disabled levels do not format the message
+    BOOST_CHECK_EQUAL(0, evaluated);
+
+    logLevel = TRACE;
+    for (int i = 0; i < 10; ++i)
+        LOG_RATE_LIMITED(TRACE, 1, 60000) << ++evaluated;
+    BOOST_CHECK_EQUAL(1, evaluated);
+    for (int i = 0; i < 10; ++i)
+        LOG_SAMPLED(TRACE, 5) << ++evaluated;
+    BOOST_CHECK_EQUAL(3, evaluated);
+    logLevel = saved;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace opflexagent */
@@ -16,6 +16,7 @@
 #include "eth.h"
 #include "ip.h"
 #include <opflexagent/logging.h>
+#include <opflex/util/ThreadSettings.h>
 
 #include <boost/system/error_code.hpp>
 #include <boost/algorithm/string/find_iterator.hpp>
@@ -45,11 +46,12 @@ using boost::copy_range;
 using boost::optional;
 
 static const char* ID_NAMESPACES[] =
-    {"secGroup", "secGroupSet"};
+    {"secGroup", "secGroupSet", "secGroupConj"};
 
 static const int VMM_DOMAIN_DN_PARTS = 4;
 static const char* ID_NMSPC_SECGROUP     = ID_NAMESPACES[0];
 static const char* ID_NMSPC_SECGROUP_SET = ID_NAMESPACES[1];
+static const char* ID_NMSPC_SECGROUP_CONJ = ID_NAMESPACES[2];
 
 void AccessFlowManager::populateTableDescriptionMap(
         SwitchManager::TableDescriptionMap &fwdTblDescr) {
@@ -80,8 +82,10 @@ AccessFlowManager::AccessFlowManager(Agent& agent_,
                                      IdGenerator& idGen_,
                                      CtZoneManager& ctZoneManager_)
     : agent(agent_), switchManager(switchManager_), idGen(idGen_),
-      ctZoneManager(ctZoneManager_), taskQueue(agent.getAgentIOService()),
-      conntrackEnabled(false), stopping(false), dropLogRemotePort(0) {
+      ctZoneManager(ctZoneManager_), dedicatedThread(false),
+      conntrackEnabled(false), conjunctiveSecGroups(false),
+      updateDebounce(0), updateMaxDebounce(0),
+      stopping(false), dropLogRemotePort(0) {
     // set up flow tables
     switchManager.setMaxFlowTables(NUM_FLOW_TABLES);
     SwitchManager::TableDescriptionMap fwdTblDescr;
@@ -104,7 +108,27 @@ void AccessFlowManager::enableConnTrack() {
     conntrackEnabled = true;
 }
 
+boost::asio::io_service& AccessFlowManager::getIOService() {
+    return dedicatedThread ? flowIOService : agent.getAgentIOService();
+}
+
+void AccessFlowManager::setDedicatedThread(bool enabled) {
+    dedicatedThread = enabled;
+}
+
 void AccessFlowManager::start() {
+    taskQueue.reset(new TaskQueue(getIOService()));
+    taskQueue->setWatchdog(&agent.getTaskWatchdog(), "access_flow");
+    if (dedicatedThread) {
+        // the switch manager calls back into this manager, so it
+        // runs on the same thread
+        switchManager.setIOService(flowIOService);
+        flowIOWork.reset(new boost::asio::io_service::work(flowIOService));
+        flowThread.reset(new std::thread(
+            opflex::util::startThread("access_flows",
+                                      [this]() { flowIOService.run(); })));
+    }
+
     switchManager.getPortMapper().registerPortStatusListener(this);
     agent.getEndpointManager().registerListener(this);
     agent.getLearningBridgeManager().registerListener(this);
@@ -126,22 +150,65 @@ void AccessFlowManager::stop() {
     agent.getLearningBridgeManager().unregisterListener(this);
     agent.getPolicyManager().unregisterListener(this);
     agent.getQosManager().unregisterListener(this);
+
+    if (flowThread) {
+        flowIOWork.reset();
+        flowIOService.stop();
+        flowThread->join();
+        flowThread.reset();
+    }
 }
 
+static const string ENDPOINT_BATCH_ITEM("endpoint-batch");
+
 void AccessFlowManager::endpointUpdated(const string& uuid) {
     if (stopping) return;
-    taskQueue.dispatch(uuid, [=](){ handleEndpointUpdate(uuid); });
+    {
+        const std::lock_guard<std::mutex> lock(endpointUpdateMutex);
+        endpointUpdates.insert(uuid);
+    }
+    taskQueue->dispatch(ENDPOINT_BATCH_ITEM,
+                       [this](){ handleEndpointBatch(); });
+}
+
+void AccessFlowManager::endpointsUpdated(const unordered_set<string>& uuids) {
+    if (stopping || uuids.empty()) return;
+    {
+        const std::lock_guard<std::mutex> lock(endpointUpdateMutex);
+        endpointUpdates.insert(uuids.begin(), uuids.end());
+    }
+    taskQueue->dispatch(ENDPOINT_BATCH_ITEM,
+                       [this](){ handleEndpointBatch(); });
+}
+
+void AccessFlowManager::handleEndpointBatch() {
+    unordered_set<string> uuids;
+    {
+        const std::lock_guard<std::mutex> lock(endpointUpdateMutex);
+        uuids.swap(endpointUpdates);
+    }
+
+    // the flows of all the endpoints go to the switch together
+    SwitchManager::Batch batch(switchManager);
+    for (const string& uuid : uuids) {
+        try {
+            handleEndpointUpdate(uuid);
+        } catch (const std::exception& e) {
+            LOG(ERROR) << "Exception while updating endpoint " << uuid
+                       << ": " << e.what();
+        }
+    }
 }
 
 void AccessFlowManager::dscpQosUpdated(const string& interface, uint8_t dscp) {
     if (stopping) return;
-    taskQueue.dispatch(interface, [=]() { handleDscpQosUpdate(interface, dscp); });
+    taskQueue->dispatch(interface, [=]() { handleDscpQosUpdate(interface, dscp); });
 }
 
 void AccessFlowManager::secGroupSetUpdated(const uri_set_t& secGrps) {
     if (stopping) return;
     const string id = getSecGrpSetId(secGrps);
-    taskQueue.dispatch("set:" + id,
+    taskQueue->dispatch("set:" + id,
                        [=]() { handleSecGrpSetUpdate(secGrps, id); });
 }
 
@@ -152,17 +219,48 @@ void AccessFlowManager::configUpdated(const opflex::modb::URI& configURI) {
 
 void AccessFlowManager::secGroupUpdated(const opflex::modb::URI& uri) {
     if (stopping) return;
-    taskQueue.dispatch("secgrp:" + uri.toString(),
-                       [=]() { handleSecGrpUpdate(uri); });
+    {
+        const std::lock_guard<std::mutex> lock(secGrpUpdateMutex);
+        secGrpUpdates[uri].full = true;
+    }
+    taskQueue->dispatchDebounced("secgrp:" + uri.toString(), updateDebounce,
+                                [=]() { handleSecGrpUpdate(uri); },
+                                updateMaxDebounce);
+}
+
+void AccessFlowManager::secGroupDeltaUpdated(const opflex::modb::URI& uri,
+                                             const SecGroupDelta& delta) {
+    if (stopping) return;
+    {
+        const std::lock_guard<std::mutex> lock(secGrpUpdateMutex);
+        SecGrpUpdate& update = secGrpUpdates[uri];
+        for (const auto* rules : {&delta.rulesAdded, &delta.rulesRemoved}) {
+            for (const shared_ptr<PolicyRule>& r : *rules)
+                update.classifiers.insert(r->getL24Classifier()->getURI());
+        }
+    }
+    taskQueue->dispatchDebounced("secgrp:" + uri.toString(), updateDebounce,
+                                [=]() { handleSecGrpUpdate(uri); },
+                                updateMaxDebounce);
 }
 
 void AccessFlowManager::portStatusUpdate(const string& portName,
                                          uint32_t portNo, bool) {
     if (stopping) return;
-    agent.getAgentIOService()
+    getIOService()
         .dispatch([=]() { handlePortStatusUpdate(portName, portNo); });
 }
 
+void AccessFlowManager::setUpdateDebounce(std::chrono::milliseconds delay,
+                                          std::chrono::milliseconds maxDelay) {
+    updateDebounce = delay;
+    updateMaxDebounce = maxDelay;
+}
+
+void AccessFlowManager::setConjunctiveSecGroups(bool enabled) {
+    conjunctiveSecGroups = enabled;
+}
+
 void AccessFlowManager::setDropLog(const string& dropLogPort, const string& dropLogRemoteIp,
         const uint16_t _dropLogRemotePort) {
     dropLogIface = dropLogPort;
@@ -299,16 +397,8 @@ static void flowBypassServiceIP(FlowEntryList& el,
                                 uint32_t accessPort, uint32_t uplinkPort,
                                 std::shared_ptr<const Endpoint>& ep ) {
 
-    for (const string& epipStr : ep->getIPs()) {
-        network::cidr_t cidr;
-        if (!network::cidr_from_string(epipStr, cidr, false))
-            continue;
-        for (const string& svcipStr : ep->getServiceIPs()) {
-            boost::system::error_code ec;
-            address serviceAddr =
-                address::from_string(svcipStr, ec);
-            if (ec) continue;
-
+    for (const network::cidr_t& cidr : ep->getIPCidrs()) {
+        for (const address& serviceAddr : ep->getServiceAddresses()) {
             FlowBuilder ingress, egress;
             ingress.priority(10)
                    .ethType(eth::type::IP)
@@ -412,18 +502,7 @@ void AccessFlowManager::createStaticFlows() {
                 .action().go(SERVICE_BYPASS_TABLE_ID)
                 .parent().build(dropLogFlows);
         switchManager.writeFlow("static", DROP_LOG_TABLE_ID, dropLogFlows);
-        /* Insert a flow at the end of every table to match dropped packets
-         * and go to the drop table where it will be punted to a port when configured
-         */
-        for(unsigned table_id = SERVICE_BYPASS_TABLE_ID; table_id < EXP_DROP_TABLE_ID; table_id++) {
-            FlowEntryList dropLogFlow;
-            FlowBuilder().priority(0).cookie(flow::cookie::TABLE_DROP_FLOW)
-                    .flags(OFPUTIL_FF_SEND_FLOW_REM)
-                    .action().dropLog(table_id)
-                    .go(EXP_DROP_TABLE_ID)
-                    .parent().build(dropLogFlow);
-            switchManager.writeFlow("DropLogFlow", table_id, dropLogFlow);
-        }
+        updateTableDropFlows();
         handleDropLogPortUpdate();
     }
     {
@@ -622,7 +701,8 @@ void AccessFlowManager::handleEndpointUpdate(const string& uuid) {
          * We allow both with / without tags to handle Openshift
          * bootstrap
          */
-        optional<Endpoint::DHCPv4Config> v4c = ep->getDHCPv4Config();
+        const shared_ptr<const Endpoint::DHCPv4Config>& v4c =
+            ep->getDHCPv4Config();
         if (v4c) {
             flowBypassDhcpRequest(el, true, false, accessPort,
                                   uplinkPort, ep);
@@ -631,7 +711,8 @@ void AccessFlowManager::handleEndpointUpdate(const string& uuid) {
                                       uplinkPort, ep);
         }
 
-        optional<Endpoint::DHCPv6Config> v6c = ep->getDHCPv6Config();
+        const shared_ptr<const Endpoint::DHCPv6Config>& v6c =
+            ep->getDHCPv6Config();
         if(v6c) {
             flowBypassDhcpRequest(el, false, false, accessPort,
                                   uplinkPort, ep);
@@ -758,6 +839,76 @@ void AccessFlowManager::handleDscpQosUpdate(const string& interface, uint8_t dsc
     switchManager.writeFlow(objIdV6, 0, dscpFlowV6);
 }
 
+void AccessFlowManager::updateTableDropFlows() {
+    using flowutils::is_drop_sampled;
+    using flowutils::drop_sample_group;
+    PacketDropLogSampling sampling =
+        agent.getExtraConfigManager().getPacketDropLogSampling();
+    SwitchManager::TableDescriptionMap tableDesc;
+    populateTableDescriptionMap(tableDesc);
+
+    // the sampling groups are added before the flows that use them
+    // and removed after
+    SwitchManager::Batch batch(switchManager);
+    /* Insert a flow at the end of every table to match dropped packets
+     * and go to the drop table, directly or through a sampling group,
+     * where it will be punted to a port when configured
+     */
+    for(unsigned table_id = SERVICE_BYPASS_TABLE_ID; table_id < EXP_DROP_TABLE_ID; table_id++) {
+        auto it = tableDesc.find(table_id);
+        double p = (it != tableDesc.end())
+            ? sampling.getProbability("Acc-" + it->second.first)
+            : sampling.probability;
+        auto git = dropSampleGroups.find(table_id);
+        if (is_drop_sampled(p)) {
+            if (git == dropSampleGroups.end() || git->second != p) {
+                uint16_t comm = (git == dropSampleGroups.end())
+                    ? OFPGC11_ADD : OFPGC11_MODIFY;
+                switchManager.writeGroupMod(
+                    drop_sample_group(comm, table_id, EXP_DROP_TABLE_ID, p));
+                dropSampleGroups[table_id] = p;
+            }
+        } else if (git != dropSampleGroups.end()) {
+            switchManager.writeGroupMod(
+                drop_sample_group(OFPGC11_DELETE, table_id,
+                                  EXP_DROP_TABLE_ID, p));
+            dropSampleGroups.erase(git);
+        }
+        switchManager.writeFlow("DropLogFlow", table_id,
+                                flowutils::table_drop_flow(table_id,
+                                                           EXP_DROP_TABLE_ID,
+                                                           p));
+    }
+}
+
+GroupEdit AccessFlowManager::reconcileGroups(GroupMap& recvGroups) {
+    GroupEdit ge;
+    for (const auto& kv : dropSampleGroups) {
+        uint32_t groupId = flowutils::DROP_SAMPLE_GROUP_BASE + kv.first;
+        auto itr = recvGroups.find(groupId);
+        uint16_t comm = OFPGC11_ADD;
+        GroupEdit::Entry recv;
+        if (itr != recvGroups.end()) {
+            comm = OFPGC11_MODIFY;
+            recv = itr->second;
+            recvGroups.erase(itr);
+        }
+        GroupEdit::Entry e0 =
+            flowutils::drop_sample_group(comm, kv.first, EXP_DROP_TABLE_ID,
+                                         kv.second);
+        if (!GroupEdit::groupEq(e0, recv)) {
+            ge.edits.push_back(e0);
+        }
+    }
+    for (const GroupMap::value_type& kv : recvGroups) {
+        GroupEdit::Entry e0(new GroupEdit::GroupMod());
+        e0->mod->command = OFPGC11_DELETE;
+        e0->mod->group_id = kv.first;
+        ge.edits.push_back(e0);
+    }
+    return ge;
+}
+
 void AccessFlowManager::handleDropLogPortUpdate() {
     FlowEntryList catchDropFlows;
     if(dropLogIface.empty() || !dropLogDst.is_v4()) {
@@ -792,10 +943,46 @@ void AccessFlowManager::handlePortStatusUpdate(const string& portName,
 }
 
 void AccessFlowManager::handleSecGrpUpdate(const opflex::modb::URI& uri) {
+    SecGrpUpdate update;
+    {
+        const std::lock_guard<std::mutex> lock(secGrpUpdateMutex);
+        auto it = secGrpUpdates.find(uri);
+        if (it == secGrpUpdates.end())
+            return;             // handled by an earlier run
+        update = std::move(it->second);
+        secGrpUpdates.erase(it);
+    }
+    if (!update.full && update.classifiers.empty())
+        return;
+
+    bool system_sec_group = checkIfSystemSecurityGroup(uri.toString());
+    if (conjunctiveSecGroups && !system_sec_group)
+        updateSecGrpConjunctions(uri);
+
     unordered_set<uri_set_t> secGrpSets;
     agent.getEndpointManager().getSecGrpSetsForSecGrp(uri, secGrpSets);
-    for (const uri_set_t& secGrpSet : secGrpSets)
-        secGroupSetUpdated(secGrpSet);
+    if (update.full || conjunctiveSecGroups || system_sec_group) {
+        for (const uri_set_t& secGrpSet : secGrpSets)
+            secGroupSetUpdated(secGrpSet);
+        return;
+    }
+
+    // rewrite only the objects of the classifiers that changed
+    LOG(DEBUG) << "Updating " << update.classifiers.size()
+               << " classifiers of security group " << uri;
+    for (const uri_set_t& secGrpSet : secGrpSets) {
+        const string id = getSecGrpSetId(secGrpSet);
+        if (secGrpSetRuleObjs.find(id) == secGrpSetRuleObjs.end()) {
+            // the set has no rule flows yet
+            secGroupSetUpdated(secGrpSet);
+            continue;
+        }
+        uint32_t secGrpSetId = idGen.getId(ID_NMSPC_SECGROUP_SET, id);
+        SecGrpRuleObjs ruleObjs;
+        addSecGrpRuleObjs(uri, secGrpSetId, id, &update.classifiers,
+                          ruleObjs);
+        writeSecGrpRuleObjs(id, ruleObjs, false);
+    }
 }
 
 bool AccessFlowManager::checkIfSystemSecurityGroup(const string& uri){
@@ -822,8 +1009,11 @@ bool AccessFlowManager::checkIfSystemSecurityGroup(const string& uri){
     return false;
 }
 
-void AccessFlowManager::handleSecGrpSetUpdate(const uri_set_t& secGrps,
-                                              const string& secGrpsIdStr) {
+void AccessFlowManager::addSecGrpRuleFlows(const shared_ptr<PolicyRule>& pc,
+                                           bool isSystemRule,
+                                           uint32_t secGrpSetId,
+                                           FlowEntryList& secGrpIn,
+                                           FlowEntryList& secGrpOut) {
     using modelgbp::gbpe::L24Classifier;
     using modelgbp::gbp::DirectionEnumT;
     using modelgbp::gbp::ConnTrackEnumT;
@@ -835,13 +1025,536 @@ void AccessFlowManager::handleSecGrpSetUpdate(const uri_set_t& secGrps,
     using flowutils::CA_REFLEX_FWD_EST;
     using flowutils::CA_REFLEX_REV_RELATED;
 
+    int ingress_table = SEC_GROUP_IN_TABLE_ID;
+    int egress_table = SEC_GROUP_OUT_TABLE_ID;
+    int after_ingress_table = TAP_TABLE_ID;
+    int after_egress_table = TAP_TABLE_ID;
+
+    if (isSystemRule) {
+        ingress_table = SYS_SEC_GRP_IN_TABLE_ID;
+        egress_table = SYS_SEC_GRP_OUT_TABLE_ID;
+
+        after_ingress_table = SEC_GROUP_IN_TABLE_ID;
+        after_egress_table = SEC_GROUP_OUT_TABLE_ID;
+    }
+
+    uint8_t dir = pc->getDirection();
+    bool skipL34 = false;
+    const shared_ptr<L24Classifier>& cls = pc->getL24Classifier();
+    const URI& ruleURI = cls.get()->getURI();
+    uint64_t secGrpCookie =
+        idGen.getId("l24classifierRule", ruleURI.toString());
+    // decode the classifier once for all the flows of the rule
+    flowutils::ClassifierMatch match;
+    flowutils::compile_classifier(*cls, match);
+    boost::optional<const network::subnets_t&> remoteSubs;
+    boost::optional<const network::service_ports_t&> namedSvcPorts;
+    if (!pc->getRemoteSubnets().empty() || !pc->getNamedServicePorts().empty()) {
+        remoteSubs = pc->getRemoteSubnets();
+        namedSvcPorts = pc->getNamedServicePorts();
+    } else {
+        skipL34 = !agent.addL34FlowsWithoutSubnet();
+        LOG(DEBUG) << "skipL34 flows: " << skipL34
+                   << " for rule: " << ruleURI;
+    }
+
+    bool log = false;
+    flowutils::ClassAction act = flowutils::CA_DENY;
+
+    if (pc->getAllow()) {
+        if (cls->getConnectionTracking(ConnTrackEnumT::CONST_NORMAL) ==
+            ConnTrackEnumT::CONST_REFLEXIVE) {
+            act = CA_REFLEX_FWD;
+        } else {
+            act = CA_ALLOW;
+        }
+    }
+
+    if (pc->getLog()) {
+        log = pc->getLog();
+    }
+    /*
+     * Do not program higher level protocols
+     * when remote subnet is missing
+     * except when agent.addL34FlowsWithoutSubnet() == true
+     */
+    if (skipL34) {
+        if (dir == DirectionEnumT::CONST_BIDIRECTIONAL ||
+            dir == DirectionEnumT::CONST_IN) {
+            if (act == flowutils::CA_DENY) {
+                 flowutils::add_l2classifier_entries(match, act, log,
+                                                    EXP_DROP_TABLE_ID, ingress_table,
+                                                    EXP_DROP_TABLE_ID,
+                                                    pc->getPriority(),
+                                                    OFPUTIL_FF_SEND_FLOW_REM,
+                                                    secGrpCookie,
+                                                    secGrpSetId, 0,
+                                                    isSystemRule,
+                                                    secGrpIn);
+            } else {
+                 flowutils::add_l2classifier_entries(match, act, log,
+                                                     after_ingress_table, ingress_table,
+                                                     EXP_DROP_TABLE_ID,
+                                                     pc->getPriority(),
+                                                     OFPUTIL_FF_SEND_FLOW_REM,
+                                                     secGrpCookie,
+                                                     secGrpSetId, 0,
+                                                     isSystemRule,
+                                                     secGrpIn);
+            }
+        }
+        if (dir == DirectionEnumT::CONST_BIDIRECTIONAL ||
+            dir == DirectionEnumT::CONST_OUT) {
+            if (act == flowutils::CA_DENY) {
+                 flowutils::add_l2classifier_entries(match, act, log,
+                                                    EXP_DROP_TABLE_ID, egress_table,
+                                                    EXP_DROP_TABLE_ID,
+                                                    pc->getPriority(),
+                                                    OFPUTIL_FF_SEND_FLOW_REM,
+                                                    secGrpCookie,
+                                                    secGrpSetId, 0,
+                                                    isSystemRule,
+                                                    secGrpOut);
+            } else {
+                 flowutils::add_l2classifier_entries(match, act, log,
+                                                     after_egress_table, egress_table,
+                                                     EXP_DROP_TABLE_ID,
+                                                     pc->getPriority(),
+                                                     OFPUTIL_FF_SEND_FLOW_REM,
+                                                     secGrpCookie,
+                                                     secGrpSetId, 0,
+                                                     isSystemRule,
+                                                     secGrpOut);
+              }
+        }
+        continue;
+    }
+
+    if (dir == DirectionEnumT::CONST_BIDIRECTIONAL ||
+        dir == DirectionEnumT::CONST_IN) {
+        if (act == flowutils::CA_DENY) {
+                 flowutils::add_classifier_entries(match, act, log,
+                                                  remoteSubs,
+                                                  boost::none,
+                                                  boost::none,
+                                                  EXP_DROP_TABLE_ID, ingress_table,
+                                                  EXP_DROP_TABLE_ID,
+                                                  pc->getPriority(),
+                                                  OFPUTIL_FF_SEND_FLOW_REM,
+                                                  secGrpCookie,
+                                                  secGrpSetId, 0,
+                                                  isSystemRule,
+                                                  secGrpIn);
+        }  else {
+                 flowutils::add_classifier_entries(match, act, log,
+                                                   remoteSubs,
+                                                   boost::none,
+                                                   boost::none,
+                                                   after_ingress_table, ingress_table,
+                                                   EXP_DROP_TABLE_ID,
+                                                   pc->getPriority(),
+                                                   OFPUTIL_FF_SEND_FLOW_REM,
+                                                   secGrpCookie,
+                                                   secGrpSetId, 0,
+                                                   isSystemRule,
+                                                   secGrpIn);
+           }
+        if (act == CA_REFLEX_FWD) {
+            flowutils::add_classifier_entries(match, CA_REFLEX_FWD_TRACK, log,
+                                              remoteSubs,
+                                              boost::none,
+                                              boost::none,
+                                              GROUP_MAP_TABLE_ID, ingress_table,
+                                              EXP_DROP_TABLE_ID,
+                                              pc->getPriority(),
+                                              OFPUTIL_FF_SEND_FLOW_REM,
+                                              secGrpCookie,
+                                              secGrpSetId, 0,
+                                              isSystemRule,
+                                              secGrpIn);
+            flowutils::add_classifier_entries(match, CA_REFLEX_FWD_EST, log,
+                                              remoteSubs,
+                                              boost::none,
+                                              boost::none,
+                                              after_ingress_table, ingress_table,
+                                              EXP_DROP_TABLE_ID,
+                                              pc->getPriority(),
+                                              OFPUTIL_FF_SEND_FLOW_REM,
+                                              secGrpCookie,
+                                              secGrpSetId, 0,
+                                              isSystemRule,
+                                              secGrpIn);
+            // add reverse entries for reflexive classifier
+            flowutils::add_classifier_entries(match, CA_REFLEX_REV_TRACK, log,
+                                              boost::none,
+                                              remoteSubs,
+                                              namedSvcPorts,
+                                              GROUP_MAP_TABLE_ID, egress_table,
+                                              EXP_DROP_TABLE_ID,
+                                              pc->getPriority(),
+                                              OFPUTIL_FF_SEND_FLOW_REM,
+                                              0,
+                                              secGrpSetId, 0,
+                                              isSystemRule,
+                                              secGrpOut);
+            flowutils::add_classifier_entries(match, CA_REFLEX_REV_ALLOW, log,
+                                              boost::none,
+                                              remoteSubs,
+                                              namedSvcPorts,
+                                              after_egress_table, egress_table,
+                                              EXP_DROP_TABLE_ID,
+                                              pc->getPriority(),
+                                              OFPUTIL_FF_SEND_FLOW_REM,
+                                              secGrpCookie,
+                                              secGrpSetId, 0,
+                                              isSystemRule,
+                                              secGrpOut);
+            flowutils::add_classifier_entries(match, CA_REFLEX_REV_RELATED, log,
+                                              boost::none,
+                                              remoteSubs,
+                                              namedSvcPorts,
+                                              after_egress_table, egress_table,
+                                              EXP_DROP_TABLE_ID,
+                                              pc->getPriority(),
+                                              OFPUTIL_FF_SEND_FLOW_REM,
+                                              secGrpCookie,
+                                              secGrpSetId, 0,
+                                              isSystemRule,
+                                              secGrpOut);
+        }
+    }
+    if (dir == DirectionEnumT::CONST_BIDIRECTIONAL ||
+        dir == DirectionEnumT::CONST_OUT) {
+        if (act == flowutils::CA_DENY) {
+            flowutils::add_classifier_entries(match, act, log,
+                                              boost::none,
+                                              remoteSubs,
+                                              namedSvcPorts,
+                                              EXP_DROP_TABLE_ID, egress_table,
+                                              EXP_DROP_TABLE_ID,
+                                              pc->getPriority(),
+                                              OFPUTIL_FF_SEND_FLOW_REM,
+                                              secGrpCookie,
+                                              secGrpSetId, 0,
+                                              isSystemRule,
+                                              secGrpOut);
+        } else {
+              flowutils::add_classifier_entries(match, act, log,
+                                                boost::none,
+                                                remoteSubs,
+                                                namedSvcPorts,
+                                                after_egress_table, egress_table,
+                                                EXP_DROP_TABLE_ID,
+                                                pc->getPriority(),
+                                                OFPUTIL_FF_SEND_FLOW_REM,
+                                                secGrpCookie,
+                                                secGrpSetId, 0,
+                                                isSystemRule,
+                                                secGrpOut);
+          }
+        if (act == CA_REFLEX_FWD) {
+            flowutils::add_classifier_entries(match, CA_REFLEX_FWD_TRACK, log,
+                                              boost::none,
+                                              remoteSubs,
+                                              namedSvcPorts,
+                                              GROUP_MAP_TABLE_ID, egress_table,
+                                              EXP_DROP_TABLE_ID,
+                                              pc->getPriority(),
+                                              OFPUTIL_FF_SEND_FLOW_REM,
+                                              secGrpCookie,
+                                              secGrpSetId, 0,
+                                              isSystemRule,
+                                              secGrpOut);
+            flowutils::add_classifier_entries(match, CA_REFLEX_FWD_EST, log,
+                                              boost::none,
+                                              remoteSubs,
+                                              namedSvcPorts,
+                                              after_egress_table, egress_table,
+                                              EXP_DROP_TABLE_ID,
+                                              pc->getPriority(),
+                                              OFPUTIL_FF_SEND_FLOW_REM,
+                                              secGrpCookie,
+                                              secGrpSetId, 0,
+                                              isSystemRule,
+                                              secGrpOut);
+            // add reverse entries for reflexive classifier
+            flowutils::add_classifier_entries(match, CA_REFLEX_REV_TRACK, log,
+                                              remoteSubs,
+                                              boost::none,
+                                              boost::none,
+                                              GROUP_MAP_TABLE_ID, ingress_table,
+                                              EXP_DROP_TABLE_ID,
+                                              pc->getPriority(),
+                                              OFPUTIL_FF_SEND_FLOW_REM,
+                                              0,
+                                              secGrpSetId, 0,
+                                              isSystemRule,
+                                              secGrpIn);
+            flowutils::add_classifier_entries(match, CA_REFLEX_REV_ALLOW, log,
+                                              remoteSubs,
+                                              boost::none,
+                                              boost::none,
+                                              after_ingress_table, ingress_table,
+                                              EXP_DROP_TABLE_ID,
+                                              pc->getPriority(),
+                                              OFPUTIL_FF_SEND_FLOW_REM,
+                                              secGrpCookie,
+                                              secGrpSetId, 0,
+                                              isSystemRule,
+                                              secGrpIn);
+            flowutils::add_classifier_entries(match, CA_REFLEX_REV_RELATED, log,
+                                              remoteSubs,
+                                              boost::none,
+                                              boost::none,
+                                              after_ingress_table, ingress_table,
+                                              EXP_DROP_TABLE_ID,
+                                              pc->getPriority(),
+                                              OFPUTIL_FF_SEND_FLOW_REM,
+                                              secGrpCookie,
+                                              secGrpSetId, 0,
+                                              isSystemRule,
+                                              secGrpIn);
+        }
+    }
+}
+
+bool AccessFlowManager::addSecGrpRuleFlows(const URI& secGrp,
+                                           uint32_t secGrpSetId,
+                                           FlowEntryList& secGrpIn,
+                                           FlowEntryList& secGrpOut) {
+    PolicyManager::rule_list_t rules;
+    agent.getPolicyManager().getSecGroupRules(secGrp, rules);
+
+    bool system_sec_group = checkIfSystemSecurityGroup(secGrp.toString());
+    for (const shared_ptr<PolicyRule>& pc : rules) {
+        addSecGrpRuleFlows(pc, system_sec_group, secGrpSetId,
+                           secGrpIn, secGrpOut);
+    }
+    return !rules.empty();
+}
+
+/*
+ * The object ID of the flows of the rules with a classifier in a
+ * security group, for a security group set
+ */
+static string secGrpRuleObjId(const string& secGrpsIdStr,
+                              const URI& secGrp, const URI& clsURI) {
+    return secGrpsIdStr + "|" + secGrp.toString() + "|" + clsURI.toString();
+}
+
+void AccessFlowManager::addSecGrpRuleObjs(const URI& secGrp,
+                                          uint32_t secGrpSetId,
+                                          const string& secGrpsIdStr,
+                                          const uri_set_t* classifiers,
+                                          SecGrpRuleObjs& objs) {
+    if (classifiers) {
+        // rules no longer there leave their objects empty
+        for (const URI& clsURI : *classifiers)
+            objs[secGrpRuleObjId(secGrpsIdStr, secGrp, clsURI)];
+    }
+
+    PolicyManager::rule_list_t rules;
+    agent.getPolicyManager().getSecGroupRules(secGrp, rules);
+    for (const shared_ptr<PolicyRule>& pc : rules) {
+        const URI& clsURI = pc->getL24Classifier()->getURI();
+        if (classifiers && classifiers->find(clsURI) == classifiers->end())
+            continue;
+        auto& obj = objs[secGrpRuleObjId(secGrpsIdStr, secGrp, clsURI)];
+        addSecGrpRuleFlows(pc, false, secGrpSetId, obj.first, obj.second);
+    }
+}
+
+void AccessFlowManager::writeSecGrpRuleObjs(const string& secGrpsIdStr,
+                                            SecGrpRuleObjs& objs,
+                                            bool full) {
+    std::unordered_set<string>& written = secGrpSetRuleObjs[secGrpsIdStr];
+    if (full) {
+        for (const string& objId : written)
+            objs[objId];
+        written.clear();
+    }
+
+    vector<std::pair<string, FlowEntryList> > inObjs;
+    vector<std::pair<string, FlowEntryList> > outObjs;
+    for (auto& obj : objs) {
+        if (obj.second.first.empty() && obj.second.second.empty())
+            written.erase(obj.first);
+        else
+            written.insert(obj.first);
+        inObjs.emplace_back(obj.first, std::move(obj.second.first));
+        outObjs.emplace_back(obj.first, std::move(obj.second.second));
+    }
+    if (written.empty())
+        secGrpSetRuleObjs.erase(secGrpsIdStr);
+
+    if (!inObjs.empty()) {
+        switchManager.writeFlows(SEC_GROUP_IN_TABLE_ID, inObjs);
+        switchManager.writeFlows(SEC_GROUP_OUT_TABLE_ID, outObjs);
+    }
+}
+
+void AccessFlowManager::updateSecGrpConjunctions(const URI& secGrp,
+                                                 bool remove) {
+    const string& secGrpId = secGrp.toString();
+    LOG(DEBUG) << (remove ? "Removing" : "Updating")
+               << " conjunctions of security group " << secGrpId;
+
+    // the rule flows without the set, which become the classifier
+    // clause of the conjunctions
+    FlowEntryList ruleIn;
+    FlowEntryList ruleOut;
+    if (!remove)
+        addSecGrpRuleFlows(secGrp, 0, ruleIn, ruleOut);
+
+    SecGrpConj newConj;
+    std::unordered_map<string, SecGrpClause> newClauses;
+    FlowEntryList conjIn;
+    FlowEntryList conjOut;
+
+    auto addConjs = [&](uint8_t tableId, const FlowEntryList& ruleFlows,
+                        SecGrpConjMap& conjMap, FlowEntryList& conjFlows) {
+        // the rule flows of a priority with the same cookie and
+        // actions share a conjunction, whose flow takes the actions
+        std::map<uint16_t, vector<std::pair<FlowEntryPtr, uint32_t> > > prios;
+        for (const FlowEntryPtr& fe : ruleFlows) {
+            uint16_t prio = fe->entry->priority;
+            auto& conjs = prios[prio];
+            uint32_t conjId = 0;
+            for (auto& c : conjs) {
+                if (c.first->entry->cookie == fe->entry->cookie &&
+                    c.first->actionEq(fe.get())) {
+                    conjId = c.second;
+                    break;
+                }
+            }
+            if (conjId == 0) {
+                const string conjKey = secGrpId + "|" +
+                    std::to_string(tableId) + "|" + std::to_string(prio) +
+                    "|" + std::to_string(conjs.size());
+                conjId = idGen.getId(ID_NMSPC_SECGROUP_CONJ, conjKey);
+                conjs.emplace_back(fe, conjId);
+                conjMap[prio].insert(conjId);
+                newConj.conjKeys.insert(conjKey);
+
+                FlowBuilder f;
+                f.priority(prio)
+                    .cookie(fe->entry->cookie)
+                    .flags(fe->entry->flags)
+                    .conjId(conjId);
+                f.action().copy(fe->entry->ofpacts, fe->entry->ofpacts_len);
+                f.build(conjFlows);
+            }
+
+            std::ostringstream key;
+            key << "clause|" << (int)tableId << "|" << prio << "|"
+                << fe->entry->match;
+            SecGrpClause& clause = newClauses[key.str()];
+            if (!clause.match) {
+                clause.tableId = tableId;
+                clause.match = fe;
+            }
+            clause.conjs[secGrp].insert(conjId);
+        }
+    };
+    addConjs(SEC_GROUP_IN_TABLE_ID, ruleIn, newConj.inConjs, conjIn);
+    addConjs(SEC_GROUP_OUT_TABLE_ID, ruleOut, newConj.outConjs, conjOut);
+
+    const string conjObjId = "conj|" + secGrpId;
+    switchManager.writeFlow(conjObjId, SEC_GROUP_IN_TABLE_ID, conjIn);
+    switchManager.writeFlow(conjObjId, SEC_GROUP_OUT_TABLE_ID, conjOut);
+
+    SecGrpConj& oldConj = secGrpConjs[secGrp];
+    for (const string& conjKey : oldConj.conjKeys) {
+        if (newConj.conjKeys.find(conjKey) == newConj.conjKeys.end())
+            idGen.erase(ID_NMSPC_SECGROUP_CONJ, conjKey);
+    }
+
+    // update the shared clause flows the group used or now uses
+    std::set<string> touched(oldConj.clauses);
+    for (const string& key : oldConj.clauses) {
+        if (newClauses.find(key) != newClauses.end())
+            continue;
+        auto it = secGrpClauses.find(key);
+        if (it != secGrpClauses.end())
+            it->second.conjs.erase(secGrp);
+    }
+    for (auto& nc : newClauses) {
+        SecGrpClause& clause = secGrpClauses[nc.first];
+        if (!clause.match) {
+            clause.tableId = nc.second.tableId;
+            clause.match = nc.second.match;
+        }
+        clause.conjs[secGrp] = std::move(nc.second.conjs[secGrp]);
+        newConj.clauses.insert(nc.first);
+        touched.insert(nc.first);
+    }
+    for (const string& key : touched) {
+        auto it = secGrpClauses.find(key);
+        if (it == secGrpClauses.end())
+            continue;
+        if (it->second.conjs.empty()) {
+            switchManager.clearFlows(key, it->second.tableId);
+            secGrpClauses.erase(it);
+            continue;
+        }
+        std::set<uint32_t> all;
+        for (const auto& c : it->second.conjs)
+            all.insert(c.second.begin(), c.second.end());
+        FlowBuilder f;
+        f.matchOf(*it->second.match);
+        for (uint32_t conjId : all)
+            f.action().conjunction(conjId, 1, 2);
+        FlowEntryList clauseFlow;
+        f.build(clauseFlow);
+        switchManager.writeFlow(key, it->second.tableId, clauseFlow);
+    }
+
+    if (newConj.conjKeys.empty())
+        secGrpConjs.erase(secGrp);
+    else
+        oldConj = std::move(newConj);
+}
+
+/*
+ * Add the flows that match the packets of a security group set and
+ * contribute the set clause to the conjunctions of the rules of its
+ * groups
+ */
+static void add_set_conj_flows(uint32_t secGrpSetId,
+                               const std::map<uint16_t,
+                                              std::set<uint32_t> >& conjs,
+                               /* out */ FlowEntryList& flows) {
+    for (const auto& p : conjs) {
+        FlowBuilder f;
+        f.priority(p.first).reg(0, secGrpSetId);
+        for (uint32_t conjId : p.second)
+            f.action().conjunction(conjId, 0, 2);
+        f.build(flows);
+    }
+}
+
+void AccessFlowManager::handleSecGrpSetUpdate(const uri_set_t& secGrps,
+                                              const string& secGrpsIdStr) {
     LOG(DEBUG) << "Updating security group set \"" << secGrpsIdStr << "\"";
 
     if (agent.getEndpointManager().secGrpSetEmpty(secGrps)) {
+        SecGrpRuleObjs noObjs;
+        writeSecGrpRuleObjs(secGrpsIdStr, noObjs, true);
         switchManager.clearFlows(secGrpsIdStr, SEC_GROUP_IN_TABLE_ID);
         switchManager.clearFlows(secGrpsIdStr, SEC_GROUP_OUT_TABLE_ID);
         switchManager.clearFlows(secGrpsIdStr, SYS_SEC_GRP_IN_TABLE_ID);
         switchManager.clearFlows(secGrpsIdStr, SYS_SEC_GRP_OUT_TABLE_ID);
+
+        // the rules of the groups that no set uses any more go too
+        for (const opflex::modb::URI& secGrp : secGrps) {
+            if (secGrpConjs.find(secGrp) == secGrpConjs.end())
+                continue;
+            unordered_set<uri_set_t> secGrpSets;
+            agent.getEndpointManager().getSecGrpSetsForSecGrp(secGrp,
+                                                              secGrpSets);
+            if (secGrpSets.empty())
+                updateSecGrpConjunctions(secGrp, true);
+        }
         return;
     }
 
@@ -853,319 +1566,37 @@ void AccessFlowManager::handleSecGrpSetUpdate(const uri_set_t& secGrps,
     FlowEntryList sysSecGrpOut;
 
     bool any_system_sec_rule_configured = false;
+    SecGrpRuleObjs ruleObjs;
+    SecGrpConjMap inConjs;
+    SecGrpConjMap outConjs;
 
     for (const opflex::modb::URI& secGrp : secGrps) {
-        PolicyManager::rule_list_t rules;
-        agent.getPolicyManager().getSecGroupRules(secGrp, rules);
-
-        bool isSystemRule = false;
-        int ingress_table = SEC_GROUP_IN_TABLE_ID;
-        int egress_table = SEC_GROUP_OUT_TABLE_ID;
-        int after_ingress_table = TAP_TABLE_ID;
-        int after_egress_table = TAP_TABLE_ID;
-        
-        FlowEntryList *secGrpInRef = &secGrpIn;
-        FlowEntryList *secGrpOutRef = &secGrpOut;
-
-        bool system_sec_group = false;
-        std::string uri (secGrp.toString());
-
-        if (checkIfSystemSecurityGroup(secGrp.toString())){
-            system_sec_group = true;
-
-            ingress_table = SYS_SEC_GRP_IN_TABLE_ID;
-            egress_table = SYS_SEC_GRP_OUT_TABLE_ID;
-
-            after_ingress_table = SEC_GROUP_IN_TABLE_ID;
-            after_egress_table = SEC_GROUP_OUT_TABLE_ID;
-        
-            secGrpInRef = &sysSecGrpIn;
-            secGrpOutRef = &sysSecGrpOut;
-        }
-
-        for (shared_ptr<PolicyRule>& pc : rules) {
-            if (system_sec_group){
+        if (checkIfSystemSecurityGroup(secGrp.toString())) {
+            if (addSecGrpRuleFlows(secGrp, secGrpSetId,
+                                   sysSecGrpIn, sysSecGrpOut))
                 any_system_sec_rule_configured = true;
-                isSystemRule = true;
-            }
-
-            uint8_t dir = pc->getDirection();
-            bool skipL34 = false;
-            const shared_ptr<L24Classifier>& cls = pc->getL24Classifier();
-            const URI& ruleURI = cls.get()->getURI();
-            uint64_t secGrpCookie =
-                idGen.getId("l24classifierRule", ruleURI.toString());
-            boost::optional<const network::subnets_t&> remoteSubs;
-            boost::optional<const network::service_ports_t&> namedSvcPorts;
-            if (!pc->getRemoteSubnets().empty() || !pc->getNamedServicePorts().empty()) {
-                remoteSubs = pc->getRemoteSubnets();
-                namedSvcPorts = pc->getNamedServicePorts();
-            } else {
-                skipL34 = !agent.addL34FlowsWithoutSubnet();
-                LOG(DEBUG) << "skipL34 flows: " << skipL34
-                           << " for rule: " << ruleURI;
-            }
-
-            bool log = false;
-            flowutils::ClassAction act = flowutils::CA_DENY;
-
-            if (pc->getAllow()) {
-                if (cls->getConnectionTracking(ConnTrackEnumT::CONST_NORMAL) ==
-                    ConnTrackEnumT::CONST_REFLEXIVE) {
-                    act = CA_REFLEX_FWD;
-                } else {
-                    act = CA_ALLOW;
-                }
-            }
-
-            if (pc->getLog()) {
-                log = pc->getLog();
-            }
-            /*
-             * Do not program higher level protocols
-             * when remote subnet is missing
-             * except when agent.addL34FlowsWithoutSubnet() == true
-             */
-            if (skipL34) {
-                if (dir == DirectionEnumT::CONST_BIDIRECTIONAL ||
-                    dir == DirectionEnumT::CONST_IN) {
-                    if (act == flowutils::CA_DENY) {
-                         flowutils::add_l2classifier_entries(*cls, act, log,
-                                                            EXP_DROP_TABLE_ID, ingress_table,
-                                                            EXP_DROP_TABLE_ID,
-                                                            pc->getPriority(),
-                                                            OFPUTIL_FF_SEND_FLOW_REM,
-                                                            secGrpCookie,
-                                                            secGrpSetId, 0,
-                                                            isSystemRule,
-                                                            *secGrpInRef);
-                    } else {
-                         flowutils::add_l2classifier_entries(*cls, act, log,
-                                                             after_ingress_table, ingress_table,
-                                                             EXP_DROP_TABLE_ID,
-                                                             pc->getPriority(),
-                                                             OFPUTIL_FF_SEND_FLOW_REM,
-                                                             secGrpCookie,
-                                                             secGrpSetId, 0,
-                                                             isSystemRule,
-                                                             *secGrpInRef);
-                    }
-                }
-                if (dir == DirectionEnumT::CONST_BIDIRECTIONAL ||
-                    dir == DirectionEnumT::CONST_OUT) {
-                    if (act == flowutils::CA_DENY) {
-                         flowutils::add_l2classifier_entries(*cls, act, log,
-                                                            EXP_DROP_TABLE_ID, egress_table,
-                                                            EXP_DROP_TABLE_ID,
-                                                            pc->getPriority(),
-                                                            OFPUTIL_FF_SEND_FLOW_REM,
-                                                            secGrpCookie,
-                                                            secGrpSetId, 0,
-                                                            isSystemRule,
-                                                            *secGrpOutRef);
-                    } else {
-                         flowutils::add_l2classifier_entries(*cls, act, log,
-                                                             after_egress_table, egress_table,
-                                                             EXP_DROP_TABLE_ID,
-                                                             pc->getPriority(),
-                                                             OFPUTIL_FF_SEND_FLOW_REM,
-                                                             secGrpCookie,
-                                                             secGrpSetId, 0, 
-                                                             isSystemRule,
-                                                             *secGrpOutRef);
-                      }
-                }
-                continue;
-            }
-
-            if (dir == DirectionEnumT::CONST_BIDIRECTIONAL ||
-                dir == DirectionEnumT::CONST_IN) {
-                if (act == flowutils::CA_DENY) {
-                         flowutils::add_classifier_entries(*cls, act, log,
-                                                          remoteSubs,
-                                                          boost::none,
-                                                          boost::none,
-                                                          EXP_DROP_TABLE_ID, ingress_table,
-                                                          EXP_DROP_TABLE_ID,
-                                                          pc->getPriority(),
-                                                          OFPUTIL_FF_SEND_FLOW_REM,
-                                                          secGrpCookie,
-                                                          secGrpSetId, 0,
-                                                          isSystemRule,
-                                                          *secGrpInRef);
-                }  else {
-                         flowutils::add_classifier_entries(*cls, act, log,
-                                                           remoteSubs,
-                                                           boost::none,
-                                                           boost::none,
-                                                           after_ingress_table, ingress_table,
-                                                           EXP_DROP_TABLE_ID,
-                                                           pc->getPriority(),
-                                                           OFPUTIL_FF_SEND_FLOW_REM,
-                                                           secGrpCookie,
-                                                           secGrpSetId, 0,
-                                                           isSystemRule,
-                                                           *secGrpInRef);
-                   }
-                if (act == CA_REFLEX_FWD) {
-                    flowutils::add_classifier_entries(*cls, CA_REFLEX_FWD_TRACK, log,
-                                                      remoteSubs,
-                                                      boost::none,
-                                                      boost::none,
-                                                      GROUP_MAP_TABLE_ID, ingress_table,
-                                                      EXP_DROP_TABLE_ID,
-                                                      pc->getPriority(),
-                                                      OFPUTIL_FF_SEND_FLOW_REM,
-                                                      secGrpCookie,
-                                                      secGrpSetId, 0,
-                                                      isSystemRule,
-                                                      *secGrpInRef);
-                    flowutils::add_classifier_entries(*cls, CA_REFLEX_FWD_EST, log,
-                                                      remoteSubs,
-                                                      boost::none,
-                                                      boost::none,
-                                                      after_ingress_table, ingress_table,
-                                                      EXP_DROP_TABLE_ID,
-                                                      pc->getPriority(),
-                                                      OFPUTIL_FF_SEND_FLOW_REM,
-                                                      secGrpCookie,
-                                                      secGrpSetId, 0,
-                                                      isSystemRule,
-                                                      *secGrpInRef);
-                    // add reverse entries for reflexive classifier
-                    flowutils::add_classifier_entries(*cls, CA_REFLEX_REV_TRACK, log,
-                                                      boost::none,
-                                                      remoteSubs,
-                                                      namedSvcPorts,
-                                                      GROUP_MAP_TABLE_ID, egress_table,
-                                                      EXP_DROP_TABLE_ID,
-                                                      pc->getPriority(),
-                                                      OFPUTIL_FF_SEND_FLOW_REM,
-                                                      0,
-                                                      secGrpSetId, 0,
-                                                      isSystemRule,
-                                                      *secGrpOutRef);
-                    flowutils::add_classifier_entries(*cls, CA_REFLEX_REV_ALLOW, log,
-                                                      boost::none,
-                                                      remoteSubs,
-                                                      namedSvcPorts,
-                                                      after_egress_table, egress_table,
-                                                      EXP_DROP_TABLE_ID,
-                                                      pc->getPriority(),
-                                                      OFPUTIL_FF_SEND_FLOW_REM,
-                                                      secGrpCookie,
-                                                      secGrpSetId, 0,
-                                                      isSystemRule,
-                                                      *secGrpOutRef);
-                    flowutils::add_classifier_entries(*cls, CA_REFLEX_REV_RELATED, log,
-                                                      boost::none,
-                                                      remoteSubs,
-                                                      namedSvcPorts,
-                                                      after_egress_table, egress_table,
-                                                      EXP_DROP_TABLE_ID,
-                                                      pc->getPriority(),
-                                                      OFPUTIL_FF_SEND_FLOW_REM,
-                                                      secGrpCookie,
-                                                      secGrpSetId, 0,
-                                                      isSystemRule,
-                                                      *secGrpOutRef);
-                }
-            }
-            if (dir == DirectionEnumT::CONST_BIDIRECTIONAL ||
-                dir == DirectionEnumT::CONST_OUT) {
-                if (act == flowutils::CA_DENY) {
-                    flowutils::add_classifier_entries(*cls, act, log,
-                                                      boost::none,
-                                                      remoteSubs,
-                                                      namedSvcPorts,
-                                                      EXP_DROP_TABLE_ID, egress_table,
-                                                      EXP_DROP_TABLE_ID,
-                                                      pc->getPriority(),
-                                                      OFPUTIL_FF_SEND_FLOW_REM,
-                                                      secGrpCookie,
-                                                      secGrpSetId, 0,
-                                                      isSystemRule,
-                                                      *secGrpOutRef);
-                } else {
-                      flowutils::add_classifier_entries(*cls, act, log,
-                                                        boost::none,
-                                                        remoteSubs,
-                                                        namedSvcPorts,
-                                                        after_egress_table, egress_table,
-                                                        EXP_DROP_TABLE_ID,
-                                                        pc->getPriority(),
-                                                        OFPUTIL_FF_SEND_FLOW_REM,
-                                                        secGrpCookie,
-                                                        secGrpSetId, 0,
-                                                        isSystemRule,
-                                                        *secGrpOutRef);
-                  }
-                if (act == CA_REFLEX_FWD) {
-                    flowutils::add_classifier_entries(*cls, CA_REFLEX_FWD_TRACK, log,
-                                                      boost::none,
-                                                      remoteSubs,
-                                                      namedSvcPorts,
-                                                      GROUP_MAP_TABLE_ID, egress_table,
-                                                      EXP_DROP_TABLE_ID,
-                                                      pc->getPriority(),
-                                                      OFPUTIL_FF_SEND_FLOW_REM,
-                                                      secGrpCookie,
-                                                      secGrpSetId, 0,
-                                                      isSystemRule,
-                                                      *secGrpOutRef);
-                    flowutils::add_classifier_entries(*cls, CA_REFLEX_FWD_EST, log,
-                                                      boost::none,
-                                                      remoteSubs,
-                                                      namedSvcPorts,
-                                                      after_egress_table, egress_table,
-                                                      EXP_DROP_TABLE_ID,
-                                                      pc->getPriority(),
-                                                      OFPUTIL_FF_SEND_FLOW_REM,
-                                                      secGrpCookie,
-                                                      secGrpSetId, 0,
-                                                      isSystemRule,
-                                                      *secGrpOutRef);
-                    // add reverse entries for reflexive classifier
-                    flowutils::add_classifier_entries(*cls, CA_REFLEX_REV_TRACK, log,
-                                                      remoteSubs,
-                                                      boost::none,
-                                                      boost::none,
-                                                      GROUP_MAP_TABLE_ID, ingress_table,
-                                                      EXP_DROP_TABLE_ID,
-                                                      pc->getPriority(),
-                                                      OFPUTIL_FF_SEND_FLOW_REM,
-                                                      0,
-                                                      secGrpSetId, 0,
-                                                      isSystemRule,
-                                                      *secGrpInRef);
-                    flowutils::add_classifier_entries(*cls, CA_REFLEX_REV_ALLOW, log,
-                                                      remoteSubs,
-                                                      boost::none,
-                                                      boost::none,
-                                                      after_ingress_table, ingress_table,
-                                                      EXP_DROP_TABLE_ID,
-                                                      pc->getPriority(),
-                                                      OFPUTIL_FF_SEND_FLOW_REM,
-                                                      secGrpCookie,
-                                                      secGrpSetId, 0,
-                                                      isSystemRule,
-                                                      *secGrpInRef);
-                    flowutils::add_classifier_entries(*cls, CA_REFLEX_REV_RELATED, log,
-                                                      remoteSubs,
-                                                      boost::none,
-                                                      boost::none,
-                                                      after_ingress_table, ingress_table,
-                                                      EXP_DROP_TABLE_ID,
-                                                      pc->getPriority(),
-                                                      OFPUTIL_FF_SEND_FLOW_REM,
-                                                      secGrpCookie,
-                                                      secGrpSetId, 0,
-                                                      isSystemRule,
-                                                      *secGrpInRef);
-                }
+        } else if (conjunctiveSecGroups) {
+            // the rules of the group are written once for all the
+            // sets, the first time a set needs them
+            auto it = secGrpConjs.find(secGrp);
+            if (it == secGrpConjs.end()) {
+                updateSecGrpConjunctions(secGrp);
+                it = secGrpConjs.find(secGrp);
+                if (it == secGrpConjs.end())
+                    continue;
             }
+            for (const auto& p : it->second.inConjs)
+                inConjs[p.first].insert(p.second.begin(), p.second.end());
+            for (const auto& p : it->second.outConjs)
+                outConjs[p.first].insert(p.second.begin(), p.second.end());
+        } else {
+            addSecGrpRuleObjs(secGrp, secGrpSetId, secGrpsIdStr, NULL,
+                              ruleObjs);
         }
     }
+    add_set_conj_flows(secGrpSetId, inConjs, secGrpIn);
+    add_set_conj_flows(secGrpSetId, outConjs, secGrpOut);
+    writeSecGrpRuleObjs(secGrpsIdStr, ruleObjs, true);
 
     switchManager.writeFlow(secGrpsIdStr, SEC_GROUP_IN_TABLE_ID, secGrpIn);
     switchManager.writeFlow(secGrpsIdStr, SEC_GROUP_OUT_TABLE_ID, secGrpOut);
@@ -1235,6 +1666,7 @@ void AccessFlowManager::rdConfigUpdated(const opflex::modb::URI& rdURI) {
 
 void AccessFlowManager::packetDropLogConfigUpdated(const opflex::modb::URI& dropLogCfgURI) {
     if (stopping) return;
+    updateTableDropFlows();
     using modelgbp::observer::DropLogConfig;
     using modelgbp::observer::DropLogModeEnumT;
     FlowEntryList dropLogFlows;
@@ -7,6 +7,9 @@
  */
 
 #include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
 #include "ActionBuilder.h"
 #include "FlowBuilder.h"
 #include "FlowConstants.h"
@@ -21,20 +24,57 @@ using boost::asio::ip::address_v6;
 
 namespace opflexagent {
 
+const size_t ActionBufferPool::MAX_BUFFERS;
+const size_t ActionBufferPool::MAX_SIZE;
+
+ActionBufferPool::~ActionBufferPool() {
+    for (ofpbuf* b : buffers) {
+        ofpbuf_uninit(b);
+        delete b;
+    }
+    destroyed = true;
+}
+
+ofpbuf* ActionBufferPool::get() {
+    if (!destroyed && !pool.buffers.empty()) {
+        ofpbuf* b = pool.buffers.back();
+        pool.buffers.pop_back();
+        return b;
+    }
+    ofpbuf* b = new ofpbuf;
+    ofpbuf_init(b, 64);
+    return b;
+}
+
+void ActionBufferPool::put(ofpbuf* b) {
+    if (!destroyed && pool.buffers.size() < MAX_BUFFERS &&
+        b->allocated <= MAX_SIZE) {
+        ofpbuf_clear(b);
+        pool.buffers.push_back(b);
+        return;
+    }
+    ofpbuf_uninit(b);
+    delete b;
+}
+
+size_t ActionBufferPool::size() {
+    return destroyed ? 0 : pool.buffers.size();
+}
+
+thread_local ActionBufferPool ActionBufferPool::pool;
+thread_local bool ActionBufferPool::destroyed = false;
+
 ActionBuilder::ActionBuilder(FlowBuilder& fb_)
-    : buf(new ofpbuf), flowHasVlan(false), fb(fb_) {
-    ofpbuf_init(buf, 64);
+    : buf(ActionBufferPool::get()), flowHasVlan(false), fb(fb_) {
 }
 
 ActionBuilder::ActionBuilder()
-    : buf(new ofpbuf), flowHasVlan(false) {
-    ofpbuf_init(buf, 64);
+    : buf(ActionBufferPool::get()), flowHasVlan(false) {
 }
 
 ActionBuilder::~ActionBuilder() {
     if (buf) {
-        ofpbuf_uninit(buf);
-        delete buf;
+        ActionBufferPool::put(buf);
     }
 }
 
@@ -43,20 +83,32 @@ ofpact * ActionBuilder::getActionsFromBuffer(ofpbuf *buf, size_t& actsLen) {
     return (ofpact*)ofpbuf_steal_data(buf);
 }
 
+ofpact* ActionBuilder::copyActions(ofpbuf* buf, size_t& actsLen) {
+    actsLen = buf->size;
+    ofpact* acts = NULL;
+    if (actsLen > 0) {
+        acts = static_cast<ofpact*>(malloc(actsLen));
+        if (!acts) throw std::bad_alloc();
+        memcpy(acts, buf->data, actsLen);
+    }
+    ofpbuf_clear(buf);
+    return acts;
+}
+
 void ActionBuilder::build(ofputil_flow_stats *dstEntry) {
-    dstEntry->ofpacts = getActionsFromBuffer(buf, dstEntry->ofpacts_len);
+    dstEntry->ofpacts = copyActions(buf, dstEntry->ofpacts_len);
 }
 
 void ActionBuilder::build(ofputil_flow_mod *dstMod) {
-    dstMod->ofpacts = getActionsFromBuffer(buf, dstMod->ofpacts_len);
+    dstMod->ofpacts = copyActions(buf, dstMod->ofpacts_len);
 }
 
 void ActionBuilder::build(ofputil_packet_out *dstPkt) {
-    dstPkt->ofpacts = getActionsFromBuffer(buf, dstPkt->ofpacts_len);
+    dstPkt->ofpacts = copyActions(buf, dstPkt->ofpacts_len);
 }
 
 void ActionBuilder::build(ofputil_bucket *dstBucket) {
-    dstBucket->ofpacts = getActionsFromBuffer(buf, dstBucket->ofpacts_len);
+    dstBucket->ofpacts = copyActions(buf, dstBucket->ofpacts_len);
 }
 
 FlowBuilder& ActionBuilder::parent() {
@@ -185,6 +237,18 @@ ActionBuilder& ActionBuilder::group(uint32_t groupId) {
     return *this;
 }
 
+ActionBuilder& ActionBuilder::conjunction(uint32_t id, uint8_t clause,
+                                          uint8_t nClauses) {
+    act_conjunction(buf, id, clause, nClauses);
+    return *this;
+}
+
+ActionBuilder& ActionBuilder::copy(const struct ofpact* ofpacts, size_t len) {
+    if (ofpacts && len > 0)
+        ofpbuf_put(buf, ofpacts, len);
+    return *this;
+}
+
 ActionBuilder& ActionBuilder::controller(uint16_t max_len) {
     act_controller(buf, max_len);
     return *this;
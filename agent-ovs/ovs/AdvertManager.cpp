@@ -21,6 +21,9 @@
 #include <opflexagent/logging.h>
 #include "arp.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include <boost/system/error_code.hpp>
 #include <boost/asio/deadline_timer.hpp>
 #include <boost/asio/placeholders.hpp>
@@ -54,12 +57,16 @@ namespace opflexagent {
 
 static const address_v6 ALL_NODES_IP(address_v6::from_string("ff02::1"));
 
+typedef std::chrono::steady_clock steady_clock;
+
 AdvertManager::AdvertManager(Agent& agent_,
                              IntFlowManager& intFlowManager_)
     : urng(rng()), all_ep_dis(300,600), repeat_dis(3000,5000),
       sendRouterAdv(false), initialRouterAdvs(0),
       sendEndpointAdv(EPADV_DISABLED), tunnelEndpointAdv(EPADV_DISABLED),
       tunnelEpAdvInterval(300),
+      advBacklog(0), maxAdvBacklog(0), advSent(0), advRateLimit(1000),
+      advTokens(0), pacerScheduled(false),
       agent(agent_), intFlowManager(intFlowManager_),
       portMapper(NULL), switchConnection(NULL),
       ioService(&agent.getAgentIOService()),
@@ -83,6 +90,7 @@ void AdvertManager::start() {
     if (sendEndpointAdv != EPADV_DISABLED) {
         allEndpointAdvTimer.reset(new deadline_timer(*ioService));
         endpointAdvTimer.reset(new deadline_timer(*ioService));
+        paceTimer.reset(new deadline_timer(*ioService));
         scheduleInitialEndpointAdv();
     }
 
@@ -99,6 +107,8 @@ void AdvertManager::stop() {
             endpointAdvTimer->cancel();
         if (allEndpointAdvTimer)
             allEndpointAdvTimer->cancel();
+        if (paceTimer)
+            paceTimer->cancel();
         if(tunnelEpAdvTimer)
             tunnelEpAdvTimer->cancel();
     } catch(const std::exception &e) {
@@ -144,7 +154,7 @@ void AdvertManager::scheduleEndpointAdv(const std::string& uuid) {
     lock_guard<recursive_mutex> timerGuard(timer_mutex);
     if (endpointAdvTimer) {
         unique_lock<mutex> guard(ep_mutex);
-        pendingEps[uuid] = 5;
+        pendingEps[uuid] = { 5, steady_clock::now() };
 
         doScheduleEpAdv();
     }
@@ -154,12 +164,146 @@ void AdvertManager::scheduleServiceAdv(const std::string& uuid) {
     lock_guard<recursive_mutex> timerGuard(timer_mutex);
     if (endpointAdvTimer) {
         unique_lock<mutex> guard(ep_mutex);
-        pendingServices[uuid] = 5;
+        pendingServices[uuid] = { 5, steady_clock::now() };
 
         doScheduleEpAdv();
     }
 }
 
+size_t AdvertManager::getAdvBacklog() {
+    unique_lock<mutex> guard(pace_mutex);
+    return advBacklog;
+}
+
+size_t AdvertManager::getMaxAdvBacklog() {
+    unique_lock<mutex> guard(pace_mutex);
+    return maxAdvBacklog;
+}
+
+URI AdvertManager::getEndpointDomain(const string& uuid) {
+    optional<URI> epgURI = agent.getEndpointManager().getComputedEPG(uuid);
+    if (epgURI) {
+        optional<shared_ptr<modelgbp::gbp::BridgeDomain>> bd =
+            agent.getPolicyManager().getBDForGroup(epgURI.get());
+        if (bd)
+            return bd.get()->getURI();
+    }
+    return URI::ROOT;
+}
+
+void AdvertManager::queueAdv(AdvType type, const string& uuid,
+                             const URI& domain) {
+    unique_lock<mutex> guard(pace_mutex);
+    unordered_set<string>& queued =
+        type == ADV_ENDPOINT ? queuedEpAdvs : queuedServiceAdvs;
+    if (!queued.insert(uuid).second)
+        return;
+
+    std::deque<adv_t>& q = advQueues[domain];
+    if (q.empty())
+        advTurns.push_back(domain);
+    q.emplace_back(type, uuid);
+    advBacklog += 1;
+    if (advBacklog > maxAdvBacklog)
+        maxAdvBacklog = advBacklog;
+
+    if (!pacerScheduled) {
+        pacerScheduled = true;
+        guard.unlock();
+        schedulePacer(0);
+    }
+}
+
+void AdvertManager::schedulePacer(uint64_t time) {
+    lock_guard<recursive_mutex> guard(timer_mutex);
+    if (!paceTimer || stopping) {
+        unique_lock<mutex> paceGuard(pace_mutex);
+        pacerScheduled = false;
+        return;
+    }
+    paceTimer->expires_from_now(milliseconds(time));
+    paceTimer->async_wait(bind(&AdvertManager::onPaceTimer, this, error));
+}
+
+void AdvertManager::onPaceTimer(const boost::system::error_code& ec) {
+    if (ec) {
+        unique_lock<mutex> guard(pace_mutex);
+        pacerScheduled = false;
+        return;
+    }
+
+    std::vector<adv_t> batch;
+    uint64_t next = 0;
+    {
+        unique_lock<mutex> guard(pace_mutex);
+        size_t budget = advBacklog;
+        uint32_t rate = advRateLimit;
+        if (rate > 0) {
+            // a token bucket holding up to 100ms of advertisements
+            double burst = std::max(1.0, rate / 10.0);
+            steady_clock::time_point now = steady_clock::now();
+            if (lastRefill == steady_clock::time_point())
+                advTokens = burst;
+            else
+                advTokens +=
+                    std::chrono::duration<double>(now - lastRefill).count()
+                    * rate;
+            advTokens = std::min(advTokens, burst);
+            lastRefill = now;
+            budget = std::min(budget, (size_t)advTokens);
+            advTokens -= budget;
+        }
+
+        batch.reserve(budget);
+        while (batch.size() < budget && !advTurns.empty()) {
+            URI domain = advTurns.front();
+            advTurns.pop_front();
+            auto qit = advQueues.find(domain);
+            if (qit == advQueues.end() || qit->second.empty())
+                continue;
+            adv_t adv = std::move(qit->second.front());
+            qit->second.pop_front();
+            if (qit->second.empty())
+                advQueues.erase(qit);
+            else
+                advTurns.push_back(domain);
+            (adv.first == ADV_ENDPOINT ? queuedEpAdvs : queuedServiceAdvs)
+                .erase(adv.second);
+            batch.push_back(std::move(adv));
+        }
+        advBacklog -= batch.size();
+
+        if (advBacklog == 0) {
+            pacerScheduled = false;
+        } else {
+            // wait for the next token
+            next = rate == 0 ? 1 : std::max<uint64_t>(1,
+                (uint64_t)std::ceil((1 - advTokens) * 1000 / rate));
+        }
+        if (advBacklog > 0 || !batch.empty()) {
+            LOG(DEBUG) << "Sending " << batch.size()
+                       << " advertisements, " << advBacklog << " queued";
+        }
+    }
+
+    if (!batch.empty()) {
+        advSent += batch.size();
+        agent.getAgentIOService()
+            .post(bind(&AdvertManager::sendAdvs, this, std::move(batch)));
+    }
+    if (next > 0)
+        schedulePacer(next);
+}
+
+void AdvertManager::sendAdvs(const std::vector<adv_t>& advs) {
+    for (const adv_t& adv : advs) {
+        if (adv.first == ADV_ENDPOINT)
+            sendEndpointAdvs(adv.second);
+        else
+            sendServiceAdvs(adv.second);
+    }
+}
+
 static int send_packet_out(SwitchConnection* conn,
                            OfpBuf& b,
                            unordered_set<uint32_t>& out_ports,
@@ -273,21 +417,13 @@ void AdvertManager::onRouterAdvTimer(const boost::system::error_code& ec) {
 
 static void doSendEpAdv(PolicyManager& policyManager,
                         SwitchConnection* switchConnection,
-                        const string& ip, const uint8_t* epMac,
+                        const address& addr, const uint8_t* epMac,
                         const uint8_t* routerMac,
                         const URI& egURI, uint32_t epgVnid,
                         unordered_set<uint32_t>& out_ports,
                         AdvertManager::EndpointAdvMode mode,
                         IntFlowManager::EncapType encapType,
                         const address& tunDst) {
-    boost::system::error_code ec;
-    address addr = address::from_string(ip, ec);
-    if (ec) {
-        LOG(ERROR) << "Invalid IP address: " << ip
-                   << ": " << ec.message();
-        return;
-    }
-
     OfpBuf b((struct ofpbuf*)NULL);
 
     boost::optional<address> routerIp;
@@ -388,12 +524,12 @@ void AdvertManager::sendEndpointAdvs(const string& uuid) {
     ep->getMAC().get().toUIntArray(epMac);
     const uint8_t* routerMac = intFlowManager.getRouterMacAddr();
 
-    for (const string& ip : ep->getIPs()) {
+    for (const network::cidr_t& cidr : ep->getIPCidrs()) {
         LOG(DEBUG) << "Sending endpoint advertisement for "
-                   << ep->getMAC().get() << " " << ip;
+                   << ep->getMAC().get() << " " << cidr.first;
 
         doSendEpAdv(polMgr, switchConnection,
-                    ip, epMac, routerMac, epgURI.get(), epgVnid.get(),
+                    cidr.first, epMac, routerMac, epgURI.get(), epgVnid.get(),
                     out_ports, sendEndpointAdv,
                     intFlowManager.getEncapType(),
                     intFlowManager.getEPGTunnelDst(epgURI.get()));
@@ -411,11 +547,20 @@ void AdvertManager::sendEndpointAdvs(const string& uuid) {
             polMgr.getVnidForGroup(ipm.getEgURI().get());
         if (!ipmVnid) continue;
 
+        boost::system::error_code ec;
+        address floatingIp =
+            address::from_string(ipm.getFloatingIP().get(), ec);
+        if (ec) {
+            LOG(ERROR) << "Invalid IP address: " << ipm.getFloatingIP().get()
+                       << ": " << ec.message();
+            continue;
+        }
+
         LOG(DEBUG) << "Sending endpoint advertisement for "
-                   << ep->getMAC().get() << " " << ipm.getFloatingIP().get();
+                   << ep->getMAC().get() << " " << floatingIp;
 
         doSendEpAdv(polMgr, switchConnection,
-                    ipm.getFloatingIP().get(), epMac,
+                    floatingIp, epMac,
                     routerMac, ipm.getEgURI().get(),
                     ipmVnid.get(), out_ports, sendEndpointAdv,
                     intFlowManager.getEncapType(),
@@ -434,8 +579,13 @@ void AdvertManager::sendAllEndpointAdvs() {
     for (const URI& epg : epgURIs) {
         unordered_set<string> eps;
         epMgr.getEndpointsForGroup(epg, eps);
+        if (eps.empty()) continue;
+
+        optional<shared_ptr<modelgbp::gbp::BridgeDomain>> bd =
+            polMgr.getBDForGroup(epg);
+        URI domain = bd ? bd.get()->getURI() : URI::ROOT;
         for (const string& uuid : eps) {
-            sendEndpointAdvs(uuid);
+            queueAdv(ADV_ENDPOINT, uuid, domain);
         }
     }
 }
@@ -496,7 +646,7 @@ void AdvertManager::sendAllServiceAdvs() {
             }
             advs.insert(*s);
 
-            sendServiceAdvs(uuid);
+            queueAdv(ADV_SERVICE, uuid, rd);
         }
     }
 }
@@ -552,13 +702,21 @@ void AdvertManager::sendServiceAdvs(const string& uuid) {
         encapType = IntFlowManager::ENCAP_VLAN;
     }
 
+    boost::system::error_code ec;
+    address ifaceIp = address::from_string(svc->getIfaceIP().get(), ec);
+    if (ec) {
+        LOG(ERROR) << "Invalid IP address: " << svc->getIfaceIP().get()
+                   << ": " << ec.message();
+        return;
+    }
+
     LOG(DEBUG) << "Sending service advertisement for "
                << svc->getServiceMAC().get() << " "
-               << svc->getIfaceIP().get() << " on "
+               << ifaceIp << " on "
                << svc->getInterfaceName().get()
                << " (vlan " << unsigned(vnid) << ")";
 
-    doSendEpAdv(polMgr, switchConnection, svc->getIfaceIP().get(),
+    doSendEpAdv(polMgr, switchConnection, ifaceIp,
                 svcMac, routerMac, URI::ROOT, vnid,
                 out_ports, sendEndpointAdv, encapType, address());
 }
@@ -573,17 +731,35 @@ void AdvertManager::onEndpointAdvTimer(const boost::system::error_code& ec) {
     if (!portMapper)
         return;
 
+    // each endpoint and service repeats on its own jittered
+    // schedule, so that repeats spread out rather than all land on
+    // the same tick
+    steady_clock::time_point now = steady_clock::now();
+    steady_clock::time_point nextDue = steady_clock::time_point::max();
+    auto repeat = [this, &now, &nextDue](PendingAdv& p) {
+        p.remaining -= 1;
+        p.due = now + std::chrono::milliseconds(repeat_dis(urng));
+        nextDue = std::min(nextDue, p.due);
+    };
+
+    // queued once ep_mutex is released
+    std::vector<string> dueEps;
+    std::vector<std::pair<string, URI>> dueServices;
+
     unique_lock<mutex> guard(ep_mutex);
     {
         auto it = pendingEps.begin();
         while (it != pendingEps.end()) {
-            agent.getAgentIOService()
-                .post(bind(&AdvertManager::sendEndpointAdvs,
-                           this, it->first));
-            if (it->second <= 1) {
+            if (it->second.due > now) {
+                nextDue = std::min(nextDue, it->second.due);
+                it++;
+                continue;
+            }
+            dueEps.push_back(it->first);
+            if (it->second.remaining <= 1) {
                 it = pendingEps.erase(it);
             } else {
-                it->second -= 1;
+                repeat(it->second);
                 it++;
             }
         }
@@ -593,33 +769,49 @@ void AdvertManager::onEndpointAdvTimer(const boost::system::error_code& ec) {
         adv_set_t advs;
         auto it = pendingServices.begin();
         while (it != pendingServices.end()) {
+            if (it->second.due > now) {
+                nextDue = std::min(nextDue, it->second.due);
+                it++;
+                continue;
+            }
             shared_ptr<const Service> s = svcMgr.getService(it->first);
             if (!s || !shouldSendAdv(*s)) {
                 it = pendingServices.erase(it);
                 continue;
             }
             if (advs.find(*s) != advs.end()) {
-                it->second -= 1;
-                it++;
+                if (it->second.remaining <= 1) {
+                    it = pendingServices.erase(it);
+                } else {
+                    repeat(it->second);
+                    it++;
+                }
                 continue;
             }
             advs.insert(*s);
 
-            agent.getAgentIOService()
-                .post(bind(&AdvertManager::sendServiceAdvs,
-                           this, it->first));
-            if (it->second <= 1) {
+            dueServices.emplace_back(it->first, s->getDomainURI()
+                                     ? s->getDomainURI().get() : URI::ROOT);
+            if (it->second.remaining <= 1) {
                 it = pendingServices.erase(it);
             } else {
-                it->second -= 1;
+                repeat(it->second);
                 it++;
             }
         }
     }
 
-    if (!pendingEps.empty() || !pendingServices.empty()) {
-        guard.unlock();
-        doScheduleEpAdv(repeat_dis(urng));
+    bool more = !pendingEps.empty() || !pendingServices.empty();
+    guard.unlock();
+
+    for (const string& uuid : dueEps)
+        queueAdv(ADV_ENDPOINT, uuid, getEndpointDomain(uuid));
+    for (const auto& svc : dueServices)
+        queueAdv(ADV_SERVICE, svc.first, svc.second);
+
+    if (more) {
+        doScheduleEpAdv(std::chrono::duration_cast<std::chrono::milliseconds>
+                        (nextDue - now).count());
     }
 }
 
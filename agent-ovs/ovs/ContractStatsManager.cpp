@@ -68,7 +68,8 @@ void ContractStatsManager::start() {
     {
         std::lock_guard<std::mutex> lock(timer_mutex);
         if (timer)
-            timer->async_wait(bind(&ContractStatsManager::on_timer, this, error));
+            timer->async_wait(strand->wrap(
+                bind(&ContractStatsManager::on_timer, this, error)));
     }
 }
 
@@ -89,9 +90,11 @@ void ContractStatsManager::on_timer(const error_code& ec) {
         return;
     }
 
+    std::unordered_set<uint64_t> cookies;
     TableState::cookie_callback_t cb_func;
-    cb_func = [this](uint64_t cookie, uint16_t priority,
-                     const struct match& match) {
+    cb_func = [this, &cookies](uint64_t cookie, uint16_t priority,
+                               const struct match& match) {
+        cookies.insert(cookie);
         const std::lock_guard<std::mutex> lock(pstatMtx);
         updateFlowEntryMap(contractState, cookie, priority, match);
     };
@@ -106,13 +109,15 @@ void ContractStatsManager::on_timer(const error_code& ec) {
         generatePolicyStatsObjects(&newClassCountersMap);
     }
 
-    sendRequest(IntFlowManager::POL_TABLE_ID);
+    // only read the flows that are counted
+    sendRequests(IntFlowManager::POL_TABLE_ID, cookies);
 
     if (!stopping) {
         std::lock_guard<std::mutex> lock(timer_mutex);
         if (timer) {
             timer->expires_from_now(milliseconds(timer_interval));
-            timer->async_wait(bind(&ContractStatsManager::on_timer, this, error));
+            timer->async_wait(strand->wrap(
+                bind(&ContractStatsManager::on_timer, this, error)));
         }
     }
 }
@@ -166,8 +171,6 @@ updatePolicyStatsCounters(const string& srcEpg,
                           const string& dstEpg,
                           const string& l24Classifier,
                           FlowStats_t& newVals) {
-
-    Mutator mutator(agent->getFramework(), "policyelement");
     optional<shared_ptr<PolicyStatUniverse> > su =
         PolicyStatUniverse::resolve(agent->getFramework());
     if (su) {
@@ -185,7 +188,6 @@ updatePolicyStatsCounters(const string& srcEpg,
                                                               newVals.byte_count.get(),
                                                               newVals.packet_count.get());
     }
-    mutator.commit();
 }
 
 void ContractStatsManager::clearCounterObject(const string& key,
@@ -304,12 +306,15 @@ void ContractStatsManager::Handle(SwitchConnection* connection,
                                   ofpbuf *msg,
                                   struct ofputil_flow_removed* fentry) {
     handleMessage(msgType, msg,
-                  [this](uint32_t table_id) -> flowCounterState_t* {
-                      if (table_id == IntFlowManager::POL_TABLE_ID)
-                          return &contractState;
-                      else
-                          return NULL;
+                  [this](uint32_t table_id) {
+                      return getCounterState(table_id);
                   }, fentry);
 }
 
+flowCounterState_t* ContractStatsManager::getCounterState(uint32_t tableId) {
+    if (tableId == IntFlowManager::POL_TABLE_ID)
+        return &contractState;
+    return NULL;
+}
+
 } /* namespace opflexagent */
@@ -10,20 +10,23 @@
 #include "CtZoneManager.h"
 #include <opflexagent/IdGenerator.h>
 #include <opflexagent/logging.h>
+#include <opflex/util/ThreadSettings.h>
 
 #ifdef HAVE_LIBNFCT
 #include <libnetfilter_conntrack/libnetfilter_conntrack.h>
 #endif /* HAVE_LIBCFCT */
 
+#include <chrono>
 #include <limits>
 
 namespace opflexagent {
 
 CtZoneManager::CtZoneManager(IdGenerator& gen_)
-    : minId(1), maxId(65534), useNetLink(false), gen(gen_) { }
+    : minId(1), maxId(65534), useNetLink(false), gen(gen_),
+      stopping(false) { }
 
 CtZoneManager::~CtZoneManager() {
-
+    stop();
 }
 
 #ifdef HAVE_LIBNFCT
@@ -45,7 +48,8 @@ public:
 struct delete_ctx {
     NfCtP cth;
     NfCtP ith;
-    uint16_t zoneId;
+    const std::vector<bool>* zones;
+    size_t deleted;
 };
 
 static int delete_cb(enum nf_conntrack_msg_type type,
@@ -54,7 +58,7 @@ static int delete_cb(enum nf_conntrack_msg_type type,
 {
     struct delete_ctx* ctx = (struct delete_ctx*)data;
 
-    if (ctx->zoneId != nfct_get_attr_u16(ct, ATTR_ZONE))
+    if (!(*ctx->zones)[nfct_get_attr_u16(ct, ATTR_ZONE)])
         return NFCT_CB_CONTINUE;
 
     int res = nfct_query(ctx->ith.handle, NFCT_Q_DESTROY, ct);
@@ -62,20 +66,22 @@ static int delete_cb(enum nf_conntrack_msg_type type,
         LOG(ERROR) << "Failed to delete conntrack entry "
                    << nfct_get_attr_u32(ct, ATTR_ID)
                    << ": " << res;
+    } else {
+        ctx->deleted += 1;
     }
 
     return NFCT_CB_CONTINUE;
 }
 #endif /* HAVE_LIBNFCT */
 
-bool CtZoneManager::ctZoneAllocHook(const std::string&, uint32_t id) {
+bool CtZoneManager::flushZones(const std::vector<bool>& zones) {
 #ifdef HAVE_LIBNFCT
-    LOG(DEBUG) << "Clearing connection tracking zone " << id;
-
+    // a single dump of the table covers all the zones
     delete_ctx ctx;
     if (!ctx.cth.handle || !ctx.ith.handle)
         return false;
-    ctx.zoneId = static_cast<uint16_t>(id);
+    ctx.zones = &zones;
+    ctx.deleted = 0;
 
     nfct_callback_register(ctx.cth.handle, NFCT_T_ALL, delete_cb, &ctx);
 
@@ -92,16 +98,65 @@ bool CtZoneManager::ctZoneAllocHook(const std::string&, uint32_t id) {
                                  AF_INET);
     int res = nfct_query(ctx.cth.handle, NFCT_Q_DUMP_FILTER, filter_dump.get());
     if (res < 0) {
-        LOG(ERROR) << "Failed to query connection tracking for zone "
-                   << id << ": " << res;
+        LOG(ERROR) << "Failed to query connection tracking: " << res;
         return false;
     }
 
+    LOG(DEBUG) << "Deleted " << ctx.deleted
+               << " connection tracking entries";
 #endif /* HAVE_LIBNFCT */
 
     return true;
 }
 
+bool CtZoneManager::ctZoneFreeHook(const std::string&, uint32_t id) {
+    // called with the ID generator locked; keep the zone reserved
+    // until the worker has flushed it
+    {
+        std::lock_guard<std::mutex> guard(flushMutex);
+        if (!flushThread)
+            return true;
+        pendingFlush.push_back(static_cast<uint16_t>(id));
+    }
+    flushCond.notify_one();
+    return false;
+}
+
+void CtZoneManager::runFlush() {
+    std::unique_lock<std::mutex> lock(flushMutex);
+    while (true) {
+        flushCond.wait(lock, [this]() {
+                return stopping || !pendingFlush.empty();
+            });
+        if (stopping) break;
+
+        // take every zone freed so far as one batch
+        std::vector<uint16_t> batch;
+        batch.swap(pendingFlush);
+        lock.unlock();
+
+        LOG(DEBUG) << "Clearing " << batch.size()
+                   << " connection tracking zones";
+        std::vector<bool> zones(std::numeric_limits<uint16_t>::max() + 1);
+        for (uint16_t zone : batch)
+            zones[zone] = true;
+        bool flushed = flushZones(zones);
+        if (flushed) {
+            for (uint16_t zone : batch)
+                gen.releaseId(nmspc, zone);
+        }
+
+        lock.lock();
+        if (!flushed) {
+            // retry the batch with the zones freed since
+            pendingFlush.insert(pendingFlush.end(),
+                                batch.begin(), batch.end());
+            flushCond.wait_for(lock, std::chrono::seconds(1),
+                               [this]() { return stopping; });
+        }
+    }
+}
+
 void CtZoneManager::setCtZoneRange(uint16_t min, uint16_t max) {
     if (min >= 1) minId = min;
     if (max < std::numeric_limits<uint16_t>::max()) maxId = max;
@@ -119,9 +174,25 @@ void CtZoneManager::init(const std::string& nmspc_) {
     gen.initNamespace(nmspc, minId, maxId);
     if (useNetLink) {
 #ifdef HAVE_LIBNFCT
-        IdGenerator::alloc_hook_t
-            hook(std::bind(&CtZoneManager::ctZoneAllocHook, this, _1, _2));
-        gen.setAllocHook(nmspc, hook);
+        // clear the zones not in use before any is allocated
+        std::vector<bool> zones(std::numeric_limits<uint16_t>::max() + 1);
+        for (uint32_t id = minId; id <= maxId; ++id)
+            zones[id] = !gen.isIdUsed(nmspc, id);
+        LOG(DEBUG) << "Clearing free connection tracking zones";
+        if (!flushZones(zones))
+            LOG(ERROR) << "Failed to clear free connection tracking zones";
+
+        {
+            std::lock_guard<std::mutex> guard(flushMutex);
+            stopping = false;
+            if (!flushThread)
+                flushThread.reset(new std::thread(
+                    opflex::util::startThread("ctzone_flush",
+                                              [this]() { runFlush(); })));
+        }
+        IdGenerator::free_hook_t
+            hook(std::bind(&CtZoneManager::ctZoneFreeHook, this, _1, _2));
+        gen.setFreeHook(nmspc, hook);
 #else /* HAVE_LIBNFCT */
         LOG(WARNING) << "Netlink library not available and connection "
             "tracking is enabled.";
@@ -129,6 +200,18 @@ void CtZoneManager::init(const std::string& nmspc_) {
     }
 }
 
+void CtZoneManager::stop() {
+    std::unique_ptr<std::thread> thread;
+    {
+        std::lock_guard<std::mutex> guard(flushMutex);
+        stopping = true;
+        thread = std::move(flushThread);
+    }
+    flushCond.notify_all();
+    if (thread)
+        thread->join();
+}
+
 uint16_t CtZoneManager::getId(const std::string& str) {
     return static_cast<uint16_t>(gen.getId(nmspc, str));
 }
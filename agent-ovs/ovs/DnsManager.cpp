@@ -12,6 +12,7 @@
 #include "Packets.h"
 #include <fstream>
 #include <opflexagent/logging.h>
+#include <opflex/util/ThreadSettings.h>
 #include <modelgbp/epdr/DnsDiscovered.hpp>
 #include <modelgbp/epdr/DnsAsk.hpp>
 #include <thread>
@@ -57,6 +58,11 @@ namespace opflexagent {
                        << " is not a directory, not starting " << ec;
             return;
         }
+        {
+            std::unique_lock<std::mutex> lk(stateMutex);
+            expiryWheel.clear();
+            wheelEpoch = boost::posix_time::second_clock::local_time();
+        }
         restoreFromStore();
 
         uuidGen.reset(new basic_random_generator<boost::mt19937>(&randomSeed));
@@ -72,10 +78,11 @@ namespace opflexagent {
             expiryTimer->expires_from_now(boost::posix_time::seconds(1));
             expiryTimer->async_wait(boost::bind(&DnsManager::onExpiryTimer,this,boost::arg<1>()));
         }
-        parserThread.reset(new std::thread([this]() {
-           started = true;
-           io_ctxt.run();
-        }));
+        parserThread.reset(new std::thread(
+            opflex::util::startThread("dns_parser", [this]() {
+                    started = true;
+                    io_ctxt.run();
+                })));
     }
 
     void DnsManager::expireCName(DnsCacheEntry &entry) {
@@ -115,6 +122,7 @@ namespace opflexagent {
         while(learntItr != learntMappings.end()) {
             learntItr->second.aNames.erase(entry.domainName);
             commitToStore(learntItr->second);
+            scheduleAging(learntItr->first);
             learntItr = learntMappings.find(learntItr->second.getCName());
         }
         /*Current entry is committed to store in the caller*/
@@ -279,13 +287,26 @@ namespace opflexagent {
         }
         {
             std::unique_lock<std::mutex> lk(stateMutex);
-            for(auto itr = learntMappings.begin();
-                itr != learntMappings.end();) {
+            std::vector<std::string> due;
+            expiryWheel.advance(expiryTick(second_clock::local_time()), due);
+            std::unordered_set<std::string> aged;
+            for(const auto &domainName: due) {
+                if(!aged.insert(domainName).second) {
+                    continue;
+                }
+                auto itr = learntMappings.find(domainName);
+                if(itr == learntMappings.end()) {
+                    continue;
+                }
                 if (itr->second.age(*this)) {
                     commitToStore(itr->second,true);
-                    itr = learntMappings.erase(itr);
-                } else {
-                    itr++;
+                    learntMappings.erase(itr);
+                    continue;
+                }
+                /* Entries with nothing to expire wait for an update */
+                ptime expiry;
+                if(itr->second.nextExpiry(expiry)) {
+                    expiryWheel.schedule(domainName, expiryTick(expiry));
                 }
             }
         }
@@ -327,6 +348,37 @@ namespace opflexagent {
         return false;
     }
 
+    bool DnsCacheEntry::nextExpiry(boost::posix_time::ptime &expiry) const {
+        bool found = false;
+        auto earliest = [&](const boost::posix_time::ptime &t) {
+            if(!found || (t < expiry)) {
+                expiry = t;
+                found = true;
+            }
+        };
+        for(const auto &cA: Ips) {
+            earliest(cA.expiryTime);
+        }
+        for(const auto &srv: Srvs) {
+            earliest(srv.expiryTime);
+        }
+        if(isCName()) {
+            earliest(cachedCName.expiryTime);
+        }
+        return found;
+    }
+
+    uint64_t DnsManager::expiryTick(const boost::posix_time::ptime &time) const {
+        if(time <= wheelEpoch) {
+            return 0;
+        }
+        return (time - wheelEpoch).total_seconds();
+    }
+
+    void DnsManager::scheduleAging(const std::string &domainName) {
+        expiryWheel.schedule(domainName, expiryWheel.current() + 1);
+    }
+
     bool DnsManager::getResolvedAddresses(const std::string& name, std::unordered_set<std::string> &addr_set) {
         if(demandMappings.find(name) != demandMappings.end()) {
             addr_set = demandMappings[name].resolved;
@@ -425,80 +477,92 @@ namespace opflexagent {
         return true;
     }
 
-    static void ParseDomainName(DnsParsingContext &ctxt, std::string &domainName) {
-        uint32_t oldLabelOffset = ctxt.labelOffset;
-        std::list<std::string> emptyList;
-        ctxt.labelSet.emplace_back(emptyList);
-        DnsParsingContext::LabelSetIterator labelSetItr = std::prev(ctxt.labelSet.end());
-        std::string label;
-        uint8_t labelLen = 0;
-        for(; ((ctxt.tailRoom>0) && (ctxt.labelState != DnsParsingContext::terminatingLabel));
-             ctxt.dptr++, ctxt.tailRoom--) {
-            switch(ctxt.labelState){
-                case DnsParsingContext::seekingLabel:
-                {
-                    labelLen = (unsigned)*ctxt.dptr;
-                    if(labelLen == 0) {
-                        ctxt.labelState = DnsParsingContext::terminatingLabel;
-                        ctxt.labelOffset++;
-                        break;
-                    }
-                    if((labelLen & 0xc0) == 0xc0) {
-                        ctxt.labelState = DnsParsingContext::accumulatingPtr;
-                        ctxt.labelPtrHi = labelLen & 0x3f;
-                        break;
-                    }
-                    ctxt.labelOffset += labelLen+1;
-                    ctxt.labelState = DnsParsingContext::accumulatingLabel;
-                    break;
-                }
-                case DnsParsingContext::accumulatingPtr:
-                {
-                    uint32_t labelPtr = ((uint16_t)((((uint16_t)ctxt.labelPtrHi>>2)
-                         << 8)+ ((uint16_t)*ctxt.dptr)));
-                    if(ctxt.labelMap.find(labelPtr) != ctxt.labelMap.end()) {
-                        ctxt.labelMap[oldLabelOffset] = ctxt.labelMap[labelPtr];
-                        for(auto itr=ctxt.labelMap[labelPtr].second;
-                                itr!=ctxt.labelMap[labelPtr].first->end();itr++) {
-                            labelSetItr->push_back(*itr);
-                        }
-                    } else {
-                        LOG(ERROR) << "Failed to find label at offset " << std::hex << labelPtr;
-                    }
-                    ctxt.labelOffset += 2;
-                    oldLabelOffset = ctxt.labelOffset;
-                    ctxt.labelState = DnsParsingContext::terminatingLabel;
-                    break;
-                }
-                case DnsParsingContext::accumulatingLabel:
-                {
-                    label += *ctxt.dptr;
-                    labelLen--;
-                    if(labelLen == 0) {
-                        labelSetItr->push_back(label);
-                        DnsParsingContext::LabelStringIterator labelStringItr = std::prev(labelSetItr->end());
-                        ctxt.labelMap[oldLabelOffset] = std::make_pair(labelSetItr,labelStringItr);
-                        oldLabelOffset = ctxt.labelOffset;
-                        label.clear();
-                        ctxt.labelState = DnsParsingContext::seekingLabel;
-                    }
-                    break;
-                }
-                case DnsParsingContext::terminatingLabel:
-                {
-                    //Terminal state. cannot come here
+    /* RFC-1035 */
+    static const uint32_t DNS_MAX_NAME_LEN = 255;
+    /* a pointer can only go back, but let a loop of pointers fail fast */
+    static const unsigned DNS_MAX_NAME_PTRS = 32;
+
+    bool DnsParsingContext::skipName() {
+        while (hasRoom(1)) {
+            uint8_t labelLen = msg[offset];
+            if (labelLen == 0) {
+                offset += 1;
+                return true;
+            }
+            if ((labelLen & 0xc0) == 0xc0) {
+                if (!hasRoom(2))
+                    return false;
+                offset += 2;
+                return true;
+            }
+            if ((labelLen & 0xc0) != 0)
+                return false;
+            offset += labelLen + 1;
+        }
+        return false;
+    }
+
+    bool DnsParsingContext::getName(NameRef ref, std::string &name) const {
+        for (const auto &decoded : decodedNames) {
+            if (decoded.first == ref) {
+                name.assign(arena, decoded.second.first, decoded.second.second);
+                return true;
+            }
+        }
+        uint32_t start = arena.size();
+        uint32_t pos = ref;
+        unsigned ptrs = 0;
+        while (true) {
+            if (pos >= msgLen)
+                break;
+            uint8_t labelLen = msg[pos];
+            if (labelLen == 0) {
+                uint32_t len = arena.size() - start;
+                decodedNames.emplace_back(ref, std::make_pair(start, len));
+                name.assign(arena, start, len);
+                return true;
+            }
+            if ((labelLen & 0xc0) == 0xc0) {
+                if ((pos + 1 >= msgLen) || (++ptrs > DNS_MAX_NAME_PTRS))
                     break;
-                }
-           }
-      }
-        /* Reset domainname parsing state*/
-        ctxt.labelState = DnsParsingContext::seekingLabel;
-        for(auto itr=labelSetItr->begin(); itr!= labelSetItr->end(); itr++) {
-            domainName += *itr;
-            if(std::next(itr) != labelSetItr->end()){
-                domainName += ".";
+                pos = ((labelLen & 0x3f) << 8) | msg[pos + 1];
+                continue;
             }
+            if (((labelLen & 0xc0) != 0) || (pos + 1 + labelLen > msgLen))
+                break;
+            if (arena.size() != start)
+                arena += '.';
+            arena.append((const char *)msg + pos + 1, labelLen);
+            if (arena.size() - start > DNS_MAX_NAME_LEN)
+                break;
+            pos += labelLen + 1;
         }
+        LOG(ERROR) << "Malformed domain name at offset " << ref;
+        arena.resize(start);
+        return false;
+    }
+
+    bool DnsParsingContext::getRRData(const DnsRRView &view,
+                                      DnsRR &dnsRR) const {
+        switch(view.rType) {
+            case RRTypeA:
+                dnsRR.rrTypeAData = get32(view.rdOffset);
+                break;
+            case RRTypeA4:
+                memcpy(dnsRR.rrTypeA4Data.v6Bytes, msg + view.rdOffset,
+                       IP6_ADDR_LEN);
+                break;
+            case RRTypeCName:
+                return getName(view.rdOffset, dnsRR.rrTypeCNameData.cName);
+            case RRTypeSrv:
+                dnsRR.rrTypeSrvData.priority = get16(view.rdOffset);
+                dnsRR.rrTypeSrvData.weight = get16(view.rdOffset + 2);
+                dnsRR.rrTypeSrvData.port = get16(view.rdOffset + 4);
+                return getName(view.rdOffset + 6, dnsRR.rrTypeSrvData.hostName);
+            default:
+                break;
+        }
+        return true;
     }
 
     /* Debug printing*/
@@ -600,21 +664,28 @@ namespace opflexagent {
            ", Authority RRs: " << dnsCtxt.nsCount << ", Additional RRs: " << dnsCtxt.arCount << endl;
         os << "Queries:" << endl;
         for(const auto &q: dnsCtxt.questions){
-            os << q.domainName << ":  " << "type " << q.qType << ", class " << q.qClass;
+            std::string domainName;
+            dnsCtxt.getName(q.name, domainName);
+            os << domainName << ":  " << "type " << q.qType << ", class " << q.qClass;
         }
         os << endl;
+        auto printRRs = [&os, &dnsCtxt](
+            const std::vector<DnsParsingContext::DnsRRView> &rrs) {
+            for(const auto &view: rrs){
+                std::string domainName;
+                dnsCtxt.getName(view.name, domainName);
+                DnsRR dnsRR(domainName, view.rType, view.rClass, view.ttl,
+                            view.rdLen);
+                dnsCtxt.getRRData(view, dnsRR);
+                os << dnsRR << endl;
+            }
+        };
         os << "Answers: " << endl;
-        for(const auto &rr: dnsCtxt.answers){
-            os << rr << endl;
-        }
+        printRRs(dnsCtxt.answers);
         os << "Authorities: " << endl;
-        for(const auto &rr: dnsCtxt.authorities){
-            os << rr << endl;
-        }
+        printRRs(dnsCtxt.authorities);
         os << "Additional Records: " << endl;
-        for(const auto &rr: dnsCtxt.additionalRecords){
-            os << rr << endl;
-        }
+        printRRs(dnsCtxt.additionalRecords);
         return os;
     }
 
@@ -729,37 +800,58 @@ namespace opflexagent {
          * Allow for returning all matching entries regardless of whether they
          * contain direct addresses.This simplifies logic.
          * */
-        for(auto demandItr : demandMappings) {
+        std::unordered_set<std::string> demands;
+        auto addDemands = [this, &demands](const std::string &name) {
+            if(demandMappings.find(name) != demandMappings.end()) {
+                demands.insert(name);
+            }
+            wildcardDemands.visitMatches(name,
+                [&demands](const std::string &demand) {
+                    demands.insert(demand);
+                });
+        };
+        addDemands(entry.domainName);
+        for(const auto &aName: entry.aNames) {
+            addDemands(aName);
+        }
+        for(const auto &pSrv: entry.parentSrv) {
+            addDemands(pSrv);
+        }
+        for(const auto &demand : demands) {
+            auto demandItr = demandMappings.find(demand);
+            if(demandItr == demandMappings.end()) {
+                continue;
+            }
             DnsCacheEntry *terminalNode=NULL;
             std::string matchingAlias, matchingSrv;
-            bool regularMatch = DomainNameMatch(entry.domainName, demandItr.first);
-            if(regularMatch || entry.matchesAliases(demandItr.first, matchingAlias)
-               || entry.matchesSrv(demandItr.first, matchingSrv)) {
+            bool regularMatch = DomainNameMatch(entry.domainName, demandItr->first);
+            if(regularMatch || entry.matchesAliases(demandItr->first, matchingAlias)
+               || entry.matchesSrv(demandItr->first, matchingSrv)) {
                 if(entry.isCName()) {
                     terminalNode = getTerminalNode(entry);
                 }
-                auto dnsAnswer = dDiscoveredU.get()->addEpdrDnsAnswer(demandItr.first);
+                auto dnsAnswer = dDiscoveredU.get()->addEpdrDnsAnswer(demandItr->first);
                 if(changed) {
                     dnsAnswer->setUuid(boost::uuids::to_string((*uuidGen)()));
                 }
                 if(regularMatch) {
-                    linkEntryToAnswer(entry, dnsAnswer, demandItr.second);
+                    linkEntryToAnswer(entry, dnsAnswer, demandItr->second);
                 }
                 if(!entry.Srvs.empty()) {
-                    addSrvEndpoints(entry, dnsAnswer,demandItr.second);
+                    addSrvEndpoints(entry, dnsAnswer,demandItr->second);
                 }
                 if((terminalNode != NULL) && (terminalNode->domainName != entry.domainName)
                         && !terminalNode->isCName()) {
-                    linkEntryToAnswer(*terminalNode, dnsAnswer, demandItr.second);
+                    linkEntryToAnswer(*terminalNode, dnsAnswer, demandItr->second);
                 }
                 if(!matchingAlias.empty()) {
                     auto learntItr = learntMappings.find(entry.domainName);
-                    linkEntryToAnswer(learntItr->second, dnsAnswer, demandItr.second);
+                    linkEntryToAnswer(learntItr->second, dnsAnswer, demandItr->second);
                 }
                 if(!matchingSrv.empty()) {
                     auto learntItr = learntMappings.find(matchingSrv);
-                    addSrvEndpoints(learntItr->second, dnsAnswer, demandItr.second);
-                    linkEntryToAnswer(learntItr->second, dnsAnswer, demandItr.second);
+                    addSrvEndpoints(learntItr->second, dnsAnswer, demandItr->second);
+                    linkEntryToAnswer(learntItr->second, dnsAnswer, demandItr->second);
                 }
             }
         }
@@ -1028,6 +1120,7 @@ namespace opflexagent {
                 {
                     std::unique_lock<std::mutex> lk(stateMutex);
                     learntMappings.insert(std::make_pair(entry.domainName, entry));
+                    scheduleAging(entry.domainName);
                     updateMOs(entry, true);
                 }
             } catch (const std::exception& ex) {
@@ -1123,6 +1216,7 @@ namespace opflexagent {
                 DnsCacheEntry additionalEntry(srv.hostName);
                 additionalEntry.parentSrv.insert(entry.domainName);
                 learntMappings.insert(std::make_pair(srv.hostName,additionalEntry));
+                scheduleAging(srv.hostName);
                 LOG(DEBUG) << "Adding SRV mapping " << srv.hostName <<" to " << entry.domainName;
             }
         }
@@ -1150,103 +1244,74 @@ namespace opflexagent {
         }
         createSrvEntries(learntMappings[dnsRR.domainName]);
         commitToStore(learntMappings[dnsRR.domainName]);
+        scheduleAging(dnsRR.domainName);
+        if(dnsRR.isCName()) {
+            scheduleAging(dnsRR.getCName());
+        }
         updateMOs(learntMappings[dnsRR.domainName], changed);
     }
 
     void DnsManager::updateCache(DnsParsingContext &ctxt) {
         std::unique_lock<std::mutex> lk(stateMutex);
-        for(auto itr=ctxt.answers.begin(); itr != ctxt.answers.end(); itr++) {
-            updateCacheForRR(*itr);
-        }
-        for(auto itr=ctxt.additionalRecords.begin(); 
-                itr != ctxt.additionalRecords.end(); itr++) {
-            updateCacheForRR(*itr);
+        for(const auto *section: {&ctxt.answers, &ctxt.additionalRecords}) {
+            for(const auto &view: *section) {
+                std::string domainName;
+                if(!ctxt.getName(view.name, domainName))
+                    continue;
+                DnsRR dnsRR(domainName, view.rType, view.rClass, view.ttl,
+                            view.rdLen);
+                if(!ctxt.getRRData(view, dnsRR))
+                    continue;
+                updateCacheForRR(dnsRR);
+            }
         }
     }
 
-    bool DnsManager::parseRR(DnsParsingContext &ctxt, std::list<DnsRR> &result) {
-        DnsRRType rType;
-        DnsRRClass rClass;
-        std::string rrDomainName;
-        uint16_t ttl,rdLen;
-        ParseDomainName(ctxt,rrDomainName);
-        if((ctxt.labelState != DnsParsingContext::seekingLabel) ||
-           (ctxt.tailRoom < 10)) {
+    bool DnsManager::parseRR(DnsParsingContext &ctxt,
+                             std::vector<DnsParsingContext::DnsRRView> &result) {
+        DnsParsingContext::DnsRRView view;
+        view.name = ctxt.offset;
+        if(!ctxt.skipName() || !ctxt.hasRoom(10)) {
             LOG(ERROR) << "Incorrect "<< ctxt.parsingSection;
             return false;
         }
-        rType = (DnsRRType)ntohs((*(uint16_t *)ctxt.dptr));
-        ctxt.dptr += 2;
-        rClass = (DnsRRClass)ntohs(*((uint16_t *)ctxt.dptr));
-        ctxt.dptr += 2;
-        ttl = ntohl(*(uint32_t *)ctxt.dptr);
-        ctxt.dptr += 4;
-        rdLen = ntohs(*(uint16_t *)ctxt.dptr);
-        ctxt.dptr += 2;
-        ctxt.tailRoom -= 10;
-        ctxt.labelOffset += 10;
-        if (ctxt.tailRoom < rdLen) {
+        view.rType = (DnsRRType)ctxt.get16(ctxt.offset);
+        view.rClass = (DnsRRClass)ctxt.get16(ctxt.offset + 2);
+        view.ttl = ctxt.get32(ctxt.offset + 4);
+        view.rdLen = ctxt.get16(ctxt.offset + 8);
+        ctxt.offset += 10;
+        if (!ctxt.hasRoom(view.rdLen)) {
             LOG(ERROR) << "Incorrect "<< ctxt.parsingSection <<" record";
             return false;
         }
-        DnsRR dnsRR(rrDomainName, rType, rClass, ttl, rdLen);
-        switch(dnsRR.rType) {
+        view.rdOffset = ctxt.offset;
+        switch(view.rType) {
             case RRTypeA:
-            {
-                if(dnsRR.rdLen < 4) {
+                if(view.rdLen < 4) {
                     LOG(ERROR) << "Incorrect A record";
                     return false;
                 }
-                dnsRR.rrTypeAData = ntohl(*(uint32_t *)ctxt.dptr);
-                ctxt.dptr += dnsRR.rdLen;
-                ctxt.labelOffset += dnsRR.rdLen;
-                ctxt.tailRoom -= dnsRR.rdLen;
                 break;
-            }
             case RRTypeA4:
-            {
-                if(dnsRR.rdLen < IP6_ADDR_LEN) {
+                if(view.rdLen < IP6_ADDR_LEN) {
                     LOG(ERROR) << "Incorrect AAAA record";
                     return false;
                 }
-                memcpy(dnsRR.rrTypeA4Data.v6Bytes, ctxt.dptr, IP6_ADDR_LEN);
-                ctxt.dptr += dnsRR.rdLen;
-                ctxt.labelOffset += dnsRR.rdLen;
-                ctxt.tailRoom -= dnsRR.rdLen;
                 break;
-            }
             case RRTypeCName:
-            {
-                ParseDomainName(ctxt, dnsRR.rrTypeCNameData.cName);
                 break;
-            }
             case RRTypeSrv:
-            {
-                if(dnsRR.rdLen < 8) {
+                if(view.rdLen < 8) {
                     LOG(ERROR) << "Incorrect SRV record";
                     return false;
                 }
-                dnsRR.rrTypeSrvData.priority = ntohs(*(uint32_t *)ctxt.dptr);
-                ctxt.dptr += 2;
-                dnsRR.rrTypeSrvData.weight = ntohs(*(uint32_t *)ctxt.dptr);
-                ctxt.dptr += 2;
-                dnsRR.rrTypeSrvData.port = ntohs(*(uint32_t *)ctxt.dptr);
-                ctxt.dptr += 2;
-                ctxt.labelOffset += 6;
-                ctxt.tailRoom -= 6;
-                ParseDomainName(ctxt, dnsRR.rrTypeSrvData.hostName);
                 break;
-            }
             default:
-            {
-                LOG(DEBUG) << "Unhandled record type " << dnsRR.rType;
-                ctxt.dptr += dnsRR.rdLen;
-                ctxt.labelOffset += dnsRR.rdLen;
-                ctxt.tailRoom -= dnsRR.rdLen;
+                LOG(DEBUG) << "Unhandled record type " << view.rType;
                 break;
-            }
         }
-        result.emplace_back(dnsRR);
+        ctxt.offset += view.rdLen;
+        result.push_back(view);
         return true;
     }
 
@@ -1258,7 +1323,8 @@ namespace opflexagent {
             return false;
         }
         uint32_t tailroom = dpp_size(pkt) - l5_offset - DNS_HDR_LEN;
-        DnsParsingContext ctxt(hdr, tailroom);
+        DnsParsingContext &ctxt = parsingCtxt;
+        ctxt.reset(hdr, tailroom);
         if((hdr->hi_flag & DNS_RCODE_MASK) != 0) {
             //Ignore erroneous packets
             LOG(DEBUG) << "Ignoring server error";
@@ -1279,19 +1345,15 @@ namespace opflexagent {
             ctxt.parsingSection = DnsParsingContext::questionSection;
             for(int qdc = ctxt.qdCount; qdc>0; qdc--) {
                 DnsParsingContext::DnsQuestion dnsQuestion;
-                ParseDomainName(ctxt, dnsQuestion.domainName);
-                if((ctxt.labelState != DnsParsingContext::seekingLabel) ||
-                   (ctxt.tailRoom < 4)) {
-                LOG(ERROR) << "Incorrect question section";
-                return false;
-            }
-                dnsQuestion.qType = (DnsRRType)(ntohs(*(uint16_t *)(ctxt.dptr)));
-                ctxt.dptr += 2;
-                dnsQuestion.qClass = (DnsRRClass)(ntohs(*(uint16_t *)(ctxt.dptr)));
-                ctxt.dptr += 2;
-                ctxt.tailRoom -= 4;
-                ctxt.labelOffset += 4;
-                ctxt.questions.emplace_back(dnsQuestion);
+                dnsQuestion.name = ctxt.offset;
+                if(!ctxt.skipName() || !ctxt.hasRoom(4)) {
+                    LOG(ERROR) << "Incorrect question section";
+                    return false;
+                }
+                dnsQuestion.qType = (DnsRRType)ctxt.get16(ctxt.offset);
+                dnsQuestion.qClass = (DnsRRClass)ctxt.get16(ctxt.offset + 2);
+                ctxt.offset += 4;
+                ctxt.questions.push_back(dnsQuestion);
             }
             //Answer section
             ctxt.parsingSection = DnsParsingContext::answerSection;
@@ -1384,7 +1446,10 @@ namespace opflexagent {
            std::unique_lock<std::mutex> lk(stateMutex);
            auto p = demandMappings.insert(std::make_pair(askName,emptySet));
            if(askName.data()[0] =='*') {
-               for(auto lm: learntMappings) {
+               if(p.second) {
+                   wildcardDemands.insert(askName.substr(1)) = askName;
+               }
+               for(auto &lm: learntMappings) {
                    if(DomainNameMatch(lm.first,askName)) {
                        addCacheEntryToAnswer(askName, askUri,
                         lm.second, p.first->second, cacheSet, notifySet);
@@ -1423,22 +1488,30 @@ namespace opflexagent {
                modelgbp::epdr::DnsAnswer::remove(agent.getFramework(),elements.back());
                mutator.commit();
                demandMappings.erase(demandMappings.find(elements.back()));
+               if(elements.back().data()[0] == '*') {
+                   wildcardDemands.erase(elements.back().substr(1));
+               }
                notifySet.insert(askUri);
            }
        }
     }
 
-    void DnsManager::notifyListeners(class_id_t cid, const URI& notifyURI) {
+    void DnsManager::notifyListeners(class_id_t cid,
+                                     const std::unordered_set<URI>& notifySet) {
+        if(notifySet.empty()) {
+            return;
+        }
         std::lock_guard<std::mutex> guard(listenerMutex);
         for (DnsListener* listener : dnsListeners) {
-            listener->dnsDemandUpdated(cid, notifyURI);
+            listener->dnsDemandsUpdated(cid, notifySet);
         }
     }
 
     void DnsManager::processURI(class_id_t class_id,
                         std::mutex &qMutex, std::queue<URI> &uriQ,
-                        std::function<void (URI&, std::unordered_set<URI>&)> func) {
-        boost::optional <opflex::modb::URI &> uri;
+                        std::function<void (URI&, std::unordered_set<URI>&)> func,
+                        std::unordered_set<URI> &notifySet) {
+        boost::optional <opflex::modb::URI> uri;
         {
             std::unique_lock<std::mutex> qLk(qMutex);
             if(!uriQ.empty()) {
@@ -1446,14 +1519,10 @@ namespace opflexagent {
                uriQ.pop();
             }
         }
-        if(!uri){
+        if(!uri || !func){
             return;
         }
-        std::unordered_set<URI> notifySet;
         func(uri.get(),notifySet);
-        for(const auto &notifyUri: notifySet) {
-            notifyListeners(class_id, notifyUri);
-        }
     }
 
     void DnsManager::objectUpdated (class_id_t class_id,
@@ -1470,7 +1539,41 @@ namespace opflexagent {
                break;
            }
        }
-       io_ctxt.post([=]() {processURI(class_id, askQMutex, askQ, func);});
+       io_ctxt.post([=]() {
+           std::unordered_set<URI> notifySet;
+           processURI(class_id, askQMutex, askQ, func, notifySet);
+           notifyListeners(class_id, notifySet);
+       });
+    }
+
+    void DnsManager::objectsUpdated(const update_list_t& updates) {
+       {
+           std::unique_lock<std::mutex> lk(askQMutex);
+           for (const update_list_t::value_type& u : updates) {
+               askQ.push(u.second);
+           }
+       }
+       std::vector<class_id_t> classIds;
+       classIds.reserve(updates.size());
+       for (const update_list_t::value_type& u : updates) {
+           classIds.push_back(u.first);
+       }
+       std::function<void (URI &,std::unordered_set<URI>&)> askFunc =
+           boost::bind(&DnsManager::handleDnsAsk,this,boost::arg<1>(),boost::arg<2>());
+       // one task drains the whole batch from the queue, and
+       // listeners hear about the batch at once
+       io_ctxt.post([=]() {
+           std::function<void (URI &,std::unordered_set<URI>&)> none;
+           std::unordered_map<class_id_t, std::unordered_set<URI>> notifySets;
+           for (class_id_t class_id : classIds) {
+               processURI(class_id, askQMutex, askQ,
+                          class_id == modelgbp::epdr::DnsAsk::CLASS_ID ?
+                          askFunc : none, notifySets[class_id]);
+           }
+           for (const auto &notifySet : notifySets) {
+               notifyListeners(notifySet.first, notifySet.second);
+           }
+       });
     }
 
     void DnsManager::stop() {
@@ -1492,6 +1595,8 @@ namespace opflexagent {
             lock_guard<std::mutex> lk(stateMutex);
             learntMappings.clear();
             demandMappings.clear();
+            wildcardDemands.clear();
+            expiryWheel.clear();
         }
         {
             lock_guard<std::mutex> lk(listenerMutex);
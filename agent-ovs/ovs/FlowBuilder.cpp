@@ -16,8 +16,8 @@
 
 namespace opflexagent {
 
-FlowBuilder::FlowBuilder() : entry_(new FlowEntry()),
-    tlvEntry_(new TlvEntry()), ethType_(0) {
+FlowBuilder::FlowBuilder() : entry_(std::make_shared<FlowEntry>()),
+    ethType_(0) {
 
 }
 
@@ -325,6 +325,17 @@ FlowBuilder& FlowBuilder::mark(uint32_t value, uint32_t mask) {
     return *this;
 }
 
+FlowBuilder& FlowBuilder::conjId(uint32_t id) {
+    match_set_conj_id(match(), id);
+    return *this;
+}
+
+FlowBuilder& FlowBuilder::matchOf(const FlowEntry& fe) {
+    entry_->entry->priority = fe.entry->priority;
+    *match() = fe.entry->match;
+    return *this;
+}
+
 FlowBuilder& FlowBuilder::conntrackState(uint32_t ctState, uint32_t mask) {
     match_set_ct_state_masked(match(), ctState, mask);
     return *this;
@@ -354,6 +365,8 @@ FlowBuilder& FlowBuilder::outerIpDst(const boost::asio::ip::address& ip,
 
 FlowBuilder& FlowBuilder::tlv(uint16_t opt_class, uint8_t opt_type,
         uint8_t opt_len, uint16_t idx) {
+    if (!tlvEntry_)
+        tlvEntry_ = std::make_shared<TlvEntry>();
     tlvEntry_->entry->option_class = opt_class;
     tlvEntry_->entry->option_type = opt_type;
     tlvEntry_->entry->option_len = opt_len;
@@ -362,11 +375,13 @@ FlowBuilder& FlowBuilder::tlv(uint16_t opt_class, uint8_t opt_type,
 }
 
 TlvEntryPtr FlowBuilder::buildTlv() {
+    if (!tlvEntry_)
+        tlvEntry_ = std::make_shared<TlvEntry>();
     return tlvEntry_;
 }
 
 void FlowBuilder::buildTlv(TlvEntryList& tlvList) {
-    tlvList.push_back(tlvEntry_);
+    tlvList.push_back(buildTlv());
 }
 
 } // namespace opflexagent
@@ -10,6 +10,7 @@
 #include "FlowExecutor.h"
 
 #include <mutex>
+#include <vector>
 
 #include "ovs-shim.h"
 #include "ovs-ofputil.h"
@@ -26,7 +27,8 @@ typedef std::unique_lock<std::mutex> mutex_guard;
 
 namespace opflexagent {
 
-FlowExecutor::FlowExecutor() : swConn(NULL) {
+FlowExecutor::FlowExecutor()
+    : swConn(NULL), maxOutstanding(1), asyncOutstanding(0) {
 }
 
 FlowExecutor::~FlowExecutor() {
@@ -77,6 +79,102 @@ FlowExecutor::ExecuteNoBlock(const TlvEdit& te) {
     return ExecuteIntNoBlock<TlvEdit>(te);
 }
 
+bool
+FlowExecutor::Execute(const GroupEdit& before, const FlowEdit& fe,
+                      const GroupEdit& after) {
+    if (before.edits.empty() && fe.edits.empty() && after.edits.empty()) {
+        return true;
+    }
+    OfpBuf barrReq(ofputil_encode_barrier_request(
+       (ofp_version)swConn->GetProtocolVersion()));
+    ovs_be32 barrXid = ((ofp_header *)barrReq->data)->xid;
+
+    {
+        mutex_guard lock(reqMtx);
+        requests[barrXid];
+    }
+
+    int error = DoExecuteNoBlock<GroupEdit>(before, barrXid);
+    if (error == 0)
+        error = DoExecuteNoBlock<FlowEdit>(fe, barrXid);
+    if (error == 0)
+        error = DoExecuteNoBlock<GroupEdit>(after, barrXid);
+    if (error == 0) {
+        error = WaitOnBarrier(barrReq);
+    } else {
+        mutex_guard lock(reqMtx);
+        requests.erase(barrXid);
+    }
+    return error == 0;
+}
+
+void
+FlowExecutor::setMaxOutstanding(size_t window) {
+    mutex_guard lock(reqMtx);
+    maxOutstanding = window > 0 ? window : 1;
+    reqCondVar.notify_all();
+}
+
+bool
+FlowExecutor::ExecuteAsync(const FlowEdit& fe, const Completion& done) {
+    return ExecuteAsync(GroupEdit(), fe, GroupEdit(), done);
+}
+
+bool
+FlowExecutor::ExecuteAsync(const GroupEdit& before, const FlowEdit& fe,
+                           const GroupEdit& after, const Completion& done) {
+    if (before.edits.empty() && fe.edits.empty() && after.edits.empty()) {
+        done(0);
+        return true;
+    }
+    OfpBuf barrReq(ofputil_encode_barrier_request(
+       (ofp_version)swConn->GetProtocolVersion()));
+    ovs_be32 barrXid = ((ofp_header *)barrReq->data)->xid;
+
+    {
+        mutex_guard lock(reqMtx);
+        while (asyncOutstanding >= maxOutstanding) {
+            reqCondVar.wait(lock);
+        }
+        asyncOutstanding += 1;
+        requests[barrXid].completion = done;
+    }
+
+    int error = DoExecuteNoBlock<GroupEdit>(before, barrXid);
+    if (error == 0)
+        error = DoExecuteNoBlock<FlowEdit>(fe, barrXid);
+    if (error == 0)
+        error = DoExecuteNoBlock<GroupEdit>(after, barrXid);
+    if (error == 0) {
+        LOG(DEBUG) << "[" << swConn->getSwitchName() << "] "
+                   << "Sending barrier request xid=" << barrXid;
+        error = swConn->SendMessage(barrReq);
+        if (error) {
+            LOG(ERROR) << "[" << swConn->getSwitchName() << "] "
+                       << "Error sending barrier request: "
+                       << ovs_strerror(error);
+        }
+    }
+    if (error == 0)
+        return true;
+
+    /* The request may already have been failed by a reconnection */
+    Completion completion;
+    {
+        mutex_guard lock(reqMtx);
+        RequestMap::iterator itr = requests.find(barrXid);
+        if (itr != requests.end()) {
+            completion.swap(itr->second.completion);
+            requests.erase(itr);
+            asyncOutstanding -= 1;
+            reqCondVar.notify_all();
+        }
+    }
+    if (completion)
+        completion(error);
+    return false;
+}
+
 template<typename T>
 bool
 FlowExecutor::ExecuteInt(const T& fe) {
@@ -200,26 +298,36 @@ template<typename T>
 int
 FlowExecutor::DoExecuteNoBlock(const T& fe,
         const boost::optional<ovs_be32>& barrXid) {
+    if (fe.edits.empty()) {
+        return 0;
+    }
     ofp_version ofVersion = (ofp_version)swConn->GetProtocolVersion();
 
+    std::vector<OfpBuf> msgs;
+    msgs.reserve(fe.edits.size());
     for (const typename T::Entry& e : fe.edits) {
-        OfpBuf msg(EncodeMod<typename T::Entry>(e, ofVersion));
-        ovs_be32 xid = ((ofp_header *)msg->data)->xid;
-        if (barrXid) {
-            mutex_guard lock(reqMtx);
-            requests[barrXid.get()].reqXids.insert(xid);
-        }
+        msgs.push_back(EncodeMod<typename T::Entry>(e, ofVersion));
         LOG(DEBUG) << "[" << swConn->getSwitchName() << "] "
-                   << "Executing xid=" << ntohl(xid) << ", " << e;
-        int error = swConn->SendMessage(msg);
-        if (error) {
-            LOG(ERROR) << "[" << swConn->getSwitchName() << "] "
-                       << "Error sending flow mod message: "
-                       << ovs_strerror(error);
-            return error;
+                   << "Executing xid="
+                   << ntohl(((ofp_header *)msgs.back()->data)->xid)
+                   << ", " << e;
+    }
+    if (barrXid) {
+        mutex_guard lock(reqMtx);
+        std::unordered_set<uint32_t>& reqXids =
+            requests[barrXid.get()].reqXids;
+        for (const OfpBuf& msg : msgs) {
+            reqXids.insert(((ofp_header *)msg->data)->xid);
         }
     }
-    return 0;
+
+    int error = swConn->SendMessages(msgs);
+    if (error) {
+        LOG(ERROR) << "[" << swConn->getSwitchName() << "] "
+                   << "Error sending flow mod message: "
+                   << ovs_strerror(error);
+    }
+    return error;
 }
 
 int
@@ -273,7 +381,19 @@ FlowExecutor::Handle(SwitchConnection *,
     case OFPTYPE_BARRIER_REPLY:
         {
             RequestMap::iterator itr = requests.find(recvXid);
-            if (itr != requests.end()) {    // request complete
+            if (itr == requests.end())
+                break;
+            if (itr->second.completion) {
+                /* nobody waits for asynchronous requests */
+                Completion completion;
+                completion.swap(itr->second.completion);
+                int status = itr->second.status;
+                requests.erase(itr);
+                asyncOutstanding -= 1;
+                reqCondVar.notify_all();
+                lock.unlock();
+                completion(status);
+            } else {                        // request complete
                 itr->second.done = true;
                 reqCondVar.notify_all();
             }
@@ -289,13 +409,27 @@ FlowExecutor::Handle(SwitchConnection *,
 void
 FlowExecutor::Connected(SwitchConnection*) {
     /* If connection was re-established, fail outstanding requests */
+    std::vector<Completion> failed;
     mutex_guard lock(reqMtx);
-    for (RequestMap::value_type& kv : requests) {
-        RequestState& req = kv.second;
-        req.status = ENOTCONN;
-        req.done = true;
+    for (RequestMap::iterator itr = requests.begin();
+         itr != requests.end(); ) {
+        RequestState& req = itr->second;
+        if (req.completion) {
+            failed.push_back(std::move(req.completion));
+            itr = requests.erase(itr);
+        } else {
+            req.status = ENOTCONN;
+            req.done = true;
+            ++itr;
+        }
     }
+    asyncOutstanding = 0;
     reqCondVar.notify_all();
+    lock.unlock();
+
+    for (const Completion& completion : failed) {
+        completion(ENOTCONN);
+    }
 }
 
 } // namespace opflexagent
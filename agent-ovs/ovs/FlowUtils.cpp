@@ -12,6 +12,7 @@
 #include "FlowBuilder.h"
 #include "eth.h"
 #include "ovs-shim.h"
+#include "ovs-ofputil.h"
 
 #include <modelgbp/l2/EtherTypeEnumT.hpp>
 #include <modelgbp/l4/TcpFlagsEnumT.hpp>
@@ -19,6 +20,8 @@
 
 #include <boost/asio/ip/address.hpp>
 
+#include <algorithm>
+#include <cmath>
 #include <vector>
 #include <functional>
 
@@ -50,24 +53,79 @@ FlowEntryPtr default_out_flow() {
         .parent().build();
 }
 
-static uint16_t match_protocol(FlowBuilder& f, L24Classifier& classifier) {
+/* the sum of the bucket weights of a drop sampling group */
+static const uint16_t DROP_SAMPLE_WEIGHT = 10000;
+
+static uint16_t drop_sample_weight(double probability) {
+    long w = lround(probability * DROP_SAMPLE_WEIGHT);
+    return (uint16_t)std::min(std::max(w, 1L), DROP_SAMPLE_WEIGHT - 1L);
+}
+
+bool is_drop_sampled(double probability) {
+    return probability > 0 && probability < 1;
+}
+
+FlowEntryPtr table_drop_flow(uint8_t tableId, uint8_t dropTable,
+                             double probability) {
+    FlowBuilder fb;
+    fb.priority(0).cookie(flow::cookie::TABLE_DROP_FLOW)
+        .flags(OFPUTIL_FF_SEND_FLOW_REM);
+    // the flow counts every drop even when none of them is logged
+    if (probability <= 0) {
+        return fb.build();
+    }
+    fb.action().dropLog(tableId);
+    if (is_drop_sampled(probability)) {
+        fb.action().group(DROP_SAMPLE_GROUP_BASE + tableId);
+    } else {
+        fb.action().go(dropTable);
+    }
+    return fb.build();
+}
+
+GroupEdit::Entry drop_sample_group(uint16_t command, uint8_t tableId,
+                                   uint8_t dropTable, double probability) {
+    GroupEdit::Entry entry(new GroupEdit::GroupMod());
+    entry->mod->command = command;
+    entry->mod->group_id = DROP_SAMPLE_GROUP_BASE + tableId;
+    if (command == OFPGC11_DELETE)
+        return entry;
+    entry->mod->type = OFPGT11_SELECT;
+
+    uint16_t weight = drop_sample_weight(probability);
+    for (uint32_t bucketId = 0; bucketId < 2; ++bucketId) {
+        ofputil_bucket *bkt = (ofputil_bucket *)malloc(sizeof(ofputil_bucket));
+        bkt->bucket_id = bucketId;
+        bkt->watch_port = OFPP_ANY;
+        bkt->watch_group = OFPG_ANY;
+        ActionBuilder ab;
+        if (bucketId == 0) {
+            bkt->weight = weight;
+            ab.resubmit(OFPP_IN_PORT, dropTable);
+        } else {
+            bkt->weight = DROP_SAMPLE_WEIGHT - weight;
+        }
+        ab.build(bkt);
+        ovs_list_push_back(&entry->mod->buckets, &bkt->list_node);
+    }
+    return entry;
+}
+
+static uint16_t match_protocol(FlowBuilder& f,
+                               const ClassifierMatch& classifier) {
     using modelgbp::arp::OpcodeEnumT;
     using modelgbp::l2::EtherTypeEnumT;
 
-    uint8_t arpOpc =
-            classifier.getArpOpc(OpcodeEnumT::CONST_UNSPECIFIED);
-    uint16_t ethT =
-            classifier.getEtherT(EtherTypeEnumT::CONST_UNSPECIFIED);
-    if (arpOpc != OpcodeEnumT::CONST_UNSPECIFIED) {
-        f.proto(arpOpc);
+    if (classifier.arpOpc != OpcodeEnumT::CONST_UNSPECIFIED) {
+        f.proto(classifier.arpOpc);
     }
-    if (ethT != EtherTypeEnumT::CONST_UNSPECIFIED) {
-        f.ethType(ethT);
+    if (classifier.etherType != EtherTypeEnumT::CONST_UNSPECIFIED) {
+        f.ethType(classifier.etherType);
     }
-    if (classifier.isProtSet()) {
-        f.proto(classifier.getProt().get());
+    if (classifier.protSet) {
+        f.proto(classifier.prot);
     }
-    return ethT;
+    return classifier.etherType;
 }
 
 static void match_tcp_flags(FlowBuilder& f, uint32_t tcpFlags) {
@@ -163,6 +221,44 @@ static flow_func make_flow_functor(const network::service_port_t& ss,
             ss.proto, ss.port, _2);
 }
 
+void compile_classifier(L24Classifier& clsfr,
+                        /* out */ ClassifierMatch& match) {
+    using modelgbp::arp::OpcodeEnumT;
+    using modelgbp::l2::EtherTypeEnumT;
+    using modelgbp::l4::TcpFlagsEnumT;
+
+    match.etherType = clsfr.getEtherT(EtherTypeEnumT::CONST_UNSPECIFIED);
+    match.arpOpc = clsfr.getArpOpc(OpcodeEnumT::CONST_UNSPECIFIED);
+    match.protSet = clsfr.isProtSet();
+    match.prot = clsfr.getProt(0);
+    match.tcpFlags = clsfr.getTcpFlags(TcpFlagsEnumT::CONST_UNSPECIFIED);
+
+    match.srcPorts.clear();
+    match.dstPorts.clear();
+    if (clsfr.getProt(0) == 1 &&
+        (clsfr.isIcmpTypeSet() || clsfr.isIcmpCodeSet())) {
+        if (clsfr.isIcmpTypeSet()) {
+            match.srcPorts.push_back(Mask(clsfr.getIcmpType(0), ~0));
+        }
+        if (clsfr.isIcmpCodeSet()) {
+            match.dstPorts.push_back(Mask(clsfr.getIcmpCode(0), ~0));
+        }
+    } else {
+        RangeMask::getMasks(clsfr.getSFromPort(), clsfr.getSToPort(),
+                            match.srcPorts);
+        RangeMask::getMasks(clsfr.getDFromPort(), clsfr.getDToPort(),
+                            match.dstPorts);
+    }
+
+    /* Add a "ignore" mask to empty ranges - makes the loop later easy */
+    if (match.srcPorts.empty()) {
+        match.srcPorts.push_back(Mask(0x0, 0x0));
+    }
+    if (match.dstPorts.empty()) {
+        match.dstPorts.push_back(Mask(0x0, 0x0));
+    }
+}
+
 void add_l2classifier_entries(L24Classifier& clsfr, ClassAction act, bool log,
                               uint8_t nextTable, uint8_t currentTable, uint8_t dropTable,
                               uint16_t priority,
@@ -170,7 +266,22 @@ void add_l2classifier_entries(L24Classifier& clsfr, ClassAction act, bool log,
                               uint32_t svnid, uint32_t dvnid,
                               bool isSystemRule,
                               /* out */ FlowEntryList& entries) {
-    if (clsfr.isProtSet())
+    ClassifierMatch match;
+    compile_classifier(clsfr, match);
+    add_l2classifier_entries(match, act, log, nextTable, currentTable,
+                             dropTable, priority, flags, cookie,
+                             svnid, dvnid, isSystemRule, entries);
+}
+
+void add_l2classifier_entries(const ClassifierMatch& clsfr,
+                              ClassAction act, bool log,
+                              uint8_t nextTable, uint8_t currentTable, uint8_t dropTable,
+                              uint16_t priority,
+                              uint32_t flags, uint64_t cookie,
+                              uint32_t svnid, uint32_t dvnid,
+                              bool isSystemRule,
+                              /* out */ FlowEntryList& entries) {
+    if (clsfr.protSet)
         return;
 
     ovs_be64 ckbe = ovs_htonll(cookie);
@@ -209,39 +320,38 @@ void add_classifier_entries(L24Classifier& clsfr, ClassAction act, bool log,
                             uint32_t svnid, uint32_t dvnid,
                             bool isSystemRule,
                             /* out */ FlowEntryList& entries) {
+    ClassifierMatch match;
+    compile_classifier(clsfr, match);
+    add_classifier_entries(match, act, log, sourceSub, destSub,
+                           destNamedAddresses, nextTable, currentTable,
+                           dropTable, priority, flags, cookie,
+                           svnid, dvnid, isSystemRule, entries);
+}
+
+void add_classifier_entries(const ClassifierMatch& clsfr,
+                            ClassAction act, bool log,
+                            boost::optional<const network::subnets_t&> sourceSub,
+                            boost::optional<const network::subnets_t&> destSub,
+                            boost::optional<const network::service_ports_t&> destNamedAddresses,
+                            uint8_t nextTable, uint8_t currentTable, uint8_t dropTable,
+                            uint16_t priority,
+                            uint32_t flags, uint64_t cookie,
+                            uint32_t svnid, uint32_t dvnid,
+                            bool isSystemRule,
+                            /* out */ FlowEntryList& entries) {
     using modelgbp::l2::EtherTypeEnumT;
     using modelgbp::l4::TcpFlagsEnumT;
     ovs_be64 ckbe = ovs_htonll(cookie);
-    MaskList srcPorts;
-    MaskList dstPorts;
+    const MaskList& srcPorts = clsfr.srcPorts;
+    const MaskList& dstPorts = clsfr.dstPorts;
 
     if (isSystemRule){
         svnid = 0;
         dvnid = 0;
     }
-    if (clsfr.getProt(0) == 1 &&
-        (clsfr.isIcmpTypeSet() || clsfr.isIcmpCodeSet())) {
-        if (clsfr.isIcmpTypeSet()) {
-            srcPorts.push_back(Mask(clsfr.getIcmpType(0), ~0));
-        }
-        if (clsfr.isIcmpCodeSet()) {
-            dstPorts.push_back(Mask(clsfr.getIcmpCode(0), ~0));
-        }
-    } else {
-        RangeMask::getMasks(clsfr.getSFromPort(), clsfr.getSToPort(), srcPorts);
-        RangeMask::getMasks(clsfr.getDFromPort(), clsfr.getDToPort(), dstPorts);
-    }
-
-    /* Add a "ignore" mask to empty ranges - makes the loop later easy */
-    if (srcPorts.empty()) {
-        srcPorts.push_back(Mask(0x0, 0x0));
-    }
-    if (dstPorts.empty()) {
-        dstPorts.push_back(Mask(0x0, 0x0));
-    }
 
     vector<uint32_t> tcpFlagsVec;
-    uint32_t tcpFlags = clsfr.getTcpFlags(TcpFlagsEnumT::CONST_UNSPECIFIED);
+    uint32_t tcpFlags = clsfr.tcpFlags;
     if (tcpFlags & TcpFlagsEnumT::CONST_ESTABLISHED) {
         tcpFlagsVec.push_back(0 + TcpFlagsEnumT::CONST_ACK);
         tcpFlagsVec.push_back(0 + TcpFlagsEnumT::CONST_RST);
@@ -267,7 +377,7 @@ void add_classifier_entries(L24Classifier& clsfr, ClassAction act, bool log,
              */
             if (act == flowutils::CA_REFLEX_REV_RELATED) {
                 FlowBuilder f;
-                uint16_t ethT = clsfr.getEtherT(EtherTypeEnumT::CONST_UNSPECIFIED);
+                uint16_t ethT = clsfr.etherType;
 
                 if (ethT == EtherTypeEnumT::CONST_IPV4 ||
                     ethT == EtherTypeEnumT::CONST_IPV6) {
@@ -6,14 +6,13 @@
  * and is available at http://www.eclipse.org/legal/epl-v10.html
  */
 
+#include <algorithm>
 #include <string>
 #include <cstring>
 #include <sys/resource.h>
 #include <unistd.h>
 #include <sys/syscall.h>
 #include <boost/system/error_code.hpp>
-#include <boost/property_tree/ptree.hpp>
-#include <boost/property_tree/json_parser.hpp>
 #include <boost/lexical_cast.hpp>
 
 #include <netinet/icmp6.h>
@@ -36,6 +35,7 @@
 #include <boost/uuid/uuid_io.hpp>
 
 #include <opflexagent/logging.h>
+#include <opflex/util/ThreadSettings.h>
 #include <opflexagent/Endpoint.h>
 #include <opflexagent/EndpointManager.h>
 #include <opflexagent/Faults.h>
@@ -72,7 +72,6 @@ using opflex::modb::MAC;
 using opflex::modb::class_id_t;
 using modelgbp::observer::SvcStatUniverse;
 
-namespace pt = boost::property_tree;
 using namespace modelgbp::gbp;
 using namespace modelgbp::gbpe;
 
@@ -85,7 +84,8 @@ namespace opflexagent {
 static const char* ID_NAMESPACES[] =
     {"floodDomain", "bridgeDomain", "routingDomain",
      "externalNetwork", "l24classifierRule",
-     "svcstats", "service"};
+     "svcstats", "service", "conjunction", "endpointDest",
+     "serviceGroup", "serviceNextHop"};
 
 static const char* ID_NMSPC_FD            = ID_NAMESPACES[0];
 static const char* ID_NMSPC_BD            = ID_NAMESPACES[1];
@@ -94,6 +94,14 @@ static const char* ID_NMSPC_EXTNET        = ID_NAMESPACES[3];
 static const char* ID_NMSPC_L24CLASS_RULE = ID_NAMESPACES[4];
 static const char* ID_NMSPC_SVCSTATS      = ID_NAMESPACES[5];
 static const char* ID_NMSPC_SERVICE       = ID_NAMESPACES[6];
+static const char* ID_NMSPC_CONJ          = ID_NAMESPACES[7];
+static const char* ID_NMSPC_EPDEST        = ID_NAMESPACES[8];
+static const char* ID_NMSPC_SVCGROUP      = ID_NAMESPACES[9];
+static const char* ID_NMSPC_SVCNEXTHOP    = ID_NAMESPACES[10];
+
+/* the service attribute that opts a service in to the detailed stats
+ * flows when the service stats are aggregated */
+static const std::string SERVICE_STATS_ATTR("service-stats");
 
 
 
@@ -122,6 +130,8 @@ void IntFlowManager::populateTableDescriptionMap(
     TABLE_DESC(LEARN_TABLE_ID, "LEARN_TABLE", "Learn table drop")
     TABLE_DESC(SERVICE_DST_TABLE_ID, "SERVICE_DST_TABLE",
             "Service destination missing/incorrect")
+    TABLE_DESC(ENDPOINT_DST_TABLE_ID, "ENDPOINT_DST_TABLE",
+            "Endpoint destination missing/incorrect")
     TABLE_DESC(POL_TABLE_ID, "POL_TABLE", "Contract missing/incorrect")
     TABLE_DESC(STATS_TABLE_ID, "STATS_TABLE", "Stats Table drop")
     TABLE_DESC(OUT_TABLE_ID, "OUT_TABLE",
@@ -140,8 +150,13 @@ IntFlowManager::IntFlowManager(Agent& agent_,
     taskQueue(agent.getAgentIOService()), encapType(ENCAP_NONE),
     floodScope(FLOOD_DOMAIN), virtualRouterEnabled(false),
     routerMac{}, routerAdv(false), virtualDHCPEnabled(false),
-    conntrackEnabled(false), dhcpMac{}, dropLogRemotePort(0),
-    serviceStatsFlowDisabled(false),
+    conntrackEnabled(false), dhcpMac{}, mcastGroupJournal(false),
+    updateDebounce(0),
+    updateMaxDebounce(0), conjunctiveContracts(false),
+    endpointDestLookup(false), routeAggregation(false), stagedSync(false),
+    serviceSelectGroups(false),
+    flowComputeThreads(1), flowWorkers("flow_compute"), dropLogRemotePort(0),
+    serviceStatsFlowDisabled(false), serviceStatsAggregated(false),
     advertManager(agent, *this), isSyncing(false), stopping(false),
     svcStatsTaskQueue(svcStatsIOService) {
     // set up flow tables
@@ -150,6 +165,9 @@ IntFlowManager::IntFlowManager(Agent& agent_,
     populateTableDescriptionMap(fwdTblDescr);
     switchManager.setForwardingTableList(fwdTblDescr);
     tunnelDst = address::from_string("127.0.0.1");
+    taskQueue.setLatency(&agent.getDataplaneLatency());
+    taskQueue.setWatchdog(&agent.getTaskWatchdog(), "int_flow");
+    svcStatsTaskQueue.setWatchdog(&agent.getTaskWatchdog(), "svc_stats");
 
     agent.getFramework().registerPeerStatusListener(this);
 }
@@ -174,9 +192,12 @@ void IntFlowManager::start(bool serviceStatsFlowDisabled_) {
     initPlatformConfig();
     createStaticFlows();
 
+    flowWorkers.start(flowComputeThreads - 1);
+
     svcStatsIOWork.reset(new boost::asio::io_service::work(svcStatsIOService));
     svcStatsThread.reset(new std::thread([this]() {
             LOG(DEBUG) << "svcStatsThread start IO run";
+            opflex::util::initThread("svc_stats");
             const pid_t tid = syscall(SYS_gettid);
             // By default sched policy is SCHED_OTHER for all threads in linux.
             // Default priority is 0. SCHED_FIFO/RR will make threads with
@@ -223,6 +244,7 @@ void IntFlowManager::stop() {
         svcStatsThread->join();
         svcStatsThread.reset();
     }
+    flowWorkers.stop();
 
     agent.getEndpointManager().unregisterListener(this);
     agent.getServiceManager().unregisterListener(this);
@@ -326,14 +348,67 @@ void IntFlowManager::setVirtualDHCP(bool dhcpEnabled,
 
 void IntFlowManager::setEndpointAdv(AdvertManager::EndpointAdvMode mode,
         AdvertManager::EndpointAdvMode tunnelMode,
-        uint64_t tunnelAdvIntvl) {
+        uint64_t tunnelAdvIntvl,
+        uint32_t advRateLimit) {
     if (mode != AdvertManager::EPADV_DISABLED)
         advertManager.enableEndpointAdv(mode);
     advertManager.enableTunnelEndpointAdv(tunnelMode, tunnelAdvIntvl);
+    advertManager.setAdvRateLimit(advRateLimit);
 }
 
 void IntFlowManager::setMulticastGroupFile(const string& mcastGroupFile) {
     this->mcastGroupFile = mcastGroupFile;
+    mcastGroupWriter.reset();
+}
+
+void IntFlowManager::setMulticastGroupJournal(bool enabled) {
+    mcastGroupJournal = enabled;
+    mcastGroupWriter.reset();
+}
+
+void IntFlowManager::setUpdateDebounce(std::chrono::milliseconds delay,
+                                       std::chrono::milliseconds maxDelay) {
+    updateDebounce = delay;
+    updateMaxDebounce = maxDelay;
+}
+
+void IntFlowManager::setConjunctiveContracts(bool enabled) {
+    conjunctiveContracts = enabled;
+}
+
+void IntFlowManager::setEndpointDestLookup(bool enabled) {
+    endpointDestLookup = enabled;
+}
+
+void IntFlowManager::setRouteAggregation(bool enabled) {
+    routeAggregation = enabled;
+}
+
+void IntFlowManager::setStagedSync(bool enabled) {
+    stagedSync = enabled;
+}
+
+void IntFlowManager::setServiceSelectGroups(bool enabled) {
+    serviceSelectGroups = enabled;
+}
+
+uint32_t IntFlowManager::getEndpointDestId(const string& uuid,
+                                           const string& kind,
+                                           size_t addresses) {
+    const string key(kind + ":" + uuid);
+    // a single address is cheaper to match with the actions inline
+    if (!endpointDestLookup || addresses < 2) {
+        if (idGen.getIdNoAlloc(ID_NMSPC_EPDEST, key) !=
+            static_cast<uint32_t>(-1))
+            idGen.erase(ID_NMSPC_EPDEST, key);
+        return 0;
+    }
+    uint32_t id = idGen.getId(ID_NMSPC_EPDEST, key);
+    return id == static_cast<uint32_t>(-1) ? 0 : id;
+}
+
+void IntFlowManager::setFlowComputeThreads(size_t threads) {
+    flowComputeThreads = threads > 0 ? threads : 1;
 }
 
 void IntFlowManager::enableConnTrack() {
@@ -360,9 +435,32 @@ address IntFlowManager::getEPGTunnelDst(const URI& epgURI) {
         return getTunnelDst();
 }
 
+static const string ENDPOINT_BATCH_ITEM("endpoint-batch");
+
 void IntFlowManager::endpointUpdated(const string& uuid) {
     if (stopping) return;
 
+    if (queueEndpointUpdate(uuid))
+        taskQueue.dispatch(ENDPOINT_BATCH_ITEM,
+                           [this]() { handleEndpointBatch(); },
+                           TaskQueue::HIGH);
+}
+
+void IntFlowManager::endpointsUpdated(const unordered_set<string>& uuids) {
+    if (stopping) return;
+
+    bool queued = false;
+    for (const string& uuid : uuids) {
+        if (queueEndpointUpdate(uuid))
+            queued = true;
+    }
+    if (queued)
+        taskQueue.dispatch(ENDPOINT_BATCH_ITEM,
+                           [this]() { handleEndpointBatch(); },
+                           TaskQueue::HIGH);
+}
+
+bool IntFlowManager::queueEndpointUpdate(const string& uuid) {
     if(tunnelEpManager.isTunnelEp(uuid)){
         string uplinkIface;
         tunnelEpManager.getUplinkIface(uplinkIface);
@@ -372,10 +470,33 @@ void IntFlowManager::endpointUpdated(const string& uuid) {
             // This is true in the cloud case
             LOG(INFO) << "Configured uplink is empty.Not starting Tunnel advertisements";
         }
-        return;
+        return false;
     }
     advertManager.scheduleEndpointAdv(uuid);
-    taskQueue.dispatch(uuid, [=]() { handleEndpointUpdate(uuid); });
+
+    const std::lock_guard<mutex> lock(endpointUpdateMutex);
+    endpointUpdates.insert(uuid);
+    return true;
+}
+
+void IntFlowManager::handleEndpointBatch() {
+    unordered_set<string> uuids;
+    {
+        const std::lock_guard<mutex> lock(endpointUpdateMutex);
+        uuids.swap(endpointUpdates);
+    }
+
+    // the flows of all the endpoints go to the switch together
+    SwitchManager::Batch batch(switchManager);
+    for (const string& uuid : uuids) {
+        try {
+            handleEndpointUpdate(uuid);
+        } catch (const std::exception& e) {
+            LOG_RATE_LIMITED_DEFAULT(ERROR)
+                << "Exception while updating endpoint " << uuid
+                << ": " << e.what();
+        }
+    }
 }
 
 void IntFlowManager::localExternalDomainUpdated(const URI& egURI) {
@@ -383,10 +504,39 @@ void IntFlowManager::localExternalDomainUpdated(const URI& egURI) {
     taskQueue.dispatch(egURI.toString(), [=]() { handleLocalExternalDomainUpdated(egURI); });
 }
 
+static const string REMOTE_ENDPOINT_BATCH_ITEM("remote-endpoint-batch");
+
 void IntFlowManager::remoteEndpointUpdated(const string& uuid) {
-    if (stopping) return;
-    taskQueue.dispatch(uuid,
-                       [=](){ handleRemoteEndpointUpdate(uuid); });
+    remoteEndpointsUpdated(unordered_set<string>{uuid});
+}
+
+void IntFlowManager::remoteEndpointsUpdated(const unordered_set<string>& uuids) {
+    if (stopping || uuids.empty()) return;
+    {
+        const std::lock_guard<mutex> lock(remoteEndpointUpdateMutex);
+        remoteEndpointUpdates.insert(uuids.begin(), uuids.end());
+    }
+    taskQueue.dispatch(REMOTE_ENDPOINT_BATCH_ITEM,
+                       [this]() { handleRemoteEndpointBatch(); });
+}
+
+void IntFlowManager::handleRemoteEndpointBatch() {
+    unordered_set<string> uuids;
+    {
+        const std::lock_guard<mutex> lock(remoteEndpointUpdateMutex);
+        uuids.swap(remoteEndpointUpdates);
+    }
+
+    SwitchManager::Batch batch(switchManager);
+    for (const string& uuid : uuids) {
+        try {
+            handleRemoteEndpointUpdate(uuid);
+        } catch (const std::exception& e) {
+            LOG_RATE_LIMITED_DEFAULT(ERROR)
+                << "Exception while updating remote endpoint " << uuid
+                << ": " << e.what();
+        }
+    }
 }
 
 void IntFlowManager::serviceUpdated(const string& uuid) {
@@ -403,6 +553,7 @@ void IntFlowManager::rdConfigUpdated(const URI& rdURI) {
 void IntFlowManager::packetDropLogConfigUpdated(const URI& dropLogCfgURI) {
     if(stopping)
         return;
+    updateTableDropFlows();
     using modelgbp::observer::DropLogConfig;
     using modelgbp::observer::DropLogModeEnumT;
     FlowEntryList dropLogFlows;
@@ -513,21 +664,48 @@ void IntFlowManager::lbVlanUpdated(LearningBridgeIface::vlan_range_t vlan) {
 void IntFlowManager::egDomainUpdated(const URI& egURI) {
     if (stopping) return;
 
-    taskQueue.dispatch(egURI.toString(),
-                       [=]() { handleEndpointGroupDomainUpdate(egURI); });
+    taskQueue.dispatchDebounced(egURI.toString(), updateDebounce,
+                                [=]() { handleEndpointGroupDomainUpdate(egURI); },
+                                updateMaxDebounce, TaskQueue::HIGH);
 }
 
 void IntFlowManager::domainUpdated(opflex::modb::class_id_t cid, const URI& domURI) {
     if (stopping) return;
 
-    taskQueue.dispatch(domURI.toString(),
-                       [=]() { handleDomainUpdate(cid, domURI); });
+    taskQueue.dispatchDebounced(domURI.toString(), updateDebounce,
+                                [=]() { handleDomainUpdate(cid, domURI); },
+                                updateMaxDebounce);
 }
 
 void IntFlowManager::contractUpdated(const URI& contractURI) {
     if (stopping) return;
-    taskQueue.dispatch(contractURI.toString(),
-                       [=]() { handleContractUpdate(contractURI); });
+    {
+        const std::lock_guard<mutex> lock(contractUpdateMutex);
+        contractUpdates[contractURI].full = true;
+    }
+    taskQueue.dispatchDebounced(contractURI.toString(), updateDebounce,
+                                [=]() { handleContractUpdate(contractURI); },
+                                updateMaxDebounce, TaskQueue::HIGH);
+}
+
+void IntFlowManager::contractDeltaUpdated(const URI& contractURI,
+                                          const ContractDelta& delta) {
+    if (stopping) return;
+    UriSet groups;
+    delta.getChangedGroups(groups);
+    if (!delta.rulesChanged() && groups.empty())
+        return;
+    {
+        const std::lock_guard<mutex> lock(contractUpdateMutex);
+        ContractUpdate& update = contractUpdates[contractURI];
+        if (delta.rulesChanged())
+            update.full = true;
+        else
+            update.groups.insert(groups.begin(), groups.end());
+    }
+    taskQueue.dispatchDebounced(contractURI.toString(), updateDebounce,
+                                [=]() { handleContractUpdate(contractURI); },
+                                updateMaxDebounce, TaskQueue::HIGH);
 }
 
 void IntFlowManager::configUpdated(const URI& configURI) {
@@ -535,6 +713,7 @@ void IntFlowManager::configUpdated(const URI& configURI) {
     optional<shared_ptr<modelgbp::platform::Config>> config_opt =
         modelgbp::platform::Config::resolve(agent.getFramework(), configURI);
     if (config_opt) {
+        agent.getStartupTimeline().mark("platform-config-resolved");
         optional<const uint8_t> configEncapType =
             config_opt.get()->getEncapType();
         if (configEncapType && configEncapType.get() != encapType) {
@@ -567,7 +746,18 @@ void IntFlowManager::portStatusUpdate(const string& portName,
 }
 
 void IntFlowManager::snatUpdated(const string& uuid) {
+    snatChanged(uuid, true);
+}
+
+void IntFlowManager::snatChanged(const string& uuid,
+                                 bool endpointsAffected) {
     if (stopping) return;
+    {
+        const std::lock_guard<mutex> lock(snatUpdateMutex);
+        auto r = snatUpdates.emplace(uuid, endpointsAffected);
+        if (!r.second && endpointsAffected)
+            r.first->second = true;
+    }
     taskQueue.dispatch(uuid, [=]() { handleSnatUpdate(uuid); });
 }
 
@@ -1133,12 +1323,8 @@ static void flowsEndpointPortSec(FlowEntryList& elPortSec,
         }
     }
 
-    for (const Endpoint::virt_ip_t& vip : endPoint.getVirtualIPs()) {
-        network::cidr_t vip_cidr;
-        if (!network::cidr_from_string(vip.second, vip_cidr)) {
-            LOG(WARNING) << "Invalid endpoint VIP (CIDR): " << vip.second;
-            continue;
-        }
+    for (const Endpoint::virt_cidr_t& vip : endPoint.getVirtualIPCidrs()) {
+        const network::cidr_t& vip_cidr = vip.second;
         uint8_t vmac[6];
         vip.first.toUIntArray(vmac);
 
@@ -1213,30 +1399,32 @@ static void flowsEndpointDHCPSource(IntFlowManager& flowMgr,
         return;
 
     if (virtualDHCPEnabled && hasMac) {
-        optional<Endpoint::DHCPv4Config> v4c = endPoint.getDHCPv4Config();
-        optional<Endpoint::DHCPv6Config> v6c = endPoint.getDHCPv6Config();
+        const shared_ptr<const Endpoint::DHCPv4Config>& v4c =
+            endPoint.getDHCPv4Config();
+        const shared_ptr<const Endpoint::DHCPv6Config>& v6c =
+            endPoint.getDHCPv6Config();
 
         if (v4c) {
             flowsVirtualDhcp(elPortSec, ofPort, macAddr, true);
 
             if (hasForwardingInfo) {
                 address_v4 serverIp(packets::LINK_LOCAL_DHCP);
-                if (v4c.get().getServerIp()) {
+                if (v4c->getServerIp()) {
                     boost::system::error_code ec;
                     address_v4 sip =
-                        address_v4::from_string(v4c.get().getServerIp().get(),
+                        address_v4::from_string(v4c->getServerIp().get(),
                                                 ec);
                     if (ec) {
                         LOG(WARNING) << "Invalid DHCP server IP: "
-                                     << v4c.get().getServerIp().get();
+                                     << v4c->getServerIp().get();
                     } else  {
                         serverIp = sip;
                     }
                 }
 
                 uint8_t serverMac[6];
-                if (v4c.get().getServerMac()) {
-                    v4c.get().getServerMac()->toUIntArray(serverMac);
+                if (v4c->getServerMac()) {
+                    v4c->getServerMac()->toUIntArray(serverMac);
                 } else {
                     memcpy(serverMac, flowMgr.getDHCPMacAddr(),
                            sizeof(serverMac));
@@ -1272,14 +1460,10 @@ static void flowsEndpointDHCPSource(IntFlowManager& flowMgr,
             }
         }
 
-        for (const Endpoint::virt_ip_t& vip :
-                 endPoint.getVirtualIPs()) {
+        for (const Endpoint::virt_cidr_t& vip :
+                 endPoint.getVirtualIPCidrs()) {
             if (endPoint.getMAC().get() == vip.first) continue;
-            network::cidr_t vip_cidr;
-            if (!network::cidr_from_string(vip.second, vip_cidr)) {
-                continue;
-            }
-            address& addr = vip_cidr.first;
+            const address& addr = vip.second.first;
             uint8_t vmacAddr[6];
             vip.first.toUIntArray(vmacAddr);
 
@@ -1326,13 +1510,7 @@ static void flowsEndpointSource(FlowEntryList& elSrc,
         actionSource(l2Classify, epgVnid, bdId, fgrpId, rdId)
             .build(elSrc);
 
-        for (const string& ipStr : endPoint.getIPs()) {
-            network::cidr_t cidr;
-            if (!network::cidr_from_string(ipStr, cidr, false)) {
-                LOG(WARNING) << "Invalid endpoint IP: "
-                             << ipStr;
-                continue;
-            }
+        for (const network::cidr_t& cidr : endPoint.getIPCidrs()) {
             actionSource(FlowBuilder().priority(140)
                          .ipSrc(cidr.first, cidr.second)
                          .inPort(ofPort).ethSrc(macAddr),
@@ -1503,8 +1681,9 @@ void IntFlowManager::handleRemoteEndpointUpdate(const string& uuid) {
         string ipStr = ep.get()->getNextHopTunnel().get();
         tunDst = address::from_string(ipStr, ec);
         if (ec || !tunDst->is_v4()) {
-            LOG(WARNING) << "Invalid remote tunnel destination IP: "
-                         << ipStr << ": " << ec.message();
+            LOG_RATE_LIMITED_DEFAULT(WARNING)
+                << "Invalid remote tunnel destination IP: "
+                << ipStr << ": " << ec.message();
         } else {
             tunDsts.push_back(tunDst.get());
             hasTunDest = true;
@@ -1520,8 +1699,9 @@ void IntFlowManager::handleRemoteEndpointUpdate(const string& uuid) {
                 string ipStr = tnl->getIp().get();
                 tunDst = address::from_string(ipStr, ec);
                 if (ec || !tunDst->is_v4()) {
-                    LOG(WARNING) << "Invalid remote tunnel destination IP: "
-                                 << ipStr << ": " << ec.message();
+                    LOG_RATE_LIMITED_DEFAULT(WARNING)
+                        << "Invalid remote tunnel destination IP: "
+                        << ipStr << ": " << ec.message();
                 } else {
                    tunDsts.push_back(tunDst.get());
                 }
@@ -1596,8 +1776,9 @@ void IntFlowManager::handleRemoteEndpointUpdate(const string& uuid) {
 
             address addr = address::from_string(invIp->getIp().get(), ec);
             if (ec) {
-                LOG(WARNING) << "Invalid remote endpoint IP: "
-                             << invIp->getIp().get() << ": " << ec.message();
+                LOG_RATE_LIMITED_DEFAULT(WARNING)
+                    << "Invalid remote endpoint IP: "
+                    << invIp->getIp().get() << ": " << ec.message();
                 continue;
             }
 
@@ -1859,14 +2040,7 @@ static void flowsEndpointSNAT(SnatManager& snatMgr,
     address nwDst;
     uint8_t prefixlen = 0;
 
-    for (const string& ipStr : endPoint.getIPs()) {
-        network::cidr_t cidr;
-        if (!network::cidr_from_string(ipStr, cidr, false)) {
-            LOG(WARNING) << "Invalid endpoint IP: "
-                         << ipStr << ": " << ec.message();
-            continue;
-        }
-
+    for (const network::cidr_t& cidr : endPoint.getIPCidrs()) {
         // Program route table flow to forward to snat table
         for (auto it = as.getDest().begin(); it != as.getDest().end(); ++it) {
             if (count >= 32) {
@@ -1942,7 +2116,10 @@ void IntFlowManager::handleEndpointUpdate(const string& uuid) {
         switchManager.clearFlows(uuid, SNAT_TABLE_ID);
         switchManager.clearFlows(uuid, SNAT_REV_TABLE_ID);
         switchManager.clearFlows(uuid, SERVICE_DST_TABLE_ID);
+        switchManager.clearFlows(uuid, ENDPOINT_DST_TABLE_ID);
         switchManager.clearFlows(uuid, OUT_TABLE_ID);
+        getEndpointDestId(uuid, "route", 0);
+        getEndpointDestId(uuid, "service", 0);
         removeEndpointFromFloodGroup(uuid);
         agent.getSnatManager().delEndpoint(uuid);
         updateSvcStatsFlows(uuid, false, false);
@@ -1958,19 +2135,13 @@ void IntFlowManager::handleEndpointUpdate(const string& uuid) {
     boost::system::error_code ec;
 
     vector<address> ipAddresses;
-    for (const string& ipStr : endPoint.getIPs()) {
-        network::cidr_t cidr;
-        if (!network::cidr_from_string(ipStr, cidr, false)) {
-            LOG(WARNING) << "Invalid endpoint IP: "
-                         << ipStr << ": " << ec.message();
-        } else {
-            ipAddresses.push_back(cidr.first);
-        }
+    for (const network::cidr_t& cidr : endPoint.getIPCidrs()) {
+        ipAddresses.push_back(cidr.first);
     }
     if (hasMac) {
         address_v6 linkLocalIp(network::construct_link_local_ip_addr(macAddr));
-        if (endPoint.getIPs().find(linkLocalIp.to_string()) ==
-            endPoint.getIPs().end())
+        if (std::find(ipAddresses.begin(), ipAddresses.end(),
+                      address(linkLocalIp)) == ipAddresses.end())
             ipAddresses.push_back(linkLocalIp);
     }
 
@@ -1987,6 +2158,7 @@ void IntFlowManager::handleEndpointUpdate(const string& uuid) {
     FlowEntryList elSnat;
     FlowEntryList elRevSnat;
     FlowEntryList elServiceMap;
+    FlowEntryList elEndpointDst;
     FlowEntryList elOutput;
 
     optional<URI> epgURI = epMgr.getComputedEPG(uuid);
@@ -2044,16 +2216,8 @@ void IntFlowManager::handleEndpointUpdate(const string& uuid) {
     /* Add ARP responder for veth_host */
     if (uuid.find("veth_host_ac") != string::npos) {
         hostAcc = true;
-        for (const string& ipStr : endPoint.getIPs()) {
-            network::cidr_t cidr;
-            if (!network::cidr_from_string(ipStr, cidr, false)) {
-                LOG(WARNING) << "Invalid endpoint IP: "
-                             << ipStr << ": " << ec.message();
-                continue;
-            } else {
-                LOG(DEBUG) << "Found endpoint IP: "
-                           << ipStr;
-            }
+        for (const network::cidr_t& cidr : endPoint.getIPCidrs()) {
+            LOG(DEBUG) << "Found endpoint IP: " << cidr.first;
             FlowBuilder proxyArp;
             proxyArp.priority(41).inPort(ofPort)
                 .ethSrc(macAddr).arpSrc(cidr.first)
@@ -2130,6 +2294,7 @@ void IntFlowManager::handleEndpointUpdate(const string& uuid) {
 
             if (virtualRouterEnabled && hasMac &&
                 routingMode == RoutingModeEnumT::CONST_ENABLED) {
+                vector<address> routeIps;
                 for (const address& ipAddr : ipAddresses) {
                     if (endPoint.isDiscoveryProxyMode()) {
                         // Auto-reply to ARP and NDP requests for endpoint
@@ -2165,36 +2330,47 @@ void IntFlowManager::handleEndpointUpdate(const string& uuid) {
                         }
                     }
 
-                    if (network::is_link_local(ipAddr))
-                        continue;
-
-                    {
-                        FlowBuilder e0;
-                        matchDestDom(e0, 0, rdId);
-                        e0.priority(500)
-                            .ethDst(getRouterMacAddr())
-                            .ipDst(ipAddr)
-                            .action()
-                            .reg(MFF_REG2, epgVnid)
-                            .reg(MFF_REG7, ofPort)
-                            .ethSrc(getRouterMacAddr())
-                            .ethDst(macAddr)
-                            .decTtl()
-                            .metadata(flow::meta::ROUTED, flow::meta::ROUTED)
-                            .go(POL_TABLE_ID)
-                            .parent().build(elRouteDst);
-                    }
+                    if (!network::is_link_local(ipAddr))
+                        routeIps.push_back(ipAddr);
+                }
 
+                uint32_t routeId =
+                    getEndpointDestId(uuid, "route", routeIps.size());
+                auto routeActions = [&](ActionBuilder& ab) {
+                    ab.reg(MFF_REG2, epgVnid)
+                        .reg(MFF_REG7, ofPort)
+                        .ethSrc(getRouterMacAddr())
+                        .ethDst(macAddr)
+                        .decTtl()
+                        .metadata(flow::meta::ROUTED, flow::meta::ROUTED)
+                        .go(POL_TABLE_ID);
+                };
+                for (const address& ipAddr : routeIps) {
+                    FlowBuilder e0;
+                    matchDestDom(e0, 0, rdId);
+                    e0.priority(500)
+                        .ethDst(getRouterMacAddr())
+                        .ipDst(ipAddr);
+                    if (routeId)
+                        e0.action()
+                            .reg(MFF_REG1, routeId)
+                            .go(ENDPOINT_DST_TABLE_ID);
+                    else
+                        routeActions(e0.action());
+                    e0.build(elRouteDst);
+                }
+                if (routeId) {
+                    FlowBuilder e1;
+                    e1.priority(10).reg(1, routeId);
+                    routeActions(e1.action());
+                    e1.build(elEndpointDst);
                 }
 
                 // virtual ip addresses in active-active AAP mode
                 if (endPoint.isAapModeAA()) {
-                    for (const Endpoint::virt_ip_t& vip : endPoint.getVirtualIPs()) {
-                        network::cidr_t vip_cidr;
-                        if (!network::cidr_from_string(vip.second, vip_cidr)) {
-                            LOG(WARNING) << "Invalid endpoint VIP (CIDR): " << vip.second;
-                            continue;
-                        }
+                    for (const Endpoint::virt_cidr_t& vip :
+                             endPoint.getVirtualIPCidrs()) {
+                        const network::cidr_t& vip_cidr = vip.second;
                         uint8_t vmac[6];
                         vip.first.toUIntArray(vmac);
 
@@ -2295,20 +2471,18 @@ void IntFlowManager::handleEndpointUpdate(const string& uuid) {
             // is reachable only for traffic originating from service
             // interfaces.
             if (hasMac) {
-                vector<address> anycastReturnIps;
-                for (const string& ipStr : endPoint.getAnycastReturnIPs()) {
-                    address addr = address::from_string(ipStr, ec);
-                    if (ec) {
-                        LOG(WARNING) << "Invalid anycast return IP: "
-                                     << ipStr << ": " << ec.message();
-                    } else {
-                        anycastReturnIps.push_back(addr);
-                    }
-                }
-                if (anycastReturnIps.empty()) {
-                    anycastReturnIps = ipAddresses;
-                }
-
+                const vector<address>& anycastReturnIps =
+                    endPoint.getAnycastReturnAddresses().empty()
+                    ? ipAddresses : endPoint.getAnycastReturnAddresses();
+
+                uint32_t serviceId =
+                    getEndpointDestId(uuid, "service",
+                                      anycastReturnIps.size());
+                auto serviceActions = [&](ActionBuilder& ab) {
+                    ab.ethSrc(getRouterMacAddr()).ethDst(macAddr)
+                        .decTtl()
+                        .output(ofPort);
+                };
                 for (const address& ipAddr : anycastReturnIps) {
                     {
                         // Deliver packets sent to service address
@@ -2316,16 +2490,24 @@ void IntFlowManager::handleEndpointUpdate(const string& uuid) {
                         matchDestDom(serviceDest, 0, rdId);
                         serviceDest
                             .priority(50)
-                            .ipDst(ipAddr)
-                            .action()
-                            .ethSrc(getRouterMacAddr()).ethDst(macAddr)
-                            .decTtl()
-                            .output(ofPort)
-                            .parent().build(elServiceMap);
+                            .ipDst(ipAddr);
+                        if (serviceId)
+                            serviceDest.action()
+                                .reg(MFF_REG1, serviceId)
+                                .go(ENDPOINT_DST_TABLE_ID);
+                        else
+                            serviceActions(serviceDest.action());
+                        serviceDest.build(elServiceMap);
                     }
                     flowsProxyDiscovery(*this, elServiceMap,
                                         51, ipAddr, macAddr, 0, rdId, 0);
                 }
+                if (serviceId) {
+                    FlowBuilder serviceActs;
+                    serviceActs.priority(10).reg(1, serviceId);
+                    serviceActions(serviceActs.action());
+                    serviceActs.build(elEndpointDst);
+                }
             }
         }
 
@@ -2357,6 +2539,7 @@ void IntFlowManager::handleEndpointUpdate(const string& uuid) {
     switchManager.writeFlow(uuid, SNAT_TABLE_ID, elSnat);
     switchManager.writeFlow(uuid, SNAT_REV_TABLE_ID, elRevSnat);
     switchManager.writeFlow(uuid, SERVICE_DST_TABLE_ID, elServiceMap);
+    switchManager.writeFlow(uuid, ENDPOINT_DST_TABLE_ID, elEndpointDst);
     switchManager.writeFlow(uuid, OUT_TABLE_ID, elOutput);
 
     if (fgrpURI && ofPort != OFPP_NONE) {
@@ -2436,8 +2619,9 @@ updateSvcStatsCounters (const uint64_t &cookie,
     optional<string> str =
         idGen.getStringForId(ID_NMSPC_SVCSTATS, cookie);
     if (str == boost::none) {
-        LOG(ERROR) << "Cookie: " << cookie
-                   << " to svc metric translation does not exist";
+        LOG_RATE_LIMITED_DEFAULT(ERROR)
+            << "Cookie: " << cookie
+            << " to svc metric translation does not exist";
         return;
     }
 
@@ -3375,13 +3559,10 @@ void IntFlowManager::updateSvcNodeStatsFlows (const string &uuid,
             if (!epWrapper)
                 break;
             const Endpoint& endPoint = *epWrapper.get();
-            for (const string& epipStr : endPoint.getIPs()) {
-                network::cidr_t cidr;
-                if (!network::cidr_from_string(epipStr, cidr, true)) {
-                    LOG(WARNING) << "Invalid endpoint IP: "
-                                 << epipStr << ": " << ec.message();
-                    continue;
-                }
+            for (const network::cidr_t& epCidr : endPoint.getIPCidrs()) {
+                const network::cidr_t
+                    cidr(network::mask_address(epCidr.first, epCidr.second),
+                         epCidr.second);
 
                 // ensure flows are either v4 or v6 - no mix-n-match
                 if (nhAddr.is_v4() != cidr.first.is_v4()) {
@@ -3601,9 +3782,13 @@ void IntFlowManager::updateSvcTgtStatsFlows (const string &uuid,
     // after an update of svc or ep/nh
     unordered_set<string> nhips;
 
+    // whether to install the stats flows or only to allocate the
+    // cookies for the load balancing flows of the service
+    bool detailed = true;
+
     // Expr to add stats flow between "any to svc" and "svc to any"
     auto svcTgtFlowAddExpr =
-        [this, &uuid_felist_map, &nhips](const string &flow_uuid,
+        [this, &uuid_felist_map, &nhips, &detailed](const string &flow_uuid,
                                          const string &svc_uuid,
                                          const string &nhipStr,
                                          const Service::ServiceMapping &sm,
@@ -3667,6 +3852,14 @@ void IntFlowManager::updateSvcTgtStatsFlows (const string &uuid,
         updateSvcTgtStatsCounters(cookieIdIg, true, ingStr, 0, 0, svcAttr, epAttr);
         updateSvcTgtStatsCounters(cookieIdEg, false, egrStr, 0, 0, svcAttr, epAttr);
 
+        if (!detailed) {
+            // the cookies are carried by the service next hop and
+            // reverse flows; an empty flow list clears the stats
+            // flows of a service that was detailed before
+            uuid_felist_map[flow_uuid];
+            return;
+        }
+
         FlowBuilder anyToSvc; // to service stats
         FlowBuilder svcToAny; // from service stats
 
@@ -3722,6 +3915,7 @@ void IntFlowManager::updateSvcTgtStatsFlows (const string &uuid,
         const Service& as = *asWrapper;
         LOG(TRACE) << "####### *<-->svc-tgt Service ########";
         LOG(TRACE) << *asWrapper;
+        detailed = isSvcStatsDetailed(as);
 
         if ((as.getServiceMode() != Service::LOADBALANCER)
                                   || as.isExternal()) {
@@ -3789,6 +3983,13 @@ void IntFlowManager::updateSvcTgtStatsFlows (const string &uuid,
         switchManager.writeFlow(p.first, STATS_TABLE_ID, p.second);
 }
 
+bool IntFlowManager::isSvcStatsDetailed(const Service& as) {
+    if (!serviceStatsAggregated)
+        return true;
+    auto it = as.getAttributes().find(SERVICE_STATS_ATTR);
+    return it != as.getAttributes().end() && it->second == "detailed";
+}
+
 void IntFlowManager::updatePodSvcStatsFlows (const string &uuid,
                                              const bool &is_svc,
                                              const bool &is_add)
@@ -3977,8 +4178,9 @@ void IntFlowManager::updatePodSvcStatsFlows (const string &uuid,
                 LOG(TRACE) << *epWrapper;
 
                 if ((as.getServiceMode() != Service::LOADBALANCER)
-                                          || as.isExternal()) {
-                    LOG(TRACE) << "podsvc not handled for non-LB or ext services";
+                                          || as.isExternal()
+                                          || !isSvcStatsDetailed(as)) {
+                    LOG(TRACE) << "podsvc not handled for non-LB, ext or aggregated services";
                     // clear obs and prom metrics during update;
                     // below will be no-op during create
                     podSvcFlowRemExpr(epUuid+":"+uuid);
@@ -3991,10 +4193,7 @@ void IntFlowManager::updatePodSvcStatsFlows (const string &uuid,
                     continue;
                 }
 
-                for (const string& epipStr : endPoint.getIPs()) {
-                    network::cidr_t cidr;
-                    if (!network::cidr_from_string(epipStr, cidr, false))
-                        continue;
+                for (const network::cidr_t& cidr : endPoint.getIPCidrs()) {
                     // Dont create EPIP <--> SVCIP flows if EPIP is one of the
                     // next hops of this service.
                     const auto& nhips = sm.getNextHopIPs();
@@ -4055,11 +4254,7 @@ void IntFlowManager::updatePodSvcStatsFlows (const string &uuid,
         // flows will get created between this EP and Svc, and unwanted flows will get
         // cleaned up.
         unordered_set<string> epsvc_uuids;
-        for (const string& epipStr : endPoint.getIPs()) {
-             network::cidr_t cidr;
-             if (!network::cidr_from_string(epipStr, cidr, false))
-                 continue;
-
+        for (const network::cidr_t& cidr : endPoint.getIPCidrs()) {
             for (const string& svcUuid : svcUuids) {
                 shared_ptr<const Service> asWrapper
                      = svcMgr.getService(svcUuid);
@@ -4071,8 +4266,9 @@ void IntFlowManager::updatePodSvcStatsFlows (const string &uuid,
 
                 const Service& as = *asWrapper.get();
                 if ((as.getServiceMode() != Service::LOADBALANCER)
-                        || as.isExternal()) {
-                    LOG(TRACE) << "podsvc not handled for non-LB or ext services";
+                        || as.isExternal()
+                        || !isSvcStatsDetailed(as)) {
+                    LOG(TRACE) << "podsvc not handled for non-LB, ext or aggregated services";
                     // clear obs and prom metrics during update;
                     // below will be no-op during create
                     podSvcFlowRemExpr(uuid+":"+svcUuid);
@@ -4105,6 +4301,76 @@ void IntFlowManager::updatePodSvcStatsFlows (const string &uuid,
         switchManager.writeFlow(p.first, STATS_TABLE_ID, p.second);
 }
 
+// the select group of a service mapping is keyed by the service and
+// the address, protocol and port of the mapping
+static string serviceGroupKey(const string& uuid,
+                              const Service::ServiceMapping& sm) {
+    ostringstream key;
+    key << uuid << ":" << sm.getServiceIP().get() << ":"
+        << sm.getServiceProto().get_value_or("") << ":"
+        << sm.getServicePort().get_value_or(0);
+    return key.str();
+}
+
+bool IntFlowManager::useServiceGroup(const Service::ServiceMapping& sm) const {
+    // client affinity hashes the source address with multipath
+    return serviceSelectGroups && !sm.getClientAffinity();
+}
+
+uint32_t IntFlowManager::getServiceNextHopLink(const string& groupKey,
+                                               const string& nextHopIp) {
+    return idGen.getId(ID_NMSPC_SVCNEXTHOP, groupKey + ":" + nextHopIp);
+}
+
+uint32_t IntFlowManager::getServiceGroupId(const string& groupKey) {
+    // bit 31 keeps the IDs apart from those of the flood groups
+    return idGen.getId(ID_NMSPC_SVCGROUP, groupKey) | (1u << 31);
+}
+
+void IntFlowManager::updateServiceGroups(const string& uuid,
+                                         SvcGroupMap& groups) {
+    auto it = serviceGroupMap.find(uuid);
+    if (it != serviceGroupMap.end()) {
+        for (const SvcGroupMap::value_type& kv : it->second) {
+            auto nit = groups.find(kv.first);
+            if (nit == groups.end()) {
+                SvcBucketMap none;
+                switchManager.writeGroupMod(
+                    createServiceGroupMod(OFPGC11_DELETE,
+                                          getServiceGroupId(kv.first),
+                                          none));
+                idGen.erase(ID_NMSPC_SVCGROUP, kv.first);
+            }
+            // release the links of the next hops that were removed
+            for (const SvcBucketMap::value_type& b : kv.second) {
+                if (nit == groups.end() ||
+                    nit->second.find(b.first) == nit->second.end())
+                    idGen.erase(ID_NMSPC_SVCNEXTHOP, kv.first + ":" + b.first);
+            }
+        }
+    }
+
+    for (const SvcGroupMap::value_type& kv : groups) {
+        uint16_t type = OFPGC11_ADD;
+        if (it != serviceGroupMap.end()) {
+            auto oit = it->second.find(kv.first);
+            if (oit != it->second.end()) {
+                if (oit->second == kv.second)
+                    continue;
+                type = OFPGC11_MODIFY;
+            }
+        }
+        switchManager.writeGroupMod(
+            createServiceGroupMod(type, getServiceGroupId(kv.first),
+                                  kv.second));
+    }
+
+    if (groups.empty())
+        serviceGroupMap.erase(uuid);
+    else
+        serviceGroupMap[uuid].swap(groups);
+}
+
 void IntFlowManager::updateServiceSnatDnatFlows(const string& uuid,
                                                 FlowEntryList& serviceNextHopFlows,
                                                 FlowEntryList& serviceRevFlows,
@@ -4176,7 +4442,12 @@ void IntFlowManager::updateServiceSnatDnatFlows(const string& uuid,
                     proto = 6;
             }
 
-            uint16_t link = 0;
+            // the link of a next hop is its position, which multipath
+            // selects, or a stable ID when a select group selects it
+            bool useGroup = useServiceGroup(sm);
+            const string groupKey =
+                useGroup ? serviceGroupKey(uuid, sm) : string();
+            uint32_t pos = 0;
             for (const string& ipstr : sm.getNextHopIPs()) {
                 auto nextHopAddr = address::from_string(ipstr, ec);
                 if (ec) {
@@ -4184,6 +4455,8 @@ void IntFlowManager::updateServiceSnatDnatFlows(const string& uuid,
                                  << ipstr << ": " << ec.message();
                     continue;
                 }
+                uint32_t link = useGroup
+                    ? getServiceNextHopLink(groupKey, ipstr) : pos;
                 {
                     FlowBuilder ipMap;
                     matchDestDom(ipMap, 0, rdId);
@@ -4193,7 +4466,7 @@ void IntFlowManager::updateServiceSnatDnatFlows(const string& uuid,
                     // use the first address as a "default" so that
                     // there is no transient case where there is no
                     // match while flows are updated.
-                    if (link == 0) {
+                    if (pos == 0) {
                         ipMap.priority(99);
                     } else {
                         ipMap.priority(100)
@@ -4203,7 +4476,7 @@ void IntFlowManager::updateServiceSnatDnatFlows(const string& uuid,
                     // loopback has highest priority
                     if (loopback) {
                         if (!agent.getEndpointManager().getEpFromLocalMap(ipstr)) {
-                            link++;
+                            pos++;
                             continue;
                         }
                         ipMap.priority(102)
@@ -4358,7 +4631,7 @@ void IntFlowManager::updateServiceSnatDnatFlows(const string& uuid,
                     }
                 }
 
-                link += 1;
+                pos += 1;
             }
         }
     }
@@ -4379,10 +4652,15 @@ void IntFlowManager::programServiceSnatDnatFlows(const string& uuid) {
 void IntFlowManager::handleServiceUpdate(const string& uuid) {
     LOG(DEBUG) << "Updating service " << uuid;
 
+    // the select groups and the flows that use them go to the switch
+    // together
+    SwitchManager::Batch batch(switchManager);
     ServiceManager& srvMgr = agent.getServiceManager();
     shared_ptr<const Service> asWrapper = srvMgr.getService(uuid);
+    SvcGroupMap serviceGroups;
 
     if (!asWrapper || !asWrapper->getDomainURI()) {
+        updateServiceGroups(uuid, serviceGroups);
         switchManager.clearFlows(uuid, SEC_TABLE_ID);
         switchManager.clearFlows(uuid, BRIDGE_TABLE_ID);
         switchManager.clearFlows(uuid, SERVICE_REV_TABLE_ID);
@@ -4460,6 +4738,22 @@ void IntFlowManager::handleServiceUpdate(const string& uuid) {
                 }
             }
 
+            uint32_t groupId = 0;
+            if (useServiceGroup(sm) && !nextHopAddrs.empty()) {
+                const string groupKey = serviceGroupKey(uuid, sm);
+                SvcBucketMap& buckets = serviceGroups[groupKey];
+                for (const string& ipstr : sm.getNextHopIPs()) {
+                    address::from_string(ipstr, ec);
+                    if (ec) continue;
+                    auto w = sm.getNextHopWeights().find(ipstr);
+                    buckets[ipstr] =
+                        std::make_pair(getServiceNextHopLink(groupKey, ipstr),
+                                       w != sm.getNextHopWeights().end()
+                                       ? w->second : 1);
+                }
+                groupId = getServiceGroupId(groupKey);
+            }
+
             uint8_t proto = 0;
             if (sm.getServiceProto()) {
                 const string& protoStr = sm.getServiceProto().get();
@@ -4503,13 +4797,20 @@ void IntFlowManager::handleServiceUpdate(const string& uuid) {
                     } else {
                         serviceDest.action().ethDst(getRouterMacAddr());
                     }
-                    serviceDest.action()
-                        .multipath(hash_fields,
-                                   1024,
-                                   ActionBuilder::NX_MP_ALG_ITER_HASH,
-                                   static_cast<uint16_t>(nextHopAddrs.size()-1),
-                                   32, MFF_REG7)
-                        .go(SERVICE_NEXTHOP_TABLE_ID);
+                    if (groupId != 0) {
+                        // the select group sets the link of a next
+                        // hop and resubmits to the next hop table
+                        serviceDest.action().group(groupId);
+                    } else {
+                        serviceDest.action()
+                            .multipath(hash_fields,
+                                       1024,
+                                       ActionBuilder::NX_MP_ALG_ITER_HASH,
+                                       static_cast<uint16_t>(
+                                           nextHopAddrs.size()-1),
+                                       32, MFF_REG7)
+                            .go(SERVICE_NEXTHOP_TABLE_ID);
+                    }
                 } else if (as.getServiceMode() == Service::LOCAL_ANYCAST &&
                            ofPort != OFPP_NONE) {
                     serviceDest.action()
@@ -4673,6 +4974,7 @@ void IntFlowManager::handleServiceUpdate(const string& uuid) {
         }
     }
 
+    updateServiceGroups(uuid, serviceGroups);
     programServiceSnatDnatFlows(uuid);
     switchManager.writeFlow(uuid, SEC_TABLE_ID, secFlows);
     switchManager.writeFlow(uuid, BRIDGE_TABLE_ID, bridgeFlows);
@@ -4783,15 +5085,26 @@ handleLearningBridgeVlanUpdate(LearningBridgeIface::vlan_range_t vlan) {
 }
 
 void IntFlowManager::handleSnatUpdate(const string& snatUuid) {
-    LOG(DEBUG) << "Updating snat " << snatUuid;
+    bool endpointsAffected;
+    {
+        const std::lock_guard<mutex> lock(snatUpdateMutex);
+        auto it = snatUpdates.find(snatUuid);
+        if (it == snatUpdates.end())
+            return;             // handled by an earlier run
+        endpointsAffected = it->second;
+        snatUpdates.erase(it);
+    }
+    LOG(DEBUG) << "Updating snat " << snatUuid
+               << (endpointsAffected ? "" : ", port ranges only");
 
     SnatManager& snatMgr = agent.getSnatManager();
-    unordered_set<string> uuids;
-
-    snatMgr.getEndpoints(snatUuid, uuids);
-    for (const string& uuid : uuids) {
-         LOG(DEBUG) << "Updating endpoint " << uuid;
-         endpointUpdated(uuid);
+    if (endpointsAffected) {
+        unordered_set<string> uuids;
+        snatMgr.getEndpoints(snatUuid, uuids);
+        for (const string& uuid : uuids) {
+            LOG(DEBUG) << "Updating endpoint " << uuid;
+            endpointUpdated(uuid);
+        }
     }
 
     shared_ptr<const Snat> asWrapper = snatMgr.getSnat(snatUuid);
@@ -5152,18 +5465,7 @@ void IntFlowManager::createStaticFlows() {
                 .action().go(IntFlowManager::SEC_TABLE_ID)
                 .parent().build(dropLogFlows);
         switchManager.writeFlow("DropLogStatic", DROP_LOG_TABLE_ID, dropLogFlows);
-        /* Insert a flow at the end of every table to match dropped packets
-         * and go to the drop table where it will be punted to a port when configured
-         */
-        for(unsigned table_id = SEC_TABLE_ID; table_id < EXP_DROP_TABLE_ID; table_id++) {
-            FlowEntryList dropLogFlow;
-            FlowBuilder().priority(0).cookie(flow::cookie::TABLE_DROP_FLOW)
-                    .flags(OFPUTIL_FF_SEND_FLOW_REM)
-                    .action().dropLog(table_id)
-                    .go(EXP_DROP_TABLE_ID)
-                    .parent().build(dropLogFlow);
-            switchManager.writeFlow("DropLogStatic", table_id, dropLogFlow);
-        }
+        updateTableDropFlows();
         handleDropLogPortUpdate();
     }
 
@@ -5172,6 +5474,8 @@ void IntFlowManager::createStaticFlows() {
 void IntFlowManager::handleEndpointGroupDomainUpdate(const URI& epgURI) {
     LOG(DEBUG) << "Updating endpoint-group " << epgURI;
 
+    // the flows and flood group of the group go to the switch together
+    SwitchManager::Batch batch(switchManager);
     const string& epgId = epgURI.toString();
 
     uint32_t tunPort = getTunnelPort();
@@ -5184,6 +5488,7 @@ void IntFlowManager::handleEndpointGroupDomainUpdate(const URI& epgURI) {
         switchManager.clearFlows(epgId, OUT_TABLE_ID);
         switchManager.clearFlows(epgId, BRIDGE_TABLE_ID);
         updateMulticastList(boost::none, epgURI);
+        groupEndpointDeps.erase(epgURI);
         return;
     }
 
@@ -5191,6 +5496,7 @@ void IntFlowManager::handleEndpointGroupDomainUpdate(const URI& epgURI) {
     optional<URI> fgrpURI, bdURI, rdURI;
     if (!getGroupForwardingInfo(epgURI, epgVnid, rdURI, rdId,
                                 bdURI, bdId, fgrpURI, fgrpId)) {
+        groupEndpointDeps.erase(epgURI);
         return;
     }
 
@@ -5345,11 +5651,39 @@ void IntFlowManager::handleEndpointGroupDomainUpdate(const URI& epgURI) {
         rdConfigUpdated(rdURI);
     }
 
-    // note this combines with the IPM group endpoints from above:
-    epMgr.getEndpointsForGroup(epgURI, epUuids);
-    for (const string& uuid : epUuids) {
-        advertManager.scheduleEndpointAdv(uuid);
-        endpointUpdated(uuid);
+    // Only recompute the endpoints when an attribute their flows
+    // use changed, and then all of them in one batch
+    GroupEndpointDeps deps;
+    deps.vnid = epgVnid;
+    deps.rdId = rdId;
+    deps.bdId = bdId;
+    deps.fgrpId = fgrpId;
+    deps.tunPort = tunPort;
+    deps.routingMode = polMgr.getEffectiveRoutingMode(epgURI);
+    deps.arpMode = AddressResModeEnumT::CONST_UNICAST;
+    deps.ndMode = AddressResModeEnumT::CONST_UNICAST;
+    deps.unkFloodMode = UnknownFloodModeEnumT::CONST_DROP;
+    deps.bcastFloodMode = BcastFloodModeEnumT::CONST_NORMAL;
+    optional<shared_ptr<FloodDomain> > fd = polMgr.getFDForGroup(epgURI);
+    if (fd) {
+        deps.arpMode = fd.get()
+            ->getArpMode(AddressResModeEnumT::CONST_UNICAST);
+        deps.ndMode = fd.get()
+            ->getNeighborDiscMode(AddressResModeEnumT::CONST_UNICAST);
+        deps.unkFloodMode = fd.get()
+            ->getUnknownFloodMode(UnknownFloodModeEnumT::CONST_DROP);
+        deps.bcastFloodMode = fd.get()
+            ->getBcastFloodMode(BcastFloodModeEnumT::CONST_NORMAL);
+    }
+    auto depsIt = groupEndpointDeps.find(epgURI);
+    if (depsIt == groupEndpointDeps.end() || !(depsIt->second == deps)) {
+        groupEndpointDeps[epgURI] = deps;
+
+        // note this combines with the IPM group endpoints from above:
+        epMgr.getEndpointsForGroup(epgURI, epUuids);
+        endpointsUpdated(epUuids);
+    } else {
+        LOG(DEBUG) << "Endpoint flows of " << epgURI << " are unchanged";
     }
 
     PolicyManager::uri_set_t contractURIs;
@@ -5605,26 +5939,23 @@ void IntFlowManager::handleRoutingDomainUpdate(const URI& rdURI) {
             }
         }
     }
+    network::prefix_actions_t intRoutes;
     for (const network::subnet_t& sn : intSubnets) {
         address addr = address::from_string(sn.first, ec);
         if (ec) continue;
-
-        FlowBuilder snr;
-        matchSubnet(snr, rdId, 300, addr, sn.second, false);
-        if (tunPort != OFPP_NONE && encapType != ENCAP_NONE) {
-            actionOutputToEPGTunnel(snr);
-        } else {
-            snr.cookie(flow::cookie::TABLE_DROP_FLOW)
-               .flags(OFPUTIL_FF_SEND_FLOW_REM)
-               .action().dropLog(ROUTE_TABLE_ID)
-               .go(EXP_DROP_TABLE_ID);
-        }
-        snr.build(rdRouteFlows);
+        intRoutes[network::cidr_t(addr, sn.second)] = 0;
     }
 
     // If we miss the local endpoints and the internal subnets, check
     // each of the external layer 3 networks.  Match using
-    // longest-prefix.
+    // longest-prefix.  Subnets of networks mapped to a NAT EPG take
+    // precedence over other external subnets, so they are kept
+    // apart, with the network VNID as their action.
+    enum { EXT_ROUTE, EXT_DROP };
+    network::prefix_actions_t extRoutes;
+    network::prefix_actions_t natRoutes;
+    network::prefix_actions_t natInRoutes;
+    unordered_map<uint32_t, uint32_t> natEpgVnids;
     vector<shared_ptr<L3ExternalDomain> > extDoms;
     rd.get()->resolveGbpL3ExternalDomain(extDoms);
     for (shared_ptr<L3ExternalDomain>& extDom : extDoms) {
@@ -5644,6 +5975,8 @@ void IntFlowManager::handleRoutingDomainUpdate(const URI& rdURI) {
                     natEpgVnid =
                         agent.getPolicyManager().getVnidForGroup(natEpg.get());
             }
+            if (natEpgVnid)
+                natEpgVnids[netVnid] = natEpgVnid.get();
 
             for (shared_ptr<ExternalSubnet>& extsub : extSubs) {
                 if (!extsub->isAddressSet() || !extsub->isPrefixLenSet())
@@ -5652,63 +5985,91 @@ void IntFlowManager::handleRoutingDomainUpdate(const URI& rdURI) {
                     address::from_string(extsub->getAddress().get(), ec);
                 if (ec) continue;
 
-                {
-                    FlowBuilder snr;
-                    matchSubnet(snr, rdId, 40, addr,
-                                extsub->getPrefixLen(0), false);
-
-                    if (natRef) {
-                        uint16_t natprio = addr.is_v4() ? 40 : 130;
-                        // For external networks mapped to a NAT EPG,
-                        // set the next hop action to NAT_OUT
-                        if (natEpgVnid) {
-                            snr.priority(40 + natprio + extsub->getPrefixLen(0))
-                                .action()
-                                .reg(MFF_REG2, netVnid)
-                                .reg(MFF_REG7, natEpgVnid.get())
-                                .metadata(flow::meta::out::NAT,
-                                          flow::meta::out::MASK)
-                                .go(POL_TABLE_ID);
-                        }
-                        // else drop until resolved
-                    } else if (tunPort != OFPP_NONE &&
-                               encapType != ENCAP_NONE) {
-                        // For other external networks, output to the tunnel
-                        actionOutputToEPGTunnel(snr);
-                    } else {
-                        snr.cookie(flow::cookie::TABLE_DROP_FLOW)
-                           .flags(OFPUTIL_FF_SEND_FLOW_REM)
-                           .action().dropLog(ROUTE_TABLE_ID)
-                           .go(EXP_DROP_TABLE_ID);
-                    }
-                    // else drop the packets
-                    snr.build(rdRouteFlows);
-                }
-                {
-                    FlowBuilder snn;
-                    matchSubnet(snn, rdId, 151, addr,
-                                extsub->getPrefixLen(0), true);
-                    snn.action()
-                        .reg(MFF_REG0, netVnid)
-                        // We want to ensure that on the final
-                        // delivery of the packet we perform
-                        // protocol-specific reverse mapping.  This
-                        // doesn't let us do hop-by-hop translations
-                        // however.
-                        //
-                        // Also remove policy applied since we're
-                        // changing the effective EPG and need to
-                        // apply policy again.
-                        .metadata(flow::meta::out::REV_NAT,
-                                  flow::meta::out::MASK |
-                                  flow::meta::POLICY_APPLIED)
-                        .go(POL_TABLE_ID)
-                        .parent().build(rdNatFlows);
-                }
+                network::cidr_t cidr(addr, extsub->getPrefixLen(0));
+                if (natRef && natEpgVnid)
+                    natRoutes[cidr] = netVnid;
+                else
+                    // drop until the NAT EPG is resolved
+                    extRoutes[cidr] = natRef ? EXT_DROP : EXT_ROUTE;
+                natInRoutes[cidr] = netVnid;
             }
         }
     }
 
+    if (routeAggregation) {
+        network::aggregate_prefixes(intRoutes);
+        network::aggregate_prefixes(extRoutes);
+        network::aggregate_prefixes(natRoutes);
+        network::aggregate_prefixes(natInRoutes);
+    }
+
+    for (const auto& route : intRoutes) {
+        address addr = route.first.first;
+        FlowBuilder snr;
+        matchSubnet(snr, rdId, 300, addr, route.first.second, false);
+        if (tunPort != OFPP_NONE && encapType != ENCAP_NONE) {
+            actionOutputToEPGTunnel(snr);
+        } else {
+            snr.cookie(flow::cookie::TABLE_DROP_FLOW)
+               .flags(OFPUTIL_FF_SEND_FLOW_REM)
+               .action().dropLog(ROUTE_TABLE_ID)
+               .go(EXP_DROP_TABLE_ID);
+        }
+        snr.build(rdRouteFlows);
+    }
+
+    for (const auto& route : extRoutes) {
+        address addr = route.first.first;
+        FlowBuilder snr;
+        matchSubnet(snr, rdId, 40, addr, route.first.second, false);
+        if (route.second == EXT_DROP) {
+            // no actions drops the packets
+        } else if (tunPort != OFPP_NONE && encapType != ENCAP_NONE) {
+            // For other external networks, output to the tunnel
+            actionOutputToEPGTunnel(snr);
+        } else {
+            snr.cookie(flow::cookie::TABLE_DROP_FLOW)
+               .flags(OFPUTIL_FF_SEND_FLOW_REM)
+               .action().dropLog(ROUTE_TABLE_ID)
+               .go(EXP_DROP_TABLE_ID);
+        }
+        snr.build(rdRouteFlows);
+    }
+
+    for (const auto& route : natRoutes) {
+        address addr = route.first.first;
+        uint16_t natprio = addr.is_v4() ? 40 : 130;
+        // For external networks mapped to a NAT EPG, set the next
+        // hop action to NAT_OUT
+        FlowBuilder snr;
+        matchSubnet(snr, rdId, 40 + natprio, addr, route.first.second, false);
+        snr.action()
+            .reg(MFF_REG2, route.second)
+            .reg(MFF_REG7, natEpgVnids[route.second])
+            .metadata(flow::meta::out::NAT, flow::meta::out::MASK)
+            .go(POL_TABLE_ID)
+            .parent().build(rdRouteFlows);
+    }
+
+    for (const auto& route : natInRoutes) {
+        address addr = route.first.first;
+        FlowBuilder snn;
+        matchSubnet(snn, rdId, 151, addr, route.first.second, true);
+        snn.action()
+            .reg(MFF_REG0, route.second)
+            // We want to ensure that on the final delivery of the
+            // packet we perform protocol-specific reverse mapping.
+            // This doesn't let us do hop-by-hop translations however.
+            //
+            // Also remove policy applied since we're changing the
+            // effective EPG and need to apply policy again.
+            .metadata(flow::meta::out::REV_NAT,
+                      flow::meta::out::MASK |
+                      flow::meta::POLICY_APPLIED)
+            .go(POL_TABLE_ID)
+            .parent().build(rdNatFlows);
+    }
+
     switchManager.writeFlow(rdURI.toString(), NAT_IN_TABLE_ID, rdNatFlows);
     switchManager.writeFlow(rdURI.toString(), ROUTE_TABLE_ID, rdRouteFlows);
 
@@ -5822,6 +6183,27 @@ IntFlowManager::createGroupMod(uint16_t type, uint32_t groupId,
     return entry;
 }
 
+GroupEdit::Entry
+IntFlowManager::createServiceGroupMod(uint16_t type, uint32_t groupId,
+                                      const SvcBucketMap& buckets) {
+    GroupEdit::Entry entry(new GroupEdit::GroupMod());
+    entry->mod->command = type;
+    entry->mod->type = OFPGT11_SELECT;
+    entry->mod->group_id = groupId;
+
+    for (const SvcBucketMap::value_type& kv : buckets) {
+        uint32_t link = kv.second.first;
+        ofputil_bucket *bkt = createBucket(link);
+        bkt->weight = kv.second.second;
+        ActionBuilder()
+            .reg(MFF_REG7, link)
+            .resubmit(OFPP_IN_PORT, SERVICE_NEXTHOP_TABLE_ID)
+            .build(bkt);
+        ovs_list_push_back(&entry->mod->buckets, &bkt->list_node);
+    }
+    return entry;
+}
+
 void
 IntFlowManager::
 updateEndpointFloodGroup(const URI& fgrpURI,
@@ -5901,25 +6283,37 @@ void IntFlowManager::removeEndpointFromFloodGroup(const string& epUUID) {
     }
 }
 
+void IntFlowManager::compileContractRules(
+    const PolicyManager::rule_list_t& rules,
+    /* out */ compiled_rule_list_t& compiled) {
+    compiled.resize(rules.size());
+    compiled_rule_list_t::iterator ci = compiled.begin();
+    for (const shared_ptr<PolicyRule>& pc : rules) {
+        const shared_ptr<L24Classifier>& cls = pc->getL24Classifier();
+        ci->direction = pc->getDirection();
+        ci->priority = pc->getPriority();
+        ci->allow = pc->getAllow();
+        ci->log = pc->getLog();
+        ci->cookie = getId(L24Classifier::CLASS_ID, cls->getURI());
+        flowutils::compile_classifier(*cls, ci->match);
+        ++ci;
+    }
+}
+
 void IntFlowManager::addContractRules(FlowEntryList& entryList,
                              const uint32_t pvnid,
                              const uint32_t cvnid,
                              bool allowBidirectional,
-                             const PolicyManager::rule_list_t& rules) {
-    for (const shared_ptr<PolicyRule>& pc : rules) {
-        uint8_t dir = pc->getDirection();
-        const shared_ptr<L24Classifier>& cls = pc->getL24Classifier();
-        const URI& ruleURI = cls->getURI();
-        uint64_t cookie = getId(L24Classifier::CLASS_ID, ruleURI);
+                             const compiled_rule_list_t& rules) {
+    for (const CompiledRule& pc : rules) {
+        uint8_t dir = pc.direction;
+        uint64_t cookie = pc.cookie;
         flowutils::ClassAction act = flowutils::CA_DENY;
-        bool log = false;
+        bool log = pc.log;
 
-        if (pc->getAllow())
+        if (pc.allow)
             act = flowutils::CA_ALLOW;
 
-        if (pc->getLog())
-            log = pc->getLog();
-
         if (dir == DirectionEnumT::CONST_BIDIRECTIONAL &&
             !allowBidirectional) {
             dir = DirectionEnumT::CONST_IN;
@@ -5928,26 +6322,26 @@ void IntFlowManager::addContractRules(FlowEntryList& entryList,
         if (dir == DirectionEnumT::CONST_IN ||
             dir == DirectionEnumT::CONST_BIDIRECTIONAL) {
             if (act == flowutils::CA_DENY) {
-                flowutils::add_classifier_entries(*cls, act, log,
+                flowutils::add_classifier_entries(pc.match, act, log,
                                                   boost::none,
                                                   boost::none,
                                                   boost::none,
                                                   IntFlowManager::EXP_DROP_TABLE_ID, IntFlowManager::POL_TABLE_ID,
                                                   IntFlowManager::EXP_DROP_TABLE_ID,
-                                                  pc->getPriority(),
+                                                  pc.priority,
                                                   OFPUTIL_FF_SEND_FLOW_REM,
                                                   cookie,
                                                   cvnid, pvnid,
                                                   false,
                                                   entryList);
             } else {
-                flowutils::add_classifier_entries(*cls, act, log,
+                flowutils::add_classifier_entries(pc.match, act, log,
                                                   boost::none,
                                                   boost::none,
                                                   boost::none,
                                                   IntFlowManager::STATS_TABLE_ID, IntFlowManager::POL_TABLE_ID,
                                                   IntFlowManager::EXP_DROP_TABLE_ID,
-                                                  pc->getPriority(),
+                                                  pc.priority,
                                                   OFPUTIL_FF_SEND_FLOW_REM,
                                                   cookie,
                                                   cvnid, pvnid,
@@ -5958,26 +6352,26 @@ void IntFlowManager::addContractRules(FlowEntryList& entryList,
         if (dir == DirectionEnumT::CONST_OUT ||
             dir == DirectionEnumT::CONST_BIDIRECTIONAL) {
              if (act == flowutils::CA_DENY) {
-                  flowutils::add_classifier_entries(*cls, act, log,
+                  flowutils::add_classifier_entries(pc.match, act, log,
                                                     boost::none,
                                                     boost::none,
                                                     boost::none,
                                                     IntFlowManager::EXP_DROP_TABLE_ID, IntFlowManager::POL_TABLE_ID,
                                                     IntFlowManager::EXP_DROP_TABLE_ID,
-                                                    pc->getPriority(),
+                                                    pc.priority,
                                                     OFPUTIL_FF_SEND_FLOW_REM,
                                                     cookie,
                                                     pvnid, cvnid,
                                                     false,
                                                     entryList);
               } else {
-                  flowutils::add_classifier_entries(*cls, act, log,
+                  flowutils::add_classifier_entries(pc.match, act, log,
                                                     boost::none,
                                                     boost::none,
                                                     boost::none,
                                                     IntFlowManager::STATS_TABLE_ID, IntFlowManager::POL_TABLE_ID,
                                                     IntFlowManager::EXP_DROP_TABLE_ID,
-                                                    pc->getPriority(),
+                                                    pc.priority,
                                                     OFPUTIL_FF_SEND_FLOW_REM,
                                                     cookie,
                                                     pvnid, cvnid,
@@ -5988,14 +6382,230 @@ void IntFlowManager::addContractRules(FlowEntryList& entryList,
     }
 }
 
+bool IntFlowManager::useConjunctions(const unordered_set<uint32_t>& provIds,
+                                     const unordered_set<uint32_t>& consIds) {
+    if (!conjunctiveContracts)
+        return false;
+    for (uint32_t vnid : provIds) {
+        if (consIds.find(vnid) != consIds.end())
+            return false;
+    }
+    /*
+     * Each rule needs a flow per pair of groups, against a flow per
+     * group and one for the conjunction.
+     */
+    size_t nprov = provIds.size();
+    size_t ncons = consIds.size();
+    return nprov * ncons > nprov + ncons + 1;
+}
+
+void IntFlowManager::updateContractConjunctions(
+    const URI& contractURI,
+    const unordered_set<uint32_t>& provIds,
+    const unordered_set<uint32_t>& consIds,
+    const compiled_rule_list_t& rules,
+    /* out */ vector<std::pair<string, FlowEntryList> >& objs) {
+    const string& contractId = contractURI.toString();
+    ContractConj newConj;
+    unordered_map<string, std::pair<FlowEntryPtr, ConjSet> > newClauses;
+
+    auto addClause = [&newClauses](const FlowEntryPtr& fe, uint32_t id,
+                                   uint8_t clause, uint8_t nClauses) {
+        ostringstream key;
+        key << "conj|" << fe->entry->priority << "|" << fe->entry->match;
+        std::pair<FlowEntryPtr, ConjSet>& c = newClauses[key.str()];
+        if (!c.first)
+            c.first = fe;
+        c.second.emplace(id, clause, nClauses);
+    };
+
+    for (const CompiledRule& pc : rules) {
+        flowutils::ClassAction act =
+            pc.allow ? flowutils::CA_ALLOW : flowutils::CA_DENY;
+        uint8_t nextTable = pc.allow ? STATS_TABLE_ID : EXP_DROP_TABLE_ID;
+
+        auto addClsFlows = [&](const flowutils::ClassifierMatch& match,
+                               FlowEntryList& flows) {
+            flowutils::add_classifier_entries(match, act, pc.log,
+                                              boost::none,
+                                              boost::none,
+                                              boost::none,
+                                              nextTable, POL_TABLE_ID,
+                                              EXP_DROP_TABLE_ID,
+                                              pc.priority,
+                                              OFPUTIL_FF_SEND_FLOW_REM,
+                                              pc.cookie,
+                                              0, 0,
+                                              false,
+                                              flows);
+        };
+
+        // the classifier flows without the groups.  When the source
+        // and destination ports take more flows as pairs than on
+        // their own, they are matched by a clause each.
+        FlowEntryList clsFlows;
+        FlowEntryList dstPortFlows;
+        if (RangeMask::clausesCheaper(pc.match.srcPorts,
+                                      pc.match.dstPorts)) {
+            flowutils::ClassifierMatch srcMatch(pc.match);
+            flowutils::ClassifierMatch dstMatch(pc.match);
+            srcMatch.dstPorts = {Mask(0x0, 0x0)};
+            dstMatch.srcPorts = {Mask(0x0, 0x0)};
+            addClsFlows(srcMatch, clsFlows);
+            addClsFlows(dstMatch, dstPortFlows);
+        } else {
+            addClsFlows(pc.match, clsFlows);
+        }
+        if (clsFlows.empty())
+            continue;
+
+        // a classifier matching every packet is not a clause
+        ostringstream clsMatch;
+        clsMatch << clsFlows.front()->entry->match;
+        bool anyClassifier = clsFlows.size() == 1 && clsMatch.str().empty();
+        uint8_t nClauses = anyClassifier ? 2 : (dstPortFlows.empty() ? 3 : 4);
+
+        for (uint8_t dir : {DirectionEnumT::CONST_IN,
+                            DirectionEnumT::CONST_OUT}) {
+            if (pc.direction != dir &&
+                pc.direction != DirectionEnumT::CONST_BIDIRECTIONAL)
+                continue;
+            bool in = dir == DirectionEnumT::CONST_IN;
+            const unordered_set<uint32_t>& srcIds = in ? consIds : provIds;
+            const unordered_set<uint32_t>& dstIds = in ? provIds : consIds;
+
+            const string conjKey = contractId + "|" +
+                std::to_string(pc.cookie) + "|" +
+                std::to_string(pc.priority) + (in ? "|in" : "|out");
+            uint32_t conjId = idGen.getId(ID_NMSPC_CONJ, conjKey);
+
+            for (uint32_t vnid : srcIds) {
+                addClause(FlowBuilder().priority(pc.priority)
+                          .reg(0, vnid).build(), conjId, 0, nClauses);
+            }
+            for (uint32_t vnid : dstIds) {
+                addClause(FlowBuilder().priority(pc.priority)
+                          .reg(2, vnid).build(), conjId, 1, nClauses);
+            }
+            if (!anyClassifier) {
+                for (const FlowEntryPtr& fe : clsFlows)
+                    addClause(fe, conjId, 2, nClauses);
+                for (const FlowEntryPtr& fe : dstPortFlows)
+                    addClause(fe, conjId, 3, nClauses);
+            }
+
+            FlowBuilder f;
+            f.priority(pc.priority)
+                .cookie(ovs_htonll(pc.cookie))
+                .flags(OFPUTIL_FF_SEND_FLOW_REM)
+                .conjId(conjId);
+            if (!pc.allow) {
+                if (pc.log) {
+                    f.action()
+                        .dropLog(POL_TABLE_ID,
+                                 ActionBuilder::CaptureReason::POLICY_DENY,
+                                 pc.cookie);
+                } else {
+                    f.action().metadata(0, flow::meta::DROP_LOG);
+                }
+            } else if (pc.log) {
+                f.action().permitLog(POL_TABLE_ID, EXP_DROP_TABLE_ID,
+                                     pc.cookie);
+            }
+            f.action().go(nextTable);
+            objs.emplace_back(conjKey, FlowEntryList());
+            f.build(objs.back().second);
+            newConj.conjKeys.insert(conjKey);
+        }
+    }
+
+    ContractConj& oldConj = contractConjs[contractURI];
+    for (const string& conjKey : oldConj.conjKeys) {
+        if (newConj.conjKeys.find(conjKey) == newConj.conjKeys.end()) {
+            objs.emplace_back(conjKey, FlowEntryList());
+            idGen.erase(ID_NMSPC_CONJ, conjKey);
+        }
+    }
+
+    // update the shared clause flows this contract used or now uses
+    std::set<string> touched(oldConj.clauses);
+    for (const string& key : oldConj.clauses) {
+        if (newClauses.find(key) != newClauses.end())
+            continue;
+        auto it = conjClauses.find(key);
+        if (it != conjClauses.end())
+            it->second.conjs.erase(contractURI);
+    }
+    for (auto& nc : newClauses) {
+        ConjClause& clause = conjClauses[nc.first];
+        if (!clause.match)
+            clause.match = nc.second.first;
+        clause.conjs[contractURI] = std::move(nc.second.second);
+        newConj.clauses.insert(nc.first);
+        touched.insert(nc.first);
+    }
+    for (const string& key : touched) {
+        auto it = conjClauses.find(key);
+        if (it == conjClauses.end())
+            continue;
+        objs.emplace_back(key, FlowEntryList());
+        if (it->second.conjs.empty()) {
+            conjClauses.erase(it);
+            continue;
+        }
+        ConjSet all;
+        for (const auto& c : it->second.conjs)
+            all.insert(c.second.begin(), c.second.end());
+        FlowBuilder f;
+        f.matchOf(*it->second.match);
+        for (const auto& c : all) {
+            f.action().conjunction(std::get<0>(c), std::get<1>(c),
+                                   std::get<2>(c));
+        }
+        f.build(objs.back().second);
+    }
+
+    if (newConj.conjKeys.empty() && newConj.clauses.empty())
+        contractConjs.erase(contractURI);
+    else
+        oldConj = std::move(newConj);
+}
+
 void
 IntFlowManager::handleContractUpdate(const URI& contractURI) {
-    LOG(DEBUG) << "Updating contract " << contractURI;
+    ContractUpdate update;
+    {
+        const std::lock_guard<mutex> lock(contractUpdateMutex);
+        auto it = contractUpdates.find(contractURI);
+        if (it == contractUpdates.end())
+            return;             // handled by an earlier run
+        update = std::move(it->second);
+        contractUpdates.erase(it);
+    }
+    LOG(DEBUG) << "Updating contract " << contractURI
+               << (update.full ? "" : ", changed groups only");
 
     const string& contractId = contractURI.toString();
+    GroupPairIndex& pairs = contractPairs[contractURI];
+    auto pairObjId = [&contractId](const GroupPair& p) {
+        return contractId + "|" + p.first.toString() +
+            "|" + p.second.toString();
+    };
+    vector<std::pair<string, FlowEntryList> > objs;
+
     PolicyManager& polMgr = agent.getPolicyManager();
+    bool wasConjunctive =
+        contractConjs.find(contractURI) != contractConjs.end();
     if (!polMgr.contractExists(contractURI)) {  // Contract removed
-        switchManager.clearFlows(contractId, POL_TABLE_ID);
+        std::set<GroupPair> oldPairs;
+        for (const auto& g : pairs)
+            oldPairs.insert(g.second.begin(), g.second.end());
+        for (const GroupPair& p : oldPairs)
+            objs.emplace_back(pairObjId(p), FlowEntryList());
+        if (wasConjunctive)
+            updateContractConjunctions(contractURI, {}, {}, {}, objs);
+        switchManager.writeFlows(POL_TABLE_ID, objs);
+        contractPairs.erase(contractURI);
         return;
     }
     PolicyManager::uri_set_t provURIs;
@@ -6005,50 +6615,157 @@ IntFlowManager::handleContractUpdate(const URI& contractURI) {
     polMgr.getContractConsumers(contractURI, consURIs);
     polMgr.getContractIntra(contractURI, intraURIs);
 
+    typedef unordered_map<URI, uint32_t> vnid_map_t;
     typedef unordered_set<uint32_t> id_set_t;
+    vnid_map_t provVnids;
+    vnid_map_t consVnids;
+    vnid_map_t intraVnids;
     id_set_t provIds;
     id_set_t consIds;
-    id_set_t intraIds;
-    getGroupVnid(provURIs, provIds);
-    getGroupVnid(consURIs, consIds);
-    getGroupVnid(intraURIs, intraIds);
+    auto getVnids = [this](const PolicyManager::uri_set_t& uris,
+                           vnid_map_t& vnids, id_set_t* ids) {
+        for (const URI& u : uris) {
+            optional<uint32_t> vnid = getGroupVnid(u);
+            if (!vnid) continue;
+            vnids.emplace(u, vnid.get());
+            if (ids) ids->insert(vnid.get());
+        }
+    };
+    getVnids(provURIs, provVnids, &provIds);
+    getVnids(consURIs, consVnids, &consIds);
+    getVnids(intraURIs, intraVnids, NULL);
 
-    PolicyManager::rule_list_t rules;
-    polMgr.getContractRules(contractURI, rules);
+    PolicyManager::rule_list_t ruleList;
+    polMgr.getContractRules(contractURI, ruleList);
+    compiled_rule_list_t rules;
+    compileContractRules(ruleList, rules);
 
     LOG(DEBUG) << "Update for contract " << contractURI
                << ", #prov=" << provIds.size()
                << ", #cons=" << consIds.size()
-               << ", #intra=" << intraIds.size()
+               << ", #intra=" << intraVnids.size()
                << ", #rules=" << rules.size();
 
-    FlowEntryList entryList;
+    /*
+     * The flows of the pairs and the conjunctions of a contract
+     * replace one another as a whole.
+     */
+    bool conjunctive = useConjunctions(provIds, consIds);
+    if (conjunctive || wasConjunctive)
+        update.full = true;
+
+    /*
+     * The flows of the new pairs only depend on the compiled rules
+     * and the vnids of the groups, so they are computed across the
+     * flow workers once the pairs are known.
+     */
+    struct PairRules {
+        size_t obj;
+        uint32_t pvnid;
+        uint32_t cvnid;
+        bool allowBidirectional;
+    };
+    vector<PairRules> pairRules;
+    std::set<GroupPair> newPairs;
+    auto addPair = [&](const vnid_map_t::value_type& prov,
+                       const vnid_map_t::value_type& cons) {
+        if (prov.second == cons.second)
+            return;
+        GroupPair p(prov.first, cons.first);
+        if (!newPairs.insert(p).second)
+            return;
 
-    for (const uint32_t& pvnid : provIds) {
-        for (const uint32_t& cvnid : consIds) {
-            if (pvnid == cvnid)
-                continue;
+        /*
+         * Collapse bidirectional rules - if consumer 'cvnid' is
+         * also a provider and provider 'pvnid' is also a
+         * consumer, then add entry for cvnid to pvnid traffic
+         * only.
+         */
+        bool allowBidirectional =
+            provIds.find(cons.second) == provIds.end() ||
+            consIds.find(prov.second) == consIds.end();
 
-            /*
-             * Collapse bidirectional rules - if consumer 'cvnid' is
-             * also a provider and provider 'pvnid' is also a
-             * consumer, then add entry for cvnid to pvnid traffic
-             * only.
-             */
-            bool allowBidirectional =
-                provIds.find(cvnid) == provIds.end() ||
-                consIds.find(pvnid) == consIds.end();
+        objs.emplace_back(pairObjId(p), FlowEntryList());
+        pairRules.push_back({objs.size() - 1, prov.second, cons.second,
+                             allowBidirectional});
+    };
+    auto addIntra = [&](const vnid_map_t::value_type& intra) {
+        GroupPair p(intra.first, intra.first);
+        if (!newPairs.insert(p).second)
+            return;
+        objs.emplace_back(pairObjId(p), FlowEntryList());
+        pairRules.push_back({objs.size() - 1, intra.second, intra.second,
+                             false});
+    };
 
-            addContractRules(entryList, pvnid, cvnid,
-                             allowBidirectional,
-                             rules);
+    if (update.full) {
+        if (!conjunctive) {
+            for (const vnid_map_t::value_type& prov : provVnids) {
+                for (const vnid_map_t::value_type& cons : consVnids)
+                    addPair(prov, cons);
+            }
+        }
+        for (const vnid_map_t::value_type& intra : intraVnids)
+            addIntra(intra);
+    } else {
+        // only the pairs of the groups whose relationship changed
+        for (const URI& group : update.groups) {
+            auto pit = provVnids.find(group);
+            if (pit != provVnids.end()) {
+                for (const vnid_map_t::value_type& cons : consVnids)
+                    addPair(*pit, cons);
+            }
+            auto cit = consVnids.find(group);
+            if (cit != consVnids.end()) {
+                for (const vnid_map_t::value_type& prov : provVnids)
+                    addPair(prov, *cit);
+            }
+            auto iit = intraVnids.find(group);
+            if (iit != intraVnids.end())
+                addIntra(*iit);
+        }
+    }
+    flowWorkers.forEach(pairRules.size(), [&](size_t i) {
+            const PairRules& pr = pairRules[i];
+            addContractRules(objs[pr.obj].second, pr.pvnid, pr.cvnid,
+                             pr.allowBidirectional, rules);
+        });
+    if (conjunctive)
+        updateContractConjunctions(contractURI, provIds, consIds, rules, objs);
+    else if (wasConjunctive)
+        updateContractConjunctions(contractURI, {}, {}, {}, objs);
+
+    // clear the flows of the changed pairs that are gone
+    std::set<GroupPair> oldPairs;
+    if (update.full) {
+        for (const auto& g : pairs)
+            oldPairs.insert(g.second.begin(), g.second.end());
+    } else {
+        for (const URI& group : update.groups) {
+            auto it = pairs.find(group);
+            if (it != pairs.end())
+                oldPairs.insert(it->second.begin(), it->second.end());
+        }
+    }
+    for (const GroupPair& p : oldPairs) {
+        if (newPairs.find(p) != newPairs.end())
+            continue;
+        objs.emplace_back(pairObjId(p), FlowEntryList());
+        for (const URI& group : {p.first, p.second}) {
+            auto it = pairs.find(group);
+            if (it == pairs.end())
+                continue;
+            it->second.erase(p);
+            if (it->second.empty())
+                pairs.erase(it);
         }
     }
-    for (const uint32_t& ivnid : intraIds) {
-        addContractRules(entryList, ivnid, ivnid, false, rules);
+    for (const GroupPair& p : newPairs) {
+        pairs[p.first].insert(p);
+        pairs[p.second].insert(p);
     }
 
-    switchManager.writeFlow(contractId, POL_TABLE_ID, entryList);
+    switchManager.writeFlows(POL_TABLE_ID, objs);
 }
 
 void IntFlowManager::initPlatformConfig() {
@@ -6089,6 +6806,8 @@ void IntFlowManager::handleConfigUpdate(const URI& configURI) {
     // config update
     createStaticFlows();
 
+    // the platform config may change the endpoint flows of every group
+    groupEndpointDeps.clear();
     PolicyManager::uri_set_t epgURIs;
     agent.getPolicyManager().getGroups(epgURIs);
     for (const URI& epg : epgURIs) {
@@ -6107,6 +6826,48 @@ void IntFlowManager::updateGroupTable() {
     }
 }
 
+void IntFlowManager::updateTableDropFlows() {
+    using flowutils::is_drop_sampled;
+    using flowutils::drop_sample_group;
+    PacketDropLogSampling sampling =
+        agent.getExtraConfigManager().getPacketDropLogSampling();
+    SwitchManager::TableDescriptionMap tableDesc;
+    populateTableDescriptionMap(tableDesc);
+
+    // the sampling groups are added before the flows that use them
+    // and removed after
+    SwitchManager::Batch batch(switchManager);
+    /* Insert a flow at the end of every table to match dropped packets
+     * and go to the drop table, directly or through a sampling group,
+     * where it will be punted to a port when configured
+     */
+    for(unsigned table_id = SEC_TABLE_ID; table_id < EXP_DROP_TABLE_ID; table_id++) {
+        auto it = tableDesc.find(table_id);
+        double p = (it != tableDesc.end())
+            ? sampling.getProbability("Int-" + it->second.first)
+            : sampling.probability;
+        auto git = dropSampleGroups.find(table_id);
+        if (is_drop_sampled(p)) {
+            if (git == dropSampleGroups.end() || git->second != p) {
+                uint16_t comm = (git == dropSampleGroups.end())
+                    ? OFPGC11_ADD : OFPGC11_MODIFY;
+                switchManager.writeGroupMod(
+                    drop_sample_group(comm, table_id, EXP_DROP_TABLE_ID, p));
+                dropSampleGroups[table_id] = p;
+            }
+        } else if (git != dropSampleGroups.end()) {
+            switchManager.writeGroupMod(
+                drop_sample_group(OFPGC11_DELETE, table_id,
+                                  EXP_DROP_TABLE_ID, p));
+            dropSampleGroups.erase(git);
+        }
+        switchManager.writeFlow("DropLogStatic", table_id,
+                                flowutils::table_drop_flow(table_id,
+                                                           EXP_DROP_TABLE_ID,
+                                                           p));
+    }
+}
+
 void IntFlowManager::handleDropLogPortUpdate() {
     if(dropLogIface.empty() || !dropLogDst.is_v4()) {
         switchManager.clearFlows("DropLogStatic", EXP_DROP_TABLE_ID);
@@ -6133,6 +6894,9 @@ void IntFlowManager::handlePortStatusUpdate(const string& portName,
         initPlatformConfig();
         createStaticFlows();
 
+        // the platform config may change the endpoint flows of every
+        // group
+        groupEndpointDeps.clear();
         PolicyManager::uri_set_t epgURIs;
         agent.getPolicyManager().getGroups(epgURIs);
         for (const URI& epg : epgURIs) {
@@ -6198,21 +6962,29 @@ void IntFlowManager::handlePortStatusUpdate(const string& portName,
     }
 }
 
+optional<uint32_t> IntFlowManager::getGroupVnid(const URI& uri) {
+    PolicyManager& pm = agent.getPolicyManager();
+    optional<uint32_t> vnid = pm.getVnidForGroup(uri);
+    optional<shared_ptr<RoutingDomain> > rd;
+    if (vnid) {
+        rd = pm.getRDForGroup(uri);
+    } else {
+        rd = pm.getRDForL3ExtNet(uri);
+        if (rd) {
+            vnid = getExtNetVnid(uri);
+        }
+    }
+    if (!rd) {
+        return boost::none;
+    }
+    return vnid;
+}
+
 void IntFlowManager::getGroupVnid(const unordered_set<URI>& uris,
     /* out */unordered_set<uint32_t>& ids) {
-    PolicyManager& pm = agent.getPolicyManager();
     for (const URI& u : uris) {
-        optional<uint32_t> vnid = pm.getVnidForGroup(u);
-        optional<shared_ptr<RoutingDomain> > rd;
+        optional<uint32_t> vnid = getGroupVnid(u);
         if (vnid) {
-            rd = pm.getRDForGroup(u);
-        } else {
-            rd = pm.getRDForL3ExtNet(u);
-            if (rd) {
-                vnid = getExtNetVnid(u);
-            }
-        }
-        if (vnid && rd) {
             ids.insert(vnid.get());
         }
     }
@@ -6235,6 +7007,22 @@ static bool serviceIdGarbageCb(ServiceManager& serviceManager,
     return (bool)serviceManager.getService(str);
 }
 
+// the service select group and next hop IDs are keyed by service UUID
+static bool serviceKeyIdGarbageCb(ServiceManager& serviceManager,
+                                  const string& str) {
+    size_t sep = str.find(':');
+    if (sep == string::npos) return false;
+    return (bool)serviceManager.getService(str.substr(0, sep));
+}
+
+// the endpoint destination IDs are keyed by kind and endpoint UUID
+static bool endpointDestIdGarbageCb(EndpointManager& epManager,
+                                    const string& str) {
+    size_t sep = str.find(':');
+    if (sep == string::npos) return false;
+    return (bool)epManager.getEndpoint(str.substr(sep + 1));
+}
+
 static bool svcStatsIdGarbageCb(EndpointManager& epManager,
                               ServiceManager& serviceManager,
                               opflex::ofcore::OFFramework& framework,
@@ -6330,6 +7118,28 @@ void IntFlowManager::cleanup() {
                 };
                 idGen.collectGarbage(ID_NMSPC_SVCSTATS, ssgcb);
             });
+
+    agent.getAgentIOService()
+        .dispatch([=]() {
+                auto edgcb = [this](const string&,
+                                    const string& str) -> bool {
+                    return endpointDestIdGarbageCb(agent.getEndpointManager(),
+                                                   str);
+                };
+                idGen.collectGarbage(ID_NMSPC_EPDEST, edgcb);
+            });
+
+    for (const char* ns : {ID_NMSPC_SVCGROUP, ID_NMSPC_SVCNEXTHOP}) {
+        agent.getAgentIOService()
+            .dispatch([=]() {
+                    auto svcgcb = [this](const string&,
+                                         const string& str) -> bool {
+                        return serviceKeyIdGarbageCb(agent.getServiceManager(),
+                                                     str);
+                    };
+                    idGen.collectGarbage(ns, svcgcb);
+                });
+    }
 }
 
 const char * IntFlowManager::getIdNamespace(opflex::modb::class_id_t cid) {
@@ -6416,21 +7226,17 @@ void IntFlowManager::multicastGroupsUpdated() {
                        [this]() { writeMulticastGroups(); });
 }
 
-void IntFlowManager::writeMulticastGroups() {
+void IntFlowManager::writeMulticastGroups(bool snapshot) {
     if (mcastGroupFile == "") return;
 
-    pt::ptree tree;
-    pt::ptree groups;
-    for (MulticastMap::value_type& kv : mcastMap)
-        groups.push_back(std::make_pair("", pt::ptree(kv.first)));
-    tree.add_child("multicast-groups", groups);
-
-    try {
-        pt::write_json(mcastGroupFile, tree);
-    } catch (pt::json_parser_error& e) {
-        LOG(ERROR) << "Could not write multicast group file "
-                   << e.what();
+    if (!mcastGroupWriter) {
+        mcastGroupWriter.reset(new MulticastGroupWriter(mcastGroupFile));
+        mcastGroupWriter->setJournal(mcastGroupJournal);
     }
+    unordered_set<string> groups;
+    for (MulticastMap::value_type& kv : mcastMap)
+        groups.insert(kv.first);
+    mcastGroupWriter->write(groups, snapshot);
 }
 
 void IntFlowManager::checkGroupEntry(GroupMap& recvGroups,
@@ -6454,21 +7260,47 @@ void IntFlowManager::checkGroupEntry(GroupMap& recvGroups,
     }
 }
 
-vector<FlowEdit>
-IntFlowManager::reconcileFlows(vector<TableState> flowTables,
-                               vector<FlowEntryList>& recvFlows) {
+FlowEdit
+IntFlowManager::reconcileTable(int tableId, const TableState& tableState,
+                               FlowEntryList& recvFlows) {
     // special handling for learning table; reconcile only the
     // reactive flows.
-    FlowEntryList learnFlows;
-    recvFlows[IntFlowManager::LEARN_TABLE_ID].swap(learnFlows);
+    if (tableId == IntFlowManager::LEARN_TABLE_ID) {
+        FlowEntryList learnFlows;
+        recvFlows.swap(learnFlows);
 
-    for (const FlowEntryPtr& fe : learnFlows) {
-        if (fe->entry->cookie == 0) {
-            recvFlows[IntFlowManager::LEARN_TABLE_ID].push_back(fe);
+        for (const FlowEntryPtr& fe : learnFlows) {
+            if (fe->entry->cookie == 0) {
+                recvFlows.push_back(fe);
+            }
         }
     }
 
-    return SwitchStateHandler::reconcileFlows(flowTables, recvFlows);
+    return SwitchStateHandler::reconcileTable(tableId, tableState,
+                                              recvFlows);
+}
+
+bool IntFlowManager::isDeferredSyncEdit(int tableId,
+                                        const FlowEdit::Entry& edit) {
+    if (!stagedSync) return false;
+
+    const ofputil_flow_stats* entry = edit.second->entry;
+    switch (tableId) {
+    case DROP_LOG_TABLE_ID:
+        // the priority 0 flow forwards to the security table
+        return entry->priority > 0;
+    case STATS_TABLE_ID:
+        // the static priority 10 flow forwards to the output table
+        return entry->priority > 10;
+    case EXP_DROP_TABLE_ID:
+        return true;
+    default:
+        // the table miss flows that count the drops of each table,
+        // which drop the same packets as an empty table would
+        return entry->priority == 0 &&
+            (entry->cookie & flow::cookie::TABLE_DROP_FLOW) ==
+            flow::cookie::TABLE_DROP_FLOW;
+    }
 }
 
 GroupEdit IntFlowManager::reconcileGroups(GroupMap& recvGroups) {
@@ -6480,6 +7312,41 @@ GroupEdit IntFlowManager::reconcileGroups(GroupMap& recvGroups) {
         uint32_t fgrpId = getId(FloodDomain::CLASS_ID, fgrpURI);
         checkGroupEntry(recvGroups, fgrpId, epMap, ge);
     }
+    for (const auto& svc : serviceGroupMap) {
+        for (const SvcGroupMap::value_type& kv : svc.second) {
+            uint32_t groupId = getServiceGroupId(kv.first);
+            auto itr = recvGroups.find(groupId);
+            uint16_t comm = OFPGC11_ADD;
+            GroupEdit::Entry recv;
+            if (itr != recvGroups.end()) {
+                comm = OFPGC11_MODIFY;
+                recv = itr->second;
+                recvGroups.erase(itr);
+            }
+            GroupEdit::Entry e0 =
+                createServiceGroupMod(comm, groupId, kv.second);
+            if (!GroupEdit::groupEq(e0, recv)) {
+                ge.edits.push_back(e0);
+            }
+        }
+    }
+    for (const auto& kv : dropSampleGroups) {
+        uint32_t groupId = flowutils::DROP_SAMPLE_GROUP_BASE + kv.first;
+        auto itr = recvGroups.find(groupId);
+        uint16_t comm = OFPGC11_ADD;
+        GroupEdit::Entry recv;
+        if (itr != recvGroups.end()) {
+            comm = OFPGC11_MODIFY;
+            recv = itr->second;
+            recvGroups.erase(itr);
+        }
+        GroupEdit::Entry e0 =
+            flowutils::drop_sample_group(comm, kv.first, EXP_DROP_TABLE_ID,
+                                         kv.second);
+        if (!GroupEdit::groupEq(e0, recv)) {
+            ge.edits.push_back(e0);
+        }
+    }
     Ep2PortMap tmp;
     for (const GroupMap::value_type& kv : recvGroups) {
         GroupEdit::Entry e0 = createGroupMod(OFPGC11_DELETE, kv.first, tmp);
@@ -6489,7 +7356,7 @@ GroupEdit IntFlowManager::reconcileGroups(GroupMap& recvGroups) {
 }
 
 void IntFlowManager::completeSync() {
-    writeMulticastGroups();
+    writeMulticastGroups(true);
     advertManager.start();
 }
 
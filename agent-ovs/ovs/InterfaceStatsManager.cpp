@@ -37,8 +37,8 @@ InterfaceStatsManager::InterfaceStatsManager(Agent* agent_,
     : agent(agent_), intPortMapper(intPortMapper_),
       accessPortMapper(accessPortMapper_),
       intConnection(NULL), accessConnection(NULL),
-      agent_io(agent_->getAgentIOService()),
-      timer_interval(timer_interval_), stopping(false) {
+      agent_io(agent_->getStatsIOService()),
+      timer_interval(timer_interval_), ovsdbStats(false), stopping(false) {
 }
 
 InterfaceStatsManager::~InterfaceStatsManager() {
@@ -60,31 +60,39 @@ void InterfaceStatsManager::start() {
         return;
     }
     LOG(DEBUG) << "Starting interface stats manager ("
-               << timer_interval << " ms)";
+               << timer_interval << " ms"
+               << (ovsdbStats ? ", from OVSDB)" : ")");
 
-    if (intConnection)
+    if (intConnection && !ovsdbStats)
         intConnection->RegisterMessageHandler(OFPTYPE_PORT_STATS_REPLY, this);
     if (accessConnection) {
-        accessConnection->RegisterMessageHandler(OFPTYPE_PORT_STATS_REPLY,
-                                                 this);
+        if (!ovsdbStats)
+            accessConnection->RegisterMessageHandler(OFPTYPE_PORT_STATS_REPLY,
+                                                     this);
         agent->getEndpointManager().registerListener(this);
     }
 
     const std::lock_guard<std::mutex> guard(timer_mutex);
-    timer.reset(new deadline_timer(agent_io, milliseconds(timer_interval)));
-    timer->async_wait(bind(&InterfaceStatsManager::on_timer, this, error));
+    // stagger the first poll so that the stats managers do not all
+    // poll the switch at once
+    long delay = agent->getStatsPollScheduler().firstDelay(timer_interval);
+    timer.reset(new deadline_timer(agent_io, milliseconds(delay)));
+    strand.reset(new boost::asio::io_service::strand(agent_io));
+    timer->async_wait(strand->wrap(
+        bind(&InterfaceStatsManager::on_timer, this, error)));
 }
 
 void InterfaceStatsManager::stop() {
     LOG(DEBUG) << "Stopping interface stats manager";
     stopping = true;
 
-    if (intConnection) {
+    if (intConnection && !ovsdbStats) {
         intConnection->UnregisterMessageHandler(OFPTYPE_PORT_STATS_REPLY, this);
     }
     if (accessConnection) {
-        accessConnection->UnregisterMessageHandler(OFPTYPE_PORT_STATS_REPLY,
-                                                             this);
+        if (!ovsdbStats)
+            accessConnection->UnregisterMessageHandler(OFPTYPE_PORT_STATS_REPLY,
+                                                       this);
         agent->getEndpointManager().unregisterListener(this);
     }
 
@@ -109,6 +117,21 @@ void InterfaceStatsManager::on_timer(const error_code& ec) {
         return;
     }
 
+    if (ovsdbStats) {
+        updateChangedEndpoints();
+    } else {
+        sendPortStatsRequests();
+    }
+
+    if (!stopping) {
+        const std::lock_guard<std::mutex> guard(timer_mutex);
+        timer->expires_at(timer->expires_at() + milliseconds(timer_interval));
+        timer->async_wait(strand->wrap(
+            bind(&InterfaceStatsManager::on_timer, this, error)));
+    }
+}
+
+void InterfaceStatsManager::sendPortStatsRequests() {
     // send port stats request
     if (intConnection) {
         OfpBuf intPortStatsReq(ofputil_encode_dump_ports_request(
@@ -130,11 +153,78 @@ void InterfaceStatsManager::on_timer(const error_code& ec) {
                        << ovs_strerror(err);
         }
     }
+}
 
-    if (!stopping) {
-        const std::lock_guard<std::mutex> guard(timer_mutex);
-        timer->expires_at(timer->expires_at() + milliseconds(timer_interval));
-        timer->async_wait(bind(&InterfaceStatsManager::on_timer, this, error));
+void InterfaceStatsManager::
+interfaceStatsUpdated(const std::string& name,
+                      const std::unordered_map<std::string, uint64_t>& stats) {
+    auto get = [&stats](const char* counter) -> uint64_t {
+        auto it = stats.find(counter);
+        return it == stats.end() ? 0 : it->second;
+    };
+    EpCounters counters;
+    memset(&counters, 0, sizeof(counters));
+    counters.txPackets = get("tx_packets");
+    counters.rxPackets = get("rx_packets");
+    counters.txBytes = get("tx_bytes");
+    counters.rxBytes = get("rx_bytes");
+    counters.txDrop = get("tx_dropped");
+    counters.rxDrop = get("rx_dropped");
+
+    std::lock_guard<std::mutex> lock(statMtx);
+    auto it = ovsdbIntfCounters.find(name);
+    if (it != ovsdbIntfCounters.end() &&
+        memcmp(&it->second, &counters, sizeof(counters)) == 0)
+        return;
+    ovsdbIntfCounters[name] = counters;
+    changedIntfs.insert(name);
+}
+
+void InterfaceStatsManager::interfaceStatsRemoved(const std::string& name) {
+    std::lock_guard<std::mutex> lock(statMtx);
+    ovsdbIntfCounters.erase(name);
+    changedIntfs.erase(name);
+}
+
+void InterfaceStatsManager::updateChangedEndpoints() {
+    EndpointManager& epMgr = agent->getEndpointManager();
+    std::lock_guard<std::mutex> lock(statMtx);
+    std::unordered_set<std::string> endpoints;
+    for (const std::string& name : changedIntfs) {
+        epMgr.getEndpointsByIface(name, endpoints);
+        if (accessConnection)
+            epMgr.getEndpointsByAccessIface(name, endpoints);
+    }
+    changedIntfs.clear();
+
+    auto find = [this](const boost::optional<std::string>& name)
+        -> const EpCounters* {
+        if (!name)
+            return nullptr;
+        auto it = ovsdbIntfCounters.find(name.get());
+        return it == ovsdbIntfCounters.end() ? nullptr : &it->second;
+    };
+    for (const std::string& uuid : endpoints) {
+        std::shared_ptr<const Endpoint> ep = epMgr.getEndpoint(uuid);
+        if (!ep)
+            continue;
+        const EpCounters* intCounters = find(ep->getInterfaceName());
+        if (!accessConnection) {
+            if (intCounters) {
+                EpCounters counters = *intCounters;
+                epMgr.updateEndpointCounters(uuid, counters);
+            }
+            continue;
+        }
+        // as for the port stats, the counters of the access interface
+        // plus the drops on the integration bridge
+        const EpCounters* accessCounters = find(ep->getAccessInterface());
+        if (accessCounters && intCounters) {
+            EpCounters counters = *accessCounters;
+            counters.txDrop += intCounters->txDrop;
+            counters.rxDrop += intCounters->rxDrop;
+            epMgr.updateEndpointCounters(uuid, counters);
+        }
     }
 }
 
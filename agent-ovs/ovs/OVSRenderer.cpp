@@ -11,7 +11,10 @@
 
 #include "OVSRenderer.h"
 #include <opflexagent/logging.h>
+#include <opflex/util/ThreadSettings.h>
 #include <sstream>
+#include <algorithm>
+#include <cmath>
 #include <boost/asio/placeholders.hpp>
 #include <openvswitch/vlog.h>
 
@@ -26,6 +29,18 @@ using boost::asio::placeholders::error;
 static const std::string ID_NMSPC_CONNTRACK("conntrack");
 static const boost::posix_time::milliseconds CLEANUP_INTERVAL(3*60*1000);
 
+static const std::string STATS_INTERFACE_INTERVAL("statistics"
+                                                  ".interface.interval");
+static const std::string STATS_CONTRACT_INTERVAL("statistics"
+                                                 ".contract.interval");
+static const std::string STATS_SERVICE_INTERVAL("statistics"
+                                                ".service.interval");
+static const std::string STATS_SECGROUP_INTERVAL("statistics"
+                                                 ".security-group"
+                                                 ".interval");
+static const std::string TABLE_DROP_STATS_INTERVAL("statistics"
+                                                   ".table-drop.interval");
+
 #define PACKET_LOGGER_PIDDIR LOCALSTATEDIR"/lib/opflex-agent-ovs/pids"
 #define LOOPBACK "127.0.0.1"
 
@@ -67,13 +82,26 @@ OVSRenderer::OVSRenderer(Agent& agent_)
       virtualRouter(true), routerAdv(true),
       endpointAdvMode(AdvertManager::EPADV_GRATUITOUS_BROADCAST),
       tunnelEndpointAdvMode(AdvertManager::EPADV_RARP_BROADCAST),
-      tunnelEndpointAdvIntvl(300),
-      virtualDHCP(true), connTrack(true), ctZoneRangeStart(0),
-      ctZoneRangeEnd(0), ovsdbUseLocalTcpPort(false), ifaceStatsEnabled(true), ifaceStatsInterval(0),
+      tunnelEndpointAdvIntvl(300), endpointAdvRateLimit(1000),
+      virtualDHCP(true), flowIdCacheJournal(false), mcastGroupJournal(false),
+      connTrack(true),
+      ctZoneRangeStart(0),
+      ctZoneRangeEnd(0), ovsdbUseLocalTcpPort(false), ovsdbTransactWindow(8),
+      ovsdbTransactBatchSize(256), ovsdbTransactDelay(5), updateDebounce(10),
+      updateMaxDebounce(100),
+      conjunctiveContracts(false), endpointDestLookup(false),
+      routeAggregation(false), stagedSync(false), serviceSelectGroups(false),
+      conjunctiveSecGroups(false),
+      flowWriteWindow(1), groupBucketEdits(false), flowComputeThreads(1),
+      accessBridgeThread(false),
+      packetInQueueSize(1024), packetInRateLimit(0),
+      ifaceStatsEnabled(true), ifaceStatsInterval(0), ifaceStatsOvsdb(false),
       contractStatsEnabled(true), contractStatsInterval(0),
-      serviceStatsFlowDisabled(false), serviceStatsEnabled(true), serviceStatsInterval(0),
+      serviceStatsFlowDisabled(false), serviceStatsAggregated(false),
+      serviceStatsEnabled(true), serviceStatsInterval(0),
       secGroupStatsEnabled(true), secGroupStatsInterval(0),
       tableDropStatsEnabled(true), tableDropStatsInterval(0),
+      tableDropStatsSingleRequest(false),
       spanRenderer(agent_), netflowRenderer(agent_), qosRenderer(agent_), started(false),
       dropLogRemotePort(6081), dropLogLocalPort(50000), pktLogger(pktLoggerIO, exporterIO, idGen)
 {
@@ -118,6 +146,7 @@ void OVSRenderer::start() {
 
     if (!flowIdCache.empty())
         idGen.setPersistLocation(flowIdCache);
+    idGen.setJournal(flowIdCacheJournal);
 
     if (connTrack) {
         ctZoneManager.setCtZoneRange(ctZoneRangeStart, ctZoneRangeEnd);
@@ -140,8 +169,20 @@ void OVSRenderer::start() {
     intFlowManager.setVirtualRouter(virtualRouter, routerAdv, virtualRouterMac);
     intFlowManager.setVirtualDHCP(virtualDHCP, virtualDHCPMac);
     intFlowManager.setMulticastGroupFile(mcastGroupFile);
+    intFlowManager.setMulticastGroupJournal(mcastGroupJournal);
+    intFlowManager.setUpdateDebounce(updateDebounce, updateMaxDebounce);
+    accessFlowManager.setUpdateDebounce(updateDebounce, updateMaxDebounce);
+    intFlowManager.setConjunctiveContracts(conjunctiveContracts);
+    intFlowManager.setEndpointDestLookup(endpointDestLookup);
+    intFlowManager.setRouteAggregation(routeAggregation);
+    intFlowManager.setStagedSync(stagedSync);
+    intFlowManager.setServiceSelectGroups(serviceSelectGroups);
+    accessFlowManager.setConjunctiveSecGroups(conjunctiveSecGroups);
+    intFlowManager.setServiceStatsAggregated(serviceStatsAggregated);
+    intFlowManager.setFlowComputeThreads(flowComputeThreads);
+    accessFlowManager.setDedicatedThread(accessBridgeThread);
     intFlowManager.setEndpointAdv(endpointAdvMode, tunnelEndpointAdvMode,
-            tunnelEndpointAdvIntvl);
+            tunnelEndpointAdvIntvl, endpointAdvRateLimit);
     if(!dropLogIntIface.empty()) {
         intFlowManager.setDropLog(dropLogIntIface, dropLogRemoteIp,
                 dropLogRemotePort);
@@ -151,6 +192,9 @@ void OVSRenderer::start() {
                         dropLogRemotePort);
     }
 
+    intSwitchManager.setWriteWindow(flowWriteWindow);
+    accessSwitchManager.setWriteWindow(flowWriteWindow);
+    intSwitchManager.setGroupBucketEdits(groupBucketEdits);
     intSwitchManager.registerStateHandler(&intFlowManager);
     intSwitchManager.start(intBridgeName);
     if (accessBridgeName != "") {
@@ -175,10 +219,12 @@ void OVSRenderer::start() {
                                ? &accessSwitchManager.getPortMapper()
                                : NULL);
     pktInHandler.setFlowReader(&intSwitchManager.getFlowReader());
+    pktInHandler.setQueueLimits(packetInQueueSize, packetInRateLimit);
     pktInHandler.start();
 
     if (ifaceStatsEnabled) {
         interfaceStatsManager.setTimerInterval(ifaceStatsInterval);
+        interfaceStatsManager.setOvsdbStats(ifaceStatsOvsdb);
         interfaceStatsManager.
             registerConnection(intSwitchManager.getConnection(),
                                (accessBridgeName != "")
@@ -209,6 +255,7 @@ void OVSRenderer::start() {
     }
     if (tableDropStatsEnabled) {
         tableDropStatsManager.setTimerInterval(tableDropStatsInterval);
+        tableDropStatsManager.setSingleRequest(tableDropStatsSingleRequest);
         tableDropStatsManager.setAgentUUID(getAgent().getUuid());
 
         tableDropStatsManager.
@@ -239,6 +286,15 @@ void OVSRenderer::start() {
     }
 
     ovsdbConnection.reset(new OvsdbConnection(ovsdbUseLocalTcpPort));
+    std::set<std::string> bridgeNames = {intBridgeName};
+    if (accessBridgeName != "")
+        bridgeNames.insert(accessBridgeName);
+    ovsdbConnection->setBridgeNames(bridgeNames);
+    ovsdbConnection->setTransactWindow(ovsdbTransactWindow,
+                                       ovsdbTransactBatchSize);
+    ovsdbConnection->setTransactDelay(ovsdbTransactDelay);
+    if (ifaceStatsEnabled && ifaceStatsOvsdb)
+        ovsdbConnection->setStatsListener(&interfaceStatsManager);
     ovsdbConnection->start();
     ovsdbConnection->connect();
 
@@ -280,6 +336,7 @@ void OVSRenderer::stop() {
     dnsManager.stop();
     intFlowManager.stop();
     accessFlowManager.stop();
+    ctZoneManager.stop();
 
     intSwitchManager.stop();
     accessSwitchManager.stop();
@@ -341,9 +398,13 @@ void OVSRenderer::setProperties(const ptree& properties) {
                                "endpoint-advertisements.tunnel-endpoint-mode");
     static const std::string ENDPOINT_TNL_ADV_INTVL("forwarding."
                                    "endpoint-advertisements.tunnel-endpoint-interval");
+    static const std::string ENDPOINT_ADV_RATE_LIMIT("forwarding."
+                                   "endpoint-advertisements.rate-limit");
 
     static const std::string FLOWID_CACHE_DIR("flowid-cache-dir");
+    static const std::string FLOWID_CACHE_JOURNAL("flowid-cache-journal");
     static const std::string MCAST_GROUP_FILE("mcast-group-file");
+    static const std::string MCAST_GROUP_JOURNAL("mcast-group-journal");
     static const std::string DNS_CACHE_DIR("dns-cache-dir");
 
     static const std::string CONN_TRACK("forwarding.connection-tracking."
@@ -357,30 +418,46 @@ void OVSRenderer::setProperties(const ptree& properties) {
 
     static const std::string STATS_INTERFACE_ENABLED("statistics"
                                                      ".interface.enabled");
-    static const std::string STATS_INTERFACE_INTERVAL("statistics"
-                                                      ".interface.interval");
+    static const std::string STATS_INTERFACE_OVSDB("statistics"
+                                                   ".interface.ovsdb-monitor");
     static const std::string STATS_CONTRACT_ENABLED("statistics"
                                                     ".contract.enabled");
-    static const std::string STATS_CONTRACT_INTERVAL("statistics"
-                                                    ".contract.interval");
     static const std::string STATS_SERVICE_FLOWDISABLED("statistics"
                                                         ".service.flow-disabled");
+    static const std::string STATS_SERVICE_AGGREGATED("statistics"
+                                                      ".service.aggregated");
     static const std::string STATS_SERVICE_ENABLED("statistics"
                                                   ".service.enabled");
-    static const std::string STATS_SERVICE_INTERVAL("statistics"
-                                                   ".service.interval");
     static const std::string STATS_SECGROUP_ENABLED("statistics"
                                                     ".security-group.enabled");
-    static const std::string STATS_SECGROUP_INTERVAL("statistics"
-                                                     ".security-group"
-                                                     ".interval");
     static const std::string TABLE_DROP_STATS_ENABLED("statistics"
                                                       ".table-drop.enabled");
-    static const std::string TABLE_DROP_STATS_INTERVAL("statistics"
-                                                       ".table-drop.interval");
+    static const std::string
+        TABLE_DROP_STATS_SINGLE_REQUEST("statistics"
+                                        ".table-drop.single-request");
     static const std::string DROP_LOG_ENCAP_GENEVE("drop-log.geneve");
     static const std::string REMOTE_NAMESPACE("namespace");
     static const std::string OVSDB_USE_LOCAL_TCPPORT("ovsdb-use-local-tcp-port");
+    static const std::string OVSDB_TRANSACT_WINDOW("ovsdb-transact-window");
+    static const std::string OVSDB_TRANSACT_BATCH_SIZE("ovsdb-transact"
+                                                       "-batch-size");
+    static const std::string OVSDB_TRANSACT_DELAY("ovsdb-transact-delay");
+    static const std::string UPDATE_DEBOUNCE("update-debounce.delay");
+    static const std::string UPDATE_MAX_DEBOUNCE("update-debounce"
+                                                 ".max-delay");
+    static const std::string CONJUNCTIVE_CONTRACTS("conjunctive-contracts");
+    static const std::string ENDPOINT_DEST_LOOKUP("endpoint-dest-lookup");
+    static const std::string ROUTE_AGGREGATION("route-aggregation");
+    static const std::string STAGED_SYNC("staged-sync");
+    static const std::string SERVICE_SELECT_GROUPS("service-select-groups");
+    static const std::string CONJUNCTIVE_SECURITY_GROUPS("conjunctive"
+                                                         "-security-groups");
+    static const std::string FLOW_WRITE_WINDOW("flow-write-window");
+    static const std::string GROUP_BUCKET_EDITS("group-bucket-edits");
+    static const std::string FLOW_COMPUTE_THREADS("flow-compute-threads");
+    static const std::string ACCESS_BRIDGE_THREAD("access-bridge-thread");
+    static const std::string PACKET_IN_QUEUE_SIZE("packet-in.queue-size");
+    static const std::string PACKET_IN_RATE_LIMIT("packet-in.rate-limit");
 
     intBridgeName =
         properties.get<std::string>(OVS_BRIDGE_NAME, "br-int");
@@ -475,6 +552,8 @@ void OVSRenderer::setProperties(const ptree& properties) {
     tunnelEndpointAdvIntvl =
         properties.get<uint64_t>(ENDPOINT_TNL_ADV_INTVL,
                                     300);
+    endpointAdvRateLimit =
+        properties.get<uint32_t>(ENDPOINT_ADV_RATE_LIMIT, 1000);
 
     connTrack = properties.get<bool>(CONN_TRACK, true);
     ctZoneRangeStart = properties.get<uint16_t>(CONN_TRACK_RANGE_START, 1);
@@ -482,21 +561,52 @@ void OVSRenderer::setProperties(const ptree& properties) {
 
     flowIdCache = properties.get<std::string>(FLOWID_CACHE_DIR,
                                               DEF_FLOWID_CACHEDIR);
+    flowIdCacheJournal = properties.get<bool>(FLOWID_CACHE_JOURNAL, false);
 
     mcastGroupFile = properties.get<std::string>(MCAST_GROUP_FILE,
                                                  DEF_MCAST_GROUPFILE);
+    mcastGroupJournal = properties.get<bool>(MCAST_GROUP_JOURNAL, false);
 
     dnsCacheDir = properties.get<std::string>(DNS_CACHE_DIR,
                                               DEF_DNS_CACHEDIR);
 
     ovsdbUseLocalTcpPort = properties.get<bool>(OVSDB_USE_LOCAL_TCPPORT, false);
+    ovsdbTransactWindow =
+        properties.get<size_t>(OVSDB_TRANSACT_WINDOW, 8);
+    ovsdbTransactBatchSize =
+        properties.get<size_t>(OVSDB_TRANSACT_BATCH_SIZE, 256);
+    ovsdbTransactDelay =
+        properties.get<uint64_t>(OVSDB_TRANSACT_DELAY, 5);
+    updateDebounce = std::chrono::milliseconds(
+        properties.get<long>(UPDATE_DEBOUNCE, 10));
+    updateMaxDebounce = std::chrono::milliseconds(
+        properties.get<long>(UPDATE_MAX_DEBOUNCE, 100));
+    conjunctiveContracts =
+        properties.get<bool>(CONJUNCTIVE_CONTRACTS, false);
+    endpointDestLookup =
+        properties.get<bool>(ENDPOINT_DEST_LOOKUP, false);
+    routeAggregation =
+        properties.get<bool>(ROUTE_AGGREGATION, false);
+    stagedSync = properties.get<bool>(STAGED_SYNC, false);
+    serviceSelectGroups =
+        properties.get<bool>(SERVICE_SELECT_GROUPS, false);
+    conjunctiveSecGroups =
+        properties.get<bool>(CONJUNCTIVE_SECURITY_GROUPS, false);
+    flowWriteWindow = properties.get<size_t>(FLOW_WRITE_WINDOW, 1);
+    groupBucketEdits = properties.get<bool>(GROUP_BUCKET_EDITS, false);
+    flowComputeThreads = properties.get<size_t>(FLOW_COMPUTE_THREADS, 1);
+    accessBridgeThread = properties.get<bool>(ACCESS_BRIDGE_THREAD, false);
+    packetInQueueSize = properties.get<size_t>(PACKET_IN_QUEUE_SIZE, 1024);
+    packetInRateLimit = properties.get<uint64_t>(PACKET_IN_RATE_LIMIT, 0);
 
     ifaceStatsEnabled = properties.get<bool>(STATS_INTERFACE_ENABLED, true);
     contractStatsEnabled = properties.get<bool>(STATS_CONTRACT_ENABLED, true);
     serviceStatsFlowDisabled = properties.get<bool>(STATS_SERVICE_FLOWDISABLED, false);
+    serviceStatsAggregated = properties.get<bool>(STATS_SERVICE_AGGREGATED, false);
     serviceStatsEnabled = properties.get<bool>(STATS_SERVICE_ENABLED, true);
     secGroupStatsEnabled = properties.get<bool>(STATS_SECGROUP_ENABLED, true);
     ifaceStatsInterval = properties.get<long>(STATS_INTERFACE_INTERVAL, 30000);
+    ifaceStatsOvsdb = properties.get<bool>(STATS_INTERFACE_OVSDB, false);
     tableDropStatsEnabled = properties.get<bool>(TABLE_DROP_STATS_ENABLED, true);
 
     contractStatsInterval =
@@ -507,18 +617,78 @@ void OVSRenderer::setProperties(const ptree& properties) {
         properties.get<long>(STATS_SECGROUP_INTERVAL, 10000);
     tableDropStatsInterval =
         properties.get<long>(TABLE_DROP_STATS_INTERVAL, 30000);
+    tableDropStatsSingleRequest =
+        properties.get<bool>(TABLE_DROP_STATS_SINGLE_REQUEST, false);
     if (ifaceStatsInterval <= 0) {
         ifaceStatsEnabled = false;
     }
     if (contractStatsInterval <= 0) {
         contractStatsEnabled = false;
     }
+    if (serviceStatsInterval <= 0) {
+        serviceStatsEnabled = false;
+    }
     if (secGroupStatsInterval <= 0) {
         secGroupStatsEnabled = false;
     }
     if(tableDropStatsInterval <= 0) {
         tableDropStatsEnabled = false;
     }
+    appliedProperties = properties;
+}
+
+bool OVSRenderer::reloadProperties(const ptree& properties) {
+    // Only the stats intervals are applied in place; any other change,
+    // including an interval that enables or disables a stats manager,
+    // needs a restart
+    static const std::vector<const std::string*> INTERVALS = {
+        &STATS_INTERFACE_INTERVAL, &STATS_CONTRACT_INTERVAL,
+        &STATS_SERVICE_INTERVAL, &STATS_SECGROUP_INTERVAL,
+        &TABLE_DROP_STATS_INTERVAL
+    };
+    auto withoutIntervals = [](ptree props) {
+        for (const std::string* path : INTERVALS) {
+            size_t dot = path->rfind('.');
+            boost::optional<ptree&> parent =
+                props.get_child_optional(path->substr(0, dot));
+            if (parent)
+                parent.get().erase(path->substr(dot + 1));
+        }
+        return props;
+    };
+    if (withoutIntervals(appliedProperties) != withoutIntervals(properties))
+        return false;
+
+    long ifaceInterval =
+        properties.get<long>(STATS_INTERFACE_INTERVAL, 30000);
+    long contractInterval =
+        properties.get<long>(STATS_CONTRACT_INTERVAL, 10000);
+    long serviceInterval =
+        properties.get<long>(STATS_SERVICE_INTERVAL, 10000);
+    long secGroupInterval =
+        properties.get<long>(STATS_SECGROUP_INTERVAL, 10000);
+    long tableDropInterval =
+        properties.get<long>(TABLE_DROP_STATS_INTERVAL, 30000);
+    if ((ifaceInterval > 0) != (ifaceStatsInterval > 0) ||
+        (contractInterval > 0) != (contractStatsInterval > 0) ||
+        (serviceInterval > 0) != (serviceStatsInterval > 0) ||
+        (secGroupInterval > 0) != (secGroupStatsInterval > 0) ||
+        (tableDropInterval > 0) != (tableDropStatsInterval > 0))
+        return false;
+
+    ifaceStatsInterval = ifaceInterval;
+    contractStatsInterval = contractInterval;
+    serviceStatsInterval = serviceInterval;
+    secGroupStatsInterval = secGroupInterval;
+    tableDropStatsInterval = tableDropInterval;
+    interfaceStatsManager.setTimerInterval(ifaceStatsInterval);
+    contractStatsManager.setTimerInterval(contractStatsInterval);
+    serviceStatsManager.setTimerInterval(serviceStatsInterval);
+    secGrpStatsManager.setTimerInterval(secGroupStatsInterval);
+    tableDropStatsManager.setTimerInterval(tableDropStatsInterval);
+    appliedProperties = properties;
+    LOG(INFO) << "Reloaded renderer statistics intervals";
+    return true;
 }
 
 static bool connTrackIdGarbageCb(EndpointManager& endpointManager,
@@ -576,13 +746,14 @@ void OVSRenderer::startPacketLogger() {
     pktLogger.setAccBridgeTableDescription(tblDescMap);
     pktLogger.startListener();
     if(!getAgent().getPacketEventNotifSock().empty()) {
-        exporterThread.reset(new std::thread([this]() {
-           this->pktLogger.startExporter();
-        }));
-    }
-    packetLoggerThread.reset(new std::thread([this]() {
-       this->pktLoggerIO.run();
-    }));
+        exporterThread.reset(new std::thread(
+            opflex::util::startThread("pkt_exporter", [this]() {
+                    this->pktLogger.startExporter();
+                })));
+    }
+    packetLoggerThread.reset(new std::thread(
+        opflex::util::startThread("pkt_logger",
+                                  [this]() { this->pktLoggerIO.run(); })));
 }
 static void convertPruneFilter(std::shared_ptr<PacketDropLogPruneSpec> &sourceSpec,
         shared_ptr<PacketFilterSpec> &filter) {
@@ -629,6 +800,10 @@ static void convertPruneFilter(std::shared_ptr<PacketDropLogPruneSpec> &sourceSp
         strDport << sourceSpec->dport.get();
         filter->setField(TFLD_DPORT,strDport.str());
     }
+    if(sourceSpec->sample && sourceSpec->sample.get() > 0) {
+        filter->sampleInterval =
+            std::max(1L, std::lround(1 / sourceSpec->sample.get()));
+    }
 }
 
 void OVSRenderer::packetDropPruneConfigUpdated(const std::string& filterName) {
@@ -25,9 +25,21 @@ extern "C" {
 namespace opflexagent {
 
 mutex OvsdbConnection::ovsdbMtx;
+const char* OvsdbConnection::STATS_MONITOR_ID = "Interface-statistics";
 
 void OvsdbConnection::on_writeq_async(uv_async_t* handle) {
     auto* conn = (OvsdbConnection*)handle->data;
+    conn->flushTransactions();
+    conn->processWriteQueue();
+}
+
+void OvsdbConnection::on_transact_timer(uv_timer_t* handle) {
+    auto* conn = (OvsdbConnection*)handle->data;
+    {
+        const std::lock_guard<std::mutex> guard(conn->transactMtx);
+        conn->transactTimerStarted = false;
+    }
+    conn->flushTransactions();
     conn->processWriteQueue();
 }
 
@@ -39,6 +51,8 @@ void OvsdbConnection::start() {
     uv_async_init(client_loop,&connect_async, connect_cb);
     writeq_async.data = this;
     uv_async_init(client_loop, &writeq_async, on_writeq_async);
+    transact_timer.data = this;
+    uv_timer_init(client_loop, &transact_timer);
 
     threadManager.startTask("OvsdbConnection");
 }
@@ -65,6 +79,7 @@ void OvsdbConnection::connect_cb(uv_async_t* handle) {
 void OvsdbConnection::stop() {
     uv_close((uv_handle_t*)&connect_async, nullptr);
     uv_close((uv_handle_t*)&writeq_async, nullptr);
+    uv_close((uv_handle_t*)&transact_timer, nullptr);
     yajr::finiLoop(client_loop);
     threadManager.stopTask("OvsdbConnection");
     cleanup();
@@ -118,8 +133,182 @@ void OvsdbConnection::disconnect() {
     // TODO
 }
 
+/*
+ * Is the operation an update of a row picked by the same conditions
+ * with no reference to the rows named in its transaction
+ */
+static bool isPlainUpdate(const OvsdbTransactMessage& msg) {
+    if (msg.getOperation() != OvsdbOperation::UPDATE ||
+        msg.conditions.empty() || !msg.mutateRowData.empty() ||
+        !msg.externalKey.first.empty())
+        return false;
+    for (const auto& column : msg.rowData) {
+        for (const auto& value : column.second.values) {
+            if (value.getKey() == "named-uuid")
+                return false;
+            for (const auto& elem : value.getCollectionValue()) {
+                if (elem.first == "named-uuid")
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+void OvsdbConnection::dropSupersededTransaction(const list<OvsdbTransactMessage>& requests) {
+    if (requests.size() != 1 || !isPlainUpdate(requests.front()))
+        return;
+    const OvsdbTransactMessage& update = requests.front();
+    // look back no further than the last other operation on the
+    // rows of the table, so that no operation on them is reordered
+    for (auto it = pendingTransacts.rbegin(); it != pendingTransacts.rend(); ++it) {
+        bool sameTable = false;
+        for (const auto& request : it->requests) {
+            if (request.getTable() == update.getTable())
+                sameTable = true;
+        }
+        if (!sameTable)
+            continue;
+        if (it->alone || it->requests.size() != 1)
+            return;
+        const OvsdbTransactMessage& old = it->requests.front();
+        if (!isPlainUpdate(old))
+            return;
+        if (old.conditions != update.conditions) {
+            // updates of other rows picked by the same column are
+            // crossed
+            if (old.conditions.size() == 1 && update.conditions.size() == 1 &&
+                std::get<0>(*old.conditions.begin()) ==
+                std::get<0>(*update.conditions.begin()))
+                continue;
+            return;
+        }
+        for (const auto& column : old.rowData) {
+            if (update.rowData.find(column.first) == update.rowData.end())
+                return;
+        }
+        LOG(DEBUG) << "Dropping update of " << OvsdbMessage::toString(update.getTable())
+                   << " superseded by a later one";
+        pendingTransacts.erase(std::next(it).base());
+        return;
+    }
+}
+
+void OvsdbConnection::sendTransaction(const list<OvsdbTransactMessage>& requests) {
+    {
+        const std::lock_guard<std::mutex> guard(transactMtx);
+        if (pendingTransacts.empty() && transactDelay > 0) {
+            // collect the transactions for a while
+            transactDue = std::chrono::steady_clock::now() +
+                std::chrono::milliseconds(transactDelay);
+        }
+        dropSupersededTransaction(requests);
+        pendingTransacts.push_back({requests, false});
+    }
+    messagesReady();
+}
+
+void OvsdbConnection::flushTransactions() {
+    const std::lock_guard<std::mutex> guard(transactMtx);
+    if (transactDelay > 0 && !pendingTransacts.empty()) {
+        auto now = std::chrono::steady_clock::now();
+        if (now < transactDue) {
+            if (!transactTimerStarted) {
+                transactTimerStarted = true;
+                uint64_t wait = std::chrono::duration_cast<std::chrono::milliseconds>
+                    (transactDue - now).count() + 1;
+                uv_timer_start(&transact_timer, on_transact_timer, wait, 0);
+            }
+            return;
+        }
+    }
+    while (!pendingTransacts.empty() &&
+           inflightTransacts.size() < transactWindow) {
+        uint64_t reqId = getNextId();
+        vector<PendingTransact>& batch = inflightTransacts[reqId];
+        list<OvsdbTransactMessage> requests;
+        do {
+            PendingTransact& pending = pendingTransacts.front();
+            if (!batch.empty() &&
+                (batch.front().alone || pending.alone ||
+                 requests.size() + pending.requests.size() > transactBatchSize)) {
+                break;
+            }
+            // every renderer uses the same few uuid-names, which
+            // must be unique within a transact request
+            const string suffix =
+                batch.empty() ? "" : "_" + std::to_string(batch.size());
+            for (auto& request : pending.requests) {
+                requests.push_back(request);
+                requests.back().uuidNameSuffix = suffix;
+            }
+            batch.push_back(std::move(pending));
+            pendingTransacts.pop_front();
+        } while (!pendingTransacts.empty());
+        LOG(DEBUG) << "Sending " << batch.size() << " transactions with "
+                   << requests.size() << " operations, reqId " << reqId;
+        sendMessage(new TransactReq(requests, reqId), false);
+    }
+}
+
+void OvsdbConnection::retryTransactions(vector<PendingTransact>& batch,
+                                        size_t failed) {
+    // a transaction sent on its own is not retried
+    if (batch.size() < 2) {
+        return;
+    }
+    const std::lock_guard<std::mutex> guard(transactMtx);
+    for (size_t i = batch.size(); i-- > 0; ) {
+        if (i == failed) {
+            continue;
+        }
+        batch[i].alone = true;
+        pendingTransacts.push_front(std::move(batch[i]));
+    }
+    LOG(INFO) << "Retrying " << batch.size() - (failed < batch.size() ? 1 : 0)
+              << " batched transactions one by one";
+}
+
 void OvsdbConnection::handleTransaction(uint64_t reqId, const Document& payload) {
     LOG(DEBUG) << "Received response for transaction with reqId " << reqId;
+    vector<PendingTransact> batch;
+    {
+        const std::lock_guard<std::mutex> guard(transactMtx);
+        auto it = inflightTransacts.find(reqId);
+        if (it != inflightTransacts.end()) {
+            batch = std::move(it->second);
+            inflightTransacts.erase(it);
+        }
+    }
+    if (payload.IsArray()) {
+        // OVSDB stops at the first operation that fails and aborts
+        // the whole transact request, along with every transaction
+        // batched into it.  Errors past the last operation are
+        // failures to commit.
+        for (SizeType i = 0; i < payload.Size(); ++i) {
+            if (!payload[i].IsObject() || !payload[i].HasMember("error")) {
+                continue;
+            }
+            StringBuffer buffer;
+            Writer<StringBuffer> writer(buffer);
+            payload[i].Accept(writer);
+            LOG(WARNING) << "Transaction with reqId " << reqId
+                         << " failed at operation " << i << " - "
+                         << buffer.GetString();
+            size_t failed = 0;
+            size_t ops = 0;
+            for (; failed < batch.size(); ++failed) {
+                ops += batch[failed].requests.size();
+                if (i < ops) {
+                    break;
+                }
+            }
+            retryTransactions(batch, failed);
+            break;
+        }
+    }
+    // the window has room for another transact request
+    messagesReady();
 }
 
 void OvsdbConnection::handleTransactionError(uint64_t reqId, const Document& payload) {
@@ -131,6 +320,17 @@ void OvsdbConnection::handleTransactionError(uint64_t reqId, const Document& pay
     } else {
         LOG(WARNING) << "Received error response with no error element";
     }
+    vector<PendingTransact> batch;
+    {
+        const std::lock_guard<std::mutex> guard(transactMtx);
+        auto it = inflightTransacts.find(reqId);
+        if (it != inflightTransacts.end()) {
+            batch = std::move(it->second);
+            inflightTransacts.erase(it);
+        }
+    }
+    retryTransactions(batch, batch.size());
+    messagesReady();
 }
 
 void populateValues(const Value& value, string& type, map<string, string>& values) {
@@ -184,6 +384,36 @@ void populateValues(const Value& value, string& type, map<string, string>& value
     }
 }
 
+/**
+ * Process the columns of an OVSDB row
+ * @param row rapidjson value of the row
+ * @param rowDetails details of the row
+ */
+static void processRow(const Value& row, OvsdbRowDetails& rowDetails) {
+    for (Value::ConstMemberIterator propItr = row.MemberBegin();
+         propItr != row.MemberEnd(); ++propItr) {
+        if (propItr->name.IsString()) {
+            const std::string propName = propItr->name.GetString();
+            if (propItr->value.IsString()) {
+                std::string stringValue = propItr->value.GetString();
+                rowDetails[propName] = OvsdbValue(stringValue);
+            } else if (propItr->value.IsArray()) {
+                map<string, string> items;
+                string type;
+                populateValues(propItr->value, type, items);
+                opflexagent::Dtype dataType = type.empty() ? opflexagent::Dtype::STRING : (type == "map" ? Dtype::MAP : Dtype::SET);
+                rowDetails[propName] = OvsdbValue(dataType, type, items);
+            } else if (propItr->value.IsInt()) {
+                int intValue = propItr->value.GetInt();
+                rowDetails[propName] = OvsdbValue(intValue);
+            } else if (propItr->value.IsBool()) {
+                bool boolValue = propItr->value.GetBool();
+                rowDetails[propName] = OvsdbValue(boolValue);
+            }
+        }
+    }
+}
+
 /**
  * Process an OVSDB row update
  * @param value rapidjson value
@@ -201,34 +431,132 @@ bool processRowUpdate(const Value& value, OvsdbRowDetails& rowDetails) {
             } else if ("old" != state) {
                 LOG(WARNING) << "Unexpected state " << state;
             }
-            for (Value::ConstMemberIterator propItr = itr->value.MemberBegin();
-                 propItr != itr->value.MemberEnd(); ++propItr) {
-                if (propItr->name.IsString()) {
-                    const std::string propName = propItr->name.GetString();
-                    if (propItr->value.IsString()) {
-                        std::string stringValue = propItr->value.GetString();
-                        rowDetails[propName] = OvsdbValue(stringValue);
-                    } else if (propItr->value.IsArray()) {
-                        map<string, string> items;
-                        string type;
-                        populateValues(propItr->value, type, items);
-                        opflexagent::Dtype dataType = type.empty() ? opflexagent::Dtype::STRING : (type == "map" ? Dtype::MAP : Dtype::SET);
-                        rowDetails[propName] = OvsdbValue(dataType, type, items);
-                    } else if (propItr->value.IsInt()) {
-                        int intValue = propItr->value.GetInt();
-                        rowDetails[propName] = OvsdbValue(intValue);
-                    } else if (propItr->value.IsBool()) {
-                        bool boolValue = propItr->value.GetBool();
-                        rowDetails[propName] = OvsdbValue(boolValue);
-                    }
-                }
-            }
+            processRow(itr->value, rowDetails);
         }
     }
     return result;
 }
 
+/**
+ * The tables of the state, and the columns monitored
+ */
+static const vector<pair<OvsdbTable, list<string>>>& stateTables() {
+    static const vector<pair<OvsdbTable, list<string>>> tables = {
+        {OvsdbTable::BRIDGE, {"name", "ports", "netflow", "ipfix", "mirrors"}},
+        {OvsdbTable::PORT, {"name", "interfaces", "qos"}},
+        {OvsdbTable::INTERFACE, {"name", "type", "options"}},
+        {OvsdbTable::MIRROR, {"name", "select_src_port", "select_dst_port", "output_port"}},
+        {OvsdbTable::NETFLOW, {"targets", "active_timeout", "add_id_to_interface"}},
+        {OvsdbTable::IPFIX, {"targets", "sampling", "other_config"}},
+        {OvsdbTable::QOS, {"queues"}}
+    };
+    return tables;
+}
+
+/**
+ * Is the column a set or a map, for which the modified rows of
+ * update2 carry the difference with the old value
+ */
+static bool isCollectionColumn(OvsdbTable table, const string& column) {
+    static const set<pair<OvsdbTable, string>> columns = {
+        {OvsdbTable::BRIDGE, "ports"},
+        {OvsdbTable::BRIDGE, "netflow"},
+        {OvsdbTable::BRIDGE, "ipfix"},
+        {OvsdbTable::BRIDGE, "mirrors"},
+        {OvsdbTable::PORT, "interfaces"},
+        {OvsdbTable::PORT, "qos"},
+        {OvsdbTable::INTERFACE, "options"},
+        {OvsdbTable::MIRROR, "select_src_port"},
+        {OvsdbTable::MIRROR, "select_dst_port"},
+        {OvsdbTable::MIRROR, "output_port"},
+        {OvsdbTable::NETFLOW, "targets"},
+        {OvsdbTable::IPFIX, "targets"},
+        {OvsdbTable::IPFIX, "sampling"},
+        {OvsdbTable::IPFIX, "other_config"},
+        {OvsdbTable::QOS, "queues"}
+    };
+    return columns.find(make_pair(table, column)) != columns.end();
+}
+
+/**
+ * Apply the columns of a modified row of update2 to a row.  The
+ * elements of the difference of a set are added to the set if they
+ * are missing and removed otherwise; the pairs of the difference of
+ * a map are added or replace the pairs with the same key, unless
+ * the pair is present, in which case it is removed.
+ */
+static void applyRowDiff(OvsdbTable table, const OvsdbRowDetails& diff,
+                         OvsdbRowDetails& row) {
+    for (const auto& col : diff) {
+        auto it = row.find(col.first);
+        if (it == row.end() || !isCollectionColumn(table, col.first)) {
+            row[col.first] = col.second;
+            continue;
+        }
+        bool isMap = it->second.getType() == Dtype::MAP ||
+            col.second.getType() == Dtype::MAP;
+        map<string, string> items = it->second.getCollectionValue();
+        for (const auto& elem : col.second.getCollectionValue()) {
+            auto iit = items.find(elem.first);
+            if (iit == items.end())
+                items.insert(elem);
+            else if (!isMap || iit->second == elem.second)
+                items.erase(iit);
+            else
+                iit->second = elem.second;
+        }
+        it->second = isMap ? OvsdbValue(Dtype::MAP, "map", items)
+            : OvsdbValue(Dtype::SET, "set", items);
+    }
+}
+
+void OvsdbConnection::processInterfaceStats(const Value& rows) {
+    if (!statsListener || !rows.IsObject())
+        return;
+    for (Value::ConstMemberIterator itr = rows.MemberBegin();
+         itr != rows.MemberEnd(); ++itr) {
+        if (!itr->value.IsObject())
+            continue;
+        if (!itr->value.HasMember("new")) {
+            // deleted row
+            if (itr->value.HasMember("old") && itr->value["old"].IsObject() &&
+                itr->value["old"].HasMember("name") &&
+                itr->value["old"]["name"].IsString()) {
+                statsListener->interfaceStatsRemoved(itr->value["old"]["name"].GetString());
+            }
+            continue;
+        }
+        const Value& row = itr->value["new"];
+        if (!row.IsObject() || !row.HasMember("name") || !row["name"].IsString() ||
+            !row.HasMember("statistics"))
+            continue;
+        // the statistics are a map of counter names to integers:
+        // ["map", [["rx_packets", 1], ...]]
+        const Value& statistics = row["statistics"];
+        if (!statistics.IsArray() || statistics.Size() != 2 || !statistics[1].IsArray())
+            continue;
+        unordered_map<string, uint64_t> stats;
+        const Value& counters = statistics[1];
+        for (SizeType i = 0; i < counters.Size(); ++i) {
+            const Value& counter = counters[i];
+            if (counter.IsArray() && counter.Size() == 2 &&
+                counter[0].IsString() && counter[1].IsUint64()) {
+                stats[counter[0].GetString()] = counter[1].GetUint64();
+            }
+        }
+        statsListener->interfaceStatsUpdated(row["name"].GetString(), stats);
+    }
+}
+
 void OvsdbConnection::handleMonitor(uint64_t reqId, const Document& payload) {
+    if (statsListener && reqId == statsMonitorReqId) {
+        // the initial statistics, not part of the sync of the state
+        if (payload.IsObject() &&
+            payload.HasMember(OvsdbMessage::toString(OvsdbTable::INTERFACE))) {
+            processInterfaceStats(payload[OvsdbMessage::toString(OvsdbTable::INTERFACE)]);
+        }
+        return;
+    }
     if (payload.IsObject()) {
         OvsdbTableDetails tableState;
         if (payload.HasMember(OvsdbMessage::toString(OvsdbTable::BRIDGE))) {
@@ -240,12 +568,11 @@ void OvsdbConnection::handleMonitor(uint64_t reqId, const Document& payload) {
                         OvsdbRowDetails rowDetails;
                         std::string uuid = itr->name.GetString();
                         rowDetails["uuid"] = OvsdbValue(uuid);
-                        std::string bridgeName;
                         processRowUpdate(itr->value, rowDetails);
                         if (rowDetails.find("name") != rowDetails.end()) {
-                            bridgeName = rowDetails["name"].getStringValue();
-                            // use bridge name as key as that's the most common lookup
-                            tableState[bridgeName] = rowDetails;
+                            // keyed by UUID as the updates are, the
+                            // state indexes the rows by name
+                            tableState[uuid] = rowDetails;
                         } else {
                             LOG(WARNING) << "Dropping bridge with no name";
                         }
@@ -359,11 +686,141 @@ void OvsdbConnection::handleMonitorError(uint64_t reqId, const Document& payload
     } else {
         LOG(WARNING) << "Received error response with no error element";
     }
+
+    OvsdbTable table;
+    {
+        const std::lock_guard<std::mutex> guard(monitorMtx);
+        auto it = pendingCondMonitors.find(reqId);
+        if (it == pendingCondMonitors.end())
+            return;
+        table = it->second;
+        pendingCondMonitors.erase(it);
+    }
+    // ovsdb-server before 2.12 does not support monitor_cond_since
+    if (useMonitorCondSince.exchange(false)) {
+        LOG(INFO) << "Conditional monitors not supported, "
+                  << "falling back to monitor";
+    }
+    sendStateMonitor(table, false);
+}
+
+void OvsdbConnection::processRowUpdates2(OvsdbTable table, const Value& rows,
+                                         bool replace) {
+    OvsdbTableDetails tableState;
+    if (rows.IsObject()) {
+        for (Value::ConstMemberIterator itr = rows.MemberBegin();
+             itr != rows.MemberEnd(); ++itr) {
+            if (!itr->name.IsString() || !itr->value.IsObject())
+                continue;
+            string rowUuid = itr->name.GetString();
+            for (Value::ConstMemberIterator opItr = itr->value.MemberBegin();
+                 opItr != itr->value.MemberEnd(); ++opItr) {
+                if (!opItr->name.IsString())
+                    continue;
+                string op = opItr->name.GetString();
+                if (op == "delete") {
+                    if (!replace)
+                        ovsdbState.deleteRow(table, rowUuid);
+                    continue;
+                }
+                if (!opItr->value.IsObject())
+                    continue;
+                OvsdbRowDetails rowDetails;
+                if (op == "initial" || op == "insert") {
+                    rowDetails["uuid"] = OvsdbValue(rowUuid);
+                    processRow(opItr->value, rowDetails);
+                } else if (op == "modify") {
+                    OvsdbRowDetails diff;
+                    processRow(opItr->value, diff);
+                    auto it = tableState.find(rowUuid);
+                    if (it != tableState.end()) {
+                        rowDetails = it->second;
+                    } else if (replace ||
+                               !ovsdbState.getRow(table, rowUuid, rowDetails)) {
+                        LOG(WARNING) << "Modified row " << rowUuid
+                                     << " not found in "
+                                     << OvsdbMessage::toString(table);
+                        rowDetails["uuid"] = OvsdbValue(rowUuid);
+                    }
+                    applyRowDiff(table, diff, rowDetails);
+                } else {
+                    LOG(WARNING) << "Unexpected row update " << op;
+                    continue;
+                }
+                if (replace)
+                    tableState[rowUuid] = rowDetails;
+                else
+                    ovsdbState.updateRow(table, rowUuid, rowDetails);
+            }
+        }
+    }
+    if (replace)
+        ovsdbState.fullUpdate(table, tableState);
+}
+
+void OvsdbConnection::handleMonitorCondSince(uint64_t reqId, const Document& payload) {
+    OvsdbTable table;
+    {
+        const std::lock_guard<std::mutex> guard(monitorMtx);
+        auto it = pendingCondMonitors.find(reqId);
+        if (it == pendingCondMonitors.end()) {
+            LOG(WARNING) << "Unexpected monitor_cond_since response " << reqId;
+            return;
+        }
+        table = it->second;
+        pendingCondMonitors.erase(it);
+        // [found, last-txn-id, table-updates2]
+        if (payload.IsArray() && payload.Size() == 3 &&
+            payload[1].IsString()) {
+            lastTxnIds[OvsdbMessage::toString(table)] = payload[1].GetString();
+        }
+    }
+    if (payload.IsArray() && payload.Size() == 3 && payload[0].IsBool() &&
+        payload[2].IsObject()) {
+        // when the transaction is not found, the updates are the
+        // initial contents of the table
+        bool found = payload[0].GetBool();
+        const char* tableName = OvsdbMessage::toString(table);
+        LOG(DEBUG) << "Monitor of " << tableName
+                   << (found ? " resumed" : " started");
+        if (payload[2].HasMember(tableName))
+            processRowUpdates2(table, payload[2][tableName], !found);
+        else if (!found)
+            ovsdbState.fullUpdate(table, OvsdbTableDetails());
+    } else {
+        LOG(WARNING) << "Unexpected monitor_cond_since response";
+    }
+    decrSyncMsgsRemaining();
+}
+
+void OvsdbConnection::handleUpdate3(const Document& payload) {
+    // [monitor-id, last-txn-id, table-updates2]
+    if (!payload.IsArray() || payload.Size() != 3 || !payload[0].IsString() ||
+        !payload[1].IsString() || !payload[2].IsObject())
+        return;
+    {
+        const std::lock_guard<std::mutex> guard(monitorMtx);
+        lastTxnIds[payload[0].GetString()] = payload[1].GetString();
+    }
+    for (const auto& t : stateTables()) {
+        const char* tableName = OvsdbMessage::toString(t.first);
+        if (payload[2].HasMember(tableName)) {
+            LOG(DEBUG) << "OVSDB update for " << tableName << " table";
+            processRowUpdates2(t.first, payload[2][tableName], false);
+        }
+    }
 }
 
 void OvsdbConnection::handleUpdate(const Document& payload) {
     if (payload.IsArray()) {
         if (payload[0].IsString()) {
+            if (statsListener && payload[1].IsObject() &&
+                std::string(payload[0].GetString()) == STATS_MONITOR_ID) {
+                if (payload[1].HasMember(OvsdbMessage::toString(OvsdbTable::INTERFACE))) {
+                    processInterfaceStats(payload[1][OvsdbMessage::toString(OvsdbTable::INTERFACE)]);
+                }
+                return;
+            }
             if (payload[1].IsObject()) {
                 if (payload[1].HasMember(OvsdbMessage::toString(OvsdbTable::BRIDGE))) {
                     LOG(DEBUG) << "OVSDB update for bridge table";
@@ -510,29 +967,55 @@ void OvsdbConnection::messagesReady() {
     uv_async_send(&writeq_async);
 }
 
+void OvsdbConnection::sendStateMonitor(OvsdbTable table, bool conditional) {
+    const list<string>* columns = NULL;
+    for (const auto& t : stateTables()) {
+        if (t.first == table)
+            columns = &t.second;
+    }
+    if (!columns)
+        return;
+    uint64_t reqId = getNextId();
+    if (!conditional) {
+        sendMessage(new OvsdbMonitorMessage(table, *columns, reqId), false);
+        return;
+    }
+
+    string lastTxnId;
+    {
+        const std::lock_guard<std::mutex> guard(monitorMtx);
+        pendingCondMonitors[reqId] = table;
+        auto it = lastTxnIds.find(OvsdbMessage::toString(table));
+        if (it != lastTxnIds.end())
+            lastTxnId = it->second;
+    }
+    string whereColumn;
+    list<string> whereValues;
+    if (table == OvsdbTable::BRIDGE && !bridgeNames.empty()) {
+        whereColumn = "name";
+        whereValues.assign(bridgeNames.begin(), bridgeNames.end());
+    }
+    sendMessage(new OvsdbMonitorMessage(table, *columns, whereColumn,
+                                        whereValues, lastTxnId, reqId),
+                false);
+}
+
 void OvsdbConnection::sendMonitorRequests() {
-    syncMsgsRemaining = 7;
-    list<string> bridgeColumns = {"name", "ports", "netflow", "ipfix", "mirrors"};
-    auto message = new OvsdbMonitorMessage(OvsdbTable::BRIDGE, bridgeColumns, getNextId());
-    sendMessage(message, false);
-    list<string> portColumns = {"name", "interfaces", "qos"};
-    message = new OvsdbMonitorMessage(OvsdbTable::PORT, portColumns, getNextId());
-    sendMessage(message, false);
-    list<string> interfaceColumns = {"name", "type", "options"};
-    message = new OvsdbMonitorMessage(OvsdbTable::INTERFACE, interfaceColumns, getNextId());
-    sendMessage(message, false);
-    list<string> mirrorColumns = {"name", "select_src_port", "select_dst_port", "output_port"};
-    message = new OvsdbMonitorMessage(OvsdbTable::MIRROR, mirrorColumns, getNextId());
-    sendMessage(message, false);
-    list<string> netflowColumns = {"targets", "active_timeout", "add_id_to_interface"};
-    message = new OvsdbMonitorMessage(OvsdbTable::NETFLOW, netflowColumns, getNextId());
-    sendMessage(message, false);
-    list<string> ipfixColumns = {"targets", "sampling", "other_config"};
-    message = new OvsdbMonitorMessage(OvsdbTable::IPFIX, ipfixColumns, getNextId());
-    sendMessage(message, false);
-    list<string> qosColumns = {"queues"};
-    message = new OvsdbMonitorMessage(OvsdbTable::QOS, qosColumns, getNextId());
-    sendMessage(message, false);
+    syncMsgsRemaining = stateTables().size();
+    bool conditional = useMonitorCondSince;
+    for (const auto& t : stateTables()) {
+        sendStateMonitor(t.first, conditional);
+    }
+    if (statsListener) {
+        // monitored apart from the interface state so that the
+        // updates of the counters are told from changes to the
+        // interfaces; the sync of the state does not wait for it
+        list<string> statsColumns = {"name", "statistics"};
+        statsMonitorReqId = getNextId();
+        auto message = new OvsdbMonitorMessage(OvsdbTable::INTERFACE, statsColumns,
+                                               statsMonitorReqId, STATS_MONITOR_ID);
+        sendMessage(message, false);
+    }
 }
 
 }
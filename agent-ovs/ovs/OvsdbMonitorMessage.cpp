@@ -16,7 +16,7 @@ namespace opflexagent {
 bool OvsdbMonitorMessage::operator()(yajr::rpc::SendHandler& writer) const {
     writer.StartArray();
     writer.String("Open_vSwitch");
-    writer.String(toString(table));
+    writer.String(monitorId.c_str());
     writer.StartObject();
     writer.String(toString(table));
     writer.StartArray();
@@ -27,9 +27,28 @@ bool OvsdbMonitorMessage::operator()(yajr::rpc::SendHandler& writer) const {
         writer.String(column.c_str());
     }
     writer.EndArray();
+    if (conditional && !whereColumn.empty() && !whereValues.empty()) {
+        // the conditions of a monitor are or-ed
+        writer.String("where");
+        writer.StartArray();
+        for (const std::string& value : whereValues) {
+            writer.StartArray();
+            writer.String(whereColumn.c_str());
+            writer.String("==");
+            writer.String(value.c_str());
+            writer.EndArray();
+        }
+        writer.EndArray();
+    }
     writer.EndObject();
     writer.EndArray();
     writer.EndObject();
+    if (conditional) {
+        // the zero UUID stands for no transaction
+        writer.String(lastTxnId.empty()
+                      ? "00000000-0000-0000-0000-000000000000"
+                      : lastTxnId.c_str());
+    }
     writer.EndArray();
     return true;
 }
@@ -19,7 +19,8 @@
 
 namespace opflexagent {
 
-void writeValue(yajr::rpc::SendHandler& writer, const OvsdbValue& value) {
+void writeValue(yajr::rpc::SendHandler& writer, const OvsdbValue& value,
+                const string& uuidNameSuffix) {
     if (value.getType() == Dtype::INTEGER) {
         writer.Uint64(value.getIntValue());
     } else if (value.getType() == Dtype::STRING) {
@@ -27,7 +28,11 @@ void writeValue(yajr::rpc::SendHandler& writer, const OvsdbValue& value) {
             writer.StartArray();
             writer.String(value.getKey().c_str());
         }
-        writer.String(value.getStringValue().c_str());
+        if (value.getKey() == "named-uuid" && !uuidNameSuffix.empty()) {
+            writer.String((value.getStringValue() + uuidNameSuffix).c_str());
+        } else {
+            writer.String(value.getStringValue().c_str());
+        }
         if (!value.getKey().empty()) {
             writer.EndArray();
         }
@@ -45,17 +50,38 @@ void writeValue(yajr::rpc::SendHandler& writer, const OvsdbValue& value) {
         for(auto it : valueMap){
             writer.StartArray();
             writer.String(it.first.c_str());
-            writer.String(it.second.c_str());
+            if (it.first == "named-uuid") {
+                writer.String((it.second + uuidNameSuffix).c_str());
+            } else {
+                writer.String(it.second.c_str());
+            }
             writer.EndArray();
         }
         writer.EndArray();
     }
 }
 
+/* write a single value, or a labeled set or map of values */
+static void writeValues(yajr::rpc::SendHandler& writer, const OvsdbValues& tdsPtr,
+                        const string& uuidNameSuffix) {
+    if (!tdsPtr.label.empty()) {
+        writer.StartArray();
+        writer.String(tdsPtr.label.c_str());
+        writer.StartArray();
+        for (auto& val : tdsPtr.values) {
+            writeValue(writer, val, uuidNameSuffix);
+        }
+        writer.EndArray();
+        writer.EndArray();
+    } else {
+        writeValue(writer, *(tdsPtr.values.begin()), uuidNameSuffix);
+    }
+}
+
 bool OvsdbTransactMessage::operator()(yajr::rpc::SendHandler& writer) const {
     if (!externalKey.first.empty()) {
         writer.String(externalKey.first.c_str());
-        writer.String(externalKey.second.c_str());
+        writer.String((externalKey.second + uuidNameSuffix).c_str());
     }
     if (getOperation() != OvsdbOperation::INSERT) {
         writer.String("where");
@@ -99,19 +125,7 @@ bool OvsdbTransactMessage::operator()(yajr::rpc::SendHandler& writer) const {
         for (auto& rowEntry : rowData) {
             const string& col = rowEntry.first;
             writer.String(col.c_str());
-            const OvsdbValues& tdsPtr = rowEntry.second;
-            if (!tdsPtr.label.empty()) {
-                writer.StartArray();
-                writer.String(tdsPtr.label.c_str());
-                writer.StartArray();
-                for (auto& val : tdsPtr.values) {
-                    writeValue(writer, val);
-                }
-                writer.EndArray();
-                writer.EndArray();
-            } else {
-                writeValue(writer, *(tdsPtr.values.begin()));
-            }
+            writeValues(writer, rowEntry.second, uuidNameSuffix);
         }
         writer.EndObject();
     }
@@ -124,8 +138,7 @@ bool OvsdbTransactMessage::operator()(yajr::rpc::SendHandler& writer) const {
             writer.String(col.c_str());
             const string& mutateRowOperation = toString(rowEntry.second.first);
             writer.String(mutateRowOperation.c_str());
-            const OvsdbValues &tdsPtr = rowEntry.second.second;
-            writeValue(writer, *(tdsPtr.values.begin()));
+            writeValues(writer, rowEntry.second.second, uuidNameSuffix);
             writer.EndArray();
         }
         writer.EndArray();
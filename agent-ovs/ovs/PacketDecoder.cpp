@@ -77,205 +77,164 @@ bool operator== (const PacketTuple &lhs, const PacketTuple &rhs) {
     return  (lhs.fields == rhs.fields);
 }
 
-void PacketDecoderLayerField::transformLog(uint32_t value, stringstream &ostr, ParseInfo &p) {
-    if(!shouldLog()){
-        return;
-    }
-    //Convert key types to layer names
-    if(getIsNextKey()) {
-        string layerName;
-        if(p.pktDecoder &&
-           p.pktDecoder->getLayerNameByTypeKey(
-               p.nextLayerTypeId, p.nextKey, layerName)) {
-            ostr << layerName;
-        } else {
-            ostr << value << "_unrecognized";
-        }
-        return;
-    }
-    //Print fieldnames for bits
-    if(bitLength == 1) {
-        if(value ==1) {
-            ostr << fieldName << " ";
-        }
-        return;
-    }
-    //Check for a string representation
-    auto it = kvOutMap.find(value);
-    if(it != kvOutMap.end()) {
-        ostr << it->second;
-    } else {
-        ostr << value;
-    }
+static void appendHex(std::string &out, uint8_t byte) {
+    static const char digits[] = "0123456789abcdef";
+    out += digits[byte >> 4];
+    out += digits[byte & 0xf];
 }
 
-int PacketDecoderLayerField::decode(const unsigned char *buf, std::size_t length, ParseInfo &p) {
-    stringstream ostr;
-    int err = 0;
-    unsigned char *data_ptr = const_cast<unsigned char *>(buf) + (bitOffset/8);
+void PacketDecoderLayerField::format(const ParsedField &f,
+                                     PacketDecoder *decoder,
+                                     std::string &out) const {
     switch(fieldType) {
         case FLDTYPE_BITFIELD:
-        {
-            uint32_t value = 0;
-            unsigned char *ptr = (unsigned char *)&value;
-            uint32_t valBytes = 0;
-            uint32_t remBits = 0;
-            if(bitLength > 8-(bitOffset%8)) {
-                remBits = (bitLength-8+(bitOffset%8));
-                valBytes += (remBits)/8;
-                if(remBits%8) {
-                    valBytes++;
-                }
-            } else {
-                remBits = 8-bitLength-(bitOffset%8);
-            }
-            unsigned char maskLow = ((1<<(8-(bitOffset%8)))-1);
-            ptr[3-valBytes] = *data_ptr & maskLow;
-            for( uint32_t i=1; i <= valBytes; i++) {
-                data_ptr++;
-                ptr[3-valBytes+i] = *data_ptr;
-            }
-            ptr[3] &= ~((1<<(remBits%8)) -1);
-            value = ntohl(value);
-            if(remBits%8 != 0) {
-                value = value >> remBits;
-            }
-            transformLog(value, ostr, p);
-            if(getIsLength()) {
-                p.inferredLength = value;
-            }
-            int scratchOffset;
-            if(shouldSave(scratchOffset)) {
-                p.scratchpad[scratchOffset] = value;
-            }
-            break;
-        }
         case FLDTYPE_BYTES:
         case FLDTYPE_OPTBYTES:
         {
-            uint8_t byteLen = bitLength/8;
-            if(fieldType == FLDTYPE_OPTBYTES) {
-                if(p.hasOptBytes == 0) {
-                    if(getIsLength()) {
-                        p.inferredLength = 0;
-                    }
-                    break;
+            if(byteCount > 4) {
+                if(byteCount <= 8) {
+                    out.append((const char *)f.data, byteCount);
                 }
+                break;
             }
-            if (byteLen <= 4) {
-                uint32_t value = 0;
-                unsigned char *ptr = (unsigned char *)&value;
-                for(uint8_t i=0; i<byteLen; i++) {
-                    ptr[4-byteLen+i] = *data_ptr;
-                    data_ptr++;
-                }
-                value = ntohl(value);
-                if(getIsLength()) {
-                    p.inferredLength = value;
-                }
-                if(getIsNextKey()) {
-                    p.nextKey = value;
+            //Convert key types to layer names
+            if(isNextKey) {
+                PacketDecoderLayer *layer = decoder ?
+                    decoder->findLayer(f.nextTypeId, f.value) : nullptr;
+                if(layer) {
+                    out += layer->getName();
+                } else {
+                    out += std::to_string(f.value);
+                    out += "_unrecognized";
                 }
-                transformLog(value, ostr, p);
-                if(shouldSave(scratchOffset)) {
-                    p.scratchpad[scratchOffset] = value;
-                }
-                if(isMetaField()) {
-                    p.meta[metaSeq-1] = value;
-                }
-            } else if(byteLen <= 8) {
-                uint64_t value = 0;
-                unsigned char *ptr = (unsigned char *)&value;
-                memcpy(ptr, data_ptr, byteLen);
-                if(shouldLog()) {
-                    for (uint8_t i=0; i<byteLen; i++) {
-                        ostr << hex << *ptr;
-                        ptr++;
-                    }
+                break;
+            }
+            //Print fieldnames for bits
+            if(bitLength == 1) {
+                if(f.value == 1) {
+                    out += fieldName;
+                    out += ' ';
                 }
+                break;
+            }
+            //Check for a string representation
+            auto it = kvOutMap.find(f.value);
+            if(it != kvOutMap.end()) {
+                out += it->second;
+            } else {
+                out += std::to_string(f.value);
             }
             break;
         }
         case FLDTYPE_IPv4ADDR:
         {
-            uint32_t value = 0;
-            unsigned char *ptr = (unsigned char *)&value;
-            for(int i=0; i<=3; i++) {
-                ptr[i] = *data_ptr;
-                data_ptr++;
-            }
-            value = htonl(value);
-            boost::asio::ip::address_v4 addr(value);
-            if(shouldLog()) {
-                ostr << addr;
-            }
+            boost::asio::ip::address_v4::bytes_type bytes;
+            memcpy(bytes.data(), f.data, bytes.size());
+            out += boost::asio::ip::address_v4(bytes).to_string();
             break;
         }
         case FLDTYPE_IPv6ADDR:
         {
             boost::asio::ip::address_v6::bytes_type bytes;
-            for(int i=0; i<16 ; i++) {
-                bytes[i] = *data_ptr;
-                data_ptr++;
-            }
-            boost::asio::ip::address_v6 addr(bytes);
-            if(shouldLog()) {
-                ostr << addr;
-            }
+            memcpy(bytes.data(), f.data, bytes.size());
+            out += boost::asio::ip::address_v6(bytes).to_string();
             break;
         }
         case FLDTYPE_MAC:
-        {   uint8_t mac_bytes[6];
-            memcpy(mac_bytes,data_ptr,6);
-            opflex::modb::MAC mac(mac_bytes);
-            if(shouldLog()) {
-                ostr << mac;
+        {
+            for(int i=0; i<6; i++) {
+                if(i != 0) {
+                    out += ':';
+                }
+                appendHex(out, f.data[i]);
             }
             break;
         }
         case FLDTYPE_VARBYTES:
         {
-            //Atleast with Geneve header which is TLV based,
-            //option length cannot exceed 128 bytes
-            unsigned char bytes[124];
-            uint32_t var_length=0;
-            var_length = p.inferredDataLength;
-            if(var_length > (length - bitOffset/8)) {
-                err = -1;
-                return err;
+            for(uint32_t i=0; i < f.dataLength; i++) {
+                out += (char)f.data[i];
+                out += ' ';
             }
-            memcpy(bytes,data_ptr,var_length);
-            if(shouldLog()) {
-                for(uint32_t i=0; i < var_length; i++) {
-                    ostr << hex << bytes[i] << " ";
+            break;
+        }
+        default:
+        case FLDTYPE_NONE:
+        {
+            break;
+        }
+    }
+}
+
+int PacketDecoderLayerField::decode(const unsigned char *buf, std::size_t length, ParseInfo &p) {
+    const unsigned char *data = buf + byteOffset;
+    uint32_t value = 0;
+    uint32_t dataLength = byteCount;
+    switch(fieldType) {
+        case FLDTYPE_OPTBYTES:
+        {
+            if(p.hasOptBytes == 0) {
+                if(isLength) {
+                    p.inferredLength = 0;
                 }
+                return 0;
             }
-            if(shouldSave(scratchOffset) && (var_length <= 4)) {
-                uint32_t value = 0;
-                unsigned char *ptr = (unsigned char *)&value;
-                for(uint8_t i=0; i<var_length; i++) {
-                    ptr[4-var_length+i] = bytes[i];
+        }
+        /* fall through */
+        case FLDTYPE_BITFIELD:
+        case FLDTYPE_BYTES:
+        {
+            if(byteCount > 4) {
+                break;
+            }
+            value = extract(data);
+            if(isLength) {
+                p.inferredLength = value;
+            }
+            if(isNextKey) {
+                p.nextKey = value;
+            }
+            if(scratchOffset != -1) {
+                p.scratchpad[scratchOffset] = value;
+            }
+            if(metaSeq != 0) {
+                p.meta[metaSeq-1] = value;
+            }
+            break;
+        }
+        case FLDTYPE_VARBYTES:
+        {
+            dataLength = p.inferredDataLength;
+            if(dataLength > (length - byteOffset)) {
+                return -1;
+            }
+            if((scratchOffset != -1) && (dataLength <= 4)) {
+                for(uint32_t i=0; i < dataLength; i++) {
+                    value = (value << 8) | data[i];
                 }
-                value = ntohl(value);
                 p.scratchpad[scratchOffset] = value;
             }
             p.inferredDataLength = 0;
             break;
         }
         default:
-        case FLDTYPE_NONE:
         {
+            //Addresses are formatted from the buffer
             break;
         }
     }
-    if(shouldLog()) {
-        p.formattedFields[outSeq-1] += ostr.str();
+    if(outSeq != 0) {
+        p.parsedFields.push_back(
+            ParsedField{this, value, p.nextLayerTypeId, data, dataLength});
     }
-    if(isTupleField()) {
-        std::string tupleStr = ostr.str();
+    if(tupleSeq != 0) {
+        std::string tupleStr;
+        if(outSeq != 0) {
+            format(p.parsedFields.back(), p.pktDecoder, tupleStr);
+        }
         p.packetTuple.setField((unsigned)(tupleSeq-1), tupleStr);
     }
-    return err;
+    return 0;
 }
 
 int PacketDecoderLayer::decode(const unsigned char *buf, std::size_t length, ParseInfo &p) {
@@ -284,8 +243,7 @@ int PacketDecoderLayer::decode(const unsigned char *buf, std::size_t length, Par
         LOG(ERROR) << "Remaining length is less than header length";
         return -1;
     }
-    p.formattedFields.clear();
-    p.formattedFields.resize(numOutArgs);
+    std::size_t firstField = p.parsedFields.size();
     if(!isOptionLayer()) {
         p.nextLayerTypeId = getNextTypeId();
     }
@@ -329,30 +287,48 @@ int PacketDecoderLayer::decode(const unsigned char *buf, std::size_t length, Par
         }
     }
 
-    boost::format fmtStr;
-    auto sptr = getVariant(p);
-    if(sptr) {
-        sptr->reParse(p);
-        sptr->getFormatString(fmtStr);
-    } else {
-        getFormatString(fmtStr);
-    }
-    for(unsigned i=1; i<=numOutArgs; i++) {
-        fmtStr%p.formattedFields[i-1];
-    }
-    try {
-        p.parsedString += fmtStr.str();
-    } catch(boost::io::too_few_args& exc) {
-        LOG(ERROR)<< exc.what();
+    const boost::format *fmt = &compiledFormat;
+    PacketDecoderLayerVariant *variant = getVariant(p);
+    if(variant) {
+        variant->reParse(p);
+        fmt = &variant->getCompiledFormat();
     }
+    p.parsedLayers.push_back(ParsedLayer{fmt, numOutArgs,
+        (uint32_t)(p.parsedFields.size() - firstField)});
 
     return err;
 }
 
+const std::string &PacketDecoder::formatLog(ParseInfo &p) const {
+    if(!p.parsedString.empty()) {
+        return p.parsedString;
+    }
+    auto field = p.parsedFields.begin();
+    std::vector<std::string> formattedFields;
+    for(const ParsedLayer &layer : p.parsedLayers) {
+        formattedFields.assign(layer.numOutArgs, std::string());
+        for(uint32_t i=0; i < layer.fieldCount; i++, field++) {
+            field->field->format(*field, p.pktDecoder,
+                    formattedFields[field->field->getOutSeq()-1]);
+        }
+        boost::format fmtStr(*layer.format);
+        for(const std::string &formatted : formattedFields) {
+            fmtStr%formatted;
+        }
+        try {
+            p.parsedString += fmtStr.str();
+        } catch(boost::io::too_few_args& exc) {
+            LOG(ERROR)<< exc.what();
+        }
+    }
+    return p.parsedString;
+}
+
 void PacketDecoder::registerLayer(shared_ptr<PacketDecoderLayerVariant>& decoderLayer) {
     if(!decoderLayer) {
         return;
     }
+    decoderLayer->compile();
     variantLayerIdMap.insert(make_pair(decoderLayer->getId(),decoderLayer));
     auto baseLayer = getLayerById(decoderLayer->getTypeId());
     if(baseLayer) {
@@ -366,6 +342,7 @@ void PacketDecoder::registerLayer(shared_ptr<PacketDecoderLayer>& decoderLayer)
     if(!decoderLayer) {
         return;
     }
+    decoderLayer->compile();
     layerTypeMap.insert(make_pair(decoderLayer->getTypeName(),decoderLayer->getTypeId()));
     layerNameMap.insert(make_pair(decoderLayer->getName(),decoderLayer->getId()));
     if(decoderLayer->getNextTypeId() != 0) {
@@ -382,44 +359,56 @@ void PacketDecoder::registerLayer(shared_ptr<PacketDecoderLayer>& decoderLayer)
             << decoderLayer->getTypeId() << "," << decoderLayer->getKey() << ")";
 }
 
+void PacketDecoder::compile() {
+    dispatchTable.clear();
+    for(auto &typeLayers : decoderMapRegistry) {
+        if(typeLayers.first >= dispatchTable.size()) {
+            dispatchTable.resize(typeLayers.first + 1);
+        }
+        LayerDispatch &d = dispatchTable[typeLayers.first];
+        for(auto &keyLayer : typeLayers.second) {
+            if(keyLayer.first < DIRECT_KEYS) {
+                d.direct.resize(DIRECT_KEYS);
+                d.direct[keyLayer.first] = keyLayer.second.get();
+            } else {
+                d.sorted.push_back(
+                    make_pair(keyLayer.first, keyLayer.second.get()));
+            }
+        }
+        sort(d.sorted.begin(), d.sorted.end(),
+             [](const pair<uint32_t, PacketDecoderLayer *> &a,
+                const pair<uint32_t, PacketDecoderLayer *> &b) {
+                 return a.first < b.first;
+             });
+    }
+    baseLayer = getLayerById(baseLayerId).get();
+}
+
 int PacketDecoder::decode(const unsigned char *buf, std::size_t length, ParseInfo &p) {
-    uint32_t layerId = baseLayerId;
-    int ret=0;
-    bool failed = false;
-    shared_ptr<PacketDecoderLayer> pktDecoderLayer = getLayerById(layerId);
+    PacketDecoderLayer *pktDecoderLayer = baseLayer;
+    if(!pktDecoderLayer) {
+        return -1;
+    }
     while(length !=0) {
-        if(!pktDecoderLayer) {
-            failed = true;
-            break;
-        }
-        ret = pktDecoderLayer->decode(buf, length, p);
+        int ret = pktDecoderLayer->decode(buf, length, p);
         if(ret) {
-            failed = true;
-            break;
+            return ret;
         }
         if(p.pendingOptionLength) {
-            if(!getLayerByTypeKey(p.optionLayerTypeId, 0, pktDecoderLayer)){
-               break;
-            }
+            pktDecoderLayer = findLayer(p.optionLayerTypeId, 0);
         } else {
             if(p.nextLayerTypeId == 0) {
                 break;
             }
-            if(!getLayerByTypeKey(p.nextLayerTypeId, p.nextKey, pktDecoderLayer)){
-               break;
-            }
+            pktDecoderLayer = findLayer(p.nextLayerTypeId, p.nextKey);
+        }
+        if(!pktDecoderLayer) {
+            break;
         }
         length -= p.parsedLength;
         buf += p.parsedLength;
         p.parsedLength=0;
     }
-    if(failed) {
-        if(ret != 0) {
-            return ret;
-        } else {
-            return -1;
-        }
-    }
     return 0;
 }
 
@@ -468,9 +457,10 @@ int PacketDecoder::configure() {
     shared_ptr<PacketDecoderLayerVariant>
         sptrGeneveOptDeniedPoliciesLayerVariant(new GeneveOptDeniedPoliciesLayerVariant());
     sptrGeneveOptDeniedPoliciesLayerVariant->configure();
-    registerLayer(sptrGeneveOptDeniedPoliciesLayerVariant); 
+    registerLayer(sptrGeneveOptDeniedPoliciesLayerVariant);
     /*Set the base layer id*/
     baseLayerId = sptrGeneve->getId();
+    compile();
     return 0;
 }
 
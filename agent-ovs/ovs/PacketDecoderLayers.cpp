@@ -112,16 +112,11 @@ void GeneveOptLayer::getFormatString(boost::format &fmtStr) {
     fmtStr = boost::format("");
 }
 
-std::shared_ptr<PacketDecoderLayerVariant>
-    GeneveOptLayer::getVariant(ParseInfo &p) {
+PacketDecoderLayerVariant *GeneveOptLayer::getVariant(ParseInfo &p) {
     std::size_t hash = 0;
     boost::hash_combine(hash,p.scratchpad[1]);
     boost::hash_combine(hash,p.scratchpad[2]);
-    auto it = layerVariants.find(hash);
-    if(it != layerVariants.end()) {
-        return it->second;
-    }
-    return nullptr;
+    return findVariant(hash);
 }
 
 int GeneveOptTableIdLayerVariant::configure() {
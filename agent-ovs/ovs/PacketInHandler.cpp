@@ -20,6 +20,7 @@
 #include "Packets.h"
 #include "ActionBuilder.h"
 #include <opflexagent/logging.h>
+#include <opflex/util/ThreadSettings.h>
 #include "dhcp.h"
 #include "udp.h"
 #include "eth.h"
@@ -58,7 +59,22 @@ PacketInHandler::PacketInHandler(Agent& agent_,
       dnsManager(dnsManager_),
       intPortMapper(NULL), accessPortMapper(NULL),
       intFlowReader(NULL),
-      intSwConnection(NULL), accSwConnection(NULL) {}
+      intSwConnection(NULL), accSwConnection(NULL),
+      queueSize(1024), running(false), stopping(false) {}
+
+PacketInHandler::~PacketInHandler() {
+    // packet-ins that arrived while stopping
+    for (PacketInQueue& q : queues) {
+        for (auto& p : q.packets)
+            ofpbuf_delete(p.second);
+    }
+}
+
+void PacketInHandler::setQueueLimits(size_t queueSize_, uint64_t rateLimit) {
+    queueSize = std::max<size_t>(queueSize_, 1);
+    for (PacketInQueue& q : queues)
+        q.limiter.setRate(rateLimit);
+}
 
 void PacketInHandler::registerConnection(SwitchConnection* intConnection,
                                          SwitchConnection* accessConnection) {
@@ -73,6 +89,16 @@ void PacketInHandler::setPortMapper(PortMapper* intMapper,
 }
 
 void PacketInHandler::start() {
+    if (!running) {
+        stopping = false;
+        for (size_t i = 0; i <= PKTIN_TYPE_MAX; ++i) {
+            PacketInQueue& q = queues[i];
+            q.worker = opflex::util::startThread(
+                "pktin_" + std::to_string(i), [this, &q]() { runQueue(q); });
+        }
+        running = true;
+    }
+
     if (intSwConnection)
         intSwConnection->RegisterMessageHandler(OFPTYPE_PACKET_IN, this);
     if (accSwConnection)
@@ -84,6 +110,59 @@ void PacketInHandler::stop() {
         intSwConnection->UnregisterMessageHandler(OFPTYPE_PACKET_IN, this);
     if (accSwConnection)
         accSwConnection->UnregisterMessageHandler(OFPTYPE_PACKET_IN, this);
+
+    if (!running)
+        return;
+    running = false;
+    stopping = true;
+    for (PacketInQueue& q : queues) {
+        {
+            std::lock_guard<std::mutex> guard(q.mtx);
+        }
+        q.cond.notify_all();
+        q.worker.join();
+    }
+}
+
+void PacketInHandler::runQueue(PacketInQueue& q) {
+    std::unique_lock<std::mutex> lock(q.mtx);
+    while (true) {
+        q.cond.wait(lock, [this, &q]() {
+                return stopping || !q.packets.empty();
+            });
+        if (stopping)
+            break;
+
+        std::pair<SwitchConnection*, ofpbuf*> p = q.packets.front();
+        q.packets.pop_front();
+        lock.unlock();
+
+        const struct ofp_header *oh = (ofp_header *)p.second->data;
+        struct ofputil_packet_in pi;
+        uint32_t pi_buffer_id;
+        if (!ofputil_decode_packet_in(oh, false, NULL, NULL,
+                                      &pi, NULL, &pi_buffer_id, NULL))
+            handlePacketIn(p.first, pi);
+        ofpbuf_delete(p.second);
+
+        lock.lock();
+    }
+    for (auto& p : q.packets)
+        ofpbuf_delete(p.second);
+    q.packets.clear();
+}
+
+static const char* PKTIN_TYPE_NAMES[] =
+    {"neighbor discovery", "DHCP", "virtual IP", "ICMP", "DNS"};
+
+void PacketInHandler::dropPacketIn(PacketInType type, const char* reason) {
+    uint64_t dropped = ++queues[type].dropped;
+    // log the first drops of a storm and fewer and fewer after that
+    if ((dropped & (dropped - 1)) == 0) {
+        LOG(WARNING) << "Dropped " << dropped << " "
+                     << PKTIN_TYPE_NAMES[type] << " packet-ins: "
+                     << reason;
+    }
 }
 
 typedef std::function<void (ActionBuilder&)> output_act_t;
@@ -170,13 +249,15 @@ static void send_packet_out(Agent& agent,
         unordered_set<string> eps;
         agent.getEndpointManager().getEndpointsByIface(iface, eps);
         if (eps.size() == 0) {
-            LOG(WARNING) << "No endpoint found for output packet"
-                         << " on " << iface;
+            LOG_RATE_LIMITED_DEFAULT(WARNING)
+                << "No endpoint found for output packet"
+                << " on " << iface;
             return;
         }
         if (eps.size() > 1)
-            LOG(WARNING) << "Multiple possible endpoints for output packet "
-                         << " on " << iface;
+            LOG_RATE_LIMITED_DEFAULT(WARNING)
+                << "Multiple possible endpoints for output packet "
+                << " on " << iface;
 
         ep = agent.getEndpointManager().getEndpoint(*eps.begin());
         if (ep && ep->getAccessInterface() && ep->getAccessUplinkInterface()) {
@@ -204,7 +285,8 @@ static void send_packet_out(Agent& agent,
             }
         }
     } catch (std::out_of_range&) {
-        LOG(WARNING) << "Port " << out_port << " not found in int bridge";
+        LOG_RATE_LIMITED_DEFAULT(WARNING)
+            << "Port " << out_port << " not found in int bridge";
     }
 
     send_packet_out(conn, b, proto, in_port, out_port, outActions);
@@ -310,6 +392,7 @@ static void handleDHCPv4PktIn(Agent& agent,
                               PortMapper* accPortMapper,
                               SwitchConnection* intConn,
                               SwitchConnection* accConn,
+                              packets::Dhcpv4ReplyCache& dhcpv4Replies,
                               const shared_ptr<const Endpoint>& ep,
                               const std::string &iface,
                               struct ofputil_packet_in& pi,
@@ -319,10 +402,11 @@ static void handleDHCPv4PktIn(Agent& agent,
     using namespace dhcp;
     using namespace udp;
 
-    const optional<Endpoint::DHCPv4Config>& v4c = ep->getDHCPv4Config();
+    const shared_ptr<const Endpoint::DHCPv4Config>& v4c =
+        ep->getDHCPv4Config();
     if (!v4c) return;
 
-    const optional<string>& dhcpIpStr = v4c.get().getIpAddress();
+    const optional<string>& dhcpIpStr = v4c->getIpAddress();
     if (!dhcpIpStr) return;
 
     boost::system::error_code ec;
@@ -380,7 +464,7 @@ static void handleDHCPv4PktIn(Agent& agent,
 
     MAC srcMac(flow.dl_src.ea);
 
-    uint8_t prefixLen = v4c.get().getPrefixLen().get_value_or(32);
+    uint8_t prefixLen = v4c->getPrefixLen().get_value_or(32);
     uint8_t reply_type = message_type::NAK;
 
     switch(message_type) {
@@ -390,9 +474,10 @@ static void handleDHCPv4PktIn(Agent& agent,
                        << requested_ip << " from " << srcMac;
             reply_type = message_type::ACK;
         } else {
-            LOG(WARNING) << "Rejecting DHCP REQUEST for IP "
-                         << requested_ip << " from " << srcMac
-                         << " on interface \"" << iface << "\"";
+            LOG_RATE_LIMITED_DEFAULT(WARNING)
+                << "Rejecting DHCP REQUEST for IP "
+                << requested_ip << " from " << srcMac
+                << " on interface \"" << iface << "\"";
         }
         break;
     case message_type::DISCOVER:
@@ -406,25 +491,19 @@ static void handleDHCPv4PktIn(Agent& agent,
     }
 
     uint8_t serverMac[6];
-    if (v4c.get().getServerMac()) {
-        v4c.get().getServerMac()->toUIntArray(serverMac);
+    if (v4c->getServerMac()) {
+        v4c->getServerMac()->toUIntArray(serverMac);
     } else {
         memcpy(serverMac, intFlowManager.getDHCPMacAddr(), sizeof(serverMac));
     }
 
-    OfpBuf b(packets::compose_dhcpv4_reply(reply_type,
-                                           dhcp_pkt->xid,
-                                           serverMac,
-                                           flow.dl_src.ea,
-                                           dhcpIp.to_ulong(),
-                                           prefixLen,
-                                           v4c.get().getServerIp(),
-                                           v4c.get().getRouters(),
-                                           v4c.get().getDnsServers(),
-                                           v4c.get().getDomain(),
-                                           v4c.get().getStaticRoutes(),
-                                           v4c.get().getInterfaceMtu(),
-                                           v4c.get().getLeaseTime()));
+    OfpBuf b(dhcpv4Replies.compose(ep,
+                                   reply_type,
+                                   dhcp_pkt->xid,
+                                   serverMac,
+                                   flow.dl_src.ea,
+                                   dhcpIp.to_ulong(),
+                                   prefixLen));
 
     send_packet_out(agent, intConn, accConn, intFlowManager,
                     intPortMapper, accPortMapper, URI::ROOT, b,
@@ -446,17 +525,14 @@ static void handleDHCPv6PktIn(Agent& agent,
     using namespace dhcp6;
     using namespace udp;
 
-    const optional<Endpoint::DHCPv6Config>& v6c = ep->getDHCPv6Config();
+    const shared_ptr<const Endpoint::DHCPv6Config>& v6c =
+        ep->getDHCPv6Config();
     if (!v6c) return;
 
-    const unordered_set<string>& addresses = ep->getIPs();
-
-    boost::system::error_code ec;
     vector<address_v6> v6addresses;
-    for (const string& addrStr : addresses) {
-        address_v6 addr_v6 = address_v6::from_string(addrStr, ec);
-        if (ec) continue;
-        v6addresses.push_back(addr_v6);
+    for (const network::cidr_t& cidr : ep->getIPCidrs()) {
+        if (cidr.first.is_v6())
+            v6addresses.push_back(cidr.first.to_v6());
     }
 
     size_t l4_size = dpp_l4_size(pkt);
@@ -550,14 +626,14 @@ static void handleDHCPv6PktIn(Agent& agent,
                                            client_id_len,
                                            iaid,
                                            v6addresses,
-                                           v6c.get().getDnsServers(),
-                                           v6c.get().getSearchList(),
+                                           v6c->getDnsServers(),
+                                           v6c->getSearchList(),
                                            temporary,
                                            rapid_commit,
-                                           v6c.get().getT1(),
-                                           v6c.get().getT2(),
-                                           v6c.get().getPreferredLifetime(),
-                                           v6c.get().getValidLifetime()));
+                                           v6c->getT1(),
+                                           v6c->getT2(),
+                                           v6c->getPreferredLifetime(),
+                                           v6c->getValidLifetime()));
 
     send_packet_out(agent, intConn, accConn, intFlowManager,
                     intPortMapper, accPortMapper, URI::ROOT, b, proto,
@@ -565,23 +641,20 @@ static void handleDHCPv6PktIn(Agent& agent,
                     pi.flow_metadata.flow.in_port.ofp_port);
 }
 
-typedef std::function<bool (const Endpoint&)> ep_pred;
 /*
- * Find EPs on an interface that match a predicate
+ * Find the EPs on an interface that use a MAC address
  */
-static unordered_set<ep_ptr> findEpsForIface(EndpointManager& epMgr,
-                                             std::string iface,
-                                             ep_pred pred) {
+static unordered_set<ep_ptr> findEpsForIfaceMac(EndpointManager& epMgr,
+                                                const std::string& iface,
+                                                const MAC& mac) {
     unordered_set<ep_ptr> eps;
     unordered_set<string> try_uuids;
-    epMgr.getEndpointsByIface(iface, try_uuids);
+    epMgr.getEndpointsByIfaceMac(iface, mac, try_uuids);
 
     for (const string& epUuid : try_uuids) {
         ep_ptr try_ep = epMgr.getEndpoint(epUuid);
-        if (!try_ep) continue;
-        if (pred(*try_ep)) {
+        if (try_ep)
             eps.insert(try_ep);
-        }
     }
 
     return eps;
@@ -596,6 +669,7 @@ static unordered_set<ep_ptr> findEpsForIface(EndpointManager& epMgr,
  * @param intFlowManager the flow manager
  * @param intConn the openflow switch connection
  * @param accConn the openflow switch connection
+ * @param dhcpv4Replies the DHCPv4 reply templates
  * @param pi the packet-in
  * @param proto an openflow proto object
  * @param pkt the packet from the packet-in
@@ -609,6 +683,7 @@ static void handleDHCPPktIn(bool v4,
                             PortMapper* accPortMapper,
                             SwitchConnection* intConn,
                             SwitchConnection* accConn,
+                            packets::Dhcpv4ReplyCache& dhcpv4Replies,
                             struct ofputil_packet_in& pi,
                             ofputil_protocol& proto,
                             struct dp_packet* pkt,
@@ -625,39 +700,25 @@ static void handleDHCPPktIn(bool v4,
         return;
     }
 
-    unordered_set<ep_ptr> eps =
-        findEpsForIface(epMgr, iface,
-                       [&srcMac](const Endpoint& ep) {
-                           const optional<MAC>& epMac = ep.getMAC();
-                           if (epMac && srcMac == epMac.get()) {
-                               return true;
-                           }
-                           const Endpoint::virt_ip_set& virtIps =
-                               ep.getVirtualIPs();
-
-                           for (const Endpoint::virt_ip_t& virt_ip : virtIps) {
-                               if (virt_ip.first == srcMac) {
-                                   return true;
-                               }
-                           }
-                           return false;
-                       });
+    unordered_set<ep_ptr> eps = findEpsForIfaceMac(epMgr, iface, srcMac);
 
     if (eps.size() == 0) {
-        LOG(WARNING) << "No endpoint found for DHCP request from "
-                     << srcMac << " on " << iface;
+        LOG_RATE_LIMITED_DEFAULT(WARNING)
+            << "No endpoint found for DHCP request from "
+            << srcMac << " on " << iface;
         return;
     }
     if (eps.size() > 1)
-        LOG(WARNING) << "Multiple possible endpoints for DHCP request from "
-                     << srcMac << " on " << iface;
+        LOG_RATE_LIMITED_DEFAULT(WARNING)
+            << "Multiple possible endpoints for DHCP request from "
+            << srcMac << " on " << iface;
 
     const shared_ptr<const Endpoint> ep = *eps.begin();
 
     if (v4)
         handleDHCPv4PktIn(agent, intFlowManager,
                           intPortMapper, accPortMapper, intConn, accConn,
-                          ep, iface, pi, proto, pkt, flow);
+                          dhcpv4Replies, ep, iface, pi, proto, pkt, flow);
     else
         handleDHCPv6PktIn(agent, intFlowManager,
                           intPortMapper, accPortMapper, intConn, accConn,
@@ -699,26 +760,15 @@ static void handleVIPPktIn(bool v4,
         return;
     }
 
-    unordered_set<ep_ptr> eps =
-        findEpsForIface(epMgr, iface,
-                        [&srcMac, &srcIp](const Endpoint& ep) {
-                            for (const Endpoint::virt_ip_t& vip :
-                                     ep.getVirtualIPs()) {
-                                network::cidr_t cidr;
-                                if (network::cidr_from_string(vip.second, cidr)
-                                    && srcMac == vip.first
-                                    && network::cidr_contains(cidr, srcIp)) {
-                                    return true;
-                                }
-                            }
-                            return false;
-                        });
-
     unordered_set<string> uuids;
-    std::for_each(eps.begin(), eps.end(),
-                  [&uuids](const ep_ptr& ep) {
-                      uuids.insert(ep->getUUID());
-                  });
+    epMgr.getEndpointsByVirtualIp(srcMac, srcIp, uuids);
+    for (auto it = uuids.begin(); it != uuids.end(); ) {
+        ep_ptr ep = epMgr.getEndpoint(*it);
+        if (ep && ep->getInterfaceName() == iface)
+            ++it;
+        else
+            it = uuids.erase(it);
+    }
 
     if (uuids.size() > 0) {
         LOG(DEBUG) << "Virtual IP ownership advertised for ("
@@ -902,7 +952,32 @@ void PacketInHandler::handleDNSPktIn(struct ofputil_packet_in& pi,
 }
 
 /**
- * Dispatch packet-in messages to the appropriate handlers
+ * Get the kind of a packet-in from its cookie
+ *
+ * @return the kind, or -1 if no handler takes the packet-in
+ */
+static int getPacketInType(uint64_t cookie) {
+    if (cookie == flow::cookie::NEIGH_DISC)
+        return PacketInHandler::PKTIN_NEIGH_DISC;
+    else if ((cookie == flow::cookie::DHCP_V4) ||
+             (cookie == flow::cookie::DHCP_V6))
+        return PacketInHandler::PKTIN_DHCP;
+    else if ((cookie == flow::cookie::VIRTUAL_IP_V4) ||
+             (cookie == flow::cookie::VIRTUAL_IP_V6))
+        return PacketInHandler::PKTIN_VIRTUAL_IP;
+    else if ((cookie == flow::cookie::ICMP_ERROR_V4) ||
+             (cookie == flow::cookie::ICMP_ECHO_V4) ||
+             (cookie == flow::cookie::ICMP_ECHO_V6))
+        return PacketInHandler::PKTIN_ICMP;
+    else if ((cookie == flow::cookie::DNS_RESPONSE_V4) ||
+             (cookie == flow::cookie::DNS_RESPONSE_V6))
+        return PacketInHandler::PKTIN_DNS;
+    return -1;
+}
+
+/**
+ * Queue packet-in messages for the handler of their kind, or
+ * handle them right away before the workers are started
  */
 void PacketInHandler::Handle(SwitchConnection* conn,
                              int msgType, ofpbuf *msg,
@@ -917,13 +992,45 @@ void PacketInHandler::Handle(SwitchConnection* conn,
                                                &pi, NULL,
                                                &pi_buffer_id, NULL);
     if (err) {
-        LOG(ERROR) << "Failed to decode packet-in: " << ovs_strerror(err);
+        LOG_RATE_LIMITED_DEFAULT(ERROR)
+            << "Failed to decode packet-in: " << ovs_strerror(err);
         return;
     }
 
     if (pi.reason != OFPR_ACTION)
         return;
 
+    int type = getPacketInType(pi.cookie);
+    if (type < 0)
+        return;
+
+    if (!running) {
+        handlePacketIn(conn, pi);
+        return;
+    }
+
+    PacketInQueue& q = queues[type];
+    if (!q.limiter.event()) {
+        dropPacketIn((PacketInType)type, "over the rate limit");
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(q.mtx);
+        if (q.packets.size() >= queueSize) {
+            dropPacketIn((PacketInType)type, "queue full");
+            return;
+        }
+        // the message is freed once this returns
+        q.packets.emplace_back(conn, ofpbuf_clone(msg));
+    }
+    q.cond.notify_one();
+}
+
+/**
+ * Dispatch packet-in messages to the appropriate handlers
+ */
+void PacketInHandler::handlePacketIn(SwitchConnection* conn,
+                                     struct ofputil_packet_in& pi) {
     DpPacketP pkt;
     struct flow flow;
 
@@ -941,11 +1048,12 @@ void PacketInHandler::Handle(SwitchConnection* conn,
     else if (pi.cookie == flow::cookie::DHCP_V4)
         handleDHCPPktIn(true, agent, intFlowManager, intPortMapper,
                         accessPortMapper, conn, accSwConnection,
-                        pi, proto, pkt.get(), flow);
+                        dhcpv4Replies, pi, proto, pkt.get(), flow);
     else if (pi.cookie == flow::cookie::DHCP_V6)
         handleDHCPPktIn(false, agent, intFlowManager,
                         intPortMapper, accessPortMapper,
-                        conn, accSwConnection, pi, proto, pkt.get(), flow);
+                        conn, accSwConnection, dhcpv4Replies,
+                        pi, proto, pkt.get(), flow);
     else if (pi.cookie == flow::cookie::VIRTUAL_IP_V4)
         handleVIPPktIn(true, agent, *intPortMapper, pi, flow);
     else if (pi.cookie == flow::cookie::VIRTUAL_IP_V6)
@@ -21,9 +21,32 @@
 #include <atomic>
 #include <thread>
 #include <chrono>
+#ifdef __linux__
+#include <sys/socket.h>
+#endif
 
 namespace opflexagent {
 
+void LocalClient::serializeEvents() {
+    StringBuffer buffer;
+    Writer<StringBuffer> writer(buffer);
+    unsigned event_count = 0;
+    PacketTuple p;
+    writer.StartArray();
+    while((event_count < maxEventsPerBuffer) &&
+          (buffer.GetSize() < PACKET_EVENT_BUFFER_SIZE - maxEventSize) &&
+          pktLogger.eventRing.pop(p)) {
+        p.serialize(writer);
+        event_count++;
+    }
+    writer.EndArray();
+    if(event_count == 0) {
+        return;
+    }
+    pendingDataLen = (buffer.GetSize()>PACKET_EVENT_BUFFER_SIZE)? PACKET_EVENT_BUFFER_SIZE: buffer.GetSize();
+    memcpy(send_buffer.data(), buffer.GetString(), pendingDataLen);
+}
+
 void LocalClient::run() {
     boost::asio::local::stream_protocol::endpoint invalidEndpoint("");
     if(remoteEndpoint==invalidEndpoint) {
@@ -51,27 +74,13 @@ void LocalClient::run() {
                 continue;
             }
         }
-        {
+        if(pendingDataLen == 0) {
             std::unique_lock<std::mutex> lk(pktLogger.qMutex);
             pktLogger.cond.wait_for(lk, std::chrono::seconds(1),
-                    [this](){return !this->pktLogger.packetTupleQ.empty();});
-            if(!pktLogger.packetTupleQ.empty()) {
-                StringBuffer buffer;
-                Writer<StringBuffer> writer(buffer);
-                unsigned event_count = 0;
-                writer.StartArray();
-                while((event_count < maxEventsPerBuffer) &&
-                        !pktLogger.packetTupleQ.empty()) {
-                    PacketTuple p = pktLogger.packetTupleQ.front();
-                    p.serialize(writer);
-                    pktLogger.packetTupleQ.pop();
-                    event_count++;
-                }
-                writer.EndArray();
-                pendingDataLen = (buffer.GetSize()>PACKET_EVENT_BUFFER_SIZE)? PACKET_EVENT_BUFFER_SIZE: buffer.GetSize();
-                memcpy(send_buffer.data(), buffer.GetString(),
-                        pendingDataLen);
-            }
+                    [this](){return !this->pktLogger.eventRing.empty();});
+        }
+        if(pendingDataLen == 0) {
+            serializeEvents();
         }
         if(pendingDataLen>0) {
             try {
@@ -142,14 +151,39 @@ void PacketLogHandler::stopExporter()
     }
 }
 
-void UdpServer::handleReceive(const boost::system::error_code& error,
-      std::size_t bytes_transferred) {
+void UdpServer::receiveBatch() {
+#ifdef __linux__
+    struct mmsghdr msgs[RECV_BATCH_SIZE];
+    struct iovec iovecs[RECV_BATCH_SIZE];
+    memset(msgs, 0, sizeof(msgs));
+    for(unsigned i = 0; i < RECV_BATCH_SIZE; i++) {
+        iovecs[i].iov_base = recv_buffers[i].data();
+        iovecs[i].iov_len = PACKET_CAPTURE_BUFFER_SIZE;
+        msgs[i].msg_hdr.msg_iov = &iovecs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    int count = recvmmsg(serverSocket.native_handle(), msgs,
+                         RECV_BATCH_SIZE, MSG_DONTWAIT, NULL);
+    for(int i = 0; i < count; i++) {
+        /* Truncated packets are still parsed */
+        this->pktLogger.parseLog(recv_buffers[i].data(), msgs[i].msg_len);
+    }
+#else
+    for(unsigned i = 0; i < RECV_BATCH_SIZE; i++) {
+        boost::system::error_code ec;
+        std::size_t length =
+            serverSocket.receive(boost::asio::buffer(recv_buffers[i]), 0, ec);
+        if(ec && ec != boost::asio::error::message_size) {
+            break;
+        }
+        this->pktLogger.parseLog(recv_buffers[i].data(), length);
+    }
+#endif
+}
 
-    if (!error || error == boost::asio::error::message_size)
-    {
-        uint32_t length = (bytes_transferred > PACKET_CAPTURE_BUFFER_SIZE) ?
-            PACKET_CAPTURE_BUFFER_SIZE: bytes_transferred;
-        this->pktLogger.parseLog(recv_buffer.data(), length);
+void UdpServer::handleReceive(const boost::system::error_code& error) {
+    if (!error) {
+        receiveBatch();
     }
     if(!stopped) {
         startReceive();
@@ -216,7 +250,15 @@ void PacketLogHandler::pruneLog(ParseInfo &p) {
     { 
         std::lock_guard<std::mutex> lk(pruneMutex);
         for( auto &pruneSpec : userPruneSpec) {
-            if(pruneSpec.second->compareTuple(p.packetTuple,*p.pktDecoder)) {
+            PacketFilterSpec &spec = *pruneSpec.second;
+            if(spec.compareTuple(p.packetTuple,*p.pktDecoder)) {
+                /* A sampled filter lets one of every sampleInterval
+                 * matching packets through */
+                if((spec.sampleInterval != 0) &&
+                   ((++spec.sampleCount % spec.sampleInterval) == 0)) {
+                    break;
+                }
+                prunedEvents++;
                 p.pruneLog = true;
                 return;
             }
@@ -231,6 +273,15 @@ void PacketLogHandler::parseLog(unsigned char *buf , std::size_t length) {
 /*Typical length of Packet is TCP ACK 40 Bytes*/
 #define PACKET_DUMP_LEN   50
 #define PACKET_DUMP_REQUIRED_LEN 232
+    if(throttleActive) {
+        if(eventRing.size() < eventRing.capacity()/2) {
+            LOG(DEBUG) << "Resuming packet events";
+            throttleActive = false;
+        } else if((++throttleCount % EVENT_SAMPLE_INTERVAL) != 0) {
+            skippedEvents++;
+            return;
+        }
+    }
     ParseInfo p(&pktDecoder);
     int ret = pktDecoder.decode(buf, length, p);
     if(ret) {
@@ -255,26 +306,26 @@ void PacketLogHandler::parseLog(unsigned char *buf , std::size_t length) {
         std::string dropReason;
         bool isPermit = getDropReason(p, dropReason);
         p.packetTuple.setField(0, dropReason);
-        LOG(INFO)<< dropReason << " " << p.parsedString;
+        LOG(INFO)<< dropReason << " " << pktDecoder.formatLog(p);
         if(!packetEventNotifSock.empty() && !isPermit )
         {
-            {
-                std::lock_guard<std::mutex> lk(qMutex);
-                if(packetTupleQ.size() < maxOutstandingEvents) {
-                    if(throttleActive) {
-                        LOG(DEBUG) << "Queueing packet events";
-                        throttleActive = false;
-                    }
-                    packetTupleQ.push(p.packetTuple);
-                    if(packetTupleQ.size()  == maxOutstandingEvents) {
-                        LOG(DEBUG) << "Max Event queue size ("
-                                   << maxOutstandingEvents
-                                   << ") throttling packet events";
-                        throttleActive = true;
+            bool wasEmpty = false;
+            if(eventRing.push(std::move(p.packetTuple), &wasEmpty)) {
+                if(wasEmpty) {
+                    {
+                        std::lock_guard<std::mutex> lk(qMutex);
                     }
+                    cond.notify_one();
+                }
+            } else {
+                droppedEvents++;
+                if(!throttleActive) {
+                    LOG(DEBUG) << "Max Event queue size ("
+                               << eventRing.capacity()
+                               << ") sampling packet events";
+                    throttleActive = true;
                 }
             }
-            cond.notify_one();
         }
     }
 }
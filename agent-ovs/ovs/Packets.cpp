@@ -70,6 +70,14 @@ uint16_t chksum_finalize(uint32_t chksum) {
     return ~chksum;
 }
 
+uint16_t chksum_update(uint16_t chksum, uint16_t oldVal, uint16_t newVal) {
+    // HC' = ~(~HC + ~m + m')
+    uint32_t sum = (uint16_t)~chksum;
+    sum += (uint16_t)~oldVal;
+    sum += newVal;
+    return chksum_finalize(sum);
+}
+
 struct nd_opt_def_route_info {
     uint8_t  nd_opt_ri_type;
     uint8_t  nd_opt_ri_len;
@@ -1030,5 +1038,126 @@ OfpBuf compose_arp(uint16_t op,
     return b;
 }
 
+Dhcpv4ReplyTemplate::Dhcpv4ReplyTemplate(const uint8_t* srcMac,
+                                         const uint8_t* clientMac,
+                                         uint32_t clientIp,
+                                         uint8_t prefixLen,
+                                         const Endpoint::DHCPv4Config& v4c) {
+    OfpBuf b(compose_dhcpv4_reply(0, 0, srcMac, clientMac,
+                                  clientIp, prefixLen,
+                                  v4c.getServerIp(),
+                                  v4c.getRouters(),
+                                  v4c.getDnsServers(),
+                                  v4c.getDomain(),
+                                  v4c.getStaticRoutes(),
+                                  v4c.getInterfaceMtu(),
+                                  v4c.getLeaseTime()));
+    const uint8_t* data = (const uint8_t*)b.data();
+    packet.assign(data, data + b.size());
+}
+
+/*
+ * Overwrite bytes of the UDP segment starting at udp, updating the
+ * UDP checksum word by word.  Words are counted from the start of the
+ * segment, as they are when the checksum is computed.
+ */
+static void patch_udp(uint8_t* udp, size_t offset,
+                      const void* val, size_t len) {
+    using namespace udp;
+
+    uint16_t chksum;
+    memcpy(&chksum, udp + offsetof(struct udp_hdr, chksum), sizeof(chksum));
+    size_t end = offset + len;
+    for (size_t word = offset & ~(size_t)1; word < end; word += 2) {
+        uint16_t oldVal, newVal;
+        memcpy(&oldVal, udp + word, sizeof(oldVal));
+        for (size_t i = word; i < word + 2; ++i) {
+            if (i >= offset && i < end)
+                udp[i] = ((const uint8_t*)val)[i - offset];
+        }
+        memcpy(&newVal, udp + word, sizeof(newVal));
+        chksum = chksum_update(chksum, oldVal, newVal);
+    }
+    memcpy(udp + offsetof(struct udp_hdr, chksum), &chksum, sizeof(chksum));
+}
+
+OfpBuf Dhcpv4ReplyTemplate::build(uint8_t message_type, uint32_t xid) const {
+    using namespace dhcp;
+    using namespace udp;
+
+    OfpBuf b(packet.size());
+    b.clear();
+    b.reserve(packet.size());
+    uint8_t* buf = (uint8_t*)b.push_zeros(packet.size());
+    memcpy(buf, packet.data(), packet.size());
+
+    uint8_t* udp = buf + sizeof(eth::eth_header) + sizeof(struct iphdr);
+    size_t dhcpOff = sizeof(struct udp_hdr);
+    patch_udp(udp, dhcpOff + offsetof(struct dhcp_hdr, xid),
+              &xid, sizeof(xid));
+    // the value of the message type option, which comes first
+    patch_udp(udp, dhcpOff + sizeof(struct dhcp_hdr) + 2,
+              &message_type, sizeof(message_type));
+
+    return b;
+}
+
+Dhcpv4ReplyCache::Dhcpv4ReplyCache(size_t maxEntries_)
+    : maxEntries(maxEntries_) {}
+
+OfpBuf Dhcpv4ReplyCache::compose(const shared_ptr<const Endpoint>& ep,
+                                 uint8_t message_type,
+                                 uint32_t xid,
+                                 const uint8_t* srcMac,
+                                 const uint8_t* clientMac,
+                                 uint32_t clientIp,
+                                 uint8_t prefixLen) {
+    shared_ptr<const Dhcpv4ReplyTemplate> reply;
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        auto it = entries.find(ep->getUUID());
+        if (it != entries.end()) {
+            const Entry& e = it->second;
+            if (e.ep.lock() == ep &&
+                memcmp(e.srcMac, srcMac, sizeof(e.srcMac)) == 0 &&
+                memcmp(e.clientMac, clientMac, sizeof(e.clientMac)) == 0 &&
+                e.clientIp == clientIp &&
+                e.prefixLen == prefixLen)
+                reply = e.reply;
+        }
+    }
+
+    if (!reply) {
+        // compose outside the lock; a concurrent request for the
+        // same endpoint may compose it too
+        reply = std::make_shared<const Dhcpv4ReplyTemplate>
+            (srcMac, clientMac, clientIp, prefixLen, *ep->getDHCPv4Config());
+
+        std::lock_guard<std::mutex> guard(mtx);
+        if (entries.size() >= maxEntries &&
+            entries.find(ep->getUUID()) == entries.end())
+            entries.clear();
+        Entry& e = entries[ep->getUUID()];
+        e.ep = ep;
+        memcpy(e.srcMac, srcMac, sizeof(e.srcMac));
+        memcpy(e.clientMac, clientMac, sizeof(e.clientMac));
+        e.clientIp = clientIp;
+        e.prefixLen = prefixLen;
+        e.reply = reply;
+    }
+
+    return reply->build(message_type, xid);
+}
+
+size_t Dhcpv4ReplyCache::size() const {
+    std::lock_guard<std::mutex> guard(mtx);
+    return entries.size();
+}
+
+void Dhcpv4ReplyCache::clear() {
+    std::lock_guard<std::mutex> guard(mtx);
+    entries.clear();
+}
+
 } /* namespace packets */
 } /* namespace opflexagent */
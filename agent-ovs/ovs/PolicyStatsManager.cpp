@@ -28,6 +28,8 @@ extern "C" {
 #include <opflex/modb/URI.h>
 #include <opflex/modb/Mutator.h>
 
+#include <vector>
+
 namespace opflexagent {
 
 using std::string;
@@ -68,12 +70,14 @@ void PolicyStatsManager::start(bool register_listener,
         connection->RegisterMessageHandler(OFPTYPE_FLOW_REMOVED, this);
         {
             std::lock_guard<std::mutex> lock(timer_mutex);
-            if (io_service)
-                timer.reset(new deadline_timer(io_service.get(),
-                                               milliseconds(timer_interval)));
-            else
-                timer.reset(new deadline_timer(agent->getAgentIOService(),
-                                               milliseconds(timer_interval)));
+            boost::asio::io_service& io =
+                io_service ? io_service.get() : agent->getStatsIOService();
+            // stagger the first poll so that the stats managers do
+            // not all poll the switch at once
+            long delay = agent->getStatsPollScheduler()
+                .firstDelay(timer_interval);
+            timer.reset(new deadline_timer(io, milliseconds(delay)));
+            strand.reset(new boost::asio::io_service::strand(io));
         }
     }
     if(register_listener) {
@@ -234,14 +238,14 @@ on_timer_base(const error_code& ec,
             // Add counters for flow entry to be removed
             newClassCounters.packet_count =
                 make_optional(true,
-                              (remFlowCounters.diff_packet_count)
-                              ? remFlowCounters.diff_packet_count.get()
-                              : 0 + packet_count);
+                              ((remFlowCounters.diff_packet_count)
+                               ? remFlowCounters.diff_packet_count.get()
+                               : 0) + packet_count);
             newClassCounters.byte_count =
                 make_optional(true,
-                              (remFlowCounters.diff_byte_count)
-                              ? remFlowCounters.diff_byte_count.get()
-                              : 0 + byte_count);
+                              ((remFlowCounters.diff_byte_count)
+                               ? remFlowCounters.diff_byte_count.get()
+                               : 0) + byte_count);
         }
     }
 
@@ -312,7 +316,7 @@ void PolicyStatsManager::updateNewFlowCounters(uint32_t cookie,
             newFlowCounters.diff_packet_count =
                 oldFlowCounters.diff_packet_count;
             // Delete the entry from oldFlowCounterMap
-            counterState.oldFlowCounterMap.erase(flowEntryKey);
+            counterState.oldFlowCounterMap.erase(it);
         }
     } else {
         // Check if we this entry exists in newFlowCounterMap;
@@ -371,17 +375,20 @@ void PolicyStatsManager::handleMessage(int msgType,
         std::lock_guard<std::mutex> lock(pstatMtx);
         ofp_header *msgHdr = (ofp_header *)msg->data;
         ovs_be32 recvXid = msgHdr->xid;
+        bool allTables;
         {
             std::lock_guard<mutex> lock(txnMtx);
             if (txns.find(recvXid) == txns.end()) {
                 return;
             }
+            allTables = allTableTxns.find(recvXid) != allTableTxns.end();
         }
-        bool ret = handleFlowStats(msg, tableMap);
+        bool ret = handleFlowStats(msg, tableMap, allTables);
         {
             std::lock_guard<mutex> lock(txnMtx);
             if(ret) {
                 txns.erase(recvXid);
+                allTableTxns.erase(recvXid);
             }
         }
     } else if (msgType == OFPTYPE_FLOW_REMOVED) {
@@ -402,12 +409,30 @@ void PolicyStatsManager::handleMessage(int msgType,
     }
 }
 
+void PolicyStatsManager::HandleFlowRemoved(SwitchConnection* connection,
+                                           const FlowRemovedBatch& batch) {
+    std::lock_guard<std::mutex> lock(pstatMtx);
+    for (auto& m : batch) {
+        struct ofputil_flow_removed* fentry = m.second;
+        flowCounterState_t* counterState = getCounterState(fentry->table_id);
+        if (!counterState)
+            continue;
+        updateNewFlowCounters((uint32_t)ovs_ntohll(fentry->cookie),
+                              fentry->priority,
+                              (fentry->match),
+                              fentry->packet_count,
+                              fentry->byte_count,
+                              *counterState, true);
+    }
+}
+
 /**
  * Call this method holding the lock pstatMtx always. Lock has been
  * moved out of this method to avoid adding more specific locks in the
  * code path.
  */
-bool PolicyStatsManager::handleFlowStats(ofpbuf *msg, const table_map_t& tableMap) {
+bool PolicyStatsManager::handleFlowStats(ofpbuf *msg, const table_map_t& tableMap,
+                                         bool allTables) {
 
     struct ofputil_flow_stats* fentry, fstat;
     fentry = &fstat;
@@ -465,9 +490,14 @@ bool PolicyStatsManager::handleFlowStats(ofpbuf *msg, const table_map_t& tableMa
                 fentry->match.wc.masks.packet_type = 0;
             }
 
+            // A request for every table also returns the flows of
+            // tables without counters, which are skipped
             flowCounterState_t* counterState = tableMap(fentry->table_id);
-            if (!counterState)
+            if (!counterState) {
+                if (allTables)
+                    continue;
                 return true;
+            }
 
             if ((fentry->flags & OFPUTIL_FF_SEND_FLOW_REM) == 0) {
                 // skip those flow entries that don't have flag set
@@ -499,16 +529,9 @@ bool PolicyStatsManager::handleFlowStats(ofpbuf *msg, const table_map_t& tableMa
 
 }
 
-void PolicyStatsManager::sendRequest(uint32_t table_id, uint64_t _cookie,
-        uint64_t _cookie_mask) {
-
-    if (!connection)
-        return;
-
-    // send port stats request again
-    ofp_version ofVer = (ofp_version)connection->GetProtocolVersion();
-    ofputil_protocol proto = ofputil_protocol_from_ofp_version(ofVer);
-
+static OfpBuf encodeFlowStatsRequest(ofputil_protocol proto,
+                                     uint32_t table_id, uint64_t cookie,
+                                     uint64_t cookie_mask) {
     ofputil_flow_stats_request fsr;
     bzero(&fsr, sizeof(ofputil_flow_stats_request));
     fsr.aggregate = false;
@@ -516,15 +539,32 @@ void PolicyStatsManager::sendRequest(uint32_t table_id, uint64_t _cookie,
     fsr.table_id = table_id;
     fsr.out_port = OFPP_ANY;
     fsr.out_group = OFPG_ANY;
-    fsr.cookie = (uint64_t)_cookie;
-    fsr.cookie_mask = (uint64_t) _cookie_mask;
+    fsr.cookie = cookie;
+    fsr.cookie_mask = cookie_mask;
 
     OfpBuf req(ofputil_encode_flow_stats_request(&fsr, proto));
     ofpmsg_update_length(req.get());
+    return req;
+}
+
+void PolicyStatsManager::sendRequest(uint32_t table_id, uint64_t _cookie,
+        uint64_t _cookie_mask) {
+
+    if (!connection)
+        return;
+
+    // send port stats request again
+    ofp_version ofVer = (ofp_version)connection->GetProtocolVersion();
+    ofputil_protocol proto = ofputil_protocol_from_ofp_version(ofVer);
+
+    OfpBuf req(encodeFlowStatsRequest(proto, table_id,
+                                      _cookie, _cookie_mask));
     ovs_be32 reqXid = ((ofp_header *)req->data)->xid;
     {
         std::lock_guard<mutex> lock(txnMtx);
         txns.insert(reqXid);
+        if (table_id == OFPTT_ALL)
+            allTableTxns.insert(reqXid);
     }
 
     int err = connection->SendMessage(req);
@@ -536,6 +576,42 @@ void PolicyStatsManager::sendRequest(uint32_t table_id, uint64_t _cookie,
     }
 }
 
+void PolicyStatsManager::
+sendRequests(uint32_t table_id, const std::unordered_set<uint64_t>& cookies) {
+    if (!connection || cookies.empty())
+        return;
+
+    ofp_version ofVer = (ofp_version)connection->GetProtocolVersion();
+    ofputil_protocol proto = ofputil_protocol_from_ofp_version(ofVer);
+
+    std::vector<OfpBuf> reqs;
+    reqs.reserve(cookies.size());
+    for (uint64_t cookie : cookies) {
+        reqs.push_back(encodeFlowStatsRequest(proto, table_id,
+                                              ovs_htonll(cookie),
+                                              OVS_BE64_MAX));
+    }
+    {
+        std::lock_guard<mutex> lock(txnMtx);
+        for (const OfpBuf& req : reqs)
+            txns.insert(((ofp_header *)req->data)->xid);
+    }
+
+    int err = connection->SendMessages(reqs);
+    if (err != 0) {
+        LOG(ERROR) << "Failed to send stats requests"
+                   << " swname: " << connection->getSwitchName()
+                   << " tableid: " << table_id
+                   << " err: " << ovs_strerror(err);
+        // drop the requests that were not sent
+        std::lock_guard<mutex> lock(txnMtx);
+        for (const OfpBuf& req : reqs) {
+            if (req)
+                txns.erase(((ofp_header *)req->data)->xid);
+        }
+    }
+}
+
 static bool isExtNet(uint64_t reg) {
     return (reg & (1 << 31));
 }
@@ -546,6 +622,23 @@ generatePolicyStatsObjects(PolicyCounterMap_t *newCountersMap1,
                            PolicyCounterMap_t *newCountersMap2) {
     // walk through newCountersMap to create new set of MOs
     PolicyManager& polMgr = agent->getPolicyManager();
+    Mutator mutator(agent->getFramework(), "policyelement");
+    auto hasNewPackets = [](const FlowStats_t& counters) {
+        return counters.packet_count && counters.packet_count.get() != 0;
+    };
+    // the flows of a classifier share its cookie, so look each
+    // cookie up once
+    const std::string clsNmspc(
+        IntFlowManager::getIdNamespace(L24Classifier::CLASS_ID));
+    std::unordered_map<uint32_t, optional<string>> classifiers;
+    auto classifierFor = [&](uint32_t cookie) -> const optional<string>& {
+        auto it = classifiers.find(cookie);
+        if (it == classifiers.end())
+            it = classifiers.emplace(cookie,
+                                     idGen.getStringForId(clsNmspc,
+                                                          cookie)).first;
+        return it->second;
+    };
 
     for (PolicyCounterMap_t:: iterator itr = newCountersMap1->begin();
          itr != newCountersMap1->end();
@@ -560,7 +653,11 @@ generatePolicyStatsObjects(PolicyCounterMap_t *newCountersMap1,
             if (it != newCountersMap2->end()) {
                 newCounters2 = it->second ;
             }
+            if (!hasNewPackets(newCounters1) && !hasNewPackets(newCounters2))
+                continue;
         } else {
+            if (!hasNewPackets(newCounters1))
+                continue;
             if (isExtNet(flowKey.reg0) || isExtNet(flowKey.reg2)) {
                 // ignore contracts with external networks
                 continue;
@@ -579,10 +676,7 @@ generatePolicyStatsObjects(PolicyCounterMap_t *newCountersMap1,
                 continue;
             }
         }
-        optional<string> idStr =
-            idGen.getStringForId(IntFlowManager::
-                                 getIdNamespace(L24Classifier::CLASS_ID),
-                                 flowKey.cookie);
+        const optional<string>& idStr = classifierFor(flowKey.cookie);
         if (idStr == boost::none) {
             LOG(DEBUG) << "Cookie: " << flowKey.cookie
                        << " to Classifier URI translation does not exist";
@@ -592,13 +686,10 @@ generatePolicyStatsObjects(PolicyCounterMap_t *newCountersMap1,
             updatePolicyStatsCounters(idStr.get(),
                                       newCounters1,newCounters2);
         } else {
-            if (newCounters1.packet_count.get() != 0) {
-                updatePolicyStatsCounters(srcEpgUri.get().toString(),
-                                          dstEpgUri.get().toString(),
-                                          idStr.get(),
-                                          newCounters1);
-            }
-
+            updatePolicyStatsCounters(srcEpgUri.get().toString(),
+                                      dstEpgUri.get().toString(),
+                                      idStr.get(),
+                                      newCounters1);
         }
     }
 
@@ -610,10 +701,9 @@ generatePolicyStatsObjects(PolicyCounterMap_t *newCountersMap1,
             const PolicyFlowMatchKey_t& flowKey = itr->first;
             FlowStats_t&  outCounters = itr->second;
             FlowStats_t   inCounters;
-            optional<string> idStr =
-                idGen.getStringForId(IntFlowManager::
-                                     getIdNamespace(L24Classifier::CLASS_ID),
-                                     flowKey.cookie);
+            if (!hasNewPackets(outCounters))
+                continue;
+            const optional<string>& idStr = classifierFor(flowKey.cookie);
             if (idStr == boost::none) {
                 LOG(DEBUG) << "Cookie: " << flowKey.cookie
                            << " to Classifier URI translation does not exist";
@@ -623,6 +713,7 @@ generatePolicyStatsObjects(PolicyCounterMap_t *newCountersMap1,
                                       inCounters,outCounters);
         }
     }
+    mutator.commit();
 }
 
 void PolicyStatsManager::removeAllCounterObjects(const string& key) {
@@ -9,6 +9,8 @@
 #include "PortMapper.h"
 #include <opflexagent/logging.h>
 
+#include <vector>
+
 #include "ovs-ofputil.h"
 
 
@@ -23,12 +25,21 @@ typedef std::lock_guard<std::mutex> mutex_guard;
 
 namespace opflexagent {
 
-PortMapper::PortMapper() : lastDescReqXid(-1) {
+PortMapper::PortMapper()
+    : ports(std::make_shared<const PortTable>()), lastDescReqXid(-1) {
 }
 
 PortMapper::~PortMapper() {
 }
 
+std::shared_ptr<const PortMapper::PortTable> PortMapper::getPorts() const {
+    return std::atomic_load(&ports);
+}
+
+void PortMapper::setPorts(std::shared_ptr<const PortTable> newPorts) {
+    std::atomic_store(&ports, std::move(newPorts));
+}
+
 void PortMapper::registerPortStatusListener(PortStatusListener *l) {
     if (l) {
         mutex_guard lock(mapMtx);
@@ -120,22 +131,40 @@ PortMapper::HandlePortDescReply(ofpbuf *msg) {
                                   &tmpBuf, &portDesc)) {
         LOG(DEBUG) << "Found port: " << portDesc.port_no
                 << " -> " << portDesc.name;
-        *tmpPortMap[portDesc.name].get() = portDesc;
+        tmpPortMap[portDesc.name] = portDesc.port_no;
         tmprPortMap[portDesc.port_no] = portDesc.name;
     }
 
     if (done) {
         LOG(DEBUG) << "Got end of message";
+        // the ports added or renumbered, then the ports removed
+        std::vector<PortMap::value_type> changed;
         {
             mutex_guard lock(mapMtx);
             lastDescReqXid = -1;
-            portMap.swap(tmpPortMap);
-            tmpPortMap.clear();
-            rportMap.swap(tmprPortMap);
-            tmprPortMap.clear();
+            std::shared_ptr<const PortTable> oldPorts = getPorts();
+            std::shared_ptr<PortTable> newPorts =
+                std::make_shared<PortTable>();
+            newPorts->portMap.swap(tmpPortMap);
+            newPorts->rportMap.swap(tmprPortMap);
+            for (const PortMap::value_type& kv : newPorts->portMap) {
+                auto it = oldPorts->portMap.find(kv.first);
+                if (it == oldPorts->portMap.end() || it->second != kv.second)
+                    changed.push_back(kv);
+            }
+            size_t updated = changed.size();
+            for (const PortMap::value_type& kv : oldPorts->portMap) {
+                if (newPorts->portMap.find(kv.first) ==
+                    newPorts->portMap.end())
+                    changed.push_back(kv);
+            }
+            LOG(DEBUG) << "Port description: " << updated
+                       << " ports added or changed, "
+                       << changed.size() - updated << " removed";
+            setPorts(std::move(newPorts));
         }
-        for (const PortMap::value_type& kv : portMap) {
-            notifyListeners(kv.first, kv.second.get()->port_no, true);
+        for (const PortMap::value_type& kv : changed) {
+            notifyListeners(kv.first, kv.second, true);
         }
     }
 }
@@ -152,14 +181,17 @@ PortMapper::HandlePortStatus(ofpbuf *msg) {
     }
     {
         mutex_guard lock(mapMtx);
+        std::shared_ptr<PortTable> newPorts =
+            std::make_shared<PortTable>(*getPorts());
         if (portStatus.reason == OFPPR_ADD ||
             portStatus.reason == OFPPR_MODIFY) {
-            *portMap[portStatus.desc.name].get() = portStatus.desc;
-            rportMap[portStatus.desc.port_no] = portStatus.desc.name;
+            newPorts->portMap[portStatus.desc.name] = portStatus.desc.port_no;
+            newPorts->rportMap[portStatus.desc.port_no] = portStatus.desc.name;
         } else if (portStatus.reason == OFPPR_DELETE) {
-            portMap.erase(portStatus.desc.name);
-            rportMap.erase(portStatus.desc.port_no);
+            newPorts->portMap.erase(portStatus.desc.name);
+            newPorts->rportMap.erase(portStatus.desc.port_no);
         }
+        setPorts(std::move(newPorts));
     }
     notifyListeners(portStatus.desc.name, portStatus.desc.port_no,
                     false);
@@ -167,15 +199,14 @@ PortMapper::HandlePortStatus(ofpbuf *msg) {
 
 uint32_t
 PortMapper::FindPort(const std::string& name) {
-    mutex_guard lock(mapMtx);
-    PortMap::const_iterator itr = portMap.find(name);
-    return itr == portMap.end() ? OFPP_NONE : itr->second.get()->port_no;
+    std::shared_ptr<const PortTable> current = getPorts();
+    PortMap::const_iterator itr = current->portMap.find(name);
+    return itr == current->portMap.end() ? OFPP_NONE : itr->second;
 }
 
-const std::string&
+std::string
 PortMapper::FindPort(uint32_t of_port_no) {
-    mutex_guard lock(mapMtx);
-    return rportMap.at(of_port_no);
+    return getPorts()->rportMap.at(of_port_no);
 }
 
 } // namespace opflexagent
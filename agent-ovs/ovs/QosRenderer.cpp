@@ -19,6 +19,11 @@ namespace opflexagent {
     void QosRenderer::start(const string& swName, OvsdbConnection* conn) {
         LOG(DEBUG) << "starting QosRenderer";
         JsonRpcRenderer::start(swName, conn);
+        {
+            const lock_guard<mutex> guard(applied_mutex);
+            appliedEgress.clear();
+            appliedIngress.clear();
+        }
         agent.getQosManager().registerListener(this);
     }
 
@@ -26,6 +31,29 @@ namespace opflexagent {
         LOG(DEBUG) << "stopping QosRenderer";
         JsonRpcRenderer::stop();
         agent.getQosManager().unregisterListener(this);
+        const lock_guard<mutex> guard(applied_mutex);
+        appliedEgress.clear();
+        appliedIngress.clear();
+    }
+
+    bool QosRenderer::markEgressApplied(const string& interface,
+            const policing_t& policing) {
+        const lock_guard<mutex> guard(applied_mutex);
+        auto it = appliedEgress.find(interface);
+        if (it != appliedEgress.end() && it->second == policing)
+            return false;
+        appliedEgress[interface] = policing;
+        return true;
+    }
+
+    bool QosRenderer::markIngressApplied(const string& interface,
+            const optional<policing_t>& policing) {
+        const lock_guard<mutex> guard(applied_mutex);
+        auto it = appliedIngress.find(interface);
+        if (it != appliedIngress.end() && it->second == policing)
+            return false;
+        appliedIngress[interface] = policing;
+        return true;
     }
 
     void QosRenderer::ingressQosUpdated(const string& interface,
@@ -53,9 +81,24 @@ namespace opflexagent {
             return;
         }
 
+        list<OvsdbTransactMessage> requests;
+        if (markEgressApplied(interface, policing_t(0, 0)))
+            addEgressQosUpdate(interface, 0, 0, requests);
+        if (markIngressApplied(interface, boost::none))
+            addIngressQosDelete(interface, requests);
+        {
+            // the interface is gone, so forget it
+            const lock_guard<mutex> guard(applied_mutex);
+            appliedEgress.erase(interface);
+            appliedIngress.erase(interface);
+        }
+        if (requests.empty()) {
+            LOG(DEBUG) << "qos already cleared for interface: " << interface;
+            return;
+        }
+
         LOG(DEBUG) << "clearing egress and ingress qos for interface: " << interface;
-        deleteEgressQos(interface);
-        deleteIngressQos(interface);
+        sendAsyncTransactRequests(requests);
     }
 
     void QosRenderer::handleEgressQosUpdate(const string& interface,
@@ -75,15 +118,20 @@ namespace opflexagent {
             return;
         }
 
-        deleteEgressQos(interface);
-        if (!qosConfigState) {
+        policing_t policing(0, 0);
+        if (qosConfigState) {
+            policing.first = qosConfigState.get()->getRate();
+            policing.second = qosConfigState.get()->getBurst();
+        }
+        if (!markEgressApplied(interface, policing)) {
+            LOG(DEBUG) << "egress qos unchanged for interface: " << interface;
             return;
         }
 
-        uint64_t rate = qosConfigState.get()->getRate();
-        uint64_t burst = qosConfigState.get()->getBurst();
-
-        updateEgressQosParams(interface, rate, burst);
+        list<OvsdbTransactMessage> requests;
+        addEgressQosUpdate(interface, policing.first, policing.second,
+                           requests);
+        sendAsyncTransactRequests(requests);
     }
 
     void QosRenderer::handleIngressQosUpdate(const string& interface,
@@ -103,17 +151,24 @@ namespace opflexagent {
             return;
         }
 
-        deleteIngressQos(interface);
-        if (!qosConfigState) {
+        optional<policing_t> policing;
+        if (qosConfigState) {
+            policing = policing_t(qosConfigState.get()->getRate() * 1024,
+                                  qosConfigState.get()->getBurst() * 1024);
+        }
+        if (!markIngressApplied(interface, policing)) {
+            LOG(DEBUG) << "ingress qos unchanged for interface: " << interface;
             return;
         }
 
-        uint64_t rate = qosConfigState.get()->getRate();
-        uint64_t burst = qosConfigState.get()->getBurst();
-
-        rate = rate * 1024;
-        burst = burst * 1024;
-        updateIngressQosParams(interface, rate, burst);
+        // replace the queue and qos of the port in one transaction
+        list<OvsdbTransactMessage> requests;
+        addIngressQosDelete(interface, requests);
+        if (policing) {
+            addIngressQosUpdate(interface, policing.get().first,
+                                policing.get().second, requests);
+        }
+        sendAsyncTransactRequests(requests);
     }
 
     void QosRenderer::updateConnectCb(const boost::system::error_code& ec,
@@ -142,6 +197,15 @@ namespace opflexagent {
     }
 
     void QosRenderer::updateEgressQosParams(const string& interface, const uint64_t& rate, const uint64_t& burst){
+        markEgressApplied(interface, policing_t(rate, burst));
+        list<OvsdbTransactMessage> requests;
+        addEgressQosUpdate(interface, rate, burst, requests);
+        sendAsyncTransactRequests(requests);
+    }
+
+    void QosRenderer::addEgressQosUpdate(const string& interface,
+            uint64_t rate, uint64_t burst,
+            list<OvsdbTransactMessage>& requests) {
         OvsdbTransactMessage msg1(OvsdbOperation::UPDATE, OvsdbTable::INTERFACE);
         set<tuple<string, OvsdbFunction, string>> conditionSet;
         conditionSet.emplace("name", OvsdbFunction::EQ, interface);
@@ -157,8 +221,7 @@ namespace opflexagent {
         OvsdbValues tdSet2(values);
         msg1.rowData["ingress_policing_burst"] = tdSet2;
 
-        const list<OvsdbTransactMessage> requests = {msg1};
-        sendAsyncTransactRequests(requests) ;
+        requests.push_back(msg1);
     }
 
     void QosRenderer::deleteEgressQos(const string& interface){
@@ -166,6 +229,15 @@ namespace opflexagent {
     }
 
     void QosRenderer::updateIngressQosParams(const string& interface, const uint64_t& rate, const uint64_t& burst){
+        markIngressApplied(interface, policing_t(rate, burst));
+        list<OvsdbTransactMessage> requests;
+        addIngressQosUpdate(interface, rate, burst, requests);
+        sendAsyncTransactRequests(requests);
+    }
+
+    void QosRenderer::addIngressQosUpdate(const string& interface,
+            uint64_t rate, uint64_t burst,
+            list<OvsdbTransactMessage>& requests) {
         vector<OvsdbValue> values;
         OvsdbTransactMessage msg1(OvsdbOperation::INSERT, OvsdbTable::QUEUE);
 
@@ -216,11 +288,20 @@ namespace opflexagent {
         OvsdbValues tdSet4(values);
         msg3.rowData["qos"] = tdSet4;
 
-        const list<OvsdbTransactMessage> requests = {msg1,msg2,msg3};
-        sendAsyncTransactRequests(requests);
+        requests.push_back(msg1);
+        requests.push_back(msg2);
+        requests.push_back(msg3);
     }
 
     void QosRenderer::deleteIngressQos(const string& interface) {
+        markIngressApplied(interface, boost::none);
+        list<OvsdbTransactMessage> requests;
+        addIngressQosDelete(interface, requests);
+        sendAsyncTransactRequests(requests);
+    }
+
+    void QosRenderer::addIngressQosDelete(const string& interface,
+            list<OvsdbTransactMessage>& requests) {
         string qosUuid;
         conn->getOvsdbState().getQosUuidForPort(interface, qosUuid);
 
@@ -230,8 +311,7 @@ namespace opflexagent {
             set<tuple<string, OvsdbFunction, string>> conditionSet0;
             conditionSet0.emplace("_uuid", OvsdbFunction::EQ, qosUuid);
             msg0.conditions = conditionSet0;
-            const list<OvsdbTransactMessage> qosDelRequest = {msg0};
-            sendAsyncTransactRequests(qosDelRequest);
+            requests.push_back(msg0);
         }
 
         string queueUuid;
@@ -243,8 +323,7 @@ namespace opflexagent {
             set<tuple<string, OvsdbFunction, string>> conditionSet2;
             conditionSet2.emplace("_uuid", OvsdbFunction::EQ, queueUuid);
             msg2.conditions = conditionSet2;
-            const list<OvsdbTransactMessage> queueDelRequest = {msg2};
-            sendAsyncTransactRequests(queueDelRequest);
+            requests.push_back(msg2);
         }
 
         OvsdbTransactMessage msg1(OvsdbOperation::UPDATE, OvsdbTable::PORT);
@@ -255,8 +334,6 @@ namespace opflexagent {
         set<tuple<string, OvsdbFunction, string>> conditionSet;
         conditionSet.emplace("name", OvsdbFunction::EQ, interface);
         msg1.conditions = conditionSet;
-
-        const list<OvsdbTransactMessage> requests = {msg1};
-        sendAsyncTransactRequests(requests);
+        requests.push_back(msg1);
     }
 }
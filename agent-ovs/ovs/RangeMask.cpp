@@ -88,47 +88,71 @@ void RangeMask::getMasks(const optional<uint16_t>& startOpt,
 
     if (start == end) {
         out.push_back(createMask(start, -1));
-    } else {
-        /* Find first bit from MSB that is different between 'start' & 'end' */
-        int l2 = 15;
-        while (l2 > 0 && isBitSet(start, l2) == isBitSet(end, l2)) {
-            --l2;
-        }
-        /* Find first from LSB that is set in 'start' */
-        int l1 = 0;
-        while (l1 < l2 && !isBitSet(start, l1)) {
-            ++l1;
-        }
-        /* Find beginning of trailing 1s in 'end' */
-        int lto = -1;
-        while (lto < l2 && isBitSet(end, lto+1)) {
-            ++lto;
-        }
+        return;
+    }
+
+    /*
+     * The same few ranges come up for every classifier that is
+     * rendered; a small direct-mapped cache per thread avoids both
+     * recomputing them and locking.
+     */
+    struct CacheEntry {
+        uint16_t start;
+        uint16_t end;
+        MaskList masks;
+    };
+    static const size_t CACHE_SIZE = 256;
+    static thread_local CacheEntry cache[CACHE_SIZE];
+    CacheEntry& ce = cache[((start * 31u) ^ end) % CACHE_SIZE];
+    if (ce.masks.empty() || ce.start != start || ce.end != end) {
+        ce.start = start;
+        ce.end = end;
+        computeMasks(start, end, ce.masks);
+    }
+    out = ce.masks;
+}
+
+void RangeMask::computeMasks(uint16_t start, uint16_t end, MaskList& out) {
+    out.clear();
+    /* Find first bit from MSB that is different between 'start' & 'end' */
+    int l2 = 15;
+    while (l2 > 0 && isBitSet(start, l2) == isBitSet(end, l2)) {
+        --l2;
+    }
+    /* Find first from LSB that is set in 'start' */
+    int l1 = 0;
+    while (l1 < l2 && !isBitSet(start, l1)) {
+        ++l1;
+    }
+    /* Find beginning of trailing 1s in 'end' */
+    int lto = -1;
+    while (lto < l2 && isBitSet(end, lto+1)) {
+        ++lto;
+    }
 
-        if (l1 == l2 && l2 == lto) {
-            /* Special case:
-             *    start = xxxx0..0
-             *    end   = xxxx1..1
-             */
-            out.push_back(createMask(start, l2));
-        } else {
-            out.push_back(createMask(start, l1-1));
-            int p = l1 + 1;
-            while (p < l2) {
-                if (!isBitSet(start, p)) {
-                    out.push_back(createMask(setBit(start, p, true), p-1));
-                }
-                ++p;
+    if (l1 == l2 && l2 == lto) {
+        /* Special case:
+         *    start = xxxx0..0
+         *    end   = xxxx1..1
+         */
+        out.push_back(createMask(start, l2));
+    } else {
+        out.push_back(createMask(start, l1-1));
+        int p = l1 + 1;
+        while (p < l2) {
+            if (!isBitSet(start, p)) {
+                out.push_back(createMask(setBit(start, p, true), p-1));
             }
-            p = l2 - 1;
-            while (p > lto) {
-                if (isBitSet(end, p)) {
-                    out.push_back(createMask(setBit(end, p, false), p-1));
-                }
-                --p;
+            ++p;
+        }
+        p = l2 - 1;
+        while (p > lto) {
+            if (isBitSet(end, p)) {
+                out.push_back(createMask(setBit(end, p, false), p-1));
             }
-            out.push_back(createMask(end, lto == l2 ? lto-1 : lto));
+            --p;
         }
+        out.push_back(createMask(end, lto == l2 ? lto-1 : lto));
     }
 }
 
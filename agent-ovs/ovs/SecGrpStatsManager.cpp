@@ -61,7 +61,8 @@ void SecGrpStatsManager::start() {
 
     {
         std::lock_guard<std::mutex> lock(timer_mutex);
-        timer->async_wait(bind(&SecGrpStatsManager::on_timer, this, error));
+        timer->async_wait(strand->wrap(
+            bind(&SecGrpStatsManager::on_timer, this, error)));
     }
 }
 
@@ -78,9 +79,12 @@ void SecGrpStatsManager::on_timer(const error_code& ec) {
         return;
     }
 
+    std::unordered_set<uint64_t> inCookies;
+    std::unordered_set<uint64_t> outCookies;
     TableState::cookie_callback_t cb_func;
-    cb_func = [this](uint64_t cookie, uint16_t priority,
-                     const struct match& match) {
+    cb_func = [this, &inCookies](uint64_t cookie, uint16_t priority,
+                                 const struct match& match) {
+        inCookies.insert(cookie);
         const std::lock_guard<std::mutex> lock(pstatMtx);
         updateFlowEntryMap(secGrpInState, cookie, priority, match);
     };
@@ -91,8 +95,9 @@ void SecGrpStatsManager::on_timer(const error_code& ec) {
             forEachCookieMatch(AccessFlowManager::SEC_GROUP_IN_TABLE_ID,
                                cb_func);
 
-        cb_func = [this](uint64_t cookie, uint16_t priority,
-                         const struct match& match) {
+        cb_func = [this, &outCookies](uint64_t cookie, uint16_t priority,
+                                      const struct match& match) {
+            outCookies.insert(cookie);
             const std::lock_guard<std::mutex> lock(pstatMtx);
             updateFlowEntryMap(secGrpOutState, cookie, priority, match);
         };
@@ -109,13 +114,15 @@ void SecGrpStatsManager::on_timer(const error_code& ec) {
                                    &newClassCountersMap2);
     }
 
-    sendRequest(AccessFlowManager::SEC_GROUP_IN_TABLE_ID);
-    sendRequest(AccessFlowManager::SEC_GROUP_OUT_TABLE_ID);
+    // only read the flows that are counted
+    sendRequests(AccessFlowManager::SEC_GROUP_IN_TABLE_ID, inCookies);
+    sendRequests(AccessFlowManager::SEC_GROUP_OUT_TABLE_ID, outCookies);
     if (!stopping) {
         std::lock_guard<std::mutex> lock(timer_mutex);
         if (timer) {
             timer->expires_from_now(milliseconds(timer_interval));
-            timer->async_wait(bind(&SecGrpStatsManager::on_timer, this, error));
+            timer->async_wait(strand->wrap(
+                bind(&SecGrpStatsManager::on_timer, this, error)));
         }
     }
 }
@@ -131,7 +138,6 @@ void SecGrpStatsManager::
 updatePolicyStatsCounters(const string& l24Classifier,
                           FlowStats_t& newVals1,
                           FlowStats_t& newVals2) {
-    Mutator mutator(agent->getFramework(), "policyelement");
     optional<shared_ptr<PolicyStatUniverse> > su =
         PolicyStatUniverse::resolve(agent->getFramework());
     if (su) {
@@ -172,7 +178,6 @@ updatePolicyStatsCounters(const string& l24Classifier,
                                                             newVals2.packet_count.get());
         }
     }
-    mutator.commit();
 }
 
 void SecGrpStatsManager::objectUpdated(opflex::modb::class_id_t class_id,
@@ -190,16 +195,20 @@ void SecGrpStatsManager::Handle(SwitchConnection* connection,
                                 ofpbuf *msg,
                                 struct ofputil_flow_removed* fentry) {
     handleMessage(msgType, msg,
-                  [this](uint32_t table_id) -> flowCounterState_t* {
-                      switch (table_id) {
-                      case AccessFlowManager::SEC_GROUP_IN_TABLE_ID:
-                          return &secGrpInState;
-                      case AccessFlowManager::SEC_GROUP_OUT_TABLE_ID:
-                          return &secGrpOutState;
-                      default:
-                          return NULL;
-                      }
+                  [this](uint32_t table_id) {
+                      return getCounterState(table_id);
                   }, fentry);
 }
 
+flowCounterState_t* SecGrpStatsManager::getCounterState(uint32_t tableId) {
+    switch (tableId) {
+    case AccessFlowManager::SEC_GROUP_IN_TABLE_ID:
+        return &secGrpInState;
+    case AccessFlowManager::SEC_GROUP_OUT_TABLE_ID:
+        return &secGrpOutState;
+    default:
+        return NULL;
+    }
+}
+
 } /* namespace opflexagent */
@@ -49,7 +49,8 @@ void ServiceStatsManager::start() {
     PolicyStatsManager::start(true, intFlowManager.getSvcStatsIOService());
     {
         std::lock_guard<std::mutex> lock(timer_mutex);
-        timer->async_wait(bind(&ServiceStatsManager::on_timer, this, error));
+        timer->async_wait(strand->wrap(
+            bind(&ServiceStatsManager::on_timer, this, error)));
     }
 }
 
@@ -155,7 +156,8 @@ void ServiceStatsManager::on_timer(const error_code& ec) {
         std::lock_guard<std::mutex> lock(timer_mutex);
         if (timer) {
             timer->expires_from_now(milliseconds(timer_interval));
-            timer->async_wait(bind(&ServiceStatsManager::on_timer, this, error));
+            timer->async_wait(strand->wrap(
+                bind(&ServiceStatsManager::on_timer, this, error)));
         }
     }
 }
@@ -343,16 +345,19 @@ void ServiceStatsManager::Handle(SwitchConnection* connection,
                                 struct ofputil_flow_removed *fentry)
 {
     handleMessage(msgType, msg,
-                  [this](uint32_t table_id) -> flowCounterState_t* {
-                      if (table_id == IntFlowManager::STATS_TABLE_ID)
-                          return &statsState;
-                      else if (table_id == IntFlowManager::SERVICE_NEXTHOP_TABLE_ID)
-                          return &svhState;
-                      else if (table_id == IntFlowManager::SERVICE_REV_TABLE_ID)
-                          return &svrState;
-                      else
-                          return NULL;
+                  [this](uint32_t table_id) {
+                      return getCounterState(table_id);
                   }, fentry);
 }
 
+flowCounterState_t* ServiceStatsManager::getCounterState(uint32_t tableId) {
+    if (tableId == IntFlowManager::STATS_TABLE_ID)
+        return &statsState;
+    else if (tableId == IntFlowManager::SERVICE_NEXTHOP_TABLE_ID)
+        return &svhState;
+    else if (tableId == IntFlowManager::SERVICE_REV_TABLE_ID)
+        return &svrState;
+    return NULL;
+}
+
 } /* namespace opflexagent */
@@ -150,49 +150,100 @@ namespace opflexagent {
             return;
         }
 
+        if (!isMirProv) {
+            updateMirrorConfig(seSt.get());
+            return;
+        }
+
+        // a new output port replaces the mirror config
+        string outputPortUuid;
+        conn->getOvsdbState().getUuidForName(OvsdbTable::PORT,
+                                             seSt.get()->getDestPort(),
+                                             outputPortUuid);
+        if (outputPortUuid.empty() || outputPortUuid != mir.out_port) {
+            updateMirrorConfig(seSt.get());
+            return;
+        }
+
+        if (isOutputPortUpdateRequired(seSt.get())) {
+            LOG(INFO) << "Output port config has changed for " << seSt.get()->getName();
+            updateOutputPort(seSt.get());
+        }
+
+        // change the source and destination ports of the mirror in
+        // place, so that the session is not interrupted
         set<string> srcPorts;
         set<string> dstPorts;
         buildPortSets(seSt.get(), srcPorts, dstPorts);
+        set<string> srcPortUuids;
+        set<string> dstPortUuids;
+        resolvePortUuids(srcPorts, srcPortUuids);
+        resolvePortUuids(dstPorts, dstPortUuids);
+
+        OvsdbTransactMessage del(OvsdbOperation::MUTATE, OvsdbTable::MIRROR);
+        OvsdbTransactMessage ins(OvsdbOperation::MUTATE, OvsdbTable::MIRROR);
+        addPortSetMutations("select_src_port", mir.src_ports, srcPortUuids,
+                            del, ins);
+        addPortSetMutations("select_dst_port", mir.dst_ports, dstPortUuids,
+                            del, ins);
 
-        LOG(DEBUG) << "src port count = " << srcPorts.size();
-        LOG(DEBUG) << "dest port count = " << dstPorts.size();
-
-        // check if the number of source and dest ports are the
-        // same as provisioned.
-        if (srcPorts.size() != mir.src_ports.size() ||
-            dstPorts.size() != mir.dst_ports.size()) {
-            updateMirrorConfig(seSt.get());
+        set<tuple<string, OvsdbFunction, string>> condSet;
+        condSet.emplace("_uuid", OvsdbFunction::EQ, mir.uuid);
+        list<OvsdbTransactMessage> requests;
+        if (!del.mutateRowData.empty()) {
+            del.conditions = condSet;
+            requests.push_back(del);
+        }
+        if (!ins.mutateRowData.empty()) {
+            ins.conditions = condSet;
+            requests.push_back(ins);
+        }
+        if (requests.empty()) {
+            LOG(DEBUG) << "Mirror ports unchanged for " << seSt.get()->getName();
             return;
         }
+        sendAsyncTransactRequests(requests);
+    }
 
-        // compare port names. If at least one is different, the config
-        // has changed.
-        for (const auto& src_port : mir.src_ports) {
-            auto itr = srcPorts.find(src_port);
-            if (itr == srcPorts.end()) {
-                updateMirrorConfig(seSt.get());
-                return;
+    void SpanRenderer::resolvePortUuids(const set<string>& ports,
+                                        set<string>& uuids) {
+        for (const auto& port : ports) {
+            string uuid;
+            conn->getOvsdbState().getUuidForName(OvsdbTable::PORT, port, uuid);
+            if (!uuid.empty()) {
+                uuids.insert(uuid);
+            } else {
+                LOG(DEBUG) << "Unable to find uuid for port " << port;
             }
         }
+    }
 
-        for (const auto& dst_port : mir.dst_ports) {
-            auto itr = dstPorts.find(dst_port);
-            if (itr == dstPorts.end()) {
-                updateMirrorConfig(seSt.get());
-                return;
-            }
+    void SpanRenderer::addPortSetMutations(const string& column,
+                                           const set<string>& current,
+                                           const set<string>& wanted,
+                                           OvsdbTransactMessage& del,
+                                           OvsdbTransactMessage& ins) {
+        vector<OvsdbValue> removed;
+        for (const auto& uuid : current) {
+            if (wanted.find(uuid) == wanted.end())
+                removed.emplace_back("uuid", uuid);
         }
-
-        // get ERSPAN interface params if configured
-        ErspanParams params;
-        if (!conn->getOvsdbState().getErspanParams(seSt.get()->getDestPort(), params)) {
-            LOG(DEBUG) << "Unable to get ERSPAN parameters";
-            return;
+        vector<OvsdbValue> added;
+        for (const auto& uuid : wanted) {
+            if (current.find(uuid) == current.end())
+                added.emplace_back("uuid", uuid);
         }
-
-        if (isOutputPortUpdateRequired(seSt.get())) {
-            LOG(INFO) << "Output port config has changed for " << seSt.get()->getName();
-            updateOutputPort(seSt.get());
+        LOG(DEBUG) << column << ": adding " << added.size()
+                   << " and removing " << removed.size() << " ports";
+        if (!removed.empty()) {
+            OvsdbValues tdSet("set", removed);
+            del.mutateRowData.emplace(column,
+                std::make_pair(OvsdbOperation::DELETE, tdSet));
+        }
+        if (!added.empty()) {
+            OvsdbValues tdSet("set", added);
+            ins.mutateRowData.emplace(column,
+                std::make_pair(OvsdbOperation::INSERT, tdSet));
         }
     }
 
@@ -8,8 +8,10 @@
 
 #include "SwitchConnection.h"
 #include <opflexagent/logging.h>
+#include <opflex/util/ThreadSettings.h>
 
 #include <sys/eventfd.h>
+#include <pthread.h>
 #include <string>
 #include <fstream>
 
@@ -31,13 +33,22 @@ extern "C" {
 }
 
 typedef std::lock_guard<std::mutex> mutex_guard;
+typedef std::unique_lock<std::mutex> unique_guard;
 
 const int LOST_CONN_BACKOFF_MSEC = 5000;
 const std::chrono::seconds ECHO_INTERVAL(5);
 const std::chrono::seconds MAX_ECHO_INTERVAL(30);
+/* Bound on waiting for the socket to drain between tries of a batch */
+const int SEND_WAIT_MSEC = 100;
 
 namespace opflexagent {
 
+void MessageHandler::HandleFlowRemoved(SwitchConnection *swConn,
+                                       const FlowRemovedBatch& batch) {
+    for (auto& m : batch)
+        Handle(swConn, OFPTYPE_FLOW_REMOVED, m.first, m.second);
+}
+
 int SwitchConnection::DecodeFlowRemoved(ofpbuf *msg,
         struct ofputil_flow_removed* fentry) {
     const struct ofp_header *oh = (ofp_header *)msg->data;
@@ -61,7 +72,9 @@ int SwitchConnection::DecodeFlowRemoved(ofpbuf *msg,
 }
 
 SwitchConnection::SwitchConnection(const std::string& swName) :
-    switchName(swName), ofConn(NULL), ofProtoVersion(OFP10_VERSION), isDisconnecting(false) {
+    switchName(swName), ofConn(NULL), ofProtoVersion(OFP10_VERSION),
+    minProtoVersion(OFP10_VERSION), maxProtoVersion(OFP10_VERSION),
+    isDisconnecting(false), dispatchStopping(false) {
     connThread = NULL;
 
     pollEventFd = eventfd(0, 0);
@@ -109,19 +122,39 @@ SwitchConnection::UnregisterMessageHandler(int msgType,
     }
 }
 
+void
+SwitchConnection::SetDispatchAsync(int msgType) {
+    asyncTypes.insert(msgType);
+}
+
+void
+SwitchConnection::SetMaxProtocolVersion(int protoVer) {
+    maxProtoVersion = protoVer;
+}
+
 int
 SwitchConnection::Connect(int protoVer) {
     if (ofConn != NULL) {    // connection already created
         return true;
     }
 
+    if (!asyncTypes.empty() && !dispatchThread) {
+        dispatchStopping = false;
+        dispatchThread.reset(new std::thread(
+            opflex::util::startThread("disp_" + switchName,
+                                      [this]() { Dispatch(); })));
+    }
+
     ofProtoVersion = protoVer;
+    minProtoVersion = protoVer;
     int err = doConnectOF();
     if (err != 0) {
         LOG(ERROR) << "Failed to connect to " << switchName << ": "
             << ovs_strerror(err);
     }
-    connThread.reset(new std::thread(std::ref(*this)));
+    connThread.reset(new std::thread(
+        opflex::util::startThread("conn_" + switchName,
+                                  [this]() { Monitor(); })));
     return err;
 }
 
@@ -131,7 +164,9 @@ SwitchConnection::doConnectOF() {
     swPath.append("unix:").append(ovs_rundir()).append("/")
             .append(switchName).append(".mgmt");
 
-    uint32_t versionBitmap = 1u << ofProtoVersion;
+    uint32_t versionBitmap = 1u << minProtoVersion;
+    if (maxProtoVersion > minProtoVersion)
+        versionBitmap |= 1u << maxProtoVersion;
     vconn *newConn;
     int error;
     error = vconn_open_block(swPath.c_str(), versionBitmap, DSCP_DEFAULT,
@@ -142,12 +177,12 @@ SwitchConnection::doConnectOF() {
 
     /* Verify we have the correct protocol version */
     int connVersion = vconn_get_version(newConn);
-    if (connVersion != ofProtoVersion) {
+    if (((1u << connVersion) & versionBitmap) == 0) {
         LOG(WARNING) << "Remote supports version " << connVersion <<
-                ", wanted " << ofProtoVersion;
+                ", wanted " << minProtoVersion;
     }
     LOG(INFO) << "Connected to switch " << swPath
-            << " using protocol version " << ofProtoVersion;
+            << " using protocol version " << connVersion;
     {
         mutex_guard lock(connMtx);
         lastEchoTime = std::chrono::steady_clock::now();
@@ -172,6 +207,7 @@ SwitchConnection::Disconnect() {
         connThread->join();
         connThread.reset();
     }
+    stopDispatch();
 
     mutex_guard lock(connMtx);
     cleanupOFConn();
@@ -198,11 +234,6 @@ const std::string& SwitchConnection::getSwitchName() {
     return switchName;
 }
 
-void
-SwitchConnection::operator()() {
-    Monitor();
-}
-
 bool
 SwitchConnection::SignalPollEvent() {
     uint64_t data = 1;
@@ -322,18 +353,15 @@ SwitchConnection::receiveOFMessage() {
         } else {
             ofptype type;
             if (!ofptype_decode(&type, (ofp_header *)recvMsg->data)) {
-                struct ofputil_flow_removed flow_removed;
-                if(type == OFPTYPE_FLOW_REMOVED) {
-                    if(DecodeFlowRemoved(recvMsg, &flow_removed) != 0) {
-                        break;
-                    }
-                }
-                HandlerMap::const_iterator itr = msgHandlers.find(type);
-                if (itr != msgHandlers.end()) {
-                    for (MessageHandler *h : itr->second) {
-                        h->Handle(this, type, recvMsg, &flow_removed);
+                if (dispatchThread && asyncTypes.count(type)) {
+                    {
+                        mutex_guard lock(dispatchMtx);
+                        dispatchQueue.emplace_back(type, recvMsg);
                     }
+                    dispatchCond.notify_one();
+                    continue;
                 }
+                handleMessage(type, recvMsg);
             }
             ofpbuf_delete(recvMsg);
         }
@@ -341,6 +369,92 @@ SwitchConnection::receiveOFMessage() {
     return 0;
 }
 
+void
+SwitchConnection::handleMessage(int type, ofpbuf *msg) {
+    struct ofputil_flow_removed flow_removed;
+    if (type == OFPTYPE_FLOW_REMOVED) {
+        if (DecodeFlowRemoved(msg, &flow_removed) != 0) {
+            return;
+        }
+    }
+    HandlerMap::const_iterator itr = msgHandlers.find(type);
+    if (itr != msgHandlers.end()) {
+        for (MessageHandler *h : itr->second) {
+            h->Handle(this, type, msg, &flow_removed);
+        }
+    }
+}
+
+void
+SwitchConnection::handleFlowRemoved(const std::vector<ofpbuf*>& msgs) {
+    std::vector<ofputil_flow_removed> decoded(msgs.size());
+    FlowRemovedBatch batch;
+    batch.reserve(msgs.size());
+    for (size_t i = 0; i < msgs.size(); ++i) {
+        if (DecodeFlowRemoved(msgs[i], &decoded[i]) == 0)
+            batch.emplace_back(msgs[i], &decoded[i]);
+    }
+    if (batch.empty())
+        return;
+    HandlerMap::const_iterator itr = msgHandlers.find(OFPTYPE_FLOW_REMOVED);
+    if (itr != msgHandlers.end()) {
+        for (MessageHandler *h : itr->second) {
+            h->HandleFlowRemoved(this, batch);
+        }
+    }
+}
+
+void
+SwitchConnection::Dispatch() {
+    std::deque<std::pair<int, ofpbuf*> > batch;
+    std::vector<ofpbuf*> flowRemoved;
+    auto flushFlowRemoved = [this, &flowRemoved]() {
+        if (flowRemoved.empty())
+            return;
+        handleFlowRemoved(flowRemoved);
+        for (ofpbuf* msg : flowRemoved)
+            ofpbuf_delete(msg);
+        flowRemoved.clear();
+    };
+    while (true) {
+        {
+            unique_guard lock(dispatchMtx);
+            dispatchCond.wait(lock, [this]() {
+                    return dispatchStopping || !dispatchQueue.empty();
+                });
+            if (dispatchQueue.empty())
+                return;
+            batch.swap(dispatchQueue);
+        }
+        // runs of flow removed messages are handled together, in
+        // order with the other messages
+        for (auto& m : batch) {
+            if (m.first == OFPTYPE_FLOW_REMOVED) {
+                flowRemoved.push_back(m.second);
+                continue;
+            }
+            flushFlowRemoved();
+            handleMessage(m.first, m.second);
+            ofpbuf_delete(m.second);
+        }
+        flushFlowRemoved();
+        batch.clear();
+    }
+}
+
+void
+SwitchConnection::stopDispatch() {
+    if (!dispatchThread)
+        return;
+    {
+        mutex_guard lock(dispatchMtx);
+        dispatchStopping = true;
+    }
+    dispatchCond.notify_all();
+    dispatchThread->join();
+    dispatchThread.reset();
+}
+
 int
 SwitchConnection::SendMessage(OfpBuf& msg) {
     while(true) {
@@ -363,6 +477,42 @@ SwitchConnection::SendMessage(OfpBuf& msg) {
     }
 }
 
+int
+SwitchConnection::SendMessages(std::vector<OfpBuf>& msgs) {
+    size_t i = 0;
+    while (i < msgs.size()) {
+        {
+            mutex_guard lock(connMtx);
+            if (!IsConnectedLocked()) {
+                return ENOTCONN;
+            }
+            for (; i < msgs.size(); ++i) {
+                int err = vconn_send(ofConn, msgs[i].get());
+                if (err == 0) {
+                    // vconn_send takes ownership
+                    msgs[i].release();
+                } else if (err != EAGAIN) {
+                    LOG(ERROR) << "Error sending OF message: "
+                               << ovs_strerror(err);
+                    return err;
+                } else {
+                    vconn_run(ofConn);
+                    vconn_send_wait(ofConn);
+                    break;
+                }
+            }
+        }
+        if (i < msgs.size()) {
+            // wait for the socket to drain without holding the
+            // connection, so that the monitor thread can keep
+            // receiving
+            poll_timer_wait(SEND_WAIT_MSEC);
+            poll_block();
+        }
+    }
+    return 0;
+}
+
 void
 SwitchConnection::FireOnConnectListeners() {
     if (GetProtocolVersion() >= OFP12_VERSION) {
@@ -9,11 +9,15 @@
 #include "SwitchManager.h"
 #include "FlowBuilder.h"
 #include <opflexagent/logging.h>
+#include <opflexagent/AllocStats.h>
 
 #include <boost/asio/placeholders.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
+#include <algorithm>
+
 #include "ovs-ofputil.h"
+#include <openvswitch/ofp-msgs.h>
 
 namespace opflexagent {
 
@@ -25,24 +29,38 @@ using boost::posix_time::milliseconds;
 using boost::asio::placeholders::error;
 
 const long DEFAULT_SYNC_DELAY_ON_CONNECT_MSEC = 5000;
+// the number of deferred edits written at once at the end of a sync
+const size_t DEFERRED_SYNC_BATCH = 1024;
 
 SwitchManager::SwitchManager(Agent& agent_,
                              FlowExecutor& flowExecutor_,
                              FlowReader& flowReader_,
                              PortMapper& portMapper_)
-    : agent(agent_),
+    : agent(agent_), ioService(&agent_.getAgentIOService()),
       flowExecutor(flowExecutor_),
       flowReader(flowReader_),
       portMapper(portMapper_), stateHandler(NULL),
+      writeWindow(1),
       connectDelayMs(DEFAULT_SYNC_DELAY_ON_CONNECT_MSEC),
       stopping(false), syncEnabled(false), syncing(false),
       syncInProgress(false), syncPending(false),
-      tlvTableDone(false), groupsDone(false) {
+      tlvTableDone(false), groupsDone(false), groupBucketEdits(false) {
 
 }
 
 void SwitchManager::start(const std::string& swName) {
     connection.reset(new SwitchConnection(swName));
+    progStats = agent.getFlowProgrammingStats()
+        .addBridge(swName, flowTables.size());
+    // Keep stats dumps, flow removals and packet-ins from holding up
+    // the barrier replies of flow writes.  The flow stats and flow
+    // removed handlers of the stats managers share state, so these
+    // go to the same thread.
+    connection->SetDispatchAsync(OFPTYPE_FLOW_STATS_REPLY);
+    connection->SetDispatchAsync(OFPTYPE_FLOW_REMOVED);
+    connection->SetDispatchAsync(OFPTYPE_GROUP_DESC_STATS_REPLY);
+    connection->SetDispatchAsync(OFPTYPE_NXT_TLV_TABLE_REPLY);
+    connection->SetDispatchAsync(OFPTYPE_PACKET_IN);
     portMapper.InstallListenersForConnection(connection.get());
     flowExecutor.InstallListenersForConnection(connection.get());
     flowReader.installListenersForConnection(connection.get());
@@ -50,10 +68,14 @@ void SwitchManager::start(const std::string& swName) {
     // Start out in syncing mode to avoid writing to the flow tables;
     // we'll update cached state only.
     syncing = true;
+
+    agent.getStartupTimeline().expect("flows-synced " + swName);
 }
 
 void SwitchManager::connect() {
     connection->RegisterOnConnectListener(this);
+    if (groupBucketEdits)
+        connection->SetMaxProtocolVersion(OFP15_VERSION);
     (void)(connection->Connect(OFP13_VERSION));
 }
 
@@ -81,6 +103,8 @@ void SwitchManager::setMaxFlowTables(int max) {
     const lock_guard<recursive_mutex> lock(sm_mutex);
     flowTables.resize(max);
     recvFlows.resize(max);
+    recvHash.resize(max);
+    recvChanged.resize(max);
     tableDone.resize(max);
 }
 
@@ -109,14 +133,13 @@ void SwitchManager::enableSync() {
         if (connectDelayMs > 0) {
             const lock_guard<recursive_mutex> lock(timer_mutex);
             connectTimer
-                .reset(new deadline_timer(agent.getAgentIOService(),
+                .reset(new deadline_timer(*ioService,
                                           milliseconds(connectDelayMs)));
         }
         // Pretend that we just got connected to the switch to schedule sync
         if (connection && connection->IsConnected()) {
-            agent.getAgentIOService()
-                .dispatch(bind(&SwitchManager::handleConnection, this,
-                               connection.get()));
+            ioService->dispatch(bind(&SwitchManager::handleConnection,
+                                     this, connection.get()));
         }
     }
 }
@@ -131,8 +154,7 @@ void SwitchManager::setSyncDelayOnConnect(long delay) {
 
 void SwitchManager::Connected(SwitchConnection *swConn) {
     if (stopping) return;
-    agent.getAgentIOService()
-        .dispatch(bind(&SwitchManager::handleConnection, this, swConn));
+    ioService->dispatch(bind(&SwitchManager::handleConnection, this, swConn));
 }
 
 void SwitchManager::handleConnection(SwitchConnection *sw) {
@@ -185,21 +207,225 @@ bool SwitchManager::writeFlow(const std::string& objId, int tableId,
 
     FlowEdit diffs;
     tab.apply(objId, el, diffs);
+    countEdits(tableId, diffs, !syncing);
     if (!syncing) {
         // If a sync is in progress, don't write to the flow tables
         // while we are reading and reconciling with the current
         // flows.
-        if (!(success = flowExecutor.Execute(diffs))) {
-            LOG(ERROR) << "[" << connection->getSwitchName() << "] "
-                       << "Writing flows for " << objId << " failed";
-
-        }
+        success = executeFlows(diffs, objId);
     }
     el.clear();
 
     return success;
 }
 
+bool SwitchManager::executeFlows(const FlowEdit& diffs,
+                                 const std::string& what) {
+    if (inBatch()) {
+        batchDiffs.edits.insert(batchDiffs.edits.end(),
+                                diffs.edits.begin(), diffs.edits.end());
+        return true;
+    }
+    // changes collected by a batch on another thread were made first
+    flushBatch();
+    if (!executeTraced(diffs)) {
+        LOG(ERROR) << "[" << connection->getSwitchName() << "] "
+                   << "Writing flows for " << what << " failed";
+        return false;
+    }
+    return true;
+}
+
+bool SwitchManager::flushBatch() {
+    if (batchDiffs.edits.empty() && batchGroupsBefore.edits.empty() &&
+        batchGroupsAfter.edits.empty())
+        return true;
+    bool success = true;
+    if (!syncing && !executeTraced(batchGroupsBefore, batchDiffs,
+                                   batchGroupsAfter)) {
+        LOG(ERROR) << "[" << connection->getSwitchName() << "] "
+                   << "Writing a batch of " << batchDiffs.edits.size()
+                   << " flow changes and "
+                   << (batchGroupsBefore.edits.size() +
+                       batchGroupsAfter.edits.size())
+                   << " group changes failed";
+        success = false;
+        // the groups may not be as recorded
+        groupState.clear();
+    }
+    batchDiffs.edits.clear();
+    batchGroupsBefore.edits.clear();
+    batchGroupsAfter.edits.clear();
+    if (!success) {
+        // the changes of every open batch were in the write
+        for (auto& b : batches)
+            b.second.success = false;
+    }
+    return success;
+}
+
+bool SwitchManager::inBatch() const {
+    return batches.find(std::this_thread::get_id()) != batches.end();
+}
+
+bool SwitchManager::executeTraced(const FlowEdit& diffs) {
+    return executeTraced(GroupEdit(), diffs, GroupEdit());
+}
+
+bool SwitchManager::executeTraced(const GroupEdit& before,
+                                  const FlowEdit& diffs,
+                                  const GroupEdit& after) {
+    using opflex::modb::TraceContext;
+    bool traced = !diffs.edits.empty() && TraceContext::isTraced();
+    DataplaneLatency* latency = &agent.getDataplaneLatency();
+    auto origin = TraceContext::getOrigin();
+    auto written = DataplaneLatency::clock::now();
+    if (traced) {
+        latency->observe(DataplaneLatency::COMPUTE,
+                         written - TraceContext::getStart());
+    }
+    size_t changes = before.edits.size() + diffs.edits.size() +
+        after.edits.size();
+    std::shared_ptr<FlowProgrammingStats::BridgeStats> stats = progStats;
+    auto acknowledged = [latency, traced, origin, written, stats, changes]() {
+        auto acked = DataplaneLatency::clock::now();
+        if (stats)
+            stats->observeWrite(changes, acked - written);
+        if (!traced) return;
+        latency->observe(DataplaneLatency::BARRIER, acked - written);
+        latency->observe(DataplaneLatency::TOTAL, acked - origin);
+    };
+
+    if (writeWindow > 1) {
+        // failures are handled when the switch replies
+        flowExecutor.ExecuteAsync(before, diffs, after,
+                                  [this, acknowledged, changes](int status) {
+                                      acknowledged();
+                                      onWriteComplete(status, changes);
+                                  });
+        return true;
+    }
+
+    bool success = (before.edits.empty() && after.edits.empty())
+        ? flowExecutor.Execute(diffs)
+        : flowExecutor.Execute(before, diffs, after);
+    acknowledged();
+    return success;
+}
+
+void SwitchManager::setWriteWindow(size_t window) {
+    writeWindow = window > 0 ? window : 1;
+    flowExecutor.setMaxOutstanding(writeWindow);
+}
+
+void SwitchManager::setIOService(boost::asio::io_service& io) {
+    ioService = &io;
+}
+
+void SwitchManager::setGroupBucketEdits(bool enabled) {
+    groupBucketEdits = enabled;
+}
+
+bool SwitchManager::useBucketEdits() {
+    return groupBucketEdits && connection &&
+        connection->GetProtocolVersion() >= OFP15_VERSION;
+}
+
+void SwitchManager::addGroupEdits(const GroupEdit::Entry& e,
+                                  GroupEdit::EntryList& edits) {
+    if (!useBucketEdits()) {
+        groupState.clear();
+        edits.push_back(e);
+        return;
+    }
+    uint32_t groupId = e->mod->group_id;
+    if (e->mod->command == OFPGC11_DELETE) {
+        groupState.erase(groupId);
+        edits.push_back(e);
+        return;
+    }
+    auto it = groupState.find(groupId);
+    if (it != groupState.end() &&
+        GroupEdit::bucketEdits(it->second, e, edits)) {
+        // the entry itself is not sent, so it can be kept as is
+        it->second = e;
+    } else {
+        // sending the entry releases its buckets
+        groupState[groupId] = GroupEdit::clone(e);
+        edits.push_back(e);
+    }
+}
+
+void SwitchManager::countEdits(int tableId, const FlowEdit& diffs,
+                               bool written) {
+    if (!progStats) return;
+    size_t counts[FlowEdit::DEL + 1] = {};
+    if (written) {
+        for (const FlowEdit::Entry& e : diffs.edits)
+            counts[e.first] += 1;
+    }
+    progStats->countEdits(tableId, counts[FlowEdit::ADD],
+                          counts[FlowEdit::MOD], counts[FlowEdit::DEL],
+                          flowTables[tableId].flowCount());
+}
+
+void SwitchManager::onWriteComplete(int status, size_t changes) {
+    if (status == 0 || stopping) return;
+    // the table state already holds the rejected changes, so reconcile
+    // the switch with it; a lost connection is synced on reconnect
+    LOG(ERROR) << "[" << connection->getSwitchName() << "] "
+               << "Writing " << changes
+               << " flow and group changes failed with error " << status;
+    if (status != ENOTCONN) {
+        ioService->post(bind(&SwitchManager::initiateSync, this));
+    }
+}
+
+void SwitchManager::beginBatch() {
+    const lock_guard<recursive_mutex> lock(sm_mutex);
+    batches[std::this_thread::get_id()].depth += 1;
+}
+
+bool SwitchManager::endBatch() {
+    const lock_guard<recursive_mutex> lock(sm_mutex);
+    auto it = batches.find(std::this_thread::get_id());
+    if (it == batches.end() || --it->second.depth > 0)
+        return true;
+    flushBatch();
+    bool success = it->second.success;
+    batches.erase(it);
+    return success;
+}
+
+bool SwitchManager::writeFlows(int tableId,
+                               std::vector<std::pair<std::string,
+                                                     FlowEntryList> >& objs) {
+    const lock_guard<recursive_mutex> lock(sm_mutex);
+    bool success = true;
+
+    assert(tableId >= 0 &&
+           static_cast<size_t>(tableId) < flowTables.size());
+    TableState& tab = flowTables[tableId];
+
+    FlowEdit diffs;
+    for (auto& obj : objs) {
+        for (FlowEntryPtr& fe : obj.second)
+            fe->entry->table_id = tableId;
+        FlowEdit objDiffs;
+        tab.apply(obj.first, obj.second, objDiffs);
+        diffs.edits.insert(diffs.edits.end(),
+                           objDiffs.edits.begin(), objDiffs.edits.end());
+        obj.second.clear();
+    }
+    countEdits(tableId, diffs, !syncing);
+    if (!syncing) {
+        success = executeFlows(diffs, std::to_string(objs.size()) +
+                               " objects");
+    }
+
+    return success;
+}
+
 bool SwitchManager::writeFlow(const std::string& objId,
                               int tableId, FlowEntryPtr el) {
     FlowEntryList tmpEl;
@@ -214,8 +440,16 @@ bool SwitchManager::writeFlow(const std::string& objId,
 }
 
 bool SwitchManager::clearFlows(const std::string& objId, int tableId) {
-    FlowEntryList empty;
-    return writeFlow(objId, tableId, empty);
+    const lock_guard<recursive_mutex> lock(sm_mutex);
+    assert(tableId >= 0 &&
+           static_cast<size_t>(tableId) < flowTables.size());
+
+    FlowEdit diffs;
+    flowTables[tableId].clear(objId, diffs);
+    countEdits(tableId, diffs, !syncing);
+    if (syncing || diffs.edits.empty())
+        return true;
+    return executeFlows(diffs, objId);
 }
 
 bool SwitchManager::writeGroupMod(const GroupEdit::Entry& e) {
@@ -226,12 +460,33 @@ bool SwitchManager::writeGroupMod(const GroupEdit::Entry& e) {
         return true;
     }
 
+    if (inBatch()) {
+        // a second change to the same group must not be reordered
+        // with the first one, so send the changes collected so far
+        auto sameGroup = [&e](const GroupEdit::Entry& pe) {
+            return pe->mod->group_id == e->mod->group_id;
+        };
+        if (std::any_of(batchGroupsBefore.edits.begin(),
+                        batchGroupsBefore.edits.end(), sameGroup) ||
+            std::any_of(batchGroupsAfter.edits.begin(),
+                        batchGroupsAfter.edits.end(), sameGroup))
+            flushBatch();
+        addGroupEdits(e, e->mod->command == OFPGC11_DELETE
+                      ? batchGroupsAfter.edits
+                      : batchGroupsBefore.edits);
+        return true;
+    }
+
+    flushBatch();
     GroupEdit ge;
-    ge.edits.push_back(e);
+    addGroupEdits(e, ge.edits);
+    if (ge.edits.empty())
+        return true;
     bool success = flowExecutor.Execute(ge);
     if (!success) {
         LOG(ERROR) << "[" << connection->getSwitchName() << "] "
                    << "Group mod failed for group-id=" << e->mod->group_id;
+        groupState.erase(e->mod->group_id);
     }
     return success;
 }
@@ -243,6 +498,7 @@ bool SwitchManager::writeTlv(const std::string& objId, TlvEntryList& el) {
     TlvEdit diffs;
     tlvTable.apply(objId, el, diffs);
     if (!syncing) {
+        flushBatch();
         // If a sync is in progress, don't write to the flow tables
         // while we are reading and reconciling with the current
         // flows.
@@ -315,8 +571,21 @@ void SwitchManager::gotFlows(int tableId, const FlowEntryList& flows,
     assert(tableId >= 0 &&
            static_cast<size_t>(tableId) < flowTables.size());
 
+    // Keep the table's own entry instead of each flow that already
+    // matches it, so that the flows read are released as the replies
+    // come in.  Entries kept this way still diff correctly if the
+    // table changes before the dump completes.
     FlowEntryList& fl = recvFlows[tableId];
-    fl.insert(fl.end(), flows.begin(), flows.end());
+    const TableState& tab = flowTables[tableId];
+    for (const FlowEntryPtr& fe : flows) {
+        uint64_t hash;
+        FlowEntryPtr same = tab.findEqual(*fe, &hash);
+        if (same)
+            recvHash[tableId] += hash;
+        else
+            recvChanged[tableId] = true;
+        fl.push_back(same ? same : fe);
+    }
     tableDone[tableId] = done;
     if (done) {
         LOG(DEBUG) << "[" << connection->getSwitchName() << "] "
@@ -351,8 +620,7 @@ void SwitchManager::checkRecvDone() {
     if (allDone) {
         LOG(DEBUG) << "[" << connection->getSwitchName() << "] "
                    << "Got all group,flow and tlv tables, starting reconciliation";
-        agent.getAgentIOService()
-            .dispatch(bind(&SwitchManager::completeSync, this));
+        ioService->dispatch(bind(&SwitchManager::completeSync, this));
     }
 }
 
@@ -360,11 +628,23 @@ void SwitchManager::completeSync() {
     const lock_guard<recursive_mutex> lock(sm_mutex);
     assert(syncInProgress == true);
     if (stateHandler) {
+        // the groups on the switch, which reconciliation consumes
+        SwitchStateHandler::GroupMap current;
+        if (useBucketEdits())
+            current = recvGroups;
         GroupEdit ge = stateHandler->reconcileGroups(recvGroups);
+        groupState.swap(current);
+        if (useBucketEdits()) {
+            GroupEdit::EntryList edits;
+            for (const GroupEdit::Entry& e : ge.edits)
+                addGroupEdits(e, edits);
+            ge.edits.swap(edits);
+        }
         bool success = flowExecutor.Execute(ge);
         if (!success) {
             LOG(ERROR) << "[" << connection->getSwitchName() << "] "
                        << "Failed to execute group table changes";
+            groupState.clear();
         }
 
         TlvEdit te_diffs =
@@ -375,16 +655,63 @@ void SwitchManager::completeSync() {
                        << "Failed to execute diffs on tlv table";
         }
 
-        std::vector<FlowEdit> diffs =
-            stateHandler->reconcileFlows(flowTables, recvFlows);
+        // reconcile one table at a time against the table state in
+        // place, releasing the flows read for a table once its diffs
+        // are written
+        std::vector<std::pair<size_t, FlowEdit> > deferred;
         for (size_t i = 0; i < flowTables.size(); ++i) {
-            success = flowExecutor.Execute(diffs[i]);
+            // every flow read was in the table when it came in, and
+            // the table still holds the same flows
+            if (!recvChanged[i] &&
+                recvFlows[i].size() == flowTables[i].flowCount() &&
+                recvHash[i] == flowTables[i].contentHash()) {
+                LOG(DEBUG) << "[" << connection->getSwitchName() << "] "
+                           << "Table=" << i << " is unchanged";
+                FlowEntryList().swap(recvFlows[i]);
+                continue;
+            }
+            FlowEdit diffs =
+                stateHandler->reconcileTable(i, flowTables[i], recvFlows[i]);
+            FlowEntryList().swap(recvFlows[i]);
+            countEdits(i, diffs, true);
+
+            FlowEdit later;
+            auto it = std::stable_partition(diffs.edits.begin(),
+                                            diffs.edits.end(),
+                                            [this, i](const FlowEdit::Entry& e) {
+                return !stateHandler->isDeferredSyncEdit(i, e);
+            });
+            later.edits.assign(it, diffs.edits.end());
+            diffs.edits.erase(it, diffs.edits.end());
+            if (!later.edits.empty())
+                deferred.emplace_back(i, std::move(later));
+
+            success = flowExecutor.Execute(diffs);
             if (!success) {
                 LOG(ERROR) << "[" << connection->getSwitchName() << "] "
                            << "Failed to execute diffs on table=" << i;
             }
         }
 
+        // then the counting and logging flows, in batches so that no
+        // single write holds up the switch
+        for (const auto& d : deferred) {
+            const std::vector<FlowEdit::Entry>& edits = d.second.edits;
+            for (size_t pos = 0; pos < edits.size();
+                 pos += DEFERRED_SYNC_BATCH) {
+                FlowEdit batch;
+                batch.edits.assign(edits.begin() + pos,
+                                   edits.begin() +
+                                   std::min(edits.size(),
+                                            pos + DEFERRED_SYNC_BATCH));
+                if (!flowExecutor.Execute(batch)) {
+                    LOG(ERROR) << "[" << connection->getSwitchName() << "] "
+                               << "Failed to execute deferred diffs on table="
+                               << d.first;
+                }
+            }
+        }
+
     }
 
     clearSyncState();
@@ -392,21 +719,28 @@ void SwitchManager::completeSync() {
     if (stateHandler) {
         stateHandler->completeSync();
     }
+    // the flows and groups read from the switch have been freed, so
+    // return the memory they held to the system
+    AllocStats::releaseFreeMemory();
     syncInProgress = false;
     syncing = false;
 
     LOG(INFO) << "[" << connection->getSwitchName() << "] "
               <<"Sync complete";
+    agent.getStartupTimeline().mark("first-flows-programmed");
+    agent.getStartupTimeline().mark("flows-synced " +
+                                    connection->getSwitchName());
 
     if (syncPending) {
-        agent.getAgentIOService()
-            .dispatch(bind(&SwitchManager::initiateSync, this));
+        ioService->dispatch(bind(&SwitchManager::initiateSync, this));
     }
 }
 
 void SwitchManager::clearSyncState() {
     for (size_t i = 0; i < flowTables.size(); ++i) {
         recvFlows[i].clear();
+        recvHash[i] = 0;
+        recvChanged[i] = false;
         tableDone[i] = false;
     }
     recvGroups.clear();
@@ -12,17 +12,16 @@
 
 namespace opflexagent {
 
-std::vector<FlowEdit>
-SwitchStateHandler::reconcileFlows(std::vector<TableState> flowTables,
-                                   std::vector<FlowEntryList>& recvFlows) {
-    std::vector<FlowEdit> diffs(flowTables.size());
-    for (size_t i = 0; i < flowTables.size(); ++i) {
-        flowTables[i].diffSnapshot(recvFlows[i], diffs[i]);
-        LOG(DEBUG) << "Table=" << i << ", snapshot has "
-                   << diffs[i].edits.size() << " diff(s)";
-        for (const FlowEdit::Entry& e : diffs[i].edits) {
-            LOG(DEBUG) << e;
-        }
+FlowEdit
+SwitchStateHandler::reconcileTable(int tableId,
+                                   const TableState& tableState,
+                                   FlowEntryList& recvFlows) {
+    FlowEdit diffs;
+    tableState.diffSnapshot(recvFlows, diffs);
+    LOG(DEBUG) << "Table=" << tableId << ", snapshot has "
+               << diffs.edits.size() << " diff(s)";
+    for (const FlowEdit::Entry& e : diffs.edits) {
+        LOG(DEBUG) << e;
     }
 
     return diffs;
@@ -33,7 +32,7 @@ GroupEdit SwitchStateHandler::reconcileGroups(GroupMap& recvGroups) {
 }
 
 TlvEdit
-SwitchStateHandler::reconcileTlvs(TableState tlvTable,
+SwitchStateHandler::reconcileTlvs(const TableState& tlvTable,
                                   TlvEntryList& recvTlvs) {
     TlvEdit diffs;
     tlvTable.diffSnapshot(recvTlvs, diffs);
@@ -109,7 +109,8 @@ void BaseTableDropStatsManager::start(bool register_listener) {
     PolicyStatsManager::start(register_listener);
     {
         std::lock_guard<std::mutex> lock(timer_mutex);
-        timer->async_wait(bind(&BaseTableDropStatsManager::on_timer, this, error));
+        timer->async_wait(strand->wrap(
+            bind(&BaseTableDropStatsManager::on_timer, this, error)));
     }
 }
 
@@ -266,6 +267,11 @@ void BaseTableDropStatsManager::on_timer(const boost::system::error_code& ec) {
         return;
     }
 
+    // Update the counters of every table in one transaction
+    Mutator mutator(agent->getFramework(), "policyelement");
+    optional<shared_ptr<PolicyStatUniverse> > su =
+        PolicyStatUniverse::resolve(agent->getFramework());
+    AgentPrometheusManager &prometheusManager = agent->getPrometheusManager();
     for(const auto& tbl_it: tableDescMap) {
         uint64_t packet_count=0, byte_count=0;
         TableState::cookie_callback_t cb_func;
@@ -291,9 +297,6 @@ void BaseTableDropStatsManager::on_timer(const boost::system::error_code& ec) {
             }
         }
 
-        Mutator mutator(agent->getFramework(), "policyelement");
-        optional<shared_ptr<PolicyStatUniverse> > su =
-            PolicyStatUniverse::resolve(agent->getFramework());
         if (su) {
             su.get()->addGbpeTableDropCounter(getAgentUUID(),
                                  connection->getSwitchName(),
@@ -301,24 +304,30 @@ void BaseTableDropStatsManager::on_timer(const boost::system::error_code& ec) {
                 ->setPackets(packet_count)
                 .setBytes(byte_count);
         }
-        mutator.commit();
-        AgentPrometheusManager &prometheusManager = agent->getPrometheusManager();
         prometheusManager.updateTableDropGauge(connection->getSwitchName(),
                                                 tbl_it.second.first,
                                                 byte_count,
                                                 packet_count);
     }
-
-    for(const auto& tbl_it: tableDescMap) {
-        sendRequest(tbl_it.first, flow::cookie::TABLE_DROP_FLOW,
-                flow::cookie::TABLE_DROP_FLOW);
-
+    mutator.commit();
+
+    if (singleRequest) {
+        // The replies carry the table of each drop flow, so one
+        // request covers every table
+        sendRequest(OFPTT_ALL, flow::cookie::TABLE_DROP_FLOW,
+                    flow::cookie::TABLE_DROP_FLOW);
+    } else {
+        for(const auto& tbl_it: tableDescMap) {
+            sendRequest(tbl_it.first, flow::cookie::TABLE_DROP_FLOW,
+                    flow::cookie::TABLE_DROP_FLOW);
+        }
     }
     if (!stopping) {
         std::lock_guard<std::mutex> lock(timer_mutex);
         if(timer) {
             timer->expires_from_now(milliseconds(timer_interval));
-            timer->async_wait(bind(&BaseTableDropStatsManager::on_timer, this, error));
+            timer->async_wait(strand->wrap(
+                bind(&BaseTableDropStatsManager::on_timer, this, error)));
         }
     }
 }
@@ -350,12 +359,16 @@ void BaseTableDropStatsManager::Handle(SwitchConnection* connection,
                                   ofpbuf *msg,
                                   struct ofputil_flow_removed* fentry) {
     handleMessage(msgType, msg,
-        [this](uint32_t table_id) -> flowCounterState_t* {
-            if(tableDescMap.find(table_id)!= tableDescMap.end())
-                return &CurrentDropCounterState[table_id];
-            else
-                return NULL;
+        [this](uint32_t table_id) {
+            return getCounterState(table_id);
         }, fentry);
 }
 
+flowCounterState_t*
+BaseTableDropStatsManager::getCounterState(uint32_t tableId) {
+    if (tableDescMap.find(tableId) != tableDescMap.end())
+        return &CurrentDropCounterState[tableId];
+    return NULL;
+}
+
 } /* namespace opflexagent */
@@ -6,8 +6,11 @@
  * and is available at http://www.eclipse.org/legal/epl-v10.html
  */
 
+#include <cstdlib>
+#include <cstring>
 #include <unordered_map>
 #include <unordered_set>
+#include <mutex>
 
 #include <boost/functional/hash.hpp>
 
@@ -18,11 +21,30 @@
 
 namespace opflexagent {
 
+/*
+ * The key of a flow in the table state: its priority and its match,
+ * packed into a minimatch that the copies of the key share
+ */
 struct match_key_t {
+    match_key_t(uint16_t prio_, const struct match& m);
+
     uint16_t prio;
-    struct match match;
+    size_t hash;
+    std::shared_ptr<const struct minimatch> match;
 };
 
+match_key_t::match_key_t(uint16_t prio_, const struct match& m)
+    : prio(prio_) {
+    struct minimatch* mm = new minimatch;
+    minimatch_init(mm, &m);
+    match.reset(mm, [](struct minimatch* p) {
+            minimatch_destroy(p);
+            delete p;
+        });
+    hash = minimatch_hash(mm, 0);
+    boost::hash_combine(hash, prio);
+}
+
 struct tlv_key_t {
      uint16_t option_class;
      uint16_t option_type;
@@ -33,9 +55,7 @@ namespace std {
 
 template<> struct hash<opflexagent::match_key_t> {
     size_t operator()(const opflexagent::match_key_t& match_key) const noexcept {
-        size_t hashv = match_hash(&match_key.match, 0);
-        boost::hash_combine(hashv, match_key.prio);
-        return hashv;
+        return match_key.hash;
     }
 };
 
@@ -67,12 +87,86 @@ FlowEntry::FlowEntry() {
 }
 
 FlowEntry::~FlowEntry() {
-    if (entry->ofpacts) {
+    if (entry->ofpacts && !sharedActions) {
         free((void *)entry->ofpacts);
     }
     free(entry);
 }
 
+namespace {
+
+/*
+ * Pool of the action lists of the flows kept in table states, so that
+ * the many flows with the same actions share one copy
+ */
+class ActionPool {
+public:
+    struct Actions {
+        const ofpact* ofpacts;
+        size_t len;
+        size_t hash;
+    };
+
+    static ActionPool& instance() {
+        // never destroyed, since entries may outlive static objects
+        static ActionPool* pool = new ActionPool();
+        return *pool;
+    }
+
+    /* Share the actions of the entry with those of other entries */
+    void intern(FlowEntry& fe) {
+        ofputil_flow_stats& flow = *fe.entry;
+        if (fe.sharedActions || !flow.ofpacts || flow.ofpacts_len == 0)
+            return;
+        size_t hash =
+            boost::hash_range((const char*)flow.ofpacts,
+                              (const char*)flow.ofpacts + flow.ofpacts_len);
+
+        std::lock_guard<std::mutex> guard(mutex);
+        auto range = pool.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            std::shared_ptr<const Actions> acts = it->second.second.lock();
+            if (acts && action_equal(acts->ofpacts, acts->len,
+                                     flow.ofpacts, flow.ofpacts_len)) {
+                free((void *)flow.ofpacts);
+                flow.ofpacts = acts->ofpacts;
+                fe.sharedActions = acts;
+                return;
+            }
+        }
+
+        Actions* acts = new Actions{flow.ofpacts, flow.ofpacts_len, hash};
+        std::shared_ptr<const Actions> shared(acts, [this](Actions* a) {
+                release(a);
+            });
+        pool.emplace(hash, std::make_pair(acts, shared));
+        fe.sharedActions = shared;
+    }
+
+private:
+    void release(Actions* acts) {
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            auto range = pool.equal_range(acts->hash);
+            for (auto it = range.first; it != range.second; ++it) {
+                if (it->second.first == acts) {
+                    pool.erase(it);
+                    break;
+                }
+            }
+        }
+        free((void *)acts->ofpacts);
+        delete acts;
+    }
+
+    std::mutex mutex;
+    std::unordered_multimap<size_t,
+                            std::pair<const Actions*,
+                                      std::weak_ptr<const Actions>>> pool;
+};
+
+} /* anonymous namespace */
+
 bool
 FlowEntry::matchEq(const FlowEntry *rhs) {
     const ofputil_flow_stats *feRhs = rhs->entry;
@@ -159,6 +253,111 @@ bool GroupEdit::groupEq(const GroupEdit::Entry& lhs,
     return group_mod_equal(lhs->mod, rhs->mod);
 }
 
+static ofputil_bucket* clone_bucket(const ofputil_bucket* bkt) {
+    ofputil_bucket* copy = (ofputil_bucket*)malloc(sizeof(ofputil_bucket));
+    *copy = *bkt;
+    copy->ofpacts = NULL;
+    if (bkt->ofpacts_len > 0) {
+        copy->ofpacts = (struct ofpact*)malloc(bkt->ofpacts_len);
+        memcpy(copy->ofpacts, bkt->ofpacts, bkt->ofpacts_len);
+    }
+    return copy;
+}
+
+static bool bucket_equal(const ofputil_bucket* lhs,
+                         const ofputil_bucket* rhs) {
+    return lhs->weight == rhs->weight &&
+        lhs->watch_port == rhs->watch_port &&
+        lhs->watch_group == rhs->watch_group &&
+        action_equal(lhs->ofpacts, lhs->ofpacts_len,
+                     rhs->ofpacts, rhs->ofpacts_len);
+}
+
+GroupEdit::Entry GroupEdit::clone(const GroupEdit::Entry& entry) {
+    GroupEdit::Entry copy(new GroupEdit::GroupMod());
+    copy->mod->command = entry->mod->command;
+    copy->mod->type = entry->mod->type;
+    copy->mod->group_id = entry->mod->group_id;
+    copy->mod->command_bucket_id = entry->mod->command_bucket_id;
+    const ofputil_bucket* bkt;
+    LIST_FOR_EACH (bkt, list_node, &entry->mod->buckets) {
+        ovs_list_push_back(&copy->mod->buckets,
+                           &clone_bucket(bkt)->list_node);
+    }
+    return copy;
+}
+
+bool GroupEdit::bucketEdits(const GroupEdit::Entry& current,
+                            const GroupEdit::Entry& target,
+                            GroupEdit::EntryList& edits) {
+    const ofputil_group_mod& cur = *current->mod;
+    const ofputil_group_mod& tgt = *target->mod;
+    if (tgt.command != OFPGC11_MODIFY || cur.group_id != tgt.group_id ||
+        cur.type != tgt.type || tgt.type == OFPGT11_FF ||
+        ovs_list_is_empty(&tgt.buckets))
+        return false;
+
+    std::unordered_map<uint32_t, const ofputil_bucket*> curBuckets;
+    const ofputil_bucket* bkt;
+    LIST_FOR_EACH (bkt, list_node, &cur.buckets) {
+        if (!curBuckets.emplace(bkt->bucket_id, bkt).second)
+            return false;
+    }
+
+    // buckets of the target that are new or changed, and the IDs of
+    // the current buckets to remove
+    std::vector<const ofputil_bucket*> inserted;
+    std::vector<uint32_t> removed;
+    std::unordered_set<uint32_t> tgtIds;
+    size_t tgtCount = 0;
+    LIST_FOR_EACH (bkt, list_node, &tgt.buckets) {
+        tgtCount += 1;
+        if (!tgtIds.insert(bkt->bucket_id).second ||
+            bkt->bucket_id > OFPG15_BUCKET_MAX)
+            return false;
+        auto it = curBuckets.find(bkt->bucket_id);
+        if (it == curBuckets.end()) {
+            inserted.push_back(bkt);
+        } else if (!bucket_equal(it->second, bkt)) {
+            removed.push_back(bkt->bucket_id);
+            inserted.push_back(bkt);
+        }
+    }
+    LIST_FOR_EACH (bkt, list_node, &cur.buckets) {
+        if (tgtIds.find(bkt->bucket_id) == tgtIds.end())
+            removed.push_back(bkt->bucket_id);
+    }
+
+    if (inserted.empty() && removed.empty())
+        return true;
+    // the edits must be fewer messages and buckets than the whole
+    // group
+    if (removed.size() + inserted.size() >= tgtCount)
+        return false;
+
+    for (uint32_t bucketId : removed) {
+        GroupEdit::Entry e(new GroupEdit::GroupMod());
+        e->mod->command = OFPGC15_REMOVE_BUCKET;
+        e->mod->type = tgt.type;
+        e->mod->group_id = tgt.group_id;
+        e->mod->command_bucket_id = bucketId;
+        edits.push_back(e);
+    }
+    if (!inserted.empty()) {
+        GroupEdit::Entry e(new GroupEdit::GroupMod());
+        e->mod->command = OFPGC15_INSERT_BUCKET;
+        e->mod->type = tgt.type;
+        e->mod->group_id = tgt.group_id;
+        e->mod->command_bucket_id = OFPG15_BUCKET_LAST;
+        for (const ofputil_bucket* b : inserted) {
+            ovs_list_push_back(&e->mod->buckets,
+                               &clone_bucket(b)->list_node);
+        }
+        edits.push_back(e);
+    }
+    return true;
+}
+
 ostream & operator<<(ostream& os, const GroupEdit::Entry& ge) {
     static const char *groupTypeStr[] = {"all", "select", "indirect",
         "ff", "unknown" };
@@ -167,14 +366,21 @@ ostream & operator<<(ostream& os, const GroupEdit::Entry& ge) {
     case OFPGC11_ADD:      os << "ADD"; break;
     case OFPGC11_MODIFY:   os << "MOD"; break;
     case OFPGC11_DELETE:   os << "DEL"; break;
+    case OFPGC15_INSERT_BUCKET: os << "INSERT_BUCKET"; break;
+    case OFPGC15_REMOVE_BUCKET: os << "REMOVE_BUCKET"; break;
     default:               os << "Unknown";
     }
     os << "|group_id=" << mod.group_id << ",type="
        << groupTypeStr[std::min<uint8_t>(4, mod.type)];
+    if (mod.command == OFPGC15_REMOVE_BUCKET)
+        os << ",command_bucket_id=" << mod.command_bucket_id;
 
     ofputil_bucket *bkt;
     LIST_FOR_EACH (bkt, list_node, &mod.buckets) {
-        os << ",bucket=bucket_id:" << bkt->bucket_id << ",actions=";
+        os << ",bucket=bucket_id:" << bkt->bucket_id;
+        if (mod.type == OFPGT11_SELECT)
+            os << ",weight:" << bkt->weight;
+        os << ",actions=";
         DsP str;
         format_action(bkt->ofpacts, bkt->ofpacts_len, str.get());
         os << ds_cstr(str.get());
@@ -185,7 +391,8 @@ ostream & operator<<(ostream& os, const GroupEdit::Entry& ge) {
 /** TableState **/
 
 typedef std::vector<FlowEntryPtr> flow_vec_t;
-typedef std::pair<std::string, FlowEntryPtr> obj_id_flow_t;
+// the object ID points to the key of the object in the entry map
+typedef std::pair<const std::string*, FlowEntryPtr> obj_id_flow_t;
 typedef std::vector<obj_id_flow_t> obj_id_flow_vec_t;
 typedef std::unordered_map<match_key_t, obj_id_flow_vec_t> match_obj_map_t;
 typedef std::unordered_map<match_key_t, flow_vec_t> match_map_t;
@@ -200,7 +407,9 @@ typedef std::unordered_map<std::string, match_tlv_opt_map_t> tlv_entry_map_t;
 typedef std::unordered_map<tlv_key_t, obj_id_tlv_vec_t> match_obj_tlv_map_t;
 
 bool operator==(const match_key_t& lhs, const match_key_t& rhs) {
-    return lhs.prio == rhs.prio && match_equal(&lhs.match, &rhs.match);
+    return lhs.prio == rhs.prio && lhs.hash == rhs.hash &&
+        (lhs.match == rhs.match ||
+         minimatch_equal(lhs.match.get(), rhs.match.get()));
 }
 bool operator!=(const match_key_t& lhs, const match_key_t& rhs) {
     return !(lhs == rhs);
@@ -214,13 +423,55 @@ bool operator!=(const tlv_key_t& lhs, const tlv_key_t& rhs) {
     return !(lhs == rhs);
 }
 
+// the hash of the content of a flow that diffSnapshot compares
+static uint64_t flow_content_hash(const match_key_t& key,
+                                  const FlowEntry& fe) {
+    size_t hashv = key.hash;
+    boost::hash_combine(hashv, fe.entry->cookie);
+    boost::hash_combine(hashv, fe.entry->flags);
+    const uint8_t* acts = (const uint8_t*)fe.entry->ofpacts;
+    boost::hash_combine(hashv,
+                        boost::hash_range(acts,
+                                          acts + fe.entry->ofpacts_len));
+    return hashv;
+}
+
 class TableState::TableStateImpl {
 public:
+    TableStateImpl() : content_hash(0) {}
+    TableStateImpl(const TableStateImpl& ts)
+        : entry_map(ts.entry_map), match_obj_map(ts.match_obj_map),
+          cookie_map(ts.cookie_map), tlv_entry_map(ts.tlv_entry_map),
+          match_obj_tlv_map(ts.match_obj_tlv_map),
+          content_hash(ts.content_hash) {
+        // point the object IDs to the keys of this entry map
+        for (match_obj_map_t::value_type& e : match_obj_map) {
+            for (obj_id_flow_t& of : e.second) {
+                of.first = &entry_map.find(*of.first)->first;
+            }
+        }
+    }
+
     entry_map_t entry_map;
     match_obj_map_t match_obj_map;
     cookie_map_t cookie_map;
     tlv_entry_map_t tlv_entry_map;
     match_obj_tlv_map_t match_obj_tlv_map;
+    // the sum of the content hashes of the flows in the flow table,
+    // which does not depend on their order
+    uint64_t content_hash;
+
+    void flowAdded(const match_key_t& key, const FlowEntryPtr& fe) {
+        content_hash += flow_content_hash(key, *fe);
+    }
+    void flowRemoved(const match_key_t& key, const FlowEntryPtr& fe) {
+        content_hash -= flow_content_hash(key, *fe);
+    }
+
+    // remove the flow of an object with the given key, adding the
+    // diffs if the flow is the one in the flow table
+    void remove(const std::string* oid, const match_key_t& key,
+                FlowEdit& diffs);
 };
 
 TableState::TableState() : pimpl(new TableStateImpl()) { }
@@ -247,9 +498,7 @@ void TableState::diffSnapshot(const FlowEntryList& oldEntries,
 
     old_entry_map_t old_entries;
     for (const FlowEntryPtr& fe : oldEntries) {
-        match_key_t key;
-        key.prio = fe->entry->priority;
-        key.match = fe->entry->match;
+        match_key_t key(fe->entry->priority, fe->entry->match);
         old_entries[key] = make_pair(false, fe);
     }
 
@@ -280,6 +529,23 @@ void TableState::diffSnapshot(const FlowEntryList& oldEntries,
     }
 }
 
+FlowEntryPtr TableState::findEqual(const FlowEntry& oldEntry,
+                                   uint64_t* hash) const {
+    match_key_t key(oldEntry.entry->priority, oldEntry.entry->match);
+    match_obj_map_t::const_iterator it = pimpl->match_obj_map.find(key);
+    if (it == pimpl->match_obj_map.end())
+        return FlowEntryPtr();
+
+    const FlowEntryPtr& e = it->second.front().second;
+    if (e->entry->cookie != oldEntry.entry->cookie ||
+        !e->actionEq(&oldEntry) ||
+        e->entry->flags != oldEntry.entry->flags)
+        return FlowEntryPtr();
+    if (hash)
+        *hash = flow_content_hash(key, *e);
+    return e;
+}
+
 void TableState::diffSnapshot(const TlvEntryList& oldEntries,
                               TlvEdit& diffs) const {
     typedef std::pair<bool, TlvEntryPtr> visited_te_t;
@@ -318,10 +584,25 @@ void TableState::diffSnapshot(const TlvEntryList& oldEntries,
     }
 }
 
+size_t TableState::flowCount() const {
+    return pimpl->match_obj_map.size();
+}
+
+uint64_t TableState::contentHash() const {
+    return pimpl->content_hash;
+}
+
+uint64_t TableState::entryHash(const FlowEntry& entry) {
+    match_key_t key(entry.entry->priority, entry.entry->match);
+    return flow_content_hash(key, entry);
+}
+
 void TableState::forEachCookieMatch(cookie_callback_t& cb) const {
     for (const auto& cookies : pimpl->cookie_map) {
         for (const auto& match_key : cookies.second) {
-            cb(ovs_ntohll(cookies.first), match_key.prio, match_key.match);
+            struct match match;
+            minimatch_expand(match_key.match.get(), &match);
+            cb(ovs_ntohll(cookies.first), match_key.prio, match);
         }
     }
 }
@@ -346,20 +627,95 @@ static void updateCookieMap(cookie_map_t& cookie_map,
     }
 }
 
+void TableState::TableStateImpl::remove(const std::string* oid,
+                                        const match_key_t& key,
+                                        FlowEdit& diffs) {
+    match_obj_map_t::iterator oit = match_obj_map.find(key);
+    if (oit == match_obj_map.end())
+        return;
+
+    if (oit->second.front().first == oid) {
+        // this object is the one in the flow table, so remove it
+        FlowEntryPtr& todel = oit->second.front().second;
+
+        if (oit->second.size() == 1) {
+            // No conflicted entries queued
+            updateCookieMap(cookie_map, todel->entry->cookie, 0, key);
+            flowRemoved(key, todel);
+
+            diffs.add(FlowEdit::DEL, todel);
+            match_obj_map.erase(oit);
+        } else {
+            // Need to add the next entry back to the table now that
+            // the first instance is removed
+            FlowEntryPtr& old = oit->second[0].second;
+            FlowEntryPtr& tomod = oit->second[1].second;
+
+            updateCookieMap(cookie_map, old->entry->cookie,
+                            tomod->entry->cookie, key);
+            flowRemoved(key, old);
+            flowAdded(key, tomod);
+
+            if (!todel->actionEq(tomod.get()))
+                diffs.add(FlowEdit::MOD, tomod);
+            oit->second.erase(oit->second.begin());
+        }
+    } else {
+        // This object is queued behind another object.  Just remove
+        // it without generating diff.
+        obj_id_flow_vec_t::iterator fvit = oit->second.begin()+1;
+        while (fvit != oit->second.end()) {
+            if (fvit->first == oid)
+                fvit = oit->second.erase(fvit);
+            else
+                ++fvit;
+        }
+    }
+}
+
+void TableState::clear(const std::string& objId,
+                       /* out */ FlowEdit& diffs) {
+    diffs.edits.clear();
+
+    entry_map_t::iterator itr = pimpl->entry_map.find(objId);
+    if (itr == pimpl->entry_map.end())
+        return;
+    const std::string* oid = &itr->first;
+
+    for (match_map_t::value_type& e : itr->second)
+        pimpl->remove(oid, e.first, diffs);
+
+    if (!diffs.edits.empty()) {
+        LOG(DEBUG) << "ObjId=" << objId << ", #diffs = " << diffs.edits.size();
+        for (const FlowEdit::Entry& e : diffs.edits) {
+            LOG(DEBUG) << e;
+        }
+    }
+    pimpl->entry_map.erase(itr);
+}
+
 void TableState::apply(const std::string& objId,
                        FlowEntryList& newEntries,
                        /* out */ FlowEdit& diffs) {
     diffs.edits.clear();
 
+    // the entry map node of the object stays in place while the
+    // object has flows, so its key stands for the object ID
+    entry_map_t::iterator itr =
+        pimpl->entry_map.emplace(objId, match_map_t()).first;
+    const std::string* oid = &itr->first;
+
     match_map_t new_entries;
     for (const FlowEntryPtr& fe : newEntries) {
-
-        match_key_t key;
-        key.prio = fe->entry->priority;
-        key.match = fe->entry->match;
+        ActionPool::instance().intern(*fe);
+        match_key_t key(fe->entry->priority, fe->entry->match);
         new_entries[key].push_back(fe);
     }
 
+    // the new entries of the object, keyed by the same keys as the
+    // flows already in the table
+    match_map_t stored_entries;
+
     // load new entries
     for (match_map_t::value_type& e : new_entries) {
         // check if there's an overlapping match already in the table
@@ -368,7 +724,7 @@ void TableState::apply(const std::string& objId,
         if (oit != pimpl->match_obj_map.end()) {
             // there is an existing entry
             FlowEntryPtr& tomod = e.second.back();
-            if (oit->second.front().first == objId) {
+            if (oit->second.front().first == oid) {
                 // it's for the same object ID.  Replace it.
                 updateCookieMap(pimpl->cookie_map,
                                 oit->second.front().second->entry->cookie,
@@ -378,10 +734,14 @@ void TableState::apply(const std::string& objId,
                         != tomod->entry->cookie) {
                     diffs.add(FlowEdit::DEL, oit->second.front().second);
                     diffs.add(FlowEdit::ADD, tomod);
+                    pimpl->flowRemoved(e.first, oit->second.front().second);
+                    pimpl->flowAdded(e.first, tomod);
                     oit->second.front().second = tomod;
                 } else if (!oit->second.front().second->actionEq(tomod.get()) ||
                            (oit->second.front().second->entry->flags
                             != tomod->entry->flags)) {
+                    pimpl->flowRemoved(e.first, oit->second.front().second);
+                    pimpl->flowAdded(e.first, tomod);
                     oit->second.front().second = tomod;
                     diffs.add(FlowEdit::MOD, tomod);
                 }
@@ -393,8 +753,8 @@ void TableState::apply(const std::string& objId,
                 bool found = false;
                 bool actionEq = true;
                 while (fvit != oit->second.end()) {
-                    if (fvit->first == objId) {
-                        *fvit = make_pair(objId, tomod);
+                    if (fvit->first == oid) {
+                        *fvit = make_pair(oid, tomod);
                         found = true;
                         break;
                     } else if (!fvit->second->actionEq(tomod.get())) {
@@ -408,13 +768,14 @@ void TableState::apply(const std::string& objId,
                         // matches with different actions.
                         LOG(WARNING) << "Duplicate match for "
                                      << objId << " (conflicts with "
-                                     << oit->second.front().first << "): "
+                                     << *oit->second.front().first << "): "
                                      << *tomod;
                     }
 
-                    oit->second.emplace_back(objId, tomod);
+                    oit->second.emplace_back(oid, tomod);
                 }
             }
+            stored_entries.emplace(oit->first, std::move(e.second));
         } else {
             // there is no existing entry.  Add a new one
             // Do not save entries with timeouts
@@ -430,66 +791,19 @@ void TableState::apply(const std::string& objId,
                                 0, toadd->entry->cookie,
                                 e.first);
 
-                pimpl->match_obj_map[e.first].push_back(make_pair(objId, toadd));
+                pimpl->match_obj_map[e.first].push_back(make_pair(oid, toadd));
+                pimpl->flowAdded(e.first, toadd);
             }
 
             diffs.add(FlowEdit::ADD, toadd);
+            stored_entries.emplace(e.first, std::move(e.second));
         }
     }
 
     // check for deleted entries
-    entry_map_t::iterator itr = pimpl->entry_map.find(objId);
-    if (itr != pimpl->entry_map.end()) {
-        for (match_map_t::value_type& e : itr->second) {
-            match_map_t::iterator mit = new_entries.find(e.first);
-            if (mit == new_entries.end()) {
-                match_obj_map_t::iterator oit =
-                    pimpl->match_obj_map.find(e.first);
-                if (oit != pimpl->match_obj_map.end()) {
-                    if (oit->second.front().first == objId) {
-                        // this object is the one in the flow table,
-                        // so remove it
-                        FlowEntryPtr& todel = oit->second.front().second;
-
-                        if (oit->second.size() == 1) {
-                            // No conflicted entries queued
-                            updateCookieMap(pimpl->cookie_map,
-                                            todel->entry->cookie, 0,
-                                            e.first);
-
-                            diffs.add(FlowEdit::DEL, todel);
-                            pimpl->match_obj_map.erase(oit);
-                        } else {
-                            // Need to add the next entry back to the
-                            // table now that the first instance is
-                            // removed
-                            FlowEntryPtr& old = oit->second[0].second;
-                            FlowEntryPtr& tomod = oit->second[1].second;
-
-                            updateCookieMap(pimpl->cookie_map,
-                                            old->entry->cookie,
-                                            tomod->entry->cookie,
-                                            e.first);
-
-                            if (!todel->actionEq(tomod.get()))
-                                diffs.add(FlowEdit::MOD, tomod);
-                            oit->second.erase(oit->second.begin());
-                        }
-                    } else {
-                        // This object is queued behind another
-                        // object.  Just remove it without generating
-                        // diff.
-                        obj_id_flow_vec_t::iterator fvit = oit->second.begin()+1;
-                        while (fvit != oit->second.end()) {
-                            if (fvit->first == objId)
-                                fvit = oit->second.erase(fvit);
-                            else
-                                ++fvit;
-                        }
-                    }
-                }
-            }
-        }
+    for (match_map_t::value_type& e : itr->second) {
+        if (new_entries.find(e.first) == new_entries.end())
+            pimpl->remove(oid, e.first, diffs);
     }
 
     if (!diffs.edits.empty()) {
@@ -500,15 +814,10 @@ void TableState::apply(const std::string& objId,
     }
 
     /* newEntries.empty() => delete */
-    if (new_entries.empty() && itr != pimpl->entry_map.end()) {
-        itr->second.swap(new_entries);
+    if (stored_entries.empty()) {
         pimpl->entry_map.erase(itr);
     } else {
-        if (itr == pimpl->entry_map.end()) {
-            pimpl->entry_map[objId].swap(new_entries);
-        } else {
-            itr->second.swap(new_entries);
-        }
+        itr->second.swap(stored_entries);
     }
 }
 
@@ -22,6 +22,13 @@
 #include <opflexagent/TaskQueue.h>
 #include "SwitchStateHandler.h"
 
+#include <boost/asio/io_service.hpp>
+
+#include <map>
+#include <memory>
+#include <set>
+#include <thread>
+
 namespace opflexagent {
 
 class CtZoneManager;
@@ -76,11 +83,48 @@ public:
     void setDropLog(const string& dropLogPort, const string& dropLogRemoteIp,
             const uint16_t dropLogRemotePort);
 
+    /**
+     * Set how long to wait for further changes to a security group
+     * before computing its flows, so that a burst of changes is
+     * computed once
+     *
+     * @param delay the time to wait after the last change, or zero to
+     * compute the flows at once
+     * @param maxDelay the longest time to wait after the first change
+     */
+    void setUpdateDebounce(std::chrono::milliseconds delay,
+                           std::chrono::milliseconds maxDelay);
+
+    /**
+     * Set whether the rules of each security group are written once
+     * as conjunctive matches, which the flows of each security group
+     * set join, instead of once per set the group is in.  System
+     * security groups keep their flows per set.
+     *
+     * @param enabled true to write security group rules as
+     * conjunctive matches
+     */
+    void setConjunctiveSecGroups(bool enabled);
+
+    /**
+     * Set whether the flows of the access bridge are computed, and
+     * the access bridge synced, on a thread of their own rather than
+     * on the agent io thread, so that the access bridge converges
+     * alongside the integration bridge.  Must be called before
+     * start().
+     *
+     * @param enabled true to use a thread of its own
+     */
+    void setDedicatedThread(bool enabled);
+
     /**
      * Handle if the droplog port name is read later
      */
     void handleDropLogPortUpdate();
 
+    /* Interface: SwitchStateHandler */
+    virtual GroupEdit reconcileGroups(GroupMap& recvGroups);
+
     ///@{
     /** Interface: ExtraConfigListener */
     virtual void rdConfigUpdated(const opflex::modb::URI& rdURI);
@@ -92,6 +136,7 @@ public:
 
     /* Interface: EndpointListener */
     virtual void endpointUpdated(const std::string& uuid);
+    virtual void endpointsUpdated(const std::unordered_set<std::string>& uuids);
     virtual void secGroupSetUpdated(const EndpointListener::uri_set_t& secGrps);
 
     /*Interface: QosListener */
@@ -102,6 +147,8 @@ public:
 
     /* Interface: PolicyListener */
     virtual void secGroupUpdated(const opflex::modb::URI&);
+    virtual void secGroupDeltaUpdated(const opflex::modb::URI& uri,
+                                      const SecGroupDelta& delta);
     virtual void configUpdated(const opflex::modb::URI& configURI);
 
     /* Interface: PortStatusListener */
@@ -182,24 +229,194 @@ public:
 private:
     void createStaticFlows();
     void handleEndpointUpdate(const std::string& uuid);
+    void handleEndpointBatch();
     void handleSecGrpUpdate(const opflex::modb::URI& uri);
     void handlePortStatusUpdate(const std::string& portName, uint32_t portNo);
     void handleSecGrpSetUpdate(const EndpointListener::uri_set_t& secGrps,
                                const std::string& secGrpsId);
     void handleDscpQosUpdate(const string& interface, uint8_t dscp);
     bool checkIfSystemSecurityGroup(const string& uri);
+
+    /*
+     * The ingress and egress flows of the rules of a security group
+     * set, by object ID.  The rules of a security group with the same
+     * classifier share an object in each set, so that a rule change
+     * rewrites the objects of its classifier only.
+     */
+    typedef std::unordered_map<std::string,
+                               std::pair<FlowEntryList, FlowEntryList> >
+        SecGrpRuleObjs;
+
+    /**
+     * Compute the flows of a security group rule for a security group
+     * set
+     *
+     * @param rule the rule
+     * @param isSystemRule true to write the flows in the system
+     * security group tables, matching any set
+     * @param secGrpSetId the ID of the set to match, or 0 to match
+     * any set
+     * @param secGrpIn the list to append the ingress flows to
+     * @param secGrpOut the list to append the egress flows to
+     */
+    void addSecGrpRuleFlows(const std::shared_ptr<PolicyRule>& rule,
+                            bool isSystemRule,
+                            uint32_t secGrpSetId,
+                            /* out */ FlowEntryList& secGrpIn,
+                            /* out */ FlowEntryList& secGrpOut);
+
+    /**
+     * Compute the flows of the rules of a security group for a
+     * security group set, in the system security group tables for a
+     * system security group
+     *
+     * @param secGrp the URI of the security group
+     * @param secGrpSetId the ID of the set to match, or 0 to match
+     * any set
+     * @param secGrpIn the list to append the ingress flows to
+     * @param secGrpOut the list to append the egress flows to
+     * @return true if the security group has rules
+     */
+    bool addSecGrpRuleFlows(const opflex::modb::URI& secGrp,
+                            uint32_t secGrpSetId,
+                            /* out */ FlowEntryList& secGrpIn,
+                            /* out */ FlowEntryList& secGrpOut);
+
+    /**
+     * Write the flows of the rules of a security group as
+     * conjunctions of the set of the packet and of the rule
+     * classifier, including the shared classifier clause flows, and
+     * remove the conjunctions that are gone.  The flows of the sets
+     * that have the security group must be updated after this.
+     *
+     * @param secGrp the URI of the security group
+     * @param remove true to remove all the conjunctions of the group,
+     * once no security group set uses it
+     */
+    void updateSecGrpConjunctions(const opflex::modb::URI& secGrp,
+                                  bool remove = false);
+
+    /**
+     * Compute the rule flow objects of a security group that is not
+     * a system security group, for a security group set
+     *
+     * @param secGrp the URI of the security group
+     * @param secGrpSetId the ID of the set
+     * @param secGrpsIdStr the string ID of the set
+     * @param classifiers if not NULL, only compute the objects of the
+     * rules with these classifiers, including empty objects for the
+     * classifiers with no rule left
+     * @param objs the objects to add the flows to
+     */
+    void addSecGrpRuleObjs(const opflex::modb::URI& secGrp,
+                           uint32_t secGrpSetId,
+                           const std::string& secGrpsIdStr,
+                           const EndpointListener::uri_set_t* classifiers,
+                           /* out */ SecGrpRuleObjs& objs);
+
+    /**
+     * Write rule flow objects of a security group set to the
+     * security group tables
+     *
+     * @param secGrpsIdStr the string ID of the set
+     * @param objs the objects to write, emptied
+     * @param full true if these are all the objects of the set, in
+     * which case the other objects written for the set are removed
+     */
+    void writeSecGrpRuleObjs(const std::string& secGrpsIdStr,
+                             SecGrpRuleObjs& objs, bool full);
     
     Agent& agent;
     SwitchManager& switchManager;
     IdGenerator& idGen;
     CtZoneManager& ctZoneManager;
-    TaskQueue taskQueue;
+
+    // the io_service the flows are computed on, which is either the
+    // agent io_service or flowIOService run by flowThread
+    bool dedicatedThread;
+    boost::asio::io_service flowIOService;
+    std::unique_ptr<boost::asio::io_service::work> flowIOWork;
+    std::unique_ptr<std::thread> flowThread;
+    boost::asio::io_service& getIOService();
+    // created by start() on the io_service in use
+    std::unique_ptr<TaskQueue> taskQueue;
+
+    // endpoints waiting in the task queue for a flow update
+    std::unordered_set<std::string> endpointUpdates;
+    std::mutex endpointUpdateMutex;
+
+    /*
+     * A security group update waiting in the task queue.  Unless the
+     * whole security group must be updated, only the rule objects of
+     * the classifiers of the rules that changed are rewritten.
+     */
+    struct SecGrpUpdate {
+        SecGrpUpdate() : full(false) {}
+        bool full;
+        EndpointListener::uri_set_t classifiers;
+    };
+    std::unordered_map<opflex::modb::URI, SecGrpUpdate> secGrpUpdates;
+    std::mutex secGrpUpdateMutex;
+
+    // the rule flow objects written for each security group set
+    std::unordered_map<std::string,
+                       std::unordered_set<std::string> > secGrpSetRuleObjs;
 
     bool conntrackEnabled;
+    bool conjunctiveSecGroups;
+    std::chrono::milliseconds updateDebounce;
+    std::chrono::milliseconds updateMaxDebounce;
     std::atomic<bool> stopping;
     std::string dropLogIface;
     boost::asio::ip::address dropLogDst;
     uint16_t dropLogRemotePort;
+
+    /**
+     * Write the flows at the end of the tables that log the packets
+     * they drop, and the groups that sample them
+     */
+    void updateTableDropFlows();
+
+    /*
+     * The probability of the drop sampling group of each table whose
+     * drops are sampled
+     */
+    std::unordered_map<unsigned, double> dropSampleGroups;
+
+    /*
+     * The conjunctions of the rules of a security group in a table,
+     * by rule priority
+     */
+    typedef std::map<uint16_t, std::set<uint32_t> > SecGrpConjMap;
+
+    /*
+     * A flow matching the classifier clause of security group rule
+     * conjunctions.  Security groups with a rule flow of the same
+     * match and priority in a table share the flow, which carries the
+     * conjunctions of all of them.  Map of clause key to the flow.
+     */
+    struct SecGrpClause {
+        /* the table of the flow */
+        uint8_t tableId;
+        /* a flow with the match of the clause */
+        FlowEntryPtr match;
+        /* the conjunctions of each security group using the clause */
+        std::unordered_map<opflex::modb::URI, std::set<uint32_t> > conjs;
+    };
+    std::unordered_map<std::string, SecGrpClause> secGrpClauses;
+
+    /*
+     * The flows of a security group written as conjunctive matches:
+     * its conjunctions in each table, the clause flows it contributes
+     * to and the ID keys of its conjunctions
+     */
+    struct SecGrpConj {
+        SecGrpConjMap inConjs;
+        SecGrpConjMap outConjs;
+        std::set<std::string> clauses;
+        std::set<std::string> conjKeys;
+    };
+    std::unordered_map<opflex::modb::URI, SecGrpConj> secGrpConjs;
 };
 
 } // namespace opflexagent
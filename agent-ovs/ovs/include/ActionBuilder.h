@@ -15,6 +15,8 @@
 #include <boost/optional.hpp>
 #include <boost/noncopyable.hpp>
 
+#include <vector>
+
 extern "C" {
 #include <openvswitch/meta-flow.h>
 #include <openflow/nicira-ext.h>
@@ -32,6 +34,54 @@ namespace opflexagent {
 
 class FlowBuilder;
 
+/**
+ * The action buffers of a thread, kept for reuse so that building a
+ * flow does not allocate and grow a new buffer each time.  Buffers
+ * that grew large are freed instead.
+ */
+class ActionBufferPool : boost::noncopyable {
+public:
+    /**
+     * The maximum number of buffers kept by a thread
+     */
+    static const size_t MAX_BUFFERS = 16;
+
+    /**
+     * The maximum allocated size of a buffer that is kept
+     */
+    static const size_t MAX_SIZE = 4096;
+
+    /**
+     * Get an empty buffer from the pool of this thread, or a new
+     * buffer if the pool is empty
+     *
+     * @return the buffer
+     */
+    static ofpbuf* get();
+
+    /**
+     * Give a buffer back to the pool of this thread, or free it if
+     * the pool is full or the buffer is too large
+     *
+     * @param b the buffer
+     */
+    static void put(ofpbuf* b);
+
+    /**
+     * Get the number of buffers in the pool of this thread
+     */
+    static size_t size();
+
+private:
+    ActionBufferPool() {}
+    ~ActionBufferPool();
+
+    std::vector<ofpbuf*> buffers;
+
+    static thread_local ActionBufferPool pool;
+    static thread_local bool destroyed;
+};
+
 /**
  * Class to help construct the actions part of a table entry incrementally.
  */
@@ -239,6 +289,27 @@ public:
      */
     ActionBuilder& group(uint32_t groupId);
 
+    /**
+     * Contribute a clause to a conjunctive match.  A flow with this
+     * action may not have any other kind of action.
+     * @param id the conjunction ID, matched by the flow that gives
+     * the actions of the conjunction
+     * @param clause the clause matched by this flow, from 0
+     * @param nClauses the number of clauses of the conjunction
+     * @return this action builder for chaining
+     */
+    ActionBuilder& conjunction(uint32_t id, uint8_t clause,
+                               uint8_t nClauses);
+
+    /**
+     * Append a copy of a list of actions, such as those of an
+     * existing flow entry
+     * @param ofpacts the actions to copy
+     * @param len the length of the actions in bytes
+     * @return this action builder for chaining
+     */
+    ActionBuilder& copy(const struct ofpact* ofpacts, size_t len);
+
     /**
      * Output the packet in a packet-out message to the controller
      * @param max_len the number of bytes of the packet to include
@@ -446,6 +517,17 @@ public:
      */
     static ofpact* getActionsFromBuffer(ofpbuf *buf, size_t& actsLen);
 
+    /**
+     * Copy the actions in a buffer used for constructing those
+     * actions into an allocation of their size, and empty the buffer
+     * so that it can be used again.
+     *
+     * @param buf buffer to copy actions from
+     * @param actsLen size, in bytes, of the copied actions array
+     * @return the copy of the actions, or NULL if there are none
+     */
+    static ofpact* copyActions(ofpbuf *buf, size_t& actsLen);
+
 private:
     struct ofpbuf* buf;
     bool flowHasVlan;
@@ -18,8 +18,12 @@
 #include <boost/noncopyable.hpp>
 #include <boost/asio/deadline_timer.hpp>
 
+#include <chrono>
+#include <deque>
 #include <mutex>
 #include <random>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace opflexagent {
 
@@ -105,6 +109,38 @@ public:
     { tunnelEndpointAdv = tunnelMode;
       tunnelEpAdvInterval = delay;}
 
+    /**
+     * Set the rate at which endpoint and service advertisements are
+     * sent.  Advertisements beyond the rate are queued and sent in
+     * turn across bridge domains.
+     *
+     * @param pps the number of advertisements per second, or 0 for
+     * no limit
+     */
+    void setAdvRateLimit(uint32_t pps) { advRateLimit = pps; }
+
+    /**
+     * Get the number of advertisements waiting to be sent
+     *
+     * @return the number of queued advertisements
+     */
+    size_t getAdvBacklog();
+
+    /**
+     * Get the largest number of advertisements that were waiting to
+     * be sent at once
+     *
+     * @return the largest backlog
+     */
+    size_t getMaxAdvBacklog();
+
+    /**
+     * Get the number of advertisements sent through the pacer
+     *
+     * @return the number of advertisements sent
+     */
+    uint64_t getAdvSentCount() const { return advSent; }
+
     /**
      * Module start
      */
@@ -233,10 +269,65 @@ private:
     std::mutex ep_mutex;
     std::mutex tunnelep_mutex;
     typedef std::unordered_map<std::string, uint8_t> pending_ep_map_t;
-    pending_ep_map_t pendingEps;
-    pending_ep_map_t pendingServices;
+    /**
+     * Repeats left for an endpoint or service and when the next one
+     * is due
+     */
+    struct PendingAdv {
+        uint8_t remaining;
+        std::chrono::steady_clock::time_point due;
+    };
+    typedef std::unordered_map<std::string, PendingAdv> pending_adv_map_t;
+    pending_adv_map_t pendingEps;
+    pending_adv_map_t pendingServices;
     pending_ep_map_t pendingTunnelEps;
 
+    /**
+     * Kinds of advertisements paced by the advertisement queue
+     */
+    enum AdvType {
+        ADV_ENDPOINT,
+        ADV_SERVICE
+    };
+    typedef std::pair<AdvType, std::string> adv_t;
+
+    /**
+     * Queue an advertisement to be sent by the pacer, unless it is
+     * already queued
+     *
+     * @param type the kind of advertisement
+     * @param uuid the UUID of the endpoint or service
+     * @param domain the bridge or routing domain the advertisement is
+     * queued under
+     */
+    void queueAdv(AdvType type, const std::string& uuid,
+                  const opflex::modb::URI& domain);
+
+    /**
+     * Get the bridge domain of an endpoint, to queue its
+     * advertisements under
+     */
+    opflex::modb::URI getEndpointDomain(const std::string& uuid);
+
+    void schedulePacer(uint64_t time);
+    void onPaceTimer(const boost::system::error_code& ec);
+    void sendAdvs(const std::vector<adv_t>& advs);
+
+    std::mutex pace_mutex;
+    /* queued advertisements by domain, sent in turn across domains */
+    std::unordered_map<opflex::modb::URI, std::deque<adv_t>> advQueues;
+    std::deque<opflex::modb::URI> advTurns;
+    std::unordered_set<std::string> queuedEpAdvs;
+    std::unordered_set<std::string> queuedServiceAdvs;
+    size_t advBacklog;
+    size_t maxAdvBacklog;
+    std::atomic<uint64_t> advSent;
+    uint32_t advRateLimit;
+    double advTokens;
+    std::chrono::steady_clock::time_point lastRefill;
+    bool pacerScheduled;
+    std::unique_ptr<boost::asio::deadline_timer> paceTimer;
+
     Agent& agent;
     IntFlowManager& intFlowManager;
     PortMapper* portMapper;
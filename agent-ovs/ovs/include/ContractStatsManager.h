@@ -89,6 +89,11 @@ public:
                 ofpbuf *msg,
                 struct ofputil_flow_removed* fentry=NULL) override;
 
+    /**
+     * Get the flow counter state for the flows of the given table
+     */
+    flowCounterState_t* getCounterState(uint32_t tableId) override;
+
     void updatePolicyStatsCounters(const std::string& srcEpg,
                                    const std::string& dstEpg,
                                    const std::string& ruleURI,
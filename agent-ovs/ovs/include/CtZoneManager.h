@@ -17,6 +17,11 @@
 
 #include <string>
 #include <cstdint>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include <boost/noncopyable.hpp>
 
 namespace opflexagent {
@@ -25,9 +30,12 @@ class IdGenerator;
 
 /**
  * Manage IDs associated with connection tracking zones in the linux
- * kernel.  When an ID is allocated, we ensure that no stale
- * connection state exists for that zone in the connection tracking
- * table.
+ * kernel.  We ensure that no stale connection state exists for a zone
+ * in the connection tracking table when its ID is allocated: the
+ * zones not in use are flushed once on initialization, and a zone
+ * freed afterwards stays quarantined until a background worker has
+ * flushed it.  The worker flushes the zones freed together in a
+ * single pass over the table, and allocation never waits for it.
  */
 class CtZoneManager : private boost::noncopyable {
 public:
@@ -61,6 +69,12 @@ public:
      */
     virtual void init(const std::string& nmspc);
 
+    /**
+     * Stop the flush worker.  Zones still quarantined stay reserved
+     * until the next initialization flushes them.
+     */
+    void stop();
+
     /**
      * Allocate a connection tracking zone for the given ID string.
      *
@@ -83,7 +97,16 @@ private:
     IdGenerator& gen;
     std::string nmspc;
 
-    bool ctZoneAllocHook(const std::string&, uint32_t);
+    std::mutex flushMutex;
+    std::condition_variable flushCond;
+    /* zones freed and waiting to be flushed */
+    std::vector<uint16_t> pendingFlush;
+    std::unique_ptr<std::thread> flushThread;
+    bool stopping;
+
+    bool ctZoneFreeHook(const std::string&, uint32_t);
+    bool flushZones(const std::vector<bool>& zones);
+    void runFlush();
 };
 
 } /* namespace opflexagent */
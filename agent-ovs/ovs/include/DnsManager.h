@@ -13,6 +13,8 @@
 #define OPFLEXAGENT_DNSMANAGER_H
 
 #include <opflexagent/Agent.h>
+#include <opflexagent/SuffixTrie.h>
+#include <opflexagent/TimerWheel.h>
 #include "PortMapper.h"
 #include <functional>
 #include <boost/noncopyable.hpp>
@@ -26,6 +28,7 @@
 #include <boost/date_time/local_time/local_time.hpp>
 #include <string>
 #include <list>
+#include <vector>
 #include <unordered_set>
 #include <mutex>
 #include <random>
@@ -60,6 +63,17 @@ class DnsListener {
          * @param dnsDemand URI of the original demand
          */
         virtual void dnsDemandUpdated(opflex::modb::class_id_t cid, opflex::modb::URI dnsDemand);
+        /**
+         * Update Listeners about a batch of available DNS Answers
+         * @param cid DnsDemand::CLASS_ID
+         * @param dnsDemands URIs of the original demands
+         */
+        virtual void dnsDemandsUpdated(opflex::modb::class_id_t cid,
+                const std::unordered_set<opflex::modb::URI> &dnsDemands) {
+            for(const auto &dnsDemand: dnsDemands) {
+                dnsDemandUpdated(cid, dnsDemand);
+            }
+        }
 };
 
 //RFC-883
@@ -164,25 +178,46 @@ public:
     };
 };
 
+/**
+ * Context for parsing a DNS message in place.
+ *
+ * Records are kept as views into the message, and names as the offset
+ * of their first label.  Names are only decoded when they are needed,
+ * into an arena shared by the names of the message, so that a name
+ * referred to by many records through compression pointers is decoded
+ * once.  The context is reused from one message to the next to keep
+ * its buffers.
+ */
 class DnsParsingContext {
 public:
-    DnsParsingContext(dns::dns_hdr *hdr, uint32_t _tailRoom):
-        dptr((char *)hdr + DNS_HDR_LEN),
-        qdCount(ntohs(hdr->qdcount)), anCount(ntohs(hdr->ancount)),
-        nsCount(ntohs(hdr->nscount)), arCount(ntohs(hdr->arcount)),
-        tailRoom(_tailRoom), labelOffset(DNS_HDR_LEN),
-        labelPtrHi(0), labelState(seekingLabel), parsingSection(baseSection){}
-    char *dptr;
+    DnsParsingContext():
+        msg(NULL), msgLen(0), offset(0),
+        qdCount(0), anCount(0), nsCount(0), arCount(0),
+        parsingSection(baseSection) {}
+    /**
+     * Start parsing a message
+     * @param hdr the DNS header at the start of the message
+     * @param _tailRoom the length of the message after the header
+     */
+    void reset(dns::dns_hdr *hdr, uint32_t _tailRoom) {
+        msg = (const uint8_t *)hdr;
+        msgLen = DNS_HDR_LEN + _tailRoom;
+        offset = DNS_HDR_LEN;
+        qdCount = ntohs(hdr->qdcount);
+        anCount = ntohs(hdr->ancount);
+        nsCount = ntohs(hdr->nscount);
+        arCount = ntohs(hdr->arcount);
+        parsingSection = baseSection;
+        questions.clear();
+        answers.clear();
+        authorities.clear();
+        additionalRecords.clear();
+        arena.clear();
+        decodedNames.clear();
+    }
+    const uint8_t *msg;
+    uint32_t msgLen, offset;
     uint16_t qdCount, anCount, nsCount, arCount;
-    uint32_t tailRoom, labelOffset;
-    uint8_t labelPtrHi;
-    //RFC-1035
-    enum LabelState {
-        seekingLabel=0,
-        accumulatingPtr,
-        accumulatingLabel,
-        terminatingLabel
-    } labelState;
     enum ParsingSection {
         baseSection=0,
         questionSection,
@@ -190,20 +225,67 @@ public:
         authoritySection,
         additionalSection
     } parsingSection;
+    /* Offset of the first label of a name in the message */
+    typedef uint16_t NameRef;
     class DnsQuestion {
     public:
-        std::string domainName;
+        NameRef name;
         DnsRRType qType;
         DnsRRClass qClass;
     };
-    typedef std::list<std::list<std::string>>::iterator LabelSetIterator;
-    typedef std::list<std::string>::iterator LabelStringIterator;
-    std::unordered_map<uint32_t, std::pair<LabelSetIterator,LabelStringIterator>> labelMap;
-    std::list<std::list<std::string>> labelSet;
-    std::list<DnsQuestion> questions;
-    std::list<DnsRR> answers;
-    std::list<DnsRR> authorities;
-    std::list<DnsRR> additionalRecords;
+    class DnsRRView {
+    public:
+        NameRef name;
+        DnsRRType rType;
+        DnsRRClass rClass;
+        uint32_t ttl;
+        uint16_t rdLen;
+        /* Offset of the record data in the message */
+        uint16_t rdOffset;
+    };
+    std::vector<DnsQuestion> questions;
+    std::vector<DnsRRView> answers;
+    std::vector<DnsRRView> authorities;
+    std::vector<DnsRRView> additionalRecords;
+    /**
+     * Check the available length from the parsing offset
+     * @param len number of bytes needed
+     * @return true if there are as many bytes left in the message
+     */
+    bool hasRoom(uint32_t len) const {
+        return (offset <= msgLen) && (len <= msgLen - offset);
+    }
+    uint16_t get16(uint32_t off) const {
+        return (uint16_t)((msg[off] << 8) | msg[off+1]);
+    }
+    uint32_t get32(uint32_t off) const {
+        return ((uint32_t)get16(off) << 16) | get16(off+2);
+    }
+    /**
+     * Move the parsing offset past the name at the offset,
+     * without decoding it
+     * @return false if the name is malformed
+     */
+    bool skipName();
+    /**
+     * Decode a name of the message
+     * @param ref the name
+     * @param name set to the domain name
+     * @return false if the name is malformed
+     */
+    bool getName(NameRef ref, std::string &name) const;
+    /**
+     * Decode the data of a record
+     * @param view the record in the message
+     * @param dnsRR record to fill in with the decoded data
+     * @return false if the data is malformed
+     */
+    bool getRRData(const DnsRRView &view, DnsRR &dnsRR) const;
+private:
+    /* Decoded names, by name, as offset and length in the arena */
+    mutable std::string arena;
+    mutable std::vector<std::pair<NameRef,
+                                  std::pair<uint32_t, uint32_t>>> decodedNames;
 };
 
 class DnsCachedRecordData {
@@ -318,6 +400,12 @@ public:
     bool isCName() const {
         return !cachedCName.cName.empty();
     }
+    /**
+     * Get the earliest expiry time of the records of this entry
+     * @param expiry set to the expiry time
+     * @return false if no record of this entry expires
+     */
+    bool nextExpiry(boost::posix_time::ptime &expiry) const;
     bool canExpire() const {
         if(isCName()) {
             return (!isHolder && aNames.empty());
@@ -379,6 +467,10 @@ public:
      */
     virtual void objectUpdated (opflex::modb::class_id_t class_id,
                                     const opflex::modb::URI& uri);
+    /**
+     * MODB batch listener interface
+     */
+    virtual void objectsUpdated(const update_list_t& updates);
     /* *
      * Set the path to store learnt dns cache entries.
      * On restart, used to restore cache.
@@ -398,6 +490,11 @@ private:
     std::unordered_map<std::string, DnsCacheEntry> learntMappings;
     /*Map of dns demand to resolved addresses*/
     std::unordered_map<std::string, DnsDemandState> demandMappings;
+    /*Wildcard demands by the suffix after the wildcard*/
+    SuffixTrie<std::string> wildcardDemands;
+    /*Names of the entries to age, by second since wheelEpoch*/
+    TimerWheel<std::string> expiryWheel;
+    boost::posix_time::ptime wheelEpoch;
     std::list<DnsListener *> dnsListeners;
     std::mutex listenerMutex,packetQMutex,askQMutex,stateMutex;
     std::recursive_mutex timerMutex;
@@ -409,7 +506,12 @@ private:
     std::atomic<bool> started;
     boost::mt19937 randomSeed;
     std::string cacheDir;
-    void notifyListeners(class_id_t cid, const URI& notifyURI);
+    /* Only used by the parser thread */
+    DnsParsingContext parsingCtxt;
+    void notifyListeners(class_id_t cid, const std::unordered_set<URI>& notifySet);
+    uint64_t expiryTick(const boost::posix_time::ptime &time) const;
+    /*Age the entry at the next tick of the expiry timer*/
+    void scheduleAging(const std::string &domainName);
     void updateMOs(DnsCacheEntry &entry, bool updated);
     void updateMOs(const std::string &alias);
     DnsCacheEntry *getTerminalNode(DnsCacheEntry &startNode);
@@ -419,8 +521,10 @@ private:
     void handleDnsAsk(URI &askUri, std::unordered_set<URI> &notifySet);
     void processURI(class_id_t class_id,
                     std::mutex &qMutex, std::queue<URI> &uriQ,
-                    std::function<void (URI&, std::unordered_set<URI>&)> func);
-    bool parseRR(DnsParsingContext &ctxt, std::list<DnsRR> &result);
+                    std::function<void (URI&, std::unordered_set<URI>&)> func,
+                    std::unordered_set<URI> &notifySet);
+    bool parseRR(DnsParsingContext &ctxt,
+                 std::vector<DnsParsingContext::DnsRRView> &result);
     bool handlePacket(const struct dp_packet *pkt);
     void processPacket();
     void onExpiryTimer(const boost::system::error_code &e);
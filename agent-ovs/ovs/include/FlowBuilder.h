@@ -285,6 +285,21 @@ public:
      */
     FlowBuilder& mark(uint32_t value, uint32_t mask = ~0l);
 
+    /**
+     * Add a match against the ID of a conjunctive match
+     * @param id the conjunction ID
+     * @return this flow builder for chaining
+     */
+    FlowBuilder& conjId(uint32_t id);
+
+    /**
+     * Copy the priority and the match of an existing flow entry,
+     * replacing any match set so far
+     * @param fe the flow entry to copy
+     * @return this flow builder for chaining
+     */
+    FlowBuilder& matchOf(const FlowEntry& fe);
+
     /**
      * Connection tracking state flags
      */
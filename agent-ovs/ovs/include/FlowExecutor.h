@@ -18,6 +18,7 @@
 #include <unordered_map>
 #include <mutex>
 #include <condition_variable>
+#include <functional>
 
 namespace opflexagent {
 
@@ -64,6 +65,24 @@ public:
      */
     virtual bool Execute(const TlvEdit& te);
 
+    /**
+     * Construct and send the group-modification and
+     * flow-modification messages of one change that spans groups
+     * and flow tables, in order: first the group edits that must
+     * precede the flows, then the flows, then the remaining group
+     * edits.  Waits till all the messages have been acted upon
+     * through a single barrier message.
+     * @param before The group modifications to send first, such as
+     * the groups the flows refer to
+     * @param fe The flow modifications
+     * @param after The group modifications to send last, such as the
+     * deletion of the groups the flows no longer refer to
+     * @return false if any error occurs while sending messages or
+     * an error reply was received, true otherwise
+     */
+    virtual bool Execute(const GroupEdit& before, const FlowEdit& fe,
+                         const GroupEdit& after);
+
     /**
      * Construct and send flow-modification messages corresponding
      * to the flow-edits specified, but does not wait the messages
@@ -93,6 +112,52 @@ public:
      * true otherwise
      */
     virtual bool ExecuteNoBlock(const TlvEdit& te);
+
+    /**
+     * A callback for an asynchronous execution, called with 0 once
+     * the switch has acted upon all its messages, or with the error
+     * of the first message that failed
+     */
+    typedef std::function<void (int)> Completion;
+
+    /**
+     * Set how many asynchronous executions may be waiting for their
+     * barrier reply at once.  Once that many are outstanding, a new
+     * asynchronous execution blocks until one of them completes.
+     * @param window the number of outstanding executions, at least 1
+     */
+    void setMaxOutstanding(size_t window);
+
+    /**
+     * Construct and send flow-modification messages corresponding
+     * to the flow-edits specified, followed by a barrier message, but
+     * does not wait for the barrier reply.  The completion is called
+     * from the connection thread when the reply is received, or with
+     * ENOTCONN if the connection is re-established first.
+     * @param fe The flow modifications
+     * @param done Called once the messages have been acted upon
+     * @return false if any error occurs while sending messages, in
+     * which case the completion has already been called, true
+     * otherwise
+     */
+    virtual bool ExecuteAsync(const FlowEdit& fe, const Completion& done);
+
+    /**
+     * Asynchronous version of Execute() for a change that spans
+     * groups and flow tables.
+     * @param before The group modifications to send first
+     * @param fe The flow modifications
+     * @param after The group modifications to send last
+     * @param done Called once the messages have been acted upon
+     * @return false if any error occurs while sending messages, in
+     * which case the completion has already been called, true
+     * otherwise
+     * @see ExecuteAsync(const FlowEdit&, const Completion&)
+     */
+    virtual bool ExecuteAsync(const GroupEdit& before, const FlowEdit& fe,
+                              const GroupEdit& after,
+                              const Completion& done);
+
     /**
      * Register all the necessary event listeners on connection.
      * @param conn Connection to register
@@ -186,6 +251,10 @@ private:
 
     SwitchConnection *swConn;
 
+    /* allowed and current number of outstanding asynchronous requests */
+    size_t maxOutstanding;
+    size_t asyncOutstanding;
+
     /**
      * @brief Maintains information about outstanding requests that
      * need to be tracked.
@@ -196,6 +265,8 @@ private:
         std::unordered_set<uint32_t> reqXids;
         int status;
         bool done;
+        /* set for asynchronous requests */
+        Completion completion;
     };
     /* Map of barrier request IDs to RequestState */
     typedef std::unordered_map<uint32_t, RequestState> RequestMap;
@@ -13,6 +13,7 @@
 #define OPFLEXAGENT_FLOWUTILS_H
 
 #include "TableState.h"
+#include "RangeMask.h"
 #include <opflexagent/Network.h>
 
 #include <modelgbp/gbpe/L24Classifier.hpp>
@@ -54,6 +55,48 @@ void match_group(FlowBuilder& f, uint16_t prio, uint32_t svnid, uint32_t dvnid);
  */
 FlowEntryPtr default_out_flow();
 
+/**
+ * Base of the IDs of the select groups that sample the packets
+ * dropped at the end of the tables.  The group of a table is the base
+ * plus the table ID.
+ */
+const uint32_t DROP_SAMPLE_GROUP_BASE = 0xfffffe00;
+
+/**
+ * Whether the packets dropped at the end of a table go through a
+ * sampling group
+ *
+ * @param probability the fraction of the dropped packets to log
+ * @return true if only some of the packets are logged
+ */
+bool is_drop_sampled(double probability);
+
+/**
+ * Get the flow at the end of a table that counts the packets dropped
+ * by the table and sends them, or a sample of them, to the drop table
+ *
+ * @param tableId the table
+ * @param dropTable the drop table that logs the packets
+ * @param probability the fraction of the dropped packets to log
+ * @return the new flow entry
+ */
+FlowEntryPtr table_drop_flow(uint8_t tableId, uint8_t dropTable,
+                             double probability);
+
+/**
+ * Get the group mod for the select group that sends a sample of the
+ * packets dropped by a table to the drop table.  The bucket is chosen
+ * by flow hash, so the flows whose drops are logged are logged fully.
+ *
+ * @param command the group mod command
+ * @param tableId the table
+ * @param dropTable the drop table that logs the packets
+ * @param probability the fraction of the dropped packets to log
+ * @return the group mod
+ */
+GroupEdit::Entry drop_sample_group(uint16_t command, uint8_t tableId,
+                                   uint8_t dropTable, double probability);
+
 /**
  * Actions to take for classifier entries in add_classifier_entries
  */
@@ -94,6 +137,59 @@ enum ClassAction {
     CA_REFLEX_REV_RELATED,
 };
 
+/**
+ * The matches of a classifier, decoded once so that the flows of its
+ * rules can be generated again and again without reading the
+ * classifier object
+ */
+struct ClassifierMatch {
+    /**
+     * The ethertype, or EtherTypeEnumT::CONST_UNSPECIFIED
+     */
+    uint16_t etherType;
+
+    /**
+     * The ARP opcode, or OpcodeEnumT::CONST_UNSPECIFIED
+     */
+    uint8_t arpOpc;
+
+    /**
+     * True if the classifier matches an IP protocol
+     */
+    bool protSet;
+
+    /**
+     * The IP protocol to match, if protSet
+     */
+    uint8_t prot;
+
+    /**
+     * The TCP flags, or TcpFlagsEnumT::CONST_UNSPECIFIED
+     */
+    uint32_t tcpFlags;
+
+    /**
+     * The masks of the source port range, or of the ICMP type.  Never
+     * empty; a single zero mask matches anything.
+     */
+    MaskList srcPorts;
+
+    /**
+     * The masks of the destination port range, or of the ICMP code.
+     * Never empty; a single zero mask matches anything.
+     */
+    MaskList dstPorts;
+};
+
+/**
+ * Decode the matches of a classifier
+ *
+ * @param clsfr the classifier
+ * @param match the decoded matches
+ */
+void compile_classifier(modelgbp::gbpe::L24Classifier& clsfr,
+                        /* out */ ClassifierMatch& match);
+
 /**
  * Create flow entries for the classifier specified and append them
  * to the provided list.
@@ -124,6 +220,23 @@ void add_classifier_entries(modelgbp::gbpe::L24Classifier& clsfr,
                             bool isSystemRule,
                             /* out */ FlowEntryList& entries);
 
+/**
+ * Create flow entries for a classifier decoded by
+ * compile_classifier() and append them to the provided list.  The
+ * parameters are those of the classifier object version.
+ */
+void add_classifier_entries(const ClassifierMatch& clsfr,
+                            ClassAction act, bool log,
+                            boost::optional<const network::subnets_t&> sourceSub,
+                            boost::optional<const network::subnets_t&> destSub,
+                            boost::optional<const network::service_ports_t&> destNamedSvcPorts,
+                            uint8_t nextTable, uint8_t currentTable, uint8_t dropTable,
+                            uint16_t priority,
+                            uint32_t flags, uint64_t cookie,
+                            uint32_t svnid, uint32_t dvnid,
+                            bool isSystemRule,
+                            /* out */ FlowEntryList& entries);
+
 /**
  * Create L2 flow entries for the classifier specified and append them
  * to the provided list.
@@ -148,6 +261,21 @@ void add_l2classifier_entries(modelgbp::gbpe::L24Classifier& clsfr,
                               uint32_t svnid, uint32_t dvnid,
                               bool isSystemRule,
                               /* out */ FlowEntryList& entries);
+
+/**
+ * Create L2 flow entries for a classifier decoded by
+ * compile_classifier() and append them to the provided list.  The
+ * parameters are those of the classifier object version.
+ */
+void add_l2classifier_entries(const ClassifierMatch& clsfr,
+                              ClassAction act, bool log,
+                              uint8_t nextTable, uint8_t currentTable, uint8_t dropTable,
+                              uint16_t priority,
+                              uint32_t flags, uint64_t cookie,
+                              uint32_t svnid, uint32_t dvnid,
+                              bool isSystemRule,
+                              /* out */ FlowEntryList& entries);
+
 /**
  * Add a match entry for the DHCP v4 and v6 request
  *
@@ -22,8 +22,11 @@
 #include <opflexagent/TunnelEpManager.h>
 #include <opflexagent/RDConfig.h>
 #include <opflexagent/TaskQueue.h>
+#include <opflexagent/WorkerPool.h>
+#include <opflexagent/MulticastGroupJournal.h>
 #include <opflexagent/PrometheusManager.h>
 #include "SwitchStateHandler.h"
+#include "FlowUtils.h"
 
 #include <opflex/ofcore/PeerStatusListener.h>
 
@@ -32,8 +35,14 @@
 #include <boost/noncopyable.hpp>
 #include <boost/asio/io_service.hpp>
 
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <set>
 #include <thread>
+#include <tuple>
 #include <utility>
+#include <vector>
 #include <unordered_map>
 
 namespace opflexagent {
@@ -202,10 +211,13 @@ public:
      * @param mode the endpoint advertisement mode
      * @param tunnelMode the tunnel endpoint advertisement mode
      * @param tunnelAdvIntvl the tunnel endpoint advertisement interval
+     * @param advRateLimit the number of endpoint advertisements
+     * sent per second, or 0 for no limit
      */
     void setEndpointAdv(AdvertManager::EndpointAdvMode mode,
             AdvertManager::EndpointAdvMode tunnelMode,
-            uint64_t tunnelAdvIntvl=600);
+            uint64_t tunnelAdvIntvl=600,
+            uint32_t advRateLimit=1000);
 
     /**
      * Set the multicast group file
@@ -214,6 +226,112 @@ public:
      */
     void setMulticastGroupFile(const std::string& mcastGroupFile);
 
+    /**
+     * Set whether changes to the multicast group subscriptions are
+     * appended to a journal next to the multicast group file, rather
+     * than rewriting the whole file on every change.  The file is
+     * still written in full on a sync and when the journal grows
+     * larger than the file.
+     *
+     * @param enabled true to use the journal
+     */
+    void setMulticastGroupJournal(bool enabled);
+
+    /**
+     * Set how long to wait for further changes to a contract, an
+     * endpoint group or a forwarding domain before computing its
+     * flows, so that a burst of changes is computed once
+     *
+     * @param delay the time to wait after the last change, or zero to
+     * compute the flows at once
+     * @param maxDelay the longest time to wait after the first change
+     */
+    void setUpdateDebounce(std::chrono::milliseconds delay,
+                           std::chrono::milliseconds maxDelay);
+
+    /**
+     * Set whether the policy flows of a contract between many
+     * providers and many consumers are written as conjunctive
+     * matches, with one flow per provider, per consumer and per rule
+     * classifier instead of one per provider, consumer and
+     * classifier together.  The classifier counters of such
+     * contracts are not reported per pair of groups.
+     *
+     * @param enabled true to use conjunctive matches where they
+     * need fewer flows
+     */
+    void setConjunctiveContracts(bool enabled);
+
+    /**
+     * Set whether the route and service destination flows of a local
+     * endpoint with several addresses only load an ID for the
+     * endpoint into REG1, with the endpoint actions written once to
+     * the endpoint destination table, instead of every flow carrying
+     * the actions.
+     *
+     * @param enabled true to write the endpoint actions once
+     */
+    void setEndpointDestLookup(bool enabled);
+
+    /**
+     * Set whether the subnet flows of a routing domain aggregate the
+     * prefixes that select the same action, removing prefixes
+     * contained in a prefix with the same action and merging sibling
+     * prefixes, so that large external route tables need flows in
+     * proportion to their distinct actions rather than their
+     * prefixes.  The shorter prefixes get lower priorities, so this
+     * assumes no other route flow relies on ranking between the
+     * prefixes of a routing domain.
+     *
+     * @param enabled true to aggregate the subnet prefixes
+     */
+    void setRouteAggregation(bool enabled);
+
+    /**
+     * Set whether a sync with the switch writes the flows that only
+     * count or log packets, namely the stats, drop log and table drop
+     * counting flows, after the flows that forward traffic, so that
+     * workloads already running forward as early as possible after a
+     * restart.
+     *
+     * @param enabled true to write the observability flows last
+     */
+    void setStagedSync(bool enabled);
+
+    /**
+     * Set whether services load balance across their next hops with
+     * an OpenFlow select group per service mapping, with a weighted
+     * bucket per next hop, instead of multipath actions.  A next hop
+     * then keeps its link ID while the others change, so adding or
+     * removing one changes its own flows and bucket only.  Mappings
+     * with client affinity keep using multipath actions.
+     *
+     * @param enabled true to use select groups
+     */
+    void setServiceSelectGroups(bool enabled);
+
+    /**
+     * Time the tasks that update the flows of the integration bridge,
+     * for tools that measure the time spent per handler.  Set it
+     * before the flow manager is started.
+     *
+     * @param timer the callback told how long each task ran, keyed
+     * by its task ID, the URI or UUID of the object it updated
+     */
+    void setTaskTimer(const TaskQueue::TaskTimer& timer) {
+        taskQueue.setTaskTimer(timer);
+    }
+
+    /**
+     * Set the number of threads that compute the policy flows of the
+     * pairs of groups of a contract, including the thread that
+     * handles the contract update.  Must be called before start().
+     *
+     * @param threads the number of threads, 1 to compute the flows
+     * on the update thread alone
+     */
+    void setFlowComputeThreads(size_t threads);
+
     /**
      * Set the drop log parameters
      * @param dropLogPort port name for the drop-log port
@@ -259,6 +377,28 @@ public:
         return serviceStatsFlowDisabled;
     }
 
+    /**
+     * Set whether the service stats are aggregated.  Aggregated
+     * stats do not install the pod<-->svc and any<-->svc-tgt stats
+     * flows; the per-target counters come from the cookies of the
+     * load balancing flows of the services instead.  Services with
+     * the attribute "service-stats" set to "detailed" keep the
+     * detailed stats flows.
+     *
+     * @param aggregated true to aggregate the service stats
+     */
+    void setServiceStatsAggregated(bool aggregated) {
+        serviceStatsAggregated = aggregated;
+    }
+
+    /**
+     * Get whether the service stats are aggregated
+     * @return true if the service stats are aggregated
+     */
+    bool getServiceStatsAggregated() {
+        return serviceStatsAggregated;
+    }
+
     /**
      * Get the router MAC address as an array of 6 bytes
      * @return the router MAC
@@ -278,15 +418,19 @@ public:
     static const char * getIdNamespace(opflex::modb::class_id_t cid);
 
     /* Interface: SwitchStateHandler */
-    virtual std::vector<FlowEdit>
-    reconcileFlows(std::vector<TableState> flowTables,
-                   std::vector<FlowEntryList>& recvFlows);
+    virtual FlowEdit reconcileTable(int tableId,
+                                    const TableState& tableState,
+                                    FlowEntryList& recvFlows);
     virtual GroupEdit reconcileGroups(GroupMap& recvGroups);
+    virtual bool isDeferredSyncEdit(int tableId,
+                                    const FlowEdit::Entry& edit);
     virtual void completeSync();
 
     /* Interface: EndpointListener */
     virtual void endpointUpdated(const std::string& uuid);
+    virtual void endpointsUpdated(const std::unordered_set<std::string>& uuids);
     virtual void remoteEndpointUpdated(const std::string& uuid);
+    virtual void remoteEndpointsUpdated(const std::unordered_set<std::string>& uuids);
     virtual void localExternalDomainUpdated(const opflex::modb::URI& uri);
 
     /* Interface: ServiceListener */
@@ -309,6 +453,8 @@ public:
     virtual void domainUpdated(opflex::modb::class_id_t cid,
                                const opflex::modb::URI& domURI);
     virtual void contractUpdated(const opflex::modb::URI& contractURI);
+    virtual void contractDeltaUpdated(const opflex::modb::URI& contractURI,
+                                      const ContractDelta& delta);
     virtual void configUpdated(const opflex::modb::URI& configURI);
 
     /* Interface: PortStatusListener */
@@ -317,6 +463,8 @@ public:
 
     /* Interface: SnatListener */
     virtual void snatUpdated(const std::string& snatUuid);
+    virtual void snatChanged(const std::string& snatUuid,
+                             bool endpointsAffected);
 
     /**
      * Run periodic cleanup tasks
@@ -455,6 +603,13 @@ public:
          * appropriate endpoint interface.
          */
         SERVICE_DST_TABLE_ID,
+        /**
+         * Apply the destination actions of a local endpoint, selected
+         * by the ID that the flows matching each address of the
+         * endpoint in the route and service destination tables load
+         * into REG1.
+         */
+        ENDPOINT_DST_TABLE_ID,
         /**
          * Allow policy for the flow based on the source and
          * destination groups and the contracts that are configured.
@@ -554,6 +709,27 @@ private:
      */
     void handleEndpointUpdate(const std::string& uuid);
 
+    /**
+     * Add an endpoint to the set of endpoints waiting for a flow
+     * update, and schedule its advertisements
+     *
+     * @param uuid UUID of the changed endpoint
+     * @return true if the endpoint was added to the set
+     */
+    bool queueEndpointUpdate(const std::string& uuid);
+
+    /**
+     * Update the flows of all the endpoints waiting for a flow
+     * update, writing them to the switch as a single batch.
+     */
+    void handleEndpointBatch();
+
+    /**
+     * Update the flows of all the remote endpoints waiting for a flow
+     * update, writing them to the switch as a single batch.
+     */
+    void handleRemoteEndpointBatch();
+
     /**
      * Compare and update flow/group tables due to changes in an
      * service.
@@ -562,6 +738,58 @@ private:
      */
     void handleServiceUpdate(const std::string& uuid);
 
+    /*
+     * The buckets of the select group of a service mapping: the link
+     * ID and the weight of each next hop, by next hop IP address.
+     */
+    typedef std::map<std::string, std::pair<uint32_t, uint16_t> >
+        SvcBucketMap;
+
+    /*
+     * The select groups of a service, by the key of their service
+     * mapping.
+     */
+    typedef std::unordered_map<std::string, SvcBucketMap> SvcGroupMap;
+
+    /**
+     * Whether a service mapping is load balanced with a select group
+     *
+     * @param sm the service mapping
+     * @return true if it has a select group
+     */
+    bool useServiceGroup(const Service::ServiceMapping& sm) const;
+
+    /**
+     * Get the link ID of a next hop of a service mapping load
+     * balanced with a select group, which is its bucket ID and the
+     * value of reg7 that selects it in the service next hop table
+     *
+     * @param groupKey the key of the select group of the mapping
+     * @param nextHopIp the IP address of the next hop
+     * @return the link ID
+     */
+    uint32_t getServiceNextHopLink(const std::string& groupKey,
+                                   const std::string& nextHopIp);
+
+    /**
+     * Get the ID of the select group of a service mapping
+     *
+     * @param groupKey the key of the select group of the mapping
+     * @return the group ID
+     */
+    uint32_t getServiceGroupId(const std::string& groupKey);
+
+    /**
+     * Write the select groups of a service, adding, modifying and
+     * removing them to match the given buckets
+     *
+     * @param uuid UUID of the service
+     * @param groups the buckets of the select groups of the service,
+     * empty when it is removed
+     */
+    void updateServiceGroups(const std::string& uuid,
+                             SvcGroupMap& groups);
+
     /**
      * update Flow entry lists for services
      * @param uuid UUID of the service
@@ -643,6 +871,15 @@ private:
                                 const bool &is_svc,
                                 const bool &is_add);
 
+    /**
+     * Check whether a service gets the detailed stats flows
+     *
+     * @param as the service
+     * @return true unless the service stats are aggregated and the
+     * service did not opt in to the detailed stats
+     */
+    bool isSvcStatsDetailed(const Service& as);
+
     typedef std::unordered_map<std::string, std::string> attr_map;
     /**
      * Clear svc counter and children stats
@@ -849,6 +1086,20 @@ private:
      */
     void removeEndpointFromFloodGroup(const std::string& epUUID);
 
+    /**
+     * Get the ID of the actions of an endpoint in the endpoint
+     * destination table, releasing it if the flows of the endpoint
+     * should carry the actions themselves.
+     *
+     * @param uuid UUID of the endpoint
+     * @param kind the kind of actions, "route" or "service"
+     * @param addresses the number of addresses matched with the actions
+     * @return the ID, or 0 if the actions are not shared
+     */
+    uint32_t getEndpointDestId(const std::string& uuid,
+                               const std::string& kind,
+                               size_t addresses);
+
     /*
      * Map of endpoint to the port it is using.
      */
@@ -869,6 +1120,18 @@ private:
                          uint32_t groupId, const Ep2PortMap& epMap,
                          GroupEdit& ge);
 
+    /**
+     * Construct a group-table modification for the select group of a
+     * service mapping.
+     *
+     * @param type The modification type
+     * @param groupId Identifier for the select group to edit
+     * @param buckets The next hops of the group
+     * @return Group-table modification entry
+     */
+    GroupEdit::Entry createServiceGroupMod(uint16_t type, uint32_t groupId,
+                                           const SvcBucketMap& buckets);
+
     Agent& agent;
     SwitchManager& switchManager;
     IdGenerator& idGen;
@@ -888,10 +1151,22 @@ private:
     bool conntrackEnabled;
     uint8_t dhcpMac[6];
     std::string mcastGroupFile;
+    bool mcastGroupJournal;
+    std::unique_ptr<MulticastGroupWriter> mcastGroupWriter;
+    std::chrono::milliseconds updateDebounce;
+    std::chrono::milliseconds updateMaxDebounce;
+    bool conjunctiveContracts;
+    bool endpointDestLookup;
+    bool routeAggregation;
+    bool stagedSync;
+    bool serviceSelectGroups;
+    size_t flowComputeThreads;
+    WorkerPool flowWorkers;
     std::string dropLogIface;
     boost::asio::ip::address dropLogDst;
     uint16_t dropLogRemotePort;
     std::atomic<bool> serviceStatsFlowDisabled;
+    std::atomic<bool> serviceStatsAggregated;
 
     /* Map containing ingress and egress cookie: Flows generated out
      * of same pod<-->svc uuid will use these cookies */
@@ -921,6 +1196,47 @@ private:
     typedef std::unordered_map<opflex::modb::URI, Ep2PortMap> FloodGroupMap;
     FloodGroupMap floodGroupMap;
 
+    /*
+     * Map of the service select groups to their buckets, by service
+     * UUID.
+     */
+    std::unordered_map<std::string, SvcGroupMap> serviceGroupMap;
+
+    /*
+     * The probability of the drop sampling group of each table whose
+     * drops are sampled
+     */
+    std::unordered_map<unsigned, double> dropSampleGroups;
+
+    /*
+     * The attributes of a group that the flows of its endpoints were
+     * last computed from.  An update to the group that leaves them
+     * unchanged, such as a change to its intra-group policy or its
+     * contracts, does not recompute the flows of its endpoints.
+     */
+    struct GroupEndpointDeps {
+        uint32_t vnid;
+        uint32_t rdId;
+        uint32_t bdId;
+        uint32_t fgrpId;
+        uint32_t tunPort;
+        uint8_t routingMode;
+        uint8_t arpMode;
+        uint8_t ndMode;
+        uint8_t unkFloodMode;
+        uint8_t bcastFloodMode;
+
+        bool operator==(const GroupEndpointDeps& o) const {
+            return vnid == o.vnid && rdId == o.rdId && bdId == o.bdId &&
+                fgrpId == o.fgrpId && tunPort == o.tunPort &&
+                routingMode == o.routingMode &&
+                arpMode == o.arpMode && ndMode == o.ndMode &&
+                unkFloodMode == o.unkFloodMode &&
+                bcastFloodMode == o.bcastFloodMode;
+        }
+    };
+    std::unordered_map<opflex::modb::URI, GroupEndpointDeps> groupEndpointDeps;
+
     uint32_t getExtNetVnid(const opflex::modb::URI& uri);
 
     AdvertManager advertManager;
@@ -937,6 +1253,91 @@ private:
     MulticastMap mcastMap;
     /* Set of external flood domain Ids*/
     std::unordered_set<uint32_t> localExternalFdSet;
+
+    /*
+     * A contract update waiting in the task queue.  Unless the whole
+     * contract must be updated, only the flows of the groups whose
+     * relationship with the contract changed are recomputed.
+     */
+    struct ContractUpdate {
+        bool full;
+        UriSet groups;
+    };
+    std::unordered_map<opflex::modb::URI, ContractUpdate> contractUpdates;
+    std::mutex contractUpdateMutex;
+
+    /*
+     * Endpoints waiting in the task queue for a flow update.  A pod
+     * storm notifies many endpoints in a row, and they are all
+     * handled by the same task.
+     */
+    std::unordered_set<std::string> endpointUpdates;
+    std::mutex endpointUpdateMutex;
+
+    /*
+     * Remote endpoints waiting in the task queue for a flow update
+     */
+    std::unordered_set<std::string> remoteEndpointUpdates;
+    std::mutex remoteEndpointUpdateMutex;
+
+    /*
+     * Snats waiting in the task queue for a flow update, mapped to
+     * whether the endpoints using them must be updated too.  A change
+     * to the port ranges of other nodes only affects the flows of the
+     * snat itself, and skipping the endpoints lets a snat IP shared by
+     * many nodes converge quickly.
+     */
+    std::unordered_map<std::string, bool> snatUpdates;
+    std::mutex snatUpdateMutex;
+
+    /*
+     * The policy flows of a contract are written separately for each
+     * pair of provider and consumer groups, with the group at both
+     * ends of intra-group pairs.  Map of contract URI to the pairs
+     * with flows, indexed by both of their groups so that an update
+     * of some groups only visits the pairs of these groups.
+     */
+    typedef std::pair<opflex::modb::URI, opflex::modb::URI> GroupPair;
+    typedef std::unordered_map<opflex::modb::URI, std::set<GroupPair> >
+        GroupPairIndex;
+    std::unordered_map<opflex::modb::URI, GroupPairIndex> contractPairs;
+
+    /*
+     * The conjunctions a flow contributes to, as conjunction ID,
+     * clause and number of clauses
+     */
+    typedef std::set<std::tuple<uint32_t, uint8_t, uint8_t> > ConjSet;
+
+    /*
+     * A flow matching one clause of conjunctive contract flows.
+     * Contracts whose rules have a clause with the same match and
+     * priority share the flow, which carries the conjunctions of all
+     * of them.  Map of flow object ID to the flow.
+     */
+    struct ConjClause {
+        /* a flow with the match of the clause */
+        FlowEntryPtr match;
+        /* the conjunctions of each contract using the clause */
+        std::unordered_map<opflex::modb::URI, ConjSet> conjs;
+    };
+    std::unordered_map<std::string, ConjClause> conjClauses;
+
+    /*
+     * The flows of a contract written as conjunctive matches: the
+     * clause flows it contributes to, and the ID keys of its
+     * conjunctions, which are also the object IDs of their flows
+     */
+    struct ContractConj {
+        std::set<std::string> clauses;
+        std::set<std::string> conjKeys;
+    };
+    std::unordered_map<opflex::modb::URI, ContractConj> contractConjs;
+
+    /**
+     * Get the vnid of an endpoint group or external network, if its
+     * routing domain is known
+     */
+    boost::optional<uint32_t> getGroupVnid(const opflex::modb::URI& uri);
     /**
      * Associate or disassociate a managed object with a multicast IP, and
      * update the multicast group subscription if necessary.
@@ -961,21 +1362,106 @@ private:
 
     /**
      * Write out the current multicast subscriptions
+     *
+     * @param snapshot true to write the whole file even when the
+     * journal is enabled
+     */
+    void writeMulticastGroups(bool snapshot = false);
+    /**
+     * A contract rule compiled for flow generation, with the matches
+     * of its classifier decoded
+     */
+    struct CompiledRule {
+        /** the direction of the rule */
+        uint8_t direction;
+        /** the priority of the rule */
+        uint16_t priority;
+        /** true to allow the traffic matched */
+        bool allow;
+        /** true to log the traffic matched */
+        bool log;
+        /** the flow cookie of the classifier */
+        uint64_t cookie;
+        /** the decoded classifier */
+        flowutils::ClassifierMatch match;
+    };
+
+    /**
+     * The compiled rules of a contract, in rule order
+     */
+    typedef std::vector<CompiledRule> compiled_rule_list_t;
+
+    /**
+     * Compile the rules of a contract once, before generating the
+     * flows for all its pairs of groups
+     *
+     * @param rules the rules of the contract
+     * @param compiled the compiled rules
      */
-    void writeMulticastGroups();
+    void compileContractRules(const PolicyManager::rule_list_t& rules,
+                              /* out */ compiled_rule_list_t& compiled);
+
     /**
+     * Add the flows of the rules of a contract between a pair of
+     * groups
      *
+     * @param entryList the list to append the flows to
+     * @param pvnid the vnid of the provider group
+     * @param cvnid the vnid of the consumer group
+     * @param allowBidirectional false to apply bidirectional rules in
+     * the IN direction only
+     * @param rules the compiled rules of the contract
      */
     void addContractRules(FlowEntryList& entryList,
                                  const uint32_t pvnid,
                                  const uint32_t cvnid,
                                  bool allowBidirectional,
-                                 const PolicyManager::rule_list_t& rules);
+                                 const compiled_rule_list_t& rules);
+
+    /**
+     * Check whether the flows of a contract need fewer entries as
+     * conjunctive matches, which is only the case for wide contracts.
+     * Contracts with a group that is both provider and consumer keep
+     * one flow per pair, so that their bidirectional rules are
+     * collapsed.
+     *
+     * @param provIds the vnids of the provider groups
+     * @param consIds the vnids of the consumer groups
+     * @return true to write conjunctive flows for the contract
+     */
+    bool useConjunctions(const std::unordered_set<uint32_t>& provIds,
+                         const std::unordered_set<uint32_t>& consIds);
+
+    /**
+     * Compute the conjunctive flows of the rules of a contract
+     * between its providers and consumers, and add the flows that
+     * changed, including shared clause flows and the flows of the
+     * conjunctions that are gone, to a list of object flows.  With no
+     * rules, removes the conjunctive flows of the contract.
+     *
+     * @param contractURI the URI of the contract
+     * @param provIds the vnids of the provider groups
+     * @param consIds the vnids of the consumer groups
+     * @param rules the compiled rules of the contract
+     * @param objs the list of object flows to append to
+     */
+    void updateContractConjunctions(
+        const opflex::modb::URI& contractURI,
+        const std::unordered_set<uint32_t>& provIds,
+        const std::unordered_set<uint32_t>& consIds,
+        const compiled_rule_list_t& rules,
+        /* out */ std::vector<std::pair<std::string, FlowEntryList> >& objs);
     /**
      * Handle if the droplog port name is read later
      */
     void handleDropLogPortUpdate();
 
+    /**
+     * Write the flows at the end of the tables that log the packets
+     * they drop, and the groups that sample them
+     */
+    void updateTableDropFlows();
+
     std::unique_ptr<std::thread> svcStatsThread;
     boost::asio::io_service svcStatsIOService;
     std::unique_ptr<boost::asio::io_service::work> svcStatsIOWork;
@@ -12,11 +12,13 @@
 #include <boost/asio.hpp>
 
 #include "SwitchConnection.h"
+#include "OvsdbConnection.h"
 #include <opflexagent/EndpointManager.h>
 #include "PortMapper.h"
 
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <mutex>
 
 #pragma once
@@ -33,7 +35,8 @@ class Agent;
  */
 class InterfaceStatsManager : private boost::noncopyable,
                               public EndpointListener,
-                              public MessageHandler {
+                              public MessageHandler,
+                              public OvsdbStatsListener {
 public:
     /**
      * Instantiate a new stats manager that will use the provided io
@@ -75,7 +78,8 @@ public:
                             SwitchConnection *accessConnection);
 
     /**
-     * Set the interval between stats requests.
+     * Set the interval between stats requests.  When called on a
+     * running manager, the interval applies from the next request.
      *
      * @param timerInterval the interval in milliseconds
      */
@@ -83,6 +87,19 @@ public:
         timer_interval = timerInterval;
     }
 
+    /**
+     * Take the counters of the interfaces from the OVSDB monitor of
+     * their statistics instead of polling the port stats of the
+     * bridges.  Each timer tick then only updates the endpoints whose
+     * interfaces changed since the last one.  Must be called before
+     * start.
+     *
+     * @param ovsdbStats true to take the counters from OVSDB
+     */
+    void setOvsdbStats(bool ovsdbStats) {
+        this->ovsdbStats = ovsdbStats;
+    }
+
     /**
      * Start the stats manager
      */
@@ -99,6 +116,12 @@ public:
                 ofpbuf *msg,
                 struct ofputil_flow_removed* fentry=NULL);
 
+    // see: OvsdbStatsListener
+    void interfaceStatsUpdated(const std::string& name,
+                               const std::unordered_map<std::string,
+                                                        uint64_t>& stats);
+    void interfaceStatsRemoved(const std::string& name);
+
 private:
     Agent* agent;
     PortMapper& intPortMapper;
@@ -106,10 +129,16 @@ private:
     SwitchConnection* intConnection;
     SwitchConnection* accessConnection;
     boost::asio::io_service& agent_io;
-    long timer_interval;
+    std::atomic<long> timer_interval;
     std::mutex timer_mutex;
     std::unique_ptr<boost::asio::deadline_timer> timer;
 
+    /**
+     * strand serializing the timer handlers on the stats io_service,
+     * which may be run by several threads
+     */
+    std::unique_ptr<boost::asio::io_service::strand> strand;
+
     /**
      * Counters for endpoints.
      */
@@ -122,7 +151,18 @@ private:
     intf_counter_map_t intfCounterMap;
     std::mutex statMtx;
 
+    bool ovsdbStats;
+
+    /**
+     * The last counters reported through OVSDB by interface name, and
+     * the interfaces whose counters changed since the last timer tick
+     */
+    std::unordered_map<std::string, EpCounters> ovsdbIntfCounters;
+    std::unordered_set<std::string> changedIntfs;
+
     void on_timer(const boost::system::error_code& ec);
+    void sendPortStatsRequests();
+    void updateChangedEndpoints();
     void updateEndpointCounters(const std::string& uuid,
                                 SwitchConnection *swConn,
                                 EpCounters& counters);
@@ -56,12 +56,15 @@ public:
 protected:
 
     /**
-     * Send the list of transact messages asynchronously to OVSDB
+     * Send the list of transact messages asynchronously to OVSDB, as
+     * one transaction.  The connection shared by the renderers
+     * collects the transactions for a short while, so it may share a
+     * transact request with the transactions of other renderers, and
+     * replace an update of the same row queued before it.
      * @param list List of transact requests
      */
     void sendAsyncTransactRequests(const list<OvsdbTransactMessage>& list) {
-        auto* req = new TransactReq(list, conn->getNextId());
-        conn->sendMessage(req, false);
+        conn->sendTransaction(list);
     }
 
     /**
@@ -62,6 +62,7 @@ public:
     // ********
 
     virtual void setProperties(const boost::property_tree::ptree& properties);
+    virtual bool reloadProperties(const boost::property_tree::ptree& properties);
     virtual void start();
     virtual void stop();
 
@@ -106,27 +107,53 @@ private:
     AdvertManager::EndpointAdvMode endpointAdvMode;
     AdvertManager::EndpointAdvMode tunnelEndpointAdvMode;
     uint64_t tunnelEndpointAdvIntvl;
+    uint32_t endpointAdvRateLimit;
     bool virtualDHCP;
     std::string virtualDHCPMac;
     std::string flowIdCache;
+    bool flowIdCacheJournal;
     std::string mcastGroupFile;
+    bool mcastGroupJournal;
     std::string dnsCacheDir;
     bool connTrack;
     uint16_t ctZoneRangeStart;
     uint16_t ctZoneRangeEnd;
     bool ovsdbUseLocalTcpPort;
+    size_t ovsdbTransactWindow;
+    size_t ovsdbTransactBatchSize;
+    uint64_t ovsdbTransactDelay;
+    std::chrono::milliseconds updateDebounce;
+    std::chrono::milliseconds updateMaxDebounce;
+    bool conjunctiveContracts;
+    bool endpointDestLookup;
+    bool routeAggregation;
+    bool stagedSync;
+    bool serviceSelectGroups;
+    bool conjunctiveSecGroups;
+    size_t flowWriteWindow;
+    bool groupBucketEdits;
+    size_t flowComputeThreads;
+    bool accessBridgeThread;
+    size_t packetInQueueSize;
+    uint64_t packetInRateLimit;
 
     bool ifaceStatsEnabled;
     long ifaceStatsInterval;
+    bool ifaceStatsOvsdb;
     bool contractStatsEnabled;
     long contractStatsInterval;
     bool serviceStatsFlowDisabled;
+    bool serviceStatsAggregated;
     bool serviceStatsEnabled;
     long serviceStatsInterval;
     bool secGroupStatsEnabled;
     long secGroupStatsInterval;
     bool tableDropStatsEnabled;
     long tableDropStatsInterval;
+    bool tableDropStatsSingleRequest;
+
+    /* the properties last passed to setProperties or reloadProperties */
+    boost::property_tree::ptree appliedProperties;
 
     std::unique_ptr<OvsdbConnection> ovsdbConnection;
     SpanRenderer spanRenderer;
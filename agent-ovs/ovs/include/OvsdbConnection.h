@@ -16,10 +16,16 @@
 #ifndef OVS_OVSDBCONNECTION_H
 #define OVS_OVSDBCONNECTION_H
 
+#include <algorithm>
 #include <atomic>
 #include <condition_variable>
 #include <mutex>
 #include <chrono>
+#include <deque>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <opflex/rpc/JsonRpcConnection.h>
 #include <opflex/rpc/JsonRpcMessage.h>
@@ -35,6 +41,32 @@ namespace opflexagent {
 using namespace std;
 using namespace rapidjson;
 
+/**
+ * Listener for the interface statistics monitored through OVSDB
+ */
+class OvsdbStatsListener {
+public:
+    virtual ~OvsdbStatsListener() {}
+
+    /**
+     * Called when the statistics of an interface change.  Called
+     * from the thread of the OVSDB connection.
+     *
+     * @param name the name of the interface
+     * @param stats the counters of the interface by name
+     */
+    virtual void interfaceStatsUpdated(const std::string& name,
+                                       const std::unordered_map<std::string, uint64_t>& stats) = 0;
+
+    /**
+     * Called when an interface is removed.  Called from the thread
+     * of the OVSDB connection.
+     *
+     * @param name the name of the interface
+     */
+    virtual void interfaceStatsRemoved(const std::string& name) = 0;
+};
+
 /**
  * Used to establish a connection to OVSDB
  */
@@ -45,9 +77,15 @@ class OvsdbConnection : public opflex::jsonrpc::RpcConnection {
      */
     OvsdbConnection(bool useLocalTcpPort) : opflex::jsonrpc::RpcConnection(),
         peer(nullptr), client_loop(nullptr), connected(false),
-        syncComplete(false), ovsdbUseLocalTcpPort(useLocalTcpPort) {
+        syncComplete(false), ovsdbUseLocalTcpPort(useLocalTcpPort),
+        transactWindow(DEFAULT_TRANSACT_WINDOW),
+        transactBatchSize(DEFAULT_TRANSACT_BATCH_SIZE),
+        transactDelay(0), transactTimerStarted(false),
+        statsListener(nullptr), statsMonitorReqId(0),
+        useMonitorCondSince(true) {
         connect_async = {};
         writeq_async = {};
+        transact_timer = {};
     }
 
     /**
@@ -99,10 +137,81 @@ class OvsdbConnection : public opflex::jsonrpc::RpcConnection {
         // monitor calls will be made on reconnect
         if (!connected) {
             syncComplete = false;
-            ovsdbState.clear();
+            {
+                // the conditional monitors resume from the last
+                // transaction seen, so the state is kept for them
+                const std::lock_guard<std::mutex> guard(monitorMtx);
+                pendingCondMonitors.clear();
+                if (!useMonitorCondSince || lastTxnIds.empty()) {
+                    lastTxnIds.clear();
+                    ovsdbState.clear();
+                }
+            }
+            // the responses to the transactions in flight are lost
+            const std::lock_guard<std::mutex> guard(transactMtx);
+            inflightTransacts.clear();
         }
     }
 
+    /**
+     * Set how transactions are pipelined to OVSDB
+     * @param window the most transact requests awaiting a response
+     * @param batchSize the most operations batched into one transact
+     * request
+     */
+    void setTransactWindow(size_t window, size_t batchSize) {
+        const std::lock_guard<std::mutex> guard(transactMtx);
+        transactWindow = std::max<size_t>(window, 1);
+        transactBatchSize = std::max<size_t>(batchSize, 1);
+    }
+
+    /**
+     * Set how long transactions are collected before they are sent,
+     * so that the transactions of the renderers reacting to the same
+     * change share a transact request.  Must be called before
+     * connecting.
+     * @param delay the milliseconds to wait after a transaction is
+     * queued while no other is queued, or 0 to send right away
+     */
+    void setTransactDelay(uint64_t delay) {
+        transactDelay = delay;
+    }
+
+    /**
+     * Monitor the statistics of the interfaces and report their
+     * changes to the listener.  vswitchd refreshes the statistics
+     * every other_config:stats-update-interval of the Open_vSwitch
+     * table.  Must be called before connecting.
+     *
+     * @param listener the listener for the statistics
+     */
+    void setStatsListener(OvsdbStatsListener* listener) {
+        statsListener = listener;
+    }
+
+    /**
+     * Limit the monitor of the bridge table to the bridges managed by
+     * the agent.  All the bridges are monitored if empty.  Must be
+     * called before connecting.
+     *
+     * @param names the names of the bridges
+     */
+    void setBridgeNames(const std::set<std::string>& names) {
+        bridgeNames = names;
+    }
+
+    /**
+     * Send a list of operations to OVSDB as one transaction.  The
+     * transaction is queued while the window of transact requests
+     * awaiting a response is full, and operations from the queued
+     * transactions are batched into the same transact request.  A
+     * queued transaction made of a single update is dropped when a
+     * later one updates the same row and columns.
+     * This can be called from any thread.
+     * @param requests the operations of the transaction
+     */
+    void sendTransaction(const list<OvsdbTransactMessage>& requests);
+
     /** Has the initial sync with OVSDB completed */
     bool isSyncComplete() {
         return syncComplete;
@@ -155,6 +264,12 @@ class OvsdbConnection : public opflex::jsonrpc::RpcConnection {
      */
     static void on_writeq_async(uv_async_t* handle);
 
+    /**
+     * callback for sending the transactions collected
+     * @param[in] handle pointer to uv_timer_t
+     */
+    static void on_transact_timer(uv_timer_t* handle);
+
     /**
      * call back for transaction response
      * @param[in] reqId request ID of the request for this response.
@@ -188,6 +303,19 @@ class OvsdbConnection : public opflex::jsonrpc::RpcConnection {
      */
     virtual void handleUpdate(const Document& payload);
 
+    /**
+     * call back for monitor_cond_since response
+     * @param[in] reqId request ID of the request for this response.
+     * @param[in] payload rapidjson::Value reference of the response body.
+     */
+    virtual void handleMonitorCondSince(uint64_t reqId, const Document& payload);
+
+    /**
+     * method for handling the async updates of the conditional
+     * monitors
+     */
+    virtual void handleUpdate3(const Document& payload);
+
     /**
      * condition variable used for synchronizing JSON/RPC
      * request and response
@@ -235,8 +363,59 @@ protected:
      */
     virtual void messagesReady();
 
+    /**
+     * Send as many of the queued transactions as the window allows.
+     * Must be called from the uv loop thread.
+     */
+    void flushTransactions();
+
 private:
 
+    /**
+     * A transaction queued or in flight
+     */
+    struct PendingTransact {
+        /** the operations of the transaction */
+        list<OvsdbTransactMessage> requests;
+        /** send the transaction in a transact request of its own */
+        bool alone;
+    };
+
+    /**
+     * Drop the queued transaction that a transaction supersedes.
+     * Must be called with transactMtx held.
+     */
+    void dropSupersededTransaction(const list<OvsdbTransactMessage>& requests);
+
+    /**
+     * Queue transactions that could not be committed along with
+     * the rest of their batch, to be retried one by one
+     */
+    void retryTransactions(vector<PendingTransact>& batch, size_t failed);
+
+    /**
+     * Report the statistics of the rows of an update of the
+     * interface statistics monitor to the listener
+     */
+    void processInterfaceStats(const Value& rows);
+
+    /**
+     * Send the monitor request for a table of the state
+     * @param table the table
+     * @param conditional send a monitor_cond_since request
+     */
+    void sendStateMonitor(OvsdbTable table, bool conditional);
+
+    /**
+     * Apply the row updates of a table of a monitor_cond_since
+     * response or of an update3 notification to the state
+     * @param table the table
+     * @param rows the row updates of the table
+     * @param replace replace the table with the rows rather than
+     * applying the updates to it
+     */
+    void processRowUpdates2(OvsdbTable table, const Value& rows, bool replace);
+
     void decrSyncMsgsRemaining() {
         syncMsgsRemaining--;
         if (syncMsgsRemaining == 0) {
@@ -249,6 +428,7 @@ private:
     opflex::util::ThreadManager threadManager;
     uv_async_t connect_async;
     uv_async_t writeq_async;
+    uv_timer_t transact_timer;
     std::atomic<bool> connected;
     std::atomic<bool> syncComplete;
     std::atomic<int> syncMsgsRemaining;
@@ -257,7 +437,31 @@ private:
     std::string remote_peer;
     OvsdbState ovsdbState;
 
+    std::mutex transactMtx;
+    std::deque<PendingTransact> pendingTransacts;
+    std::unordered_map<uint64_t, vector<PendingTransact>> inflightTransacts;
+    size_t transactWindow;
+    size_t transactBatchSize;
+    uint64_t transactDelay;
+    // when the transactions collected are due
+    std::chrono::steady_clock::time_point transactDue;
+    bool transactTimerStarted;
+
+    OvsdbStatsListener* statsListener;
+    uint64_t statsMonitorReqId;
+
+    std::set<std::string> bridgeNames;
+    std::atomic<bool> useMonitorCondSince;
+    std::mutex monitorMtx;
+    // table of the monitor_cond_since requests awaiting a response
+    std::unordered_map<uint64_t, OvsdbTable> pendingCondMonitors;
+    // last transaction seen by each monitor ID
+    std::unordered_map<std::string, std::string> lastTxnIds;
+
     const int WAIT_TIMEOUT = 5000;
+    static const size_t DEFAULT_TRANSACT_WINDOW = 8;
+    static const size_t DEFAULT_TRANSACT_BATCH_SIZE = 256;
+    static const char* STATS_MONITOR_ID;
 };
 
 
@@ -69,6 +69,15 @@ public:
         return reqId;
     }
 
+    /**
+     * Send the request with its own request ID, so that the
+     * response can be matched with it
+     * @return request ID
+     */
+    virtual uint64_t getReqXid() const {
+        return reqId;
+    }
+
     /**
      * Serialize payload
      * @param writer writer
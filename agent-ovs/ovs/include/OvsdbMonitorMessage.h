@@ -32,8 +32,40 @@ public:
      * @param table_ Table to be monitored
      * @param columns_ Columns to monitor (all columns if empty)
      * @param reqId Req ID for the message
+     * @param monitorId_ ID that identifies the updates of the monitor
+     * (the name of the table if empty)
      */
-    OvsdbMonitorMessage(OvsdbTable table_, const std::list<std::string>& columns_, uint64_t reqId) : OvsdbMessage("monitor", REQUEST, reqId), table(table_), columns(columns_) {}
+    OvsdbMonitorMessage(OvsdbTable table_, const std::list<std::string>& columns_, uint64_t reqId,
+                        const std::string& monitorId_ = "")
+        : OvsdbMessage("monitor", REQUEST, reqId), table(table_), columns(columns_),
+          monitorId(monitorId_.empty() ? toString(table_) : monitorId_),
+          conditional(false) {}
+
+    /**
+     * Constructor for a conditional monitor that resumes from a
+     * transaction, sent as monitor_cond_since.  The updates are sent
+     * as update3 notifications.
+     * @param table_ Table to be monitored
+     * @param columns_ Columns to monitor (all columns if empty)
+     * @param whereColumn_ Only monitor the rows whose value of this
+     * column is one of whereValues_ (all rows if empty)
+     * @param whereValues_ Values of whereColumn_ to monitor
+     * @param lastTxnId_ ID of the last transaction seen by the
+     * monitor, from which the updates resume (the updates start from
+     * the initial contents of the table if empty)
+     * @param reqId Req ID for the message
+     * @param monitorId_ ID that identifies the updates of the monitor
+     * (the name of the table if empty)
+     */
+    OvsdbMonitorMessage(OvsdbTable table_, const std::list<std::string>& columns_,
+                        const std::string& whereColumn_,
+                        const std::list<std::string>& whereValues_,
+                        const std::string& lastTxnId_, uint64_t reqId,
+                        const std::string& monitorId_ = "")
+        : OvsdbMessage("monitor_cond_since", REQUEST, reqId), table(table_), columns(columns_),
+          monitorId(monitorId_.empty() ? toString(table_) : monitorId_),
+          conditional(true), whereColumn(whereColumn_), whereValues(whereValues_),
+          lastTxnId(lastTxnId_) {}
 
     /**
      * Destructor
@@ -49,6 +81,11 @@ public:
 private:
     OvsdbTable table;
     std::list<std::string> columns;
+    std::string monitorId;
+    bool conditional;
+    std::string whereColumn;
+    std::list<std::string> whereValues;
+    std::string lastTxnId;
 };
 
 }
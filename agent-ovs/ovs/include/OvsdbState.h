@@ -51,13 +51,19 @@ typedef struct mirror_ {
      */
     set<string> dst_ports;
     /**
-      * set of erspan ports
+      * UUID of the output port
       */
     string out_port;
 } mirror;
 
 /**
  * Local representation of the OVSDB state
+ *
+ * The rows of each table are indexed by name, so that the lookups of
+ * the renderers do not scan the tables.  The state is written from
+ * the thread of the OVSDB connection and read from the renderers;
+ * the lock is held only for the lookups, which copy out the few
+ * values asked for.
  */
 class OvsdbState {
 public:
@@ -74,7 +80,11 @@ public:
      */
     void fullUpdate(OvsdbTable table, const OvsdbTableDetails& fields) {
         unique_lock<mutex> lock(stateMutex);
-        ovsdbState[table] = fields;
+        TableState& ts = ovsdbState[table];
+        ts.rows = fields;
+        ts.nameIndex.clear();
+        for (const auto& row : ts.rows)
+            ts.index(row.first, row.second);
     }
 
     /**
@@ -82,7 +92,15 @@ public:
      */
     void updateRow(OvsdbTable table, const string& key, const OvsdbRowDetails& row) {
         unique_lock<mutex> lock(stateMutex);
-        ovsdbState[table][key] = row;
+        TableState& ts = ovsdbState[table];
+        auto it = ts.rows.find(key);
+        if (it != ts.rows.end()) {
+            ts.unindex(key, it->second);
+            it->second = row;
+        } else {
+            it = ts.rows.emplace(key, row).first;
+        }
+        ts.index(key, it->second);
     }
 
     /**
@@ -90,7 +108,28 @@ public:
      */
     void deleteRow(OvsdbTable table, const string& key) {
         unique_lock<mutex> lock(stateMutex);
-        ovsdbState[table].erase(key);
+        TableState& ts = ovsdbState[table];
+        auto it = ts.rows.find(key);
+        if (it == ts.rows.end())
+            return;
+        ts.unindex(key, it->second);
+        ts.rows.erase(it);
+    }
+
+    /**
+     * Get a copy of a row in cache
+     * @param table table of the row
+     * @param key key of the row
+     * @param row filled with the row
+     * @return true if the row is present
+     */
+    bool getRow(OvsdbTable table, const string& key, OvsdbRowDetails& row) {
+        unique_lock<mutex> lock(stateMutex);
+        const OvsdbRowDetails* r = findRow(table, key);
+        if (!r)
+            return false;
+        row = *r;
+        return true;
     }
 
     /** Clear the state */
@@ -106,11 +145,13 @@ public:
      */
     void getBridgeUuid(const string& bridgeName, string& uuid) {
         unique_lock<mutex> lock(stateMutex);
-        auto& bridgeRows = ovsdbState[OvsdbTable::BRIDGE];
-        if (bridgeRows.find(bridgeName) != bridgeRows.end()) {
-            auto bridgeParams = bridgeRows[bridgeName];
-            if (bridgeParams.find("uuid") != bridgeParams.end()) {
-                uuid = bridgeParams["uuid"].getStringValue();
+        const OvsdbRowDetails* row = findByName(OvsdbTable::BRIDGE, bridgeName);
+        if (!row)
+            row = findRow(OvsdbTable::BRIDGE, bridgeName);
+        if (row) {
+            auto it = row->find("uuid");
+            if (it != row->end()) {
+                uuid = it->second.getStringValue();
             }
         }
     }
@@ -124,27 +165,25 @@ public:
      */
     void getUuidForName(OvsdbTable table, const string& name, string& uuid) {
         unique_lock<mutex> lock(stateMutex);
-        auto& portRows = ovsdbState[table];
-        for (auto& row : portRows) {
-            if (row.second.find("name") != row.second.end()) {
-                if (row.second["name"].getStringValue() == name) {
-                    LOG(DEBUG) << "Found mapping from " << name << " to " << row.second["uuid"].getStringValue();
-                    uuid = row.second["uuid"].getStringValue();
-                }
+        const OvsdbRowDetails* row = findByName(table, name);
+        if (row) {
+            auto it = row->find("uuid");
+            if (it != row->end()) {
+                LOG(DEBUG) << "Found mapping from " << name << " to " << it->second.getStringValue();
+                uuid = it->second.getStringValue();
             }
         }
     }
 
     void getQosUuidForPort(const string& name, string& uuid) {
         unique_lock<mutex> lock(stateMutex);
-        auto& portRows = ovsdbState[OvsdbTable::PORT];
-        for (auto& row : portRows) {
-            if (row.second.find("name") != row.second.end() &&
-                row.second.find("qos") != row.second.end() &&
-                row.second["name"].getStringValue() == name) {
-                const auto& col = row.second["qos"].getCollectionValue();
-                for(auto it = col.begin(); it!=col.end();it++){
-                    uuid = it->first;
+        const OvsdbRowDetails* row = findByName(OvsdbTable::PORT, name);
+        if (row) {
+            auto it = row->find("qos");
+            if (it != row->end()) {
+                const auto& col = it->second.getCollectionValue();
+                for (auto cit = col.begin(); cit != col.end(); cit++) {
+                    uuid = cit->first;
                 }
             }
         }
@@ -152,17 +191,17 @@ public:
 
     void getQueueUuidForQos(const string& qos, string &uuid) {
         unique_lock<mutex> lock(stateMutex);
-        auto& qosRows = ovsdbState[OvsdbTable::QOS];
-        for (auto& row : qosRows) {
-             if (row.second.find("uuid") != row.second.end() &&
-                 row.second["uuid"].getStringValue() == qos &&
-                 row.second.find("queues") != row.second.end())  {
-                 const auto& col = row.second["queues"].getCollectionValue();
-                 for(auto it = col.begin(); it != col.end(); it++) {
-                     LOG(DEBUG) << "queue: " << it->first << "=" << it->second;
-                     uuid = it->second;
-                 }
-             }
+        // QoS rows are keyed by UUID
+        const OvsdbRowDetails* row = findRow(OvsdbTable::QOS, qos);
+        if (row) {
+            auto it = row->find("queues");
+            if (it != row->end()) {
+                const auto& col = it->second.getCollectionValue();
+                for (auto cit = col.begin(); cit != col.end(); cit++) {
+                    LOG(DEBUG) << "queue: " << cit->first << "=" << cit->second;
+                    uuid = cit->second;
+                }
+            }
         }
     }
 
@@ -175,53 +214,57 @@ public:
     bool getMirrorState(const string& name, mirror& mir) {
         bool found = false;
         unique_lock<mutex> lock(stateMutex);
-        auto mirrorRows = ovsdbState[OvsdbTable::MIRROR];
-        for (auto& row : mirrorRows) {
-            if (row.second.find("name") != row.second.end()) {
-                if (row.second["name"].getStringValue() == name) {
-                    LOG(DEBUG) << "Found mirror with name " << name;
-                    if (row.second.find("uuid") != row.second.end()) {
-                        mir.uuid = row.second["uuid"].getStringValue();
-                        found = true;
-                    } else {
-                        LOG(WARNING) << "Unable to find UUID for mirror named " << name;
-                    }
-                    mir.src_ports.clear();
-                    if (row.second.find("select_src_port") != row.second.end()) {
-                        if (row.second["select_src_port"].getType() == Dtype::SET) {
-                            auto ports = row.second["select_src_port"].getCollectionValue();
-                            for (auto& port : ports) {
-                                mir.src_ports.emplace(port.first);
-                                LOG(DEBUG) << "add src port " << port.first;
-                            }
-                        } else if (row.second["select_src_port"].getType() == Dtype::STRING) {
-                            auto& port = row.second["select_src_port"].getStringValue();
-                            mir.src_ports.emplace(port);
-                            LOG(DEBUG) << "add src port " << port;
-                        }
-                    }
-                    mir.dst_ports.clear();
-                    if (row.second.find("select_dst_port") != row.second.end()) {
-                        if (row.second["select_dst_port"].getType() == Dtype::SET) {
-                            auto ports = row.second["select_dst_port"].getCollectionValue();
-                            for (auto& port : ports) {
-                                mir.dst_ports.emplace(port.first);
-                                LOG(DEBUG) << "add dest port " << port.first;
-                            }
-                        } else if (row.second["select_dst_port"].getType() == Dtype::STRING) {
-                            auto& port = row.second["select_dst_port"].getStringValue();
-                            mir.dst_ports.emplace(port);
-                            LOG(DEBUG) << "add dest port " << port;
-                        }
-                    }
-                    if (row.second.find("out_port") != row.second.end()) {
-                        auto& port = row.second["out_port"].getStringValue();
-                        mir.out_port = port;
-                        LOG(DEBUG) << "add out port " << port;
-                    }
+        const OvsdbRowDetails* row = findByName(OvsdbTable::MIRROR, name);
+        if (!row)
+            return false;
+        LOG(DEBUG) << "Found mirror with name " << name;
+        auto it = row->find("uuid");
+        if (it != row->end()) {
+            mir.uuid = it->second.getStringValue();
+            found = true;
+        } else {
+            LOG(WARNING) << "Unable to find UUID for mirror named " << name;
+        }
+        mir.src_ports.clear();
+        it = row->find("select_src_port");
+        if (it != row->end()) {
+            if (it->second.getType() == Dtype::SET) {
+                auto ports = it->second.getCollectionValue();
+                for (auto& port : ports) {
+                    mir.src_ports.emplace(port.first);
+                    LOG(DEBUG) << "add src port " << port.first;
                 }
+            } else if (it->second.getType() == Dtype::STRING) {
+                auto& port = it->second.getStringValue();
+                mir.src_ports.emplace(port);
+                LOG(DEBUG) << "add src port " << port;
             }
         }
+        mir.dst_ports.clear();
+        it = row->find("select_dst_port");
+        if (it != row->end()) {
+            if (it->second.getType() == Dtype::SET) {
+                auto ports = it->second.getCollectionValue();
+                for (auto& port : ports) {
+                    mir.dst_ports.emplace(port.first);
+                    LOG(DEBUG) << "add dest port " << port.first;
+                }
+            } else if (it->second.getType() == Dtype::STRING) {
+                auto& port = it->second.getStringValue();
+                mir.dst_ports.emplace(port);
+                LOG(DEBUG) << "add dest port " << port;
+            }
+        }
+        mir.out_port.clear();
+        it = row->find("output_port");
+        if (it != row->end()) {
+            auto ports = it->second.getCollectionValue();
+            if (!ports.empty())
+                mir.out_port = ports.begin()->first;
+            else
+                mir.out_port = it->second.getStringValue();
+            LOG(DEBUG) << "add out port " << mir.out_port;
+        }
         return found;
     }
 
@@ -230,36 +273,79 @@ public:
      */
     bool getErspanParams(const string& interfaceName, ErspanParams& params) {
         unique_lock<mutex> lock(stateMutex);
-        auto interfaceRows = ovsdbState[OvsdbTable::INTERFACE];
-        for (auto& row : interfaceRows) {
-            if (row.second.find("name") != row.second.end()) {
-                if (row.second["name"].getStringValue() == interfaceName) {
-                    LOG(DEBUG) << "found erspan params for interface " << interfaceName;
-                    params.setPortName(interfaceName);
-                    if (row.second.find("options") != row.second.end()) {
-                        auto options = row.second["options"].getCollectionValue();
-                        if (options.find("erspan_ver") != options.end()) {
-                            LOG(DEBUG) << "setting version to " << options["erspan_ver"];
-                            params.setVersion(stoul(options["erspan_ver"]));
-                        }
-                        if (options.find("remote_ip") != options.end()) {
-                            LOG(DEBUG) << "Setting remote IP to " << options["remote_ip"];
-                            params.setRemoteIp(options["remote_ip"]);
-                        }
-                        if (options.find("key") != options.end()) {
-                            LOG(DEBUG) << "Setting session ID to " << options["key"];
-                            params.setSessionId(stoul(options["key"]));
-                        }
-                    }
-                    return true;
-                }
+        const OvsdbRowDetails* row = findByName(OvsdbTable::INTERFACE, interfaceName);
+        if (!row)
+            return false;
+        LOG(DEBUG) << "found erspan params for interface " << interfaceName;
+        params.setPortName(interfaceName);
+        auto it = row->find("options");
+        if (it != row->end()) {
+            auto options = it->second.getCollectionValue();
+            if (options.find("erspan_ver") != options.end()) {
+                LOG(DEBUG) << "setting version to " << options["erspan_ver"];
+                params.setVersion(stoul(options["erspan_ver"]));
+            }
+            if (options.find("remote_ip") != options.end()) {
+                LOG(DEBUG) << "Setting remote IP to " << options["remote_ip"];
+                params.setRemoteIp(options["remote_ip"]);
+            }
+            if (options.find("key") != options.end()) {
+                LOG(DEBUG) << "Setting session ID to " << options["key"];
+                params.setSessionId(stoul(options["key"]));
             }
         }
-        return false;
+        return true;
     }
 
 private:
-    unordered_map<OvsdbTable, OvsdbTableDetails> ovsdbState;
+    /**
+     * The rows of a table, and the keys of the rows by the value of
+     * their name column
+     */
+    struct TableState {
+        OvsdbTableDetails rows;
+        unordered_map<string, string> nameIndex;
+
+        void index(const string& key, const OvsdbRowDetails& row) {
+            auto it = row.find("name");
+            if (it != row.end())
+                nameIndex[it->second.getStringValue()] = key;
+        }
+
+        void unindex(const string& key, const OvsdbRowDetails& row) {
+            auto it = row.find("name");
+            if (it == row.end())
+                return;
+            auto nit = nameIndex.find(it->second.getStringValue());
+            if (nit != nameIndex.end() && nit->second == key)
+                nameIndex.erase(nit);
+        }
+    };
+
+    /* Must be called with stateMutex held */
+    const OvsdbRowDetails* findRow(OvsdbTable table, const string& key) const {
+        auto tit = ovsdbState.find(table);
+        if (tit == ovsdbState.end())
+            return NULL;
+        auto it = tit->second.rows.find(key);
+        return it == tit->second.rows.end() ? NULL : &it->second;
+    }
+
+    /* Must be called with stateMutex held */
+    const OvsdbRowDetails* findByName(OvsdbTable table, const string& name) const {
+        auto tit = ovsdbState.find(table);
+        if (tit == ovsdbState.end())
+            return NULL;
+        auto nit = tit->second.nameIndex.find(name);
+        if (nit == tit->second.nameIndex.end())
+            return NULL;
+        auto it = tit->second.rows.find(nit->second);
+        return it == tit->second.rows.end() ? NULL : &it->second;
+    }
+
+    unordered_map<OvsdbTable, TableState> ovsdbState;
+    // a plain mutex, as there is no shared mutex in C++11 and
+    // boost_thread is not linked; the lookups under it are short
     mutex stateMutex;
 };
 
@@ -41,7 +41,8 @@ public:
      */
      OvsdbTransactMessage(const OvsdbTransactMessage& copy) : OvsdbMessage("transact", REQUEST),
          conditions(copy.conditions), columns(copy.columns), rowData(copy.rowData), mutateRowData(copy.mutateRowData),
-         externalKey(copy.externalKey), operation(copy.getOperation()), table(copy.getTable()) {}
+         externalKey(copy.externalKey), uuidNameSuffix(copy.uuidNameSuffix),
+         operation(copy.getOperation()), table(copy.getTable()) {}
 
     /**
      * Assignment operator
@@ -94,6 +95,12 @@ public:
      * generated key name to value
      */
     pair<string, string> externalKey;
+    /**
+     * suffix appended to the uuid-name of the row and to the
+     * named-uuid references, which keeps the names of requests
+     * batched into the same transaction apart
+     */
+    string uuidNameSuffix;
 
 private:
     OvsdbOperation operation;
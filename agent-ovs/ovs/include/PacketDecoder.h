@@ -11,6 +11,7 @@
 #ifndef OPFLEXAGENT_PACKETDECODER_H
 #define OPFLEXAGENT_PACKETDECODER_H
 
+#include <algorithm>
 #include <memory>
 #include <unordered_map>
 #include <set>
@@ -33,6 +34,7 @@ using rapidjson::StringBuffer;
 namespace opflexagent {
 
 class PacketDecoder;
+class PacketDecoderLayerField;
 
     /**
      * Field indices
@@ -134,6 +136,52 @@ public:
  */
 bool operator== (const PacketTuple &lhs, const PacketTuple &rhs);
 
+/**
+ * A logged field decoded from a packet, kept raw until the output is
+ * formatted
+ */
+struct ParsedField {
+    /**
+     * The field definition
+     */
+    const PacketDecoderLayerField *field;
+    /**
+     * Value of integer fields
+     */
+    uint32_t value;
+    /**
+     * Type id of the next layer, to name next layer keys
+     */
+    uint32_t nextTypeId;
+    /**
+     * Bytes of the field in the decoded buffer
+     */
+    const unsigned char *data;
+    /**
+     * Number of bytes of the field
+     */
+    uint32_t dataLength;
+};
+
+/**
+ * A layer decoded from a packet, kept raw until the output is
+ * formatted
+ */
+struct ParsedLayer {
+    /**
+     * Compiled format string of the layer or of its variant
+     */
+    const boost::format *format;
+    /**
+     * Number of arguments in the format string
+     */
+    uint32_t numOutArgs;
+    /**
+     * Number of logged fields of this layer in the parsed fields
+     */
+    uint32_t fieldCount;
+};
+
 /**
  *  Struct to hold parsing context
  */
@@ -145,7 +193,7 @@ struct ParseInfo {
      */
     ParseInfo(PacketDecoder *_decoder):pktDecoder(_decoder),nextLayerTypeId(0),
             nextKey(0), optionLayerTypeId(0), parsedLength(0), parsedString(),
-            formattedFields(), layerFormatterString(), hasOptBytes(false),
+            hasOptBytes(false),
             pendingOptionLength(0), inferredLength(0), inferredDataLength(0),
             scratchpad{0,0,0,0}, packetTuple(), meta{0,0,0,0}, pruneLog(false) {
         time_t rawtime = std::time(nullptr);
@@ -181,21 +229,19 @@ struct ParseInfo {
      */
     uint32_t parsedLength;
     /**
-     * Parsed output
+     * Parsed output, filled in by PacketDecoder::formatLog
      */
     std::string parsedString;
     /**
-     * Parsed output for current layer
-     */
-    std::string parsedLayerString;
-    /**
-     * Field values in the format string of a given layer
+     * Decoded layers, in order
      */
-    std::vector<std::string> formattedFields;
+    std::vector<ParsedLayer> parsedLayers;
     /**
-     * Format string of a given layer
+     * Logged fields of the decoded layers, in order.  These point into
+     * the decoded buffer, so the output must be formatted while it is
+     * still valid.
      */
-    boost::format layerFormatterString;
+    std::vector<ParsedField> parsedFields;
     /**
      * Layer has variable length data
      */
@@ -266,7 +312,18 @@ public:
             int printSeq = 0, int tupleSeq_ = 0, int metaSeq_ = 0):
         fieldType(type), fieldName(name), bitLength(len), bitOffset(offset),
         isNextKey(nextKey), isLength(length), scratchOffset(_scratchOffset),
-        outSeq(printSeq), tupleSeq(tupleSeq_), metaSeq(metaSeq_) {}
+        outSeq(printSeq), tupleSeq(tupleSeq_), metaSeq(metaSeq_) {
+        byteOffset = bitOffset/8;
+        if(fieldType == FLDTYPE_BITFIELD) {
+            uint32_t bits = bitOffset%8 + bitLength;
+            byteCount = (bits + 7)/8;
+            shift = byteCount*8 - bits;
+        } else {
+            byteCount = bitLength/8;
+            shift = 0;
+        }
+        mask = (bitLength >= 32) ? 0xffffffff : ((1u << bitLength) - 1);
+    }
     /**
      * Whether matching traffic should be allowed or dropped
      * @return true if this field indicates the length of the containing Layer
@@ -280,6 +337,19 @@ public:
      * @return true if required number of bits were extracted and valid.
      */
     int decode(const unsigned char *buf, std::size_t length, ParseInfo &p);
+    /**
+     * Format a decoded value of this field
+     * @param f the decoded field
+     * @param decoder decoder used to name next layer keys
+     * @param out string to append the formatted value to
+     */
+    void format(const ParsedField &f, PacketDecoder *decoder,
+                std::string &out) const;
+    /**
+     * Get the position of this field in the layer output
+     * @return 1-based argument of the format string, 0 if not logged
+     */
+    int getOutSeq() const {return outSeq;}
     /**
      * populate human readable strings for specific field values as a map
      * @param outMap value to string map for field values.
@@ -292,13 +362,17 @@ private:
     uint32_t bitOffset;
     bool isNextKey,isLength;
     int scratchOffset, outSeq, tupleSeq, metaSeq;
+    /* byte offset, byte count, shift and mask of integer fields,
+       computed from the bit offset and length */
+    uint32_t byteOffset, byteCount, shift, mask;
     std::unordered_map<uint32_t, std::string> kvOutMap;
-    bool getIsNextKey() {return isNextKey;}
-    bool shouldSave(int &_offset) {_offset=scratchOffset; return (_offset != -1);}
-    bool shouldLog() {return (outSeq != 0);}
-    bool isTupleField() {return (tupleSeq != 0);}
-    bool isMetaField() {return (metaSeq != 0);}
-    void transformLog(uint32_t val, std::stringstream &ostr, ParseInfo &p);
+    uint32_t extract(const unsigned char *data) const {
+        uint32_t value = 0;
+        for(uint32_t i=0; i < byteCount; i++) {
+            value = (value << 8) | data[i];
+        }
+        return (value >> shift) & mask;
+    }
 };
 
 /**
@@ -337,6 +411,15 @@ public:
      * @param p Parsing Context and output
      */
     virtual void reParse(ParseInfo &p) {;}
+    /**
+     * Compile the format string of this variant once configured
+     */
+    void compile() { getFormatString(compiledFormat); }
+    /**
+     * Get the compiled format string of this variant
+     * @return format string for variant output
+     */
+    const boost::format &getCompiledFormat() const { return compiledFormat; }
     /**
      * Get the Id of this layer
      * @return layer id
@@ -381,6 +464,8 @@ protected:
     std::vector<uint32_t> keyData;
     /** Hash of key data */
     std::size_t hash;
+    /** Format string compiled by compile() */
+    boost::format compiledFormat;
 };
 
 /**
@@ -489,8 +574,16 @@ public:
      */
     void addVariant(std::size_t key,
             std::shared_ptr<PacketDecoderLayerVariant>& sptr) {
-        layerVariants.insert(std::make_pair(key,sptr));
+        auto it = std::lower_bound(layerVariants.begin(), layerVariants.end(),
+                                   key, variantKeyLess);
+        if(it == layerVariants.end() || it->first != key) {
+            layerVariants.insert(it, std::make_pair(key,sptr));
+        }
     }
+    /**
+     * Compile the format string of this layer once configured
+     */
+    void compile() { getFormatString(compiledFormat); }
     /**
      * Extract the field value from the given buffer
      * @param buf buffer to extract bytes from
@@ -536,8 +629,7 @@ public:
      * Get the variant layer from parsed data
      * @param p Parsing Context and output
      */
-    virtual std::shared_ptr<PacketDecoderLayerVariant>
-        getVariant(ParseInfo &p) {
+    virtual PacketDecoderLayerVariant *getVariant(ParseInfo &p) {
         return nullptr;
     }
 protected:
@@ -559,9 +651,27 @@ protected:
      */
     std::vector<PacketDecoderLayerField> pktFields;
     /**
-     * Variants in the layer
+     * Variants in the layer, sorted by key
      */
-    std::map<std::size_t,std::shared_ptr<PacketDecoderLayerVariant>> layerVariants;
+    std::vector<std::pair<std::size_t,
+            std::shared_ptr<PacketDecoderLayerVariant>>> layerVariants;
+    /**
+     * Format string compiled by compile()
+     */
+    boost::format compiledFormat;
+    /**
+     * Find a variant of this layer
+     * @param key key of the variant
+     * @return the variant, or NULL if there is none for this key
+     */
+    PacketDecoderLayerVariant *findVariant(std::size_t key) {
+        auto it = std::lower_bound(layerVariants.begin(), layerVariants.end(),
+                                   key, variantKeyLess);
+        if(it != layerVariants.end() && it->first == key) {
+            return it->second.get();
+        }
+        return nullptr;
+    }
     /**
      * This is an option header layer
      */
@@ -589,22 +699,57 @@ protected:
                 nextKey, isLength, scratchOffset, printSeq, tupleSeq, metaSeq));
         return 0;
     };
+private:
+    static bool variantKeyLess(const std::pair<std::size_t,
+                               std::shared_ptr<PacketDecoderLayerVariant>> &v,
+                               std::size_t key) {
+        return v.first < key;
+    }
 };
 
 /**
  *  Packet Decoder main interface
+ *
+ * Once the layers are configured, they are compiled into flat
+ * dispatch tables indexed by layer type, so that decoding a packet
+ * follows the next layer keys (ethertype, IP protocol, ...) without
+ * hashing.  Decoding only extracts the field values; the log output
+ * is formatted from them by formatLog when it is needed.
  */
 class PacketDecoder {
 public:
     /**
      * Constructor for PacketDecoder
      */
-    PacketDecoder():baseLayerId(0){};
+    PacketDecoder():baseLayer(nullptr), baseLayerId(0){};
     /**
      * Customize PacketDecoder by adding layers inside this method
      * @return true if no errors occurred during configuration
      */
     int configure();
+    /**
+     * Find the layer for a key of a base layer type in the compiled
+     * dispatch tables
+     * @param typeId base layer type id
+     * @param key key for the specific layer
+     * @return the layer, or NULL if there is none
+     */
+    PacketDecoderLayer *findLayer(uint32_t typeId, uint32_t key) const {
+        if(typeId >= dispatchTable.size()) {
+            return nullptr;
+        }
+        const LayerDispatch &d = dispatchTable[typeId];
+        if(key < d.direct.size()) {
+            return d.direct[key];
+        }
+        auto it = std::lower_bound(d.sorted.begin(), d.sorted.end(), key,
+                [](const std::pair<uint32_t, PacketDecoderLayer *> &e,
+                   uint32_t k) { return e.first < k; });
+        if(it != d.sorted.end() && it->first == key) {
+            return it->second;
+        }
+        return nullptr;
+    }
     /**
      * Get corresponding layer for the given id
      * @param id layer id
@@ -658,8 +803,8 @@ public:
      */
     bool getLayerNameByTypeKey(uint32_t typeId, uint32_t key,
             std::string &layerName) {
-        std::shared_ptr<PacketDecoderLayer> p;
-        if(getLayerByTypeKey(typeId, key, p)) {
+        PacketDecoderLayer *p = findLayer(typeId, key);
+        if(p) {
             layerName = p->getName();
             return true;
         }
@@ -686,7 +831,25 @@ public:
      * @return true if decoding was error free
      */
     int decode(const unsigned char *buf, std::size_t length, ParseInfo &p);
+
+    /**
+     * Format the log output of a decoded packet into its parsed
+     * string.  Must be called while the decoded buffer is still
+     * valid.
+     * @param p context of the decoded packet
+     * @return the parsed string
+     */
+    const std::string &formatLog(ParseInfo &p) const;
 private:
+    /* Keys below this are dispatched by direct index */
+    static const uint32_t DIRECT_KEYS = 256;
+    /* Compiled dispatch table of the layers of one base type */
+    struct LayerDispatch {
+        std::vector<PacketDecoderLayer *> direct;
+        std::vector<std::pair<uint32_t, PacketDecoderLayer *>> sorted;
+    };
+    std::vector<LayerDispatch> dispatchTable;
+    PacketDecoderLayer *baseLayer;
     std::unordered_map<std::string, uint32_t> layerTypeMap;
     std::unordered_map<std::string, uint32_t> layerNameMap;
     std::unordered_map<uint32_t, std::unordered_map<uint32_t,
@@ -696,6 +859,7 @@ private:
     uint32_t baseLayerId;
     void registerLayer(std::shared_ptr<PacketDecoderLayer>&);
     void registerLayer(std::shared_ptr<PacketDecoderLayerVariant>&);
+    void compile();
 };
 
 }
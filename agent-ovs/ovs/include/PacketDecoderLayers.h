@@ -72,8 +72,7 @@ public:
     virtual uint32_t getVariableDataLength(uint32_t hdrLength);
     virtual uint32_t getVariableHeaderLength(uint32_t fldVal);
     virtual void getFormatString(boost::format &fmtStr);
-    virtual std::shared_ptr<PacketDecoderLayerVariant>
-            getVariant(ParseInfo &p);
+    virtual PacketDecoderLayerVariant *getVariant(ParseInfo &p);
 };
 
 /**
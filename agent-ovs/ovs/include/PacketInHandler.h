@@ -20,6 +20,15 @@
 #include "TableState.h"
 #include <opflexagent/Agent.h>
 #include "DnsManager.h"
+#include "Packets.h"
+#include <opflexagent/KeyedRateLimiter.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
 
 struct dp_packet;
 struct flow;
@@ -31,6 +40,12 @@ class IntFlowManager;
 
 /**
  * Handler for packet-in messages arriving from the switch
+ *
+ * Once started, the packet-ins are sorted by their cookie into a
+ * queue for each kind of packet-in, each with a worker thread of its
+ * own, so that a storm of one kind does not delay the others or the
+ * connection.  The queues are bounded and rate limited, and count
+ * the packet-ins they drop.
  */
 class PacketInHandler : public MessageHandler,
                         private boost::noncopyable {
@@ -40,6 +55,49 @@ public:
      */
     PacketInHandler(Agent& agent, IntFlowManager& intFlowManager, DnsManager& dnsManager);
 
+    /**
+     * Destroy the packet in handler
+     */
+    ~PacketInHandler();
+
+    /**
+     * The kinds of packet-ins, each handled from a queue of its own
+     */
+    enum PacketInType {
+        /** neighbor discovery */
+        PKTIN_NEIGH_DISC,
+        /** DHCPv4 and DHCPv6 */
+        PKTIN_DHCP,
+        /** virtual IP learning */
+        PKTIN_VIRTUAL_IP,
+        /** ICMP errors and echo requests */
+        PKTIN_ICMP,
+        /** DNS responses */
+        PKTIN_DNS,
+        PKTIN_TYPE_MAX = PKTIN_DNS
+    };
+
+    /**
+     * Set the limits of the queues of packet-ins.  Must be called
+     * before start.
+     *
+     * @param queueSize the most packet-ins waiting in each queue
+     * @param rateLimit the most packet-ins per second queued for each
+     * kind, or 0 for no limit
+     */
+    void setQueueLimits(size_t queueSize, uint64_t rateLimit);
+
+    /**
+     * Get the number of packet-ins of a kind dropped because their
+     * queue was full or over its rate limit
+     *
+     * @param type the kind of packet-in
+     * @return the number of packet-ins dropped
+     */
+    uint64_t getDropCount(PacketInType type) const {
+        return queues[type].dropped;
+    }
+
     /**
      * Set the port mapper to use
      * @param intMapper the integration bridge port mapper
@@ -93,6 +151,37 @@ private:
     void handleDNSPktIn(struct ofputil_packet_in& pi,
                         ofputil_protocol& proto,
                         struct dp_packet* pkt);
+
+    /**
+     * Handle a decoded packet-in
+     */
+    void handlePacketIn(SwitchConnection* conn,
+                        struct ofputil_packet_in& pi);
+
+    /**
+     * A queue of packet-ins and its worker
+     */
+    struct PacketInQueue {
+        PacketInQueue() : dropped(0) {}
+
+        std::thread worker;
+        std::mutex mtx;
+        std::condition_variable cond;
+        /* the connection and a copy of each message */
+        std::deque<std::pair<SwitchConnection*, ofpbuf*>> packets;
+        TokenBucket limiter;
+        std::atomic<uint64_t> dropped;
+    };
+
+    void runQueue(PacketInQueue& queue);
+    void dropPacketIn(PacketInType type, const char* reason);
+
+    packets::Dhcpv4ReplyCache dhcpv4Replies;
+
+    PacketInQueue queues[PKTIN_TYPE_MAX + 1];
+    size_t queueSize;
+    std::atomic<bool> running;
+    std::atomic<bool> stopping;
 };
 } /* namespace opflexagent */
 
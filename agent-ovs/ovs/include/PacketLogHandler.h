@@ -17,11 +17,12 @@
 #include <boost/bind.hpp>
 #include <opflexagent/logging.h>
 #include <opflexagent/IdGenerator.h>
+#include <opflexagent/SPSCRing.h>
 #include "PacketDecoderLayers.h"
 #include <opflexagent/Network.h>
+#include <atomic>
 #include <mutex>
 #include <condition_variable>
-#include <queue>
 
 #pragma once
 #ifndef OPFLEXAGENT_PACKETLOGHANDLER_H_
@@ -34,7 +35,8 @@ namespace opflexagent {
 class PacketLogHandler;
 
 /**
- * Class to listen on the given UDP port
+ * Class to listen on the given UDP port.  Packets are received in
+ * batches with recvmmsg where it is available.
  */
 class UdpServer
 {
@@ -69,6 +71,11 @@ public:
         serverSocket.bind(localEndpoint, ec);
         if(ec) {
             LOG(ERROR) << "Failed to bind " << ec;
+            return false;
+        }
+        serverSocket.non_blocking(true, ec);
+        if(ec) {
+            LOG(ERROR) << "Failed to set non-blocking mode " << ec;
         }
         return !(ec);
     }
@@ -76,11 +83,9 @@ public:
      * Start UDP receive
      */
     void startReceive() {
-        serverSocket.async_receive_from(
-            boost::asio::buffer(recv_buffer, PACKET_CAPTURE_BUFFER_SIZE), remoteEndpoint,
+        serverSocket.async_receive(boost::asio::null_buffers(),
             boost::bind(&UdpServer::handleReceive, this,
-              boost::asio::placeholders::error,
-              boost::asio::placeholders::bytes_transferred));
+              boost::asio::placeholders::error));
     }
     /**
      * Stop UDP listener
@@ -94,20 +99,25 @@ public:
     }
 private:
     /**
-     * Handle received UDP packets
+     * Handle the socket becoming readable
+     */
+    void handleReceive(const boost::system::error_code& error);
+    /**
+     * Receive and parse a batch of the pending packets
      */
-    void handleReceive(const boost::system::error_code& error,
-      std::size_t bytes_transferred);
+    void receiveBatch();
+    static const unsigned RECV_BATCH_SIZE = 16;
     PacketLogHandler &pktLogger;
     boost::asio::ip::udp::socket serverSocket;
     boost::asio::ip::udp::endpoint localEndpoint;
-    boost::asio::ip::udp::endpoint remoteEndpoint;
-    boost::array<unsigned char, PACKET_CAPTURE_BUFFER_SIZE> recv_buffer;
+    boost::array<unsigned char, PACKET_CAPTURE_BUFFER_SIZE>
+        recv_buffers[RECV_BATCH_SIZE];
     std::atomic<bool> stopped;
 };
 
 /**
- * Class to connect to a given local socket
+ * Class to connect to a given local socket and export the packet
+ * events taken from the event ring, many to a write
  */
 class LocalClient
 {
@@ -145,12 +155,18 @@ private:
     std::atomic<bool> stopped;
     bool connected;
     unsigned pendingDataLen;
-    static const unsigned maxEventsPerBuffer=10;
+    static const unsigned maxEventsPerBuffer=64;
+    /* room left in the buffer for the last event of a batch */
+    static const unsigned maxEventSize=1024;
+    /**
+     * Serialize a batch of events from the ring into the send buffer
+     */
+    void serializeEvents();
 };
 
 class PacketFilterSpec: public PacketTuple {
 public:
-    PacketFilterSpec():PacketTuple() {
+    PacketFilterSpec():PacketTuple(), sampleInterval(0), sampleCount(0) {
         int field_count = fields.size();
         fields.insert(std::make_pair(field_count++,
                 std::make_pair("SourceMacMask", "")));
@@ -161,6 +177,15 @@ public:
         fields.insert(std::make_pair(field_count++,
                 std::make_pair("DestinationIPPrefixLength", "")));
     }
+    /**
+     * Log one of every sampleInterval packets matching the filter
+     * rather than pruning them all, or zero to prune them all
+     */
+    uint32_t sampleInterval;
+    /**
+     * Number of packets that matched the filter
+     */
+    uint64_t sampleCount;
     /**
      * Compare Macs with mask
      * @param mac1: Mac address 1
@@ -279,6 +304,12 @@ public:
 
 /**
  * Class to hold the UDP listener and the packet decoder
+ *
+ * Decoded packet events are handed to the exporter through a
+ * lock-free ring.  When the exporter falls behind and the ring fills
+ * up, events are dropped, and only one in EVENT_SAMPLE_INTERVAL
+ * received packets is decoded until the ring is half empty again, so
+ * that a flood of drops does not turn into a flood of decoding.
  */
 class PacketLogHandler {
 public:
@@ -286,10 +317,17 @@ public:
      * Constructor for PacketLogHandler
      * @param _io reference to IO service to handle server
      * @param _clientio reference to IO service to handle client
+     * @param idGen_ id generator used to name the dropping rules
+     * @param maxOutstandingEvents the number of events the ring holds
+     * for the exporter
      */
     PacketLogHandler(boost::asio::io_service &_io,
-            boost::asio::io_service &_clientio, IdGenerator& idGen_):server_io(_io),
-            client_io(_clientio), port(0), stopped(false), throttleActive(false), idGen(idGen_) {
+            boost::asio::io_service &_clientio, IdGenerator& idGen_,
+            size_t maxOutstandingEvents = 1024):server_io(_io),
+            client_io(_clientio), port(0), stopped(false),
+            eventRing(maxOutstandingEvents), throttleActive(false),
+            throttleCount(0), droppedEvents(0), skippedEvents(0),
+            prunedEvents(0), idGen(idGen_) {
                 /*Prune unused control packets by default*/
                 #define LLDP_MAC "01:80:c2:00:00:0e"
                 #define MCAST_V6_MAC "33:33:00:00:00:00"
@@ -404,6 +442,25 @@ public:
      * @param filterName Filter name
      */
     void deletePruneFilter(const std::string &filterName);
+    /**
+     * Get the number of events dropped because the event ring was
+     * full
+     * @return the number of events dropped
+     */
+    uint64_t getDroppedEventCount() const { return droppedEvents; }
+    /**
+     * Get the number of received packets not decoded because the
+     * event ring was full
+     * @return the number of packets skipped
+     */
+    uint64_t getSkippedEventCount() const { return skippedEvents; }
+    /**
+     * Get the number of decoded packets not logged because a user
+     * configured prune filter matched them, including the packets
+     * left out of the sample of a sampled filter
+     * @return the number of packets pruned
+     */
+    uint64_t getPrunedEventCount() const { return prunedEvents; }
 
 protected:
     ///@{
@@ -420,10 +477,14 @@ protected:
     std::mutex qMutex;
     std::mutex pruneMutex;
     std::condition_variable cond;
-    std::queue<PacketTuple> packetTupleQ;
+    SPSCRing<PacketTuple> eventRing;
     bool throttleActive;
+    uint64_t throttleCount;
+    std::atomic<uint64_t> droppedEvents;
+    std::atomic<uint64_t> skippedEvents;
+    std::atomic<uint64_t> prunedEvents;
     TableDescriptionMap intTableDescMap, accTableDescMap;
-    static const unsigned maxOutstandingEvents=30;
+    static const unsigned EVENT_SAMPLE_INTERVAL=16;
     friend UdpServer;
     friend LocalClient;
     IdGenerator& idGen;
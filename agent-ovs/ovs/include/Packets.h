@@ -16,10 +16,17 @@
 #include <arpa/inet.h>
 
 #include <boost/asio/ip/address.hpp>
+#include <boost/noncopyable.hpp>
 
 #include <opflexagent/PolicyManager.h>
 #include <opflexagent/Endpoint.h>
 
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 class OfpBuf;
 
 namespace opflexagent {
@@ -86,6 +93,17 @@ void chksum_accum(uint32_t& chksum, uint16_t* addr, size_t len);
  */
 uint16_t chksum_finalize(uint32_t chksum);
 
+/**
+ * Update a finalized checksum for the change of a 16-bit word of the
+ * checksummed data, without summing the data again (RFC 1624)
+ *
+ * @param chksum the finalized checksum
+ * @param oldVal the old value of the word
+ * @param newVal the new value of the word
+ * @return the updated checksum
+ */
+uint16_t chksum_update(uint16_t chksum, uint16_t oldVal, uint16_t newVal);
+
 /**
  * Compose an ICMP6 neighbor advertisement ethernet frame
  *
@@ -234,6 +252,108 @@ OfpBuf compose_arp(uint16_t op,
                    uint32_t tpa,
                    bool rarp = false);
 
+/**
+ * A DHCPv4 reply composed once for a client, from which the reply to
+ * each request is stamped out by patching in the message type and
+ * transaction ID.  The UDP checksum is updated incrementally, and the
+ * options are not composed again.
+ */
+class Dhcpv4ReplyTemplate {
+public:
+    /**
+     * Compose the template.  The parameters are those of
+     * compose_dhcpv4_reply.
+     *
+     * @param srcMac the MAC address for the DHCP server
+     * @param clientMac the MAC address for the requesting client
+     * @param clientIp the IP address to return to the client
+     * @param prefixLen the prefix length for the subnet
+     * @param config the DHCP configuration of the endpoint
+     */
+    Dhcpv4ReplyTemplate(const uint8_t* srcMac,
+                        const uint8_t* clientMac,
+                        uint32_t clientIp,
+                        uint8_t prefixLen,
+                        const Endpoint::DHCPv4Config& config);
+
+    /**
+     * Stamp out a reply from the template
+     *
+     * @param message_type the message type to send
+     * @param xid the transaction ID for the message
+     * @return the same reply as compose_dhcpv4_reply
+     */
+    OfpBuf build(uint8_t message_type, uint32_t xid) const;
+
+private:
+    std::vector<uint8_t> packet;
+};
+
+/**
+ * The DHCPv4 reply templates of the endpoints, keyed by endpoint
+ * UUID.  A template is composed again when the endpoint is updated,
+ * since an updated endpoint is a new object, or when the addresses
+ * of the reply change.  Thread safe.
+ */
+class Dhcpv4ReplyCache : private boost::noncopyable {
+public:
+    /**
+     * Create an empty cache
+     *
+     * @param maxEntries the number of templates above which the
+     * cache is emptied, which bounds the templates of endpoints that
+     * went away
+     */
+    explicit Dhcpv4ReplyCache(size_t maxEntries = 4096);
+
+    /**
+     * Compose a DHCPv4 reply for an endpoint from its template,
+     * composing the template first if needed
+     *
+     * @param ep the endpoint, which must have a DHCPv4 configuration
+     * @param message_type the message type to send
+     * @param xid the transaction ID for the message
+     * @param srcMac the MAC address for the DHCP server
+     * @param clientMac the MAC address for the requesting client
+     * @param clientIp the IP address to return to the client
+     * @param prefixLen the prefix length for the subnet
+     * @return the reply
+     */
+    OfpBuf compose(const std::shared_ptr<const Endpoint>& ep,
+                   uint8_t message_type,
+                   uint32_t xid,
+                   const uint8_t* srcMac,
+                   const uint8_t* clientMac,
+                   uint32_t clientIp,
+                   uint8_t prefixLen);
+
+    /**
+     * Get the number of templates in the cache
+     *
+     * @return the number of templates
+     */
+    size_t size() const;
+
+    /**
+     * Remove all the templates
+     */
+    void clear();
+
+private:
+    struct Entry {
+        std::weak_ptr<const Endpoint> ep;
+        uint8_t srcMac[6];
+        uint8_t clientMac[6];
+        uint32_t clientIp;
+        uint8_t prefixLen;
+        std::shared_ptr<const Dhcpv4ReplyTemplate> reply;
+    };
+
+    mutable std::mutex mtx;
+    std::unordered_map<std::string, Entry> entries;
+    size_t maxEntries;
+};
+
 } /* namespace packets */
 } /* namespace opflexagent */
 
@@ -72,7 +72,8 @@ public:
     void registerConnection(SwitchConnection* connection);
 
     /**
-     * Set the interval between stats requests.
+     * Set the interval between stats requests.  When called on a
+     * running manager, the interval applies from the next request.
      *
      * @param timerInterval the interval in milliseconds
      */
@@ -124,6 +125,13 @@ public:
      */
     virtual void on_timer(const boost::system::error_code& ec) = 0;
 
+    /**
+     * Interface: MessageHandler.  Update the counters of a batch of
+     * removed flows under a single acquisition of the counter lock.
+     */
+    void HandleFlowRemoved(SwitchConnection* connection,
+                           const FlowRemovedBatch& batch) override;
+
     /**
      * Size of window of counters to maintain for each classifier
      */
@@ -367,10 +375,16 @@ protected:
      */
     std::unique_ptr<boost::asio::deadline_timer> timer;
 
+    /**
+     * strand serializing the timer handlers on the stats io_service,
+     * which may be run by several threads
+     */
+    std::unique_ptr<boost::asio::io_service::strand> strand;
+
     /**
      * The timer interval to use for querying stats
      */
-    long timer_interval;
+    std::atomic<long> timer_interval;
 
     /**
      * A UUID for this agent instance
@@ -395,6 +409,17 @@ protected:
     void sendRequest(uint32_t table_id, uint64_t _cookie=0,
                      uint64_t _cookie_mask=0);
 
+    /**
+     * Send flow stats requests to the given table for the flows with
+     * each of the given cookies.  The switch indexes flows by cookie,
+     * so the cost of these requests scales with the number of flows
+     * counted rather than the size of the table.
+     * @param table_id the table to read
+     * @param cookies the cookies to read, in host byte order
+     */
+    void sendRequests(uint32_t table_id,
+                      const std::unordered_set<uint64_t>& cookies);
+
     /**
      * Clear stale counter values
      */
@@ -410,6 +435,16 @@ protected:
      */
     typedef std::function<flowCounterState_t* (uint32_t)> table_map_t;
 
+    /**
+     * Get the flow counter state for the flows of the given table
+     *
+     * @param tableId the table ID
+     * @return the counter state, or NULL if the table is not tracked
+     */
+    virtual flowCounterState_t* getCounterState(uint32_t tableId) {
+        return NULL;
+    }
+
     /**
      * handle the OpenFlow message provided using the given table map
      */
@@ -429,7 +464,9 @@ protected:
     virtual void handleTableDropStats(struct ofputil_flow_stats* fentry) {};
 
     /**
-     * Generate the policy stats objects for from the counter maps
+     * Generate the policy stats objects for from the counter maps,
+     * in a single modb transaction.  Entries without new packets are
+     * skipped.
      */
     void generatePolicyStatsObjects(PolicyCounterMap_t *counters1,
                                     PolicyCounterMap_t *counters2 = NULL);
@@ -447,14 +484,16 @@ protected:
     virtual void clearCounterObject(const std::string& key,uint8_t index) {};
 
     /**
-     * Update the security group stats counters
+     * Update the security group stats counters.  Called within the
+     * mutator of generatePolicyStatsObjects.
      */
     virtual void updatePolicyStatsCounters(const std::string& l24Classifier,
                                            FlowStats_t& newVals1,
                                            FlowStats_t& newVals2) {};
 
     /**
-     * Update the contract stats counters
+     * Update the contract stats counters.  Called within the mutator
+     * of generatePolicyStatsObjects.
      */
     virtual void updatePolicyStatsCounters(const std::string& srcEpg,
                                            const std::string& dstEpg,
@@ -485,9 +524,16 @@ protected:
      */
     std::unordered_set<uint32_t> txns;
 
+    /**
+     * The transaction IDs in txns of requests for every table, whose
+     * replies also hold the flows of tables without counters
+     */
+    std::unordered_set<uint32_t> allTableTxns;
+
 
 private:
-    bool handleFlowStats(ofpbuf *msg, const table_map_t& tableMap);
+    bool handleFlowStats(ofpbuf *msg, const table_map_t& tableMap,
+                         bool allTables);
 };
 
 } /* namespace opflexagent */
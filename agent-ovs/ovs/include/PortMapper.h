@@ -12,6 +12,8 @@
 #include "SwitchConnection.h"
 #include "ovs-shim.h"
 
+#include <list>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <mutex>
@@ -59,7 +61,7 @@ public:
      * @return the string port name
      * @throws std::out_of_range if there is no such port known
      */
-    virtual const std::string& FindPort(uint32_t of_port_no);
+    virtual std::string FindPort(uint32_t of_port_no);
 
     /**
      * Register handler for port-status events notifications.
@@ -100,8 +102,10 @@ private:
     /**
      * Update port-map with information received in the port description
      * message.
-     * Port info is first put in a temporary map which gets moved to the
-     * main map once the outstanding port description request is complete.
+     * Port info is first put in a temporary map which gets published
+     * once the outstanding port description request is complete, and
+     * listeners are notified of the ports that were added, renumbered
+     * or removed.
      */
     void HandlePortDescReply(ofpbuf *msg);
 
@@ -120,10 +124,24 @@ private:
     void notifyListeners(const std::string& portName, uint32_t portNo,
                          bool fromDesc);
 
-    typedef std::unordered_map<std::string, PhyPortP> PortMap;
+    typedef std::unordered_map<std::string, uint32_t> PortMap;
     typedef std::unordered_map<uint32_t, std::string> RPortMap;
-    PortMap portMap;
-    RPortMap rportMap;
+
+    /**
+     * The ports of the switch.  A table is never changed once
+     * published: updates publish a new table, so that lookups only
+     * load the current table and never take the lock.
+     */
+    struct PortTable {
+        PortMap portMap;
+        RPortMap rportMap;
+    };
+    std::shared_ptr<const PortTable> ports;
+
+    std::shared_ptr<const PortTable> getPorts() const;
+    // publish a new table; called with mapMtx held
+    void setPorts(std::shared_ptr<const PortTable> newPorts);
+
     PortMap tmpPortMap;
     RPortMap tmprPortMap;
 
@@ -132,6 +150,7 @@ private:
     typedef std::list<PortStatusListener *>  PortStatusList;
     PortStatusList portStatusListeners;
 
+    // serializes the updates of the port table and of the listeners
     std::mutex mapMtx;
 };
 
@@ -14,14 +14,23 @@
 #define OPFLEX_QOSRENDERER_H
 
 #include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
 #include <opflexagent/QosListener.h>
 #include "JsonRpcRenderer.h"
 
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
 
 namespace opflexagent {
 
 /**
  * class to render Qos export config on a virtual switch
+ *
+ * The renderer keeps the policing it last applied to each interface,
+ * so that an update that does not change it sends nothing to OVSDB,
+ * and the operations of one update are sent as one transaction.
  */
 class QosRenderer : public QosListener,
                         public JsonRpcRenderer,
@@ -110,6 +119,32 @@ public:
 
 
 private:
+    /* rate and burst of the policing of an interface */
+    typedef std::pair<uint64_t, uint64_t> policing_t;
+
+    /* record the policing applied to an interface, and return false
+       if it was applied already */
+    bool markEgressApplied(const string& interface,
+                           const policing_t& policing);
+    bool markIngressApplied(const string& interface,
+                            const boost::optional<policing_t>& policing);
+
+    void addEgressQosUpdate(const string& interface, uint64_t rate,
+                            uint64_t burst,
+                            list<OvsdbTransactMessage>& requests);
+    void addIngressQosUpdate(const string& interface, uint64_t rate,
+                             uint64_t burst,
+                             list<OvsdbTransactMessage>& requests);
+    void addIngressQosDelete(const string& interface,
+                             list<OvsdbTransactMessage>& requests);
+
+    std::mutex applied_mutex;
+    /* the policing last applied per interface; an interface missing
+       from a map has an unknown policing in that direction, and an
+       ingress policing of none is cleared */
+    std::unordered_map<string, policing_t> appliedEgress;
+    std::unordered_map<string, boost::optional<policing_t> > appliedIngress;
+
     void updateConnectCb(const boost::system::error_code& ec, const string& interface,
             const boost::optional<std::shared_ptr<opflexagent::QosConfigState>>& qosConfigState);
     void delConnectCb(const boost::system::error_code& ec, const string& interface);
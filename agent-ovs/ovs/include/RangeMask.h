@@ -37,7 +37,8 @@ class RangeMask {
 public:
     /**
      * Get the list of masked values that represent an integer range.
-     * Both the start and end of the range are inclusive.
+     * Both the start and end of the range are inclusive.  The
+     * decompositions are memoized per thread.
      *
      * @param start Beginning of the range; optional
      * @param end End of the range; optional
@@ -46,6 +47,24 @@ public:
     static void getMasks(const boost::optional<uint16_t>& start,
                          const boost::optional<uint16_t>& end,
                          MaskList& out);
+
+    /**
+     * Check whether matching the pairs of masks of two ranges, one
+     * flow per pair, takes more flows than matching each list as a
+     * clause of a conjunction, which takes a flow per mask.
+     *
+     * @param first masks of the first range
+     * @param second masks of the second range
+     * @return true if the clauses take fewer flows
+     */
+    static bool clausesCheaper(const MaskList& first,
+                               const MaskList& second) {
+        return first.size() > 1 && second.size() > 1 &&
+            first.size() * second.size() > first.size() + second.size();
+    }
+
+private:
+    static void computeMasks(uint16_t start, uint16_t end, MaskList& out);
 };
 
 /**
@@ -78,6 +78,11 @@ public:
                 ofpbuf *msg,
                 struct ofputil_flow_removed* fentry=NULL) override;
 
+    /**
+     * Get the flow counter state for the flows of the given table
+     */
+    flowCounterState_t* getCounterState(uint32_t tableId) override;
+
     void updatePolicyStatsCounters(const std::string& l24Classifier,
                                    FlowStats_t& newVals1,
                                    FlowStats_t& newVals2) override;
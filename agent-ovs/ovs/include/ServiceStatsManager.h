@@ -71,6 +71,11 @@ public:
                 ofpbuf *msg,
                 struct ofputil_flow_removed* fentry=NULL) override;
 
+    /**
+     * Get the flow counter state for the flows of the given table
+     */
+    flowCounterState_t* getCounterState(uint32_t tableId) override;
+
     /**
      * Update stats state
      */
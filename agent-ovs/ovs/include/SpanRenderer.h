@@ -92,6 +92,12 @@ private:
     void delConnectPtrCb(const boost::system::error_code& ec, const shared_ptr<SessionState>& pSt);
 
     static void buildPortSets(const shared_ptr<SessionState>& seSt, set<string>& srcPorts, set<string>& dstPorts);
+    void resolvePortUuids(const set<string>& ports, set<string>& uuids);
+    static void addPortSetMutations(const string& column,
+                                    const set<string>& current,
+                                    const set<string>& wanted,
+                                    OvsdbTransactMessage& del,
+                                    OvsdbTransactMessage& ins);
 };
 }
 #endif //OPFLEX_SPANRENDERER_H
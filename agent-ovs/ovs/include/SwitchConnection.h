@@ -11,10 +11,14 @@
 #define OPFLEXAGENT_SWITCHCONNECTION_H_
 
 #include <queue>
+#include <deque>
 #include <list>
+#include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 #include <chrono>
 #include <atomic>
 
@@ -28,6 +32,12 @@ namespace opflexagent {
 
 class SwitchConnection;
 
+/**
+ * A batch of received flow removed messages with their decoded form
+ */
+typedef std::vector<std::pair<struct ofpbuf*, struct ofputil_flow_removed*> >
+    FlowRemovedBatch;
+
 /**
  * @brief Abstract base-class for a OpenFlow message handler.
  */
@@ -44,6 +54,18 @@ public:
                         int msgType,
                         struct ofpbuf *msg,
                         struct ofputil_flow_removed *fentry=NULL) = 0;
+
+    /**
+     * Called with consecutive flow removed messages received by a
+     * connection that dispatches them asynchronously.  The default
+     * implementation calls Handle for each message; handlers that
+     * take a lock per message can override it to take it once per
+     * batch.
+     * @param swConn Connection where the messages were received
+     * @param batch the messages in the order they were received
+     */
+    virtual void HandleFlowRemoved(SwitchConnection *swConn,
+                                   const FlowRemovedBatch& batch);
 };
 
 /**
@@ -136,12 +158,43 @@ public:
      */
     void UnregisterMessageHandler(int msgType, MessageHandler *handler);
 
+    /**
+     * Dispatch the messages of the given type to their handlers on a
+     * thread of the connection's own, separate from the thread that
+     * receives messages, so that slow handlers do not hold up barrier
+     * replies and echo requests.  Messages handed to the dispatch
+     * thread are handled in the order they were received.  Handlers
+     * that share state must have all their message types dispatched
+     * on the same thread.  Must be called before Connect.
+     * @param msgType OpenFlow message type to dispatch asynchronously
+     */
+    void SetDispatchAsync(int msgType);
+
+    /**
+     * Also offer a later version of the OpenFlow protocol when
+     * connecting, which the switch may then negotiate instead of the
+     * version given to Connect.  Must be called before Connect.
+     * @param protoVer the later version of OpenFlow to offer
+     */
+    void SetMaxProtocolVersion(int protoVer);
+
     /**
      * Send an OpenFlow message to the switch.
      * @return 0 on success, openvswitch error code on failure
      */
     virtual int SendMessage(OfpBuf& msg);
 
+    /**
+     * Send a batch of OpenFlow messages to the switch in order,
+     * holding the connection for as long as the switch keeps up
+     * rather than contending for it once per message.  Messages that
+     * were sent are released from the vector.
+     * @param msgs the messages to send
+     * @return 0 on success, openvswitch error code on failure of the
+     * first message that could not be sent
+     */
+    virtual int SendMessages(std::vector<OfpBuf>& msgs);
+
     /**
      * Returns the OpenFlow protocol version being used by the connection.
      */
@@ -152,9 +205,6 @@ public:
      */
     const std::string& getSwitchName();
 
-    /** Interface: Boost thread */
-    void operator()();
-
     /**
      * Does actual work of establishing an OpenFlow connection to the switch.
      * @return 0 on success, openvswitch error code on failure
@@ -198,6 +248,12 @@ public:
      */
     void FireOnConnectListeners();
 
+    /**
+     * Main loop of the dispatch thread for the message types set with
+     * SetDispatchAsync.
+     */
+    void Dispatch();
+
     /**
      * Same as IsConnected() but assumes lock is held by caller.
      */
@@ -210,9 +266,25 @@ protected:
     void notifyConnectListeners();
 
 private:
+    /**
+     * Handle a received message with the handlers registered for
+     * its type
+     */
+    void handleMessage(int type, ofpbuf *msg);
+
+    /**
+     * Decode a batch of flow removed messages and hand it to the
+     * handlers of flow removed messages
+     */
+    void handleFlowRemoved(const std::vector<ofpbuf*>& msgs);
+
+    void stopDispatch();
+
     std::string switchName;
     vconn *ofConn;
     int ofProtoVersion;
+    int minProtoVersion;
+    int maxProtoVersion;
 
     std::atomic<bool> isDisconnecting;
 
@@ -226,6 +298,13 @@ private:
     typedef std::list<OnConnectListener *>  OnConnectList;
     OnConnectList onConnectListeners;
 
+    std::unordered_set<int> asyncTypes;
+    std::unique_ptr<std::thread> dispatchThread;
+    std::mutex dispatchMtx;
+    std::condition_variable dispatchCond;
+    std::deque<std::pair<int, ofpbuf*> > dispatchQueue;
+    bool dispatchStopping;
+
     int pollEventFd;
     std::chrono::time_point<std::chrono::steady_clock> lastEchoTime;
 
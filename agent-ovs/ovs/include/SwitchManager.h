@@ -25,7 +25,10 @@
 
 #include <string>
 #include <memory>
+#include <vector>
 #include <mutex>
+#include <thread>
+#include <unordered_map>
 
 namespace opflexagent {
 
@@ -96,6 +99,33 @@ public:
      */
     void setSyncDelayOnConnect(long delay);
 
+    /**
+     * Set how many flow writes may be waiting for the switch to
+     * acknowledge them.  With a window of 1, each write waits for its
+     * barrier reply.  With a larger window, writes return once sent
+     * and a write that the switch rejects triggers a sync of the flow
+     * tables.
+     * @param window the number of outstanding writes
+     */
+    void setWriteWindow(size_t window);
+
+    /**
+     * Set the io_service that runs the sync of the switch and the
+     * calls into the state handler, which is the agent io_service by
+     * default.  Must be called before connecting.
+     * @param io the io_service to use
+     */
+    void setIOService(boost::asio::io_service& io);
+
+    /**
+     * Offer OpenFlow 1.5 to the switch, and when the switch agrees,
+     * update groups by inserting and removing the buckets that
+     * changed instead of replacing all their buckets.  Must be called
+     * before connect.
+     * @param enabled true to edit group buckets
+     */
+    void setGroupBucketEdits(bool enabled);
+
     /* Interface: OnConnectListener */
     virtual void Connected(SwitchConnection *swConn);
 
@@ -141,6 +171,68 @@ public:
      */
     bool writeFlow(const std::string& objId, int tableId, FlowBuilder& fb);
 
+    /**
+     * Write the flow lists of several objects to the flow table,
+     * with the changes to all of them sent to the switch as one
+     * batch.
+     *
+     * @param tableId the tableId for the flow table
+     * @param objs pairs of object ID and the list of flows to write
+     * for it
+     */
+    bool writeFlows(int tableId,
+                    std::vector<std::pair<std::string, FlowEntryList> >& objs);
+
+    /**
+     * Start a batch of flow table and group table writes.  Until the
+     * matching call to endBatch, the flow and group changes made by
+     * this thread are collected rather than sent.  Batches may nest;
+     * the changes are sent when the outermost batch ends.  A write
+     * from a thread outside of a batch does not wait for the batch to
+     * end, but sends the changes collected so far ahead of its own,
+     * so that the switch sees the changes in the order they were
+     * made.
+     */
+    void beginBatch();
+
+    /**
+     * End a batch of writes started with beginBatch, and send the
+     * collected changes to the switch together, followed by a single
+     * barrier.  Group changes are sent before the flows, except
+     * deletions, which are sent after them.
+     *
+     * @return false if sending the changes written during the batch
+     * failed
+     */
+    bool endBatch();
+
+    /**
+     * A batch of writes for the lifetime of the object, so that all
+     * the changes made for one logical update reach the switch
+     * together with a single barrier
+     */
+    class Batch : private boost::noncopyable {
+    public:
+        /**
+         * Start a batch on the switch manager
+         * @param switchManager_ the switch manager to write to
+         */
+        explicit Batch(SwitchManager& switchManager_)
+            : switchManager(switchManager_) {
+            switchManager.beginBatch();
+        }
+
+        /**
+         * End the batch, sending the collected changes
+         */
+        ~Batch() {
+            switchManager.endBatch();
+        }
+
+    private:
+        SwitchManager& switchManager;
+    };
+
     /**
      * Clear the flow entries for the given object ID.
      *
@@ -273,6 +365,7 @@ private:
     void clearSyncState();
 
     Agent& agent;
+    boost::asio::io_service* ioService;
     FlowExecutor& flowExecutor;
     FlowReader& flowReader;
     PortMapper& portMapper;
@@ -283,6 +376,34 @@ private:
     TableState tlvTable;
     std::recursive_mutex sm_mutex;
 
+    // the batches open on each thread, and the flow and group
+    // changes collected during any of them; group changes other than
+    // deletions go before the flows and deletions after.  Protected
+    // by sm_mutex, which is only held for each write.
+    struct BatchState {
+        int depth = 0;
+        bool success = true;
+    };
+    std::unordered_map<std::thread::id, BatchState> batches;
+    FlowEdit batchDiffs;
+    GroupEdit batchGroupsBefore;
+    GroupEdit batchGroupsAfter;
+    bool inBatch() const;
+    bool executeFlows(const FlowEdit& diffs, const std::string& what);
+    bool flushBatch();
+    // execute flow and group changes with one barrier, recording
+    // their latency if traced
+    bool executeTraced(const GroupEdit& before, const FlowEdit& diffs,
+                       const GroupEdit& after);
+    bool executeTraced(const FlowEdit& diffs);
+    // record the flow changes of a table, which are only counted if
+    // they are written to the switch
+    std::shared_ptr<FlowProgrammingStats::BridgeStats> progStats;
+    void countEdits(int tableId, const FlowEdit& diffs, bool written);
+    // number of writes sent without waiting for their barrier reply
+    size_t writeWindow;
+    void onWriteComplete(int status, size_t changes);
+
     // connection state
     void handleConnection(SwitchConnection *sw);
     void onConnectTimer(const boost::system::error_code& ec);
@@ -298,6 +419,10 @@ private:
     std::atomic<bool> syncPending;
 
     std::vector<FlowEntryList> recvFlows;
+    // the sum of the entry hashes of the table flows that the flows
+    // read are equal to, and whether a flow read was not in the table
+    std::vector<uint64_t> recvHash;
+    std::vector<bool> recvChanged;
     std::vector<bool> tableDone;
     TlvEntryList recvTlvs;
     std::atomic<bool> tlvTableDone;
@@ -305,6 +430,16 @@ private:
     SwitchStateHandler::GroupMap recvGroups;
     std::atomic<bool> groupsDone;
 
+    // the groups written, to diff their buckets against, kept only
+    // while bucket edits are in use
+    bool groupBucketEdits;
+    SwitchStateHandler::GroupMap groupState;
+    bool useBucketEdits();
+    // append the changes that write the group entry, recording the
+    // entry in the group state
+    void addGroupEdits(const GroupEdit::Entry& e,
+                       GroupEdit::EntryList& edits);
+
     /*Drop counter table list*/
     TableDescriptionMap tableDescriptionMap;
 
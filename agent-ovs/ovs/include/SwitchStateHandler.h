@@ -37,18 +37,36 @@ public:
     virtual ~SwitchStateHandler() {};
 
     /**
-     * Compare flows read from switch and make modification to eliminate
-     * differences.
+     * Compare the flows of a table read from switch and make
+     * modification to eliminate differences.  Called for each table
+     * in turn, so that the flows received for a table can be released
+     * once its edits are written.
      *
-     * @param flowTables the current flow table state
-     * @param recvFlows the flows received from the switch to
-     * reconcile against, with a flow entry list per table.  It is
-     * safe to modify this vector.
-     * @return the necessary edits to reconcile the flows
+     * @param tableId the ID of the table
+     * @param tableState the current state of the table
+     * @param recvFlows the flows of the table received from the
+     * switch to reconcile against.  It is safe to modify this list.
+     * @return the necessary edits to reconcile the table
+     */
+    virtual FlowEdit reconcileTable(int tableId,
+                                    const TableState& tableState,
+                                    FlowEntryList& recvFlows);
+
+    /**
+     * Check whether an edit made to reconcile a flow table only adds
+     * observability, such as counting or logging, over flows that
+     * forward the same packets.  The sync writes such edits once the
+     * other edits of every table are written, so that the flows
+     * needed to forward traffic are programmed first.
+     *
+     * @param tableId the ID of the table
+     * @param edit the edit returned by reconcileTable
+     * @return true to write the edit after the other edits
      */
-    virtual std::vector<FlowEdit>
-    reconcileFlows(std::vector<TableState> flowTables,
-                   std::vector<FlowEntryList>& recvFlows);
+    virtual bool isDeferredSyncEdit(int tableId,
+                                    const FlowEdit::Entry& edit) {
+        return false;
+    }
 
     /**
      * A map from a group table ID to an associated group edit
@@ -95,7 +113,8 @@ public:
      * safe to modify this vector.
      * @return the necessary edits to reconcile the tlvs
      */
-    virtual TlvEdit reconcileTlvs(TableState tlvTable, TlvEntryList& recvTlvs);
+    virtual TlvEdit reconcileTlvs(const TableState& tlvTable,
+                                  TlvEntryList& recvTlvs);
 
     /**
      * Called when the state sync process completes
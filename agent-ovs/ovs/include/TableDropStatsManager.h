@@ -38,7 +38,8 @@ public:
                          SwitchManager& switchManager,
                          long timer_interval = 30000):
                              PolicyStatsManager(agent, idGen, switchManager,
-                                     timer_interval) {
+                                     timer_interval),
+                             singleRequest(false) {
         /*SwitchManager instance is assumed to be already
          *initialized at this point
          */
@@ -75,8 +76,22 @@ public:
                 ofpbuf *msg,
                 struct ofputil_flow_removed* fentry=NULL) override;
 
+    /**
+     * Get the flow counter state for the flows of the given table
+     */
+    flowCounterState_t* getCounterState(uint32_t tableId) override;
+
     void handleTableDropStats(struct ofputil_flow_stats* fentry) override;
 
+    /**
+     * Set whether the drop flows of every table are requested in one
+     * flow stats request per interval, rather than one per table.
+     * The reply still gives the counters of each table.
+     *
+     * @param enabled true to send one request
+     */
+    void setSingleRequest(bool enabled) { singleRequest = enabled; }
+
 
 private:
     //Drop Flow Counter States per table
@@ -86,6 +101,7 @@ private:
         PolicyStatsManager::flowCounterState_t> CurrentDropCounterState;
 
     SwitchManager::TableDescriptionMap tableDescMap;
+    bool singleRequest;
 
     void updateDropFlowStatsCounters(flowCounterState_t& counterState,
             uint64_t cookie, uint16_t priority, const struct match& match);
@@ -213,6 +229,16 @@ public:
         intTableDropStatsMgr.setTimerInterval(timerInterval);
         accTableDropStatsMgr.setTimerInterval(timerInterval);
     }
+    /**
+     * Set whether the drop flows of every table of a bridge are
+     * requested in one flow stats request per interval.
+     *
+     * @param enabled true to send one request per bridge
+     */
+    void setSingleRequest(bool enabled) {
+        intTableDropStatsMgr.setSingleRequest(enabled);
+        accTableDropStatsMgr.setSingleRequest(enabled);
+    }
     /**
      * Register the given connection with the policy stats manager.
      * This connection will be queried for counters.
@@ -51,6 +51,14 @@ public:
      * The flow entry
      */
     struct ofputil_flow_stats* entry;
+
+    /**
+     * Set once a table state shares the actions of the entry with
+     * other entries that have the same actions, in which case it owns
+     * entry->ofpacts instead of the entry.  The actions of a shared
+     * entry must not be modified.
+     */
+    std::shared_ptr<const void> sharedActions;
 };
 /**
  * A shared pointer to a flow entry
@@ -167,6 +175,33 @@ public:
     static bool groupEq(const GroupEdit::Entry& lhs,
             const GroupEdit::Entry& rhs);
 
+    /**
+     * Compute the OpenFlow 1.5 bucket edits that turn a group into
+     * another with the same ID and type, matching buckets by their
+     * bucket ID: a remove-bucket mod for each bucket removed or
+     * changed, then an insert-bucket mod with the buckets added or
+     * changed.  Fast failover groups, where the order of buckets
+     * matters, are not edited.
+     *
+     * @param current the group as it is on the switch
+     * @param target the group to write, a modify command
+     * @param edits the bucket edits are appended to this list, and
+     * nothing if the groups have the same buckets
+     * @return false if the group should be modified as a whole
+     * instead, because bucket edits do not apply or are not smaller
+     */
+    static bool bucketEdits(const GroupEdit::Entry& current,
+                            const GroupEdit::Entry& target,
+                            GroupEdit::EntryList& edits);
+
+    /**
+     * Make a copy of a group entry, with copies of its buckets
+     *
+     * @param entry the entry to copy
+     * @return the new entry
+     */
+    static GroupEdit::Entry clone(const GroupEdit::Entry& entry);
+
     /**
      * The group edits that need to be made
      */
@@ -299,6 +334,16 @@ public:
                FlowEntryList& el,
                /* out */ FlowEdit& diffs);
 
+    /**
+     * Remove the entries of the given object-id, as applying an empty
+     * entry-list would, without touching the table when the object
+     * has no entries
+     *
+     * @param objId the object-id whose entries to remove
+     * @param diffs the changes to make to the flow table
+     */
+    void clear(const std::string& objId, /* out */ FlowEdit& diffs);
+
     /**
      * Update cached entry-list corresponding to given object-id
      */
@@ -315,6 +360,19 @@ public:
      */
     void diffSnapshot(const FlowEntryList& oldEntries, FlowEdit& diffs) const;
 
+    /**
+     * Find the entry in the table that a snapshot entry would need no
+     * change to match, as compared by diffSnapshot: same priority,
+     * match, cookie, actions and flags.
+     *
+     * @param oldEntry the entry to look up
+     * @param hash if not NULL, set to the entry hash of the entry
+     * found, as entryHash computes it
+     * @return the entry in the table, or NULL if there is none
+     */
+    FlowEntryPtr findEqual(const FlowEntry& oldEntry,
+                           uint64_t* hash = NULL) const;
+
     /**
      * Compute the differences between provided table-entries and all the
      * entries currently in the table.
@@ -324,6 +382,31 @@ public:
      */
     void diffSnapshot(const TlvEntryList& oldEntries, TlvEdit& diffs) const;
 
+    /**
+     * Get the number of flows in the flow table
+     *
+     * @return the number of flows
+     */
+    size_t flowCount() const;
+
+    /**
+     * Get a hash of the flows in the flow table, kept up to date as
+     * flows change.  The hash is the sum of the entry hashes of the
+     * flows, so it does not depend on their order.
+     *
+     * @return the hash of the flow table
+     */
+    uint64_t contentHash() const;
+
+    /**
+     * Get the hash of an entry, over the fields that diffSnapshot
+     * compares: priority, match, cookie, flags and actions.
+     *
+     * @param entry the entry to hash
+     * @return the hash of the entry
+     */
+    static uint64_t entryHash(const FlowEntry& entry);
+
     /**
      * A callback that can be passed to forEachCookieMatch.
      * Parameters are the cookie value, the match priority, and the
@@ -173,6 +173,12 @@ extern "C" {
      */
     void act_group(struct ofpbuf* buf, uint32_t groupId);
 
+    /**
+     * contribute to a conjunctive match
+     */
+    void act_conjunction(struct ofpbuf* buf, uint32_t id, uint8_t clause,
+                         uint8_t nClauses);
+
     /**
      * output to controller
      */
@@ -51,6 +51,9 @@ int group_mod_equal(struct ofputil_group_mod* lgm,
                                rbkt->ofpacts, rbkt->ofpacts_len)) {
                 return 0;
             }
+            if (lgm->type == OFPGT11_SELECT && lbkt->weight != rbkt->weight) {
+                return 0;
+            }
             lbkt = ofputil_bucket_list_front(&lbkt->list_node);
             rbkt = ofputil_bucket_list_front(&rbkt->list_node);
         }
@@ -225,6 +228,14 @@ void act_group(struct ofpbuf* buf, uint32_t groupId) {
     group->group_id = groupId;
 }
 
+void act_conjunction(struct ofpbuf* buf, uint32_t id, uint8_t clause,
+                     uint8_t nClauses) {
+    struct ofpact_conjunction *conj = ofpact_put_CONJUNCTION(buf);
+    conj->id = id;
+    conj->clause = clause;
+    conj->n_clauses = nClauses;
+}
+
 void act_controller(struct ofpbuf* buf, uint16_t max_len) {
     struct ofpact_output *contr = ofpact_put_OUTPUT(buf);
     contr->port = OFPP_CONTROLLER;
@@ -18,9 +18,14 @@
 #include "FlowUtils.h"
 
 #include <opflex/modb/Mutator.h>
+#include <opflex/modb/URIBuilder.h>
 #include <modelgbp/gbp/SecGroup.hpp>
 
+#include <atomic>
+#include <future>
 #include <memory>
+#include <set>
+#include <sstream>
 #include <vector>
 
 BOOST_AUTO_TEST_SUITE(AccessFlowManager_test)
@@ -38,13 +43,14 @@ using opflex::modb::Mutator;
 
 class AccessFlowManagerFixture : public FlowManagerFixture {
 public:
-    AccessFlowManagerFixture()
+    AccessFlowManagerFixture(bool dedicatedThread = false)
         : accessFlowManager(agent, switchManager, idGen, ctZoneManager) {
         expTables.resize(AccessFlowManager::NUM_FLOW_TABLES);
         switchManager.registerStateHandler(&accessFlowManager);
         idGen.initNamespace("l24classifierRule");
         start();
         accessFlowManager.enableConnTrack();
+        accessFlowManager.setDedicatedThread(dedicatedThread);
         accessFlowManager.start();
     }
     virtual ~AccessFlowManagerFixture() {
@@ -178,6 +184,51 @@ BOOST_FIXTURE_TEST_CASE(endpoint, AccessFlowManagerFixture) {
 
 }
 
+class DedicatedThreadFixture : public AccessFlowManagerFixture {
+public:
+    DedicatedThreadFixture() : AccessFlowManagerFixture(true) {}
+};
+
+BOOST_FIXTURE_TEST_CASE(dedicatedThread, DedicatedThreadFixture) {
+    setConnected();
+    initExpStatic();
+    WAIT_FOR_TABLES("static", 500);
+    WAIT_FOR(exec.executedFlowEdits > 0 && !switchManager.isSyncing(), 500);
+
+    // hold the agent io thread; the endpoint flows are still written
+    // from the access bridge thread
+    std::promise<void> release;
+    std::shared_future<void> released(release.get_future());
+    std::atomic<bool> held(false);
+    agent.getAgentIOService().post([&held, released]() {
+            held = true;
+            released.wait();
+        });
+    WAIT_FOR(held, 500);
+
+    size_t edits = exec.executedFlowEdits;
+    ep0.reset(new Endpoint("0-0-0-0"));
+    ep0->setAccessInterface("ep0-access");
+    ep0->setAccessUplinkInterface("ep0-uplink");
+    portmapper.setPort(ep0->getAccessInterface().get(), 42);
+    portmapper.setPort(ep0->getAccessUplinkInterface().get(), 24);
+    portmapper.setPort(42, ep0->getAccessInterface().get());
+    portmapper.setPort(24, ep0->getAccessUplinkInterface().get());
+    epSrc.updateEndpoint(*ep0);
+    WAIT_FOR(exec.executedFlowEdits > edits, 500);
+    release.set_value();
+
+    initExpEp(ep0);
+    WAIT_FOR_TABLES("create", 500);
+
+    edits = exec.executedFlowEdits;
+    epSrc.removeEndpoint(ep0->getUUID());
+    WAIT_FOR(exec.executedFlowEdits > edits, 500);
+    clearExpFlowTables();
+    initExpStatic();
+    WAIT_FOR_TABLES("remove", 500);
+}
+
 BOOST_FIXTURE_TEST_CASE(epDscpTest, AccessFlowManagerFixture) {
     setConnected();
 
@@ -522,6 +573,94 @@ BOOST_FIXTURE_TEST_CASE(denyrule, AccessFlowManagerFixture) {
     WAIT_FOR_TABLES("deny-rule", 500);
 }
 
+BOOST_FIXTURE_TEST_CASE(secGrpConjunctive, AccessFlowManagerFixture) {
+    accessFlowManager.setConjunctiveSecGroups(true);
+    createObjects();
+    createPolicyObjects();
+
+    /* two groups whose rules have the same classifier */
+    shared_ptr<SecGroup> secGrpA;
+    shared_ptr<SecGroup> secGrpB;
+    {
+        Mutator mutator(framework, "policyreg");
+        secGrpA = space->addGbpSecGroup("secgrpA");
+        secGrpA->addGbpSecGroupSubject("A_subject1")
+            ->addGbpSecGroupRule("A_1_rule1")
+            ->setDirection(DirectionEnumT::CONST_IN).setOrder(100)
+            .addGbpRuleToClassifierRSrc(classifier1->getURI().toString());
+        secGrpB = space->addGbpSecGroup("secgrpB");
+        secGrpB->addGbpSecGroupSubject("B_subject1")
+            ->addGbpSecGroupRule("B_1_rule1")
+            ->setDirection(DirectionEnumT::CONST_IN).setOrder(100)
+            .addGbpRuleToClassifierRSrc(classifier1->getURI().toString());
+        mutator.commit();
+    }
+
+    uint16_t prio = PolicyManager::MAX_POLICY_RULE_PRIORITY;
+    uint32_t ruleId = idGen.getId("l24classifierRule",
+                                  classifier1->getURI().toString());
+    auto conjKey = [prio](const shared_ptr<SecGroup>& sg) {
+        return sg->getURI().toString() + "|" +
+            std::to_string(AccessFlowManager::SEC_GROUP_IN_TABLE_ID) +
+            "|" + std::to_string(prio) + "|0";
+    };
+    /* the rules of each group once, and a flow for the set */
+    auto initExpConjSet = [&](const vector<shared_ptr<SecGroup> >& set) {
+        string setStr;
+        std::set<uint32_t> conjIds;
+        for (const shared_ptr<SecGroup>& sg : set) {
+            uint32_t conjId = idGen.getIdNoAlloc("secGroupConj",
+                                                 conjKey(sg));
+            BOOST_REQUIRE(conjId != uint32_t(-1));
+            conjIds.insert(conjId);
+            ADDF(Bldr(SEND_FLOW_REM).table(IN_POL).priority(prio)
+                 .cookie(ruleId).isConjId(conjId)
+                 .actions().go(TAP).done());
+            setStr += (setStr.empty() ? "" : ",") + sg->getURI().toString();
+        }
+        uint32_t setId = idGen.getId("secGroupSet", setStr);
+        Bldr clause;
+        clause.table(IN_POL).priority(prio).tcp().isTpDst(80).actions();
+        Bldr setFlow;
+        setFlow.table(IN_POL).priority(prio).reg(SEPG, setId).actions();
+        for (uint32_t conjId : conjIds) {
+            clause.conjunction(conjId, 1, 2);
+            setFlow.conjunction(conjId, 0, 2);
+        }
+        ADDF(clause.done());
+        ADDF(setFlow.done());
+    };
+
+    ep0.reset(new Endpoint("0-0-0-0"));
+    ep0->addSecurityGroup(secGrpA->getURI());
+    epSrc.updateEndpoint(*ep0);
+
+    initExpStatic();
+    initExpConjSet({secGrpA});
+    WAIT_FOR_TABLES("add", 500);
+
+    /* the groups share the clause flow */
+    ep0->addSecurityGroup(secGrpB->getURI());
+    epSrc.updateEndpoint(*ep0);
+
+    clearExpFlowTables();
+    initExpStatic();
+    initExpConjSet({secGrpA, secGrpB});
+    WAIT_FOR_TABLES("shared", 500);
+
+    /* the rules of a group that no set uses are removed */
+    string keyA = conjKey(secGrpA);
+    ep0.reset(new Endpoint("0-0-0-0"));
+    ep0->addSecurityGroup(secGrpB->getURI());
+    epSrc.updateEndpoint(*ep0);
+
+    clearExpFlowTables();
+    initExpStatic();
+    initExpConjSet({secGrpB});
+    WAIT_FOR_TABLES("remove", 500);
+    BOOST_CHECK_EQUAL(uint32_t(-1), idGen.getIdNoAlloc("secGroupConj", keyA));
+}
+
 BOOST_FIXTURE_TEST_CASE(egressDnsRule, AccessFlowManagerFixture) {
     using namespace modelgbp::epdr;
     createObjects();
@@ -1122,4 +1261,107 @@ void AccessFlowManagerFixture::initExpSecGrp6() {
              .tcp().reg(SEPG, setId).isIpDst("10.0.0.0/16").isTpDst(80).actions()
              .permitLog(OUT_POL,EXP_DROP,ruleId).go(TAP).done());
 }
+
+static void setDropSampling(Agent& agent, double probability) {
+    PacketDropLogConfig cfg(opflex::modb::URIBuilder()
+                            .addElement("PolicyUniverse")
+                            .addElement("ObserverDropLogConfig").build());
+    cfg.sampling.tables["Acc-OUT_TABLE"] = probability;
+    agent.getExtraConfigManager().packetDropLogConfigUpdated(cfg);
+}
+
+/* the buckets of a drop sampling group that logs weight/10000 drops */
+static string dropSampleBuckets(uint16_t weight) {
+    return ",bucket=bucket_id:0,weight:" + std::to_string(weight) +
+        ",actions=resubmit(," + std::to_string(EXP_DROP) + ")" +
+        ",bucket=bucket_id:1,weight:" + std::to_string(10000 - weight) +
+        ",actions=drop";
+}
+
+BOOST_FIXTURE_TEST_CASE(tableDropSampling, AccessFlowManagerFixture) {
+    setConnected();
+    WAIT_FOR(exec.executedFlowEdits > 0 && !switchManager.isSyncing(), 500);
+    setDropSampling(agent, 1);
+
+    uint32_t gid = flowutils::DROP_SAMPLE_GROUP_BASE + OUT;
+    string ge_smpl("group_id=" + std::to_string(gid) + ",type=select");
+
+    // a fraction of the drops go through the sampling group
+    exec.Clear();
+    exec.ExpectGroup(FlowEdit::ADD, ge_smpl + dropSampleBuckets(2500));
+    exec.Expect(FlowEdit::MOD, Bldr().table(OUT).priority(0)
+                .cookie(ovs_ntohll(opflexagent::flow::cookie::TABLE_DROP_FLOW))
+                .flags(OFPUTIL_FF_SEND_FLOW_REM).priority(0)
+                .actions().dropLog(OUT).group(gid).done());
+    setDropSampling(agent, 0.25);
+    WAIT_FOR(exec.IsGroupEmpty(), 500);
+    WAIT_FOR(exec.IsEmpty(), 500);
+
+    // a new fraction only changes the group
+    exec.Clear();
+    exec.ExpectGroup(FlowEdit::MOD, ge_smpl + dropSampleBuckets(5000));
+    setDropSampling(agent, 0.5);
+    WAIT_FOR(exec.IsGroupEmpty(), 500);
+
+    // none of the drops are logged, but they are still counted
+    exec.Clear();
+    exec.Expect(FlowEdit::MOD, Bldr().table(OUT).priority(0)
+                .cookie(ovs_ntohll(opflexagent::flow::cookie::TABLE_DROP_FLOW))
+                .flags(OFPUTIL_FF_SEND_FLOW_REM).priority(0)
+                .actions().drop().done());
+    exec.ExpectGroup(FlowEdit::DEL, "group_id=" + std::to_string(gid) +
+                     ",type=all");
+    setDropSampling(agent, 0);
+    WAIT_FOR(exec.IsEmpty(), 500);
+    WAIT_FOR(exec.IsGroupEmpty(), 500);
+
+    // every drop goes to the drop table again
+    exec.Clear();
+    exec.Expect(FlowEdit::MOD, Bldr().table(OUT).priority(0)
+                .cookie(ovs_ntohll(opflexagent::flow::cookie::TABLE_DROP_FLOW))
+                .flags(OFPUTIL_FF_SEND_FLOW_REM).priority(0)
+                .actions().dropLog(OUT).go(EXP_DROP).done());
+    setDropSampling(agent, 1);
+    WAIT_FOR(exec.IsEmpty(), 500);
+}
+
+BOOST_FIXTURE_TEST_CASE(tableDropSamplingReconcile, AccessFlowManagerFixture) {
+    setDropSampling(agent, 0.25);
+
+    uint32_t gid = flowutils::DROP_SAMPLE_GROUP_BASE + OUT;
+    string ge_smpl("group_id=" + std::to_string(gid) + ",type=select");
+    SwitchStateHandler::GroupMap recvGroups;
+    auto editStr = [](const GroupEdit& ge, size_t i) {
+        std::stringstream ss;
+        ss << ge.edits[i];
+        return ss.str();
+    };
+
+    // a missing group is added
+    GroupEdit ge = accessFlowManager.reconcileGroups(recvGroups);
+    BOOST_REQUIRE_EQUAL(1, ge.edits.size());
+    BOOST_CHECK_EQUAL("ADD|" + ge_smpl + dropSampleBuckets(2500),
+                      editStr(ge, 0));
+
+    // a matching group is kept and an unknown one is removed
+    recvGroups[gid] = flowutils::drop_sample_group(OFPGC11_ADD, OUT,
+                                                   EXP_DROP, 0.25);
+    recvGroups[4242] = flowutils::drop_sample_group(OFPGC11_ADD, OUT,
+                                                    EXP_DROP, 0.25);
+    recvGroups[4242]->mod->group_id = 4242;
+    ge = accessFlowManager.reconcileGroups(recvGroups);
+    BOOST_REQUIRE_EQUAL(1, ge.edits.size());
+    BOOST_CHECK_EQUAL("DEL|group_id=4242,type=all", editStr(ge, 0));
+
+    // a group with a stale fraction is corrected
+    recvGroups.clear();
+    recvGroups[gid] = flowutils::drop_sample_group(OFPGC11_ADD, OUT,
+                                                   EXP_DROP, 0.5);
+    ge = accessFlowManager.reconcileGroups(recvGroups);
+    BOOST_REQUIRE_EQUAL(1, ge.edits.size());
+    BOOST_CHECK_EQUAL("MOD|" + ge_smpl + dropSampleBuckets(2500),
+                      editStr(ge, 0));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
+
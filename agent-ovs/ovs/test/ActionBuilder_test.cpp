@@ -0,0 +1,102 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Test suite for class ActionBuilder
+ *
+ * Copyright (c) 2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "ActionBuilder.h"
+#include "FlowBuilder.h"
+#include "TableState.h"
+#include "ovs-ofputil.h"
+
+namespace opflexagent {
+
+BOOST_AUTO_TEST_SUITE(ActionBuilder_test)
+
+BOOST_AUTO_TEST_CASE(pool_reuse) {
+    size_t pooled = ActionBufferPool::size();
+
+    // a buffer given back is cleared and handed out again
+    ofpbuf* b = ActionBufferPool::get();
+    ofpbuf_put_zeros(b, 32);
+    ActionBufferPool::put(b);
+    BOOST_CHECK_EQUAL(pooled + 1, ActionBufferPool::size());
+    BOOST_CHECK_EQUAL(b, ActionBufferPool::get());
+    BOOST_CHECK_EQUAL(0, b->size);
+    BOOST_CHECK_EQUAL(pooled, ActionBufferPool::size());
+
+    // a buffer that grew large is freed
+    ofpbuf_put_zeros(b, ActionBufferPool::MAX_SIZE + 1);
+    ActionBufferPool::put(b);
+    BOOST_CHECK_EQUAL(pooled, ActionBufferPool::size());
+
+    // the pool keeps a bounded number of buffers
+    std::vector<ofpbuf*> bufs;
+    for (size_t i = 0; i < ActionBufferPool::MAX_BUFFERS + 4; ++i)
+        bufs.push_back(ActionBufferPool::get());
+    for (ofpbuf* buf : bufs)
+        ActionBufferPool::put(buf);
+    BOOST_CHECK_EQUAL(ActionBufferPool::MAX_BUFFERS,
+                      ActionBufferPool::size());
+
+    // builders take their buffers from the pool and give them back
+    {
+        ActionBuilder ab;
+        BOOST_CHECK_EQUAL(ActionBufferPool::MAX_BUFFERS - 1,
+                          ActionBufferPool::size());
+    }
+    BOOST_CHECK_EQUAL(ActionBufferPool::MAX_BUFFERS,
+                      ActionBufferPool::size());
+}
+
+BOOST_AUTO_TEST_CASE(copy_actions) {
+    ofpbuf* b = ActionBufferPool::get();
+    size_t len = 1;
+    BOOST_CHECK(ActionBuilder::copyActions(b, len) == NULL);
+    BOOST_CHECK_EQUAL(0, len);
+
+    uint8_t data[40];
+    for (size_t i = 0; i < sizeof(data); ++i)
+        data[i] = i;
+    ofpbuf_put(b, data, sizeof(data));
+    ofpact* acts = ActionBuilder::copyActions(b, len);
+    BOOST_REQUIRE(acts != NULL);
+    BOOST_CHECK_EQUAL(sizeof(data), len);
+    BOOST_CHECK(memcmp(acts, data, sizeof(data)) == 0);
+    // the buffer is emptied but keeps its memory for the next flow
+    BOOST_CHECK_EQUAL(0, b->size);
+    BOOST_CHECK(b->allocated >= sizeof(data));
+    free(acts);
+    ActionBufferPool::put(b);
+}
+
+BOOST_AUTO_TEST_CASE(reused_buffer_actions) {
+    // the actions of a flow built with a reused buffer are the same
+    // as with a new one, with nothing left from the previous flow
+    FlowEntryPtr first = FlowBuilder().priority(1)
+        .action().output(1).output(2).output(3).go(4).parent().build();
+    FlowEntryPtr second = FlowBuilder().priority(1)
+        .action().output(5).parent().build();
+
+    FlowEntryPtr expected = FlowBuilder().priority(1)
+        .action().output(5).parent().build();
+    BOOST_CHECK(second->actionEq(expected.get()));
+    BOOST_CHECK(!first->actionEq(second.get()));
+    BOOST_CHECK_EQUAL(expected->entry->ofpacts_len,
+                      second->entry->ofpacts_len);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace opflexagent */
@@ -192,6 +192,22 @@ public:
     }
 };
 
+class EpAdvertFixturePaced : public AdvertManagerFixture {
+public:
+    EpAdvertFixturePaced()
+        : AdvertManagerFixture() {
+        advertManager.
+            enableEndpointAdv(AdvertManager::EPADV_GRATUITOUS_BROADCAST);
+        advertManager.setAdvRateLimit(20);
+        start();
+        advertManager.scheduleInitialEndpointAdv(10);
+    }
+
+    ~EpAdvertFixturePaced() {
+        stop();
+    }
+};
+
 class EpAdvertFixtureRR : public AdvertManagerFixture {
 public:
     EpAdvertFixtureRR()
@@ -335,6 +351,17 @@ BOOST_FIXTURE_TEST_CASE(endpointAdvertGB, EpAdvertFixtureGB) {
     testEpAdvert(AdvertManager::EPADV_GRATUITOUS_BROADCAST);
 }
 
+BOOST_FIXTURE_TEST_CASE(endpointAdvertPaced, EpAdvertFixturePaced) {
+    // the advertisements trickle out a couple at a time
+    WAIT_FOR(conn->getSentMsgCount() > 0, 1000);
+    BOOST_CHECK(conn->getSentMsgCount() < 11);
+    BOOST_CHECK(advertManager.getMaxAdvBacklog() > 2);
+
+    testEpAdvert(AdvertManager::EPADV_GRATUITOUS_BROADCAST);
+    WAIT_FOR(advertManager.getAdvBacklog() == 0, 500);
+    BOOST_CHECK(advertManager.getAdvSentCount() >= 8);
+}
+
 BOOST_FIXTURE_TEST_CASE(routerAdvert, RouterAdvertFixture) {
     WAIT_FOR(conn->getSentMsgCount() == 1, 1000);
     BOOST_CHECK_EQUAL(1, conn->getSentMsgCount());
@@ -29,13 +29,22 @@ using namespace opflexagent;
 class MockExecutorConnection : public SwitchConnection {
 public:
     MockExecutorConnection() : SwitchConnection("mockBridge"),
-        lastXid(0), errReply(ofperr(0)), reconnectReply(false), executor(nullptr) {
+        lastXid(0), errReply(ofperr(0)), reconnectReply(false), executor(nullptr),
+        barriers(0) {
     }
     ~MockExecutorConnection() {
     }
 
     int GetProtocolVersion() { return OFP13_VERSION; }
     int SendMessage(OfpBuf& msg);
+    int SendMessages(std::vector<OfpBuf>& msgs) {
+        for (OfpBuf& msg : msgs) {
+            int err = SendMessage(msg);
+            if (err)
+                return err;
+        }
+        return 0;
+    }
 
     void Expect(const FlowEdit& fe) {
         expectedEdits = fe;
@@ -49,6 +58,7 @@ public:
     ofperr errReply;
     bool reconnectReply;
     FlowExecutor *executor;
+    int barriers;
 };
 
 class FlowExecutorFixture {
@@ -80,6 +90,19 @@ BOOST_FIXTURE_TEST_CASE(multiedit, FlowExecutorFixture) {
     BOOST_CHECK(fexec.Execute(fe));
 }
 
+BOOST_FIXTURE_TEST_CASE(transaction, FlowExecutorFixture) {
+    FlowEdit fe;
+    assign::push_back(fe.edits)(FlowEdit::ADD, flows[0])
+            (FlowEdit::MOD, flows[1]);
+    conn.Expect(fe);
+    BOOST_CHECK(fexec.Execute(GroupEdit(), fe, GroupEdit()));
+    BOOST_CHECK(conn.expectedEdits.edits.empty());
+    BOOST_CHECK_EQUAL(1, conn.barriers);
+
+    BOOST_CHECK(fexec.Execute(GroupEdit(), FlowEdit(), GroupEdit()));
+    BOOST_CHECK_EQUAL(1, conn.barriers);
+}
+
 BOOST_FIXTURE_TEST_CASE(noblock, FlowExecutorFixture) {
     FlowEdit fe;
     assign::push_back(fe.edits)(FlowEdit::ADD, flows[0])
@@ -105,6 +128,39 @@ BOOST_FIXTURE_TEST_CASE(reconnect, FlowExecutorFixture) {
     BOOST_CHECK(fexec.Execute(fe) == false);
 }
 
+BOOST_FIXTURE_TEST_CASE(async, FlowExecutorFixture) {
+    std::vector<int> done;
+    auto completion = [&done](int status) { done.push_back(status); };
+    fexec.setMaxOutstanding(4);
+
+    FlowEdit fe;
+    assign::push_back(fe.edits)(FlowEdit::ADD, flows[0])
+            (FlowEdit::MOD, flows[1]);
+    conn.Expect(fe);
+    BOOST_CHECK(fexec.ExecuteAsync(fe, completion));
+    BOOST_CHECK(conn.expectedEdits.edits.empty());
+    BOOST_CHECK_EQUAL(1, conn.barriers);
+
+    FlowEdit fe1;
+    assign::push_back(fe1.edits)(FlowEdit::MOD, flows[0]);
+    conn.Expect(fe1);
+    conn.ReplyWithError(OFPERR_OFPFMFC_TABLE_FULL);
+    BOOST_CHECK(fexec.ExecuteAsync(fe1, completion));
+
+    conn.Expect(fe1);
+    conn.ReplyWithError(ofperr(0));
+    conn.reconnectReply = true;
+    BOOST_CHECK(fexec.ExecuteAsync(fe1, completion));
+
+    BOOST_CHECK(fexec.ExecuteAsync(FlowEdit(), completion));
+    BOOST_CHECK_EQUAL(3, conn.barriers);
+
+    std::vector<int> expected =
+        { 0, OFPERR_OFPFMFC_TABLE_FULL, ENOTCONN, 0 };
+    BOOST_CHECK_EQUAL_COLLECTIONS(done.begin(), done.end(),
+                                  expected.begin(), expected.end());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 int MockExecutorConnection::SendMessage(OfpBuf& msg) {
@@ -170,6 +226,7 @@ int MockExecutorConnection::SendMessage(OfpBuf& msg) {
         minimatch_destroy(&fm.match);
     } else if (type == OFPTYPE_BARRIER_REQUEST) {
          BOOST_CHECK(expectedEdits.edits.empty());
+         ++barriers;
 
          if (reconnectReply) {
              executor->Connected(this);
@@ -118,12 +118,12 @@ static string rstr[] = {
     "OXM_OF_VLAN_VID[]", "NXM_OF_ETH_SRC[]", "NXM_OF_ETH_DST[]",
     "NXM_OF_ARP_OP[]", "NXM_NX_ARP_SHA[]", "NXM_NX_ARP_THA[]",
     "NXM_OF_ARP_SPA[]", "NXM_OF_ARP_TPA[]", "OXM_OF_METADATA[]",
-    "NXM_NX_PKT_MARK[]"
+    "NXM_NX_PKT_MARK[]", "NXM_NX_REG1[]"
 };
 static string rstr1[] =
     { "reg0", "reg0", "reg2", "reg4", "reg5", "reg5", "reg6", "reg7",
       "reg8", "reg9", "reg10", "reg11", "reg12",
-      "", "", "", "", "", "", "" ,"", "", "", "", ""};
+      "", "", "", "", "", "", "" ,"", "", "", "", "", "", "reg1"};
 
 Bldr::Bldr() :
     _flag(0), _table("table=0"), _cookie("cookie=0x0"),
@@ -24,6 +24,8 @@
 #include <modelgbp/gbp/EnforcementPreferenceTypeEnumT.hpp>
 #include <modelgbp/gbpe/EpToSvcCounter.hpp>
 
+#include <opflex/modb/URIBuilder.h>
+
 #include <opflexagent/logging.h>
 #include <opflexagent/LearningBridgeSource.h>
 #include "IntFlowManager.h"
@@ -160,6 +162,12 @@ public:
     /** Initialize contract 1 flows */
     void initExpCon1();
 
+    /**
+     * Initialize contract 1 flows between one provider and one
+     * consumer, optionally without the flows of its fourth rule
+     */
+    void initExpCon1(uint32_t pvnid, uint32_t cvnid, bool rule4 = true);
+
     /** Initialize contract 2 flows */
     void initExpCon2();
 
@@ -180,6 +188,33 @@ public:
     void initExpCon9();
   
     void initExpCon10();
+
+    /**
+     * Create contracts with a single rule allowing a classifier from
+     * epg3, epg4 and a new group epg5 to epg0, epg1 and epg2, and wait
+     * for them to resolve
+     */
+    void createConjContracts(const vector<string>& names,
+                             const shared_ptr<L24Classifier>& classifier,
+                             vector<shared_ptr<Contract> >& contracts,
+                             unordered_set<uint32_t>& pvnids,
+                             unordered_set<uint32_t>& cvnids);
+
+    /**
+     * Initialize the conjunction and group clause flows of contracts
+     * created by createConjContracts
+     * @return the conjunction IDs of the contracts
+     */
+    std::set<uint32_t>
+    initExpConjContracts(const vector<URI>& contracts,
+                         const shared_ptr<L24Classifier>& classifier,
+                         uint8_t nClauses,
+                         const unordered_set<uint32_t>& pvnids,
+                         const unordered_set<uint32_t>& cvnids);
+
+    /** Initialize a clause flow shared by conjunctions */
+    void initExpConjClause(Bldr& b, const std::set<uint32_t>& conjIds,
+                           uint8_t clause, uint8_t nClauses);
     /** Initialize subnet-scoped flow entries */
     void initSubnets(PolicyManager::subnet_vector_t& sns,
                      uint32_t bdId = 1, uint32_t rdId = 1);
@@ -247,7 +282,8 @@ public:
     void groupFloodTest();
     void connectTest();
     void portStatusTest();
-    void loadBalancedServiceTest(bool stats_enabled);
+    void loadBalancedServiceTest(bool stats_enabled,
+                                 bool stats_aggregated = false);
     void LBServiceTest();
     void remoteEndpointTest();
 
@@ -304,6 +340,18 @@ public:
     virtual ~VxlanIntFlowManagerFixture() {}
 };
 
+class ParallelIntFlowManagerFixture : public IntFlowManagerFixture {
+public:
+    ParallelIntFlowManagerFixture() : IntFlowManagerFixture() {
+        intFlowManager.setEncapType(IntFlowManager::ENCAP_VXLAN);
+        intFlowManager.setFlowComputeThreads(3);
+        intFlowManager.start();
+        createGroupEntries(IntFlowManager::ENCAP_VXLAN);
+    }
+
+    virtual ~ParallelIntFlowManagerFixture() {}
+};
+
 class VlanIntFlowManagerFixture : public IntFlowManagerFixture {
 public:
     VlanIntFlowManagerFixture() : IntFlowManagerFixture() {
@@ -592,6 +640,64 @@ BOOST_FIXTURE_TEST_CASE(arpmode_vlan, VlanIntFlowManagerFixture) {
     arpModeTest();
 }
 
+BOOST_FIXTURE_TEST_CASE(epgUnchangedDeps, VxlanIntFlowManagerFixture) {
+    setConnected();
+    exec.IgnoreGroupMods();
+
+    Mutator m1(framework, policyOwner);
+    epg0->addGbpEpGroupToNetworkRSrc()
+        ->setTargetFloodDomain(fd0->getURI());
+    m1.commit();
+    WAIT_FOR(policyMgr.getFDForGroup(epg0->getURI()) != boost::none, 500);
+    PolicyManager::subnet_vector_t sns;
+    WAIT_FOR_DO(sns.size() == 4, 500, sns.clear();
+                policyMgr.getSubnetsForGroup(epg0->getURI(), sns));
+    intFlowManager.egDomainUpdated(epg0->getURI());
+
+    clearExpFlowTables();
+    initExpStatic();
+    initExpEpg(epg0, 1);
+    initExpFd(1);
+    initExpBd(1, 1, true);
+    initExpEp(ep0, epg0, 1, 1, 1, true);
+    initExpEp(ep2, epg0, 1, 1, 1, true);
+    initSubnets(sns);
+    WAIT_FOR_TABLES("create", 500);
+
+    /* move ep0 to another port without telling the flow manager, so
+       that any recomputation of its flows shows in the tables */
+    portmapper.setPort(ep0->getInterfaceName().get(), 81);
+    portmapper.setPort(81, ep0->getInterfaceName().get());
+
+    /* a group update that leaves the endpoint attributes unchanged
+       does not rewrite the endpoint flows */
+    intFlowManager.egDomainUpdated(epg0->getURI());
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    WAIT_FOR_TABLES("unchanged", 500);
+
+    /* changing the arp mode recomputes every endpoint of the group */
+    fd0->setArpMode(AddressResModeEnumT::CONST_FLOOD)
+        .setNeighborDiscMode(AddressResModeEnumT::CONST_FLOOD);
+    m1.commit();
+    WAIT_FOR(policyMgr.getFDForGroup(epg0->getURI()).get()
+             ->getArpMode(AddressResModeEnumT::CONST_UNICAST)
+             == AddressResModeEnumT::CONST_FLOOD, 500);
+    WAIT_FOR(policyMgr.getFDForGroup(epg0->getURI()).get()
+             ->getNeighborDiscMode(AddressResModeEnumT::CONST_UNICAST)
+             == AddressResModeEnumT::CONST_FLOOD, 500);
+    intFlowManager.egDomainUpdated(epg0->getURI());
+
+    clearExpFlowTables();
+    initExpStatic();
+    initExpEpg(epg0, 1);
+    initExpFd(1);
+    initExpBd(1, 1, true);
+    initExpEp(ep0, epg0, 1, 1, 1, false);
+    initExpEp(ep2, epg0, 1, 1, 1, false);
+    initSubnets(sns);
+    WAIT_FOR_TABLES("changed", 500);
+}
+
 BOOST_FIXTURE_TEST_CASE(localEp, VxlanIntFlowManagerFixture) {
     setConnected();
 
@@ -641,6 +747,40 @@ BOOST_FIXTURE_TEST_CASE(localEp, VxlanIntFlowManagerFixture) {
     WAIT_FOR_TABLES("remove", 500);
 }
 
+BOOST_FIXTURE_TEST_CASE(localEpDestLookup, VxlanIntFlowManagerFixture) {
+    intFlowManager.setEndpointDestLookup(true);
+    setConnected();
+
+    /* the route and service flows of each address load the ID of the
+       endpoint actions */
+    intFlowManager.endpointUpdated(ep0->getUUID());
+
+    initExpStatic();
+    initExpEp(ep0, epg0);
+    WAIT_FOR_TABLES("create", 500);
+    BOOST_CHECK(idGen.getIdNoAlloc("endpointDest",
+                                   "route:" + ep0->getUUID()) !=
+                static_cast<uint32_t>(-1));
+
+    /* port-mapping change rewrites the shared actions */
+    portmapper.setPort(ep0->getInterfaceName().get(), 180);
+    intFlowManager.portStatusUpdate(ep0->getInterfaceName().get(),
+                                 180, false);
+
+    clearExpFlowTables();
+    initExpStatic();
+    initExpEp(ep0, epg0);
+    WAIT_FOR_TABLES("change port", 500);
+
+    /* remove endpoint */
+    epSrc.removeEndpoint(ep0->getUUID());
+    intFlowManager.endpointUpdated(ep0->getUUID());
+
+    clearExpFlowTables();
+    initExpStatic();
+    WAIT_FOR_TABLES("remove", 500);
+}
+
 BOOST_FIXTURE_TEST_CASE(noifaceEp, VxlanIntFlowManagerFixture) {
     setConnected();
 
@@ -883,6 +1023,207 @@ BOOST_FIXTURE_TEST_CASE(policy, VxlanIntFlowManagerFixture) {
     WAIT_FOR_TABLES("remove", 500);
 }
 
+BOOST_FIXTURE_TEST_CASE(policy_conjunction_fallback,
+                        VxlanIntFlowManagerFixture) {
+    setConnected();
+    intFlowManager.setConjunctiveContracts(true);
+
+    createPolicyObjects();
+
+    PolicyManager::uri_set_t egs;
+    WAIT_FOR_DO(egs.size() == 2, 1000, egs.clear();
+                policyMgr.getContractProviders(con1->getURI(), egs));
+    egs.clear();
+    WAIT_FOR_DO(egs.size() == 2, 500, egs.clear();
+                policyMgr.getContractConsumers(con1->getURI(), egs));
+
+    /* two providers and two consumers need fewer flows per pair */
+    intFlowManager.contractUpdated(con1->getURI());
+    initExpStatic();
+    initExpCon1();
+    WAIT_FOR_TABLES("con1", 500);
+}
+
+BOOST_FIXTURE_TEST_CASE(policy_conjunction, VxlanIntFlowManagerFixture) {
+    setConnected();
+    intFlowManager.setConjunctiveContracts(true);
+
+    createPolicyObjects();
+
+    /* two contracts from three consumers to three providers */
+    vector<shared_ptr<Contract> > cons;
+    unordered_set<uint32_t> pvnids;
+    unordered_set<uint32_t> cvnids;
+    createConjContracts({"conjContract1", "conjContract2"}, classifier1,
+                        cons, pvnids, cvnids);
+    shared_ptr<Contract> conjCon1 = cons[0];
+    shared_ptr<Contract> conjCon2 = cons[1];
+
+    /* one flow per group and per classifier instead of one per pair */
+    intFlowManager.contractUpdated(conjCon1->getURI());
+    intFlowManager.contractUpdated(conjCon2->getURI());
+    initExpStatic();
+    std::set<uint32_t> conjIds =
+        initExpConjContracts({conjCon1->getURI(), conjCon2->getURI()},
+                             classifier1, 3, pvnids, cvnids);
+    Bldr cls;
+    cls.table(POL).priority(PolicyManager::MAX_POLICY_RULE_PRIORITY)
+        .tcp().isTpDst(80);
+    initExpConjClause(cls, conjIds, 2, 3);
+    WAIT_FOR_TABLES("add", 500);
+
+    /* the clause flows keep the conjunction of the other contract */
+    uint32_t cookie = intFlowManager.getId(classifier1->getClassId(),
+                                           classifier1->getURI());
+    string conjKey2 = conjCon2->getURI().toString() + "|" +
+        std::to_string(cookie) + "|" +
+        std::to_string(PolicyManager::MAX_POLICY_RULE_PRIORITY) + "|in";
+    Mutator m2(framework, policyOwner);
+    conjCon2->remove();
+    m2.commit();
+    WAIT_FOR(!policyMgr.contractExists(conjCon2->getURI()), 500);
+    intFlowManager.contractUpdated(conjCon2->getURI());
+    clearExpFlowTables();
+    initExpStatic();
+    conjIds = initExpConjContracts({conjCon1->getURI()}, classifier1, 3,
+                                   pvnids, cvnids);
+    Bldr cls1;
+    cls1.table(POL).priority(PolicyManager::MAX_POLICY_RULE_PRIORITY)
+        .tcp().isTpDst(80);
+    initExpConjClause(cls1, conjIds, 2, 3);
+    WAIT_FOR_TABLES("remove one", 500);
+    BOOST_CHECK_EQUAL(uint32_t(-1),
+                      idGen.getIdNoAlloc("conjunction", conjKey2));
+
+    /* the last contract takes its clause flows with it */
+    Mutator m3(framework, policyOwner);
+    conjCon1->remove();
+    m3.commit();
+    WAIT_FOR(!policyMgr.contractExists(conjCon1->getURI()), 500);
+    intFlowManager.contractUpdated(conjCon1->getURI());
+    clearExpFlowTables();
+    initExpStatic();
+    WAIT_FOR_TABLES("remove all", 500);
+}
+
+BOOST_FIXTURE_TEST_CASE(policy_conjunction_portrange,
+                        VxlanIntFlowManagerFixture) {
+    setConnected();
+    intFlowManager.setConjunctiveContracts(true);
+
+    createPolicyObjects();
+
+    /* three masks for each port range */
+    Mutator m1(framework, policyOwner);
+    shared_ptr<L24Classifier> clsr = space->addGbpeL24Classifier("clsrRange");
+    clsr->setEtherT(modelgbp::l2::EtherTypeEnumT::CONST_IPV4)
+        .setProt(6 /* TCP */)
+        .setSFromPort(1000).setSToPort(1006)
+        .setDFromPort(80).setDToPort(86);
+    m1.commit();
+
+    vector<shared_ptr<Contract> > cons;
+    unordered_set<uint32_t> pvnids;
+    unordered_set<uint32_t> cvnids;
+    createConjContracts({"conjContract1"}, clsr, cons, pvnids, cvnids);
+
+    /* the source and destination ports are a clause each, so the
+       classifier takes 3+3 flows instead of 3*3 */
+    intFlowManager.contractUpdated(cons[0]->getURI());
+    initExpStatic();
+    std::set<uint32_t> conjIds =
+        initExpConjContracts({cons[0]->getURI()}, clsr, 4, pvnids, cvnids);
+    uint16_t prio = PolicyManager::MAX_POLICY_RULE_PRIORITY;
+    for (const Mask& m : MaskList{Mask(1000, 0xfffc), Mask(1004, 0xfffe),
+                                  Mask(1006, 0xffff)}) {
+        Bldr b;
+        b.table(POL).priority(prio).tcp().isTpSrc(m.first, m.second);
+        initExpConjClause(b, conjIds, 2, 4);
+    }
+    for (const Mask& m : MaskList{Mask(80, 0xfffc), Mask(84, 0xfffe),
+                                  Mask(86, 0xffff)}) {
+        Bldr b;
+        b.table(POL).priority(prio).tcp().isTpDst(m.first, m.second);
+        initExpConjClause(b, conjIds, 3, 4);
+    }
+    WAIT_FOR_TABLES("portrange", 500);
+}
+
+BOOST_FIXTURE_TEST_CASE(policy_parallel, ParallelIntFlowManagerFixture) {
+    setConnected();
+
+    createPolicyObjects();
+
+    PolicyManager::uri_set_t egs;
+    WAIT_FOR_DO(egs.size() == 2, 1000, egs.clear();
+                policyMgr.getContractProviders(con1->getURI(), egs));
+    egs.clear();
+    WAIT_FOR_DO(egs.size() == 2, 500, egs.clear();
+                policyMgr.getContractConsumers(con1->getURI(), egs));
+
+    /* the flows of the pairs are computed on the flow workers */
+    intFlowManager.contractUpdated(con1->getURI());
+    initExpStatic();
+    initExpCon1();
+    WAIT_FOR_TABLES("con1", 500);
+}
+
+BOOST_FIXTURE_TEST_CASE(policy_delta, VxlanIntFlowManagerFixture) {
+    setConnected();
+
+    createPolicyObjects();
+
+    PolicyManager::uri_set_t egs;
+    WAIT_FOR_DO(egs.size() == 2, 1000, egs.clear();
+                policyMgr.getContractProviders(con1->getURI(), egs));
+    egs.clear();
+    WAIT_FOR_DO(egs.size() == 2, 500, egs.clear();
+                policyMgr.getContractConsumers(con1->getURI(), egs));
+
+    intFlowManager.contractUpdated(con1->getURI());
+    initExpStatic();
+    initExpCon1();
+    WAIT_FOR_TABLES("con1", 500);
+
+    /* only the pairs of the provider removed are updated */
+    Mutator m1(framework, policyOwner);
+    epg1->addGbpEpGroupToProvContractRSrc(con1->getURI().toString())
+        ->unsetTarget();
+    m1.commit();
+    WAIT_FOR_DO(egs.size() == 1, 500, egs.clear();
+                policyMgr.getContractProviders(con1->getURI(), egs));
+
+    ContractDelta delta;
+    delta.providersRemoved.insert(epg1->getURI());
+    intFlowManager.contractDeltaUpdated(con1->getURI(), delta);
+    clearExpFlowTables();
+    initExpStatic();
+    initExpCon1();
+    WAIT_FOR_TABLES("provider removed", 500);
+
+    /* remove a rule without telling the flow manager, so that any
+       recomputation of a pair's flows shows in the tables */
+    con1->addGbpSubject("1_subject1")->addGbpRule("1_1_rule4")->remove();
+    m1.commit();
+    PolicyManager::rule_list_t rules;
+    WAIT_FOR_DO(rules.size() == 3, 500, rules.clear();
+                policyMgr.getContractRules(con1->getURI(), rules));
+
+    /* a delta for epg3 rewrites only the flows of the epg0/epg3 pair,
+       which pick up the rule change, and leaves the epg0/epg2 pair */
+    uint32_t epg0_vnid = policyMgr.getVnidForGroup(epg0->getURI()).get();
+    uint32_t epg2_vnid = policyMgr.getVnidForGroup(epg2->getURI()).get();
+    uint32_t epg3_vnid = policyMgr.getVnidForGroup(epg3->getURI()).get();
+    ContractDelta delta2;
+    delta2.consumersAdded.insert(epg3->getURI());
+    intFlowManager.contractDeltaUpdated(con1->getURI(), delta2);
+    clearExpFlowTables();
+    initExpStatic();
+    initExpCon1(epg0_vnid, epg2_vnid);
+    initExpCon1(epg0_vnid, epg3_vnid, false);
+    WAIT_FOR_TABLES("one pair", 500);
+}
+
 BOOST_FIXTURE_TEST_CASE(policy_portrange, VxlanIntFlowManagerFixture) {
     setConnected();
     createPolicyObjects();
@@ -1640,6 +1981,14 @@ BOOST_FIXTURE_TEST_CASE(loadBalancedService_en_stats_vlan, VlanIntFlowManagerFix
     loadBalancedServiceTest(true);
 }
 
+BOOST_FIXTURE_TEST_CASE(loadBalancedService_agg_stats_vxlan, VxlanIntFlowManagerFixture) {
+    loadBalancedServiceTest(true, true);
+}
+
+BOOST_FIXTURE_TEST_CASE(loadBalancedService_agg_stats_vlan, VlanIntFlowManagerFixture) {
+    loadBalancedServiceTest(true, true);
+}
+
 BOOST_FIXTURE_TEST_CASE(loadBalancedService_dis_stats_vxlan, VxlanIntFlowManagerFixture) {
     loadBalancedServiceTest(false);
 }
@@ -1648,11 +1997,14 @@ BOOST_FIXTURE_TEST_CASE(loadBalancedService_dis_stats_vlan, VlanIntFlowManagerFi
     loadBalancedServiceTest(false);
 }
 
-void BaseIntFlowManagerFixture::loadBalancedServiceTest(bool stats_enabled) {
+void BaseIntFlowManagerFixture::loadBalancedServiceTest(bool stats_enabled,
+                                                        bool stats_aggregated) {
     setConnected();
-    LOG(DEBUG) << "#### Starting LB Service Test #### stats: " << stats_enabled;
+    LOG(DEBUG) << "#### Starting LB Service Test #### stats: " << stats_enabled
+               << " aggregated: " << stats_aggregated;
 
     intFlowManager.setServiceStatsFlowDisabled(!stats_enabled);
+    intFlowManager.setServiceStatsAggregated(stats_aggregated);
     LBServiceTest();
 }
 
@@ -1948,7 +2300,7 @@ BOOST_FIXTURE_TEST_CASE(learningBridge, BaseIntFlowManagerFixture) {
 
 #define ADDF(flow) addExpFlowEntry(expTables, flow)
 enum TABLE {
-    DROPLOG, SEC, SRC, SNAT_REV, SVR, BR, SVH, RT, SNAT, NAT, LRN, SVD, POL, STAT, OUT, EXP_DROPLOG
+    DROPLOG, SEC, SRC, SNAT_REV, SVR, BR, SVH, RT, SNAT, NAT, LRN, SVD, EPD, POL, STAT, OUT, EXP_DROPLOG
 };
 
 enum CaptureReason {
@@ -2259,6 +2611,12 @@ void BaseIntFlowManagerFixture::initExpEp(shared_ptr<Endpoint>& ep,
     memcpy(rmacArr, intFlowManager.getRouterMacAddr(), sizeof(rmacArr));
     string rmac = MAC(rmacArr).toString();
     string mmac("01:00:00:00:00:00/01:00:00:00:00:00");
+    // the IDs of the shared endpoint actions, if any
+    const uint32_t NO_ID = static_cast<uint32_t>(-1);
+    uint32_t routeId =
+        idGen.getIdNoAlloc("endpointDest", "route:" + ep->getUUID());
+    uint32_t serviceId =
+        idGen.getIdNoAlloc("endpointDest", "service:" + ep->getUUID());
 
     // source rules
     if (port != OFPP_NONE) {
@@ -2322,14 +2680,21 @@ void BaseIntFlowManagerFixture::initExpEp(shared_ptr<Endpoint>& ep,
                 address ipa = address::from_string(ip);
                 if (ipa.is_v4()) {
                     // route
-                    ADDF(Bldr().table(RT).priority(500).ip()
-                         .reg(RD, rdId)
-                         .isEthDst(rmac).isIpDst(ip)
-                         .actions().load(DEPG, vnid)
-                         .load(OUTPORT, port).ethSrc(rmac)
-                         .ethDst(mac).decTtl()
-                         .meta(opflexagent::flow::meta::ROUTED, opflexagent::flow::meta::ROUTED)
-                         .go(POL).done());
+                    if (routeId != NO_ID)
+                        ADDF(Bldr().table(RT).priority(500).ip()
+                             .reg(RD, rdId)
+                             .isEthDst(rmac).isIpDst(ip)
+                             .actions().load(EPDEST, routeId)
+                             .go(EPD).done());
+                    else
+                        ADDF(Bldr().table(RT).priority(500).ip()
+                             .reg(RD, rdId)
+                             .isEthDst(rmac).isIpDst(ip)
+                             .actions().load(DEPG, vnid)
+                             .load(OUTPORT, port).ethSrc(rmac)
+                             .ethDst(mac).decTtl()
+                             .meta(opflexagent::flow::meta::ROUTED, opflexagent::flow::meta::ROUTED)
+                             .go(POL).done());
                     if (ep->isDiscoveryProxyMode()) {
                         // proxy arp
                         ADDF(Bldr().table(BR).priority(20).arp()
@@ -2385,7 +2750,13 @@ void BaseIntFlowManagerFixture::initExpEp(shared_ptr<Endpoint>& ep,
                     }
                 } else {
                     // route
-                    if (ip != lladdr) {
+                    if (ip != lladdr && routeId != NO_ID) {
+                        ADDF(Bldr().table(RT).priority(500).ipv6()
+                             .reg(RD, rdId)
+                             .isEthDst(rmac).isIpv6Dst(ip)
+                             .actions().load(EPDEST, routeId)
+                             .go(EPD).done());
+                    } else if (ip != lladdr) {
                         ADDF(Bldr().table(RT).priority(500).ipv6()
                              .reg(RD, rdId)
                              .isEthDst(rmac).isIpv6Dst(ip)
@@ -2436,11 +2807,17 @@ void BaseIntFlowManagerFixture::initExpEp(shared_ptr<Endpoint>& ep,
         for (const string& ip : *acastIps) {
             address ipa = address::from_string(ip);
             if (ipa.is_v4()) {
-                ADDF(Bldr().table(SVD).priority(50).ip()
-                     .reg(RD, rdId).isIpDst(ip)
-                     .actions()
-                     .ethSrc(rmac).ethDst(mac)
-                     .decTtl().outPort(port).done());
+                if (serviceId != NO_ID)
+                    ADDF(Bldr().table(SVD).priority(50).ip()
+                         .reg(RD, rdId).isIpDst(ip)
+                         .actions().load(EPDEST, serviceId)
+                         .go(EPD).done());
+                else
+                    ADDF(Bldr().table(SVD).priority(50).ip()
+                         .reg(RD, rdId).isIpDst(ip)
+                         .actions()
+                         .ethSrc(rmac).ethDst(mac)
+                         .decTtl().outPort(port).done());
                 ADDF(Bldr().table(SVD).priority(51).arp()
                      .reg(RD, rdId)
                      .isEthDst(bmac).isTpa(ipa.to_string())
@@ -2452,11 +2829,17 @@ void BaseIntFlowManagerFixture::initExpEp(shared_ptr<Endpoint>& ep,
                                                 ipa.to_v4().to_ulong())
                      .inport().done());
             } else {
-                ADDF(Bldr().table(SVD).priority(50).ipv6()
-                     .reg(RD, rdId).isIpv6Dst(ip)
-                     .actions()
-                     .ethSrc(rmac).ethDst(mac)
-                     .decTtl().outPort(port).done());
+                if (serviceId != NO_ID)
+                    ADDF(Bldr().table(SVD).priority(50).ipv6()
+                         .reg(RD, rdId).isIpv6Dst(ip)
+                         .actions().load(EPDEST, serviceId)
+                         .go(EPD).done());
+                else
+                    ADDF(Bldr().table(SVD).priority(50).ipv6()
+                         .reg(RD, rdId).isIpv6Dst(ip)
+                         .actions()
+                         .ethSrc(rmac).ethDst(mac)
+                         .decTtl().outPort(port).done());
                 ADDF(Bldr().cookie(ovs_ntohll(opflexagent::flow::cookie::NEIGH_DISC))
                      .table(SVD).priority(51).icmp6()
                      .reg(RD, rdId).isEthDst(mmac)
@@ -2467,6 +2850,18 @@ void BaseIntFlowManagerFixture::initExpEp(shared_ptr<Endpoint>& ep,
                      .controller(65535).done());
             }
         }
+        if (serviceId != NO_ID)
+            ADDF(Bldr().table(EPD).priority(10).reg(EPDEST, serviceId)
+                 .actions()
+                 .ethSrc(rmac).ethDst(mac)
+                 .decTtl().outPort(port).done());
+        if (routeOn && routeId != NO_ID)
+            ADDF(Bldr().table(EPD).priority(10).reg(EPDEST, routeId)
+                 .actions().load(DEPG, vnid)
+                 .load(OUTPORT, port).ethSrc(rmac)
+                 .ethDst(mac).decTtl()
+                 .meta(opflexagent::flow::meta::ROUTED, opflexagent::flow::meta::ROUTED)
+                 .go(POL).done());
     }
 
     // hairpin output rule
@@ -2546,7 +2941,6 @@ void BaseIntFlowManagerFixture::initSubnets(PolicyManager::subnet_vector_t& sns,
 }
 
 void BaseIntFlowManagerFixture::initExpCon1() {
-    uint16_t prio = PolicyManager::MAX_POLICY_RULE_PRIORITY;
     PolicyManager::uri_set_t ps, cs;
     unordered_set<uint32_t> pvnids, cvnids;
 
@@ -2557,53 +2951,62 @@ void BaseIntFlowManagerFixture::initExpCon1() {
 
     for (const uint32_t& pvnid : pvnids) {
         for (const uint32_t& cvnid : cvnids) {
-            /* classifer 1  */
-            const opflex::modb::URI& ruleURI_1 = classifier1->getURI();
-            uint32_t con1_cookie = intFlowManager.getId(
-                         classifier1->getClassId(), ruleURI_1);
-            ADDF(Bldr(SEND_FLOW_REM).table(POL)
-                 .priority(prio)
-                 .cookie(con1_cookie).tcp()
-                 .reg(SEPG, cvnid).reg(DEPG, pvnid).isTpDst(80)
-                 .actions()
-                 .go(STAT)
-                 .done());
-            /* classifier 2  */
-            const opflex::modb::URI& ruleURI_2 = classifier2->getURI();
-            con1_cookie = intFlowManager.getId(classifier2->getClassId(),
-                                               ruleURI_2);
-            ADDF(Bldr(SEND_FLOW_REM).table(POL)
-                 .priority(prio-128)
-                 .cookie(con1_cookie).arp()
-                 .reg(SEPG, pvnid).reg(DEPG, cvnid)
-                 .actions().go(STAT).done());
-            /* classifier 6 */
-            const opflex::modb::URI& ruleURI_6 = classifier6->getURI();
-            con1_cookie = intFlowManager.getId(classifier6->getClassId(),
-                                               ruleURI_6);
-            ADDF(Bldr(SEND_FLOW_REM).table(POL)
-                 .priority(prio-256)
-                 .cookie(con1_cookie).tcp()
-                 .reg(SEPG, cvnid).reg(DEPG, pvnid).isTpSrc(22)
-                 .isTcpFlags("+syn+ack").actions().go(STAT).done());
-            /* classifier 7 */
-            const opflex::modb::URI& ruleURI_7 = classifier7->getURI();
-            con1_cookie = intFlowManager.getId(classifier7->getClassId(),
-                                               ruleURI_7);
-            ADDF(Bldr(SEND_FLOW_REM).table(POL)
-                 .priority(prio-384)
-                 .cookie(con1_cookie).tcp()
-                 .reg(SEPG, cvnid).reg(DEPG, pvnid).isTpSrc(21)
-                 .isTcpFlags("+ack").actions().go(STAT).done());
-            ADDF(Bldr(SEND_FLOW_REM).table(POL)
-                 .priority(prio-384)
-                 .cookie(con1_cookie).tcp()
-                 .reg(SEPG, cvnid).reg(DEPG, pvnid).isTpSrc(21)
-                 .isTcpFlags("+rst").actions().go(STAT).done());
+            initExpCon1(pvnid, cvnid);
         }
     }
 }
 
+void BaseIntFlowManagerFixture::initExpCon1(uint32_t pvnid, uint32_t cvnid,
+                                            bool rule4) {
+    uint16_t prio = PolicyManager::MAX_POLICY_RULE_PRIORITY;
+
+    /* classifer 1  */
+    const opflex::modb::URI& ruleURI_1 = classifier1->getURI();
+    uint32_t con1_cookie = intFlowManager.getId(
+                 classifier1->getClassId(), ruleURI_1);
+    ADDF(Bldr(SEND_FLOW_REM).table(POL)
+         .priority(prio)
+         .cookie(con1_cookie).tcp()
+         .reg(SEPG, cvnid).reg(DEPG, pvnid).isTpDst(80)
+         .actions()
+         .go(STAT)
+         .done());
+    /* classifier 2  */
+    const opflex::modb::URI& ruleURI_2 = classifier2->getURI();
+    con1_cookie = intFlowManager.getId(classifier2->getClassId(),
+                                       ruleURI_2);
+    ADDF(Bldr(SEND_FLOW_REM).table(POL)
+         .priority(prio-128)
+         .cookie(con1_cookie).arp()
+         .reg(SEPG, pvnid).reg(DEPG, cvnid)
+         .actions().go(STAT).done());
+    /* classifier 6 */
+    const opflex::modb::URI& ruleURI_6 = classifier6->getURI();
+    con1_cookie = intFlowManager.getId(classifier6->getClassId(),
+                                       ruleURI_6);
+    ADDF(Bldr(SEND_FLOW_REM).table(POL)
+         .priority(prio-256)
+         .cookie(con1_cookie).tcp()
+         .reg(SEPG, cvnid).reg(DEPG, pvnid).isTpSrc(22)
+         .isTcpFlags("+syn+ack").actions().go(STAT).done());
+    if (!rule4)
+        return;
+    /* classifier 7 */
+    const opflex::modb::URI& ruleURI_7 = classifier7->getURI();
+    con1_cookie = intFlowManager.getId(classifier7->getClassId(),
+                                       ruleURI_7);
+    ADDF(Bldr(SEND_FLOW_REM).table(POL)
+         .priority(prio-384)
+         .cookie(con1_cookie).tcp()
+         .reg(SEPG, cvnid).reg(DEPG, pvnid).isTpSrc(21)
+         .isTcpFlags("+ack").actions().go(STAT).done());
+    ADDF(Bldr(SEND_FLOW_REM).table(POL)
+         .priority(prio-384)
+         .cookie(con1_cookie).tcp()
+         .reg(SEPG, cvnid).reg(DEPG, pvnid).isTpSrc(21)
+         .isTcpFlags("+rst").actions().go(STAT).done());
+}
+
 void BaseIntFlowManagerFixture::initExpCon2() {
     uint16_t prio = PolicyManager::MAX_POLICY_RULE_PRIORITY;
     PolicyManager::uri_set_t ps, cs;
@@ -2942,6 +3345,92 @@ void BaseIntFlowManagerFixture::initExpCon10() {
                  .actions().dropLog(POL, POLICY_DENY, clsr18_cookie).go(EXP_DROPLOG).done());
 
 }
+void BaseIntFlowManagerFixture::createConjContracts(
+    const vector<string>& names,
+    const shared_ptr<L24Classifier>& classifier,
+    vector<shared_ptr<Contract> >& contracts,
+    unordered_set<uint32_t>& pvnids,
+    unordered_set<uint32_t>& cvnids) {
+    Mutator mutator(framework, policyOwner);
+    shared_ptr<EpGroup> epg5 = space->addGbpEpGroup("epg5");
+    epg5->addGbpeInstContext()->setEncapId(0xE0F);
+    epg5->addGbpEpGroupToNetworkRSrc()
+        ->setTargetRoutingDomain(rd0->getURI());
+    for (const string& name : names) {
+        shared_ptr<Contract> con = space->addGbpContract(name);
+        con->addGbpSubject(name + "_subject1")->addGbpRule(name + "_rule1")
+            ->setDirection(DirectionEnumT::CONST_IN).setOrder(100)
+            .addGbpRuleToClassifierRSrc(classifier->getURI().toString());
+        for (auto& epg : {epg0, epg1, epg2})
+            epg->addGbpEpGroupToProvContractRSrc(con->getURI().toString());
+        for (auto& epg : {epg3, epg4, epg5})
+            epg->addGbpEpGroupToConsContractRSrc(con->getURI().toString());
+        contracts.push_back(con);
+    }
+    mutator.commit();
+
+    PolicyManager::uri_set_t egs;
+    for (auto& con : contracts) {
+        WAIT_FOR_DO(egs.size() == 3, 1000, egs.clear();
+                    policyMgr.getContractProviders(con->getURI(), egs));
+        egs.clear();
+        WAIT_FOR_DO(egs.size() == 3, 500, egs.clear();
+                    policyMgr.getContractConsumers(con->getURI(), egs));
+        egs.clear();
+    }
+    WAIT_FOR(policyMgr.getVnidForGroup(epg5->getURI()), 500);
+
+    for (auto& epg : {epg0, epg1, epg2})
+        pvnids.insert(policyMgr.getVnidForGroup(epg->getURI()).get());
+    for (auto& epg : {epg3, epg4, epg5})
+        cvnids.insert(policyMgr.getVnidForGroup(epg->getURI()).get());
+}
+
+std::set<uint32_t> BaseIntFlowManagerFixture::initExpConjContracts(
+    const vector<URI>& contracts,
+    const shared_ptr<L24Classifier>& classifier,
+    uint8_t nClauses,
+    const unordered_set<uint32_t>& pvnids,
+    const unordered_set<uint32_t>& cvnids) {
+    uint16_t prio = PolicyManager::MAX_POLICY_RULE_PRIORITY;
+    uint32_t cookie = intFlowManager.getId(classifier->getClassId(),
+                                           classifier->getURI());
+    std::set<uint32_t> conjIds;
+    for (const URI& c : contracts) {
+        uint32_t conjId =
+            idGen.getIdNoAlloc("conjunction",
+                               c.toString() + "|" + std::to_string(cookie) +
+                               "|" + std::to_string(prio) + "|in");
+        BOOST_REQUIRE(conjId != uint32_t(-1));
+        conjIds.insert(conjId);
+        ADDF(Bldr(SEND_FLOW_REM).table(POL).priority(prio)
+             .cookie(cookie).isConjId(conjId)
+             .actions().go(STAT).done());
+    }
+
+    /* the group clause flows are shared by all the contracts */
+    for (uint32_t cvnid : cvnids) {
+        Bldr b;
+        b.table(POL).priority(prio).reg(SEPG, cvnid);
+        initExpConjClause(b, conjIds, 0, nClauses);
+    }
+    for (uint32_t pvnid : pvnids) {
+        Bldr b;
+        b.table(POL).priority(prio).reg(DEPG, pvnid);
+        initExpConjClause(b, conjIds, 1, nClauses);
+    }
+    return conjIds;
+}
+
+void BaseIntFlowManagerFixture::initExpConjClause(
+    Bldr& b, const std::set<uint32_t>& conjIds,
+    uint8_t clause, uint8_t nClauses) {
+    b.actions();
+    for (uint32_t conjId : conjIds)
+        b.conjunction(conjId, clause, nClauses);
+    ADDF(b.done());
+}
+
 // Initialize flows related to IP address mapping/NAT
 void BaseIntFlowManagerFixture::initExpIpMapping(bool natEpgMap, bool nextHop) {
     uint8_t rmacArr[6];
@@ -3513,6 +4002,9 @@ void BaseIntFlowManagerFixture::initExpLBService(Service &as1,
 
 
     bool statsEnabled = !intFlowManager.getServiceStatsFlowDisabled();
+    // aggregated stats only count the targets with the cookies of
+    // the next hop and reverse flows
+    bool statsDetailed = !intFlowManager.getServiceStatsAggregated();
 
     uint64_t rxCookie1 = 0;
     uint64_t txCookie1 = 0;
@@ -3520,11 +4012,13 @@ void BaseIntFlowManagerFixture::initExpLBService(Service &as1,
     uint64_t txCookie2 = 0;
     if (statsEnabled) {
         if (!exposed) {
-            initExpPodServiceStats("169.254.169.254", ep0, as1, "udp", 53, 5353);
-            initExpPodServiceStats("169.254.169.254", ep2, as1, "udp", 53, 5353);
-            initExpPodServiceStats("169.254.169.254", ep3, as1, "udp", 53, 5353);
-            initExpPodServiceStats("169.254.169.254", ep4, as1, "udp", 53, 5353);
-            initExpPodServiceStats("fe80::a9:fe:a9:fe", ep0, as2, "tcp", 80, 80);
+            if (statsDetailed) {
+                initExpPodServiceStats("169.254.169.254", ep0, as1, "udp", 53, 5353);
+                initExpPodServiceStats("169.254.169.254", ep2, as1, "udp", 53, 5353);
+                initExpPodServiceStats("169.254.169.254", ep3, as1, "udp", 53, 5353);
+                initExpPodServiceStats("169.254.169.254", ep4, as1, "udp", 53, 5353);
+                initExpPodServiceStats("fe80::a9:fe:a9:fe", ep0, as2, "tcp", 80, 80);
+            }
 
             const string& anyToSvcKey1 = "antosvc:svc-tgt:"+as1.getUUID()+":10.20.44.2";
             const string& svcToAnyKey1 = "svctoan:svc-tgt:"+as1.getUUID()+":10.20.44.2";
@@ -3548,8 +4042,10 @@ void BaseIntFlowManagerFixture::initExpLBService(Service &as1,
             rxCookie2 = idGen.getIdNoAlloc("svcstats", anyToSvcKey2);
             txCookie2 = idGen.getIdNoAlloc("svcstats", svcToAnyKey2);
 
-            initExpAnySvcStats("10.20.44.2", 5353, as1.getUUID(), rxCookie1, txCookie1);
-            initExpAnySvcStats("2001:db8::2", 80, as2.getUUID(), rxCookie2, txCookie2);
+            if (statsDetailed) {
+                initExpAnySvcStats("10.20.44.2", 5353, as1.getUUID(), rxCookie1, txCookie1);
+                initExpAnySvcStats("2001:db8::2", 80, as2.getUUID(), rxCookie2, txCookie2);
+            }
 
             const string& nodeToSvcKey = "notosvc:svc-nod:"+as1.getUUID()+":10.20.44.2";
             const string& svcToNodeKey = "svctono:svc-nod:"+as1.getUUID()+":10.20.44.2";
@@ -4639,4 +5135,213 @@ BOOST_FIXTURE_TEST_CASE(testdropflowconfig, BaseIntFlowManagerFixture) {
     stop();
 }
 
+BOOST_FIXTURE_TEST_CASE(routeAggregation, VxlanIntFlowManagerFixture) {
+    intFlowManager.setRouteAggregation(true);
+    setConnected();
+    intFlowManager.egDomainUpdated(epg0->getURI());
+    intFlowManager.domainUpdated(RoutingDomain::CLASS_ID, rd0->getURI());
+
+    // the two sibling /24 subnets merge into a /23
+    initExpStatic();
+    initExpEpg(epg0);
+    initExpBd();
+    initExpRd(1, false, false);
+    ADDF(Bldr().table(RT).priority(323)
+         .ip().reg(RD, 1).isIpDst("10.20.44.0/23")
+         .actions().mdAct(opflexagent::flow::meta::out::TUNNEL)
+         .go(STAT).done());
+    ADDF(Bldr().table(RT).priority(332)
+         .ipv6().reg(RD, 1).isIpv6Dst("2001:db8::/32")
+         .actions().mdAct(opflexagent::flow::meta::out::TUNNEL)
+         .go(STAT).done());
+    initExpEp(ep0, epg0);
+    initExpEp(ep2, epg0);
+    WAIT_FOR_TABLES("aggregated", 500);
+}
+
+BOOST_FIXTURE_TEST_CASE(stagedSync, VxlanIntFlowManagerFixture) {
+    FlowEntryList flows;
+    FlowBuilder().table(STAT).priority(100)
+        .action().go(OUT).parent().build(flows);
+    FlowBuilder().table(STAT).priority(10)
+        .action().go(OUT).parent().build(flows);
+    FlowBuilder().table(RT).priority(0)
+        .cookie(opflexagent::flow::cookie::TABLE_DROP_FLOW)
+        .action().go(IntFlowManager::EXP_DROP_TABLE_ID).parent()
+        .build(flows);
+    auto isDeferred = [&](int table, size_t flow) {
+        return intFlowManager.
+            isDeferredSyncEdit(table, FlowEdit::Entry(FlowEdit::ADD,
+                                                      flows[flow]));
+    };
+
+    BOOST_CHECK(!isDeferred(IntFlowManager::STATS_TABLE_ID, 0));
+
+    intFlowManager.setStagedSync(true);
+    // stats flows above the static forwarding flow are written last
+    BOOST_CHECK(isDeferred(IntFlowManager::STATS_TABLE_ID, 0));
+    BOOST_CHECK(!isDeferred(IntFlowManager::STATS_TABLE_ID, 1));
+    // so are the drop counting flows at the end of each table
+    BOOST_CHECK(isDeferred(IntFlowManager::ROUTE_TABLE_ID, 2));
+    BOOST_CHECK(!isDeferred(IntFlowManager::ROUTE_TABLE_ID, 0));
+    BOOST_CHECK(isDeferred(IntFlowManager::EXP_DROP_TABLE_ID, 1));
+}
+
+BOOST_FIXTURE_TEST_CASE(serviceSelectGroups, VxlanIntFlowManagerFixture) {
+    intFlowManager.setServiceSelectGroups(true);
+    setConnected();
+    intFlowManager.egDomainUpdated(epg0->getURI());
+    intFlowManager.domainUpdated(RoutingDomain::CLASS_ID, rd0->getURI());
+
+    Service as;
+    as.setUUID("ed84daef-1696-4b98-8c80-6b22d85f4dc2");
+    as.setDomainURI(URI(rd0->getURI()));
+    as.setServiceMode(Service::LOADBALANCER);
+    Service::ServiceMapping sm;
+    sm.setServiceIP("169.254.169.254");
+    sm.setServiceProto("udp");
+    sm.setServicePort(53);
+    sm.addNextHopIP("10.20.44.2");
+    sm.addNextHopIP("169.254.169.2");
+    sm.setNextHopWeight("169.254.169.2", 3);
+    as.addServiceMapping(sm);
+
+    // a bucket per next hop sets its link and resubmits to the next
+    // hop table
+    string ge_svc("group_id=2147483649,type=select");
+    boost::format bktFormat(",bucket=bucket_id:%1%,weight:%2%,"
+                            "actions=load:0x%1$x->NXM_NX_REG7[],"
+                            "resubmit(,%3%)");
+    auto bkt = [&](uint32_t link, uint16_t weight) {
+        return (bktFormat % link % weight
+                % (int)IntFlowManager::SERVICE_NEXTHOP_TABLE_ID).str();
+    };
+
+    exec.Clear();
+    exec.ExpectGroup(FlowEdit::ADD, ge_svc + bkt(1, 1) + bkt(2, 3));
+    servSrc.updateService(as);
+    WAIT_FOR(exec.IsGroupEmpty(), 500);
+
+    // the remaining next hop keeps its bucket when the others change
+    as.clearServiceMappings();
+    Service::ServiceMapping sm2;
+    sm2.setServiceIP("169.254.169.254");
+    sm2.setServiceProto("udp");
+    sm2.setServicePort(53);
+    sm2.addNextHopIP("169.254.169.2");
+    sm2.setNextHopWeight("169.254.169.2", 3);
+    sm2.addNextHopIP("169.254.169.3");
+    as.addServiceMapping(sm2);
+    exec.Clear();
+    exec.ExpectGroup(FlowEdit::MOD, ge_svc + bkt(2, 3) + bkt(3, 1));
+    servSrc.updateService(as);
+    WAIT_FOR(exec.IsGroupEmpty(), 500);
+
+    exec.Clear();
+    exec.ExpectGroup(FlowEdit::DEL, ge_svc);
+    servSrc.removeService(as.getUUID());
+    WAIT_FOR(exec.IsGroupEmpty(), 500);
+}
+
+static void setDropSampling(Agent& agent, double probability) {
+    PacketDropLogConfig cfg(URIBuilder().addElement("PolicyUniverse")
+                            .addElement("ObserverDropLogConfig").build());
+    cfg.sampling.tables["Int-POL_TABLE"] = probability;
+    agent.getExtraConfigManager().packetDropLogConfigUpdated(cfg);
+}
+
+/* the buckets of a drop sampling group that logs weight/10000 drops */
+static string dropSampleBuckets(uint16_t weight) {
+    return (boost::format(",bucket=bucket_id:0,weight:%1%,"
+                          "actions=resubmit(,%2%)"
+                          ",bucket=bucket_id:1,weight:%3%,actions=drop")
+            % weight % (int)EXP_DROPLOG % (10000 - weight)).str();
+}
+
+static bool hasGroupEdit(const GroupEdit& ge, const string& exp) {
+    for (const GroupEdit::Entry& e : ge.edits) {
+        std::stringstream ss;
+        ss << e;
+        if (ss.str() == exp) return true;
+    }
+    return false;
+}
+
+BOOST_FIXTURE_TEST_CASE(tableDropSampling, VxlanIntFlowManagerFixture) {
+    setConnected();
+    WAIT_FOR(exec.executedFlowEdits > 0 && !switchManager.isSyncing(), 500);
+    setDropSampling(agent, 1);
+
+    uint32_t gid = flowutils::DROP_SAMPLE_GROUP_BASE + POL;
+    string ge_smpl("group_id=" + std::to_string(gid) + ",type=select");
+
+    // a fraction of the drops go through the sampling group
+    exec.Clear();
+    exec.ExpectGroup(FlowEdit::ADD, ge_smpl + dropSampleBuckets(2500));
+    exec.Expect(FlowEdit::MOD, Bldr().table(POL)
+                .cookie(ovs_ntohll(opflexagent::flow::cookie::TABLE_DROP_FLOW))
+                .flags(OFPUTIL_FF_SEND_FLOW_REM).priority(0)
+                .actions().dropLog(POL).group(gid).done());
+    setDropSampling(agent, 0.25);
+    WAIT_FOR(exec.IsGroupEmpty(), 500);
+    WAIT_FOR(exec.IsEmpty(), 500);
+
+    // a new fraction only changes the group
+    exec.Clear();
+    exec.ExpectGroup(FlowEdit::MOD, ge_smpl + dropSampleBuckets(5000));
+    setDropSampling(agent, 0.5);
+    WAIT_FOR(exec.IsGroupEmpty(), 500);
+
+    // none of the drops are logged, but they are still counted
+    exec.Clear();
+    exec.Expect(FlowEdit::MOD, Bldr().table(POL)
+                .cookie(ovs_ntohll(opflexagent::flow::cookie::TABLE_DROP_FLOW))
+                .flags(OFPUTIL_FF_SEND_FLOW_REM).priority(0)
+                .actions().drop().done());
+    exec.ExpectGroup(FlowEdit::DEL, "group_id=" + std::to_string(gid) +
+                     ",type=all");
+    setDropSampling(agent, 0);
+    WAIT_FOR(exec.IsEmpty(), 500);
+    WAIT_FOR(exec.IsGroupEmpty(), 500);
+
+    // every drop goes to the drop table again
+    exec.Clear();
+    exec.Expect(FlowEdit::MOD, Bldr().table(POL)
+                .cookie(ovs_ntohll(opflexagent::flow::cookie::TABLE_DROP_FLOW))
+                .flags(OFPUTIL_FF_SEND_FLOW_REM).priority(0)
+                .actions().dropLog(POL).go(EXP_DROPLOG).done());
+    setDropSampling(agent, 1);
+    WAIT_FOR(exec.IsEmpty(), 500);
+}
+
+BOOST_FIXTURE_TEST_CASE(tableDropSamplingReconcile, VxlanIntFlowManagerFixture) {
+    setDropSampling(agent, 0.25);
+
+    uint32_t gid = flowutils::DROP_SAMPLE_GROUP_BASE + POL;
+    string ge_smpl("group_id=" + std::to_string(gid) + ",type=select");
+    SwitchStateHandler::GroupMap recvGroups;
+
+    // a missing group is added
+    GroupEdit ge = intFlowManager.reconcileGroups(recvGroups);
+    BOOST_CHECK(hasGroupEdit(ge, "ADD|" + ge_smpl + dropSampleBuckets(2500)));
+
+    // a matching group is kept and an unknown one is removed
+    recvGroups[gid] = flowutils::drop_sample_group(OFPGC11_ADD, POL,
+                                                   EXP_DROPLOG, 0.25);
+    recvGroups[4242] = flowutils::drop_sample_group(OFPGC11_ADD, POL,
+                                                    EXP_DROPLOG, 0.25);
+    recvGroups[4242]->mod->group_id = 4242;
+    ge = intFlowManager.reconcileGroups(recvGroups);
+    for (const GroupEdit::Entry& e : ge.edits)
+        BOOST_CHECK(e->mod->group_id != gid);
+    BOOST_CHECK(hasGroupEdit(ge, "DEL|group_id=4242,type=all"));
+
+    // a group with a stale fraction is corrected
+    recvGroups.clear();
+    recvGroups[gid] = flowutils::drop_sample_group(OFPGC11_ADD, POL,
+                                                   EXP_DROPLOG, 0.5);
+    ge = intFlowManager.reconcileGroups(recvGroups);
+    BOOST_CHECK(hasGroupEdit(ge, "MOD|" + ge_smpl + dropSampleBuckets(2500)));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -249,6 +249,47 @@ BOOST_FIXTURE_TEST_CASE(testUnsupportedCounters, InterfaceStatsManagerFixture) {
     statsManager.stop();
 }
 
+BOOST_FIXTURE_TEST_CASE(useOvsdbStats, InterfaceStatsManagerFixture) {
+    MockConnection integrationPortConn(TEST_CONN_TYPE_INT);
+    MockConnection accessPortConn(TEST_CONN_TYPE_ACC);
+    statsManager.registerConnection(&integrationPortConn, &accessPortConn);
+    statsManager.setOvsdbStats(true);
+    statsManager.start();
+
+    std::unordered_map<std::string, uint64_t> intStats =
+        {{"rx_packets", 1}, {"tx_packets", 2}, {"rx_bytes", 3},
+         {"tx_bytes", 4}, {"rx_dropped", 5}, {"tx_dropped", 6},
+         {"collisions", 7}};
+    std::unordered_map<std::string, uint64_t> accessStats =
+        {{"rx_packets", 10}, {"tx_packets", 20}, {"rx_bytes", 30},
+         {"tx_bytes", 40}, {"rx_dropped", 50}, {"tx_dropped", 60}};
+    statsManager.interfaceStatsUpdated("ep0-int", intStats);
+    statsManager.interfaceStatsUpdated("ep0-acc", accessStats);
+
+    auto rxPackets = [this]() -> uint64_t {
+        optional<shared_ptr<EpStatUniverse> > su =
+            EpStatUniverse::resolve(framework);
+        if (!su)
+            return 0;
+        optional<shared_ptr<modelgbp::gbpe::EpCounter> > counter =
+            su.get()->resolveGbpeEpCounter("0-0-0-0");
+        return counter ? counter.get()->getRxPackets(0) : 0;
+    };
+    // the counters are updated on the next timer tick
+    WAIT_FOR(rxPackets() == 10, 500);
+    uint64_t expected[6] = { 10, 20, 30, 40, 55, 66 };
+    verifyCounters(expected, 1);
+
+    // a change to one of the interfaces alone updates the endpoint
+    // with the last counters of the other
+    accessStats["rx_packets"] = 11;
+    statsManager.interfaceStatsUpdated("ep0-int", intStats);
+    statsManager.interfaceStatsUpdated("ep0-acc", accessStats);
+    WAIT_FOR(rxPackets() == 11, 500);
+
+    statsManager.stop();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }
@@ -43,10 +43,12 @@ static string canonicalizeGroupEntryStr(const string& entryStr) {
 }
 
 MockFlowExecutor::MockFlowExecutor()
-    : ignoreFlowMods(true), ignoreGroupMods(true), ignoreTlvMods(true) {}
+    : ignoreFlowMods(true), ignoreGroupMods(true), ignoreTlvMods(true),
+      executedFlowEdits(0) {}
 
 bool MockFlowExecutor::Execute(const FlowEdit& flowEdits) {
     std::lock_guard<std::mutex> guard(flow_mod_mutex);
+    if (!flowEdits.edits.empty()) executedFlowEdits++;
     if (ignoreFlowMods) return true;
 
     FlowEdit editCopy = flowEdits;
@@ -100,6 +102,23 @@ bool MockFlowExecutor::Execute(const GroupEdit& groupEdits) {
     }
     return true;
 }
+bool MockFlowExecutor::Execute(const GroupEdit& before,
+                               const FlowEdit& flowEdits,
+                               const GroupEdit& after) {
+    bool success = Execute(before);
+    success = Execute(flowEdits) && success;
+    return Execute(after) && success;
+}
+
+bool MockFlowExecutor::ExecuteAsync(const GroupEdit& before,
+                                    const FlowEdit& flowEdits,
+                                    const GroupEdit& after,
+                                    const Completion& done) {
+    bool success = Execute(before, flowEdits, after);
+    done(success ? 0 : EINVAL);
+    return success;
+}
+
 bool MockFlowExecutor::Execute(const TlvEdit& TlvEdits) {
     if (ignoreTlvMods) return true;
 
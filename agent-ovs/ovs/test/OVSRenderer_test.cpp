@@ -0,0 +1,69 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Test suite for class OVSRenderer
+ *
+ * Copyright (c) 2014 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <opflexagent/test/BaseFixture.h>
+#include <OVSRenderer.h>
+
+namespace opflexagent {
+
+using boost::property_tree::ptree;
+
+BOOST_AUTO_TEST_SUITE(OVSRenderer_test)
+
+BOOST_FIXTURE_TEST_CASE(reload, BaseFixture) {
+    static const char* INTERVALS[] = {
+        "statistics.interface.interval",
+        "statistics.contract.interval",
+        "statistics.service.interval",
+        "statistics.security-group.interval",
+        "statistics.table-drop.interval"
+    };
+
+    OVSRenderer renderer(agent);
+    ptree props;
+    for (const char* path : INTERVALS)
+        props.put(path, 10000);
+    props.put("statistics.interface.ovsdb", false);
+    renderer.setProperties(props);
+
+    // a changed interval is applied in place
+    for (const char* path : INTERVALS) {
+        ptree changed = props;
+        changed.put(path, 5000);
+        BOOST_CHECK_MESSAGE(renderer.reloadProperties(changed), path);
+        BOOST_CHECK(renderer.reloadProperties(props));
+    }
+
+    // an interval that disables or enables a stats manager needs a
+    // restart
+    for (const char* path : INTERVALS) {
+        ptree disabled = props;
+        disabled.put(path, 0);
+        BOOST_CHECK_MESSAGE(!renderer.reloadProperties(disabled), path);
+
+        OVSRenderer off(agent);
+        off.setProperties(disabled);
+        BOOST_CHECK_MESSAGE(!off.reloadProperties(props), path);
+    }
+
+    // so does any other change
+    ptree other = props;
+    other.put("statistics.interface.ovsdb", true);
+    BOOST_CHECK(!renderer.reloadProperties(other));
+    BOOST_CHECK(renderer.reloadProperties(props));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace opflexagent */
@@ -110,6 +110,236 @@ BOOST_FIXTURE_TEST_CASE( verify_connect, OvsdbConnectionFixture ) {
 
     conn->stop();
 }
+
+class StatsListener : public OvsdbStatsListener {
+public:
+    virtual void interfaceStatsUpdated(const string& name,
+                                       const unordered_map<string, uint64_t>& s) {
+        stats[name] = s;
+    }
+
+    virtual void interfaceStatsRemoved(const string& name) {
+        stats.erase(name);
+    }
+
+    unordered_map<string, unordered_map<string, uint64_t>> stats;
+};
+
+BOOST_FIXTURE_TEST_CASE( verify_interface_stats, OvsdbConnectionFixture ) {
+    StatsListener listener;
+    conn->setStatsListener(&listener);
+    conn->start();
+    conn->connect();
+    conn->sendMonitorRequests();
+
+    // the statistics monitor is sent after the seven others
+    Document payload;
+    payload.Parse("{\"Interface\":{\"be01b633-ff0c-4b3a-b1af-09506068fe27\":{\"new\":{\"name\":\"veth25\",\"statistics\":[\"map\",[[\"rx_bytes\",1200],[\"rx_packets\",12],[\"tx_dropped\",1]]]}},\"177160de-af8b-4666-99de-e1221040bd55\":{\"new\":{\"name\":\"veth19-1\",\"statistics\":[\"map\",[]]}}}}");
+    conn->handleMonitor(8, payload);
+    BOOST_REQUIRE_EQUAL(2, listener.stats.size());
+    BOOST_CHECK_EQUAL(1200, listener.stats["veth25"]["rx_bytes"]);
+    BOOST_CHECK_EQUAL(12, listener.stats["veth25"]["rx_packets"]);
+    BOOST_CHECK_EQUAL(1, listener.stats["veth25"]["tx_dropped"]);
+    BOOST_CHECK(listener.stats["veth19-1"].empty());
+
+    // updates of the interface state are not statistics
+    payload.GetAllocator().Clear();
+    payload.Parse(interfaceMonitorUpdate.c_str());
+    conn->handleUpdate(payload);
+    BOOST_CHECK_EQUAL(2, listener.stats.size());
+
+    payload.GetAllocator().Clear();
+    payload.Parse("[\"Interface-statistics\",{\"Interface\":{\"be01b633-ff0c-4b3a-b1af-09506068fe27\":{\"new\":{\"name\":\"veth25\",\"statistics\":[\"map\",[[\"rx_bytes\",2400],[\"rx_packets\",24]]]},\"old\":{\"statistics\":[\"map\",[[\"rx_bytes\",1200],[\"rx_packets\",12],[\"tx_dropped\",1]]]}},\"177160de-af8b-4666-99de-e1221040bd55\":{\"old\":{\"name\":\"veth19-1\",\"statistics\":[\"map\",[]]}}}}]");
+    conn->handleUpdate(payload);
+    BOOST_REQUIRE_EQUAL(1, listener.stats.size());
+    BOOST_CHECK_EQUAL(2400, listener.stats["veth25"]["rx_bytes"]);
+    BOOST_CHECK_EQUAL(0, listener.stats["veth25"].count("tx_dropped"));
+
+    conn->stop();
+}
+
+BOOST_FIXTURE_TEST_CASE( verify_monitor_cond_since, OvsdbConnectionFixture ) {
+    auto* mock = static_cast<MockRpcConnection*>(conn.get());
+    conn->setBridgeNames({"br-int"});
+    conn->connect();
+    conn->sendMonitorRequests();
+
+    // the seven tables of the state are monitored conditionally,
+    // the bridges by name
+    BOOST_REQUIRE_EQUAL(7, mock->condMonitors.size());
+    BOOST_CHECK(mock->monitors.empty());
+    const string& bridgeReq = mock->condMonitors[0].second;
+    BOOST_CHECK(bridgeReq.find("\"where\":[[\"name\",\"==\",\"br-int\"]]") != string::npos);
+    BOOST_CHECK(bridgeReq.find("\"00000000-0000-0000-0000-000000000000\"") != string::npos);
+    BOOST_CHECK(mock->condMonitors[1].second.find("where") == string::npos);
+
+    Document payload;
+    payload.Parse("[false,\"txn1\",{\"Bridge\":{\"18368680-b320-458f-927c-3e8e87a75a7a\":{\"initial\":{\"name\":\"br-int\",\"ports\":[\"set\",[[\"uuid\",\"8a7ce194-ffe4-4f50-8f1b-ec2e29abef6c\"],[\"uuid\",\"79af9603-c805-4772-9b5d-56cc4c0aa02b\"]]],\"netflow\":[\"set\",[]],\"ipfix\":[\"set\",[]],\"mirrors\":[\"set\",[]]}}}}]");
+    conn->handleMonitorCondSince(mock->condMonitors[0].first, payload);
+    payload.GetAllocator().Clear();
+    payload.Parse("[false,\"txn1\",{\"Port\":{\"8a7ce194-ffe4-4f50-8f1b-ec2e29abef6c\":{\"initial\":{\"name\":\"veth25\",\"interfaces\":[\"uuid\",\"be01b633-ff0c-4b3a-b1af-09506068fe27\"],\"qos\":[\"set\",[]]}}}}]");
+    conn->handleMonitorCondSince(mock->condMonitors[1].first, payload);
+
+    string uuid;
+    conn->getOvsdbState().getBridgeUuid("br-int", uuid);
+    BOOST_CHECK_EQUAL("18368680-b320-458f-927c-3e8e87a75a7a", uuid);
+    uuid.clear();
+    conn->getOvsdbState().getUuidForName(OvsdbTable::PORT, "veth25", uuid);
+    BOOST_CHECK_EQUAL("8a7ce194-ffe4-4f50-8f1b-ec2e29abef6c", uuid);
+
+    // a modified set carries the elements added or removed
+    payload.GetAllocator().Clear();
+    payload.Parse("[\"Bridge\",\"txn2\",{\"Bridge\":{\"18368680-b320-458f-927c-3e8e87a75a7a\":{\"modify\":{\"ports\":[\"set\",[[\"uuid\",\"79af9603-c805-4772-9b5d-56cc4c0aa02b\"],[\"uuid\",\"e8a58da4-a1bb-4d3f-86f9-ab2a8a008c89\"]]]}}}}]");
+    conn->handleUpdate3(payload);
+    OvsdbRowDetails row;
+    BOOST_REQUIRE(conn->getOvsdbState().getRow(OvsdbTable::BRIDGE,
+                                               "18368680-b320-458f-927c-3e8e87a75a7a", row));
+    BOOST_CHECK_EQUAL("br-int", row["name"].getStringValue());
+    auto ports = row["ports"].getCollectionValue();
+    BOOST_CHECK_EQUAL(2, ports.size());
+    BOOST_CHECK_EQUAL(1, ports.count("8a7ce194-ffe4-4f50-8f1b-ec2e29abef6c"));
+    BOOST_CHECK_EQUAL(1, ports.count("e8a58da4-a1bb-4d3f-86f9-ab2a8a008c89"));
+
+    payload.GetAllocator().Clear();
+    payload.Parse("[\"Port\",\"txn2\",{\"Port\":{\"8a7ce194-ffe4-4f50-8f1b-ec2e29abef6c\":{\"delete\":null}}}]");
+    conn->handleUpdate3(payload);
+    uuid.clear();
+    conn->getOvsdbState().getUuidForName(OvsdbTable::PORT, "veth25", uuid);
+    BOOST_CHECK(uuid.empty());
+
+    // the state is kept across a reconnect, and the monitors resume
+    // from the last transaction
+    conn->disconnect();
+    conn->connect();
+    conn->sendMonitorRequests();
+    BOOST_REQUIRE_EQUAL(14, mock->condMonitors.size());
+    BOOST_CHECK(mock->condMonitors[7].second.find("\"txn2\"") != string::npos);
+    uuid.clear();
+    conn->getOvsdbState().getBridgeUuid("br-int", uuid);
+    BOOST_CHECK_EQUAL("18368680-b320-458f-927c-3e8e87a75a7a", uuid);
+
+    payload.GetAllocator().Clear();
+    payload.Parse("[true,\"txn3\",{\"Bridge\":{\"18368680-b320-458f-927c-3e8e87a75a7a\":{\"modify\":{\"name\":\"br-int2\"}}}}]");
+    conn->handleMonitorCondSince(mock->condMonitors[7].first, payload);
+    uuid.clear();
+    conn->getOvsdbState().getBridgeUuid("br-int", uuid);
+    BOOST_CHECK(uuid.empty());
+    conn->getOvsdbState().getBridgeUuid("br-int2", uuid);
+    BOOST_CHECK_EQUAL("18368680-b320-458f-927c-3e8e87a75a7a", uuid);
+
+    // without monitor_cond_since, the tables are monitored in full
+    payload.GetAllocator().Clear();
+    payload.Parse("{\"error\":\"unknown method\"}");
+    conn->handleMonitorError(mock->condMonitors[8].first, payload);
+    BOOST_REQUIRE_EQUAL(1, mock->monitors.size());
+    BOOST_CHECK(mock->monitors[0].second.find("\"Port\"") != string::npos);
+}
+
+static list<OvsdbTransactMessage> portTransaction(const string& name) {
+    OvsdbTransactMessage msg(OvsdbOperation::INSERT, OvsdbTable::PORT);
+    vector<OvsdbValue> values;
+    values.emplace_back(name);
+    OvsdbValues tdSet(values);
+    msg.rowData.emplace("name", tdSet);
+    msg.externalKey = make_pair("uuid-name", "port1");
+    return {msg};
+}
+
+static bool contains(const string& payload, const string& s) {
+    return payload.find(s) != string::npos;
+}
+
+BOOST_FIXTURE_TEST_CASE( verify_transact_window, OvsdbConnectionFixture ) {
+    auto* mock = static_cast<MockRpcConnection*>(conn.get());
+    conn->connect();
+    conn->setTransactWindow(1, 4);
+
+    for (int i = 0; i < 6; i++) {
+        conn->sendTransaction(portTransaction("veth" + to_string(i)));
+    }
+    // the window holds a single transact request
+    BOOST_REQUIRE_EQUAL(1, mock->transacts.size());
+    BOOST_CHECK(contains(mock->transacts[0].second, "\"veth0\""));
+
+    Document payload;
+    payload.Parse("[{\"uuid\":[\"uuid\",\"8a7ce194-ffe4-4f50-8f1b-ec2e29abef6c\"]}]");
+    conn->handleTransaction(mock->transacts[0].first, payload);
+
+    // the next four transactions share a transact request, each
+    // one with its own uuid-name
+    BOOST_REQUIRE_EQUAL(2, mock->transacts.size());
+    const string& batch = mock->transacts[1].second;
+    BOOST_CHECK(contains(batch, "\"veth1\""));
+    BOOST_CHECK(contains(batch, "\"veth4\""));
+    BOOST_CHECK(!contains(batch, "\"veth5\""));
+    BOOST_CHECK(contains(batch, "\"port1\""));
+    BOOST_CHECK(contains(batch, "\"port1_3\""));
+
+    // the third operation fails, so the other transactions of the
+    // batch are sent again one by one
+    Document errorPayload;
+    errorPayload.Parse("[{},{},{\"error\":\"constraint violation\"},null]");
+    conn->handleTransaction(mock->transacts[1].first, errorPayload);
+    BOOST_REQUIRE_EQUAL(3, mock->transacts.size());
+    BOOST_CHECK(contains(mock->transacts[2].second, "\"veth1\""));
+    BOOST_CHECK(!contains(mock->transacts[2].second, "\"veth2\""));
+
+    for (auto name : {"veth2", "veth4", "veth5"}) {
+        conn->handleTransaction(mock->transacts.back().first, payload);
+        BOOST_CHECK(contains(mock->transacts.back().second,
+                             string("\"") + name + "\""));
+    }
+    BOOST_CHECK_EQUAL(6, mock->transacts.size());
+}
+
+static list<OvsdbTransactMessage> rateTransaction(const string& name,
+                                                  uint64_t rate,
+                                                  bool withBurst) {
+    OvsdbTransactMessage msg(OvsdbOperation::UPDATE, OvsdbTable::INTERFACE);
+    msg.conditions.emplace("name", OvsdbFunction::EQ, name);
+    vector<OvsdbValue> values;
+    values.emplace_back(rate);
+    msg.rowData["ingress_policing_rate"] = OvsdbValues(values);
+    if (withBurst)
+        msg.rowData["ingress_policing_burst"] = OvsdbValues(values);
+    return {msg};
+}
+
+BOOST_FIXTURE_TEST_CASE( verify_transact_supersede, OvsdbConnectionFixture ) {
+    auto* mock = static_cast<MockRpcConnection*>(conn.get());
+    conn->connect();
+    conn->setTransactWindow(1, 16);
+
+    conn->sendTransaction(portTransaction("veth0"));
+    BOOST_REQUIRE_EQUAL(1, mock->transacts.size());
+
+    // queued behind the transaction in flight; the later updates of
+    // a row replace the updates of the same columns
+    conn->sendTransaction(rateTransaction("veth1", 1000, false));
+    conn->sendTransaction(rateTransaction("veth2", 2000, true));
+    conn->sendTransaction(rateTransaction("veth1", 3000, true));
+    conn->sendTransaction(rateTransaction("veth2", 4000, false));
+    // an insert into the table is not crossed
+    OvsdbTransactMessage insert(OvsdbOperation::INSERT, OvsdbTable::INTERFACE);
+    vector<OvsdbValue> values;
+    values.emplace_back(string("veth3"));
+    insert.rowData.emplace("name", OvsdbValues(values));
+    conn->sendTransaction({insert});
+    conn->sendTransaction(rateTransaction("veth1", 5000, true));
+
+    Document payload;
+    payload.Parse("[{\"uuid\":[\"uuid\",\"8a7ce194-ffe4-4f50-8f1b-ec2e29abef6c\"]}]");
+    conn->handleTransaction(mock->transacts[0].first, payload);
+    BOOST_REQUIRE_EQUAL(2, mock->transacts.size());
+    const string& batch = mock->transacts[1].second;
+    BOOST_CHECK(!contains(batch, "1000"));
+    // fewer columns than the update it follows
+    BOOST_CHECK(contains(batch, "2000"));
+    BOOST_CHECK(contains(batch, "3000"));
+    BOOST_CHECK(contains(batch, "4000"));
+    BOOST_CHECK(contains(batch, "5000"));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }
\ No newline at end of file
@@ -171,10 +171,12 @@ BOOST_FIXTURE_TEST_CASE(arp_test, PacketDecoderFixture) {
     std::string expected(" MAC=ff:ff:ff:ff:ff:ff:9e:72:a6:94:18:af:ARP ARP_SPA=13.0.0.3 ARP_TPA=13.0.0.5 ARP_OP=1");
     int ret = pktDecoder.decode(arp_buf, 74, p);
     BOOST_CHECK(ret == 0);
+    /* the log output is only formatted on demand */
+    BOOST_CHECK(p.parsedString.empty());
     std::string dropReason;
     pktLogger.getDropReason(p, dropReason);
     p.packetTuple.setField(0, dropReason);
-    BOOST_CHECK(p.parsedString == expected);
+    BOOST_CHECK(pktDecoder.formatLog(p) == expected);
     BOOST_CHECK(p.packetTuple == expectedTuple);
 }
 
@@ -188,7 +190,7 @@ BOOST_FIXTURE_TEST_CASE(icmp_test, PacketDecoderFixture) {
     std::string dropReason;
     pktLogger.getDropReason(p, dropReason);
     p.packetTuple.setField(0, dropReason);
-    BOOST_CHECK(p.parsedString == expected);
+    BOOST_CHECK(pktDecoder.formatLog(p) == expected);
     BOOST_CHECK(p.packetTuple == expectedTuple);
 }
 
@@ -202,7 +204,7 @@ BOOST_FIXTURE_TEST_CASE(tcp_test, PacketDecoderFixture) {
     std::string dropReason;
     pktLogger.getDropReason(p, dropReason);
     p.packetTuple.setField(0, dropReason);
-    BOOST_CHECK(p.parsedString == expected);
+    BOOST_CHECK(pktDecoder.formatLog(p) == expected);
     BOOST_CHECK(p.packetTuple == expectedTuple);
 }
 
@@ -216,7 +218,7 @@ BOOST_FIXTURE_TEST_CASE(udp_test, PacketDecoderFixture) {
     std::string dropReason;
     pktLogger.getDropReason(p, dropReason);
     p.packetTuple.setField(0, dropReason);
-    BOOST_CHECK(p.parsedString == expected);
+    BOOST_CHECK(pktDecoder.formatLog(p) == expected);
     BOOST_CHECK(p.packetTuple == expectedTuple);
 }
 
@@ -230,7 +232,7 @@ BOOST_FIXTURE_TEST_CASE(udp_over_v6_test, PacketDecoderFixture) {
     std::string dropReason;
     pktLogger.getDropReason(p, dropReason);
     p.packetTuple.setField(0, dropReason);
-    BOOST_CHECK(p.parsedString == expected);
+    BOOST_CHECK(pktDecoder.formatLog(p) == expected);
     BOOST_CHECK(p.packetTuple == expectedTuple);
 }
 
@@ -244,7 +246,7 @@ BOOST_FIXTURE_TEST_CASE(tcp_over_v6_test, PacketDecoderFixture) {
     std::string dropReason;
     pktLogger.getDropReason(p, dropReason);
     p.packetTuple.setField(0, dropReason);
-    BOOST_CHECK(p.parsedString == expected);
+    BOOST_CHECK(pktDecoder.formatLog(p) == expected);
     BOOST_CHECK(p.packetTuple == expectedTuple);
 }
 
@@ -258,7 +260,7 @@ BOOST_FIXTURE_TEST_CASE(ip_options_unrecognized_test, PacketDecoderFixture) {
     std::string dropReason;
     pktLogger.getDropReason(p, dropReason);
     p.packetTuple.setField(0, dropReason);
-    BOOST_CHECK(p.parsedString == expected);
+    BOOST_CHECK(pktDecoder.formatLog(p) == expected);
     BOOST_CHECK(p.packetTuple == expectedTuple);
 }
 
@@ -344,4 +346,50 @@ BOOST_FIXTURE_TEST_CASE(user_prune_tests, PacketDecoderFixture) {
     pktLogger.pruneLog(p3);
     BOOST_CHECK(p3.pruneLog == true);
 }
+
+BOOST_FIXTURE_TEST_CASE(user_prune_sample, PacketDecoderFixture) {
+    auto pktDecoder = pktLogger.getDecoder();
+    std::shared_ptr<PacketFilterSpec> filt1(new PacketFilterSpec());
+    filt1->setField(TFLD_IP_PROTO,"6");
+    filt1->sampleInterval = 4;
+    pktLogger.updatePruneFilter("filt1",filt1);
+
+    // one of every four matching packets is logged anyway
+    for (int i = 1; i <= 8; i++) {
+        ParseInfo p(&pktDecoder);
+        int ret = pktDecoder.decode(tcp_buf, 106, p);
+        BOOST_CHECK(ret == 0);
+        pktLogger.pruneLog(p);
+        BOOST_CHECK_EQUAL(p.pruneLog, (i % 4) != 0);
+    }
+    BOOST_CHECK_EQUAL(6, pktLogger.getPrunedEventCount());
+
+    // packets the filter does not match are logged and not counted
+    ParseInfo p2(&pktDecoder);
+    int ret = pktDecoder.decode(udp_buf, 66, p2);
+    BOOST_CHECK(ret == 0);
+    pktLogger.pruneLog(p2);
+    BOOST_CHECK(p2.pruneLog == false);
+    BOOST_CHECK_EQUAL(6, pktLogger.getPrunedEventCount());
+}
+
+BOOST_AUTO_TEST_CASE(event_ring_full) {
+    opflexagent::IdGenerator idGen;
+    MockPacketLogHandler logger(io_1, io_2, idGen, 4);
+    logger.startListener();
+    logger.setNotifSock("/tmp/packet-event-test.sock");
+    std::vector<unsigned char> buf(arp_buf, arp_buf + sizeof(arp_buf));
+    for(int i = 0; i < 4; i++) {
+        logger.parseLog(buf.data(), buf.size());
+    }
+    BOOST_CHECK_EQUAL(0, logger.getDroppedEventCount());
+    BOOST_CHECK_EQUAL(0, logger.getSkippedEventCount());
+
+    /* Once the ring is full, only one in 16 packets is decoded */
+    for(int i = 0; i < 33; i++) {
+        logger.parseLog(buf.data(), buf.size());
+    }
+    BOOST_CHECK_EQUAL(3, logger.getDroppedEventCount());
+    BOOST_CHECK_EQUAL(30, logger.getSkippedEventCount());
+}
 BOOST_AUTO_TEST_SUITE_END()
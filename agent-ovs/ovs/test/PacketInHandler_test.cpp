@@ -22,6 +22,7 @@
 #include "MockSwitchManager.h"
 #include "IntFlowManager.h"
 #include "FlowConstants.h"
+#include "Packets.h"
 #include "udp.h"
 #include "dhcp.h"
 
@@ -692,6 +693,40 @@ BOOST_FIXTURE_TEST_CASE(dhcpv4_discover, PacketInHandlerFixture) {
     testDhcpv4Discover(intConn);
 }
 
+BOOST_FIXTURE_TEST_CASE(dhcpv4_discover_queued, PacketInHandlerFixture) {
+    setDhcpv4Config();
+    pktInHandler.registerConnection(&intConn, NULL);
+    pktInHandler.setQueueLimits(16, 0);
+    pktInHandler.start();
+
+    ofputil_packet_in_private pin;
+    init_packet_in(pin, &pkt_dhcpv4_discover, sizeof(pkt_dhcpv4_discover),
+                   opflexagent::flow::cookie::DHCP_V4, IntFlowManager::SEC_TABLE_ID,
+                   80);
+    OfpBuf b(ofputil_encode_packet_in_private(&pin,
+                                              OFPUTIL_P_OF13_OXM,
+                                              OFPUTIL_PACKET_IN_NXT));
+
+    // the reply is sent from the worker of the DHCP queue
+    pktInHandler.Handle(&intConn, OFPTYPE_PACKET_IN, b.get());
+    WAIT_FOR(intConn.getSentMsgCount() == 1, 500);
+    verify_dhcpv4(intConn.getSentMsg(0), opflexagent::dhcp::message_type::OFFER);
+    pktInHandler.stop();
+
+    // past the rate limit, packet-ins are dropped and counted
+    intConn.clear();
+    pktInHandler.setQueueLimits(16, 1);
+    pktInHandler.start();
+    pktInHandler.Handle(&intConn, OFPTYPE_PACKET_IN, b.get());
+    pktInHandler.Handle(&intConn, OFPTYPE_PACKET_IN, b.get());
+    WAIT_FOR(intConn.getSentMsgCount() == 1, 500);
+    BOOST_CHECK_EQUAL(1,
+        pktInHandler.getDropCount(PacketInHandler::PKTIN_DHCP));
+    BOOST_CHECK_EQUAL(0,
+        pktInHandler.getDropCount(PacketInHandler::PKTIN_DNS));
+    pktInHandler.stop();
+}
+
 BOOST_FIXTURE_TEST_CASE(dhcpv4_request, PacketInHandlerFixture) {
     setDhcpv4Config();
 
@@ -735,6 +770,63 @@ BOOST_FIXTURE_TEST_CASE(dhcpv4_request_inv, PacketInHandlerFixture) {
     verify_dhcpv4(intConn.getSentMsg(0), opflexagent::dhcp::message_type::NAK);
 }
 
+static void verify_dhcpv4_template(packets::Dhcpv4ReplyCache& cache,
+                                   const std::shared_ptr<const Endpoint>& ep,
+                                   uint8_t message_type,
+                                   uint32_t xid) {
+    const Endpoint::DHCPv4Config& v4c = *ep->getDHCPv4Config();
+    const uint8_t serverMac[6] = {0x00, 0x22, 0xbd, 0xf8, 0x19, 0xff};
+    uint8_t clientMac[6];
+    ep->getMAC()->toUIntArray(clientMac);
+    uint32_t clientIp =
+        address_v4::from_string(v4c.getIpAddress().get()).to_ulong();
+
+    OfpBuf reply(cache.compose(ep, message_type, xid, serverMac, clientMac,
+                               clientIp, 24));
+    OfpBuf expected(packets::compose_dhcpv4_reply(message_type, xid,
+                                                  serverMac, clientMac,
+                                                  clientIp, 24,
+                                                  v4c.getServerIp(),
+                                                  v4c.getRouters(),
+                                                  v4c.getDnsServers(),
+                                                  v4c.getDomain(),
+                                                  v4c.getStaticRoutes(),
+                                                  v4c.getInterfaceMtu(),
+                                                  v4c.getLeaseTime()));
+    BOOST_REQUIRE_EQUAL(expected.size(), reply.size());
+    BOOST_CHECK(0 == memcmp(expected.data(), reply.data(), reply.size()));
+}
+
+BOOST_FIXTURE_TEST_CASE(dhcpv4_reply_template, PacketInHandlerFixture) {
+    using namespace opflexagent::dhcp;
+
+    setDhcpv4Config();
+    std::shared_ptr<const Endpoint> ep =
+        agent.getEndpointManager().getEndpoint(ep0->getUUID());
+    BOOST_REQUIRE(ep);
+
+    // replies stamped out from the template match composed replies
+    packets::Dhcpv4ReplyCache cache;
+    for (uint8_t message_type : {message_type::OFFER,
+                                 message_type::ACK,
+                                 message_type::NAK}) {
+        for (uint32_t xid : {0u, 0x12345678u, 0xdeadbeefu})
+            verify_dhcpv4_template(cache, ep, message_type, xid);
+    }
+    BOOST_CHECK_EQUAL(1, cache.size());
+
+    // an updated endpoint gets a new template
+    Endpoint::DHCPv4Config c(*ep->getDHCPv4Config());
+    c.setInterfaceMtu(9000);
+    c.setLeaseTime(3600);
+    Endpoint updated(*ep);
+    updated.setDHCPv4Config(c);
+    std::shared_ptr<const Endpoint> ep2 =
+        std::make_shared<const Endpoint>(updated);
+    verify_dhcpv4_template(cache, ep2, message_type::ACK, 0x42);
+    BOOST_CHECK_EQUAL(1, cache.size());
+}
+
 BOOST_FIXTURE_TEST_CASE(dhcpv6_noconfig, PacketInHandlerFixture) {
     ofputil_packet_in_private pin;
     init_packet_in(pin, &pkt_dhcpv6_solicit, sizeof(pkt_dhcpv6_solicit),
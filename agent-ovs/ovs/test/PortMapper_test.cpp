@@ -10,6 +10,8 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <set>
+
 #include "SwitchConnection.h"
 #include "PortMapper.h"
 #include "ovs-ofputil.h"
@@ -58,9 +60,11 @@ public:
     void portStatusUpdate(const string& portName, uint32_t portNo, bool) {
         lastPortName = portName;
         lastPortNo = portNo;
+        updated.insert(portName);
     }
     string lastPortName;
     uint32_t lastPortNo;
+    std::set<string> updated;
 };
 
 class PortMapperFixture {
@@ -229,4 +233,30 @@ BOOST_FIXTURE_TEST_CASE(portstatus_listener, PortMapperFixture) {
     BOOST_CHECK_EQUAL(psl.lastPortNo, 15);
 }
 
+BOOST_FIXTURE_TEST_CASE(portdesc_listener_changes, PortMapperFixture) {
+    MockListener psl;
+    pm.registerPortStatusListener(&psl);
+
+    pm.Connected(&conn);
+    auto reply = MakeReplyMsg(0, 3, false);
+    BOOST_REQUIRE(reply.get());
+    Received(pm, reply);
+    BOOST_CHECK_EQUAL(3, psl.updated.size());
+
+    /* after a reconnect only the ports that changed are notified */
+    psl.updated.clear();
+    ports[1].port_no = 99;
+    pm.Connected(&conn);
+    reply = MakeReplyMsg(1, 4, false);
+    BOOST_REQUIRE(reply.get());
+    Received(pm, reply);
+    BOOST_CHECK(psl.updated ==
+                std::set<string>({"test-port-5", "test-port-10",
+                                  "test-port-20"}));
+    BOOST_CHECK(pm.FindPort("test-port-5") == OFPP_NONE);
+    BOOST_CHECK(pm.FindPort("test-port-10") == 99);
+    BOOST_CHECK_EQUAL(pm.FindPort(99), "test-port-10");
+    BOOST_CHECK_THROW(pm.FindPort(10), std::out_of_range);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
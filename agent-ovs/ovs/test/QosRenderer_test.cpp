@@ -112,6 +112,39 @@ bool verifyCreateDestroy(Agent& agent, const shared_ptr<QosRenderer>& qosRendere
 BOOST_FIXTURE_TEST_CASE( verify_createdestroy, QosRendererFixture ) {
     BOOST_CHECK_EQUAL(true, verifyCreateDestroy(agent, qosRenderer, conn));
 }
+
+BOOST_FIXTURE_TEST_CASE( verify_unchanged, QosRendererFixture ) {
+    auto* mock = static_cast<MockRpcConnection*>(conn.get());
+    conn->setTransactWindow(100, 1);
+    shared_ptr<QosConfigState> qosConfig =
+        make_shared<QosConfigState>(URI("/PolicyUniverse/PolicySpace/test/"
+                                        "QosBandwidthLimit/bw/"), "bw");
+    qosConfig->setRate(1000);
+    qosConfig->setBurst(9000);
+    const string interface("intf1");
+
+    size_t sent = mock->transacts.size();
+    qosRenderer->egressQosUpdated(interface, qosConfig);
+    qosRenderer->ingressQosUpdated(interface, qosConfig);
+    BOOST_REQUIRE_EQUAL(sent + 2, mock->transacts.size());
+    // the old qos of the port is replaced in the same transaction
+    const string& ingress = mock->transacts.back().second;
+    BOOST_CHECK(ingress.find("\"delete\"") != string::npos);
+    BOOST_CHECK(ingress.find("\"insert\"") != string::npos);
+
+    // updates that change nothing are not sent
+    qosRenderer->egressQosUpdated(interface, qosConfig);
+    qosRenderer->ingressQosUpdated(interface, qosConfig);
+    BOOST_CHECK_EQUAL(sent + 2, mock->transacts.size());
+
+    qosConfig->setRate(2000);
+    qosRenderer->egressQosUpdated(interface, qosConfig);
+    BOOST_CHECK_EQUAL(sent + 3, mock->transacts.size());
+
+    // both directions are cleared in one transaction
+    qosRenderer->qosDeleted(interface);
+    BOOST_CHECK_EQUAL(sent + 4, mock->transacts.size());
+}
 BOOST_AUTO_TEST_SUITE_END()
 
 }
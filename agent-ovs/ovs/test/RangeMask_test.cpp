@@ -72,4 +72,33 @@ BOOST_AUTO_TEST_CASE(range) {
             (0x07c0, 0xfff0));
 }
 
+BOOST_AUTO_TEST_CASE(cache) {
+    // the memoized decompositions match, including after the ranges
+    // sharing their cache entries were decomposed
+    for (int i = 0; i < 2; ++i) {
+        for (uint32_t start = 0; start < 2048; start += 7) {
+            uint16_t end = start + 1000;
+            MaskList ml;
+            RangeMask::getMasks(uint16_t(start), end, ml);
+            uint32_t covered = 0;
+            for (const Mask& m : ml)
+                covered += (uint16_t)~m.second + 1;
+            BOOST_CHECK_EQUAL(1001, covered);
+        }
+    }
+    expect(6, 15,
+        list_of<Mask>(0x0006, 0xfffe)(0x0008, 0xfff8));
+}
+
+BOOST_AUTO_TEST_CASE(clauses) {
+    MaskList one, two, three;
+    RangeMask::getMasks(80, 80, one);
+    RangeMask::getMasks(6, 11, two);
+    RangeMask::getMasks(6, 13, three);
+    BOOST_CHECK(!RangeMask::clausesCheaper(one, three));
+    BOOST_CHECK(!RangeMask::clausesCheaper(two, two));
+    BOOST_CHECK(RangeMask::clausesCheaper(two, three));
+    BOOST_CHECK(RangeMask::clausesCheaper(three, three));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -298,6 +298,72 @@ BOOST_FIXTURE_TEST_CASE(testFlowRemoved, SecGrpStatsManagerFixture) {
     secGrpStatsManager.stop();
 }
 
+BOOST_FIXTURE_TEST_CASE(testFlowRemovedBatch, SecGrpStatsManagerFixture) {
+    MockConnection accPortConn(TEST_CONN_TYPE_ACC);
+    secGrpStatsManager.registerConnection(&accPortConn);
+    secGrpStatsManager.start();
+
+    FlowEntryList entryList;
+    writeClassifierFlows(entryList,
+                         AccessFlowManager::SEC_GROUP_IN_TABLE_ID,
+                         1,
+                         classifier3);
+    FlowEntryList entryList1;
+    writeClassifierFlows(entryList1,
+                         AccessFlowManager::SEC_GROUP_OUT_TABLE_ID,
+                         1,
+                         classifier3);
+
+    boost::system::error_code ec;
+    ec = make_error_code(boost::system::errc::success);
+    secGrpStatsManager.on_timer(ec);
+
+    // the same messages as testFlowRemoved, handed over in batches
+    std::vector<ofpbuf*> msgs;
+    std::vector<struct ofputil_flow_removed> fentries(4);
+    auto handleBatch = [&](size_t begin, size_t end) {
+        FlowRemovedBatch batch;
+        for (size_t i = begin; i < end; ++i) {
+            SwitchConnection::DecodeFlowRemoved(msgs[i], &fentries[i]);
+            batch.emplace_back(msgs[i], &fentries[i]);
+        }
+        secGrpStatsManager.HandleFlowRemoved(&accPortConn, batch);
+    };
+    for (int i = 0; i < 2; ++i)
+        msgs.push_back(makeFlowRemovedMessage_2(&accPortConn,
+                           LAST_PACKET_COUNT,
+                           AccessFlowManager::SEC_GROUP_IN_TABLE_ID,
+                           entryList));
+    for (int i = 0; i < 2; ++i)
+        msgs.push_back(makeFlowRemovedMessage_2(&accPortConn,
+                           LAST_PACKET_COUNT,
+                           AccessFlowManager::SEC_GROUP_OUT_TABLE_ID,
+                           entryList1));
+    for (ofpbuf* msg : msgs)
+        BOOST_REQUIRE(msg != 0);
+
+    handleBatch(0, 1);
+    secGrpStatsManager.on_timer(ec);
+    handleBatch(1, 4);
+    secGrpStatsManager.on_timer(ec);
+    for (ofpbuf* msg : msgs)
+        ofpbuf_delete(msg);
+
+    verifyFlowStats(classifier3,
+                    LAST_PACKET_COUNT,
+                    LAST_PACKET_COUNT * PACKET_SIZE,
+                    true,
+                    AccessFlowManager::SEC_GROUP_IN_TABLE_ID,
+                    &secGrpStatsManager);
+    verifyFlowStats(classifier3,
+                    LAST_PACKET_COUNT,
+                    LAST_PACKET_COUNT * PACKET_SIZE,
+                    false,
+                    AccessFlowManager::SEC_GROUP_OUT_TABLE_ID,
+                    &secGrpStatsManager);
+    secGrpStatsManager.stop();
+}
+
 BOOST_FIXTURE_TEST_CASE(testCircularBuffer, SecGrpStatsManagerFixture) {
     MockConnection accPortConn(TEST_CONN_TYPE_ACC);
     secGrpStatsManager.registerConnection(&accPortConn);
@@ -90,7 +90,7 @@ public:
         mirrorDetail["uuid"] = OvsdbValue(uuid);
         const string mirrorName("abc");
         mirrorDetail["name"] = OvsdbValue(mirrorName);
-        mirrorDetail["out_port"] = OvsdbValue(erspanPortUuid);
+        mirrorDetail["output_port"] = OvsdbValue(erspanPortUuid);
         map<string, string> srcPorts;
         srcPorts[p1PortUuid];
         srcPorts[p2PortUuid];
@@ -106,7 +106,7 @@ public:
         mirrorDetail2["uuid"] = OvsdbValue(uuid);
         const string mirrorName2("ugh-vspan");
         mirrorDetail2["name"] = OvsdbValue(mirrorName2);
-        mirrorDetail2["out_port"] = OvsdbValue(erspanPortUuid2);
+        mirrorDetail2["output_port"] = OvsdbValue(erspanPortUuid2);
         mirrorDetail2["select_src_port"] = OvsdbValue(Dtype::SET, "set", srcPorts);
         mirrorDetail2["select_dst_port"] = OvsdbValue(Dtype::SET, "set", dstPorts);
         mirrorDetails[uuid] = mirrorDetail2;
@@ -286,6 +286,68 @@ BOOST_FIXTURE_TEST_CASE( verify_get_erspan_params, SpanRendererFixture ) {
     spr->updateMirrorConfig(sessionState);
 }
 
+BOOST_FIXTURE_TEST_CASE( verify_incremental_update, SpanRendererFixture ) {
+    auto* mock = static_cast<MockRpcConnection*>(conn.get());
+    conn->setTransactWindow(100, 1);
+
+    auto pu = policy::Universe::resolve(framework).get();
+    auto su = span::Universe::resolve(framework).get();
+    Mutator mutator(framework, "policyreg");
+    auto space = pu->addPolicySpace("test");
+    auto bd = space->addGbpBridgeDomain("bd");
+    auto session = su->addSpanSession("ugh-vspan");
+    session->setState(platform::AdminStateEnumT::CONST_ON);
+    auto dstGrp1 = session->addSpanDstGrp("DstGrp1");
+    // the output port of the mirror in OVSDB
+    auto dstMem1 = dstGrp1->addSpanDstMember(ERSPAN_PORT_PREFIX + "test");
+    auto dstSumm1 = dstMem1->addSpanDstSummary();
+    dstSumm1->setDest("99.99.99.12");
+    dstSumm1->setVersion(2);
+    dstSumm1->setFlowId(5);
+    auto localEp = session->addSpanLocalEp("p1-tap");
+    localEp->setName("p1-tap");
+    auto localEp2 = session->addSpanLocalEp("p2-tap");
+    localEp2->setName("p2-tap");
+    mutator.commit();
+
+    auto epr = epr::L2Universe::resolve(framework).get();
+    Mutator mutator2(framework, "policyelement");
+    auto l2Ep = epr->addEprL2Ep(bd->getURI().toString(),
+                                MAC("aa:bb:cc:dd:01:01"));
+    l2Ep->setInterfaceName("p1-tap");
+    auto l2Ep2 = epr->addEprL2Ep(bd->getURI().toString(),
+                                 MAC("aa:bb:cc:dd:01:02"));
+    l2Ep2->setInterfaceName("p2-tap");
+    mutator2.commit();
+    WAIT_FOR(agent.getSpanManager().getSessionState(session->getURI()), 500);
+
+    {
+        lock_guard <recursive_mutex> guard(SpanManager::updates);
+        agent.getSpanManager().addEndpoint(localEp, l2Ep,
+                                           DirectionEnumT::CONST_IN);
+        agent.getSpanManager().addEndpoint(localEp2, l2Ep2,
+                                           DirectionEnumT::CONST_BIDIRECTIONAL);
+    }
+    size_t sent = mock->transacts.size();
+    spr->spanUpdated(session->getURI());
+
+    // p1-tap is no longer a source port, and the mirror is changed
+    // in place rather than rewritten
+    bool mutated = false;
+    for (size_t i = sent; i < mock->transacts.size(); ++i) {
+        const string& t = mock->transacts[i].second;
+        BOOST_CHECK(t.find("\"insert\"") == string::npos);
+        BOOST_CHECK(t.find("\"update\"") == string::npos ||
+                    t.find("\"Mirror\"") == string::npos);
+        if (t.find("\"mutate\"") != string::npos &&
+            t.find("\"select_src_port\",\"delete\"") != string::npos &&
+            t.find("0a7a4d65-e785-4674-a219-167391d10c3f") != string::npos &&
+            t.find("select_dst_port") == string::npos)
+            mutated = true;
+    }
+    BOOST_CHECK(mutated);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }
@@ -0,0 +1,108 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Test suite for class SwitchManager
+ *
+ * Copyright (c) 2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <opflexagent/test/ModbFixture.h>
+#include "MockSwitchManager.h"
+#include "FlowBuilder.h"
+
+namespace opflexagent {
+
+using std::vector;
+
+/**
+ * Record the priorities of the flow changes in each write
+ */
+class RecordingFlowExecutor : public MockFlowExecutor {
+public:
+    virtual bool Execute(const FlowEdit& flowEdits) {
+        if (flowEdits.edits.empty()) return true;
+        vector<uint16_t> prios;
+        for (const FlowEdit::Entry& e : flowEdits.edits)
+            prios.push_back(e.second->entry->priority);
+        writes.push_back(prios);
+        return true;
+    }
+    using MockFlowExecutor::Execute;
+
+    vector<vector<uint16_t> > writes;
+};
+
+class SwitchManagerFixture : public ModbFixture {
+public:
+    SwitchManagerFixture()
+        : switchManager(agent, exec, reader, portmapper) {
+        switchManager.setMaxFlowTables(1);
+        switchManager.start("placeholder");
+    }
+
+    ~SwitchManagerFixture() {
+        switchManager.stop();
+    }
+
+    void writeFlow(const std::string& objId, uint16_t prio) {
+        FlowBuilder fb;
+        fb.priority(prio).inPort(prio);
+        switchManager.writeFlow(objId, 0, fb);
+    }
+
+    RecordingFlowExecutor exec;
+    MockFlowReader reader;
+    MockPortMapper portmapper;
+    MockSwitchManager switchManager;
+};
+
+BOOST_AUTO_TEST_SUITE(SwitchManager_test)
+
+BOOST_FIXTURE_TEST_CASE(batch, SwitchManagerFixture) {
+    switchManager.beginBatch();
+    writeFlow("a", 1);
+    switchManager.beginBatch();
+    writeFlow("b", 2);
+    // the changes are only sent when the outermost batch ends
+    BOOST_CHECK(switchManager.endBatch());
+    writeFlow("c", 3);
+    BOOST_CHECK(exec.writes.empty());
+    BOOST_CHECK(switchManager.endBatch());
+
+    BOOST_REQUIRE_EQUAL(1, exec.writes.size());
+    BOOST_CHECK((exec.writes[0] == vector<uint16_t>{1, 2, 3}));
+
+    writeFlow("d", 4);
+    BOOST_REQUIRE_EQUAL(2, exec.writes.size());
+    BOOST_CHECK((exec.writes[1] == vector<uint16_t>{4}));
+}
+
+BOOST_FIXTURE_TEST_CASE(batch_other_thread, SwitchManagerFixture) {
+    switchManager.beginBatch();
+    writeFlow("a", 1);
+
+    // a write from another thread does not wait for the batch, and
+    // sends the changes collected so far first
+    std::thread other([this]() { writeFlow("b", 2); });
+    other.join();
+    BOOST_REQUIRE_EQUAL(2, exec.writes.size());
+    BOOST_CHECK((exec.writes[0] == vector<uint16_t>{1}));
+    BOOST_CHECK((exec.writes[1] == vector<uint16_t>{2}));
+
+    writeFlow("c", 3);
+    BOOST_CHECK(switchManager.endBatch());
+    BOOST_REQUIRE_EQUAL(3, exec.writes.size());
+    BOOST_CHECK((exec.writes[2] == vector<uint16_t>{3}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace opflexagent */
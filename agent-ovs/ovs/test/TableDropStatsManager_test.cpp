@@ -9,6 +9,8 @@
  */
 
 #include <sstream>
+#include <utility>
+#include <vector>
 #include <boost/test/unit_test.hpp>
 #include <boost/assign/list_of.hpp>
 #include <boost/optional.hpp>
@@ -53,6 +55,20 @@ public:
         std::lock_guard<mutex> lock(txnMtx);
         txns.insert(txn_id);
     }
+
+    size_t testTxnCount() {
+        std::lock_guard<mutex> lock(txnMtx);
+        return txns.size();
+    }
+
+    // get the transaction ID of a pending request for every table
+    bool testAllTableTxnId(uint32_t& txn_id) {
+        std::lock_guard<mutex> lock(txnMtx);
+        if (allTableTxns.empty())
+            return false;
+        txn_id = *allTableTxns.begin();
+        return true;
+    }
 };
 
 class MockAccessTableDropStatsManager : public BaseTableDropStatsManager {
@@ -178,8 +194,53 @@ public:
                                  uint64_t exp_byte_count,
                                  const std::string &bridgeName,
                                  const std::string &tableName);
+
+    /**
+     * Make a reply to a flow stats request for every table, holding
+     * the given flows of each table
+     */
+    struct ofpbuf *makeAllTablesReplyMessage(uint32_t xid,
+             uint32_t packet_count,
+             const std::vector<std::pair<uint32_t, FlowEntryList> >& tables);
 };
 
+struct ofpbuf *TableDropStatsManagerFixture::makeAllTablesReplyMessage(
+        uint32_t xid, uint32_t packet_count,
+        const std::vector<std::pair<uint32_t, FlowEntryList> >& tables) {
+    struct ofputil_flow_stats_request fsr;
+    bzero(&fsr, sizeof(struct ofputil_flow_stats_request));
+    fsr.table_id = OFPTT_ALL;
+    fsr.out_port = OFPP_ANY;
+    fsr.out_group = OFPG_ANY;
+    enum ofputil_protocol proto =
+        ofputil_protocol_from_ofp_version((ofp_version)OFP13_VERSION);
+    struct ofpbuf *req_msg = ofputil_encode_flow_stats_request(&fsr, proto);
+    struct ofp_header *req_hdr = (ofp_header *)req_msg->data;
+    req_hdr->xid = xid;
+
+    ovs_list ovs_replies;
+    ofpmp_init(&ovs_replies, req_hdr);
+    ofpbuf_delete(req_msg);
+    for (const auto& table : tables) {
+        for (const FlowEntryPtr& fe : table.second) {
+            struct ofputil_flow_stats fs;
+            bzero(&fs, sizeof(struct ofputil_flow_stats));
+            fs.table_id = table.first;
+            fs.priority = fe->entry->priority;
+            fs.cookie = fe->entry->cookie;
+            fs.packet_count = packet_count;
+            fs.byte_count = PACKET_SIZE * packet_count;
+            fs.flags = fe->entry->flags;
+            fs.match = fe->entry->match;
+            ofputil_append_flow_stats_reply(&fs, &ovs_replies, NULL);
+        }
+    }
+    struct ofpbuf *reply = ofpbuf_from_list(ovs_list_back(&ovs_replies));
+    ofpmsg_update_length(reply);
+    reply->header = NULL;
+    return reply;
+}
+
 void TableDropStatsManagerFixture::checkPrometheusCounters(uint64_t exp_packet_count,
                              uint64_t exp_byte_count,
                              const std::string &bridgeName,
@@ -394,6 +455,57 @@ BOOST_FIXTURE_TEST_CASE(testStaticDropFlowsAcc, TableDropStatsManagerFixture) {
     tableDropStatsManager.stop();
 }
 
+BOOST_FIXTURE_TEST_CASE(testSingleRequestInt, TableDropStatsManagerFixture) {
+    start();
+    MockIntTableDropStatsManager& statsManager =
+        tableDropStatsManager.intTableDropStatsMgr;
+    statsManager.setSingleRequest(true);
+
+    // the drop flows of two tables, after a drop flow of a table
+    // without counters, which must not end the reply
+    std::vector<std::pair<uint32_t, FlowEntryList> > tables(3);
+    tables[0].first = 250;
+    createIntBridgeDropFlowList(IntFlowManager::SEC_TABLE_ID,
+                                tables[0].second);
+    tables[1].first = IntFlowManager::SEC_TABLE_ID;
+    createIntBridgeDropFlowList(IntFlowManager::SEC_TABLE_ID,
+                                tables[1].second);
+    tables[2].first = IntFlowManager::SRC_TABLE_ID;
+    createIntBridgeDropFlowList(IntFlowManager::SRC_TABLE_ID,
+                                tables[2].second);
+
+    boost::system::error_code ec =
+        make_error_code(boost::system::errc::success);
+    for (uint32_t count = INITIAL_PACKET_COUNT;
+         count <= INITIAL_PACKET_COUNT * 2; count += INITIAL_PACKET_COUNT) {
+        // one request covers every table
+        size_t pending = statsManager.testTxnCount();
+        statsManager.on_timer(ec);
+        BOOST_CHECK_EQUAL(pending + 1, statsManager.testTxnCount());
+        uint32_t xid;
+        BOOST_REQUIRE(statsManager.testAllTableTxnId(xid));
+
+        struct ofpbuf *res_msg =
+            makeAllTablesReplyMessage(xid, count, tables);
+        BOOST_REQUIRE(res_msg != 0);
+        statsManager.Handle(&intPortConn, OFPTYPE_FLOW_STATS_REPLY, res_msg);
+        ofpbuf_delete(res_msg);
+        BOOST_CHECK_EQUAL(pending, statsManager.testTxnCount());
+    }
+    statsManager.on_timer(ec);
+
+    // the counters stay per table
+    verifyDropFlowStats(INITIAL_PACKET_COUNT * 4,
+                        INITIAL_PACKET_COUNT * 4 * PACKET_SIZE,
+                        IntFlowManager::SEC_TABLE_ID, intPortConn,
+                        statsManager);
+    verifyDropFlowStats(INITIAL_PACKET_COUNT,
+                        INITIAL_PACKET_COUNT * PACKET_SIZE,
+                        IntFlowManager::SRC_TABLE_ID, intPortConn,
+                        statsManager);
+    tableDropStatsManager.stop();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }
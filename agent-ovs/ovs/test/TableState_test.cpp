@@ -15,6 +15,7 @@
 
 #include "TableState.h"
 #include "FlowBuilder.h"
+#include "ActionBuilder.h"
 #include <opflexagent/logging.h>
 
 #include "ovs-shim.h"
@@ -242,4 +243,199 @@ BOOST_FIXTURE_TEST_CASE(diff, TableStateFixture) {
     BOOST_CHECK(diffs.edits[2].second->matchEq(f3_1.get()));
 }
 
+BOOST_FIXTURE_TEST_CASE(findEqual, TableStateFixture) {
+    el.push_back(f1_1);
+    el.push_back(f3_1);
+    state.apply("test", el, diffs);
+
+    FlowEntryPtr f1_1copy(FlowBuilder().priority(1).inPort(5)
+                          .action().output(4)
+                          .parent().build());
+    BOOST_CHECK(state.findEqual(*f1_1copy) == f1_1);
+    BOOST_CHECK(!state.findEqual(*f1_2));
+    BOOST_CHECK(!state.findEqual(*f2_1));
+    BOOST_CHECK(!state.findEqual(*f3_2));
+
+    /* entries found in place of snapshot entries diff the same */
+    el.clear();
+    el.push_back(state.findEqual(*f1_1copy));
+    el.push_back(f2_1);
+    state.diffSnapshot(el, diffs);
+    std::sort(diffs.edits.begin(), diffs.edits.end());
+    BOOST_REQUIRE(2 == diffs.edits.size());
+    BOOST_CHECK_EQUAL(FlowEdit::ADD, diffs.edits[0].first);
+    BOOST_CHECK(diffs.edits[0].second->matchEq(f3_1.get()));
+    BOOST_CHECK_EQUAL(FlowEdit::DEL, diffs.edits[1].first);
+    BOOST_CHECK(diffs.edits[1].second->matchEq(f2_1.get()));
+}
+
+BOOST_FIXTURE_TEST_CASE(clear, TableStateFixture) {
+    state.clear("test", diffs);
+    BOOST_CHECK(diffs.edits.empty());
+
+    el.push_back(f1_1);
+    el.push_back(f2_1);
+    state.apply("test", el, diffs);
+    el.clear();
+    el.push_back(f1_2);
+    state.apply("other", el, diffs);
+    BOOST_CHECK(diffs.edits.empty());
+
+    // the queued flow of the other object takes over
+    state.clear("test", diffs);
+    std::sort(diffs.edits.begin(), diffs.edits.end());
+    BOOST_REQUIRE(2 == diffs.edits.size());
+    BOOST_CHECK_EQUAL(FlowEdit::MOD, diffs.edits[0].first);
+    BOOST_CHECK(diffs.edits[0].second->actionEq(f1_2.get()));
+    BOOST_CHECK_EQUAL(FlowEdit::DEL, diffs.edits[1].first);
+    BOOST_CHECK(diffs.edits[1].second->matchEq(f2_1.get()));
+
+    state.clear("test", diffs);
+    BOOST_CHECK(diffs.edits.empty());
+    state.clear("other", diffs);
+    BOOST_REQUIRE(1 == diffs.edits.size());
+    BOOST_CHECK_EQUAL(FlowEdit::DEL, diffs.edits[0].first);
+}
+
+BOOST_FIXTURE_TEST_CASE(contentHash, TableStateFixture) {
+    BOOST_CHECK_EQUAL(0, state.flowCount());
+    BOOST_CHECK_EQUAL(0, state.contentHash());
+
+    el.push_back(f1_1);
+    el.push_back(f2_1);
+    state.apply("test", el, diffs);
+    BOOST_CHECK_EQUAL(2, state.flowCount());
+    BOOST_CHECK_EQUAL(TableState::entryHash(*f1_1) +
+                      TableState::entryHash(*f2_1), state.contentHash());
+
+    uint64_t hash = 0;
+    BOOST_CHECK(state.findEqual(*f2_1, &hash) == f2_1);
+    BOOST_CHECK_EQUAL(TableState::entryHash(*f2_1), hash);
+
+    // changed actions and cookies change the hash
+    el.clear();
+    el.push_back(f1_2);
+    el.push_back(f2_2);
+    state.apply("test", el, diffs);
+    BOOST_CHECK_EQUAL(TableState::entryHash(*f1_2) +
+                      TableState::entryHash(*f2_2), state.contentHash());
+    BOOST_CHECK(TableState::entryHash(*f1_1) !=
+                TableState::entryHash(*f1_2));
+
+    // flows queued behind other objects count once they are in the
+    // table
+    el.clear();
+    el.push_back(f1_1);
+    state.apply("other", el, diffs);
+    BOOST_CHECK_EQUAL(2, state.flowCount());
+    state.clear("test", diffs);
+    BOOST_CHECK_EQUAL(1, state.flowCount());
+    BOOST_CHECK_EQUAL(TableState::entryHash(*f1_1), state.contentHash());
+    state.clear("other", diffs);
+    BOOST_CHECK_EQUAL(0, state.contentHash());
+}
+
+BOOST_FIXTURE_TEST_CASE(shared, TableStateFixture) {
+    FlowEntryPtr f4_1(FlowBuilder().priority(1).inPort(6)
+                      .action().output(4).parent().build());
+    el.push_back(f1_1);
+    el.push_back(f4_1);
+    state.apply("test", el, diffs);
+    BOOST_REQUIRE(2 == diffs.edits.size());
+    BOOST_CHECK(f1_1->sharedActions);
+    BOOST_CHECK(f1_1->entry->ofpacts == f4_1->entry->ofpacts);
+
+    TableState copy(state);
+    el.clear();
+    el.push_back(f1_1);
+    copy.apply("test", el, diffs);
+    BOOST_REQUIRE(1 == diffs.edits.size());
+    BOOST_CHECK_EQUAL(FlowEdit::DEL, diffs.edits[0].first);
+    BOOST_CHECK(diffs.edits[0].second->matchEq(f4_1.get()));
+
+    el.clear();
+    el.push_back(f1_2);
+    state.apply("conflict", el, diffs);
+    BOOST_REQUIRE(0 == diffs.edits.size());
+    el.clear();
+    state.apply("test", el, diffs);
+    BOOST_REQUIRE(2 == diffs.edits.size());
+}
+
+static GroupEdit::Entry makeGroup(uint16_t command,
+                                  const std::vector<uint32_t>& ports,
+                                  uint32_t changedPort = 0) {
+    GroupEdit::Entry entry(new GroupEdit::GroupMod());
+    entry->mod->command = command;
+    entry->mod->group_id = 1;
+    for (uint32_t port : ports) {
+        ofputil_bucket* bkt = (ofputil_bucket*)malloc(sizeof(ofputil_bucket));
+        bkt->weight = 0;
+        bkt->bucket_id = port;
+        bkt->watch_port = OFPP_ANY;
+        bkt->watch_group = OFPG_ANY;
+        ActionBuilder ab;
+        if (port == changedPort)
+            ab.decTtl();
+        ab.output(port).build(bkt);
+        ovs_list_push_back(&entry->mod->buckets, &bkt->list_node);
+    }
+    return entry;
+}
+
+static std::vector<uint32_t> bucketIds(const GroupEdit::Entry& entry) {
+    std::vector<uint32_t> ids;
+    ofputil_bucket* bkt;
+    LIST_FOR_EACH (bkt, list_node, &entry->mod->buckets) {
+        ids.push_back(bkt->bucket_id);
+    }
+    return ids;
+}
+
+BOOST_AUTO_TEST_CASE(bucketEdits) {
+    std::vector<uint32_t> ports {1, 2, 3, 4, 5, 6};
+    GroupEdit::Entry current = makeGroup(OFPGC11_ADD, ports);
+    GroupEdit::EntryList edits;
+
+    // same buckets in another order
+    BOOST_CHECK(GroupEdit::bucketEdits(current,
+                                       makeGroup(OFPGC11_MODIFY,
+                                                 {6, 5, 4, 3, 2, 1}),
+                                       edits));
+    BOOST_CHECK(edits.empty());
+
+    // a port added, a port removed and a port changed
+    GroupEdit::Entry target =
+        makeGroup(OFPGC11_MODIFY, {1, 2, 3, 5, 6, 7}, 6);
+    BOOST_CHECK(GroupEdit::bucketEdits(current, target, edits));
+    BOOST_REQUIRE_EQUAL(3, edits.size());
+    BOOST_CHECK_EQUAL(OFPGC15_REMOVE_BUCKET, edits[0]->mod->command);
+    BOOST_CHECK_EQUAL(6, edits[0]->mod->command_bucket_id);
+    BOOST_CHECK_EQUAL(OFPGC15_REMOVE_BUCKET, edits[1]->mod->command);
+    BOOST_CHECK_EQUAL(4, edits[1]->mod->command_bucket_id);
+    BOOST_CHECK_EQUAL(OFPGC15_INSERT_BUCKET, edits[2]->mod->command);
+    BOOST_CHECK_EQUAL(OFPG15_BUCKET_LAST, edits[2]->mod->command_bucket_id);
+    BOOST_CHECK(std::vector<uint32_t>({6, 7}) == bucketIds(edits[2]));
+    BOOST_CHECK(std::vector<uint32_t>({1, 2, 3, 5, 6, 7}) ==
+                bucketIds(target));
+
+    // too many changes, or not a modification
+    edits.clear();
+    BOOST_CHECK(!GroupEdit::bucketEdits(current,
+                                        makeGroup(OFPGC11_MODIFY,
+                                                  {1, 2, 7, 8}),
+                                        edits));
+    BOOST_CHECK(!GroupEdit::bucketEdits(current,
+                                        makeGroup(OFPGC11_ADD, ports),
+                                        edits));
+    BOOST_CHECK(!GroupEdit::bucketEdits(current,
+                                        makeGroup(OFPGC11_MODIFY, {}),
+                                        edits));
+    BOOST_CHECK(edits.empty());
+
+    GroupEdit::Entry copy = GroupEdit::clone(target);
+    BOOST_CHECK(GroupEdit::groupEq(copy, target));
+    BOOST_CHECK(copy->mod->buckets.next != target->mod->buckets.next);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -100,7 +100,7 @@ enum REG {
     SEPG, SEPG12, DEPG, BD, FD, FD12, RD, OUTPORT,
     SVCADDR1, SVCADDR2, SVCADDR3, SVCADDR4, CTMARK, TUNID, TUNSRC, TUNDST,
     VLAN, ETHSRC, ETHDST, ARPOP, ARPSHA, ARPTHA, ARPSPA, ARPTPA, METADATA,
-    PKT_MARK
+    PKT_MARK, EPDEST
 };
 
 enum FLAG {
@@ -220,6 +220,7 @@ public:
     Bldr& isPktMark(uint32_t mark) {
         m("pkt_mark", str(mark, true)); return *this;
     }
+    Bldr& isConjId(uint32_t id) { m("conj_id", str(id)); return *this; }
     Bldr& isSvcCookieEnabledNExposed(uint64_t c, bool enabled, bool exposed) {
         if (enabled && exposed)
             return cookie(c);
@@ -270,6 +271,11 @@ public:
     Bldr& out(REG r);
     Bldr& decTtl() { a("dec_ttl"); return *this; }
     Bldr& group(uint32_t g) { a("group", str(g)); return *this; }
+    Bldr& conjunction(uint32_t id, uint8_t clause, uint8_t nClauses) {
+        a() << "conjunction(" << id << "," << (clause + 1) << "/"
+            << int(nClauses) << ")";
+        return *this;
+    }
     Bldr& outPort(uint32_t p) { a("output", str(p)); return *this; }
     Bldr& pushVlan() { a("push_vlan:0x8100"); return *this; }
     Bldr& popVlan() { a("pop_vlan"); return *this; }
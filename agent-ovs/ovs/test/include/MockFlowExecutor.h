@@ -12,6 +12,7 @@
 
 #include "FlowExecutor.h"
 
+#include <atomic>
 #include <mutex>
 #include <string>
 #include <vector>
@@ -31,6 +32,13 @@ public:
     virtual bool Execute(const FlowEdit& flowEdits);
     virtual bool Execute(const GroupEdit& groupEdits);
     virtual bool Execute(const TlvEdit& tlvEdits);
+    virtual bool Execute(const GroupEdit& before, const FlowEdit& flowEdits,
+                         const GroupEdit& after);
+    using FlowExecutor::ExecuteAsync;
+    virtual bool ExecuteAsync(const GroupEdit& before,
+                              const FlowEdit& flowEdits,
+                              const GroupEdit& after,
+                              const Completion& done);
     virtual void Expect(FlowEdit::type mod, const std::string& fe);
     virtual void Expect(FlowEdit::type mod, const std::vector<std::string>& fe);
     virtual void Expect(TlvEdit::type mod, const std::string& te);
@@ -54,6 +62,8 @@ public:
     std::mutex flow_mod_mutex;
     bool ignoreGroupMods;
     bool ignoreTlvMods;
+    // number of non-empty flow edits executed, including ignored ones
+    std::atomic<size_t> executedFlowEdits;
 };
 
 } // namespace opflexagent
@@ -39,10 +39,12 @@ public:
     virtual void disconnect() { setConnected(false);}
 
     /**
-     * New messages are ready to be written to the socket.
-     * No-op with mock connection
+     * New messages are ready to be written to the socket.  Send the
+     * queued transactions right away with mock connection
      */
-    virtual void messagesReady() {};
+    virtual void messagesReady() {
+        flushTransactions();
+    };
 
     /**
      * destructor
@@ -62,10 +64,37 @@ public:
         std::unique_ptr<JsonRpcMessage> messagep(message);
         opflex::jsonrpc::PayloadWrapper wrapper(message);
         yajr::internal::GenericStringQueue<rapidjson::UTF8<> > sq;
-        ::yajr::rpc::SendHandler writer;
-        writer.Reset(sq);
+        ::yajr::rpc::SendHandler writer(sq);
         wrapper(writer);
+        if (message->getMethod() == "transact") {
+            transacts.emplace_back(message->getReqXid(),
+                                   std::string(sq.deque_.begin(),
+                                               sq.deque_.end()));
+        } else if (message->getMethod() == "monitor") {
+            monitors.emplace_back(message->getReqXid(),
+                                  std::string(sq.deque_.begin(),
+                                              sq.deque_.end()));
+        } else if (message->getMethod() == "monitor_cond_since") {
+            condMonitors.emplace_back(message->getReqXid(),
+                                      std::string(sq.deque_.begin(),
+                                                  sq.deque_.end()));
+        }
     }
+
+    /**
+     * request ID and payload of the transact requests sent
+     */
+    std::vector<std::pair<uint64_t, std::string>> transacts;
+
+    /**
+     * request ID and payload of the monitor requests sent
+     */
+    std::vector<std::pair<uint64_t, std::string>> monitors;
+
+    /**
+     * request ID and payload of the monitor_cond_since requests sent
+     */
+    std::vector<std::pair<uint64_t, std::string>> condMonitors;
 };
 
 }
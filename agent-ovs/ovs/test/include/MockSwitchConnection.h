@@ -46,6 +46,13 @@ public:
         return 0;
     }
 
+    virtual int SendMessages(std::vector<OfpBuf>& msgs) {
+        std::lock_guard<std::mutex> guard(sentMsgMutex);
+        for (OfpBuf& msg : msgs)
+            sentMsgs.push_back(std::move(msg));
+        return 0;
+    }
+
     virtual bool IsConnected() { return connected; }
 
     bool connected;
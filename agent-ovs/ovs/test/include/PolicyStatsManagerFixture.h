@@ -70,6 +70,11 @@ public:
         msg.reset();
         return 0;
     }
+    virtual int SendMessages(std::vector<OfpBuf>& msgs) {
+        for (OfpBuf& msg : msgs)
+            SendMessage(msg);
+        return 0;
+    }
     int GetProtocolVersion() { return OFP13_VERSION; }
 };
 
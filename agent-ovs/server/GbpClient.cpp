@@ -14,14 +14,15 @@
 #  include <config.h>
 #endif
 
-#include <rapidjson/stringbuffer.h>
-#include <rapidjson/prettywriter.h>
 #include <grpcpp/grpcpp.h>
 
 #include "gbp.grpc.pb.h"
 #include "GbpClient.h"
 #include <opflexagent/logging.h>
 
+#include <condition_variable>
+#include <deque>
+
 namespace opflexagent {
 
 using grpc::Channel;
@@ -37,156 +38,219 @@ using gbpserver::GBPObject;
 using gbpserver::Property;
 using gbpserver::Reference;
 
-using rapidjson::Document;
-using rapidjson::Value;
-using rapidjson::kObjectType;
-using rapidjson::kArrayType;
-using rapidjson::StringRef;
-using rapidjson::StringBuffer;
-using rapidjson::PrettyWriter;
-
 using opflex::gbp::PolicyUpdateOp;
+using opflex::gbp::PolicyObjectReader;
+using opflex::test::GbpOpflexServer;
+
+/**
+ * A policy object reader over the objects of a GBP operation, which
+ * refers to the strings of the operation rather than copying them
+ */
+class GbpObjectReader : public PolicyObjectReader {
+public:
+    GbpObjectReader(const GBPOperation& oper_)
+        : oper(oper_), pos(-1) {}
+
+    virtual bool next() override {
+        if (pos < oper.object_list_size())
+            pos += 1;
+        return pos < oper.object_list_size();
+    }
+    virtual const std::string& getSubject() const override {
+        return obj().subject();
+    }
+    virtual const std::string& getURI() const override {
+        return obj().uri();
+    }
+    virtual size_t getPropertyCount() const override {
+        return obj().properties_size();
+    }
+    virtual const std::string& getPropertyName(size_t i) const override {
+        return prop(i).name();
+    }
+    virtual prop_type_t getPropertyType(size_t i) const override {
+        switch (prop(i).value_case()) {
+        case Property::kStrVal:
+            return STRING;
+        case Property::kIntVal:
+            return INT;
+        case Property::kRefVal:
+            return REFERENCE;
+        default:
+            return NONE;
+        }
+    }
+    virtual const std::string& getString(size_t i) const override {
+        const Property& p = prop(i);
+        if (p.value_case() == Property::kRefVal)
+            return p.refval().reference_uri();
+        return p.strval();
+    }
+    virtual int64_t getInt(size_t i) const override {
+        return prop(i).intval();
+    }
+    virtual const std::string& getReferenceSubject(size_t i) const override {
+        return prop(i).refval().subject();
+    }
+    virtual size_t getChildCount() const override {
+        return obj().children_size();
+    }
+    virtual const std::string& getChild(size_t i) const override {
+        return obj().children(i);
+    }
+    virtual const std::string& getParentSubject() const override {
+        return obj().parent_subject();
+    }
+    virtual const std::string& getParentURI() const override {
+        return obj().parent_uri();
+    }
+    virtual const std::string& getParentRelation() const override {
+        return obj().parent_relation();
+    }
+
+private:
+    const GBPOperation& oper;
+    int pos;
+
+    const GBPObject& obj() const { return oper.object_list(pos); }
+    const Property& prop(size_t i) const { return obj().properties(i); }
+};
 
 class GbpClientImpl {
 public:
     GbpClientImpl(std::shared_ptr<Channel> channel,
-                  opflex::test::GbpOpflexServer& server) :
+                  opflex::test::GbpOpflexServer& server,
+                  std::atomic<int32_t>& version) :
         stub_(GBP::NewStub(channel)),
         server_(server),
-        stopping(false) {
+        version_(version),
+        stopping(false),
+        done(false) {
+        apply_thread_ = std::thread(&GbpClientImpl::ApplyOperations, this);
         thread_ = std::thread(&GbpClientImpl::ListObjects, this);
     }
 
-    void Wait() { thread_.join(); }
+    void Wait() {
+        thread_.join();
+        apply_thread_.join();
+    }
     void Stop() { stopping = true; }
 
 private:
-    static void JsonDump(Document& d) {
-        StringBuffer buffer;
-        buffer.Clear();
-
-        PrettyWriter<StringBuffer> writer(buffer);
-        d.Accept(writer);
-
-        LOG(DEBUG) << buffer.GetString();
-    }
-
-    static void JsonDocAdd(Document& d, const GBPObject& gbp) {
-        Document::AllocatorType& allocator = d.GetAllocator();
-        Value o(kObjectType);
-        int i;
-
-        o.AddMember("subject", StringRef(gbp.subject()), allocator);
-        o.AddMember("uri", StringRef(gbp.uri()), allocator);
-
-        Value p(kArrayType);
-        for (i = 0; i < gbp.properties_size(); i++) {
-            const Property& property = gbp.properties(i);
-            Value po(kObjectType);
-
-            po.AddMember("name", StringRef(property.name()), allocator);
-            switch (property.value_case()) {
-            case Property::kStrVal:
-                po.AddMember("data", StringRef(property.strval()), allocator);
-                break;
-            case Property::kIntVal:
-                po.AddMember("data", property.intval(), allocator);
-                break;
-            case Property::kRefVal:
-                {
-                    Value r(kObjectType);
-                    const Reference& reference = property.refval();
-                    r.AddMember("subject", StringRef(reference.subject()), allocator);
-                    r.AddMember("reference_uri", StringRef(reference.reference_uri()), allocator);
-                    po.AddMember("data", r, allocator);
-                break;
-                }
-            default:
-                continue;
-            }
-            p.PushBack(po, allocator);
-        }
-        if (p.Size()) {
-            o.AddMember("properties", p, allocator);
-        }
-
-        Value c(kArrayType);
-        for (i = 0; i < gbp.children_size(); i++) {
-             c.PushBack(StringRef(gbp.children(i)), allocator);
-        }
-        if (c.Size()) {
-            o.AddMember("children", c, allocator);
+    static bool GetOp(const GBPOperation& oper, PolicyUpdateOp& op) {
+        switch (oper.opcode()) {
+        case GBPOperation::ADD:
+            op = PolicyUpdateOp::ADD;
+            return true;
+        case GBPOperation::REPLACE:
+            op = PolicyUpdateOp::REPLACE;
+            return true;
+        case GBPOperation::DELETE:
+            op = PolicyUpdateOp::DELETE;
+            return true;
+        case GBPOperation::DELETE_RECURSIVE:
+            op = PolicyUpdateOp::DELETE_RECURSIVE;
+            return true;
+        default:
+            LOG(DEBUG) << "Unknown operation " << oper.opcode();
+            return false;
         }
-
-        if (gbp.parent_subject() != "")
-            o.AddMember("parent_subject", StringRef(gbp.parent_subject()), allocator);
-        if (gbp.parent_uri() != "")
-            o.AddMember("parent_uri", StringRef(gbp.parent_uri()), allocator);
-        if (gbp.parent_relation() != "")
-            o.AddMember("parent_relation", StringRef(gbp.parent_relation()), allocator);
-
-        d.PushBack(o, allocator);
     }
 
+    // Read the operations from the stream, resuming from the last
+    // version applied, and queue them to be applied
     void ListObjects() {
-        GBPOperation oper;
         ClientContext context;
         Version version;
-        Document jsonDoc;
 
-        jsonDoc.SetArray();
-        version.set_number(1);
+        version.set_number(version_);
+        LOG(INFO) << "Listing objects from version " << version.number();
         std::unique_ptr<ClientReader<GBPOperation> > reader(
             stub_->ListObjects(&context, version));
         // The read operation should block until data is available
+        GBPOperation oper;
         while (reader->Read(&oper)) {
             if (stopping)
-                return;
-            jsonDoc.Clear();
+                break;
             LOG(DEBUG) << "Operation " << oper.opcode()
                       << " of size " << oper.object_list_size();
-            for (int i = 0; i < oper.object_list_size(); i++) {
-                const GBPObject& object = oper.object_list(i);
-                JsonDocAdd(jsonDoc, object);
+            {
+                const std::lock_guard<std::mutex> lock(queue_mutex);
+                queue.emplace_back();
+                queue.back().Swap(&oper);
             }
-            JsonDump(jsonDoc);
-            PolicyUpdateOp op;
-            switch (oper.opcode()) {
-            case GBPOperation::ADD:
-                op = PolicyUpdateOp::ADD;
-                break;
-            case GBPOperation::REPLACE:
-                op = PolicyUpdateOp::REPLACE;
-                break;
-            case GBPOperation::DELETE:
-                op = PolicyUpdateOp::DELETE;
-                break;
-            case GBPOperation::DELETE_RECURSIVE:
-                op = PolicyUpdateOp::DELETE_RECURSIVE;
-                break;
-            default:
-                LOG(DEBUG) << "Unknown operation " << oper.opcode();
-                continue;
-            }
-            server_.updatePolicy(jsonDoc, op);
+            queue_cond.notify_one();
         }
+        if (stopping)
+            context.TryCancel();
         Status status = reader->Finish();
         if (status.ok()) {
             LOG(INFO) << "ListObjects rpc succeeded.";
         } else {
             LOG(INFO) << "ListObjects rpc failed.";
         }
+        {
+            const std::lock_guard<std::mutex> lock(queue_mutex);
+            done = true;
+        }
+        queue_cond.notify_one();
+    }
+
+    // Apply the operations queued while the previous batch was being
+    // applied as one batch, so that the subscriptions they affect
+    // are computed and updated once
+    void ApplyOperations() {
+        while (true) {
+            std::deque<GBPOperation> batch;
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex);
+                queue_cond.wait(lock, [this]() {
+                        return done || !queue.empty();
+                    });
+                if (queue.empty())
+                    return;
+                batch.swap(queue);
+            }
+            if (stopping)
+                return;
+
+            // The readers refer to the operations, which must outlive
+            // them
+            std::vector<GbpOpflexServer::policy_update_t> updates;
+            int32_t batchVersion = 0;
+            for (const GBPOperation& oper : batch) {
+                PolicyUpdateOp op;
+                if (oper.has_version() && oper.version().number() != 0)
+                    batchVersion = oper.version().number();
+                if (!GetOp(oper, op))
+                    continue;
+                updates.emplace_back(op, std::make_shared<GbpObjectReader>(oper));
+            }
+            if (!updates.empty())
+                server_.updatePolicy(updates);
+            if (batchVersion != 0) {
+                version_ = batchVersion;
+                LOG(DEBUG) << "Applied policy version " << batchVersion;
+            }
+        }
     }
 
     std::unique_ptr<GBP::Stub> stub_;
     std::thread thread_;
+    std::thread apply_thread_;
     opflex::test::GbpOpflexServer& server_;
-    bool stopping;
+    std::atomic<int32_t>& version_;
+    std::atomic<bool> stopping;
+
+    std::mutex queue_mutex;
+    std::condition_variable queue_cond;
+    std::deque<GBPOperation> queue;
+    bool done;
 };
 
 GbpClient::GbpClient(const std::string& address,
                      opflex::test::GbpOpflexServer& server) :
-    server_(server), stopping(false), client_(nullptr) {
+    server_(server), version(0), stopping(false), client_(nullptr) {
     thread_ = std::thread(&GbpClient::Start, this, address);
 }
 
@@ -203,7 +267,7 @@ void GbpClient::Start(const std::string& address) {
         GbpClientImpl client(
             grpc::CreateChannel(address,
                                 grpc::InsecureChannelCredentials()),
-                                server_);
+                                server_, version);
         {
             const std::lock_guard<std::mutex> lock(client_mutex);
             client_ = &client;
@@ -59,6 +59,18 @@ static string ofagent_family_help[] =
   "number of errors on state reports received from an opflex agent"
 };
 
+static string latency_family_names[] =
+{
+  "opflex_agent_keepalive_rtt_ms",
+  "opflex_agent_request_latency_ms"
+};
+
+static string latency_family_help[] =
+{
+  "round-trip time of keep-alive echoes to an opflex agent in milliseconds",
+  "latency of requests to an opflex agent per method in milliseconds"
+};
+
 // construct ServerPrometheusManager for opflex server
 ServerPrometheusManager::ServerPrometheusManager ()
                                  : PrometheusManager()
@@ -77,6 +89,17 @@ void ServerPrometheusManager::init ()
             gauge_ofagent_family_ptr[metric] = nullptr;
         }
     }
+
+    {
+        const lock_guard<mutex> lock(latency_mutex);
+        for (LATENCY_METRICS metric=LATENCY_METRICS_MIN;
+                metric <= LATENCY_METRICS_MAX;
+                    metric = LATENCY_METRICS(metric+1)) {
+            gauge_latency_bucket_family_ptr[metric] = nullptr;
+            gauge_latency_sum_family_ptr[metric] = nullptr;
+            gauge_latency_count_family_ptr[metric] = nullptr;
+        }
+    }
 }
 
 // create all gauge families during start
@@ -86,6 +109,11 @@ void ServerPrometheusManager::createStaticGaugeFamilies (void)
         const lock_guard<mutex> lock(ofagent_stats_mutex);
         createStaticGaugeFamiliesOFAgent();
     }
+
+    {
+        const lock_guard<mutex> lock(latency_mutex);
+        createStaticGaugeFamiliesLatency();
+    }
 }
 
 // Start of ServerPrometheusManager instance
@@ -150,6 +178,12 @@ void ServerPrometheusManager::removeStaticGaugeFamilies()
         const lock_guard<mutex> lock(ofagent_stats_mutex);
         removeStaticGaugeFamiliesOFAgent();
     }
+
+    // Latency histogram specific
+    {
+        const lock_guard<mutex> lock(latency_mutex);
+        removeStaticGaugeFamiliesLatency();
+    }
 }
 
 // remove all dynamic counters during stop
@@ -160,6 +194,12 @@ void ServerPrometheusManager::removeDynamicGauges ()
         const lock_guard<mutex> lock(ofagent_stats_mutex);
         removeDynamicGaugeOFAgent();
     }
+
+    // Remove latency histogram related gauges
+    {
+        const lock_guard<mutex> lock(latency_mutex);
+        removeDynamicGaugeLatency();
+    }
 }
 
 // create all OFAgent specific gauge families during start
@@ -182,180 +222,176 @@ void ServerPrometheusManager::createStaticGaugeFamiliesOFAgent (void)
     }
 }
 
-// Create OFAgentStats gauge given metric type, agent (IP,port) tuple
-void ServerPrometheusManager::createDynamicGaugeOFAgent (OFAGENT_METRICS metric,
-                                                       const string& agent)
+// Create the OFAgentStats gauges given agent (IP,port) tuple
+ServerPrometheusManager::ofagent_gauges_t*
+ServerPrometheusManager::createDynamicGaugeOFAgent (const string& agent)
 {
-    // Retrieve the Gauge if its already created
-    if (getDynamicGaugeOFAgent(metric, agent))
-        return;
+    // Retrieve the Gauges if they are already created
+    ofagent_gauges_t* pgauges = getDynamicGaugeOFAgent(agent);
+    if (pgauges)
+        return pgauges;
 
-    auto& gauge = gauge_ofagent_family_ptr[metric]->Add({{"agent", agent}});
-    if (gauge_check.is_dup(&gauge)) {
-        LOG(WARNING) << "duplicate ofagent dyn gauge family"
-                   << " metric: " << metric
-                   << " agent: " << agent;
-        return;
+    ofagent_gauges_t gauges;
+    for (OFAGENT_METRICS metric=OFAGENT_METRICS_MIN;
+            metric <= OFAGENT_METRICS_MAX;
+                metric = OFAGENT_METRICS(metric+1)) {
+        auto& gauge = gauge_ofagent_family_ptr[metric]->Add({{"agent", agent}});
+        if (gauge_check.is_dup(&gauge)) {
+            LOG(WARNING) << "duplicate ofagent dyn gauge family"
+                       << " metric: " << metric
+                       << " agent: " << agent;
+            // undo the gauges added so far
+            for (OFAGENT_METRICS m=OFAGENT_METRICS_MIN; m < metric;
+                     m = OFAGENT_METRICS(m+1)) {
+                gauge_check.remove(gauges.gauge[m]);
+                gauge_ofagent_family_ptr[m]->Remove(gauges.gauge[m]);
+            }
+            return nullptr;
+        }
+        gauge_check.add(&gauge);
+        gauges.gauge[metric] = &gauge;
     }
     LOG(DEBUG) << "created ofagent dyn gauge family"
-               << " metric: " << metric
                << " agent: " << agent;
-    gauge_check.add(&gauge);
-    ofagent_gauge_map[metric][agent] = &gauge;
+    return &ofagent_gauge_map.emplace(agent, gauges).first->second;
 }
 
-// Get OFAgent stats gauge given the metric, agent (IP,port) tuple
-Gauge * ServerPrometheusManager::getDynamicGaugeOFAgent (OFAGENT_METRICS metric,
-                                                       const string& agent)
+// Get OFAgent stats gauges given the agent (IP,port) tuple
+ServerPrometheusManager::ofagent_gauges_t*
+ServerPrometheusManager::getDynamicGaugeOFAgent (const string& agent)
 {
-    Gauge *pgauge = nullptr;
-    auto itr = ofagent_gauge_map[metric].find(agent);
-    if (itr == ofagent_gauge_map[metric].end()) {
+    auto itr = ofagent_gauge_map.find(agent);
+    if (itr == ofagent_gauge_map.end()) {
         LOG(TRACE) << "Dyn Gauge OFAgent stats not found"
-                   << " metric: " << metric
                    << " agent: " << agent;
-    } else {
-        pgauge = itr->second;
+        return nullptr;
     }
-
-    return pgauge;
+    return &itr->second;
 }
 
-// Remove dynamic OFAgentStats gauge given a metic type and agent (IP,port) tuple
-bool ServerPrometheusManager::removeDynamicGaugeOFAgent (OFAGENT_METRICS metric,
-                                                       const string& agent)
-{
-    Gauge *pgauge = getDynamicGaugeOFAgent(metric, agent);
-    if (pgauge) {
-        ofagent_gauge_map[metric].erase(agent);
-        gauge_check.remove(pgauge);
-        gauge_ofagent_family_ptr[metric]->Remove(pgauge);
-    } else {
-        LOG(DEBUG) << "remove dynamic gauge ofagent stats not found agent:" << agent;
-        return false;
-    }
-    return true;
-}
-
-// Remove dynamic OFAgentStats gauge given a metric type
-void ServerPrometheusManager::removeDynamicGaugeOFAgent (OFAGENT_METRICS metric)
-{
-    auto itr = ofagent_gauge_map[metric].begin();
-    while (itr != ofagent_gauge_map[metric].end()) {
-        LOG(DEBUG) << "Delete OFAgent stats agent: " << itr->first
-                   << " Gauge: " << itr->second;
-        gauge_check.remove(itr->second);
-        gauge_ofagent_family_ptr[metric]->Remove(itr->second);
-        itr++;
-    }
-
-    ofagent_gauge_map[metric].clear();
-}
-
-// Remove dynamic OFAgentStats gauges for all metrics
-void ServerPrometheusManager::removeDynamicGaugeOFAgent ()
+// Set the OFAgentStats gauges of an agent from its stats
+void ServerPrometheusManager::updateDynamicGaugeOFAgent (ofagent_gauges_t& gauges,
+                                                       OFServerStats& stats)
 {
     for (OFAGENT_METRICS metric=OFAGENT_METRICS_MIN;
             metric <= OFAGENT_METRICS_MAX;
                 metric = OFAGENT_METRICS(metric+1)) {
-        removeDynamicGaugeOFAgent(metric);
-    }
-}
-
-// Remove all statically allocated OFAgent gauge families
-void ServerPrometheusManager::removeStaticGaugeFamiliesOFAgent ()
-{
-    for (OFAGENT_METRICS metric=OFAGENT_METRICS_MIN;
-            metric <= OFAGENT_METRICS_MAX;
-                metric = OFAGENT_METRICS(metric+1)) {
-        gauge_ofagent_family_ptr[metric] = nullptr;
-    }
-}
-
-/* Function called from PolicyStatsManager to update OFAgentStats */
-void ServerPrometheusManager::addNUpdateOFAgentStats (const std::string& agent,
-                                                    const std::shared_ptr<OFServerStats> stats)
-{
-    RETURN_IF_DISABLED
-    const lock_guard<mutex> lock(ofagent_stats_mutex);
-
-    if (!stats)
-        return;
-
-    // Create gauge metrics if they arent present already
-    for (OFAGENT_METRICS metric=OFAGENT_METRICS_MIN;
-            metric <= OFAGENT_METRICS_MAX;
-                metric = OFAGENT_METRICS(metric+1))
-        createDynamicGaugeOFAgent(metric, agent);
-
-    // Update the metrics
-    for (OFAGENT_METRICS metric=OFAGENT_METRICS_MIN;
-            metric <= OFAGENT_METRICS_MAX;
-                metric = OFAGENT_METRICS(metric+1)) {
-        Gauge *pgauge = getDynamicGaugeOFAgent(metric, agent);
         optional<uint64_t>   metric_opt;
         switch (metric) {
         case OFAGENT_IDENT_REQS:
-            metric_opt = stats->getIdentReqs();
+            metric_opt = stats.getIdentReqs();
             break;
         case OFAGENT_POL_UPDATES:
-            metric_opt = stats->getPolUpdates();
+            metric_opt = stats.getPolUpdates();
             break;
         case OFAGENT_POL_UNAVAILABLE_RESOLVES:
-            metric_opt = stats->getPolUnavailableResolves();
+            metric_opt = stats.getPolUnavailableResolves();
             break;
         case OFAGENT_POL_RESOLVES:
-            metric_opt = stats->getPolResolves();
+            metric_opt = stats.getPolResolves();
             break;
         case OFAGENT_POL_RESOLVE_ERRS:
-            metric_opt = stats->getPolResolveErrs();
+            metric_opt = stats.getPolResolveErrs();
             break;
         case OFAGENT_POL_UNRESOLVES:
-            metric_opt = stats->getPolUnresolves();
+            metric_opt = stats.getPolUnresolves();
             break;
         case OFAGENT_POL_UNRESOLVE_ERRS:
-            metric_opt = stats->getPolUnresolveErrs();
+            metric_opt = stats.getPolUnresolveErrs();
             break;
         case OFAGENT_EP_DECLARES:
-            metric_opt = stats->getEpDeclares();
+            metric_opt = stats.getEpDeclares();
             break;
         case OFAGENT_EP_DECLARE_ERRS:
-            metric_opt = stats->getEpDeclareErrs();
+            metric_opt = stats.getEpDeclareErrs();
             break;
         case OFAGENT_EP_UNDECLARES:
-            metric_opt = stats->getEpUndeclares();
+            metric_opt = stats.getEpUndeclares();
             break;
         case OFAGENT_EP_UNDECLARE_ERRS:
-            metric_opt = stats->getEpUndeclareErrs();
+            metric_opt = stats.getEpUndeclareErrs();
             break;
         case OFAGENT_EP_RESOLVES:
-            metric_opt = stats->getEpResolves();
+            metric_opt = stats.getEpResolves();
             break;
         case OFAGENT_EP_RESOLVE_ERRS:
-            metric_opt = stats->getEpResolveErrs();
+            metric_opt = stats.getEpResolveErrs();
             break;
         case OFAGENT_EP_UNRESOLVES:
-            metric_opt = stats->getEpUnresolves();
+            metric_opt = stats.getEpUnresolves();
             break;
         case OFAGENT_EP_UNRESOLVE_ERRS:
-            metric_opt = stats->getEpUnresolveErrs();
+            metric_opt = stats.getEpUnresolveErrs();
             break;
         case OFAGENT_STATE_REPORTS:
-            metric_opt = stats->getStateReports();
+            metric_opt = stats.getStateReports();
             break;
         case OFAGENT_STATE_REPORT_ERRS:
-            metric_opt = stats->getStateReportErrs();
+            metric_opt = stats.getStateReportErrs();
             break;
         default:
             LOG(WARNING) << "Unhandled ofagent metric: " << metric;
         }
-        if (metric_opt && pgauge)
-            pgauge->Set(static_cast<double>(metric_opt.get()));
-        if (!pgauge) {
-            LOG(WARNING) << "Invalid ofagent update agent: " << agent;
-            break;
-        }
+        if (metric_opt)
+            gauges.gauge[metric]->Set(static_cast<double>(metric_opt.get()));
+    }
+}
+
+// Remove dynamic OFAgentStats gauges given the agent (IP,port) tuple
+bool ServerPrometheusManager::removeDynamicGaugeOFAgent (const string& agent)
+{
+    auto itr = ofagent_gauge_map.find(agent);
+    if (itr == ofagent_gauge_map.end()) {
+        LOG(DEBUG) << "remove dynamic gauge ofagent stats not found agent:" << agent;
+        return false;
+    }
+    for (OFAGENT_METRICS metric=OFAGENT_METRICS_MIN;
+            metric <= OFAGENT_METRICS_MAX;
+                metric = OFAGENT_METRICS(metric+1)) {
+        gauge_check.remove(itr->second.gauge[metric]);
+        gauge_ofagent_family_ptr[metric]->Remove(itr->second.gauge[metric]);
+    }
+    ofagent_gauge_map.erase(itr);
+    return true;
+}
+
+// Remove dynamic OFAgentStats gauges of every agent
+void ServerPrometheusManager::removeDynamicGaugeOFAgent ()
+{
+    while (!ofagent_gauge_map.empty()) {
+        const string agent = ofagent_gauge_map.begin()->first;
+        LOG(DEBUG) << "Delete OFAgent stats agent: " << agent;
+        removeDynamicGaugeOFAgent(agent);
+    }
+}
+
+// Remove all statically allocated OFAgent gauge families
+void ServerPrometheusManager::removeStaticGaugeFamiliesOFAgent ()
+{
+    for (OFAGENT_METRICS metric=OFAGENT_METRICS_MIN;
+            metric <= OFAGENT_METRICS_MAX;
+                metric = OFAGENT_METRICS(metric+1)) {
+        gauge_ofagent_family_ptr[metric] = nullptr;
+    }
+}
+
+/* Function called from PolicyStatsManager to update OFAgentStats */
+void ServerPrometheusManager::addNUpdateOFAgentStats (const std::string& agent,
+                                                    const std::shared_ptr<OFServerStats> stats)
+{
+    RETURN_IF_DISABLED
+    const lock_guard<mutex> lock(ofagent_stats_mutex);
+
+    if (!stats)
+        return;
+
+    // Create gauge metrics if they arent present already
+    ofagent_gauges_t* pgauges = createDynamicGaugeOFAgent(agent);
+    if (!pgauges) {
+        LOG(WARNING) << "Invalid ofagent update agent: " << agent;
+        return;
     }
+    updateDynamicGaugeOFAgent(*pgauges, *stats);
 }
 
 // Function called from StatsIO to remove OFAgentStats
@@ -364,11 +400,226 @@ void ServerPrometheusManager::removeOFAgentStats (const string& agent)
     RETURN_IF_DISABLED
     LOG(DEBUG) << "Deleting OFAgentStats for agent: " << agent;
     const lock_guard<mutex> lock(ofagent_stats_mutex);
-    for (OFAGENT_METRICS metric=OFAGENT_METRICS_MIN;
-            metric <= OFAGENT_METRICS_MAX;
-                metric = OFAGENT_METRICS(metric+1)) {
-        if (!removeDynamicGaugeOFAgent(metric, agent))
-            break;
+    removeDynamicGaugeOFAgent(agent);
+}
+
+/* Function called from StatsIO once per tick with the stats of every agent */
+void ServerPrometheusManager::updateOFAgentStats (const agent_stats_map_t& stats)
+{
+    RETURN_IF_DISABLED
+    {
+        const lock_guard<mutex> lock(ofagent_stats_mutex);
+        for (const auto& peerStat : stats) {
+            if (!peerStat.second)
+                continue;
+            ofagent_gauges_t* pgauges = createDynamicGaugeOFAgent(peerStat.first);
+            if (pgauges)
+                updateDynamicGaugeOFAgent(*pgauges, *peerStat.second);
+        }
+        // evict the agents that are gone
+        auto itr = ofagent_gauge_map.begin();
+        while (itr != ofagent_gauge_map.end()) {
+            const string agent = (itr++)->first;
+            if (stats.find(agent) == stats.end()) {
+                LOG(DEBUG) << "Deleting OFAgentStats for agent: " << agent;
+                removeDynamicGaugeOFAgent(agent);
+            }
+        }
+    }
+
+    {
+        const lock_guard<mutex> lock(latency_mutex);
+        for (const auto& peerStat : stats) {
+            if (peerStat.second)
+                updateDynamicGaugeLatency(peerStat.first, *peerStat.second);
+        }
+        // evict the agents that are gone; the histograms of an agent
+        // are adjacent in each map
+        for (LATENCY_METRICS metric=LATENCY_METRICS_MIN;
+                metric <= LATENCY_METRICS_MAX;
+                    metric = LATENCY_METRICS(metric+1)) {
+            auto itr = latency_gauge_map[metric].begin();
+            while (itr != latency_gauge_map[metric].end()) {
+                const auto key = (itr++)->first;
+                if (stats.find(key.first) == stats.end())
+                    removeDynamicGaugeLatency(metric, key.first, key.second);
+            }
+        }
+    }
+}
+
+// create the latency histogram gauge families during start
+void ServerPrometheusManager::createStaticGaugeFamiliesLatency (void)
+{
+    for (LATENCY_METRICS metric=LATENCY_METRICS_MIN;
+            metric <= LATENCY_METRICS_MAX;
+                metric = LATENCY_METRICS(metric+1)) {
+        const string& name = latency_family_names[metric];
+        const string& help = latency_family_help[metric];
+        auto& gauge_bucket_family = BuildGauge()
+                             .Name(name + "_bucket")
+                             .Help(help)
+                             .Labels({})
+                             .Register(*registry_ptr);
+        gauge_latency_bucket_family_ptr[metric] = &gauge_bucket_family;
+        auto& gauge_sum_family = BuildGauge()
+                             .Name(name + "_sum")
+                             .Help(help)
+                             .Labels({})
+                             .Register(*registry_ptr);
+        gauge_latency_sum_family_ptr[metric] = &gauge_sum_family;
+        auto& gauge_count_family = BuildGauge()
+                             .Name(name + "_count")
+                             .Help(help)
+                             .Labels({})
+                             .Register(*registry_ptr);
+        gauge_latency_count_family_ptr[metric] = &gauge_count_family;
+    }
+}
+
+// Remove the statically allocated latency histogram gauge families
+void ServerPrometheusManager::removeStaticGaugeFamiliesLatency ()
+{
+    for (LATENCY_METRICS metric=LATENCY_METRICS_MIN;
+            metric <= LATENCY_METRICS_MAX;
+                metric = LATENCY_METRICS(metric+1)) {
+        gauge_latency_bucket_family_ptr[metric] = nullptr;
+        gauge_latency_sum_family_ptr[metric] = nullptr;
+        gauge_latency_count_family_ptr[metric] = nullptr;
+    }
+}
+
+// Create or update the gauges of a latency histogram
+void ServerPrometheusManager::updateDynamicGaugeLatency (LATENCY_METRICS metric,
+                                                       const string& agent,
+                                             const OFLatencyHistogram& hist,
+                                                       const string& method)
+{
+    const auto key = make_pair(agent, method);
+    auto itr = latency_gauge_map[metric].find(key);
+    if (itr == latency_gauge_map[metric].end()) {
+        map<string, string> labels;
+        labels["agent"] = agent;
+        if (!method.empty())
+            labels["method"] = method;
+
+        latency_gauges_t gauges;
+        for (size_t b = 0; b <= OFLatencyHistogram::BUCKETS; ++b) {
+            map<string, string> bucket_labels(labels);
+            bucket_labels["le"] = (b < OFLatencyHistogram::BUCKETS)
+                ? std::to_string(OFLatencyHistogram::getBound(b)) : "+Inf";
+            auto& gauge =
+                gauge_latency_bucket_family_ptr[metric]->Add(bucket_labels);
+            if (gauge_check.is_dup(&gauge)) {
+                LOG(WARNING) << "duplicate latency dyn gauge family"
+                             << " metric: " << metric
+                             << " agent: " << agent;
+                // undo the buckets added so far
+                for (size_t i = 0; i < b; ++i) {
+                    gauge_check.remove(gauges.bucket[i]);
+                    gauge_latency_bucket_family_ptr[metric]
+                        ->Remove(gauges.bucket[i]);
+                }
+                return;
+            }
+            gauge_check.add(&gauge);
+            gauges.bucket[b] = &gauge;
+        }
+        gauges.sum = &gauge_latency_sum_family_ptr[metric]->Add(labels);
+        gauge_check.add(gauges.sum);
+        gauges.count = &gauge_latency_count_family_ptr[metric]->Add(labels);
+        gauge_check.add(gauges.count);
+        LOG(DEBUG) << "created latency dyn gauge family"
+                   << " metric: " << metric
+                   << " agent: " << agent;
+        itr = latency_gauge_map[metric].emplace(key, gauges).first;
+    }
+
+    latency_gauges_t& gauges = itr->second;
+    for (size_t b = 0; b <= OFLatencyHistogram::BUCKETS; ++b) {
+        gauges.bucket[b]->Set(
+            static_cast<double>(hist.getCumulativeCount(b)));
+    }
+    gauges.sum->Set(static_cast<double>(hist.getSum()));
+    gauges.count->Set(static_cast<double>(hist.getCount()));
+}
+
+// Create or update every latency histogram of an agent
+void ServerPrometheusManager::updateDynamicGaugeLatency (const string& agent,
+                                                       OFServerStats& stats)
+{
+    updateDynamicGaugeLatency(LATENCY_AGENT_KEEPALIVE_RTT, agent,
+                              stats.getKeepAliveRtt());
+    OFMethodLatency::method_map_t methodLatency;
+    stats.getMethodLatency().getLatency(methodLatency);
+    for (const auto& l : methodLatency) {
+        if (l.second)
+            updateDynamicGaugeLatency(LATENCY_AGENT_METHOD, agent,
+                                      *l.second, l.first);
+    }
+}
+
+// Remove the gauges of a latency histogram given its agent and method
+void ServerPrometheusManager::removeDynamicGaugeLatency (LATENCY_METRICS metric,
+                                                       const string& agent,
+                                                       const string& method)
+{
+    auto itr = latency_gauge_map[metric].find(make_pair(agent, method));
+    if (itr == latency_gauge_map[metric].end()) {
+        LOG(TRACE) << "Latency gauges not found for " << agent
+                   << " " << method;
+        return;
+    }
+
+    latency_gauges_t& gauges = itr->second;
+    for (size_t b = 0; b <= OFLatencyHistogram::BUCKETS; ++b) {
+        gauge_check.remove(gauges.bucket[b]);
+        gauge_latency_bucket_family_ptr[metric]->Remove(gauges.bucket[b]);
+    }
+    gauge_check.remove(gauges.sum);
+    gauge_latency_sum_family_ptr[metric]->Remove(gauges.sum);
+    gauge_check.remove(gauges.count);
+    gauge_latency_count_family_ptr[metric]->Remove(gauges.count);
+    latency_gauge_map[metric].erase(itr);
+}
+
+// Remove all dynamic latency histogram gauges
+void ServerPrometheusManager::removeDynamicGaugeLatency ()
+{
+    for (LATENCY_METRICS metric=LATENCY_METRICS_MIN;
+            metric <= LATENCY_METRICS_MAX;
+                metric = LATENCY_METRICS(metric+1)) {
+        while (!latency_gauge_map[metric].empty()) {
+            const auto& key = latency_gauge_map[metric].begin()->first;
+            removeDynamicGaugeLatency(metric, key.first, key.second);
+        }
+    }
+}
+
+/* Function called from StatsIO to update agent latency histograms */
+void ServerPrometheusManager::addNUpdateOFAgentLatency (const string& agent,
+                                const std::shared_ptr<OFServerStats> stats)
+{
+    RETURN_IF_DISABLED
+    if (!stats)
+        return;
+    const lock_guard<mutex> lock(latency_mutex);
+    updateDynamicGaugeLatency(agent, *stats);
+}
+
+/* Function called from StatsIO to remove agent latency histograms */
+void ServerPrometheusManager::removeOFAgentLatency (const string& agent)
+{
+    RETURN_IF_DISABLED
+    LOG(DEBUG) << "Deleting latency histograms for agent: " << agent;
+    const lock_guard<mutex> lock(latency_mutex);
+    removeDynamicGaugeLatency(LATENCY_AGENT_KEEPALIVE_RTT, agent);
+    // the method histograms of the agent are adjacent in the map
+    auto& methodGauges = latency_gauge_map[LATENCY_AGENT_METHOD];
+    auto itr = methodGauges.lower_bound(make_pair(agent, string()));
+    while (itr != methodGauges.end() && itr->first.first == agent) {
+        const string method = (itr++)->first.second;
+        removeDynamicGaugeLatency(LATENCY_AGENT_METHOD, agent, method);
     }
 }
 
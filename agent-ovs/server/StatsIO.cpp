@@ -10,12 +10,15 @@
  */
 
 #include <opflexagent/logging.h>
+#include <opflex/util/ThreadSettings.h>
 #include "StatsIO.h"
 #include <opflex/ofcore/OFFramework.h>
 #include <opflex/ofcore/OFServerStats.h>
 #include <modelgbp/dmtree/Root.hpp>
 #include <modelgbp/observer/SysStatUniverse.hpp>
 
+#include <vector>
+
 using boost::asio::deadline_timer;
 using boost::posix_time::seconds;
 using namespace opflex::modb;
@@ -24,6 +27,12 @@ using namespace modelgbp::dmtree;
 
 namespace opflexagent {
 
+/*
+ * The number of ticks between sweeps over every server counter in
+ * the MODB for agents that went away
+ */
+static const int SWEEP_TICKS = 30;
+
 StatsIO::StatsIO (ServerPrometheusManager& prometheusManager_,
                   opflex::test::GbpOpflexServer& server_,
                   opflex::ofcore::OFFramework& framework_,
@@ -32,7 +41,7 @@ StatsIO::StatsIO (ServerPrometheusManager& prometheusManager_,
                   server(server_),
                   framework(framework_),
                   stats_interval_secs(stats_interval_secs_),
-                  stopping(false) {
+                  stopping(false), sweepTicks(0) {
 }
 
 StatsIO::~StatsIO() {
@@ -48,7 +57,8 @@ void StatsIO::start() {
             on_timer_stats(ec);
         });
 
-    io_service_thread.reset(new std::thread([this]() { io.run(); }));
+    io_service_thread.reset(new std::thread(
+        opflex::util::startThread("stats_io", [this]() { io.run(); })));
 }
 
 void StatsIO::stop() {
@@ -74,7 +84,9 @@ void StatsIO::on_timer_stats (const boost::system::error_code& ec) {
         return;
     }
 
-    std::unordered_map<string, std::shared_ptr<OFServerStats>> stats;
+    // Double-buffer the snapshots: the last one whose removals were
+    // committed tells which agents went away since
+    stats.clear();
     server.getOpflexPeerStats(stats);
     optional<shared_ptr<SysStatUniverse> > ssu =
         SysStatUniverse::resolve(framework);
@@ -85,8 +97,9 @@ void StatsIO::on_timer_stats (const boost::system::error_code& ec) {
             ssu = root.get()->addObserverSysStatUniverse();
         mutator.commit();
     }
-    Mutator mutator(framework, "policyelement");
+    bool committed = false;
     if (ssu) {
+        Mutator mutator(framework, "policyelement");
         for (const auto& peerStat : stats) {
             ssu.get()->addObserverOpflexServerCounter(peerStat.first)
                     ->setIdentReqs(peerStat.second->getIdentReqs())
@@ -106,23 +119,42 @@ void StatsIO::on_timer_stats (const boost::system::error_code& ec) {
                     .setEpUnresolveErrs(peerStat.second->getEpUnresolveErrs())
                     .setStateReports(peerStat.second->getStateReports())
                     .setStateReportErrs(peerStat.second->getStateReportErrs());
-            prometheusManager.addNUpdateOFAgentStats(peerStat.first, peerStat.second);
         }
         // Remove mos for deleted connections
-        std::vector<std::shared_ptr<modelgbp::observer::OpflexServerCounter> > out;
-        ssu.get()->resolveObserverOpflexServerCounter(out);
-        for (auto &serverCounter: out) {
-            boost::optional<const std::string&> agent =
-                                                serverCounter->getPeer();
-            if (agent) {
-                if (stats.find(agent.get()) == stats.end()) {
+        if (sweepTicks == 0) {
+            // Fall back to every counter in the MODB now and then, in
+            // case one was left behind
+            std::vector<std::shared_ptr<OpflexServerCounter> > out;
+            ssu.get()->resolveObserverOpflexServerCounter(out);
+            for (auto &serverCounter: out) {
+                boost::optional<const std::string&> agent =
+                    serverCounter->getPeer();
+                if (agent && stats.find(agent.get()) == stats.end())
                     serverCounter->remove();
-                    prometheusManager.removeOFAgentStats(agent.get());
-                }
+            }
+        } else {
+            for (const auto& peerStat : prevStats) {
+                if (stats.find(peerStat.first) != stats.end())
+                    continue;
+                optional<shared_ptr<OpflexServerCounter> > serverCounter =
+                    ssu.get()->resolveObserverOpflexServerCounter(peerStat.first);
+                if (serverCounter)
+                    serverCounter.get()->remove();
             }
         }
+        mutator.commit();
+        committed = true;
+    }
+    // Update the metrics of every agent at once, which also evicts
+    // the agents that went away
+    prometheusManager.updateOFAgentStats(stats);
+
+    // Only a committed snapshot is the one the next removals start
+    // from; until then the agents of the older one stay pending
+    if (committed) {
+        prevStats.swap(stats);
+        sweepTicks = (sweepTicks + 1) % SWEEP_TICKS;
     }
-    mutator.commit();
 
     if (!stopping) {
         const std::lock_guard<std::mutex> guard(stats_timer_mutex);
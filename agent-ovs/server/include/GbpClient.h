@@ -20,6 +20,7 @@
 #include <thread>
 #include <chrono>
 #include <mutex>
+#include <atomic>
 
 #ifdef RAPIDJSON_HAS_STDSTRING
 #undef RAPIDJSON_HAS_STDSTRING
@@ -46,6 +47,8 @@ private:
     void Start(const std::string& address);
     std::thread thread_;
     opflex::test::GbpOpflexServer& server_;
+    // the last policy version applied, kept across reconnects
+    std::atomic<int32_t> version;
     std::atomic<bool> stopping;
     GbpClientImpl* client_;
     std::mutex client_mutex;
@@ -46,6 +46,12 @@ private:
     opflex::ofcore::OFFramework& framework;
     int stats_interval_secs;
     std::atomic<bool> stopping;
+    // the stats snapshot of this tick, and the last one whose
+    // counters were committed to the MODB
+    ServerPrometheusManager::agent_stats_map_t stats;
+    ServerPrometheusManager::agent_stats_map_t prevStats;
+    // the ticks since the last sweep over every server counter
+    int sweepTicks;
     std::unique_ptr<std::thread> io_service_thread;
     boost::asio::io_service io;
     std::unique_ptr<boost::asio::deadline_timer> stats_timer;
@@ -75,7 +75,10 @@ int main(int argc, char** argv) {
             ("disable-prometheus", "Disable exporting metrics to prometheus")
             ("enable-prometheus-localhost", "Export prometheus port only on localhost")
             ("policy,p", po::value<string>()->default_value(""),
-             "Read the specified policy file to seed the MODB")
+             "Read the specified policy file or MODB image to seed the MODB")
+            ("policy_threads", po::value<int>()->default_value(0),
+             "Number of threads that parse the policy file "
+             "(default 0, one per core)")
             ("ssl_castore", po::value<string>()->default_value("/etc/ssl/certs/"),
              "Use the specified path or certificate file as the SSL CA store")
             ("ssl_key", po::value<string>()->default_value(""),
@@ -98,7 +101,24 @@ int main(int argc, char** argv) {
             ("stats_interval_secs", po::value<int>()->default_value(15),
              "How often to wakeup io thread to check for stats timeouts")
             ("server_port", po::value<int>()->default_value(8009),
-             "Port on which server passively listens");
+             "Port on which server passively listens")
+            ("workers", po::value<int>()->default_value(0),
+             "Number of worker threads that serialize resolve responses "
+             "(default 0, serialize on the listener thread)")
+            ("loops", po::value<int>()->default_value(1),
+             "Number of event loops that serve agent connections")
+            ("resolve_cache_size", po::value<int>()->default_value(-1),
+             "Number of serialized policy subtrees to cache for "
+             "policy resolves, or 0 to disable")
+            ("resolve_rate", po::value<double>()->default_value(0),
+             "Policy and endpoint resolves per second allowed from each "
+             "agent (default 0, no limit)")
+            ("declare_rate", po::value<double>()->default_value(0),
+             "Endpoint declarations per second allowed from each agent "
+             "(default 0, no limit)")
+            ("report_rate", po::value<double>()->default_value(0),
+             "State reports per second allowed from each agent "
+             "(default 0, no limit)");
     } catch (const boost::bad_lexical_cast& e) {
         std::cerr << e.what() << std::endl;
         return 1;
@@ -117,7 +137,9 @@ int main(int argc, char** argv) {
     std::string ssl_pass;
     std::vector<std::string> peers;
     std::vector<std::string> transport_mode_proxies;
-    int prr_interval_secs, stats_interval_secs, server_port;
+    int prr_interval_secs, stats_interval_secs, server_port, workers,
+        loops, resolve_cache_size, policy_threads;
+    double resolve_rate, declare_rate, report_rate;
 #ifdef HAVE_GRPC_SUPPORT
     std::string grpc_address;
     std::string grpc_conf_file;
@@ -186,6 +208,13 @@ int main(int argc, char** argv) {
         prr_interval_secs = vm["prr_interval_secs"].as<int>();
         stats_interval_secs = vm["stats_interval_secs"].as<int>();
         server_port = vm["server_port"].as<int>();
+        workers = vm["workers"].as<int>();
+        loops = vm["loops"].as<int>();
+        resolve_cache_size = vm["resolve_cache_size"].as<int>();
+        resolve_rate = vm["resolve_rate"].as<double>();
+        declare_rate = vm["declare_rate"].as<double>();
+        report_rate = vm["report_rate"].as<double>();
+        policy_threads = vm["policy_threads"].as<int>();
     } catch (const po::unknown_option& e) {
         std::cerr << e.what() << std::endl;
         return 2;
@@ -235,6 +264,8 @@ int main(int argc, char** argv) {
                         server, framework, stats_interval_secs);
         statsIO.start();
 
+        if (policy_threads > 0)
+            server.setPolicyThreads(policy_threads);
         if (policy_file != "") {
             server.readPolicy(policy_file);
         }
@@ -242,6 +273,13 @@ int main(int argc, char** argv) {
         if (ssl_key != "") {
             server.enableSSL(ssl_castore, ssl_key, ssl_pass);
         }
+        if (workers > 0)
+            server.setWorkers(workers);
+        if (loops > 1)
+            server.setLoops(loops);
+        if (resolve_cache_size >= 0)
+            server.setResolveCacheSize(resolve_cache_size);
+        server.setRequestLimits(resolve_rate, declare_rate, report_rate);
 
         server.start();
         signal(SIGINT | SIGTERM, sighandler);
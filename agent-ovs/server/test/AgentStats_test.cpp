@@ -179,6 +179,66 @@ BOOST_FIXTURE_TEST_CASE(testOFAgent, AgentStatsFixture) {
     LOG(DEBUG) << "### OFAgent end";
 }
 
+BOOST_FIXTURE_TEST_CASE(testOFAgentLatency, AgentStatsFixture) {
+
+    LOG(DEBUG) << "### OFAgentLatency start";
+    shared_ptr<OFServerStats> opflexStats = std::make_shared<OFServerStats>();
+    const string& agent = "127.0.0.1:9999";
+
+    opflexStats->getKeepAliveRtt().observe(3);
+    opflexStats->getMethodLatency().observe("policy_update", 12);
+    prometheusManager.addNUpdateOFAgentLatency(agent, opflexStats);
+
+    string output = BaseFixture::getOutputFromCommand(cmd);
+    size_t pos = output.find("opflex_agent_keepalive_rtt_ms_bucket"
+                             "{agent=\"" + agent + "\",le=\"5\"} 1");
+    BaseFixture::expPosition(true, pos);
+    pos = output.find("opflex_agent_request_latency_ms_sum"
+                      "{agent=\"" + agent + "\",method=\"policy_update\"} 12");
+    BaseFixture::expPosition(true, pos);
+
+    prometheusManager.removeOFAgentLatency(agent);
+    output = BaseFixture::getOutputFromCommand(cmd);
+    pos = output.find("opflex_agent_keepalive_rtt_ms_count{");
+    BaseFixture::expPosition(false, pos);
+    pos = output.find("opflex_agent_request_latency_ms_count{");
+    BaseFixture::expPosition(false, pos);
+    LOG(DEBUG) << "### OFAgentLatency end";
+}
+
+BOOST_FIXTURE_TEST_CASE(testOFAgentSnapshot, AgentStatsFixture) {
+
+    LOG(DEBUG) << "### OFAgentSnapshot start";
+    const string& agent1 = "127.0.0.1:9998";
+    const string& agent2 = "127.0.0.1:9999";
+    ServerPrometheusManager::agent_stats_map_t stats;
+    stats[agent1] = std::make_shared<OFServerStats>();
+    stats[agent2] = std::make_shared<OFServerStats>();
+    updateOFAgentStats(stats[agent1]);
+    updateOFAgentStats(stats[agent2]);
+    stats[agent2]->getKeepAliveRtt().observe(3);
+
+    prometheusManager.updateOFAgentStats(stats);
+    verifyOFAgentMetrics(agent1, 1, false);
+    verifyOFAgentMetrics(agent2, 1, false);
+
+    // an agent missing from the next snapshot is evicted
+    stats.erase(agent2);
+    updateOFAgentStats(stats[agent1]);
+    prometheusManager.updateOFAgentStats(stats);
+    verifyOFAgentMetrics(agent1, 2, false);
+    verifyOFAgentMetrics(agent2, 1, true);
+    const string& output = BaseFixture::getOutputFromCommand(cmd);
+    size_t pos = output.find("opflex_agent_keepalive_rtt_ms_count"
+                             "{agent=\"" + agent2 + "\"}");
+    BaseFixture::expPosition(false, pos);
+
+    stats.clear();
+    prometheusManager.updateOFAgentStats(stats);
+    verifyOFAgentMetrics(agent1, 2, true);
+    LOG(DEBUG) << "### OFAgentSnapshot end";
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }
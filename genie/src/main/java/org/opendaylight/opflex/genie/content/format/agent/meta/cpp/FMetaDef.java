@@ -1,6 +1,7 @@
 package org.opendaylight.opflex.genie.content.format.agent.meta.cpp;
 
 import java.util.Collection;
+import java.util.LinkedHashMap;
 import java.util.Map;
 import java.util.TreeMap;
 
@@ -64,10 +65,14 @@ public class FMetaDef
     {
         out.println(0, "#include <" + Config.getProjName() + "/metadata/metadata.hpp>");
         out.println(0, "#include <" + Config.getProjName() + "/dmtree/Root.hpp>");
+        out.println(0, "#include <opflex/modb/mo-internal/ClassCodec.h>");
+        out.println(0, "#include <opflex/modb/mo-internal/ObjectInstance.h>");
+        out.println(0, "#include <cstring>");
 
         out.println(0, "namespace " + Config.getProjName());
         out.println(0, "{");
 
+        generateCodecs(0);
         generateMetaAccessor(0);
 
         out.println(0, "} // namespace " + Config.getProjName());
@@ -195,6 +200,10 @@ public class FMetaDef
         out.print(aInIndent , lPrefix + "ClassInfo(" + aInClass.getGID().getId() + ", ");
         out.println(getClassType(aInClass) + ", \"" + aInClass.getFullConcatenatedName() + "\", \"" + getOwner(aInClass) + "\",");
         genProps(aInIndent + 1, aInClass);
+        if (hasCodec(aInClass))
+        {
+            out.println(aInIndent + 1, ",&" + getCodecName(aInClass));
+        }
         out.println(aInIndent + 1, ')');
     }
 
@@ -266,6 +275,227 @@ public class FMetaDef
             out.println(aInIndent + 1, "}");
         }
     }
+    /**
+     * Generates a JSON codec for each concrete class whose value properties can all be encoded with
+     * straight-line code. Reference and child properties are left to the generic serializer.
+     */
+    private void generateCodecs(int aInIndent)
+    {
+        out.println(aInIndent, "namespace");
+        out.println(aInIndent, "{");
+        for (Item lIt : MClass.getConcreteClasses())
+        {
+            MClass lClass = (MClass) lIt;
+            if (lClass.isConcrete() && hasCodec(lClass))
+            {
+                genCodec(aInIndent + 1, lClass);
+            }
+        }
+        out.println(aInIndent, "} // anonymous namespace");
+    }
+
+    private static String getCodecName(MClass aIn)
+    {
+        return "codec_" + aIn.getGID().getId();
+    }
+
+    /**
+     * @return the PropertyInfo type of a value property that codecs can handle, or null if the
+     * property must be left to the generic serializer
+     */
+    private static String getCodecType(MProp aInProp)
+    {
+        MType lPrimitiveType = aInProp.getType(false).getBuiltInType();
+        String lType = getTypeName(lPrimitiveType);
+        switch (lType)
+        {
+            case "ENUM8":
+            case "ENUM16":
+            case "ENUM32":
+            case "ENUM64":
+                if (!Config.isEnumSupport())
+                {
+                    return null;
+                }
+            case "STRING":
+            case "S64":
+            case "U64":
+            case "MAC":
+                return lType;
+            default:
+                return null;
+        }
+    }
+
+    private static TreeMap<String,MProp> getCodecProps(MClass aInClass)
+    {
+        TreeMap<String,MProp> lProps = new TreeMap<>();
+        aInClass.findProp(lProps,true);
+        return lProps;
+    }
+
+    private static boolean hasCodec(MClass aInClass)
+    {
+        if (isRelationshipSource(aInClass))
+        {
+            return false;
+        }
+        TreeMap<String,MProp> lProps = getCodecProps(aInClass);
+        if (lProps.isEmpty())
+        {
+            return false;
+        }
+        for (MProp lProp : lProps.values())
+        {
+            if (null == getCodecType(lProp))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    private static Map<String,String> getEnumConsts(MProp aInProp)
+    {
+        // value to name, with the last name for a value winning as in EnumInfo
+        Map<String, MConst> lConsts = new TreeMap<>();
+        aInProp.findConst(lConsts, true);
+        Map<String,String> lValues = new LinkedHashMap<>();
+        for (MConst lConst : lConsts.values())
+        {
+            if (ConstAction.REMOVE != lConst.getAction())
+            {
+                lValues.put(lConst.getValue().getValue(), lConst.getLID().getName());
+            }
+        }
+        return lValues;
+    }
+
+    private static String getLiteral(String aIn)
+    {
+        return "\"" + aIn + "\", " + aIn.length();
+    }
+
+    private void genCodec(int aInIndent, MClass aInClass)
+    {
+        TreeMap<String,MProp> lProps = getCodecProps(aInClass);
+        String lName = getCodecName(aInClass);
+
+        out.println(aInIndent, "// " + aInClass.getFullConcatenatedName());
+        out.println(aInIndent, "void encode_" + aInClass.getGID().getId() + "(const opflex::modb::mointernal::ObjectInstance& oi, yajr::rpc::SendHandler& writer)");
+        out.println(aInIndent, "{");
+        for (MProp lProp : lProps.values())
+        {
+            String lType = getCodecType(lProp);
+            String lPropName = lProp.getLID().getName();
+            int lLocalId = lProp.getPropId(aInClass);
+            boolean lIsEnum = lType.startsWith("ENUM");
+            String lFind;
+            switch (lType)
+            {
+                case "STRING":
+                    lFind = "const std::string* v = oi.findString(";
+                    break;
+                case "S64":
+                    lFind = "const int64_t* v = oi.findInt64(";
+                    break;
+                case "MAC":
+                    lFind = "const opflex::modb::MAC* v = oi.findMAC(";
+                    break;
+                default:
+                    lFind = "const uint64_t* v = oi.findUInt64(";
+                    break;
+            }
+            out.println(aInIndent + 1, "{");
+            out.println(aInIndent + 2, lFind + toUnsignedStr(lLocalId) + ");");
+            out.println(aInIndent + 2, "if (v)");
+            out.println(aInIndent + 2, "{");
+            out.println(aInIndent + 3, "writer.StartObject();");
+            out.println(aInIndent + 3, "writer.String(" + getLiteral("name") + ");");
+            out.println(aInIndent + 3, "writer.String(" + getLiteral(lPropName) + ");");
+            out.println(aInIndent + 3, "writer.String(" + getLiteral("data") + ");");
+            switch (lType)
+            {
+                case "STRING":
+                    out.println(aInIndent + 3, "writer.String(v->data(), v->size());");
+                    break;
+                case "S64":
+                    out.println(aInIndent + 3, "writer.Int64(*v);");
+                    break;
+                case "MAC":
+                    out.println(aInIndent + 3, "writer.String(v->toString().c_str());");
+                    break;
+                case "U64":
+                    out.println(aInIndent + 3, "writer.Uint64(*v);");
+                    break;
+                default:
+                {
+                    String lElse = "";
+                    for (Map.Entry<String,String> lConst : getEnumConsts(lProp).entrySet())
+                    {
+                        out.println(aInIndent + 3, lElse + "if (*v == " + lConst.getKey() + ") writer.String(" + getLiteral(lConst.getValue()) + ");");
+                        lElse = "else ";
+                    }
+                    out.println(aInIndent + 3, lElse + "writer.Null();");
+                    break;
+                }
+            }
+            out.println(aInIndent + 3, "writer.EndObject();");
+            out.println(aInIndent + 2, "}");
+            out.println(aInIndent + 1, "}");
+        }
+        out.println(aInIndent, "}");
+
+        // MAC properties are left to the generic decoder, which reports malformed addresses
+        out.println(aInIndent, "bool decode_" + aInClass.getGID().getId() + "(const char* name, const rapidjson::Value& data, opflex::modb::mointernal::ObjectInstance& oi)");
+        out.println(aInIndent, "{");
+        for (MProp lProp : lProps.values())
+        {
+            String lType = getCodecType(lProp);
+            if (lType.equals("MAC"))
+            {
+                continue;
+            }
+            String lPropName = lProp.getLID().getName();
+            String lId = toUnsignedStr(lProp.getPropId(aInClass));
+            out.println(aInIndent + 1, "if (std::strcmp(name, \"" + lPropName + "\") == 0)");
+            out.println(aInIndent + 1, "{");
+            switch (lType)
+            {
+                case "STRING":
+                    out.println(aInIndent + 2, "if (data.IsString()) oi.setString(" + lId + ", std::string(data.GetString(), data.GetStringLength()));");
+                    break;
+                case "S64":
+                    out.println(aInIndent + 2, "if (data.IsInt64()) oi.setInt64(" + lId + ", data.GetInt64());");
+                    break;
+                case "U64":
+                    out.println(aInIndent + 2, "if (data.IsUint64()) oi.setUInt64(" + lId + ", data.GetUint64());");
+                    break;
+                default:
+                {
+                    // unknown names are left to the generic decoder so they get reported
+                    out.println(aInIndent + 2, "if (!data.IsString()) return false;");
+                    out.println(aInIndent + 2, "const char* v = data.GetString();");
+                    String lElse = "";
+                    for (Map.Entry<String,String> lConst : getEnumConsts(lProp).entrySet())
+                    {
+                        out.println(aInIndent + 2, lElse + "if (std::strcmp(v, \"" + lConst.getValue() + "\") == 0) oi.setUInt64(" + lId + ", " + lConst.getKey() + ");");
+                        lElse = "else ";
+                    }
+                    out.println(aInIndent + 2, lElse + "return false;");
+                    break;
+                }
+            }
+            out.println(aInIndent + 2, "return true;");
+            out.println(aInIndent + 1, "}");
+        }
+        out.println(aInIndent + 1, "return false;");
+        out.println(aInIndent, "}");
+
+        out.println(aInIndent, "const opflex::modb::mointernal::ClassCodec " + lName + " = { encode_" + aInClass.getGID().getId() + ", decode_" + aInClass.getGID().getId() + " };");
+        out.println(aInIndent, "");
+    }
+
     private void genConsts(int aInIndent, MProp aInProp, MType aInType)
     {
         Map<String, MConst> lConsts = new TreeMap<>();
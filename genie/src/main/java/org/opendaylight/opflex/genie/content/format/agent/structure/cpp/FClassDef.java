@@ -255,32 +255,72 @@ public class FClassDef extends ItemFormatterTask
         {
             if (aInProp.getLID().getName().equalsIgnoreCase("targetName"))
             {
-                genRef(aInIndent,aInClass, aInPropIdx, lComments);
+                String lPropId = genPropId(aInIndent, "target", aInPropIdx);
+                genRef(aInIndent,aInClass, lPropId, lComments);
             }
         }
         else
         {
-            genPropCheck(aInIndent, aInProp,aInPropIdx, lBaseType,lComments);
-            genPropAccessor(aInIndent, aInProp, aInPropIdx, lBaseType, lComments);
+            String lPropId = genPropId(aInIndent, aInProp.getLID().getName(), aInPropIdx);
+            genPropCheck(aInIndent, aInProp,lPropId, lBaseType,lComments);
+            genPropAccessor(aInIndent, aInProp, lPropId, lBaseType, lComments);
             genPropDefaultedAccessor(aInIndent, aInProp, lBaseType, lComments);
-            genPropMutator(aInIndent, aInClass, aInProp, aInPropIdx, lBaseType, lComments);
-            genPropUnset(aInIndent, aInClass, aInProp, aInPropIdx, lBaseType, lComments);
+            genPropMutator(aInIndent, aInClass, aInProp, lPropId, lBaseType, lComments);
+            genPropUnset(aInIndent, aInClass, aInProp, lPropId, lBaseType, lComments);
         }
     }
 
+    /**
+     * Get the name of the generated constant holding a property ID
+     */
+    public static String getPropIdName(String aInPropName)
+    {
+        return "PROP_ID_" + Strings.repaceIllegal(aInPropName.toUpperCase());
+    }
+
+    /**
+     * Get the C++ type of the value returned by the single-lookup
+     * ObjectInstance accessor for the given accessor type
+     */
+    public static String getValueType(String aInPType)
+    {
+        switch (aInPType)
+        {
+            case "UInt64":
+                return "uint64_t";
+            case "Int64":
+                return "int64_t";
+            case "String":
+                return "std::string";
+            case "MAC":
+                return "opflex::modb::MAC";
+            default:
+                return "opflex::modb::reference_t";
+        }
+    }
+
+    private String genPropId(int aInIndent, String aInName, int aInPropIdx)
+    {
+        String lPropId = getPropIdName(aInName);
+        out.printHeaderComment(aInIndent, Arrays.asList("The property ID for " + aInName));
+        out.println(aInIndent, "static constexpr opflex::modb::prop_id_t " + lPropId + " = " + toUnsignedStr(aInPropIdx) + ";");
+        out.println();
+        return lPropId;
+    }
+
     private void genRef(
-        int aInIndent, MClass aInClass, int aInPropIdx,
+        int aInIndent, MClass aInClass, String aInPropId,
         Collection<String> aInComments)
     {
-        genRefCheck(aInIndent, aInPropIdx, aInComments);
-        genRefAccessors(aInIndent, aInPropIdx, aInComments);
+        genRefCheck(aInIndent, aInPropId, aInComments);
+        genRefAccessors(aInIndent, aInPropId, aInComments);
         genRefDefaultedAccessors(aInIndent, aInComments);
-        genRefMutators(aInIndent, aInClass, aInPropIdx, aInComments);
-        genRefUnset(aInIndent, aInClass, aInPropIdx, aInComments);
+        genRefMutators(aInIndent, aInClass, aInPropId, aInComments);
+        genRefUnset(aInIndent, aInClass, aInPropId, aInComments);
     }
     
     private void genPropCheck(
-        int aInIndent, int aInPropIdx, Collection<String> aInComments,
+        int aInIndent, String aInPropId, Collection<String> aInComments,
         String aInCheckName, String aInPType)
     {
         //
@@ -305,30 +345,30 @@ public class FClassDef extends ItemFormatterTask
         // METHOD BODY
         //
         out.println(aInIndent,"{");
-            out.println(aInIndent + 1, "return getObjectInstance().isSet(" + toUnsignedStr(aInPropIdx) +
+            out.println(aInIndent + 1, "return getObjectInstance().isSet(" + aInPropId +
                                        ", opflex::modb::PropertyInfo::" + aInPType + ");");
         out.println(aInIndent,"}");
         out.println();
     }
 
     private void genPropCheck(
-        int aInIndent, MProp aInProp, int aInPropIdx, MType aInBaseType, Collection<String> aInComments)
+        int aInIndent, MProp aInProp, String aInPropId, MType aInBaseType, Collection<String> aInComments)
     {
         String lPType = FMetaDef.getTypeName(aInBaseType);
-        genPropCheck(aInIndent, aInPropIdx,
+        genPropCheck(aInIndent, aInPropId,
                 aInComments, aInProp.getLID().getName(),
                      lPType);
     }
 
     private void genRefCheck(
-        int aInIndent, int aInPropIdx, Collection<String> aInComments)
+        int aInIndent, String aInPropId, Collection<String> aInComments)
     {
-        genPropCheck(aInIndent, aInPropIdx,
+        genPropCheck(aInIndent, aInPropId,
                 aInComments, "target", "REFERENCE");
     }
 
     private void genPropAccessor(
-        int aInIndent, int aInPropIdx, Collection<String> aInComments, String aInCheckName,
+        int aInIndent, String aInPropId, Collection<String> aInComments, String aInCheckName,
         String aInName, String aInEffSyntax, String aInPType, String aInCast, String aInAccessor)
     {
         //
@@ -347,15 +387,16 @@ public class FClassDef extends ItemFormatterTask
         out.printHeaderComment(aInIndent,lComment);
         out.println(aInIndent,"boost::optional<" + aInEffSyntax + "> get" + Strings.upFirstLetter(aInName) + "()");
         out.println(aInIndent,"{");
-        out.println(aInIndent + 1,"if (is" + Strings.upFirstLetter(aInCheckName) + "Set())");
-        out.println(aInIndent + 2,"return " + aInCast + "getObjectInstance().get" + aInPType + "(" + toUnsignedStr(aInPropIdx) + ")" + aInAccessor + ";");
+        out.println(aInIndent + 1,"const " + getValueType(aInPType) + "* value = getObjectInstance().find" + aInPType + "(" + aInPropId + ");");
+        out.println(aInIndent + 1,"if (value)");
+        out.println(aInIndent + 2,"return " + aInCast + "(*value)" + aInAccessor + ";");
         out.println(aInIndent + 1,"return boost::none;");
         out.println(aInIndent,"}");
         out.println();
     }
 
     private void genPropAccessor(
-        int aInIndent, MProp aInProp, int aInPropIdx, MType aInBaseType,
+        int aInIndent, MProp aInProp, String aInPropId, MType aInBaseType,
         Collection<String> aInComments)
     {
         String lName = aInProp.getLID().getName();
@@ -363,18 +404,18 @@ public class FClassDef extends ItemFormatterTask
         String lEffSyntax = getPropEffSyntax(aInBaseType);
         String lCast = getCast(lPType, lEffSyntax);
         lPType = getTypeAccessor(lPType);
-        genPropAccessor(aInIndent, aInPropIdx, aInComments,
+        genPropAccessor(aInIndent, aInPropId, aInComments,
                         lName, lName, lEffSyntax, lPType, lCast, "");
     }
 
     private void genRefAccessors(
-        int aInIndent, int aInPropIdx,
+        int aInIndent, String aInPropId,
         Collection<String> aInComments)
     {
         String lName = "target";
-        genPropAccessor(aInIndent, aInPropIdx, aInComments,
+        genPropAccessor(aInIndent, aInPropId, aInComments,
                         lName, lName + "Class", "opflex::modb::class_id_t", "Reference", "", ".first");
-        genPropAccessor(aInIndent, aInPropIdx, aInComments,
+        genPropAccessor(aInIndent, aInPropId, aInComments,
                         lName, lName + "URI", "opflex::modb::URI", "Reference", "", ".second");
     }
 
@@ -429,7 +470,7 @@ public class FClassDef extends ItemFormatterTask
     }
 
     private void genPropMutator(
-        int aInIndent, MClass aInClass, int aInPropIdx, Collection<String> aInBaseComments,
+        int aInIndent, MClass aInClass, String aInPropId, Collection<String> aInBaseComments,
         Collection<String> aInComments, String aInName, String aInPType, String aInEffSyntax,
         String aInParamName, String aInParamHelp, String aInSetterPrefix)
     {
@@ -453,14 +494,14 @@ public class FClassDef extends ItemFormatterTask
         // BODY
         //
         out.println(aInIndent,"{");
-        out.println(aInIndent + 1, "getTLMutator().modify(getClassId(), getURI())->set" + aInPType + "(" + toUnsignedStr(aInPropIdx) + aInSetterPrefix + ", " + aInParamName + ");");
+        out.println(aInIndent + 1, "getTLMutator().modify(getClassId(), getURI())->set" + aInPType + "(" + aInPropId + aInSetterPrefix + ", " + aInParamName + ");");
         out.println(aInIndent + 1, "return *this;");
         out.println(aInIndent,"}");
         out.println();
     }
 
     private void genNamedPropMutators(
-        int aInIndent, MClass aInClass, MClass aInRefClass, int aInPropIdx,
+        int aInIndent, MClass aInClass, MClass aInRefClass, String aInPropId,
         List<Pair<String, MNameRule>> aInNamingPath, boolean aInIsUniqueNaming,
         String aInMethName, String aInPType, String aInSetterPrefix)
     {
@@ -521,14 +562,14 @@ public class FClassDef extends ItemFormatterTask
         //
         String lUriBuilder = getUriBuilder(aInNamingPath);
         out.println(aInIndent,"{");
-        out.println(aInIndent + 1, "getTLMutator().modify(getClassId(), getURI())->set" + aInPType + "(" + toUnsignedStr(aInPropIdx) + aInSetterPrefix + ", " + lUriBuilder + ");");
+        out.println(aInIndent + 1, "getTLMutator().modify(getClassId(), getURI())->set" + aInPType + "(" + aInPropId + aInSetterPrefix + ", " + lUriBuilder + ");");
         out.println(aInIndent + 1, "return *this;");
         out.println(aInIndent,"}");
         out.println();
     }
     
     private void genPropMutator(
-        int aInIndent, MClass aInClass, MProp aInProp, int aInPropIdx, MType aInBaseType,
+        int aInIndent, MClass aInClass, MProp aInProp, String aInPropId, MType aInBaseType,
         Collection<String> aInComments)
     {
         String lName = aInProp.getLID().getName();
@@ -536,14 +577,14 @@ public class FClassDef extends ItemFormatterTask
         lPType = getTypeAccessor(lPType);
         List<String> lComments = Arrays.asList(
             "Set " + lName + " to the specified value in the currently-active mutator.");
-        genPropMutator(aInIndent, aInClass, aInPropIdx,
+        genPropMutator(aInIndent, aInClass, aInPropId,
                 lComments, aInComments, lName, lPType,
                        getPropEffSyntax(aInBaseType), "newValue", "the new value to set.",
                        "");
     }
 
     private void genRefMutators(
-        int aInIndent, MClass aInClass, int aInPropIdx, Collection<String> aInComments)
+        int aInIndent, MClass aInClass, String aInPropId, Collection<String> aInComments)
     {
         for (MClass lTargetClass : ((MRelationshipClass) aInClass).getTargetClasses(true))
         {
@@ -552,7 +593,7 @@ public class FClassDef extends ItemFormatterTask
             List<String> lComments = Arrays.asList(
                 "Set the reference to point to an instance of " + getClassName(lTargetClass, false),
                 "with the specified URI");
-            genPropMutator(aInIndent, aInClass, aInPropIdx,
+            genPropMutator(aInIndent, aInClass, aInPropId,
                     lComments, aInComments, lName, "Reference",
                            "const opflex::modb::URI&", "uri", "The URI of the reference to add",
                            ", " + lTargetClass.getGID().getId());
@@ -561,14 +602,14 @@ public class FClassDef extends ItemFormatterTask
             boolean lIsUniqueNaming = lTargetClass.getNamingPaths(lNamingPaths, Language.CPP);
             for (List<Pair<String, MNameRule>> lNamingPath : lNamingPaths)
             {
-                genNamedPropMutators(aInIndent, aInClass, lTargetClass, aInPropIdx, lNamingPath, lIsUniqueNaming,
+                genNamedPropMutators(aInIndent, aInClass, lTargetClass, aInPropId, lNamingPath, lIsUniqueNaming,
                                     lName, "Reference", ", " + lTargetClass.getGID().getId());
             }
         }
     }
 
     private void genPropUnset(
-        int aInIndent, MClass aInClass, int aInPropIdx,
+        int aInIndent, MClass aInClass, String aInPropId,
         Collection<String> aInComments, String aInName, String aInPType)
     {
         //
@@ -593,7 +634,7 @@ public class FClassDef extends ItemFormatterTask
         // BODY
         //
         out.println(aInIndent,"{");
-        out.println(aInIndent + 1, "getTLMutator().modify(getClassId(), getURI())->unset(" + toUnsignedStr(aInPropIdx) + ", " +
+        out.println(aInIndent + 1, "getTLMutator().modify(getClassId(), getURI())->unset(" + aInPropId + ", " +
                                    "opflex::modb::PropertyInfo::" + aInPType + ", " +
                                    "opflex::modb::PropertyInfo::SCALAR);");
         out.println(aInIndent + 1, "return *this;");
@@ -602,18 +643,18 @@ public class FClassDef extends ItemFormatterTask
     }
 
     private void genPropUnset(
-        int aInIndent, MClass aInClass, MProp aInProp, int aInPropIdx, MType aInBaseType,
+        int aInIndent, MClass aInClass, MProp aInProp, String aInPropId, MType aInBaseType,
         Collection<String> aInComments)
     {
-        genPropUnset(aInIndent, aInClass, aInPropIdx, aInComments,
+        genPropUnset(aInIndent, aInClass, aInPropId, aInComments,
                      aInProp.getLID().getName(), FMetaDef.getTypeName(aInBaseType));
     }
 
     private void genRefUnset(
-        int aInIndent, MClass aInClass, int aInPropIdx,
+        int aInIndent, MClass aInClass, String aInPropId,
         Collection<String> aInComments)
     {
-        genPropUnset(aInIndent, aInClass, aInPropIdx, aInComments,
+        genPropUnset(aInIndent, aInClass, aInPropId, aInComments,
                      "target", "REFERENCE");
     }
 
@@ -685,6 +726,26 @@ public class FClassDef extends ItemFormatterTask
         out.println(aInIdent, "}");
         out.println();
 
+        String[] lAllComment =
+            {"Retrieve a batch of " + lclassName + " instances from the managed",
+             "object store, locking the store once for the whole batch rather",
+             "than once per object.",
+             "",
+             "@param framework the framework instance to use",
+             "@param uris the URIs of the objects to retrieve",
+             "@param out a shared pointer to each object, in the same order as",
+             "uris, or boost::none if it does not exist."};
+        out.printHeaderComment(aInIdent,lAllComment);
+
+        out.println(aInIdent, "static void resolveAll(");
+        out.println(aInIdent + 1, "opflex::ofcore::OFFramework& framework,");
+        out.println(aInIdent + 1, "const std::vector<opflex::modb::URI>& uris,");
+        out.println(aInIdent + 1, "/* out */ std::vector<boost::optional<std::shared_ptr<" + lFullyQualifiedClassName + "> > >& out)");
+        out.println(aInIdent, "{");
+        out.println(aInIdent + 1, "opflex::modb::mointernal::MO::resolveAll<" + lFullyQualifiedClassName + ">(framework, CLASS_ID, uris, out);");
+        out.println(aInIdent, "}");
+        out.println();
+
         Collection<List<Pair<String, MNameRule>>> lNamingPaths = new LinkedList<>();
         boolean lIsUniqueNaming = aInClass.getNamingPaths(lNamingPaths, Language.CPP);
         for (List<Pair<String, MNameRule>> lNamingPath : lNamingPaths)
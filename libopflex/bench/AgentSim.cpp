@@ -0,0 +1,814 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Simulated agent fleet for scale testing an opflex server
+ *
+ * Copyright (c) 2014 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <uv.h>
+
+#include "opflex/engine/internal/OpflexConnection.h"
+#include "opflex/engine/internal/OpflexHandler.h"
+#include "opflex/engine/internal/OpflexMessage.h"
+#include "opflex/logging/StdErrLogHandler.h"
+#include "opflex/logging/internal/logging.hpp"
+#include "opflex/ofcore/OFConstants.h"
+#include "opflex/yajr/yajr.hpp"
+
+namespace opflex {
+namespace bench {
+
+using engine::internal::HandlerFactory;
+using engine::internal::OpflexConnection;
+using engine::internal::OpflexHandler;
+using engine::internal::OpflexMessage;
+using rapidjson::Value;
+using std::string;
+typedef std::chrono::steady_clock clock_type;
+
+namespace {
+
+// the interval at which each agent issues the operations it owes
+const uint64_t TICK_MS = 100;
+
+/**
+ * The operations a simulated agent issues and times
+ */
+enum SimOp { IDENTITY, RESOLVE, DECLARE, REPORT, NUM_OPS };
+
+const char* const OP_NAMES[NUM_OPS] = {
+    "send_identity", "policy_resolve", "endpoint_declare", "state_report"
+};
+
+/**
+ * The shape and rate of the work of each simulated agent
+ */
+struct SimConfig {
+    SimConfig()
+        : host("127.0.0.1"), port(8009), agents(1000), threads(1),
+          duration(30), ramp(500), resolveRate(1), declareRate(1),
+          reportRate(1), policies(10), endpoints(10), prr(7200),
+          resolveSubject("GbpEpGroup"),
+          resolveUri("/PolicyUniverse/PolicySpace/common/GbpEpGroup/epg%n/") {}
+
+    string host;
+    int port;
+    size_t agents;
+    size_t threads;
+    size_t duration;
+    size_t ramp;
+    double resolveRate;
+    double declareRate;
+    double reportRate;
+    size_t policies;
+    size_t endpoints;
+    int64_t prr;
+    string resolveSubject;
+    string resolveUri;
+};
+
+/**
+ * Counts and latencies of the operations of the agents of one loop.
+ * Only touched from that loop's thread, and merged after it exits.
+ */
+struct SimStats {
+    SimStats() : connected(0), handshakes(0), disconnects(0), updates(0) {
+        for (size_t i = 0; i < NUM_OPS; ++i) {
+            sent[i] = 0;
+            errors[i] = 0;
+        }
+    }
+
+    void merge(SimStats& o) {
+        connected += o.connected;
+        handshakes += o.handshakes;
+        disconnects += o.disconnects;
+        updates += o.updates;
+        for (size_t i = 0; i < NUM_OPS; ++i) {
+            sent[i] += o.sent[i];
+            errors[i] += o.errors[i];
+            latencies[i].insert(latencies[i].end(),
+                                o.latencies[i].begin(),
+                                o.latencies[i].end());
+        }
+    }
+
+    size_t connected;
+    size_t handshakes;
+    size_t disconnects;
+    size_t updates;
+    size_t sent[NUM_OPS];
+    size_t errors[NUM_OPS];
+    std::vector<double> latencies[NUM_OPS];
+};
+
+/**
+ * Substitute %a with the agent index and %n with the object index in
+ * a URI template
+ */
+string expand(const string& tmpl, size_t agent, size_t n) {
+    string result;
+    result.reserve(tmpl.size() + 16);
+    for (size_t i = 0; i < tmpl.size(); ++i) {
+        if (tmpl[i] == '%' && i + 1 < tmpl.size()) {
+            if (tmpl[i + 1] == 'a') {
+                result += std::to_string(agent);
+                i += 1;
+                continue;
+            } else if (tmpl[i + 1] == 'n') {
+                result += std::to_string(n);
+                i += 1;
+                continue;
+            }
+        }
+        result += tmpl[i];
+    }
+    return result;
+}
+
+/**
+ * Format a MAC address unique to the given agent and endpoint
+ */
+string endpointMac(size_t agent, size_t n) {
+    char buf[18];
+    std::snprintf(buf, sizeof(buf), "02:%02x:%02x:%02x:%02x:%02x",
+                  (unsigned)((agent >> 16) & 0xff),
+                  (unsigned)((agent >> 8) & 0xff),
+                  (unsigned)(agent & 0xff),
+                  (unsigned)((n >> 8) & 0xff),
+                  (unsigned)(n & 0xff));
+    return buf;
+}
+
+/**
+ * A request sent by a simulated agent, numbered by the agent so
+ * that its response can be timed
+ */
+class SimReq : public OpflexMessage {
+public:
+    SimReq(const string& method, uint64_t xid_)
+        : OpflexMessage(method, REQUEST), xid(xid_) {}
+
+    virtual void serializePayload(yajr::rpc::SendHandler& writer) const {
+        (*this)(writer);
+    }
+
+    virtual uint64_t getReqXid() const { return xid; }
+
+private:
+    uint64_t xid;
+};
+
+class SimIdentityReq : public SimReq {
+public:
+    SimIdentityReq(uint64_t xid, const string& name_)
+        : SimReq("send_identity", xid), name(name_) {}
+
+    virtual SimIdentityReq* clone() { return new SimIdentityReq(*this); }
+
+    virtual bool operator()(yajr::rpc::SendHandler& writer) const {
+        writer.StartArray();
+        writer.StartObject();
+        writer.String("proto_version");
+        writer.String("1.0");
+        writer.String("name");
+        writer.String(name.c_str());
+        writer.String("domain");
+        writer.String("sim");
+        writer.String("my_role");
+        writer.StartArray();
+        writer.String("policy_element");
+        writer.EndArray();
+        writer.EndObject();
+        writer.EndArray();
+        return true;
+    }
+
+private:
+    string name;
+};
+
+class SimResolveReq : public SimReq {
+public:
+    SimResolveReq(uint64_t xid, const string& subject_, const string& uri_,
+                  int64_t prr_)
+        : SimReq("policy_resolve", xid), subject(subject_), uri(uri_),
+          prr(prr_) {}
+
+    virtual SimResolveReq* clone() { return new SimResolveReq(*this); }
+
+    virtual bool operator()(yajr::rpc::SendHandler& writer) const {
+        writer.StartArray();
+        writer.StartObject();
+        writer.String("subject");
+        writer.String(subject.c_str());
+        writer.String("policy_uri");
+        writer.String(uri.c_str());
+        writer.String("prr");
+        writer.Int64(prr);
+        writer.EndObject();
+        writer.EndArray();
+        return true;
+    }
+
+private:
+    string subject;
+    string uri;
+    int64_t prr;
+};
+
+/**
+ * Write a managed object with a single parent and string properties
+ */
+void writeMO(yajr::rpc::SendHandler& writer, const char* subject,
+             const string& uri, const char* parentSubject,
+             const char* parentUri,
+             const std::vector<std::pair<const char*, string> >& props) {
+    writer.StartObject();
+    writer.String("subject");
+    writer.String(subject);
+    writer.String("uri");
+    writer.String(uri.c_str());
+    writer.String("parent_subject");
+    writer.String(parentSubject);
+    writer.String("parent_uri");
+    writer.String(parentUri);
+    writer.String("parent_relation");
+    writer.String(subject);
+    writer.String("properties");
+    writer.StartArray();
+    for (auto& p : props) {
+        writer.StartObject();
+        writer.String("name");
+        writer.String(p.first);
+        writer.String("data");
+        writer.String(p.second.c_str());
+        writer.EndObject();
+    }
+    writer.EndArray();
+    writer.String("children");
+    writer.StartArray();
+    writer.EndArray();
+    writer.EndObject();
+}
+
+class SimDeclareReq : public SimReq {
+public:
+    SimDeclareReq(uint64_t xid, size_t agent_, size_t n_, int64_t prr_)
+        : SimReq("endpoint_declare", xid), agent(agent_), n(n_),
+          prr(prr_) {}
+
+    virtual SimDeclareReq* clone() { return new SimDeclareReq(*this); }
+
+    virtual bool operator()(yajr::rpc::SendHandler& writer) const {
+        string mac = endpointMac(agent, n);
+        string uuid = "sim-" + std::to_string(agent) + "-" +
+            std::to_string(n);
+        string uri = "/EprL2Universe/EprL2Ep/"
+            "%2fPolicyUniverse%2fPolicySpace%2fcommon%2fGbpBridgeDomain"
+            "%2fbd%2f/" + mac + "/";
+        writer.StartArray();
+        writer.StartObject();
+        writer.String("endpoint");
+        writer.StartArray();
+        writeMO(writer, "EprL2Ep", uri, "EprL2Universe", "/EprL2Universe/",
+                {{"uuid", uuid}, {"mac", mac}});
+        writer.EndArray();
+        writer.String("prr");
+        writer.Int64(prr);
+        writer.EndObject();
+        writer.EndArray();
+        return true;
+    }
+
+private:
+    size_t agent;
+    size_t n;
+    int64_t prr;
+};
+
+class SimReportReq : public SimReq {
+public:
+    SimReportReq(uint64_t xid, size_t agent_, size_t n_)
+        : SimReq("state_report", xid), agent(agent_), n(n_) {}
+
+    virtual SimReportReq* clone() { return new SimReportReq(*this); }
+
+    virtual bool operator()(yajr::rpc::SendHandler& writer) const {
+        string uuid = "sim-" + std::to_string(agent) + "-" +
+            std::to_string(n);
+        writer.StartArray();
+        writer.StartObject();
+        writer.String("observable");
+        writer.StartArray();
+        writeMO(writer, "GbpeEpCounter",
+                "/ObserverEpStatUniverse/GbpeEpCounter/" + uuid + "/",
+                "ObserverEpStatUniverse", "/ObserverEpStatUniverse/",
+                {{"uuid", uuid}});
+        writer.EndArray();
+        writer.EndObject();
+        writer.EndArray();
+        return true;
+    }
+
+private:
+    size_t agent;
+    size_t n;
+};
+
+class SimLoop;
+
+/**
+ * A lightweight simulated agent: a single opflex connection that
+ * handshakes as a policy element and then issues resolves, endpoint
+ * declares and state reports at the configured rates
+ */
+class SimAgent : public OpflexConnection {
+public:
+    SimAgent(HandlerFactory& factory, SimLoop& loop_, size_t index_);
+
+    void start();
+    void stop();
+
+    void sendIdentity();
+    void handshakeDone();
+    void lost();
+    void completed(uint64_t reqId, bool error);
+    void updateReceived();
+
+    virtual const string& getName() { return name; }
+    virtual const string& getDomain() { return domain; }
+    virtual const string& getRemotePeer() { return name; }
+    virtual yajr::Peer* getPeer() { return peer; }
+    // requests are written synchronously from the loop
+    virtual void messagesReady() {}
+
+private:
+    SimLoop& loop;
+    size_t index;
+    string name;
+    string domain;
+    yajr::Peer* peer;
+    uv_timer_t timer;
+    bool ready;
+    uint64_t nextXid;
+    size_t nextPolicy;
+    size_t nextEndpoint;
+    size_t nextReport;
+    double credit[NUM_OPS];
+    std::unordered_map<uint64_t, std::pair<SimOp, clock_type::time_point> >
+        pending;
+
+    void send(SimOp op, SimReq* req);
+    void tick();
+
+    static uv_loop_t* loop_selector(void* data);
+    static void on_state_change(yajr::Peer* p, void* data,
+                                yajr::StateChange::To stateChange,
+                                int error);
+    static void on_timer(uv_timer_t* handle);
+};
+
+class SimHandler : public OpflexHandler {
+public:
+    SimHandler(OpflexConnection* conn) : OpflexHandler(conn) {}
+
+    SimAgent* getAgent() { return (SimAgent*)getConnection(); }
+
+    virtual void connected() {
+        setState(CONNECTED);
+        getAgent()->sendIdentity();
+    }
+    virtual void disconnected() {
+        setState(DISCONNECTED);
+        getAgent()->lost();
+    }
+    virtual void handleSendIdentityRes(uint64_t reqId, const Value&) {
+        setState(READY);
+        getAgent()->completed(reqId, false);
+        getAgent()->handshakeDone();
+    }
+    virtual void handleSendIdentityErr(uint64_t reqId, const Value&) {
+        setState(FAILED);
+        getAgent()->completed(reqId, true);
+    }
+    virtual void handlePolicyResolveRes(uint64_t reqId, const Value&) {
+        getAgent()->completed(reqId, false);
+    }
+    virtual void handlePolicyResolveErr(uint64_t reqId, const Value&) {
+        getAgent()->completed(reqId, true);
+    }
+    virtual void handleEPDeclareRes(uint64_t reqId, const Value&) {
+        getAgent()->completed(reqId, false);
+    }
+    virtual void handleEPDeclareErr(uint64_t reqId, const Value&) {
+        getAgent()->completed(reqId, true);
+    }
+    virtual void handleStateReportRes(uint64_t reqId, const Value&) {
+        getAgent()->completed(reqId, false);
+    }
+    virtual void handleStateReportErr(uint64_t reqId, const Value&) {
+        getAgent()->completed(reqId, true);
+    }
+    virtual void handlePolicyUpdateReq(const Value&, const Value&) {
+        getAgent()->updateReceived();
+    }
+    virtual void handleEPUpdateReq(const Value&, const Value&) {
+        getAgent()->updateReceived();
+    }
+};
+
+class SimHandlerFactory : public HandlerFactory {
+public:
+    virtual OpflexHandler* newHandler(OpflexConnection* conn) {
+        return new SimHandler(conn);
+    }
+};
+
+/**
+ * An event loop thread that runs a share of the agents
+ */
+class SimLoop {
+public:
+    SimLoop(const SimConfig& config_) : config(config_) {}
+
+    void start();
+    void stop();
+
+    /**
+     * Hand an agent over to the loop, which connects it from its
+     * own thread
+     */
+    void add(SimAgent* agent);
+
+    const SimConfig& config;
+    SimStats stats;
+    uv_loop_t loop;
+
+private:
+    std::vector<std::unique_ptr<SimAgent> > agents;
+    std::vector<SimAgent*> added;
+    std::mutex addedMutex;
+    uv_thread_t thread;
+    uv_async_t startAsync;
+    uv_async_t stopAsync;
+
+    static void run(void* data);
+    static void on_start(uv_async_t* handle);
+    static void on_stop(uv_async_t* handle);
+};
+
+SimAgent::SimAgent(HandlerFactory& factory, SimLoop& loop_, size_t index_)
+    : OpflexConnection(factory), loop(loop_), index(index_),
+      name("sim-agent-" + std::to_string(index_)), domain("sim"),
+      peer(NULL), ready(false), nextXid(1), nextPolicy(0),
+      nextEndpoint(0), nextReport(0) {
+    timer = {};
+    for (size_t i = 0; i < NUM_OPS; ++i)
+        credit[i] = 0;
+}
+
+void SimAgent::start() {
+    timer.data = this;
+    uv_timer_init(&loop.loop, &timer);
+    peer = yajr::Peer::create(loop.config.host,
+                              std::to_string(loop.config.port),
+                              on_state_change, this, loop_selector);
+}
+
+void SimAgent::stop() {
+    uv_timer_stop(&timer);
+    uv_close((uv_handle_t*)&timer, NULL);
+    OpflexConnection::disconnect();
+    if (peer) peer->destroy();
+    peer = NULL;
+}
+
+void SimAgent::send(SimOp op, SimReq* req) {
+    pending[req->getReqXid()] = std::make_pair(op, clock_type::now());
+    loop.stats.sent[op] += 1;
+    sendMessage(req, true);
+}
+
+void SimAgent::sendIdentity() {
+    send(IDENTITY, new SimIdentityReq(nextXid++, name));
+}
+
+void SimAgent::handshakeDone() {
+    ready = true;
+    loop.stats.handshakes += 1;
+    uv_timer_start(&timer, on_timer, TICK_MS, TICK_MS);
+}
+
+void SimAgent::lost() {
+    ready = false;
+    pending.clear();
+    uv_timer_stop(&timer);
+}
+
+void SimAgent::completed(uint64_t reqId, bool error) {
+    auto it = pending.find(reqId);
+    if (it == pending.end()) return;
+    SimOp op = it->second.first;
+    if (error) {
+        loop.stats.errors[op] += 1;
+    } else {
+        loop.stats.latencies[op].push_back
+            (std::chrono::duration<double>(clock_type::now() -
+                                           it->second.second).count());
+    }
+    pending.erase(it);
+}
+
+void SimAgent::updateReceived() {
+    loop.stats.updates += 1;
+}
+
+void SimAgent::tick() {
+    const SimConfig& c = loop.config;
+    double secs = TICK_MS / 1000.0;
+    credit[RESOLVE] += c.resolveRate * secs;
+    credit[DECLARE] += c.declareRate * secs;
+    credit[REPORT] += c.reportRate * secs;
+
+    for (; credit[RESOLVE] >= 1 && c.policies > 0; credit[RESOLVE] -= 1) {
+        send(RESOLVE, new SimResolveReq
+             (nextXid++, c.resolveSubject,
+              expand(c.resolveUri, index, nextPolicy), c.prr));
+        nextPolicy = (nextPolicy + 1) % c.policies;
+    }
+    for (; credit[DECLARE] >= 1 && c.endpoints > 0; credit[DECLARE] -= 1) {
+        send(DECLARE, new SimDeclareReq(nextXid++, index, nextEndpoint,
+                                        c.prr));
+        nextEndpoint = (nextEndpoint + 1) % c.endpoints;
+    }
+    for (; credit[REPORT] >= 1 && c.endpoints > 0; credit[REPORT] -= 1) {
+        send(REPORT, new SimReportReq(nextXid++, index, nextReport));
+        nextReport = (nextReport + 1) % c.endpoints;
+    }
+}
+
+uv_loop_t* SimAgent::loop_selector(void* data) {
+    return &((SimAgent*)data)->loop.loop;
+}
+
+void SimAgent::on_state_change(yajr::Peer* p, void* data,
+                               yajr::StateChange::To stateChange,
+                               int error) {
+    SimAgent* agent = (SimAgent*)data;
+    switch (stateChange) {
+    case yajr::StateChange::CONNECT:
+        agent->loop.stats.connected += 1;
+        p->startKeepAlive(10000, 15000, 60000);
+        agent->handler->connected();
+        break;
+    case yajr::StateChange::DISCONNECT:
+        agent->loop.stats.disconnects += 1;
+        agent->handler->disconnected();
+        agent->cleanup();
+        agent->clearPendingRequests();
+        break;
+    case yajr::StateChange::FAILURE:
+        LOG(DEBUG) << "[" << agent->name << "] "
+                   << "Connection error: " << uv_strerror(error);
+        break;
+    default:
+        break;
+    }
+}
+
+void SimAgent::on_timer(uv_timer_t* handle) {
+    ((SimAgent*)handle->data)->tick();
+}
+
+void SimLoop::start() {
+    uv_loop_init(&loop);
+    yajr::initLoop(&loop);
+    startAsync.data = stopAsync.data = this;
+    uv_async_init(&loop, &startAsync, on_start);
+    uv_async_init(&loop, &stopAsync, on_stop);
+    uv_thread_create(&thread, run, this);
+}
+
+void SimLoop::stop() {
+    uv_async_send(&stopAsync);
+    uv_thread_join(&thread);
+    uv_loop_close(&loop);
+    agents.clear();
+    for (SimAgent* a : added)
+        delete a;
+    added.clear();
+}
+
+void SimLoop::add(SimAgent* agent) {
+    {
+        const std::lock_guard<std::mutex> lock(addedMutex);
+        added.push_back(agent);
+    }
+    uv_async_send(&startAsync);
+}
+
+void SimLoop::run(void* data) {
+    SimLoop* sl = (SimLoop*)data;
+    uv_run(&sl->loop, UV_RUN_DEFAULT);
+}
+
+void SimLoop::on_start(uv_async_t* handle) {
+    SimLoop* sl = (SimLoop*)handle->data;
+    std::vector<SimAgent*> toStart;
+    {
+        const std::lock_guard<std::mutex> lock(sl->addedMutex);
+        toStart.swap(sl->added);
+    }
+    for (SimAgent* a : toStart) {
+        sl->agents.emplace_back(a);
+        a->start();
+    }
+}
+
+void SimLoop::on_stop(uv_async_t* handle) {
+    SimLoop* sl = (SimLoop*)handle->data;
+    for (auto& a : sl->agents)
+        a->stop();
+    uv_close((uv_handle_t*)&sl->startAsync, NULL);
+    uv_close((uv_handle_t*)&sl->stopAsync, NULL);
+    yajr::finiLoop(&sl->loop);
+}
+
+double percentile(std::vector<double>& values, double p) {
+    if (values.empty()) return 0;
+    size_t i = std::min(values.size() - 1, (size_t)(p * values.size()));
+    std::nth_element(values.begin(), values.begin() + i, values.end());
+    return values[i];
+}
+
+void report(SimStats& stats, const SimConfig& config, double seconds) {
+    std::printf("{\"name\":\"agents\",\"agents\":%zu,\"connected\":%zu,"
+                "\"handshakes\":%zu,\"disconnects\":%zu,\"updates\":%zu}\n",
+                config.agents, stats.connected, stats.handshakes,
+                stats.disconnects, stats.updates);
+    for (size_t i = 0; i < NUM_OPS; ++i) {
+        std::vector<double>& l = stats.latencies[i];
+        std::printf("{\"name\":\"%s\",\"sent\":%zu,\"ops\":%zu,"
+                    "\"errors\":%zu,\"seconds\":%.3f,\"ops_per_sec\":%.1f,"
+                    "\"p50_us\":%.1f,\"p99_us\":%.1f,\"max_us\":%.1f}\n",
+                    OP_NAMES[i], stats.sent[i], l.size(), stats.errors[i],
+                    seconds, seconds > 0 ? l.size() / seconds : 0,
+                    percentile(l, 0.50) * 1e6, percentile(l, 0.99) * 1e6,
+                    l.empty() ? 0 :
+                    *std::max_element(l.begin(), l.end()) * 1e6);
+    }
+    std::fflush(stdout);
+}
+
+volatile sig_atomic_t interrupted = 0;
+
+void on_signal(int) {
+    interrupted = 1;
+}
+
+} /* anonymous namespace */
+
+} /* namespace bench */
+} /* namespace opflex */
+
+using namespace opflex::bench;
+
+static void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [options]" << std::endl
+              << "  -H host     server to connect to (default 127.0.0.1)"
+              << std::endl
+              << "  -P port     server port (default 8009)" << std::endl
+              << "  -a agents   number of simulated agents (default 1000)"
+              << std::endl
+              << "  -t threads  number of event loop threads (default 1)"
+              << std::endl
+              << "  -d seconds  time to run once connected (default 30)"
+              << std::endl
+              << "  -c rate     agents started per second (default 500)"
+              << std::endl
+              << "  -R rate     policy resolves per second per agent "
+              << "(default 1)" << std::endl
+              << "  -D rate     endpoint declares per second per agent "
+              << "(default 1)" << std::endl
+              << "  -S rate     state reports per second per agent "
+              << "(default 1)" << std::endl
+              << "  -p count    distinct policies each agent resolves "
+              << "(default 10)" << std::endl
+              << "  -e count    endpoints each agent declares (default 10)"
+              << std::endl
+              << "  -s subject  class of the resolved policies "
+              << "(default GbpEpGroup)" << std::endl
+              << "  -u uri      URI template of the resolved policies; "
+              << "%a is replaced" << std::endl
+              << "              with the agent index and %n with the "
+              << "policy index" << std::endl
+              << "Results are written to standard output as one JSON "
+              << "object per line." << std::endl;
+}
+
+int main(int argc, char** argv) {
+    signal(SIGPIPE, SIG_IGN);
+    SimConfig config;
+    for (int i = 1; i < argc; ++i) {
+        bool hasArg = i + 1 < argc;
+        if (std::strcmp(argv[i], "-H") == 0 && hasArg) {
+            config.host = argv[++i];
+        } else if (std::strcmp(argv[i], "-P") == 0 && hasArg) {
+            config.port = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "-a") == 0 && hasArg) {
+            config.agents = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "-t") == 0 && hasArg) {
+            config.threads = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "-d") == 0 && hasArg) {
+            config.duration = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "-c") == 0 && hasArg) {
+            config.ramp = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "-R") == 0 && hasArg) {
+            config.resolveRate = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "-D") == 0 && hasArg) {
+            config.declareRate = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "-S") == 0 && hasArg) {
+            config.reportRate = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "-p") == 0 && hasArg) {
+            config.policies = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "-e") == 0 && hasArg) {
+            config.endpoints = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "-s") == 0 && hasArg) {
+            config.resolveSubject = argv[++i];
+        } else if (std::strcmp(argv[i], "-u") == 0 && hasArg) {
+            config.resolveUri = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (config.agents == 0 || config.threads == 0 || config.ramp == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // keep log output from interfering with the results
+    opflex::logging::StdErrLogHandler
+        logHandler(opflex::logging::OFLogHandler::ERROR);
+    opflex::logging::OFLogHandler::registerHandler(logHandler);
+    signal(SIGINT, on_signal);
+
+    SimHandlerFactory factory;
+    std::vector<std::unique_ptr<SimLoop> > loops;
+    for (size_t i = 0; i < config.threads; ++i) {
+        loops.emplace_back(new SimLoop(config));
+        loops.back()->start();
+    }
+
+    // start the agents in batches so the server is not flooded with
+    // connections all at once
+    clock_type::time_point start = clock_type::now();
+    size_t started = 0;
+    size_t batch = std::max<size_t>(config.ramp * TICK_MS / 1000, 1);
+    while (started < config.agents && !interrupted) {
+        size_t end = std::min(started + batch, config.agents);
+        for (; started < end; ++started) {
+            SimLoop& l = *loops[started % loops.size()];
+            l.add(new SimAgent(factory, l, started));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(TICK_MS));
+    }
+
+    for (size_t s = 0; s < config.duration * 10 && !interrupted; ++s)
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    double seconds =
+        std::chrono::duration<double>(clock_type::now() - start).count();
+
+    SimStats total;
+    for (auto& l : loops) {
+        l->stop();
+        total.merge(l->stats);
+    }
+    report(total, config, seconds);
+    return 0;
+}
@@ -0,0 +1,142 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*!
+ * @file Bench.h
+ * @brief Interface definition file for the benchmark harness
+ */
+/*
+ * Copyright (c) 2014 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#ifndef OPFLEX_BENCH_BENCH_H
+#define OPFLEX_BENCH_BENCH_H
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace opflex {
+namespace bench {
+
+/**
+ * Context passed to each benchmark, used to size the workload and
+ * report the results
+ */
+class BenchContext {
+public:
+    /**
+     * Construct a benchmark context
+     *
+     * @param objects_ the number of objects each benchmark should use
+     */
+    BenchContext(size_t objects_)
+        : objects(objects_), messageSize(64), largeMessageSize(65536),
+          connections(1), window(1) {}
+
+    /**
+     * The number of objects each benchmark should use
+     */
+    const size_t objects;
+
+    /**
+     * The size of the payload of the small messages, in bytes
+     */
+    size_t messageSize;
+
+    /**
+     * The size of the payload of the large messages, in bytes
+     */
+    size_t largeMessageSize;
+
+    /**
+     * The number of concurrent connections for the comms benchmarks
+     */
+    size_t connections;
+
+    /**
+     * The number of requests each connection keeps in flight
+     */
+    size_t window;
+
+    /**
+     * Report a single measurement as one JSON object per line on
+     * standard output
+     *
+     * @param name the name of the measurement
+     * @param ops the number of operations timed
+     * @param seconds the elapsed time in seconds
+     * @param bytes the number of bytes processed, or zero if the
+     * measurement is not a throughput measurement
+     */
+    void report(const std::string& name, size_t ops, double seconds,
+                size_t bytes = 0);
+
+    /**
+     * Report a measurement along with the median and 99th
+     * percentile of the latency of its operations
+     *
+     * @param name the name of the measurement
+     * @param ops the number of operations timed
+     * @param seconds the elapsed time in seconds
+     * @param bytes the number of bytes processed
+     * @param latencies the latency of each operation in seconds;
+     * reordered by the call
+     */
+    void report(const std::string& name, size_t ops, double seconds,
+                size_t bytes, std::vector<double>& latencies);
+};
+
+/**
+ * A simple stopwatch using a monotonic clock
+ */
+class Timer {
+public:
+    Timer() : start(std::chrono::steady_clock::now()) {}
+
+    /**
+     * Get the time elapsed since the timer was created
+     *
+     * @return the elapsed time in seconds
+     */
+    double elapsed() const {
+        return std::chrono::duration<double>
+            (std::chrono::steady_clock::now() - start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start;
+};
+
+/**
+ * A benchmark function
+ */
+typedef std::function<void(BenchContext&)> bench_fn_t;
+
+/**
+ * Register a benchmark.  Registration happens at static
+ * initialization time through a Register instance.
+ */
+class Register {
+public:
+    /**
+     * Register the benchmark with the given name
+     *
+     * @param name the name of the benchmark
+     * @param fn the benchmark function
+     */
+    Register(const std::string& name, bench_fn_t fn);
+
+    /**
+     * Get the registered benchmarks in registration order
+     */
+    static std::vector<std::pair<std::string, bench_fn_t> >& getBenchmarks();
+};
+
+} /* namespace bench */
+} /* namespace opflex */
+
+#endif /* OPFLEX_BENCH_BENCH_H */
@@ -0,0 +1,370 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Benchmarks for the yajr communication layer
+ *
+ * Copyright (c) 2014 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+#include <uv.h>
+
+#include <opflex/yajr/internal/comms.hpp>
+#include <yajr/rpc/methods.hpp>
+#include <yajr/transport/ZeroCopyOpenSSL.hpp>
+
+#include "Bench.h"
+
+namespace opflex {
+namespace bench {
+
+using yajr::transport::ZeroCopyOpenSSL;
+typedef yajr::comms::internal::Peer::LoopData LoopData;
+typedef std::chrono::steady_clock clock_type;
+
+namespace {
+
+enum Transport { TCP, UNIX, TCP_TLS };
+
+const uint16_t BENCH_PORT = 28009;
+const uint64_t BENCH_TIMEOUT_MS = 120000;
+
+/**
+ * An echo request padded with a string of the requested size.  The
+ * peer echoes the whole payload back, and the response reports the
+ * round trip through the RTT callback.
+ */
+class PaddedEcho {
+public:
+    PaddedEcho(uint64_t now_, const std::string& padding_)
+        : now(now_), padding(padding_) {}
+
+    bool operator()(yajr::rpc::SendHandler& handler) const {
+        return handler.StartArray() && handler.Uint64(now) &&
+            handler.String(padding) && handler.EndArray();
+    }
+
+private:
+    uint64_t now;
+    const std::string& padding;
+};
+
+class EchoRun;
+
+struct Connection {
+    EchoRun* run;
+    yajr::Peer* peer;
+    // requests are answered in order, so this holds the send times
+    // of the outstanding requests oldest first
+    std::deque<clock_type::time_point> inflight;
+};
+
+/**
+ * Run a number of echo exchanges between a listener running on its
+ * own thread and a set of client connections on the calling thread
+ */
+class EchoRun {
+public:
+    EchoRun(BenchContext& ctx, Transport transport_, size_t size,
+            size_t total_)
+        : total(total_), completed(0), seconds(0),
+          transport(transport_), padding(size, 'x'),
+          conns(ctx.connections), window(ctx.window), connected(0),
+          sent(0), stopping(false), failed(false) {
+        latencies.reserve(total);
+        for (Connection& c : conns) {
+            c.run = this;
+            c.peer = NULL;
+        }
+    }
+
+    bool run();
+
+    const size_t total;
+    size_t completed;
+    double seconds;
+    std::vector<double> latencies;
+
+private:
+    Transport transport;
+    std::string padding;
+    std::vector<Connection> conns;
+    size_t window;
+    size_t connected;
+    size_t sent;
+    bool stopping;
+    bool failed;
+    std::string socketPath;
+    clock_type::time_point start;
+
+    uv_loop_t serverLoop;
+    uv_loop_t clientLoop;
+    uv_thread_t serverThread;
+    uv_async_t serverStop;
+    uv_async_t clientStop;
+    uv_timer_t timer;
+    std::unique_ptr<ZeroCopyOpenSSL::Ctx> serverCtx;
+    std::unique_ptr<ZeroCopyOpenSSL::Ctx> clientCtx;
+
+    void startSending();
+    void sendEcho(Connection& c);
+    void stop(bool error);
+
+    static void serverThreadFunc(void* run_);
+    static uv_loop_t* serverLoopSelector(void* data);
+    static uv_loop_t* clientLoopSelector(void* data);
+    static void* onAccept(yajr::Listener*, void* data, int error);
+    static void onServerState(yajr::Peer* p, void* data,
+                              yajr::StateChange::To stateChange, int error);
+    static void onClientState(yajr::Peer* p, void* data,
+                              yajr::StateChange::To stateChange, int error);
+    static void onRtt(yajr::Peer* p, void* data, uint64_t rtt);
+    static void onServerStop(uv_async_t* handle);
+    static void onClientStop(uv_async_t* handle);
+    static void onTimeout(uv_timer_t* handle);
+};
+
+bool EchoRun::run() {
+    bool tls = transport == TCP_TLS;
+    if (tls) {
+        ZeroCopyOpenSSL::initOpenSSL(true);
+        serverCtx.reset(ZeroCopyOpenSSL::Ctx::createCtx
+                        (NULL, COMMS_TEST_DIR "/server.pem", "password123"));
+        clientCtx.reset(ZeroCopyOpenSSL::Ctx::createCtx
+                        (COMMS_TEST_DIR "/ca.pem", NULL, NULL, true));
+        if (!serverCtx || !clientCtx) {
+            std::cerr << "Could not create the SSL contexts" << std::endl;
+            ZeroCopyOpenSSL::finiOpenSSL();
+            return false;
+        }
+    }
+    if (transport == UNIX) {
+        socketPath = "/tmp/opflex_bench_" + std::to_string(getpid()) +
+            ".sock";
+        unlink(socketPath.c_str());
+    }
+
+    uv_loop_init(&serverLoop);
+    yajr::initLoop(&serverLoop);
+    serverStop.data = this;
+    uv_async_init(&serverLoop, &serverStop, onServerStop);
+    if (transport == UNIX)
+        yajr::Listener::create(socketPath, onServerState, onAccept, this,
+                               &serverLoop, serverLoopSelector);
+    else
+        yajr::Listener::create("127.0.0.1", BENCH_PORT, onServerState,
+                               onAccept, this, &serverLoop,
+                               serverLoopSelector);
+    uv_thread_create(&serverThread, serverThreadFunc, this);
+
+    for (size_t i = 0; i < 5000; ++i) {
+        if (LoopData::getPeerCount(&serverLoop, LoopData::LISTENING) != 0)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    uv_loop_init(&clientLoop);
+    yajr::initLoop(&clientLoop);
+    clientStop.data = timer.data = this;
+    uv_async_init(&clientLoop, &clientStop, onClientStop);
+    uv_timer_init(&clientLoop, &timer);
+    uv_timer_start(&timer, onTimeout, BENCH_TIMEOUT_MS, 0);
+
+    for (Connection& c : conns) {
+        if (transport == UNIX)
+            c.peer = yajr::Peer::create(socketPath, onClientState, &c,
+                                        clientLoopSelector);
+        else
+            c.peer = yajr::Peer::create("127.0.0.1",
+                                        std::to_string(BENCH_PORT),
+                                        onClientState, &c,
+                                        clientLoopSelector);
+        if (tls && !ZeroCopyOpenSSL::attachTransport(c.peer,
+                                                     clientCtx.get()))
+            failed = true;
+    }
+
+    uv_run(&clientLoop, UV_RUN_DEFAULT);
+    uv_loop_close(&clientLoop);
+
+    uv_async_send(&serverStop);
+    uv_thread_join(&serverThread);
+    uv_loop_close(&serverLoop);
+
+    if (transport == UNIX)
+        unlink(socketPath.c_str());
+    if (tls) {
+        serverCtx.reset();
+        clientCtx.reset();
+        ZeroCopyOpenSSL::finiOpenSSL();
+    }
+    return !failed && completed == total;
+}
+
+void EchoRun::startSending() {
+    start = clock_type::now();
+    for (Connection& c : conns) {
+        for (size_t i = 0; i < window && sent < total; ++i)
+            sendEcho(c);
+    }
+}
+
+void EchoRun::sendEcho(Connection& c) {
+    c.inflight.push_back(clock_type::now());
+    sent += 1;
+    yajr::rpc::OutReq<&yajr::rpc::method::echo>
+        (PaddedEcho(uv_now(&clientLoop), padding), c.peer).send();
+}
+
+void EchoRun::stop(bool error) {
+    failed = failed || error;
+    if (stopping) return;
+    stopping = true;
+    // called from the callbacks of the peers, so tear them down from
+    // the next iteration of the loop
+    uv_async_send(&clientStop);
+}
+
+void EchoRun::serverThreadFunc(void* run_) {
+    EchoRun* run = (EchoRun*)run_;
+    uv_run(&run->serverLoop, UV_RUN_DEFAULT);
+}
+
+uv_loop_t* EchoRun::serverLoopSelector(void* data) {
+    return &((EchoRun*)data)->serverLoop;
+}
+
+uv_loop_t* EchoRun::clientLoopSelector(void* data) {
+    return &((Connection*)data)->run->clientLoop;
+}
+
+void* EchoRun::onAccept(yajr::Listener*, void* data, int error) {
+    return error ? NULL : data;
+}
+
+void EchoRun::onServerState(yajr::Peer* p, void* data,
+                            yajr::StateChange::To stateChange, int error) {
+    EchoRun* run = (EchoRun*)data;
+    if (stateChange == yajr::StateChange::CONNECT && run->serverCtx)
+        ZeroCopyOpenSSL::attachTransport(p, run->serverCtx.get());
+}
+
+void EchoRun::onClientState(yajr::Peer* p, void* data,
+                            yajr::StateChange::To stateChange, int error) {
+    Connection* c = (Connection*)data;
+    EchoRun* run = c->run;
+    switch (stateChange) {
+    case yajr::StateChange::CONNECT:
+        p->setRttCallback(onRtt);
+        run->connected += 1;
+        if (run->connected == run->conns.size())
+            run->startSending();
+        break;
+    case yajr::StateChange::DISCONNECT:
+    case yajr::StateChange::TRANSPORT_FAILURE:
+        if (!run->stopping) {
+            std::cerr << "Connection lost: " << uv_strerror(error)
+                      << std::endl;
+            run->stop(true);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void EchoRun::onRtt(yajr::Peer* p, void* data, uint64_t) {
+    Connection* c = (Connection*)data;
+    EchoRun* run = c->run;
+    if (c->inflight.empty() || run->stopping) return;
+
+    clock_type::time_point now = clock_type::now();
+    run->latencies.push_back(std::chrono::duration<double>
+                             (now - c->inflight.front()).count());
+    c->inflight.pop_front();
+    run->completed += 1;
+    if (run->completed == run->total) {
+        run->seconds = std::chrono::duration<double>(now - run->start).count();
+        run->stop(false);
+    } else if (run->sent < run->total) {
+        run->sendEcho(*c);
+    }
+}
+
+void EchoRun::onServerStop(uv_async_t* handle) {
+    EchoRun* run = (EchoRun*)handle->data;
+    uv_close((uv_handle_t*)handle, NULL);
+    yajr::finiLoop(&run->serverLoop);
+}
+
+void EchoRun::onClientStop(uv_async_t* handle) {
+    EchoRun* run = (EchoRun*)handle->data;
+    uv_timer_stop(&run->timer);
+    uv_close((uv_handle_t*)&run->timer, NULL);
+    uv_close((uv_handle_t*)handle, NULL);
+    yajr::finiLoop(&run->clientLoop);
+}
+
+void EchoRun::onTimeout(uv_timer_t* handle) {
+    EchoRun* run = (EchoRun*)handle->data;
+    std::cerr << "Timed out after " << run->completed << " of "
+              << run->total << " requests" << std::endl;
+    run->stop(true);
+}
+
+void runEcho(BenchContext& ctx, Transport transport,
+             const std::string& name, size_t size, size_t total) {
+    EchoRun run(ctx, transport, size, total);
+    if (!run.run()) {
+        std::cerr << name << " failed" << std::endl;
+        return;
+    }
+    // the payload crosses the connection in both directions
+    ctx.report(name, run.completed, run.seconds,
+               2 * size * run.completed, run.latencies);
+}
+
+void benchComms(BenchContext& ctx, Transport transport,
+                const std::string& name) {
+    runEcho(ctx, transport, name + "_echo", ctx.messageSize, ctx.objects);
+    runEcho(ctx, transport, name + "_large", ctx.largeMessageSize,
+            std::max<size_t>(ctx.objects / 10, 1));
+}
+
+void benchTcp(BenchContext& ctx) {
+    benchComms(ctx, TCP, "comms_tcp");
+}
+
+void benchUnix(BenchContext& ctx) {
+    benchComms(ctx, UNIX, "comms_unix");
+}
+
+void benchTls(BenchContext& ctx) {
+    benchComms(ctx, TCP_TLS, "comms_tls");
+}
+
+Register tcp("comms_tcp", benchTcp);
+Register unixSocket("comms_unix", benchUnix);
+Register tls("comms_tls", benchTls);
+
+} /* anonymous namespace */
+
+} /* namespace bench */
+} /* namespace opflex */
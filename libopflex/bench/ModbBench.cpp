@@ -0,0 +1,216 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Benchmarks for the managed object database
+ *
+ * Copyright (c) 2014 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <atomic>
+#include <thread>
+
+#include "opflex/modb/URIBuilder.h"
+#include "opflex/modb/Mutator.h"
+#include "opflex/ofcore/OFFramework.h"
+
+#include "BaseFixture.h"
+#include "Bench.h"
+
+namespace opflex {
+namespace bench {
+
+using namespace modb;
+using mointernal::ObjectInstance;
+
+namespace {
+
+// results are accumulated here so the timed work is not optimized out
+volatile size_t sink;
+
+void makeURIs(size_t count, /* out */ std::vector<URI>& uris) {
+    uris.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+        uris.push_back(URIBuilder().addElement("class2")
+                       .addElement((int64_t)i).build());
+}
+
+void benchRegion(BenchContext& ctx) {
+    BaseFixture f;
+    std::vector<URI> uris;
+    makeURIs(ctx.objects, uris);
+
+    {
+        Timer t;
+        for (size_t i = 0; i < uris.size(); ++i) {
+            std::shared_ptr<ObjectInstance> oi =
+                std::make_shared<ObjectInstance>(2);
+            oi->setInt64(4, (int64_t)i);
+            f.client1->put(2, uris[i], oi);
+        }
+        ctx.report("region_put", uris.size(), t.elapsed());
+    }
+    {
+        Timer t;
+        size_t found = 0;
+        for (const URI& uri : uris) {
+            std::shared_ptr<const ObjectInstance> oi;
+            if (f.client1->get(2, uri, oi)) ++found;
+        }
+        ctx.report("region_get", found, t.elapsed());
+    }
+}
+
+// readers and the region owner contending for the region lock.  The
+// lock prefers writers, but a writer still waits for the readers that
+// hold the lock and new readers wait behind a waiting writer, which
+// shows up in the tail latency of both.
+void benchRegionContended(BenchContext& ctx) {
+    static const size_t READERS = 3;
+    BaseFixture f;
+    std::vector<URI> uris;
+    makeURIs(ctx.objects, uris);
+    for (const URI& uri : uris)
+        f.client1->put(2, uri, std::make_shared<ObjectInstance>(2));
+
+    std::vector<std::vector<double> > readLatencies(READERS);
+    std::vector<double> writeLatencies;
+    writeLatencies.reserve(uris.size());
+    std::atomic<bool> go(false);
+
+    Timer t;
+    std::vector<std::thread> readers;
+    for (size_t r = 0; r < READERS; ++r) {
+        readers.emplace_back([&, r]() {
+                std::vector<double>& lat = readLatencies[r];
+                lat.reserve(uris.size());
+                while (!go) std::this_thread::yield();
+                for (size_t i = 0; i < uris.size(); ++i) {
+                    std::shared_ptr<const ObjectInstance> oi;
+                    Timer op;
+                    f.client1->get(2, uris[(i + r) % uris.size()], oi);
+                    lat.push_back(op.elapsed());
+                }
+            });
+    }
+    go = true;
+    for (size_t i = 0; i < uris.size(); ++i) {
+        std::shared_ptr<ObjectInstance> oi =
+            std::make_shared<ObjectInstance>(2);
+        oi->setInt64(4, (int64_t)i);
+        Timer op;
+        f.client1->put(2, uris[i], oi);
+        writeLatencies.push_back(op.elapsed());
+    }
+    double writeTime = t.elapsed();
+    for (std::thread& r : readers)
+        r.join();
+    double readTime = t.elapsed();
+
+    std::vector<double> all;
+    for (std::vector<double>& lat : readLatencies)
+        all.insert(all.end(), lat.begin(), lat.end());
+    ctx.report("region_contended_get", all.size(), readTime, 0, all);
+    ctx.report("region_contended_put", writeLatencies.size(), writeTime,
+               0, writeLatencies);
+}
+
+void benchCommit(BenchContext& ctx) {
+    modb::MDFixture md;
+    ofcore::MockOFFramework framework;
+    framework.setModel(md.md);
+    framework.start();
+
+    std::vector<URI> uris;
+    makeURIs(ctx.objects, uris);
+
+    // commits of increasing size over the same set of objects
+    for (size_t batch : { (size_t)1, (size_t)10, (size_t)100 }) {
+        if (batch > uris.size()) break;
+        size_t commits = uris.size() / batch;
+        Timer t;
+        for (size_t c = 0; c < commits; ++c) {
+            Mutator mutator(framework, "owner1");
+            for (size_t i = c * batch; i < (c + 1) * batch; ++i)
+                mutator.modify(2, uris[i])->setInt64(4, (int64_t)(i + batch));
+            mutator.commit();
+        }
+        ctx.report("mutator_commit_" + std::to_string(batch),
+                   commits, t.elapsed());
+    }
+    framework.stop();
+}
+
+class CountingListener : public ObjectListener {
+public:
+    CountingListener() : count(0) {}
+    virtual void objectUpdated(class_id_t, const URI&) { ++count; }
+    std::atomic<size_t> count;
+};
+
+void benchNotify(BenchContext& ctx) {
+    BaseFixture f;
+    CountingListener listener;
+    f.db.registerListener(2, &listener);
+
+    std::vector<URI> uris;
+    makeURIs(ctx.objects, uris);
+    for (const URI& uri : uris)
+        f.client1->put(2, uri, std::make_shared<ObjectInstance>(2));
+
+    Timer t;
+    mointernal::StoreClient::notif_t notifs;
+    for (const URI& uri : uris)
+        f.client1->queueNotification(2, uri, notifs);
+    f.client1->deliverNotifications(notifs);
+    while (listener.count < uris.size())
+        std::this_thread::yield();
+    ctx.report("notify_dispatch", listener.count, t.elapsed());
+    f.db.unregisterListener(2, &listener);
+}
+
+void benchURI(BenchContext& ctx) {
+    std::vector<std::string> strs;
+    strs.reserve(ctx.objects);
+    for (size_t i = 0; i < ctx.objects; ++i)
+        strs.push_back("/PolicyUniverse/PolicySpace/common/GbpEpGroup/epg" +
+                       std::to_string(i) + "/");
+
+    {
+        Timer t;
+        size_t h = 0;
+        for (const std::string& s : strs)
+            h ^= std::hash<URI>()(URI(s));
+        ctx.report("uri_construct_hash", strs.size(), t.elapsed());
+        sink = h;
+    }
+    {
+        Timer t;
+        size_t n = 0;
+        for (size_t i = 0; i < ctx.objects; ++i) {
+            URI u = URIBuilder().addElement("PolicyUniverse")
+                .addElement("PolicySpace").addElement("common")
+                .addElement("GbpEpGroup").addElement((uint64_t)i).build();
+            n += u.toString().size();
+        }
+        ctx.report("uri_build", ctx.objects, t.elapsed(), n);
+    }
+}
+
+Register region("region", benchRegion);
+Register regionContended("region_contended", benchRegionContended);
+Register commit("mutator_commit", benchCommit);
+Register notify("notify_dispatch", benchNotify);
+Register uri("uri", benchURI);
+
+} /* anonymous namespace */
+
+} /* namespace bench */
+} /* namespace opflex */
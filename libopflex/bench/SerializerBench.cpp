@@ -0,0 +1,85 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Benchmarks for the managed object serializer
+ *
+ * Copyright (c) 2014 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "opflex/engine/internal/MOSerializer.h"
+#include "opflex/modb/URIBuilder.h"
+
+#include "BaseFixture.h"
+#include "Bench.h"
+
+namespace opflex {
+namespace bench {
+
+using namespace modb;
+using engine::internal::MOSerializer;
+using mointernal::ObjectInstance;
+
+namespace {
+
+void benchSerializer(BenchContext& ctx) {
+    BaseFixture f;
+    MOSerializer serializer(&f.db);
+
+    URI root("/");
+    std::shared_ptr<ObjectInstance> oi(new ObjectInstance(1));
+    oi->setUInt64(1, 42);
+    oi->addString(2, "test1");
+    f.client1->put(1, root, oi);
+    for (size_t i = 0; i < ctx.objects; ++i) {
+        URI uri(URIBuilder().addElement("class2")
+                .addElement((int64_t)i).build());
+        std::shared_ptr<ObjectInstance> child(new ObjectInstance(2));
+        child->setInt64(4, (int64_t)i);
+        child->setMAC(15, MAC("aa:bb:cc:dd:ee:ff"));
+        f.client1->put(2, uri, child);
+        f.client1->addChild(1, root, 3, 2, uri);
+    }
+
+    rapidjson::StringBuffer buffer;
+    {
+        Timer t;
+        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+        writer.StartArray();
+        serializer.serialize(1, root, *f.client1, writer, true);
+        writer.EndArray();
+        ctx.report("mo_serialize", ctx.objects + 1, t.elapsed(),
+                   buffer.GetSize());
+    }
+    {
+        util::ThreadManager threadManager;
+        ObjectStore db(threadManager);
+        db.init(f.md);
+        db.start();
+        MOSerializer target(&db);
+        mointernal::StoreClient& client = db.getStoreClient("owner1");
+
+        Timer t;
+        rapidjson::Document d;
+        d.Parse(buffer.GetString());
+        for (rapidjson::SizeType i = 0; i < d.Size(); ++i)
+            target.deserialize(d[i], client, true);
+        ctx.report("mo_deserialize", d.Size(), t.elapsed(),
+                   buffer.GetSize());
+        db.stop();
+    }
+}
+
+Register serializer("mo_serializer", benchSerializer);
+
+} /* anonymous namespace */
+
+} /* namespace bench */
+} /* namespace opflex */
@@ -0,0 +1,214 @@
+#!/usr/bin/env python3
+#
+# libopflex: a framework for developing opflex-based policy agents
+# Copyright (c) 2014 Cisco Systems, Inc. and others.  All rights reserved.
+#
+# This program and the accompanying materials are made available under the
+# terms of the Eclipse Public License v1.0 which accompanies this distribution,
+# and is available at http://www.eclipse.org/legal/epl-v10.html
+#
+"""Collect benchmark results and compare them against a baseline.
+
+The benchmark programs write one JSON object per line.  "collect"
+validates those lines, takes the median of the runs of each
+measurement and writes a results document:
+
+  {"schema": "opflex-bench/1",
+   "suite": "libopflex",
+   "params": {"objects": "10000", ...},
+   "results": {"region_put": {"runs": 3, "ops": 10000,
+                              "ops_per_sec": 1234567.8, ...}, ...}}
+
+Each measurement has "ops" and "seconds", and may have any of the
+metrics in METRICS.  "compare" checks a results document against a
+baseline document of the same schema and suite, and exits with status
+1 if any metric is worse than the baseline by more than its threshold.
+"""
+
+import argparse
+import fnmatch
+import json
+import platform
+import statistics
+import sys
+
+SCHEMA = "opflex-bench/1"
+
+# the metrics that are compared, and whether higher values are better
+METRICS = {
+    "ops_per_sec": True,
+    "mb_per_sec": True,
+    "p50_us": False,
+    "p99_us": False,
+    "max_ms": False,
+    "max_rss_kb": False,
+}
+
+NUMBER = (int, float)
+
+
+def parse_line(line, where):
+    try:
+        r = json.loads(line)
+    except ValueError as e:
+        raise ValueError("%s: not JSON: %s" % (where, e))
+    if not isinstance(r, dict):
+        raise ValueError("%s: not a JSON object" % where)
+    if not isinstance(r.get("name"), str) or not r["name"]:
+        raise ValueError("%s: missing name" % where)
+    for field in ("ops", "seconds"):
+        if not isinstance(r.get(field), NUMBER):
+            raise ValueError("%s: missing %s" % (where, field))
+    for field, value in r.items():
+        if field != "name" and not isinstance(value, NUMBER):
+            raise ValueError("%s: %s is not a number" % (where, field))
+    return r
+
+
+def collect(args):
+    runs = {}
+    for path in args.input:
+        f = sys.stdin if path == "-" else open(path)
+        with f:
+            for n, line in enumerate(f, 1):
+                line = line.strip()
+                if not line:
+                    continue
+                r = parse_line(line, "%s:%d" % (path, n))
+                runs.setdefault(r.pop("name"), []).append(r)
+
+    results = {}
+    for name, rs in runs.items():
+        fields = set().union(*rs)
+        m = {"runs": len(rs)}
+        for field in sorted(fields):
+            values = [r[field] for r in rs if field in r]
+            m[field] = statistics.median(values)
+        results[name] = m
+
+    params = {}
+    for p in args.param or []:
+        key, _, value = p.partition("=")
+        params[key] = value
+
+    doc = {
+        "schema": SCHEMA,
+        "suite": args.suite,
+        "host": platform.node(),
+        "params": params,
+        "results": results,
+    }
+    out = sys.stdout if args.output == "-" else open(args.output, "w")
+    with out:
+        json.dump(doc, out, indent=1, sort_keys=True)
+        out.write("\n")
+    return 0
+
+
+def load(path):
+    with open(path) as f:
+        doc = json.load(f)
+    if doc.get("schema") != SCHEMA:
+        raise ValueError("%s: unknown schema %r" % (path, doc.get("schema")))
+    return doc
+
+
+def threshold_for(name, metric, default, thresholds):
+    # the longest matching pattern wins, so that specific entries
+    # override general ones
+    best = None
+    for pattern, value in thresholds.items():
+        if fnmatch.fnmatchcase(name + "." + metric, pattern) or \
+           fnmatch.fnmatchcase(name, pattern):
+            if best is None or len(pattern) > len(best[0]):
+                best = (pattern, value)
+    return best[1] if best else default
+
+
+def compare(args):
+    current = load(args.results)
+    baseline = load(args.baseline)
+    if current.get("suite") != baseline.get("suite"):
+        raise ValueError("Results of suite %r cannot be compared with "
+                         "a baseline of suite %r" %
+                         (current.get("suite"), baseline.get("suite")))
+    if current.get("params") != baseline.get("params"):
+        print("warning: the parameters differ from those of the baseline",
+              file=sys.stderr)
+
+    thresholds = {}
+    if args.thresholds:
+        with open(args.thresholds) as f:
+            thresholds = json.load(f)
+
+    regressions = 0
+    base = baseline["results"]
+    for name, m in sorted(current["results"].items()):
+        if name not in base:
+            print("%-40s new" % name)
+            continue
+        for metric, higher in sorted(METRICS.items()):
+            if metric not in m or metric not in base[name]:
+                continue
+            old = base[name][metric]
+            new = m[metric]
+            if old == 0:
+                continue
+            change = (new - old) * 100.0 / old
+            worse = -change if higher else change
+            limit = threshold_for(name, metric, args.threshold, thresholds)
+            status = "ok"
+            if worse > limit:
+                status = "REGRESSION"
+                regressions += 1
+            elif -worse > limit:
+                status = "improved"
+            print("%-40s %-12s %14.1f %14.1f %+7.1f%% %s" %
+                  (name, metric, old, new, change, status))
+    for name in sorted(set(base) - set(current["results"])):
+        print("%-40s missing" % name)
+
+    if regressions:
+        print("%d metrics regressed by more than the threshold" %
+              regressions, file=sys.stderr)
+        return 1
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    sub = parser.add_subparsers(dest="command")
+    sub.required = True
+
+    c = sub.add_parser("collect", help="collect benchmark output")
+    c.add_argument("input", nargs="*", default=["-"],
+                   help="files of JSON lines, or - for standard input")
+    c.add_argument("-o", "--output", default="-",
+                   help="the results document to write")
+    c.add_argument("-s", "--suite", required=True,
+                   help="the name of the benchmark suite")
+    c.add_argument("-p", "--param", action="append",
+                   help="a name=value parameter of the run")
+    c.set_defaults(func=collect)
+
+    p = sub.add_parser("compare", help="compare results with a baseline")
+    p.add_argument("results", help="the results document")
+    p.add_argument("baseline", help="the baseline results document")
+    p.add_argument("-t", "--threshold", type=float, default=10.0,
+                   help="the percentage by which a metric may be worse "
+                   "than the baseline (default 10)")
+    p.add_argument("-T", "--thresholds",
+                   help="a JSON object mapping patterns of measurement "
+                   "names, or of name.metric, to thresholds")
+    p.set_defaults(func=compare)
+
+    args = parser.parse_args()
+    try:
+        return args.func(args)
+    except (IOError, ValueError) as e:
+        print("error: %s" % e, file=sys.stderr)
+        return 2
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,148 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Benchmark driver for libopflex
+ *
+ * Copyright (c) 2014 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <set>
+
+#include "opflex/logging/StdErrLogHandler.h"
+
+#include "Bench.h"
+
+using namespace opflex::bench;
+
+namespace opflex {
+namespace bench {
+
+static void printResult(const std::string& name, size_t ops,
+                        double seconds, size_t bytes) {
+    std::printf("{\"name\":\"%s\",\"ops\":%zu,\"seconds\":%.6f,"
+                "\"ops_per_sec\":%.1f", name.c_str(), ops, seconds,
+                seconds > 0 ? ops / seconds : 0);
+    if (bytes > 0)
+        std::printf(",\"bytes\":%zu,\"mb_per_sec\":%.3f", bytes,
+                    seconds > 0 ? bytes / seconds / (1024 * 1024) : 0);
+}
+
+static double percentile(std::vector<double>& values, double p) {
+    if (values.empty()) return 0;
+    size_t i = std::min(values.size() - 1, (size_t)(p * values.size()));
+    std::nth_element(values.begin(), values.begin() + i, values.end());
+    return values[i];
+}
+
+void BenchContext::report(const std::string& name, size_t ops,
+                          double seconds, size_t bytes) {
+    printResult(name, ops, seconds, bytes);
+    std::printf("}\n");
+    std::fflush(stdout);
+}
+
+void BenchContext::report(const std::string& name, size_t ops,
+                          double seconds, size_t bytes,
+                          std::vector<double>& latencies) {
+    printResult(name, ops, seconds, bytes);
+    std::printf(",\"p50_us\":%.1f,\"p99_us\":%.1f}\n",
+                percentile(latencies, 0.50) * 1e6,
+                percentile(latencies, 0.99) * 1e6);
+    std::fflush(stdout);
+}
+
+Register::Register(const std::string& name, bench_fn_t fn) {
+    getBenchmarks().push_back(std::make_pair(name, fn));
+}
+
+std::vector<std::pair<std::string, bench_fn_t> >& Register::getBenchmarks() {
+    static std::vector<std::pair<std::string, bench_fn_t> > benchmarks;
+    return benchmarks;
+}
+
+} /* namespace bench */
+} /* namespace opflex */
+
+static void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [-n objects] [-s size] [-S size] "
+              << "[-c connections] [-w window] [-l] [benchmark...]"
+              << std::endl
+              << "  -n objects  number of objects per benchmark "
+              << "(default 10000)" << std::endl
+              << "  -s size     payload size of the small comms messages "
+              << "(default 64)" << std::endl
+              << "  -S size     payload size of the large comms messages "
+              << "(default 65536)" << std::endl
+              << "  -c conns    number of concurrent comms connections "
+              << "(default 1)" << std::endl
+              << "  -w window   requests in flight per comms connection "
+              << "(default 1)" << std::endl
+              << "  -l          list the available benchmarks" << std::endl
+              << "Results are written to standard output as one JSON "
+              << "object per line." << std::endl;
+}
+
+int main(int argc, char** argv) {
+    size_t objects = 10000;
+    size_t messageSize = 64;
+    size_t largeMessageSize = 65536;
+    size_t connections = 1;
+    size_t window = 1;
+    std::set<std::string> selected;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            objects = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            messageSize = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "-S") == 0 && i + 1 < argc) {
+            largeMessageSize = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            connections = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            window = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "-l") == 0) {
+            for (auto& b : Register::getBenchmarks())
+                std::cout << b.first << std::endl;
+            return 0;
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            selected.insert(argv[i]);
+        }
+    }
+    if (objects == 0 || connections == 0 || window == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // keep log output from interfering with the results
+    opflex::logging::StdErrLogHandler
+        logHandler(opflex::logging::OFLogHandler::ERROR);
+    opflex::logging::OFLogHandler::registerHandler(logHandler);
+
+    BenchContext ctx(objects);
+    ctx.messageSize = messageSize;
+    ctx.largeMessageSize = largeMessageSize;
+    ctx.connections = connections;
+    ctx.window = window;
+    for (auto& b : Register::getBenchmarks()) {
+        if (!selected.empty() && selected.find(b.first) == selected.end())
+            continue;
+        b.second(ctx);
+    }
+    return 0;
+}
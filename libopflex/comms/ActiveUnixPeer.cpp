@@ -71,17 +71,28 @@ void ::yajr::comms::internal::ActiveUnixPeer::retry() {
         getLoopData()->up();
     }
 
-    /* uv_pipe_connect errors are always asynchronous */
-    uv_pipe_connect(&connect_req_,
-                    reinterpret_cast<uv_pipe_t *>(getHandle()),
-                    socketName_.c_str(),
-                    on_active_connection);
-    /* workaround for libuv synchronous uv_pipe_connect() failures bug */
-    getLoopData()->kickLibuv();
+    if (!seqPacket_) {
+        /* uv_pipe_connect errors are always asynchronous */
+        uv_pipe_connect(&connect_req_,
+                        reinterpret_cast<uv_pipe_t *>(getHandle()),
+                        socketName_.c_str(),
+                        on_active_connection);
+        /* workaround for libuv synchronous uv_pipe_connect() failures bug */
+        getLoopData()->kickLibuv();
+    }
 
     up();
     status_ = internal::Peer::kPS_CONNECTING;
     insert(internal::Peer::LoopData::ATTEMPTING_TO_CONNECT);
+
+    if (seqPacket_) {
+        /* UNIX sockets connect at once, so there is no need to wait */
+        connect_req_.handle = reinterpret_cast<uv_stream_t *>(getHandle());
+        on_active_connection(&connect_req_,
+                transport::SeqPacket::connect(
+                    reinterpret_cast<uv_pipe_t *>(getHandle()),
+                    socketName_.c_str()));
+    }
 }
 
 
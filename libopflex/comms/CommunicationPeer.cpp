@@ -12,12 +12,16 @@
 #endif
 
 #include <cstdlib>
+#include <cstring>
+#include <new>
+#include <yajr/rpc/cbor_reader.hpp>
 #include <yajr/rpc/gen/echo.hpp>
-#include <yajr/rpc/internal/json_stream_wrappers.hpp>
 #include <yajr/rpc/methods.hpp>
 
 #include <rapidjson/error/en.h>
 
+#include <zlib.h>
+
 template<>
 int yajr::AsyncDocumentParser<>::instance_count_ = 0;
 
@@ -88,17 +92,27 @@ void CommunicationPeer::startKeepAlive(
     bumpLastHeard();
 
     keepAliveInterval_ = timeoutAfter;
-    uv_timer_start(&keepAliveTimer_, on_timeout, begin, repeat);
+    keepAliveRepeat_ = repeat;
+
+    getLoopData()->cancelKeepAlive(this);
+    keepAliveDeadline_ = now() + begin;
+    getLoopData()->scheduleKeepAlive(this, keepAliveDeadline_);
 }
 
 void CommunicationPeer::stopKeepAlive() {
     LOG(DEBUG)<< this;
-    uv_timer_stop(&keepAliveTimer_);
+    getLoopData()->cancelKeepAlive(this);
     keepAliveInterval_ = 0;
 }
 
-void CommunicationPeer::on_timeout(uv_timer_t * timer) {
-    get(timer)->timeout();
+void CommunicationPeer::onKeepAliveTimer() {
+    /* re-arm first, as the timeout might stop the keep-alive */
+    if (keepAliveRepeat_) {
+        keepAliveDeadline_ = now() + keepAliveRepeat_;
+        getLoopData()->scheduleKeepAlive(this, keepAliveDeadline_);
+    }
+
+    timeout();
 }
 
 void CommunicationPeer::bumpLastHeard() const {
@@ -109,11 +123,9 @@ void CommunicationPeer::onConnect() {
     connected_ = true;
     status_ = internal::Peer::kPS_ONLINE;
 
-    keepAliveTimer_.data = this;
-    LOG(DEBUG) << this << " up() for a timer init";
-    up();
-    uv_timer_init(getUvLoop(), &keepAliveTimer_);
-    uv_unref((uv_handle_t*) &keepAliveTimer_);
+    /* a reconnected peer has to negotiate compression and encoding again */
+    resetCompression();
+    resetBinaryEncoding();
 
     connectionHandler_(this, data_, ::yajr::StateChange::CONNECT, 0);
 
@@ -131,18 +143,24 @@ void CommunicationPeer::onDisconnect() {
     if (connected_) {
         /* wipe deque out and reset pendingBytes_ */
         s_.deque_.clear();
+        raw_.deque_.clear();
         pendingBytes_ = 0;
         connected_ = false;
+        congested_ = false;
+
+        /* drop any partial frame */
+        releaseInBuf();
 
-        resetSsIn();
+        /* and the messages still being parsed, which belonged to this
+         * connection rather than to the next one */
+        for (ParseJob * job = parseHead_; job; job = job->next) {
+            job->stale = true;
+        }
 
         if (getKeepAliveInterval()) {
             stopKeepAlive();
         }
 
-        if (!uv_is_closing((uv_handle_t*)&keepAliveTimer_)) {
-            uv_close((uv_handle_t*)&keepAliveTimer_, on_close);
-        }
         connectionHandler_(this, data_, ::yajr::StateChange::DISCONNECT, 0);
     }
 
@@ -259,29 +277,33 @@ void CommunicationPeer::readBufNoNull(char* buffer, size_t nread) {
     }
 
     while ((nread != 0 && --nread > 0) && connected_) {
-        size_t chunk_size = readChunk(buffer);
+        size_t chunk_size = strlen(buffer);
         if (chunk_size == 0) {
             break;
         }
+
+        /* the documents are parsed in-situ in the read buffer, one after
+         * the other, so the chunk must be NUL-terminated in place */
+        char * chunk = buffer;
         nread -= chunk_size++;
         buffer += chunk_size;
 
         bumpLastHeard();
 
-        yajr::comms::internal::wrapper::IStreamWrapper is(ssIn_);
-        while (is.Peek()) {
+        rapidjson::InsituStringStream is(chunk);
+        while (is.Peek() && connected_) {
             docIn_.GetAllocator().Clear();
-            docIn_.ParseStream<rapidjson::kParseStopWhenDoneFlag>(is);
+            docIn_.ParseStream<rapidjson::kParseStopWhenDoneFlag |
+                               rapidjson::kParseInsituFlag>(is);
             if (docIn_.HasParseError()) {
                 rapidjson::ParseErrorCode e = docIn_.GetParseError();
                 size_t o = docIn_.GetErrorOffset();
                 LOG(ERROR)
                     << "Error: " << rapidjson::GetParseError_En(e) << " at offset "
-                    << o << " of message: (" << ssIn_.str() << ")";
-                if (ssIn_.str().data()) {
-                    onError(UV_EPROTO);
-                    onDisconnect();
-                }
+                    << o << " of message: (" << (chunk + o) << ")";
+                onError(UV_EPROTO);
+                onDisconnect();
+                break;
             } else {
                 auto inb = yajr::rpc::MessageFactory::getInboundMessage(*this, docIn_);
                 if (!inb) {
@@ -297,13 +319,23 @@ void CommunicationPeer::readBufNoNull(char* buffer, size_t nread) {
             }
         }
     }
-    resetSsIn();
 }
 
 void CommunicationPeer::readBuffer(char * buffer, size_t nread, bool canWriteJustPastTheEnd) {
     if (!nread) {
         return;
     }
+
+    if (inflate_) {
+        inflateInbound(buffer, nread);
+        return;
+    }
+
+    if (binaryIn_) {
+        readBinary(buffer, nread);
+        return;
+    }
+
     char lastByte[2];
     if (!canWriteJustPastTheEnd) {
         lastByte[0] = buffer[nread-1];
@@ -315,17 +347,67 @@ void CommunicationPeer::readBuffer(char * buffer, size_t nread, bool canWriteJus
 
         nread = 1;
         buffer = lastByte;
+
+        /* the peer might have switched its stream in the meantime */
+        if (inflate_) {
+            inflateInbound(buffer, nread);
+            return;
+        }
+        if (binaryIn_) {
+            readBinary(buffer, nread);
+            return;
+        }
     }
 
     buffer[nread++] = '\0';
     readBufferZ(buffer, nread);
 }
 
-void CommunicationPeer::readBufferZ(char const * buffer, size_t nread) {
+void CommunicationPeer::readRecord(char * record, size_t nread, bool canWriteJustPastTheEnd) {
+    if (!nread) {
+        return;
+    }
+
+    if (inflate_ || binaryIn_ || parseOffload_ || !inBuf_.empty() ||
+            record[nread-1] || std::getenv("OPFLEX_USE_ASYNC_JSON")) {
+        readBuffer(record, nread, canWriteJustPastTheEnd);
+        return;
+    }
+
+    /* every message is followed by its delimiter, and the parser
+     * stops right on it, so there is nothing to scan for */
+    char * const end = record + nread;
+    while (record != end && connected_) {
+        if (*record == kCompressedStream || *record == kBinaryStream) {
+            readBuffer(record, end - record, canWriteJustPastTheEnd);
+            return;
+        }
+
+        char * next = NULL;
+        std::unique_ptr<yajr::rpc::InboundMessage> msg(
+                parseFrame(record, &next));
+        if (msg) {
+            msg->process();
+        } else if (!next) {
+            break;
+        }
+        record = next;
+    }
+}
+
+void CommunicationPeer::readBufferZ(char * buffer, size_t nread) {
     if (!connected_) {
         LOG(WARNING) << "skipping read as not connected";
     }
 
+    if (binaryIn_) {
+        /* binary frames don't need the terminator */
+        if (nread) {
+            readBinary(buffer, nread - 1);
+        }
+        return;
+    }
+
     if (std::getenv("OPFLEX_USE_ASYNC_JSON")) {
         if (!nread) {
             return;
@@ -349,20 +431,179 @@ void CommunicationPeer::readBufferZ(char const * buffer, size_t nread) {
     }
 
     while ((--nread > 0) && connected_) {
-        size_t chunk_size = readChunk(buffer);
-        nread -= chunk_size++;
+        if (!inflate_ && inBuf_.empty() && *buffer == kCompressedStream) {
+            /* everything after the marker is deflated */
+            if (startInflate()) {
+                inflateInbound(buffer + 1, nread - 1);
+            }
+            break;
+        }
+
+        if (inBuf_.empty() && *buffer == kBinaryStream) {
+            /* everything after the marker is made of binary frames */
+            LOG(DEBUG) << this << " peer is sending CBOR from now on";
+            binaryIn_ = true;
+            readBinary(buffer + 1, nread - 1);
+            break;
+        }
+
+        size_t chunk_size = strlen(buffer);
+        nread -= chunk_size;
 
         if (!nread) {
+            /* no delimiter yet, keep the partial frame for the next read */
+            inBuf_.insert(inBuf_.end(), buffer, buffer + chunk_size);
             break;
         }
 
-        buffer += chunk_size;
-        std::unique_ptr<yajr::rpc::InboundMessage> msg(parseFrame());
+        /* parse the frame in place if we have all of it, otherwise
+         * complete it in the receive buffer, along with its delimiter */
+        char * frame = buffer;
+        if (!inBuf_.empty()) {
+            inBuf_.insert(inBuf_.end(), buffer, buffer + chunk_size + 1);
+            frame = inBuf_.data();
+        }
+        buffer += chunk_size + 1;
+
+        if (!offloadFrame(frame, chunk_size + 1, false)) {
+            std::unique_ptr<yajr::rpc::InboundMessage> msg(parseFrame(frame));
+            if (msg) {
+                msg->process();
+            } else {
+                LOG(ERROR) << "skipping inbound message";
+            }
+        }
+
+        /* the message refers to the frame, so only now can we reuse it */
+        releaseInBuf();
+    }
+}
+
+struct CommunicationPeer::ParseJob {
+    ParseJob(CommunicationPeer * peer_, bool binary_)
+        : peer(peer_), next(NULL), binary(binary_), parsed(false),
+          valid(false), stale(false) {
+        req.data = this;
+    }
+
+    /* runs on the thread pool, and touches nothing but the job */
+    void parse() {
+        if (binary) {
+            yajr::rpc::CborReader reader(frame.data() + kFrameHeaderSize,
+                                         frame.size() - kFrameHeaderSize);
+            doc.Populate(reader);
+            valid = reader.IsValid();
+        } else {
+            doc.ParseInsitu(frame.data());
+            valid = !doc.HasParseError();
+        }
+    }
+
+    static void onWork(uv_work_t * req) {
+        static_cast<ParseJob *>(req->data)->parse();
+    }
+
+    static void onParsed(uv_work_t * req, int status) {
+        ParseJob * job = static_cast<ParseJob *>(req->data);
+        CommunicationPeer * peer = job->peer;
+
+        job->parsed = true;
+        if (status) {
+            /* the loop is going away */
+            job->stale = true;
+        }
 
+        peer->deliverParsed();
+        peer->down();
+    }
+
+    uv_work_t req;
+    CommunicationPeer * peer;
+    ParseJob * next;
+    std::vector<char> frame;
+    rapidjson::Document doc;
+    bool binary;
+    bool parsed;
+    bool valid;
+    bool stale;
+};
+
+bool CommunicationPeer::offloadFrame(char const * frame, size_t size,
+                                     bool binary) {
+    /* once a frame is on the thread pool, the ones behind it have to
+     * queue up too, or their messages would overtake its message */
+    if (!parseOffload_ || (!parseHead_ && size < parseOffload_)) {
+        return false;
+    }
+
+    bumpLastHeard();
+
+    ParseJob * job = new (std::nothrow) ParseJob(this, binary);
+    if (!job) {
+        LOG(ERROR) << this << " out of memory, skipping inbound message";
+        onError(UV_ENOMEM);
+        onDisconnect();
+        return true;
+    }
+
+    /* a frame that spans reads is already in its own buffer */
+    if (frame == inBuf_.data()) {
+        job->frame.swap(inBuf_);
+    } else {
+        job->frame.assign(frame, frame + size);
+    }
+
+    if (parseTail_) {
+        parseTail_->next = job;
+    } else {
+        parseHead_ = job;
+    }
+    parseTail_ = job;
+
+    int rc;
+    if ((rc = uv_queue_work(getUvLoop(), &job->req,
+                            ParseJob::onWork, ParseJob::onParsed))) {
+        LOG(WARNING)
+            << "uv_queue_work: [" << uv_err_name(rc) << "] " << uv_strerror(rc);
+        job->parse();
+        job->parsed = true;
+        deliverParsed();
+        return true;
+    }
+
+    up();
+
+    return true;
+}
+
+void CommunicationPeer::deliverParsed() {
+    while (parseHead_ && parseHead_->parsed) {
+        std::unique_ptr<ParseJob> job(parseHead_);
+        parseHead_ = job->next;
+        if (!parseHead_) {
+            parseTail_ = NULL;
+        }
+
+        if (job->stale || !connected_) {
+            continue;
+        }
+
+        if (!job->valid) {
+            LOG(ERROR) << "Error: could not parse inbound message of "
+                       << job->frame.size() << " bytes";
+            onError(UV_EPROTO);
+            onDisconnect();
+            continue;
+        }
+
+        std::unique_ptr<yajr::rpc::InboundMessage> msg(
+                yajr::rpc::MessageFactory::getInboundMessage(*this, job->doc));
         if (!msg) {
-            LOG(ERROR) << "skipping inbound message";
+            onError(UV_EPROTO);
+            onDisconnect();
             continue;
         }
+
         msg->process();
     }
 }
@@ -373,14 +614,252 @@ void CommunicationPeer::onWrite() {
     write(); /* kick the can */
 }
 
+void CommunicationPeer::checkWatermarks() {
+    if (!highWatermark_) {
+        return;
+    }
+
+    size_t queued = s_.deque_.size() + raw_.deque_.size();
+    if (!congested_ && queued > highWatermark_) {
+        LOG(DEBUG) << this << " congested with " << queued << " bytes queued";
+        congested_ = true;
+    } else if (congested_ && queued <= lowWatermark_) {
+        LOG(DEBUG) << this << " drained to " << queued << " bytes queued";
+        congested_ = false;
+    } else {
+        return;
+    }
+
+    if (watermarkCb_) {
+        watermarkCb_(this, data_, congested_);
+    }
+}
+
 int CommunicationPeer::write() {
+    checkWatermarks();
+
     if (pendingBytes_) {
         return 0;
     }
 
+    /* hold small writes back until the loop is about to poll, so that
+     * all the messages sent in this iteration go out together */
+    if (coalesceLimit_ &&
+        s_.deque_.size() + raw_.deque_.size() < coalesceLimit_) {
+        if (!flushScheduled_) {
+            flushScheduled_ = true;
+            getLoopData()->scheduleFlush(this);
+        }
+        return 0;
+    }
+
+    deflateOutbound();
     return transport_.callbacks_->sendCb_(this);
 }
 
+void CommunicationPeer::flush() {
+    flushScheduled_ = false;
+
+    /* if a write is still in flight, onWrite() will kick us again */
+    if (!connected_ || pendingBytes_) {
+        return;
+    }
+
+    deflateOutbound();
+    (void) transport_.callbacks_->sendCb_(this);
+}
+
+void CommunicationPeer::DeflateEnd::operator()(z_stream_s * z) const {
+    deflateEnd(z);
+    delete z;
+}
+
+void CommunicationPeer::InflateEnd::operator()(z_stream_s * z) const {
+    inflateEnd(z);
+    delete z;
+}
+
+bool CommunicationPeer::enableCompression() {
+    if (deflate_) {
+        return true;
+    }
+
+    /* the marker has to be found at a frame boundary */
+    if (!nullTermination) {
+        LOG(WARNING) << this << " can't compress a stream without frame delimiters";
+        return false;
+    }
+
+    /* binary frames can't carry the marker */
+    if (binaryOut_) {
+        LOG(WARNING) << this << " can't compress a stream once it is binary";
+        return false;
+    }
+
+    std::unique_ptr<z_stream_s, DeflateEnd> z(new z_stream_s());
+    /* JSON with repetitive URIs compresses well even at the fastest level */
+    if (deflateInit(z.get(), Z_BEST_SPEED) != Z_OK) {
+        LOG(ERROR) << this << " deflateInit: " << (z->msg ? z->msg : "failed");
+        return false;
+    }
+
+    LOG(DEBUG) << this << " compressing from now on";
+    s_.deque_.push_back(char(kCompressedStream));
+    deflate_ = std::move(z);
+
+    return true;
+}
+
+void CommunicationPeer::deflateOutbound() {
+    if (!deflate_ || raw_.deque_.empty()) {
+        return;
+    }
+
+    std::vector<iovec> iov =
+        ::yajr::comms::internal::get_iovec(
+                raw_.deque_.begin(),
+                raw_.deque_.end()
+        );
+
+    /* sync-flush the last chunk, so the peer can decode every message
+     * that has been sent so far, while keeping the dictionary */
+    unsigned char out[16384];
+    for (size_t i = 0; i < iov.size(); ++i) {
+        int flush = (i + 1 == iov.size()) ? Z_SYNC_FLUSH : Z_NO_FLUSH;
+        deflate_->next_in = static_cast<Bytef *>(iov[i].iov_base);
+        deflate_->avail_in = iov[i].iov_len;
+        do {
+            deflate_->next_out = out;
+            deflate_->avail_out = sizeof(out);
+            (void) ::deflate(deflate_.get(), flush);
+            s_.deque_.insert(s_.deque_.end(), out,
+                             out + sizeof(out) - deflate_->avail_out);
+        } while (deflate_->avail_out == 0);
+    }
+
+    raw_.deque_.clear();
+}
+
+bool CommunicationPeer::startInflate() {
+    std::unique_ptr<z_stream_s, InflateEnd> z(new z_stream_s());
+    if (inflateInit(z.get()) != Z_OK) {
+        LOG(ERROR) << this << " inflateInit: " << (z->msg ? z->msg : "failed");
+        onError(UV_ENOMEM);
+        onDisconnect();
+        return false;
+    }
+
+    LOG(DEBUG) << this << " peer is compressing from now on";
+    inflate_ = std::move(z);
+
+    return true;
+}
+
+void CommunicationPeer::inflateInbound(char const * buffer, size_t n) {
+    /* one more byte for the terminator readBufferZ() wants */
+    char out[16384 + 1];
+
+    inflate_->next_in = reinterpret_cast<Bytef *>(const_cast<char *>(buffer));
+    inflate_->avail_in = n;
+    do {
+        inflate_->next_out = reinterpret_cast<Bytef *>(out);
+        inflate_->avail_out = sizeof(out) - 1;
+
+        int rc = ::inflate(inflate_.get(), Z_NO_FLUSH);
+        if (rc != Z_OK && rc != Z_BUF_ERROR) {
+            LOG(ERROR) << this << " Failed to inflate input: "
+                       << (inflate_->msg ? inflate_->msg : zError(rc));
+            onError(UV_EPROTO);
+            onDisconnect();
+            return;
+        }
+
+        size_t have = sizeof(out) - 1 - inflate_->avail_out;
+        if (have) {
+            out[have] = '\0';
+            readBufferZ(out, have + 1);
+        }
+    } while (inflate_->avail_out == 0 && connected_);
+}
+
+void CommunicationPeer::resetCompression() {
+    raw_.deque_.clear();
+    deflate_.reset();
+    inflate_.reset();
+}
+
+bool CommunicationPeer::enableBinaryEncoding() {
+    if (binaryOut_) {
+        return true;
+    }
+
+    /* the marker has to be found at a frame boundary */
+    if (!nullTermination) {
+        LOG(WARNING) << this << " can't switch the encoding of a stream without frame delimiters";
+        return false;
+    }
+
+    LOG(DEBUG) << this << " sending CBOR from now on";
+    outQueue().deque_.push_back(char(kBinaryStream));
+    binaryOut_ = true;
+    writer_.SetBinary(true);
+
+    return true;
+}
+
+void CommunicationPeer::resetBinaryEncoding() {
+    binaryOut_ = false;
+    binaryIn_ = false;
+    writer_.SetBinary(false);
+}
+
+void CommunicationPeer::readBinary(char const * buffer, size_t n) {
+    while (n && connected_) {
+        char const * frame = NULL;
+        size_t size = 0;
+
+        if (inBuf_.empty() && n >= kFrameHeaderSize &&
+            n >= binaryFrameSize(buffer)) {
+            /* the whole frame is in the buffer */
+            frame = buffer;
+            size = binaryFrameSize(buffer);
+        } else {
+            /* complete the header first, then the rest of the frame */
+            size_t want = inBuf_.size() < kFrameHeaderSize
+                ? kFrameHeaderSize
+                : binaryFrameSize(inBuf_.data());
+            size_t chunk = std::min(n, want - inBuf_.size());
+            inBuf_.insert(inBuf_.end(), buffer, buffer + chunk);
+            buffer += chunk;
+            n -= chunk;
+            if (inBuf_.size() < kFrameHeaderSize ||
+                inBuf_.size() < binaryFrameSize(inBuf_.data())) {
+                continue;
+            }
+            frame = inBuf_.data();
+            size = inBuf_.size();
+        }
+
+        if (!offloadFrame(frame, size, true)) {
+            std::unique_ptr<yajr::rpc::InboundMessage> msg(
+                parseBinaryFrame(frame + kFrameHeaderSize,
+                                 size - kFrameHeaderSize));
+            if (msg) {
+                msg->process();
+            } else {
+                LOG(ERROR) << "skipping inbound message";
+            }
+        }
+
+        if (frame == buffer) {
+            buffer += size;
+            n -= size;
+        } else {
+            releaseInBuf();
+        }
+    }
+}
+
 int CommunicationPeer::writeIOV(std::vector<iovec>& iov) const {
     assert(!iov.empty());
 
@@ -421,10 +900,19 @@ void CommunicationPeer::sendEchoReq() {
         . send();
 }
 
+void CommunicationPeer::onEchoRes(uint64_t sent) const {
+    uint64_t ts = now();
+    if (!rttCb_ || sent > ts) {
+        return;
+    }
+
+    rttCb_(const_cast<CommunicationPeer *>(this), data_, ts - sent);
+}
+
 void CommunicationPeer::timeout() {
     uint64_t rtt = now() - lastHeard_;
 
-    if (uvRefCnt_ == 1) {
+    if (!connected_) {
         /* we already have a pending close */
         LOG(TRACE) << this << " Already closing";
         return;
@@ -481,39 +969,74 @@ int comms::internal::CommunicationPeer::unchoke() const {
     return rc;
 }
 
-yajr::rpc::InboundMessage * comms::internal::CommunicationPeer::parseFrame() {
+yajr::rpc::InboundMessage * comms::internal::CommunicationPeer::parseFrame(
+        char * frame, char ** next) {
     bumpLastHeard();
 
     /* empty frames are legal too */
-    if (ssIn_.str().empty()) {
+    if (!*frame) {
+        if (next) {
+            *next = frame + 1;
+        }
         return NULL;
     }
 
     yajr::rpc::InboundMessage * ret = NULL;
-    yajr::comms::internal::wrapper::IStreamWrapper is(ssIn_);
 
+    /* reuses the first chunk of the allocator across messages, and the
+     * strings of the document point into the frame */
     docIn_.GetAllocator().Clear();
 
-    docIn_.ParseStream(is);
+    rapidjson::InsituStringStream is(frame);
+    docIn_.ParseStream<rapidjson::kParseInsituFlag>(is);
     if (docIn_.HasParseError()) {
         rapidjson::ParseErrorCode e = docIn_.GetParseError();
         size_t o = docIn_.GetErrorOffset();
 
+        /* the frame has been partly decoded in place, so only what is
+         * left from the error onwards is reliable */
         LOG(ERROR)
             << "Error: " << rapidjson::GetParseError_En(e) << " at offset "
-            << o << " of message: (" << ssIn_.str() << ")";
+            << o << " of message: (" << (frame + o) << ")";
+
+        onError(UV_EPROTO);
+        onDisconnect();
 
-        if (ssIn_.str().data()) {
+        // ret stays set to NULL
+    } else {
+        /* the parser stopped on the delimiter */
+        if (next) {
+            *next = frame + is.Tell() + 1;
+        }
+        ret = yajr::rpc::MessageFactory::getInboundMessage(*this, docIn_);
+        if (!ret) {
             onError(UV_EPROTO);
             onDisconnect();
         }
+    }
+
+    return ret;
+}
+
+yajr::rpc::InboundMessage * comms::internal::CommunicationPeer::parseBinaryFrame(
+        char const * frame, size_t size) {
+    bumpLastHeard();
+
+    yajr::rpc::InboundMessage * ret = NULL;
+
+    docIn_.SetNull();
+    docIn_.GetAllocator().Clear();
+
+    yajr::rpc::CborReader reader(frame, size);
+    docIn_.Populate(reader);
+    if (!reader.IsValid()) {
+        LOG(ERROR) << "Error: invalid CBOR message of " << size << " bytes";
+
+        onError(UV_EPROTO);
+        onDisconnect();
 
         // ret stays set to NULL
     } else {
-        /* don't clean up ssIn_ yet. yes, it's technically a "dead" variable here,
-         * but we might need to inspect it from gdb to make our life easier when
-         * getInboundMessage() isn't happy :)
-         */
         ret = yajr::rpc::MessageFactory::getInboundMessage(*this, docIn_);
         if (!ret) {
             onError(UV_EPROTO);
@@ -521,7 +1044,6 @@ yajr::rpc::InboundMessage * comms::internal::CommunicationPeer::parseFrame() {
         }
     }
 
-    resetSsIn();
     return ret;
 }
 
@@ -76,12 +76,8 @@ char const * getUvHandleType(uv_handle_t * h) {
 char const * getUvHandleField(uv_handle_t * h, internal::Peer * peer) {
     char const * hType = "???";
 
-    if (h == reinterpret_cast< uv_handle_t * >(&peer->keepAliveTimer_)) {
-        hType = "keepAliveTimer";
-    } else {
-        if (h == peer->getHandle()) {
-            hType = "TCP";
-        }
+    if (h == peer->getHandle()) {
+        hType = "TCP";
     }
 
     return hType;
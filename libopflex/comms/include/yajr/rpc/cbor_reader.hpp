@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+#pragma once
+#ifndef _COMMS__INCLUDE__OPFLEX__RPC__CBOR_READER_HPP
+#define _COMMS__INCLUDE__OPFLEX__RPC__CBOR_READER_HPP
+
+#include <rapidjson/rapidjson.h>
+
+#include <cstdint>
+#include <cstring>
+#include <climits>
+
+namespace yajr {
+namespace rpc {
+
+/**
+ * Decode a single CBOR (RFC 8949) item into the SAX calls a
+ * rapidjson handler expects, so that a rapidjson::Document can be
+ * populated from a message written by a binary SendHandler:
+ *
+ *     CborReader reader(frame, size);
+ *     document.Populate(reader);
+ *     if (!reader.IsValid()) ...
+ *
+ * Only the items that have a JSON equivalent are accepted, and map
+ * keys have to be text strings.  Strings are always copied, since
+ * they are not NUL-terminated in the frame.
+ */
+class CborReader {
+  public:
+    /**
+     * Construct a reader for the given frame
+     * @param data the encoded item
+     * @param size the size of the encoded item
+     */
+    CborReader(char const * data, size_t size)
+        : p_(reinterpret_cast<unsigned char const *>(data)),
+          end_(p_ + size),
+          valid_(false) {}
+
+    /**
+     * Produce the SAX events for the item
+     * @param handler the handler to call
+     * @return true if the whole frame is one valid item
+     */
+    template <typename Handler>
+    bool operator()(Handler& handler) {
+        valid_ = parseItem(handler, 0) && p_ == end_;
+        return valid_;
+    }
+
+    /**
+     * Check whether the last parse succeeded
+     * @return true if the frame was a single valid item
+     */
+    bool IsValid() const {
+        return valid_;
+    }
+
+  private:
+    /* JSON-RPC messages nest only a few levels deep */
+    static const unsigned kMaxDepth = 128;
+
+    unsigned char const * p_;
+    unsigned char const * end_;
+    bool valid_;
+
+    bool readBigEndian(unsigned bytes, uint64_t& value) {
+        if (size_t(end_ - p_) < bytes) {
+            return false;
+        }
+        value = 0;
+        while (bytes--) {
+            value = (value << 8) | *p_++;
+        }
+        return true;
+    }
+
+    /* the argument that follows the major type in the initial byte */
+    bool readArgument(unsigned char info, uint64_t& value) {
+        if (info < 24) {
+            value = info;
+            return true;
+        }
+        if (info > 27) {
+            return false;
+        }
+        return readBigEndian(1u << (info - 24), value);
+    }
+
+    bool isBreak() const {
+        return p_ != end_ && *p_ == 0xff;
+    }
+
+    template <typename Handler>
+    bool parseText(Handler& handler, uint64_t length, bool key) {
+        if (uint64_t(end_ - p_) < length) {
+            return false;
+        }
+        char const * str = reinterpret_cast<char const *>(p_);
+        p_ += length;
+        rapidjson::SizeType len = rapidjson::SizeType(length);
+        return key ? handler.Key(str, len, true)
+                   : handler.String(str, len, true);
+    }
+
+    template <typename Handler>
+    bool parseItem(Handler& handler, unsigned depth) {
+        if (p_ == end_ || depth > kMaxDepth) {
+            return false;
+        }
+
+        unsigned char major = *p_ >> 5;
+        unsigned char info = *p_++ & 0x1f;
+
+        if (major == 7) {
+            uint64_t bits;
+            switch (info) {
+            case 20: return handler.Bool(false);
+            case 21: return handler.Bool(true);
+            case 22:
+            case 23: return handler.Null();
+            case 26: {
+                if (!readBigEndian(4, bits)) return false;
+                uint32_t bits32 = uint32_t(bits);
+                float f;
+                std::memcpy(&f, &bits32, sizeof(f));
+                return handler.Double(f);
+            }
+            case 27: {
+                if (!readBigEndian(8, bits)) return false;
+                double d;
+                std::memcpy(&d, &bits, sizeof(d));
+                return handler.Double(d);
+            }
+            default: return false;
+            }
+        }
+
+        bool indefinite = (info == 31 && (major == 4 || major == 5));
+        uint64_t value = 0;
+        if (!indefinite && !readArgument(info, value)) {
+            return false;
+        }
+
+        switch (major) {
+        case 0:
+            return value <= UINT_MAX ? handler.Uint(unsigned(value))
+                                     : handler.Uint64(value);
+        case 1: {
+            if (value > uint64_t(INT64_MAX)) return false;
+            int64_t i = -1 - int64_t(value);
+            return i >= INT_MIN ? handler.Int(int(i)) : handler.Int64(i);
+        }
+        case 3:
+            return parseText(handler, value, false);
+        case 4: {
+            if (!handler.StartArray()) return false;
+            rapidjson::SizeType count = 0;
+            while (indefinite ? !isBreak() : count < value) {
+                if (!parseItem(handler, depth + 1)) return false;
+                ++count;
+            }
+            if (indefinite) ++p_; /* the break */
+            return handler.EndArray(count);
+        }
+        case 5: {
+            if (!handler.StartObject()) return false;
+            rapidjson::SizeType count = 0;
+            while (indefinite ? !isBreak() : count < value) {
+                if (p_ == end_ || (*p_ >> 5) != 3) return false;
+                uint64_t length;
+                if (!readArgument(*p_++ & 0x1f, length) ||
+                    !parseText(handler, length, true) ||
+                    !parseItem(handler, depth + 1)) return false;
+                ++count;
+            }
+            if (indefinite) ++p_; /* the break */
+            return handler.EndObject(count);
+        }
+        case 6:
+            /* tags carry no meaning for JSON, decode what they tag */
+            return parseItem(handler, depth + 1);
+        default:
+            /* byte strings and indefinite-length strings */
+            return false;
+        }
+    }
+};
+
+} /* yajr::rpc namespace */
+} /* yajr namespace */
+
+#endif /* _COMMS__INCLUDE__OPFLEX__RPC__CBOR_READER_HPP */
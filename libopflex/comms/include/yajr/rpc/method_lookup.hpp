@@ -5,68 +5,107 @@
  * terms of the Eclipse Public License v1.0 which accompanies this distribution,
  * and is available at http://www.eclipse.org/legal/epl-v10.html
  */
+#pragma once
+#ifndef _COMMS__INCLUDE__YAJR__RPC__METHOD_LOOKUP_HPP
+#define _COMMS__INCLUDE__YAJR__RPC__METHOD_LOOKUP_HPP
+
+#include <yajr/rpc/internal/fnv_1a_64.hpp>
+#include <yajr/rpc/methods.hpp>
+
+#include <cstddef>
+
+/* every method with handlers, in the order of the dispatch table */
+#define YAJR_RPC_METHODS(XX) \
+    XX(echo)                 \
+    XX(send_identity)        \
+    XX(policy_resolve)       \
+    XX(policy_unresolve)     \
+    XX(policy_update)        \
+    XX(endpoint_declare)     \
+    XX(endpoint_undeclare)   \
+    XX(endpoint_resolve)     \
+    XX(endpoint_unresolve)   \
+    XX(endpoint_update)      \
+    XX(state_report)         \
+    XX(transact)             \
+    XX(monitor)              \
+    XX(update)               \
+    XX(monitor_cond_since)   \
+    XX(update3)              \
+    XX(custom)
+
+namespace yajr {
+    namespace rpc {
+        namespace internal {
+            namespace method_lookup {
+
+constexpr char const * names[] = {
+#define XX(m) #m,
+    YAJR_RPC_METHODS(XX)
+#undef XX
+};
+
+constexpr std::size_t methods = sizeof(names) / sizeof(names[0]);
+
+/* a method's slot is taken from these bits of its FNV-1a hash, which
+ * happen to be distinct for every method in the set */
+constexpr std::size_t slots = 64;
+constexpr unsigned shift = 9;
+
+constexpr std::size_t slot(uint64_t hash) {
+    return (hash >> shift) & (slots - 1);
+}
+
+constexpr std::size_t nameSlot(std::size_t i) {
+    return slot(fnv_1a_64::hash_const(names[i]));
+}
+
+constexpr bool distinct(std::size_t i, std::size_t j) {
+    return j == methods ||
+        (nameSlot(i) != nameSlot(j) && distinct(i, j + 1));
+}
+
+constexpr bool perfect(std::size_t i = 0) {
+    return i == methods || (distinct(i, i + 1) && perfect(i + 1));
+}
+
+static_assert(perfect(),
+              "two methods share a slot, change the shift or the slots");
+
+/**
+ * The factories for the inbound messages of a method
+ */
+struct Entry {
+    /** the method */
+    MethodName * method;
+    /** create an inbound request */
+    yajr::rpc::InboundRequest * (*request)(
+            yajr::Peer& peer,
+            rapidjson::Value const & params,
+            rapidjson::Value const & id);
+    /** create an inbound result */
+    yajr::rpc::InboundResult * (*result)(
+            yajr::Peer& peer,
+            rapidjson::Value const & result,
+            rapidjson::Value const & id);
+    /** create an inbound error */
+    yajr::rpc::InboundError * (*error)(
+            yajr::Peer& peer,
+            rapidjson::Value const & error,
+            rapidjson::Value const & id);
+};
+
+/**
+ * Look up the entry of a method with a single probe of the perfect
+ * hash table
+ * @param method the method name
+ * @return the entry of the method, or that of method::unknown
+ */
+Entry const & lookup(char const * method);
 
-    switch (fnv_1a_64::hash_runtime(method)) {
-        case fnv_1a_64::hash_const("echo"):
-            return PERFECT_RET_VAL(yajr::rpc::method::echo);
-            break;
-
-        case fnv_1a_64::hash_const("send_identity"):
-            return PERFECT_RET_VAL(yajr::rpc::method::send_identity);
-            break;
-
-        case fnv_1a_64::hash_const("policy_resolve"):
-            return PERFECT_RET_VAL(yajr::rpc::method::policy_resolve);
-            break;
-
-        case fnv_1a_64::hash_const("policy_unresolve"):
-            return PERFECT_RET_VAL(yajr::rpc::method::policy_unresolve);
-            break;
-
-        case fnv_1a_64::hash_const("policy_update"):
-            return PERFECT_RET_VAL(yajr::rpc::method::policy_update);
-            break;
-
-        case fnv_1a_64::hash_const("endpoint_declare"):
-            return PERFECT_RET_VAL(yajr::rpc::method::endpoint_declare);
-            break;
-
-        case fnv_1a_64::hash_const("endpoint_undeclare"):
-            return PERFECT_RET_VAL(yajr::rpc::method::endpoint_undeclare);
-            break;
-
-        case fnv_1a_64::hash_const("endpoint_resolve"):
-            return PERFECT_RET_VAL(yajr::rpc::method::endpoint_resolve);
-            break;
-
-        case fnv_1a_64::hash_const("endpoint_unresolve"):
-            return PERFECT_RET_VAL(yajr::rpc::method::endpoint_unresolve);
-            break;
-
-        case fnv_1a_64::hash_const("endpoint_update"):
-            return PERFECT_RET_VAL(yajr::rpc::method::endpoint_update);
-            break;
-
-        case fnv_1a_64::hash_const("state_report"):
-            return PERFECT_RET_VAL(yajr::rpc::method::state_report);
-            break;
-
-        case fnv_1a_64::hash_const("transact"):
-            return PERFECT_RET_VAL(yajr::rpc::method::transact);
-            break;
-
-        case fnv_1a_64::hash_const("monitor"):
-            return PERFECT_RET_VAL(yajr::rpc::method::monitor);
-            break;
-
-        case fnv_1a_64::hash_const("update"):
-            return PERFECT_RET_VAL(yajr::rpc::method::update);
-            break;
-
-        case fnv_1a_64::hash_const("custom"):
-            return PERFECT_RET_VAL(yajr::rpc::method::custom);
-            break;
+} /* yajr::rpc::internal::method_lookup namespace */
+} /* yajr::rpc::internal namespace */
+} /* yajr::rpc namespace */
+} /* yajr namespace */
 
-        default:
-            return PERFECT_RET_VAL(yajr::rpc::method::unknown);
-    }
+#endif /* _COMMS__INCLUDE__YAJR__RPC__METHOD_LOOKUP_HPP */
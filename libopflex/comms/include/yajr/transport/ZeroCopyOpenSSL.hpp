@@ -18,8 +18,12 @@
 
 #include <deque>
 
+#include <mutex>
+
 #include <string>
 
+#include <unordered_map>
+
 namespace yajr {
 
     class Peer;
@@ -58,13 +62,20 @@ struct ZeroCopyOpenSSL : public Transport::Engine {
              *        method Ctx::createCtx(). Can be shared across multiple
              *        peers.
              */
-            bool inverted_roles = false
+            bool inverted_roles = false,
             /**< [in] whether to have the server connect and the client accept,
              *        so as to save CPU on the server at the price of losing
              *        interoperability. Don't use it unless you control both
              *        clients and servers and want to push the heavy asymmetric
              *        crypto operations from the servers to the clients.
              */
+            char const * sessionKey = NULL
+            /**< [in] for the connecting side, the name under which the
+             *        context saves the TLS session, typically "host:port".
+             *        Later connections with the same name resume the
+             *        session instead of doing a full handshake. NULL
+             *        disables resumption.
+             */
     );
 
     ~ZeroCopyOpenSSL();
@@ -74,6 +85,9 @@ struct ZeroCopyOpenSSL : public Transport::Engine {
     BIO * bioSSL_;
     char * lastOutBuf_;
     static std::string const dumpOpenSslErrorStackAsString();
+    /* forget the saved session of an active peer whose connection
+     * failed, so that the next attempt does a full handshake */
+    void forgetSession();
   private:
     SSL* ssl_;
     bool ready_;
@@ -82,7 +96,10 @@ struct ZeroCopyOpenSSL : public Transport::Engine {
     static void lockingCallback(int, int, const char *, int);
 #endif
     static void infoCallback(SSL const *, int, int);
-    ZeroCopyOpenSSL(ZeroCopyOpenSSL::Ctx * ctx, bool passive);
+    ZeroCopyOpenSSL(ZeroCopyOpenSSL::Ctx * ctx, bool passive,
+                    char const * sessionKey);
+    /* the name of the saved session of an active peer, if any */
+    std::string sessionKey_;
 };
 
 class ZeroCopyOpenSSL::Ctx {
@@ -103,10 +120,15 @@ class ZeroCopyOpenSSL::Ctx {
          *        certificate and its private key, possibly encrypted.
          *        Can be NULL for SSL clients, must be present for servers.
          */
-        char const * passphrase = NULL
+        char const * passphrase = NULL,
         /**< [in] the passphrase to be used to decrypt the private key within
          *        this peer's PEM file
          */
+        bool client = false
+        /**< [in] whether the context is for connecting peers, which save
+         *        their sessions by name for resumption. Otherwise the
+         *        context caches the sessions of the peers it accepts.
+         */
     );
 
     /**
@@ -164,15 +186,42 @@ class ZeroCopyOpenSSL::Ctx {
     );
 
 
+    /**
+     * @brief Forget the TLS session saved under a name, so that the next
+     * connection with that name does a full handshake
+     */
+    void forgetSession(
+        std::string const & sessionKey
+        /**< [in] the name the session was saved under */
+    );
+
+    /**
+     * @brief Get the number of TLS sessions saved for resumption
+     */
+    size_t getSessionCount();
+
+    /**
+     * @brief Get the number of client handshakes that resumed a saved
+     * session
+     */
+    size_t getResumedCount();
+
     SSL_CTX * getSslCtx() const {
         return sslCtx_;
     }
     ~Ctx();
   private:
+    friend struct ZeroCopyOpenSSL;
     Ctx(SSL_CTX * c, char const * passphrase);
     static int pwdCb(char *, int, int, void *);
+    static int newSessionCb(SSL *, SSL_SESSION *);
+    void resumeSession(SSL * ssl, std::string const & sessionKey);
     SSL_CTX * sslCtx_;
     std::string passphrase_;
+    /* client sessions by name, each holding a reference */
+    std::mutex sessionMutex_;
+    std::unordered_map<std::string, SSL_SESSION *> sessions_;
+    size_t resumed_;
 };
 
 } /* yajr::transport namespace */
@@ -28,6 +28,8 @@ std::ostream& operator << (std::ostream& os, Peer::LoopData const * lD);
 
 void internal::Peer::LoopData::onPrepareLoop() {
 
+    flushPeers();
+
     if (destroying_ && !refCount_) {
 
         CountHandle countHandle = { this, 0 };
@@ -53,6 +55,8 @@ void internal::Peer::LoopData::onPrepareLoop() {
     const std::lock_guard<std::recursive_mutex> lock(peerMutex);
     peers[TO_LISTEN].clear_and_dispose(RetryPeer());
     peers[TO_RESOLVE].clear_and_dispose(RetryPeer());
+    /* connections that a listener on another loop accepted for us */
+    peers[TO_ADOPT].clear_and_dispose(RetryPeer());
 
     if (now - lastRun_ < 750) {
         goto prepared;
@@ -91,6 +95,90 @@ prepared:
     }
 }
 
+void internal::Peer::LoopData::scheduleFlush(CommunicationPeer * peer) {
+    peer->up();
+    toFlush_.push_back(peer);
+}
+
+void internal::Peer::LoopData::flushPeers() {
+    /* swap the pending peers out, as flushing can schedule again */
+    flushing_.swap(toFlush_);
+    for (CommunicationPeer * peer : flushing_) {
+        peer->flush();
+        peer->down();
+    }
+    flushing_.clear();
+}
+
+void internal::Peer::LoopData::scheduleKeepAlive(
+        CommunicationPeer * peer,
+        uint64_t deadline) {
+    assert(!peer->KeepAliveHook::is_linked());
+
+    /* an idle wheel has not kept up with the time */
+    if (!wheelPeers_) {
+        wheelTick_ = uv_now(wheelTimer_.loop) / kWheelTick;
+    }
+
+    /* round up, so that the slot never comes around too early */
+    uint64_t tick = (deadline + kWheelTick - 1) / kWheelTick;
+    if (tick <= wheelTick_) {
+        tick = wheelTick_ + 1;
+    }
+    wheel_[tick & (kWheelSlots - 1)].push_back(*peer);
+
+    if (!wheelPeers_++ && !destroying_) {
+        uv_timer_start(&wheelTimer_, onWheelTick, kWheelTick, kWheelTick);
+    }
+}
+
+void internal::Peer::LoopData::cancelKeepAlive(CommunicationPeer * peer) {
+    if (!peer->KeepAliveHook::is_linked()) {
+        return;
+    }
+
+    peer->KeepAliveHook::unlink();
+
+    if (!--wheelPeers_) {
+        uv_timer_stop(&wheelTimer_);
+    }
+}
+
+void internal::Peer::LoopData::onWheelTick() {
+    uint64_t now = uv_now(wheelTimer_.loop);
+    uint64_t tick = now / kWheelTick;
+
+    /* take the expired timers out first, as firing them can arm and
+     * disarm others.  Timers that are more than a revolution away
+     * stay in their slot until then. */
+    KeepAliveList expired;
+    for (size_t n = 0; wheelTick_ < tick && n < kWheelSlots; ++n) {
+        KeepAliveList & slot = wheel_[++wheelTick_ & (kWheelSlots - 1)];
+        for (KeepAliveList::iterator i = slot.begin(); i != slot.end(); ) {
+            CommunicationPeer & peer = *i++;
+            if (peer.getKeepAliveDeadline() <= now) {
+                peer.KeepAliveHook::unlink();
+                expired.push_back(peer);
+            }
+        }
+    }
+    wheelTick_ = tick;
+
+    while (!expired.empty()) {
+        CommunicationPeer & peer = expired.front();
+        expired.pop_front();
+        if (!--wheelPeers_) {
+            uv_timer_stop(&wheelTimer_);
+        }
+        peer.onKeepAliveTimer();
+    }
+}
+
+void internal::Peer::LoopData::onWheelTick(uv_timer_t * h) {
+    static_cast< ::yajr::comms::internal::Peer::LoopData *>(h->data)
+        ->onWheelTick();
+}
+
 void internal::Peer::LoopData::onPrepareLoop(uv_prepare_t * h) {
     static_cast< ::yajr::comms::internal::Peer::LoopData *>(h->data)
         ->onPrepareLoop();
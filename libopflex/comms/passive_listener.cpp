@@ -16,7 +16,12 @@
 
 #include <opflex/logging/internal/logging.hpp>
 
+#include <fcntl.h>
 #include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <new>
 
 /*
                          ____               _
@@ -224,7 +229,11 @@ void ::yajr::comms::internal::ListeningUnixPeer::retry() {
 
     up();
 
-    if ((rc = uv_pipe_bind(reinterpret_cast<uv_pipe_t *>(getHandle()),
+    if ((rc = seqPacket_
+                ? transport::SeqPacket::bind(
+                    reinterpret_cast<uv_pipe_t *>(getHandle()),
+                    socketName_.c_str())
+                : uv_pipe_bind(reinterpret_cast<uv_pipe_t *>(getHandle()),
                     socketName_.c_str()))) {
         LOG(WARNING)
             << "uv_pipe_bind: ["
@@ -298,6 +307,15 @@ void on_passive_connection(uv_stream_t * server_handle, int status)
     }
 
     int rc;
+    if (peer->getUvLoop() != server_handle->loop) {
+        /* the peer is served by another loop, which opens the socket */
+        if ((rc = peer->handOff(server_handle))) {
+            peer->onError(rc);
+            peer->down();  // this is invoked with an intent to delete!
+        }
+        return;
+    }
+
     if ((rc = uv_accept(server_handle, (uv_stream_t*) peer->getHandle()))) {
         LOG(DEBUG) << "uv_accept: [" << uv_err_name(rc) << "] " << uv_strerror(rc);
         peer->onError(rc);
@@ -305,15 +323,119 @@ void on_passive_connection(uv_stream_t * server_handle, int status)
         return;
     }
 
-    if (peer->unchoke()) {
+    peer->onAccept();
+
+}
+
+namespace {
+
+/* a stream of either kind, to accept a connection into */
+union AcceptedStream {
+    uv_handle_t handle;
+    uv_stream_t stream;
+    uv_tcp_t tcp;
+    uv_pipe_t pipe;
+};
+
+void on_accepted_close(uv_handle_t * h) {
+    delete reinterpret_cast<AcceptedStream *>(h);
+}
+
+} /* anonymous namespace */
+
+void PassivePeer::onAccept() {
+
+    if (unchoke()) {
         return;
     }
 
-    peer->insert(internal::Peer::LoopData::ONLINE);
+    insert(internal::Peer::LoopData::ONLINE);
 
     /* kick the ball */
-    peer->onConnect();
+    onConnect();
+}
+
+int PassivePeer::handOff(uv_stream_t * server) {
+
+    AcceptedStream * accepted = new (std::nothrow) AcceptedStream;
+    if (!accepted) {
+        return UV_ENOMEM;
+    }
+
+    int rc = (server->type == UV_NAMED_PIPE)
+        ? uv_pipe_init(server->loop, &accepted->pipe, 0)
+        : uv_tcp_init(server->loop, &accepted->tcp);
+    if (rc) {
+        delete accepted;
+        return rc;
+    }
+
+    /* libuv streams are bound to the loop that accepts them, so take
+     * a copy of the socket for the peer's loop and close this one.  The
+     * copy must not leak into child processes */
+    uv_os_fd_t fd;
+    if (!(rc = uv_accept(server, &accepted->stream)) &&
+        !(rc = uv_fileno(&accepted->handle, &fd)) &&
+        (handOffFd_ = fcntl(fd, F_DUPFD_CLOEXEC, 0)) < 0) {
+        rc = uv_translate_sys_error(errno);
+    }
+    uv_close(&accepted->handle, on_accepted_close);
+
+    if (rc) {
+        LOG(WARNING) << "hand off: [" << uv_err_name(rc) << "] " << uv_strerror(rc);
+        return rc;
+    }
+
+    /* from here on the peer belongs to the other loop's thread */
+    insert(internal::Peer::LoopData::TO_ADOPT);
+    getLoopData()->kickLibuv();
+
+    return 0;
+}
 
+void PassivePeer::retry() {
+
+    int fd = handOffFd_;
+    handOffFd_ = -1;
+
+    assert(fd >= 0);
+    if (fd < 0) {
+        return;
+    }
+
+    int rc;
+    if ((rc = initHandle())) {
+        LOG(WARNING) << "initHandle: [" << uv_err_name(rc) << "] " << uv_strerror(rc);
+        ::close(fd);
+        onError(rc);
+        down();  // this is invoked with an intent to delete!
+        return;
+    }
+
+    if ((rc = openHandle(fd))) {
+        LOG(WARNING) << "openHandle: [" << uv_err_name(rc) << "] " << uv_strerror(rc);
+        ::close(fd);
+        onError(rc);
+        uv_close(getHandle(), on_close);
+        return;
+    }
+
+    onAccept();
+}
+
+void PassivePeer::destroy(bool now) {
+
+    if (handOffFd_ < 0) {
+        CommunicationPeer::destroy(now);
+        return;
+    }
+
+    /* the socket was never opened, so there is no handle to close */
+    ::close(handOffFd_);
+    handOffFd_ = -1;
+    destroying_ = true;
+    unlink();
+    down();
 }
 
 ::yajr::comms::internal::PassivePeer *
@@ -337,8 +459,13 @@ void on_passive_connection(uv_stream_t * server_handle, int status)
         return NULL;
     }
 
+    /* a peer of another loop gets its handle initialized over there */
+    if (peer->getUvLoop() != getUvLoop()) {
+        return peer;
+    }
+
     int rc;
-    if ((rc = peer->tcpInit())) {
+    if ((rc = peer->initHandle())) {
         peer->onError(rc);
         peer->down();  // this is invoked with an intent to delete!
         return NULL;
@@ -359,6 +486,12 @@ public:
                         uvLoopSelector)
         { }
 
+    virtual int initHandle() {
+        return uv_pipe_init(getUvLoop(),
+                            reinterpret_cast<uv_pipe_t *>(getHandle()),
+                            0);
+    }
+
     virtual int getPeerName(struct sockaddr* remoteAddress, int* len) const {
         *len = sizeof(struct sockaddr_un);
 
@@ -373,6 +506,11 @@ public:
         addr->sun_path[sizeof(addr->sun_path)-1] = '\0';
         return rc;
     }
+
+  protected:
+    virtual int openHandle(int fd) {
+        return uv_pipe_open(reinterpret_cast<uv_pipe_t *>(getHandle()), fd);
+    }
 };
 
 ::yajr::comms::internal::PassivePeer *
@@ -396,11 +534,17 @@ public:
         return NULL;
     }
 
+    if (seqPacket_) {
+        transport::SeqPacket::attachTransport(peer);
+    }
+
+    /* a peer of another loop gets its handle initialized over there */
+    if (peer->getUvLoop() != getUvLoop()) {
+        return peer;
+    }
+
     int rc;
-    if ((rc = uv_pipe_init(
-                    getUvLoop(),
-                    reinterpret_cast<uv_pipe_t *>(peer->getHandle()),
-                    0))) {
+    if ((rc = peer->initHandle())) {
         LOG(WARNING)
             << "uv_pipe_init: ["
             << uv_err_name(rc)
@@ -20,7 +20,8 @@
 namespace opflex {
 namespace jsonrpc {
 
-RpcConnection::RpcConnection() : requestId(1), connGeneration(0) {
+RpcConnection::RpcConnection()
+    : requestId(1), connGeneration(0), congested(false) {
 }
 
 RpcConnection::~RpcConnection() {
@@ -29,16 +30,18 @@ RpcConnection::~RpcConnection() {
 void RpcConnection::cleanup() {
     const std::lock_guard<std::mutex> lock(queue_mutex);
     connGeneration += 1;
-    while (!write_queue.empty()) {
-        delete write_queue.front().first;
-        write_queue.pop_front();
-    }
+    congested = false;
+    write_queue.clear();
 }
 
 void RpcConnection::sendMessage(JsonRpcMessage* message, bool sync) {
+    sendMessage(std::shared_ptr<JsonRpcMessage>(message), sync);
+}
+
+void RpcConnection::sendMessage(const std::shared_ptr<JsonRpcMessage>& message,
+                                bool sync) {
     if (sync) {
-        std::unique_ptr<JsonRpcMessage> messagep(message);
-        doWrite(message);
+        doWrite(message.get());
     } else {
         const std::lock_guard<std::mutex> lock(queue_mutex);
         write_queue.push_back(std::make_pair(message, connGeneration));
@@ -49,20 +52,31 @@ void RpcConnection::sendMessage(JsonRpcMessage* message, bool sync) {
 
 void RpcConnection::processWriteQueue() {
     const std::lock_guard<std::mutex> lock(queue_mutex);
-    while (!write_queue.empty()) {
-        const write_queue_item_t& qi = write_queue.front();
+    // stop as soon as the peer is congested; the rest of the queue
+    // is written once it drains
+    while (!write_queue.empty() && !congested) {
+        write_queue_item_t& qi = write_queue.front();
         // Avoid writing messages from a previous reconnect attempt
         if (qi.second < connGeneration) {
             LOG(DEBUG) << "Ignoring " << qi.first->getMethod()
                        << " of type " << qi.first->getType();
+            write_queue.pop_front();
             continue;
         }
-        std::unique_ptr<JsonRpcMessage> message(qi.first);
+        std::shared_ptr<JsonRpcMessage> message(std::move(qi.first));
         write_queue.pop_front();
         doWrite(message.get());
     }
 }
 
+void RpcConnection::congestionChanged(bool congested_) {
+    congested = congested_;
+    // this can be called while the write queue is being processed,
+    // so let the loop process it again later
+    if (!congested_)
+        messagesReady();
+}
+
 void RpcConnection::doWrite(JsonRpcMessage* message) {
     if (getPeer() == NULL) return;
 
@@ -74,7 +88,8 @@ void RpcConnection::doWrite(JsonRpcMessage* message) {
             uint64_t xid = message->getReqXid();
             if (xid == 0) xid = requestId++;
             yajr::rpc::OutboundRequest outm(wrapper, &method, xid, getPeer());
-            outm.send();
+            if (outm.send())
+                requestSent(xid, message->getMethod());
         }
         break;
     case jsonrpc::JsonRpcMessage::RESPONSE:
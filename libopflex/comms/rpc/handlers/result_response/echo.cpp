@@ -12,6 +12,7 @@
 #endif
 
 
+#include <opflex/yajr/internal/comms.hpp>
 #include <yajr/rpc/methods.hpp>
 #include <yajr/rpc/gen/echo.hpp>
 
@@ -20,6 +21,15 @@ namespace yajr {
 
 template<>
 void InbRes<&yajr::rpc::method::echo>::process() const {
+    /* the payload starts with the timestamp sent by EchoGen, possibly
+     * followed by padding that the sender added to size the message */
+    rapidjson::Value const & payload = getPayload();
+    if (!payload.IsArray() || payload.Empty() || !payload[0].IsUint64()) {
+        return;
+    }
+
+    dynamic_cast< ::yajr::comms::internal::CommunicationPeer const * >
+        (getPeer())->onEchoRes(payload[0].GetUint64());
 }
 
 }
@@ -12,12 +12,9 @@
 #endif
 
 
-#include <yajr/rpc/internal/fnv_1a_64.hpp>
-#include <yajr/rpc/methods.hpp>
+#include <yajr/rpc/method_lookup.hpp>
 #include <opflex/yajr/rpc/rpc.hpp>
 
-namespace fnv_1a_64 = yajr::rpc::internal::fnv_1a_64;
-
 namespace yajr {
     namespace rpc {
 
@@ -29,10 +26,7 @@ MessageFactory::InboundError(
 
     char const * method = id[rapidjson::SizeType(0)].GetString();
 
-#undef  PERFECT_RET_VAL
-#define PERFECT_RET_VAL(method) \
-    new (std::nothrow) InbErr<&method>(peer, error, id)
-#include <yajr/rpc/method_lookup.hpp>
+    return internal::method_lookup::lookup(method).error(peer, error, id);
 }
 
 }
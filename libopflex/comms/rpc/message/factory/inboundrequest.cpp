@@ -12,12 +12,9 @@
 #endif
 
 
-#include <yajr/rpc/internal/fnv_1a_64.hpp>
-#include <yajr/rpc/methods.hpp>
+#include <yajr/rpc/method_lookup.hpp>
 #include <opflex/yajr/rpc/rpc.hpp>
 
-namespace fnv_1a_64 = yajr::rpc::internal::fnv_1a_64;
-
 namespace yajr {
     namespace rpc {
 
@@ -27,10 +24,7 @@ MessageFactory::InboundRequest(
         rapidjson::Value const & params,
         char const * method,
         rapidjson::Value const & id) {
-#undef  PERFECT_RET_VAL
-#define PERFECT_RET_VAL(method) \
-    new (std::nothrow) InbReq<&method>(peer, params, id)
-#include <yajr/rpc/method_lookup.hpp>
+    return internal::method_lookup::lookup(method).request(peer, params, id);
 }
 
 }
@@ -12,12 +12,9 @@
 #endif
 
 
-#include <yajr/rpc/internal/fnv_1a_64.hpp>
-#include <yajr/rpc/methods.hpp>
+#include <yajr/rpc/method_lookup.hpp>
 #include <opflex/yajr/rpc/rpc.hpp>
 
-namespace fnv_1a_64 = yajr::rpc::internal::fnv_1a_64;
-
 namespace yajr {
     namespace rpc {
 
@@ -29,11 +26,7 @@ MessageFactory::InboundResult(
 
     char const * method = id[rapidjson::SizeType(0)].GetString();
 
-#undef  PERFECT_RET_VAL
-#define PERFECT_RET_VAL(method) \
-    new (std::nothrow) InbRes<&method>(peer, result, id)
-#include <yajr/rpc/method_lookup.hpp>
-
+    return internal::method_lookup::lookup(method).result(peer, result, id);
 }
 
 } /* yajr::rpc namespace */
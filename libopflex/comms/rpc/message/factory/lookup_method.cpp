@@ -12,23 +12,92 @@
 #endif
 
 
-#include <yajr/rpc/internal/fnv_1a_64.hpp>
-#include <yajr/rpc/methods.hpp>
+#include <yajr/rpc/method_lookup.hpp>
 
-namespace fnv_1a_64 = yajr::rpc::internal::fnv_1a_64;
+#include <cstring>
 
 namespace yajr {
     namespace rpc {
+        namespace internal {
+            namespace method_lookup {
+
+namespace {
+
+template <MethodName * M>
+yajr::rpc::InboundRequest * newRequest(
+        yajr::Peer& peer,
+        rapidjson::Value const & params,
+        rapidjson::Value const & id) {
+    return new (std::nothrow) InbReq<M>(peer, params, id);
+}
+
+template <MethodName * M>
+yajr::rpc::InboundResult * newResult(
+        yajr::Peer& peer,
+        rapidjson::Value const & result,
+        rapidjson::Value const & id) {
+    return new (std::nothrow) InbRes<M>(peer, result, id);
+}
+
+template <MethodName * M>
+yajr::rpc::InboundError * newError(
+        yajr::Peer& peer,
+        rapidjson::Value const & error,
+        rapidjson::Value const & id) {
+    return new (std::nothrow) InbErr<M>(peer, error, id);
+}
+
+#define ENTRY(m) \
+    { &yajr::rpc::method::m, newRequest<&yajr::rpc::method::m>, \
+      newResult<&yajr::rpc::method::m>, newError<&yajr::rpc::method::m> }
+
+/* indexed like names, with method::unknown last */
+Entry const entries[methods + 1] = {
+#define XX(m) ENTRY(m),
+    YAJR_RPC_METHODS(XX)
+#undef XX
+    ENTRY(unknown)
+};
+
+#undef ENTRY
+
+/* the index in entries of the method in a slot, or methods if none */
+constexpr unsigned char slotIndex(std::size_t s, std::size_t i = 0) {
+    return i == methods ? methods
+        : (nameSlot(i) == s ? i : slotIndex(s, i + 1));
+}
+
+#define S1(s) slotIndex(s)
+#define S4(s) S1(s), S1(s + 1), S1(s + 2), S1(s + 3)
+#define S16(s) S4(s), S4(s + 4), S4(s + 8), S4(s + 12)
+
+static_assert(slots == 64, "the slot table below has 64 entries");
+constexpr unsigned char table[slots] = {
+    S16(0), S16(16), S16(32), S16(48)
+};
+
+#undef S16
+#undef S4
+#undef S1
+
+} /* anonymous namespace */
+
+Entry const & lookup(char const * method) {
+    std::size_t i = table[slot(fnv_1a_64::hash_runtime(method))];
+    /* names outside the set can land in any slot */
+    if (i != methods && std::strcmp(names[i], method)) {
+        i = methods;
+    }
+    return entries[i];
+}
+
+} /* yajr::rpc::internal::method_lookup namespace */
+} /* yajr::rpc::internal namespace */
 
 MethodName const *
 MessageFactory::lookupMethod(char const * method) {
-
-#undef  PERFECT_RET_VAL
-#define PERFECT_RET_VAL(method) \
-    &method
-#include <yajr/rpc/method_lookup.hpp>
+    return internal::method_lookup::lookup(method).method;
 }
 
 } /* yajr::rpc namespace */
 } /* yajr namespace */
-
@@ -17,6 +17,8 @@
 #include <openssl/err.h>
 #include <openssl/conf.h>
 
+#include <yajr/rpc/cbor_reader.hpp>
+#include <yajr/rpc/method_lookup.hpp>
 #include <yajr/transport/ZeroCopyOpenSSL.hpp>
 #include <opflex/yajr/internal/comms.hpp>
 
@@ -560,6 +562,55 @@ BOOST_FIXTURE_TEST_CASE( STABLE_test_pipe, CommsFixture ) {
 
 }
 
+BOOST_FIXTURE_TEST_CASE( STABLE_test_seqpacket, CommsFixture ) {
+
+    static const char * domainSocket = "/tmp/comms_test_test_seqpacket.sock";
+
+    unlink(domainSocket);
+
+    ::yajr::Listener * l = ::yajr::Listener::create(
+            std::string("seqpacket:") + domainSocket, doNothingOnConnect,
+            NULL, NULL, CommsFixture::current_loop, CommsFixture::loopSelector
+    );
+
+    BOOST_CHECK_EQUAL(!l, 0);
+
+    ::yajr::Peer * p = ::yajr::Peer::create(
+            std::string("seqpacket:") + domainSocket, doNothingOnConnect,
+            NULL, CommsFixture::loopSelector
+    );
+
+    BOOST_CHECK_EQUAL(!p, 0);
+
+    loop_until_final(range_t(3,3), pc_successful_connect);
+
+}
+
+BOOST_FIXTURE_TEST_CASE( STABLE_test_seqpacket_keepalive, CommsFixture ) {
+
+    static const char * domainSocket =
+        "/tmp/comms_test_test_seqpacket_keepalive.sock";
+
+    unlink(domainSocket);
+
+    ::yajr::Listener * l = ::yajr::Listener::create(
+            std::string("seqpacket:") + domainSocket, startPingingOnConnect,
+            NULL, NULL, CommsFixture::current_loop, CommsFixture::loopSelector
+    );
+
+    BOOST_CHECK_EQUAL(!l, 0);
+
+    ::yajr::Peer * p = ::yajr::Peer::create(
+            std::string("seqpacket:") + domainSocket, startPingingOnConnect,
+            NULL, CommsFixture::loopSelector
+    );
+
+    BOOST_CHECK_EQUAL(!p, 0);
+
+    loop_until_final(range_t(4,4), pc_successful_connect, range_t(0,0), true, DEFAULT_COMMSTEST_TIMEOUT); // 4 is to cause a timeout
+
+}
+
 static void pc_non_existent(void) {
 
     /* non-empty */
@@ -650,6 +701,226 @@ BOOST_FIXTURE_TEST_CASE( STABLE_test_keepalive, CommsFixture ) {
 
 }
 
+void CountKeepAliveRtt(::yajr::Peer * p, void * data, uint64_t rtt) {
+    ++CommsFixture::eventCounter;
+}
+
+void StartFastPingingOnConnect(
+        ::yajr::Peer * p,
+        void * data,
+        ::yajr::StateChange::To stateChange,
+        int error) {
+    if (stateChange == ::yajr::StateChange::CONNECT) {
+        LOG(DEBUG) << "got a CONNECT notification on " << p;
+        p->setRttCallback(CountKeepAliveRtt);
+        /* one echo now, and one on every firing of the keep-alive */
+        p->startKeepAlive(50, 50, 60000);
+        return;
+    }
+    DoNothingOnConnect(p, data, stateChange, error);
+}
+
+/* a repeating keep-alive is rescheduled on the wheel each time it
+ * fires, so the echoes keep coming */
+BOOST_FIXTURE_TEST_CASE( STABLE_test_keepalive_wheel_repeat, CommsFixture ) {
+
+    LOG(DEBUG);
+
+    ::yajr::Listener * l = ::yajr::Listener::create(
+            "127.0.0.1", 65532-kPortOffset, doNothingOnConnect,
+            NULL, NULL, CommsFixture::current_loop, CommsFixture::loopSelector
+    );
+
+    BOOST_CHECK_EQUAL(!l, 0);
+
+    ::yajr::Peer * p = ::yajr::Peer::create(
+            "127.0.0.1", std::to_string(65532-kPortOffset),
+            StartFastPingingOnConnect,
+            NULL, CommsFixture::loopSelector
+    );
+
+    BOOST_CHECK_EQUAL(!p, 0);
+
+    /* the first echo and at least four firings */
+    loop_until_final(range_t(3,3), pc_successful_connect, range_t(0,0), false, DEFAULT_COMMSTEST_TIMEOUT, 5);
+
+}
+
+static const uint64_t kKeepAliveBegin = 200;
+static uint64_t keepAliveStarted;
+
+void ExpireKeepAliveOnConnect(
+        ::yajr::Peer * p,
+        void * data,
+        ::yajr::StateChange::To stateChange,
+        int error) {
+    switch(stateChange) {
+        case ::yajr::StateChange::CONNECT:
+            LOG(DEBUG) << "got a CONNECT notification on " << p;
+            keepAliveStarted = uv_now(CommsFixture::current_loop);
+            /* any silence is too long, so the first firing tears the
+             * connection down */
+            p->startKeepAlive(kKeepAliveBegin, kKeepAliveBegin, 1);
+            break;
+        case ::yajr::StateChange::DISCONNECT:
+            LOG(DEBUG) << "got a DISCONNECT notification on " << p;
+            /* the wheel never fires early */
+            BOOST_CHECK_GE(uv_now(CommsFixture::current_loop) - keepAliveStarted,
+                           kKeepAliveBegin);
+            ++CommsFixture::eventCounter;
+            break;
+        default:
+            DoNothingOnConnect(p, data, stateChange, error);
+    }
+}
+
+/* an expired keep-alive tears the connection down, and the timer of
+ * the new connection is armed afresh */
+BOOST_FIXTURE_TEST_CASE( STABLE_test_keepalive_wheel_expiry, CommsFixture ) {
+
+    LOG(DEBUG);
+
+    ::yajr::Listener * l = ::yajr::Listener::create(
+            "127.0.0.1", 65532-kPortOffset, doNothingOnConnect,
+            NULL, NULL, CommsFixture::current_loop, CommsFixture::loopSelector
+    );
+
+    BOOST_CHECK_EQUAL(!l, 0);
+
+    ::yajr::Peer * p = ::yajr::Peer::create(
+            "127.0.0.1", std::to_string(65532-kPortOffset),
+            ExpireKeepAliveOnConnect,
+            NULL, CommsFixture::loopSelector
+    );
+
+    BOOST_CHECK_EQUAL(!p, 0);
+
+    /* the peer reconnects after each expiry */
+    loop_until_final(range_t(1,3), NULL, range_t(0,3), false, DEFAULT_COMMSTEST_TIMEOUT, 2);
+
+}
+
+void StartCoalescedPingingOnConnect(
+        ::yajr::Peer * p,
+        void * data,
+        ::yajr::StateChange::To stateChange,
+        int error) {
+    if (stateChange == ::yajr::StateChange::CONNECT) {
+        p->setWriteCoalescing(64 * 1024);
+    }
+    StartPingingOnConnect(p, data, stateChange, error);
+}
+
+BOOST_FIXTURE_TEST_CASE( STABLE_test_keepalive_coalesced, CommsFixture ) {
+
+    LOG(DEBUG);
+
+    ::yajr::Listener * l = ::yajr::Listener::create(
+            "127.0.0.1", 65532-kPortOffset, StartCoalescedPingingOnConnect,
+            NULL, NULL, CommsFixture::current_loop, CommsFixture::loopSelector
+    );
+
+    BOOST_CHECK_EQUAL(!l, 0);
+
+    ::yajr::Peer * p = ::yajr::Peer::create(
+            "127.0.0.1", std::to_string(65532-kPortOffset),
+            StartCoalescedPingingOnConnect,
+            NULL, CommsFixture::loopSelector
+    );
+
+    BOOST_CHECK_EQUAL(!p, 0);
+
+    loop_until_final(range_t(4,4), pc_successful_connect, range_t(0,0), true, DEFAULT_COMMSTEST_TIMEOUT); // 4 is to cause a timeout
+
+}
+
+void StartOffloadedPingingOnConnect(
+        ::yajr::Peer * p,
+        void * data,
+        ::yajr::StateChange::To stateChange,
+        int error) {
+    if (stateChange == ::yajr::StateChange::CONNECT) {
+        /* every frame gets parsed on the thread pool */
+        p->setParseOffload(1);
+    }
+    StartPingingOnConnect(p, data, stateChange, error);
+}
+
+BOOST_FIXTURE_TEST_CASE( STABLE_test_keepalive_parse_offload, CommsFixture ) {
+
+    LOG(DEBUG);
+
+    ::yajr::Listener * l = ::yajr::Listener::create(
+            "127.0.0.1", 65532-kPortOffset, StartOffloadedPingingOnConnect,
+            NULL, NULL, CommsFixture::current_loop, CommsFixture::loopSelector
+    );
+
+    BOOST_CHECK_EQUAL(!l, 0);
+
+    ::yajr::Peer * p = ::yajr::Peer::create(
+            "127.0.0.1", std::to_string(65532-kPortOffset),
+            StartOffloadedPingingOnConnect,
+            NULL, CommsFixture::loopSelector
+    );
+
+    BOOST_CHECK_EQUAL(!p, 0);
+
+    loop_until_final(range_t(4,4), pc_successful_connect, range_t(0,0), true, DEFAULT_COMMSTEST_TIMEOUT); // 4 is to cause a timeout
+
+}
+
+static size_t congestedCount = 0;
+static size_t drainedCount = 0;
+
+void CountWatermarks(::yajr::Peer * p, void * data, bool congested) {
+    if (congested) {
+        ++congestedCount;
+    } else {
+        ++drainedCount;
+    }
+}
+
+void StartWatermarkedPingingOnConnect(
+        ::yajr::Peer * p,
+        void * data,
+        ::yajr::StateChange::To stateChange,
+        int error) {
+    if (stateChange == ::yajr::StateChange::CONNECT) {
+        /* every echo crosses the high watermark until it is sent */
+        p->setWatermarks(1, 0, CountWatermarks);
+    }
+    StartPingingOnConnect(p, data, stateChange, error);
+}
+
+BOOST_FIXTURE_TEST_CASE( STABLE_test_keepalive_watermarks, CommsFixture ) {
+
+    LOG(DEBUG);
+
+    congestedCount = drainedCount = 0;
+
+    ::yajr::Listener * l = ::yajr::Listener::create(
+            "127.0.0.1", 65532-kPortOffset, StartWatermarkedPingingOnConnect,
+            NULL, NULL, CommsFixture::current_loop, CommsFixture::loopSelector
+    );
+
+    BOOST_CHECK_EQUAL(!l, 0);
+
+    ::yajr::Peer * p = ::yajr::Peer::create(
+            "127.0.0.1", std::to_string(65532-kPortOffset),
+            StartWatermarkedPingingOnConnect,
+            NULL, CommsFixture::loopSelector
+    );
+
+    BOOST_CHECK_EQUAL(!p, 0);
+
+    loop_until_final(range_t(4,4), pc_successful_connect, range_t(0,0), true, DEFAULT_COMMSTEST_TIMEOUT); // 4 is to cause a timeout
+
+    BOOST_CHECK(congestedCount > 0);
+    BOOST_CHECK(drainedCount > 0);
+    BOOST_CHECK(congestedCount - drainedCount <= 2);
+
+}
+
 void pc_no_peers(void) {
 
     /* empty */
@@ -1761,9 +2032,283 @@ BOOST_FIXTURE_TEST_CASE( STABLE_test_several_SSL_peers, CommsFixture ) {
 
     loop_until_final(range_t(401,401), pc_successful_connect200, range_t(0,0), true, 800); // 401 is to cause a timeout
 
+}
+
+/* connects a client to one listener twice and then to a listener
+ * that refuses it, one connection at a time */
+struct SessionResumption {
+    ZeroCopyOpenSSL::Ctx * clientCtx;
+    ::yajr::Peer * peer;
+    uv_timer_t timer;
+    int step;
+    bool dropped;
+} sessionResumption;
+
+::yajr::Peer * connectWithSession(int port) {
+    ::yajr::Peer * p = ::yajr::Peer::create(
+            "127.0.0.1",
+            std::to_string(port),
+            singlePingOnConnect,
+            NULL, CommsFixture::loopSelector
+    );
+    BOOST_CHECK_EQUAL(!p, 0);
+    if (p) {
+        BOOST_CHECK(ZeroCopyOpenSSL::attachTransport(
+                    p, sessionResumption.clientCtx, false, "server"));
+    }
+    return p;
+}
+
+void sessionResumptionStep(uv_timer_t * handle) {
+    SessionResumption & r = sessionResumption;
+    switch (r.step) {
+        case 0:
+            /* a full handshake saves the session */
+            if (r.clientCtx->getSessionCount() != 1) {
+                return;
+            }
+            r.peer->destroy();
+            r.peer = connectWithSession(65300-kPortOffset);
+            break;
+        case 1:
+            /* the second connection resumes it */
+            if (r.clientCtx->getResumedCount() != 1) {
+                return;
+            }
+            r.peer->destroy();
+            r.peer = connectWithSession(65299-kPortOffset);
+            break;
+        case 2:
+            /* a failed handshake drops it */
+            if (r.clientCtx->getSessionCount() != 0) {
+                return;
+            }
+            r.dropped = true;
+            r.peer->destroy();
+            uv_timer_stop(handle);
+            break;
+        default:
+            return;
+    }
+    ++r.step;
+}
+
+void pc_session_resumption(void) {
+    SessionResumption & r = sessionResumption;
+    BOOST_CHECK_EQUAL(r.clientCtx->getResumedCount(), 1);
+    BOOST_CHECK(r.dropped);
+    uv_timer_stop(&r.timer);
+    if (!uv_is_closing((uv_handle_t *)&r.timer)) {
+        uv_close((uv_handle_t *)&r.timer, NULL);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE( STABLE_test_SSL_session_resumption, CommsFixture ) {
+
+    LOG(DEBUG);
+
+    std::unique_ptr< ::yajr::transport::ZeroCopyOpenSSL::Ctx > serverCtx(
+        ::yajr::transport::ZeroCopyOpenSSL::Ctx::createCtx(
+            NULL,
+            SRCDIR"/test/server.pem",
+            "password123"
+        )
+    );
+
+    /* requires a client certificate, which the client does not have */
+    std::unique_ptr< ::yajr::transport::ZeroCopyOpenSSL::Ctx > strictCtx(
+        ::yajr::transport::ZeroCopyOpenSSL::Ctx::createCtx(
+            SRCDIR"/test/ca.pem",
+            SRCDIR"/test/server.pem",
+            "password123"
+        )
+    );
+
+    std::unique_ptr< ::yajr::transport::ZeroCopyOpenSSL::Ctx > clientCtx(
+        ::yajr::transport::ZeroCopyOpenSSL::Ctx::createCtx(
+            SRCDIR"/test/ca.pem",
+            NULL,
+            NULL,
+            true
+        )
+    );
+
+    BOOST_CHECK_EQUAL(!serverCtx, 0);
+    BOOST_CHECK_EQUAL(!strictCtx, 0);
+    BOOST_CHECK_EQUAL(!clientCtx, 0);
+
+    if (!serverCtx || !strictCtx || !clientCtx) {
+        return;
+    }
+
+    strictCtx->setVerify();
+
+    ::yajr::Listener * l = ::yajr::Listener::create(
+            "127.0.0.1",
+            65300-kPortOffset,
+            attachPassiveSslTransportOnConnect,
+            passthroughAccept,
+            serverCtx.get(),
+            CommsFixture::current_loop, CommsFixture::loopSelector
+    );
+
+    BOOST_CHECK_EQUAL(!l, 0);
+
+    ::yajr::Listener * strict = ::yajr::Listener::create(
+            "127.0.0.1",
+            65299-kPortOffset,
+            attachPassiveSslTransportOnConnect,
+            passthroughAccept,
+            strictCtx.get(),
+            CommsFixture::current_loop, CommsFixture::loopSelector
+    );
+
+    BOOST_CHECK_EQUAL(!strict, 0);
+
+    SessionResumption & r = sessionResumption;
+    r.clientCtx = clientCtx.get();
+    r.step = 0;
+    r.dropped = false;
+    r.peer = connectWithSession(65300-kPortOffset);
+
+    uv_timer_init(CommsFixture::current_loop, &r.timer);
+    uv_timer_start(&r.timer, sessionResumptionStep, 20, 20);
+
+    loop_until_final(range_t(10,10), pc_session_resumption, range_t(0,0), true, 2000); // 10 is to cause a timeout
+
 }
 #endif
 
 
 BOOST_AUTO_TEST_SUITE_END()
 
+BOOST_AUTO_TEST_SUITE(binary_encoding)
+
+BOOST_AUTO_TEST_CASE( cbor_round_trip ) {
+
+    static const char json[] =
+        "{\"id\":[\"policy_resolve\",18446744073709551615],"
+        "\"method\":\"policy_resolve\",\"params\":[{"
+        "\"subject\":\"EpdrL2Discovered\",\"prr\":3600,"
+        "\"small\":[0,23,24,255,256,65535,65536,4294967295,4294967296],"
+        "\"negative\":[-1,-24,-25,-2147483648,-2147483649,"
+        "-9223372036854775808],"
+        "\"double\":-1.25,\"yes\":true,\"no\":false,\"nothing\":null,"
+        "\"empty\":{},\"none\":[],\"text\":\"\",\"uri\":\"/PolicyUniverse/"
+        "PolicySpace/test/GbpEpGroup/group1/\"}]}";
+
+    rapidjson::Document in;
+    in.Parse(json);
+    BOOST_REQUIRE(!in.HasParseError());
+
+    ::yajr::internal::StringQueue queue;
+    ::yajr::rpc::SendHandler writer(queue);
+    writer.SetBinary(true);
+    BOOST_REQUIRE(in.Accept(writer));
+
+    std::string encoded(queue.deque_.begin(), queue.deque_.end());
+    BOOST_CHECK(encoded.size() < sizeof(json));
+
+    rapidjson::Document out;
+    ::yajr::rpc::CborReader reader(encoded.data(), encoded.size());
+    out.Populate(reader);
+    BOOST_REQUIRE(reader.IsValid());
+    BOOST_CHECK(in == out);
+
+    /* a value serialized ahead of time is re-encoded too */
+    queue.Clear();
+    writer.Reset(queue);
+    BOOST_REQUIRE(writer.RawValue(json, sizeof(json) - 1,
+                                  rapidjson::kObjectType));
+    BOOST_CHECK(encoded == std::string(queue.deque_.begin(),
+                                       queue.deque_.end()));
+
+    /* a prepared value is encoded once and then copied as it is */
+    ::yajr::rpc::PreparedValue prepared(json, rapidjson::kObjectType);
+    for (int i = 0; i < 2; ++i) {
+        queue.Clear();
+        writer.Reset(queue);
+        BOOST_REQUIRE(writer.Prepared(prepared));
+        BOOST_CHECK(encoded == std::string(queue.deque_.begin(),
+                                           queue.deque_.end()));
+    }
+
+    /* and written as JSON by a handler that writes JSON */
+    queue.Clear();
+    writer.Reset(queue);
+    writer.SetBinary(false);
+    BOOST_REQUIRE(writer.Prepared(prepared));
+    BOOST_CHECK(std::string(json) == std::string(queue.deque_.begin(),
+                                                 queue.deque_.end()));
+    writer.SetBinary(true);
+
+    /* truncated frames are rejected */
+    for (size_t n = 0; n < encoded.size(); ++n) {
+        rapidjson::Document partial;
+        ::yajr::rpc::CborReader partialReader(encoded.data(), n);
+        partial.Populate(partialReader);
+        BOOST_CHECK(!partialReader.IsValid());
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(block_cache)
+
+BOOST_AUTO_TEST_CASE(reuse) {
+
+    using ::yajr::internal::BlockCache;
+
+    /* a freed block is handed out again for any size of its class */
+    void * p = BlockCache::allocate(100);
+    BlockCache::deallocate(p, 100);
+    void * q = BlockCache::allocate(120);
+    BOOST_CHECK_EQUAL(p, q);
+    BlockCache::deallocate(q, 120);
+
+    /* large blocks bypass the cache */
+    void * big = BlockCache::allocate(1 << 20);
+    BOOST_REQUIRE(big);
+    BlockCache::deallocate(big, 1 << 20);
+
+    /* a drained queue leaves its nodes behind for the next one */
+    ::yajr::internal::StringQueue queue;
+    for (size_t i = 0; i < 100000; ++i) {
+        queue.deque_.push_back('x');
+    }
+    queue.Clear();
+    queue.ShrinkToFit();
+    for (size_t i = 0; i < 100000; ++i) {
+        queue.deque_.push_back('y');
+    }
+    BOOST_CHECK_EQUAL(100000u, queue.GetSize());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(method_lookup)
+
+BOOST_AUTO_TEST_CASE(perfect_hash) {
+
+    using ::yajr::rpc::MessageFactory;
+    namespace method = ::yajr::rpc::method;
+
+    BOOST_CHECK_EQUAL(&method::echo, MessageFactory::lookupMethod("echo"));
+    BOOST_CHECK_EQUAL(&method::policy_resolve,
+            MessageFactory::lookupMethod("policy_resolve"));
+    BOOST_CHECK_EQUAL(&method::custom, MessageFactory::lookupMethod("custom"));
+
+    /* every method of the set is found in its own slot */
+    for (char const * name : ::yajr::rpc::internal::method_lookup::names) {
+        BOOST_CHECK_EQUAL(std::string(name),
+                MessageFactory::lookupMethod(name)->s);
+    }
+
+    /* names outside the set */
+    BOOST_CHECK_EQUAL(&method::unknown, MessageFactory::lookupMethod(""));
+    BOOST_CHECK_EQUAL(&method::unknown,
+            MessageFactory::lookupMethod("policy_resolvex"));
+    BOOST_CHECK_EQUAL(&method::unknown, MessageFactory::lookupMethod("Echo"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
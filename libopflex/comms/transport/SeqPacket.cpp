@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+
+#include <opflex/yajr/transport/SeqPacket.hpp>
+#include <opflex/yajr/internal/comms.hpp>
+
+#include <opflex/logging/internal/logging.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace yajr {
+namespace transport {
+
+using namespace yajr::comms::internal;
+
+char const SeqPacket::kPathPrefix[] = "seqpacket:";
+
+bool SeqPacket::isSeqPacketPath(std::string const & path) {
+    return !path.compare(0, sizeof(kPathPrefix) - 1, kPathPrefix);
+}
+
+std::string SeqPacket::socketPath(std::string const & path) {
+    return isSeqPacketPath(path) ? path.substr(sizeof(kPathPrefix) - 1)
+                                 : path;
+}
+
+namespace {
+
+int openSocket(uv_pipe_t * pipe, char const * path, bool listening) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        return UV_ENAMETOOLONG;
+    }
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
+        return uv_translate_sys_error(errno);
+    }
+
+    int rc = listening
+        ? ::bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr))
+        : ::connect(fd, reinterpret_cast<struct sockaddr *>(&addr),
+                    sizeof(addr));
+    if (rc) {
+        rc = uv_translate_sys_error(errno);
+        close(fd);
+        return rc;
+    }
+
+    if ((rc = uv_pipe_open(pipe, fd))) {
+        close(fd);
+        if (listening) {
+            unlink(path);
+        }
+    }
+
+    return rc;
+}
+
+}
+
+int SeqPacket::connect(uv_pipe_t * pipe, char const * path) {
+    return openSocket(pipe, path, false);
+}
+
+int SeqPacket::bind(uv_pipe_t * pipe, char const * path) {
+    return openSocket(pipe, path, true);
+}
+
+void SeqPacket::attachTransport(CommunicationPeer * peer) {
+    assert(peer->choked_);
+    new (peer->detachTransport()) TransportEngine< SeqPacket >(NULL);
+}
+
+template<>
+int Cb< SeqPacket >::send_cb(CommunicationPeer * peer) {
+    assert(!peer->getPendingBytes());
+
+    ::yajr::internal::StringQueue::Deque & q = peer->getStringQueue().deque_;
+    size_t size = q.size();
+
+    if (!size) {
+        LOG(TRACE) << "Nothing left to be sent!";
+        return 0;
+    }
+
+    /* each write goes out as a single record, which ends where the
+     * last message that fits in it does, unless it is the first one */
+    if (size > SeqPacket::kMaxRecordSize) {
+        typedef std::reverse_iterator<
+            ::yajr::internal::StringQueue::Deque::iterator > rev;
+        rev last = std::find(rev(q.begin() + SeqPacket::kMaxRecordSize),
+                             rev(q.begin()), '\0');
+        size = last != rev(q.begin())
+            ? last.base() - q.begin()
+            : SeqPacket::kMaxRecordSize;
+    }
+    peer->setPendingBytes(size);
+
+    std::vector<iovec> iov =
+        ::yajr::comms::internal::get_iovec(q.begin(), q.begin() + size);
+
+    assert (iov.size());
+
+    return peer->writeIOV(iov);
+}
+
+template<>
+void Cb< SeqPacket >::on_sent(CommunicationPeer const * peer) {
+    peer->getStringQueue().deque_.erase(
+            peer->getStringQueue().deque_.begin(),
+            peer->getStringQueue().deque_.begin() + peer->getPendingBytes()
+    );
+}
+
+template<>
+void Cb< SeqPacket >::alloc_cb(uv_handle_t * _, size_t size, uv_buf_t* buf) {
+    /* a shorter buffer would truncate the record, plus room for a NUL */
+    size_t bufferSize = SeqPacket::kMaxRecordSize + 1;
+    *buf = uv_buf_init((char*) malloc(bufferSize), bufferSize);
+}
+
+template<>
+void Cb< SeqPacket >::on_read(uv_stream_t * h, ssize_t nread, uv_buf_t const * buf) {
+    CommunicationPeer * peer = comms::internal::Peer::get<CommunicationPeer>(h);
+
+    if (!peer->connected_) {
+        if (buf->base) {
+            free(buf->base);
+        }
+        return;
+    }
+
+    if (nread < 0) {
+        LOG(DEBUG)
+            << peer << " nread = " <<  nread << " ["
+            << uv_err_name(nread) << "] "
+            << uv_strerror(nread) << " => closing";
+        peer->onDisconnect();
+    }
+
+    if (nread > 0) {
+        if (peer->nullTermination) {
+            peer->readRecord(
+                buf->base,
+                nread,
+                (buf->len > static_cast< size_t >(nread))
+            );
+        } else {
+            if (buf->len > (size_t)nread) {
+                buf->base[nread++] = '\0';
+            }
+            peer->readBufNoNull(buf->base, nread);
+        }
+    }
+
+    if (buf->base) {
+        free(buf->base);
+    }
+
+}
+
+} /* yajr::transport namespace */
+} /* yajr namespace */
@@ -20,6 +20,7 @@
 
 #include <openssl/err.h>
 
+#include <algorithm>
 #include <cassert>
 
 namespace {
@@ -109,6 +110,7 @@ ssize_t Cb< ZeroCopyOpenSSL >::StaticHelpers::tryToDecrypt(
         IF_SSL_ERROR(sslErr) {
             LOG(ERROR) << peer << " Failed to decrypt input: " << sslErr;
         }
+        e->forgetSession();
         peer->onDisconnect();
     }
 
@@ -137,22 +139,27 @@ ssize_t Cb< ZeroCopyOpenSSL >::StaticHelpers::tryToEncrypt(
     ssize_t totalWrite = 0;
     ssize_t nwrite = 0;
 
-    std::vector<iovec> iovIn =
-        ::yajr::comms::internal::get_iovec(
-                peer->getStringQueue().deque_.begin(),
-                peer->getStringQueue().deque_.end()
-        );
+    /* The deque hands out its storage in small blocks, and each
+     * BIO_write() becomes at least one TLS record, so gather the
+     * blocks into full records first. The staging buffer is shared by
+     * all the peers of the thread, as it is only used in here.
+     */
+    static thread_local char record[SSL3_RT_MAX_PLAIN_LENGTH];
+
+    ::yajr::internal::StringQueue::Deque const & queue =
+        peer->getStringQueue().deque_;
 
-    std::vector<iovec>::iterator iovInIt;
-    for (iovInIt = iovIn.begin(); iovInIt != iovIn.end(); ++iovInIt) {
+    while (static_cast<size_t>(totalWrite) < queue.size()) {
 
-        ssize_t tryWrite = iovInIt->iov_len;
+        ssize_t tryWrite = std::min(queue.size() - totalWrite, sizeof(record));
 
-        assert(tryWrite);
+        std::copy(queue.begin() + totalWrite,
+                  queue.begin() + totalWrite + tryWrite,
+                  record);
 
         nwrite = BIO_write(
                 e->bioSSL_,
-                iovInIt->iov_base,
+                record,
                 tryWrite);
 
         if (nwrite > 0) {
@@ -169,6 +176,7 @@ ssize_t Cb< ZeroCopyOpenSSL >::StaticHelpers::tryToEncrypt(
         IF_SSL_ERROR(sslErr, nwrite <= 0) {
             LOG(ERROR) << peer << " Failed to encrypt output: " << sslErr;
         }
+        e->forgetSession();
         const_cast<CommunicationPeer *>(peer)->onDisconnect();
 
         return 0;
@@ -495,14 +503,16 @@ void ZeroCopyOpenSSL::finiOpenSSL() {
 #endif
 }
 
-ZeroCopyOpenSSL::ZeroCopyOpenSSL(ZeroCopyOpenSSL::Ctx * ctx, bool passive)
+ZeroCopyOpenSSL::ZeroCopyOpenSSL(ZeroCopyOpenSSL::Ctx * ctx, bool passive,
+                                 char const * sessionKey)
     :
         bioInternal_(BIO_new(BIO_s_bio())),
         bioExternal_(BIO_new(BIO_s_bio())),
         bioSSL_(BIO_new(BIO_f_ssl())),
         lastOutBuf_(NULL),
         ssl_(NULL),
-        ready_(false)
+        ready_(false),
+        sessionKey_(sessionKey && !passive ? sessionKey : "")
     {
 
     if(bioInternal_ && BIO_set_write_buf_size(bioInternal_, 24576) &&
@@ -529,10 +539,15 @@ ZeroCopyOpenSSL::ZeroCopyOpenSSL(ZeroCopyOpenSSL::Ctx * ctx, bool passive)
     SSL_set_mode(ssl_, SSL_MODE_RELEASE_BUFFERS);
 #endif
 
+    SSL_set_app_data(ssl_, this);
+
     if (passive) {
         SSL_set_accept_state(ssl_);
     } else {
         SSL_set_connect_state(ssl_);
+        if (!sessionKey_.empty()) {
+            ctx->resumeSession(ssl_, sessionKey_);
+        }
     }
 
     /* This is the best way I found to do nothing visible yet trigger the SSL
@@ -554,13 +569,36 @@ ZeroCopyOpenSSL::~ZeroCopyOpenSSL() {
     }
 }
 
-void ZeroCopyOpenSSL::infoCallback(SSL const *, int where, int ret) {
+void ZeroCopyOpenSSL::forgetSession() {
+    if (sessionKey_.empty()) {
+        return;
+    }
+    Ctx * ctx = static_cast< Ctx * >(
+            SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl_)));
+    if (ctx) {
+        ctx->forgetSession(sessionKey_);
+    }
+}
+
+void ZeroCopyOpenSSL::infoCallback(SSL const * ssl, int where, int ret) {
     switch (where) {
         case SSL_CB_HANDSHAKE_START:
             LOG(DEBUG) << " Handshake start!";
             break;
         case SSL_CB_HANDSHAKE_DONE:
-            LOG(DEBUG) << " Handshake done!";
+            if (!SSL_session_reused(const_cast< SSL * >(ssl))) {
+                LOG(DEBUG) << " Handshake done!";
+                break;
+            }
+            LOG(DEBUG) << " Handshake done, session resumed!";
+            if (!SSL_is_server(const_cast< SSL * >(ssl))) {
+                Ctx * ctx = static_cast< Ctx * >(
+                        SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+                if (ctx) {
+                    std::lock_guard<std::mutex> guard(ctx->sessionMutex_);
+                    ++ctx->resumed_;
+                }
+            }
             break;
     }
 }
@@ -629,10 +667,15 @@ ZeroCopyOpenSSL::Ctx::Ctx(
     )
         :
             sslCtx_(c),
-            passphrase_(passphrase?:"")
+            passphrase_(passphrase?:""),
+            resumed_(0)
         {};
 
 ZeroCopyOpenSSL::Ctx::~Ctx(){
+    for (auto & s : sessions_) {
+        SSL_SESSION_free(s.second);
+    }
+
     if (!sslCtx_) {
         return;
     }
@@ -641,6 +684,63 @@ ZeroCopyOpenSSL::Ctx::~Ctx(){
 
 }
 
+int ZeroCopyOpenSSL::Ctx::newSessionCb(SSL * ssl, SSL_SESSION * session) {
+
+    /* the server keeps its sessions in the internal cache and in tickets */
+    if (SSL_is_server(ssl)) {
+        return 0;
+    }
+
+    ZeroCopyOpenSSL * zc = static_cast< ZeroCopyOpenSSL * >(
+            SSL_get_app_data(ssl));
+    Ctx * ctx = static_cast< Ctx * >(
+            SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+    if (!zc || !ctx || zc->sessionKey_.empty()) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> guard(ctx->sessionMutex_);
+    SSL_SESSION * & saved = ctx->sessions_[zc->sessionKey_];
+    if (saved) {
+        SSL_SESSION_free(saved);
+    }
+    /* returning 1 keeps the reference that OpenSSL passed us */
+    saved = session;
+    return 1;
+}
+
+void ZeroCopyOpenSSL::Ctx::resumeSession(SSL * ssl,
+        std::string const & sessionKey) {
+    std::lock_guard<std::mutex> guard(sessionMutex_);
+    auto it = sessions_.find(sessionKey);
+    if (it == sessions_.end()) {
+        return;
+    }
+    /* takes its own reference; a session the server refuses just
+     * falls back to a full handshake */
+    SSL_set_session(ssl, it->second);
+}
+
+void ZeroCopyOpenSSL::Ctx::forgetSession(std::string const & sessionKey) {
+    std::lock_guard<std::mutex> guard(sessionMutex_);
+    auto it = sessions_.find(sessionKey);
+    if (it == sessions_.end()) {
+        return;
+    }
+    SSL_SESSION_free(it->second);
+    sessions_.erase(it);
+}
+
+size_t ZeroCopyOpenSSL::Ctx::getSessionCount() {
+    std::lock_guard<std::mutex> guard(sessionMutex_);
+    return sessions_.size();
+}
+
+size_t ZeroCopyOpenSSL::Ctx::getResumedCount() {
+    std::lock_guard<std::mutex> guard(sessionMutex_);
+    return resumed_;
+}
+
 size_t ZeroCopyOpenSSL::Ctx::addCaFileOrDirectory(
         char const * caFileOrDirectory
     ) {
@@ -744,7 +844,8 @@ size_t ZeroCopyOpenSSL::Ctx::addPrivateKeyFile(
 ZeroCopyOpenSSL::Ctx * ZeroCopyOpenSSL::Ctx::createCtx(
         char const * caFileOrDirectory,
         char const * keyAndCertFilePath,
-        char const * passphrase
+        char const * passphrase,
+        bool client
    ) {
 
 #if (OPENSSL_VERSION_NUMBER < 0x10100000L)
@@ -787,6 +888,24 @@ ZeroCopyOpenSSL::Ctx * ZeroCopyOpenSSL::Ctx::createCtx(
 
         SSL_CTX_set_default_passwd_cb(sslCtx, pwdCb);
         SSL_CTX_set_default_passwd_cb_userdata(sslCtx, ctx); /* Important! */
+        SSL_CTX_set_app_data(sslCtx, ctx);
+
+        /* Clients save their sessions by peer name through the callback
+         * only, so that a reconnect resumes the session rather than
+         * redoing the asymmetric crypto of a full handshake on both sides.
+         * Servers cache the sessions of their clients, and need a session
+         * id context to resume sessions of clients that present a
+         * certificate.
+         */
+        if (client) {
+            SSL_CTX_set_session_cache_mode(sslCtx, SSL_SESS_CACHE_CLIENT |
+                    SSL_SESS_CACHE_NO_INTERNAL_STORE);
+            SSL_CTX_sess_set_new_cb(sslCtx, newSessionCb);
+        } else {
+            SSL_CTX_set_session_cache_mode(sslCtx, SSL_SESS_CACHE_SERVER);
+        }
+        SSL_CTX_set_session_id_context(sslCtx,
+                reinterpret_cast< unsigned char const * >("opflex"), 6);
 
         if (caFileOrDirectory) {
             failure += ctx->addCaFileOrDirectory(caFileOrDirectory);
@@ -843,7 +962,8 @@ void ZeroCopyOpenSSL::Ctx::setNoVerify(
 bool ZeroCopyOpenSSL::attachTransport(
         yajr::Peer * p,
         ZeroCopyOpenSSL::Ctx * ctx,
-        bool inverted_roles) {
+        bool inverted_roles,
+        char const * sessionKey) {
 
     if (!ctx) {
         return false;
@@ -856,7 +976,7 @@ bool ZeroCopyOpenSSL::attachTransport(
     }
 
     ZeroCopyOpenSSL * const e = new (std::nothrow)
-        ZeroCopyOpenSSL(ctx, peer->passive_ ^ inverted_roles);
+        ZeroCopyOpenSSL(ctx, peer->passive_ ^ inverted_roles, sessionKey);
 
     if (!e) {
         return false;
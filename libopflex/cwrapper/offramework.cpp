@@ -14,15 +14,23 @@
 #  include <config.h>
 #endif
 
+#include <cstring>
 #include <new>
 #include <string>
+#include <vector>
 
 #include "opflex/ofcore/OFFramework.h"
+#include "opflex/modb/internal/ObjectStore.h"
 #include "opflex/c/offramework_c.h"
 
 using opflex::ofcore::OFFramework;
 using opflex::ofcore::PeerStatusListener;
 using opflex::modb::ModelMetadata;
+using opflex::modb::ClassInfo;
+using opflex::modb::PropertyInfo;
+using opflex::modb::URI;
+using opflex::modb::mointernal::ObjectInstance;
+using opflex::modb::mointernal::StoreClient;
 
 ofstatus offramework_create(/* out */ offramework_p* framework) {
     ofstatus status = OF_ESUCCESS;
@@ -221,3 +229,111 @@ offramework_register_peerstatuslistener(offramework_p framework,
  done:
     return status;
 }
+
+// copy a string value into the caller's buffer
+static bool copy_str(const std::string& str, char* buf, size_t buf_size,
+                     size_t& used, ofprop_value_t& value) {
+    if (buf == NULL || buf_size - used < str.size() + 1)
+        return false;
+    std::memcpy(buf + used, str.c_str(), str.size() + 1);
+    value.type = OF_PROP_STRING;
+    value.value.str = buf + used;
+    used += str.size() + 1;
+    return true;
+}
+
+ofstatus offramework_read_batch(offramework_p framework,
+                                class_id_t class_id,
+                                const char* const* uris,
+                                size_t count,
+                                const prop_id_t* prop_ids,
+                                size_t prop_count,
+                                /* out */ ofprop_value_t* values,
+                                /* out */ char* buf,
+                                size_t buf_size,
+                                /* out */ size_t* found) {
+    ofstatus status = OF_ESUCCESS;
+    OFFramework* f = NULL;
+    size_t used = 0;
+    size_t present = 0;
+
+    if (framework == NULL ||
+        (count > 0 && uris == NULL) ||
+        (prop_count > 0 && (prop_ids == NULL || values == NULL))) {
+        status = OF_EINVALID_ARG;
+        goto done;
+    }
+    try {
+        f = (OFFramework*)framework;
+        opflex::modb::ObjectStore& store = f->getStore();
+        StoreClient& client = store.getReadOnlyStoreClient();
+
+        // look up the properties once for the whole batch
+        const ClassInfo& ci = store.getClassInfo(class_id);
+        std::vector<const PropertyInfo*> props(prop_count, NULL);
+        for (size_t j = 0; j < prop_count; ++j) {
+            auto it = ci.getProperties().find(prop_ids[j]);
+            if (it != ci.getProperties().end() &&
+                it->second.getCardinality() == PropertyInfo::SCALAR)
+                props[j] = &it->second;
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            ofprop_value_t* row = values + i * prop_count;
+            for (size_t j = 0; j < prop_count; ++j) {
+                row[j].prop_id = prop_ids[j];
+                row[j].type = OF_PROP_NONE;
+            }
+            if (uris[i] == NULL) continue;
+
+            std::shared_ptr<const ObjectInstance> oi;
+            if (!client.get(class_id, URI(uris[i]), oi)) continue;
+            present += 1;
+
+            for (size_t j = 0; j < prop_count; ++j) {
+                const PropertyInfo* pinfo = props[j];
+                if (pinfo == NULL ||
+                    !oi->isSet(pinfo->getId(), pinfo->getType(),
+                               PropertyInfo::SCALAR))
+                    continue;
+                switch (pinfo->getType()) {
+                case PropertyInfo::U64:
+                case PropertyInfo::ENUM8:
+                case PropertyInfo::ENUM16:
+                case PropertyInfo::ENUM32:
+                case PropertyInfo::ENUM64:
+                    row[j].type = OF_PROP_UINT64;
+                    row[j].value.u64 = oi->getUInt64(pinfo->getId());
+                    break;
+                case PropertyInfo::S64:
+                    row[j].type = OF_PROP_INT64;
+                    row[j].value.s64 = oi->getInt64(pinfo->getId());
+                    break;
+                case PropertyInfo::STRING:
+                    if (!copy_str(oi->getString(pinfo->getId()),
+                                  buf, buf_size, used, row[j]))
+                        status = OF_EOUTOFRANGE;
+                    break;
+                case PropertyInfo::MAC:
+                    if (!copy_str(oi->getMAC(pinfo->getId()).toString(),
+                                  buf, buf_size, used, row[j]))
+                        status = OF_EOUTOFRANGE;
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+    } catch (const std::out_of_range& e) {
+        // no such class
+        status = OF_EOUTOFRANGE;
+        goto done;
+    } catch (...) {
+        status = OF_EFAILED;
+        goto done;
+    }
+
+ done:
+    if (found != NULL) *found = present;
+    return status;
+}
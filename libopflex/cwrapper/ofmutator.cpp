@@ -15,10 +15,22 @@
 #endif
 
 
+#include <stdexcept>
+#include <vector>
+
 #include "opflex/modb/Mutator.h"
+#include "opflex/modb/MAC.h"
+#include "opflex/modb/mo-internal/ObjectInstance.h"
+#include "opflex/modb/internal/ObjectStore.h"
+#include "opflex/ofcore/OFFramework.h"
 #include "opflex/c/ofmutator_c.h"
 
 using opflex::modb::Mutator;
+using opflex::modb::ClassInfo;
+using opflex::modb::PropertyInfo;
+using opflex::modb::MAC;
+using opflex::modb::URI;
+using opflex::modb::mointernal::ObjectInstance;
 using opflex::ofcore::OFFramework;
 
 ofstatus ofmutator_create(offramework_p framework,
@@ -100,3 +112,157 @@ ofstatus ofmutator_commit(ofmutator_p mutator) {
  done:
     return status;
 }
+
+/*
+ * Check that a value can be stored in a property: integers in integer
+ * properties, a defined constant in an enum, and a string in a string
+ * or MAC address property, where it must parse as an address
+ */
+static bool check_prop_value(const PropertyInfo& pinfo,
+                             const ofprop_value_t& p) {
+    if (pinfo.getCardinality() != PropertyInfo::SCALAR)
+        return false;
+    switch (pinfo.getType()) {
+    case PropertyInfo::U64:
+        return p.type == OF_PROP_UINT64;
+    case PropertyInfo::S64:
+        return p.type == OF_PROP_INT64;
+    case PropertyInfo::ENUM8:
+    case PropertyInfo::ENUM16:
+    case PropertyInfo::ENUM32:
+    case PropertyInfo::ENUM64:
+        if (p.type != OF_PROP_UINT64)
+            return false;
+        try {
+            pinfo.getEnumInfo().getNameById(p.value.u64);
+        } catch (const std::out_of_range&) {
+            return false;
+        }
+        return true;
+    case PropertyInfo::STRING:
+        return p.type == OF_PROP_STRING && p.value.str != NULL;
+    case PropertyInfo::MAC:
+        if (p.type != OF_PROP_STRING || p.value.str == NULL)
+            return false;
+        try {
+            MAC mac(p.value.str);
+        } catch (const std::invalid_argument&) {
+            return false;
+        }
+        return true;
+    default:
+        return false;
+    }
+}
+
+ofstatus ofmutator_modify_batch(ofmutator_p mutator,
+                                const ofmo_update_t* updates,
+                                size_t count) {
+    ofstatus status = OF_ESUCCESS;
+    Mutator* obj = NULL;
+
+    try {
+        if (mutator == NULL || (updates == NULL && count > 0)) {
+            status = OF_EINVALID_ARG;
+            goto done;
+        }
+
+        // look up the property of each value, checking them all
+        // before anything is modified
+        obj = (Mutator*)mutator;
+        opflex::modb::ObjectStore& store = obj->getFramework().getStore();
+        std::vector<std::vector<const PropertyInfo*> > props(count);
+        for (size_t i = 0; i < count; ++i) {
+            const ofmo_update_t& u = updates[i];
+            if (u.uri == NULL || (u.props == NULL && u.prop_count > 0)) {
+                status = OF_EINVALID_ARG;
+                goto done;
+            }
+            const ClassInfo* ci;
+            try {
+                ci = &store.getClassInfo(u.class_id);
+            } catch (const std::out_of_range&) {
+                status = OF_EOUTOFRANGE;
+                goto done;
+            }
+            props[i].resize(u.prop_count);
+            for (size_t j = 0; j < u.prop_count; ++j) {
+                const ofprop_value_t& p = u.props[j];
+                auto it = ci->getProperties().find(p.prop_id);
+                if (it == ci->getProperties().end() ||
+                    !check_prop_value(it->second, p)) {
+                    status = OF_EINVALID_ARG;
+                    goto done;
+                }
+                props[i][j] = &it->second;
+            }
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            const ofmo_update_t& u = updates[i];
+            ObjectInstance& oi = *obj->modify(u.class_id, URI(u.uri));
+            for (size_t j = 0; j < u.prop_count; ++j) {
+                const ofprop_value_t& p = u.props[j];
+                switch (props[i][j]->getType()) {
+                case PropertyInfo::U64:
+                case PropertyInfo::ENUM8:
+                case PropertyInfo::ENUM16:
+                case PropertyInfo::ENUM32:
+                case PropertyInfo::ENUM64:
+                    oi.setUInt64(p.prop_id, p.value.u64);
+                    break;
+                case PropertyInfo::S64:
+                    oi.setInt64(p.prop_id, p.value.s64);
+                    break;
+                case PropertyInfo::STRING:
+                    oi.setString(p.prop_id, p.value.str);
+                    break;
+                case PropertyInfo::MAC:
+                    oi.setMAC(p.prop_id, MAC(p.value.str));
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+
+    } catch (...) {
+        status = OF_EFAILED;
+        goto done;
+    }
+
+ done:
+    return status;
+}
+
+ofstatus ofmutator_remove_batch(ofmutator_p mutator,
+                                class_id_t class_id,
+                                const char* const* uris,
+                                size_t count) {
+    ofstatus status = OF_ESUCCESS;
+    Mutator* obj = NULL;
+
+    try {
+        if (mutator == NULL || (uris == NULL && count > 0)) {
+            status = OF_EINVALID_ARG;
+            goto done;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (uris[i] == NULL) {
+                status = OF_EINVALID_ARG;
+                goto done;
+            }
+        }
+
+        obj = (Mutator*)mutator;
+        for (size_t i = 0; i < count; ++i)
+            obj->remove(class_id, URI(uris[i]));
+
+    } catch (...) {
+        status = OF_EFAILED;
+        goto done;
+    }
+
+ done:
+    return status;
+}
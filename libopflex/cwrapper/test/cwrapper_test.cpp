@@ -178,4 +178,167 @@ BOOST_FIXTURE_TEST_CASE( mutator, ServerFixture ) {
     BOOST_CHECK(OF_IS_SUCCESS(offramework_destroy(&framework)));
 }
 
+BOOST_FIXTURE_TEST_CASE( batch, MDFixture ) {
+    offramework_p framework = NULL;
+    BOOST_CHECK(OF_IS_SUCCESS(offramework_create(&framework)));
+    BOOST_CHECK(OF_IS_SUCCESS(offramework_set_model(framework, &md)));
+    BOOST_CHECK(OF_IS_SUCCESS(offramework_start(framework)));
+
+    const char* uris[] = { "/class3/1", "/class3/2", "/class3/3" };
+    ofprop_value_t props[2][2];
+    ofmo_update_t updates[2];
+    for (int i = 0; i < 2; ++i) {
+        props[i][0].prop_id = 6;
+        props[i][0].type = OF_PROP_INT64;
+        props[i][0].value.s64 = -i;
+        props[i][1].prop_id = 7;
+        props[i][1].type = OF_PROP_STRING;
+        props[i][1].value.str = uris[i];
+        updates[i].class_id = 3;
+        updates[i].uri = uris[i];
+        updates[i].props = props[i];
+        updates[i].prop_count = 2;
+    }
+
+    ofmutator_p mutator = NULL;
+    BOOST_CHECK(OF_IS_SUCCESS(ofmutator_create(framework, "owner2", &mutator)));
+    BOOST_CHECK(OF_IS_SUCCESS(ofmutator_modify_batch(mutator, updates, 2)));
+    BOOST_CHECK(OF_IS_SUCCESS(ofmutator_commit(mutator)));
+
+    // read back, including an object that does not exist and an
+    // unset property
+    prop_id_t prop_ids[] = { 6, 7, 16 };
+    ofprop_value_t values[3 * 3];
+    char buf[64];
+    size_t found = 0;
+    BOOST_CHECK(OF_IS_SUCCESS(offramework_read_batch(framework, 3, uris, 3,
+                                                     prop_ids, 3, values,
+                                                     buf, sizeof(buf),
+                                                     &found)));
+    BOOST_CHECK_EQUAL(2U, found);
+    for (int i = 0; i < 2; ++i) {
+        BOOST_CHECK_EQUAL(OF_PROP_INT64, values[i * 3].type);
+        BOOST_CHECK_EQUAL(-i, values[i * 3].value.s64);
+        BOOST_CHECK_EQUAL(OF_PROP_STRING, values[i * 3 + 1].type);
+        BOOST_CHECK_EQUAL(string(uris[i]), values[i * 3 + 1].value.str);
+        BOOST_CHECK_EQUAL(OF_PROP_NONE, values[i * 3 + 2].type);
+    }
+    for (int j = 0; j < 3; ++j)
+        BOOST_CHECK_EQUAL(OF_PROP_NONE, values[2 * 3 + j].type);
+
+    // a buffer too small for the strings
+    BOOST_CHECK_EQUAL(OF_EOUTOFRANGE,
+                      offramework_read_batch(framework, 3, uris, 2,
+                                             prop_ids, 3, values,
+                                             buf, 12, NULL));
+    BOOST_CHECK_EQUAL(OF_PROP_STRING, values[1].type);
+    BOOST_CHECK_EQUAL(OF_PROP_NONE, values[3 + 1].type);
+
+    BOOST_CHECK(OF_IS_SUCCESS(ofmutator_remove_batch(mutator, 3, uris, 2)));
+    BOOST_CHECK(OF_IS_SUCCESS(ofmutator_commit(mutator)));
+    BOOST_CHECK(OF_IS_SUCCESS(offramework_read_batch(framework, 3, uris, 3,
+                                                     prop_ids, 3, values,
+                                                     buf, sizeof(buf),
+                                                     &found)));
+    BOOST_CHECK_EQUAL(0U, found);
+
+    // arguments are checked before anything is modified
+    props[1][1].value.str = NULL;
+    BOOST_CHECK_EQUAL(OF_EINVALID_ARG,
+                      ofmutator_modify_batch(mutator, updates, 2));
+
+    BOOST_CHECK(OF_IS_SUCCESS(ofmutator_destroy(&mutator)));
+    BOOST_CHECK(OF_IS_SUCCESS(offramework_stop(framework)));
+    BOOST_CHECK(OF_IS_SUCCESS(offramework_destroy(&framework)));
+}
+
+BOOST_FIXTURE_TEST_CASE( batch_types, MDFixture ) {
+    offramework_p framework = NULL;
+    BOOST_CHECK(OF_IS_SUCCESS(offramework_create(&framework)));
+    BOOST_CHECK(OF_IS_SUCCESS(offramework_set_model(framework, &md)));
+    BOOST_CHECK(OF_IS_SUCCESS(offramework_start(framework)));
+
+    // a MAC address goes in as a string and reads back the same
+    const char* uris[] = { "/class2/1" };
+    ofprop_value_t props[2];
+    props[0].prop_id = 4;
+    props[0].type = OF_PROP_INT64;
+    props[0].value.s64 = -5;
+    props[1].prop_id = 15;
+    props[1].type = OF_PROP_STRING;
+    props[1].value.str = "01:23:45:67:89:ab";
+    ofmo_update_t update;
+    update.class_id = 2;
+    update.uri = uris[0];
+    update.props = props;
+    update.prop_count = 2;
+
+    ofmutator_p mutator = NULL;
+    BOOST_CHECK(OF_IS_SUCCESS(ofmutator_create(framework, "owner1", &mutator)));
+    BOOST_CHECK(OF_IS_SUCCESS(ofmutator_modify_batch(mutator, &update, 1)));
+    BOOST_CHECK(OF_IS_SUCCESS(ofmutator_commit(mutator)));
+
+    prop_id_t prop_ids[] = { 4, 15 };
+    ofprop_value_t values[2];
+    char buf[64];
+    size_t found = 0;
+    BOOST_CHECK(OF_IS_SUCCESS(offramework_read_batch(framework, 2, uris, 1,
+                                                     prop_ids, 2, values,
+                                                     buf, sizeof(buf),
+                                                     &found)));
+    BOOST_CHECK_EQUAL(1U, found);
+    BOOST_CHECK_EQUAL(OF_PROP_INT64, values[0].type);
+    BOOST_CHECK_EQUAL(-5, values[0].value.s64);
+    BOOST_CHECK_EQUAL(OF_PROP_STRING, values[1].type);
+    BOOST_CHECK_EQUAL(string("01:23:45:67:89:ab"), values[1].value.str);
+
+    // a value that does not fit its property is refused
+    props[1].value.str = "not a mac";
+    BOOST_CHECK_EQUAL(OF_EINVALID_ARG,
+                      ofmutator_modify_batch(mutator, &update, 1));
+    props[1].type = OF_PROP_UINT64;
+    props[1].value.u64 = 1;
+    BOOST_CHECK_EQUAL(OF_EINVALID_ARG,
+                      ofmutator_modify_batch(mutator, &update, 1));
+    props[1].prop_id = 99;
+    BOOST_CHECK_EQUAL(OF_EINVALID_ARG,
+                      ofmutator_modify_batch(mutator, &update, 1));
+    update.class_id = 99;
+    BOOST_CHECK_EQUAL(OF_EOUTOFRANGE,
+                      ofmutator_modify_batch(mutator, &update, 1));
+    BOOST_CHECK(OF_IS_SUCCESS(ofmutator_destroy(&mutator)));
+
+    // an enum takes only its constants
+    const char* enumUris[] = { "/class7/1" };
+    ofprop_value_t enumProp;
+    enumProp.prop_id = 14;
+    enumProp.type = OF_PROP_UINT64;
+    enumProp.value.u64 = 1;
+    update.class_id = 7;
+    update.uri = enumUris[0];
+    update.props = &enumProp;
+    update.prop_count = 1;
+    BOOST_CHECK(OF_IS_SUCCESS(ofmutator_create(framework, "owner2", &mutator)));
+    BOOST_CHECK(OF_IS_SUCCESS(ofmutator_modify_batch(mutator, &update, 1)));
+    BOOST_CHECK(OF_IS_SUCCESS(ofmutator_commit(mutator)));
+    BOOST_CHECK(OF_IS_SUCCESS(offramework_read_batch(framework, 7, enumUris, 1,
+                                                     &enumProp.prop_id, 1,
+                                                     values, buf, sizeof(buf),
+                                                     &found)));
+    BOOST_CHECK_EQUAL(OF_PROP_UINT64, values[0].type);
+    BOOST_CHECK_EQUAL(1U, values[0].value.u64);
+
+    enumProp.value.u64 = 7;
+    BOOST_CHECK_EQUAL(OF_EINVALID_ARG,
+                      ofmutator_modify_batch(mutator, &update, 1));
+    enumProp.type = OF_PROP_STRING;
+    enumProp.value.str = "on";
+    BOOST_CHECK_EQUAL(OF_EINVALID_ARG,
+                      ofmutator_modify_batch(mutator, &update, 1));
+
+    BOOST_CHECK(OF_IS_SUCCESS(ofmutator_destroy(&mutator)));
+    BOOST_CHECK(OF_IS_SUCCESS(offramework_stop(framework)));
+    BOOST_CHECK(OF_IS_SUCCESS(offramework_destroy(&framework)));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
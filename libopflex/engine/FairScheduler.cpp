@@ -0,0 +1,136 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for TokenBucket, FairScheduler and WeightedRoundRobin
+ *
+ * Copyright (c) 2014 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <algorithm>
+
+#include "opflex/engine/internal/FairScheduler.h"
+
+namespace opflex {
+namespace engine {
+namespace internal {
+
+TokenBucket::TokenBucket(double rate_, double burst_)
+    : rate(rate_), burst(burst_), tokens(burst_), last(0), started(false) {}
+
+bool TokenBucket::take(double cost, uint64_t now) {
+    if (rate <= 0) return true;
+
+    if (started && now > last)
+        tokens = std::min(burst, tokens + rate * (now - last) / 1000);
+    if (!started || now > last)
+        last = now;
+    started = true;
+
+    if (tokens <= 0) return false;
+    tokens -= cost;
+    return true;
+}
+
+FairScheduler::FairScheduler(size_t quantum_)
+    : quantum(std::max<int64_t>(1, quantum_)), count(0) {}
+
+void FairScheduler::push(const void* source, const job_t& job) {
+    std::lock_guard<std::mutex> guard(mutex);
+    auto it = sources.find(source);
+    if (it == sources.end())
+        it = sources.emplace(source, Source(quantum)).first;
+    Source& s = it->second;
+    if (s.jobs.empty())
+        active.push_back(source);
+    s.jobs.push_back(job);
+    count += 1;
+}
+
+bool FairScheduler::runNext() {
+    const void* source;
+    job_t job;
+    int64_t estimate;
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (active.empty()) return false;
+
+        // give credit to the sources in turn until one has some
+        // left.  The source at the head keeps its turn while it has
+        // credit.
+        while (true) {
+            source = active.front();
+            Source& s = sources.find(source)->second;
+            if (s.deficit > 0) break;
+            s.deficit += quantum;
+            active.pop_front();
+            active.push_back(source);
+        }
+
+        // charge the estimated cost up front, so that the other
+        // threads do not pick more jobs of the source than its credit
+        // covers while this one runs
+        Source& s = sources.find(source)->second;
+        job = std::move(s.jobs.front());
+        s.jobs.pop_front();
+        if (s.jobs.empty())
+            active.pop_front();
+        estimate = s.estimate;
+        s.deficit -= estimate;
+        s.running += 1;
+        count -= 1;
+    }
+
+    size_t cost = job();
+
+    std::lock_guard<std::mutex> guard(mutex);
+    auto it = sources.find(source);
+    Source& s = it->second;
+    s.running -= 1;
+    if (s.jobs.empty() && s.running == 0) {
+        // an idle source starts its next backlog afresh
+        sources.erase(it);
+    } else {
+        s.deficit += estimate - (int64_t)cost;
+        s.estimate = cost;
+    }
+    return true;
+}
+
+size_t FairScheduler::size() const {
+    std::lock_guard<std::mutex> guard(mutex);
+    return count;
+}
+
+WeightedRoundRobin::WeightedRoundRobin(const std::vector<size_t>& weights_)
+    : weights(weights_), credits(weights_) {}
+
+int WeightedRoundRobin::next(const std::function<bool(size_t)>& pending) {
+    for (size_t round = 0; round < 2; ++round) {
+        for (size_t c = 0; c < credits.size(); ++c) {
+            if (credits[c] > 0 && pending(c)) {
+                credits[c] -= 1;
+                return c;
+            }
+        }
+        // every class with work has used its share, so start a new
+        // round
+        reset();
+    }
+    return -1;
+}
+
+void WeightedRoundRobin::reset() {
+    credits = weights;
+}
+
+} /* namespace internal */
+} /* namespace engine */
+} /* namespace opflex */
@@ -15,12 +15,15 @@
 #endif
 
 #include <cstdio>
+#include <unistd.h>
 
 #include "opflex/modb/internal/ObjectStore.h"
+#include "opflex/modb/internal/StoreImage.h"
 #include "opflex/test/GbpOpflexServer.h"
 #include "opflex/engine/internal/OpflexMessage.h"
 #include "opflex/engine/internal/GbpOpflexServerImpl.h"
 #include "opflex/engine/internal/OpflexServerHandler.h"
+#include "opflex/util/ThreadSettings.h"
 
 namespace opflex {
 namespace test {
@@ -49,6 +52,22 @@ void GbpOpflexServer::enableSSL(const std::string& caStorePath,
     pimpl->enableSSL(caStorePath, serverKeyPath,
                      serverKeyPass, verifyPeers);
 }
+void GbpOpflexServer::setWorkers(size_t workers) {
+    pimpl->setWorkers(workers);
+}
+void GbpOpflexServer::setLoops(size_t loops) {
+    pimpl->setLoops(loops);
+}
+void GbpOpflexServer::setPolicyThreads(size_t threads) {
+    pimpl->setPolicyThreads(threads);
+}
+void GbpOpflexServer::setResolveCacheSize(size_t size) {
+    pimpl->setResolveCacheSize(size);
+}
+void GbpOpflexServer::setRequestLimits(double resolves, double declares,
+                                       double reports) {
+    pimpl->setRequestLimits(resolves, declares, reports);
+}
 void GbpOpflexServer::start() {
     pimpl->start();
 }
@@ -65,6 +84,10 @@ void GbpOpflexServer::updatePolicy(rapidjson::Document& d,
     pimpl->updatePolicy(d, op);
 }
 
+void GbpOpflexServer::updatePolicy(const std::vector<policy_update_t>& updates) {
+    pimpl->updatePolicy(updates);
+}
+
 const GbpOpflexServer::peer_vec_t& GbpOpflexServer::getPeers() const {
     return pimpl->getPeers();
 }
@@ -88,6 +111,15 @@ using test::GbpOpflexServer;
 using boost::asio::deadline_timer;
 using boost::posix_time::seconds;
 
+static const size_t DEFAULT_CACHE_SIZE = 4096;
+
+// the number of store changes kept for invalidating the resolve cache
+static const size_t CACHE_JOURNAL_SIZE = 64*1024;
+
+// the bytes of responses serialized for a connection in its turn,
+// before the workers move on to the next connection
+static const size_t RESPONSE_QUANTUM = 64*1024;
+
 GbpOpflexServerImpl::GbpOpflexServerImpl(uint16_t port_, uint8_t roles_,
                                          const GbpOpflexServer::peer_vec_t& peers_,
                                          const std::vector<std::string>& proxies_,
@@ -98,7 +130,11 @@ GbpOpflexServerImpl::GbpOpflexServerImpl(uint16_t port_, uint8_t roles_,
       listener(*this, port_, "name", "domain"),
       db(db_),
       serializer(&db, this),
-      stopping(false), prr_interval_secs(prr_interval_secs_) {
+      stopping(false), prr_interval_secs(prr_interval_secs_),
+      workers(0), policy_threads(0),
+      response_scheduler(RESPONSE_QUANTUM), request_limits(),
+      cache_size(DEFAULT_CACHE_SIZE),
+      cache_version(0), cache_seq(0) {
     client = &db.getStoreClient("_SYSTEM_");
 }
 
@@ -115,6 +151,10 @@ void GbpOpflexServerImpl::enableSSL(const std::string& caStorePath,
 }
 
 void GbpOpflexServerImpl::start() {
+    // the resolve cache relies on the journal to evict only the
+    // subtrees that changed
+    if (cache_size > 0 && db.getJournalSize() == 0)
+        db.setJournalSize(CACHE_JOURNAL_SIZE);
 
     {
         const std::lock_guard<std::mutex> guard(prr_timer_mutex);
@@ -125,7 +165,17 @@ void GbpOpflexServerImpl::start() {
             });
     }
 
-    io_service_thread.reset(new std::thread([this]() { io.run(); }));
+    io_service_thread.reset(new std::thread(
+        util::startThread("server_io", [this]() { io.run(); })));
+
+    if (workers > 0) {
+        worker_io.reset();
+        worker_work.reset(new boost::asio::io_service::work(worker_io));
+        for (size_t i = 0; i < workers; ++i)
+            worker_threads.emplace_back(
+                util::startThread("server_worker",
+                                  [this]() { worker_io.run(); }));
+    }
     listener.listen();
 }
 
@@ -143,6 +193,14 @@ void GbpOpflexServerImpl::stop() {
         io_service_thread->join();
         io_service_thread.reset();
     }
+
+    // finish the responses already handed to the workers while the
+    // connections are still open
+    worker_work.reset();
+    for (std::thread& t : worker_threads)
+        t.join();
+    worker_threads.clear();
+
     listener.disconnect();
     client = NULL;
 }
@@ -172,30 +230,252 @@ void GbpOpflexServerImpl::on_timer_prr (const boost::system::error_code& ec) {
 }
 
 void GbpOpflexServerImpl::readPolicy(const std::string& file) {
-    FILE* pfile = fopen(file.c_str(), "r");
-    if (pfile == NULL) {
+    if (access(file.c_str(), R_OK) != 0) {
         LOG(ERROR) << "Could not open policy file "
                    << file << " for reading";
         return;
     }
 
-    size_t objs = serializer.readMOs(pfile, *getSystemClient());
+    size_t objs;
+    {
+        boost::unique_lock<boost::shared_mutex> guard(policy_mutex);
+        if (modb::StoreImage::isImage(file))
+            objs = modb::StoreImage(&db).load(file, *getSystemClient());
+        else
+            objs = serializer.readMOs(file, *getSystemClient(),
+                                      policy_threads);
+    }
     LOG(INFO) << "Read " << objs
               << " managed objects from policy file \"" << file << "\"";
 }
 
 void GbpOpflexServerImpl::updatePolicy(rapidjson::Document& d,
                                        gbp::PolicyUpdateOp op) {
-    size_t objs = serializer.updateMOs(d, *getSystemClient(), op);
+    size_t objs;
+    {
+        boost::unique_lock<boost::shared_mutex> guard(policy_mutex);
+        objs = serializer.updateMOs(d, *getSystemClient(), op);
+    }
     LOG(INFO) << "Update " << objs
               << " managed objects from GRPC update";
     listener.sendUpdates();
 }
 
+void GbpOpflexServerImpl::updatePolicy(const std::vector<GbpOpflexServer
+                                       ::policy_update_t>& updates) {
+    size_t objs = 0;
+    {
+        boost::unique_lock<boost::shared_mutex> guard(policy_mutex);
+        for (const GbpOpflexServer::policy_update_t& update : updates)
+            objs += serializer.updateMOs(*update.second, *getSystemClient(),
+                                         update.first);
+    }
+    LOG(INFO) << "Update " << objs
+              << " managed objects from " << updates.size()
+              << " GRPC updates";
+    listener.sendUpdates();
+}
+
+// bring the cache up to date with the store.  Must hold cache_mutex
+void GbpOpflexServerImpl::syncCache() {
+    uint64_t version = db.getVersion();
+    if (version == cache_version) return;
+
+    std::vector<modb::ObjectStore::Change> changes;
+    if (db.getJournalSize() == 0 || !db.getChangesSince(cache_seq, changes)) {
+        // no journal to say what changed
+        resolve_cache.clear();
+        cache_lru.clear();
+        cache_seq = db.getJournalSeq();
+    } else {
+        for (const modb::ObjectStore::Change& c : changes)
+            evictCached(c.uri);
+        cache_seq += changes.size();
+    }
+    cache_version = version;
+}
+
+// A cached subtree includes every object below its root, and their
+// URIs extend the URI of the root, so a change invalidates the entry
+// for the object and for each of its ancestors
+void GbpOpflexServerImpl::evictCached(const modb::URI& uri) {
+    if (resolve_cache.empty()) return;
+    const std::string& str = uri.toString();
+    for (size_t i = 0; i < str.size(); ++i) {
+        if (str[i] == '/')
+            eraseCached(modb::URI(str.substr(0, i + 1)));
+    }
+    eraseCached(uri);
+}
+
+void GbpOpflexServerImpl::eraseCached(const modb::URI& uri) {
+    auto it = resolve_cache.find(uri);
+    if (it == resolve_cache.end()) return;
+    cache_lru.erase(it->second.lru);
+    resolve_cache.erase(it);
+}
+
+std::shared_ptr<const yajr::rpc::PreparedValue>
+GbpOpflexServerImpl::getSerialized(modb::class_id_t class_id,
+                                   const modb::URI& uri) {
+    uint64_t version = 0, seq = 0;
+    if (cache_size > 0) {
+        const std::lock_guard<std::mutex> guard(cache_mutex);
+        syncCache();
+        auto it = resolve_cache.find(uri);
+        if (it != resolve_cache.end() && it->second.class_id == class_id) {
+            cache_lru.splice(cache_lru.begin(), cache_lru, it->second.lru);
+            return it->second.json;
+        }
+        version = cache_version;
+        seq = cache_seq;
+    }
+
+    yajr::internal::StringQueue queue;
+    yajr::rpc::SendHandler writer(queue);
+    serializer.serialize(class_id, uri, *client, writer, true);
+    std::shared_ptr<const yajr::rpc::PreparedValue>
+        json(std::make_shared<const yajr::rpc::PreparedValue>(
+                 std::string(queue.deque_.begin(), queue.deque_.end()),
+                 rapidjson::kObjectType));
+
+    if (cache_size > 0) {
+        const std::lock_guard<std::mutex> guard(cache_mutex);
+        // a change may have been processed while serializing, in
+        // which case the result could already be stale
+        if (version == cache_version && seq == cache_seq) {
+            eraseCached(uri);
+            // make room by evicting the least recently used subtrees
+            while (!cache_lru.empty() && resolve_cache.size() >= cache_size)
+                eraseCached(cache_lru.back());
+            cache_lru.push_front(uri);
+            cache_entry_t& entry = resolve_cache[uri];
+            entry.class_id = class_id;
+            entry.json = json;
+            entry.lru = cache_lru.begin();
+        }
+    }
+    return json;
+}
+
 OpflexHandler* GbpOpflexServerImpl::newHandler(OpflexConnection* conn) {
     return new OpflexServerHandler(conn, this);
 }
 
+/**
+ * Holds a copy of a request ID so that it outlives the request
+ * document.  A base class so that it is constructed before the
+ * message that points to it.
+ */
+struct MessageId {
+    MessageId() {}
+    MessageId(const Value& id_) {
+        id.CopyFrom(id_, id.GetAllocator());
+    }
+    rapidjson::Document id;
+};
+
+/**
+ * A message whose payload was serialized ahead of time.  Clones
+ * share the payload, so the same message can be queued to many
+ * connections, each of which still writes its own JSON-RPC envelope
+ * and ID around it.  Connections that use the binary encoding share
+ * a single CBOR encoding of the payload as well.
+ */
+class PreparedMessage : private MessageId, public OpflexMessage {
+public:
+    /**
+     * Construct a request with a serialized array of parameters
+     */
+    PreparedMessage(const std::string& method,
+                    const std::shared_ptr<const yajr::rpc::PreparedValue>& payload_)
+        : OpflexMessage(method, REQUEST), payload(payload_) {}
+
+    /**
+     * Construct a response with a serialized result object
+     */
+    PreparedMessage(const std::string& method, const Value& id_,
+                    const std::shared_ptr<const yajr::rpc::PreparedValue>& payload_)
+        : MessageId(id_), OpflexMessage(method, RESPONSE, &id),
+          payload(payload_) {}
+
+    virtual void serializePayload(yajr::rpc::SendHandler& writer) const {
+        writer.Prepared(*payload);
+    }
+
+    virtual PreparedMessage* clone() {
+        if (getType() == REQUEST)
+            return new PreparedMessage(getMethod(), payload);
+        return new PreparedMessage(getMethod(), id, payload);
+    }
+
+    /**
+     * Serialize the payload of a message
+     */
+    static std::shared_ptr<const yajr::rpc::PreparedValue>
+    prepare(const OpflexMessage& message) {
+        yajr::internal::StringQueue queue;
+        yajr::rpc::SendHandler writer(queue);
+        message.serializePayload(writer);
+        return std::make_shared<const yajr::rpc::PreparedValue>(
+            std::string(queue.deque_.begin(), queue.deque_.end()),
+            message.getType() == REQUEST
+            ? rapidjson::kArrayType : rapidjson::kObjectType);
+    }
+
+private:
+    std::shared_ptr<const yajr::rpc::PreparedValue> payload;
+};
+
+void GbpOpflexServerImpl::sendResponse(OpflexServerConnection* conn,
+                                       const Value& id,
+                                       OpflexMessage* res) {
+    if (workers == 0) {
+        conn->sendMessage(res, true);
+        return;
+    }
+
+    // The workers take the responses of the connections in turn, so
+    // that an agent with a large backlog of resolves does not delay
+    // the responses to the others
+    std::shared_ptr<OpflexMessage> resp(res);
+    std::shared_ptr<MessageId> mid(new MessageId(id));
+    uint64_t connId = conn->getId();
+    bool binary = conn->getPeer() && conn->getPeer()->isBinaryEncoding();
+    response_scheduler.push(conn, [this, connId, binary, resp, mid]() -> size_t {
+            // Policy writes are not held up by the serialization.
+            // Instead, a response is serialized again if a policy
+            // update from a later version of the store was sent while
+            // it was being serialized, so that it never overwrites the
+            // newer state on the agent.
+            size_t bytes = 0;
+            for (;;) {
+                std::shared_ptr<const yajr::rpc::PreparedValue> payload;
+                uint64_t version;
+                {
+                    modb::ObjectStore::SnapshotGuard snapshot(db);
+                    version = snapshot.getVersion();
+                    payload = PreparedMessage::prepare(*resp);
+                }
+                // encode it here rather than on the connection's loop
+                bytes += binary
+                    ? payload->getBinary().size()
+                    : payload->getJson().size();
+                OpflexListener::SendResult result =
+                    listener.sendIfCurrent(connId, version,
+                                           new PreparedMessage(resp->getMethod(),
+                                                               mid->id,
+                                                               payload));
+                if (result != OpflexListener::STALE)
+                    break;
+                LOG(DEBUG) << "Reserializing " << resp->getMethod()
+                           << " response overtaken by a policy update";
+            }
+            return bytes;
+        });
+    worker_io.post([this]() { response_scheduler.runNext(); });
+}
+
 class PolicyUpdateReq : public OpflexMessage {
 public:
     PolicyUpdateReq(GbpOpflexServerImpl& server_,
@@ -226,9 +506,8 @@ public:
         writer.String("replace");
         writer.StartArray();
         for (const modb::reference_t& p : replace) {
-            serializer.serialize(p.first, p.second,
-                                 *client, writer,
-                                 true);
+            // the same subtree is replaced on every subscribed peer
+            writer.Prepared(*server.getSerialized(p.first, p.second));
         }
         writer.EndArray();
 
@@ -270,9 +549,10 @@ protected:
 void GbpOpflexServerImpl::policyUpdate(const std::vector<modb::reference_t>& replace,
                                        const std::vector<modb::reference_t>& merge_children,
                                        const std::vector<modb::reference_t>& del) {
-    PolicyUpdateReq* req =
-        new PolicyUpdateReq(*this, replace, merge_children, del);
-    listener.sendToAll(req);
+    // serialize once and share the payload between the connections
+    PolicyUpdateReq req(*this, replace, merge_children, del);
+    listener.sendToAll(new PreparedMessage(req.getMethod(),
+                                           PreparedMessage::prepare(req)));
 }
 
 void GbpOpflexServerImpl::policyUpdate(OpflexServerConnection* conn,
@@ -345,8 +625,9 @@ protected:
 
 void GbpOpflexServerImpl::endpointUpdate(const std::vector<modb::reference_t>& replace,
                                          const std::vector<modb::reference_t>& del) {
-    EndpointUpdateReq* req = new EndpointUpdateReq(*this, replace, del);
-    listener.sendToAll(req);
+    EndpointUpdateReq req(*this, replace, del);
+    listener.sendToAll(new PreparedMessage(req.getMethod(),
+                                           PreparedMessage::prepare(req)));
 }
 
 void GbpOpflexServerImpl::remoteObjectUpdated(modb::class_id_t class_id,
@@ -24,11 +24,15 @@ namespace internal {
 
 using yajr::Peer;
 
+// the time to wait for a response before giving up, in milliseconds
+static const uint64_t OP_TIMEOUT = 5000;
+
 InspectorClientConn::InspectorClientConn(HandlerFactory& handlerFactory,
                                          const std::string& name_)
     : OpflexConnection(handlerFactory), name(name_), peer(NULL) {
     client_loop = {};
     timer = {};
+    poll_timer = {};
 }
 
 InspectorClientConn::~InspectorClientConn() {
@@ -41,7 +45,9 @@ void InspectorClientConn::connect() {
 
     timer.data = this;
     uv_timer_init(&client_loop, &timer);
-    uv_timer_start(&timer, on_timer, 5000, 5000);
+    uv_timer_start(&timer, on_timer, OP_TIMEOUT, OP_TIMEOUT);
+    poll_timer.data = this;
+    uv_timer_init(&client_loop, &poll_timer);
 
     peer = yajr::Peer::create(name,
                               on_state_change,
@@ -61,6 +67,8 @@ void InspectorClientConn::messagesReady() {
 
 void InspectorClientConn::close() {
     OpflexConnection::disconnect();
+    uv_timer_stop(&poll_timer);
+    pollFn = nullptr;
     if (peer) peer->destroy();
     peer = NULL;
 }
@@ -93,6 +101,8 @@ void InspectorClientConn::on_state_change(Peer * p, void * data,
 
         uv_timer_stop(&conn->timer);
         uv_close((uv_handle_t*)&conn->timer, NULL);
+        uv_timer_stop(&conn->poll_timer);
+        uv_close((uv_handle_t*)&conn->poll_timer, NULL);
         yajr::finiLoop(&conn->client_loop);
         break;
     }
@@ -104,6 +114,20 @@ void InspectorClientConn::on_timer(uv_timer_t* timer) {
     conn->close();
 }
 
+void InspectorClientConn::schedule(uint64_t delay,
+                                   const std::function<void()>& fn) {
+    pollFn = fn;
+    uv_timer_start(&poll_timer, on_poll_timer, delay, 0);
+    uv_timer_start(&timer, on_timer, delay + OP_TIMEOUT, OP_TIMEOUT);
+}
+
+void InspectorClientConn::on_poll_timer(uv_timer_t* timer) {
+    InspectorClientConn* conn = (InspectorClientConn*)timer->data;
+    std::function<void()> fn;
+    fn.swap(conn->pollFn);
+    if (fn) fn();
+}
+
 const std::string& BAD_NAME("BAD_NAME");
 const std::string& BAD_DOMAIN("BAD_DOMAIN");
 const std::string& InspectorClientConn::getName() { return BAD_NAME; }
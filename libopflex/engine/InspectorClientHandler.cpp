@@ -54,7 +54,8 @@ void InspectorClientHandler::checkDone() {
         client->conn.close();
 }
 
-void InspectorClientHandler::handlePolicyQueryRes(const Value& payload) {
+void InspectorClientHandler::handlePolicyQueryRes(uint64_t reqId,
+                                                  const Value& payload) {
     StoreClient* storeClient = client->storeClient;
     StoreClient::notif_t notifs;
     if (payload.HasMember("policy")) {
@@ -72,6 +73,47 @@ void InspectorClientHandler::handlePolicyQueryRes(const Value& payload) {
         }
     }
 
+    // the request stays pending while there are more pages to fetch
+    if (client->continueQuery(reqId, payload))
+        return;
+    client->pendingRequests -= 1;
+    checkDone();
+}
+
+void InspectorClientHandler::handleStoreStatsRes(const Value& payload) {
+    if (payload.HasMember("stats") && payload["stats"].IsArray()) {
+        const Value& stats = payload["stats"];
+        Value::ConstValueIterator it;
+        for (it = stats.Begin(); it != stats.End(); ++it) {
+            const Value& s = *it;
+            if (!s.IsObject() || !s.HasMember("class") ||
+                !s["class"].IsString())
+                continue;
+            modb::ClassStats& cs = client->storeStats[s["class"].GetString()];
+            if (s.HasMember("instances") && s["instances"].IsUint64())
+                cs.instances = s["instances"].GetUint64();
+            if (s.HasMember("prop_bytes") && s["prop_bytes"].IsUint64())
+                cs.propBytes = s["prop_bytes"].GetUint64();
+            if (s.HasMember("index_bytes") && s["index_bytes"].IsUint64())
+                cs.indexBytes = s["index_bytes"].GetUint64();
+            if (s.HasMember("uri_bytes") && s["uri_bytes"].IsUint64())
+                cs.uriBytes = s["uri_bytes"].GetUint64();
+        }
+    } else {
+        LOG(ERROR) << "[" << getConnection()->getRemotePeer() << "] "
+                   << "Malformed store stats response: stats must be array";
+    }
+
+    client->pendingRequests -= 1;
+    checkDone();
+}
+
+void InspectorClientHandler::handleWatchRes(const Value& payload) {
+    // the watch stays pending while it keeps polling
+    if (client->continueWatch(payload))
+        return;
+    LOG(ERROR) << "[" << getConnection()->getRemotePeer() << "] "
+               << "Malformed watch response: no sequence number";
     client->pendingRequests -= 1;
     checkDone();
 }
@@ -87,13 +129,18 @@ void InspectorClientHandler::handleCustomRes(uint64_t reqId,
     if (!method.IsString() || !result.IsObject()) return;
 
     if (InspectorServerHandler::POLICY_QUERY == method.GetString())
-        handlePolicyQueryRes(result);
+        handlePolicyQueryRes(reqId, result);
+    else if (InspectorServerHandler::STORE_STATS == method.GetString())
+        handleStoreStatsRes(result);
+    else if (InspectorServerHandler::WATCH == method.GetString())
+        handleWatchRes(result);
 }
 
 void InspectorClientHandler::handleError(uint64_t reqId,
                                          const Value& payload,
                                          const string& type) {
     OpflexHandler::handleError(reqId, payload, type);
+    client->pagedQueries.erase(reqId);
     client->pendingRequests -= 1;
     checkDone();
 }
@@ -14,9 +14,13 @@
 #  include <config.h>
 #endif
 
+#include <algorithm>
+#include <iomanip>
+
 #include <boost/optional.hpp>
 
 #include "opflex/modb/internal/ObjectStore.h"
+#include "opflex/modb/internal/StoreImage.h"
 #include "opflex/engine/internal/InspectorClientHandler.h"
 #include "opflex/engine/internal/OpflexConnection.h"
 #include "opflex/engine/internal/OpflexMessage.h"
@@ -42,6 +46,7 @@ using opflex::modb::ObjectStore;
 using opflex::modb::PropertyInfo;
 using opflex::modb::ClassInfo;
 using opflex::modb::URI;
+using opflex::modb::class_id_t;
 using modb::mointernal::ObjectInstance;
 using modb::mointernal::StoreClient;
 using internal::OpflexHandler;
@@ -53,7 +58,9 @@ InspectorClientImpl::InspectorClientImpl(const std::string& name_,
                                          const modb::ModelMetadata& model)
     : conn(*this, name_), db(threadManager),
       serializer(&db, this), pendingRequests(0),
-      followRefs(false), recursive(false), unresolved(false) {
+      followRefs(false), recursive(false), unresolved(false),
+      depth(0), pageSize(0), pagesReceived(0), pagedObjectsReceived(0),
+      nextXid(1) {
     db.init(model);
     storeClient = &db.getStoreClient("_SYSTEM_");
 }
@@ -94,15 +101,29 @@ class Query : public Cmd {
 public:
     Query(const string& subject_,
           optional<URI> uri_,
-          bool recursive_ = true)
-        : subject(subject_), uri(uri_), recursive(recursive_) { }
+          bool recursive_ = true,
+          size_t depth_ = 0)
+        : subject(subject_), uri(uri_), recursive(recursive_),
+          depth(depth_), pageSize(0), cursorQuery(0) { }
     virtual ~Query() {}
 
     virtual int execute(InspectorClientImpl& client);
 
+    /**
+     * Send the query, registering it to request its next page if it
+     * is paged
+     */
+    void send(InspectorClientImpl& client);
+
     string subject;
     optional<URI> uri;
     bool recursive;
+    size_t depth;
+    std::vector<string> classes;
+    std::vector<std::pair<string, string> > filters;
+    size_t pageSize;
+    size_t cursorQuery;
+    string cursorUri;
 };
 
 class InspectorMessage : public OpflexMessage {
@@ -118,9 +139,9 @@ public:
 class PolicyQueryReq : public InspectorMessage {
 public:
     PolicyQueryReq(InspectorClientImpl& client,
-                   const Query& query_)
+                   const Query& query_, uint64_t xid_)
         : InspectorMessage("custom", REQUEST, client),
-          query(query_) {}
+          query(query_), xid(xid_) {}
 
     virtual void serializePayload(yajr::rpc::SendHandler& writer) const {
         (*this)(writer);
@@ -144,8 +165,45 @@ public:
             writer.String("policy_uri");
             writer.String(query.uri.get().toString().c_str());
         }
+        if (!query.filters.empty()) {
+            writer.String("where");
+            writer.StartArray();
+            for (const std::pair<string, string>& f : query.filters) {
+                writer.StartObject();
+                writer.String("name");
+                writer.String(f.first.c_str());
+                writer.String("data");
+                writer.String(f.second.c_str());
+                writer.EndObject();
+            }
+            writer.EndArray();
+        }
         writer.String("recursive");
         writer.Bool(query.recursive);
+        if (query.depth > 0) {
+            writer.String("depth");
+            writer.Uint64(query.depth);
+        }
+        if (!query.classes.empty()) {
+            writer.String("classes");
+            writer.StartArray();
+            for (const string& c : query.classes)
+                writer.String(c.c_str());
+            writer.EndArray();
+        }
+        if (query.pageSize > 0) {
+            writer.String("page_size");
+            writer.Uint64(query.pageSize);
+        }
+        if (!query.cursorUri.empty()) {
+            writer.String("cursor");
+            writer.StartObject();
+            writer.String("query");
+            writer.Uint64(query.cursorQuery);
+            writer.String("uri");
+            writer.String(query.cursorUri.c_str());
+            writer.EndObject();
+        }
         writer.EndObject();
         writer.EndArray();
         writer.EndObject();
@@ -153,22 +211,287 @@ public:
         return true;
     }
 
-    const Query& query;
+    virtual uint64_t getReqXid() const { return xid; }
+
+    Query query;
+    uint64_t xid;
 };
 
 int Query::execute(InspectorClientImpl& client) {
-    PolicyQueryReq* r = new PolicyQueryReq(client, *this);
+    send(client);
+    return 1;
+}
+
+void Query::send(InspectorClientImpl& client) {
+    uint64_t xid = client.nextXid++;
+    if (pageSize > 0)
+        client.pagedQueries[xid].reset(new Query(*this));
+    PolicyQueryReq* r = new PolicyQueryReq(client, *this, xid);
     client.getConn().sendMessage(r, true);
+}
+
+class StoreStatsQuery : public Cmd {
+public:
+    virtual ~StoreStatsQuery() {}
+
+    virtual int execute(InspectorClientImpl& client);
+};
+
+class StoreStatsReq : public InspectorMessage {
+public:
+    StoreStatsReq(InspectorClientImpl& client)
+        : InspectorMessage("custom", REQUEST, client) {}
+
+    virtual void serializePayload(yajr::rpc::SendHandler& writer) const {
+        (*this)(writer);
+    }
+
+    virtual StoreStatsReq* clone() {
+        return new StoreStatsReq(*this);
+    }
+
+    virtual bool operator()(yajr::rpc::SendHandler& writer) const {
+        writer.StartArray();
+        writer.StartObject();
+        writer.String("method");
+        writer.String("org.opendaylight.opflex.store_stats");
+        writer.String("params");
+        writer.StartArray();
+        writer.EndArray();
+        writer.EndObject();
+        writer.EndArray();
+        return true;
+    }
+};
+
+int StoreStatsQuery::execute(InspectorClientImpl& client) {
+    StoreStatsReq* r = new StoreStatsReq(client);
+    client.getConn().sendMessage(r, true);
+    return 1;
+}
+
+void InspectorClientImpl::addStoreStatsQuery() {
+    commands.push_back(new StoreStatsQuery());
+}
+
+class Watch : public Cmd {
+public:
+    Watch(const string& subject_, const string& uriPrefix_,
+          std::ostream& output_, bool includeProps_, size_t interval_)
+        : subject(subject_), uriPrefix(uriPrefix_), output(output_),
+          includeProps(includeProps_), interval(interval_),
+          started(false), since(0) {}
+    virtual ~Watch() {}
+
+    virtual int execute(InspectorClientImpl& client);
+
+    /**
+     * Poll for the changes since the last poll
+     */
+    void send(InspectorClientImpl& client);
+
+    string subject;
+    string uriPrefix;
+    std::ostream& output;
+    bool includeProps;
+    size_t interval;
+    bool started;
+    uint64_t since;
+};
+
+class WatchReq : public InspectorMessage {
+public:
+    WatchReq(InspectorClientImpl& client, const Watch& watch)
+        : InspectorMessage("custom", REQUEST, client),
+          subject(watch.subject), uriPrefix(watch.uriPrefix),
+          includeProps(watch.includeProps), started(watch.started),
+          since(watch.since) {}
+
+    virtual void serializePayload(yajr::rpc::SendHandler& writer) const {
+        (*this)(writer);
+    }
+
+    virtual WatchReq* clone() {
+        return new WatchReq(*this);
+    }
+
+    virtual bool operator()(yajr::rpc::SendHandler& writer) const {
+        writer.StartArray();
+        writer.StartObject();
+        writer.String("method");
+        writer.String("org.opendaylight.opflex.watch");
+        writer.String("params");
+        writer.StartArray();
+        writer.StartObject();
+        if (!subject.empty()) {
+            writer.String("subject");
+            writer.String(subject.c_str());
+        }
+        if (!uriPrefix.empty()) {
+            writer.String("policy_uri");
+            writer.String(uriPrefix.c_str());
+        }
+        // the first poll starts the watch from the current state
+        if (started) {
+            writer.String("since");
+            writer.Uint64(since);
+        }
+        writer.String("properties");
+        writer.Bool(includeProps);
+        writer.EndObject();
+        writer.EndArray();
+        writer.EndObject();
+        writer.EndArray();
+        return true;
+    }
+
+    string subject;
+    string uriPrefix;
+    bool includeProps;
+    bool started;
+    uint64_t since;
+};
+
+int Watch::execute(InspectorClientImpl& client) {
+    client.watch.reset(new Watch(*this));
+    client.watch->send(client);
     return 1;
 }
 
+void Watch::send(InspectorClientImpl& client) {
+    WatchReq* r = new WatchReq(client, *this);
+    client.getConn().sendMessage(r, true);
+}
+
+void InspectorClientImpl::addWatch(const string& subject,
+                                   const string& uriPrefix,
+                                   std::ostream& output,
+                                   bool includeProps,
+                                   size_t interval) {
+    commands.push_back(new Watch(subject, uriPrefix, output,
+                                 includeProps, interval));
+}
+
+bool InspectorClientImpl::continueWatch(const rapidjson::Value& result) {
+    if (!watch) return false;
+    if (!result.HasMember("seq") || !result["seq"].IsUint64())
+        return false;
+    uint64_t seq = result["seq"].GetUint64();
+    std::ostream& output = watch->output;
+
+    if (result.HasMember("resync") && result["resync"].IsBool() &&
+        result["resync"].GetBool()) {
+        output << "# Changes were lost from the journal; resuming from "
+               << seq << std::endl;
+    }
+    if (result.HasMember("changes") && result["changes"].IsArray()) {
+        const rapidjson::Value& changes = result["changes"];
+        rapidjson::Value::ConstValueIterator it;
+        for (it = changes.Begin(); it != changes.End(); ++it) {
+            const rapidjson::Value& c = *it;
+            if (!c.IsObject() ||
+                !c.HasMember("seq") || !c["seq"].IsUint64() ||
+                !c.HasMember("subject") || !c["subject"].IsString() ||
+                !c.HasMember("uri") || !c["uri"].IsString() ||
+                !c.HasMember("op") || !c["op"].IsString())
+                continue;
+            output << "#" << c["seq"].GetUint64() << " "
+                   << (string("removed") == c["op"].GetString()
+                       ? "REMOVED" : "UPDATED") << " ";
+
+            // display the object through a transient copy in the
+            // local view, so that it is printed like other objects
+            bool shown = false;
+            if (c.HasMember("object") && c["object"].IsObject()) {
+                serializer.deserialize(c["object"], *storeClient, false);
+                try {
+                    class_id_t class_id =
+                        db.getClassInfo(c["subject"].GetString()).getId();
+                    URI uri(c["uri"].GetString());
+                    serializer.displayMO(output, class_id, uri, true);
+                    storeClient->remove(class_id, uri, false);
+                    shown = true;
+                } catch (const std::out_of_range& e) {}
+            }
+            if (!shown) {
+                output << c["subject"].GetString() << ","
+                       << c["uri"].GetString() << std::endl;
+            }
+        }
+    }
+    output.flush();
+
+    watch->since = seq;
+    watch->started = true;
+    conn.schedule(watch->interval, [this]() { watch->send(*this); });
+    return true;
+}
+
+void InspectorClientImpl::printStoreStats(std::ostream& output) {
+    typedef std::pair<string, modb::ClassStats> stat_t;
+    std::vector<stat_t> sorted(storeStats.begin(), storeStats.end());
+    std::sort(sorted.begin(), sorted.end(),
+              [](const stat_t& a, const stat_t& b) {
+                  return a.second.getBytes() > b.second.getBytes();
+              });
+
+    uint64_t instances = 0, bytes = 0;
+    output << std::left << std::setw(50) << "CLASS" << std::right
+           << std::setw(10) << "INSTANCES" << std::setw(14) << "BYTES"
+           << std::setw(14) << "PROPS" << std::setw(14) << "INDEX"
+           << std::setw(14) << "URIS" << std::endl;
+    for (const stat_t& s : sorted) {
+        if (s.second.instances == 0) continue;
+        instances += s.second.instances;
+        bytes += s.second.getBytes();
+        output << std::left << std::setw(50) << s.first << std::right
+               << std::setw(10) << s.second.instances
+               << std::setw(14) << s.second.getBytes()
+               << std::setw(14) << s.second.propBytes
+               << std::setw(14) << s.second.indexBytes
+               << std::setw(14) << s.second.uriBytes << std::endl;
+    }
+    output << std::left << std::setw(50) << "TOTAL" << std::right
+           << std::setw(10) << instances << std::setw(14) << bytes
+           << std::endl;
+}
+
 void InspectorClientImpl::addQuery(const string& subject,
                                    const URI& uri) {
-    commands.push_back(new Query(subject, optional<URI>(uri), recursive));
+    Query* query = new Query(subject, optional<URI>(uri), recursive, depth);
+    query->classes = childClasses;
+    commands.push_back(query);
 }
 
 void InspectorClientImpl::addClassQuery(const string& subject) {
-    commands.push_back(new Query(subject, boost::none, recursive));
+    Query* query = new Query(subject, boost::none, recursive, depth);
+    query->classes = childClasses;
+    query->filters = filters;
+    query->pageSize = pageSize;
+    commands.push_back(query);
+}
+
+bool InspectorClientImpl::continueQuery(uint64_t reqId,
+                                        const rapidjson::Value& result) {
+    auto it = pagedQueries.find(reqId);
+    if (it == pagedQueries.end()) return false;
+    pagesReceived += 1;
+    if (result.HasMember("policy") && result["policy"].IsArray())
+        pagedObjectsReceived += result["policy"].Size();
+    unique_ptr<Query> query(std::move(it->second));
+    pagedQueries.erase(it);
+
+    if (!result.HasMember("cursor")) return false;
+    const rapidjson::Value& cursor = result["cursor"];
+    if (!cursor.IsObject() ||
+        !cursor.HasMember("query") || !cursor["query"].IsUint64() ||
+        !cursor.HasMember("uri") || !cursor["uri"].IsString())
+        return false;
+
+    query->cursorQuery = cursor["query"].GetUint64();
+    query->cursorUri = cursor["uri"].GetString();
+    query->send(*this);
+    return true;
 }
 
 void InspectorClientImpl::dumpToFile(FILE* file) {
@@ -183,6 +506,14 @@ size_t InspectorClientImpl::loadFromFile(FILE* file) {
     return serializer.readMOs(file, *storeClient);
 }
 
+bool InspectorClientImpl::dumpToImage(FILE* file) {
+    return modb::StoreImage(&db).write(file);
+}
+
+size_t InspectorClientImpl::loadFromImage(const std::string& file) {
+    return modb::StoreImage(&db).load(file, *storeClient);
+}
+
 void InspectorClientImpl::prettyPrint(std::ostream& output,
                                       bool tree,
                                       bool includeProps,
@@ -208,6 +539,23 @@ void InspectorClientImpl::setUnresolved(bool enabled) {
     followRefs = enabled;
 }
 
+void InspectorClientImpl::setDepth(size_t depth_) {
+    depth = depth_;
+}
+
+void InspectorClientImpl::addChildClass(const string& subject) {
+    childClasses.push_back(subject);
+}
+
+void InspectorClientImpl::addFilter(const string& property,
+                                    const string& value) {
+    filters.push_back(std::make_pair(property, value));
+}
+
+void InspectorClientImpl::setPageSize(size_t size) {
+    pageSize = size;
+}
+
 static std::string getRefSubj(const modb::ObjectStore& store,
                               const modb::reference_t& ref) {
     try {
@@ -14,7 +14,13 @@
 #  include <config.h>
 #endif
 
+#include <algorithm>
+#include <limits>
 #include <sstream>
+#include <string>
+#include <unordered_set>
+
+#include <boost/optional.hpp>
 
 #include "opflex/engine/internal/OpflexMessage.h"
 #include "opflex/engine/internal/InspectorServerHandler.h"
@@ -45,10 +51,14 @@ public:
     PolicyQueryRes(const rapidjson::Value& id,
                    Inspector* inspector_,
                    const std::vector<modb::reference_t>& mos_,
-                   bool recursive_)
+                   bool recursive_, size_t depth_,
+                   const std::unordered_set<modb::class_id_t>& classes_,
+                   size_t cursorQuery_, const std::string& cursorUri_)
         : OpflexMessage("custom", RESPONSE, &id),
           inspector(inspector_),
-          mos(mos_), recursive(recursive_) {}
+          mos(mos_), recursive(recursive_), depth(depth_),
+          classes(classes_),
+          cursorQuery(cursorQuery_), cursorUri(cursorUri_) {}
 
     virtual void serializePayload(yajr::rpc::SendHandler& writer) const {
         (*this)(writer);
@@ -60,6 +70,11 @@ public:
 
     virtual bool operator()(yajr::rpc::SendHandler& writer) const {
         MOSerializer& serializer = inspector->getSerializer();
+        // read the objects from a snapshot however long the response
+        // takes to serialize.  Children are still found from the live
+        // indexes.
+        const modb::ObjectStore::SnapshotGuard
+            snapshot(inspector->getStore());
         modb::mointernal::StoreClient& client =
             inspector->getStore().getReadOnlyStoreClient();
 
@@ -74,12 +89,22 @@ public:
             try {
                 serializer.serialize(p.first, p.second,
                                      client, writer,
-                                     recursive);
+                                     recursive, depth,
+                                     classes.empty() ? NULL : &classes);
             } catch (const std::out_of_range& e) {
                 // policy doesn't exist locally
             }
         }
         writer.EndArray();
+        if (!cursorUri.empty()) {
+            writer.String("cursor");
+            writer.StartObject();
+            writer.String("query");
+            writer.Uint64(cursorQuery);
+            writer.String("uri");
+            writer.String(cursorUri.c_str());
+            writer.EndObject();
+        }
         writer.EndObject();
         writer.EndObject();
         return true;
@@ -88,14 +113,100 @@ public:
     Inspector* inspector;
     std::vector<modb::reference_t> mos;
     bool recursive;
+    size_t depth;
+    std::unordered_set<modb::class_id_t> classes;
+    size_t cursorQuery;
+    std::string cursorUri;
 };
 
+// check whether any value of the property matches the filter value,
+// comparing in the form the value would have in a dump
+static bool matchesFilter(const modb::mointernal::ObjectInstance& oi,
+                          const modb::PropertyInfo& pinfo,
+                          const std::string& value) {
+    using modb::PropertyInfo;
+    const modb::prop_id_t id = pinfo.getId();
+    const bool vec = pinfo.getCardinality() == PropertyInfo::VECTOR;
+    if (!oi.isSet(id, pinfo.getType(), pinfo.getCardinality()))
+        return false;
+
+    size_t count = 1;
+    switch (pinfo.getType()) {
+    case PropertyInfo::STRING:
+        if (vec) count = oi.getStringSize(id);
+        for (size_t i = 0; i < count; ++i) {
+            if ((vec ? oi.getString(id, i) : oi.getString(id)) == value)
+                return true;
+        }
+        break;
+    case PropertyInfo::S64:
+        if (vec) count = oi.getInt64Size(id);
+        for (size_t i = 0; i < count; ++i) {
+            int64_t v = vec ? oi.getInt64(id, i) : oi.getInt64(id);
+            if (std::to_string(v) == value)
+                return true;
+        }
+        break;
+    case PropertyInfo::U64:
+    case PropertyInfo::ENUM8:
+    case PropertyInfo::ENUM16:
+    case PropertyInfo::ENUM32:
+    case PropertyInfo::ENUM64:
+        if (vec) count = oi.getUInt64Size(id);
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t v = vec ? oi.getUInt64(id, i) : oi.getUInt64(id);
+            if (std::to_string(v) == value)
+                return true;
+            if (pinfo.getType() == PropertyInfo::U64)
+                continue;
+            try {
+                if (pinfo.getEnumInfo().getNameById(v) == value)
+                    return true;
+            } catch (const std::out_of_range& e) { }
+        }
+        break;
+    case PropertyInfo::MAC:
+        if (vec) count = oi.getMACSize(id);
+        for (size_t i = 0; i < count; ++i) {
+            if ((vec ? oi.getMAC(id, i) : oi.getMAC(id)).toString() == value)
+                return true;
+        }
+        break;
+    case PropertyInfo::REFERENCE:
+        if (vec) count = oi.getReferenceSize(id);
+        for (size_t i = 0; i < count; ++i) {
+            modb::reference_t ref =
+                vec ? oi.getReference(id, i) : oi.getReference(id);
+            if (ref.second.toString() == value)
+                return true;
+        }
+        break;
+    default:
+        break;
+    }
+    return false;
+}
+
 void InspectorServerHandler::handlePolicyQueryReq(const Value& id,
                                                   const Value& payload) {
+    typedef std::vector<std::pair<const modb::PropertyInfo*,
+                                  std::string> > filters_t;
     Value::ConstValueIterator it;
-    std::vector<modb::reference_t> mos;
+    std::vector<modb::class_id_t> queryClasses;
+    std::vector<boost::optional<modb::URI> > queryUris;
+    std::vector<filters_t> queryFilters;
+    std::string queryKey;
     bool recursive = false;
-    
+    size_t depth = std::numeric_limits<size_t>::max();
+    std::unordered_set<modb::class_id_t> classes;
+    size_t pageSize = 0;
+    size_t cursorQuery = 0;
+    std::string cursorUri;
+    modb::mointernal::StoreClient& client =
+        inspector->db->getReadOnlyStoreClient();
+
+    // recursive, depth, classes, page_size and cursor apply to the
+    // whole request; subject, policy_uri and where apply to each query
     for (it = payload.Begin(); it != payload.End(); ++it) {
         if (!it->IsObject()) {
             sendErrorRes(id, "ERROR", "Malformed message: not an object");
@@ -107,19 +218,96 @@ void InspectorServerHandler::handlePolicyQueryReq(const Value& id,
         }
 
         const Value& subjectv = (*it)["subject"];
-        const Value& recursivev = (*it)["recursive"];
         if (!subjectv.IsString()) {
             sendErrorRes(id, "ERROR",
                          "Malformed message: subject is not a string");
             return;
         }
-        if (recursivev.IsBool()) {
-            recursive = recursivev.GetBool();
+        if (it->HasMember("recursive") && (*it)["recursive"].IsBool()) {
+            recursive = (*it)["recursive"].GetBool();
+        }
+        if (it->HasMember("depth") && (*it)["depth"].IsUint64()) {
+            depth = (*it)["depth"].GetUint64();
+        }
+        if (it->HasMember("classes")) {
+            const Value& classesv = (*it)["classes"];
+            if (!classesv.IsArray()) {
+                sendErrorRes(id, "ERROR",
+                             "Malformed message: classes is not an array");
+                return;
+            }
+            for (Value::ConstValueIterator cit = classesv.Begin();
+                 cit != classesv.End(); ++cit) {
+                if (!cit->IsString()) {
+                    sendErrorRes(id, "ERROR",
+                                 "Malformed message: class is not a string");
+                    return;
+                }
+                try {
+                    classes.insert(inspector->db->
+                                   getClassInfo(cit->GetString()).getId());
+                } catch (const std::out_of_range& e) {
+                    sendErrorRes(id, "ERROR",
+                                 std::string("Unknown class: ") +
+                                 cit->GetString());
+                    return;
+                }
+            }
+        }
+        if (it->HasMember("page_size") && (*it)["page_size"].IsUint64()) {
+            pageSize = (*it)["page_size"].GetUint64();
+        }
+        if (it->HasMember("cursor")) {
+            const Value& cursorv = (*it)["cursor"];
+            if (!cursorv.IsObject() ||
+                !cursorv.HasMember("query") || !cursorv["query"].IsUint64() ||
+                !cursorv.HasMember("uri") || !cursorv["uri"].IsString()) {
+                sendErrorRes(id, "ERROR",
+                             "Malformed message: invalid cursor");
+                return;
+            }
+            cursorQuery = cursorv["query"].GetUint64();
+            cursorUri = cursorv["uri"].GetString();
         }
 
         try {
             const modb::ClassInfo& ci =
                 inspector->db->getClassInfo(subjectv.GetString());
+
+            filters_t filters;
+            if (it->HasMember("where")) {
+                const Value& wherev = (*it)["where"];
+                if (!wherev.IsArray()) {
+                    sendErrorRes(id, "ERROR",
+                                 "Malformed message: where is not an array");
+                    return;
+                }
+                for (Value::ConstValueIterator wit = wherev.Begin();
+                     wit != wherev.End(); ++wit) {
+                    if (!wit->IsObject() ||
+                        !wit->HasMember("name") ||
+                        !(*wit)["name"].IsString() ||
+                        !wit->HasMember("data") ||
+                        !(*wit)["data"].IsString()) {
+                        sendErrorRes(id, "ERROR",
+                                     "Malformed message: invalid filter");
+                        return;
+                    }
+                    const char* pname = (*wit)["name"].GetString();
+                    try {
+                        filters.push_back(std::make_pair(
+                            &ci.getProperty(pname),
+                            std::string((*wit)["data"].GetString())));
+                    } catch (const std::out_of_range& e) {
+                        sendErrorRes(id, "ERROR",
+                                     std::string("Unknown property: ") +
+                                     pname);
+                        return;
+                    }
+                }
+            }
+
+            boost::optional<modb::URI> uri;
             if (it->HasMember("policy_uri")) {
                 const Value& puriv = (*it)["policy_uri"];
                 if (!puriv.IsString()) {
@@ -127,18 +315,16 @@ void InspectorServerHandler::handlePolicyQueryReq(const Value& id,
                                  "Malformed message: policy_uri is not a string");
                     return;
                 }
-                modb::URI puri(puriv.GetString());
-                modb::reference_t mo(ci.getId(), puri);
-                mos.push_back(mo);
-            } else {
-                std::unordered_set<modb::URI> uris;
-                inspector->db->getReadOnlyStoreClient()
-                    .getObjectsForClass(ci.getId(), uris);
-                for (const modb::URI& uri : uris) {
-                    modb::reference_t mo(ci.getId(), uri);
-                    mos.push_back(mo);
-                }
+                uri = modb::URI(puriv.GetString());
             }
+
+            queryKey += ci.getName();
+            queryKey += ' ';
+            if (uri) queryKey += uri.get().toString();
+            queryKey += '\n';
+            queryClasses.push_back(ci.getId());
+            queryUris.push_back(uri);
+            queryFilters.push_back(std::move(filters));
         } catch (const std::out_of_range& e) {
             sendErrorRes(id, "ERROR",
                          std::string("Unknown subject: ") +
@@ -147,13 +333,298 @@ void InspectorServerHandler::handlePolicyQueryReq(const Value& id,
         }
     }
 
+    // the next page of a paged query resumes from the URIs collected
+    // and sorted for its first page, so fetching a whole class costs
+    // one sort rather than one per page.  Objects created since the
+    // first page are not returned.
+    std::vector<std::vector<modb::URI> > queries;
+    bool resumed = !cursorUri.empty() && queryKey == pagedKey;
+    if (resumed) {
+        queries.swap(pagedUris);
+    } else {
+        for (size_t q = 0; q < queryClasses.size(); ++q) {
+            std::vector<modb::URI> uris;
+            if (queryUris[q]) {
+                uris.push_back(queryUris[q].get());
+            } else {
+                std::unordered_set<modb::URI> all;
+                client.getObjectsForClass(queryClasses[q], all);
+                uris.insert(uris.end(), all.begin(), all.end());
+                // a stable order so that a cursor can resume the query
+                std::sort(uris.begin(), uris.end());
+            }
+            queries.push_back(std::move(uris));
+        }
+    }
+
+    // collect the page that follows the cursor.  The cursor is the
+    // last object returned, so it stays valid as objects come and go.
+    // Filters are checked as the page is collected, so the objects
+    // past the end of the page are not read.
+    std::vector<modb::reference_t> mos;
+    size_t lastQuery = 0;
+    std::string nextUri;
+    for (size_t q = cursorUri.empty() ? 0 : cursorQuery;
+         q < queries.size() && nextUri.empty(); ++q) {
+        const std::vector<modb::URI>& uris = queries[q];
+        std::vector<modb::URI>::const_iterator uit = uris.begin();
+        if (!cursorUri.empty() && q == cursorQuery)
+            uit = std::upper_bound(uris.begin(), uris.end(),
+                                   modb::URI(cursorUri));
+        for (; uit != uris.end(); ++uit) {
+            if (!queryFilters[q].empty()) {
+                std::shared_ptr<const modb::mointernal::ObjectInstance> oi;
+                try {
+                    oi = client.get(queryClasses[q], *uit);
+                } catch (const std::out_of_range& e) {
+                    continue;
+                }
+                bool match = true;
+                for (const filters_t::value_type& f : queryFilters[q]) {
+                    if (!matchesFilter(*oi, *f.first, f.second)) {
+                        match = false;
+                        break;
+                    }
+                }
+                if (!match) continue;
+            }
+            if (pageSize > 0 && mos.size() == pageSize) {
+                nextUri = mos.back().second.toString();
+                break;
+            }
+            mos.push_back(modb::reference_t(queryClasses[q], *uit));
+            lastQuery = q;
+        }
+    }
+
+    if (nextUri.empty()) {
+        pagedKey.clear();
+        pagedUris.clear();
+    } else {
+        pagedKey = queryKey;
+        pagedUris.swap(queries);
+    }
+
     PolicyQueryRes* res =
-        new PolicyQueryRes(id, inspector, mos, recursive);
+        new PolicyQueryRes(id, inspector, mos, recursive, depth, classes,
+                           lastQuery, nextUri);
+    getConnection()->sendMessage(res, true);
+}
+
+class StoreStatsRes : public OpflexMessage {
+public:
+    StoreStatsRes(const rapidjson::Value& id,
+                  const modb::class_stats_map_t& stats_)
+        : OpflexMessage("custom", RESPONSE, &id), stats(stats_) {}
+
+    virtual void serializePayload(yajr::rpc::SendHandler& writer) const {
+        (*this)(writer);
+    }
+
+    virtual StoreStatsRes* clone() {
+        return new StoreStatsRes(*this);
+    }
+
+    virtual bool operator()(yajr::rpc::SendHandler& writer) const {
+        writer.StartObject();
+        writer.String("method");
+        writer.String(InspectorServerHandler::STORE_STATS.c_str());
+        writer.String("result");
+        writer.StartObject();
+        writer.String("stats");
+        writer.StartArray();
+        for (const modb::class_stats_map_t::value_type& s : stats) {
+            writer.StartObject();
+            writer.String("class");
+            writer.String(s.first.c_str());
+            writer.String("instances");
+            writer.Uint64(s.second.instances);
+            writer.String("prop_bytes");
+            writer.Uint64(s.second.propBytes);
+            writer.String("index_bytes");
+            writer.Uint64(s.second.indexBytes);
+            writer.String("uri_bytes");
+            writer.Uint64(s.second.uriBytes);
+            writer.EndObject();
+        }
+        writer.EndArray();
+        writer.EndObject();
+        writer.EndObject();
+        return true;
+    }
+
+    modb::class_stats_map_t stats;
+};
+
+void InspectorServerHandler::handleStoreStatsReq(const Value& id,
+                                                 const Value& payload) {
+    modb::class_stats_map_t stats;
+    inspector->getStore().getClassStats(stats);
+
+    StoreStatsRes* res = new StoreStatsRes(id, stats);
+    getConnection()->sendMessage(res, true);
+}
+
+class WatchRes : public OpflexMessage {
+public:
+    WatchRes(const rapidjson::Value& id,
+             Inspector* inspector_,
+             const std::vector<modb::ObjectStore::Change>& changes_,
+             uint64_t seq_, bool resync_, bool includeProps_)
+        : OpflexMessage("custom", RESPONSE, &id),
+          inspector(inspector_), changes(changes_), seq(seq_),
+          resync(resync_), includeProps(includeProps_) {}
+
+    virtual void serializePayload(yajr::rpc::SendHandler& writer) const {
+        (*this)(writer);
+    }
+
+    virtual WatchRes* clone() {
+        return new WatchRes(*this);
+    }
+
+    virtual bool operator()(yajr::rpc::SendHandler& writer) const {
+        MOSerializer& serializer = inspector->getSerializer();
+        modb::ObjectStore& store = inspector->getStore();
+        const modb::ObjectStore::SnapshotGuard snapshot(store);
+        modb::mointernal::StoreClient& client =
+            store.getReadOnlyStoreClient();
+
+        writer.StartObject();
+        writer.String("method");
+        writer.String(InspectorServerHandler::WATCH.c_str());
+        writer.String("result");
+        writer.StartObject();
+        writer.String("seq");
+        writer.Uint64(seq);
+        writer.String("resync");
+        writer.Bool(resync);
+        writer.String("changes");
+        writer.StartArray();
+        for (const modb::ObjectStore::Change& c : changes) {
+            bool removed = c.op == modb::ObjectStore::Change::REMOVED;
+            writer.StartObject();
+            writer.String("seq");
+            writer.Uint64(c.seq);
+            writer.String("subject");
+            writer.String(store.getClassInfo(c.class_id).getName().c_str());
+            writer.String("uri");
+            writer.String(c.uri.toString().c_str());
+            writer.String("op");
+            writer.String(removed ? "removed" : "updated");
+            if (includeProps && !removed) {
+                try {
+                    // the object as it is now, which may be newer
+                    // than the change
+                    writer.String("object");
+                    serializer.serialize(c.class_id, c.uri, client,
+                                         writer, false);
+                } catch (const std::out_of_range& e) {
+                    // removed since; a later change reports it
+                    writer.Null();
+                }
+            }
+            writer.EndObject();
+        }
+        writer.EndArray();
+        writer.EndObject();
+        writer.EndObject();
+        return true;
+    }
+
+    Inspector* inspector;
+    std::vector<modb::ObjectStore::Change> changes;
+    uint64_t seq;
+    bool resync;
+    bool includeProps;
+};
+
+void InspectorServerHandler::handleWatchReq(const Value& id,
+                                            const Value& payload) {
+    modb::ObjectStore& store = inspector->getStore();
+    if (store.getJournalSize() == 0) {
+        sendErrorRes(id, "ERROR",
+                     "Change journal is disabled: set journal-size "
+                     "to watch for changes");
+        return;
+    }
+
+    boost::optional<modb::class_id_t> classId;
+    std::string uriPrefix;
+    boost::optional<uint64_t> since;
+    bool includeProps = false;
+    Value::ConstValueIterator it;
+    for (it = payload.Begin(); it != payload.End(); ++it) {
+        if (!it->IsObject()) {
+            sendErrorRes(id, "ERROR", "Malformed message: not an object");
+            return;
+        }
+        if (it->HasMember("subject")) {
+            const Value& subjectv = (*it)["subject"];
+            if (!subjectv.IsString()) {
+                sendErrorRes(id, "ERROR",
+                             "Malformed message: subject is not a string");
+                return;
+            }
+            try {
+                classId = store.getClassInfo(subjectv.GetString()).getId();
+            } catch (const std::out_of_range& e) {
+                sendErrorRes(id, "ERROR",
+                             std::string("Unknown subject: ") +
+                             subjectv.GetString());
+                return;
+            }
+        }
+        if (it->HasMember("policy_uri")) {
+            const Value& puriv = (*it)["policy_uri"];
+            if (!puriv.IsString()) {
+                sendErrorRes(id, "ERROR",
+                             "Malformed message: policy_uri is not a string");
+                return;
+            }
+            uriPrefix = puriv.GetString();
+        }
+        if (it->HasMember("since") && (*it)["since"].IsUint64()) {
+            since = (*it)["since"].GetUint64();
+        }
+        if (it->HasMember("properties") && (*it)["properties"].IsBool()) {
+            includeProps = (*it)["properties"].GetBool();
+        }
+    }
+
+    // without a sequence number the watch starts from now
+    std::vector<modb::ObjectStore::Change> all;
+    bool resync = false;
+    uint64_t seq = since ? since.get() : store.getJournalSeq();
+    if (since && !store.getChangesSince(seq, all)) {
+        resync = true;
+        all.clear();
+        seq = store.getJournalSeq();
+    } else if (!all.empty()) {
+        seq = all.back().seq;
+    }
+
+    std::vector<modb::ObjectStore::Change> changes;
+    for (const modb::ObjectStore::Change& c : all) {
+        if (classId && c.class_id != classId.get())
+            continue;
+        if (!uriPrefix.empty() &&
+            c.uri.toString().compare(0, uriPrefix.size(), uriPrefix) != 0)
+            continue;
+        changes.push_back(c);
+    }
+
+    WatchRes* res = new WatchRes(id, inspector, changes, seq,
+                                 resync, includeProps);
     getConnection()->sendMessage(res, true);
 }
 
 const std::string
 InspectorServerHandler::POLICY_QUERY("org.opendaylight.opflex.policy_query");
+const std::string
+InspectorServerHandler::STORE_STATS("org.opendaylight.opflex.store_stats");
+const std::string
+InspectorServerHandler::WATCH("org.opendaylight.opflex.watch");
 
 void InspectorServerHandler::handleCustomReq(const Value& id,
                                              const Value& payload) {
@@ -187,6 +658,10 @@ void InspectorServerHandler::handleCustomReq(const Value& id,
         }
         if (POLICY_QUERY == methodv.GetString()) {
             handlePolicyQueryReq(id, paramsv);
+        } else if (STORE_STATS == methodv.GetString()) {
+            handleStoreStatsReq(id, paramsv);
+        } else if (WATCH == methodv.GetString()) {
+            handleWatchReq(id, paramsv);
         } else {
             sendErrorRes(id, "ERROR",
                          "Malformed custom message: unknown method: " +
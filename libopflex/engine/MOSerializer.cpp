@@ -15,13 +15,21 @@
 #endif
 
 #include <cstdio>
+#include <algorithm>
+#include <cstring>
 #include <sstream>
+#include <thread>
+#include <chrono>
+#include <unordered_map>
 
 #include <boost/next_prior.hpp>
 #include <rapidjson/document.h>
+#include <rapidjson/error/en.h>
 #include <rapidjson/filewritestream.h>
 #include <rapidjson/filereadstream.h>
 #include <rapidjson/prettywriter.h>
+#include <rapidjson/reader.h>
+#include <rapidjson/stringbuffer.h>
 
 #include "opflex/engine/internal/MOSerializer.h"
 #include "opflex/modb/internal/Region.h"
@@ -104,6 +112,205 @@ void MOSerializer::deserialize_enum(modb::mointernal::StoreClient& client,
     }
 }
 
+void MOSerializer::deserialize_prop(const ClassInfo& ci,
+                                    StoreClient& client,
+                                    const char* pname,
+                                    const rapidjson::Value& pvalue,
+                                    ObjectInstance& oi) {
+    const modb::mointernal::ClassCodec* codec = ci.getCodec();
+    if (codec != NULL && codec->decode(pname, pvalue, oi))
+        return;
+
+    try {
+        const PropertyInfo& pinfo = ci.getProperty(pname);
+        switch (pinfo.getType()) {
+        case PropertyInfo::STRING:
+            if (pinfo.getCardinality() == PropertyInfo::VECTOR) {
+                if (!pvalue.IsArray()) return;
+                for (SizeType j = 0; j < pvalue.Size(); ++j) {
+                    const Value& v = pvalue[j];
+                    if (!v.IsString()) continue;
+                    oi.addString(pinfo.getId(), v.GetString());
+                }
+            } else {
+                if (!pvalue.IsString()) return;
+                oi.setString(pinfo.getId(),
+                             pvalue.GetString());
+            }
+            break;
+        case PropertyInfo::REFERENCE:
+            if (pinfo.getCardinality() == PropertyInfo::VECTOR) {
+                if (!pvalue.IsArray()) return;
+                for (SizeType j = 0; j < pvalue.Size(); ++j) {
+                    const Value& v = pvalue[j];
+                    deserialize_ref(client, pinfo, v, oi, false);
+                }
+            } else {
+                deserialize_ref(client, pinfo, pvalue, oi, true);
+            }
+            break;
+        case PropertyInfo::S64:
+            if (pinfo.getCardinality() == PropertyInfo::VECTOR) {
+                if (!pvalue.IsArray()) return;
+                for (SizeType j = 0; j < pvalue.Size(); ++j) {
+                    const Value& v = pvalue[j];
+                    if (!v.IsInt64()) continue;
+                    oi.addInt64(pinfo.getId(), v.GetInt64());
+                }
+            } else {
+                if (!pvalue.IsInt64()) return;
+                oi.setInt64(pinfo.getId(),
+                            pvalue.GetInt64());
+            }
+            break;
+        case PropertyInfo::ENUM8:
+        case PropertyInfo::ENUM16:
+        case PropertyInfo::ENUM32:
+        case PropertyInfo::ENUM64:
+            {
+                if (pinfo.getCardinality() == PropertyInfo::VECTOR) {
+                    if (!pvalue.IsArray()) return;
+                    for (SizeType j = 0; j < pvalue.Size(); ++j) {
+                        const Value& v = pvalue[j];
+                        deserialize_enum(client, pinfo, v, oi, false);
+                    }
+                } else {
+                    deserialize_enum(client, pinfo, pvalue, oi, true);
+                }
+            }
+            break;
+        case PropertyInfo::U64:
+            if (pinfo.getCardinality() == PropertyInfo::VECTOR) {
+                if (!pvalue.IsArray()) return;
+                for (SizeType j = 0; j < pvalue.Size(); ++j) {
+                    const Value& v = pvalue[j];
+                    if (!v.IsUint64()) continue;
+                    oi.addUInt64(pinfo.getId(), v.GetUint64());
+                }
+            } else {
+                if (!pvalue.IsUint64()) return;
+                oi.setUInt64(pinfo.getId(),
+                             pvalue.GetUint64());
+            }
+            break;
+        case PropertyInfo::MAC:
+            if (pinfo.getCardinality() == PropertyInfo::VECTOR) {
+                if (!pvalue.IsArray()) return;
+                for (SizeType j = 0; j < pvalue.Size(); ++j) {
+                    const Value& v = pvalue[j];
+                    if (!v.IsString()) continue;
+                    oi.addMAC(pinfo.getId(), MAC(v.GetString()));
+                }
+            } else {
+                oi.setMAC(pinfo.getId(),
+                          MAC(pvalue.GetString()));
+            }
+            break;
+        case PropertyInfo::COMPOSITE:
+            // do nothing;
+            break;
+        }
+    } catch (const std::invalid_argument& e) {
+        LOG(DEBUG) << "Invalid property "
+                   << pname
+                   << " in class "
+                   << ci.getName();
+    } catch (const std::out_of_range& e) {
+        LOG(DEBUG) << "Unknown property "
+                   << pname
+                   << " in class "
+                   << ci.getName();
+        // ignore property
+    }
+}
+
+void MOSerializer::deserialize_commit(const ClassInfo& ci,
+                                      const URI& uri,
+                                      const std::shared_ptr<ObjectInstance>& oi,
+                                      const char* parent_uri,
+                                      const char* parent_subject,
+                                      const char* parent_relation,
+                                      const std::unordered_set<string>& children,
+                                      StoreClient& client,
+                                      bool replaceChildren,
+                                      /* out */ StoreClient::notif_t* notifs) {
+    bool remoteUpdated = false;
+    if (client.putIfModified(ci.getId(), uri, oi)) {
+        remoteUpdated = true;
+    }
+    if (parent_uri != NULL && parent_subject != NULL) {
+        if (parent_relation == NULL)
+            parent_relation = ci.getName().c_str();
+        try {
+            const ClassInfo& parent_class =
+                store->getClassInfo(parent_subject);
+            const PropertyInfo& parent_prop =
+                parent_class.getProperty(parent_relation);
+            URI puri(parent_uri);
+            if (client.isPresent(parent_class.getId(), puri)) {
+                if (client.addChild(parent_class.getId(),
+                                    puri,
+                                    parent_prop.getId(),
+                                    ci.getId(),
+                                    uri)) {
+                    if (notifs)
+                        client.queueNotification(parent_class.getId(),
+                                                 puri,
+                                                 *notifs);
+                }
+            }
+        } catch (const std::out_of_range& e) {
+            // no parent class or property found
+            LOG(ERROR) << "Invalid parent or property for "
+                       << uri.toString();
+        }
+    }
+
+    if (replaceChildren) {
+        const ClassInfo::property_map_t& props = ci.getProperties();
+        ClassInfo::property_map_t::const_iterator it;
+        for (it = props.begin(); it != props.end(); ++it) {
+            if (it->second.getType() == PropertyInfo::COMPOSITE) {
+                std::vector<URI> curChildren;
+                client.getChildren(ci.getId(),
+                                   uri,
+                                   it->second.getId(),
+                                   it->second.getClassId(),
+                                   curChildren);
+
+                for (URI& child : curChildren) {
+                    if (children.find(child.toString()) == children.end()) {
+                        // this child isn't in the list of children
+                        // set in the update
+                        try {
+                            LOG(DEBUG) << "Removing missing child " << child
+                                       << " from updated parent " << uri;
+                            client.remove(it->second.getClassId(), child,
+                                          true, notifs);
+                            if (notifs)
+                                (*notifs)[child] = it->second.getClassId();
+                            remoteUpdated = true;
+                        } catch (const std::out_of_range& e) {
+                            // most likely already removed by
+                            // another thread
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    if (remoteUpdated) {
+        LOG(DEBUG) << "Updated object " << uri;
+        if (notifs)
+            client.queueNotification(ci.getId(), uri, *notifs);
+        PolicyUpdateOp op = replaceChildren ? PolicyUpdateOp::REPLACE
+                                            : PolicyUpdateOp::ADD;
+        if (listener)
+            listener->remoteObjectUpdated(ci.getId(), uri, op);
+    }
+}
+
 void MOSerializer::deserialize(const rapidjson::Value& mo,
                                modb::mointernal::StoreClient& client,
                                bool replaceChildren,
@@ -135,118 +342,15 @@ void MOSerializer::deserialize(const rapidjson::Value& mo,
                     const Value& pname = prop["name"];
                     if (!pname.IsString())
                         continue;
-                    const Value& pvalue = prop["data"];
-
-                    try {
-                        const PropertyInfo& pinfo =
-                            ci.getProperty(pname.GetString());
-                        switch (pinfo.getType()) {
-                        case PropertyInfo::STRING:
-                            if (pinfo.getCardinality() == PropertyInfo::VECTOR) {
-                                if (!pvalue.IsArray()) continue;
-                                for (SizeType j = 0; j < pvalue.Size(); ++j) {
-                                    const Value& v = pvalue[j];
-                                    if (!v.IsString()) continue;
-                                    oi->addString(pinfo.getId(), v.GetString());
-                                }
-                            } else {
-                                if (!pvalue.IsString()) continue;
-                                oi->setString(pinfo.getId(),
-                                              pvalue.GetString());
-                            }
-                            break;
-                        case PropertyInfo::REFERENCE:
-                            if (pinfo.getCardinality() == PropertyInfo::VECTOR) {
-                                if (!pvalue.IsArray()) continue;
-                                for (SizeType j = 0; j < pvalue.Size(); ++j) {
-                                    const Value& v = pvalue[j];
-                                    deserialize_ref(client, pinfo, v, *oi, false);
-                                }
-                            } else {
-                                deserialize_ref(client, pinfo, pvalue, *oi, true);
-                            }
-                            break;
-                        case PropertyInfo::S64:
-                            if (pinfo.getCardinality() == PropertyInfo::VECTOR) {
-                                if (!pvalue.IsArray()) continue;
-                                for (SizeType j = 0; j < pvalue.Size(); ++j) {
-                                    const Value& v = pvalue[j];
-                                    if (!v.IsInt64()) continue;
-                                    oi->addInt64(pinfo.getId(), v.GetInt64());
-                                }
-                            } else {
-                                if (!pvalue.IsInt64()) continue;
-                                oi->setInt64(pinfo.getId(),
-                                             pvalue.GetInt64());
-                            }
-                            break;
-                        case PropertyInfo::ENUM8:
-                        case PropertyInfo::ENUM16:
-                        case PropertyInfo::ENUM32:
-                        case PropertyInfo::ENUM64:
-                            {
-                                if (pinfo.getCardinality() == PropertyInfo::VECTOR) {
-                                    if (!pvalue.IsArray()) continue;
-                                    for (SizeType j = 0; j < pvalue.Size(); ++j) {
-                                        const Value& v = pvalue[j];
-                                        deserialize_enum(client, pinfo, v, *oi, false);
-                                    }
-                                } else {
-                                    deserialize_enum(client, pinfo, pvalue, *oi, true);
-                                }
-                            }
-                            break;
-                        case PropertyInfo::U64:
-                            if (pinfo.getCardinality() == PropertyInfo::VECTOR) {
-                                if (!pvalue.IsArray()) continue;
-                                for (SizeType j = 0; j < pvalue.Size(); ++j) {
-                                    const Value& v = pvalue[j];
-                                    if (!v.IsUint64()) continue;
-                                    oi->addUInt64(pinfo.getId(), v.GetUint64());
-                                }
-                            } else {
-                                if (!pvalue.IsUint64()) continue;
-                                oi->setUInt64(pinfo.getId(),
-                                              pvalue.GetUint64());
-                            }
-                            break;
-                        case PropertyInfo::MAC:
-                            if (pinfo.getCardinality() == PropertyInfo::VECTOR) {
-                                if (!pvalue.IsArray()) continue;
-                                for (SizeType j = 0; j < pvalue.Size(); ++j) {
-                                    const Value& v = pvalue[j];
-                                    if (!v.IsString()) continue;
-                                    oi->addMAC(pinfo.getId(), MAC(v.GetString()));
-                                }
-                            } else {
-                                oi->setMAC(pinfo.getId(),
-                                           MAC(pvalue.GetString()));
-                            }
-                            break;
-                        case PropertyInfo::COMPOSITE:
-                            // do nothing;
-                            break;
-                        }
-                    } catch (const std::invalid_argument& e) {
-                        LOG(DEBUG) << "Invalid property "
-                                   << pname.GetString()
-                                   << " in class "
-                                   << ci.getName();
-                    } catch (const std::out_of_range& e) {
-                        LOG(DEBUG) << "Unknown property "
-                                   << pname.GetString()
-                                   << " in class "
-                                   << ci.getName();
-                        // ignore property
-                    }
+                    deserialize_prop(ci, client, pname.GetString(),
+                                     prop["data"], *oi);
                 }
             }
         }
 
-        bool remoteUpdated = false;
-        if (client.putIfModified(ci.getId(), uri, oi)) {
-            remoteUpdated = true;
-        }
+        const char* parent_uri = NULL;
+        const char* parent_subject = NULL;
+        const char* parent_relation = NULL;
         if (mo.HasMember("parent_uri") && mo.HasMember("parent_subject")) {
             const Value& pname = mo["parent_uri"];
             const Value& psubj = mo["parent_subject"];
@@ -255,88 +359,27 @@ void MOSerializer::deserialize(const rapidjson::Value& mo,
                 prel = &mo["parent_relation"];
 
             if (pname.IsString() && psubj.IsString() && prel->IsString()) {
-                try {
-                    const ClassInfo& parent_class =
-                        store->getClassInfo(psubj.GetString());
-                    const PropertyInfo& parent_prop =
-                        parent_class.getProperty(prel->GetString());
-                    URI parent_uri(pname.GetString());
-                    if (client.isPresent(parent_class.getId(), parent_uri)) {
-                        if (client.addChild(parent_class.getId(),
-                                            parent_uri,
-                                            parent_prop.getId(),
-                                            ci.getId(),
-                                            uri)) {
-                            if (notifs)
-                                client.queueNotification(parent_class.getId(),
-                                                         parent_uri,
-                                                         *notifs);
-                        }
-                    }
-                } catch (const std::out_of_range& e) {
-                    // no parent class or property found
-                    LOG(ERROR) << "Invalid parent or property for "
-                               << uri.toString();
-                }
+                parent_uri = pname.GetString();
+                parent_subject = psubj.GetString();
+                parent_relation = prel->GetString();
             }
         }
 
-        if (replaceChildren) {
-            std::unordered_set<string> children;
-            if (mo.HasMember("children")) {
-                const Value& cvs = mo["children"];
-                if (cvs.IsArray()) {
-                    for (SizeType i = 0; i < cvs.Size(); ++i) {
-                        const Value& cv = cvs[i];
-                        if (cv.IsString())
-                            children.insert(cv.GetString());
-                    }
-                }
-            }
-
-            const ClassInfo::property_map_t& props = ci.getProperties();
-            ClassInfo::property_map_t::const_iterator it;
-            for (it = props.begin(); it != props.end(); ++it) {
-                if (it->second.getType() == PropertyInfo::COMPOSITE) {
-                    std::vector<URI> curChildren;
-                    client.getChildren(ci.getId(),
-                                       uri,
-                                       it->second.getId(),
-                                       it->second.getClassId(),
-                                       curChildren);
-
-                    for (URI& child : curChildren) {
-                        if (children.find(child.toString()) == children.end()) {
-                            // this child isn't in the list of children
-                            // set in the update
-                            try {
-                                LOG(DEBUG) << "Removing missing child " << child
-                                           << " from updated parent " << uri;
-                                client.remove(it->second.getClassId(), child,
-                                              true, notifs);
-                                if (notifs)
-                                    (*notifs)[child] = it->second.getClassId();
-                                remoteUpdated = true;
-                            } catch (const std::out_of_range& e) {
-                                // most likely already removed by
-                                // another thread
-                            }
-                        }
-                    }
+        std::unordered_set<string> children;
+        if (replaceChildren && mo.HasMember("children")) {
+            const Value& cvs = mo["children"];
+            if (cvs.IsArray()) {
+                for (SizeType i = 0; i < cvs.Size(); ++i) {
+                    const Value& cv = cvs[i];
+                    if (cv.IsString())
+                        children.insert(cv.GetString());
                 }
             }
         }
 
-        if (remoteUpdated) {
-            LOG(DEBUG) << "Updated object " << uri;
-            if (notifs)
-                client.queueNotification(ci.getId(), uri, *notifs);
-            PolicyUpdateOp op = replaceChildren ? PolicyUpdateOp::REPLACE
-                                                : PolicyUpdateOp::ADD;
-            if (listener)
-                listener->remoteObjectUpdated(ci.getId(), uri, op);
-        }
-
+        deserialize_commit(ci, uri, oi, parent_uri, parent_subject,
+                           parent_relation, children, client,
+                           replaceChildren, notifs);
     } catch (const std::invalid_argument& e) {
         // ignore invalid URIs
         LOG(DEBUG) << "Could not deserialize invalid object of class "
@@ -348,6 +391,555 @@ void MOSerializer::deserialize(const rapidjson::Value& mo,
     }
 }
 
+// the number of objects written to the store between deliveries of
+// update notifications when streaming
+static const size_t DESERIALIZE_CHUNK = 256;
+
+// the smallest chunk of a policy file worth parsing on its own thread
+static const size_t PARALLEL_READ_MIN_CHUNK = 1024 * 1024;
+
+/**
+ * A managed object parsed from a chunk of a policy file, waiting to
+ * be written to the store
+ */
+struct MOSerializer::ParsedMO {
+    ParsedMO(const ClassInfo* ci_, const URI& uri_,
+             const std::shared_ptr<ObjectInstance>& oi_)
+        : ci(ci_), uri(uri_), oi(oi_), hasParentUri(false),
+          hasParentSubject(false), hasParentRelation(false) {}
+
+    const ClassInfo* ci;
+    URI uri;
+    std::shared_ptr<ObjectInstance> oi;
+    std::string parentUri;
+    std::string parentSubject;
+    std::string parentRelation;
+    bool hasParentUri;
+    bool hasParentSubject;
+    bool hasParentRelation;
+    std::unordered_set<string> children;
+};
+
+/**
+ * A SAX handler for a JSON array of managed objects.  The object
+ * instance for each managed object is created as soon as its subject
+ * is read and its properties are decoded into it as they arrive, so
+ * the array is never held in memory as a document.  Property values
+ * that are containers, or that arrive before the name of their
+ * property or the subject of their object, are buffered as JSON text
+ * and decoded once there is enough context.
+ */
+class MOSerializer::StreamHandler
+    : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, StreamHandler> {
+public:
+    /**
+     * Construct a handler that writes each object to the store as it
+     * ends, or that only collects them if parsed is not NULL
+     */
+    StreamHandler(MOSerializer& serializer_, StoreClient& client_,
+                  bool replaceChildren_, bool notify_,
+                  std::vector<ParsedMO>* parsed_ = NULL)
+        : serializer(serializer_), client(client_),
+          replaceChildren(replaceChildren_), notify(notify_),
+          parsed(parsed_), writer(buffer), depth(0), skip(0), capture(0),
+          count(0), committed(0), malformed(false) {
+        beginObject();
+        beginProp();
+    }
+
+    bool Null() { return value(Value()); }
+    bool Bool(bool b) { return value(Value(b)); }
+    bool Int(int i) { return value(Value(i)); }
+    bool Uint(unsigned u) { return value(Value(u)); }
+    bool Int64(int64_t i) { return value(Value(i)); }
+    bool Uint64(uint64_t u) { return value(Value(u)); }
+    bool Double(double d) { return value(Value(d)); }
+    bool String(const char* str, SizeType length, bool) {
+        return value(Value(str, length));
+    }
+    bool StartObject() { return start(true); }
+    bool EndObject(SizeType) { return end(true); }
+    bool StartArray() { return start(false); }
+    bool EndArray(SizeType) { return end(false); }
+
+    bool Key(const char* str, SizeType length, bool copy) {
+        if (capture > 0) return writer.Key(str, length, copy);
+        if (skip > 0) return true;
+        if (depth == 2) {
+            if (strcmp(str, "uri") == 0) moKey = MO_URI;
+            else if (strcmp(str, "subject") == 0) moKey = MO_SUBJECT;
+            else if (strcmp(str, "parent_uri") == 0) moKey = MO_PARENT_URI;
+            else if (strcmp(str, "parent_subject") == 0)
+                moKey = MO_PARENT_SUBJECT;
+            else if (strcmp(str, "parent_relation") == 0)
+                moKey = MO_PARENT_RELATION;
+            else if (strcmp(str, "properties") == 0) moKey = MO_PROPERTIES;
+            else if (strcmp(str, "children") == 0) moKey = MO_CHILDREN;
+            else moKey = MO_OTHER;
+        } else if (depth == 4) {
+            if (strcmp(str, "name") == 0) propKey = PROP_NAME;
+            else if (strcmp(str, "data") == 0) propKey = PROP_DATA;
+            else propKey = PROP_OTHER;
+        }
+        return true;
+    }
+
+    /**
+     * Deliver any notifications that are still queued
+     */
+    void flush() {
+        if (notify && !notifs.empty()) {
+            client.deliverNotifications(notifs);
+            notifs.clear();
+        }
+    }
+
+    /**
+     * Get the number of managed objects read
+     */
+    size_t getCount() const { return count; }
+
+    /**
+     * True if the input was not an array
+     */
+    bool isMalformed() const { return malformed; }
+
+private:
+    enum mo_key_t {
+        MO_OTHER, MO_URI, MO_SUBJECT, MO_PARENT_URI, MO_PARENT_SUBJECT,
+        MO_PARENT_RELATION, MO_PROPERTIES, MO_CHILDREN
+    };
+    enum prop_key_t { PROP_OTHER, PROP_NAME, PROP_DATA };
+
+    MOSerializer& serializer;
+    StoreClient& client;
+    bool replaceChildren;
+    bool notify;
+    StoreClient::notif_t notifs;
+    std::vector<ParsedMO>* parsed;
+
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer;
+
+    // the number of open containers we are tracking: 1 in the array,
+    // 2 in a managed object, 3 in its properties or children and 4 in
+    // a property
+    int depth;
+    // the open containers below a value we are ignoring
+    int skip;
+    // the open containers below a property value being buffered
+    int capture;
+    size_t count;
+    size_t committed;
+    bool malformed;
+
+    // the managed object being read
+    mo_key_t moKey;
+    bool inProperties;
+    std::string uri;
+    bool hasUri;
+    std::string parentUri;
+    bool hasParentUri;
+    std::string parentSubject;
+    bool hasParentSubject;
+    std::string parentRelation;
+    bool hasParentRelation;
+    const ClassInfo* ci;
+    bool unknownClass;
+    std::shared_ptr<ObjectInstance> oi;
+    std::unordered_set<string> children;
+    std::vector<std::pair<string, string> > pending;
+
+    // the property being read
+    prop_key_t propKey;
+    std::string name;
+    bool hasName;
+    bool hasData;
+
+    void beginObject() {
+        moKey = MO_OTHER;
+        inProperties = false;
+        hasUri = hasParentUri = hasParentSubject = hasParentRelation = false;
+        ci = NULL;
+        unknownClass = false;
+        oi.reset();
+        children.clear();
+        pending.clear();
+    }
+
+    void beginProp() {
+        propKey = PROP_OTHER;
+        hasName = false;
+        hasData = false;
+    }
+
+    void setSubject(const Value& v) {
+        try {
+            ci = &serializer.store->getClassInfo(v.GetString());
+            oi = std::make_shared<ObjectInstance>(ci->getId(), false);
+        } catch (const std::out_of_range& e) {
+            // ignore unknown class
+            LOG(DEBUG) << "Could not deserialize object of unknown class "
+                       << v.GetString();
+            unknownClass = true;
+            pending.clear();
+        }
+    }
+
+    // decode the property from the JSON text in the buffer, which
+    // holds the value wrapped in an array
+    void decodeBuffered(const char* pname, const char* json) {
+        Document d;
+        d.Parse(json);
+        if (d.HasParseError() || !d.IsArray() || d.Size() != 1) return;
+        serializer.deserialize_prop(*ci, client, pname, d[0], *oi);
+    }
+
+    void data(const Value& v) {
+        if (ci != NULL && hasName) {
+            serializer.deserialize_prop(*ci, client, name.c_str(), v, *oi);
+            return;
+        }
+        buffer.Clear();
+        writer.Reset(buffer);
+        writer.StartArray();
+        v.Accept(writer);
+        writer.EndArray();
+        hasData = true;
+    }
+
+    void endProp() {
+        if (hasData && hasName && !unknownClass) {
+            if (ci != NULL)
+                decodeBuffered(name.c_str(), buffer.GetString());
+            else
+                pending.push_back(std::make_pair(name,
+                                                 string(buffer.GetString())));
+        }
+        beginProp();
+    }
+
+    void collect(const URI& u) {
+        parsed->emplace_back(ci, u, oi);
+        ParsedMO& mo = parsed->back();
+        mo.parentUri.swap(parentUri);
+        mo.hasParentUri = hasParentUri;
+        mo.parentSubject.swap(parentSubject);
+        mo.hasParentSubject = hasParentSubject;
+        mo.parentRelation.swap(parentRelation);
+        mo.hasParentRelation = hasParentRelation;
+        mo.children.swap(children);
+    }
+
+    void endObject() {
+        count += 1;
+        if (ci != NULL && hasUri) {
+            try {
+                URI u(uri);
+                for (const std::pair<string, string>& p : pending)
+                    decodeBuffered(p.first.c_str(), p.second.c_str());
+                if (parsed) {
+                    collect(u);
+                } else {
+                    serializer.deserialize_commit(*ci, u, oi,
+                        hasParentUri ? parentUri.c_str() : NULL,
+                        hasParentSubject ? parentSubject.c_str() : NULL,
+                        hasParentRelation ? parentRelation.c_str() : NULL,
+                        children, client, replaceChildren,
+                        notify ? &notifs : NULL);
+                    committed += 1;
+                }
+            } catch (const std::invalid_argument& e) {
+                // ignore invalid URIs
+                LOG(DEBUG) << "Could not deserialize invalid object of class "
+                           << ci->getName();
+            } catch (const std::out_of_range& e) {
+                LOG(DEBUG) << "Could not deserialize object " << uri;
+            }
+            if (committed % DESERIALIZE_CHUNK == 0)
+                flush();
+        }
+        beginObject();
+    }
+
+    bool value(const Value& v) {
+        if (capture > 0) return v.Accept(writer);
+        if (skip > 0) return true;
+        switch (depth) {
+        case 0:
+            malformed = true;
+            return false;
+        case 2:
+            if (!v.IsString()) break;
+            switch (moKey) {
+            case MO_URI:
+                uri.assign(v.GetString(), v.GetStringLength());
+                hasUri = true;
+                break;
+            case MO_SUBJECT:
+                if (ci == NULL && !unknownClass)
+                    setSubject(v);
+                break;
+            case MO_PARENT_URI:
+                parentUri.assign(v.GetString(), v.GetStringLength());
+                hasParentUri = true;
+                break;
+            case MO_PARENT_SUBJECT:
+                parentSubject.assign(v.GetString(), v.GetStringLength());
+                hasParentSubject = true;
+                break;
+            case MO_PARENT_RELATION:
+                parentRelation.assign(v.GetString(), v.GetStringLength());
+                hasParentRelation = true;
+                break;
+            default:
+                break;
+            }
+            break;
+        case 3:
+            if (!inProperties && replaceChildren && v.IsString())
+                children.insert(string(v.GetString(), v.GetStringLength()));
+            break;
+        case 4:
+            if (propKey == PROP_NAME && v.IsString()) {
+                name.assign(v.GetString(), v.GetStringLength());
+                hasName = true;
+            } else if (propKey == PROP_DATA && !unknownClass) {
+                data(v);
+            }
+            break;
+        default:
+            break;
+        }
+        return true;
+    }
+
+    bool start(bool object) {
+        if (capture > 0) {
+            capture += 1;
+            return object ? writer.StartObject() : writer.StartArray();
+        }
+        if (skip > 0) {
+            skip += 1;
+            return true;
+        }
+        switch (depth) {
+        case 0:
+            if (object) {
+                malformed = true;
+                return false;
+            }
+            depth = 1;
+            break;
+        case 1:
+            if (object) {
+                beginObject();
+                depth = 2;
+            } else {
+                skip = 1;
+            }
+            break;
+        case 2:
+            if (!object &&
+                (moKey == MO_PROPERTIES || moKey == MO_CHILDREN)) {
+                inProperties = (moKey == MO_PROPERTIES);
+                depth = 3;
+            } else {
+                skip = 1;
+            }
+            break;
+        case 3:
+            if (object && inProperties) {
+                beginProp();
+                depth = 4;
+            } else {
+                skip = 1;
+            }
+            break;
+        case 4:
+            if (propKey == PROP_DATA && !unknownClass) {
+                buffer.Clear();
+                writer.Reset(buffer);
+                writer.StartArray();
+                if (object) writer.StartObject(); else writer.StartArray();
+                capture = 1;
+            } else {
+                skip = 1;
+            }
+            break;
+        }
+        return true;
+    }
+
+    bool end(bool object) {
+        if (capture > 0) {
+            if (object) writer.EndObject(); else writer.EndArray();
+            capture -= 1;
+            if (capture == 0) {
+                writer.EndArray();
+                hasData = true;
+                if (ci != NULL && hasName) {
+                    decodeBuffered(name.c_str(), buffer.GetString());
+                    hasData = false;
+                }
+            }
+            return true;
+        }
+        if (skip > 0) {
+            skip -= 1;
+            return true;
+        }
+        switch (depth) {
+        case 2:
+            endObject();
+            break;
+        case 4:
+            endProp();
+            break;
+        }
+        depth -= 1;
+        return true;
+    }
+};
+
+template <typename InputStream, typename Handler>
+static bool parseMOs(InputStream& is, Handler& handler) {
+    rapidjson::Reader reader;
+    rapidjson::ParseResult result = reader.Parse(is, handler);
+    handler.flush();
+    if (handler.isMalformed()) {
+        LOG(ERROR) << "Malformed policy file: not an array";
+        return false;
+    } else if (result.IsError()) {
+        LOG(ERROR) << "Error parsing managed objects: "
+                   << rapidjson::GetParseError_En(result.Code())
+                   << " at offset " << result.Offset();
+        return false;
+    }
+    return true;
+}
+
+size_t MOSerializer::deserializeStream(FILE* pfile, StoreClient& client,
+                                       bool replaceChildren, bool notify) {
+    char buffer[8192];
+    rapidjson::FileReadStream f(pfile, buffer, sizeof(buffer));
+    StreamHandler handler(*this, client, replaceChildren, notify);
+    parseMOs(f, handler);
+    return handler.getCount();
+}
+
+size_t MOSerializer::deserializeStream(const char* json, StoreClient& client,
+                                       bool replaceChildren, bool notify) {
+    rapidjson::StringStream s(json);
+    StreamHandler handler(*this, client, replaceChildren, notify);
+    parseMOs(s, handler);
+    return handler.getCount();
+}
+
+/**
+ * A rapidjson input stream over a range of a buffer holding some of
+ * the elements of a JSON array, which reads them as an array of
+ * their own
+ */
+class ChunkStream {
+public:
+    typedef char Ch;
+
+    ChunkStream(const char* begin_, const char* end_)
+        : begin(begin_), cur(begin_), end(end_), state(OPEN) {}
+
+    Ch Peek() const {
+        if (state == OPEN) return '[';
+        if (cur < end) return *cur;
+        return state == BODY ? ']' : '\0';
+    }
+
+    Ch Take() {
+        if (state == OPEN) {
+            state = BODY;
+            return '[';
+        }
+        if (cur < end) return *cur++;
+        if (state == BODY) {
+            state = CLOSED;
+            return ']';
+        }
+        return '\0';
+    }
+
+    size_t Tell() const {
+        return (cur - begin) + (state != OPEN) + (state == CLOSED);
+    }
+
+    Ch* PutBegin() { RAPIDJSON_ASSERT(false); return 0; }
+    void Put(Ch) { RAPIDJSON_ASSERT(false); }
+    void Flush() { RAPIDJSON_ASSERT(false); }
+    size_t PutEnd(Ch*) { RAPIDJSON_ASSERT(false); return 0; }
+
+private:
+    enum { OPEN, BODY, CLOSED };
+    const char* begin;
+    const char* cur;
+    const char* end;
+    int state;
+};
+
+/**
+ * Split the elements of the JSON array in the buffer into at most
+ * the given number of ranges of about the same size.  Each range
+ * holds whole elements separated by commas.
+ *
+ * @return false if the buffer does not hold a complete array
+ */
+static bool splitArray(const string& buf, size_t chunks,
+                       std::vector<std::pair<size_t, size_t> >& ranges) {
+    size_t i = buf.find_first_not_of(" \t\r\n");
+    if (i == string::npos || buf[i] != '[') return false;
+    i += 1;
+
+    size_t target = buf.size() / chunks;
+    size_t start = i;
+    int depth = 0;
+    bool inString = false;
+    bool escape = false;
+    for (; i < buf.size(); ++i) {
+        char c = buf[i];
+        if (inString) {
+            if (escape) escape = false;
+            else if (c == '\\') escape = true;
+            else if (c == '"') inString = false;
+            continue;
+        }
+        switch (c) {
+        case '"':
+            inString = true;
+            break;
+        case '{':
+        case '[':
+            depth += 1;
+            break;
+        case '}':
+        case ']':
+            if (depth == 0) {
+                ranges.push_back(std::make_pair(start, i));
+                return true;
+            }
+            depth -= 1;
+            break;
+        case ',':
+            if (depth == 0 && i - start >= target &&
+                ranges.size() + 1 < chunks) {
+                ranges.push_back(std::make_pair(start, i));
+                start = i + 1;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return false;
+}
+
 static void getRoots(ObjectStore* store, Region::obj_set_t& roots) {
     std::unordered_set<string> owners;
     store->getOwners(owners);
@@ -394,6 +986,78 @@ void MOSerializer::dumpMODB(FILE* pfile) {
     fwrite("\n", 1, 1, pfile);
 }
 
+/**
+ * A writer that forwards to another writer and pauses after every
+ * chunk of JSON objects, flushing the output stream first so the
+ * pause never holds buffered output.
+ */
+template <typename W, typename OutputStream>
+class PacedWriter {
+public:
+    PacedWriter(W& writer_, OutputStream& os_, size_t chunk_,
+                uint64_t pause_)
+        : writer(writer_), os(os_), chunk(chunk_ ? chunk_ : 1),
+          pause(pause_), objects(0) {}
+
+    bool StartObject() {
+        if (++objects % chunk == 0) {
+            os.Flush();
+            if (pause > 0)
+                std::this_thread::sleep_for(std::chrono::microseconds(pause));
+            else
+                std::this_thread::yield();
+        }
+        return writer.StartObject();
+    }
+    bool EndObject(SizeType count = 0) { return writer.EndObject(count); }
+    bool StartArray() { return writer.StartArray(); }
+    bool EndArray(SizeType count = 0) { return writer.EndArray(count); }
+    bool String(const char* str) { return writer.String(str); }
+    bool String(const char* str, SizeType length, bool copy = false) {
+        return writer.String(str, length, copy);
+    }
+    bool Int64(int64_t i) { return writer.Int64(i); }
+    bool Uint64(uint64_t u) { return writer.Uint64(u); }
+    bool Bool(bool b) { return writer.Bool(b); }
+    bool Null() { return writer.Null(); }
+
+private:
+    W& writer;
+    OutputStream& os;
+    size_t chunk;
+    uint64_t pause;
+    size_t objects;
+};
+
+size_t MOSerializer::dumpMODBPaced(FILE* pfile, size_t chunk, uint64_t pause,
+                                   const boost::atomic<bool>* cancel) {
+    const ObjectStore::SnapshotGuard snapshot(*store);
+    Region::obj_set_t roots;
+    getRoots(store, roots);
+
+    char buffer[8192];
+    rapidjson::FileWriteStream ws(pfile, buffer, sizeof(buffer));
+    typedef rapidjson::Writer<rapidjson::FileWriteStream> writer_t;
+    writer_t base(ws);
+    PacedWriter<writer_t, rapidjson::FileWriteStream>
+        writer(base, ws, chunk, pause);
+    StoreClient& client = store->getReadOnlyStoreClient();
+
+    size_t count = 0;
+    writer.StartArray();
+    for (const Region::obj_set_t::value_type& r : roots) {
+        if (cancel && *cancel) break;
+        try {
+            serialize(r.first, r.second, client, writer, true);
+            count += 1;
+        } catch (const std::out_of_range& e) { }
+    }
+    writer.EndArray();
+    ws.Flush();
+    fwrite("\n", 1, 1, pfile);
+    return count;
+}
+
 void MOSerializer::dumpMODB(const std::string& file) {
     FILE* pfile = fopen(file.c_str(), "w");
     if (pfile == NULL) {
@@ -406,23 +1070,102 @@ void MOSerializer::dumpMODB(const std::string& file) {
     LOG(INFO) << "Wrote MODB to " << file;
 }
 
+void MOSerializer::commitParsed(std::vector<ParsedMO>& mos,
+                                StoreClient& client) {
+    for (ParsedMO& mo : mos) {
+        try {
+            deserialize_commit(*mo.ci, mo.uri, mo.oi,
+                mo.hasParentUri ? mo.parentUri.c_str() : NULL,
+                mo.hasParentSubject ? mo.parentSubject.c_str() : NULL,
+                mo.hasParentRelation ? mo.parentRelation.c_str() : NULL,
+                mo.children, client, true, NULL);
+        } catch (const std::out_of_range& e) {
+            LOG(DEBUG) << "Could not deserialize object " << mo.uri;
+        }
+        mo.oi.reset();
+    }
+    std::vector<ParsedMO>().swap(mos);
+}
+
 size_t MOSerializer::readMOs(FILE* pfile, StoreClient& client) {
-    char buffer[1024];
+    // the objects are only staged until the whole file has parsed,
+    // so that a truncated or corrupt file is not loaded in part
+    char buffer[8192];
     rapidjson::FileReadStream f(pfile, buffer, sizeof(buffer));
-    rapidjson::Document d;
-    d.ParseStream<0, rapidjson::UTF8<>, rapidjson::FileReadStream>(f);
-    if (!d.IsArray()) {
-        LOG(ERROR) << "Malformed policy file: not an array";
+    std::vector<ParsedMO> parsed;
+    StreamHandler handler(*this, client, true, false, &parsed);
+    if (!parseMOs(f, handler)) {
+        LOG(ERROR) << "Not loading any of the managed objects read";
         return 0;
     }
-    rapidjson::Value::ConstValueIterator moit;
-    size_t i = 0;
-    for (moit = d.Begin(); moit != d.End(); ++ moit) {
-        const rapidjson::Value& mo = *moit;
-        deserialize(mo, client, true, NULL);
-        i += 1;
+    commitParsed(parsed, client);
+    return handler.getCount();
+}
+
+size_t MOSerializer::readMOs(const std::string& file, StoreClient& client,
+                            size_t threads) {
+    FILE* pfile = fopen(file.c_str(), "r");
+    if (pfile == NULL) {
+        LOG(ERROR) << "Could not open " << file << " for reading";
+        return 0;
     }
-    return i;
+    string buf;
+    if (fseek(pfile, 0, SEEK_END) == 0) {
+        long size = ftell(pfile);
+        if (size > 0) {
+            buf.resize(size);
+            rewind(pfile);
+            buf.resize(fread(&buf[0], 1, buf.size(), pfile));
+        }
+    }
+
+    if (threads == 0) {
+        threads = std::min<size_t>(std::thread::hardware_concurrency(),
+                                   buf.size() / PARALLEL_READ_MIN_CHUNK);
+    }
+    std::vector<std::pair<size_t, size_t> > ranges;
+    if (threads < 2 || !splitArray(buf, threads, ranges)) {
+        // not worth splitting, or not an array the stream parser
+        // should report on
+        buf.clear();
+        rewind(pfile);
+        size_t count = readMOs(pfile, client);
+        fclose(pfile);
+        return count;
+    }
+    fclose(pfile);
+
+    std::vector<std::vector<ParsedMO> > parsed(ranges.size());
+    std::vector<size_t> counts(ranges.size());
+    std::vector<char> ok(ranges.size(), false);
+    std::vector<std::thread> parsers;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        parsers.emplace_back([&, i]() {
+                ChunkStream cs(buf.data() + ranges[i].first,
+                               buf.data() + ranges[i].second);
+                StreamHandler handler(*this, client, true, false,
+                                      &parsed[i]);
+                ok[i] = parseMOs(cs, handler);
+                counts[i] = handler.getCount();
+            });
+    }
+    for (std::thread& t : parsers)
+        t.join();
+    string().swap(buf);
+
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        if (!ok[i]) {
+            LOG(ERROR) << "Not loading any of the managed objects read";
+            return 0;
+        }
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < parsed.size(); ++i) {
+        count += counts[i];
+        commitParsed(parsed[i], client);
+    }
+    return count;
 }
 
 size_t MOSerializer::updateMOs(rapidjson::Document& d, StoreClient& client,
@@ -471,6 +1214,209 @@ size_t MOSerializer::updateMOs(rapidjson::Document& d, StoreClient& client,
     return i;
 }
 
+/**
+ * The class and property lookups for the subjects of one update
+ * from a policy object reader
+ */
+class MOSerializer::SubjectCache {
+public:
+    SubjectCache(ObjectStore& store_) : store(store_) {}
+
+    /**
+     * Get the class for the subject
+     *
+     * @throws std::out_of_range if there is no such class
+     */
+    const ClassInfo& getClass(const string& subject) {
+        auto it = subjects.find(subject);
+        if (it == subjects.end()) {
+            it = subjects.emplace(subject,
+                                  Subject(store.getClassInfo(subject))).first;
+        }
+        return it->second.ci;
+    }
+
+    /**
+     * Get the property of the class with the given name, or NULL if
+     * there is none
+     */
+    const PropertyInfo* getProperty(const ClassInfo& ci, const string& name) {
+        Subject& subject = subjects.at(ci.getName());
+        auto it = subject.props.find(name);
+        if (it == subject.props.end()) {
+            const PropertyInfo* pinfo = NULL;
+            try {
+                pinfo = &ci.getProperty(name);
+            } catch (const std::out_of_range& e) {
+                LOG(DEBUG) << "Unknown property " << name
+                           << " in class " << ci.getName();
+            }
+            it = subject.props.emplace(name, pinfo).first;
+        }
+        return it->second;
+    }
+
+private:
+    struct Subject {
+        Subject(const ClassInfo& ci_) : ci(ci_) {}
+        const ClassInfo& ci;
+        std::unordered_map<string, const PropertyInfo*> props;
+    };
+
+    ObjectStore& store;
+    std::unordered_map<string, Subject> subjects;
+};
+
+void MOSerializer::deserialize_prop(SubjectCache& cache,
+                                    const PropertyInfo& pinfo,
+                                    const gbp::PolicyObjectReader& reader,
+                                    size_t i,
+                                    ObjectInstance& oi) {
+    typedef gbp::PolicyObjectReader R;
+    bool scalar = pinfo.getCardinality() != PropertyInfo::VECTOR;
+    R::prop_type_t type = reader.getPropertyType(i);
+    switch (pinfo.getType()) {
+    case PropertyInfo::STRING:
+        if (type != R::STRING) return;
+        if (scalar)
+            oi.setString(pinfo.getId(), reader.getString(i));
+        else
+            oi.addString(pinfo.getId(), reader.getString(i));
+        break;
+    case PropertyInfo::REFERENCE:
+        {
+            if (type != R::REFERENCE) return;
+            const string& subject = reader.getReferenceSubject(i);
+            try {
+                const ClassInfo& ci = cache.getClass(subject);
+                if (scalar)
+                    oi.setReference(pinfo.getId(), ci.getId(),
+                                    URI(reader.getString(i)));
+                else
+                    oi.addReference(pinfo.getId(), ci.getId(),
+                                    URI(reader.getString(i)));
+            } catch (const std::out_of_range& e) {
+                LOG(DEBUG) << "Could not deserialize reference of unknown class "
+                           << subject;
+            }
+        }
+        break;
+    case PropertyInfo::S64:
+        if (type != R::INT) return;
+        if (scalar)
+            oi.setInt64(pinfo.getId(), reader.getInt(i));
+        else
+            oi.addInt64(pinfo.getId(), reader.getInt(i));
+        break;
+    case PropertyInfo::U64:
+        if (type != R::INT || reader.getInt(i) < 0) return;
+        if (scalar)
+            oi.setUInt64(pinfo.getId(), reader.getInt(i));
+        else
+            oi.addUInt64(pinfo.getId(), reader.getInt(i));
+        break;
+    case PropertyInfo::ENUM8:
+    case PropertyInfo::ENUM16:
+    case PropertyInfo::ENUM32:
+    case PropertyInfo::ENUM64:
+        {
+            if (type != R::STRING) return;
+            const EnumInfo& ei = pinfo.getEnumInfo();
+            try {
+                uint64_t val = ei.getIdByName(reader.getString(i));
+                if (scalar)
+                    oi.setUInt64(pinfo.getId(), val);
+                else
+                    oi.addUInt64(pinfo.getId(), val);
+            } catch (const std::out_of_range& e) {
+                LOG(WARNING) << "No value of type "
+                             << ei.getName()
+                             << " found for name "
+                             << reader.getString(i);
+            }
+        }
+        break;
+    case PropertyInfo::MAC:
+        if (type != R::STRING) return;
+        try {
+            if (scalar)
+                oi.setMAC(pinfo.getId(), MAC(reader.getString(i)));
+            else
+                oi.addMAC(pinfo.getId(), MAC(reader.getString(i)));
+        } catch (const std::invalid_argument& e) {
+            LOG(DEBUG) << "Invalid property "
+                       << pinfo.getName();
+        }
+        break;
+    case PropertyInfo::COMPOSITE:
+        // do nothing;
+        break;
+    }
+}
+
+size_t MOSerializer::updateMOs(gbp::PolicyObjectReader& reader,
+                               StoreClient& client,
+                               PolicyUpdateOp op) {
+    SubjectCache cache(*store);
+    size_t count = 0;
+    bool replaceChildren = (op == PolicyUpdateOp::REPLACE);
+    bool deleteRec = (op == PolicyUpdateOp::DELETE_RECURSIVE);
+    bool remove = deleteRec || op == PolicyUpdateOp::DELETE;
+    std::unordered_set<string> children;
+
+    while (reader.next()) {
+        const string& subject = reader.getSubject();
+        try {
+            const ClassInfo& ci = cache.getClass(subject);
+            URI uri(reader.getURI());
+            if (remove) {
+                if (client.remove(ci.getId(), uri, deleteRec, NULL) && listener)
+                    listener->remoteObjectUpdated(ci.getId(), uri, op);
+                count += 1;
+                continue;
+            }
+
+            std::shared_ptr<ObjectInstance> oi =
+                std::make_shared<ObjectInstance>(ci.getId(), false);
+            size_t nprops = reader.getPropertyCount();
+            for (size_t i = 0; i < nprops; ++i) {
+                const PropertyInfo* pinfo =
+                    cache.getProperty(ci, reader.getPropertyName(i));
+                if (pinfo)
+                    deserialize_prop(cache, *pinfo, reader, i, *oi);
+            }
+
+            children.clear();
+            if (replaceChildren) {
+                size_t nchildren = reader.getChildCount();
+                for (size_t i = 0; i < nchildren; ++i)
+                    children.insert(reader.getChild(i));
+            }
+
+            const string& parentURI = reader.getParentURI();
+            const string& parentSubject = reader.getParentSubject();
+            const string& parentRelation = reader.getParentRelation();
+            bool hasParent = !parentURI.empty() && !parentSubject.empty();
+            deserialize_commit(ci, uri, oi,
+                               hasParent ? parentURI.c_str() : NULL,
+                               hasParent ? parentSubject.c_str() : NULL,
+                               parentRelation.empty()
+                               ? NULL : parentRelation.c_str(),
+                               children, client, replaceChildren, NULL);
+            count += 1;
+        } catch (const std::invalid_argument& e) {
+            // ignore invalid URIs
+            LOG(DEBUG) << "Could not deserialize invalid object of class "
+                       << subject;
+        } catch (const std::out_of_range& e) {
+            // ignore unknown class
+            LOG(DEBUG) << "Could not deserialize object of unknown class "
+                       << subject;
+        }
+    }
+    return count;
+}
+
 #define FORMAT_PROP(gfunc, type, prefixTrunc, output)                   \
     {                                                                   \
         std::ostringstream str;                                         \
@@ -741,6 +1687,13 @@ void MOSerializer::displayMODB(std::ostream& ostream,
     }
 }
 
+void MOSerializer::displayMO(std::ostream& ostream,
+                             modb::class_id_t class_id, const modb::URI& uri,
+                             bool includeProps, bool utf8, size_t truncate) {
+    displayObject(ostream, class_id, uri, false, true, includeProps,
+                  true, "", 0, utf8, truncate);
+}
+
 void MOSerializer::displayUnresolved(std::ostream& ostream, bool tree,
                                      bool utf8) {
     Region::obj_set_t roots;
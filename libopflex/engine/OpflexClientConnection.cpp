@@ -39,7 +39,7 @@ OpflexClientConnection::OpflexClientConnection(HandlerFactory& handlerFactory,
     : OpflexConnection(handlerFactory),
       pool(pool_), hostname(hostname_), port(port_), role(0), peer(NULL),
       started(false), active(false), closing(false), ready(false),
-      failureCount(0), handshake_timer(NULL) {
+      failureCount(0), grantedLease(0), handshake_timer(NULL) {
     opflexStats = std::make_shared<OFAgentStats>();
 }
 
@@ -150,7 +150,14 @@ void OpflexClientConnection::on_state_change(Peer * p, void * data,
                        on_handshake_timer, conn->getHandshakeTimeout(), 0);
 
         if (conn->pool->clientCtx.get())
-            ZeroCopyOpenSSL::attachTransport(p, conn->pool->clientCtx.get());
+            ZeroCopyOpenSSL::attachTransport(p, conn->pool->clientCtx.get(),
+                                             false,
+                                             conn->getRemotePeer().c_str());
+        p->setRttCallback(on_keepalive_rtt);
+        p->setWriteCoalescing(WRITE_COALESCE_LIMIT);
+        p->setWatermarks(conn->getHighWatermark(), conn->getLowWatermark(),
+                         on_watermark);
+        p->setParseOffload(conn->pool->getParseOffload());
         p->startKeepAlive(10000, 15000, conn->getKeepaliveTimeout());
 
         conn->pool->updatePeerStatus(conn->hostname, conn->port,
@@ -166,6 +173,7 @@ void OpflexClientConnection::on_state_change(Peer * p, void * data,
         conn->ready = false;
         conn->handler->disconnected();
         conn->cleanup();
+        conn->clearPendingRequests();
 
         if (!conn->closing)
             conn->pool->updatePeerStatus(conn->hostname, conn->port,
@@ -14,6 +14,8 @@
 #  include <config.h>
 #endif
 
+#include <chrono>
+
 #include "opflex/engine/internal/OpflexConnection.h"
 #include "opflex/engine/internal/OpflexHandler.h"
 
@@ -33,7 +35,10 @@ using yajr::rpc::OutboundError;
 using yajr::transport::ZeroCopyOpenSSL;
 
 OpflexConnection::OpflexConnection(HandlerFactory& handlerFactory)
-    : RpcConnection(), handler(handlerFactory.newHandler(this))
+    : RpcConnection(), handler(handlerFactory.newHandler(this)),
+      highWatermark(DEFAULT_HIGH_WATERMARK),
+      lowWatermark(DEFAULT_LOW_WATERMARK),
+      pendingTimeout(DEFAULT_PENDING_TIMEOUT)
 {
     connect();
 }
@@ -56,6 +61,7 @@ void OpflexConnection::connect() {}
 
 void OpflexConnection::disconnect() {
     cleanup();
+    clearPendingRequests();
 }
 
 void OpflexConnection::close() {
@@ -70,6 +76,74 @@ void OpflexConnection::notifyReady() {
 
 }
 
+static uint64_t now() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now()
+                                       .time_since_epoch()).count();
+}
+
+void OpflexConnection::requestSent(uint64_t xid, const string& method) {
+    const std::lock_guard<std::mutex> lock(pending_mutex);
+    pendingRequests[xid] = std::make_pair(method, now());
+}
+
+void OpflexConnection::responseReceived(uint64_t reqId) {
+    pending_req_t req;
+    {
+        const std::lock_guard<std::mutex> lock(pending_mutex);
+        auto it = pendingRequests.find(reqId);
+        if (it == pendingRequests.end()) return;
+        req = std::move(it->second);
+        pendingRequests.erase(it);
+    }
+    uint64_t ts = now();
+    observeLatency(req.first, ts > req.second ? ts - req.second : 0);
+}
+
+void OpflexConnection::clearPendingRequests() {
+    const std::lock_guard<std::mutex> lock(pending_mutex);
+    pendingRequests.clear();
+}
+
+void OpflexConnection::expirePendingRequests() {
+    size_t expired = 0;
+    {
+        const std::lock_guard<std::mutex> lock(pending_mutex);
+        uint64_t ts = now();
+        auto it = pendingRequests.begin();
+        while (it != pendingRequests.end()) {
+            if (ts - it->second.second > pendingTimeout) {
+                it = pendingRequests.erase(it);
+                expired += 1;
+            } else {
+                ++it;
+            }
+        }
+    }
+    if (expired > 0)
+        LOG(DEBUG) << "[" << getRemotePeer() << "] "
+                   << "Forgot " << expired
+                   << " requests that got no response";
+}
+
+void OpflexConnection::on_keepalive_rtt(yajr::Peer* p, void* data,
+                                        uint64_t rtt) {
+    OpflexConnection* conn = (OpflexConnection*)data;
+    conn->observeRtt(rtt);
+    // the keep-alive timer also bounds the requests waiting for
+    // responses
+    conn->expirePendingRequests();
+}
+
+void OpflexConnection::on_watermark(yajr::Peer* p, void* data,
+                                    bool congested) {
+    OpflexConnection* conn = (OpflexConnection*)data;
+    LOG(INFO) << "[" << conn->getRemotePeer() << "] "
+              << (congested ? "Peer is congested"
+                            : "Peer is no longer congested");
+    conn->congestionChanged(congested);
+}
+
 } /* namespace internal */
 } /* namespace engine */
 } /* namespace opflex */
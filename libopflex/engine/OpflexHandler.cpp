@@ -44,8 +44,9 @@ void OpflexHandler::handleUnexpected(const string& type) {
 
 void OpflexHandler::handleUnsupportedReq(const Value& id,
                                          const string& type) {
-    LOG(WARNING) << "[" << getConnection()->getRemotePeer() << "] "
-                 << "Ignoring unsupported request of type " << type;
+    LOG_RATE_LIMITED_DEFAULT(WARNING)
+        << "[" << getConnection()->getRemotePeer() << "] "
+        << "Ignoring unsupported request of type " << type;
     sendErrorRes(id, "EUNSUPPORTED", "Unsupported request");
 }
 
@@ -64,10 +65,11 @@ void OpflexHandler::handleError(uint64_t reqId,
         if (v.IsString())
             message = v.GetString();
     }
-    LOG(ERROR) << "[" << getConnection()->getRemotePeer() << "] "
-               << "Remote peer returned error with message ("
-               << reqId << "," << type
-               << "): " << code << ": " << message;
+    LOG_RATE_LIMITED_DEFAULT(ERROR)
+        << "[" << getConnection()->getRemotePeer() << "] "
+        << "Remote peer returned error with message ("
+        << reqId << "," << type
+        << "): " << code << ": " << message;
 }
 
 class ErrorRes : public OpflexMessage {
@@ -113,6 +115,22 @@ void OpflexHandler::sendErrorRes(const Value& id,
     getConnection()->sendMessage(new ErrorRes(id, code, message), true);
 }
 
+void OpflexHandler::sendBusyRes(const Value& id) {
+    LOG_RATE_LIMITED_DEFAULT(WARNING)
+        << "[" << getConnection()->getRemotePeer() << "] "
+        << "Refusing request: request rate limit exceeded";
+    getConnection()->sendMessage(new ErrorRes(id, "EBUSY",
+                                              "Request rate limit exceeded"),
+                                 true);
+}
+
+bool OpflexHandler::isBusyErr(const Value& payload) {
+    if (!payload.IsObject() || !payload.HasMember("code"))
+        return false;
+    const Value& v = payload["code"];
+    return v.IsString() && string("EBUSY") == v.GetString();
+}
+
 bool OpflexHandler::requireReadyReq(const Value& id,
                                     const string& method) {
     if (isReady()) return true;
@@ -143,6 +161,8 @@ namespace rpc {
     ((opflex::engine::internal::OpflexConnection*)getPeer()->getData())\
     ->getHandler()->handle##name(getRemoteId(), getPayload())
 #define HANDLE_RES_BASE(name) \
+    ((opflex::engine::internal::OpflexConnection*)getPeer()->getData())\
+    ->responseReceived(getLocalId().id_);                               \
     ((opflex::engine::internal::OpflexConnection*)getPeer()->getData())\
     ->getHandler()->handle##name(getLocalId().id_, getPayload())
 
@@ -152,10 +172,13 @@ namespace rpc {
                                         std::string(#name)))            \
         HANDLE_REQ_BASE(name)
 #define HANDLE_RES(name)                                                \
+    ((opflex::engine::internal::OpflexConnection*)getPeer()->getData())\
+    ->responseReceived(getLocalId().id_);                               \
     if (((opflex::engine::internal::OpflexConnection*)getPeer()->getData()) \
         ->getHandler()->requireReadyRes(getLocalId().id_,               \
                                         std::string(#name)))            \
-        HANDLE_RES_BASE(name)
+        ((opflex::engine::internal::OpflexConnection*)getPeer()->getData())\
+        ->getHandler()->handle##name(getLocalId().id_, getPayload())
 
 template<>
 void InbReq<&yajr::rpc::method::send_identity>::process() const {
@@ -354,5 +377,37 @@ template<>
 void InbErr<&yajr::rpc::method::update>::process() const {
 }
 
+template<>
+void InbRes<&yajr::rpc::method::monitor_cond_since>::process() const {
+    ((opflex::jsonrpc::RpcConnection*)getPeer()->getData())
+            ->handleMonitorCondSince(getLocalId().id_, (rapidjson::Document&)getPayload());
+}
+
+template<>
+void InbReq<&yajr::rpc::method::monitor_cond_since>::process() const {
+    LOG(ERROR) << "received monitor_cond_since req";
+    // unsupported
+}
+
+template<>
+void InbErr<&yajr::rpc::method::monitor_cond_since>::process() const {
+    ((opflex::jsonrpc::RpcConnection*)getPeer()->getData())
+        ->handleMonitorError(getLocalId().id_, (rapidjson::Document&)getPayload());
+}
+
+template<>
+void InbReq<&yajr::rpc::method::update3>::process() const {
+    ((opflex::jsonrpc::RpcConnection*)getPeer()->getData())
+        ->handleUpdate3((rapidjson::Document&)getPayload());
+}
+
+template<>
+void InbRes<&yajr::rpc::method::update3>::process() const {
+}
+
+template<>
+void InbErr<&yajr::rpc::method::update3>::process() const {
+}
+
 } /* namespace rpc */
 } /* namespace yajr */
@@ -35,10 +35,8 @@ OpflexListener::OpflexListener(HandlerFactory& handlerFactory_,
                                const std::string& domain_)
     : handlerFactory(handlerFactory_), port(port_),
       name(name_), domain(domain_), active(true),
-      server_thread(0), listener(nullptr) {
-    server_loop = {};
-    cleanup_async = {};
-    writeq_async = {};
+      listener(nullptr), loopCount(1), nextLoop(0),
+      listenerStopped(false) {
 }
 
 OpflexListener::OpflexListener(HandlerFactory& handlerFactory_,
@@ -47,10 +45,8 @@ OpflexListener::OpflexListener(HandlerFactory& handlerFactory_,
                                const std::string& domain_)
     : handlerFactory(handlerFactory_), socketName(socketName_),
       port(0), name(name_), domain(domain_), active(true),
-      server_thread(0), listener(nullptr) {
-    server_loop = {};
-    cleanup_async = {};
-    writeq_async = {};
+      listener(nullptr), loopCount(1), nextLoop(0),
+      listenerStopped(false) {
 }
 
 OpflexListener::~OpflexListener() {
@@ -72,39 +68,58 @@ void OpflexListener::enableSSL(const std::string& caStorePath,
 }
 
 void OpflexListener::on_cleanup_async(uv_async_t* handle) {
-    OpflexListener* listener = (OpflexListener*)handle->data;
+    ConnLoop* cl = (ConnLoop*)handle->data;
+    OpflexListener* listener = cl->listener;
+
+    // the other loops wait until the listening loop can no longer
+    // hand them connections
+    if (cl != listener->loops[0].get() && !listener->listenerStopped)
+        return;
 
     {
         const std::lock_guard<std::recursive_mutex> lock(listener->conn_mutex);
-        conn_set_t conns(listener->conns);
+        conn_set_t conns;
+        {
+            const std::lock_guard<std::recursive_mutex> guard(cl->conns_mutex);
+            conns = cl->conns;
+        }
         for (OpflexServerConnection* conn : conns) {
             conn->close();
         }
-        if (!listener->conns.empty()) return;
+        const std::lock_guard<std::recursive_mutex> guard(cl->conns_mutex);
+        if (!cl->conns.empty()) return;
     }
 
-    uv_close((uv_handle_t*)&listener->writeq_async, NULL);
+    uv_close((uv_handle_t*)&cl->writeq_async, NULL);
     uv_close((uv_handle_t*)handle, NULL);
-    yajr::finiLoop(&listener->server_loop);
+    yajr::finiLoop(&cl->loop);
 }
 
 void OpflexListener::on_writeq_async(uv_async_t* handle) {
-    OpflexListener* listener = (OpflexListener*)handle->data;
-    const std::lock_guard<std::recursive_mutex> lock(listener->conn_mutex);
-    for (OpflexServerConnection* conn : listener->conns) {
+    ConnLoop* cl = (ConnLoop*)handle->data;
+    const std::lock_guard<std::recursive_mutex> guard(cl->conns_mutex);
+    for (OpflexServerConnection* conn : cl->conns) {
         conn->processWriteQueue();
     }
 }
 
 void OpflexListener::listen() {
     int rc;
-    uv_loop_init(&server_loop);
-    cleanup_async.data = this;
-    writeq_async.data = this;
-    uv_async_init(&server_loop, &cleanup_async, on_cleanup_async);
-    uv_async_init(&server_loop, &writeq_async, on_writeq_async);
-
-    yajr::initLoop(&server_loop);
+    for (size_t i = 0; i < loopCount; ++i) {
+        loops.emplace_back(new ConnLoop(this));
+        ConnLoop& cl = *loops.back();
+        uv_loop_init(&cl.loop);
+        cl.cleanup_async.data = &cl;
+        cl.writeq_async.data = &cl;
+        uv_async_init(&cl.loop, &cl.cleanup_async, on_cleanup_async);
+        uv_async_init(&cl.loop, &cl.writeq_async, on_writeq_async);
+
+        yajr::initLoop(&cl.loop);
+    }
+    // the listening loop also accepts every connection, so hand the
+    // first ones to the other loops
+    nextLoop = 1 % loops.size();
+    uv_loop_t* server_loop = &loops[0]->loop;
 
     if (!socketName.empty()) {
         listener =
@@ -112,7 +127,7 @@ void OpflexListener::listen() {
                                    OpflexServerConnection::on_state_change,
                                    on_new_connection,
                                    this,
-                                   &server_loop,
+                                   server_loop,
                                    OpflexServerConnection::loop_selector);
     } else {
         listener =
@@ -120,29 +135,41 @@ void OpflexListener::listen() {
                                    OpflexServerConnection::on_state_change,
                                    on_new_connection,
                                    this,
-                                   &server_loop,
+                                   server_loop,
                                    OpflexServerConnection::loop_selector);
     }
 
-    rc = uv_thread_create(&server_thread, server_thread_func, this);
-    if (rc < 0) {
-        throw std::runtime_error(string("Could not create server thread: ") +
-                                 uv_strerror(rc));
+    for (std::unique_ptr<ConnLoop>& cl : loops) {
+        rc = uv_thread_create(&cl->thread, server_thread_func, cl.get());
+        if (rc < 0) {
+            throw std::runtime_error(string("Could not create server thread: ") +
+                                     uv_strerror(rc));
+        }
     }
 }
 
 void OpflexListener::disconnect() {
     if (!active) return;
     active = false;
-
-    uv_async_send(&cleanup_async);
-    uv_thread_join(&server_thread);
-    uv_loop_close(&server_loop);
+    if (loops.empty()) return;
+
+    // stop the listening loop first, as it hands new connections to
+    // the others
+    uv_async_send(&loops[0]->cleanup_async);
+    uv_thread_join(&loops[0]->thread);
+    uv_loop_close(&loops[0]->loop);
+    listenerStopped = true;
+
+    for (size_t i = 1; i < loops.size(); ++i) {
+        uv_async_send(&loops[i]->cleanup_async);
+        uv_thread_join(&loops[i]->thread);
+        uv_loop_close(&loops[i]->loop);
+    }
 }
 
-void OpflexListener::server_thread_func(void* listener_) {
-    OpflexListener* processor = (OpflexListener*)listener_;
-    uv_run(&processor->server_loop, UV_RUN_DEFAULT);
+void OpflexListener::server_thread_func(void* loop_) {
+    ConnLoop* cl = (ConnLoop*)loop_;
+    uv_run(&cl->loop, UV_RUN_DEFAULT);
 }
 
 void* OpflexListener::on_new_connection(yajr::Listener* ylistener,
@@ -156,18 +183,39 @@ void* OpflexListener::on_new_connection(yajr::Listener* ylistener,
     OpflexListener* listener = (OpflexListener*)data;
     const std::lock_guard<std::recursive_mutex> lock(listener->conn_mutex);
     boost::unique_lock<boost::mutex> serverConnGuard(serverConnectionMutex);
-    OpflexServerConnection* conn = new OpflexServerConnection(listener);
+    // only the listening loop accepts connections, so it can assign
+    // them to the loops round-robin without further locking
+    size_t index = listener->nextLoop;
+    listener->nextLoop = (index + 1) % listener->loops.size();
+    OpflexServerConnection* conn = new OpflexServerConnection(listener, index);
     listener->conns.insert(conn);
+    listener->conn_ids[conn->getId()] = conn;
+    ConnLoop& cl = *listener->loops[index];
+    const std::lock_guard<std::recursive_mutex> guard(cl.conns_mutex);
+    cl.conns.insert(conn);
     return conn;
 }
 
 void OpflexListener::connectionClosed(OpflexServerConnection* conn) {
     std::unique_lock<std::recursive_mutex> guard(conn_mutex);
+    ConnLoop& cl = *loops[conn->getLoopIndex()];
+    {
+        const std::lock_guard<std::recursive_mutex> lock(cl.conns_mutex);
+        cl.conns.erase(conn);
+    }
     conns.erase(conn);
+    conn_ids.erase(conn->getId());
     delete conn;
     guard.unlock();
     if (!active)
-        uv_async_send(&cleanup_async);
+        uv_async_send(&cl.cleanup_async);
+}
+
+void OpflexListener::connectionReady(OpflexServerConnection* conn) {
+    // a connection handed to its loop during the cleanup of the loop
+    // is only opened afterwards, so it needs another pass
+    if (!active)
+        uv_async_send(&loops[conn->getLoopIndex()]->cleanup_async);
 }
 
 void OpflexListener::getOpflexPeerStats(std::unordered_map<string, std::shared_ptr<OFServerStats>>& stats) {
@@ -179,12 +227,12 @@ void OpflexListener::getOpflexPeerStats(std::unordered_map<string, std::shared_p
 }
 
 void OpflexListener::sendToAll(OpflexMessage* message) {
-    std::unique_ptr<OpflexMessage> messagep(message);
+    std::shared_ptr<jsonrpc::JsonRpcMessage> messagep(message);
     const std::lock_guard<std::recursive_mutex> lock(conn_mutex);
     if (!active) return;
+    // every connection serializes the same message
     for (OpflexServerConnection* conn : conns) {
-        // this is inefficient but we only use this for testing
-        conn->sendMessage(message->clone());
+        conn->sendMessage(messagep);
     }
 }
 
@@ -196,17 +244,69 @@ void OpflexListener::sendToOne(OpflexServerConnection* conn, OpflexMessage* mess
     conn->sendMessage(message->clone());
 }
 
+OpflexListener::SendResult
+OpflexListener::sendIfCurrent(uint64_t connId, uint64_t version,
+                              OpflexMessage* message) {
+    std::unique_ptr<OpflexMessage> messagep(message);
+    // policy updates are queued with conn_mutex held, so no update
+    // can be queued between the check and the send
+    const std::lock_guard<std::recursive_mutex> lock(conn_mutex);
+    if (!active) return NOT_CONNECTED;
+    auto it = conn_ids.find(connId);
+    if (it == conn_ids.end()) return NOT_CONNECTED;
+    if (it->second->getUpdateVersion() > version) return STALE;
+    it->second->sendMessage(messagep.release(), false);
+    return SENT;
+}
+
+void OpflexListener::subscribe(const modb::URI& uri,
+                               OpflexServerConnection* conn) {
+    const std::lock_guard<std::mutex> lock(subscription_mutex);
+    subscriptions[uri].insert(conn);
+}
+
+void OpflexListener::unsubscribe(const modb::URI& uri,
+                                 OpflexServerConnection* conn) {
+    const std::lock_guard<std::mutex> lock(subscription_mutex);
+    auto it = subscriptions.find(uri);
+    if (it == subscriptions.end()) return;
+    it->second.erase(conn);
+    if (it->second.empty())
+        subscriptions.erase(it);
+}
+
+void OpflexListener::getSubscribers(const modb::URI& uri,
+                                    std::unordered_set<OpflexServerConnection*>&
+                                    subscribers) {
+    const std::lock_guard<std::mutex> lock(subscription_mutex);
+    if (subscriptions.empty()) return;
+
+    auto add = [this, &subscribers](const modb::URI& u) {
+        auto it = subscriptions.find(u);
+        if (it != subscriptions.end())
+            subscribers.insert(it->second.begin(), it->second.end());
+    };
+    add(uri);
+    // resolving an object subscribes to its whole subtree, so also
+    // check each ancestor below the root
+    const std::string& str = uri.toString();
+    for (size_t i = 1; i + 1 < str.size(); ++i) {
+        if (str[i] == '/')
+            add(modb::URI(str.substr(0, i + 1)));
+    }
+}
+
 void OpflexListener::addPendingUpdate(opflex::modb::class_id_t class_id,
                                       const opflex::modb::URI& uri,
                                       opflex::gbp::PolicyUpdateOp op) {
     if (!active) return;
     const std::lock_guard<std::recursive_mutex> lock(conn_mutex);
-    for (OpflexServerConnection* conn : conns) {
-        if (conn->getUri(uri))
-            conn->addPendingUpdate(class_id, uri, op);
-        else
-            LOG(DEBUG) << "could not find uri " << uri;
-    }
+    std::unordered_set<OpflexServerConnection*> subscribers;
+    getSubscribers(uri, subscribers);
+    if (subscribers.empty())
+        LOG(DEBUG) << "could not find uri " << uri;
+    for (OpflexServerConnection* conn : subscribers)
+        conn->addPendingUpdate(class_id, uri, op);
 }
 
 void OpflexListener::sendUpdates() {
@@ -234,13 +334,18 @@ bool OpflexListener::applyConnPred(conn_pred_t pred, void* user) {
     return true;
 }
 
-void OpflexListener::messagesReady() {
-    uv_async_send(&writeq_async);
+void OpflexListener::messagesReady(OpflexServerConnection* conn) {
+    uv_async_send(&loops[conn->getLoopIndex()]->writeq_async);
+}
+
+uv_loop_t* OpflexListener::getLoop(OpflexServerConnection* conn) {
+    return &loops[conn->getLoopIndex()]->loop;
 }
 
 bool OpflexListener::isListening() {
     using yajr::comms::internal::Peer;
-    return Peer::LoopData::getPeerCount(&server_loop, Peer::LoopData::LISTENING) != 0;
+    if (loops.empty()) return false;
+    return Peer::LoopData::getPeerCount(&loops[0]->loop, Peer::LoopData::LISTENING) != 0;
 }
 
 boost::mutex OpflexListener::serverConnectionMutex{};
@@ -18,6 +18,7 @@
 #include <string>
 #include <vector>
 #include <utility>
+#include <algorithm>
 
 #include <rapidjson/document.h>
 #include <boost/lexical_cast.hpp>
@@ -29,6 +30,7 @@
 #include "opflex/logging/internal/logging.hpp"
 #include "opflex/engine/internal/MOSerializer.h"
 #include "opflex/engine/internal/OpflexMessage.h"
+#include "opflex/modb/TraceContext.h"
 
 namespace opflex {
 namespace engine {
@@ -57,10 +59,14 @@ public:
                     const string& domain_,
                     const optional<string>& location_,
                     const uint8_t roles_,
-                    const string& mac_)
+                    const string& mac_,
+                    bool compression_,
+                    bool binary_,
+                    uint64_t lease_)
         : OpflexMessage("send_identity", REQUEST),
           name(name_), domain(domain_), location(location_), roles(roles_),
-          mac(mac_) {}
+          mac(mac_), compression(compression_), binary(binary_),
+          lease(lease_) {}
 
     virtual void serializePayload(yajr::rpc::SendHandler& writer) const {
         (*this)(writer);
@@ -105,7 +111,15 @@ public:
             writer.String("features");
             writer.StartArray();
             writer.String("anycastFallback");
+            if (compression)
+                writer.String("compression");
+            if (binary)
+                writer.String("cbor");
             writer.EndArray();
+            if (lease) {
+                writer.String("lease");
+                writer.Uint64(lease);
+            }
             writer.EndObject();
         }
         writer.EndObject();
@@ -120,12 +134,17 @@ private:
     optional<string> location;
     uint8_t roles;
     string mac;
+    bool compression;
+    bool binary;
+    uint64_t lease;
 };
 
 OpflexPEHandler::OpflexPEHandler(OpflexConnection* conn, Processor* processor_)
     : OpflexHandler(conn), processor(processor_) {
     conn->setHandshakeTimeout(processor_->getHandshakeTimeout());
     conn->setKeepaliveTimeout(processor_->getKeepaliveTimeout());
+    conn->setWatermarks(processor_->getHighWatermark(),
+                        processor_->getLowWatermark());
 }
 
 void OpflexPEHandler::connected() {
@@ -137,17 +156,23 @@ void OpflexPEHandler::connected() {
                             pool.getDomain(),
                             pool.getLocation(),
                             OFConstants::POLICY_ELEMENT,
-                            pool.getTunnelMac().toString());
+                            pool.getTunnelMac().toString(),
+                            pool.isCompression(),
+                            pool.isBinaryEncoding(),
+                            getProcessor()->getRequestedLease());
     auto conn = (OpflexClientConnection*)getConnection();
     conn->getOpflexStats()->incrIdentReqs();
     conn->sendMessage(req, true);
 }
 
 void OpflexPEHandler::disconnected() {
+    bool wasReady = getConnection()->isReady();
     setState(DISCONNECTED);
     OpflexPool& pool = getProcessor()->getPool();
     auto conn = (OpflexClientConnection*)getConnection();
     pool.setRoles(conn, 0);
+    if (wasReady)
+        getProcessor()->connectionLost(conn);
 }
 
 void OpflexPEHandler::ready() {
@@ -197,6 +222,9 @@ void OpflexPEHandler::handleSendIdentityRes(uint64_t reqId,
     bool seekingProxies = (pool.getTransportModeState() ==
                            AgentTransportState::SEEKING_PROXIES);
     int proxy_count = 0;
+    bool peerCompression = false;
+    bool peerBinary = false;
+    uint64_t grantedLease = 0;
 
     if (payload.HasMember("your_location")) {
         const Value& ylocation = payload["your_location"];
@@ -239,6 +267,21 @@ void OpflexPEHandler::handleSendIdentityRes(uint64_t reqId,
                     proxy_count++;
                 }
             }
+            Value::ConstMemberIterator fitr = data.FindMember("features");
+            if (fitr != data.MemberEnd() && fitr->value.IsArray()) {
+                Value::ConstValueIterator it;
+                for (it = fitr->value.Begin(); it != fitr->value.End(); ++it) {
+                    if (!it->IsString()) continue;
+                    if (string("compression") == it->GetString())
+                        peerCompression = true;
+                    else if (string("cbor") == it->GetString())
+                        peerBinary = true;
+                }
+            }
+            Value::ConstMemberIterator litr = data.FindMember("lease");
+            if (litr != data.MemberEnd() && litr->value.IsUint64())
+                grantedLease = std::min(litr->value.GetUint64(),
+                                        getProcessor()->getRequestedLease());
         }
     }
     if(isTransportMode && seekingProxies && (proxy_count != 3)) {
@@ -330,6 +373,23 @@ void OpflexPEHandler::handleSendIdentityRes(uint64_t reqId,
         }
         pool.setRoles(conn, peerRoles);
         pool.validatePeerSet(conn,peer_set);
+        if (peerCompression && pool.isCompression() &&
+            conn->getPeer()->enableCompression()) {
+            LOG(INFO) << "[" << conn->getRemotePeer() << "] "
+                      << "Compression enabled";
+        }
+        // after compression, which can't be enabled on a binary stream
+        if (peerBinary && pool.isBinaryEncoding() &&
+            conn->getPeer()->enableBinaryEncoding()) {
+            LOG(INFO) << "[" << conn->getRemotePeer() << "] "
+                      << "Binary encoding enabled";
+        }
+        conn->setGrantedLease(grantedLease);
+        if (grantedLease) {
+            LOG(INFO) << "[" << conn->getRemotePeer() << "] "
+                      << "Endpoint lease of " << grantedLease
+                      << " seconds granted";
+        }
         ready();
     } else {
         pool.validatePeerSet(conn,peer_set);
@@ -353,7 +413,10 @@ void OpflexPEHandler::handlePolicyResolveRes(uint64_t reqId,
                                              const Value& payload) {
     auto conn = (OpflexClientConnection*)getConnection();
     conn->getOpflexStats()->incrPolResolveResps();
-    getProcessor()->responseReceived(reqId);
+    boost::optional<uint64_t> latency =
+        getProcessor()->responseReceived(reqId);
+    if (latency)
+        conn->getOpflexStats()->getPolResolveLatency().observe(latency.get());
     StoreClient* client = getProcessor()->getSystemClient();
     MOSerializer& serializer = getProcessor()->getSerializer();
     StoreClient::notif_t notifs;
@@ -370,7 +433,8 @@ void OpflexPEHandler::handlePolicyResolveRes(uint64_t reqId,
             const Value& mo = *it;
             serializer.deserialize(mo, *client, true, &notifs);
             if (!mo.HasMember("uri")) {
-                LOG(ERROR) << "uri member doesn't exist in the JSON value" ;
+                LOG_RATE_LIMITED_DEFAULT(ERROR)
+                    << "uri member doesn't exist in the JSON value";
             }
             else {
                 const Value& uriv = mo["uri"];
@@ -387,10 +451,13 @@ void OpflexPEHandler::handlePolicyResolveErr(uint64_t reqId,
     auto conn = (OpflexClientConnection*)getConnection();
     conn->getOpflexStats()->incrPolResolveErrs();
     handleError(reqId, payload, "Policy Resolve");
+    if (isBusyErr(payload))
+        getProcessor()->responseBusy();
 }
 
 void OpflexPEHandler::handlePolicyUpdateReq(const rapidjson::Value& id,
                                             const rapidjson::Value& payload) {
+    const modb::TraceContext::Scope trace(modb::TraceContext::clock::now());
     auto conn = (OpflexClientConnection*)getConnection();
     conn->getOpflexStats()->incrPolUpdates();
     StoreClient* client = getProcessor()->getSystemClient();
@@ -506,7 +573,10 @@ void OpflexPEHandler::handleEPDeclareRes(uint64_t reqId,
                                          const rapidjson::Value& payload) {
     auto conn = (OpflexClientConnection*)getConnection();
     conn->getOpflexStats()->incrEpDeclareResps();
-    getProcessor()->responseReceived(reqId);
+    boost::optional<uint64_t> latency =
+        getProcessor()->responseReceived(reqId);
+    if (latency)
+        conn->getOpflexStats()->getEpDeclareLatency().observe(latency.get());
 }
 
 void OpflexPEHandler::handleEPDeclareErr(uint64_t reqId,
@@ -514,6 +584,8 @@ void OpflexPEHandler::handleEPDeclareErr(uint64_t reqId,
     auto conn = (OpflexClientConnection*)getConnection();
     conn->getOpflexStats()->incrEpDeclareErrs();
     handleError(reqId, payload, "Endpoint Declare");
+    if (isBusyErr(payload))
+        getProcessor()->responseBusy();
 }
 
 void OpflexPEHandler::handleEPUndeclareRes(uint64_t reqId,
@@ -528,6 +600,8 @@ void OpflexPEHandler::handleEPUndeclareErr(uint64_t reqId,
     auto conn = (OpflexClientConnection*)getConnection();
     conn->getOpflexStats()->incrEpUndeclareErrs();
     handleError(reqId, payload, "Endpoint Undeclare");
+    if (isBusyErr(payload))
+        getProcessor()->responseBusy();
 }
 
 void OpflexPEHandler::handleEPResolveRes(uint64_t reqId,
@@ -552,6 +626,13 @@ void OpflexPEHandler::handleEPResolveRes(uint64_t reqId,
     client->deliverNotifications(notifs);
 }
 
+void OpflexPEHandler::handleEPResolveErr(uint64_t reqId,
+                                         const rapidjson::Value& payload) {
+    handleError(reqId, payload, "Endpoint Resolve");
+    if (isBusyErr(payload))
+        getProcessor()->responseBusy();
+}
+
 void OpflexPEHandler::handleEPUnresolveRes(uint64_t reqId,
                                            const rapidjson::Value& payload) {
     // nothing to do
@@ -653,6 +734,8 @@ void OpflexPEHandler::handleStateReportErr(uint64_t reqId,
     auto conn = (OpflexClientConnection*)getConnection();
     conn->getOpflexStats()->incrStateReportErrs();
     handleError(reqId, payload, "State Report");
+    if (isBusyErr(payload))
+        getProcessor()->responseBusy();
 }
 
 } /* namespace internal */
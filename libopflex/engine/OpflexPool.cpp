@@ -14,6 +14,7 @@
 #  include <config.h>
 #endif
 
+#include <algorithm>
 #include <memory>
 
 #include "opflex/engine/internal/OpflexPool.h"
@@ -33,7 +34,8 @@ using yajr::transport::ZeroCopyOpenSSL;
 OpflexPool::OpflexPool(HandlerFactory& factory_,
                        util::ThreadManager& threadManager_)
     : factory(factory_), threadManager(threadManager_),
-      active(false),
+      active(false), loadSharing(false), compression(false),
+      binaryEncoding(false), parseOffload(0),
       client_mode(OFConstants::OpflexElementMode::STITCHED_MODE),
       transport_state(OFConstants::OpflexTransportModeState::SEEKING_PROXIES),
       ipv4_proxy(0), ipv6_proxy(0),
@@ -100,7 +102,7 @@ void OpflexPool::enableSSL(const string& caStorePath,
     OpflexConnection::initSSL();
     clientCtx.reset(ZeroCopyOpenSSL::Ctx::createCtx(caStorePath.c_str(),
                 keyAndCertFilePath.c_str(),
-                passphrase.c_str()));
+                passphrase.c_str(), true));
     if (!clientCtx.get())
         throw std::runtime_error("Could not enable SSL");
 
@@ -113,7 +115,8 @@ void OpflexPool::enableSSL(const string& caStorePath,
 void OpflexPool::enableSSL(const string& caStorePath,
                            bool verifyPeers) {
     OpflexConnection::initSSL();
-    clientCtx.reset(ZeroCopyOpenSSL::Ctx::createCtx(caStorePath.c_str()));
+    clientCtx.reset(ZeroCopyOpenSSL::Ctx::createCtx(caStorePath.c_str(),
+                                                    NULL, NULL, true));
     if (!clientCtx.get())
         throw std::runtime_error("Could not enable SSL");
 
@@ -345,6 +348,20 @@ size_t OpflexPool::getRoleCount(ofcore::OFConstants::OpflexRole role) {
     return it->second.conns.size();
 }
 
+uint64_t OpflexPool::getGrantedLease() {
+    const std::lock_guard<std::recursive_mutex> lock(conn_mutex);
+
+    uint64_t lease = 0;
+    for (conn_map_t::value_type& v : connections) {
+        OpflexClientConnection* conn = v.second.conn;
+        if (!conn->isReady()) continue;
+        uint64_t granted = conn->getGrantedLease();
+        if (granted == 0) return 0;
+        if (lease == 0 || granted < lease) lease = granted;
+    }
+    return lease;
+}
+
 
 void OpflexPool::setRoles(OpflexClientConnection* conn,
                           uint8_t newroles) {
@@ -406,7 +423,17 @@ void incrementMsgCounter(OpflexClientConnection* conn, OpflexMessage* msg)
 size_t OpflexPool::sendToRole(OpflexMessage* message,
                            OFConstants::OpflexRole role,
                            bool sync, const std::string& uri) {
-    std::unique_ptr<OpflexMessage> messagep(message);
+    std::vector<std::string> uris;
+    if (!uri.empty())
+        uris.push_back(uri);
+    return sendToRole(message, role, sync, uris);
+}
+
+size_t OpflexPool::sendToRole(OpflexMessage* message,
+                           OFConstants::OpflexRole role,
+                           bool sync, const std::vector<std::string>& uris,
+                           bool skipCongested) {
+    std::shared_ptr<jsonrpc::JsonRpcMessage> messagep(message);
     if (!active) return 0;
     std::vector<OpflexClientConnection*> conns;
 
@@ -416,30 +443,98 @@ size_t OpflexPool::sendToRole(OpflexMessage* message,
         return 0;
 
     size_t i = 0;
-    OpflexMessage* m_copy = NULL;
+    size_t congested = 0;
     std::vector<OpflexClientConnection*> ready;
     for (OpflexClientConnection* conn : it->second.conns) {
         if (!conn->isReady()) continue;
+        if (skipCongested && conn->isCongested()) {
+            congested += 1;
+            continue;
+        }
         ready.push_back(conn);
     }
+    // the message is shared by all of the connections rather than
+    // cloned for each of them
     for (OpflexClientConnection* conn : ready) {
-        if (i < (ready.size() - 1)) {
-            m_copy = message->clone();
-        } else {
-            m_copy = message;
-            messagep.release();
-        }
-        incrementMsgCounter(conn, m_copy);
-        conn->sendMessage(m_copy, sync);
-        if (message->getMethod() == "policy_resolve" && !uri.empty()) {
-           addPendingItem(conn, uri);
+        incrementMsgCounter(conn, message);
+        conn->sendMessage(messagep, sync);
+        if (message->getMethod() == "policy_resolve") {
+            for (const std::string& uri : uris)
+                addPendingItem(conn, uri);
         }
         i += 1;
     }
-    // all allocated buffers should have been dispatched to
-    // connections
+    return i + congested;
+}
 
-    return i;
+void OpflexPool::assignPeers(OFConstants::OpflexRole role,
+                             const std::vector<std::string>& uris,
+                             /* out */ std::vector<peer_name_t>& peers,
+                             const peer_name_t* extra) {
+    peers.clear();
+    std::vector<peer_name_t> ready;
+    {
+        const std::lock_guard<std::recursive_mutex> lock(conn_mutex);
+        auto it = roles.find(role);
+        if (it != roles.end()) {
+            for (OpflexClientConnection* conn : it->second.conns) {
+                if (conn->isReady())
+                    ready.emplace_back(conn->getHostname(), conn->getPort());
+            }
+        }
+    }
+    if (extra &&
+        std::find(ready.begin(), ready.end(), *extra) == ready.end())
+        ready.push_back(*extra);
+    if (ready.empty())
+        return;
+
+    // each subject goes to the peer with the highest hash of the
+    // peer name and the URI
+    std::vector<std::string> names;
+    for (const peer_name_t& p : ready)
+        names.push_back(p.first + ":" + std::to_string(p.second) + "/");
+    std::hash<std::string> hasher;
+    peers.reserve(uris.size());
+    for (const std::string& uri : uris) {
+        size_t best = 0;
+        size_t bestHash = 0;
+        for (size_t i = 0; i < ready.size(); ++i) {
+            size_t h = hasher(names[i] + uri);
+            if (i == 0 || h > bestHash) {
+                best = i;
+                bestHash = h;
+            }
+        }
+        peers.push_back(ready[best]);
+    }
+}
+
+size_t OpflexPool::sendToPeer(OpflexMessage* message, const peer_name_t& peer,
+                              OFConstants::OpflexRole role,
+                              bool sync, const std::vector<std::string>& uris,
+                              bool skipCongested) {
+    std::unique_ptr<OpflexMessage> messagep(message);
+    if (!active) return 0;
+
+    const std::lock_guard<std::recursive_mutex> lock(conn_mutex);
+    auto it = connections.find(peer);
+    if (it == connections.end() || !(it->second.roles & role))
+        return 0;
+    OpflexClientConnection* conn = it->second.conn;
+    if (!conn->isReady())
+        return 0;
+    if (skipCongested && conn->isCongested())
+        return 1;
+
+    bool resolve = message->getMethod() == "policy_resolve";
+    incrementMsgCounter(conn, message);
+    conn->sendMessage(messagep.release(), sync);
+    if (resolve) {
+        for (const std::string& uri : uris)
+            addPendingItem(conn, uri);
+    }
+    return 1;
 }
 
 void OpflexPool::validatePeerSet(OpflexClientConnection * conn, const peer_name_set_t& peers) {
@@ -16,7 +16,10 @@
 
 #include <openssl/err.h>
 #include <sys/un.h>
+#include <algorithm>
 #include <iostream>
+#include <unordered_set>
+#include <boost/atomic.hpp>
 #include <boost/filesystem.hpp>
 
 #include "opflex/engine/internal/OpflexServerConnection.h"
@@ -32,9 +35,13 @@ using std::string;
 using yajr::transport::ZeroCopyOpenSSL;
 using opflex::gbp::PolicyUpdateOp;
 
-OpflexServerConnection::OpflexServerConnection(OpflexListener* listener_)
+static boost::atomic<uint64_t> next_conn_id(0);
+
+OpflexServerConnection::OpflexServerConnection(OpflexListener* listener_,
+                                               size_t loopIndex_)
     : OpflexConnection(listener_->handlerFactory),
-      listener(listener_), peer(NULL) {
+      listener(listener_), loopIndex(loopIndex_), id(++next_conn_id),
+      update_version(0), peer(NULL) {
 
       opflexStats = std::make_shared<OFServerStats>();
       uv_loop_init(&server_loop);
@@ -52,6 +59,11 @@ OpflexServerConnection::OpflexServerConnection(OpflexListener* listener_)
 }
 
 OpflexServerConnection::~OpflexServerConnection() {
+      {
+          std::lock_guard<std::mutex> lock(uri_map_mutex);
+          for (const auto& u : uri_map)
+              listener->unsubscribe(u.first, this);
+      }
       uv_async_send(&cleanup_async);
       uv_thread_join(&server_thread);
       uv_loop_close(&server_loop);
@@ -99,7 +111,7 @@ const std::string& OpflexServerConnection::getDomain() {
 
 uv_loop_t* OpflexServerConnection::loop_selector(void * data) {
     OpflexServerConnection* conn = (OpflexServerConnection*)data;
-    return conn->getListener()->getLoop();
+    return conn->getListener()->getLoop(conn);
 }
 
 void OpflexServerConnection::on_state_change(yajr::Peer * p, void * data,
@@ -118,9 +130,14 @@ void OpflexServerConnection::on_state_change(yajr::Peer * p, void * data,
             ZeroCopyOpenSSL::Ctx* serverCtx = conn->listener->serverCtx.get();
             if (serverCtx)
                 ZeroCopyOpenSSL::attachTransport(p, serverCtx);
+            p->setRttCallback(on_keepalive_rtt);
+            p->setWriteCoalescing(WRITE_COALESCE_LIMIT);
+            p->setWatermarks(conn->getHighWatermark(), conn->getLowWatermark(),
+                             on_watermark);
             p->startKeepAlive(10000, 15000, 120000);
 
             conn->handler->connected();
+            conn->listener->connectionReady(conn);
         }
         break;
     case yajr::StateChange::DISCONNECT:
@@ -156,7 +173,7 @@ void OpflexServerConnection::disconnect() {
 }
 
 void OpflexServerConnection::messagesReady() {
-    listener->messagesReady();
+    listener->messagesReady(this);
 }
 
 void OpflexServerConnection::addUri(const opflex::modb::URI& uri,
@@ -165,6 +182,7 @@ void OpflexServerConnection::addUri(const opflex::modb::URI& uri,
     std::lock_guard<std::mutex> lock(uri_map_mutex);
 
     uri_map[uri] = lifetime;
+    listener->subscribe(uri, this);
 }
 
 bool OpflexServerConnection::getUri(const opflex::modb::URI& uri) {
@@ -200,7 +218,9 @@ bool OpflexServerConnection::clearUri(const opflex::modb::URI& uri) {
     LOG(DEBUG) << "AGENT->SERVER CLEAR " << uri;
     std::lock_guard<std::mutex> lock(uri_map_mutex);
 
-    return (0 != uri_map.erase(uri));
+    if (0 == uri_map.erase(uri)) return false;
+    listener->unsubscribe(uri, this);
+    return true;
 }
 
 void OpflexServerConnection::addPendingUpdate(opflex::modb::class_id_t class_id,
@@ -223,6 +243,22 @@ void OpflexServerConnection::addPendingUpdate(opflex::modb::class_id_t class_id,
     }
 }
 
+void OpflexServerConnection::dedupe(std::vector<modb::reference_t>& refs) {
+    std::unordered_set<modb::reference_t> seen;
+    auto end = std::remove_if(refs.begin(), refs.end(),
+                              [&seen](const modb::reference_t& ref) {
+                                  return !seen.insert(ref).second;
+                              });
+    refs.erase(end, refs.end());
+}
+
+void OpflexServerConnection::congestionChanged(bool congested) {
+    OpflexConnection::congestionChanged(congested);
+    // send whatever was held back while the agent was congested
+    if (!congested)
+        sendUpdates();
+}
+
 void OpflexServerConnection::sendUpdates() {
     uv_async_send(&policy_update_async);
 }
@@ -244,6 +280,20 @@ void OpflexServerConnection::on_policy_update_async(uv_async_t* handle) {
     if (conn->replace.empty() && conn->merge.empty() && conn->deleted.empty())
         return;
 
+    // hold the updates back until the agent catches up.  Only the
+    // latest state of each object is sent, so the pending updates
+    // need to be kept no larger than the set of objects involved.
+    if (conn->isCongested()) {
+        dedupe(conn->replace);
+        dedupe(conn->merge);
+        dedupe(conn->deleted);
+        return;
+    }
+
+    // the update reads the live store, so it reflects at least the
+    // current version.  Responses serialized from an older snapshot
+    // must not be queued after it.
+    conn->update_version = server->getStore().getVersion();
     server->policyUpdate(conn, conn->replace, conn->merge, conn->deleted);
 
     conn->replace.clear();
@@ -264,9 +314,10 @@ void OpflexServerConnection::on_prr_timer_async(uv_async_t* handle) {
     auto it = conn->uri_map.begin();
     while (it != conn->uri_map.end()) {
         it->second -= server->getPrrIntervalSecs();
-        if (it->second <= 0)
+        if (it->second <= 0) {
+            conn->listener->unsubscribe(it->first, conn);
             it = conn->uri_map.erase(it);
-        else
+        } else
             it++;
     }
 }
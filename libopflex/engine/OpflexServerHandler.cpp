@@ -16,6 +16,8 @@
 
 
 #include <sstream>
+#include <algorithm>
+#include <chrono>
 
 #include <boost/optional.hpp>
 
@@ -35,6 +37,38 @@ using modb::mointernal::StoreClient;
 using ofcore::OFConstants;
 using test::GbpOpflexServer;
 
+// the longest endpoint lease granted to a client, in seconds
+static const uint64_t MAX_ENDPOINT_LEASE = 24*3600;
+
+// the number of seconds of requests an agent may send at once
+static const double REQUEST_BURST_SECS = 10;
+
+OpflexServerHandler::OpflexServerHandler(OpflexConnection* conn,
+                                         GbpOpflexServerImpl* server_)
+    : OpflexHandler(conn), server(server_), flakyMode(false) {
+    for (size_t kind = 0; kind < REQUEST_KINDS; ++kind) {
+        double rate = server->getRequestLimit(kind);
+        limits[kind] = TokenBucket(rate, rate * REQUEST_BURST_SECS);
+    }
+}
+
+bool OpflexServerHandler::admit(const Value& id, const Value& payload,
+                                request_kind_t kind) {
+    TokenBucket& limit = limits[kind];
+    if (limit.getRate() <= 0) return true;
+
+    using namespace std::chrono;
+    uint64_t now = duration_cast<milliseconds>
+        (steady_clock::now().time_since_epoch()).count();
+    size_t cost = payload.IsArray() ? std::max<size_t>(1, payload.Size()) : 1;
+    if (limit.take(cost, now)) return true;
+
+    // refuse the request before doing any work for it, so that an
+    // agent that storms the server cannot hold up the others
+    sendBusyRes(id);
+    return false;
+}
+
 void OpflexServerHandler::connected() {
 
 }
@@ -58,10 +92,14 @@ public:
                     const optional<std::string>& your_location_,
                     const uint8_t roles_,
                     const test::GbpOpflexServer::peer_vec_t& peers_,
-                    const std::vector<std::string>& proxies_)
+                    const std::vector<std::string>& proxies_,
+                    bool compression_,
+                    bool binary_,
+                    uint64_t lease_)
         : OpflexMessage("send_identity", RESPONSE, &id),
           name(name_), domain(domain_), your_location(your_location_),
-          roles(roles_), peers(peers_), proxies(proxies_) {}
+          roles(roles_), peers(peers_), proxies(proxies_),
+          compression(compression_), binary(binary_), lease(lease_) {}
 
     virtual void serializePayload(yajr::rpc::SendHandler& writer) const {
         (*this)(writer);
@@ -77,9 +115,12 @@ public:
         writer.String(name.c_str());
         writer.String("domain");
         writer.String(domain.c_str());
-        if (your_location || !proxies.empty()) {
-            writer.String("your_location");
-            writer.String(your_location.get().c_str());
+        if (your_location || !proxies.empty() || compression || binary ||
+            lease) {
+            if (your_location) {
+                writer.String("your_location");
+                writer.String(your_location.get().c_str());
+            }
             writer.String("data");
             writer.StartObject();
             int i = 0;
@@ -98,6 +139,19 @@ public:
                 writer.String(proxy.c_str());
                 i++;
             }
+            if (compression || binary) {
+                writer.String("features");
+                writer.StartArray();
+                if (compression)
+                    writer.String("compression");
+                if (binary)
+                    writer.String("cbor");
+                writer.EndArray();
+            }
+            if (lease) {
+                writer.String("lease");
+                writer.Uint64(lease);
+            }
             writer.EndObject();
         }
         writer.String("my_role");
@@ -142,6 +196,9 @@ private:
     uint8_t roles;
     test::GbpOpflexServer::peer_vec_t peers;
     std::vector<std::string> proxies;
+    bool compression;
+    bool binary;
+    uint64_t lease;
 };
 
 class PolicyResolveRes : public OpflexMessage {
@@ -162,17 +219,14 @@ public:
     }
 
     virtual bool operator()(yajr::rpc::SendHandler& writer) const {
-        MOSerializer& serializer = server.getSerializer();
-        modb::mointernal::StoreClient* client = server.getSystemClient();
-
         writer.StartObject();
         writer.String("policy");
         writer.StartArray();
         for (const modb::reference_t& p : mos) {
             try {
-                serializer.serialize(p.first, p.second,
-                                     *client, writer,
-                                     true);
+                // many peers resolve the same policy, so reuse the
+                // serialized subtree where possible
+                writer.Prepared(*server.getSerialized(p.first, p.second));
             } catch (const std::out_of_range& e) {
                 // policy doesn't exist locally
             }
@@ -238,6 +292,32 @@ void OpflexServerHandler::handleSendIdentityReq(const rapidjson::Value& id,
 
     LOG(DEBUG) << "Got send_identity req from " << conn->getRemotePeer();
     conn->getOpflexStats()->incrIdentReqs();
+    // accept compression and binary encoding if the client offers them
+    bool compression = false;
+    bool binary = false;
+    uint64_t lease = 0;
+    if (payload.IsArray() && payload.Size() > 0 && payload[0].IsObject() &&
+        payload[0].HasMember("data")) {
+        const Value& data = payload[0]["data"];
+        if (data.IsObject() && data.HasMember("features") &&
+            data["features"].IsArray()) {
+            const Value& features = data["features"];
+            Value::ConstValueIterator it;
+            for (it = features.Begin(); it != features.End(); ++it) {
+                if (!it->IsString()) continue;
+                if (std::string("compression") == it->GetString())
+                    compression = true;
+                else if (std::string("cbor") == it->GetString())
+                    binary = true;
+            }
+        }
+        // grant the endpoint lease the client asks for, up to a limit
+        if (data.IsObject() && data.HasMember("lease") &&
+            data["lease"].IsUint64()) {
+            lease = std::min(data["lease"].GetUint64(), MAX_ENDPOINT_LEASE);
+        }
+    }
+
     std::stringstream sb;
     sb << "127.0.0.1:" << server->getPort();
     SendIdentityRes* res =
@@ -245,8 +325,15 @@ void OpflexServerHandler::handleSendIdentityReq(const rapidjson::Value& id,
                             std::string("location_string"),
                             server->getRoles(),
                             server->getPeers(),
-                            server->getProxies());
+                            server->getProxies(),
+                            compression, binary, lease);
     conn->sendMessage(res, true);
+    // the response itself goes out uncompressed and as JSON.
+    // Compression can't be enabled on a binary stream, so it goes first.
+    if (compression)
+        conn->getPeer()->enableCompression();
+    if (binary)
+        conn->getPeer()->enableBinaryEncoding();
     ready();
 }
 
@@ -258,6 +345,10 @@ void OpflexServerHandler::handlePolicyResolveReq(const rapidjson::Value& id,
 
     LOG(DEBUG) << "Got policy_resolve req from " << conn->getRemotePeer();
     conn->getOpflexStats()->incrPolResolves();
+    if (!admit(id, payload, RESOLVE)) {
+        conn->getOpflexStats()->incrPolResolveErrs();
+        return;
+    }
 
     bool found = true;
     Value::ConstValueIterator it;
@@ -350,7 +441,7 @@ void OpflexServerHandler::handlePolicyResolveReq(const rapidjson::Value& id,
 
     PolicyResolveRes* res =
         new PolicyResolveRes(id, *server, mos);
-    getConnection()->sendMessage(res, true);
+    server->sendResponse(conn, id, res);
 }
 
 void OpflexServerHandler::handlePolicyUnresolveReq(const rapidjson::Value& id,
@@ -432,6 +523,11 @@ void OpflexServerHandler::handleEPDeclareReq(const rapidjson::Value& id,
 
     LOG(DEBUG) << "Got endpoint_declare req from " << conn->getRemotePeer();
     conn->getOpflexStats()->incrEpDeclares();
+    if (!admit(id, payload, DECLARE)) {
+        conn->getOpflexStats()->incrEpDeclareErrs();
+        return;
+    }
+    boost::unique_lock<boost::shared_mutex> guard(server->getPolicyMutex());
     StoreClient::notif_t notifs;
     StoreClient& client = *server->getSystemClient();
     MOSerializer& serializer = server->getSerializer();
@@ -507,6 +603,11 @@ void OpflexServerHandler::handleEPUndeclareReq(const rapidjson::Value& id,
 
     LOG(DEBUG) << "Got endpoint_unndeclare req from " << conn->getRemotePeer();
     conn->getOpflexStats()->incrEpUndeclares();
+    if (!admit(id, payload, DECLARE)) {
+        conn->getOpflexStats()->incrEpUndeclareErrs();
+        return;
+    }
+    boost::unique_lock<boost::shared_mutex> guard(server->getPolicyMutex());
     StoreClient::notif_t notifs;
     StoreClient& client = *server->getSystemClient();
 
@@ -573,6 +674,10 @@ void OpflexServerHandler::handleEPResolveReq(const rapidjson::Value& id,
 
     LOG(DEBUG) << "Got endpoint_resolve req from " << conn->getRemotePeer();
     conn->getOpflexStats()->incrEpResolves();
+    if (!admit(id, payload, RESOLVE)) {
+        conn->getOpflexStats()->incrEpResolveErrs();
+        return;
+    }
     Value::ConstValueIterator it;
     std::vector<modb::reference_t> mos;
     for (it = payload.Begin(); it != payload.End(); ++it) {
@@ -634,7 +739,7 @@ void OpflexServerHandler::handleEPResolveReq(const rapidjson::Value& id,
 
     EndpointResolveRes* res =
         new EndpointResolveRes(id, *server, mos);
-    conn->sendMessage(res, true);
+    server->sendResponse(conn, id, res);
 }
 
 void OpflexServerHandler::handleEPUnresolveReq(const rapidjson::Value& id,
@@ -720,6 +825,11 @@ void OpflexServerHandler::handleStateReportReq(const rapidjson::Value& id,
 
     LOG(DEBUG) << "Got state_report req from " << conn->getRemotePeer();
     conn->getOpflexStats()->incrStateReports();
+    if (!admit(id, payload, STATE_REPORT)) {
+        conn->getOpflexStats()->incrStateReportErrs();
+        return;
+    }
+    boost::unique_lock<boost::shared_mutex> guard(server->getPolicyMutex());
     StoreClient::notif_t notifs;
     StoreClient& client = *server->getSystemClient();
     MOSerializer& serializer = server->getSerializer();
@@ -752,6 +862,21 @@ void OpflexServerHandler::handleStateReportReq(const rapidjson::Value& id,
             serializer.deserialize(mo, client, true, &notifs);
         }
     }
+    if (flakyMode) {
+        bool shouldFlake = false;
+        for (const StoreClient::notif_t::value_type& v : notifs) {
+            modb::reference_t r(v.second, v.first);
+            if (declarations.find(r) == declarations.end()) {
+                client.remove(v.second, v.first, false, NULL);
+                declarations.insert(r);
+                shouldFlake = true;
+            }
+        }
+        if (shouldFlake) {
+            LOG(INFO) << "Flaking out";
+            return;
+        }
+    }
     client.deliverNotifications(notifs);
 
     OpflexMessage* res =
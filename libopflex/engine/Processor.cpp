@@ -15,13 +15,21 @@
 #endif
 
 
+#include <cstdio>
 #include <ctime>
 #include <uv.h>
 #include <limits>
 #include <cmath>
 #include <random>
+#include <algorithm>
 
 #include <boost/tuple/tuple.hpp>
+#include <rapidjson/document.h>
+#include <rapidjson/filereadstream.h>
+#include <rapidjson/filewritestream.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
 #include "opflex/engine/internal/OpflexPEHandler.h"
 #include "opflex/engine/internal/ProcessorMessage.h"
 #include "opflex/engine/Processor.h"
@@ -51,10 +59,42 @@ using namespace internal;
 static const uint64_t DEFAULT_PROC_DELAY = 250;
 static const uint64_t DEFAULT_RETRY_DELAY = 1000*60*2;
 static const uint64_t FIRST_XID = (uint64_t)1 << 63;
-static const uint32_t MAX_PROCESS = 1024;
+// time budget for processing items in one slice of the processing
+// loop, in nanoseconds.  The loop is given back between slices so
+// that connection handshakes and keepalives are not starved under a
+// large backlog.
+static const uint64_t PROCESS_SLICE_NS = 20*1000*1000;
+// a retry is not attempted before this many times the response
+// latency from the peers
+static const uint64_t RETRY_LATENCY_FACTOR = 4;
+// relative share of the processing loop for each priority class
+static const size_t PRIORITY_WEIGHTS[] = { 8, 4, 1 };
+// limits on the subjects coalesced into a single request
+static const size_t MAX_BATCH_SUBJECTS = 256;
+static const size_t MAX_BATCH_BYTES = 64*1024;
+// estimated size of a subject in a request beyond its URI
+static const size_t BATCH_SUBJECT_OVERHEAD = 64;
+// time that unreferenced objects loaded from the policy cache are
+// kept after the processor starts
+static const uint64_t POLICY_CACHE_HOLD = 60*1000;
+// maximum garbage collection candidates checked in one slice of the
+// processing loop
+static const size_t GC_SLICE_ITEMS = 256;
 
 std::random_device rd;
-std::mt19937 gen(rd());
+
+Processor::Shard::Shard(Processor* processor_, size_t index)
+    : processor(processor_),
+      taskName(index == 0 ? "processor"
+               : "processor_" + std::to_string(index)),
+      classes(std::vector<size_t>(PRIORITY_WEIGHTS,
+                                  PRIORITY_WEIGHTS + PRIORITY_CLASSES)),
+      resync_all(false), gen(rd()), proc_loop(nullptr) {
+    cleanup_async = {};
+    proc_async = {};
+    connect_async = {};
+    proc_timer = {};
+}
 
 Processor::Processor(ObjectStore* store_, ThreadManager& threadManager_)
     : AbstractObjectListener(store_),
@@ -63,14 +103,13 @@ Processor::Processor(ObjectStore* store_, ThreadManager& threadManager_)
       threadManager(threadManager_),
       pool(*this, threadManager_), nextXid(FIRST_XID),
       reportObservables(true),
+      reportBudget(0), reportTokens(0), reportTokenTime(0),
+      policyCacheInterval(0), cache_seq(0), cache_write_pending(false),
+      cache_written_seq(0), cache_timer_active(false),
       processingDelay(DEFAULT_PROC_DELAY),
       retryDelay(DEFAULT_RETRY_DELAY),
-      proc_loop(nullptr),
       proc_active(false) {
-    cleanup_async = {};
-    proc_async = {};
-    connect_async = {};
-    proc_timer = {};
+    shards.emplace_back(new Shard(this, 0));
 }
 
 Processor::~Processor() {
@@ -100,64 +139,176 @@ void Processor::setPrrTimerDuration(uint64_t duration) {
     prrTimerDuration = duration;
     policyRefTimerDuration = 1000*prrTimerDuration/2;
 }
-// check whether the object state index has work for us
-bool Processor::hasWork(/* out */ obj_state_by_exp::iterator& it) {
-    if (obj_state.empty()) return false;
-    obj_state_by_exp& exp_index = obj_state.get<expiration_tag>();
-    it = exp_index.begin();
-    if (it->expiration == 0 || now(proc_loop) >= it->expiration) return true;
-    return false;
+
+void Processor::setProcessingThreads(size_t threads) {
+    if (threads == 0)
+        throw std::invalid_argument("At least one processing "
+                                    "thread is required");
+    if (proc_active)
+        throw std::logic_error("Cannot change processing threads "
+                               "after the processor is started");
+
+    shards.clear();
+    for (size_t i = 0; i < threads; ++i)
+        shards.emplace_back(new Shard(this, i));
 }
 
-// add a reference if it doesn't already exist
-void Processor::addRef(obj_state_by_exp::iterator& it,
-                       const reference_t& up) {
-    if (it->details->urirefs.find(up) == it->details->urirefs.end()) {
-        obj_state_by_uri& uri_index = obj_state.get<uri_tag>();
-        obj_state_by_uri::iterator uit = uri_index.find(up.second);
+Processor::Shard& Processor::getShard(const URI& uri) {
+    return *shards[std::hash<URI>()(uri) % shards.size()];
+}
 
-        if (uit == uri_index.end()) {
-            LOG(DEBUG) << "Tracking new nonlocal item " << up.second << " from reference";
-            obj_state.insert(item(up.second, up.first,
-                                  0, policyRefTimerDuration,
-                                  UNRESOLVED, false));
-            uit = uri_index.find(up.second);
-        }
-        uit->details->refcount += 1;
-        LOG(DEBUG) << "addref " << uit->uri.toString()
-                   << " (from " << it->uri.toString() << ")"
-                   << " " << uit->details->refcount
-                   << " state " << ItemStateMap[uit->details->state];
+// get the priority class used to schedule an item
+Processor::priority_t Processor::getPriority(const item& i) {
+    switch (store->getClassInfo(i.details->class_id).getType()) {
+    case ClassInfo::POLICY:
+        return PRIORITY_POLICY;
+    case ClassInfo::LOCAL_ENDPOINT:
+    case ClassInfo::REMOTE_ENDPOINT:
+        return PRIORITY_ENDPOINT;
+    default:
+        return PRIORITY_BACKGROUND;
+    }
+}
 
+// check whether there is an expired item for us.  Expired items are
+// moved from the timer wheel to the ready queue for their priority
+// class, and the queues are served by weighted round robin.  Entries
+// left behind when an item was removed or rescheduled are skipped.
+bool Processor::hasWork(Shard& s,
+                        /* out */ obj_state_by_uri::iterator& it) {
+    obj_state_by_uri& uri_index = s.obj_state.get<uri_tag>();
+    uint64_t curTime = now(s.proc_loop);
+    URI uri(URI::ROOT);
+    uint64_t exp;
+    while (s.wheel.pop(curTime, uri, exp)) {
+        it = uri_index.find(uri);
+        if (it != uri_index.end() && it->expiration == exp)
+            s.ready[getPriority(*it)].push_back({uri, exp});
+    }
+
+    int p = s.classes.next([&](size_t c) {
+            // drop the entries of items removed or rescheduled since
+            std::deque<ready_item>& queue = s.ready[c];
+            while (!queue.empty()) {
+                const ready_item& r = queue.front();
+                it = uri_index.find(r.uri);
+                if (it != uri_index.end() && it->expiration == r.expiration)
+                    return true;
+                queue.pop_front();
+            }
+            return false;
+        });
+    if (p < 0) return false;
+    s.ready[p].pop_front();
+    return true;
+}
+
+// update the expiration of an item and schedule it in the timer
+// wheel.  An item that never expires is not scheduled.
+void Processor::setExpiration(Shard& s, obj_state_by_uri::iterator& it,
+                              uint64_t expiration) {
+    s.obj_state.get<uri_tag>().modify(it, change_expiration(expiration));
+    if (expiration != std::numeric_limits<uint64_t>::max())
+        s.wheel.schedule(it->uri, expiration);
+}
+
+// add a reference if it doesn't already exist.  References to items
+// in other shards are deferred until the shard lock is released.
+void Processor::addRef(Shard& s, obj_state_by_uri::iterator& it,
+                       const reference_t& up,
+                       /* out */ ref_updates_t& deferred) {
+    if (it->details->urirefs.find(up) == it->details->urirefs.end()) {
+        if (&getShard(up.second) == &s)
+            incRef(s, up, it->uri);
+        else
+            deferred.push_back({up, true});
         it->details->urirefs.insert(up);
     }
 }
 
-// remove a reference if it already exists.  If refcount is zero,
-// schedule the reference for collection
-void Processor::removeRef(obj_state_by_exp::iterator& it,
-                          const reference_t& up) {
+// remove a reference if it already exists.  References to items in
+// other shards are deferred until the shard lock is released.
+void Processor::removeRef(Shard& s, obj_state_by_uri::iterator& it,
+                          const reference_t& up,
+                          /* out */ ref_updates_t& deferred) {
     if (it->details->urirefs.find(up) != it->details->urirefs.end()) {
-        obj_state_by_uri& uri_index = obj_state.get<uri_tag>();
-        obj_state_by_uri::iterator uit = uri_index.find(up.second);
-        if (uit != uri_index.end()) {
-            uit->details->refcount -= 1;
-            LOG(DEBUG) << "removeref " << uit->uri.toString()
-                       << " (from " << it->uri.toString() << ")"
-                       << " " << uit->details->refcount
-                       << " state " << ItemStateMap[uit->details->state];
-            if (uit->details->refcount <= 0) {
-                uint64_t nexp = now(proc_loop)+processingDelay;
-                uri_index.modify(uit, Processor::change_expiration(nexp));
-            }
-        }
+        if (&getShard(up.second) == &s)
+            decRef(s, up, it->uri, now(s.proc_loop));
+        else
+            deferred.push_back({up, false});
         it->details->urirefs.erase(up);
     }
 }
 
+// increment the refcount of an item in the shard, tracking it if
+// needed.  Must be called with the shard lock held.
+void Processor::incRef(Shard& s, const reference_t& up, const URI& from) {
+    obj_state_by_uri& uri_index = s.obj_state.get<uri_tag>();
+    obj_state_by_uri::iterator uit = uri_index.find(up.second);
+
+    if (uit == uri_index.end()) {
+        LOG(DEBUG) << "Tracking new nonlocal item " << up.second << " from reference";
+        s.obj_state.insert(item(up.second, up.first,
+                                0, policyRefTimerDuration,
+                                UNRESOLVED, false));
+        s.wheel.schedule(up.second, 0);
+        uit = uri_index.find(up.second);
+    }
+    uit->details->refcount += 1;
+    uit->details->orphan = false;
+    // cached policy held for the local policy is resolved as soon as
+    // it is referenced
+    if (uit->details->stale && uit->details->refcount == 1)
+        setExpiration(s, uit, 0);
+    LOG(DEBUG) << "addref " << uit->uri.toString()
+               << " (from " << from.toString() << ")"
+               << " " << uit->details->refcount
+               << " state " << ItemStateMap[uit->details->state];
+}
+
+// decrement the refcount of an item in the shard.  If refcount is
+// zero, add the item to the garbage collection candidates.  Must be
+// called with the shard lock held.
+void Processor::decRef(Shard& s, const reference_t& up, const URI& from,
+                       uint64_t curTime) {
+    obj_state_by_uri& uri_index = s.obj_state.get<uri_tag>();
+    obj_state_by_uri::iterator uit = uri_index.find(up.second);
+    if (uit != uri_index.end()) {
+        uit->details->refcount -= 1;
+        LOG(DEBUG) << "removeref " << uit->uri.toString()
+                   << " (from " << from.toString() << ")"
+                   << " " << uit->details->refcount
+                   << " state " << ItemStateMap[uit->details->state];
+        if (uit->details->refcount <= 0) {
+            s.gc_candidates.push_back(uit->uri);
+        }
+    }
+}
+
+// apply reference changes deferred while processing an item in
+// shard s.  Must be called without any shard lock held.
+void Processor::applyRefUpdates(Shard& s, const URI& from,
+                                const ref_updates_t& updates) {
+    // all loops share the same monotonic clock
+    uint64_t curTime = now(s.proc_loop);
+    for (const ref_update& u : updates) {
+        Shard& t = getShard(u.ref.second);
+        {
+            const std::lock_guard<std::mutex> lock(t.item_mutex);
+            if (!proc_active) return;
+            if (u.add)
+                incRef(t, u.ref, from);
+            else
+                decRef(t, u.ref, from, curTime);
+        }
+        uv_async_send(&t.proc_async);
+    }
+}
+
 size_t Processor::getRefCount(const URI& uri) {
-    const std::lock_guard<std::mutex> lock(item_mutex);
-    obj_state_by_uri& uri_index = obj_state.get<uri_tag>();
+    Shard& s = getShard(uri);
+    const std::lock_guard<std::mutex> lock(s.item_mutex);
+    obj_state_by_uri& uri_index = s.obj_state.get<uri_tag>();
     obj_state_by_uri::iterator uit = uri_index.find(uri);
     if (uit != uri_index.end()) {
         return uit->details->refcount;
@@ -165,9 +316,58 @@ size_t Processor::getRefCount(const URI& uri) {
     return 0;
 }
 
+void Processor::getItemStateCounts(/* out */ std::unordered_map<std::string,
+                                                              uint64_t>& counts) {
+    for (const std::pair<const int, std::string>& st : ItemStateMap)
+        counts[st.second] = 0;
+    counts["stale"] = 0;
+    for (std::unique_ptr<Shard>& s : shards) {
+        const std::lock_guard<std::mutex> lock(s->item_mutex);
+        for (const item& i : s->obj_state) {
+            counts[ItemStateMap[i.details->state]] += 1;
+            if (i.details->stale)
+                counts["stale"] += 1;
+        }
+    }
+}
+
+// fold the latency of a response to a request sent at the given time
+// into the moving average.  The loop time is derived from the same
+// monotonic clock as uv_hrtime.
+uint64_t Processor::updateLatency(uint64_t sendTime) {
+    uint64_t curTime = uv_hrtime() / 1000000;
+    uint64_t sample = curTime > sendTime ? curTime - sendTime : 0;
+    foldLatency(sample);
+    return sample;
+}
+
+void Processor::foldLatency(uint64_t sample) {
+    uint64_t cur = responseLatency;
+    uint64_t next;
+    do {
+        next = cur == 0 ? sample : (cur * 7 + sample) / 8;
+    } while (!responseLatency.compare_exchange_weak(cur, next));
+}
+
+void Processor::responseBusy() {
+    // a refusal counts as a response slow enough to stretch the base
+    // retry delay to the policy refresh interval
+    foldLatency(policyRefTimerDuration / RETRY_LATENCY_FACTOR);
+}
+
+void Processor::getResolveLatency(/* out */ std::unordered_map<std::string,
+                                  std::shared_ptr<const OFLatencyHistogram> >& latency) {
+    for (const auto& l : resolveLatency) {
+        try {
+            latency[store->getClassInfo(l.first).getName()] = l.second;
+        } catch (const std::out_of_range& e) {}
+    }
+}
+
 bool Processor::isObjNew(const URI& uri) {
-    const std::lock_guard<std::mutex> lock(item_mutex);
-    obj_state_by_uri& uri_index = obj_state.get<uri_tag>();
+    Shard& s = getShard(uri);
+    const std::lock_guard<std::mutex> lock(s.item_mutex);
+    obj_state_by_uri& uri_index = s.obj_state.get<uri_tag>();
     obj_state_by_uri::iterator uit = uri_index.find(uri);
     if (uit != uri_index.end()) {
         return uit->details->state == NEW;
@@ -176,32 +376,56 @@ bool Processor::isObjNew(const URI& uri) {
 }
 
 // check if the object has a zero refcount and it has no remote
-// ancestor that has a zero refcount.
-bool Processor::isOrphan(const item& item) {
+// ancestor that has a zero refcount.  The ancestors may be in any
+// shard, so this must be called without any shard lock held.
+bool Processor::isOrphan(class_id_t class_id, const URI& uri,
+                         bool local, size_t refcount) {
     // simplest case: refcount is nonzero or item is local
-    if (item.details->local || item.details->refcount > 0)
+    if (local || refcount > 0)
         return false;
 
     try {
         std::pair<URI, prop_id_t> parent(URI::ROOT, 0);
-        if (client->getParent(item.details->class_id, item.uri, parent)) {
-            obj_state_by_uri& uri_index = obj_state.get<uri_tag>();
-            obj_state_by_uri::iterator uit = uri_index.find(parent.first);
-            // parent missing
-            if (uit == uri_index.end())
-                return true;
-
-            // the parent is local, so there can be no remote parent with
-            // a nonzero refcount
-            if (uit->details->local)
-                return true;
-
-            return isOrphan(*uit);
+        if (client->getParent(class_id, uri, parent)) {
+            Shard& ps = getShard(parent.first);
+            class_id_t parent_class;
+            size_t parent_refcount;
+            {
+                const std::lock_guard<std::mutex> lock(ps.item_mutex);
+                obj_state_by_uri& uri_index = ps.obj_state.get<uri_tag>();
+                obj_state_by_uri::iterator uit = uri_index.find(parent.first);
+                // parent missing
+                if (uit == uri_index.end())
+                    return true;
+
+                // the parent is cached policy held for the local
+                // policy
+                if (isHeld(*uit->details))
+                    return false;
+
+                // the parent is local, so there can be no remote
+                // parent with a nonzero refcount
+                if (uit->details->local)
+                    return true;
+
+                parent_class = uit->details->class_id;
+                parent_refcount = uit->details->refcount;
+            }
+            return isOrphan(parent_class, parent.first,
+                            false, parent_refcount);
         }
     } catch (const std::out_of_range& e) {}
     return true;
 }
 
+// check whether an item loaded from the policy cache is still kept
+// regardless of its references
+bool Processor::isHeld(const item_details& details) {
+    uint64_t curTime = uv_hrtime() / 1000000;
+    return (details.stale && curTime < cacheHoldUntil) ||
+        curTime < details.hold_until;
+}
+
 // Check if an object is the highest-rank ancestor for objects that
 // are synced to the server.  We don't bother syncing child objects
 // since those will get synced when we sync the parent.
@@ -223,42 +447,145 @@ bool Processor::isParentSyncObject(const item& item) {
     return true;
 }
 
-void Processor::sendToRole(const item& i, uint64_t& newexp,
-                           OpflexMessage* req,
-                           ofcore::OFConstants::OpflexRole role) {
-    uint64_t xid = req->getReqXid();
-    size_t pending = pool.sendToRole(req, role, false, i.uri.toString());
-    i.details->pending_reqs = pending;
+// add an item to the batch of requests of the given type, sending
+// the batch first if it is full
+void Processor::queueRequest(Shard& s, batch_type_t type, const item& i) {
+    request_batch& batch = s.batches[type];
+    size_t bytes = i.uri.toString().size() + BATCH_SUBJECT_OVERHEAD;
+    if (!batch.refs.empty() &&
+        (batch.refs.size() >= MAX_BATCH_SUBJECTS ||
+         batch.bytes + bytes > MAX_BATCH_BYTES))
+        flushBatch(s, type);
+
+    batch.refs.emplace_back(i.details->class_id, i.uri);
+    batch.bytes += bytes;
+}
 
-    obj_state_by_uri& uri_index = obj_state.get<uri_tag>();
-    obj_state_by_uri::iterator uit = uri_index.find(i.uri);
-    uri_index.modify(uit, change_last_xid(xid));
+// send the subjects of a request of the given type to the peers.
+// Every item in the request shares the request ID, so a response
+// clears the pending requests for each of them through the xid index.
+// If peer is set the request is sent only to that peer.
+void Processor::sendRequest(Shard& s, batch_type_t type,
+                            const vector<reference_t>& refs,
+                            const OpflexPool::peer_name_t* peer) {
+    uint64_t xid = nextXid++;
+    OpflexMessage* req = NULL;
+    OFConstants::OpflexRole role = getBatchRole(type);
+    switch (type) {
+    case BATCH_POLICY_RESOLVE:
+        req = new PolicyResolveReq(this, xid, refs);
+        break;
+    case BATCH_ENDPOINT_RESOLVE:
+        req = new EndpointResolveReq(this, xid, refs);
+        break;
+    case BATCH_ENDPOINT_DECLARE:
+        req = new EndpointDeclareReq(this, xid, refs);
+        break;
+    default:
+        req = new StateReportReq(this, xid, refs);
+        break;
+    }
+    vector<std::string> uris;
+    if (type == BATCH_POLICY_RESOLVE) {
+        uris.reserve(refs.size());
+        for (const reference_t& r : refs)
+            uris.push_back(r.second.toString());
+    }
+    // a congested peer is left alone and the items are retried with
+    // the usual backoff, rather than queueing more work behind it
+    size_t pending = peer
+        ? pool.sendToPeer(req, *peer, role, false, uris, true)
+        : pool.sendToRole(req, role, false, uris, true);
+
+    obj_state_by_uri& uri_index = s.obj_state.get<uri_tag>();
+    uint64_t curTime = now(s.proc_loop);
+    uint64_t baseDelay =
+        std::max(retryDelay, RETRY_LATENCY_FACTOR * responseLatency);
+    for (const reference_t& r : refs) {
+        obj_state_by_uri::iterator uit = uri_index.find(r.second);
+        // item was purged since it was queued
+        if (uit == uri_index.end()) continue;
 
-    if (pending > 0) {
-        uint64_t nextRetryDelay =
-            (uint64_t)std::pow(2, i.details->retry_count) * retryDelay;
+        uit->details->pending_reqs = pending;
+        uri_index.modify(uit, change_last_xid(xid));
 
-        if (nextRetryDelay > policyRefTimerDuration)
-            nextRetryDelay = policyRefTimerDuration;
+        if (pending > 0) {
+            uint64_t nextRetryDelay =
+                (uint64_t)std::pow(2, uit->details->retry_count) * baseDelay;
 
-        if (i.details->retry_count > 0) {
-            LOG(DEBUG) << "Retrying dropped message for item "
-                       << i.uri
-                       << " (next attempt in " << nextRetryDelay << " ms)";
+            if (nextRetryDelay > policyRefTimerDuration)
+                nextRetryDelay = policyRefTimerDuration;
+
+            if (uit->details->retry_count > 0) {
+                // references that stay unresolved are retried forever
+                LOG_SAMPLED(DEBUG, 100)
+                    << "Retrying dropped message for item "
+                    << uit->uri
+                    << " (next attempt in " << nextRetryDelay << " ms)";
+            }
+
+            if (uit->details->retry_count < 16)
+                uit->details->retry_count += 1;
+
+            setExpiration(s, uit, curTime + nextRetryDelay);
+        } else {
+            uit->details->retry_count = 0;
         }
+    }
+}
+
+// get the role of the peers that serve a type of request
+OFConstants::OpflexRole Processor::getBatchRole(batch_type_t type) {
+    switch (type) {
+    case BATCH_POLICY_RESOLVE:
+        return OFConstants::POLICY_REPOSITORY;
+    case BATCH_ENDPOINT_RESOLVE:
+    case BATCH_ENDPOINT_DECLARE:
+        return OFConstants::ENDPOINT_REGISTRY;
+    default:
+        return OFConstants::OBSERVER;
+    }
+}
 
-        if (i.details->retry_count < 16)
-            i.details->retry_count += 1;
+// send the batch of requests of the given type.  With load sharing,
+// resolves and declares are split into one request for each ready
+// peer, and state reports still go to every observer.
+void Processor::flushBatch(Shard& s, batch_type_t type) {
+    request_batch& batch = s.batches[type];
+    if (batch.refs.empty()) return;
+
+    vector<OpflexPool::peer_name_t> peers;
+    if (pool.isLoadSharing() && type != BATCH_STATE_REPORT) {
+        vector<std::string> uris;
+        uris.reserve(batch.refs.size());
+        for (const reference_t& r : batch.refs)
+            uris.push_back(r.second.toString());
+        pool.assignPeers(getBatchRole(type), uris, peers);
+    }
 
-        newexp = now(proc_loop) + nextRetryDelay;
+    if (peers.empty()) {
+        sendRequest(s, type, batch.refs, NULL);
     } else {
-        i.details->retry_count = 0;
+        std::unordered_map<OpflexPool::peer_name_t,
+                           vector<reference_t> > byPeer;
+        for (size_t i = 0; i < batch.refs.size(); ++i)
+            byPeer[peers[i]].push_back(batch.refs[i]);
+        for (const auto& p : byPeer)
+            sendRequest(s, type, p.second, &p.first);
     }
+
+    batch.refs.clear();
+    batch.bytes = 0;
+}
+
+void Processor::flushBatches(Shard& s) {
+    for (size_t t = 0; t < BATCH_TYPES; ++t)
+        flushBatch(s, (batch_type_t)t);
 }
 
-bool Processor::resolveObj(ClassInfo::class_type_t type, const item& i,
-                           uint64_t& newexp, bool checkTime) {
-    uint64_t curTime = now(proc_loop);
+bool Processor::resolveObj(Shard& s, ClassInfo::class_type_t type,
+                           const item& i, bool checkTime) {
+    uint64_t curTime = now(s.proc_loop);
     bool shouldRefresh =
         (i.details->resolve_time == 0) ||
         (curTime > (i.details->resolve_time + i.details->refresh_rate/2));
@@ -274,11 +601,7 @@ bool Processor::resolveObj(ClassInfo::class_type_t type, const item& i,
         {
             LOG(DEBUG) << "Resolving policy " << i.uri;
             i.details->resolve_time = curTime;
-            vector<reference_t> refs;
-            refs.emplace_back(i.details->class_id, i.uri);
-            PolicyResolveReq* req =
-                new PolicyResolveReq(this, nextXid++, refs);
-            sendToRole(i, newexp, req, OFConstants::POLICY_REPOSITORY);
+            queueRequest(s, BATCH_POLICY_RESOLVE, i);
             return true;
         }
         break;
@@ -286,11 +609,7 @@ bool Processor::resolveObj(ClassInfo::class_type_t type, const item& i,
         {
             LOG(DEBUG) << "Resolving remote endpoint " << i.uri;
             i.details->resolve_time = curTime;
-            vector<reference_t> refs;
-            refs.emplace_back(i.details->class_id, i.uri);
-            EndpointResolveReq* req =
-                new EndpointResolveReq(this, nextXid++, refs);
-            sendToRole(i, newexp, req, OFConstants::ENDPOINT_REGISTRY);
+            queueRequest(s, BATCH_ENDPOINT_RESOLVE, i);
             return true;
         }
         break;
@@ -318,29 +637,116 @@ void Processor::disableObservableReporting() {
     reportObservables = false;
 }
 
-bool Processor::declareObj(ClassInfo::class_type_t type, const item& i,
-                           uint64_t& newexp) {
-    uint64_t curTime = now(proc_loop);
+void Processor::setStateReportInterval(uint64_t interval) {
+    stateReportInterval = interval;
+}
+
+void Processor::overrideStateReportInterval(class_id_t class_id,
+                                            uint64_t interval) {
+    reportIntervals[class_id] = interval;
+}
+
+void Processor::setStateReportBudget(uint64_t bytesPerSecond) {
+    const std::lock_guard<std::mutex> lock(report_mutex);
+    reportBudget = bytesPerSecond;
+    reportTokens = bytesPerSecond;
+    reportTokenTime = 0;
+}
+
+// get the minimum interval between state reports for objects of the
+// class, or zero if they are reported on every change
+uint64_t Processor::getReportInterval(class_id_t class_id) {
+    auto iter = reportIntervals.find(class_id);
+    if (iter != reportIntervals.end())
+        return iter->second;
+    return stateReportInterval;
+}
+
+// take bytes from the state report budget.  Every observer peer is
+// sent the same reports, so a single bucket bounds the bytes sent to
+// each of them.  If the budget is exhausted, returns false and the
+// time to wait in milliseconds until it will have refilled.
+bool Processor::reserveReportBytes(uint64_t curTime, size_t bytes,
+                                   /* out */ uint64_t& wait) {
+    const std::lock_guard<std::mutex> lock(report_mutex);
+    if (reportBudget == 0) return true;
+
+    if (curTime > reportTokenTime) {
+        if (reportTokenTime > 0)
+            reportTokens += (double)reportBudget *
+                (curTime - reportTokenTime) / 1000;
+        reportTokenTime = curTime;
+    }
+    // allow a burst of up to one second of budget, and always allow
+    // a single report larger than that once the bucket is full
+    if (reportTokens > reportBudget)
+        reportTokens = reportBudget;
+    if (reportTokens >= bytes || reportTokens >= reportBudget) {
+        reportTokens -= bytes;
+        return true;
+    }
+    double deficit = std::min((double)bytes, (double)reportBudget) -
+        reportTokens;
+    wait = (uint64_t)std::ceil(deficit * 1000 / reportBudget);
+    return false;
+}
+
+// get the time of the next renewal of a local endpoint declared at
+// curTime: halfway through the lease, rounded down to the start of a
+// renewal bucket.  The clock is shared by all the shards, so the
+// endpoints in a bucket are due at the same time and go out in the
+// same batch.
+uint64_t Processor::getRenewalTime(uint64_t curTime) {
+    uint64_t renew = getEndpointLease() * 1000 / 2;
+    uint64_t bucket = std::max<uint64_t>(renew / renewalBuckets, 1);
+    uint64_t next = curTime + renew;
+    next -= next % bucket;
+    if (next <= curTime)
+        next += bucket;
+    return next;
+}
+
+bool Processor::declareObj(Shard& s, ClassInfo::class_type_t type,
+                           const item& i, uint64_t& newexp,
+                           bool checkChanged) {
+    uint64_t curTime = now(s.proc_loop);
     switch (type) {
     case ClassInfo::LOCAL_ENDPOINT:
         if (isParentSyncObject(i)) {
             LOG(DEBUG) << "Declaring local endpoint " << i.uri;
             i.details->resolve_time = curTime;
-            vector<reference_t> refs;
-            refs.emplace_back(i.details->class_id, i.uri);
-            EndpointDeclareReq* req =
-                new EndpointDeclareReq(this, nextXid++, refs);
-            sendToRole(i, newexp, req, OFConstants::ENDPOINT_REGISTRY);
+            queueRequest(s, BATCH_ENDPOINT_DECLARE, i);
+            if (i.details->pending_reqs == 0 && renewalBuckets > 0)
+                newexp = getRenewalTime(curTime);
         }
         return true;
     case ClassInfo::OBSERVABLE:
         if (isParentSyncObject(i) && reportObservables && isObservableReportable(i.details->class_id)) {
+            std::shared_ptr<const ObjectInstance> oi;
+            if (!client->get(i.details->class_id, i.uri, oi))
+                return true;
+
+            // skip reports of unchanged state that the peers have
+            // acknowledged until a refresh is due.  A report that is
+            // still pending was lost or refused, and is sent again.
+            if (checkChanged && i.details->pending_reqs == 0 &&
+                i.details->reported &&
+                *i.details->reported == *oi &&
+                curTime <= i.details->resolve_time + i.details->refresh_rate/2)
+                return true;
+
+            uint64_t wait = 0;
+            if (!reserveReportBytes(curTime, oi->getMemoryUsage(), wait)) {
+                LOG(TRACE) << "Delaying report of observable " << i.uri
+                           << " by " << wait << " ms for byte budget";
+                newexp = curTime + wait;
+                return true;
+            }
+
             LOG(TRACE) << "Declaring local observable " << i.uri;
             i.details->resolve_time = curTime;
-            vector<reference_t> refs;
-            refs.emplace_back(i.details->class_id, i.uri);
-            StateReportReq* req = new StateReportReq(this, nextXid++, refs);
-            sendToRole(i, newexp, req, OFConstants::OBSERVER);
+            i.details->reported = oi;
+            queueRequest(s, BATCH_STATE_REPORT, i);
         }
         return true;
     default:
@@ -351,21 +757,48 @@ bool Processor::declareObj(ClassInfo::class_type_t type, const item& i,
 
 // Process the item.  This is where we do most of the actual work of
 // syncing the managed object over opflex
-void Processor::processItem(obj_state_by_exp::iterator& it) {
+void Processor::processItem(Shard& s, obj_state_by_uri::iterator& it) {
     StoreClient::notif_t notifs;
+    ref_updates_t deferred;
+
+    // Items are only erased by the thread processing their shard, so
+    // the iterator stays valid while the lock is released to check
+    // the ancestors in other shards.
+    bool orphan;
+    {
+        std::unique_lock<std::mutex> guard(s.item_mutex);
+        class_id_t class_id = it->details->class_id;
+        bool local = it->details->local;
+        size_t refcount = it->details->refcount;
+        bool held = isHeld(*it->details);
+        bool collect = it->details->orphan;
+        URI uri(it->uri);
+        guard.unlock();
+        orphan = collect ||
+            (!held && isOrphan(class_id, uri, local, refcount));
+    }
+
+    std::unique_lock<std::mutex> guard(s.item_mutex);
+    // a reference may have been added from another shard while the
+    // lock was released, so only an item that is still unreferenced
+    // is an orphan.  The garbage collection mark is consumed only
+    // when it is honored.
+    orphan &= !it->details->local && it->details->refcount == 0 &&
+        !isHeld(*it->details);
+    if (orphan)
+        it->details->orphan = false;
 
-    std::unique_lock<std::mutex> guard(item_mutex);
     ItemState curState = it->details->state;
     size_t curRefCount = it->details->refcount;
     bool local = it->details->local;
 
-    obj_state_by_exp& exp_index = obj_state.get<expiration_tag>();
+    obj_state_by_uri& uri_index = s.obj_state.get<uri_tag>();
     uint64_t newexp = std::numeric_limits<uint64_t>::max();
     if (it->details->refresh_rate > 0) {
         if (it->details->pending_reqs > 0)
-            newexp = now(proc_loop) + retryDelay;
+            newexp = now(s.proc_loop) + retryDelay;
         else
-            newexp = now(proc_loop) + it->details->refresh_rate;
+            newexp = now(s.proc_loop) + it->details->refresh_rate;
     }
 
     const ClassInfo& ci = store->getClassInfo(it->details->class_id);
@@ -400,6 +833,10 @@ void Processor::processItem(obj_state_by_exp::iterator& it) {
         // item removed
         switch (curState) {
         case UNRESOLVED:
+            // stop tracking unresolved references that are no longer
+            // referenced
+            if (orphan)
+                newState = DELETED;
             break;
         default:
             newState = DELETED;
@@ -408,7 +845,7 @@ void Processor::processItem(obj_state_by_exp::iterator& it) {
     }
 
     // Check whether this item needs to be garbage collected
-    if (oi && isOrphan(*it)) {
+    if (oi && orphan) {
         switch (curState) {
         case NEW:
         case REMOTE:
@@ -417,9 +854,7 @@ void Processor::processItem(obj_state_by_exp::iterator& it) {
                 // we won't remove them right away
                 LOG(DEBUG) << "Queuing delete for orphan " << it->uri.toString();
                 newState = PENDING_DELETE;
-                newexp = now(proc_loop) + processingDelay;
-                obj_state_by_exp& exp_index = obj_state.get<expiration_tag>();
-                exp_index.modify(it, change_expiration(newexp));
+                newexp = now(s.proc_loop) + processingDelay;
                 break;
             }
         default:
@@ -451,14 +886,14 @@ void Processor::processItem(obj_state_by_exp::iterator& it) {
                                   PropertyInfo::SCALAR)) {
                         reference_t u = oi->getReference(p.first);
                         visited.insert(u);
-                        addRef(it, u);
+                        addRef(s, it, u, deferred);
                     }
                 } else {
                     size_t c = oi->getReferenceSize(p.first);
                     for (size_t i = 0; i < c; ++i) {
                         reference_t u = oi->getReference(p.first, i);
                         visited.insert(u);
-                        addRef(it, u);
+                        addRef(s, it, u, deferred);
                     }
                 }
             }
@@ -467,18 +902,19 @@ void Processor::processItem(obj_state_by_exp::iterator& it) {
     std::unordered_set<reference_t> existing(it->details->urirefs);
     for (const reference_t& up : existing) {
         if (visited.find(up) == visited.end()) {
-            removeRef(it, up);
+            removeRef(s, it, up, deferred);
         }
     }
 
     if (curRefCount > 0) {
-        resolveObj(ci.getType(), *it, newexp);
+        resolveObj(s, ci.getType(), *it);
         newState = RESOLVED;
     } else if (oi) {
-        if (declareObj(ci.getType(), *it, newexp))
+        if (declareObj(s, ci.getType(), *it, newexp))
             newState = IN_SYNC;
     }
 
+    URI uri(it->uri);
     if (newState == DELETED) {
         client->removeChildren(it->details->class_id,
                                it->uri,
@@ -524,44 +960,101 @@ void Processor::processItem(obj_state_by_exp::iterator& it) {
             LOG(DEBUG) << "Purging state for " << it->uri.toString()
                        << " in state " << ItemStateMap[it->details->state];
         }
-        exp_index.erase(it);
+        uri_index.erase(it);
     } else {
         it->details->state = newState;
-        exp_index.modify(it, Processor::change_expiration(newexp));
+        setExpiration(s, it, newexp);
     }
 
     guard.unlock();
 
+    if (!deferred.empty())
+        applyRefUpdates(s, uri, deferred);
     if (!notifs.empty())
         client->deliverNotifications(notifs);
 }
 
-void Processor::doProcess() {
-    obj_state_by_exp::iterator it;
-    uint32_t proc_count = 0;
+// check a bounded number of the garbage collection candidates of the
+// shard.  Orphaned items are scheduled for processing, which removes
+// them, and the rest are left alone until their count drops to zero
+// again.
+void Processor::collectGarbage(Shard& s) {
+    struct candidate {
+        URI uri;
+        class_id_t class_id;
+    };
+    vector<candidate> candidates;
+    {
+        const std::lock_guard<std::mutex> lock(s.item_mutex);
+        obj_state_by_uri& uri_index = s.obj_state.get<uri_tag>();
+        while (!s.gc_candidates.empty() &&
+               candidates.size() < GC_SLICE_ITEMS) {
+            obj_state_by_uri::iterator uit =
+                uri_index.find(s.gc_candidates.front());
+            s.gc_candidates.pop_front();
+            if (uit == uri_index.end() || uit->details->local ||
+                uit->details->refcount > 0 || uit->details->orphan ||
+                isHeld(*uit->details))
+                continue;
+            candidates.push_back({uit->uri, uit->details->class_id});
+        }
+        if (!s.gc_candidates.empty())
+            uv_async_send(&s.proc_async);
+    }
+    if (candidates.empty()) return;
+
+    // the ancestors may be in other shards, so check them without
+    // the lock
+    vector<bool> orphans;
+    for (const candidate& c : candidates)
+        orphans.push_back(isOrphan(c.class_id, c.uri, false, 0));
+
+    const std::lock_guard<std::mutex> lock(s.item_mutex);
+    obj_state_by_uri& uri_index = s.obj_state.get<uri_tag>();
+    uint64_t curTime = now(s.proc_loop);
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (!orphans[i]) continue;
+        obj_state_by_uri::iterator uit = uri_index.find(candidates[i].uri);
+        if (uit == uri_index.end() || uit->details->refcount > 0)
+            continue;
+        uit->details->orphan = true;
+        setExpiration(s, uit, curTime + processingDelay);
+    }
+}
+
+void Processor::doProcess(Shard& s) {
+    collectGarbage(s);
+
+    obj_state_by_uri::iterator it;
+    uint64_t sliceEnd = uv_hrtime() + PROCESS_SLICE_NS;
     while (proc_active) {
         {
-            const std::lock_guard<std::mutex> lock(item_mutex);
-            if (!hasWork(it))
+            const std::lock_guard<std::mutex> lock(s.item_mutex);
+            if (!hasWork(s, it))
                 break;
         }
-        processItem(it);
-        proc_count += 1;
-        if (proc_count >= MAX_PROCESS && proc_active) {
-            uv_async_send(&proc_async);
+        uint64_t itemStart = uv_hrtime();
+        processItem(s, it);
+        uint64_t itemEnd = uv_hrtime();
+        processTime.observe((itemEnd - itemStart) / 1000);
+        if (itemEnd >= sliceEnd && proc_active) {
+            uv_async_send(&s.proc_async);
             break;
         }
     }
+    // send the requests accumulated by this slice
+    const std::lock_guard<std::mutex> lock(s.item_mutex);
+    flushBatches(s);
 }
 
 void Processor::proc_async_cb(uv_async_t* handle) {
-    Processor* processor = (Processor*)handle->data;
-    processor->doProcess();
+    Shard* s = (Shard*)handle->data;
+    s->processor->doProcess(*s);
 }
 
 void Processor::connect_async_cb(uv_async_t* handle) {
-    Processor* processor = (Processor*)handle->data;
-    processor->handleNewConnections();
+    Shard* s = (Shard*)handle->data;
+    s->processor->handleNewConnections(*s);
 }
 
 static void register_listeners(void* processor, const modb::ClassInfo& ci) {
@@ -569,17 +1062,36 @@ static void register_listeners(void* processor, const modb::ClassInfo& ci) {
     p->listen(ci.getId());
 }
 
+static void add_resolve_latency(void* latency, const modb::ClassInfo& ci) {
+    if (ci.getType() != ClassInfo::POLICY) return;
+    auto* l = (std::unordered_map<class_id_t,
+               std::shared_ptr<OFLatencyHistogram> >*)latency;
+    (*l)[ci.getId()] = std::make_shared<OFLatencyHistogram>();
+}
+
 void Processor::timer_callback(uv_timer_t* handle) {
+    Shard* s = (Shard*)handle->data;
+    s->processor->doProcess(*s);
+}
+
+void Processor::cache_timer_cb(uv_timer_t* handle) {
     Processor* processor = (Processor*)handle->data;
-    processor->doProcess();
+    processor->writePolicyCache(true);
 }
 
 void Processor::cleanup_async_cb(uv_async_t* handle) {
-    Processor* processor = (Processor*)handle->data;
-    uv_timer_stop(&processor->proc_timer);
-    uv_close((uv_handle_t*)&processor->proc_timer, NULL);
-    uv_close((uv_handle_t*)&processor->proc_async, NULL);
-    uv_close((uv_handle_t*)&processor->connect_async, NULL);
+    Shard* s = (Shard*)handle->data;
+    Processor* processor = s->processor;
+    if (processor->cache_timer_active &&
+        s == processor->shards.front().get()) {
+        uv_timer_stop(&processor->cache_timer);
+        uv_close((uv_handle_t*)&processor->cache_timer, NULL);
+        processor->cache_timer_active = false;
+    }
+    uv_timer_stop(&s->proc_timer);
+    uv_close((uv_handle_t*)&s->proc_timer, NULL);
+    uv_close((uv_handle_t*)&s->proc_async, NULL);
+    uv_close((uv_handle_t*)&s->connect_async, NULL);
     uv_close((uv_handle_t*)handle, NULL);
 }
 
@@ -596,20 +1108,48 @@ void Processor::start(ofcore::OFConstants::OpflexElementMode agent_mode) {
 
     client = &store->getStoreClient("_SYSTEM_");
     store->forEachClass(&register_listeners, this);
+    if (resolveLatency.empty())
+        store->forEachClass(&add_resolve_latency, &resolveLatency);
 
-    proc_loop = threadManager.initTask("processor");
-    uv_timer_init(proc_loop, &proc_timer);
-    cleanup_async.data = this;
-    uv_async_init(proc_loop, &cleanup_async, cleanup_async_cb);
-    proc_async.data = this;
-    uv_async_init(proc_loop, &proc_async, proc_async_cb);
-    connect_async.data = this;
-    uv_async_init(proc_loop, &connect_async, connect_async_cb);
-    proc_timer.data = this;
-    uv_timer_start(&proc_timer, &timer_callback,
-                   processingDelay, processingDelay);
-    threadManager.startTask("processor");
+    for (std::unique_ptr<Shard>& s : shards) {
+        s->proc_loop = threadManager.initTask(s->taskName);
+        {
+            // schedule any items left from before the processor was
+            // last stopped relative to the new loop time
+            const std::lock_guard<std::mutex> lock(s->item_mutex);
+            s->wheel.reset(now(s->proc_loop));
+            for (size_t p = 0; p < PRIORITY_CLASSES; ++p)
+                s->ready[p].clear();
+            s->classes.reset();
+            for (const item& i : s->obj_state) {
+                if (i.expiration != std::numeric_limits<uint64_t>::max())
+                    s->wheel.schedule(i.uri, i.expiration);
+            }
+        }
+        uv_timer_init(s->proc_loop, &s->proc_timer);
+        s->cleanup_async.data = s.get();
+        uv_async_init(s->proc_loop, &s->cleanup_async, cleanup_async_cb);
+        s->proc_async.data = s.get();
+        uv_async_init(s->proc_loop, &s->proc_async, proc_async_cb);
+        s->connect_async.data = s.get();
+        uv_async_init(s->proc_loop, &s->connect_async, connect_async_cb);
+        s->proc_timer.data = s.get();
+        uv_timer_start(&s->proc_timer, &timer_callback,
+                       processingDelay, processingDelay);
+        if (s == shards.front()) {
+            const std::lock_guard<std::mutex> lock(cache_mutex);
+            if (!policyCacheFile.empty() && policyCacheInterval > 0) {
+                uv_timer_init(s->proc_loop, &cache_timer);
+                cache_timer.data = this;
+                uv_timer_start(&cache_timer, &cache_timer_cb,
+                               policyCacheInterval, policyCacheInterval);
+                cache_timer_active = true;
+            }
+        }
+        threadManager.startTask(s->taskName);
+    }
 
+    loadPolicyCache();
     pool.start();
 }
 
@@ -617,28 +1157,33 @@ void Processor::stop() {
     if (!proc_active) return;
 
     LOG(DEBUG) << "Stopping OpFlex Processor";
-    {
-        const std::lock_guard<std::mutex> lock(item_mutex);
+    writePolicyCache();
+
+    for (std::unique_ptr<Shard>& s : shards) {
+        const std::lock_guard<std::mutex> lock(s->item_mutex);
         proc_active = false;
     }
 
     unlisten();
 
-    uv_async_send(&cleanup_async);
-    threadManager.stopTask("processor");
+    for (std::unique_ptr<Shard>& s : shards) {
+        uv_async_send(&s->cleanup_async);
+        threadManager.stopTask(s->taskName);
+    }
 
     pool.stop();
 }
 
 void Processor::objectUpdated(modb::class_id_t class_id,
                               const modb::URI& uri) {
-    const std::lock_guard<std::mutex> lock(item_mutex);
+    Shard& s = getShard(uri);
+    const std::lock_guard<std::mutex> lock(s.item_mutex);
     if (!proc_active) return;
 
-    obj_state_by_uri& uri_index = obj_state.get<uri_tag>();
+    obj_state_by_uri& uri_index = s.obj_state.get<uri_tag>();
     obj_state_by_uri::iterator uit = uri_index.find(uri);
 
-    uint64_t curtime = now(proc_loop);
+    uint64_t curtime = now(s.proc_loop);
 
     bool present;
     bool local = false;
@@ -656,25 +1201,267 @@ void Processor::objectUpdated(modb::class_id_t class_id,
             }
             uint64_t nexp = 0;
             if (local) nexp = curtime+processingDelay;
+            // cached policy is first processed when it is no longer
+            // held, unless it is referenced before then
+            bool stale = !local && s.cached.erase(uri) > 0;
+            if (stale) nexp = cacheHoldUntil;
             double prrRange1 = prrTimerDuration/3;
             double prrRange2 = prrTimerDuration/2;
             std::uniform_int_distribution<> distribution(prrRange1,prrRange2);
-            uint64_t prrRandVal = distribution(gen);
+            uint64_t prrRandVal = distribution(s.gen);
             policyRefTimerDuration = prrRandVal*1000;
-            obj_state.insert(item(uri, class_id,
+            s.obj_state.insert(item(uri, class_id,
                                   nexp, policyRefTimerDuration,
                                   local ? NEW : REMOTE, local));
+            if (stale)
+                uri_index.find(uri)->details->stale = true;
+            s.wheel.schedule(uri, nexp);
         }
     } else {
         if (uit->details->local) {
             uit->details->state = UPDATED;
-            uri_index.modify(uit, change_expiration(curtime+processingDelay));
+            uint64_t nexp = curtime+processingDelay;
+            // coalesce changes to observables within the report interval
+            const ClassInfo& ci = store->getClassInfo(class_id);
+            if (ci.getType() == ClassInfo::OBSERVABLE) {
+                uint64_t interval = getReportInterval(class_id);
+                if (interval > 0 && uit->details->resolve_time + interval > nexp)
+                    nexp = uit->details->resolve_time + interval;
+            }
+            setExpiration(s, uit, nexp);
             uri_index.modify(uit, change_last_xid(0));
         } else  {
-            uri_index.modify(uit, change_expiration(curtime));
+            if (s.cached.erase(uri) > 0)
+                uit->details->stale = true;
+            setExpiration(s, uit, curtime);
+        }
+    }
+    uv_async_send(&s.proc_async);
+}
+
+void Processor::setPolicyCache(const std::string& file, uint64_t interval) {
+    const std::lock_guard<std::mutex> lock(cache_mutex);
+    policyCacheFile = file;
+    policyCacheInterval = interval;
+}
+
+void Processor::prefetch(const std::vector<reference_t>& refs,
+                         uint64_t holdTime) {
+    uint64_t holdUntil = uv_hrtime() / 1000000 + holdTime;
+    std::unordered_set<Shard*> wake;
+    for (const reference_t& ref : refs) {
+        Shard& s = getShard(ref.second);
+        const std::lock_guard<std::mutex> lock(s.item_mutex);
+        if (!proc_active) return;
+
+        obj_state_by_uri& uri_index = s.obj_state.get<uri_tag>();
+        obj_state_by_uri::iterator uit = uri_index.find(ref.second);
+        if (uit == uri_index.end()) {
+            LOG(DEBUG) << "Prefetching " << ref.second;
+            s.obj_state.insert(item(ref.second, ref.first,
+                                    0, policyRefTimerDuration,
+                                    UNRESOLVED, false));
+            s.wheel.schedule(ref.second, 0);
+            uit = uri_index.find(ref.second);
+            wake.insert(&s);
+        }
+        if (uit->details->hold_until < holdUntil)
+            uit->details->hold_until = holdUntil;
+    }
+    for (Shard* s : wake)
+        uv_async_send(&s->proc_async);
+}
+
+// load the policy cache into the store.  The roots of the cached
+// subtrees are marked stale when they are tracked.
+void Processor::loadPolicyCache() {
+    std::string file;
+    {
+        const std::lock_guard<std::mutex> lock(cache_mutex);
+        file = policyCacheFile;
+    }
+    if (file.empty()) return;
+
+    FILE* pfile = fopen(file.c_str(), "r");
+    if (pfile == NULL) {
+        LOG(INFO) << "No policy cache found at " << file;
+        return;
+    }
+    char buffer[1024];
+    rapidjson::FileReadStream f(pfile, buffer, sizeof(buffer));
+    rapidjson::Document d;
+    d.ParseStream<0, rapidjson::UTF8<>, rapidjson::FileReadStream>(f);
+    fclose(pfile);
+    if (!d.IsArray()) {
+        LOG(ERROR) << "Malformed policy cache " << file << ": not an array";
+        return;
+    }
+
+    rapidjson::Value::ConstValueIterator moit;
+    std::unordered_set<std::string> uris;
+    for (moit = d.Begin(); moit != d.End(); ++moit) {
+        if (moit->IsObject() && moit->HasMember("uri") &&
+            (*moit)["uri"].IsString())
+            uris.insert((*moit)["uri"].GetString());
+    }
+
+    cacheHoldUntil = uv_hrtime() / 1000000 + POLICY_CACHE_HOLD;
+    for (moit = d.Begin(); moit != d.End(); ++moit) {
+        if (!moit->IsObject() || !moit->HasMember("uri") ||
+            !(*moit)["uri"].IsString())
+            continue;
+        // a root is an object whose parent is not in the cache
+        if (moit->HasMember("parent_uri") &&
+            (*moit)["parent_uri"].IsString() &&
+            uris.find((*moit)["parent_uri"].GetString()) != uris.end())
+            continue;
+        URI uri((*moit)["uri"].GetString());
+        Shard& s = getShard(uri);
+        const std::lock_guard<std::mutex> lock(s.item_mutex);
+        s.cached.insert(uri);
+    }
+
+    StoreClient::notif_t notifs;
+    for (moit = d.Begin(); moit != d.End(); ++moit)
+        serializer.deserialize(*moit, *client, true, &notifs);
+    client->deliverNotifications(notifs);
+    LOG(INFO) << "Loaded " << d.Size()
+              << " managed objects from policy cache " << file;
+}
+
+// serialize the subtrees of the resolved policy for the policy
+// cache.  Must be called with cache_mutex held.
+size_t Processor::serializePolicyCache(std::string& out) {
+    vector<reference_t> roots;
+    for (std::unique_ptr<Shard>& s : shards) {
+        const std::lock_guard<std::mutex> lock(s->item_mutex);
+        for (const item& i : s->obj_state) {
+            if (i.details->local || i.details->state != RESOLVED)
+                continue;
+            try {
+                const ClassInfo& ci =
+                    store->getClassInfo(i.details->class_id);
+                if (ci.getType() == ClassInfo::POLICY)
+                    roots.emplace_back(i.details->class_id, i.uri);
+            } catch (const std::out_of_range& e) {}
         }
     }
-    uv_async_send(&proc_async);
+
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    writer.StartArray();
+    StoreClient& rclient = store->getReadOnlyStoreClient();
+    for (const reference_t& r : roots) {
+        try {
+            serializer.serialize(r.first, r.second, rclient, writer, true);
+        } catch (const std::out_of_range& e) {
+            // removed since it was found
+        }
+    }
+    writer.EndArray();
+    out.assign(buffer.GetString(), buffer.GetSize());
+    return roots.size();
+}
+
+// write serialized policy to the policy cache.  The file is replaced
+// atomically so a crash never leaves a partial cache.
+void Processor::storePolicyCache(const std::string& file,
+                                 const std::string& data,
+                                 uint64_t seq, size_t count) {
+    const std::lock_guard<std::mutex> guard(cache_write_mutex);
+    if (seq <= cache_written_seq) return;
+
+    std::string tmpFile = file + ".tmp";
+    FILE* pfile = fopen(tmpFile.c_str(), "w");
+    if (pfile == NULL) {
+        LOG(ERROR) << "Could not open policy cache "
+                   << tmpFile << " for writing";
+        return;
+    }
+    // a short write, for example on a full disk, must not replace
+    // the cache with a truncated file
+    bool failed = fwrite(data.data(), 1, data.size(), pfile) != data.size();
+    if (fclose(pfile) != 0)
+        failed = true;
+    if (failed) {
+        LOG(ERROR) << "Could not write policy cache " << tmpFile;
+        remove(tmpFile.c_str());
+        return;
+    }
+
+    if (rename(tmpFile.c_str(), file.c_str()) != 0) {
+        LOG(ERROR) << "Could not replace policy cache " << file;
+        remove(tmpFile.c_str());
+        return;
+    }
+    cache_written_seq = seq;
+    LOG(DEBUG) << "Wrote " << count
+               << " resolved policy objects to cache " << file;
+}
+
+/**
+ * A write of the policy cache queued on the thread pool of the loop,
+ * with its own copy of the contents
+ */
+struct Processor::CacheWrite {
+    CacheWrite(Processor* processor_) : processor(processor_) {
+        req.data = this;
+    }
+
+    void store() {
+        processor->storePolicyCache(file, data, seq, count);
+    }
+
+    static void onWork(uv_work_t* req) {
+        static_cast<CacheWrite*>(req->data)->store();
+    }
+
+    static void onDone(uv_work_t* req, int status) {
+        std::unique_ptr<CacheWrite> job(static_cast<CacheWrite*>(req->data));
+        const std::lock_guard<std::mutex> guard(job->processor->cache_mutex);
+        job->processor->cache_write_pending = false;
+    }
+
+    uv_work_t req;
+    Processor* processor;
+    std::string file;
+    std::string data;
+    uint64_t seq;
+    size_t count;
+};
+
+// write the subtrees of the resolved policy to the policy cache.
+// Taking the contents needs the store, but the file is written on
+// the thread pool when async is set, so that a slow disk does not
+// hold up the processor loop.
+void Processor::writePolicyCache(bool async) {
+    std::unique_ptr<CacheWrite> job(new CacheWrite(this));
+    {
+        const std::lock_guard<std::mutex> guard(cache_mutex);
+        if (policyCacheFile.empty()) return;
+        // skip the write if the last one has not finished yet
+        if (async && cache_write_pending) return;
+        job->file = policyCacheFile;
+        job->count = serializePolicyCache(job->data);
+        job->seq = ++cache_seq;
+        if (async) cache_write_pending = true;
+    }
+
+    if (async) {
+        int rc = uv_queue_work(shards.front()->proc_loop, &job->req,
+                               CacheWrite::onWork, CacheWrite::onDone);
+        if (rc == 0) {
+            job.release();
+            return;
+        }
+        LOG(WARNING) << "Could not queue policy cache write: "
+                     << uv_strerror(rc);
+        {
+            const std::lock_guard<std::mutex> guard(cache_mutex);
+            cache_write_pending = false;
+        }
+    }
+    job->store();
 }
 
 void Processor::setOpflexIdentity(const std::string& name,
@@ -718,27 +1505,121 @@ OpflexHandler* Processor::newHandler(OpflexConnection* conn) {
     return new OpflexPEHandler(conn, this);
 }
 
-void Processor::handleNewConnections() {
-    const std::lock_guard<std::mutex> lock(item_mutex);
-    for (const item& i : obj_state) {
+void Processor::resyncItem(Shard& s, const item& i) {
+    const ClassInfo& ci = store->getClassInfo(i.details->class_id);
+    if (i.details->state == IN_SYNC) {
         uint64_t newexp = 0;
-        const ClassInfo& ci = store->getClassInfo(i.details->class_id);
-        if (i.details->state == IN_SYNC) {
-            declareObj(ci.getType(), i, newexp);
+        declareObj(s, ci.getType(), i, newexp, false);
+        // retry reports delayed by the byte budget
+        if (newexp > 0) {
+            obj_state_by_uri& uri_index = s.obj_state.get<uri_tag>();
+            obj_state_by_uri::iterator uit = uri_index.find(i.uri);
+            setExpiration(s, uit, newexp);
+        }
+    } else if (i.details->state == RESOLVED) {
+        resolveObj(s, ci.getType(), i, false);
+    } else {
+        return;
+    }
+    resyncCount += 1;
+}
+
+// get the role of the peers that serve an item when load sharing, or
+// OBSERVER if the item goes to every peer
+OFConstants::OpflexRole Processor::getResyncRole(ClassInfo::class_type_t type,
+                                                ItemState state) {
+    switch (type) {
+    case ClassInfo::POLICY:
+        if (state == RESOLVED) return OFConstants::POLICY_REPOSITORY;
+        break;
+    case ClassInfo::REMOTE_ENDPOINT:
+        if (state == RESOLVED) return OFConstants::ENDPOINT_REGISTRY;
+        break;
+    case ClassInfo::LOCAL_ENDPOINT:
+        if (state == IN_SYNC) return OFConstants::ENDPOINT_REGISTRY;
+        break;
+    default:
+        break;
+    }
+    return OFConstants::OBSERVER;
+}
+
+// send the items again after the set of ready peers changed.  A new
+// peer gets everything, since it may not have seen any of it.  When
+// a peer is lost, only the subjects that it served move to another
+// peer, so only those are sent again.
+void Processor::handleNewConnections(Shard& s) {
+    const std::lock_guard<std::mutex> lock(s.item_mutex);
+    if (s.resync_all) {
+        for (const item& i : s.obj_state)
+            resyncItem(s, i);
+    } else if (!s.lost_peers.empty()) {
+        std::unordered_map<int, vector<const item*> > byRole;
+        for (const item& i : s.obj_state) {
+            const ClassInfo& ci = store->getClassInfo(i.details->class_id);
+            OFConstants::OpflexRole role =
+                getResyncRole(ci.getType(), i.details->state);
+            if (role != OFConstants::OBSERVER)
+                byRole[role].push_back(&i);
         }
-        if (i.details->state == RESOLVED) {
-            resolveObj(ci.getType(), i, newexp, false);
+        for (const auto& r : byRole) {
+            vector<std::string> uris;
+            uris.reserve(r.second.size());
+            for (const item* i : r.second)
+                uris.push_back(i->uri.toString());
+            for (const OpflexPool::peer_name_t& lost : s.lost_peers) {
+                vector<OpflexPool::peer_name_t> peers;
+                pool.assignPeers((OFConstants::OpflexRole)r.first,
+                                 uris, peers, &lost);
+                for (size_t k = 0; k < peers.size(); ++k) {
+                    if (peers[k] == lost)
+                        resyncItem(s, *r.second[k]);
+                }
+            }
         }
     }
+    s.resync_all = false;
+    s.lost_peers.clear();
+    flushBatches(s);
 }
 
 void Processor::connectionReady(OpflexConnection* conn) {
-    uv_async_send(&connect_async);
+    for (std::unique_ptr<Shard>& s : shards) {
+        {
+            const std::lock_guard<std::mutex> lock(s->item_mutex);
+            s->resync_all = true;
+        }
+        uv_async_send(&s->connect_async);
+    }
 }
 
-void Processor::responseReceived(uint64_t reqId) {
-    const std::lock_guard<std::mutex> lock(item_mutex);
-    obj_state_by_xid& xid_index = obj_state.get<xid_tag>();
+void Processor::connectionLost(OpflexConnection* conn) {
+    if (!pool.isLoadSharing() || !proc_active) return;
+    auto cconn = static_cast<OpflexClientConnection*>(conn);
+    OpflexPool::peer_name_t peer(cconn->getHostname(), cconn->getPort());
+    for (std::unique_ptr<Shard>& s : shards) {
+        {
+            const std::lock_guard<std::mutex> lock(s->item_mutex);
+            s->lost_peers.push_back(peer);
+        }
+        uv_async_send(&s->connect_async);
+    }
+}
+
+boost::optional<uint64_t> Processor::responseReceived(uint64_t reqId) {
+    // the request may have been sent for an item in any shard
+    boost::optional<uint64_t> latency;
+    for (std::unique_ptr<Shard>& s : shards) {
+        boost::optional<uint64_t> l = responseReceived(*s, reqId);
+        if (l) latency = l;
+    }
+    return latency;
+}
+
+boost::optional<uint64_t> Processor::responseReceived(Shard& s,
+                                                      uint64_t reqId) {
+    const std::lock_guard<std::mutex> lock(s.item_mutex);
+    obj_state_by_xid& xid_index = s.obj_state.get<xid_tag>();
     obj_state_by_xid::iterator xi0,xi1;
     boost::tuples::tie(xi0,xi1)=xid_index.equal_range(reqId);
 
@@ -748,23 +1629,36 @@ void Processor::responseReceived(uint64_t reqId) {
         ++xi0;
     }
 
-    obj_state_by_uri& uri_index = obj_state.get<uri_tag>();
+    obj_state_by_uri& uri_index = s.obj_state.get<uri_tag>();
 
+    boost::optional<uint64_t> latency;
     for (const URI& uri : items) {
         obj_state_by_uri::iterator uit = uri_index.find(uri);
         if (uit == uri_index.end()) continue;
 
+        // every item in a request shares the send time, so one sample
+        // is taken per request
+        if (!latency && uit->details->resolve_time > 0)
+            latency = updateLatency(uit->details->resolve_time);
+
+        if (latency) {
+            auto rl = resolveLatency.find(uit->details->class_id);
+            if (rl != resolveLatency.end())
+                rl->second->observe(latency.get());
+        }
+
         if (uit->details->pending_reqs > 0)
             uit->details->pending_reqs -= 1;
 
         if (uit->details->pending_reqs == 0) {
             // All peers responded to the message
             uit->details->retry_count = 0;
-            uri_index.modify(uit,
-                             change_expiration(uit->details->resolve_time +
-                                               uit->details->refresh_rate));
+            uit->details->stale = false;
+            setExpiration(s, uit, uit->details->resolve_time +
+                          uit->details->refresh_rate);
         }
     }
+    return latency;
 }
 
 } /* namespace engine */
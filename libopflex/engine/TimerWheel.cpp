@@ -0,0 +1,108 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for TimerWheel
+ *
+ * Copyright (c) 2014 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "opflex/engine/internal/TimerWheel.h"
+
+namespace opflex {
+namespace engine {
+namespace internal {
+
+using modb::URI;
+
+TimerWheel::TimerWheel(uint64_t now)
+    : current(now), count(0) {}
+
+void TimerWheel::reset(uint64_t now) {
+    for (size_t level = 0; level < LEVELS; ++level) {
+        for (size_t i = 0; i < SLOTS; ++i)
+            slots[level][i].clear();
+    }
+    ready.clear();
+    current = now;
+    count = 0;
+}
+
+void TimerWheel::schedule(const URI& uri, uint64_t expiration) {
+    insert({uri, expiration});
+    count += 1;
+}
+
+// place an entry in the lowest level whose span covers its
+// expiration.  Entries beyond the span of the top level are placed in
+// its last slot and reinserted when that slot is cascaded.
+void TimerWheel::insert(const entry& e) {
+    if (e.expiration < current) {
+        ready.push_back(e);
+        return;
+    }
+
+    uint64_t tick = e.expiration;
+    const uint64_t max_delta = ((uint64_t)1 << (SLOT_BITS * LEVELS)) - 1;
+    if (tick - current > max_delta)
+        tick = current + max_delta;
+
+    uint64_t delta = tick - current;
+    size_t level = 0;
+    while (level < LEVELS - 1 &&
+           delta >= ((uint64_t)1 << (SLOT_BITS * (level + 1))))
+        level += 1;
+
+    size_t index = (tick >> (SLOT_BITS * level)) & (SLOTS - 1);
+    slots[level][index].push_back(e);
+}
+
+void TimerWheel::advance(uint64_t now) {
+    while (current <= now) {
+        // nothing left in the slots, so skip directly to now
+        if (ready.size() == count) {
+            current = now + 1;
+            break;
+        }
+
+        // when the lower levels wrap, move the next slot of the level
+        // above down into the lower levels
+        for (size_t level = 1; level < LEVELS; ++level) {
+            if ((current & (((uint64_t)1 << (SLOT_BITS * level)) - 1)) != 0)
+                break;
+            size_t index = (current >> (SLOT_BITS * level)) & (SLOTS - 1);
+            slot_t cascade;
+            cascade.swap(slots[level][index]);
+            for (const entry& e : cascade)
+                insert(e);
+        }
+
+        slot_t& slot = slots[0][current & (SLOTS - 1)];
+        ready.insert(ready.end(), slot.begin(), slot.end());
+        slot.clear();
+        current += 1;
+    }
+}
+
+bool TimerWheel::pop(uint64_t now, /* out */ URI& uri,
+                     /* out */ uint64_t& expiration) {
+    advance(now);
+    if (ready.empty()) return false;
+
+    uri = ready.front().uri;
+    expiration = ready.front().expiration;
+    ready.pop_front();
+    count -= 1;
+    return true;
+}
+
+} /* namespace internal */
+} /* namespace engine */
+} /* namespace opflex */
@@ -15,6 +15,9 @@
 #define ENGINE_INSPECTORCLIENTIMPL_H
 
 #include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
 
 #include "opflex/ofcore/InspectorClient.h"
 #include "opflex/modb/internal/ObjectStore.h"
@@ -27,6 +30,8 @@ namespace opflex {
 namespace engine {
 
 class Cmd;
+class Query;
+class Watch;
 
 /**
  * Inspect the state of a a managed object database using the
@@ -65,6 +70,21 @@ public:
      */
     internal::InspectorClientConn& getConn() { return conn; }
 
+    /**
+     * Get the number of pages of paged class queries received so far
+     *
+     * @return the number of pages
+     */
+    size_t getPagesReceived() const { return pagesReceived; }
+
+    /**
+     * Get the number of objects received in the pages of paged class
+     * queries so far, counting an object as often as it is received
+     *
+     * @return the number of objects
+     */
+    size_t getPagedObjectsReceived() const { return pagedObjectsReceived; }
+
     // ***************
     // InspectorClient
     // ***************
@@ -72,17 +92,31 @@ public:
     virtual void setFollowRefs(bool enabled);
     virtual void setRecursive(bool enabled);
     virtual void setUnresolved(bool enabled);
+    virtual void setDepth(size_t depth);
+    virtual void addChildClass(const std::string& subject);
+    virtual void addFilter(const std::string& property,
+                           const std::string& value);
+    virtual void setPageSize(size_t size);
     virtual void addQuery(const std::string& subject,
                           const modb::URI& uri);
     virtual void addClassQuery(const std::string& subject);
+    virtual void addStoreStatsQuery();
+    virtual void addWatch(const std::string& subject,
+                          const std::string& uriPrefix,
+                          std::ostream& output,
+                          bool includeProps = false,
+                          size_t interval = 1000);
     virtual void execute();
     virtual void dumpToFile(FILE* file);
     virtual size_t loadFromFile(FILE* file);
+    virtual bool dumpToImage(FILE* file);
+    virtual size_t loadFromImage(const std::string& file);
     virtual void prettyPrint(std::ostream& output,
                              bool tree = true,
                              bool includeProps = true,
                              bool utf8 = true,
                              size_t truncate = 0);
+    virtual void printStoreStats(std::ostream& output);
 
     // **************
     // HandlerFactory
@@ -105,15 +139,46 @@ private:
     modb::ObjectStore db;
     internal::MOSerializer serializer;
     modb::mointernal::StoreClient* storeClient;
+    modb::class_stats_map_t storeStats;
 
     std::list<Cmd*> commands;
     unsigned int pendingRequests;
     bool followRefs;
     bool recursive;
     bool unresolved;
+    size_t depth;
+    std::vector<std::string> childClasses;
+    std::vector<std::pair<std::string, std::string> > filters;
+    size_t pageSize;
+    size_t pagesReceived;
+    size_t pagedObjectsReceived;
+
+    uint64_t nextXid;
+    std::unordered_map<uint64_t, std::unique_ptr<Query> > pagedQueries;
+    std::unique_ptr<Watch> watch;
     friend class internal::InspectorClientHandler;
+    friend class Query;
+    friend class Watch;
 
     void executeCommands();
+
+    /**
+     * Request the next page of a paged class query
+     *
+     * @param reqId the request ID of the response
+     * @param result the result of the response
+     * @return true if another page was requested
+     */
+    bool continueQuery(uint64_t reqId, const rapidjson::Value& result);
+
+    /**
+     * Print the changes in a watch response and schedule the next
+     * poll
+     *
+     * @param result the result of the response
+     * @return true if another poll was scheduled
+     */
+    bool continueWatch(const rapidjson::Value& result);
 };
 
 } /* namespace engine */
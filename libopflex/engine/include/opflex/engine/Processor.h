@@ -16,12 +16,18 @@
 #define OPFLEX_ENGINE_PROCESSOR_H
 
 #include <vector>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <mutex>
+#include <memory>
+#include <random>
 
 #include <boost/atomic.hpp>
+#include <boost/optional.hpp>
+#include <boost/noncopyable.hpp>
 #include <boost/multi_index_container.hpp>
-#include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/member.hpp>
 #include <uv.h>
@@ -33,8 +39,11 @@
 #include "opflex/engine/internal/OpflexHandler.h"
 #include "opflex/engine/internal/MOSerializer.h"
 #include "opflex/engine/internal/AbstractObjectListener.h"
+#include "opflex/engine/internal/TimerWheel.h"
+#include "opflex/engine/internal/FairScheduler.h"
 
 #include "opflex/util/ThreadManager.h"
+#include "opflex/ofcore/OFAgentStats.h"
 
 namespace opflex {
 namespace engine {
@@ -176,6 +185,51 @@ public:
      */
     bool isObjNew(const modb::URI& uri);
 
+    /**
+     * Get the number of items tracked by the processor in each item
+     * state, so that the depth of the processing backlog can be
+     * monitored
+     *
+     * @param counts a map from the name of each item state to the
+     * number of items in that state.  The number of items loaded
+     * from the policy cache and not yet confirmed by a peer is
+     * included as "stale".
+     */
+    void getItemStateCounts(/* out */ std::unordered_map<std::string,
+                                                         uint64_t>& counts);
+
+    /**
+     * Get the smoothed latency of responses from the peers to
+     * requests sent by the processor
+     *
+     * @return the latency in milliseconds
+     */
+    uint64_t getResponseLatency() const { return responseLatency; }
+
+    /**
+     * Get the number of items sent again because a peer became ready
+     * or was lost
+     */
+    uint64_t getResyncCount() const { return resyncCount; }
+
+    /**
+     * Get the histogram of the time spent processing each item
+     *
+     * @return the histogram, in microseconds
+     */
+    const OFLatencyHistogram& getProcessTime() const { return processTime; }
+
+    /**
+     * Get the histograms of the latency of policy resolution for
+     * each policy class, from sending a resolve request to receiving
+     * its response.  Populated when the processor is started.
+     *
+     * @param latency a map from class name to the histogram for that
+     * class, in milliseconds
+     */
+    void getResolveLatency(/* out */ std::unordered_map<std::string,
+                           std::shared_ptr<const OFLatencyHistogram> >& latency);
+
     /**
      * Set the processing delay for unit tests
      */
@@ -191,6 +245,17 @@ public:
      */
     void setPrrTimerDuration(const uint64_t duration);
 
+    /**
+     * Set the number of threads processing managed object state.
+     * Objects are partitioned across the threads by URI.  Must be
+     * called before start().
+     *
+     * @param threads the number of processing threads
+     * @throws std::invalid_argument if threads is zero
+     * @throws std::logic_error if the processor is already started
+     */
+    void setProcessingThreads(size_t threads);
+
     /**
      * Get the peer handshake timeout
      */
@@ -218,12 +283,85 @@ public:
     void setKeepaliveTimeout(const uint32_t timeout) {
         keepaliveTimeout = timeout;
     }
+
+    /**
+     * Get the send high watermark for the connections to the peers
+     */
+    size_t getHighWatermark() const {
+        return highWatermark;
+    }
+
+    /**
+     * Get the send low watermark for the connections to the peers
+     */
+    size_t getLowWatermark() const {
+        return lowWatermark;
+    }
+
+    /**
+     * Set the send watermarks for the connections to the peers
+     */
+    void setWatermarks(size_t high, size_t low) {
+        highWatermark = high;
+        lowWatermark = low;
+    }
 \
     /**
      * Set the prr timer duration in secs
      */
     uint64_t getPrrTimerDuration() { return prrTimerDuration; }
 
+    /**
+     * Set the lease to request for the declarations of local
+     * endpoints, in seconds.  A lease longer than the prr timer
+     * duration is requested from the peers in the identity exchange
+     * and used only once a peer grants it.
+     *
+     * @param lease the lease in seconds, or zero to use the prr timer
+     * duration
+     */
+    void setEndpointLease(uint64_t lease) { endpointLease = lease; }
+
+    /**
+     * Get the endpoint lease requested from the peers, or zero if
+     * none is requested
+     */
+    uint64_t getRequestedLease() {
+        uint64_t lease = endpointLease;
+        return lease > prrTimerDuration ? lease : 0;
+    }
+
+    /**
+     * Get the lease of the declarations of local endpoints in
+     * seconds: the shortest lease granted by the ready peers, or else
+     * the prr timer duration when a ready peer did not grant one
+     */
+    uint64_t getEndpointLease() {
+        uint64_t lease = pool.getGrantedLease();
+        return lease ? lease : prrTimerDuration;
+    }
+
+    /**
+     * Get the time of the next renewal of a local endpoint declared
+     * at the given time: halfway through the lease, rounded down to
+     * the start of a renewal bucket
+     *
+     * @param curTime the time of the declaration in milliseconds
+     * @return the time of the renewal in milliseconds
+     */
+    uint64_t getRenewalTime(uint64_t curTime);
+
+    /**
+     * Set the number of renewal buckets.  Local endpoints are
+     * redeclared halfway through their lease, rounded down to the
+     * start of one of this many buckets over half the lease, so that
+     * the endpoints due in a bucket are renewed with one declare.
+     *
+     * @param buckets the number of buckets, or zero to renew each
+     * endpoint on its own timer
+     */
+    void setRenewalBuckets(size_t buckets) { renewalBuckets = buckets; }
+
     // See HandlerFactory::newHandler
     virtual
     internal::OpflexHandler* newHandler(internal::OpflexConnection* conn);
@@ -240,13 +378,31 @@ public:
      */
     void connectionReady(internal::OpflexConnection* conn);
 
+    /**
+     * A ready client connection was lost.  When load sharing, the
+     * subjects it served are sent again to the remaining peers.
+     * @param conn the connection object
+     */
+    void connectionLost(internal::OpflexConnection* conn);
+
     /**
      * Called when a response to a message sent from the processor is
      * received
      *
      * @param reqId the ID of the request
+     * @return the latency of the response in milliseconds, if the
+     * request was sent for items tracked by the processor
      */
-    void responseReceived(uint64_t reqId);
+    boost::optional<uint64_t> responseReceived(uint64_t reqId);
+
+    /**
+     * Called when a peer refuses a request sent from the processor
+     * because it is overloaded.  The items of the request stay
+     * pending and are retried with the usual backoff, and the refusal
+     * counts as a slow response so that the retries back off further
+     * for as long as the peer stays overloaded.
+     */
+    void responseBusy();
 
     /**
      * Set the tunnelMac to send to opflex registries as the parent of
@@ -277,6 +433,68 @@ public:
      */
     void disableObservableReporting();
 
+    /**
+     * Set the minimum interval between state reports for an object
+     * of any observable class.  Changes made within the interval are
+     * coalesced into a single report.  The default of zero reports
+     * each change after the processing delay.
+     *
+     * @param interval the interval in milliseconds
+     */
+    void setStateReportInterval(uint64_t interval);
+
+    /**
+     * Set the minimum interval between state reports for objects of
+     * a specific observable class, overriding the interval set with
+     * setStateReportInterval().  Must be called before start().
+     *
+     * @param class_id Observable class ID
+     * @param interval the interval in milliseconds
+     */
+    void overrideStateReportInterval(modb::class_id_t class_id,
+                                     uint64_t interval);
+
+    /**
+     * Set the approximate number of bytes of state reports that may
+     * be sent to each observer peer per second.  Reports over the
+     * budget are delayed until it refills.  Zero, the default, means
+     * no limit.
+     *
+     * @param bytesPerSecond the budget in bytes per second
+     */
+    void setStateReportBudget(uint64_t bytesPerSecond);
+
+    /**
+     * Keep a cache of the resolved policy on disk so that a restarted
+     * processor can use the policy right away while it is resolved
+     * again from the peers.  The cache is loaded when the processor
+     * is started, written periodically while it runs and written
+     * again when it is stopped.  Objects loaded from the cache are
+     * marked stale until a peer responds to a resolve request for
+     * them.
+     *
+     * @param file the path to the cache file, or an empty string to
+     * disable the cache
+     * @param interval the interval between writes of the cache in
+     * milliseconds, or zero to write it only when the processor is
+     * stopped.  Takes effect when the processor is started.
+     */
+    void setPolicyCache(const std::string& file, uint64_t interval);
+
+    /**
+     * Resolve remote objects before anything references them.  The
+     * objects that are not yet tracked are resolved in the next
+     * batch of requests and kept for the hold time even if nothing
+     * references them, so that a reference made in the meantime
+     * finds them already resolved.
+     *
+     * @param refs the class IDs and URIs of the objects
+     * @param holdTime the time to keep unreferenced objects in
+     * milliseconds
+     */
+    void prefetch(const std::vector<modb::reference_t>& refs,
+                  uint64_t holdTime);
+
 private:
     /**
      * The system store client
@@ -301,7 +519,7 @@ private:
     /**
      * Request ID counter
      */
-    uint64_t nextXid;
+    boost::atomic<uint64_t> nextXid;
 
     /**
      * Override whether observable is reportable
@@ -313,6 +531,66 @@ private:
       */
      bool reportObservables;
 
+    /**
+     * Minimum interval between state reports for an observable
+     */
+    boost::atomic<uint64_t> stateReportInterval{0};
+
+    /**
+     * Per-class overrides of the state report interval
+     */
+    std::unordered_map<modb::class_id_t, uint64_t> reportIntervals;
+
+    /**
+     * Token bucket limiting the bytes of state reports sent per
+     * second.  Protected by report_mutex.
+     */
+    uint64_t reportBudget;
+    double reportTokens;
+    uint64_t reportTokenTime;
+    std::mutex report_mutex;
+
+    /**
+     * Path to the policy cache and the interval between writes.
+     * Protected by cache_mutex, which also serializes taking the
+     * contents of the cache.
+     */
+    std::string policyCacheFile;
+    uint64_t policyCacheInterval;
+    std::mutex cache_mutex;
+
+    /**
+     * The sequence number of the last contents taken for the cache,
+     * and whether a write of them is still queued on the thread pool.
+     * Protected by cache_mutex.
+     */
+    uint64_t cache_seq;
+    bool cache_write_pending;
+
+    /**
+     * The sequence number of the contents last written to the cache
+     * file, so that a late write never replaces newer contents.
+     * Protected by cache_write_mutex, which serializes the writes.
+     */
+    uint64_t cache_written_seq;
+    std::mutex cache_write_mutex;
+
+    struct CacheWrite;
+
+    /**
+     * Timer for writing the policy cache, run on the loop of the
+     * first shard
+     */
+    uv_timer_t cache_timer;
+    bool cache_timer_active;
+
+    /**
+     * The loop time until which stale objects loaded from the policy
+     * cache are kept even if nothing references them, so that the
+     * local policy has time to reference them after a restart
+     */
+    boost::atomic<uint64_t> cacheHoldUntil{0};
+
     /**
      * The status of items in the MODB with respect to the opflex
      * protocol
@@ -399,6 +677,31 @@ private:
          * Number of retries for this item
          */
         uint16_t retry_count;
+
+        /**
+         * The state of an observable when it was last reported, used
+         * to skip reports of unchanged state
+         */
+        std::shared_ptr<const modb::mointernal::ObjectInstance> reported;
+
+        /**
+         * Whether the item was loaded from the policy cache and not
+         * yet confirmed by a peer
+         */
+        bool stale;
+
+        /**
+         * Whether garbage collection found the item orphaned, so
+         * that processing it need not walk its ancestors again.
+         * Cleared when a reference to the item is added.
+         */
+        bool orphan;
+
+        /**
+         * The time until which an item that was prefetched is kept
+         * even if nothing references it
+         */
+        uint64_t hold_until;
     };
 
     /**
@@ -424,6 +727,9 @@ private:
             details->resolve_time = 0;
             details->pending_reqs = 0;
             details->retry_count = 0;
+            details->stale = false;
+            details->orphan = false;
+            details->hold_until = 0;
         }
         ~item() { if (details) delete details; }
         item& operator=( const item& rhs ) {
@@ -458,9 +764,7 @@ private:
         item_details* details;
     };
 
-    // tag for expiration index
-    struct expiration_tag{};
-    // tag for expiration index
+    // tag for uri index
     struct uri_tag{};
     // tag for xid index
     struct xid_tag{};
@@ -477,16 +781,10 @@ private:
                 boost::multi_index::tag<xid_tag>,
                 boost::multi_index::member<item,
                                            uint64_t,
-                                           &item::last_xid> > ,
-            boost::multi_index::ordered_non_unique<
-                boost::multi_index::tag<expiration_tag>,
-                boost::multi_index::member<item,
-                                           uint64_t,
-                                           &item::expiration> >
+                                           &item::last_xid> >
             >
         > object_state_t;
 
-    typedef object_state_t::index<expiration_tag>::type obj_state_by_exp;
     typedef object_state_t::index<uri_tag>::type obj_state_by_uri;
     typedef object_state_t::index<xid_tag>::type obj_state_by_xid;
 
@@ -516,10 +814,169 @@ private:
     };
 
     /**
-     * Store and index the state of managed objects
+     * The types of request that are batched by the processor
+     */
+    enum batch_type_t {
+        /** policy_resolve requests */
+        BATCH_POLICY_RESOLVE,
+        /** endpoint_resolve requests */
+        BATCH_ENDPOINT_RESOLVE,
+        /** endpoint_declare requests */
+        BATCH_ENDPOINT_DECLARE,
+        /** state_report requests */
+        BATCH_STATE_REPORT,
+        /** the number of batch types */
+        BATCH_TYPES
+    };
+
+    /**
+     * Subjects of one request type accumulated while processing a
+     * shard, so that they can be sent to the peers in one message
+     */
+    struct request_batch {
+        request_batch() : bytes(0) {}
+
+        /**
+         * The subjects to include in the request
+         */
+        std::vector<modb::reference_t> refs;
+
+        /**
+         * An estimate of the size of the subjects in the request
+         */
+        size_t bytes;
+    };
+
+    /**
+     * Priority classes for expired items.  Items in each class are
+     * served in expiration order, and the classes share the
+     * processing loop by weighted round robin.
      */
-    object_state_t obj_state;
-    std::mutex item_mutex;
+    enum priority_t {
+        /** policy resolution, needed to forward traffic */
+        PRIORITY_POLICY,
+        /** endpoint declarations and resolutions */
+        PRIORITY_ENDPOINT,
+        /** observables, state reports and everything else */
+        PRIORITY_BACKGROUND,
+        /** the number of priority classes */
+        PRIORITY_CLASSES
+    };
+
+    /**
+     * An expired item waiting to be processed
+     */
+    struct ready_item {
+        /** the URI of the item */
+        modb::URI uri;
+        /** the expiration the item was scheduled with */
+        uint64_t expiration;
+    };
+
+    /**
+     * A partition of the managed object state.  Each shard has its
+     * own index and lock, and is processed on its own thread.
+     */
+    class Shard : private boost::noncopyable {
+    public:
+        Shard(Processor* processor, size_t index);
+
+        /**
+         * The processor that owns the shard
+         */
+        Processor* processor;
+
+        /**
+         * The name of the processing task for the shard
+         */
+        std::string taskName;
+
+        /**
+         * Store and index the state of managed objects
+         */
+        object_state_t obj_state;
+        std::mutex item_mutex;
+
+        /**
+         * Schedule of item expirations, in the time of the
+         * processing loop
+         */
+        internal::TimerWheel wheel;
+
+        /**
+         * Requests waiting to be sent, by type.  Protected by
+         * item_mutex.
+         */
+        request_batch batches[BATCH_TYPES];
+
+        /**
+         * Expired items waiting to be processed, by priority class
+         */
+        std::deque<ready_item> ready[PRIORITY_CLASSES];
+
+        /**
+         * Share the processing loop between the priority classes
+         */
+        internal::WeightedRoundRobin classes;
+
+        /**
+         * Whether every item must be sent again because a peer became
+         * ready, and the peers lost since the connections were last
+         * handled, whose subjects must be sent to the remaining peers.
+         * Protected by item_mutex.
+         */
+        bool resync_all;
+        std::vector<internal::OpflexPool::peer_name_t> lost_peers;
+
+        /**
+         * Roots of the policy loaded from the policy cache that are
+         * not yet tracked
+         */
+        std::unordered_set<modb::URI> cached;
+
+        /**
+         * Items whose reference count dropped to zero, waiting to be
+         * checked for garbage collection
+         */
+        std::deque<modb::URI> gc_candidates;
+
+        /**
+         * Random source for PRR timer jitter
+         */
+        std::mt19937 gen;
+
+        /**
+         * Processing thread
+         */
+        uv_loop_t* proc_loop;
+        uv_async_t cleanup_async;
+        uv_async_t proc_async;
+        uv_async_t connect_async;
+        uv_timer_t proc_timer;
+    };
+
+    /**
+     * The shards, indexed by URI hash
+     */
+    std::vector<std::unique_ptr<Shard> > shards;
+
+    /**
+     * Get the shard responsible for the given URI
+     */
+    Shard& getShard(const modb::URI& uri);
+
+    /**
+     * A change to the reference count of an item that is made after
+     * the lock of the current shard is released, since the item may
+     * belong to another shard
+     */
+    struct ref_update {
+        /** the referenced item */
+        modb::reference_t ref;
+        /** true to add a reference, false to remove one */
+        bool add;
+    };
+    typedef std::vector<ref_update> ref_updates_t;
 
     /**
      * Processing delay to allow batching updates
@@ -537,46 +994,107 @@ private:
     static const uint64_t DEFAULT_PRR_TIMER_DURATION = 7200;
     uint64_t prrTimerDuration = DEFAULT_PRR_TIMER_DURATION;
 
+    /**
+     * Endpoint lease requested from the peers in secs, and the number
+     * of renewal buckets
+     */
+    static const size_t DEFAULT_RENEWAL_BUCKETS = 16;
+    boost::atomic<uint64_t> endpointLease{0};
+    boost::atomic<size_t> renewalBuckets{DEFAULT_RENEWAL_BUCKETS};
+
     uint32_t peerHandshakeTimeout = 45000;
     uint32_t keepaliveTimeout = 120000;
+    size_t highWatermark = internal::OpflexConnection::DEFAULT_HIGH_WATERMARK;
+    size_t lowWatermark = internal::OpflexConnection::DEFAULT_LOW_WATERMARK;
 
     /**
      *  policy refresh timer duration in msecs
      */
-    uint64_t policyRefTimerDuration = 1000*DEFAULT_PRR_TIMER_DURATION/2;
+    boost::atomic<uint64_t>
+        policyRefTimerDuration{1000*DEFAULT_PRR_TIMER_DURATION/2};
+
+    /**
+     * Exponentially-weighted moving average of the response latency
+     * from the peers in milliseconds, used to scale retry delays when
+     * the peers are slow
+     */
+    boost::atomic<uint64_t> responseLatency{0};
+
+    /**
+     * Number of items sent again when the connections changed
+     */
+    boost::atomic<uint64_t> resyncCount{0};
+
+    /**
+     * Time spent processing each item, in microseconds
+     */
+    OFLatencyHistogram processTime;
 
     /**
-     * Processing thread
+     * Resolve latency for each policy class, in milliseconds.  Only
+     * modified in start().
      */
-    uv_loop_t* proc_loop;
+    std::unordered_map<modb::class_id_t,
+                       std::shared_ptr<OFLatencyHistogram> > resolveLatency;
+
     boost::atomic<bool> proc_active;
-    uv_async_t cleanup_async;
-    uv_async_t proc_async;
-    uv_async_t connect_async;
-    uv_timer_t proc_timer;
 
     static void timer_callback(uv_timer_t* handle);
     static void cleanup_async_cb(uv_async_t *handle);
     static void proc_async_cb(uv_async_t *handle);
     static void connect_async_cb(uv_async_t *handle);
-
-    bool hasWork(/* out */ obj_state_by_exp::iterator& it);
-    void addRef(obj_state_by_exp::iterator& it,
-                const modb::reference_t& up);
-    void removeRef(obj_state_by_exp::iterator& it,
-                   const modb::reference_t& up);
-    void processItem(obj_state_by_exp::iterator& it);
-    bool isOrphan(const item& item);
+    static void cache_timer_cb(uv_timer_t* handle);
+
+    bool hasWork(Shard& s, /* out */ obj_state_by_uri::iterator& it);
+    priority_t getPriority(const item& i);
+    void setExpiration(Shard& s, obj_state_by_uri::iterator& it,
+                       uint64_t expiration);
+    void addRef(Shard& s, obj_state_by_uri::iterator& it,
+                const modb::reference_t& up,
+                /* out */ ref_updates_t& deferred);
+    void removeRef(Shard& s, obj_state_by_uri::iterator& it,
+                   const modb::reference_t& up,
+                   /* out */ ref_updates_t& deferred);
+    void incRef(Shard& s, const modb::reference_t& up,
+                const modb::URI& from);
+    void decRef(Shard& s, const modb::reference_t& up,
+                const modb::URI& from, uint64_t curTime);
+    void applyRefUpdates(Shard& s, const modb::URI& from,
+                         const ref_updates_t& updates);
+    uint64_t updateLatency(uint64_t sendTime);
+    void foldLatency(uint64_t sample);
+    void processItem(Shard& s, obj_state_by_uri::iterator& it);
+    bool isOrphan(modb::class_id_t class_id, const modb::URI& uri,
+                  bool local, size_t refcount);
     bool isParentSyncObject(const item& item);
-    void doProcess();
-    void sendToRole(const item& it, uint64_t& newexp,
-                    internal::OpflexMessage* req,
-                    ofcore::OFConstants::OpflexRole role);
-    bool resolveObj(modb::ClassInfo::class_type_t type, const item& it,
-                    uint64_t& newexp, bool checkTime = true);
-    bool declareObj(modb::ClassInfo::class_type_t type, const item& it,
-                    uint64_t& newexp);
-    void handleNewConnections();
+    bool isHeld(const item_details& details);
+    void loadPolicyCache();
+    void writePolicyCache(bool async = false);
+    size_t serializePolicyCache(std::string& out);
+    void storePolicyCache(const std::string& file, const std::string& data,
+                          uint64_t seq, size_t count);
+    void collectGarbage(Shard& s);
+    void doProcess(Shard& s);
+    void queueRequest(Shard& s, batch_type_t type, const item& it);
+    ofcore::OFConstants::OpflexRole getBatchRole(batch_type_t type);
+    void sendRequest(Shard& s, batch_type_t type,
+                     const std::vector<modb::reference_t>& refs,
+                     const internal::OpflexPool::peer_name_t* peer);
+    void flushBatch(Shard& s, batch_type_t type);
+    void flushBatches(Shard& s);
+    bool resolveObj(Shard& s, modb::ClassInfo::class_type_t type,
+                    const item& it, bool checkTime = true);
+    bool declareObj(Shard& s, modb::ClassInfo::class_type_t type,
+                    const item& it, uint64_t& newexp,
+                    bool checkChanged = true);
+    uint64_t getReportInterval(modb::class_id_t class_id);
+    bool reserveReportBytes(uint64_t curTime, size_t bytes,
+                            /* out */ uint64_t& wait);
+    void handleNewConnections(Shard& s);
+    void resyncItem(Shard& s, const item& i);
+    static ofcore::OFConstants::OpflexRole
+    getResyncRole(modb::ClassInfo::class_type_t type, ItemState state);
+    boost::optional<uint64_t> responseReceived(Shard& s, uint64_t reqId);
 };
 
 } /* namespace engine */
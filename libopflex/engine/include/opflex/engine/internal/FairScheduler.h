@@ -0,0 +1,192 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*!
+ * @file FairScheduler.h
+ * @brief Interface definition file for TokenBucket, FairScheduler and
+ * WeightedRoundRobin
+ */
+/*
+ * Copyright (c) 2014 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEX_ENGINE_FAIRSCHEDULER_H
+#define OPFLEX_ENGINE_FAIRSCHEDULER_H
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+namespace opflex {
+namespace engine {
+namespace internal {
+
+/**
+ * A token bucket that limits the rate at which a peer may consume
+ * some resource.  The bucket fills at a fixed rate up to a burst size,
+ * and each request takes its cost out of the bucket.  A request that
+ * finds the bucket empty is refused.
+ *
+ * The bucket is not thread safe.
+ */
+class TokenBucket {
+public:
+    /**
+     * Construct a token bucket that starts full
+     *
+     * @param rate the rate at which the bucket fills, per second, or
+     * zero for no limit
+     * @param burst the maximum number of tokens in the bucket
+     */
+    TokenBucket(double rate = 0, double burst = 0);
+
+    /**
+     * Take tokens out of the bucket.  A request is allowed as long as
+     * the bucket is not empty, so a request that costs more than the
+     * burst is allowed when the bucket is full, and is paid for by
+     * the requests that follow it.
+     *
+     * @param cost the number of tokens to take
+     * @param now the current time in milliseconds, such as the value
+     * of uv_now()
+     * @return true if the request is allowed, and false if it is
+     * refused, in which case no tokens are taken
+     */
+    bool take(double cost, uint64_t now);
+
+    /**
+     * Get the rate at which the bucket fills
+     */
+    double getRate() const { return rate; }
+
+private:
+    double rate;
+    double burst;
+    double tokens;
+    uint64_t last;
+    bool started;
+};
+
+/**
+ * Run jobs queued by many sources on a pool of threads with deficit
+ * round robin, so that a source that queues many expensive jobs gets
+ * its fair share of the threads instead of delaying the jobs of every
+ * other source behind its own.
+ *
+ * Each job returns its cost, such as the number of bytes that it
+ * produced.  A source with queued jobs is given a quantum of credit
+ * each time its turn comes, and runs jobs until the cost of the jobs
+ * has used up its credit.  A source that has no more jobs loses its
+ * remaining credit.  Since the cost is only known once the job has
+ * run, a job is charged the cost of the previous job of its source
+ * when it is picked, and the difference is settled when it
+ * completes.
+ *
+ * The methods are thread safe.
+ */
+class FairScheduler : private boost::noncopyable {
+public:
+    /**
+     * A job to run, which returns its cost
+     */
+    typedef std::function<size_t()> job_t;
+
+    /**
+     * Construct a scheduler
+     *
+     * @param quantum the credit given to a source in each round
+     */
+    explicit FairScheduler(size_t quantum);
+
+    /**
+     * Queue a job for a source.  Post one call to runNext() for each
+     * job queued.
+     *
+     * @param source the source of the job
+     * @param job the job to run
+     */
+    void push(const void* source, const job_t& job);
+
+    /**
+     * Run the next job in deficit round robin order
+     *
+     * @return true if a job was run, or false if no job was queued
+     */
+    bool runNext();
+
+    /**
+     * Get the number of queued jobs
+     */
+    size_t size() const;
+
+private:
+    struct Source {
+        explicit Source(int64_t estimate_) : estimate(estimate_) {}
+
+        std::deque<job_t> jobs;
+        int64_t deficit = 0;
+        size_t running = 0;
+        // the cost charged for a job when it is picked, which is the
+        // cost of the last job of the source, or a quantum before
+        // the first one completes
+        int64_t estimate;
+    };
+
+    const int64_t quantum;
+    mutable std::mutex mutex;
+    std::unordered_map<const void*, Source> sources;
+    // the sources with queued jobs, in round robin order
+    std::deque<const void*> active;
+    size_t count;
+};
+
+/**
+ * Share a processing loop between classes of work by weighted round
+ * robin.  In each round a class with pending work is served as many
+ * times as its weight, and a class without work gives up the rest of
+ * its share, so that the heavier classes are served ahead of a
+ * backlog in the others without starving them.
+ *
+ * The scheduler is not thread safe.
+ */
+class WeightedRoundRobin {
+public:
+    /**
+     * Construct a scheduler
+     *
+     * @param weights the weight of each class
+     */
+    explicit WeightedRoundRobin(const std::vector<size_t>& weights);
+
+    /**
+     * Choose the class to serve next and use one of its credits
+     *
+     * @param pending a function that returns whether a class has
+     * work pending
+     * @return the class to serve, or -1 if no class has work
+     */
+    int next(const std::function<bool(size_t)>& pending);
+
+    /**
+     * Start a new round
+     */
+    void reset();
+
+private:
+    std::vector<size_t> weights;
+    std::vector<size_t> credits;
+};
+
+} /* namespace internal */
+} /* namespace engine */
+} /* namespace opflex */
+
+#endif /* OPFLEX_ENGINE_FAIRSCHEDULER_H */
@@ -18,11 +18,17 @@
 #include "opflex/engine/internal/OpflexHandler.h"
 #include "opflex/engine/internal/OpflexServerHandler.h"
 #include "opflex/modb/internal/ObjectStore.h"
+#include "opflex/yajr/rpc/send_handler.hpp"
 
 #include <mutex>
 #include <thread>
 #include <atomic>
+#include <vector>
+#include <list>
+#include <string>
+#include <unordered_map>
 #include <boost/asio.hpp>
+#include <boost/thread/shared_mutex.hpp>
 #include <boost/asio/io_service.hpp>
 #include <boost/asio/deadline_timer.hpp>
 
@@ -73,6 +79,93 @@ public:
                    const std::string& serverKeyPass,
                    bool verifyPeers);
 
+    /**
+     * Set the number of worker threads that serialize resolve
+     * responses.  With no workers, the default, responses are
+     * serialized on the listener thread.  Call before start()
+     *
+     * @param workers the number of worker threads
+     */
+    void setWorkers(size_t workers) { this->workers = workers; }
+
+    /**
+     * Get the number of worker threads that serialize resolve
+     * responses
+     */
+    size_t getWorkers() const { return workers; }
+
+    /**
+     * Set the number of event loops that serve agent connections.
+     * Connections are assigned to the loops round-robin.  Call
+     * before start()
+     *
+     * @param loops the number of event loops
+     */
+    void setLoops(size_t loops) { listener.setLoopCount(loops); }
+
+    /**
+     * Set the number of threads that parse a policy file
+     *
+     * @param threads the number of threads, or 0 for one per core
+     */
+    void setPolicyThreads(size_t threads) { policy_threads = threads; }
+
+    /**
+     * Set the maximum number of serialized policy subtrees kept to
+     * answer policy resolves.  The least recently used subtrees are
+     * evicted to make room, and start() enables the change journal
+     * of the store if it is disabled.  Setting it to zero disables
+     * the cache.  Call before start()
+     *
+     * @param size the maximum number of cached subtrees
+     */
+    void setResolveCacheSize(size_t size) { cache_size = size; }
+
+    /**
+     * Limit the rate of requests from each agent.  A request over the
+     * limit is refused with an EBUSY error, and the agent retries it
+     * later.  Each item in a request counts as one request.  Call
+     * before start()
+     *
+     * @param resolves the rate of policy and endpoint resolves per
+     * second, or zero for no limit
+     * @param declares the rate of endpoint declarations and
+     * undeclarations per second, or zero for no limit
+     * @param reports the rate of state reports per second, or zero
+     * for no limit
+     */
+    void setRequestLimits(double resolves, double declares, double reports) {
+        request_limits[OpflexServerHandler::RESOLVE] = resolves;
+        request_limits[OpflexServerHandler::DECLARE] = declares;
+        request_limits[OpflexServerHandler::STATE_REPORT] = reports;
+    }
+
+    /**
+     * Get the rate limit for a kind of request from each agent
+     *
+     * @param kind an OpflexServerHandler::request_kind_t
+     * @return the rate per second, or zero for no limit
+     */
+    double getRequestLimit(size_t kind) const {
+        return kind < OpflexServerHandler::REQUEST_KINDS
+            ? request_limits[kind] : 0;
+    }
+
+    /**
+     * Get the serialized subtree for a managed object, from the
+     * resolve cache if it is there.  Entries are invalidated using
+     * the change journal of the store when it is enabled, and
+     * otherwise whenever the store version changes.
+     *
+     * @param class_id the class of the object
+     * @param uri the URI of the object
+     * @return the object and its children, serialized so that they
+     * can be written to any connection
+     * @throws std::out_of_range if the object does not exist
+     */
+    std::shared_ptr<const yajr::rpc::PreparedValue>
+    getSerialized(modb::class_id_t class_id, const modb::URI& uri);
+
     /**
      * Start the server
      */
@@ -100,6 +193,15 @@ public:
      */
     void updatePolicy(rapidjson::Document& d, gbp::PolicyUpdateOp op);
 
+    /**
+     * Apply a batch of policy updates in order, and send the
+     * resulting updates once
+     *
+     * @param updates the updates to apply
+     */
+    void updatePolicy(const std::vector<test::GbpOpflexServer::policy_update_t>&
+                      updates);
+
     /**
      * Get the peers that this server was configured with
      *
@@ -149,6 +251,29 @@ public:
      */
     OpflexListener& getListener() { return listener; }
 
+    /**
+     * Get the lock that serializes policy writes.  Hold it
+     * exclusively while modifying the store.  Responses serialized by
+     * the workers read from a snapshot and do not take it.
+     */
+    boost::shared_mutex& getPolicyMutex() { return policy_mutex; }
+
+    /**
+     * Send a response that reads from the store.  With workers, the
+     * response is serialized on a worker thread against a snapshot
+     * of the store and queued to the connection, so the caller must
+     * not hold any lock on the listener.  A response that a policy
+     * update from a later version of the store overtakes while it is
+     * being serialized is serialized again.
+     *
+     * @param conn the connection to send to
+     * @param id the ID of the request being answered
+     * @param res the response to send.  Ownership is transferred.
+     */
+    void sendResponse(OpflexServerConnection* conn,
+                      const rapidjson::Value& id,
+                      OpflexMessage* res);
+
     /**
      * Dispatch a policy update to the attached clients
      */
@@ -215,6 +340,33 @@ private:
     std::unique_ptr<boost::asio::deadline_timer> prr_timer;
     int prr_interval_secs;
     std::mutex prr_timer_mutex;
+
+    size_t workers;
+    size_t policy_threads;
+    boost::asio::io_service worker_io;
+    std::unique_ptr<boost::asio::io_service::work> worker_work;
+    std::vector<std::thread> worker_threads;
+    boost::shared_mutex policy_mutex;
+    FairScheduler response_scheduler;
+    double request_limits[OpflexServerHandler::REQUEST_KINDS];
+
+    struct cache_entry_t {
+        modb::class_id_t class_id;
+        std::shared_ptr<const yajr::rpc::PreparedValue> json;
+        // the position of the entry in cache_lru
+        std::list<modb::URI>::iterator lru;
+    };
+    size_t cache_size;
+    std::mutex cache_mutex;
+    std::unordered_map<modb::URI, cache_entry_t> resolve_cache;
+    // the URIs of the cached subtrees, most recently used first
+    std::list<modb::URI> cache_lru;
+    uint64_t cache_version;
+    uint64_t cache_seq;
+
+    void syncCache();
+    void evictCached(const modb::URI& uri);
+    void eraseCached(const modb::URI& uri);
 };
 
 } /* namespace internal */
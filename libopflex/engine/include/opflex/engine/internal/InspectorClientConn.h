@@ -13,6 +13,8 @@
 
 #include "opflex/engine/internal/OpflexConnection.h"
 
+#include <functional>
+
 #pragma once
 #ifndef OPFLEX_ENGINE_INSPECTORCLIENTCONN_H
 #define OPFLEX_ENGINE_INSPECTORCLIENTCONN_H
@@ -53,6 +55,16 @@ public:
     virtual yajr::Peer* getPeer() { return peer; }
     virtual void messagesReady();
 
+    /**
+     * Call the given function from the connection's loop after the
+     * given delay, pushing back the operation timeout until then.
+     * Scheduling again replaces a call that has not been made yet.
+     *
+     * @param delay the delay in milliseconds
+     * @param fn the function to call
+     */
+    void schedule(uint64_t delay, const std::function<void()>& fn);
+
 private:
     const std::string& name;
 
@@ -60,11 +72,14 @@ private:
 
     uv_loop_t client_loop;
     uv_timer_t timer;
+    uv_timer_t poll_timer;
+    std::function<void()> pollFn;
     static uv_loop_t* loop_selector(void* data);
     static void on_state_change(yajr::Peer* p, void* data,
                                 yajr::StateChange::To stateChange,
                                 int error);
     static void on_timer(uv_timer_t* timer);
+    static void on_poll_timer(uv_timer_t* timer);
 };
 
 
@@ -68,7 +68,10 @@ private:
 
     void checkDone();
 
-    virtual void handlePolicyQueryRes(const rapidjson::Value& payload);
+    virtual void handlePolicyQueryRes(uint64_t reqId,
+                                      const rapidjson::Value& payload);
+    virtual void handleStoreStatsRes(const rapidjson::Value& payload);
+    virtual void handleWatchRes(const rapidjson::Value& payload);
 };
 
 } /* namespace internal */
@@ -16,11 +16,13 @@
 #define OPFLEX_ENGINE_INSPECTORSERVERHANDLER_H
 
 #include <string>
+#include <vector>
 
 #include <boost/noncopyable.hpp>
 #include <rapidjson/document.h>
 
 #include "opflex/engine/internal/OpflexHandler.h"
+#include "opflex/modb/URI.h"
 
 namespace opflex {
 namespace engine {
@@ -54,6 +56,18 @@ public:
      */ 
     static const std::string POLICY_QUERY;
 
+    /**
+     * A custom message type for a query of the per-class memory
+     * accounting of the object store
+     */
+    static const std::string STORE_STATS;
+
+    /**
+     * A custom message type for a request of the changes made to the
+     * object store since a change journal sequence number
+     */
+    static const std::string WATCH;
+
     // *************
     // OpflexHandler
     // *************
@@ -69,8 +83,24 @@ public:
 protected:
     Inspector* inspector;
 
+    /**
+     * The subjects and URIs of the queries of the paged policy query
+     * in progress
+     */
+    std::string pagedKey;
+
+    /**
+     * The sorted URIs of each query of the paged policy query in
+     * progress, from which its next page resumes
+     */
+    std::vector<std::vector<modb::URI> > pagedUris;
+
     virtual void handlePolicyQueryReq(const rapidjson::Value& id,
                                       const rapidjson::Value& payload);
+    virtual void handleStoreStatsReq(const rapidjson::Value& id,
+                                     const rapidjson::Value& payload);
+    virtual void handleWatchReq(const rapidjson::Value& id,
+                                const rapidjson::Value& payload);
 };
 
 } /* namespace internal */
@@ -11,14 +11,20 @@
  * and is available at http://www.eclipse.org/legal/epl-v10.html
  */
 
+#include <cstdio>
+#include <limits>
 #include <vector>
 #include <map>
+#include <unordered_set>
 
+#include <boost/atomic.hpp>
 #include <rapidjson/document.h>
 #include <rapidjson/writer.h>
 
 #include "opflex/modb/internal/ObjectStore.h"
+#include "opflex/modb/mo-internal/ClassCodec.h"
 #include "opflex/gbp/Policy.h"
+#include "opflex/gbp/PolicyObject.h"
 #include "opflex/logging/internal/logging.hpp"
 
 #ifndef OPFLEX_ENGINE_MOSERIALIZER_H
@@ -178,6 +184,10 @@ public:
      * @param client the store client to use to look up the data
      * @param writer the writer to write to
      * @param recursive serialize the children as well
+     * @param depth the number of levels of children to serialize
+     * when recursive
+     * @param classes if not NULL, only descend into the children of
+     * these classes when recursive
      * @throws std::out_of_range if there is no such managed object
      */
     template <typename T>
@@ -185,7 +195,10 @@ public:
                    const modb::URI& uri,
                    modb::mointernal::StoreClient& client,
                    T& writer,
-                   bool recursive = true) {
+                   bool recursive = true,
+                   size_t depth = std::numeric_limits<size_t>::max(),
+                   const std::unordered_set<modb::class_id_t>* classes =
+                   NULL) {
         const modb::ClassInfo& ci = store->getClassInfo(class_id);
         const std::shared_ptr<const modb::mointernal::ObjectInstance>
             oi(client.get(class_id, uri));
@@ -200,9 +213,14 @@ public:
 
         writer.String("properties");
         writer.StartArray();
+        bool encoded = encodeValues(ci, *oi, writer);
         const modb::ClassInfo::property_map_t& pmap = ci.getProperties();
         modb::ClassInfo::property_map_t::const_iterator pit;
         for (pit = pmap.begin(); pit != pmap.end(); ++pit) {
+            if (encoded &&
+                pit->second.getType() != modb::PropertyInfo::REFERENCE &&
+                pit->second.getType() != modb::PropertyInfo::COMPOSITE)
+                continue;
             if (pit->second.getType() != modb::PropertyInfo::COMPOSITE &&
                 !oi->isSet(pit->first, pit->second.getType(),
                            pit->second.getCardinality()))
@@ -320,9 +338,12 @@ public:
                 writer.EndObject();
                 break;
             case modb::PropertyInfo::COMPOSITE:
-                client.getChildren(class_id, uri, pit->first,
-                                   pit->second.getClassId(),
-                                   children[pit->second.getClassId()]);
+                {
+                    std::vector<modb::URI>& cl =
+                        children[pit->second.getClassId()];
+                    client.getChildren(class_id, uri, pit->first,
+                                       pit->second.getClassId(), cl);
+                }
                 break;
             }
         }
@@ -360,11 +381,14 @@ public:
         }
 
         writer.EndObject();
-        if (recursive) {
+        if (recursive && depth > 0) {
             for (clsit = children.begin(); clsit != children.end(); ++clsit) {
+                if (classes && classes->find(clsit->first) == classes->end())
+                    continue;
                 for (cit = clsit->second.begin();
                      cit != clsit->second.end(); ++cit) {
-                    serialize(clsit->first, *cit, client, writer);
+                    serialize(clsit->first, *cit, client, writer,
+                              true, depth - 1, classes);
                 }
             }
         }
@@ -388,6 +412,48 @@ public:
                      /* out */
                      modb::mointernal::StoreClient::notif_t* notifs = NULL);
 
+    /**
+     * Deserialize a JSON array of managed objects from the file into
+     * the store without parsing the array into a document.  Each
+     * object instance is filled in as its properties are parsed and
+     * written to the store when its JSON object ends, so memory use
+     * is bounded by the largest managed object rather than by the
+     * size of the array.  The objects that precede a parse error are
+     * therefore already written when it is found; use readMOs to load
+     * a file only if it parses.
+     *
+     * @param file the file containing the managed objects
+     * @param client the store client where we should write the output
+     * @param replaceChildren if true, delete any children not present
+     * in the list of child URIs.
+     * @param notify if true, deliver the update notifications after
+     * each chunk of managed objects is written
+     * @return the number of managed objects read
+     */
+    size_t deserializeStream(FILE* file,
+                             modb::mointernal::StoreClient& client,
+                             bool replaceChildren,
+                             bool notify = false);
+
+    /**
+     * Deserialize a JSON array of managed objects from the
+     * null-terminated string into the store without parsing the
+     * array into a document.
+     *
+     * @param json the JSON text containing the managed objects
+     * @param client the store client where we should write the output
+     * @param replaceChildren if true, delete any children not present
+     * in the list of child URIs.
+     * @param notify if true, deliver the update notifications after
+     * each chunk of managed objects is written
+     * @return the number of managed objects read
+     * @see deserializeStream(FILE*, modb::mointernal::StoreClient&, bool, bool)
+     */
+    size_t deserializeStream(const char* json,
+                             modb::mointernal::StoreClient& client,
+                             bool replaceChildren,
+                             bool notify = false);
+
     /**
      * Dump the managed object database to the file specified as a
      * JSON blob.
@@ -404,6 +470,44 @@ public:
      */
     void dumpMODB(FILE* file);
 
+    /**
+     * The default number of JSON objects a paced dump writes between
+     * pauses
+     */
+    static const size_t DUMP_CHUNK = 256;
+
+    /**
+     * The default pause between the chunks of a paced dump, in
+     * microseconds
+     */
+    static const uint64_t DUMP_PAUSE = 1000;
+
+    /**
+     * Dump the managed object database to the file as compact JSON,
+     * reading the objects from a snapshot of the store.  The dump
+     * flushes its output and sleeps after each chunk of objects, so
+     * that a dump running on its own thread does not hold up the
+     * threads that are processing the store.
+     *
+     * The roots and children are found from the live indexes, which
+     * are not versioned.  Objects created since the snapshot are
+     * skipped and objects removed since the snapshot are missing, so
+     * the dump is not a consistent image of the store when it is
+     * modified during the dump.
+     *
+     * @param file the file to write to
+     * @param chunk the number of JSON objects to write between pauses
+     * @param pause the pause between chunks in microseconds
+     * @param cancel if not NULL, the dump stops after the current root
+     * object once this is set.  The output is still a valid JSON
+     * array.
+     * @return the number of root objects written
+     */
+    size_t dumpMODBPaced(FILE* file,
+                         size_t chunk = DUMP_CHUNK,
+                         uint64_t pause = DUMP_PAUSE,
+                         const boost::atomic<bool>* cancel = NULL);
+
     /**
      * Dump the unresolved managed object database to the file specified as a
      * JSON blob.
@@ -413,7 +517,9 @@ public:
     void dumpUnResolvedMODB(FILE *file);
 
     /**
-     * Read managed objects from the given file into the MODB
+     * Read managed objects from the given file into the MODB.  The
+     * whole file is parsed before any object is written, so a file
+     * that is not valid JSON leaves the store unchanged.
      *
      * @param file the file containing the managed objects
      * @param client the store client to use
@@ -422,6 +528,25 @@ public:
     size_t readMOs(FILE* file,
                    modb::mointernal::StoreClient& client);
 
+    /**
+     * Read managed objects from the named file into the MODB using
+     * several threads.  The file is split at the boundaries between
+     * the objects of its top-level array, and the chunks are parsed
+     * into object instances in parallel.  The objects are then
+     * written to the store in file order, so that each object finds
+     * the parents that precede it.  Nothing is written unless every
+     * chunk parses.
+     *
+     * @param file the name of the file containing the managed objects
+     * @param client the store client to use
+     * @param threads the number of threads that parse the file, or 0
+     * for one per core, but no more than one per megabyte of the file
+     * @param return the number of managed objects read
+     */
+    size_t readMOs(const std::string& file,
+                   modb::mointernal::StoreClient& client,
+                   size_t threads);
+
     /**
      * Update managed objects from RapidJson document into the MODB
      *
@@ -434,6 +559,21 @@ public:
                      modb::mointernal::StoreClient& client,
                      gbp::PolicyUpdateOp op);
 
+    /**
+     * Update managed objects read from a policy object reader into
+     * the MODB, without building a document.  The class and property
+     * of each name are looked up once for each subject in the
+     * update.
+     *
+     * @param reader the reader for the objects of the update
+     * @param client the store client to use
+     * @param op the Update opcode
+     * @param return the number of managed objects updated
+     */
+    size_t updateMOs(gbp::PolicyObjectReader& reader,
+                     modb::mointernal::StoreClient& client,
+                     gbp::PolicyUpdateOp op);
+
     /**
      * Display the managed object database in a human-readable format
      *
@@ -448,6 +588,24 @@ public:
                      bool tree = true, bool includeProps = false,
                      bool utf8 = true, size_t truncate = 0);
 
+    /**
+     * Display a single managed object in a human-readable format,
+     * along with any of its children that are in the store
+     *
+     * @param ostream the output stream to write to
+     * @param class_id the class ID of the object
+     * @param uri the URI of the object
+     * @param includeProps include the properties of the object
+     * @param utf8 use UTF-8 characters when truncating
+     * @param truncate truncate URIs to the specified number of bytes.
+     * 0 means do not truncate.
+     * @throws std::out_of_range if there is no such managed object
+     */
+    void displayMO(std::ostream& ostream,
+                   modb::class_id_t class_id, const modb::URI& uri,
+                   bool includeProps = false,
+                   bool utf8 = true, size_t truncate = 0);
+
     /**
      * Display the unresolved refrence in managed object database in a human-readable format
      *
@@ -457,6 +615,9 @@ public:
     void displayUnresolved(std::ostream& ostream, bool tree = true, bool utf8 = true);
 
 private:
+    class StreamHandler;
+    struct ParsedMO;
+
     modb::ObjectStore* store;
     Listener* listener;
 
@@ -485,6 +646,35 @@ private:
         }
     }
 
+    /**
+     * Encode the value properties of an object using the
+     * class-specific codec.  Codecs only target the wire writer, so
+     * other writers always use the generic path.
+     *
+     * @return false if the properties were not encoded
+     */
+    template <typename T>
+    static bool encodeValues(const modb::ClassInfo& ci,
+                             const modb::mointernal::ObjectInstance& oi,
+                             T& writer) {
+        return false;
+    }
+
+    /**
+     * Encode the value properties of an object to the wire writer
+     * using the class-specific codec, if there is one.
+     *
+     * @return false if the class has no codec
+     */
+    static bool encodeValues(const modb::ClassInfo& ci,
+                             const modb::mointernal::ObjectInstance& oi,
+                             yajr::rpc::SendHandler& writer) {
+        const modb::mointernal::ClassCodec* codec = ci.getCodec();
+        if (codec == NULL) return false;
+        codec->encode(oi, writer);
+        return true;
+    }
+
     /**
      * Serialize an enum
      * @param client the store client to use to look up the data
@@ -524,6 +714,79 @@ private:
                          modb::mointernal::ObjectInstance& oi,
                          bool scalar);
 
+    /**
+     * Deserialize a single property into the object instance
+     *
+     * @param ci the class of the object
+     * @param client the store client
+     * @param pname the name of the property
+     * @param pvalue the value of the property
+     * @param oi the object instance where we'll store the result
+     */
+    void deserialize_prop(const modb::ClassInfo& ci,
+                          modb::mointernal::StoreClient& client,
+                          const char* pname,
+                          const rapidjson::Value& pvalue,
+                          modb::mointernal::ObjectInstance& oi);
+
+    class SubjectCache;
+
+    /**
+     * Decode a single property read from a policy object reader into
+     * the object instance
+     *
+     * @param cache the lookups for the subjects of the update
+     * @param pinfo the property
+     * @param reader the reader positioned at the object
+     * @param i the index of the property in the object
+     * @param oi the object instance where we'll store the result
+     */
+    void deserialize_prop(SubjectCache& cache,
+                          const modb::PropertyInfo& pinfo,
+                          const gbp::PolicyObjectReader& reader,
+                          size_t i,
+                          modb::mointernal::ObjectInstance& oi);
+
+    /**
+     * Write a deserialized object instance to the store and update
+     * its parent and children
+     *
+     * @param ci the class of the object
+     * @param uri the URI of the object
+     * @param oi the object instance to write
+     * @param parent_uri the URI of the parent, or NULL if none
+     * @param parent_subject the class of the parent, or NULL if none
+     * @param parent_relation the parent property, or NULL to use the
+     * class name
+     * @param children the URIs of the children, used when
+     * replaceChildren is set
+     * @param client the store client where we should write the output
+     * @param replaceChildren if true, delete any children not present
+     * in children
+     * @param notifs an optional map for update notifications
+     */
+    void deserialize_commit(const modb::ClassInfo& ci,
+                            const modb::URI& uri,
+                            const std::shared_ptr<modb::mointernal::ObjectInstance>& oi,
+                            const char* parent_uri,
+                            const char* parent_subject,
+                            const char* parent_relation,
+                            const std::unordered_set<std::string>& children,
+                            modb::mointernal::StoreClient& client,
+                            bool replaceChildren,
+                            /* out */
+                            modb::mointernal::StoreClient::notif_t* notifs);
+
+    /**
+     * Write the managed objects parsed from a policy file to the
+     * store in order, releasing them as they are written
+     *
+     * @param mos the managed objects to write
+     * @param client the store client where we should write the output
+     */
+    void commitParsed(std::vector<ParsedMO>& mos,
+                      modb::mointernal::StoreClient& client);
+
     /**
      * Deserialize an enum
      */
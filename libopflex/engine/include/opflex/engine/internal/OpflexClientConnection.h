@@ -18,6 +18,8 @@
 #include <include/opflex/ofcore/OFAgentStats.h>
 #include "opflex/engine/internal/OpflexConnection.h"
 
+#include <atomic>
+
 namespace opflex {
 namespace engine {
 namespace internal {
@@ -98,6 +100,21 @@ public:
     virtual void setRoles(uint8_t _role) { role = _role; }
     virtual uint8_t getRoles() { return role; }
 
+    /**
+     * Set the endpoint lease the peer granted in its identity
+     * response
+     *
+     * @param lease the lease in seconds, or zero if the peer did not
+     * grant one
+     */
+    void setGrantedLease(uint64_t lease) { grantedLease = lease; }
+
+    /**
+     * Get the endpoint lease the peer granted in seconds, or zero if
+     * it did not grant one
+     */
+    uint64_t getGrantedLease() const { return grantedLease; }
+
     std::shared_ptr<OFAgentStats> getOpflexStats() { return opflexStats; }
 private:
     OpflexPool* pool;
@@ -114,6 +131,7 @@ private:
     bool closing;
     bool ready;
     int failureCount;
+    std::atomic<uint64_t> grantedLease;
 
     std::shared_ptr<OFAgentStats> opflexStats;
 
@@ -126,6 +144,13 @@ private:
     virtual void notifyReady();
     virtual void notifyFailed();
 
+    virtual void observeLatency(const std::string& method, uint64_t latency) {
+        opflexStats->getMethodLatency().observe(method, latency);
+    }
+    virtual void observeRtt(uint64_t rtt) {
+        opflexStats->getKeepAliveRtt().observe(rtt);
+    }
+
 protected:
     static void on_state_change(yajr::Peer* p, void* data,
                                 yajr::StateChange::To stateChange,
@@ -16,6 +16,8 @@
 #include <sstream>
 #include <list>
 #include <utility>
+#include <mutex>
+#include <unordered_map>
 
 #include <rapidjson/document.h>
 #include <rapidjson/stringbuffer.h>
@@ -141,15 +143,144 @@ public:
         keepaliveTimeout = timeout;
     }
 
+    /**
+     * The default number of queued bytes above which the connection
+     * is congested
+     */
+    static const size_t DEFAULT_HIGH_WATERMARK = 4 * 1024 * 1024;
+
+    /**
+     * The default number of queued bytes at which the connection is
+     * no longer congested
+     */
+    static const size_t DEFAULT_LOW_WATERMARK = 1024 * 1024;
+
+    /**
+     * Get the send high watermark (in bytes)
+     * @return watermark
+     */
+    size_t getHighWatermark() const {
+        return highWatermark;
+    }
+
+    /**
+     * Get the send low watermark (in bytes)
+     * @return watermark
+     */
+    size_t getLowWatermark() const {
+        return lowWatermark;
+    }
+
+    /**
+     * Set the send watermarks.  The connection is congested once
+     * more than high bytes are queued for the peer, until no more
+     * than low bytes are left.  Applies from the next connect.
+     *
+     * @param high the high watermark in bytes, or 0 to never become
+     * congested
+     * @param low the low watermark in bytes
+     */
+    void setWatermarks(size_t high, size_t low) {
+        highWatermark = high;
+        lowWatermark = low;
+    }
+
+    /**
+     * The default time after which a request still waiting for its
+     * response is forgotten (in ms)
+     */
+    static const uint64_t DEFAULT_PENDING_TIMEOUT = 5 * 60 * 1000;
+
+    /**
+     * Set the time after which a request still waiting for its
+     * response is forgotten.  The requests are checked whenever a
+     * keep-alive exchange completes, so a peer that stays connected
+     * but never answers does not grow them without bound.
+     *
+     * @param timeout the timeout in milliseconds
+     */
+    void setPendingTimeout(uint64_t timeout) {
+        pendingTimeout = timeout;
+    }
+
+    /**
+     * A response or error response to a request sent on this
+     * connection was received.  Records the latency of the request
+     * using observeLatency().
+     *
+     * @param reqId the request ID of the request
+     */
+    void responseReceived(uint64_t reqId);
+
 protected:
     /**
      * The handler for the connection
      */
     OpflexHandler* handler;
 
+    virtual void requestSent(uint64_t xid, const std::string& method);
+
+    /**
+     * Record the latency of a response received for a request sent
+     * on this connection
+     *
+     * @param method the method of the request
+     * @param latency the time between sending the request and
+     * receiving its response in milliseconds
+     */
+    virtual void observeLatency(const std::string& method,
+                                uint64_t latency) {}
+
+    /**
+     * Forget the requests that are still waiting for responses, for
+     * example because the connection was lost
+     */
+    void clearPendingRequests();
+
+    /**
+     * Forget the requests that have waited for their responses for
+     * longer than the pending timeout
+     */
+    void expirePendingRequests();
+
+    /**
+     * Keep-alive round-trip callback for the peer of a connection
+     * that records the round trip time using observeRtt()
+     */
+    static void on_keepalive_rtt(yajr::Peer* p, void* data, uint64_t rtt);
+
+    /**
+     * The number of queued bytes at which the peer stops coalescing
+     * outbound messages and writes them out right away
+     */
+    static const size_t WRITE_COALESCE_LIMIT = 64 * 1024;
+
+    /**
+     * Send watermark callback for the peer of a connection that
+     * records the change using congestionChanged()
+     */
+    static void on_watermark(yajr::Peer* p, void* data, bool congested);
+
+    /**
+     * Record the round-trip time of a keep-alive exchange
+     *
+     * @param rtt the round-trip time in milliseconds
+     */
+    virtual void observeRtt(uint64_t rtt) {}
+
 private:
     uint32_t handshakeTimeout;
     uint32_t keepaliveTimeout;
+    size_t highWatermark;
+    size_t lowWatermark;
+    uint64_t pendingTimeout;
+
+    /**
+     * The method and send time of the requests waiting for responses
+     */
+    typedef std::pair<std::string, uint64_t> pending_req_t;
+    std::unordered_map<uint64_t, pending_req_t> pendingRequests;
+    std::mutex pending_mutex;
 
     virtual void notifyReady();
     virtual void notifyFailed() {}
@@ -460,6 +460,25 @@ public:
                               const std::string& code,
                               const std::string& message);
 
+    /**
+     * Refuse a request that the remote peer sent faster than it is
+     * allowed to, by responding with an error with a response code of
+     * EBUSY.  The peer should retry the request later.  Unlike
+     * sendErrorRes(), the error is logged with a rate limit.
+     *
+     * @param id the ID of the remote message
+     */
+    virtual void sendBusyRes(const rapidjson::Value& id);
+
+    /**
+     * Check whether an error payload refuses a request because the
+     * remote peer is overloaded
+     *
+     * @param payload the error payload
+     * @return true if the response code is EBUSY
+     */
+    static bool isBusyErr(const rapidjson::Value& payload);
+
     /**
      * Check that the connection is in ready state before handling the
      * specified request.  If the connection is not ready, send an
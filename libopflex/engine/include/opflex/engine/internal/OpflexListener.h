@@ -11,10 +11,16 @@
  * and is available at http://www.eclipse.org/legal/epl-v10.html
  */
 
+#include <algorithm>
+#include <memory>
 #include <mutex>
 #include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include <netinet/in.h>
 #include <boost/atomic.hpp>
+#include <boost/noncopyable.hpp>
 #include <boost/thread/mutex.hpp>
 #include <uv.h>
 
@@ -88,6 +94,22 @@ public:
                    const std::string& serverKeyPass,
                    bool verifyPeers = true);
 
+    /**
+     * Set the number of event loops that serve the connections, each
+     * on its own thread.  Accepted connections are assigned to the
+     * loops round-robin, so that their TLS, parsing and writes are
+     * spread across several cores.  Call before listen().
+     *
+     * @param count the number of loops.  The default is 1, which
+     * serves the connections on the listening loop.
+     */
+    void setLoopCount(size_t count) { loopCount = std::max<size_t>(count, 1); }
+
+    /**
+     * Get the number of event loops that serve the connections
+     */
+    size_t getLoopCount() const { return loopCount; }
+
     /**
      * Start listening on the local socket for new connections
      */
@@ -134,6 +156,35 @@ public:
      */
     void sendToOne(OpflexServerConnection* conn, OpflexMessage* message);
 
+    /**
+     * The result of queuing a response with sendIfCurrent()
+     */
+    enum SendResult {
+        /** The response was queued */
+        SENT,
+        /** The connection has closed */
+        NOT_CONNECTED,
+        /** A newer policy update was sent on the connection */
+        STALE
+    };
+
+    /**
+     * Queue a response serialized from a store snapshot to a single
+     * peer, if its connection is still open and no policy update
+     * serialized from a later version of the store has been sent on
+     * it.  Can be called from any thread.
+     *
+     * @param connId the identifier of the connection to send to
+     * @param version the store version the response was serialized
+     * from
+     * @param message the message to write.  The memory will be owned
+     * by the listener
+     * @return the result of the send.  The message is only queued if
+     * the result is SENT.
+     */
+    SendResult sendIfCurrent(uint64_t connId, uint64_t version,
+                             OpflexMessage* message);
+
     /**
      * Add pending update for conn
      *
@@ -146,6 +197,19 @@ public:
                           const modb::URI& uri,
                           gbp::PolicyUpdateOp op);
 
+    /**
+     * Find the connections that should receive updates for a URI:
+     * those that resolved the URI itself or one of its ancestors.
+     * The cost depends only on the depth of the URI and the number
+     * of subscribers.
+     *
+     * @param uri the URI of the updated object
+     * @param subscribers the set to which the connections are added
+     */
+    void getSubscribers(const modb::URI& uri,
+                        /* out */ std::unordered_set<OpflexServerConnection*>&
+                        subscribers);
+
     /**
      * Send pending updates to each agent
      */
@@ -197,24 +261,69 @@ private:
 
     boost::atomic<bool> active;
 
-    uv_loop_t server_loop;
-    uv_thread_t server_thread;
-
     yajr::Listener* listener;
 
     std::recursive_mutex conn_mutex;
     typedef std::set<OpflexServerConnection*> conn_set_t;
     conn_set_t conns;
+    std::unordered_map<uint64_t, OpflexServerConnection*> conn_ids;
+
+    /**
+     * An event loop serving a share of the connections.  The first
+     * loop also runs the listening socket.
+     */
+    class ConnLoop : private boost::noncopyable {
+    public:
+        ConnLoop(OpflexListener* listener_)
+            : listener(listener_), thread(0) {
+            loop = {};
+            cleanup_async = {};
+            writeq_async = {};
+        }
+
+        OpflexListener* listener;
+        uv_loop_t loop;
+        uv_thread_t thread;
+        uv_async_t cleanup_async;
+        uv_async_t writeq_async;
+
+        /**
+         * The connections served by the loop.  They are only deleted
+         * from its own thread, so the loop can process them without
+         * holding conn_mutex.
+         */
+        conn_set_t conns;
+        std::recursive_mutex conns_mutex;
+    };
+
+    size_t loopCount;
+    std::vector<std::unique_ptr<ConnLoop> > loops;
+    /** the loop that gets the next connection */
+    size_t nextLoop;
+    /**
+     * Set once the listening loop has stopped, so that no more
+     * connections are handed to the other loops
+     */
+    boost::atomic<bool> listenerStopped;
+
+    /**
+     * The connections that resolved each URI, maintained by the
+     * connections as they add and clear their URIs
+     */
+    typedef std::unordered_set<OpflexServerConnection*> sub_set_t;
+    std::unordered_map<modb::URI, sub_set_t> subscriptions;
+    std::mutex subscription_mutex;
 
-    uv_async_t cleanup_async;
-    uv_async_t writeq_async;
+    void subscribe(const modb::URI& uri, OpflexServerConnection* conn);
+    void unsubscribe(const modb::URI& uri, OpflexServerConnection* conn);
 
-    static void server_thread_func(void* processor);
+    static void server_thread_func(void* loop);
     static void on_cleanup_async(uv_async_t *handle);
     static void on_writeq_async(uv_async_t *handle);
-    void messagesReady();
-    uv_loop_t* getLoop() { return &server_loop; }
+    void messagesReady(OpflexServerConnection* conn);
+    uv_loop_t* getLoop(OpflexServerConnection* conn);
     void connectionClosed(OpflexServerConnection* conn);
+    void connectionReady(OpflexServerConnection* conn);
 
     static void* on_new_connection(yajr::Listener* listener,
                                    void* data, int error);
@@ -83,6 +83,8 @@ public:
                                       const rapidjson::Value& payload);
     virtual void handleEPResolveRes(uint64_t reqId,
                                     const rapidjson::Value& payload);
+    virtual void handleEPResolveErr(uint64_t reqId,
+                                    const rapidjson::Value& payload);
     virtual void handleEPUnresolveRes(uint64_t reqId,
                                       const rapidjson::Value& payload);
     virtual void handleEPUpdateReq(const rapidjson::Value& id,
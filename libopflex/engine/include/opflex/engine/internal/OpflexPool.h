@@ -12,6 +12,7 @@
  */
 
 #include <string>
+#include <vector>
 #include <utility>
 #include <map>
 #include <set>
@@ -244,12 +245,33 @@ public:
      * @param role the role to which the message should be sent
      * @param sync if true then this is being called from the libuv
      * thread
+     * @param uri the URI of the policy being resolved, if any
      * @return the number of ready connections to which we sent the message
      */
     size_t sendToRole(OpflexMessage* message,
                       ofcore::OFConstants::OpflexRole role,
                       bool sync = false, const std::string& uri = "");
 
+    /**
+     * Send a given message to all the connected and ready peers with
+     * the given role.  This message can be called from any thread.
+     *
+     * @param message the message to write.  The memory will be owned by the pool.
+     * @param role the role to which the message should be sent
+     * @param sync if true then this is being called from the libuv
+     * thread
+     * @param uris the URIs of the policies being resolved by the
+     * message
+     * @param skipCongested if true the message is not sent to
+     * congested connections, but they are still counted so that the
+     * caller retries the message later
+     * @return the number of ready connections to which we sent the message
+     */
+    size_t sendToRole(OpflexMessage* message,
+                      ofcore::OFConstants::OpflexRole role,
+                      bool sync, const std::vector<std::string>& uris,
+                      bool skipCongested = false);
+
     /**
      * Get the number of connections in a particular role
      *
@@ -258,6 +280,15 @@ public:
      */
     size_t getRoleCount(ofcore::OFConstants::OpflexRole role);
 
+    /**
+     * Get the endpoint lease granted by the ready peers: the shortest
+     * lease granted, or zero if no peer is ready or a ready peer did
+     * not grant one
+     *
+     * @return the lease in seconds, or zero
+     */
+    uint64_t getGrantedLease();
+
     /**
      * Check whether the given port and hostname is in the set of
      * configured peers (as opposed to peers learned through
@@ -279,6 +310,106 @@ public:
      */
     typedef std::unordered_set<peer_name_t> peer_name_set_t;
 
+    /**
+     * Enable or disable load sharing.  When load sharing is enabled,
+     * the processor sends the requests for each subject to one of
+     * the ready peers of a role, chosen with assignPeers(), instead
+     * of to every ready peer.
+     *
+     * @param enabled true to enable load sharing
+     */
+    void setLoadSharing(bool enabled) { loadSharing = enabled; }
+
+    /**
+     * Check whether load sharing is enabled
+     */
+    bool isLoadSharing() const { return loadSharing; }
+
+    /**
+     * Enable or disable offering compression in the handshake with
+     * each peer.  The connections to the peers that accept the offer
+     * compress the traffic in both directions.
+     *
+     * @param enabled true to offer compression
+     */
+    void setCompression(bool enabled) { compression = enabled; }
+
+    /**
+     * Check whether compression is offered to the peers
+     */
+    bool isCompression() const { return compression; }
+
+    /**
+     * Enable or disable offering the binary encoding in the handshake
+     * with each peer.  The connections to the peers that accept the
+     * offer are encoded as CBOR rather than JSON in both directions.
+     *
+     * @param enabled true to offer the binary encoding
+     */
+    void setBinaryEncoding(bool enabled) { binaryEncoding = enabled; }
+
+    /**
+     * Check whether the binary encoding is offered to the peers
+     */
+    bool isBinaryEncoding() const { return binaryEncoding; }
+
+    /**
+     * Set the size from which the messages received from the peers
+     * are parsed on the libuv thread pool rather than on the loop
+     * that handles the connections.  Applies from the next connect.
+     *
+     * @param threshold the message size in bytes, or 0 to parse
+     * every message on the loop
+     */
+    void setParseOffload(size_t threshold) { parseOffload = threshold; }
+
+    /**
+     * Get the size from which messages are parsed on the thread pool
+     */
+    size_t getParseOffload() const { return parseOffload; }
+
+    /**
+     * Choose the ready peer of the given role that serves each of the
+     * given subjects when load sharing.  Peers are chosen by
+     * rendezvous hashing on the URI, so a subject stays with the same
+     * peer while that peer is ready, and only the subjects of a peer
+     * that fails move to the other peers.
+     *
+     * @param role the role of the peers
+     * @param uris the URIs of the subjects
+     * @param peers the peer chosen for each subject, or empty if no
+     * peer with the role is ready
+     * @param extra a peer to consider in addition to the ready peers,
+     * such as a peer that was just lost, to find the subjects that it
+     * served
+     */
+    void assignPeers(ofcore::OFConstants::OpflexRole role,
+                     const std::vector<std::string>& uris,
+                     /* out */ std::vector<peer_name_t>& peers,
+                     const peer_name_t* extra = NULL);
+
+    /**
+     * Send a given message to a single peer if it is connected, ready
+     * and has the given role.  This message can be called from any
+     * thread.
+     *
+     * @param message the message to write.  The memory will be owned by the pool.
+     * @param peer the peer to send the message to
+     * @param role the role of the peer
+     * @param sync if true then this is being called from the libuv
+     * thread
+     * @param uris the URIs of the policies being resolved by the
+     * message
+     * @param skipCongested if true the message is not sent if the
+     * connection is congested, but 1 is still returned so that the
+     * caller retries the message later
+     * @return 1 if the message was sent, or 0 otherwise
+     */
+    size_t sendToPeer(OpflexMessage* message, const peer_name_t& peer,
+                      ofcore::OFConstants::OpflexRole role,
+                      bool sync, const std::vector<std::string>& uris,
+                      bool skipCongested = false);
+
     /**
      * Update the set of connections in the pool to include only
      * configured peers and the peers that appear in the provided set
@@ -388,6 +519,10 @@ private:
     conn_map_t connections;
     role_map_t roles;
     boost::atomic<bool> active;
+    boost::atomic<bool> loadSharing;
+    boost::atomic<bool> compression;
+    boost::atomic<bool> binaryEncoding;
+    boost::atomic<size_t> parseOffload;
 
     opflex::ofcore::OFConstants::OpflexElementMode client_mode;
     opflex::ofcore::OFConstants::OpflexTransportModeState transport_state;
@@ -41,8 +41,10 @@ public:
      * Create a new server connection associated with the given
      *
      * @param listener the listener associated with the connection
+     * @param loopIndex the index of the listener's event loop that
+     * serves the connection
      */
-    OpflexServerConnection(OpflexListener* listener);
+    OpflexServerConnection(OpflexListener* listener, size_t loopIndex = 0);
     virtual ~OpflexServerConnection();
 
     /**
@@ -57,6 +59,26 @@ public:
      */
     OpflexListener* getListener() { return listener; }
 
+    /**
+     * Get the index of the listener's event loop that serves this
+     * connection
+     */
+    size_t getLoopIndex() const { return loopIndex; }
+
+    /**
+     * Get the identifier of this connection.  Identifiers are not
+     * reused, so a message for a connection that has closed is never
+     * delivered to a later connection.
+     */
+    uint64_t getId() const { return id; }
+
+    /**
+     * Get the store version that the last policy update sent on this
+     * connection was serialized from.  Must be called with the
+     * listener's connection mutex held.
+     */
+    uint64_t getUpdateVersion() const { return update_version; }
+
     /**
      * Get the unique name for this component in the policy domain
      *
@@ -127,6 +149,13 @@ public:
     std::shared_ptr<OFServerStats> getOpflexStats() { return opflexStats; }
 private:
     OpflexListener* listener;
+    size_t loopIndex;
+    uint64_t id;
+    /**
+     * The store version the last policy update was serialized from,
+     * guarded by the listener's connection mutex
+     */
+    uint64_t update_version;
 
     std::string remote_peer;
     void setRemotePeer(int rc, struct sockaddr_storage& name);
@@ -156,10 +185,19 @@ private:
     static void on_policy_update_async(uv_async_t *handle);
     static void on_cleanup_async(uv_async_t *handle);
     static void on_prr_timer_async(uv_async_t* handle);
+    static void dedupe(std::vector<opflex::modb::reference_t>& refs);
 
     yajr::Peer* peer;
 
     std::shared_ptr<OFServerStats> opflexStats;
+
+    virtual void observeLatency(const std::string& method, uint64_t latency) {
+        opflexStats->getMethodLatency().observe(method, latency);
+    }
+    virtual void observeRtt(uint64_t rtt) {
+        opflexStats->getKeepAliveRtt().observe(rtt);
+    }
+    virtual void congestionChanged(bool congested);
 };
 
 
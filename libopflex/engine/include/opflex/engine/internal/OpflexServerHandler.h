@@ -20,6 +20,7 @@
 
 #include "opflex/engine/internal/OpflexHandler.h"
 #include "opflex/engine/internal/MOSerializer.h"
+#include "opflex/engine/internal/FairScheduler.h"
 
 #pragma once
 #ifndef OPFLEX_ENGINE_OPFLEXSERVERHANDLER_H
@@ -41,14 +42,26 @@ public:
      * Construct a new opflex PE handler associated with the given
      * connection
      */
-    OpflexServerHandler(OpflexConnection* conn, GbpOpflexServerImpl* server_)
-        : OpflexHandler(conn), server(server_), flakyMode(false) {}
+    OpflexServerHandler(OpflexConnection* conn, GbpOpflexServerImpl* server_);
 
     /**
      * Destroy the handler
      */
     virtual ~OpflexServerHandler() {}
 
+    /**
+     * The kinds of requests whose rate is limited for each agent
+     */
+    enum request_kind_t {
+        /** policy and endpoint resolves */
+        RESOLVE,
+        /** endpoint declarations and undeclarations */
+        DECLARE,
+        /** state reports */
+        STATE_REPORT,
+        REQUEST_KINDS
+    };
+
     /**
      * Check whether the server has recieved a specific resolution
      */
@@ -64,7 +77,7 @@ public:
 
     /**
      * Enable or disable flaky mode.  When enabled, drop the first
-     * attempt to resolve anything.
+     * attempt to resolve, declare or report anything.
      *
      * @param flakyMode true to enable flaky mode
      */
@@ -102,6 +115,21 @@ protected:
     std::unordered_set<modb::reference_t> resolutions;
     std::unordered_set<modb::reference_t> declarations;
     boost::atomic<bool> flakyMode;
+    TokenBucket limits[REQUEST_KINDS];
+
+    /**
+     * Check that the agent is within its request rate limit, and
+     * otherwise refuse the request.  Each item in the payload costs
+     * one token.
+     *
+     * @param id the ID of the request
+     * @param payload the payload of the request
+     * @param kind the kind of request
+     * @return true if the request may be handled
+     */
+    bool admit(const rapidjson::Value& id,
+               const rapidjson::Value& payload,
+               request_kind_t kind);
 };
 
 } /* namespace internal */
@@ -320,7 +320,7 @@ public:
         }
         writer.EndArray();
         writer.String("prr");
-        writer.Int64(processor->getPrrTimerDuration());
+        writer.Int64(processor->getEndpointLease());
 
         writer.EndObject();
         writer.EndArray();
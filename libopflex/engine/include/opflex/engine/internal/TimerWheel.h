@@ -0,0 +1,125 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*!
+ * @file TimerWheel.h
+ * @brief Interface definition file for TimerWheel
+ */
+/*
+ * Copyright (c) 2014 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEX_ENGINE_TIMERWHEEL_H
+#define OPFLEX_ENGINE_TIMERWHEEL_H
+
+#include <vector>
+#include <deque>
+
+#include "opflex/modb/URI.h"
+
+namespace opflex {
+namespace engine {
+namespace internal {
+
+/**
+ * A hierarchical timer wheel that schedules URIs for expiration at a
+ * time in milliseconds, such as the value of uv_now().  Scheduling
+ * and expiring an entry are constant time.
+ *
+ * Entries cannot be cancelled.  A URI that is rescheduled leaves its
+ * old entry in the wheel, so callers should check that an expired
+ * entry still matches the current expiration for its URI.
+ *
+ * The wheel is not thread safe.
+ */
+class TimerWheel {
+public:
+    /**
+     * Construct an empty timer wheel
+     *
+     * @param now the current time in milliseconds
+     */
+    TimerWheel(uint64_t now = 0);
+
+    /**
+     * Schedule a URI for expiration.  An expiration at or before the
+     * current time expires on the next call to pop().
+     *
+     * @param uri the URI to schedule
+     * @param expiration the time in milliseconds when the entry
+     * expires
+     */
+    void schedule(const modb::URI& uri, uint64_t expiration);
+
+    /**
+     * Get the next entry that has expired as of the given time.
+     * Entries are returned in order of expiration, except that those
+     * scheduled in the past are returned first in the order they
+     * were scheduled.
+     *
+     * @param now the current time in milliseconds
+     * @param uri the URI of the expired entry
+     * @param expiration the expiration it was scheduled with
+     * @return true if an expired entry was returned
+     */
+    bool pop(uint64_t now, /* out */ modb::URI& uri,
+             /* out */ uint64_t& expiration);
+
+    /**
+     * Get the number of entries in the wheel, including stale
+     * entries for rescheduled URIs
+     */
+    size_t size() const { return count; }
+
+    /**
+     * Remove all entries and set the current time
+     *
+     * @param now the current time in milliseconds
+     */
+    void reset(uint64_t now);
+
+private:
+    struct entry {
+        modb::URI uri;
+        uint64_t expiration;
+    };
+    typedef std::vector<entry> slot_t;
+
+    static const unsigned SLOT_BITS = 8;
+    static const size_t SLOTS = 1 << SLOT_BITS;
+    static const size_t LEVELS = 4;
+
+    /**
+     * The slots for each level.  A slot at level n covers 2^(8n)
+     * milliseconds.
+     */
+    slot_t slots[LEVELS][SLOTS];
+
+    /**
+     * Entries that have expired and are waiting to be popped
+     */
+    std::deque<entry> ready;
+
+    /**
+     * The next millisecond to expire.  All entries expiring before
+     * it have been moved to the ready queue.
+     */
+    uint64_t current;
+
+    /**
+     * The number of entries in the wheel
+     */
+    size_t count;
+
+    void insert(const entry& e);
+    void advance(uint64_t now);
+};
+
+} /* namespace internal */
+} /* namespace engine */
+} /* namespace opflex */
+
+#endif /* OPFLEX_ENGINE_TIMERWHEEL_H */
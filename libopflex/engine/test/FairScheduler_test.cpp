@@ -0,0 +1,105 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Test suite for TokenBucket and FairScheduler classes.
+ *
+ * Copyright (c) 2014 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+#include "opflex/engine/internal/FairScheduler.h"
+
+using namespace opflex::engine::internal;
+
+BOOST_AUTO_TEST_SUITE(FairScheduler_test)
+
+BOOST_AUTO_TEST_CASE(bucket) {
+    TokenBucket unlimited;
+    for (int i = 0; i < 100; ++i)
+        BOOST_CHECK(unlimited.take(1000, 0));
+
+    TokenBucket bucket(10, 20);
+    BOOST_CHECK(bucket.take(10, 1000));
+    BOOST_CHECK(bucket.take(10, 1000));
+    BOOST_CHECK(!bucket.take(1, 1000));
+
+    // half a second refills 5 tokens, and a request may overdraw
+    BOOST_CHECK(bucket.take(10, 1500));
+    BOOST_CHECK(!bucket.take(1, 1500));
+    BOOST_CHECK(!bucket.take(1, 1900));
+    BOOST_CHECK(bucket.take(1, 2500));
+
+    // the bucket holds no more than the burst
+    BOOST_CHECK(bucket.take(20, 100000));
+    BOOST_CHECK(!bucket.take(1, 100000));
+}
+
+static void push(FairScheduler& sched, const void* source,
+                 std::string& order, char name, size_t cost) {
+    sched.push(source, [&order, name, cost]() {
+            order.push_back(name);
+            return cost;
+        });
+}
+
+BOOST_AUTO_TEST_CASE(roundrobin) {
+    FairScheduler sched(100);
+    std::string order;
+    int a, b;
+    for (int i = 0; i < 4; ++i)
+        push(sched, &a, order, 'a', 100);
+    for (int i = 0; i < 2; ++i)
+        push(sched, &b, order, 'b', 100);
+    BOOST_CHECK_EQUAL(6, sched.size());
+
+    while (sched.runNext()) {}
+    BOOST_CHECK_EQUAL("ababaa", order);
+    BOOST_CHECK_EQUAL(0, sched.size());
+    BOOST_CHECK(!sched.runNext());
+}
+
+BOOST_AUTO_TEST_CASE(deficit) {
+    FairScheduler sched(100);
+    std::string order;
+    int a, b;
+    // the expensive jobs of a wait for b to catch up
+    for (int i = 0; i < 2; ++i)
+        push(sched, &a, order, 'a', 300);
+    for (int i = 0; i < 3; ++i)
+        push(sched, &b, order, 'b', 100);
+
+    while (sched.runNext()) {}
+    BOOST_CHECK_EQUAL("abbba", order);
+}
+
+BOOST_AUTO_TEST_CASE(concurrent) {
+    FairScheduler sched(100);
+    std::string order;
+    int a, b;
+    // the first job of a runs the next job as another thread would.
+    // a has paid for the job it is running, so b goes next.
+    sched.push(&a, [&sched, &order]() {
+            order.push_back('a');
+            sched.runNext();
+            return (size_t)100;
+        });
+    for (int i = 0; i < 2; ++i)
+        push(sched, &a, order, 'a', 100);
+    push(sched, &b, order, 'b', 100);
+
+    while (sched.runNext()) {}
+    BOOST_CHECK_EQUAL("abaa", order);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
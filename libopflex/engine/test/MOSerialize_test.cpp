@@ -15,9 +15,14 @@
 #endif
 
 
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
 #include <boost/test/unit_test.hpp>
 
 #include "opflex/engine/internal/MOSerializer.h"
+#include "opflex/modb/mo-internal/ClassCodec.h"
 
 #include "BaseFixture.h"
 
@@ -32,6 +37,7 @@ using mointernal::ObjectInstance;
 using std::out_of_range;
 using std::string;
 using std::make_pair;
+using boost::assign::list_of;
 
 BOOST_AUTO_TEST_SUITE(MOSerialize_test)
 
@@ -311,6 +317,183 @@ BOOST_FIXTURE_TEST_CASE( mo_deserialize , BaseFixture ) {
     }
     FILE* moFile = fopen(modbFilename.c_str(), "r");
     serializer.readMOs(moFile, sysClient);
+    fclose(moFile);
+
+    // a paced dump writes the same objects
+    char pacedPath[] = "/tmp/mo-paced-XXXXXX";
+    int fd = mkstemp(pacedPath);
+    BOOST_REQUIRE(fd >= 0);
+    close(fd);
+    FILE* pacedFile = fopen(pacedPath, "w");
+    BOOST_REQUIRE(pacedFile != NULL);
+    BOOST_CHECK_EQUAL(1, serializer.dumpMODBPaced(pacedFile, 1, 0));
+    fclose(pacedFile);
+    pacedFile = fopen(pacedPath, "r");
+    BOOST_CHECK_EQUAL(2, serializer.readMOs(pacedFile, sysClient));
+    fclose(pacedFile);
+
+    // a cancelled dump is still a valid array
+    boost::atomic<bool> cancel(true);
+    pacedFile = fopen(pacedPath, "w");
+    BOOST_CHECK_EQUAL(0, serializer.dumpMODBPaced(pacedFile, 1, 0, &cancel));
+    fclose(pacedFile);
+    pacedFile = fopen(pacedPath, "r");
+    BOOST_CHECK_EQUAL(0, serializer.readMOs(pacedFile, sysClient));
+    fclose(pacedFile);
+    unlink(pacedPath);
+}
+
+BOOST_FIXTURE_TEST_CASE( mo_serialize_snapshot , BaseFixture ) {
+    MOSerializer serializer(&db);
+
+    std::shared_ptr<ObjectInstance> oi =
+        std::shared_ptr<ObjectInstance>(new ObjectInstance(1));
+    oi->setUInt64(1, 42);
+    URI uri("/");
+    client1->put(1, uri, oi);
+
+    std::shared_ptr<ObjectInstance> oi2 =
+        std::shared_ptr<ObjectInstance>(new ObjectInstance(2));
+    oi2->setInt64(4, -42);
+    URI uri2("/class2/-42");
+    client1->put(2, uri2, oi2);
+    client1->addChild(1, uri, 3, 2, uri2);
+
+    StringBuffer buffer;
+    Writer<StringBuffer> writer(buffer);
+    {
+        const ObjectStore::SnapshotGuard snapshot(db);
+
+        // a child created after the snapshot is skipped
+        std::shared_ptr<ObjectInstance> oi3 =
+            std::shared_ptr<ObjectInstance>(new ObjectInstance(2));
+        oi3->setInt64(4, -84);
+        URI uri3("/class2/-84");
+        client1->put(2, uri3, oi3);
+        client1->addChild(1, uri, 3, 2, uri3);
+
+        writer.StartArray();
+        serializer.serialize(1, uri, *client1, writer);
+        writer.EndArray();
+    }
+
+    Document d;
+    d.Parse(buffer.GetString());
+    BOOST_REQUIRE(!d.HasParseError());
+    BOOST_REQUIRE(d.IsArray());
+    BOOST_REQUIRE_EQUAL(2, d.Size());
+    const Value& children = d[SizeType(0)]["children"];
+    BOOST_REQUIRE_EQUAL(1, children.Size());
+    BOOST_CHECK_EQUAL(uri2.toString(), children[SizeType(0)].GetString());
+    BOOST_CHECK_EQUAL(uri2.toString(), d[SizeType(1)]["uri"].GetString());
+}
+
+BOOST_FIXTURE_TEST_CASE( mo_deserialize_stream , BaseFixture ) {
+    // the second object has its properties before its subject, and
+    // there are unknown members and classes to skip
+    static const char buffer[] =
+        "[{\"subject\":\"class1\",\"uri\":\"/\",\"properties\":[{\"name"
+        "\":\"prop2\",\"data\":[\"test1\",\"test2\"]},{\"data\":42,\"nam"
+        "e\":\"prop1\"}],\"extra\":{\"a\":[1,{\"b\":2}]},\"children\":[\""
+        "/class2/-84\",\"/class2/-42\"]},{\"uri\":\"/class2/-42\",\"prope"
+        "rties\":[{\"name\":\"prop4\",\"data\":-42}],\"subject\":\"class2"
+        "\",\"children\":[],\"parent_subject\":\"class1\",\"parent_uri\":"
+        "\"/\",\"parent_relation\":\"class2\"},{\"subject\":\"nosuchclass"
+        "\",\"uri\":\"/nosuchclass/\",\"properties\":[{\"name\":\"x\",\"d"
+        "ata\":[1]}]},{\"subject\":\"class2\",\"uri\":\"/class2/-84\",\"p"
+        "roperties\":[{\"name\":\"prop4\",\"data\":-84}],\"children\":[],"
+        "\"parent_subject\":\"class1\",\"parent_uri\":\"/\"}]";
+
+    MOSerializer serializer(&db);
+    StoreClient& sysClient = db.getStoreClient("_SYSTEM_");
+    BOOST_CHECK_EQUAL(4,
+                      serializer.deserializeStream(buffer, sysClient, true));
+
+    URI uri("/");
+    URI uri2("/class2/-42");
+    URI uri3("/class2/-84");
+    std::shared_ptr<const ObjectInstance> oi = sysClient.get(1, uri);
+    BOOST_CHECK_EQUAL(42, oi->getUInt64(1));
+    BOOST_CHECK_EQUAL(2, oi->getStringSize(2));
+    BOOST_CHECK_EQUAL("test1", oi->getString(2, 0));
+    BOOST_CHECK_EQUAL("test2", oi->getString(2, 1));
+    BOOST_CHECK_EQUAL(-42, sysClient.get(2, uri2)->getInt64(4));
+    BOOST_CHECK_EQUAL(-84, sysClient.get(2, uri3)->getInt64(4));
+
+    std::vector<URI> children;
+    sysClient.getChildren(1, uri, 3, 2, children);
+    BOOST_CHECK_EQUAL(2, children.size());
+
+    // not an array
+    BOOST_CHECK_EQUAL(0, serializer.deserializeStream("{}", sysClient, true));
+}
+
+BOOST_FIXTURE_TEST_CASE( mo_read_parallel , BaseFixture ) {
+    // the children come before their parent, and a string holds the
+    // characters the file is split on
+    static const char buffer[] =
+        "[{\"subject\":\"class2\",\"uri\":\"/class2/-42\",\"properti"
+        "es\":[{\"name\":\"prop4\",\"data\":-42}],\"children\":[],\"p"
+        "arent_subject\":\"class1\",\"parent_uri\":\"/\",\"parent_rel"
+        "ation\":\"class2\"},\n{\"subject\":\"class1\",\"uri\":\"/\","
+        "\"properties\":[{\"name\":\"prop2\",\"data\":[\"a,}]\\\"b\","
+        "\"c\"]}],\"children\":[\"/class2/-84\",\"/class2/-42\"]},\n{\"s"
+        "ubject\":\"class2\",\"uri\":\"/class2/-84\",\"properties\":[{"
+        "\"name\":\"prop4\",\"data\":-84}],\"children\":[],\"parent_su"
+        "bject\":\"class1\",\"parent_uri\":\"/\"}]\n";
+
+    string fileName("/tmp/mo_parallel.json");
+    FILE* file = fopen(fileName.c_str(), "w");
+    BOOST_REQUIRE(file != NULL);
+    fputs(buffer, file);
+    fclose(file);
+
+    MOSerializer serializer(&db);
+    StoreClient& sysClient = db.getStoreClient("_SYSTEM_");
+    BOOST_CHECK_EQUAL(3, serializer.readMOs(fileName, sysClient, 3));
+
+    URI uri("/");
+    std::shared_ptr<const ObjectInstance> oi = sysClient.get(1, uri);
+    BOOST_CHECK_EQUAL(2, oi->getStringSize(2));
+    BOOST_CHECK_EQUAL("a,}]\"b", oi->getString(2, 0));
+    BOOST_CHECK_EQUAL(-42, sysClient.get(2, URI("/class2/-42"))->getInt64(4));
+    BOOST_CHECK_EQUAL(-84, sysClient.get(2, URI("/class2/-84"))->getInt64(4));
+
+    // the first child is written before its parent, so only the
+    // second one is linked to it
+    std::vector<URI> children;
+    sysClient.getChildren(1, uri, 3, 2, children);
+    BOOST_CHECK_EQUAL(1, children.size());
+
+    // the same file read on one thread
+    BOOST_CHECK_EQUAL(3, serializer.readMOs(fileName, sysClient, 1));
+    remove(fileName.c_str());
+}
+
+BOOST_FIXTURE_TEST_CASE( mo_read_truncated , BaseFixture ) {
+    // the last object is cut short, so none of the objects before it
+    // are loaded either
+    static const char buffer[] =
+        "[{\"subject\":\"class1\",\"uri\":\"/\",\"properties\":[],"
+        "\"children\":[]},\n{\"subject\":\"class2\",\"uri\":\"/cla"
+        "ss2/-42\",\"properties\":[{\"name\":\"prop4\",\"data\":-42}"
+        "],\"children\":[]},\n{\"subject\":\"class2\",\"uri\":\"/cla"
+        "ss2/-84\",\"properties\":[{\"name\":\"prop4\",\"da";
+
+    string fileName("/tmp/mo_truncated.json");
+    FILE* file = fopen(fileName.c_str(), "w");
+    BOOST_REQUIRE(file != NULL);
+    fputs(buffer, file);
+    fclose(file);
+
+    MOSerializer serializer(&db);
+    StoreClient& sysClient = db.getStoreClient("_SYSTEM_");
+    for (size_t threads : { (size_t)1, (size_t)3 }) {
+        BOOST_CHECK_EQUAL(0, serializer.readMOs(fileName, sysClient, threads));
+        BOOST_CHECK(!sysClient.isPresent(1, URI("/")));
+        BOOST_CHECK(!sysClient.isPresent(2, URI("/class2/-42")));
+    }
+    remove(fileName.c_str());
 }
 
 BOOST_FIXTURE_TEST_CASE( types , BaseFixture ) {
@@ -391,4 +574,233 @@ BOOST_FIXTURE_TEST_CASE( types , BaseFixture ) {
     serializer.displayUnresolved(std::cout, true, true);
 }
 
+static size_t encodeCount = 0;
+static size_t decodeCount = 0;
+
+static void encodeClass1(const ObjectInstance& oi,
+                         yajr::rpc::SendHandler& writer) {
+    encodeCount += 1;
+    if (oi.isSet(1, PropertyInfo::U64)) {
+        writer.StartObject();
+        writer.String("name", 4);
+        writer.String("prop1", 5);
+        writer.String("data", 4);
+        writer.Uint64(oi.getUInt64(1));
+        writer.EndObject();
+    }
+}
+
+static bool decodeClass1(const char* name, const Value& data,
+                         ObjectInstance& oi) {
+    if (std::strcmp(name, "prop1") != 0) return false;
+    decodeCount += 1;
+    if (data.IsUint64())
+        oi.setUInt64(1, data.GetUint64());
+    return true;
+}
+
+static const ClassCodec class1Codec = { encodeClass1, decodeClass1 };
+
+class CodecFixture {
+public:
+    CodecFixture()
+        : md("example",
+             list_of(ClassInfo(1, ClassInfo::POLICY, "class1", "owner1",
+                               list_of
+                                   (PropertyInfo(1, "prop1",
+                                                 PropertyInfo::U64,
+                                                 PropertyInfo::SCALAR))
+                                   (PropertyInfo(2, "class2Ref",
+                                                 PropertyInfo::REFERENCE,
+                                                 PropertyInfo::SCALAR)),
+                               &class1Codec))
+                    (ClassInfo(2, ClassInfo::POLICY, "class2", "owner1",
+                               list_of
+                                   (PropertyInfo(3, "prop3",
+                                                 PropertyInfo::STRING,
+                                                 PropertyInfo::SCALAR))))),
+          db(threadManager) {
+        db.init(md);
+        db.start();
+        client = &db.getStoreClient("owner1");
+    }
+
+    ~CodecFixture() {
+        db.stop();
+    }
+
+    ModelMetadata md;
+    opflex::util::ThreadManager threadManager;
+    ObjectStore db;
+    StoreClient* client;
+};
+
+BOOST_FIXTURE_TEST_CASE( codec , CodecFixture ) {
+    MOSerializer serializer(&db);
+    URI c2u("/class2/test/");
+
+    std::shared_ptr<ObjectInstance> oi1 = std::make_shared<ObjectInstance>(1);
+    oi1->setUInt64(1, 42);
+    oi1->setReference(2, 2, c2u);
+    client->put(1, URI::ROOT, oi1);
+
+    // the generic path is used for other writers
+    encodeCount = 0;
+    {
+        StringBuffer buffer;
+        Writer<StringBuffer> writer(buffer);
+        serializer.serialize(1, URI::ROOT, *client, writer, false);
+    }
+    BOOST_CHECK_EQUAL(0, encodeCount);
+
+    yajr::internal::StringQueue queue;
+    yajr::rpc::SendHandler writer(queue);
+    serializer.serialize(1, URI::ROOT, *client, writer, false);
+    BOOST_CHECK_EQUAL(1, encodeCount);
+    string str(queue.deque_.begin(), queue.deque_.end());
+
+    Document d;
+    d.Parse(str.c_str());
+    BOOST_REQUIRE(d.IsObject());
+    const Value& props = d["properties"];
+    BOOST_REQUIRE(props.IsArray());
+    BOOST_CHECK_EQUAL(2, props.Size());
+
+    client->remove(1, URI::ROOT, false);
+    decodeCount = 0;
+    serializer.deserialize(d, *client, false, NULL);
+    BOOST_CHECK_EQUAL(1, decodeCount);
+
+    std::shared_ptr<const ObjectInstance> oi = client->get(1, URI::ROOT);
+    BOOST_CHECK_EQUAL(42, oi->getUInt64(1));
+    // references still go through the generic path
+    BOOST_CHECK(make_pair((class_id_t)2ul, c2u) == oi->getReference(2));
+}
+
+/**
+ * A policy object reader over objects held in memory
+ */
+class TestPolicyReader : public opflex::gbp::PolicyObjectReader {
+public:
+    struct Prop {
+        string name;
+        prop_type_t type;
+        string str;
+        int64_t i;
+        string refSubject;
+    };
+    struct Obj {
+        string subject;
+        string uri;
+        std::vector<Prop> props;
+        std::vector<string> children;
+        string parentSubject;
+        string parentUri;
+        string parentRelation;
+    };
+
+    TestPolicyReader(const std::vector<Obj>& objs_)
+        : objs(objs_), pos(0), started(false) {}
+
+    virtual bool next() {
+        if (started) pos += 1;
+        started = true;
+        return pos < objs.size();
+    }
+    virtual const string& getSubject() const { return objs[pos].subject; }
+    virtual const string& getURI() const { return objs[pos].uri; }
+    virtual size_t getPropertyCount() const { return objs[pos].props.size(); }
+    virtual const string& getPropertyName(size_t i) const {
+        return objs[pos].props[i].name;
+    }
+    virtual prop_type_t getPropertyType(size_t i) const {
+        return objs[pos].props[i].type;
+    }
+    virtual const string& getString(size_t i) const {
+        return objs[pos].props[i].str;
+    }
+    virtual int64_t getInt(size_t i) const { return objs[pos].props[i].i; }
+    virtual const string& getReferenceSubject(size_t i) const {
+        return objs[pos].props[i].refSubject;
+    }
+    virtual size_t getChildCount() const { return objs[pos].children.size(); }
+    virtual const string& getChild(size_t i) const {
+        return objs[pos].children[i];
+    }
+    virtual const string& getParentSubject() const {
+        return objs[pos].parentSubject;
+    }
+    virtual const string& getParentURI() const { return objs[pos].parentUri; }
+    virtual const string& getParentRelation() const {
+        return objs[pos].parentRelation;
+    }
+
+private:
+    std::vector<Obj> objs;
+    size_t pos;
+    bool started;
+};
+
+BOOST_FIXTURE_TEST_CASE( mo_update_reader , BaseFixture ) {
+    typedef TestPolicyReader R;
+    MOSerializer serializer(&db);
+    StoreClient& sysClient = db.getStoreClient("_SYSTEM_");
+
+    std::vector<R::Obj> objs;
+    objs.push_back({"class1", "/",
+                    {{"prop1", R::INT, "", 42, ""},
+                     {"prop2", R::STRING, "test1", 0, ""},
+                     {"prop2", R::STRING, "test2", 0, ""},
+                     {"unknown", R::STRING, "x", 0, ""}},
+                    {"/class2/-42"}, "", "", ""});
+    objs.push_back({"class2", "/class2/-42",
+                    {{"prop4", R::INT, "", -42, ""},
+                     {"prop15", R::STRING, "11:22:33:44:55:66", 0, ""}},
+                    {}, "class1", "/", "class2"});
+    objs.push_back({"class2", "/class2/-84",
+                    {{"prop4", R::STRING, "wrong type", 0, ""}},
+                    {}, "class1", "/", ""});
+    objs.push_back({"fakesubject", "/fake", {}, {}, "", "", ""});
+    R reader(objs);
+    BOOST_CHECK_EQUAL(3,
+                      serializer.updateMOs(reader, sysClient,
+                                           opflex::gbp::PolicyUpdateOp::ADD));
+
+    URI uri("/");
+    URI uri2("/class2/-42");
+    URI uri3("/class2/-84");
+    std::shared_ptr<const ObjectInstance> oi = sysClient.get(1, uri);
+    std::shared_ptr<const ObjectInstance> oi2 = sysClient.get(2, uri2);
+    std::shared_ptr<const ObjectInstance> oi3 = sysClient.get(2, uri3);
+    BOOST_CHECK_EQUAL(42, oi->getUInt64(1));
+    BOOST_CHECK_EQUAL(2, oi->getStringSize(2));
+    BOOST_CHECK_EQUAL("test1", oi->getString(2, 0));
+    BOOST_CHECK_EQUAL("test2", oi->getString(2, 1));
+    BOOST_CHECK_EQUAL(-42, oi2->getInt64(4));
+    BOOST_CHECK(MAC("11:22:33:44:55:66") == oi2->getMAC(15));
+    BOOST_CHECK(!oi3->isSet(4, PropertyInfo::S64));
+
+    std::vector<URI> children;
+    sysClient.getChildren(1, uri, 3, 2, children);
+    BOOST_CHECK_EQUAL(2, children.size());
+
+    // replacing the parent removes the children it does not list
+    std::vector<R::Obj> replace;
+    replace.push_back({"class1", "/", {{"prop1", R::INT, "", 84, ""}},
+                       {"/class2/-42"}, "", "", ""});
+    R replaceReader(replace);
+    serializer.updateMOs(replaceReader, sysClient,
+                         opflex::gbp::PolicyUpdateOp::REPLACE);
+    BOOST_CHECK_EQUAL(84, sysClient.get(1, uri)->getUInt64(1));
+    BOOST_CHECK(sysClient.isPresent(2, uri2));
+    BOOST_CHECK(!sysClient.isPresent(2, uri3));
+
+    std::vector<R::Obj> remove;
+    remove.push_back({"class2", "/class2/-42", {}, {}, "", "", ""});
+    R removeReader(remove);
+    serializer.updateMOs(removeReader, sysClient,
+                         opflex::gbp::PolicyUpdateOp::DELETE);
+    BOOST_CHECK(!sysClient.isPresent(2, uri2));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -149,4 +149,49 @@ BOOST_FIXTURE_TEST_CASE( manage_ivxlan_roles , PoolFixture ) {
     c3->disconnect();
 }
 
+BOOST_FIXTURE_TEST_CASE( assign_peers , PoolFixture ) {
+    MockClientConn* c1 = new MockClientConn(handlerFactory, &pool,
+                                            "1.2.3.4", 1234);
+    MockClientConn* c2 = new MockClientConn(handlerFactory, &pool,
+                                            "1.2.3.4", 1235);
+    pool.addPeer(c1);
+    pool.addPeer(c2);
+
+    std::vector<std::string> uris;
+    for (int i = 0; i < 100; ++i)
+        uris.push_back("/class4/" + std::to_string(i) + "/");
+
+    std::vector<OpflexPool::peer_name_t> peers;
+    pool.assignPeers(OFConstants::POLICY_REPOSITORY, uris, peers);
+    BOOST_CHECK(peers.empty());
+
+    pool.setRoles(c1, OFConstants::POLICY_REPOSITORY);
+    pool.setRoles(c2, OFConstants::POLICY_REPOSITORY);
+    pool.assignPeers(OFConstants::POLICY_REPOSITORY, uris, peers);
+    BOOST_REQUIRE_EQUAL(uris.size(), peers.size());
+
+    // the subjects are spread across both peers, consistently
+    size_t onC1 = 0;
+    for (const OpflexPool::peer_name_t& p : peers)
+        if (p.second == 1234) onC1 += 1;
+    BOOST_CHECK(onC1 > 0 && onC1 < uris.size());
+    std::vector<OpflexPool::peer_name_t> again;
+    pool.assignPeers(OFConstants::POLICY_REPOSITORY, uris, again);
+    BOOST_CHECK(peers == again);
+
+    // only the subjects of a failed peer move
+    c2->ready = false;
+    pool.assignPeers(OFConstants::POLICY_REPOSITORY, uris, again);
+    BOOST_REQUIRE_EQUAL(uris.size(), again.size());
+    for (size_t i = 0; i < uris.size(); ++i) {
+        BOOST_CHECK_EQUAL(1234, again[i].second);
+    }
+    c2->ready = true;
+    pool.assignPeers(OFConstants::POLICY_REPOSITORY, uris, again);
+    BOOST_CHECK(peers == again);
+
+    c1->disconnect();
+    c2->disconnect();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
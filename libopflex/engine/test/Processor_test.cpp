@@ -15,6 +15,7 @@
 #endif
 
 
+#include <algorithm>
 #include <vector>
 #include <unistd.h>
 
@@ -28,6 +29,7 @@
 #include "opflex/engine/Processor.h"
 #include "opflex/logging/StdOutLogHandler.h"
 #include "opflex/engine/internal/GbpOpflexServerImpl.h"
+#include "opflex/yajr/internal/comms.hpp"
 
 #include "BaseFixture.h"
 #include "TestListener.h"
@@ -105,6 +107,7 @@ public:
 
     void testBootstrap(bool ssl, bool transport_mode);
     void testPeerSwap(void);
+    void testDereference();
 
     ThreadManager threadManager;
     Processor processor;
@@ -118,6 +121,18 @@ public:
     }
 };
 
+class ShardedFixture : public BasePFixture {
+public:
+    ShardedFixture() {
+        BOOST_CHECK_THROW(processor.setProcessingThreads(0),
+                          std::invalid_argument);
+        processor.setProcessingThreads(4);
+        processor.start();
+        BOOST_CHECK_THROW(processor.setProcessingThreads(2),
+                          std::logic_error);
+    }
+};
+
 class SSLFixture : public BasePFixture {
 public:
     SSLFixture() {
@@ -157,13 +172,18 @@ public:
 
 class ServerFixture : public Fixture {
 public:
-    ServerFixture() : db(threadManager) {
+    ServerFixture(size_t workers = 0, size_t loops = 1,
+                  double declareRate = 0)
+        : db(threadManager) {
         db.init(md);
         db.start();
         opflexServer = std::make_shared<GbpOpflexServerImpl>(8009, SERVER_ROLES,
                      list_of(make_pair(SERVER_ROLES, LOCALHOST":8009")),
                      vector<std::string>(),
                      db, 60);
+        opflexServer->setWorkers(workers);
+        opflexServer->setLoops(loops);
+        opflexServer->setRequestLimits(0, declareRate, 0);
         opflexServer->start();
         WAIT_FOR(opflexServer->getListener().isListening(), 1000);
     }
@@ -192,7 +212,7 @@ static bool itemPresent(StoreClient* client,
 }
 
 // Test garbage collection after removing references
-BOOST_FIXTURE_TEST_CASE( dereference, Fixture ) {
+void BasePFixture::testDereference() {
     StoreClient::notif_t notifs;
     URI c4u("/class4/test/");
     URI c5u("/class5/test/");
@@ -239,6 +259,104 @@ BOOST_FIXTURE_TEST_CASE( dereference, Fixture ) {
     BOOST_CHECK_EQUAL(0, processor.getRefCount(c4u));
     WAIT_FOR(!itemPresent(client2, 6, c6u), 1000);
 }
+
+BOOST_FIXTURE_TEST_CASE( dereference, Fixture ) {
+    testDereference();
+}
+
+BOOST_FIXTURE_TEST_CASE( dereference_sharded, ShardedFixture ) {
+    testDereference();
+}
+
+// Test that unresolved references are no longer tracked once nothing
+// references them
+BOOST_FIXTURE_TEST_CASE( dereference_unresolved, Fixture ) {
+    StoreClient::notif_t notifs;
+    URI c4u("/class4/test/");
+    URI c5u("/class5/test/");
+    std::shared_ptr<ObjectInstance> oi5 = std::make_shared<ObjectInstance>(5);
+    oi5->setString(10, "test");
+    oi5->addReference(11, 4, c4u);
+
+    client2->put(5, c5u, oi5);
+    client2->queueNotification(5, c5u, notifs);
+    client2->deliverNotifications(notifs);
+    notifs.clear();
+    WAIT_FOR(processor.getRefCount(c4u) > 0, 1000);
+    BOOST_CHECK(!processor.isObjNew(c4u));
+
+    client2->remove(5, c5u, false, &notifs);
+    client2->queueNotification(5, c5u, notifs);
+    client2->deliverNotifications(notifs);
+    notifs.clear();
+
+    WAIT_FOR(processor.isObjNew(c4u), 1000);
+    BOOST_CHECK_EQUAL(0, processor.getRefCount(c4u));
+}
+
+BOOST_FIXTURE_TEST_CASE( item_state_counts, Fixture ) {
+    StoreClient::notif_t notifs;
+    URI c4u("/class4/test/");
+    URI c5u("/class5/test/");
+    std::shared_ptr<ObjectInstance> oi5 = std::make_shared<ObjectInstance>(5);
+    oi5->setString(10, "test");
+    oi5->addReference(11, 4, c4u);
+
+    client2->put(5, c5u, oi5);
+    client2->queueNotification(5, c5u, notifs);
+    client2->deliverNotifications(notifs);
+    WAIT_FOR(processor.getRefCount(c4u) > 0, 1000);
+
+    std::unordered_map<std::string, uint64_t> counts;
+    processor.getItemStateCounts(counts);
+    BOOST_CHECK(counts.find("new") != counts.end());
+    BOOST_CHECK(counts.find("unresolved") != counts.end());
+    BOOST_CHECK(counts.find("deleted") != counts.end());
+    uint64_t total = 0;
+    for (const auto& c : counts)
+        total += c.second;
+    BOOST_CHECK_EQUAL(2, total);
+}
+// test that the priority classes of the processor serve policy ahead
+// of a backlog of background work, without starving the backlog
+BOOST_AUTO_TEST_CASE( priority_classes ) {
+    size_t pending[] = { 0, 0, 100 };
+    auto hasWork = [&pending](size_t c) { return pending[c] > 0; };
+    auto serve = [&](WeightedRoundRobin& classes) {
+        int c = classes.next(hasWork);
+        BOOST_REQUIRE(c >= 0);
+        pending[c] -= 1;
+        return static_cast<char>('0' + c);
+    };
+
+    // the policy, endpoint and background weights of the processor
+    WeightedRoundRobin classes({ 8, 4, 1 });
+    std::string order;
+    order.push_back(serve(classes));
+    order.push_back(serve(classes));
+    BOOST_CHECK_EQUAL("22", order);
+
+    // policy that expires behind the backlog is served first
+    pending[0] = 10;
+    order.clear();
+    for (int i = 0; i < 13; ++i)
+        order.push_back(serve(classes));
+    BOOST_CHECK_EQUAL("0000000000222", order);
+
+    // the background keeps its share while policy keeps coming
+    WeightedRoundRobin busy({ 8, 4, 1 });
+    pending[0] = pending[1] = pending[2] = 100;
+    size_t served[] = { 0, 0, 0 };
+    for (int i = 0; i < 26; ++i)
+        served[serve(busy) - '0'] += 1;
+    BOOST_CHECK_EQUAL(16, served[0]);
+    BOOST_CHECK_EQUAL(8, served[1]);
+    BOOST_CHECK_EQUAL(2, served[2]);
+
+    pending[0] = pending[1] = pending[2] = 0;
+    BOOST_CHECK_EQUAL(-1, busy.next(hasWork));
+}
+
 static bool connReady(OpflexPool& pool, const char* host, int port) {
     OpflexConnection* conn = pool.getPeer(host, port);
     return (conn != NULL && conn->isReady());
@@ -459,6 +577,131 @@ BOOST_FIXTURE_TEST_CASE( endpoint_declare, ServerFixture ) {
 
 }
 
+// test negotiating a long endpoint lease with the peer
+BOOST_FIXTURE_TEST_CASE( endpoint_lease, ServerFixture ) {
+    BOOST_CHECK_EQUAL(processor.getPrrTimerDuration(),
+                      processor.getEndpointLease());
+    // a lease longer than the server allows is capped
+    processor.setEndpointLease(1000000);
+    startClient();
+    WAIT_FOR(connReady(processor.getPool(), LOCALHOST, 8009), 1000);
+    BOOST_CHECK_EQUAL(24*3600, processor.getEndpointLease());
+}
+
+// test that renewals fall on the bucket boundaries halfway through
+// the lease
+BOOST_FIXTURE_TEST_CASE( renewal_buckets, Fixture ) {
+    // no peer is ready, so the lease is the prr timer duration
+    uint64_t renew = processor.getEndpointLease() * 1000 / 2;
+    BOOST_CHECK_EQUAL(processor.getPrrTimerDuration() * 1000 / 2, renew);
+    processor.setRenewalBuckets(4);
+    uint64_t bucket = renew / 4;
+
+    // declarations within a bucket are renewed together
+    uint64_t start = 10 * bucket;
+    BOOST_CHECK_EQUAL(start + renew, processor.getRenewalTime(start));
+    BOOST_CHECK_EQUAL(start + renew, processor.getRenewalTime(start + 1));
+    BOOST_CHECK_EQUAL(start + renew,
+                      processor.getRenewalTime(start + bucket - 1));
+    BOOST_CHECK_EQUAL(start + renew + bucket,
+                      processor.getRenewalTime(start + bucket));
+
+    // with one bucket, every declaration in the first half lease is
+    // renewed at its end
+    processor.setRenewalBuckets(1);
+    BOOST_CHECK_EQUAL(renew, processor.getRenewalTime(1));
+    BOOST_CHECK_EQUAL(renew, processor.getRenewalTime(renew - 1));
+    BOOST_CHECK_EQUAL(2 * renew, processor.getRenewalTime(renew));
+}
+
+static uint64_t methodCount(OFMethodLatency& latency,
+                            const std::string& method) {
+    OFMethodLatency::method_map_t m;
+    latency.getLatency(m);
+    auto it = m.find(method);
+    return it == m.end() ? 0 : it->second->getCount();
+}
+
+static uint64_t serverRttCount(GbpOpflexServerImpl& server) {
+    std::unordered_map<std::string, std::shared_ptr<OFServerStats> > stats;
+    server.getListener().getOpflexPeerStats(stats);
+    uint64_t count = 0;
+    for (const auto& s : stats)
+        count += s.second->getKeepAliveRtt().getCount();
+    return count;
+}
+
+BOOST_FIXTURE_TEST_CASE( latency, ServerFixture ) {
+    startClient();
+    WAIT_FOR(connReady(processor.getPool(), LOCALHOST, 8009), 1000);
+
+    std::shared_ptr<OFAgentStats> stats =
+        processor.getPool().getPeer(LOCALHOST, 8009)->getOpflexStats();
+    // the handshake is timed per method and the first keep-alive
+    // echo is sent on connect by both sides
+    WAIT_FOR(methodCount(stats->getMethodLatency(), "send_identity") > 0,
+             1000);
+    WAIT_FOR(stats->getKeepAliveRtt().getCount() > 0, 1000);
+    WAIT_FOR(serverRttCount(*opflexServer) > 0, 1000);
+    BOOST_CHECK(methodCount(stats->getMethodLatency(), "send_identity") > 0);
+    BOOST_CHECK(stats->getKeepAliveRtt().getCount() > 0);
+}
+
+class LimitedServerFixture : public ServerFixture {
+public:
+    // one declaration per second, with a burst of ten
+    LimitedServerFixture() : ServerFixture(0, 1, 1) {}
+};
+
+// test that declarations over the rate limit are refused with EBUSY
+// and that the agent backs off
+BOOST_FIXTURE_TEST_CASE( endpoint_declare_busy, LimitedServerFixture ) {
+    startClient();
+    WAIT_FOR(connReady(processor.getPool(), LOCALHOST, 8009), 1000);
+    std::shared_ptr<OFAgentStats> stats =
+        processor.getPool().getPeer(LOCALHOST, 8009)->getOpflexStats();
+
+    StoreClient* rclient = opflexServer->getSystemClient();
+    client1->put(1, URI("/"), std::make_shared<ObjectInstance>(1));
+    vector<URI> uris;
+    auto declare = [&](size_t n) {
+        StoreClient::notif_t notifs;
+        client1->queueNotification(1, URI("/"), notifs);
+        for (size_t i = 0; i < n; ++i) {
+            int64_t id = 100 + uris.size();
+            URI u("/class2/" + std::to_string(id) + "/");
+            std::shared_ptr<ObjectInstance> oi =
+                std::make_shared<ObjectInstance>(2);
+            oi->setInt64(4, id);
+            client1->put(2, u, oi);
+            client1->queueNotification(2, u, notifs);
+            uris.push_back(u);
+        }
+        client1->deliverNotifications(notifs);
+    };
+    auto present = [&]() {
+        size_t count = 0;
+        for (const URI& u : uris) {
+            if (itemPresent(rclient, 2, u))
+                count += 1;
+        }
+        return count;
+    };
+
+    // a request may overdraw the burst, so a single batch is allowed
+    // but the request after it is refused
+    declare(20);
+    WAIT_FOR(stats->getEpDeclareErrs() > 0 || present() == uris.size(),
+             1000);
+    declare(1);
+    WAIT_FOR(stats->getEpDeclareErrs() > 0, 1000);
+    BOOST_CHECK(stats->getEpDeclareErrs() > 0);
+
+    // the refused declarations are retried after a longer backoff
+    BOOST_CHECK(present() < uris.size());
+    BOOST_CHECK(processor.getResponseLatency() > 1000);
+}
+
 // test endpoint_declare when the server is flaky
 BOOST_FIXTURE_TEST_CASE( endpoint_declare_flaky, ServerFixture ) {
     startClient();
@@ -496,6 +739,76 @@ BOOST_FIXTURE_TEST_CASE( endpoint_declare_flaky, ServerFixture ) {
     BOOST_CHECK_EQUAL(43, roi2_2->getInt64(4));
 }
 
+// test that only the endpoints declared to a lost peer are declared
+// again when load sharing
+BOOST_FIXTURE_TEST_CASE( load_sharing_reconnect, Fixture ) {
+    GbpOpflexServer::peer_t p1 =
+        make_pair(SERVER_ROLES, "127.0.0.1:8009");
+    GbpOpflexServer::peer_t p2 =
+        make_pair(SERVER_ROLES, "127.0.0.1:8010");
+
+    opflex::util::ThreadManager threadManager;
+    opflex::modb::ObjectStore db(threadManager);
+    db.init(md);
+    db.start();
+    GbpOpflexServerImpl peer1(8009, SERVER_ROLES, list_of(p1)(p2),
+                              vector<std::string>(), db, 60);
+    GbpOpflexServerImpl peer2(8010, SERVER_ROLES, list_of(p1)(p2),
+                              vector<std::string>(), db, 60);
+    peer1.start();
+    peer2.start();
+    WAIT_FOR(peer1.getListener().isListening(), 1000);
+    WAIT_FOR(peer2.getListener().isListening(), 1000);
+
+    processor.getPool().setLoadSharing(true);
+    processor.addPeer(LOCALHOST, 8009);
+    WAIT_FOR(connReady(processor.getPool(), LOCALHOST, 8009), 1000);
+    WAIT_FOR(connReady(processor.getPool(), LOCALHOST, 8010), 1000);
+
+    StoreClient::notif_t notifs;
+    URI u1("/");
+    client1->put(1, u1, std::make_shared<ObjectInstance>(1));
+    client1->queueNotification(1, u1, notifs);
+    vector<URI> eps;
+    for (int i = 0; i < 32; ++i) {
+        URI u("/class2/" + std::to_string(i) + "/");
+        std::shared_ptr<ObjectInstance> oi =
+            std::make_shared<ObjectInstance>(2);
+        oi->setInt64(4, i);
+        client1->put(2, u, oi);
+        client1->queueNotification(2, u, notifs);
+        eps.push_back(u);
+    }
+    client1->deliverNotifications(notifs);
+    notifs.clear();
+
+    StoreClient* rclient = peer1.getSystemClient();
+    for (const URI& u : eps)
+        WAIT_FOR(itemPresent(rclient, 2, u), 1000);
+
+    vector<std::string> uris;
+    for (const URI& u : eps)
+        uris.push_back(u.toString());
+    vector<OpflexPool::peer_name_t> peers;
+    processor.getPool().assignPeers(OFConstants::ENDPOINT_REGISTRY,
+                                    uris, peers);
+    BOOST_REQUIRE_EQUAL(eps.size(), peers.size());
+    uint64_t moved = std::count(peers.begin(), peers.end(),
+                                make_pair(std::string(LOCALHOST), 8010));
+    BOOST_CHECK(moved > 0);
+    BOOST_CHECK(moved < eps.size());
+
+    uint64_t resync = processor.getResyncCount();
+    peer2.stop();
+    WAIT_FOR(!connReady(processor.getPool(), LOCALHOST, 8010), 1000);
+    WAIT_FOR(processor.getResyncCount() == resync + moved, 1000);
+    usleep(100000);
+    BOOST_CHECK_EQUAL(resync + moved, processor.getResyncCount());
+
+    peer1.stop();
+    db.stop();
+}
+
 BOOST_FIXTURE_TEST_CASE( main_loop_adaptor, SyncFixture ) {
     opflex::util::ThreadManager threadManager;
     opflex::modb::ObjectStore db(threadManager);
@@ -577,15 +890,15 @@ static bool resolutions_pred(OpflexServerConnection* conn, void* user) {
 
 class PolicyFixture : public ServerFixture {
 public:
-    PolicyFixture()
-        : ServerFixture(),
+    PolicyFixture(size_t workers = 0, size_t loops = 1)
+        : ServerFixture(workers, loops),
           c4u("/class4/test/"),
           c5u("/class5/test/"),
           c6u("/class4/test/class6/test2/"),
           rclient(NULL) {
     }
 
-    void setup() {
+    void setupServer() {
         rclient = opflexServer->getSystemClient();
         root = std::make_shared<ObjectInstance>(1);
         oi4 = std::make_shared<ObjectInstance>(4);
@@ -601,6 +914,10 @@ public:
         rclient->put(6, c6u, oi6);
         rclient->addChild(1, URI::ROOT, 8, 4, c4u);
         rclient->addChild(4, c4u, 12, 6, c6u);
+    }
+
+    void setup() {
+        setupServer();
 
         // create a local reference to the remote policy object
         oi5->setString(10, "test");
@@ -700,6 +1017,169 @@ BOOST_FIXTURE_TEST_CASE( policy_resolve, PolicyFixture ) {
     WAIT_FOR(!opflexServer->getListener().applyConnPred(resolutions_pred, NULL), 1000);
 }
 
+// test resolving policy before it is referenced
+BOOST_FIXTURE_TEST_CASE( prefetch, PolicyFixture ) {
+    startClient();
+    WAIT_FOR(connReady(processor.getPool(), LOCALHOST, 8009), 1000);
+    setupServer();
+
+    // the prefetched object is resolved and kept although nothing
+    // references it
+    processor.prefetch({{4, c4u}}, 10000);
+    WAIT_FOR(itemPresent(client2, 4, c4u), 1000);
+    WAIT_FOR(itemPresent(client2, 6, c6u), 1000);
+    BOOST_CHECK_EQUAL(0, processor.getRefCount(c4u));
+    usleep(100000);
+    BOOST_CHECK(itemPresent(client2, 4, c4u));
+
+    // a later reference finds it already resolved
+    setup();
+    WAIT_FOR(processor.getRefCount(c4u) > 0, 1000);
+    BOOST_CHECK_EQUAL("test", client2->get(4, c4u)->getString(9));
+}
+
+// test the serialized subtree cache used for policy resolves
+BOOST_FIXTURE_TEST_CASE( resolve_cache, ServerFixture ) {
+    URI c4u("/class4/test/");
+    URI c4u_2("/class4/test2/");
+    URI c6u("/class4/test/class6/test2/");
+    StoreClient* rclient = opflexServer->getSystemClient();
+    std::shared_ptr<ObjectInstance> oi4 = std::make_shared<ObjectInstance>(4);
+    oi4->setString(9, "test");
+    std::shared_ptr<ObjectInstance> oi6 = std::make_shared<ObjectInstance>(6);
+    oi6->setString(13, "test2");
+    rclient->put(4, c4u, oi4);
+    rclient->put(6, c6u, oi6);
+    rclient->addChild(4, c4u, 12, 6, c6u);
+
+    // the server enables the journal for the cache
+    BOOST_CHECK(db.getJournalSize() > 0);
+
+    std::shared_ptr<const yajr::rpc::PreparedValue> json =
+        opflexServer->getSerialized(4, c4u);
+    BOOST_CHECK(json->getJson().find("test2") != std::string::npos);
+    BOOST_CHECK(json == opflexServer->getSerialized(4, c4u));
+
+    // a cached subtree survives a commit outside of it
+    rclient->put(4, c4u_2, oi4);
+    BOOST_CHECK(json == opflexServer->getSerialized(4, c4u));
+
+    oi6->setString(13, "moretesting");
+    rclient->put(6, c6u, oi6);
+    json = opflexServer->getSerialized(4, c4u);
+    BOOST_CHECK(json->getJson().find("moretesting") != std::string::npos);
+
+    rclient->delChild(4, c4u, 12, 6, c6u);
+    json = opflexServer->getSerialized(4, c4u);
+    BOOST_CHECK(json->getJson().find("moretesting") == std::string::npos);
+
+    BOOST_CHECK_THROW(opflexServer->getSerialized(4, URI("/class4/none/")),
+                      std::out_of_range);
+
+    // a full cache evicts the least recently used subtree
+    GbpOpflexServerImpl server(8010, SERVER_ROLES,
+                               list_of(make_pair(SERVER_ROLES,
+                                                 LOCALHOST":8010")),
+                               vector<std::string>(), db, 60);
+    server.setResolveCacheSize(2);
+    URI c4u_3("/class4/test3/");
+    rclient->put(4, c4u_3, oi4);
+    json = server.getSerialized(4, c4u);
+    std::shared_ptr<const yajr::rpc::PreparedValue> json2 =
+        server.getSerialized(4, c4u_2);
+    BOOST_CHECK(json == server.getSerialized(4, c4u));
+    server.getSerialized(4, c4u_3);
+    BOOST_CHECK(json == server.getSerialized(4, c4u));
+    BOOST_CHECK(json2 != server.getSerialized(4, c4u_2));
+
+    // without a journal any change clears the cache
+    db.setJournalSize(0);
+    json = opflexServer->getSerialized(4, c4u);
+    rclient->put(4, c4u_2, oi4);
+    BOOST_CHECK(json != opflexServer->getSerialized(4, c4u));
+}
+
+class WorkerPolicyFixture : public PolicyFixture {
+public:
+    WorkerPolicyFixture() : PolicyFixture(4) {}
+};
+
+// test policy_resolve with responses serialized on worker threads
+BOOST_FIXTURE_TEST_CASE( policy_resolve_workers, WorkerPolicyFixture ) {
+    startClient();
+    WAIT_FOR(connReady(processor.getPool(), LOCALHOST, 8009), 1000);
+    setup();
+
+    WAIT_FOR(processor.getRefCount(c4u) > 0, 1000);
+    WAIT_FOR(itemPresent(client2, 4, c4u), 1000);
+    WAIT_FOR(itemPresent(client2, 6, c6u), 1000);
+    BOOST_CHECK_EQUAL("test", client2->get(4, c4u)->getString(9));
+    BOOST_CHECK_EQUAL("test2", client2->get(6, c6u)->getString(13));
+
+    // updates are still delivered after a worker response
+    vector<reference_t> replace;
+    vector<reference_t> merge;
+    vector<reference_t> del;
+    oi4->setString(9, "moretesting");
+    rclient->put(4, c4u, oi4);
+    merge.emplace_back(4, c4u);
+    opflexServer->policyUpdate(replace, merge, del);
+    WAIT_FOR("moretesting" == client2->get(4, c4u)->getString(9), 1000);
+}
+
+class LoopsPolicyFixture : public PolicyFixture {
+public:
+    LoopsPolicyFixture() : PolicyFixture(0, 3) {}
+};
+
+// test policy_resolve with the connection served on another loop
+// than the listening one
+BOOST_FIXTURE_TEST_CASE( policy_resolve_loops, LoopsPolicyFixture ) {
+    startClient();
+    WAIT_FOR(connReady(processor.getPool(), LOCALHOST, 8009), 1000);
+    setup();
+
+    WAIT_FOR(processor.getRefCount(c4u) > 0, 1000);
+    WAIT_FOR(itemPresent(client2, 4, c4u), 1000);
+    WAIT_FOR(itemPresent(client2, 6, c6u), 1000);
+    BOOST_CHECK_EQUAL("test2", client2->get(6, c6u)->getString(13));
+
+    vector<reference_t> replace;
+    vector<reference_t> merge;
+    vector<reference_t> del;
+    oi4->setString(9, "moretesting");
+    rclient->put(4, c4u, oi4);
+    merge.emplace_back(4, c4u);
+    opflexServer->policyUpdate(replace, merge, del);
+    WAIT_FOR("moretesting" == client2->get(4, c4u)->getString(9), 1000);
+}
+
+static size_t subscriberCount(OpflexListener& listener, const URI& uri) {
+    std::unordered_set<OpflexServerConnection*> subscribers;
+    listener.getSubscribers(uri, subscribers);
+    return subscribers.size();
+}
+
+// test the index of resolved URIs used to route updates
+BOOST_FIXTURE_TEST_CASE( subscriptions, PolicyFixture ) {
+    startClient();
+    WAIT_FOR(connReady(processor.getPool(), LOCALHOST, 8009), 1000);
+    setup();
+    WAIT_FOR(itemPresent(client2, 4, c4u), 1000);
+
+    OpflexListener& listener = opflexServer->getListener();
+    BOOST_CHECK_EQUAL(1, subscriberCount(listener, c4u));
+    // the subtree of a resolved object is covered as well
+    BOOST_CHECK_EQUAL(1, subscriberCount(listener, c6u));
+    BOOST_CHECK_EQUAL(0, subscriberCount(listener, URI("/class4/")));
+
+    client2->remove(5, c5u, false, &notifs);
+    client2->queueNotification(5, c5u, notifs);
+    client2->deliverNotifications(notifs);
+    notifs.clear();
+    WAIT_FOR(subscriberCount(listener, c4u) == 0, 1000);
+}
+
 // test policy resolve after connection ready
 BOOST_FIXTURE_TEST_CASE( policy_resolve_reconnect, PolicyFixture ) {
     setup();
@@ -714,6 +1194,66 @@ BOOST_FIXTURE_TEST_CASE( policy_resolve_reconnect, PolicyFixture ) {
     BOOST_CHECK_EQUAL("test2", client2->get(6, c6u)->getString(13));
 }
 
+// test policy resolve and update over a compressed connection
+BOOST_FIXTURE_TEST_CASE( policy_resolve_compressed, PolicyFixture ) {
+    processor.getPool().setCompression(true);
+    startClient();
+    WAIT_FOR(connReady(processor.getPool(), LOCALHOST, 8009), 1000);
+
+    OpflexConnection* conn = processor.getPool().getPeer(LOCALHOST, 8009);
+    yajr::comms::internal::CommunicationPeer* peer =
+        dynamic_cast<yajr::comms::internal::CommunicationPeer*>
+        (conn->getPeer());
+    BOOST_REQUIRE(peer != NULL);
+    WAIT_FOR(peer->isCompressing(), 1000);
+
+    setup();
+    WAIT_FOR(itemPresent(client2, 4, c4u), 1000);
+    WAIT_FOR(itemPresent(client2, 6, c6u), 1000);
+    BOOST_CHECK_EQUAL("test", client2->get(4, c4u)->getString(9));
+    BOOST_CHECK_EQUAL("test2", client2->get(6, c6u)->getString(13));
+
+    vector<reference_t> replace;
+    vector<reference_t> merge;
+    vector<reference_t> del;
+    oi4->setString(9, "compressed");
+    rclient->put(4, c4u, oi4);
+    merge.emplace_back(4, c4u);
+    opflexServer->policyUpdate(replace, merge, del);
+    WAIT_FOR("compressed" == client2->get(4, c4u)->getString(9), 1000);
+}
+
+// test policy resolve and update over a compressed CBOR connection
+BOOST_FIXTURE_TEST_CASE( policy_resolve_binary, PolicyFixture ) {
+    processor.getPool().setCompression(true);
+    processor.getPool().setBinaryEncoding(true);
+    startClient();
+    WAIT_FOR(connReady(processor.getPool(), LOCALHOST, 8009), 1000);
+
+    OpflexConnection* conn = processor.getPool().getPeer(LOCALHOST, 8009);
+    yajr::comms::internal::CommunicationPeer* peer =
+        dynamic_cast<yajr::comms::internal::CommunicationPeer*>
+        (conn->getPeer());
+    BOOST_REQUIRE(peer != NULL);
+    WAIT_FOR(peer->isBinaryEncoding(), 1000);
+    BOOST_CHECK(peer->isCompressing());
+
+    setup();
+    WAIT_FOR(itemPresent(client2, 4, c4u), 1000);
+    WAIT_FOR(itemPresent(client2, 6, c6u), 1000);
+    BOOST_CHECK_EQUAL("test", client2->get(4, c4u)->getString(9));
+    BOOST_CHECK_EQUAL("test2", client2->get(6, c6u)->getString(13));
+
+    vector<reference_t> replace;
+    vector<reference_t> merge;
+    vector<reference_t> del;
+    oi4->setString(9, "binary");
+    rclient->put(4, c4u, oi4);
+    merge.emplace_back(4, c4u);
+    opflexServer->policyUpdate(replace, merge, del);
+    WAIT_FOR("binary" == client2->get(4, c4u)->getString(9), 1000);
+}
+
 // test policy resolve when the server is flaky
 BOOST_FIXTURE_TEST_CASE( policy_resolve_flaky, PolicyFixture ) {
     startClient();
@@ -733,6 +1273,70 @@ BOOST_FIXTURE_TEST_CASE( policy_resolve_flaky, PolicyFixture ) {
     WAIT_FOR(opflexServer->getListener().applyConnPred(resolutions_pred, NULL), 1000);
 }
 
+static uint64_t staleCount(Processor& processor) {
+    std::unordered_map<std::string, uint64_t> counts;
+    processor.getItemStateCounts(counts);
+    return counts["stale"];
+}
+
+// test writing resolved policy to the policy cache and loading it
+// into a new processor
+BOOST_FIXTURE_TEST_CASE( policy_cache, PolicyFixture ) {
+    char path[] = "/tmp/policy-cache-XXXXXX";
+    int fd = mkstemp(path);
+    BOOST_REQUIRE(fd >= 0);
+    close(fd);
+    std::string cacheFile(path);
+    unlink(cacheFile.c_str());
+
+    startClient();
+    WAIT_FOR(connReady(processor.getPool(), LOCALHOST, 8009), 1000);
+    setup();
+    WAIT_FOR(itemPresent(client2, 4, c4u), 1000);
+    WAIT_FOR(itemPresent(client2, 6, c6u), 1000);
+    WAIT_FOR(opflexServer->getListener().applyConnPred(resolutions_pred, NULL), 1000);
+
+    // the cache is written when the processor is stopped
+    processor.setPolicyCache(cacheFile, 0);
+    processor.stop();
+    BOOST_CHECK_EQUAL(0, access(cacheFile.c_str(), F_OK));
+
+    ThreadManager cacheThreadManager;
+    ObjectStore cacheDb(cacheThreadManager);
+    cacheDb.init(md);
+    cacheDb.start();
+    cacheDb.getStoreClient("owner1")
+        .put(1, URI::ROOT, std::make_shared<ObjectInstance>(1));
+    {
+        Processor cacheProcessor(&cacheDb, cacheThreadManager);
+        cacheProcessor.setProcDelay(5);
+        cacheProcessor.setPolicyCache(cacheFile, 200);
+        cacheProcessor.start();
+
+        StoreClient* cacheClient = &cacheDb.getReadOnlyStoreClient();
+        WAIT_FOR(itemPresent(cacheClient, 4, c4u), 1000);
+        WAIT_FOR(itemPresent(cacheClient, 6, c6u), 1000);
+        BOOST_CHECK_EQUAL("test", cacheClient->get(4, c4u)->getString(9));
+        BOOST_CHECK_EQUAL("test2", cacheClient->get(6, c6u)->getString(13));
+
+        // only the root of the cached policy is marked stale, and it
+        // is held although nothing references it
+        WAIT_FOR(staleCount(cacheProcessor) == 1, 1000);
+        usleep(100000);
+        BOOST_CHECK(itemPresent(cacheClient, 4, c4u));
+        BOOST_CHECK(itemPresent(cacheClient, 6, c6u));
+
+        // while running, the cache is rewritten in the background
+        unlink(cacheFile.c_str());
+        WAIT_FOR(access(cacheFile.c_str(), F_OK) == 0, 1000);
+
+        cacheProcessor.stop();
+    }
+    cacheThreadManager.stop();
+    cacheDb.stop();
+    unlink(cacheFile.c_str());
+}
+
 class StateFixture : public ServerFixture {
 public:
     StateFixture()
@@ -799,6 +1403,30 @@ BOOST_FIXTURE_TEST_CASE( state_report, StateFixture ) {
     BOOST_CHECK_EQUAL("update", rclient->get(3, u3)->getString(16));
 }
 
+static uint64_t serverReportCount(GbpOpflexServerImpl& server) {
+    std::unordered_map<std::string, std::shared_ptr<OFServerStats> > stats;
+    server.getListener().getOpflexPeerStats(stats);
+    uint64_t count = 0;
+    for (const auto& s : stats)
+        count += s.second->getStateReports();
+    return count;
+}
+
+// test that a state report that is not acknowledged is sent again,
+// even though the state did not change
+BOOST_FIXTURE_TEST_CASE( state_report_flaky, StateFixture ) {
+    startClient();
+    WAIT_FOR(connReady(processor.getPool(), LOCALHOST, 8009), 1000);
+    opflexServer->getListener().applyConnPred(make_flaky_pred, NULL);
+    setup();
+
+    // the server drops the first report without a response
+    WAIT_FOR(serverReportCount(*opflexServer) > 0, 1000);
+    WAIT_FOR(itemPresent(rclient, 3, u3), 1000);
+    BOOST_CHECK(serverReportCount(*opflexServer) > 1);
+    BOOST_CHECK_EQUAL(12, rclient->get(3, u3)->getInt64(6));
+}
+
 // test state_report after connection ready
 BOOST_FIXTURE_TEST_CASE( state_report_reconnect, StateFixture ) {
     setup();
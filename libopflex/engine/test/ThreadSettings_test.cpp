@@ -0,0 +1,94 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Test suite for thread settings
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <boost/test/unit_test.hpp>
+
+#include "opflex/util/ThreadSettings.h"
+
+using namespace opflex::util;
+
+BOOST_AUTO_TEST_SUITE(ThreadSettings_test)
+
+#ifdef __linux__
+
+struct ThreadResult {
+    std::string name;
+    int nice = 0;
+    bool ok = false;
+};
+
+static ThreadResult runThread(const std::string& name) {
+    ThreadResult result;
+    std::thread t = startThread(name, [&result]() {
+            char buf[16];
+            pthread_getname_np(pthread_self(), buf, sizeof(buf));
+            result.name = buf;
+            result.nice = getpriority(PRIO_PROCESS, syscall(SYS_gettid));
+        });
+    t.join();
+    return result;
+}
+
+BOOST_AUTO_TEST_CASE(name) {
+    clearThreadSettings();
+    BOOST_CHECK_EQUAL("test_thread", runThread("test_thread").name);
+    // names are cut to what the kernel keeps
+    BOOST_CHECK_EQUAL("a_very_long_thr",
+                      runThread("a_very_long_thread_name").name);
+}
+
+BOOST_AUTO_TEST_CASE(prefix) {
+    clearThreadSettings();
+    int base = getpriority(PRIO_PROCESS, 0);
+    ThreadSettings all;
+    all.nice = std::min(base + 1, 19);
+    ThreadSettings some;
+    some.nice = std::min(base + 2, 19);
+    setThreadSettings("", all);
+    setThreadSettings("test_", some);
+
+    BOOST_CHECK_EQUAL(all.nice.get(), runThread("other").nice);
+    BOOST_CHECK_EQUAL(some.nice.get(), runThread("test_x").nice);
+    BOOST_CHECK_EQUAL(all.nice.get(), runThread("tes").nice);
+
+    // the settings of a thread do not leak to the threads that
+    // start after it
+    clearThreadSettings();
+    BOOST_CHECK_EQUAL(base, runThread("test_x").nice);
+}
+
+BOOST_AUTO_TEST_CASE(invalid) {
+    clearThreadSettings();
+    ThreadSettings settings;
+    settings.policy = std::string("bogus");
+    setThreadSettings("bad", settings);
+    bool ok = true;
+    std::thread t([&ok]() { ok = initThread("bad_thread"); });
+    t.join();
+    BOOST_CHECK(!ok);
+    clearThreadSettings();
+}
+
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,108 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Test suite for TimerWheel class.
+ *
+ * Copyright (c) 2014 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "opflex/engine/internal/TimerWheel.h"
+
+using namespace opflex::engine::internal;
+using opflex::modb::URI;
+
+BOOST_AUTO_TEST_SUITE(TimerWheel_test)
+
+static std::vector<uint64_t> popAll(TimerWheel& wheel, uint64_t now) {
+    std::vector<uint64_t> result;
+    URI uri("/");
+    uint64_t exp;
+    while (wheel.pop(now, uri, exp))
+        result.push_back(exp);
+    return result;
+}
+
+BOOST_AUTO_TEST_CASE(expire) {
+    TimerWheel wheel(1000);
+    URI u1("/u1/");
+    URI u2("/u2/");
+
+    wheel.schedule(u1, 1010);
+    wheel.schedule(u2, 1005);
+    BOOST_CHECK_EQUAL(2, wheel.size());
+    BOOST_CHECK(popAll(wheel, 1004).empty());
+
+    URI uri("/");
+    uint64_t exp;
+    BOOST_REQUIRE(wheel.pop(1020, uri, exp));
+    BOOST_CHECK_EQUAL(u2, uri);
+    BOOST_CHECK_EQUAL(1005, exp);
+    BOOST_REQUIRE(wheel.pop(1020, uri, exp));
+    BOOST_CHECK_EQUAL(u1, uri);
+    BOOST_CHECK_EQUAL(1010, exp);
+    BOOST_CHECK(!wheel.pop(1020, uri, exp));
+    BOOST_CHECK_EQUAL(0, wheel.size());
+}
+
+BOOST_AUTO_TEST_CASE(past) {
+    TimerWheel wheel(1000);
+    URI u1("/u1/");
+
+    wheel.schedule(u1, 0);
+    wheel.schedule(u1, 500);
+    wheel.schedule(u1, 1000);
+    std::vector<uint64_t> exps = popAll(wheel, 1000);
+    std::vector<uint64_t> expected = { 0, 500, 1000 };
+    BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(),
+                                  exps.begin(), exps.end());
+}
+
+BOOST_AUTO_TEST_CASE(cascade) {
+    const uint64_t start = 123456789;
+    TimerWheel wheel(start);
+    URI u1("/u1/");
+
+    // expirations spread over every level of the wheel
+    std::vector<uint64_t> expected;
+    for (uint64_t delta : { 1ull, 255ull, 256ull, 257ull, 65535ull,
+                            65536ull, 70000ull, 16777216ull, 20000000ull }) {
+        wheel.schedule(u1, start + delta);
+        expected.push_back(start + delta);
+    }
+
+    std::vector<uint64_t> exps;
+    for (uint64_t target : expected) {
+        BOOST_CHECK(popAll(wheel, target - 1).empty());
+        std::vector<uint64_t> r = popAll(wheel, target);
+        BOOST_REQUIRE_EQUAL(1, r.size());
+        exps.push_back(r[0]);
+    }
+    BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(),
+                                  exps.begin(), exps.end());
+    BOOST_CHECK_EQUAL(0, wheel.size());
+}
+
+BOOST_AUTO_TEST_CASE(idle) {
+    TimerWheel wheel(0);
+    URI u1("/u1/");
+
+    // an empty wheel catches up to the current time immediately
+    BOOST_CHECK(popAll(wheel, 1000000000000ull).empty());
+    wheel.schedule(u1, 1000000000010ull);
+    BOOST_CHECK(popAll(wheel, 1000000000009ull).empty());
+    BOOST_CHECK_EQUAL(1, popAll(wheel, 1000000000010ull).size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -93,6 +93,56 @@ typedef void* ofobj_p;
  */
 typedef uint64_t class_id_t;
 
+/**
+ * A property ID, unique within the model
+ */
+typedef uint64_t prop_id_t;
+
+/**
+ * A property value that is not set, or that is of a type the batch
+ * interfaces do not handle
+ */
+#define OF_PROP_NONE 0
+/**
+ * An unsigned 64-bit integer property value, which is also used for
+ * enums
+ */
+#define OF_PROP_UINT64 1
+/**
+ * A signed 64-bit integer property value
+ */
+#define OF_PROP_INT64 2
+/**
+ * A string property value, which is also used for MAC addresses
+ */
+#define OF_PROP_STRING 3
+
+/**
+ * A scalar property value, used to pass properties to and from the
+ * batch interfaces in packed arrays
+ */
+typedef struct ofprop_value {
+    /**
+     * The ID of the property
+     */
+    prop_id_t prop_id;
+    /**
+     * The type of the value, one of the OF_PROP_* constants
+     */
+    int type;
+    /**
+     * The value, according to its type
+     */
+    union {
+        /** an OF_PROP_UINT64 value */
+        uint64_t u64;
+        /** an OF_PROP_INT64 value */
+        int64_t s64;
+        /** an OF_PROP_STRING value, as a null-terminated string */
+        const char* str;
+    } value;
+} ofprop_value_t;
+
 /** @} defs */
 /** @} ccore */
 /** @} cwrapper */
@@ -154,6 +154,45 @@ extern "C" {
     ofstatus offramework_register_peerstatuslistener(offramework_p framework,
                                                      ofpeerstatuslistener_p obj);
 
+    /**
+     * Read the given scalar properties of a batch of objects of the
+     * same class into caller-provided buffers.  The values are
+     * written to values in row order, prop_count values for each
+     * URI, with the type of each value taken from the model.  A value
+     * that is unset, of a vector or reference property, or of an
+     * object that does not exist is written with type @ref
+     * OF_PROP_NONE.  The strings are copied into buf, and the values
+     * point into it.
+     *
+     * @param framework the framework
+     * @param class_id the class ID of the objects
+     * @param uris an array of the URIs of the objects, as
+     * null-terminated strings
+     * @param count the number of URIs in uris
+     * @param prop_ids an array of the IDs of the properties to read
+     * @param prop_count the number of property IDs in prop_ids
+     * @param values an array of at least count * prop_count values
+     * that will receive the property values
+     * @param buf a buffer that will receive the string values, or
+     * NULL if no string values are read
+     * @param buf_size the size of buf in bytes
+     * @param found a pointer that will receive the number of objects
+     * that exist, or NULL
+     * @return a status code, which is OF_EOUTOFRANGE if buf was too
+     * small for the string values.  The values that did not fit are
+     * written with type @ref OF_PROP_NONE.
+     */
+    ofstatus offramework_read_batch(offramework_p framework,
+                                    class_id_t class_id,
+                                    const char* const* uris,
+                                    size_t count,
+                                    const prop_id_t* prop_ids,
+                                    size_t prop_count,
+                                    /* out */ ofprop_value_t* values,
+                                    /* out */ char* buf,
+                                    size_t buf_size,
+                                    /* out */ size_t* found);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
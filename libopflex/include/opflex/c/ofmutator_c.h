@@ -48,6 +48,28 @@
  */
 typedef ofobj_p ofmutator_p;
 
+/**
+ * An object to modify in a batch, with the properties to set on it
+ */
+typedef struct ofmo_update {
+    /**
+     * The class ID of the object
+     */
+    class_id_t class_id;
+    /**
+     * The URI of the object, as a null-terminated string
+     */
+    const char* uri;
+    /**
+     * An array of the properties to set
+     */
+    const ofprop_value_t* props;
+    /**
+     * The number of properties in props
+     */
+    size_t prop_count;
+} ofmo_update_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -85,6 +107,46 @@ extern "C" {
      * @return a status code
      */
     ofstatus ofmutator_commit(ofmutator_p mutator);
+
+    /**
+     * Modify a batch of objects in the mutator, setting the given
+     * scalar properties on each of them.  Objects that do not exist
+     * are created.  The arguments are all checked before any object
+     * is modified, and the strings are copied, so the arrays can be
+     * reused as soon as the call returns.  The changes are made
+     * visible by @ref ofmutator_commit().
+     *
+     * Each value must match the type of its property in the model:
+     * an enum takes an OF_PROP_UINT64 that is one of its constants,
+     * and a MAC address an OF_PROP_STRING such as
+     * "01:23:45:67:89:ab".
+     *
+     * @param mutator the mutator
+     * @param updates an array of the objects to modify
+     * @param count the number of objects in updates
+     * @return a status code: OF_EINVALID_ARG if a property does not
+     * exist or a value does not fit it, and OF_EOUTOFRANGE if a
+     * class does not exist
+     */
+    ofstatus ofmutator_modify_batch(ofmutator_p mutator,
+                                    const ofmo_update_t* updates,
+                                    size_t count);
+
+    /**
+     * Remove a batch of objects of the same class in the mutator.
+     * The changes are made visible by @ref ofmutator_commit().
+     *
+     * @param mutator the mutator
+     * @param class_id the class ID of the objects
+     * @param uris an array of the URIs of the objects, as
+     * null-terminated strings
+     * @param count the number of URIs in uris
+     * @return a status code
+     */
+    ofstatus ofmutator_remove_batch(ofmutator_p mutator,
+                                    class_id_t class_id,
+                                    const char* const* uris,
+                                    size_t count);
     
 
 #ifdef __cplusplus
@@ -0,0 +1,141 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*!
+ * @file PolicyObject.h
+ * @brief Interface definition file for GBP policy objects
+ */
+/*
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#ifndef GBP_POLICYOBJECT_H
+#define GBP_POLICYOBJECT_H
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace opflex {
+namespace gbp {
+
+/**
+ * A cursor over a sequence of policy objects, each described the
+ * way a policy source sends it: a subject, a URI, a list of named
+ * properties, the URIs of its children and its parent.  A policy
+ * source implements it over its own representation, so the objects
+ * are decoded straight into the store without an intermediate
+ * document.  The strings returned only need to stay valid until the
+ * cursor moves.
+ */
+class PolicyObjectReader {
+public:
+    /**
+     * The type of a property value
+     */
+    enum prop_type_t {
+        /**
+         * A value of a type the source does not describe, which is
+         * ignored
+         */
+        NONE,
+        /**
+         * A string, which is also used for enums and MAC addresses
+         */
+        STRING,
+        /**
+         * An integer
+         */
+        INT,
+        /**
+         * A reference to another object
+         */
+        REFERENCE
+    };
+
+    virtual ~PolicyObjectReader() {}
+
+    /**
+     * Move to the next object.  The cursor starts before the first
+     * object.
+     *
+     * @return false if there are no more objects
+     */
+    virtual bool next() = 0;
+
+    /**
+     * Get the class name of the object
+     */
+    virtual const std::string& getSubject() const = 0;
+
+    /**
+     * Get the URI of the object
+     */
+    virtual const std::string& getURI() const = 0;
+
+    /**
+     * Get the number of properties of the object.  A vector property
+     * appears once for each of its values.
+     */
+    virtual size_t getPropertyCount() const = 0;
+
+    /**
+     * Get the name of the property at the given index
+     */
+    virtual const std::string& getPropertyName(size_t i) const = 0;
+
+    /**
+     * Get the type of the value of the property at the given index
+     */
+    virtual prop_type_t getPropertyType(size_t i) const = 0;
+
+    /**
+     * Get the value of a STRING property, or the URI of a REFERENCE
+     * property
+     */
+    virtual const std::string& getString(size_t i) const = 0;
+
+    /**
+     * Get the value of an INT property
+     */
+    virtual int64_t getInt(size_t i) const = 0;
+
+    /**
+     * Get the class name of the object a REFERENCE property refers
+     * to
+     */
+    virtual const std::string& getReferenceSubject(size_t i) const = 0;
+
+    /**
+     * Get the number of children URIs of the object
+     */
+    virtual size_t getChildCount() const = 0;
+
+    /**
+     * Get the URI of the child at the given index
+     */
+    virtual const std::string& getChild(size_t i) const = 0;
+
+    /**
+     * Get the class name of the parent, or an empty string if the
+     * object does not name its parent
+     */
+    virtual const std::string& getParentSubject() const = 0;
+
+    /**
+     * Get the URI of the parent, or an empty string
+     */
+    virtual const std::string& getParentURI() const = 0;
+
+    /**
+     * Get the name of the parent property that holds the object, or
+     * an empty string to use the class name of the object
+     */
+    virtual const std::string& getParentRelation() const = 0;
+};
+
+} /* namespace gbp */
+} /* namespace opflex */
+#endif /* GBP_POLICYOBJECT_H */
@@ -15,6 +15,7 @@
 #ifndef OPFLEX_LOGGING_OFLOGHANDLER_H
 #define OPFLEX_LOGGING_OFLOGHANDLER_H
 
+#include <atomic>
 #include <string>
 
 namespace opflex {
@@ -125,11 +126,39 @@ public:
     static OFLogHandler* getHandler()
         __attribute__((no_instrument_function));
 
+    /**
+     * Set the lowest level that the active handler may log.  The
+     * logging macros discard messages below it with a single
+     * comparison, before the handler is consulted, so disabled log
+     * statements stay cheap on hot paths.  A handler whose level
+     * changes at runtime should keep this up to date.  The default is
+     * TRACE, which leaves the decision to shouldEmit().
+     *
+     * @param level the lowest level that may be logged
+     */
+    static void setMinimumLevel(Level level)
+        __attribute__((no_instrument_function));
+
+    /**
+     * Check whether a level is at or above the minimum level set
+     * with setMinimumLevel()
+     *
+     * @param level the level of a message to log
+     * @return false if a message at the level will not be logged
+     */
+    static bool isLevelEnabled(const Level level)
+        __attribute__((no_instrument_function)) {
+        return level >= minLevel.load(std::memory_order_relaxed);
+    }
+
 protected:
     /**
      * The log level for this logger.
      */
     Level logLevel_;
+
+private:
+    static std::atomic<int> minLevel;
 };
 
 /* @} logging */
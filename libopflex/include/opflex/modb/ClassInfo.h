@@ -22,6 +22,10 @@
 namespace opflex {
 namespace modb {
 
+namespace mointernal {
+struct ClassCodec;
+}
+
 /**
  * \addtogroup cpp
  * @{
@@ -90,16 +94,21 @@ public:
     /**
      * Default constructor
      */
-    ClassInfo() : class_id(0), class_type(POLICY) {}
+    ClassInfo() : class_id(0), class_type(POLICY), codec(NULL) {}
 
     /**
      * Construct a class info object for the given class ID
+     *
+     * @param codec an optional class-specific JSON codec used in
+     * place of the generic serializer.  The codec must outlive the
+     * class info.
      */
     ClassInfo(class_id_t class_id,
               class_type_t class_type,
               const std::string& class_name,
               const std::string& owner,
-              const std::vector<PropertyInfo>& properties);
+              const std::vector<PropertyInfo>& properties,
+              const mointernal::ClassCodec* codec = NULL);
 
     /**
      * Destroy the class index
@@ -157,6 +166,13 @@ public:
         return properties.at(prop_id);
     }
 
+    /**
+     * Get the class-specific JSON codec for this class
+     * @return the codec, or NULL if the generic serializer should be
+     * used
+     */
+    const mointernal::ClassCodec* getCodec() const { return codec; }
+
 private:
     /**
      * The class ID for this class
@@ -189,6 +205,11 @@ private:
      * Look up properties IDs by name
      */
     prop_name_map_t prop_names;
+
+    /**
+     * The class-specific codec, if any
+     */
+    const mointernal::ClassCodec* codec;
 };
 
 /* @} metadata */
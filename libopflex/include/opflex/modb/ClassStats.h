@@ -0,0 +1,81 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*!
+ * @file ClassStats.h
+ * @brief Interface definition file for ClassStats
+ */
+/*
+ * Copyright (c) 2014 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#ifndef MODB_CLASSSTATS_H
+#define MODB_CLASSSTATS_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace opflex {
+namespace modb {
+
+/**
+ * @addtogroup cpp
+ * @{
+ */
+
+/**
+ * @addtogroup modb
+ * @{
+ */
+
+/**
+ * Approximate memory accounting for the objects of one class in the
+ * managed object database
+ */
+struct ClassStats {
+    ClassStats() : instances(0), propBytes(0), indexBytes(0), uriBytes(0) {}
+
+    /**
+     * The number of object instances of the class
+     */
+    uint64_t instances;
+
+    /**
+     * Bytes used by the object instances and their property values
+     */
+    uint64_t propBytes;
+
+    /**
+     * Bytes used by the parent/child and property indexes for the
+     * class
+     */
+    uint64_t indexBytes;
+
+    /**
+     * Bytes used by the URIs of the object instances
+     */
+    uint64_t uriBytes;
+
+    /**
+     * Get the total bytes accounted to the class
+     *
+     * @return the sum of the property, index and URI bytes
+     */
+    uint64_t getBytes() const { return propBytes + indexBytes + uriBytes; }
+};
+
+/**
+ * A map from class name to the statistics for that class
+ */
+typedef std::unordered_map<std::string, ClassStats> class_stats_map_t;
+
+/* @} modb */
+/* @} cpp */
+
+} /* namespace modb */
+} /* namespace opflex */
+
+#endif /* MODB_CLASSSTATS_H */
@@ -55,7 +55,9 @@ namespace modb {
  * the fields within that object will either all be modified or none.
  *
  * This is most similar to a database transaction with an isolation
- * level set to read uncommitted.
+ * level set to read uncommitted.  Readers that need a consistent
+ * view across several objects can read through a Snapshot, which
+ * sees each commit either completely or not at all.
  */
 class Mutator {
 public:
@@ -66,9 +68,15 @@ public:
      * @param framework the framework instance that will be modified
      * @param owner the owner string that will control which fields
      * can be modified.
+     * @param delta if true, modify() returns a delta that records only
+     * the properties that are changed rather than a full copy of the
+     * object.  On commit the delta is applied to the latest version
+     * of the object, and the object is written and notified only if
+     * a modified property actually changed value.
      */
     Mutator(ofcore::OFFramework& framework,
-            const std::string& owner);
+            const std::string& owner,
+            bool delta = false);
 
     /**
      * Destroy the Mutator.  Any uncommitted changes will be lost.
@@ -86,7 +94,9 @@ public:
 
     /**
      * Create a new mutable object with the given URI which is a copy
-     * of any existing object with the specified URI.
+     * of any existing object with the specified URI.  In delta mode,
+     * the object is a delta over the existing object that reads
+     * through to it for any property that has not been modified.
      *
      * @param class_id the class ID for the object
      * @param uri The URI for the object
@@ -105,6 +115,13 @@ public:
      */
     void remove(class_id_t class_id, const URI& uri);
 
+    /**
+     * Get the framework instance that the mutator modifies
+     *
+     * @return the framework instance
+     */
+    ofcore::OFFramework& getFramework();
+
     /**
      * Create a new child object with the specified class and URI, and
      * make it a child of the given parent.  If the object already
@@ -15,6 +15,8 @@
 #define MODB_OBJECTLISTENER_H
 
 #include <set>
+#include <vector>
+#include <utility>
 #include "ClassInfo.h"
 #include "URI.h"
 
@@ -62,6 +64,45 @@ public:
      * @param uri the URI for the updated object
      */
     virtual void objectUpdated(class_id_t class_id, const URI& uri) = 0;
+
+    /**
+     * A batch of updated objects, each given as a (class ID, URI)
+     * pair.
+     */
+    typedef std::vector<std::pair<class_id_t, URI> > update_list_t;
+
+    /**
+     * A batch of objects have been added, updated, or deleted.  This
+     * is called with all the updates drained from the notification
+     * queue together, in the order they were queued.  Listeners can
+     * override this to, for example, take a lock once for the whole
+     * batch rather than once per object.  The same consolidation
+     * rules as for objectUpdated() apply.
+     *
+     * The default implementation calls objectUpdated() for each
+     * update in order.
+     *
+     * @param updates the class IDs and URIs of the updated objects
+     */
+    virtual void objectsUpdated(const update_list_t& updates) {
+        for (const update_list_t::value_type& u : updates) {
+            objectUpdated(u.first, u.second);
+        }
+    }
+
+    /**
+     * Whether this listener can be called concurrently from several
+     * notification threads.  When the object store is configured
+     * with more than one notification worker, thread-safe listeners
+     * receive notifications from the parallel workers, with all
+     * notifications for a given URI still delivered in order from a
+     * single worker.  Listeners that are not thread-safe are always
+     * called from the single serial notification thread.
+     *
+     * @return true if the listener is thread-safe.  The default
+     * implementation returns false.
+     */
+    virtual bool isThreadSafe() const { return false; }
 };
 
 /* @} modb */
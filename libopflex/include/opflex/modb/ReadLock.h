@@ -0,0 +1,79 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*!
+ * @file ReadLock.h
+ * @brief Interface definition file for ReadLocks
+ */
+/*
+ * Copyright (c) 2014 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#ifndef MODB_READLOCK_H
+#define MODB_READLOCK_H
+
+#include <boost/noncopyable.hpp>
+
+namespace opflex {
+
+namespace ofcore {
+class OFFramework;
+}
+
+namespace modb {
+
+/**
+ * @addtogroup cpp
+ * @{
+ */
+
+/**
+ * @addtogroup modb
+ * @{
+ */
+
+/**
+ * @brief A read lock holds every region of the data store shared
+ * for its lifetime.
+ *
+ * Each resolve of a managed object normally takes and releases the
+ * lock of the region that holds it.  A caller that resolves many
+ * objects in a row, such as one that walks a chain of relations, can
+ * hold a read lock around the walk so that the reads made from the
+ * calling thread do not lock again.
+ *
+ * Writers to the store are blocked while the lock is held, so read
+ * locks must be short-lived, and the thread holding one must not
+ * modify the store.  Read locks may be nested on the same thread and
+ * combined with a Snapshot, as long as the snapshot is taken before
+ * the read lock.
+ */
+class ReadLock : private boost::noncopyable {
+public:
+    /**
+     * Lock the regions of the store associated with the framework
+     * for reads on the calling thread.
+     *
+     * @param framework the framework instance to read from
+     */
+    ReadLock(ofcore::OFFramework& framework);
+
+    /**
+     * Release the regions
+     */
+    ~ReadLock();
+
+private:
+    class ReadLockImpl;
+    ReadLockImpl* pimpl;
+};
+
+/* @} modb */
+/* @} cpp */
+
+} /* namespace modb */
+} /* namespace opflex */
+
+#endif /* MODB_READLOCK_H */
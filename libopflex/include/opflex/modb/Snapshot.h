@@ -0,0 +1,92 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*!
+ * @file Snapshot.h
+ * @brief Interface definition file for Snapshots
+ */
+/*
+ * Copyright (c) 2014 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#ifndef MODB_SNAPSHOT_H
+#define MODB_SNAPSHOT_H
+
+#include <cstdint>
+
+#include <boost/noncopyable.hpp>
+
+namespace opflex {
+
+namespace ofcore {
+class OFFramework;
+}
+
+namespace modb {
+
+/**
+ * @addtogroup cpp
+ * @{
+ */
+
+/**
+ * @addtogroup modb
+ * @{
+ */
+
+/**
+ * @brief A snapshot is a consistent, read-only view of the data
+ * store as of a single committed version.
+ *
+ * While a snapshot exists, reads of managed objects made from the
+ * thread that created it are served as of the version at which the
+ * snapshot was taken.  Changes committed after that point, including
+ * objects that are added or removed, are not visible through the
+ * snapshot, and every commit made by a Mutator is seen either
+ * entirely or not at all.
+ *
+ * The snapshot covers the object instances themselves; lookups of
+ * the children of an object still reflect the current state of the
+ * store.
+ *
+ * Snapshots are intended to be short-lived since the store must
+ * retain the prior state of every object modified while a snapshot
+ * is active.  Snapshots may be nested on the same thread.
+ */
+class Snapshot : private boost::noncopyable {
+public:
+    /**
+     * Take a snapshot of the store associated with the framework and
+     * register it for reads on the calling thread.
+     *
+     * @param framework the framework instance to read from
+     */
+    Snapshot(ofcore::OFFramework& framework);
+
+    /**
+     * Release the snapshot and restore the view that was in effect
+     * on the calling thread when it was created.
+     */
+    ~Snapshot();
+
+    /**
+     * Get the store version this snapshot is reading at
+     *
+     * @return the version
+     */
+    uint64_t getVersion() const;
+
+private:
+    class SnapshotImpl;
+    SnapshotImpl* pimpl;
+};
+
+/* @} modb */
+/* @} cpp */
+
+} /* namespace modb */
+} /* namespace opflex */
+
+#endif /* MODB_SNAPSHOT_H */
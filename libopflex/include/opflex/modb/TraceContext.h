@@ -0,0 +1,112 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*!
+ * @file TraceContext.h
+ * @brief Interface definition file for TraceContext
+ */
+/*
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#ifndef MODB_TRACECONTEXT_H
+#define MODB_TRACECONTEXT_H
+
+#include <chrono>
+
+#include <boost/noncopyable.hpp>
+
+namespace opflex {
+namespace modb {
+
+/**
+ * @addtogroup cpp
+ * @{
+ */
+
+/**
+ * @addtogroup modb
+ * @{
+ */
+
+/**
+ * @brief A trace context carries the time at which the change being
+ * handled on a thread entered the system, so that the latency of
+ * the work it causes can be measured at the end of the chain.
+ *
+ * The context is set on the calling thread for the lifetime of a
+ * Scope.  Notifications queued by a thread carry its context to the
+ * thread that delivers them, which sets it again while the listeners
+ * are called; when several notifications are delivered together,
+ * the oldest context is used.  Contexts may be nested on the same
+ * thread.
+ */
+class TraceContext {
+public:
+    /**
+     * The clock used for the trace timestamps
+     */
+    typedef std::chrono::steady_clock clock;
+
+    /**
+     * Get the time at which the change being handled on the calling
+     * thread entered the system
+     *
+     * @return the origin, or a default-constructed time point if the
+     * thread is not handling a traced change
+     */
+    static clock::time_point getOrigin();
+
+    /**
+     * Get the time at which the current context was set on the
+     * calling thread
+     *
+     * @return the start, or a default-constructed time point if the
+     * thread is not handling a traced change
+     */
+    static clock::time_point getStart();
+
+    /**
+     * Check whether the calling thread is handling a traced change
+     *
+     * @return true if a context is set
+     */
+    static bool isTraced() {
+        return getOrigin() != clock::time_point();
+    }
+
+    /**
+     * Set the trace context of the calling thread for the lifetime of
+     * the object
+     */
+    class Scope : private boost::noncopyable {
+    public:
+        /**
+         * Set the context of the calling thread
+         *
+         * @param origin the time the change entered the system; a
+         * default-constructed time point clears the context
+         */
+        explicit Scope(clock::time_point origin);
+
+        /**
+         * Restore the context that was in effect on the calling
+         * thread when the scope was created
+         */
+        ~Scope();
+
+    private:
+        clock::time_point savedOrigin;
+        clock::time_point savedStart;
+    };
+};
+
+/** @} modb */
+/** @} cpp */
+
+} /* namespace modb */
+} /* namespace opflex */
+
+#endif /* MODB_TRACECONTEXT_H */
@@ -17,6 +17,7 @@
 #include <boost/any.hpp>
 #include <boost/functional/hash.hpp>
 
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -37,6 +38,10 @@ namespace modb {
  * properties such as "/childname1/5/childname2/8/value2" that
  * represents a unique path from the root of the tree to the specific
  * child.
+ *
+ * When interning is enabled with URI::setInterning(), URIs
+ * constructed from the same string share a single copy of the string
+ * so that equality checks between them reduce to a pointer compare.
  */
 class URI {
 public:
@@ -81,7 +86,53 @@ public:
      */
     static const URI ROOT;
 
+    /**
+     * Enable or disable interning of URI strings.  While enabled,
+     * newly-constructed URIs look up their string representation in
+     * a global table and share storage with any live URI with the
+     * same value.  URIs that already exist are not affected.
+     *
+     * @param enabled true to enable interning
+     */
+    static void setInterning(bool enabled);
+
+    /**
+     * Check whether URI interning is currently enabled
+     *
+     * @return true if newly-constructed URIs are interned
+     */
+    static bool isInterning();
+
+    /**
+     * Get the number of distinct URI strings currently held in the
+     * intern table
+     *
+     * @return the number of interned strings
+     */
+    static size_t getInternedCount();
+
+    /**
+     * Construct a URI whose string is interned, whether or not
+     * interning is enabled globally with setInterning().
+     *
+     * @param uri the string representation of the URI
+     * @return a URI sharing storage with any live interned URI with
+     * the same value
+     */
+    static URI intern(const std::string& uri);
+
+    /**
+     * Get the approximate number of bytes of memory used by this
+     * URI.  Storage for the string that is shared with other URIs is
+     * divided evenly between them.
+     *
+     * @return the approximate memory use in bytes
+     */
+    size_t getMemoryUsage() const;
+
 private:
+    URI(const std::shared_ptr<const std::string>& uri, size_t hashv);
+
     std::shared_ptr<const std::string> uri;
     size_t hashv;
 
@@ -114,6 +165,12 @@ bool operator<(const URI& lhs, const URI& rhs);
  */
 size_t hash_value(URI const& uri);
 
+/**
+ * A callback invoked for each URI visited during an iteration.
+ * Return false to stop the iteration early.
+ */
+typedef std::function<bool(const URI&)> uri_visitor_t;
+
 /* @} modb */
 /* @} cpp */
 
@@ -31,6 +31,11 @@ namespace modb {
 
 /**
  * @brief Build a URI using path elements from the root of the tree.
+ *
+ * Elements are escaped and appended directly into a string buffer.
+ * Buffers are recycled through a small per-thread cache, so building
+ * a URI normally allocates only the resulting URI string, or nothing
+ * at all when buildInterned() finds an existing interned copy.
  */
 class URIBuilder {
 public:
@@ -108,6 +113,12 @@ public:
      */
     URI build();
 
+    /**
+     * Build the URI from the path elements and return it as an
+     * interned URI, regardless of URI::isInterning()
+     */
+    URI buildInterned();
+
 private:
     class URIBuilderImpl;
     friend class URIBuilderImpl;
@@ -0,0 +1,78 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*!
+ * @file ClassCodec.h
+ * @brief Interface definition file for ClassCodec
+ */
+/*
+ * Copyright (c) 2014 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#ifndef MODB_CLASSCODEC_H
+#define MODB_CLASSCODEC_H
+
+#include <rapidjson/document.h>
+
+#include "opflex/yajr/rpc/rpc.hpp"
+
+namespace opflex {
+namespace modb {
+namespace mointernal {
+
+class ObjectInstance;
+
+/**
+ * A class-specific JSON encoder and decoder for the value
+ * properties of a managed object, generated by the code generation
+ * framework alongside the class metadata.
+ *
+ * A codec handles the string, integer, MAC address and enum
+ * properties of its class.  Reference and child properties need
+ * to consult the object store and are always handled by the
+ * generic serializer, which is also used for any class without a
+ * codec.
+ */
+struct ClassCodec {
+    /**
+     * Write each set value property of the object instance to the
+     * writer as a property object with name and data members
+     *
+     * @param oi the object instance to encode
+     * @param writer the writer to write to
+     */
+    typedef void (*encode_t)(const ObjectInstance& oi,
+                             yajr::rpc::SendHandler& writer);
+
+    /**
+     * Decode a single property into the object instance.  A value
+     * of the wrong JSON type is ignored.
+     *
+     * @param name the name of the property
+     * @param data the property value
+     * @param oi the object instance where we'll store the result
+     * @return true if the name is a value property of this class,
+     * or false if the generic serializer should handle it
+     */
+    typedef bool (*decode_t)(const char* name,
+                             const rapidjson::Value& data,
+                             ObjectInstance& oi);
+
+    /**
+     * The encoder for the class
+     */
+    encode_t encode;
+
+    /**
+     * The decoder for the class
+     */
+    decode_t decode;
+};
+
+} /* namespace mointernal */
+} /* namespace modb */
+} /* namespace opflex */
+
+#endif /* MODB_CLASSCODEC_H */
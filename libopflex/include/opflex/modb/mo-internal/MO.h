@@ -163,9 +163,43 @@ protected:
         }
     }
 
+    /**
+     * Resolve a batch of URIs of the same class to their managed
+     * object wrapper classes, locking the store once for the batch.
+     *
+     * @param framework the framework instance
+     * @param class_id the class ID for the corresponding objects
+     * @param uris the URIs to resolve
+     * @param out the managed objects, in the same order as uris.  An
+     * entry is boost::none if the object does not exist.
+     */
+    template <class T> static
+    void resolveAll(ofcore::OFFramework& framework,
+                    class_id_t class_id,
+                    const std::vector<URI>& uris,
+                    /* out */ std::vector<boost::optional<std::shared_ptr<T> > >& out) {
+        std::vector<reference_t> refs;
+        refs.reserve(uris.size());
+        for (const URI& uri : uris)
+            refs.push_back(std::make_pair(class_id, uri));
+        std::vector<std::shared_ptr<const ObjectInstance> > ois;
+        MO::getStoreClient(framework).getAll(refs, ois);
+
+        out.clear();
+        out.reserve(uris.size());
+        for (size_t i = 0; i < uris.size(); ++i) {
+            if (ois[i])
+                out.push_back(std::make_shared<T>(framework, uris[i], ois[i]));
+            else
+                out.push_back(boost::none);
+        }
+    }
+
     /**
      * Resolve any children of the specified parent object to their
-     * managed object wrapper classes.
+     * managed object wrapper classes.  Without a snapshot on the
+     * thread, the children are read under the lock of their region
+     * only, so the result is not consistent with other regions.
      */
     template <class T> static
     void resolveChildren(ofcore::OFFramework& framework,
@@ -174,16 +208,14 @@ protected:
                          prop_id_t parent_prop,
                          class_id_t child_class,
                          /* out */ std::vector<std::shared_ptr<T> >& out) {
-        std::vector<URI> childURIs;
         MO::getStoreClient(framework)
-            .getChildren(parent_class, parent_uri, parent_prop,
-                         child_class, childURIs);
-        std::vector<URI>::const_iterator it;
-        for (it = childURIs.begin(); it != childURIs.end(); ++it) {
-            boost::optional<std::shared_ptr<T> > child =
-                resolve<T>(framework, child_class, *it);
-            if (child) out.push_back(child.get());
-        }
+            .forEachChild(parent_class, parent_uri, parent_prop, child_class,
+                          [&](const URI& uri) {
+                              boost::optional<std::shared_ptr<T> > child =
+                                  resolve<T>(framework, child_class, uri);
+                              if (child) out.push_back(child.get());
+                              return true;
+                          });
     }
 
     /**
@@ -14,8 +14,10 @@
 #ifndef MODB_OBJECTINSTANCE_H_
 #define MODB_OBJECTINSTANCE_H_
 
+#include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 #include <boost/tuple/tuple_comparison.hpp>
 #include <boost/cstdint.hpp>
 #include <boost/variant.hpp>
@@ -116,6 +118,32 @@ public:
     ObjectInstance(class_id_t class_id_, bool local_)
         : class_id(class_id_), local(local_) { }
 
+    /**
+     * Construct an empty delta over the given base object.  A delta
+     * records only the properties that are modified through it and
+     * reads any other property from the base, copying a property
+     * from the base only when it is first modified.  Use merge() to
+     * produce the full object that can be written to the store.
+     *
+     * @param base the object that this delta modifies
+     */
+    explicit ObjectInstance(const std::shared_ptr<const ObjectInstance>& base);
+
+    /**
+     * Copy an object instance
+     */
+    ObjectInstance(const ObjectInstance& oi);
+
+    /**
+     * Assign an object instance
+     */
+    ObjectInstance& operator=(const ObjectInstance& oi);
+
+    /**
+     * Destroy the object instance
+     */
+    ~ObjectInstance();
+
     /**
      * Get the class ID for this object instance
      *
@@ -298,6 +326,25 @@ public:
      */
     size_t getMACSize(prop_id_t prop_id) const;
 
+    /**
+     * @name Single-lookup accessors
+     * Get a pointer to the value of a scalar property, or NULL if it
+     * is not set.  These check for and fetch the value with a single
+     * lookup, and are used by generated managed object accessors.
+     * The pointer is valid until the object instance is modified or
+     * destroyed.
+     *
+     * @param prop_id the property ID to look up
+     * @return a pointer to the value, or NULL if it is not set
+     */
+    /**@{*/
+    const uint64_t* findUInt64(prop_id_t prop_id) const;
+    const int64_t* findInt64(prop_id_t prop_id) const;
+    const std::string* findString(prop_id_t prop_id) const;
+    const reference_t* findReference(prop_id_t prop_id) const;
+    const MAC* findMAC(prop_id_t prop_id) const;
+    /**@}*/
+
     /**
      * Set the uint64-valued parameter to the specified value
      *
@@ -454,6 +501,50 @@ public:
      */
     void addMAC(prop_id_t prop_id, const MAC& value);
 
+    /**
+     * Get the approximate number of bytes of memory used by this
+     * object instance and its property values.  Storage for
+     * reference URIs is shared as described in URI::getMemoryUsage().
+     *
+     * @return the approximate memory use in bytes
+     */
+    size_t getMemoryUsage() const;
+
+    /**
+     * Check whether this object is a delta over a base object
+     *
+     * @return true if the object is a delta
+     */
+    bool isDelta() const { return delta.get() != NULL; }
+
+    /**
+     * Check whether the properties modified in this delta actually
+     * differ from the base.  Each modified property is compared
+     * individually; for an object that is not a delta this always
+     * returns true.
+     *
+     * @return true if applying the delta would change the base
+     */
+    bool hasChanges() const;
+
+    /**
+     * Replace the base of this delta, for example with a newer
+     * version of the same object, keeping the recorded modifications
+     *
+     * @param base the new base object
+     * @throws std::logic_error if the object is not a delta
+     */
+    void rebase(const std::shared_ptr<const ObjectInstance>& base);
+
+    /**
+     * Apply the modifications recorded in this delta to its base and
+     * return the result as a new object that is not a delta.  For an
+     * object that is not a delta this returns a copy.
+     *
+     * @return the merged object
+     */
+    std::shared_ptr<ObjectInstance> merge() const;
+
 private:
     class_id_t class_id;
 
@@ -474,16 +565,42 @@ private:
 
         Value() : type(PropertyInfo::STRING), cardinality(PropertyInfo::SCALAR) {}
         Value(const Value& val);
+        Value(Value&& val) noexcept;
         ~Value();
         Value& operator=(const Value& val);
+        Value& operator=(Value&& val) noexcept;
     private:
         void clear();
     };
 
-    typedef std::unordered_map<prop_key_t, Value> prop_map_t;
+    /**
+     * Properties are stored in a contiguous array sorted by property
+     * ID.  Objects typically have only a handful of properties, so
+     * this is both smaller and faster to search and copy than a hash
+     * table.
+     */
+    typedef std::pair<prop_key_t, Value> prop_entry_t;
+    typedef std::vector<prop_entry_t> prop_map_t;
     prop_map_t prop_map;
+
+    static bool keyLess(const prop_entry_t& entry, const prop_key_t& key);
+    prop_map_t::iterator lowerBound(const prop_key_t& key);
+    const Value* findValue(const prop_key_t& key) const;
+    const Value& getValue(const prop_key_t& key) const;
+    Value& findOrInsert(const prop_key_t& key, bool copyBase = false);
+
     bool local;
 
+    /**
+     * State for an object that is a delta over a base object, with
+     * the keys of base properties that were unset through the delta
+     */
+    struct Delta {
+        std::shared_ptr<const ObjectInstance> base;
+        std::vector<prop_key_t> unset;
+    };
+    std::unique_ptr<Delta> delta;
+
     friend bool operator==(const ObjectInstance& lhs,
                            const ObjectInstance& rhs);
     friend bool operator!=(const ObjectInstance& lhs,
@@ -497,7 +614,9 @@ private:
 };
 
 /**
- * Check for ObjectInstance equality.
+ * Check for ObjectInstance equality.  A delta is compared by the
+ * changes it records and its base, so it is never equal to an object
+ * that is not a delta.
  */
 bool operator==(const ObjectInstance& lhs, const ObjectInstance& rhs);
 /**
@@ -16,6 +16,7 @@
 
 #include <boost/noncopyable.hpp>
 #include <unordered_set>
+#include <vector>
 
 #include "opflex/modb/URI.h"
 #include "opflex/modb/mo-internal/ObjectInstance.h"
@@ -106,6 +107,19 @@ public:
     bool get(class_id_t class_id, const URI& uri,
              /*out*/ std::shared_ptr<const ObjectInstance>& oi) const;
 
+    /**
+     * Get the object instances for a batch of references.  The
+     * references are grouped by region so that each region is locked
+     * once for the whole batch rather than once per object.
+     *
+     * @param refs the class IDs and URIs of the objects to retrieve
+     * @param out the object instances, in the same order as refs.  An
+     * entry is null if the object is not present or its class is not
+     * registered.
+     */
+    void getAll(const std::vector<reference_t>& refs,
+                /*out*/ std::vector<std::shared_ptr<const ObjectInstance> >& out) const;
+
     /**
      * A map to store queued notifications
      */
@@ -185,7 +199,10 @@ public:
 
     /**
      * Get the children of the parent URI and property and put the
-     * result into the supplied vector.
+     * result into the supplied vector.  On a thread reading a
+     * snapshot, children created since the snapshot are skipped;
+     * the child index is not versioned, so children removed since
+     * then are missing.
      *
      * @param parent_class the class ID of the parent
      * @param parent_uri the URI of the parent object
@@ -200,9 +217,36 @@ public:
                      class_id_t child_class,
                      /* out */ std::vector<URI>& output);
 
+    /**
+     * Invoke the visitor for each child of the parent URI and
+     * property without copying the children.  The children are
+     * visited under the lock of the child region; the visitor may
+     * read from the store but must not modify it.  The snapshot of
+     * the thread is honored as for getChildren().  Only the child
+     * region is locked, so reads from other regions in the visitor
+     * see a view that is not consistent with it unless the thread
+     * reads a snapshot.
+     *
+     * @param parent_class the class ID of the parent
+     * @param parent_uri the URI of the parent object
+     * @param parent_prop the property ID in the parent object
+     * @param child_class the class ID of the child
+     * @param visitor the visitor to invoke for each child.  Return
+     * false to stop early.
+     * @return false if the visitor stopped the iteration early
+     * @throws std::out_of_range If no such class ID is registered
+     */
+    bool forEachChild(class_id_t parent_class,
+                      const URI& parent_uri,
+                      prop_id_t parent_prop,
+                      class_id_t child_class,
+                      const uri_visitor_t& visitor);
+
     /**
      * Remove all the children of the given object, exluding the
-     * object itself.
+     * object itself.  The subtree is walked iteratively and removed
+     * with a single lock of each region it spans; the notifications
+     * for the whole subtree are added to notifs in one batch.
      *
      * @param class_id the class ID for the object being inserted
      * @param uri the URI to remove
@@ -231,7 +275,10 @@ public:
     void deliverNotifications(const notif_t& notifs);
 
     /**
-     * Get a set of all objects with the given class ID
+     * Get a set of all objects with the given class ID.  On a thread
+     * reading a snapshot, objects created since the snapshot are
+     * skipped; the class index is not versioned, so objects removed
+     * since then are missing.
      *
      * @param class_id the class_id to look up
      * @param output An unordered set that will get the output
@@ -240,6 +287,71 @@ public:
     void getObjectsForClass(class_id_t class_id,
                             /* out */ std::unordered_set<URI>& output);
 
+    /**
+     * Invoke the visitor for each object with the given class ID
+     * without copying the instance set.  The objects are visited
+     * under the region lock; the visitor may read from the store but
+     * must not modify it.  The snapshot of the thread is honored as
+     * for getObjectsForClass().  Only that region is locked, so reads
+     * from other regions in the visitor see a view that is not
+     * consistent with it unless the thread reads a snapshot.
+     *
+     * @param class_id the class_id to look up
+     * @param visitor the visitor to invoke for each URI.  Return
+     * false to stop early.
+     * @return false if the visitor stopped the iteration early
+     * @throws std::out_of_range if the class is not found
+     */
+    bool forEachObjectOfClass(class_id_t class_id,
+                              const uri_visitor_t& visitor);
+
+    /**
+     * Find the objects of the given class whose integer or enum
+     * property contains the given value, using a secondary index
+     * registered with ObjectStore::addIndex().  Signed properties
+     * are looked up by their value cast to an unsigned integer.
+     *
+     * @param class_id the class ID
+     * @param prop_id the indexed property
+     * @param value the value to find
+     * @param output An unordered set that will get the output
+     * @throws std::out_of_range if the class is not found or the
+     * property is not indexed
+     */
+    void findByProperty(class_id_t class_id, prop_id_t prop_id,
+                        uint64_t value,
+                        /* out */ std::unordered_set<URI>& output);
+
+    /**
+     * Find the objects of the given class whose string property
+     * contains the given value
+     *
+     * @see findByProperty(class_id_t, prop_id_t, uint64_t, std::unordered_set<URI>&)
+     */
+    void findByProperty(class_id_t class_id, prop_id_t prop_id,
+                        const std::string& value,
+                        /* out */ std::unordered_set<URI>& output);
+
+    /**
+     * Find the objects of the given class whose MAC property
+     * contains the given value
+     *
+     * @see findByProperty(class_id_t, prop_id_t, uint64_t, std::unordered_set<URI>&)
+     */
+    void findByProperty(class_id_t class_id, prop_id_t prop_id,
+                        const MAC& value,
+                        /* out */ std::unordered_set<URI>& output);
+
+    /**
+     * Find the objects of the given class whose reference property
+     * contains the given value
+     *
+     * @see findByProperty(class_id_t, prop_id_t, uint64_t, std::unordered_set<URI>&)
+     */
+    void findByProperty(class_id_t class_id, prop_id_t prop_id,
+                        const reference_t& value,
+                        /* out */ std::unordered_set<URI>& output);
+
 private:
 
     friend class opflex::modb::Region;
@@ -79,6 +79,48 @@ public:
      */
     virtual void setUnresolved(bool enabled) = 0;
 
+    /**
+     * Limit the subtree downloaded for each object when recursive
+     * downloading is enabled.  Applies to queries added after the
+     * call.
+     *
+     * @param depth the number of levels of children to download, or
+     * 0 to download the whole subtree
+     */
+    virtual void setDepth(size_t depth) = 0;
+
+    /**
+     * Only download the children of the given class when recursive
+     * downloading is enabled.  Call once for each class to download;
+     * if never called, children of every class are downloaded.
+     * Applies to queries added after the call.
+     *
+     * @param subject the name of the class
+     */
+    virtual void addChildClass(const std::string& subject) = 0;
+
+    /**
+     * Only return the objects of class queries whose property has
+     * the given value.  Values are compared as they appear in a
+     * dump, so enums match by name or value and references by URI.
+     * Applies to class queries added after the call.
+     *
+     * @param property the name of the property
+     * @param value the value to match
+     */
+    virtual void addFilter(const std::string& property,
+                           const std::string& value) = 0;
+
+    /**
+     * Retrieve the objects of each class query in pages of at most
+     * the given number of objects rather than in a single response.
+     * Applies to class queries added after the call.
+     *
+     * @param size the page size, or 0 to retrieve all of the objects
+     * in one response
+     */
+    virtual void setPageSize(size_t size) = 0;
+
     /**
      * Query for a particular managed object
      *
@@ -95,6 +137,34 @@ public:
      */
     virtual void addClassQuery(const std::string& subject) = 0;
 
+    /**
+     * Query for the approximate per-class memory accounting of the
+     * remote object store
+     */
+    virtual void addStoreStatsQuery() = 0;
+
+    /**
+     * Watch for changes to the remote object store, printing each
+     * change to the given stream as it is seen until the connection
+     * closes.  The client polls the change journal of the server, so
+     * the server must have the journal enabled, and the properties
+     * printed are those the object has when it is polled.
+     *
+     * @param subject the subject (class name) to watch, or an empty
+     * string for all classes
+     * @param uriPrefix only watch objects whose URI starts with the
+     * prefix, such as the URI of a subtree, or an empty string for
+     * all objects
+     * @param output the output stream to write to
+     * @param includeProps print the properties of updated objects
+     * @param interval the time between polls in milliseconds
+     */
+    virtual void addWatch(const std::string& subject,
+                          const std::string& uriPrefix,
+                          std::ostream& output,
+                          bool includeProps = false,
+                          size_t interval = 1000) = 0;
+
     /**
      * Attempt to execute all queued inspector commands
      */
@@ -117,6 +187,25 @@ public:
      */
     virtual size_t loadFromFile(FILE* file) = 0;
 
+    /**
+     * Dump the current MODB view to the specified file as a binary
+     * MODB image, which can be loaded much faster than the JSON
+     * format.
+     *
+     * @param file the file to write to
+     * @return true if the image was written successfully
+     */
+    virtual bool dumpToImage(FILE* file) = 0;
+
+    /**
+     * Load a binary MODB image written by dumpToImage into the
+     * inspector's MODB view in order to display it.
+     *
+     * @param file the name of the image file to load
+     * @return the number of managed objects loaded
+     */
+    virtual size_t loadFromImage(const std::string& file) = 0;
+
     /**
      * Pretty print the current MODB to the provided output stream.
      *
@@ -133,6 +222,14 @@ public:
                              bool utf8 = true,
                              size_t truncate = 0) = 0;
 
+    /**
+     * Print the store stats retrieved with addStoreStatsQuery() to
+     * the provided output stream, largest classes first.
+     *
+     * @param output the output stream to write to
+     */
+    virtual void printStoreStats(std::ostream& output) = 0;
+
 };
 
 /** @} ofcore */
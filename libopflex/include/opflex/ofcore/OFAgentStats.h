@@ -14,6 +14,129 @@
 #define OPFLEX_OFSTATS_H
 
 #include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * A histogram of latency samples with fixed exponential bucket
+ * bounds, safe to update and read from any thread.  The unit of the
+ * samples is chosen by the owner of the histogram.
+ */
+class OFLatencyHistogram {
+
+public:
+
+    /**
+     * The number of buckets with a finite upper bound
+     */
+    static const size_t BUCKETS = 14;
+
+    /**
+     * Get the inclusive upper bound of a bucket
+     *
+     * @param bucket the bucket index, less than BUCKETS
+     * @return the upper bound of the bucket
+     */
+    static uint64_t getBound(size_t bucket) {
+        static const uint64_t bounds[BUCKETS] =
+            { 1, 2, 5, 10, 25, 50, 100, 250, 500, 1000,
+              2500, 5000, 10000, 30000 };
+        return bounds[bucket];
+    }
+
+    /**
+     * Record a sample
+     *
+     * @param value the sample to record
+     */
+    void observe(uint64_t value) {
+        size_t b = 0;
+        while (b < BUCKETS && value > getBound(b)) b++;
+        counts[b]++;
+        sum += value;
+    }
+
+    /**
+     * Get the number of samples less than or equal to the upper bound
+     * of a bucket, or the total number of samples for the bucket index
+     * BUCKETS
+     *
+     * @param bucket the bucket index, at most BUCKETS
+     * @return the cumulative count of samples
+     */
+    uint64_t getCumulativeCount(size_t bucket) const {
+        uint64_t total = 0;
+        for (size_t b = 0; b <= bucket && b <= BUCKETS; ++b)
+            total += counts[b];
+        return total;
+    }
+
+    /** get the number of samples recorded */
+    uint64_t getCount() const { return getCumulativeCount(BUCKETS); }
+    /** get the sum of the samples recorded */
+    uint64_t getSum() const { return sum; }
+
+private:
+
+    std::atomic_ullong counts[BUCKETS + 1] {};
+    std::atomic_ullong sum{};
+};
+
+/**
+ * A set of latency histograms keyed by JSON-RPC method name, with a
+ * histogram created for each method the first time it is observed.
+ * Safe to update and read from any thread.
+ */
+class OFMethodLatency {
+
+public:
+
+    /**
+     * A map from method name to its histogram
+     */
+    typedef std::unordered_map<std::string,
+                               std::shared_ptr<const OFLatencyHistogram> >
+        method_map_t;
+
+    /**
+     * Record a sample for a method
+     *
+     * @param method the name of the method
+     * @param value the sample to record
+     */
+    void observe(const std::string& method, uint64_t value) {
+        std::shared_ptr<OFLatencyHistogram> hist;
+        {
+            const std::lock_guard<std::mutex> lock(mutex);
+            std::shared_ptr<OFLatencyHistogram>& h = histograms[method];
+            if (!h) h = std::make_shared<OFLatencyHistogram>();
+            hist = h;
+        }
+        hist->observe(value);
+    }
+
+    /**
+     * Get the histograms of every method observed so far
+     *
+     * @param latency a map that will be filled with the histogram for
+     * each method
+     */
+    void getLatency(/* out */ method_map_t& latency) const {
+        const std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& h : histograms)
+            latency[h.first] = h.second;
+    }
+
+private:
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string,
+                       std::shared_ptr<OFLatencyHistogram> > histograms;
+};
 
 /**
  * OpFlex client stats counters
@@ -121,6 +244,15 @@ public:
     /** get the number of policies requested by the client which is not yet received */
     uint64_t getPolUnresolvedCount() { return polUnresolvedCount; }
 
+    /** get the latency of policy_resolve responses in milliseconds */
+    OFLatencyHistogram& getPolResolveLatency() { return polResolveLatency; }
+    /** get the latency of endpoint_declare responses in milliseconds */
+    OFLatencyHistogram& getEpDeclareLatency() { return epDeclareLatency; }
+    /** get the round-trip time of keep-alive echoes in milliseconds */
+    OFLatencyHistogram& getKeepAliveRtt() { return keepAliveRtt; }
+    /** get the latency of responses per request method in milliseconds */
+    OFMethodLatency& getMethodLatency() { return methodLatency; }
+
 
 private:
 
@@ -151,6 +283,11 @@ private:
     std::atomic_ullong stateReportErrs{};
  
     std::atomic_ullong polUnresolvedCount{};
+
+    OFLatencyHistogram polResolveLatency;
+    OFLatencyHistogram epDeclareLatency;
+    OFLatencyHistogram keepAliveRtt;
+    OFMethodLatency methodLatency;
 };
 
 #endif //OPFLEX_OFSTATS_H
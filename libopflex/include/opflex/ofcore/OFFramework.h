@@ -580,6 +580,7 @@
 #include <boost/optional.hpp>
 
 #include "opflex/modb/Mutator.h"
+#include "opflex/modb/ClassStats.h"
 #include "opflex/ofcore/PeerStatusListener.h"
 #include "opflex/ofcore/MainLoopAdaptor.h"
 #include "opflex/ofcore/OFConstants.h"
@@ -735,6 +736,26 @@ public:
      */
     void setPrrTimerDuration(const uint64_t duration);
 
+    /**
+     * Set the lease to request for the declarations of local
+     * endpoints.  A lease longer than the prr timer duration is only
+     * used once the peer grants it.
+     *
+     * @param lease the lease in seconds, or zero to use the prr timer
+     * duration
+     */
+    void setEndpointLease(uint64_t lease);
+
+    /**
+     * Set the number of buckets over half the endpoint lease that
+     * the renewals of local endpoint declarations are grouped into,
+     * so that the endpoints of a bucket are renewed with one request.
+     *
+     * @param buckets the number of buckets, or zero to renew each
+     * endpoint on its own timer
+     */
+    void setRenewalBuckets(size_t buckets);
+
     /**
      * Set the peer handshake timeout
      * @param timeout peer handshake timeout in milliseconds
@@ -747,6 +768,44 @@ public:
      */
     void setKeepaliveTimeout(const uint32_t timeout);
 
+    /**
+     * Set the send watermarks for the connections to the peers.
+     * Once more than high bytes are waiting to be sent to a peer, no
+     * new requests are sent to it until no more than low bytes are
+     * left.  Must be called before start().
+     *
+     * @param high the high watermark in bytes, or 0 to disable
+     * @param low the low watermark in bytes
+     */
+    void setSendWatermarks(size_t high, size_t low);
+
+    /**
+     * Set the number of threads used to deliver object store
+     * notifications to listeners.  Must be called before start().
+     *
+     * @param workers the number of notification workers
+     * @see modb::ObjectListener::isThreadSafe
+     */
+    void setNotificationWorkers(size_t workers);
+
+    /**
+     * Set the number of threads processing the synchronization of
+     * managed objects with the OpFlex peers.  Objects are partitioned
+     * across the threads by URI.  Must be called before start().
+     *
+     * @param threads the number of processing threads
+     */
+    void setProcessingThreads(size_t threads);
+
+    /**
+     * Set the number of object store changes retained in the change
+     * journal, so that consumers can catch up on recent changes
+     * without walking the whole store.  Zero disables the journal.
+     *
+     * @param size the maximum number of changes to retain
+     */
+    void setJournalSize(size_t size);
+
     /**
      * Start the framework.  This will start all the framework threads
      * and attempt to connect to configured OpFlex peers.
@@ -786,6 +845,32 @@ public:
      */
     virtual void dumpMODB(FILE* file);
 
+    /**
+     * Dump the managed object database to the file specified on a
+     * background thread, reading from a snapshot of the store.  A
+     * JSON dump is written as compact JSON and pauses between chunks
+     * of objects, so that dumping a busy store does not hold up
+     * policy processing.  Only one dump runs at a time.
+     *
+     * @param file the file to write to.
+     * @param image write a binary store image rather than JSON
+     * @return true if the dump was started, or false if another dump
+     * is still running
+     */
+    virtual bool dumpMODBAsync(const std::string& file, bool image = false);
+
+    /**
+     * Load managed objects from a file written by dumpMODB() or
+     * dumpMODBAsync() into the managed object database, as if they
+     * had been received from the policy repository, and notify the
+     * listeners of the objects loaded.  This is meant for tools that
+     * replay a recorded state.
+     *
+     * @param file the JSON dump or store image to read
+     * @return the number of managed objects loaded
+     */
+    virtual size_t loadMODB(const std::string& file);
+
     /**
      * Pretty print the current MODB to the provided output stream.
      *
@@ -905,6 +990,44 @@ public:
      */
     void getOpflexPeerStats(std::unordered_map<std::string, std::shared_ptr<OFAgentStats>>& stats);
 
+    /**
+     * Retrieve approximate memory accounting for each class in the
+     * managed object database.  This walks every object in the
+     * store, so it should not be called frequently.
+     *
+     * @param stats Map of class names to the stats for that class
+     */
+    void getStoreStats(modb::class_stats_map_t& stats);
+
+    /**
+     * Retrieve the number of managed objects tracked by the OpFlex
+     * processor in each processing state.  Large counts in the new,
+     * updated or unresolved states indicate a processing backlog.
+     *
+     * @param counts Map of state names to the number of objects in
+     * that state
+     */
+    void getProcessorStats(std::unordered_map<std::string, uint64_t>& counts);
+
+    /**
+     * Get the histogram of the time the OpFlex processor spends
+     * processing each managed object
+     *
+     * @return the histogram, in microseconds
+     */
+    const OFLatencyHistogram& getProcessTimeStats();
+
+    /**
+     * Retrieve the histograms of the latency of policy resolution for
+     * each policy class, from sending a resolve request to receiving
+     * its response
+     *
+     * @param latency Map of class names to the histogram for that
+     * class, in milliseconds
+     */
+    void getResolveLatencyStats(std::unordered_map<std::string,
+                                std::shared_ptr<const OFLatencyHistogram> >& latency);
+
     /**
      * Enable/Disable reporting of observable changes to registered observers
      *
@@ -918,6 +1041,108 @@ public:
       */
      void disableObservableReporting();
 
+    /**
+     * Set the minimum interval between state reports for an object
+     * of any observable class.  Changes made within the interval are
+     * coalesced into a single report.
+     *
+     * @param interval the interval in milliseconds, or zero to report
+     * every change
+     */
+    void setStateReportInterval(uint64_t interval);
+
+    /**
+     * Set the minimum interval between state reports for objects of
+     * a specific observable class.  Must be called before start().
+     *
+     * @param class_id Observable class ID
+     * @param interval the interval in milliseconds
+     */
+    void overrideStateReportInterval(modb::class_id_t class_id,
+                                     uint64_t interval);
+
+    /**
+     * Set the approximate number of bytes of state reports that may
+     * be sent to each observer peer per second
+     *
+     * @param bytesPerSecond the budget, or zero for no limit
+     */
+    void setStateReportBudget(uint64_t bytesPerSecond);
+
+    /**
+     * Keep a cache of the resolved policy on disk, so that after a
+     * restart the cached policy can be used while it is resolved
+     * again from the peers.  Must be called before start().
+     *
+     * @param file the path to the cache file, or an empty string to
+     * disable the cache
+     * @param interval the interval between writes of the cache in
+     * milliseconds, or zero to write it only on stop()
+     */
+    void setPolicyCache(const std::string& file, uint64_t interval);
+
+    /**
+     * Resolve policy objects before the local policy references
+     * them, for instance for the dependencies that a new endpoint
+     * group is expected to have.  The objects are resolved in one
+     * batch of requests and kept for the hold time even if nothing
+     * references them.
+     *
+     * @param refs the class IDs and URIs of the objects
+     * @param holdTime the time to keep unreferenced objects in
+     * milliseconds
+     */
+    void prefetch(const std::vector<std::pair<modb::class_id_t,
+                                              modb::URI> >& refs,
+                  uint64_t holdTime);
+
+    /**
+     * Enable or disable sharing the request load across peers.  When
+     * enabled, resolves and declares for each subject are sent to one
+     * of the ready peers of the role, chosen consistently by URI,
+     * instead of to all of them.  The subjects of a peer that fails
+     * are sent again to the remaining peers.
+     *
+     * @param enabled true to enable load sharing
+     */
+    void setLoadSharing(bool enabled);
+
+    /**
+     * Enable or disable compression of the OpFlex traffic.  When
+     * enabled, compression is offered in the handshake with each
+     * peer, and the connections to the peers that accept it are
+     * deflated in both directions, underneath SSL if it is enabled.
+     *
+     * @param enabled true to offer compression
+     */
+    void setCompression(bool enabled);
+
+    /**
+     * Enable or disable the binary encoding of the OpFlex traffic.
+     * When enabled, the binary encoding is offered in the handshake
+     * with each peer, and the connections to the peers that accept
+     * it carry CBOR rather than JSON in both directions.  JSON
+     * remains the default for interoperability.
+     *
+     * @param enabled true to offer the binary encoding
+     */
+    void setBinaryEncoding(bool enabled);
+
+    /**
+     * Parse the messages of at least the given size received from
+     * the OpFlex peers on a pool of worker threads, so that a very
+     * large message, such as a big policy resolve response, does not
+     * delay the keepalives and the other traffic of the connections.
+     * The messages are still handled in the order they were
+     * received.  The libuv thread pool does the parsing, and its
+     * size can be set with the UV_THREADPOOL_SIZE environment
+     * variable.
+     *
+     * @param threshold the message size in bytes, or 0 to parse every
+     * message on the connection's own thread
+     */
+    void setParseOffload(size_t threshold);
+
     /**
      * Get the object store that provides access to the managed object
      * database.
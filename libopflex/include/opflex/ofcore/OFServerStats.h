@@ -15,6 +15,8 @@
 
 #include <atomic>
 
+#include "opflex/ofcore/OFAgentStats.h"
+
 /**
  * OpFlex server stats counters
  */
@@ -110,6 +112,11 @@ public:
     /** increment the number of state_report msgs received errs */
     void incrStateReportErrs() { stateReportErrs++; }
 
+    /** get the round-trip time of keep-alive echoes in milliseconds */
+    OFLatencyHistogram& getKeepAliveRtt() { return keepAliveRtt; }
+    /** get the latency of responses per request method in milliseconds */
+    OFMethodLatency& getMethodLatency() { return methodLatency; }
+
 private:
     std::atomic_ullong identReqs{};
     std::atomic_ullong polUpdates{};
@@ -128,6 +135,9 @@ private:
     std::atomic_ullong epUnresolveErrs{};
     std::atomic_ullong stateReports{};
     std::atomic_ullong stateReportErrs{};
+
+    OFLatencyHistogram keepAliveRtt;
+    OFMethodLatency methodLatency;
 };
 
 #endif //OPFLEX_OFSERVERSTATS_H
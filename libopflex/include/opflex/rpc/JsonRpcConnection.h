@@ -16,6 +16,9 @@
 #ifndef RPC_JSONRPCCONNECTION_H
 #define RPC_JSONRPCCONNECTION_H
 
+#include <atomic>
+#include <deque>
+#include <memory>
 #include <mutex>
 #include <boost/noncopyable.hpp>
 
@@ -95,6 +98,20 @@ public:
      */
     virtual void handleUpdate(const rapidjson::Document& payload) {};
 
+    /**
+     * call back for monitor_cond_since response.  Errors are
+     * reported to handleMonitorError.
+     * @param[in] reqId request ID of the request for this response.
+     * @param[in] payload rapidjson::Value reference of the response body.
+     */
+    virtual void handleMonitorCondSince(uint64_t reqId, const rapidjson::Document& payload) {};
+
+    /**
+     * call back for update3 request
+     * @param[in] payload rapidjson::Value reference of the request body.
+     */
+    virtual void handleUpdate3(const rapidjson::Document& payload) {};
+
     /**
      * destructor
      */
@@ -129,6 +146,19 @@ public:
      */
     virtual void sendMessage(JsonRpcMessage* message, bool sync = false);
 
+    /**
+     * Send a JSON-RPC message that may also be queued on other
+     * connections.  The message is serialized separately for each
+     * connection, so it must not be modified once it is shared.  This
+     * can be called from any thread.
+     *
+     * @param message the message to send
+     * @param sync if true, send the message synchronously.  This can
+     * only be called if it's called from the uv loop thread.
+     */
+    void sendMessage(const std::shared_ptr<JsonRpcMessage>& message,
+                     bool sync = false);
+
     /**
      * Get a human-readable view of the name of the remote peer
      *
@@ -136,6 +166,14 @@ public:
      */
     virtual const std::string& getRemotePeer() = 0;
 
+    /**
+     * Check whether the peer has fallen behind on reading what we
+     * send.  While it is congested the write queue is left alone.
+     *
+     * @return true if the connection is congested
+     */
+    bool isCongested() const { return congested; }
+
 protected:
 
     /**
@@ -154,11 +192,31 @@ protected:
      */
     virtual void messagesReady() = 0;
 
+    /**
+     * A request has been written to the socket.  Called from the
+     * thread writing the message.
+     *
+     * @param xid the request ID of the request
+     * @param method the method of the request
+     */
+    virtual void requestSent(uint64_t xid, const std::string& method) {}
+
+    /**
+     * The bytes queued for the peer crossed one of its watermarks.
+     * Must be called from the libuv loop thread.  Once the peer is
+     * no longer congested the write queue is processed again.
+     *
+     * @param congested true if the high watermark was crossed
+     */
+    virtual void congestionChanged(bool congested);
+
 private:
     uint64_t requestId;
     uint64_t connGeneration;
-    typedef std::pair<JsonRpcMessage*, uint64_t> write_queue_item_t;
-    typedef std::list<write_queue_item_t> write_queue_t;
+    std::atomic<bool> congested;
+    typedef std::pair<std::shared_ptr<JsonRpcMessage>, uint64_t>
+        write_queue_item_t;
+    typedef std::deque<write_queue_item_t> write_queue_t;
     write_queue_t write_queue;
     std::mutex queue_mutex;
 
@@ -18,6 +18,7 @@
 #include <unordered_map>
 
 #include "opflex/gbp/Policy.h"
+#include "opflex/gbp/PolicyObject.h"
 #include <opflex/ofcore/OFServerStats.h>
 
 #pragma once
@@ -78,6 +79,60 @@ public:
      */
     ~GbpOpflexServer();
 
+    /**
+     * Serialize policy and endpoint resolve responses on a pool of
+     * worker threads that read from a snapshot of the store, rather
+     * than on the listener thread.  Call before start()
+     *
+     * @param workers the number of worker threads, or 0 to serialize
+     * responses on the listener thread
+     */
+    void setWorkers(size_t workers);
+
+    /**
+     * Serve agent connections on a pool of event loops, each with
+     * its own thread, rather than on the listener thread alone.
+     * Call before start()
+     *
+     * @param loops the number of event loops
+     */
+    void setLoops(size_t loops);
+
+    /**
+     * Set the number of threads that parse a policy file read with
+     * readPolicy()
+     *
+     * @param threads the number of threads, or 0, the default, for
+     * one per core
+     */
+    void setPolicyThreads(size_t threads);
+
+    /**
+     * Set the maximum number of serialized policy subtrees cached to
+     * answer policy resolves from many peers for the same policy.
+     * Call before start()
+     *
+     * @param size the maximum number of cached subtrees, or 0 to
+     * disable the cache
+     */
+    void setResolveCacheSize(size_t size);
+
+    /**
+     * Limit the rate of requests from each agent, so that an agent
+     * that storms the server cannot starve the others.  A request
+     * over the limit is refused with an EBUSY error and retried by
+     * the agent later.  Each item in a request counts as one request.
+     * Call before start()
+     *
+     * @param resolves the rate of policy and endpoint resolves per
+     * second, or 0 for no limit
+     * @param declares the rate of endpoint declarations and
+     * undeclarations per second, or 0 for no limit
+     * @param reports the rate of state reports per second, or 0 for
+     * no limit
+     */
+    void setRequestLimits(double resolves, double declares, double reports);
+
     /**
      * Start the server
      */
@@ -89,8 +144,9 @@ public:
     void stop();
 
     /**
-     * Read policy into the server from the specified file.  Note that
-     * this will not automatically cause updates to be sent to
+     * Read policy into the server from the specified file, either a
+     * JSON array of managed objects or a binary store image.  Note
+     * that this will not automatically cause updates to be sent to
      * connected clients.
      *
      * @param file the filename to read in
@@ -105,6 +161,23 @@ public:
      */
     void updatePolicy(rapidjson::Document& d, gbp::PolicyUpdateOp op);
 
+    /**
+     * A policy update opcode and a reader for the objects to apply
+     * it to
+     */
+    typedef std::pair<gbp::PolicyUpdateOp,
+                      std::shared_ptr<gbp::PolicyObjectReader> >
+        policy_update_t;
+
+    /**
+     * Apply a batch of policy updates in order, and send the
+     * resulting updates to the connected clients once for the whole
+     * batch
+     *
+     * @param updates the updates to apply
+     */
+    void updatePolicy(const std::vector<policy_update_t>& updates);
+
     /**
      * Enable SSL for connections to opflex peers.  Call before start()
      *
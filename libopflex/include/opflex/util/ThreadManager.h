@@ -69,6 +69,7 @@ private:
             cleanup = {};
         }
 
+        std::string name;
         uv_loop_t* loop;
         uv_thread_t thread;
         uv_async_t cleanup;
@@ -0,0 +1,94 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*!
+ * @file ThreadSettings.h
+ * @brief Interface definition file for thread naming and scheduling
+ */
+/*
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEX_UTIL_THREADSETTINGS_H
+#define OPFLEX_UTIL_THREADSETTINGS_H
+
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+namespace opflex {
+namespace util {
+
+/**
+ * CPU affinity and scheduling settings for a group of threads
+ */
+struct ThreadSettings {
+    /**
+     * The CPUs the threads may run on, or empty for any CPU
+     */
+    std::vector<int> cpus;
+
+    /**
+     * The scheduling policy: "other", "batch", "idle", "fifo" or "rr"
+     */
+    boost::optional<std::string> policy;
+
+    /**
+     * The static priority for the "fifo" and "rr" policies
+     */
+    int priority = 0;
+
+    /**
+     * The nice value for the "other" and "batch" policies
+     */
+    boost::optional<int> nice;
+};
+
+/**
+ * Set the settings for the threads whose names start with a prefix.
+ * Threads are matched against the longest prefix that has settings,
+ * so the empty prefix applies to every thread without a more
+ * specific match.  Only threads started after the call are affected.
+ *
+ * @param prefix the start of the thread names
+ * @param settings the settings to apply
+ */
+void setThreadSettings(const std::string& prefix,
+                       const ThreadSettings& settings);
+
+/**
+ * Forget the settings of all threads
+ */
+void clearThreadSettings();
+
+/**
+ * Name the calling thread and apply the settings that match the
+ * name.  Thread names are cut to the 15 characters the kernel keeps.
+ *
+ * @param name the name of the thread
+ * @return false if a setting could not be applied
+ */
+bool initThread(const std::string& name);
+
+/**
+ * Start a thread that calls initThread and then runs a function.
+ * All long-lived threads should be created with this so that they are
+ * named and scheduled consistently.
+ *
+ * @param name the name of the thread
+ * @param func the function to run
+ * @return the new thread
+ */
+std::thread startThread(const std::string& name,
+                        const std::function<void()>& func);
+
+} /* namespace util */
+} /* namespace opflex */
+
+#endif /* OPFLEX_UTIL_THREADSETTINGS_H */
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef _____COMMS__INCLUDE__OPFLEX__INTERNAL__BLOCK_CACHE_HPP
+#define _____COMMS__INCLUDE__OPFLEX__INTERNAL__BLOCK_CACHE_HPP
+
+#include <cstddef>
+#include <memory>
+#include <new>
+
+namespace yajr {
+namespace internal {
+
+/**
+ * A per-thread cache of small memory blocks, for the objects that a
+ * loop thread allocates and frees over and over for every message:
+ * the nodes of the outbound string queues and the inbound message
+ * objects.  Freed blocks are kept on a free list per size class, up
+ * to a bounded number of bytes per class, and handed out again by
+ * the next allocation of that class on the same thread.
+ *
+ * Every block comes from the global operator new, so blocks are
+ * interchangeable between threads: a block goes on the free list of
+ * the thread that frees it, whichever thread allocated it.  Once
+ * that list is full, or after the thread's cache is destroyed, the
+ * block goes back to the global heap.
+ */
+class BlockCache {
+  public:
+    /**
+     * Allocate a block
+     * @param size the size of the block
+     * @return the block
+     */
+    static void * allocate(std::size_t size) {
+        void * p = pop(size);
+        return p ? p : ::operator new(roundUp(size));
+    }
+
+    /**
+     * Allocate a block without throwing
+     * @param size the size of the block
+     * @return the block, or NULL if the allocation failed
+     */
+    static void * allocate(std::size_t size, std::nothrow_t const &) noexcept {
+        void * p = pop(size);
+        return p ? p : ::operator new(roundUp(size), std::nothrow);
+    }
+
+    /**
+     * Free a block returned by allocate()
+     * @param p the block
+     * @param size the size it was allocated with
+     */
+    static void deallocate(void * p, std::size_t size) noexcept {
+        if (!p) {
+            return;
+        }
+        if (size <= kMaxBlockSize) {
+            Lists & lists = local();
+            FreeList & list = lists.lists_[sizeClass(size)];
+            if (lists.live_ &&
+                list.count_ < kMaxCachedBytes / classSize(sizeClass(size))) {
+                Block * b = static_cast<Block *>(p);
+                b->next_ = list.head_;
+                list.head_ = b;
+                ++list.count_;
+                return;
+            }
+        }
+        ::operator delete(p);
+    }
+
+  private:
+    static const std::size_t kGranularity = 64;
+    static const std::size_t kMaxBlockSize = 1024;
+    static const std::size_t kMaxCachedBytes = 256 * 1024;
+    static const std::size_t kClasses = kMaxBlockSize / kGranularity;
+
+    struct Block {
+        Block * next_;
+    };
+
+    struct FreeList {
+        Block * head_;
+        std::size_t count_;
+    };
+
+    struct Lists {
+        Lists() : lists_(), live_(true) {}
+        ~Lists() {
+            for (std::size_t c = 0; c < kClasses; ++c) {
+                while (Block * b = lists_[c].head_) {
+                    lists_[c].head_ = b->next_;
+                    ::operator delete(b);
+                }
+            }
+            /* later frees on this thread bypass the cache */
+            live_ = false;
+        }
+        FreeList lists_[kClasses];
+        bool live_;
+    };
+
+    static Lists & local() {
+        static thread_local Lists lists;
+        return lists;
+    }
+
+    static std::size_t sizeClass(std::size_t size) {
+        return size ? (size - 1) / kGranularity : 0;
+    }
+
+    static std::size_t classSize(std::size_t c) {
+        return (c + 1) * kGranularity;
+    }
+
+    /* every block of a class can hold any size of that class */
+    static std::size_t roundUp(std::size_t size) {
+        return size <= kMaxBlockSize ? classSize(sizeClass(size)) : size;
+    }
+
+    static void * pop(std::size_t size) noexcept {
+        if (size > kMaxBlockSize) {
+            return NULL;
+        }
+        FreeList & list = local().lists_[sizeClass(size)];
+        Block * b = list.head_;
+        if (b) {
+            list.head_ = b->next_;
+            --list.count_;
+        }
+        return b;
+    }
+};
+
+/**
+ * A standard allocator that draws its memory from the BlockCache
+ * @tparam T the type of the objects allocated
+ */
+template <typename T>
+struct CachingAllocator : public std::allocator<T> {
+
+    /** The allocator for another type */
+    template <typename U>
+    struct rebind {
+        /** The rebound allocator */
+        typedef CachingAllocator<U> other;
+    };
+
+    CachingAllocator() noexcept {}
+
+    /** Convert from the allocator for another type */
+    template <typename U>
+    CachingAllocator(CachingAllocator<U> const &) noexcept {}
+
+    /**
+     * Allocate storage for some objects
+     * @param n the number of objects
+     * @return the storage
+     */
+    T * allocate(std::size_t n, void const * = 0) {
+        return static_cast<T *>(BlockCache::allocate(n * sizeof(T)));
+    }
+
+    /**
+     * Free storage returned by allocate()
+     * @param p the storage
+     * @param n the number of objects it was allocated for
+     */
+    void deallocate(T * p, std::size_t n) noexcept {
+        BlockCache::deallocate(p, n * sizeof(T));
+    }
+};
+
+} /* yajr::internal namespace */
+} /* yajr namespace */
+
+#endif /* _____COMMS__INCLUDE__OPFLEX__INTERNAL__BLOCK_CACHE_HPP */
@@ -15,6 +15,7 @@
 #include <opflex/yajr/yajr.hpp>
 #include <opflex/yajr/rpc/rpc.hpp>
 #include <opflex/yajr/transport/PlainText.hpp>
+#include <opflex/yajr/transport/SeqPacket.hpp>
 #include <opflex/yajr/async_doc_parser.hpp>
 
 #include <opflex/logging/OFLogHandler.h>
@@ -25,10 +26,14 @@
 #include <boost/atomic.hpp>
 #include <boost/intrusive/list.hpp>
 
-#include <sstream>  /* for basic_stringstream<> */
+#include <algorithm>
 #include <iostream>
 #include <atomic>
+#include <memory>
 #include <mutex>
+#include <vector>
+
+struct z_stream_s;
 
 #define uv_close(h, cb)                        \
     do {                                       \
@@ -95,6 +100,14 @@ typedef ::boost::intrusive::list_base_hook<
     ::boost::intrusive::link_mode< ::boost::intrusive::auto_unlink> >
     SafeListBaseHook;
 
+/** Tag of the hook that links a peer into a keep-alive wheel slot */
+struct KeepAliveTag;
+
+typedef ::boost::intrusive::list_base_hook<
+    ::boost::intrusive::tag<KeepAliveTag>,
+    ::boost::intrusive::link_mode< ::boost::intrusive::auto_unlink> >
+    KeepAliveHook;
+
 /**
  * Peer
  */
@@ -119,6 +132,7 @@ class Peer : public SafeListBaseHook {
           VaS(XX, LISTENING)             \
           VaS(XX, TO_RESOLVE)            \
           VaS(XX, TO_LISTEN)             \
+          VaS(XX, TO_ADOPT)              \
           VaS(XX, RETRY_TO_CONNECT)      \
           VaS(XX, RETRY_TO_LISTEN)       \
           VaS(XX, ATTEMPTING_TO_CONNECT) \
@@ -169,6 +183,11 @@ class Peer : public SafeListBaseHook {
             uv_timer_init(loop, &prepareAgain_);
             prepareAgain_.data = this;
             uv_async_init(loop, &kickLibuv_, NULL);
+            uv_timer_init(loop, &wheelTimer_);
+            uv_unref((uv_handle_t*) &wheelTimer_);
+            wheelTimer_.data = this;
+            wheelTick_ = uv_now(loop) / kWheelTick;
+            wheelPeers_ = 0;
         }
 
         /**
@@ -221,6 +240,33 @@ class Peer : public SafeListBaseHook {
         /** Mark the peer down */
         void down();
 
+        /**
+         * Write out the coalesced messages of a peer before the loop
+         * next polls for I/O.  Holds a reference to the peer until
+         * then.
+         *
+         * @param peer the peer to flush
+         */
+        void scheduleFlush(CommunicationPeer * peer);
+
+        /**
+         * Arm the keep-alive timer of a peer.  All the keep-alive
+         * timers of the loop share one hashed timer wheel, driven by a
+         * single libuv timer that only runs while any is armed.  Timers
+         * fire at most one wheel tick late, and never early.
+         *
+         * @param peer the peer, whose timer must not be armed
+         * @param deadline the loop time in ms at which to fire
+         */
+        void scheduleKeepAlive(CommunicationPeer * peer, uint64_t deadline);
+
+        /**
+         * Disarm the keep-alive timer of a peer, if it is armed
+         *
+         * @param peer the peer
+         */
+        void cancelKeepAlive(CommunicationPeer * peer);
+
         /** Workaround libuv issues by manually */
         void kickLibuv() {
             /* workaround for libuv syncronous uv_pipe_connect() failures bug */
@@ -254,6 +300,7 @@ class Peer : public SafeListBaseHook {
 
         Peer::List peers[LoopData::TOTAL_STATES];
         void onPrepareLoop();
+        void flushPeers();
         static void onPrepareLoop(uv_prepare_t *);
         static void fini(uv_handle_t *);
         static std::recursive_mutex peerMutex;
@@ -263,6 +310,25 @@ class Peer : public SafeListBaseHook {
         uint64_t lastRun_;
         std::atomic<bool> destroying_;
         std::atomic<uint64_t> refCount_;
+        std::vector<CommunicationPeer *> toFlush_;
+        std::vector<CommunicationPeer *> flushing_;
+
+        typedef ::boost::intrusive::list<CommunicationPeer,
+                ::boost::intrusive::base_hook<KeepAliveHook>,
+                ::boost::intrusive::constant_time_size<false> >
+            KeepAliveList;
+
+        /** Resolution of the keep-alive wheel in ms */
+        static const uint64_t kWheelTick = 100;
+        /** Slots of the keep-alive wheel, a power of two */
+        static const size_t kWheelSlots = 512;
+
+        void onWheelTick();
+        static void onWheelTick(uv_timer_t *);
+        KeepAliveList wheel_[kWheelSlots];
+        uv_timer_t wheelTimer_;
+        uint64_t wheelTick_;
+        size_t wheelPeers_;
 
         friend class Peer;
     };
@@ -410,17 +476,14 @@ class Peer : public SafeListBaseHook {
     }
 
     union {
-        union {
-            struct {
-                struct addrinfo * ai;
-                struct addrinfo const * ai_next;
-            };
-            struct {
-                uv_loop_t * uvLoop_;
-            } listener_;
-        } _;
-        uv_timer_t keepAliveTimer_;
-    };
+        struct {
+            struct addrinfo * ai;
+            struct addrinfo const * ai_next;
+        };
+        struct {
+            uv_loop_t * uvLoop_;
+        } listener_;
+    } _;
     /** Function pointer type for the uv_loop selector method to be used to
      *  select which particular uv_loop to assign a peer to.
      */
@@ -474,7 +537,8 @@ static_assert (sizeof(Peer) <= 4096, "Peer won't fit on one page");
 /**
  * Abstract communication peer
  */
-class CommunicationPeer : public Peer, virtual public ::yajr::Peer {
+class CommunicationPeer : public Peer, public KeepAliveHook,
+                          virtual public ::yajr::Peer {
 
     friend
     std::ostream& operator<< (
@@ -503,11 +567,29 @@ class CommunicationPeer : public Peer, virtual public ::yajr::Peer {
                 internal::Peer(passive, uvLoopSelector, status),
                 connectionHandler_(connectionHandler),
                 data_(data),
+                docInChunk_(new char[kDocInChunkSize]),
+                docInAllocator_(docInChunk_.get(), kDocInChunkSize),
+                docIn_(&docInAllocator_),
                 writer_(s_),
                 pendingBytes_(0),
                 nextId_(0),
                 keepAliveInterval_(0),
+                keepAliveRepeat_(0),
+                keepAliveDeadline_(0),
                 lastHeard_(0),
+                rttCb_(NULL),
+                coalesceLimit_(0),
+                flushScheduled_(false),
+                highWatermark_(0),
+                lowWatermark_(0),
+                watermarkCb_(NULL),
+                congested_(false),
+                parseOffload_(0),
+                parseHead_(NULL),
+                parseTail_(NULL),
+                binaryOut_(false),
+                binaryIn_(false),
+                frameStart_(0),
                 transport_(transport::PlainText::getPlainTextTransport()),
                 asyncDocParser_([this](Document& d) -> int { return asyncDocParserCb(d); })
             {
@@ -536,10 +618,20 @@ class CommunicationPeer : public Peer, virtual public ::yajr::Peer {
     void onWrite();
 
     /**
-     * Add frame delimiter
+     * Add frame delimiter.  Binary frames are prefixed with their
+     * length instead, which is filled in here.
      */
     void delimitFrame() const {
-        s_.Put('\0');
+        if (binaryOut_) {
+            ::yajr::internal::StringQueue::Deque & q = outQueue().deque_;
+            size_t length = q.size() - frameStart_ - kFrameHeaderSize;
+            for (size_t i = 0; i < kFrameHeaderSize; ++i) {
+                q[frameStart_ + i] =
+                    char(length >> (8 * (kFrameHeaderSize - 1 - i)));
+            }
+            return;
+        }
+        outQueue().Put('\0');
     }
 
     /**
@@ -548,6 +640,11 @@ class CommunicationPeer : public Peer, virtual public ::yajr::Peer {
      */
     int write();
 
+    /**
+     * Write out the messages held back by write coalescing
+     */
+    void flush();
+
     /**
      * Write iovec to peer
      * @return rc
@@ -586,14 +683,103 @@ class CommunicationPeer : public Peer, virtual public ::yajr::Peer {
     virtual void stopKeepAlive();
 
     /**
-     * CB for timer expiry
-     * @param timer libuv timer
+     * Called by the keep-alive wheel of the loop when the keep-alive
+     * timer of the peer expires
+     */
+    void onKeepAliveTimer();
+
+    /**
+     * Get the loop time at which the keep-alive timer expires
+     * @return the time in ms
      */
-    static void on_timeout(uv_timer_t * timer);
+    uint64_t getKeepAliveDeadline() const {
+        return keepAliveDeadline_;
+    }
+
+    /**
+     * Set the keep-alive round-trip callback
+     * @param rttCb callback
+     */
+    virtual void setRttCallback(::yajr::Peer::RttCb rttCb) {
+        rttCb_ = rttCb;
+    }
+
+    /**
+     * Set the write coalescing limit
+     * @param limit queued bytes that trigger a write, or 0 to disable
+     */
+    virtual void setWriteCoalescing(size_t limit) {
+        coalesceLimit_ = limit;
+    }
+
+    /**
+     * Set the send watermarks
+     * @param high queued bytes above which the peer is congested, or 0
+     * to disable
+     * @param low queued bytes below which it is no longer congested
+     * @param watermarkCb callback
+     */
+    virtual void setWatermarks(size_t high, size_t low,
+                               ::yajr::Peer::WatermarkCb watermarkCb) {
+        highWatermark_ = high;
+        lowWatermark_ = std::min(low, high);
+        watermarkCb_ = watermarkCb;
+    }
+
+    /**
+     * Set the size from which inbound frames are parsed on the libuv
+     * thread pool
+     * @param threshold frame size in bytes, or 0 to disable
+     */
+    virtual void setParseOffload(size_t threshold) {
+        parseOffload_ = threshold;
+    }
+
+    /**
+     * Check whether the peer is above its high watermark
+     * @return true if the peer is congested
+     */
+    bool isCongested() const {
+        return congested_;
+    }
+
+    /**
+     * Compress everything sent to the peer from now on
+     * @return true if the outbound stream is compressed
+     */
+    virtual bool enableCompression();
+
+    /**
+     * Check whether the outbound stream is compressed
+     * @return true if the outbound stream is compressed
+     */
+    bool isCompressing() const {
+        return deflate_.get() != NULL;
+    }
+
+    /**
+     * Encode everything sent to the peer as CBOR from now on
+     * @return true if the outbound stream is binary
+     */
+    virtual bool enableBinaryEncoding();
+
+    /**
+     * Check whether the outbound stream is binary
+     * @return true if the outbound stream is binary
+     */
+    virtual bool isBinaryEncoding() const {
+        return binaryOut_;
+    }
 
     /** send echo req to peer */
     void sendEchoReq();
 
+    /**
+     * Called when an echo response is received
+     * @param sent timestamp in ms carried by the echo
+     */
+    void onEchoRes(uint64_t sent) const;
+
     /**
      * Called on timeout
      */
@@ -748,7 +934,13 @@ class CommunicationPeer : public Peer, virtual public ::yajr::Peer {
      * @return writer
      */
     ::yajr::rpc::SendHandler & getWriter() const {
-        writer_.Reset(s_);
+        writer_.Reset(outQueue());
+        if (binaryOut_) {
+            /* room for the length, see delimitFrame() */
+            frameStart_ = outQueue().deque_.size();
+            outQueue().deque_.insert(outQueue().deque_.end(),
+                                     kFrameHeaderSize, '\0');
+        }
         return writer_;
     }
 
@@ -791,6 +983,20 @@ class CommunicationPeer : public Peer, virtual public ::yajr::Peer {
             size_t nread,
             bool canWriteJustPastTheEnd = false);
 
+    /**
+     * Read a record of a transport that keeps message boundaries.  A
+     * record made of whole JSON messages is parsed in place, one
+     * message after the other, anything else is read as part of the
+     * stream.
+     * @param record the record
+     * @param nread the size of the record
+     * @param canWriteJustPastTheEnd can write past the end
+     */
+    void readRecord(
+            char * record,
+            size_t nread,
+            bool canWriteJustPastTheEnd = false);
+
   protected:
     /* don't leak memory! */
     virtual ~CommunicationPeer() {}
@@ -802,6 +1008,20 @@ class CommunicationPeer : public Peer, virtual public ::yajr::Peer {
     ::yajr::Peer::StateChangeCb connectionHandler_;
     void * data_;
 
+    /**
+     * Size of the first chunk of the parse allocator, which is kept
+     * across messages
+     */
+    static const size_t kDocInChunkSize = 16 * 1024;
+
+    /**
+     * Capacity above which the receive buffer is released once the
+     * frame it holds has been processed
+     */
+    static const size_t kMaxRetainedInBuf = 1024 * 1024;
+
+    std::unique_ptr<char[]> docInChunk_;
+    mutable rapidjson::MemoryPoolAllocator<> docInAllocator_;
     mutable rapidjson::Document docIn_;
 
     mutable ::yajr::rpc::SendHandler writer_;
@@ -809,34 +1029,119 @@ class CommunicationPeer : public Peer, virtual public ::yajr::Peer {
     mutable uint64_t nextId_;
 
     std::atomic<uint64_t> keepAliveInterval_;
+    uint64_t keepAliveRepeat_;
+    uint64_t keepAliveDeadline_;
     mutable uint64_t lastHeard_;
+    ::yajr::Peer::RttCb rttCb_;
 
-    ::yajr::transport::Transport transport_;
+    size_t coalesceLimit_;
+    bool flushScheduled_;
+
+    size_t highWatermark_;
+    size_t lowWatermark_;
+    ::yajr::Peer::WatermarkCb watermarkCb_;
+    bool congested_;
+
+    void checkWatermarks();
+
+    /**
+     * A frame being parsed on the libuv thread pool.  The frames of a
+     * peer are queued in the order they were received, and their
+     * messages are handled from the head of the queue as soon as they
+     * are parsed.
+     */
+    struct ParseJob;
+
+    size_t parseOffload_;
+    ParseJob * parseHead_;
+    ParseJob * parseTail_;
+
+    bool offloadFrame(char const * frame, size_t size, bool binary);
+    void deliverParsed();
+
+    /**
+     * Byte that a peer sends at a frame boundary to announce that the
+     * rest of its stream is deflated.  It can never start a JSON frame.
+     */
+    static const char kCompressedStream = '\x01';
+
+    /** Frees a deflate stream */
+    struct DeflateEnd {
+        void operator()(z_stream_s * z) const;
+    };
 
-    mutable std::stringstream ssIn_;
+    /** Frees an inflate stream */
+    struct InflateEnd {
+        void operator()(z_stream_s * z) const;
+    };
 
-    void resetSsIn() const {
-        const static std::stringstream initialFmt;
-        const static std::string emptyStr;
+    /**
+     * When compressing, the messages are written here and deflated
+     * into s_ right before the transport sends them
+     */
+    mutable ::yajr::internal::StringQueue raw_;
+    std::unique_ptr<z_stream_s, DeflateEnd> deflate_;
+    std::unique_ptr<z_stream_s, InflateEnd> inflate_;
 
-        ssIn_.str(emptyStr);
-        ssIn_.clear();
-        ssIn_.copyfmt(initialFmt);
+    ::yajr::internal::StringQueue & outQueue() const {
+        return deflate_ ? raw_ : s_;
     }
 
-    yajr::rpc::InboundMessage * parseFrame();
+    void deflateOutbound();
+    bool startInflate();
+    void inflateInbound(char const * buffer, size_t n);
+    void resetCompression();
 
-    void readBufferZ(
-            char const * bufferZ,
-            size_t n);
+    /**
+     * Byte that a peer sends at a frame boundary to announce that the
+     * rest of its stream is made of binary frames.  A compressed peer
+     * sends it in the deflated stream, so compression has to be
+     * enabled first.
+     */
+    static const char kBinaryStream = '\x02';
+
+    /** Size of the big-endian length that starts a binary frame */
+    static const size_t kFrameHeaderSize = 4;
+
+    bool binaryOut_;
+    bool binaryIn_;
+    mutable size_t frameStart_;
+
+    void readBinary(char const * buffer, size_t n);
+    void resetBinaryEncoding();
+
+    static size_t binaryFrameSize(char const * header) {
+        size_t length = 0;
+        for (size_t i = 0; i < kFrameHeaderSize; ++i) {
+            length = (length << 8) | static_cast<unsigned char>(header[i]);
+        }
+        return kFrameHeaderSize + length;
+    }
+
+    ::yajr::transport::Transport transport_;
+
+    /**
+     * The part of a frame received so far when the frame spans more
+     * than one read.  Frames are parsed in-situ, either here or
+     * directly in the read buffer when they fit in a single read.
+     */
+    mutable std::vector<char> inBuf_;
 
-    size_t readChunk(char const * buffer) const {
-        ssize_t chunk_size = - ssIn_.tellp();
-        ssIn_ << buffer;
-        chunk_size += ssIn_.tellp();
-        return chunk_size;
+    void releaseInBuf() const {
+        inBuf_.clear();
+        if (inBuf_.capacity() > kMaxRetainedInBuf) {
+            std::vector<char>().swap(inBuf_);
+        }
     }
 
+    yajr::rpc::InboundMessage * parseFrame(char * frame, char ** next = NULL);
+    yajr::rpc::InboundMessage * parseBinaryFrame(char const * frame,
+                                                 size_t size);
+
+    void readBufferZ(
+            char * bufferZ,
+            size_t n);
+
     int asyncDocParserCb(rapidjson::Document &d);
 
     mutable AsyncDocumentParser<> asyncDocParser_;
@@ -981,10 +1286,14 @@ class ActiveUnixPeer : public ActivePeer {
                     connectionHandler,
                     data,
                     uvLoopSelector),
-            socketName_(socketName)
+            socketName_(transport::SeqPacket::socketPath(socketName)),
+            seqPacket_(transport::SeqPacket::isSeqPacketPath(socketName))
         {
             _.ai = NULL;
             createFail_ = 0;
+            if (seqPacket_) {
+                transport::SeqPacket::attachTransport(this);
+            }
         }
 
     /**
@@ -1003,6 +1312,7 @@ class ActiveUnixPeer : public ActivePeer {
 
   private:
     std::string const socketName_;
+    bool const seqPacket_;
 };
 static_assert (sizeof(ActiveUnixPeer) <= 4096, "ActiveUnixPeer won't fit on one page");
 
@@ -1027,21 +1337,65 @@ class PassivePeer : public CommunicationPeer {
                     connectionHandler,
                     data,
                     uvLoopSelector,
-                    kPS_RESOLVING)
+                    kPS_RESOLVING),
+            handOffFd_(-1)
         {
             createFail_ = 0;
         }
 
     /**
-     * Retry connection to peer
+     * Initialize the handle of the peer on its own libuv loop
+     * @return rc
      */
-    virtual void retry() {
-        assert(0);
+    virtual int initHandle() {
+        return tcpInit();
     }
 
+    /**
+     * Start reading from a newly accepted connection
+     */
+    void onAccept();
+
+    /**
+     * Accept a pending connection of a listener that runs on another
+     * libuv loop, and hand the socket over to the loop of this peer,
+     * which opens it from its own thread.  The handle of the peer must
+     * not have been initialized.
+     *
+     * @param server the listening stream
+     * @return rc
+     */
+    int handOff(uv_stream_t * server);
+
+    /**
+     * Open the socket handed over by handOff(), on the loop of the
+     * peer
+     */
+    virtual void retry();
+
+    /**
+     * Destroy the peer
+     *
+     * @param now Whether the peer should be destroyed immediately
+     */
+    virtual void destroy(bool now = false);
+
   protected:
+    /**
+     * Open a connected socket in the initialized handle
+     * @param fd the socket
+     * @return rc
+     */
+    virtual int openHandle(int fd) {
+        return uv_tcp_open(reinterpret_cast<uv_tcp_t *>(getHandle()), fd);
+    }
+
     /* don't leak memory! */
     virtual ~PassivePeer() {}
+
+  private:
+    /** the socket handed over, until the peer's loop opens it */
+    int handOffFd_;
 };
 static_assert (sizeof(PassivePeer) <= 4096, "PassivePeer won't fit on one page");
 
@@ -1228,7 +1582,8 @@ class ListeningUnixPeer : public ListeningPeer {
                   listenerUvLoop,
                   uvLoopSelector
           ),
-          socketName_(socketName)
+          socketName_(transport::SeqPacket::socketPath(socketName)),
+          seqPacket_(transport::SeqPacket::isSeqPacketPath(socketName))
         {
             createFail_ = 0;
         }
@@ -1241,6 +1596,7 @@ class ListeningUnixPeer : public ListeningPeer {
 
   private:
     std::string const socketName_;
+    bool const seqPacket_;
 };
 static_assert (sizeof(ListeningUnixPeer) <= 4096, "ListeningUnixPeer won't fit on one page");
 
@@ -26,7 +26,6 @@ namespace yajr {
 namespace rpc {
 
 typedef rapidjson::Value::StringRefType const MethodName;
-typedef rapidjson::Writer< yajr::internal::StringQueue > SendHandler;
 typedef boost::function<bool (yajr::rpc::SendHandler &)> PayloadGenerator;
 
 /**
@@ -248,6 +247,46 @@ class InboundMessage : public Message {
         return payload_;
     }
 
+    /**
+     * Allocate an inbound message.  Inbound messages are created and
+     * destroyed for every frame on the loop thread, so their storage
+     * is recycled through the thread's block cache.
+     *
+     * @param size the size of the message
+     */
+    static void * operator new(std::size_t size) {
+        return ::yajr::internal::BlockCache::allocate(size);
+    }
+
+    /**
+     * Allocate an inbound message without throwing
+     *
+     * @param size the size of the message
+     */
+    static void * operator new(std::size_t size,
+                               std::nothrow_t const & nt) noexcept {
+        return ::yajr::internal::BlockCache::allocate(size, nt);
+    }
+
+    /**
+     * Free an inbound message
+     *
+     * @param p the message storage
+     * @param size the size of the message
+     */
+    static void operator delete(void * p, std::size_t size) noexcept {
+        ::yajr::internal::BlockCache::deallocate(p, size);
+    }
+
+    /**
+     * Free an inbound message whose constructor failed
+     *
+     * @param p the message storage
+     */
+    static void operator delete(void * p, std::nothrow_t const &) noexcept {
+        ::operator delete(p);
+    }
+
   protected:
     /**
      * @brief Constructor needed by derived classes
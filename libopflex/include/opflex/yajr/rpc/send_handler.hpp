@@ -13,8 +13,19 @@
 #include <rapidjson/rapidjson.h>
 
 #include <rapidjson/encodings.h>
+#include <rapidjson/memorystream.h>
+#include <rapidjson/reader.h>
+#include <rapidjson/writer.h>
 
+#include <opflex/yajr/internal/block_cache.hpp>
+
+#include <cstdint>
+#include <cstring>
 #include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
 
 namespace yajr {
 namespace internal {
@@ -31,6 +42,13 @@ struct GenericStringQueue {
     /** Character */
     typedef typename Encoding::Ch Ch;
 
+    /**
+     * The queue itself.  Its nodes are recycled through the thread's
+     * block cache, since a busy peer's queue allocates and frees
+     * them for every write.
+     */
+    typedef std::deque<Ch, CachingAllocator<Ch> > Deque;
+
     /** add char to queue */
     void Put(Ch c) {
         deque_.push_back(c);
@@ -59,13 +77,326 @@ struct GenericStringQueue {
     }
 
     /** deque of chars */
-    std::deque<Ch> deque_;
+    Deque deque_;
 };
 
 //! String buffer with UTF8 encoding
 typedef GenericStringQueue<rapidjson::UTF8<> > StringQueue;
 
 } /* yajr::internal namespace */
+
+namespace rpc {
+
+class PreparedValue;
+
+/**
+ * The handler that messages are serialized to.  It writes JSON by
+ * default, or CBOR (RFC 8949) once a peer has switched its outbound
+ * stream to the binary encoding.  Either way the same SAX calls are
+ * made, so the code that serializes messages does not need to know.
+ *
+ * Maps and arrays are encoded with indefinite length, since the
+ * number of members is not known when they are started.
+ */
+class SendHandler {
+  public:
+    /** The JSON writer */
+    typedef rapidjson::Writer< internal::StringQueue > Base;
+
+    /** Character */
+    typedef Base::Ch Ch;
+
+    /**
+     * Construct a new send handler that writes JSON
+     * @param os the queue to write to
+     */
+    explicit SendHandler(internal::StringQueue& os)
+        : json_(os), out_(&os), binary_(false) {}
+
+    /**
+     * Reset the handler to write a new message to the given queue
+     * @param os the queue to write to
+     */
+    void Reset(internal::StringQueue& os) {
+        json_.Reset(os);
+        out_ = &os;
+    }
+
+    /**
+     * Choose between CBOR and JSON
+     * @param binary true to write CBOR
+     */
+    void SetBinary(bool binary) {
+        binary_ = binary;
+    }
+
+    /**
+     * Check whether the handler writes CBOR
+     * @return true if the handler writes CBOR
+     */
+    bool IsBinary() const {
+        return binary_;
+    }
+
+    /** write a null */
+    bool Null() {
+        if (!binary_) return json_.Null();
+        put(0xf6);
+        return true;
+    }
+
+    /** write a boolean */
+    bool Bool(bool b) {
+        if (!binary_) return json_.Bool(b);
+        put(b ? 0xf5 : 0xf4);
+        return true;
+    }
+
+    /** write an int */
+    bool Int(int i) {
+        if (!binary_) return json_.Int(i);
+        putInt(i);
+        return true;
+    }
+
+    /** write an unsigned */
+    bool Uint(unsigned u) {
+        if (!binary_) return json_.Uint(u);
+        putHead(0, u);
+        return true;
+    }
+
+    /** write a 64-bit int */
+    bool Int64(int64_t i64) {
+        if (!binary_) return json_.Int64(i64);
+        putInt(i64);
+        return true;
+    }
+
+    /** write a 64-bit unsigned */
+    bool Uint64(uint64_t u64) {
+        if (!binary_) return json_.Uint64(u64);
+        putHead(0, u64);
+        return true;
+    }
+
+    /** write a double */
+    bool Double(double d) {
+        if (!binary_) return json_.Double(d);
+        uint64_t bits;
+        std::memcpy(&bits, &d, sizeof(bits));
+        put(0xfb);
+        putBigEndian(bits, 8);
+        return true;
+    }
+
+    /** write a number given as a string, which CBOR keeps as text */
+    bool RawNumber(const Ch* str, rapidjson::SizeType length,
+                   bool copy = false) {
+        if (!binary_) return json_.RawNumber(str, length, copy);
+        putText(str, length);
+        return true;
+    }
+
+    /** write a string */
+    bool String(const Ch* str, rapidjson::SizeType length,
+                bool copy = false) {
+        if (!binary_) return json_.String(str, length, copy);
+        putText(str, length);
+        return true;
+    }
+
+    /** write a NUL-terminated string */
+    bool String(const Ch* const& str) {
+        return String(str, rapidjson::SizeType(std::strlen(str)));
+    }
+
+    /** write a string */
+    bool String(const std::basic_string<Ch>& str) {
+        return String(str.data(), rapidjson::SizeType(str.size()));
+    }
+
+    /** start an object */
+    bool StartObject() {
+        if (!binary_) return json_.StartObject();
+        put(0xbf);
+        return true;
+    }
+
+    /** write the key of an object member */
+    bool Key(const Ch* str, rapidjson::SizeType length, bool copy = false) {
+        if (!binary_) return json_.Key(str, length, copy);
+        putText(str, length);
+        return true;
+    }
+
+    /** write the NUL-terminated key of an object member */
+    bool Key(const Ch* const& str) {
+        return Key(str, rapidjson::SizeType(std::strlen(str)));
+    }
+
+    /** write the key of an object member */
+    bool Key(const std::basic_string<Ch>& str) {
+        return Key(str.data(), rapidjson::SizeType(str.size()));
+    }
+
+    /** end an object */
+    bool EndObject(rapidjson::SizeType memberCount = 0) {
+        if (!binary_) return json_.EndObject(memberCount);
+        put(0xff);
+        return true;
+    }
+
+    /** start an array */
+    bool StartArray() {
+        if (!binary_) return json_.StartArray();
+        put(0x9f);
+        return true;
+    }
+
+    /** end an array */
+    bool EndArray(rapidjson::SizeType elementCount = 0) {
+        if (!binary_) return json_.EndArray(elementCount);
+        put(0xff);
+        return true;
+    }
+
+    /**
+     * Write a value that has already been serialized to JSON.  When
+     * writing CBOR the JSON is parsed and re-encoded, so a value
+     * written more than once should be a PreparedValue instead.
+     */
+    bool RawValue(const Ch* json, size_t length, rapidjson::Type type) {
+        if (!binary_) return json_.RawValue(json, length, type);
+        rapidjson::MemoryStream ms(json, length);
+        rapidjson::Reader reader;
+        return !reader.Parse(ms, *this).IsError();
+    }
+
+    /**
+     * Write a value that was serialized ahead of time, in whichever
+     * encoding the handler writes.
+     */
+    bool Prepared(const PreparedValue& value);
+
+  private:
+    Base json_;
+    internal::StringQueue * out_;
+    bool binary_;
+
+    /* CBOR isn't text, so skip the checks of StringQueue::Put() */
+    void put(unsigned char c) {
+        out_->deque_.push_back(c);
+    }
+
+    void putBigEndian(uint64_t value, unsigned bytes) {
+        while (bytes--) {
+            put(static_cast<unsigned char>(value >> (8 * bytes)));
+        }
+    }
+
+    /* the initial byte of every item holds the major type and either
+     * the argument itself or how many bytes of it follow */
+    void putHead(unsigned char major, uint64_t value) {
+        major <<= 5;
+        if (value < 24) {
+            put(major | value);
+        } else if (value <= 0xff) {
+            put(major | 24);
+            putBigEndian(value, 1);
+        } else if (value <= 0xffff) {
+            put(major | 25);
+            putBigEndian(value, 2);
+        } else if (value <= 0xffffffff) {
+            put(major | 26);
+            putBigEndian(value, 4);
+        } else {
+            put(major | 27);
+            putBigEndian(value, 8);
+        }
+    }
+
+    void putInt(int64_t i) {
+        if (i >= 0) {
+            putHead(0, i);
+        } else {
+            putHead(1, static_cast<uint64_t>(-(i + 1)));
+        }
+    }
+
+    void putText(const Ch* str, size_t length) {
+        putHead(3, length);
+        out_->deque_.insert(out_->deque_.end(), str, str + length);
+    }
+};
+
+/**
+ * A value serialized to JSON ahead of time so that it can be written
+ * many times, such as a policy subtree sent to every peer that
+ * resolves it.  Its CBOR encoding is made from the JSON the first
+ * time a binary handler writes it, and kept for the writes after.
+ */
+class PreparedValue {
+  public:
+    /**
+     * Construct a prepared value
+     * @param json the value serialized as JSON
+     * @param type the type of the value
+     */
+    PreparedValue(std::string json, rapidjson::Type type)
+        : json_(std::move(json)), type_(type) {}
+
+    /**
+     * Get the JSON encoding of the value
+     * @return the JSON text
+     */
+    const std::string& getJson() const {
+        return json_;
+    }
+
+    /**
+     * Get the type of the value
+     * @return the type
+     */
+    rapidjson::Type getType() const {
+        return type_;
+    }
+
+    /**
+     * Get the CBOR encoding of the value, encoding it on first use
+     * @return the CBOR bytes
+     */
+    const std::string& getBinary() const {
+        const std::lock_guard<std::mutex> guard(mutex_);
+        if (!binary_) {
+            internal::StringQueue queue;
+            SendHandler writer(queue);
+            writer.SetBinary(true);
+            writer.RawValue(json_.data(), json_.size(), type_);
+            binary_.reset(new std::string(queue.deque_.begin(),
+                                          queue.deque_.end()));
+        }
+        return *binary_;
+    }
+
+  private:
+    const std::string json_;
+    const rapidjson::Type type_;
+    mutable std::mutex mutex_;
+    mutable std::unique_ptr<const std::string> binary_;
+};
+
+inline bool SendHandler::Prepared(const PreparedValue& value) {
+    if (!binary_) {
+        const std::string& json = value.getJson();
+        return json_.RawValue(json.data(), json.size(), value.getType());
+    }
+    const std::string& cbor = value.getBinary();
+    out_->deque_.insert(out_->deque_.end(), cbor.begin(), cbor.end());
+    return true;
+}
+
+} /* yajr::rpc namespace */
 } /* yajr namespace */
 
 #endif /* _____COMMS__INCLUDE__OPFLEX__RPC__SEND_HANDLER_HPP */
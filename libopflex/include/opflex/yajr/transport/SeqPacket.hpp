@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef _____COMMS__INCLUDE__YAJR__TRANSPORT__SEQPACKET_HPP
+#define _____COMMS__INCLUDE__YAJR__TRANSPORT__SEQPACKET_HPP
+
+#include <opflex/yajr/transport/engine.hpp>
+
+#include <string>
+
+namespace yajr {
+namespace transport {
+
+/**
+ * Transport for same-host peers over a UNIX socket of type
+ * SOCK_SEQPACKET, which preserves the boundaries of the records it
+ * carries.  Every record holds whole messages whenever they fit, so
+ * that the receiver can parse them straight from the read buffer
+ * without reassembling the stream or scanning for delimiters.
+ *
+ * A UNIX socket path that starts with "seqpacket:" selects this
+ * transport, for both the listener and the peers that connect to it.
+ */
+class SeqPacket : public Transport::Engine {
+  public:
+    /**
+     * The prefix of the socket paths using this transport
+     */
+    static char const kPathPrefix[];
+
+    /**
+     * The largest record sent, well below the default socket send
+     * buffer, which bounds the size of a record
+     */
+    static const size_t kMaxRecordSize = 64 * 1024;
+
+    /**
+     * Check whether a socket path selects this transport
+     * @param path the socket path
+     * @return true if the path has the transport prefix
+     */
+    static bool isSeqPacketPath(std::string const & path);
+
+    /**
+     * Get the socket path to use
+     * @param path the socket path, with or without the prefix
+     * @return the path without the transport prefix
+     */
+    static std::string socketPath(std::string const & path);
+
+    /**
+     * Connect a pipe handle to a listening SOCK_SEQPACKET socket.
+     * UNIX sockets connect at once, so the connection has succeeded
+     * or failed on return.
+     * @param pipe an initialized pipe handle
+     * @param path the socket path
+     * @return 0 on success, a libuv error code otherwise
+     */
+    static int connect(uv_pipe_t * pipe, char const * path);
+
+    /**
+     * Bind a pipe handle to a new SOCK_SEQPACKET socket, ready for
+     * uv_listen()
+     * @param pipe an initialized pipe handle
+     * @param path the socket path
+     * @return 0 on success, a libuv error code otherwise
+     */
+    static int bind(uv_pipe_t * pipe, char const * path);
+
+    /**
+     * Replace the transport of a peer, before it starts reading
+     * @param peer the peer
+     */
+    static void attachTransport(comms::internal::CommunicationPeer * peer);
+
+  private:
+    SeqPacket();
+    SeqPacket(const SeqPacket &);
+    SeqPacket & operator=(const SeqPacket &);
+};
+
+template< >
+inline TransportEngine< SeqPacket >::~TransportEngine() {
+}
+
+} /* yajr::transport namespace */
+} /* yajr namespace */
+
+#endif /* _____COMMS__INCLUDE__YAJR__TRANSPORT__SEQPACKET_HPP */
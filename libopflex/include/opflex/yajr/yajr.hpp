@@ -85,6 +85,39 @@ class Peer {
                                          /**< [in] Callback data for the Peer */
     );
 
+    /**
+     * @brief Typedef for a keep-alive round-trip callback
+     *
+     * Callback type for a keep-alive round-trip callback. The callback is
+     * invoked from the Peer's uv_loop each time the response to one of the
+     * keep-alive "echo" requests is received.
+     */
+    typedef void (*RttCb)(
+            yajr::Peer            *,
+                                    /**< [in] the Peer the callback refers to */
+            void                  * data,
+                                         /**< [in] Callback data for the Peer */
+            uint64_t                rtt
+                             /**< [in] round-trip time of the echo, in msecs */
+    );
+
+    /**
+     * @brief Typedef for a send watermark callback
+     *
+     * Callback type for a send watermark callback. The callback is invoked
+     * from the Peer's uv_loop when the bytes queued for sending to the Peer
+     * rise above the high watermark, and again when they drain down to the
+     * low watermark.
+     */
+    typedef void (*WatermarkCb)(
+            yajr::Peer            *,
+                                    /**< [in] the Peer the callback refers to */
+            void                  * data,
+                                         /**< [in] Callback data for the Peer */
+            bool                    congested
+                       /**< [in] true if the high watermark has been crossed */
+    );
+
     /**
      * @brief Factory for an active yajr TCP communication Peer.
      *
@@ -130,6 +163,9 @@ class Peer {
     /**
      * @brief Factory for an active yajr Unix Domain Socket communication Peer.
      *
+     * A socketName prefixed with "seqpacket:" connects to a listener of
+     * type SOCK_SEQPACKET, which keeps the boundaries of the messages.
+     *
      * @return a pointer to the Peer created
      * @see create
      **/
@@ -235,6 +271,92 @@ class Peer {
      */
     virtual void stopKeepAlive() = 0;
 
+    /**
+     * @brief set the keep-alive round-trip callback
+     *
+     * Set a callback to be invoked with the round-trip time of every
+     * keep-alive exchange, or NULL to stop invoking it.
+     *
+     * @param rttCb the callback
+     */
+    virtual void setRttCallback(RttCb rttCb) = 0;
+
+    /**
+     * @brief coalesce outbound messages into fewer writes
+     *
+     * Hold back the messages sent during an iteration of the Peer's
+     * uv_loop and write them out together just before the loop polls
+     * for I/O again, or as soon as at least limit bytes are queued.
+     *
+     * @param limit the number of queued bytes that triggers a write
+     * right away, or 0 to write every message as soon as it is sent
+     */
+    virtual void setWriteCoalescing(size_t limit) = 0;
+
+    /**
+     * @brief report when the Peer falls behind on sending
+     *
+     * Invoke watermarkCb with congested set to true once more than high
+     * bytes are queued for sending, and with congested set to false once
+     * no more than low bytes are left. The Peer keeps queueing whatever it
+     * is asked to send; it is up to the caller to hold back while the
+     * Peer is congested.
+     *
+     * @param high the high watermark in bytes, or 0 to stop reporting
+     * @param low the low watermark in bytes
+     * @param watermarkCb the callback
+     */
+    virtual void setWatermarks(size_t high, size_t low,
+                               WatermarkCb watermarkCb) = 0;
+
+    /**
+     * @brief parse large inbound messages off the Peer's uv_loop
+     *
+     * Hand every inbound frame of at least threshold bytes to the libuv
+     * thread pool for parsing, so that a huge message doesn't hold up
+     * the keep-alives and the I/O of the other Peers on the loop. The
+     * parsed messages are still handled on the uv_loop, in the order
+     * they were received: while a frame is being parsed, the frames
+     * that follow it are handed to the pool as well.
+     *
+     * @param threshold the size in bytes from which frames are parsed
+     * on the thread pool, or 0 to parse every frame on the uv_loop
+     */
+    virtual void setParseOffload(size_t threshold) = 0;
+
+    /**
+     * @brief compress everything sent to the Peer from now on
+     *
+     * Start deflating the outbound stream. The Peer detects the switch
+     * in-band and inflates what follows, so this must only be called
+     * once the other side is known to support it, for example because
+     * it said so during its handshake.
+     *
+     * @return true if the outbound stream is now compressed
+     */
+    virtual bool enableCompression() = 0;
+
+    /**
+     * @brief encode everything sent to the Peer as CBOR from now on
+     *
+     * Switch the outbound stream from JSON to length-prefixed CBOR
+     * frames. The messages are serialized through the same SendHandler
+     * calls, and the Peer decodes them into the same documents, so
+     * nothing above the Peer changes. As with enableCompression(), the
+     * other side must be known to support it. Compression can't be
+     * enabled after this, so enable it first if both are wanted.
+     *
+     * @return true if the outbound stream is now binary
+     */
+    virtual bool enableBinaryEncoding() = 0;
+
+    /**
+     * @brief check whether everything sent to the Peer is CBOR
+     *
+     * @return true if the outbound stream is binary
+     */
+    virtual bool isBinaryEncoding() const = 0;
+
   protected:
     Peer() {}
     ~Peer() {}
@@ -321,6 +443,9 @@ struct Listener {
     /**
      * @brief Factory for passive yajr Unix Domain Socket communication Listener.
      *
+     * A socketName prefixed with "seqpacket:" binds a socket of type
+     * SOCK_SEQPACKET, which keeps the boundaries of the messages.
+     *
      * @return a pointer to the Peer created
      * @see create
      **/
@@ -22,6 +22,7 @@ namespace opflex {
 namespace logging {
 
 static boost::atomic<OFLogHandler*> activeHandler(NULL);
+std::atomic<int> OFLogHandler::minLevel(TRACE);
 
 OFLogHandler::OFLogHandler(Level logLevel) : logLevel_(logLevel) { };
 OFLogHandler::~OFLogHandler() { }
@@ -40,5 +41,9 @@ bool OFLogHandler::shouldEmit(const Level level) {
     return level >= logLevel_;
 }
 
+void OFLogHandler::setMinimumLevel(Level level) {
+    minLevel.store(level, std::memory_order_relaxed);
+}
+
 } /* namespace logging */
 } /* namespace opflex */
@@ -0,0 +1,40 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for StdErrLogHandler class.
+ *
+ * Copyright (c) 2014 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+
+#include <iostream>
+
+#include "opflex/logging/StdErrLogHandler.h"
+
+namespace opflex {
+namespace logging {
+
+StdErrLogHandler::StdErrLogHandler(Level logLevel_): OFLogHandler(logLevel_) { }
+StdErrLogHandler::~StdErrLogHandler() { }
+
+void StdErrLogHandler::handleMessage(const std::string& file,
+                                     const int line,
+                                     const std::string& function,
+                                     const Level level,
+                                     const std::string& message) {
+    if (level < logLevel_) return;
+
+    std::cerr << file << ":" << line << ":" << function <<
+        "[" << level <<"] " << message << std::endl;
+}
+
+} /* namespace logging */
+} /* namespace opflex */
@@ -10,6 +10,9 @@
 #ifndef _INCLUDE__OPFLEX__LOGGING_HPP
 #define _INCLUDE__OPFLEX__LOGGING_HPP
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <sstream>
 #include <iostream>
 
@@ -57,6 +60,109 @@ private:
     std::ostringstream buffer_;
 };
 
+/**
+ * Whether a message at a rate limited or sampled call site may be
+ * logged, and how many messages were left out since the last one
+ * that was
+ */
+struct Allowance {
+    /** true if the message may be logged */
+    bool allowed;
+    /** the number of messages left out before this one */
+    uint64_t suppressed;
+
+    /** check whether the message may be logged */
+    explicit operator bool() const { return allowed; }
+};
+
+/**
+ * Write a note about the messages left out, if there are any
+ */
+inline std::ostream& operator<<(std::ostream& os, const Allowance& a) {
+    if (a.suppressed)
+        os << "[" << a.suppressed << " similar messages suppressed] ";
+    return os;
+}
+
+/**
+ * The number of messages LOG_RATE_LIMITED_DEFAULT lets through per
+ * interval
+ */
+const uint32_t DEFAULT_LOG_RATE_LIMIT = 10;
+
+/**
+ * The interval in milliseconds of LOG_RATE_LIMITED_DEFAULT
+ */
+const uint32_t DEFAULT_LOG_RATE_INTERVAL_MS = 10000;
+
+/**
+ * Let through a number of messages per interval at a call site and
+ * count the others.  Use through LOG_RATE_LIMITED.
+ */
+class RateLimiter {
+public:
+    /**
+     * Create a limiter
+     *
+     * @param limit_ the number of messages to log per interval
+     * @param intervalMs the length of the interval in milliseconds
+     */
+    RateLimiter(uint32_t limit_, uint32_t intervalMs)
+        : limit(limit_), interval(int64_t(intervalMs) * 1000000),
+          windowStart(INT64_MIN / 2), count(0), suppressed(0) {}
+
+    /**
+     * Count a message and check whether it may be logged
+     */
+    Allowance allow() {
+        int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>
+            (std::chrono::steady_clock::now().time_since_epoch()).count();
+        int64_t start = windowStart.load(std::memory_order_relaxed);
+        if (now - start >= interval &&
+            windowStart.compare_exchange_strong(start, now))
+            count.store(0, std::memory_order_relaxed);
+        if (count.fetch_add(1, std::memory_order_relaxed) < limit)
+            return {true, suppressed.exchange(0)};
+        suppressed.fetch_add(1, std::memory_order_relaxed);
+        return {false, 0};
+    }
+
+private:
+    const uint32_t limit;
+    const int64_t interval;
+    std::atomic<int64_t> windowStart;
+    std::atomic<uint32_t> count;
+    std::atomic<uint64_t> suppressed;
+};
+
+/**
+ * Let through one in a number of messages at a call site.  Use
+ * through LOG_SAMPLED.
+ */
+class Sampler {
+public:
+    /**
+     * Create a sampler
+     *
+     * @param rate_ log one in this many messages
+     */
+    explicit Sampler(uint32_t rate_) : rate(rate_ ? rate_ : 1), count(0) {}
+
+    /**
+     * Count a message and check whether it may be logged
+     */
+    Allowance allow() {
+        uint64_t n = count.fetch_add(1, std::memory_order_relaxed);
+        if (n % rate != 0)
+            return {false, 0};
+        return {true, n ? rate - 1 : 0};
+    }
+
+private:
+    const uint32_t rate;
+    std::atomic<uint64_t> count;
+};
+
 } /* namespace internal */
 } /* namespace logging */
 } /* namespace opflex */
@@ -96,7 +202,8 @@ private:
  * log messages
  */
 #define LOG_SHOULD_EMIT(level)                                          \
-    (opflex::logging::OFLogHandler::getHandler()->shouldEmit(level))
+    (opflex::logging::OFLogHandler::isLevelEnabled(level) &&            \
+     opflex::logging::OFLogHandler::getHandler()->shouldEmit(level))
 
 /**
  * Create a log stream that you can log to as in:
@@ -113,4 +220,49 @@ private:
                                           __FUNCTION__)                 \
             .stream()                                                   \
 
+/**
+ * Log at most limit messages per intervalMs milliseconds from this
+ * call site.  The first message logged after some were dropped notes
+ * how many were.
+ */
+#define LOG_RATE_LIMITED(level, limit, intervalMs)                      \
+    if (!LOG_SHOULD_EMIT(level)) {} else                                \
+    if (opflex::logging::internal::Allowance _log_allowance =           \
+        []() -> opflex::logging::internal::RateLimiter& {               \
+            static opflex::logging::internal::RateLimiter               \
+                l(limit, intervalMs);                                   \
+            return l;                                                   \
+        }().allow())                                                    \
+        opflex::logging::internal::Logger(level,                        \
+                                          __FILE__,                     \
+                                          __LINE__,                     \
+                                          __FUNCTION__)                 \
+            .stream() << _log_allowance
+
+/**
+ * Log at most DEFAULT_LOG_RATE_LIMIT messages per
+ * DEFAULT_LOG_RATE_INTERVAL_MS milliseconds from this call site
+ */
+#define LOG_RATE_LIMITED_DEFAULT(level)                                 \
+    LOG_RATE_LIMITED(level,                                             \
+                     opflex::logging::internal::DEFAULT_LOG_RATE_LIMIT, \
+                     opflex::logging::internal::DEFAULT_LOG_RATE_INTERVAL_MS)
+
+/**
+ * Log one in every rate messages from this call site, noting how many
+ * were left out
+ */
+#define LOG_SAMPLED(level, rate)                                        \
+    if (!LOG_SHOULD_EMIT(level)) {} else                                \
+    if (opflex::logging::internal::Allowance _log_allowance =           \
+        []() -> opflex::logging::internal::Sampler& {                   \
+            static opflex::logging::internal::Sampler s(rate);          \
+            return s;                                                   \
+        }().allow())                                                    \
+        opflex::logging::internal::Logger(level,                        \
+                                          __FILE__,                     \
+                                          __LINE__,                     \
+                                          __FUNCTION__)                 \
+            .stream() << _log_allowance
+
 #endif /* _INCLUDE__OPFLEX__LOGGING_HPP */
@@ -15,13 +15,19 @@
 #endif
 
 
+#include <algorithm>
+#include <cstdint>
 #include <utility>
 
+#include <boost/functional/hash.hpp>
+
 #include "opflex/modb/internal/ClassIndex.h"
 
 namespace opflex {
 namespace modb {
 
+using mointernal::ObjectInstance;
+
 ClassIndex::ClassIndex() {
 
 }
@@ -37,70 +43,177 @@ void ClassIndex::delInstance(const URI& uri) {
     instance_map.erase(uri);
 }
 
-bool ClassIndex::addChild(const URI& parent, prop_id_t parent_prop, 
+const uint32_t ClassIndex::NO_ENTRY = UINT32_MAX;
+
+size_t ClassIndex::childHash(const URI& parent, prop_id_t prop) {
+    size_t seed = std::hash<URI>()(parent);
+    boost::hash_combine(seed, prop);
+    return seed;
+}
+
+size_t ClassIndex::findChildSlot(const URI& parent, prop_id_t prop,
+                                 size_t hash) const {
+    size_t mask = child_slots.size() - 1;
+    size_t i = hash & mask;
+    while (true) {
+        uint32_t e = child_slots[i];
+        if (e == NO_ENTRY) return i;
+        const ChildEntry& ce = child_entries[e];
+        if (ce.hash == hash && ce.prop == prop && ce.parent == parent)
+            return i;
+        i = (i + 1) & mask;
+    }
+}
+
+const ClassIndex::ChildEntry*
+ClassIndex::findChildEntry(const URI& parent, prop_id_t prop) const {
+    if (child_slots.empty()) return NULL;
+    uint32_t e =
+        child_slots[findChildSlot(parent, prop, childHash(parent, prop))];
+    if (e == NO_ENTRY) return NULL;
+    return &child_entries[e];
+}
+
+ClassIndex::ChildEntry*
+ClassIndex::findChildEntry(const URI& parent, prop_id_t prop) {
+    return const_cast<ChildEntry*>
+        (static_cast<const ClassIndex*>(this)->findChildEntry(parent, prop));
+}
+
+void ClassIndex::growChildSlots() {
+    size_t size = child_slots.empty() ? 8 : child_slots.size() * 2;
+    child_slots.assign(size, NO_ENTRY);
+    size_t mask = size - 1;
+    for (size_t e = 0; e < child_entries.size(); ++e) {
+        size_t i = child_entries[e].hash & mask;
+        while (child_slots[i] != NO_ENTRY)
+            i = (i + 1) & mask;
+        child_slots[i] = e;
+    }
+}
+
+ClassIndex::ChildEntry& ClassIndex::insertChildEntry(const URI& parent,
+                                                     prop_id_t prop) {
+    // keep the load factor at or below 3/4
+    if ((child_entries.size() + 1) * 4 > child_slots.size() * 3)
+        growChildSlots();
+
+    size_t hash = childHash(parent, prop);
+    size_t slot = findChildSlot(parent, prop, hash);
+    if (child_slots[slot] != NO_ENTRY)
+        return child_entries[child_slots[slot]];
+
+    child_slots[slot] = child_entries.size();
+    child_entries.push_back(ChildEntry(parent, prop, hash));
+    return child_entries.back();
+}
+
+void ClassIndex::eraseChildEntry(const URI& parent, prop_id_t prop) {
+    if (child_slots.empty()) return;
+    size_t mask = child_slots.size() - 1;
+    size_t i = findChildSlot(parent, prop, childHash(parent, prop));
+    uint32_t removed = child_slots[i];
+    if (removed == NO_ENTRY) return;
+
+    // backward-shift deletion: move later entries in the probe
+    // sequence into the hole unless that would take them before
+    // their home slot
+    size_t j = i;
+    while (true) {
+        j = (j + 1) & mask;
+        uint32_t e = child_slots[j];
+        if (e == NO_ENTRY) break;
+        size_t k = child_entries[e].hash & mask;
+        bool home = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+        if (!home) {
+            child_slots[i] = e;
+            i = j;
+        }
+    }
+    child_slots[i] = NO_ENTRY;
+
+    // fill the hole in the dense array with the last entry
+    uint32_t last = child_entries.size() - 1;
+    if (removed != last) {
+        child_entries[removed] = std::move(child_entries[last]);
+        const ChildEntry& moved = child_entries[removed];
+        child_slots[findChildSlot(moved.parent, moved.prop,
+                                  moved.hash)] = removed;
+    }
+    child_entries.pop_back();
+}
+
+bool ClassIndex::addChild(const URI& parent, prop_id_t parent_prop,
                           const URI& child) {
-    uri_prop_map_t::iterator result = parent_map.find(child);
+    uri_parent_map_t::iterator result = parent_map.find(child);
     if (result != parent_map.end()) {
-        if (result->second.first == parent &&
-            result->second.second == parent_prop &&
-            result->first == child) {
+        if (result->second.parent.first == parent &&
+            result->second.parent.second == parent_prop) {
             return false;
         } else {
-            delChild(result->second.first, result->second.second, child);
+            std::pair<URI, prop_id_t> old = result->second.parent;
+            delChild(old.first, old.second, child);
         }
     }
-    child_map[parent][parent_prop].insert(child);
-    parent_map.insert(std::make_pair(child, std::make_pair(parent,parent_prop)));
+    ChildEntry& ce = insertChildEntry(parent, parent_prop);
+    ce.children.push_back(child);
+    parent_map.insert(std::make_pair(child,
+                                     ParentLink(parent, parent_prop,
+                                                ce.children.size() - 1)));
     return true;
 }
 
-bool ClassIndex::delChild(const URI& parent, prop_id_t parent_prop, 
+bool ClassIndex::delChild(const URI& parent, prop_id_t parent_prop,
                           const URI& child) {
-    uri_prop_uri_map_t::iterator cit = child_map.find(parent);
-    if (cit == child_map.end()) return false;
-    prop_uri_map_t& pmap = cit->second;
+    ChildEntry* ce = findChildEntry(parent, parent_prop);
+    if (ce == NULL) return false;
 
-    prop_uri_map_t::iterator pit = pmap.find(parent_prop);
-    if (pit == pmap.end()) return false;
-    uri_set_t& uset = pit->second;
+    uri_parent_map_t::iterator pit = parent_map.find(child);
+    if (pit == parent_map.end() ||
+        pit->second.parent.second != parent_prop ||
+        pit->second.parent.first != parent)
+        return false;
 
-    bool removed = uset.erase(child);
-    if (uset.size() == 0) {
-        pmap.erase(parent_prop);
-        if (pmap.size() == 0)
-            child_map.erase(parent);
+    // swap the last child into the removed position
+    size_t index = pit->second.index;
+    if (index != ce->children.size() - 1) {
+        ce->children[index] = ce->children.back();
+        parent_map.at(ce->children[index]).index = index;
     }
+    ce->children.pop_back();
+    parent_map.erase(pit);
 
-    parent_map.erase(child);
-
-    return removed;
+    if (ce->children.empty())
+        eraseChildEntry(parent, parent_prop);
+    return true;
 }
 
 void ClassIndex::getChildren(const URI& parent, prop_id_t parent_prop,
                              std::vector<URI>& output) const {
-    uri_prop_uri_map_t::const_iterator cit = child_map.find(parent);
-    if (cit == child_map.end()) return;
-    const prop_uri_map_t& pmap = cit->second;
-
-    prop_uri_map_t::const_iterator pit = pmap.find(parent_prop);
-    if (pit == pmap.end()) return;
-    const uri_set_t& uset = pit->second;
+    const ChildEntry* ce = findChildEntry(parent, parent_prop);
+    if (ce == NULL) return;
+    output.insert(output.end(), ce->children.begin(), ce->children.end());
+}
 
-    uri_set_t::const_iterator it;
-    for (it = uset.begin(); it != uset.end(); ++it) {
-        output.push_back(*it);
+bool ClassIndex::forEachChild(const URI& parent, prop_id_t parent_prop,
+                              const uri_visitor_t& visitor) const {
+    const ChildEntry* ce = findChildEntry(parent, parent_prop);
+    if (ce == NULL) return true;
+    for (const URI& child : ce->children) {
+        if (!visitor(child)) return false;
     }
+    return true;
 }
 
 const std::pair<URI, prop_id_t>& ClassIndex::getParent(const URI& child) const {
-    return parent_map.at(child);
+    return parent_map.at(child).parent;
 }
 
 bool ClassIndex::getParent(const URI& child,
                            /* out */ std::pair<URI, prop_id_t>& parent) const {
-    uri_prop_map_t::const_iterator itr = parent_map.find(child);
+    uri_parent_map_t::const_iterator itr = parent_map.find(child);
     if (itr != parent_map.end()) {
-        parent = itr->second;
+        parent = itr->second.parent;
         return true;
     }
     return false;
@@ -114,5 +227,197 @@ void ClassIndex::getAll(uri_set_t& output) const {
     output.insert(instance_map.begin(), instance_map.end());
 }
 
+bool ClassIndex::forEachInstance(const uri_visitor_t& visitor) const {
+    for (const URI& uri : instance_map) {
+        if (!visitor(uri)) return false;
+    }
+    return true;
+}
+
+/**
+ * Approximate per-node overhead of a hash table entry: the next
+ * pointer and cached hash, plus its bucket slot
+ */
+static const size_t NODE_BYTES = 3 * sizeof(void*);
+
+template <typename Set>
+static size_t uriSetBytes(const Set& set) {
+    size_t bytes = sizeof(Set);
+    for (const URI& uri : set)
+        bytes += NODE_BYTES + uri.getMemoryUsage();
+    return bytes;
+}
+
+size_t ClassIndex::getMemoryUsage() const {
+    size_t bytes = uriSetBytes(instance_map);
+    bytes += child_slots.capacity() * sizeof(uint32_t) +
+        child_entries.capacity() * sizeof(ChildEntry);
+    for (const ChildEntry& ce : child_entries) {
+        bytes += ce.parent.getMemoryUsage() - sizeof(URI) +
+            ce.children.capacity() * sizeof(URI);
+        for (const URI& child : ce.children)
+            bytes += child.getMemoryUsage() - sizeof(URI);
+    }
+    for (const uri_parent_map_t::value_type& p : parent_map) {
+        bytes += NODE_BYTES + p.first.getMemoryUsage() +
+            p.second.parent.first.getMemoryUsage() +
+            sizeof(prop_id_t) + sizeof(size_t);
+    }
+    for (const prop_index_map_t::value_type& pi : prop_indexes) {
+        bytes += NODE_BYTES + sizeof(pi);
+        for (const auto& v : pi.second.values) {
+            bytes += NODE_BYTES + sizeof(std::string) + v.first.capacity() +
+                uriSetBytes(v.second);
+        }
+    }
+    return bytes;
+}
+
+std::string ClassIndex::indexKey(uint64_t value) {
+    return std::string((const char*)&value, sizeof(value));
+}
+
+std::string ClassIndex::indexKey(const std::string& value) {
+    return value;
+}
+
+std::string ClassIndex::indexKey(const MAC& value) {
+    uint8_t bytes[6];
+    value.toUIntArray(bytes);
+    return std::string((const char*)bytes, sizeof(bytes));
+}
+
+std::string ClassIndex::indexKey(const reference_t& value) {
+    std::string key((const char*)&value.first, sizeof(value.first));
+    key += value.second.toString();
+    return key;
+}
+
+/**
+ * Get the index keys for each value of a property in the object
+ */
+static void getKeys(const ObjectInstance& oi,
+                    prop_id_t prop_id,
+                    PropertyInfo::property_type_t type,
+                    PropertyInfo::cardinality_t cardinality,
+                    /* out */ std::vector<std::string>& keys) {
+    // enums are stored as unsigned integers
+    switch (type) {
+    case PropertyInfo::ENUM8:
+    case PropertyInfo::ENUM16:
+    case PropertyInfo::ENUM32:
+    case PropertyInfo::ENUM64:
+        type = PropertyInfo::U64;
+        break;
+    default:
+        break;
+    }
+
+    if (cardinality == PropertyInfo::SCALAR) {
+        if (!oi.isSet(prop_id, type)) return;
+        switch (type) {
+        case PropertyInfo::U64:
+            keys.push_back(ClassIndex::indexKey(oi.getUInt64(prop_id)));
+            break;
+        case PropertyInfo::S64:
+            keys.push_back(ClassIndex::
+                           indexKey((uint64_t)oi.getInt64(prop_id)));
+            break;
+        case PropertyInfo::STRING:
+            keys.push_back(oi.getString(prop_id));
+            break;
+        case PropertyInfo::MAC:
+            keys.push_back(ClassIndex::indexKey(oi.getMAC(prop_id)));
+            break;
+        case PropertyInfo::REFERENCE:
+            keys.push_back(ClassIndex::indexKey(oi.getReference(prop_id)));
+            break;
+        default:
+            break;
+        }
+        return;
+    }
+
+    size_t i, n;
+    switch (type) {
+    case PropertyInfo::U64:
+        n = oi.getUInt64Size(prop_id);
+        for (i = 0; i < n; ++i)
+            keys.push_back(ClassIndex::indexKey(oi.getUInt64(prop_id, i)));
+        break;
+    case PropertyInfo::S64:
+        n = oi.getInt64Size(prop_id);
+        for (i = 0; i < n; ++i)
+            keys.push_back(ClassIndex::
+                           indexKey((uint64_t)oi.getInt64(prop_id, i)));
+        break;
+    case PropertyInfo::STRING:
+        n = oi.getStringSize(prop_id);
+        for (i = 0; i < n; ++i)
+            keys.push_back(oi.getString(prop_id, i));
+        break;
+    case PropertyInfo::MAC:
+        n = oi.getMACSize(prop_id);
+        for (i = 0; i < n; ++i)
+            keys.push_back(ClassIndex::indexKey(oi.getMAC(prop_id, i)));
+        break;
+    case PropertyInfo::REFERENCE:
+        n = oi.getReferenceSize(prop_id);
+        for (i = 0; i < n; ++i)
+            keys.push_back(ClassIndex::
+                           indexKey(oi.getReference(prop_id, i)));
+        break;
+    default:
+        break;
+    }
+}
+
+bool ClassIndex::addIndex(const PropertyInfo& prop) {
+    return prop_indexes.insert(std::make_pair(prop.getId(),
+                                              PropIndex(prop.getType(),
+                                                        prop.getCardinality())))
+        .second;
+}
+
+bool ClassIndex::hasIndex(prop_id_t prop_id) const {
+    return prop_indexes.find(prop_id) != prop_indexes.end();
+}
+
+void ClassIndex::updateIndexes(const URI& uri,
+                               const ObjectInstance* oldoi,
+                               const ObjectInstance* newoi) {
+    std::vector<std::string> oldkeys;
+    std::vector<std::string> newkeys;
+    for (prop_index_map_t::value_type& pi : prop_indexes) {
+        oldkeys.clear();
+        newkeys.clear();
+        if (oldoi) getKeys(*oldoi, pi.first, pi.second.type,
+                           pi.second.cardinality, oldkeys);
+        if (newoi) getKeys(*newoi, pi.first, pi.second.type,
+                           pi.second.cardinality, newkeys);
+        if (oldkeys == newkeys) continue;
+
+        for (const std::string& key : oldkeys) {
+            auto it = pi.second.values.find(key);
+            if (it == pi.second.values.end()) continue;
+            it->second.erase(uri);
+            if (it->second.empty())
+                pi.second.values.erase(it);
+        }
+        for (const std::string& key : newkeys) {
+            pi.second.values[key].insert(uri);
+        }
+    }
+}
+
+void ClassIndex::findByProperty(prop_id_t prop_id, const std::string& key,
+                                /* out */ std::unordered_set<URI>& output)
+    const {
+    const PropIndex& pi = prop_indexes.at(prop_id);
+    auto it = pi.values.find(key);
+    if (it == pi.values.end()) return;
+    output.insert(it->second.begin(), it->second.end());
+}
+
 } /* namespace modb */
 } /* namespace opflex */
@@ -24,11 +24,13 @@ ClassInfo::ClassInfo(class_id_t class_id_,
                      class_type_t class_type_,
                      const std::string& class_name_,
                      const std::string& owner_,
-                     const std::vector<PropertyInfo>& properties_)
+                     const std::vector<PropertyInfo>& properties_,
+                     const mointernal::ClassCodec* codec_)
     : class_id(class_id_),
       class_type(class_type_),
       class_name(class_name_), 
-      owner(owner_) {
+      owner(owner_),
+      codec(codec_) {
     std::vector<PropertyInfo>::const_iterator it;
     for (it = properties_.begin(); it != properties_.end(); ++it) {
         properties[it->getId()] = *it;
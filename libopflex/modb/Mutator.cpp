@@ -41,13 +41,29 @@ typedef std::unordered_map<URI, std::shared_ptr<ObjectInstance> > obj_map_t;
 class Mutator::MutatorImpl {
 public:
     MutatorImpl(ofcore::OFFramework& framework_,
-                const std::string& owner)
+                const std::string& owner, bool delta_)
         : framework(framework_),
-          client(framework.getStore().getStoreClient(owner)) { }
+          client(framework.getStore().getStoreClient(owner)),
+          delta(delta_) { }
+
+    // always read the latest version, even when the thread is
+    // reading from a snapshot
+    bool getLatest(class_id_t class_id, const URI& uri,
+                   std::shared_ptr<const ObjectInstance>& oi) {
+        ObjectStore& store = framework.getStore();
+        const uint64_t* snapshot = store.getThreadSnapshot();
+        store.setThreadSnapshot(NULL);
+        bool found = client.get(class_id, uri, oi);
+        store.setThreadSnapshot(snapshot);
+        return found;
+    }
 
     ofcore::OFFramework& framework;
     StoreClient& client;
 
+    // record property deltas rather than full copies
+    bool delta;
+
     // modified objects
     obj_map_t obj_map;
 
@@ -59,8 +75,9 @@ public:
 };
 
 Mutator::Mutator(ofcore::OFFramework& framework,
-                 const std::string& owner)
-    : pimpl(new MutatorImpl(framework, owner)) {
+                 const std::string& owner,
+                 bool delta)
+    : pimpl(new MutatorImpl(framework, owner, delta)) {
     pimpl->framework.registerTLMutator(*this);
 }
 
@@ -87,8 +104,11 @@ std::shared_ptr<ObjectInstance>& Mutator::modify(class_id_t class_id,
     if (it != pimpl->obj_map.end()) return it->second;
     std::shared_ptr<ObjectInstance> copy;
     std::shared_ptr<const ObjectInstance> oi;
-    if (pimpl->client.get(class_id, uri, oi)) {
-        copy = std::make_shared<ObjectInstance>(*oi.get());
+    if (pimpl->getLatest(class_id, uri, oi)) {
+        if (pimpl->delta)
+            copy = std::make_shared<ObjectInstance>(oi);
+        else
+            copy = std::make_shared<ObjectInstance>(*oi.get());
     } else {
         // create new object
         copy = std::make_shared<ObjectInstance>(class_id);
@@ -103,34 +123,54 @@ void Mutator::remove(class_id_t class_id, const URI& uri) {
     pimpl->removed_objects.insert(make_pair(class_id, uri));
 }
 
+ofcore::OFFramework& Mutator::getFramework() {
+    return pimpl->framework;
+}
+
 void Mutator::commit() {
     StoreClient::notif_t raw_notifs;
     StoreClient::notif_t notifs;
-    for (obj_map_t::value_type& objt : pimpl->obj_map) {
-        if (pimpl->client.putIfModified(objt.second->getClassId(),
-                                        objt.first,
-                                        objt.second))
-            raw_notifs[objt.first] = objt.second->getClassId();
-
-    }
-    for (uri_prop_uri_map_t::value_type& upt : pimpl->added_children) {
-        for (prop_uri_map_t::value_type& pt : upt.second) {
-            for (const reference_t& ut : pt.second) {
-                if (pimpl->client.addChild(ut.first, ut.second, pt.first,
-                                           upt.first.first, upt.first.second))
-                    raw_notifs[upt.first.second] = upt.first.first;
-
+    {
+        // publish all the changes to snapshots as one version
+        const ObjectStore::CommitGuard commit(pimpl->framework.getStore());
+        for (obj_map_t::value_type& objt : pimpl->obj_map) {
+            class_id_t class_id = objt.second->getClassId();
+            if (objt.second->isDelta()) {
+                // apply the changed properties to the current version
+                std::shared_ptr<const ObjectInstance> current;
+                if (pimpl->getLatest(class_id, objt.first, current))
+                    objt.second->rebase(current);
+                if (!objt.second->hasChanges())
+                    continue;
+                pimpl->client.put(class_id, objt.first,
+                                  objt.second->merge());
+                raw_notifs[objt.first] = class_id;
+            } else if (pimpl->client.putIfModified(class_id,
+                                                   objt.first,
+                                                   objt.second)) {
+                raw_notifs[objt.first] = class_id;
+            }
+        }
+        for (uri_prop_uri_map_t::value_type& upt : pimpl->added_children) {
+            for (prop_uri_map_t::value_type& pt : upt.second) {
+                for (const reference_t& ut : pt.second) {
+                    if (pimpl->client.addChild(ut.first, ut.second,
+                                               pt.first, upt.first.first,
+                                               upt.first.second))
+                        raw_notifs[upt.first.second] = upt.first.first;
+
+                }
             }
         }
-    }
 
-    for (const StoreClient::notif_t::value_type& nt : raw_notifs) {
-        pimpl->client.queueNotification(nt.second, nt.first, notifs);
-    }
+        for (const StoreClient::notif_t::value_type& nt : raw_notifs) {
+            pimpl->client.queueNotification(nt.second, nt.first, notifs);
+        }
 
-    for (const reference_t& rt : pimpl->removed_objects) {
-        if (pimpl->client.remove(rt.first, rt.second, false))
-            pimpl->client.queueNotification(rt.first, rt.second, notifs);
+        for (const reference_t& rt : pimpl->removed_objects) {
+            if (pimpl->client.remove(rt.first, rt.second, false))
+                pimpl->client.queueNotification(rt.first, rt.second, notifs);
+        }
     }
 
     pimpl->obj_map.clear();
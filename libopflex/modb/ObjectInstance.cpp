@@ -16,6 +16,8 @@
 
 
 #include <utility>
+#include <algorithm>
+#include <stdexcept>
 
 #include "opflex/modb/mo-internal/ObjectInstance.h"
 
@@ -75,9 +77,18 @@ ObjectInstance::Value::Value(const Value& val)
             value = new vector<reference_t>(*get<vector<reference_t>*>(val.value));
         else if (type == PropertyInfo::STRING)
             value = new vector<string>(*get<vector<string>*>(val.value));
+        else if (type == PropertyInfo::MAC)
+            value = new vector<MAC>(*get<vector<MAC>*>(val.value));
     }
 }
 
+ObjectInstance::Value::Value(Value&& val) noexcept
+    : type(val.type), cardinality(val.cardinality),
+      value(std::move(val.value)) {
+    // ownership of any vector moves with the pointer
+    val.value = boost::blank();
+}
+
 ObjectInstance::Value::~Value() {
     try {
         clear();
@@ -120,154 +131,279 @@ ObjectInstance::Value& ObjectInstance::Value::operator=(const Value& val) {
             value = new vector<reference_t>(*get<vector<reference_t>*>(val.value));
         else if (type == PropertyInfo::STRING)
             value = new vector<string>(*get<vector<string>*>(val.value));
+        else if (type == PropertyInfo::MAC)
+            value = new vector<MAC>(*get<vector<MAC>*>(val.value));
     }
     return *this;
 }
 
+ObjectInstance::Value& ObjectInstance::Value::operator=(Value&& val) noexcept {
+    if (this == &val) return *this;
+    clear();
+
+    type = val.type;
+    cardinality = val.cardinality;
+    value = std::move(val.value);
+    val.value = boost::blank();
+    return *this;
+}
+
+bool ObjectInstance::keyLess(const prop_entry_t& entry,
+                             const prop_key_t& key) {
+    if (get<2>(entry.first) != get<2>(key))
+        return get<2>(entry.first) < get<2>(key);
+    if (get<0>(entry.first) != get<0>(key))
+        return get<0>(entry.first) < get<0>(key);
+    return get<1>(entry.first) < get<1>(key);
+}
+
+ObjectInstance::prop_map_t::iterator
+ObjectInstance::lowerBound(const prop_key_t& key) {
+    return std::lower_bound(prop_map.begin(), prop_map.end(), key, keyLess);
+}
+
+ObjectInstance::ObjectInstance(const std::shared_ptr<const ObjectInstance>& base)
+    : class_id(base->class_id), local(base->local), delta(new Delta()) {
+    delta->base = base;
+}
+
+ObjectInstance::ObjectInstance(const ObjectInstance& oi)
+    : class_id(oi.class_id), prop_map(oi.prop_map), local(oi.local) {
+    if (oi.delta)
+        delta.reset(new Delta(*oi.delta));
+}
+
+ObjectInstance& ObjectInstance::operator=(const ObjectInstance& oi) {
+    if (this == &oi) return *this;
+    class_id = oi.class_id;
+    prop_map = oi.prop_map;
+    local = oi.local;
+    delta.reset(oi.delta ? new Delta(*oi.delta) : NULL);
+    return *this;
+}
+
+ObjectInstance::~ObjectInstance() { }
+
+const ObjectInstance::Value*
+ObjectInstance::findValue(const prop_key_t& key) const {
+    prop_map_t::const_iterator it =
+        std::lower_bound(prop_map.begin(), prop_map.end(), key, keyLess);
+    if (it != prop_map.end() && it->first == key) return &it->second;
+    if (!delta) return NULL;
+
+    // fall through to the base unless the delta unset the property
+    if (std::find(delta->unset.begin(), delta->unset.end(), key) !=
+        delta->unset.end())
+        return NULL;
+    return delta->base->findValue(key);
+}
+
+const ObjectInstance::Value&
+ObjectInstance::getValue(const prop_key_t& key) const {
+    const Value* v = findValue(key);
+    if (!v) throw std::out_of_range("Property not set");
+    return *v;
+}
+
+ObjectInstance::Value& ObjectInstance::findOrInsert(const prop_key_t& key,
+                                                    bool copyBase) {
+    prop_map_t::iterator it = lowerBound(key);
+    if (it != prop_map.end() && it->first == key)
+        return it->second;
+
+    if (delta) {
+        std::vector<prop_key_t>::iterator uit =
+            std::find(delta->unset.begin(), delta->unset.end(), key);
+        if (uit != delta->unset.end()) {
+            delta->unset.erase(uit);
+        } else if (copyBase) {
+            // copy the property from the base on first modification
+            const Value* bv = delta->base->findValue(key);
+            if (bv)
+                return prop_map.insert(it, prop_entry_t(key, *bv))->second;
+        }
+    }
+    return prop_map.insert(it, prop_entry_t(key, Value()))->second;
+}
+
 bool ObjectInstance::isSet(prop_id_t prop_id,
                            PropertyInfo::property_type_t type,
                            PropertyInfo::cardinality_t cardinality) const {
     type = normalize(type);
-    return prop_map.find(make_tuple(type,
-                                    cardinality,
-                                    prop_id)) != prop_map.end();
+    return findValue(make_tuple(type, cardinality, prop_id)) != NULL;
 }
 
 bool ObjectInstance::unset(prop_id_t prop_id,
                            PropertyInfo::property_type_t type,
                            PropertyInfo::cardinality_t cardinality) {
     type = normalize(type);
-    auto it = prop_map.find(make_tuple(type, cardinality, prop_id));
-    if (it == prop_map.end()) return false;
+    prop_key_t key = make_tuple(type, cardinality, prop_id);
+    bool wasSet = findValue(key) != NULL;
+    prop_map_t::iterator it = lowerBound(key);
+    if (it != prop_map.end() && it->first == key)
+        prop_map.erase(it);
 
-    prop_map.erase(it);
-    return true;
+    if (delta && delta->base->findValue(key) &&
+        std::find(delta->unset.begin(), delta->unset.end(), key) ==
+        delta->unset.end())
+        delta->unset.push_back(key);
+    return wasSet;
 }
 
 uint64_t ObjectInstance::getUInt64(prop_id_t prop_id) const {
-    const Value& v = prop_map.at(make_tuple(PropertyInfo::U64,
-                                            PropertyInfo::SCALAR,
-                                            prop_id));
+    const Value& v = getValue(make_tuple(PropertyInfo::U64,
+                                         PropertyInfo::SCALAR,
+                                         prop_id));
     return get<uint64_t>(v.value);
 }
 
 uint64_t ObjectInstance::getUInt64(prop_id_t prop_id,
                                    size_t index) const {
-    const Value& v = prop_map.at(make_tuple(PropertyInfo::U64,
-                                            PropertyInfo::VECTOR,
-                                            prop_id));
+    const Value& v = getValue(make_tuple(PropertyInfo::U64,
+                                         PropertyInfo::VECTOR,
+                                         prop_id));
     return get<vector<uint64_t>*>(v.value)->at(index);
 }
 
 size_t ObjectInstance::getUInt64Size(prop_id_t prop_id) const {
-    auto it =
-        prop_map.find(make_tuple(PropertyInfo::U64,
-                                 PropertyInfo::VECTOR,
-                                 prop_id));
-    if (it == prop_map.end()) return 0;
-    return get<vector<uint64_t>*>(it->second.value)->size();
+    const Value* v = findValue(make_tuple(PropertyInfo::U64,
+                                          PropertyInfo::VECTOR,
+                                          prop_id));
+    if (!v) return 0;
+    return get<vector<uint64_t>*>(v->value)->size();
 }
 
 const MAC& ObjectInstance::getMAC(prop_id_t prop_id) const {
-    const Value& v = prop_map.at(make_tuple(PropertyInfo::MAC,
-                                            PropertyInfo::SCALAR,
-                                            prop_id));
+    const Value& v = getValue(make_tuple(PropertyInfo::MAC,
+                                         PropertyInfo::SCALAR,
+                                         prop_id));
     return get<MAC>(v.value);
 }
 
 const MAC& ObjectInstance::getMAC(prop_id_t prop_id,
                                    size_t index) const {
-    const Value& v = prop_map.at(make_tuple(PropertyInfo::MAC,
-                                            PropertyInfo::VECTOR,
-                                            prop_id));
+    const Value& v = getValue(make_tuple(PropertyInfo::MAC,
+                                         PropertyInfo::VECTOR,
+                                         prop_id));
     return get<vector<MAC>*>(v.value)->at(index);
 }
 
 size_t ObjectInstance::getMACSize(prop_id_t prop_id) const {
-    auto it =
-        prop_map.find(make_tuple(PropertyInfo::MAC,
-                                 PropertyInfo::VECTOR,
-                                 prop_id));
-    if (it == prop_map.end()) return 0;
-    return get<vector<MAC>*>(it->second.value)->size();
+    const Value* v = findValue(make_tuple(PropertyInfo::MAC,
+                                          PropertyInfo::VECTOR,
+                                          prop_id));
+    if (!v) return 0;
+    return get<vector<MAC>*>(v->value)->size();
 }
 
 int64_t ObjectInstance::getInt64(prop_id_t prop_id) const {
-    const Value& v = prop_map.at(make_tuple(PropertyInfo::S64,
-                                            PropertyInfo::SCALAR,
-                                            prop_id));
+    const Value& v = getValue(make_tuple(PropertyInfo::S64,
+                                         PropertyInfo::SCALAR,
+                                         prop_id));
     return get<int64_t>(v.value);
 }
 
 int64_t ObjectInstance::getInt64(prop_id_t prop_id,
                                  size_t index) const {
-    const Value& v = prop_map.at(make_tuple(PropertyInfo::S64,
-                                            PropertyInfo::VECTOR,
-                                            prop_id));
+    const Value& v = getValue(make_tuple(PropertyInfo::S64,
+                                         PropertyInfo::VECTOR,
+                                         prop_id));
     return get<vector<int64_t>*>(v.value)->at(index);
 }
 
 size_t ObjectInstance::getInt64Size(prop_id_t prop_id) const {
-    auto it =
-        prop_map.find(make_tuple(PropertyInfo::S64,
-                                 PropertyInfo::VECTOR,
-                                 prop_id));
-    if (it == prop_map.end()) return 0;
-    return get<vector<int64_t>*>(it->second.value)->size();
+    const Value* v = findValue(make_tuple(PropertyInfo::S64,
+                                          PropertyInfo::VECTOR,
+                                          prop_id));
+    if (!v) return 0;
+    return get<vector<int64_t>*>(v->value)->size();
 }
 
 const string& ObjectInstance::getString(prop_id_t prop_id) const {
-    const Value& v = prop_map.at(make_tuple(PropertyInfo::STRING,
-                                            PropertyInfo::SCALAR,
-                                            prop_id));
+    const Value& v = getValue(make_tuple(PropertyInfo::STRING,
+                                         PropertyInfo::SCALAR,
+                                         prop_id));
     return get<string>(v.value);
 }
 
 const string& ObjectInstance::getString(prop_id_t prop_id,
                                         size_t index) const {
-    const Value& v = prop_map.at(make_tuple(PropertyInfo::STRING,
-                                            PropertyInfo::VECTOR,
-                                            prop_id));
+    const Value& v = getValue(make_tuple(PropertyInfo::STRING,
+                                         PropertyInfo::VECTOR,
+                                         prop_id));
     return get<vector<string>*>(v.value)->at(index);
 }
 
 size_t ObjectInstance::getStringSize(prop_id_t prop_id) const {
-    auto it =
-        prop_map.find(make_tuple(PropertyInfo::STRING,
-                                 PropertyInfo::VECTOR,
-                                 prop_id));
-    if (it == prop_map.end()) return 0;
-    return get<vector<string>*>(it->second.value)->size();
+    const Value* v = findValue(make_tuple(PropertyInfo::STRING,
+                                          PropertyInfo::VECTOR,
+                                          prop_id));
+    if (!v) return 0;
+    return get<vector<string>*>(v->value)->size();
+}
+
+const uint64_t* ObjectInstance::findUInt64(prop_id_t prop_id) const {
+    const Value* v = findValue(make_tuple(PropertyInfo::U64,
+                                          PropertyInfo::SCALAR,
+                                          prop_id));
+    return v ? &get<uint64_t>(v->value) : NULL;
+}
+
+const int64_t* ObjectInstance::findInt64(prop_id_t prop_id) const {
+    const Value* v = findValue(make_tuple(PropertyInfo::S64,
+                                          PropertyInfo::SCALAR,
+                                          prop_id));
+    return v ? &get<int64_t>(v->value) : NULL;
+}
+
+const string* ObjectInstance::findString(prop_id_t prop_id) const {
+    const Value* v = findValue(make_tuple(PropertyInfo::STRING,
+                                          PropertyInfo::SCALAR,
+                                          prop_id));
+    return v ? &get<string>(v->value) : NULL;
+}
+
+const reference_t* ObjectInstance::findReference(prop_id_t prop_id) const {
+    const Value* v = findValue(make_tuple(PropertyInfo::REFERENCE,
+                                          PropertyInfo::SCALAR,
+                                          prop_id));
+    return v ? &get<reference_t>(v->value) : NULL;
+}
+
+const MAC* ObjectInstance::findMAC(prop_id_t prop_id) const {
+    const Value* v = findValue(make_tuple(PropertyInfo::MAC,
+                                          PropertyInfo::SCALAR,
+                                          prop_id));
+    return v ? &get<MAC>(v->value) : NULL;
 }
 
 reference_t ObjectInstance::getReference(prop_id_t prop_id) const {
-    const Value& v = prop_map.at(make_tuple(PropertyInfo::REFERENCE,
-                                            PropertyInfo::SCALAR,
-                                            prop_id));
+    const Value& v = getValue(make_tuple(PropertyInfo::REFERENCE,
+                                         PropertyInfo::SCALAR,
+                                         prop_id));
     return get<reference_t>(v.value);
 }
 
 reference_t ObjectInstance::getReference(prop_id_t prop_id,
                                          size_t index) const {
-    const Value& v = prop_map.at(make_tuple(PropertyInfo::REFERENCE,
-                                            PropertyInfo::VECTOR,
-                                            prop_id));
+    const Value& v = getValue(make_tuple(PropertyInfo::REFERENCE,
+                                         PropertyInfo::VECTOR,
+                                         prop_id));
     return get<vector<reference_t>*>(v.value)->at(index);
 }
 
 size_t ObjectInstance::getReferenceSize(prop_id_t prop_id) const {
-    auto it =
-        prop_map.find(make_tuple(PropertyInfo::REFERENCE,
-                                 PropertyInfo::VECTOR,
-                                 prop_id));
-    if (it == prop_map.end()) return 0;
-    return get<vector<reference_t>*>(it->second.value)->size();
+    const Value* v = findValue(make_tuple(PropertyInfo::REFERENCE,
+                                          PropertyInfo::VECTOR,
+                                          prop_id));
+    if (!v) return 0;
+    return get<vector<reference_t>*>(v->value)->size();
 }
 
 void ObjectInstance::setUInt64(prop_id_t prop_id, uint64_t value) {
-    Value& v = prop_map[make_tuple(PropertyInfo::U64,
-                                   PropertyInfo::SCALAR,
-                                   prop_id)];
+    Value& v = findOrInsert(make_tuple(PropertyInfo::U64,
+                                       PropertyInfo::SCALAR,
+                                       prop_id));
     v.type = PropertyInfo::U64;
     v.cardinality = PropertyInfo::SCALAR;
     v.value = value;
@@ -275,9 +411,9 @@ void ObjectInstance::setUInt64(prop_id_t prop_id, uint64_t value) {
 
 void ObjectInstance::setUInt64(prop_id_t prop_id,
                                const vector<uint64_t>& value) {
-    Value& v = prop_map[make_tuple(PropertyInfo::U64,
-                                   PropertyInfo::VECTOR,
-                                   prop_id)];
+    Value& v = findOrInsert(make_tuple(PropertyInfo::U64,
+                                       PropertyInfo::VECTOR,
+                                       prop_id));
     v.type = PropertyInfo::U64;
     v.cardinality = PropertyInfo::VECTOR;
     if (v.value.which() != 0)
@@ -286,9 +422,9 @@ void ObjectInstance::setUInt64(prop_id_t prop_id,
 }
 
 void ObjectInstance::setMAC(prop_id_t prop_id, const MAC& value) {
-    Value& v = prop_map[make_tuple(PropertyInfo::MAC,
-                                   PropertyInfo::SCALAR,
-                                   prop_id)];
+    Value& v = findOrInsert(make_tuple(PropertyInfo::MAC,
+                                       PropertyInfo::SCALAR,
+                                       prop_id));
     v.type = PropertyInfo::MAC;
     v.cardinality = PropertyInfo::SCALAR;
     v.value = value;
@@ -296,9 +432,9 @@ void ObjectInstance::setMAC(prop_id_t prop_id, const MAC& value) {
 
 void ObjectInstance::setMAC(prop_id_t prop_id,
                                const vector<MAC>& value) {
-    Value& v = prop_map[make_tuple(PropertyInfo::MAC,
-                                   PropertyInfo::VECTOR,
-                                   prop_id)];
+    Value& v = findOrInsert(make_tuple(PropertyInfo::MAC,
+                                       PropertyInfo::VECTOR,
+                                       prop_id));
     v.type = PropertyInfo::MAC;
     v.cardinality = PropertyInfo::VECTOR;
     if (v.value.which() != 0)
@@ -307,9 +443,9 @@ void ObjectInstance::setMAC(prop_id_t prop_id,
 }
 
 void ObjectInstance::setInt64(prop_id_t prop_id, int64_t value) {
-    Value& v = prop_map[make_tuple(PropertyInfo::S64,
-                                   PropertyInfo::SCALAR,
-                                   prop_id)];
+    Value& v = findOrInsert(make_tuple(PropertyInfo::S64,
+                                       PropertyInfo::SCALAR,
+                                       prop_id));
     v.type = PropertyInfo::S64;
     v.cardinality = PropertyInfo::SCALAR;
     v.value = value;
@@ -317,9 +453,9 @@ void ObjectInstance::setInt64(prop_id_t prop_id, int64_t value) {
 
 void ObjectInstance::setInt64(prop_id_t prop_id,
                               const vector<int64_t>& value) {
-    Value& v = prop_map[make_tuple(PropertyInfo::S64,
-                                   PropertyInfo::VECTOR,
-                                   prop_id)];
+    Value& v = findOrInsert(make_tuple(PropertyInfo::S64,
+                                       PropertyInfo::VECTOR,
+                                       prop_id));
     v.type = PropertyInfo::S64;
     v.cardinality = PropertyInfo::VECTOR;
     if (v.value.which() != 0)
@@ -328,9 +464,9 @@ void ObjectInstance::setInt64(prop_id_t prop_id,
 }
 
 void ObjectInstance::setString(prop_id_t prop_id, const string& value) {
-    Value& v = prop_map[make_tuple(PropertyInfo::STRING,
-                                   PropertyInfo::SCALAR,
-                                   prop_id)];
+    Value& v = findOrInsert(make_tuple(PropertyInfo::STRING,
+                                       PropertyInfo::SCALAR,
+                                       prop_id));
     v.type = PropertyInfo::STRING;
     v.cardinality = PropertyInfo::SCALAR;
     v.value = value;
@@ -338,9 +474,9 @@ void ObjectInstance::setString(prop_id_t prop_id, const string& value) {
 
 void ObjectInstance::setString(prop_id_t prop_id,
                                const vector<string>& value) {
-    Value& v = prop_map[make_tuple(PropertyInfo::STRING,
-                                   PropertyInfo::VECTOR,
-                                   prop_id)];
+    Value& v = findOrInsert(make_tuple(PropertyInfo::STRING,
+                                       PropertyInfo::VECTOR,
+                                       prop_id));
     v.type = PropertyInfo::STRING;
     v.cardinality = PropertyInfo::VECTOR;
     if (v.value.which() != 0)
@@ -351,9 +487,9 @@ void ObjectInstance::setString(prop_id_t prop_id,
 
 void ObjectInstance::setReference(prop_id_t prop_id,
                                   class_id_t class_id, const URI& uri) {
-    Value& v = prop_map[make_tuple(PropertyInfo::REFERENCE,
-                                   PropertyInfo::SCALAR,
-                                   prop_id)];
+    Value& v = findOrInsert(make_tuple(PropertyInfo::REFERENCE,
+                                       PropertyInfo::SCALAR,
+                                       prop_id));
     v.type = PropertyInfo::REFERENCE;
     v.cardinality = PropertyInfo::SCALAR;
     v.value = make_pair(class_id, uri);
@@ -361,9 +497,9 @@ void ObjectInstance::setReference(prop_id_t prop_id,
 
 void ObjectInstance::setReference(prop_id_t prop_id,
                                   const vector<reference_t>& value) {
-    Value& v = prop_map[make_tuple(PropertyInfo::REFERENCE,
-                                   PropertyInfo::VECTOR,
-                                   prop_id)];
+    Value& v = findOrInsert(make_tuple(PropertyInfo::REFERENCE,
+                                       PropertyInfo::VECTOR,
+                                       prop_id));
     v.type = PropertyInfo::REFERENCE;
     v.cardinality = PropertyInfo::VECTOR;
     if (v.value.which() != 0)
@@ -372,9 +508,9 @@ void ObjectInstance::setReference(prop_id_t prop_id,
 }
 
 void ObjectInstance::addUInt64(prop_id_t prop_id, uint64_t value) {
-    Value& v = prop_map[make_tuple(PropertyInfo::U64,
-                                   PropertyInfo::VECTOR,
-                                   prop_id)];
+    Value& v = findOrInsert(make_tuple(PropertyInfo::U64,
+                                       PropertyInfo::VECTOR,
+                                       prop_id), true);
     vector<uint64_t>* val;
     if (v.value.which() == 0) {
         v.type = PropertyInfo::U64;
@@ -387,9 +523,9 @@ void ObjectInstance::addUInt64(prop_id_t prop_id, uint64_t value) {
 }
 
 void ObjectInstance::addMAC(prop_id_t prop_id, const MAC& value) {
-    Value& v = prop_map[make_tuple(PropertyInfo::MAC,
-                                   PropertyInfo::VECTOR,
-                                   prop_id)];
+    Value& v = findOrInsert(make_tuple(PropertyInfo::MAC,
+                                       PropertyInfo::VECTOR,
+                                       prop_id), true);
     vector<MAC>* val;
     if (v.value.which() == 0) {
         v.type = PropertyInfo::MAC;
@@ -402,9 +538,9 @@ void ObjectInstance::addMAC(prop_id_t prop_id, const MAC& value) {
 }
 
 void ObjectInstance::addInt64(prop_id_t prop_id, int64_t value) {
-    Value& v = prop_map[make_tuple(PropertyInfo::S64,
-                                   PropertyInfo::VECTOR,
-                                   prop_id)];
+    Value& v = findOrInsert(make_tuple(PropertyInfo::S64,
+                                       PropertyInfo::VECTOR,
+                                       prop_id), true);
     vector<int64_t>* val;
     if (v.value.which() == 0) {
         v.type = PropertyInfo::S64;
@@ -417,9 +553,9 @@ void ObjectInstance::addInt64(prop_id_t prop_id, int64_t value) {
 }
 
 void ObjectInstance::addString(prop_id_t prop_id, const string& value) {
-    Value& v = prop_map[make_tuple(PropertyInfo::STRING,
-                                   PropertyInfo::VECTOR,
-                                   prop_id)];
+    Value& v = findOrInsert(make_tuple(PropertyInfo::STRING,
+                                       PropertyInfo::VECTOR,
+                                       prop_id), true);
     vector<string>* val;
     if (v.value.which() == 0) {
         v.type = PropertyInfo::STRING;
@@ -434,9 +570,9 @@ void ObjectInstance::addString(prop_id_t prop_id, const string& value) {
 void ObjectInstance::addReference(prop_id_t prop_id,
                                   class_id_t class_id,
                                   const URI& uri) {
-    Value& v = prop_map[make_tuple(PropertyInfo::REFERENCE,
-                                   PropertyInfo::VECTOR,
-                                   prop_id)];
+    Value& v = findOrInsert(make_tuple(PropertyInfo::REFERENCE,
+                                       PropertyInfo::VECTOR,
+                                       prop_id), true);
     vector<reference_t>* val;
     if (v.value.which() == 0) {
         v.type = PropertyInfo::REFERENCE;
@@ -448,6 +584,96 @@ void ObjectInstance::addReference(prop_id_t prop_id,
     val->push_back(make_pair(class_id, uri));
 }
 
+/**
+ * Approximate the heap memory used by a string, assuming short
+ * strings are stored inline
+ */
+static size_t stringHeapBytes(const string& s) {
+    return s.capacity() > 15 ? s.capacity() + 1 : 0;
+}
+
+template <typename T>
+static size_t vectorBytes(const vector<T>* v) {
+    return sizeof(vector<T>) + v->capacity() * sizeof(T);
+}
+
+size_t ObjectInstance::getMemoryUsage() const {
+    size_t bytes = sizeof(ObjectInstance) +
+        prop_map.capacity() * sizeof(prop_entry_t);
+    for (const prop_entry_t& p : prop_map) {
+        const Value& v = p.second;
+        if (const string* sv = get<string>(&v.value)) {
+            bytes += stringHeapBytes(*sv);
+        } else if (const reference_t* rv = get<reference_t>(&v.value)) {
+            bytes += rv->second.getMemoryUsage() - sizeof(URI);
+        } else if (vector<uint64_t>* const* uv =
+                   get<vector<uint64_t>*>(&v.value)) {
+            bytes += vectorBytes(*uv);
+        } else if (vector<int64_t>* const* iv =
+                   get<vector<int64_t>*>(&v.value)) {
+            bytes += vectorBytes(*iv);
+        } else if (vector<MAC>* const* mv = get<vector<MAC>*>(&v.value)) {
+            bytes += vectorBytes(*mv);
+        } else if (vector<string>* const* svv =
+                   get<vector<string>*>(&v.value)) {
+            bytes += vectorBytes(*svv);
+            for (const string& e : **svv)
+                bytes += stringHeapBytes(e);
+        } else if (vector<reference_t>* const* rvv =
+                   get<vector<reference_t>*>(&v.value)) {
+            bytes += vectorBytes(*rvv);
+            for (const reference_t& e : **rvv)
+                bytes += e.second.getMemoryUsage() - sizeof(URI);
+        }
+    }
+    return bytes;
+}
+
+bool ObjectInstance::hasChanges() const {
+    if (!delta) return true;
+    for (const prop_entry_t& p : prop_map) {
+        const Value* bv = delta->base->findValue(p.first);
+        if (!bv || *bv != p.second) return true;
+    }
+    for (const prop_key_t& key : delta->unset) {
+        if (delta->base->findValue(key)) return true;
+    }
+    return false;
+}
+
+void ObjectInstance::rebase(const std::shared_ptr<const ObjectInstance>& base) {
+    if (!delta)
+        throw std::logic_error("Object instance is not a delta");
+    delta->base = base;
+}
+
+std::shared_ptr<ObjectInstance> ObjectInstance::merge() const {
+    if (!delta) return std::make_shared<ObjectInstance>(*this);
+
+    // both arrays are sorted, so merge them in a single pass
+    std::shared_ptr<ObjectInstance> result =
+        std::make_shared<ObjectInstance>(class_id, local);
+    const prop_map_t& base = delta->base->prop_map;
+    result->prop_map.reserve(base.size() + prop_map.size());
+    prop_map_t::const_iterator bit = base.begin();
+    prop_map_t::const_iterator dit = prop_map.begin();
+    while (bit != base.end() || dit != prop_map.end()) {
+        if (dit == prop_map.end() ||
+            (bit != base.end() && keyLess(*bit, dit->first))) {
+            if (std::find(delta->unset.begin(), delta->unset.end(),
+                          bit->first) == delta->unset.end())
+                result->prop_map.push_back(*bit);
+            ++bit;
+        } else {
+            if (bit != base.end() && bit->first == dit->first)
+                ++bit;
+            result->prop_map.push_back(*dit);
+            ++dit;
+        }
+    }
+    return result;
+}
+
 template <typename T>
 bool equal(const ObjectInstance::Value& lhs,
            const ObjectInstance::Value& rhs) {
@@ -505,14 +731,27 @@ bool operator!=(const ObjectInstance::Value& lhs,
 }
 
 bool operator==(const ObjectInstance& lhs, const ObjectInstance& rhs) {
-    for (const ObjectInstance::prop_map_t::value_type& v : lhs.prop_map) {
-        auto it = rhs.prop_map.find(v.first);
-        if (it == rhs.prop_map.end()) return false;
-        if (v.second != it->second) return false;
+    // deltas are equal only if they record the same changes to equal
+    // bases.  Compare the results of merge() to compare their effects.
+    if (lhs.delta || rhs.delta) {
+        if (!lhs.delta || !rhs.delta) return false;
+        if (lhs.delta->base != rhs.delta->base &&
+            *lhs.delta->base != *rhs.delta->base)
+            return false;
+        if (lhs.delta->unset.size() != rhs.delta->unset.size() ||
+            !std::is_permutation(lhs.delta->unset.begin(),
+                                 lhs.delta->unset.end(),
+                                 rhs.delta->unset.begin()))
+            return false;
     }
-    for (const ObjectInstance::prop_map_t::value_type& v : rhs.prop_map) {
-        auto it = lhs.prop_map.find(v.first);
-        if (it == lhs.prop_map.end()) return false;
+
+    // both property arrays are kept sorted by key with no duplicates
+    if (lhs.prop_map.size() != rhs.prop_map.size()) return false;
+    ObjectInstance::prop_map_t::const_iterator lit = lhs.prop_map.begin();
+    ObjectInstance::prop_map_t::const_iterator rit = rhs.prop_map.begin();
+    for (; lit != lhs.prop_map.end(); ++lit, ++rit) {
+        if (lit->first != rit->first) return false;
+        if (lit->second != rit->second) return false;
     }
     return true;
 }
@@ -17,6 +17,7 @@
 #include <stdexcept>
 
 #include "opflex/modb/internal/ObjectStore.h"
+#include "opflex/logging/internal/logging.hpp"
 
 namespace opflex {
 namespace modb {
@@ -25,11 +26,20 @@ using mointernal::StoreClient;
 
 ObjectStore::ObjectStore(util::ThreadManager& threadManager_)
     : systemClient(this, NULL), readOnlyClient(this, NULL, true),
-      notif_proc(this), notif_queue(&notif_proc, threadManager_) {
+      threadManager(threadManager_),
+      notif_proc(this, "modb_notif", NotifQueueProc::ALL),
+      notif_queue(&notif_proc, threadManager_), started(false),
+      version(0), history_limit(DEFAULT_SNAPSHOT_HISTORY),
+      history_size(0), expired_below(0), prune_pending(false),
+      journal_size(0), journal_head(0), journal_seq(0) {
+    uv_key_create(&commit_key);
+    uv_key_create(&snapshot_key);
 }
 
 ObjectStore::~ObjectStore() {
     stop();
+    uv_key_delete(&snapshot_key);
+    uv_key_delete(&commit_key);
 
     region_owner_map_t::const_iterator it;
     for (it = region_owner_map.begin();
@@ -63,8 +73,21 @@ void ObjectStore::init(const ModelMetadata& model) {
     }
 }
 
-ObjectStore::NotifQueueProc::NotifQueueProc(ObjectStore* store_)
-    : store(store_) {}
+ObjectStore::NotifQueueProc::NotifQueueProc(ObjectStore* store_,
+                                            const std::string& name_,
+                                            mode_t mode_)
+    : store(store_), name(name_), mode(mode_) {}
+
+bool ObjectStore::NotifQueueProc::accepts(const ObjectListener* l) const {
+    switch (mode) {
+    case SERIAL:
+        return !l->isThreadSafe();
+    case PARALLEL:
+        return l->isThreadSafe();
+    default:
+        return true;
+    }
+}
 
 void ObjectStore::NotifQueueProc::processItem(const URI& uri,
                                               const boost::any& data) {
@@ -74,21 +97,95 @@ void ObjectStore::NotifQueueProc::processItem(const URI& uri,
     std::list<ObjectListener*>& listeners =
         store->class_map.at(class_id).listeners;
     for (it = listeners.begin(); it != listeners.end(); ++it) {
-        (*it)->objectUpdated(class_id, uri);
+        if (accepts(*it))
+            (*it)->objectUpdated(class_id, uri);
+    }
+}
+
+void ObjectStore::NotifQueueProc::
+processItems(const URIQueue::item_batch_t& items) {
+    typedef std::pair<ObjectListener*,
+                      ObjectListener::update_list_t> listener_batch_t;
+    std::vector<listener_batch_t> batches;
+    std::unordered_map<ObjectListener*, size_t> batch_index;
+    TraceContext::clock::time_point origin;
+
+    const std::lock_guard<std::mutex> lock(store->listener_mutex);
+    for (const URIQueue::item* d : items) {
+        if (d->origin != TraceContext::clock::time_point() &&
+            (origin == TraceContext::clock::time_point() ||
+             d->origin < origin))
+            origin = d->origin;
+        class_id_t class_id = boost::any_cast<class_id_t>(d->data);
+        class_map_t::const_iterator cit = store->class_map.find(class_id);
+        if (cit == store->class_map.end()) continue;
+        for (ObjectListener* listener : cit->second.listeners) {
+            if (!accepts(listener)) continue;
+            auto r = batch_index.insert(std::make_pair(listener,
+                                                       batches.size()));
+            if (r.second)
+                batches.push_back(listener_batch_t(listener,
+                                                   ObjectListener
+                                                   ::update_list_t()));
+            batches[r.first->second].second
+                .push_back(std::make_pair(class_id, d->uri));
+        }
+    }
+
+    const TraceContext::Scope trace(origin);
+    for (const listener_batch_t& b : batches) {
+        try {
+            b.first->objectsUpdated(b.second);
+        } catch (const std::exception& ex) {
+            LOG(ERROR) << "Exception while delivering notifications: "
+                       << ex.what();
+        } catch (...) {
+            LOG(ERROR) << "Unknown error delivering notifications";
+        }
     }
 }
 
 const std::string& ObjectStore::NotifQueueProc::taskName() {
-    static const std::string name("modb_notif");
     return name;
 }
 
+void ObjectStore::setNotificationWorkers(size_t workers) {
+    if (workers == 0)
+        throw std::invalid_argument("At least one notification "
+                                    "worker is required");
+    if (started)
+        throw std::logic_error("Cannot change notification workers "
+                               "after the store is started");
+
+    worker_queues.clear();
+    worker_procs.clear();
+    notif_proc.setMode(workers > 1 ? NotifQueueProc::SERIAL
+                                   : NotifQueueProc::ALL);
+    for (size_t i = 1; i < workers; ++i) {
+        worker_procs.emplace_back
+            (new NotifQueueProc(this, "modb_notif_" + std::to_string(i),
+                                NotifQueueProc::PARALLEL));
+        worker_queues.emplace_back
+            (new URIQueue(worker_procs.back().get(), threadManager));
+    }
+}
+
+size_t ObjectStore::getNotificationWorkers() const {
+    return worker_queues.size() + 1;
+}
+
 void ObjectStore::start() {
+    started = true;
     notif_queue.start();
+    for (std::unique_ptr<URIQueue>& q : worker_queues)
+        q->start();
 }
 
 void ObjectStore::stop() {
     notif_queue.stop();
+    for (std::unique_ptr<URIQueue>& q : worker_queues)
+        q->stop();
+    started = false;
 }
 
 Region* ObjectStore::getRegion(const std::string& owner) {
@@ -108,6 +205,27 @@ void ObjectStore::getOwners(/* out */ std::unordered_set<std::string>& output) {
     }
 }
 
+void ObjectStore::addIndex(class_id_t class_id, prop_id_t prop_id) {
+    ClassContext& cc = class_map.at(class_id);
+    const ClassInfo::property_map_t& props = cc.classInfo.getProperties();
+    ClassInfo::property_map_t::const_iterator it = props.find(prop_id);
+    if (it == props.end())
+        throw std::out_of_range("No such property for class");
+    if (it->second.getType() == PropertyInfo::COMPOSITE)
+        throw std::invalid_argument("Cannot index a composite property");
+    cc.region->addIndex(class_id, it->second);
+}
+
+void ObjectStore::getClassStats(/* out */ class_stats_map_t& output) {
+    std::unordered_map<class_id_t, ClassStats> stats;
+    for (const region_owner_map_t::value_type& r : region_owner_map) {
+        r.second->getClassStats(stats);
+    }
+    for (const auto& s : stats) {
+        output[getClassInfo(s.first).getName()] = s.second;
+    }
+}
+
 StoreClient& ObjectStore::getReadOnlyStoreClient() {
     return readOnlyClient;
 }
@@ -141,7 +259,12 @@ void ObjectStore::forEachClass(void (*apply)(void*, const ClassInfo&), void* dat
 void ObjectStore::registerListener(class_id_t class_id,
                                    ObjectListener* listener) {
     const std::lock_guard<std::mutex> lock(listener_mutex);
-    class_map.at(class_id).listeners.push_back(listener);
+    ClassContext& cc = class_map.at(class_id);
+    cc.listeners.push_back(listener);
+    if (listener->isThreadSafe())
+        cc.safeListeners += 1;
+    else
+        cc.unsafeListeners += 1;
 }
 
 void ObjectStore::unregisterListener(class_id_t class_id,
@@ -149,11 +272,190 @@ void ObjectStore::unregisterListener(class_id_t class_id,
     const std::lock_guard<std::mutex> lock(listener_mutex);
     class_map_t::iterator it = class_map.find(class_id);
     if (it == class_map.end()) return;
+    size_t before = it->second.listeners.size();
     it->second.listeners.remove(listener);
+    size_t removed = before - it->second.listeners.size();
+    if (listener->isThreadSafe())
+        it->second.safeListeners -= removed;
+    else
+        it->second.unsafeListeners -= removed;
+}
+
+ObjectStore::CommitGuard::CommitGuard(ObjectStore& store_)
+    : store(store_) {
+    store.beginCommit();
+}
+
+ObjectStore::CommitGuard::~CommitGuard() {
+    store.endCommit();
+}
+
+ObjectStore::SnapshotGuard::SnapshotGuard(ObjectStore& store_)
+    : store(store_), version(store.acquireSnapshot()),
+      previous(store.getThreadSnapshot()) {
+    store.setThreadSnapshot(&version);
+}
+
+ObjectStore::SnapshotGuard::~SnapshotGuard() {
+    store.setThreadSnapshot(previous);
+    store.releaseSnapshot(version);
+}
+
+void ObjectStore::beginCommit() {
+    uintptr_t depth = (uintptr_t)uv_key_get(&commit_key);
+    if (depth == 0) {
+        // a commit waits behind a snapshot being acquired, which
+        // waits for the commits holding region locks
+        if (Region::isReading())
+            throw std::logic_error("Store modified while reading");
+        commit_mutex.lock_shared();
+    }
+    uv_key_set(&commit_key, (void*)(depth + 1));
+}
+
+void ObjectStore::endCommit() {
+    uintptr_t depth = (uintptr_t)uv_key_get(&commit_key) - 1;
+    uv_key_set(&commit_key, (void*)depth);
+    if (depth > 0) return;
+
+    version += 1;
+    commit_mutex.unlock_shared();
+
+    // the history kept for expired snapshots is discarded outside
+    // the commit, since that takes every region lock in turn
+    if (prune_pending.exchange(false))
+        pruneHistory(expired_below);
+}
+
+uint64_t ObjectStore::getVersion() const {
+    return version;
+}
+
+void ObjectStore::setSnapshotHistoryLimit(size_t limit) {
+    history_limit = limit;
+}
+
+bool ObjectStore::reserveHistory() {
+    if (history_size < history_limit) {
+        history_size += 1;
+        return true;
+    }
+
+    // every snapshot held now is older than the open commit
+    uint64_t v = getCommitVersion();
+    if (expired_below < v) {
+        LOG(WARNING) << "Snapshot history exceeded " << history_limit
+                     << " values; expiring snapshots before version " << v;
+        expired_below = v;
+        prune_pending = true;
+    }
+    return false;
+}
+
+void ObjectStore::pruneHistory(uint64_t v) {
+    for (const region_owner_map_t::value_type& r : region_owner_map)
+        history_size -= r.second->pruneHistory(v);
+}
+
+uint64_t ObjectStore::acquireSnapshot() {
+    if (Region::isReading())
+        throw std::logic_error("Snapshot acquired while reading");
+    // waits for any commit in progress so the snapshot never sees a
+    // partial commit
+    const boost::unique_lock<boost::shared_mutex> lock(commit_mutex);
+    uint64_t v = version;
+    snapshots.insert(v);
+    return v;
+}
+
+void ObjectStore::releaseSnapshot(uint64_t v) {
+    uint64_t oldest;
+    {
+        const boost::unique_lock<boost::shared_mutex> lock(commit_mutex);
+        std::multiset<uint64_t>::iterator it = snapshots.find(v);
+        if (it == snapshots.end()) return;
+        snapshots.erase(it);
+        if (!snapshots.empty() && *snapshots.begin() <= v)
+            return;
+        // a snapshot acquired after the lock is released is at the
+        // current version, so it needs none of the history up to it
+        oldest = snapshots.empty() ? version.load() : *snapshots.begin();
+    }
+    pruneHistory(oldest);
+}
+
+void ObjectStore::setThreadSnapshot(const uint64_t* v) {
+    uv_key_set(&snapshot_key, (void*)v);
+}
+
+const uint64_t* ObjectStore::getThreadSnapshot() {
+    return (const uint64_t*)uv_key_get(&snapshot_key);
 }
 
 void ObjectStore::queueNotification(class_id_t class_id, const URI& uri) {
-    notif_queue.queueItem(uri, class_id);
+    if (worker_queues.empty()) {
+        notif_queue.queueItem(uri, class_id);
+        return;
+    }
+
+    // route to the serial queue and to the URI's partition only when
+    // the class has listeners for them
+    class_map_t::const_iterator it = class_map.find(class_id);
+    if (it == class_map.end()) return;
+    if (it->second.unsafeListeners > 0)
+        notif_queue.queueItem(uri, class_id);
+    if (it->second.safeListeners > 0) {
+        size_t worker = std::hash<URI>()(uri) % worker_queues.size();
+        worker_queues[worker]->queueItem(uri, class_id);
+    }
+}
+
+void ObjectStore::setJournalSize(size_t size) {
+    const std::lock_guard<std::mutex> guard(journal_mutex);
+    if (size == journal_size) return;
+    journal.clear();
+    journal.shrink_to_fit();
+    journal.reserve(size);
+    journal_size = size;
+    journal_head = 0;
+}
+
+size_t ObjectStore::getJournalSize() {
+    const std::lock_guard<std::mutex> guard(journal_mutex);
+    return journal_size;
+}
+
+uint64_t ObjectStore::getJournalSeq() {
+    const std::lock_guard<std::mutex> guard(journal_mutex);
+    return journal_seq;
+}
+
+void ObjectStore::recordChange(class_id_t class_id, const URI& uri,
+                               Change::op_t op) {
+    const std::lock_guard<std::mutex> guard(journal_mutex);
+    if (journal_size == 0) return;
+    Change change = { ++journal_seq, class_id, uri, op };
+    if (journal.size() < journal_size) {
+        journal.push_back(change);
+    } else {
+        journal[journal_head] = change;
+        journal_head = (journal_head + 1) % journal_size;
+    }
+}
+
+bool ObjectStore::getChangesSince(uint64_t seq,
+                                  /* out */ std::vector<Change>& output) {
+    const std::lock_guard<std::mutex> guard(journal_mutex);
+    if (seq == journal_seq) return true;
+    if (seq > journal_seq || journal_seq - seq > journal.size())
+        return false;
+
+    size_t count = journal_seq - seq;
+    size_t start = journal_head + journal.size() - count;
+    output.reserve(output.size() + count);
+    for (size_t i = 0; i < count; ++i)
+        output.push_back(journal[(start + i) % journal.size()]);
+    return true;
 }
 
 } /* namespace modb */
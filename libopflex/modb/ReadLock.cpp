@@ -0,0 +1,55 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for ReadLock class.
+ *
+ * Copyright (c) 2014 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <algorithm>
+#include <vector>
+
+#include "opflex/ofcore/OFFramework.h"
+#include "opflex/modb/ReadLock.h"
+#include "opflex/modb/internal/ObjectStore.h"
+
+namespace opflex {
+namespace modb {
+
+class ReadLock::ReadLockImpl {
+public:
+    // the locked regions, in the order they were locked
+    std::vector<Region*> regions;
+};
+
+ReadLock::ReadLock(ofcore::OFFramework& framework)
+    : pimpl(new ReadLockImpl()) {
+    ObjectStore& store = framework.getStore();
+    std::unordered_set<std::string> owners;
+    store.getOwners(owners);
+    for (const std::string& owner : owners)
+        pimpl->regions.push_back(store.getRegion(owner));
+
+    // lock in a fixed order so that two read locks waiting behind
+    // writers cannot deadlock
+    std::sort(pimpl->regions.begin(), pimpl->regions.end());
+    for (Region* r : pimpl->regions)
+        r->beginRead();
+}
+
+ReadLock::~ReadLock() {
+    for (auto it = pimpl->regions.rbegin(); it != pimpl->regions.rend(); ++it)
+        (*it)->endRead();
+    delete pimpl;
+}
+
+} /* namespace modb */
+} /* namespace opflex */
@@ -14,6 +14,8 @@
 #  include <config.h>
 #endif
 
+#include <stdexcept>
+
 #include "opflex/modb/internal/Region.h"
 #include "opflex/modb/internal/ObjectStore.h"
 
@@ -26,30 +28,118 @@ using std::pair;
 using std::make_pair;
 using mointernal::ObjectInstance;
 
+namespace {
+
+/**
+ * The number of regions the thread holds a read lock on
+ */
+thread_local size_t regionsRead = 0;
+
+/**
+ * Take the region lock shared.  The lock is only taken by the
+ * outermost reader on a thread, since a nested read lock would
+ * deadlock against a waiting writer.
+ */
+void lockRead(pthread_rwlock_t& lock, uv_key_t& depth) {
+    uintptr_t d = (uintptr_t)uv_key_get(&depth);
+    if (d == 0) {
+        pthread_rwlock_rdlock(&lock);
+        regionsRead += 1;
+    }
+    uv_key_set(&depth, (void*)(d + 1));
+}
+
+void unlockRead(pthread_rwlock_t& lock, uv_key_t& depth) {
+    uintptr_t d = (uintptr_t)uv_key_get(&depth) - 1;
+    uv_key_set(&depth, (void*)d);
+    if (d == 0) {
+        regionsRead -= 1;
+        pthread_rwlock_unlock(&lock);
+    }
+}
+
+/**
+ * Hold the region lock shared for the lifetime of the object
+ */
+class ReadGuard {
+public:
+    ReadGuard(pthread_rwlock_t& lock_, uv_key_t& depth_)
+        : lock(lock_), depth(depth_) {
+        lockRead(lock, depth);
+    }
+    ~ReadGuard() {
+        unlockRead(lock, depth);
+    }
+private:
+    pthread_rwlock_t& lock;
+    uv_key_t& depth;
+};
+
+/**
+ * Hold the region lock exclusively for the lifetime of the object
+ */
+class WriteGuard {
+public:
+    WriteGuard(pthread_rwlock_t& lock_, uv_key_t& depth)
+        : lock(lock_) {
+        if (uv_key_get(&depth) != NULL)
+            throw std::logic_error("Region modified while reading");
+        pthread_rwlock_wrlock(&lock);
+    }
+    ~WriteGuard() { pthread_rwlock_unlock(&lock); }
+private:
+    pthread_rwlock_t& lock;
+};
+
+} /* anonymous namespace */
+
 Region::Region(ObjectStore* parent, const string& owner_)
-    : client(parent, this), owner(owner_) {
+    : client(parent, this), store(parent), owner(owner_) {
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+#ifdef __GLIBC__
+    pthread_rwlockattr_setkind_np(&attr,
+                                  PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+    pthread_rwlock_init(&region_lock, &attr);
+    pthread_rwlockattr_destroy(&attr);
+    uv_key_create(&read_depth);
 }
 
 Region::~Region() {
+    uv_key_delete(&read_depth);
+    pthread_rwlock_destroy(&region_lock);
 }
 
 void Region::addClass(const ClassInfo& class_info) {
     class_map[class_info.getId()];
 }
 
+bool Region::isReading() {
+    return regionsRead > 0;
+}
+
+void Region::beginRead() {
+    lockRead(region_lock, read_depth);
+}
+
+void Region::endRead() {
+    unlockRead(region_lock, read_depth);
+}
+
 bool Region::isPresent(const URI& uri) {
-    const std::lock_guard<std::mutex> lock(region_mutex);
+    const ReadGuard guard(region_lock, read_depth);
     return uri_map.find(uri) != uri_map.end();
 }
 
 std::shared_ptr<const ObjectInstance> Region::get(const URI& uri) {
-    const std::lock_guard<std::mutex> lock(region_mutex);
+    const ReadGuard guard(region_lock, read_depth);
     return uri_map.at(uri);
 }
 
 bool Region::get(const URI& uri,
                  /*out*/ std::shared_ptr<const ObjectInstance>& oi) {
-    const std::lock_guard<std::mutex> lock(region_mutex);
+    const ReadGuard guard(region_lock, read_depth);
     uri_map_t::const_iterator itr = uri_map.find(uri);
     if (itr != uri_map.end()) {
         oi = itr->second;
@@ -58,12 +148,72 @@ bool Region::get(const URI& uri,
     return false;
 }
 
+bool Region::get(const URI& uri, uint64_t version,
+                 /*out*/ std::shared_ptr<const ObjectInstance>& oi) {
+    const ReadGuard guard(region_lock, read_depth);
+    history_map_t::const_iterator hit = history.find(uri);
+    if (hit != history.end() && !store->isSnapshotExpired(version)) {
+        for (const history_t::value_type& h : hit->second) {
+            if (h.first > version) {
+                if (!h.second) return false;
+                oi = h.second;
+                return true;
+            }
+        }
+    }
+    uri_map_t::const_iterator itr = uri_map.find(uri);
+    if (itr != uri_map.end()) {
+        oi = itr->second;
+        return true;
+    }
+    return false;
+}
+
+void Region::recordHistory(const URI& uri) {
+    if (!store->hasSnapshots()) return;
+    uint64_t v = store->getCommitVersion();
+    history_t& h = history[uri];
+    // only the value from before the commit is visible to snapshots
+    if (!h.empty() && h.back().first == v) return;
+    if (!store->reserveHistory()) {
+        if (h.empty()) history.erase(uri);
+        return;
+    }
+
+    uri_map_t::const_iterator itr = uri_map.find(uri);
+    h.push_back(std::make_pair(v, itr != uri_map.end()
+                               ? itr->second
+                               : std::shared_ptr<const ObjectInstance>()));
+}
+
+size_t Region::pruneHistory(uint64_t version) {
+    const WriteGuard guard(region_lock, read_depth);
+    size_t pruned = 0;
+    history_map_t::iterator it = history.begin();
+    while (it != history.end()) {
+        history_t& h = it->second;
+        history_t::iterator hit = h.begin();
+        while (hit != h.end() && hit->first <= version)
+            ++hit;
+        pruned += hit - h.begin();
+        h.erase(h.begin(), hit);
+        if (h.empty())
+            it = history.erase(it);
+        else
+            ++it;
+    }
+    return pruned;
+}
+
 void Region::put(class_id_t class_id, const URI& uri,
                  const std::shared_ptr<const ObjectInstance>& oi) {
-    const std::lock_guard<std::mutex> lock(region_mutex);
+    const WriteGuard guard(region_lock, read_depth);
     try {
         ClassIndex& ci = class_map.at(class_id);
-        uri_map[uri] = oi;
+        recordHistory(uri);
+        std::shared_ptr<const ObjectInstance>& cur = uri_map[uri];
+        ci.updateIndexes(uri, cur.get(), oi.get());
+        cur = oi;
         ci.addInstance(uri);
         if (!ci.hasParent(uri)) roots.insert(make_pair(class_id, uri));
     } catch (const std::out_of_range& e) {
@@ -73,18 +223,22 @@ void Region::put(class_id_t class_id, const URI& uri,
 
 bool Region::putIfModified(class_id_t class_id, const URI& uri,
                            const std::shared_ptr<const ObjectInstance>& oi) {
-    const std::lock_guard<std::mutex> lock(region_mutex);
+    const WriteGuard guard(region_lock, read_depth);
     try {
         ClassIndex& ci = class_map.at(class_id);
         uri_map_t::iterator it = uri_map.find(uri);
         bool result = true;
         if (it != uri_map.end()) {
             if (*oi != *it->second) {
+                recordHistory(uri);
+                ci.updateIndexes(uri, it->second.get(), oi.get());
                 it->second = oi;
             } else {
                 result = false;
             }
         } else {
+            recordHistory(uri);
+            ci.updateIndexes(uri, NULL, oi.get());
             uri_map[uri] = oi;
             ci.addInstance(uri);
         }
@@ -97,11 +251,35 @@ bool Region::putIfModified(class_id_t class_id, const URI& uri,
 }
 
 bool Region::remove(class_id_t class_id, const URI& uri) {
-    const std::lock_guard<std::mutex> lock(region_mutex);
+    const WriteGuard guard(region_lock, read_depth);
     ClassIndex& ci = class_map.at(class_id);
     ci.delInstance(uri);
     roots.erase(make_pair(class_id, uri));
-    return (0 != uri_map.erase(uri));
+    uri_map_t::iterator it = uri_map.find(uri);
+    if (it == uri_map.end()) return false;
+    recordHistory(uri);
+    ci.updateIndexes(uri, it->second.get(), NULL);
+    uri_map.erase(it);
+    return true;
+}
+
+void Region::removeAll(const std::vector<reference_t>& objects,
+                       /* out */ std::vector<reference_t>& removed) {
+    const WriteGuard guard(region_lock, read_depth);
+    std::pair<URI, prop_id_t> parent(URI::ROOT, 0);
+    for (const reference_t& obj : objects) {
+        ClassIndex& ci = class_map.at(obj.first);
+        if (ci.getParent(obj.second, parent))
+            ci.delChild(parent.first, parent.second, obj.second);
+        ci.delInstance(obj.second);
+        roots.erase(obj);
+        uri_map_t::iterator it = uri_map.find(obj.second);
+        if (it == uri_map.end()) continue;
+        recordHistory(obj.second);
+        ci.updateIndexes(obj.second, it->second.get(), NULL);
+        uri_map.erase(it);
+        removed.push_back(obj);
+    }
 }
 
 bool Region::addChild(class_id_t parent_class,
@@ -109,7 +287,7 @@ bool Region::addChild(class_id_t parent_class,
                       prop_id_t parent_prop,
                       class_id_t child_class,
                       const URI& child_uri) {
-    const std::lock_guard<std::mutex> lock(region_mutex);
+    const WriteGuard guard(region_lock, read_depth);
     obj_set_t::iterator it = roots.find(make_pair(child_class, child_uri));
     if (it != roots.end())
         roots.erase(it);
@@ -122,7 +300,7 @@ bool Region::delChild(class_id_t parent_class,
                       prop_id_t parent_prop,
                       class_id_t child_class,
                       const URI& child_uri) {
-    const std::lock_guard<std::mutex> lock(region_mutex);
+    const WriteGuard guard(region_lock, read_depth);
     ClassIndex& ci = class_map.at(child_class);
     bool r = ci.delChild(parent_uri, parent_prop, child_uri);
     if (uri_map.find(child_uri) != uri_map.end() && !ci.hasParent(child_uri))
@@ -135,37 +313,98 @@ void Region::getChildren(class_id_t parent_class,
                          prop_id_t parent_prop,
                          class_id_t child_class,
                          /* out */ vector<URI>& output) {
-    const std::lock_guard<std::mutex> lock(region_mutex);
-    ClassIndex& ci = class_map.at(child_class);
+    const ReadGuard guard(region_lock, read_depth);
+    const ClassIndex& ci = class_map.at(child_class);
     ci.getChildren(parent_uri, parent_prop, output);
 }
 
+bool Region::forEachChild(class_id_t parent_class,
+                          const URI& parent_uri,
+                          prop_id_t parent_prop,
+                          class_id_t child_class,
+                          const uri_visitor_t& visitor) {
+    const ReadGuard guard(region_lock, read_depth);
+    const ClassIndex& ci = class_map.at(child_class);
+    return ci.forEachChild(parent_uri, parent_prop, visitor);
+}
+
 std::pair<URI, prop_id_t> Region::getParent(class_id_t child_class,
                                             const URI& child) {
-    const std::lock_guard<std::mutex> lock(region_mutex);
-    ClassIndex& ci = class_map.at(child_class);
+    const ReadGuard guard(region_lock, read_depth);
+    const ClassIndex& ci = class_map.at(child_class);
     return ci.getParent(child);
 }
 
 bool Region::getParent(class_id_t child_class, const URI& child,
                        /* out */ std::pair<URI, prop_id_t>& parent) {
-    const std::lock_guard<std::mutex> lock(region_mutex);
+    const ReadGuard guard(region_lock, read_depth);
     class_map_t::const_iterator citr = class_map.find(child_class);
     return citr != class_map.end() ? citr->second.getParent(child, parent)
                                    : false;
 }
 
 void Region::getRoots(/* out */ obj_set_t& output) {
-    const std::lock_guard<std::mutex> lock(region_mutex);
+    const ReadGuard guard(region_lock, read_depth);
     output.insert(roots.begin(), roots.end());
 }
 
 void Region::getObjectsForClass(class_id_t class_id,
                                 /* out */ std::unordered_set<URI>& output) {
-    const std::lock_guard<std::mutex> lock(region_mutex);
-    ClassIndex& ci = class_map.at(class_id);
+    const ReadGuard guard(region_lock, read_depth);
+    const ClassIndex& ci = class_map.at(class_id);
     ci.getAll(output);
 }
 
+bool Region::forEachObjectOfClass(class_id_t class_id,
+                                  const uri_visitor_t& visitor) {
+    const ReadGuard guard(region_lock, read_depth);
+    const ClassIndex& ci = class_map.at(class_id);
+    return ci.forEachInstance(visitor);
+}
+
+bool Region::addIndex(class_id_t class_id, const PropertyInfo& prop) {
+    const WriteGuard guard(region_lock, read_depth);
+    ClassIndex& ci = class_map.at(class_id);
+    if (!ci.addIndex(prop)) return false;
+
+    std::unordered_set<URI> uris;
+    ci.getAll(uris);
+    for (const URI& uri : uris) {
+        uri_map_t::const_iterator it = uri_map.find(uri);
+        if (it != uri_map.end())
+            ci.updateIndexes(uri, NULL, it->second.get());
+    }
+    return true;
+}
+
+void Region::getClassStats(/* out */ std::unordered_map<class_id_t,
+                                                       ClassStats>& output) {
+    const ReadGuard guard(region_lock, read_depth);
+    std::unordered_set<URI> uris;
+    for (const class_map_t::value_type& c : class_map) {
+        ClassStats& stats = output[c.first];
+        uris.clear();
+        c.second.getAll(uris);
+        stats.indexBytes += c.second.getMemoryUsage();
+        for (const URI& uri : uris) {
+            uri_map_t::const_iterator it = uri_map.find(uri);
+            if (it == uri_map.end()) continue;
+            stats.instances += 1;
+            stats.uriBytes += uri.getMemoryUsage();
+            // the object map entry and its shared pointer
+            stats.propBytes += sizeof(uri_map_t::value_type) +
+                3 * sizeof(void*) + it->second->getMemoryUsage();
+        }
+    }
+}
+
+void Region::findByProperty(class_id_t class_id, prop_id_t prop_id,
+                            const std::string& key,
+                            /* out */ std::unordered_set<URI>& output) {
+    const ReadGuard guard(region_lock, read_depth);
+    const ClassIndex& ci = class_map.at(class_id);
+    ci.findByProperty(prop_id, key, output);
+}
+
 } /* namespace modb */
 } /* namespace opflex */
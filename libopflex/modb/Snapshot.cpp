@@ -0,0 +1,55 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for Snapshot class.
+ *
+ * Copyright (c) 2014 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "opflex/ofcore/OFFramework.h"
+#include "opflex/modb/Snapshot.h"
+#include "opflex/modb/internal/ObjectStore.h"
+
+namespace opflex {
+namespace modb {
+
+class Snapshot::SnapshotImpl {
+public:
+    SnapshotImpl(ObjectStore& store_)
+        : store(store_), version(store.acquireSnapshot()),
+          previous(store.getThreadSnapshot()) { }
+
+    ObjectStore& store;
+
+    // the version this snapshot reads at
+    uint64_t version;
+
+    // the snapshot that was registered on this thread before this one
+    const uint64_t* previous;
+};
+
+Snapshot::Snapshot(ofcore::OFFramework& framework)
+    : pimpl(new SnapshotImpl(framework.getStore())) {
+    pimpl->store.setThreadSnapshot(&pimpl->version);
+}
+
+Snapshot::~Snapshot() {
+    pimpl->store.setThreadSnapshot(pimpl->previous);
+    pimpl->store.releaseSnapshot(pimpl->version);
+    delete pimpl;
+}
+
+uint64_t Snapshot::getVersion() const {
+    return pimpl->version;
+}
+
+} /* namespace modb */
+} /* namespace opflex */
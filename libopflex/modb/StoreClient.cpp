@@ -15,6 +15,10 @@
 #endif
 
 
+#include <algorithm>
+#include <map>
+#include <vector>
+
 #include "opflex/modb/internal/ObjectStore.h"
 
 namespace opflex {
@@ -67,24 +71,41 @@ void StoreClient::put(class_id_t class_id,
                       const URI& uri,
                       const std::shared_ptr<const ObjectInstance>& oi) {
     Region* r = checkOwner(store, readOnly, region, class_id);
+    const ObjectStore::CommitGuard commit(*store);
     r->put(class_id, uri, oi);
+    store->recordChange(class_id, uri, ObjectStore::Change::UPDATED);
 }
 
 bool StoreClient::putIfModified(class_id_t class_id,
                                 const URI& uri,
                                 const std::shared_ptr<const ObjectInstance>& oi) {
     Region* r = checkOwner(store, readOnly, region, class_id);
-    return r->putIfModified(class_id, uri, oi);
+    const ObjectStore::CommitGuard commit(*store);
+    if (!r->putIfModified(class_id, uri, oi)) return false;
+    store->recordChange(class_id, uri, ObjectStore::Change::UPDATED);
+    return true;
 }
 
 bool StoreClient::isPresent(class_id_t class_id, const URI& uri) const {
     Region* r = store->getRegion(class_id);
+    const uint64_t* snapshot = store->getThreadSnapshot();
+    if (snapshot) {
+        std::shared_ptr<const ObjectInstance> oi;
+        return r->get(uri, *snapshot, oi);
+    }
     return r->isPresent(uri);
 }
 
 std::shared_ptr<const ObjectInstance> StoreClient::get(class_id_t class_id,
                                                      const URI& uri) const {
     Region* r = store->getRegion(class_id);
+    const uint64_t* snapshot = store->getThreadSnapshot();
+    if (snapshot) {
+        std::shared_ptr<const ObjectInstance> oi;
+        if (!r->get(uri, *snapshot, oi))
+            throw std::out_of_range("No object in snapshot");
+        return oi;
+    }
     return r->get(uri);
 }
 
@@ -96,40 +117,108 @@ bool StoreClient::get(class_id_t class_id, const URI& uri,
     } catch (const std::out_of_range&) {
         return false;
     }
+    const uint64_t* snapshot = store->getThreadSnapshot();
+    if (snapshot)
+        return r->get(uri, *snapshot, oi);
     return r->get(uri, oi);
 }
 
+void StoreClient::getAll(const std::vector<reference_t>& refs,
+                         /*out*/ std::vector<std::shared_ptr<const ObjectInstance> >& out) const {
+    out.clear();
+    out.resize(refs.size());
+
+    std::map<Region*, std::vector<size_t> > batches;
+    for (size_t i = 0; i < refs.size(); ++i) {
+        try {
+            batches[store->getRegion(refs[i].first)].push_back(i);
+        } catch (const std::out_of_range&) {
+            // leave the entry null
+        }
+    }
+
+    const uint64_t* snapshot = store->getThreadSnapshot();
+    for (auto& batch : batches) {
+        Region* r = batch.first;
+        r->beginRead();
+        try {
+            for (size_t i : batch.second) {
+                if (snapshot)
+                    r->get(refs[i].second, *snapshot, out[i]);
+                else
+                    r->get(refs[i].second, out[i]);
+            }
+        } catch (...) {
+            r->endRead();
+            throw;
+        }
+        r->endRead();
+    }
+}
+
 void StoreClient::removeChildren(class_id_t class_id, const URI& uri,
                                  notif_t* notifs) {
-    const ClassInfo& ci = store->getClassInfo(class_id);
-    const ClassInfo::property_map_t& pmap = ci.getProperties();
-    ClassInfo::property_map_t::const_iterator it;
-    for (it = pmap.begin(); it != pmap.end(); ++it) {
-        if (it->second.getType() == PropertyInfo::COMPOSITE) {
-            class_id_t prop_class = it->second.getClassId();
-            prop_id_t prop_id = it->second.getId();
-            std::vector<URI> children;
-            getChildren(class_id, uri, prop_id, prop_class, children);
-            std::vector<URI>::iterator cit;
-            for (cit = children.begin(); cit != children.end(); ++cit) {
-                // unlink the parent/child
-                delChild(class_id, uri, prop_id, prop_class, *cit);
-                // remove the child object
-                remove(prop_class, *cit, true, notifs);
-                if (notifs)
-                    (*notifs)[*cit] = prop_class;
-            }
+    // collect the subtree breadth-first, grouping the descendants by
+    // the region that holds them.  Each region is locked separately
+    // while its children are collected, so the walk is not a
+    // consistent view across regions.
+    std::vector<reference_t> pending;
+    std::map<Region*, std::vector<reference_t> > batches;
+    pending.push_back(std::make_pair(class_id, uri));
+    for (size_t i = 0; i < pending.size(); ++i) {
+        const reference_t parent = pending[i];
+        const ClassInfo& ci = store->getClassInfo(parent.first);
+        for (const ClassInfo::property_map_t::value_type& p :
+                 ci.getProperties()) {
+            if (p.second.getType() != PropertyInfo::COMPOSITE)
+                continue;
+            class_id_t prop_class = p.second.getClassId();
+            Region* r = store->getRegion(prop_class);
+            std::vector<reference_t>& batch = batches[r];
+            r->forEachChild(parent.first, parent.second, p.second.getId(),
+                            prop_class,
+                            [&](const URI& child) {
+                                pending.push_back(std::make_pair(prop_class,
+                                                                 child));
+                                batch.push_back(pending.back());
+                                return true;
+                            });
+        }
+    }
+    if (pending.size() == 1) return;
+
+    std::map<Region*, std::vector<reference_t> >::iterator bit;
+    for (bit = batches.begin(); bit != batches.end(); ) {
+        if (bit->second.empty()) {
+            bit = batches.erase(bit);
+        } else {
+            checkOwner(store, readOnly, region, bit->second.front().first);
+            ++bit;
         }
     }
+
+    const ObjectStore::CommitGuard commit(*store);
+    std::vector<reference_t> removed;
+    for (bit = batches.begin(); bit != batches.end(); ++bit)
+        bit->first->removeAll(bit->second, removed);
+    for (const reference_t& obj : removed)
+        store->recordChange(obj.first, obj.second,
+                            ObjectStore::Change::REMOVED);
+    if (notifs) {
+        for (size_t i = 1; i < pending.size(); ++i)
+            (*notifs)[pending[i].second] = pending[i].first;
+    }
 }
 
 bool StoreClient::remove(class_id_t class_id, const URI& uri,
                          bool recursive, notif_t* notifs) {
     Region* r = checkOwner(store, readOnly, region, class_id);
+    const ObjectStore::CommitGuard commit(*store);
 
     // Remove the object itself
     bool result = r->remove(class_id, uri);
     if (!result) return result;
+    store->recordChange(class_id, uri, ObjectStore::Change::REMOVED);
 
     // remove the parent link
     try {
@@ -173,8 +262,13 @@ bool StoreClient::addChild(class_id_t parent_class,
     // add relationship to child's region.  Note that
     // it's OK if the child URI doesn't exist
     Region* r = checkOwner(store, readOnly, region, child_class);
-    return r->addChild(parent_class, parent_uri, parent_prop,
-                       child_class, child_uri);
+    const ObjectStore::CommitGuard commit(*store);
+    bool added = r->addChild(parent_class, parent_uri, parent_prop,
+                             child_class, child_uri);
+    if (added)
+        store->recordChange(parent_class, parent_uri,
+                            ObjectStore::Change::UPDATED);
+    return added;
 }
 
 void StoreClient::delChild(class_id_t parent_class,
@@ -183,8 +277,11 @@ void StoreClient::delChild(class_id_t parent_class,
                            class_id_t child_class,
                            const URI& child_uri) {
     Region* r = checkOwner(store, readOnly, region, child_class);
-    r->delChild(parent_class, parent_uri, parent_prop,
-                child_class, child_uri);
+    const ObjectStore::CommitGuard commit(*store);
+    if (r->delChild(parent_class, parent_uri, parent_prop,
+                    child_class, child_uri))
+        store->recordChange(parent_class, parent_uri,
+                            ObjectStore::Change::UPDATED);
 }
 
 void StoreClient::getChildren(class_id_t parent_class,
@@ -195,6 +292,37 @@ void StoreClient::getChildren(class_id_t parent_class,
     Region* r = store->getRegion(child_class);
     r->getChildren(parent_class, parent_uri, parent_prop,
                    child_class, output);
+    const uint64_t* snapshot = store->getThreadSnapshot();
+    if (snapshot) {
+        std::shared_ptr<const ObjectInstance> oi;
+        output.erase(std::remove_if(output.begin(), output.end(),
+                                    [&](const URI& uri) {
+                                        return !r->get(uri, *snapshot, oi);
+                                    }), output.end());
+    }
+}
+
+// the indexes are not versioned, so a visitor on a thread reading a
+// snapshot skips the objects that are not present in it
+static uri_visitor_t snapshotVisitor(Region* r, const uint64_t* snapshot,
+                                     const uri_visitor_t& visitor) {
+    if (!snapshot) return visitor;
+    return [r, snapshot, &visitor](const URI& uri) {
+        std::shared_ptr<const ObjectInstance> oi;
+        return !r->get(uri, *snapshot, oi) || visitor(uri);
+    };
+}
+
+bool StoreClient::forEachChild(class_id_t parent_class,
+                               const URI& parent_uri,
+                               prop_id_t parent_prop,
+                               class_id_t child_class,
+                               const uri_visitor_t& visitor) {
+    Region* r = store->getRegion(child_class);
+    return r->forEachChild(parent_class, parent_uri, parent_prop,
+                           child_class,
+                           snapshotVisitor(r, store->getThreadSnapshot(),
+                                           visitor));
 }
 
 bool StoreClient::getParent(class_id_t child_class, const URI& child,
@@ -211,7 +339,54 @@ bool StoreClient::getParent(class_id_t child_class, const URI& child,
 void StoreClient::getObjectsForClass(class_id_t class_id,
                                      /* out */ std::unordered_set<URI>& output) {
     Region* r = store->getRegion(class_id);
-    return r->getObjectsForClass(class_id, output);
+    r->getObjectsForClass(class_id, output);
+    const uint64_t* snapshot = store->getThreadSnapshot();
+    if (snapshot) {
+        std::shared_ptr<const ObjectInstance> oi;
+        for (auto it = output.begin(); it != output.end(); ) {
+            if (r->get(*it, *snapshot, oi))
+                ++it;
+            else
+                it = output.erase(it);
+        }
+    }
+}
+
+bool StoreClient::forEachObjectOfClass(class_id_t class_id,
+                                       const uri_visitor_t& visitor) {
+    Region* r = store->getRegion(class_id);
+    return r->forEachObjectOfClass(class_id,
+                                   snapshotVisitor(r,
+                                                   store->getThreadSnapshot(),
+                                                   visitor));
+}
+
+void StoreClient::findByProperty(class_id_t class_id, prop_id_t prop_id,
+                                 uint64_t value,
+                                 /* out */ std::unordered_set<URI>& output) {
+    Region* r = store->getRegion(class_id);
+    r->findByProperty(class_id, prop_id, ClassIndex::indexKey(value), output);
+}
+
+void StoreClient::findByProperty(class_id_t class_id, prop_id_t prop_id,
+                                 const std::string& value,
+                                 /* out */ std::unordered_set<URI>& output) {
+    Region* r = store->getRegion(class_id);
+    r->findByProperty(class_id, prop_id, ClassIndex::indexKey(value), output);
+}
+
+void StoreClient::findByProperty(class_id_t class_id, prop_id_t prop_id,
+                                 const MAC& value,
+                                 /* out */ std::unordered_set<URI>& output) {
+    Region* r = store->getRegion(class_id);
+    r->findByProperty(class_id, prop_id, ClassIndex::indexKey(value), output);
+}
+
+void StoreClient::findByProperty(class_id_t class_id, prop_id_t prop_id,
+                                 const reference_t& value,
+                                 /* out */ std::unordered_set<URI>& output) {
+    Region* r = store->getRegion(class_id);
+    r->findByProperty(class_id, prop_id, ClassIndex::indexKey(value), output);
 }
 
 } /* namespace mointernal */
@@ -0,0 +1,690 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for StoreImage class.
+ *
+ * Copyright (c) 2014 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <cstddef>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "opflex/modb/internal/StoreImage.h"
+#include "opflex/logging/internal/logging.hpp"
+
+namespace opflex {
+namespace modb {
+
+using std::string;
+using std::vector;
+using mointernal::ObjectInstance;
+using mointernal::StoreClient;
+
+const uint32_t StoreImage::VERSION = 1;
+
+namespace {
+
+const char IMAGE_MAGIC[8] = {'O', 'F', 'M', 'O', 'D', 'B', 'I', 'M'};
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+const uint32_t NO_INDEX = 0xffffffff;
+const uint32_t FLAG_LOCAL = 0x1;
+
+/*
+ * On-disk layout.  Every section is an array of fixed-size records
+ * aligned to 8 bytes so that it can be used in place from a mapping.
+ */
+struct ImageHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t fileSize;
+    uint32_t nStrings;
+    uint32_t nClasses;
+    uint32_t nObjects;
+    uint32_t nProps;
+    uint64_t nValues;
+    uint64_t stringOffset;
+    uint64_t classOffset;
+    uint64_t objectOffset;
+    uint64_t propOffset;
+    uint64_t valueOffset;
+    uint64_t stringDataOffset;
+};
+
+struct ClassRecord {
+    uint64_t classId;
+    uint32_t nObjects;
+    uint32_t firstObject;
+};
+
+struct ObjectRecord {
+    uint32_t uri;
+    uint32_t parentUri;
+    uint64_t parentProp;
+    uint32_t flags;
+    uint32_t firstProp;
+    uint32_t nProps;
+    uint32_t reserved;
+};
+
+/*
+ * A scalar property stores its value inline.  A vector property
+ * stores the index of its first element in the value pool.  Strings
+ * are string table indexes, references pack the class ID in the high
+ * 32 bits and the URI string index in the low 32 bits, and MAC
+ * addresses are packed into the low 48 bits.
+ */
+struct PropRecord {
+    uint64_t propId;
+    uint8_t type;
+    uint8_t cardinality;
+    uint16_t reserved;
+    uint32_t count;
+    uint64_t value;
+};
+
+struct StringRecord {
+    uint32_t length;
+    char data[4];
+};
+
+PropertyInfo::property_type_t storageType(PropertyInfo::property_type_t t) {
+    switch (t) {
+    case PropertyInfo::ENUM8:
+    case PropertyInfo::ENUM16:
+    case PropertyInfo::ENUM32:
+    case PropertyInfo::ENUM64:
+        return PropertyInfo::U64;
+    default:
+        return t;
+    }
+}
+
+uint64_t packMAC(const MAC& mac) {
+    uint8_t bytes[6];
+    mac.toUIntArray(bytes);
+    uint64_t v = 0;
+    for (int i = 0; i < 6; ++i)
+        v = (v << 8) | bytes[i];
+    return v;
+}
+
+MAC unpackMAC(uint64_t v) {
+    uint8_t bytes[6];
+    for (int i = 5; i >= 0; --i) {
+        bytes[i] = v & 0xff;
+        v >>= 8;
+    }
+    return MAC(bytes);
+}
+
+size_t align8(size_t v) {
+    return (v + 7) & ~((size_t)7);
+}
+
+class ImageWriter {
+public:
+    uint32_t intern(const string& str) {
+        std::pair<std::unordered_map<string, uint32_t>::iterator, bool> r =
+            stringIds.insert(std::make_pair(str, (uint32_t)strings.size()));
+        if (r.second)
+            strings.push_back(&r.first->first);
+        return r.first->second;
+    }
+
+    uint64_t reference(const reference_t& ref) {
+        return ((uint64_t)ref.first << 32) | intern(ref.second.toString());
+    }
+
+    void addProp(const ObjectInstance& oi, const PropertyInfo& pinfo) {
+        PropertyInfo::property_type_t type = storageType(pinfo.getType());
+        PropertyInfo::cardinality_t card = pinfo.getCardinality();
+        if (type == PropertyInfo::COMPOSITE) return;
+        if (!oi.isSet(pinfo.getId(), type, card)) return;
+
+        PropRecord p;
+        memset(&p, 0, sizeof(p));
+        p.propId = pinfo.getId();
+        p.type = type;
+        p.cardinality = card;
+
+        prop_id_t id = pinfo.getId();
+        if (card == PropertyInfo::SCALAR) {
+            p.count = 1;
+            switch (type) {
+            case PropertyInfo::U64:
+                p.value = oi.getUInt64(id);
+                break;
+            case PropertyInfo::S64:
+                p.value = (uint64_t)oi.getInt64(id);
+                break;
+            case PropertyInfo::STRING:
+                p.value = intern(oi.getString(id));
+                break;
+            case PropertyInfo::REFERENCE:
+                p.value = reference(oi.getReference(id));
+                break;
+            case PropertyInfo::MAC:
+                p.value = packMAC(oi.getMAC(id));
+                break;
+            default:
+                return;
+            }
+        } else {
+            p.value = values.size();
+            switch (type) {
+            case PropertyInfo::U64:
+                p.count = oi.getUInt64Size(id);
+                for (size_t i = 0; i < p.count; ++i)
+                    values.push_back(oi.getUInt64(id, i));
+                break;
+            case PropertyInfo::S64:
+                p.count = oi.getInt64Size(id);
+                for (size_t i = 0; i < p.count; ++i)
+                    values.push_back((uint64_t)oi.getInt64(id, i));
+                break;
+            case PropertyInfo::STRING:
+                p.count = oi.getStringSize(id);
+                for (size_t i = 0; i < p.count; ++i)
+                    values.push_back(intern(oi.getString(id, i)));
+                break;
+            case PropertyInfo::REFERENCE:
+                p.count = oi.getReferenceSize(id);
+                for (size_t i = 0; i < p.count; ++i)
+                    values.push_back(reference(oi.getReference(id, i)));
+                break;
+            case PropertyInfo::MAC:
+                p.count = oi.getMACSize(id);
+                for (size_t i = 0; i < p.count; ++i)
+                    values.push_back(packMAC(oi.getMAC(id, i)));
+                break;
+            default:
+                return;
+            }
+        }
+        props.push_back(p);
+    }
+
+    void addClass(ObjectStore* store, const ClassInfo& ci) {
+        StoreClient& client = store->getReadOnlyStoreClient();
+        std::unordered_set<URI> uris;
+        try {
+            client.getObjectsForClass(ci.getId(), uris);
+        } catch (const std::out_of_range& e) {
+            return;
+        }
+
+        ClassRecord c;
+        memset(&c, 0, sizeof(c));
+        c.classId = ci.getId();
+        c.firstObject = objects.size();
+        for (const URI& uri : uris) {
+            std::shared_ptr<const ObjectInstance> oi;
+            try {
+                oi = client.get(ci.getId(), uri);
+            } catch (const std::out_of_range& e) {
+                continue;
+            }
+
+            ObjectRecord o;
+            memset(&o, 0, sizeof(o));
+            o.uri = intern(uri.toString());
+            o.parentUri = NO_INDEX;
+            o.parentProp = 0;
+            std::pair<URI, prop_id_t> parent(URI::ROOT, 0);
+            if (client.getParent(ci.getId(), uri, parent)) {
+                o.parentUri = intern(parent.first.toString());
+                o.parentProp = parent.second;
+            }
+            o.flags = oi->isLocal() ? FLAG_LOCAL : 0;
+            o.firstProp = props.size();
+            for (const ClassInfo::property_map_t::value_type& pv :
+                     ci.getProperties())
+                addProp(*oi, pv.second);
+            o.nProps = props.size() - o.firstProp;
+            objects.push_back(o);
+        }
+        c.nObjects = objects.size() - c.firstObject;
+        if (c.nObjects > 0)
+            classes.push_back(c);
+    }
+
+    bool write(FILE* file) {
+        ImageHeader h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, IMAGE_MAGIC, sizeof(h.magic));
+        h.version = StoreImage::VERSION;
+        h.byteOrder = BYTE_ORDER_MARK;
+        h.nStrings = strings.size();
+        h.nClasses = classes.size();
+        h.nObjects = objects.size();
+        h.nProps = props.size();
+        h.nValues = values.size();
+
+        vector<uint64_t> stringOffsets;
+        stringOffsets.reserve(strings.size());
+        size_t stringDataSize = 0;
+        for (const string* s : strings) {
+            stringOffsets.push_back(stringDataSize);
+            stringDataSize +=
+                align8(offsetof(StringRecord, data) + s->size() + 1);
+        }
+
+        size_t offset = align8(sizeof(h));
+        h.stringOffset = offset;
+        offset += align8(stringOffsets.size() * sizeof(uint64_t));
+        h.classOffset = offset;
+        offset += align8(classes.size() * sizeof(ClassRecord));
+        h.objectOffset = offset;
+        offset += align8(objects.size() * sizeof(ObjectRecord));
+        h.propOffset = offset;
+        offset += align8(props.size() * sizeof(PropRecord));
+        h.valueOffset = offset;
+        offset += values.size() * sizeof(uint64_t);
+        h.stringDataOffset = offset;
+        offset += stringDataSize;
+        h.fileSize = offset;
+
+        bool ok = true;
+        size_t written = 0;
+        ok = ok && section(file, &h, sizeof(h), written);
+        ok = ok && section(file, stringOffsets.data(),
+                           stringOffsets.size() * sizeof(uint64_t), written);
+        ok = ok && section(file, classes.data(),
+                           classes.size() * sizeof(ClassRecord), written);
+        ok = ok && section(file, objects.data(),
+                           objects.size() * sizeof(ObjectRecord), written);
+        ok = ok && section(file, props.data(),
+                           props.size() * sizeof(PropRecord), written);
+        ok = ok && section(file, values.data(),
+                           values.size() * sizeof(uint64_t), written);
+        vector<char> record;
+        for (const string* s : strings) {
+            if (!ok) break;
+            uint32_t len = s->size();
+            record.resize(offsetof(StringRecord, data) + len + 1);
+            memcpy(record.data(), &len, sizeof(len));
+            memcpy(record.data() + offsetof(StringRecord, data),
+                   s->c_str(), len + 1);
+            ok = section(file, record.data(), record.size(), written);
+        }
+        return ok && written == h.fileSize;
+    }
+
+private:
+    std::unordered_map<string, uint32_t> stringIds;
+    vector<const string*> strings;
+    vector<ClassRecord> classes;
+    vector<ObjectRecord> objects;
+    vector<PropRecord> props;
+    vector<uint64_t> values;
+
+    /* write a block followed by zero padding to the next 8 bytes */
+    static bool section(FILE* file, const void* data, size_t len,
+                        size_t& written) {
+        static const char zeros[8] = {0};
+        if (len > 0 && fwrite(data, 1, len, file) != len)
+            return false;
+        size_t pad = align8(written + len) - (written + len);
+        if (pad > 0 && fwrite(zeros, 1, pad, file) != pad)
+            return false;
+        written += len + pad;
+        return true;
+    }
+};
+
+class ImageReader {
+public:
+    ImageReader(const char* base_, size_t size_)
+        : base(base_), size(size_),
+          header(reinterpret_cast<const ImageHeader*>(base_)) {}
+
+    bool validate() {
+        if (size < sizeof(ImageHeader)) {
+            LOG(ERROR) << "Truncated MODB image";
+            return false;
+        }
+        if (memcmp(header->magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) != 0) {
+            LOG(ERROR) << "Not a MODB image";
+            return false;
+        }
+        if (header->version != StoreImage::VERSION) {
+            LOG(ERROR) << "Unsupported MODB image version "
+                       << header->version;
+            return false;
+        }
+        if (header->byteOrder != BYTE_ORDER_MARK) {
+            LOG(ERROR) << "MODB image has the wrong byte order";
+            return false;
+        }
+        if (header->fileSize != size ||
+            !inBounds(header->stringOffset,
+                      header->nStrings, sizeof(uint64_t)) ||
+            !inBounds(header->classOffset,
+                      header->nClasses, sizeof(ClassRecord)) ||
+            !inBounds(header->objectOffset,
+                      header->nObjects, sizeof(ObjectRecord)) ||
+            !inBounds(header->propOffset,
+                      header->nProps, sizeof(PropRecord)) ||
+            !inBounds(header->valueOffset,
+                      header->nValues, sizeof(uint64_t)) ||
+            header->stringDataOffset > size) {
+            LOG(ERROR) << "Truncated or malformed MODB image";
+            return false;
+        }
+        return true;
+    }
+
+    const ClassRecord& getClass(uint32_t i) const {
+        return at<ClassRecord>(header->classOffset)[i];
+    }
+
+    const ObjectRecord* getObject(uint32_t i) const {
+        if (i >= header->nObjects) return NULL;
+        return &at<ObjectRecord>(header->objectOffset)[i];
+    }
+
+    const PropRecord* getProp(uint32_t i) const {
+        if (i >= header->nProps) return NULL;
+        return &at<PropRecord>(header->propOffset)[i];
+    }
+
+    bool getValue(uint64_t i, uint64_t& value) const {
+        if (i >= header->nValues) return false;
+        value = at<uint64_t>(header->valueOffset)[i];
+        return true;
+    }
+
+    bool getString(uint64_t i, string& str) const {
+        if (i >= header->nStrings) return false;
+        uint64_t offset = header->stringDataOffset +
+            at<uint64_t>(header->stringOffset)[i];
+        if (offset + offsetof(StringRecord, data) > size) return false;
+        const StringRecord* s =
+            reinterpret_cast<const StringRecord*>(base + offset);
+        if (offset + offsetof(StringRecord, data) + s->length > size)
+            return false;
+        str.assign(s->data, s->length);
+        return true;
+    }
+
+    bool getReference(uint64_t v, class_id_t& class_id, URI& uri) const {
+        string str;
+        if (!getString(v & 0xffffffff, str)) return false;
+        class_id = v >> 32;
+        uri = URI(str);
+        return true;
+    }
+
+    uint32_t getClassCount() const { return header->nClasses; }
+
+private:
+    const char* base;
+    size_t size;
+    const ImageHeader* header;
+
+    bool inBounds(uint64_t offset, uint64_t count, size_t rsize) const {
+        return offset <= size && count <= (size - offset) / rsize;
+    }
+
+    template <typename T>
+    const T* at(uint64_t offset) const {
+        return reinterpret_cast<const T*>(base + offset);
+    }
+};
+
+bool loadValue(const ImageReader& reader, const PropRecord& p,
+               uint64_t v, ObjectInstance& oi) {
+    bool scalar = p.cardinality == PropertyInfo::SCALAR;
+    switch (p.type) {
+    case PropertyInfo::U64:
+        if (scalar) oi.setUInt64(p.propId, v);
+        else oi.addUInt64(p.propId, v);
+        break;
+    case PropertyInfo::S64:
+        if (scalar) oi.setInt64(p.propId, (int64_t)v);
+        else oi.addInt64(p.propId, (int64_t)v);
+        break;
+    case PropertyInfo::MAC:
+        if (scalar) oi.setMAC(p.propId, unpackMAC(v));
+        else oi.addMAC(p.propId, unpackMAC(v));
+        break;
+    case PropertyInfo::STRING:
+        {
+            string str;
+            if (!reader.getString(v, str)) return false;
+            if (scalar) oi.setString(p.propId, str);
+            else oi.addString(p.propId, str);
+        }
+        break;
+    case PropertyInfo::REFERENCE:
+        {
+            class_id_t class_id;
+            URI uri(URI::ROOT);
+            if (!reader.getReference(v, class_id, uri)) return false;
+            if (scalar) oi.setReference(p.propId, class_id, uri);
+            else oi.addReference(p.propId, class_id, uri);
+        }
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+/* set a vector property that was written without any values, so
+   that it is still set rather than missing */
+bool loadEmpty(const PropRecord& p, ObjectInstance& oi) {
+    switch (p.type) {
+    case PropertyInfo::U64:
+        oi.setUInt64(p.propId, vector<uint64_t>());
+        break;
+    case PropertyInfo::S64:
+        oi.setInt64(p.propId, vector<int64_t>());
+        break;
+    case PropertyInfo::MAC:
+        oi.setMAC(p.propId, vector<MAC>());
+        break;
+    case PropertyInfo::STRING:
+        oi.setString(p.propId, vector<string>());
+        break;
+    case PropertyInfo::REFERENCE:
+        oi.setReference(p.propId, vector<reference_t>());
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+/* check that a property record still matches the current model */
+bool checkProp(const ClassInfo& ci, const PropRecord& p) {
+    try {
+        prop_id_t prop_id = p.propId;
+        const PropertyInfo& pinfo = ci.getProperty(prop_id);
+        return storageType(pinfo.getType()) == p.type &&
+            pinfo.getCardinality() == p.cardinality;
+    } catch (const std::out_of_range& e) {
+        return false;
+    }
+}
+
+} /* anonymous namespace */
+
+StoreImage::StoreImage(ObjectStore* store_) : store(store_) {
+
+}
+
+static void addClassToImage(void* data, const ClassInfo& ci) {
+    std::pair<ObjectStore*, ImageWriter*>* ctx =
+        static_cast<std::pair<ObjectStore*, ImageWriter*>*>(data);
+    ctx->second->addClass(ctx->first, ci);
+}
+
+bool StoreImage::write(FILE* file) {
+    ImageWriter writer;
+    std::pair<ObjectStore*, ImageWriter*> ctx(store, &writer);
+    store->forEachClass(addClassToImage, &ctx);
+    return writer.write(file);
+}
+
+bool StoreImage::write(const string& file) {
+    FILE* pfile = fopen(file.c_str(), "w");
+    if (pfile == NULL) {
+        LOG(ERROR) << "Could not open MODB image "
+                   << file << " for writing";
+        return false;
+    }
+    bool ok = write(pfile);
+    if (fclose(pfile) != 0) ok = false;
+    if (ok) {
+        LOG(INFO) << "Wrote MODB image to " << file;
+    } else {
+        LOG(ERROR) << "Failed to write MODB image " << file;
+    }
+    return ok;
+}
+
+bool StoreImage::isImage(const string& file) {
+    FILE* pfile = fopen(file.c_str(), "r");
+    if (pfile == NULL) return false;
+    char magic[sizeof(IMAGE_MAGIC)];
+    bool result = fread(magic, 1, sizeof(magic), pfile) == sizeof(magic) &&
+        memcmp(magic, IMAGE_MAGIC, sizeof(magic)) == 0;
+    fclose(pfile);
+    return result;
+}
+
+size_t StoreImage::load(const string& file, StoreClient& client,
+                        /* out */ StoreClient::notif_t* notifs) {
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOG(ERROR) << "Could not open MODB image " << file;
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        LOG(ERROR) << "Could not read MODB image " << file;
+        close(fd);
+        return 0;
+    }
+    size_t size = st.st_size;
+    void* base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        LOG(ERROR) << "Could not map MODB image " << file;
+        return 0;
+    }
+
+    ImageReader reader(static_cast<const char*>(base), size);
+    size_t count = 0;
+    if (reader.validate()) {
+        // load everything as one commit so that the store version is
+        // bumped once for the whole image
+        const ObjectStore::CommitGuard commit(*store);
+        vector<std::pair<const ObjectRecord*, class_id_t> > children;
+
+        for (uint32_t c = 0; c < reader.getClassCount(); ++c) {
+            const ClassRecord& cr = reader.getClass(c);
+            const ClassInfo* ci;
+            try {
+                ci = &store->getClassInfo(cr.classId);
+            } catch (const std::out_of_range& e) {
+                LOG(WARNING) << "Skipping unknown class " << cr.classId
+                             << " in MODB image";
+                continue;
+            }
+
+            for (uint32_t i = 0; i < cr.nObjects; ++i) {
+                const ObjectRecord* o = reader.getObject(cr.firstObject + i);
+                string uristr;
+                if (o == NULL || !reader.getString(o->uri, uristr)) {
+                    LOG(ERROR) << "Malformed object record in MODB image";
+                    break;
+                }
+                URI uri(uristr);
+                std::shared_ptr<ObjectInstance> oi =
+                    std::make_shared<ObjectInstance>(ci->getId(),
+                                                     o->flags & FLAG_LOCAL);
+                for (uint32_t j = 0; j < o->nProps; ++j) {
+                    const PropRecord* p = reader.getProp(o->firstProp + j);
+                    if (p == NULL) break;
+                    if (!checkProp(*ci, *p)) {
+                        LOG(DEBUG) << "Skipping stale property " << p->propId
+                                   << " in class " << ci->getName();
+                        continue;
+                    }
+                    if (p->cardinality == PropertyInfo::SCALAR) {
+                        loadValue(reader, *p, p->value, *oi);
+                    } else if (p->count == 0) {
+                        loadEmpty(*p, *oi);
+                    } else {
+                        for (uint32_t k = 0; k < p->count; ++k) {
+                            uint64_t v;
+                            if (!reader.getValue(p->value + k, v) ||
+                                !loadValue(reader, *p, v, *oi))
+                                break;
+                        }
+                    }
+                }
+
+                try {
+                    if (client.putIfModified(ci->getId(), uri, oi) && notifs)
+                        client.queueNotification(ci->getId(), uri, *notifs);
+                    count += 1;
+                    if (o->parentUri != NO_INDEX)
+                        children.push_back(std::make_pair(o, ci->getId()));
+                } catch (const std::invalid_argument& e) {
+                    LOG(ERROR) << "Could not load " << uri
+                               << " from MODB image: " << e.what();
+                }
+            }
+        }
+
+        // link children only once every parent has been stored
+        for (const std::pair<const ObjectRecord*, class_id_t>& child :
+                 children) {
+            string uristr, parentstr;
+            if (!reader.getString(child.first->uri, uristr) ||
+                !reader.getString(child.first->parentUri, parentstr))
+                continue;
+            URI uri(uristr);
+            try {
+                const ClassInfo& parent_class =
+                    store->getPropClassInfo(child.first->parentProp);
+                URI parent_uri(parentstr);
+                if (client.addChild(parent_class.getId(), parent_uri,
+                                    child.first->parentProp,
+                                    child.second, uri) && notifs)
+                    client.queueNotification(parent_class.getId(),
+                                             parent_uri, *notifs);
+            } catch (const std::out_of_range& e) {
+                LOG(ERROR) << "Invalid parent or property for " << uri;
+            } catch (const std::invalid_argument& e) {
+                LOG(ERROR) << "Invalid parent for " << uri
+                           << ": " << e.what();
+            }
+        }
+    }
+
+    munmap(base, size);
+    return count;
+}
+
+} /* namespace modb */
+} /* namespace opflex */
@@ -0,0 +1,48 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for TraceContext class.
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "opflex/modb/TraceContext.h"
+
+namespace opflex {
+namespace modb {
+
+namespace {
+thread_local TraceContext::clock::time_point threadOrigin;
+thread_local TraceContext::clock::time_point threadStart;
+}
+
+TraceContext::clock::time_point TraceContext::getOrigin() {
+    return threadOrigin;
+}
+
+TraceContext::clock::time_point TraceContext::getStart() {
+    return threadStart;
+}
+
+TraceContext::Scope::Scope(clock::time_point origin)
+    : savedOrigin(threadOrigin), savedStart(threadStart) {
+    threadOrigin = origin;
+    threadStart = origin == clock::time_point()
+        ? clock::time_point() : clock::now();
+}
+
+TraceContext::Scope::~Scope() {
+    threadOrigin = savedOrigin;
+    threadStart = savedStart;
+}
+
+} /* namespace modb */
+} /* namespace opflex */
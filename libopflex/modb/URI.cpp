@@ -17,6 +17,9 @@
 
 #include <cctype>
 #include <cstdlib>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
 
 #include <boost/algorithm/string/split.hpp>
 
@@ -35,19 +38,107 @@ using boost::algorithm::first_finder;
 using boost::iterator_range;
 using boost::copy_range;
 
+namespace {
+
+/**
+ * Table of live interned URI strings indexed by their hash.  Entries
+ * are removed by the deleter of the shared string when the last URI
+ * referencing it is destroyed.
+ */
+class InternTable {
+public:
+    std::shared_ptr<const string> intern(const string& str, size_t hashv) {
+        const std::lock_guard<std::mutex> guard(lock);
+        auto range = table.equal_range(hashv);
+        for (auto it = range.first; it != range.second; ++it) {
+            // The string stays alive until its deleter has removed
+            // the entry, so it is safe to compare under the lock
+            // without taking a reference.
+            if (*it->second.first == str) {
+                std::shared_ptr<const string> existing =
+                    it->second.second.lock();
+                if (existing)
+                    return existing;
+            }
+        }
+        const string* copy = new string(str);
+        std::shared_ptr<const string> result(copy, Deleter(this, hashv));
+        table.insert(std::make_pair(hashv, std::make_pair(copy, result)));
+        return result;
+    }
+
+    size_t size() {
+        const std::lock_guard<std::mutex> guard(lock);
+        return table.size();
+    }
+
+private:
+    typedef std::pair<const string*,
+                      std::weak_ptr<const string> > entry_t;
+    typedef std::unordered_multimap<size_t, entry_t> table_t;
+
+    class Deleter {
+    public:
+        Deleter(InternTable* table_, size_t hashv_)
+            : table(table_), hashv(hashv_) {}
+
+        void operator()(const string* str) {
+            table->release(hashv, str);
+            delete str;
+        }
+    private:
+        InternTable* table;
+        size_t hashv;
+    };
+
+    void release(size_t hashv, const string* str) {
+        const std::lock_guard<std::mutex> guard(lock);
+        auto range = table.equal_range(hashv);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second.first == str) {
+                table.erase(it);
+                break;
+            }
+        }
+    }
+
+    std::mutex lock;
+    table_t table;
+};
+
+std::atomic<bool> internEnabled(false);
+
+// intentionally leaked so that interned URIs held in static storage
+// can be safely destroyed at exit
+InternTable& getInternTable() {
+    static InternTable* table = new InternTable();
+    return *table;
+}
+
+} /* anonymous namespace */
+
 const URI URI::ROOT("/");
 
 URI::URI(const std::shared_ptr<const std::string>& uri_)
     : uri(uri_) {
     hashv = 0;
     boost::hash_combine(hashv, *uri);
+    if (internEnabled)
+        uri = getInternTable().intern(*uri_, hashv);
 }
 
 URI::URI(const std::string& uri_) {
-    uri = std::make_shared<const std::string>(uri_);
-
     hashv = 0;
     boost::hash_combine(hashv, uri_);
+
+    if (internEnabled)
+        uri = getInternTable().intern(uri_, hashv);
+    else
+        uri = std::make_shared<const std::string>(uri_);
+}
+
+URI::URI(const std::shared_ptr<const std::string>& uri_, size_t hashv_)
+    : uri(uri_), hashv(hashv_) {
 }
 
 URI::URI(const URI& uri_)
@@ -58,6 +149,24 @@ URI::URI(const URI& uri_)
 URI::~URI() {
 }
 
+void URI::setInterning(bool enabled) {
+    internEnabled = enabled;
+}
+
+bool URI::isInterning() {
+    return internEnabled;
+}
+
+size_t URI::getInternedCount() {
+    return getInternTable().size();
+}
+
+URI URI::intern(const std::string& uri_) {
+    size_t hashv = 0;
+    boost::hash_combine(hashv, uri_);
+    return URI(getInternTable().intern(uri_, hashv), hashv);
+}
+
 std::ostream & operator<<(std::ostream &os, const URI& uri) {
     os << uri.toString();
     return os;
@@ -67,6 +176,14 @@ const std::string& URI::toString() const {
     return *uri;
 }
 
+size_t URI::getMemoryUsage() const {
+    // the string, its shared control block and any heap buffer
+    size_t shared = sizeof(std::string) + 2 * sizeof(void*) +
+        (uri->capacity() > 15 ? uri->capacity() + 1 : 0);
+    long users = uri.use_count();
+    return sizeof(URI) + (users > 1 ? shared / users : shared);
+}
+
 typedef split_iterator<string::const_iterator> string_split_iter;
 
 enum UState {
@@ -125,6 +242,11 @@ URI& URI::operator=(const URI& rhs) {
 }
 
 bool operator==(const URI& lhs, const URI& rhs) {
+    // URIs copied from one another or interned from the same string
+    // share storage, and the cached hash lets us reject most
+    // mismatches without touching the string data
+    if (lhs.uri == rhs.uri) return true;
+    if (lhs.hashv != rhs.hashv) return false;
     return *lhs.uri == *rhs.uri;
 }
 bool operator!=(const URI& lhs, const URI& rhs) {
@@ -15,90 +15,193 @@
 #endif
 
 
-#include <sstream>
 #include <string>
-#include <cctype>
-#include <iomanip>
+#include <vector>
+
+#include <pthread.h>
 
 #include "opflex/modb/URIBuilder.h"
 
 namespace opflex {
 namespace modb {
 
-using std::stringstream;
-using std::ostream;
 using std::string;
 
+namespace {
+
+/**
+ * Initial capacity of a new builder buffer, large enough for most
+ * URIs in the model
+ */
+const size_t INITIAL_CAPACITY = 256;
+
+/**
+ * Buffers that have grown beyond this are not recycled
+ */
+const size_t MAX_CACHED_CAPACITY = 4096;
+
+/**
+ * Maximum number of idle builders kept per thread.  Builders are
+ * often nested when a URI element is itself built from a URI.
+ */
+const size_t MAX_CACHED = 4;
+
+pthread_once_t cache_once = PTHREAD_ONCE_INIT;
+pthread_key_t cache_key;
+
+} /* anonymous namespace */
+
 class URIBuilder::URIBuilderImpl {
 public:
-    URIBuilderImpl() { 
-        uri_stream.fill('0');
-        uri_stream << '/';
+    /**
+     * Get a builder from the cache for the current thread, or
+     * allocate a new one if the cache is empty
+     */
+    static URIBuilderImpl* acquire() {
+        pthread_once(&cache_once, createCacheKey);
+        cache_t* cache = (cache_t*)pthread_getspecific(cache_key);
+        if (cache != NULL && !cache->empty()) {
+            URIBuilderImpl* impl = cache->back();
+            cache->pop_back();
+            return impl;
+        }
+        URIBuilderImpl* impl = new URIBuilderImpl();
+        impl->buffer.reserve(INITIAL_CAPACITY);
+        return impl;
     }
 
-    explicit URIBuilderImpl(const URI& uri) {
-        uri_stream.fill('0');
-        uri_stream << uri.toString();
+    /**
+     * Return a builder to the cache for the current thread
+     */
+    static void release(URIBuilderImpl* impl) {
+        cache_t* cache = (cache_t*)pthread_getspecific(cache_key);
+        if (cache == NULL) {
+            cache = new cache_t();
+            cache->reserve(MAX_CACHED);
+            pthread_setspecific(cache_key, cache);
+        }
+        if (cache->size() < MAX_CACHED &&
+            impl->buffer.capacity() <= MAX_CACHED_CAPACITY) {
+            impl->buffer.clear();
+            cache->push_back(impl);
+        } else {
+            delete impl;
+        }
     }
 
-    stringstream uri_stream;
+    string buffer;
+
+private:
+    typedef std::vector<URIBuilderImpl*> cache_t;
+
+    static void createCacheKey() {
+        pthread_key_create(&cache_key, freeCache);
+    }
+
+    static void freeCache(void* arg) {
+        cache_t* cache = (cache_t*)arg;
+        for (URIBuilderImpl* impl : *cache)
+            delete impl;
+        delete cache;
+    }
 };
 
-URIBuilder::URIBuilder() : pimpl(new URIBuilderImpl()) {
+namespace {
 
+const char HEX_DIGITS[] = "0123456789abcdef";
+
+inline bool isUnreserved(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+        (c >= '0' && c <= '9') ||
+        c == '-' || c == '_' || c == '.' || c == '~';
 }
 
-URIBuilder::URIBuilder(const URI& uri) : pimpl(new URIBuilderImpl(uri)) {
+void writeStringEscape(string& buffer, const char* str, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        unsigned char c = (unsigned char)str[i];
+        if (isUnreserved(c)) {
+            buffer.push_back(c);
+        } else {
+            const char esc[3] = { '%', HEX_DIGITS[c >> 4], HEX_DIGITS[c & 0xf] };
+            buffer.append(esc, 3);
+        }
+    }
+}
 
+void writeUInt(string& buffer, uint64_t value, bool negative) {
+    char digits[21];
+    char* p = digits + sizeof(digits);
+    do {
+        *--p = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    if (negative) *--p = '-';
+    buffer.append(p, digits + sizeof(digits) - p);
 }
 
-URIBuilder::~URIBuilder() {
-    delete pimpl;
+void writeInt(string& buffer, int64_t value) {
+    if (value < 0)
+        writeUInt(buffer, ~(uint64_t)value + 1, true);
+    else
+        writeUInt(buffer, (uint64_t)value, false);
 }
 
-static void writeStringEscape(ostream& stream, const string& str) {
-    string::const_iterator i;
-    stream << std::hex;
-    for (i = str.begin(); i != str.end(); ++i) {
-        string::value_type c = *i;
-        if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
-            stream << c;
-            continue;
-        }
+} /* anonymous namespace */
 
-        stream << '%' << std::setw(2) << int((unsigned char) c);
-    }
-    stream << std::dec;
+URIBuilder::URIBuilder() : pimpl(URIBuilderImpl::acquire()) {
+    pimpl->buffer.push_back('/');
+}
+
+URIBuilder::URIBuilder(const URI& uri) : pimpl(URIBuilderImpl::acquire()) {
+    pimpl->buffer.append(uri.toString());
+}
+
+URIBuilder::~URIBuilder() {
+    URIBuilderImpl::release(pimpl);
 }
 
 URIBuilder& URIBuilder::addElement(uint64_t elementValue) {
-    pimpl->uri_stream << elementValue << '/';
+    writeUInt(pimpl->buffer, elementValue, false);
+    pimpl->buffer.push_back('/');
     return *this;
 }
 
 URIBuilder& URIBuilder::addElement(int64_t elementValue) {
-    pimpl->uri_stream << elementValue << '/';
+    writeInt(pimpl->buffer, elementValue);
+    pimpl->buffer.push_back('/');
     return *this;
 }
 
 URIBuilder& URIBuilder::addElement(uint32_t elementValue) {
-    pimpl->uri_stream << elementValue << '/';
+    writeUInt(pimpl->buffer, elementValue, false);
+    pimpl->buffer.push_back('/');
     return *this;
 }
 
 URIBuilder& URIBuilder::addElement(int32_t elementValue) {
-    pimpl->uri_stream << elementValue << '/';
+    writeInt(pimpl->buffer, elementValue);
+    pimpl->buffer.push_back('/');
     return *this;
 }
 
 URIBuilder& URIBuilder::addElement(const string& elementValue) {
-    writeStringEscape(pimpl->uri_stream, elementValue);
-    pimpl->uri_stream << '/';
+    writeStringEscape(pimpl->buffer, elementValue.data(), elementValue.size());
+    pimpl->buffer.push_back('/');
     return *this;
 }
 
 URIBuilder& URIBuilder::addElement(const MAC& elementValue) {
-    return addElement(elementValue.toString());
+    // equivalent to escaping MAC::toString(), where each ':' becomes
+    // "%3a"
+    uint8_t mac[6];
+    elementValue.toUIntArray(mac);
+    for (int i = 0; i < 6; ++i) {
+        if (i > 0) pimpl->buffer.append("%3a", 3);
+        pimpl->buffer.push_back(HEX_DIGITS[mac[i] >> 4]);
+        pimpl->buffer.push_back(HEX_DIGITS[mac[i] & 0xf]);
+    }
+    pimpl->buffer.push_back('/');
+    return *this;
 }
 
 URIBuilder& URIBuilder::addElement(const URI& elementValue) {
@@ -106,7 +209,11 @@ URIBuilder& URIBuilder::addElement(const URI& elementValue) {
 }
 
 modb::URI URIBuilder::build() {
-    return modb::URI(pimpl->uri_stream.str());
+    return modb::URI(pimpl->buffer);
+}
+
+modb::URI URIBuilder::buildInterned() {
+    return modb::URI::intern(pimpl->buffer);
 }
 
 } /* namespace modb */
@@ -14,6 +14,10 @@
 #  include <config.h>
 #endif
 
+#include <algorithm>
+#include <functional>
+#include <memory>
+
 #include "opflex/modb/internal/URIQueue.h"
 #include "opflex/logging/internal/logging.hpp"
 
@@ -22,30 +26,74 @@ namespace modb {
 
 URIQueue::URIQueue(QProcessor* processor_, util::ThreadManager& threadManager_)
     : processor(processor_), threadManager(threadManager_),
-      item_loop(nullptr), proc_shouldRun(false) {
+      item_head(nullptr), item_loop(nullptr), proc_shouldRun(false) {
     item_async = {};
     cleanup_async = {};
 }
 
 URIQueue::~URIQueue() {
     stop();
+    node* n = item_head.exchange(nullptr);
+    while (n != nullptr) {
+        node* next = n->next;
+        delete n;
+        n = next;
+    }
+}
+
+URIQueue::shard& URIQueue::getShard(const URI& uri) {
+    return queued[std::hash<URI>()(uri) % SHARDS];
+}
+
+void URIQueue::QProcessor::processItems(const item_batch_t& items) {
+    for (const URIQueue::item* d : items) {
+        try {
+            processItem(d->uri, d->data);
+        } catch (const std::exception& ex) {
+            LOG(ERROR) << "Exception while processing notification queue: "
+                       << ex.what();
+        } catch (...) {
+            LOG(ERROR) << "Unknown error processing notification queue";
+        }
+    }
 }
 
+// Maximum number of items delivered to the processor in one batch
+static const size_t MAX_BATCH_SIZE = 1024;
+
 // listen on the item queue and dispatch events where required
 void URIQueue::proc_async_func(uv_async_t* handle) {
     URIQueue* queue = static_cast<URIQueue*>(handle->data);
 
     if (queue->proc_shouldRun) {
-        item_queue_t toProcess;
-        {
-            const std::lock_guard<std::mutex> lock(queue->item_mutex);
-            toProcess.swap(queue->item_queue);
+        // take every queued item at once, and restore queue order
+        node* head = queue->item_head.exchange(nullptr,
+                                               boost::memory_order_acquire);
+        std::vector<std::unique_ptr<node> > toProcess;
+        for (node* n = head; n != nullptr; n = n->next)
+            toProcess.emplace_back(n);
+        std::reverse(toProcess.begin(), toProcess.end());
+
+        // the items are no longer queued, so that a change made while
+        // they are processed queues them again
+        for (const std::unique_ptr<node>& n : toProcess) {
+            shard& s = queue->getShard(n->it.uri);
+            const std::lock_guard<std::mutex> lock(s.mutex);
+            s.uris.erase(n->it.uri);
         }
 
-        for (const URIQueue::item& d : toProcess) {
+        item_batch_t batch;
+        batch.reserve(std::min(toProcess.size(), MAX_BATCH_SIZE));
+        auto it = toProcess.begin();
+        while (it != toProcess.end()) {
             if (!queue->proc_shouldRun) return;
+            batch.clear();
+            for (; it != toProcess.end() &&
+                     batch.size() < MAX_BATCH_SIZE; ++it) {
+                batch.push_back(&(*it)->it);
+            }
             try {
-                queue->processor->processItem(d.uri, d.data);
+                queue->processor->processItems(batch);
             } catch (const std::exception& ex) {
                 LOG(ERROR) << "Exception while processing notification queue: "
                            << ex.what();
@@ -83,10 +131,17 @@ void URIQueue::stop() {
 
 void URIQueue::queueItem(const URI& uri, const boost::any& data) {
     {
-        const std::lock_guard<std::mutex> lock(item_mutex);
-        item_queue.push_back(item(uri, data));
-        uv_async_send(&item_async);
+        shard& s = getShard(uri);
+        const std::lock_guard<std::mutex> lock(s.mutex);
+        if (!s.uris.insert(uri).second) return;
     }
+
+    node* n = new node(uri, data);
+    n->next = item_head.load(boost::memory_order_relaxed);
+    while (!item_head.compare_exchange_weak(n->next, n,
+                                            boost::memory_order_release,
+                                            boost::memory_order_relaxed));
+    uv_async_send(&item_async);
 }
 
 } /* namespace modb */
@@ -14,11 +14,15 @@
 #ifndef MODB_CLASSINDEX_H
 #define MODB_CLASSINDEX_H
 
+#include <unordered_map>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include "opflex/modb/URI.h"
+#include "opflex/modb/MAC.h"
 #include "opflex/modb/ClassInfo.h"
+#include "opflex/modb/mo-internal/ObjectInstance.h"
 
 namespace opflex {
 namespace modb {
@@ -92,6 +96,18 @@ public:
     void getChildren(const URI& parent, prop_id_t parent_prop,
                      /* out */ std::vector<URI>& output) const ;
 
+    /**
+     * Invoke the visitor for each child of the parent URI and
+     * property without copying the children.
+     *
+     * @param parent the URI of the parent object
+     * @param parent_prop The property ID of the parent property
+     * @param visitor the visitor to invoke for each child
+     * @return false if the visitor stopped the iteration early
+     */
+    bool forEachChild(const URI& parent, prop_id_t parent_prop,
+                      const uri_visitor_t& visitor) const;
+
     /**
      * Get the parent for the given child URI.
      *
@@ -129,22 +145,170 @@ public:
      */
     void getAll(std::unordered_set<URI>& output) const;
 
+    /**
+     * Invoke the visitor for each URI in the class without copying
+     * the instance set.
+     *
+     * @param visitor the visitor to invoke for each URI
+     * @return false if the visitor stopped the iteration early
+     */
+    bool forEachInstance(const uri_visitor_t& visitor) const;
+
+    /**
+     * Maintain a secondary index on the given property so that
+     * instances can be looked up by its value.  Existing instances
+     * must be indexed separately using updateIndexes().
+     *
+     * @param prop the property to index
+     * @return true if the index was added, or false if the property
+     * was already indexed
+     */
+    bool addIndex(const PropertyInfo& prop);
+
+    /**
+     * Check whether the given property is indexed
+     *
+     * @param prop_id the property ID
+     * @return true if there is an index on the property
+     */
+    bool hasIndex(prop_id_t prop_id) const;
+
+    /**
+     * Update the secondary indexes for an instance whose value is
+     * changing.
+     *
+     * @param uri the URI of the instance
+     * @param oldoi the previous value of the instance, or NULL if it
+     * was not present
+     * @param newoi the new value of the instance, or NULL if it is
+     * being removed
+     */
+    void updateIndexes(const URI& uri,
+                       const mointernal::ObjectInstance* oldoi,
+                       const mointernal::ObjectInstance* newoi);
+
+    /**
+     * Find the instances whose indexed property contains the value
+     * with the given index key.
+     *
+     * @param prop_id the property ID
+     * @param key the index key for the value, from indexKey()
+     * @param output an unordered_set to receive the output
+     * @throws std::out_of_range if the property is not indexed
+     */
+    void findByProperty(prop_id_t prop_id, const std::string& key,
+                        /* out */ std::unordered_set<URI>& output) const;
+
+    /**
+     * Get the approximate number of bytes of memory used by the
+     * parent/child, instance and property indexes
+     *
+     * @return the approximate memory use in bytes
+     */
+    size_t getMemoryUsage() const;
+
+    /**
+     * Get the index key for an integer or enum property value
+     */
+    static std::string indexKey(uint64_t value);
+
+    /**
+     * Get the index key for a string property value
+     */
+    static std::string indexKey(const std::string& value);
+
+    /**
+     * Get the index key for a MAC property value
+     */
+    static std::string indexKey(const MAC& value);
+
+    /**
+     * Get the index key for a reference property value
+     */
+    static std::string indexKey(const reference_t& value);
+
 private:
     typedef std::unordered_set<URI> uri_set_t;
-    typedef std::unordered_map<prop_id_t, uri_set_t> prop_uri_map_t;
-    typedef std::unordered_map<URI, prop_uri_map_t> uri_prop_uri_map_t;
-    typedef std::unordered_map<URI, std::pair<URI, prop_id_t> > uri_prop_map_t;
 
     /**
-     * The child map allows us to look up all the children of this
-     * class index's type for a given parent URI
+     * The children of this class index's type for a single parent
+     * URI and parent property
+     */
+    struct ChildEntry {
+        ChildEntry(const URI& parent_, prop_id_t prop_, size_t hash_)
+            : parent(parent_), prop(prop_), hash(hash_) {}
+
+        /**
+         * The URI of the parent object
+         */
+        URI parent;
+
+        /**
+         * The parent property
+         */
+        prop_id_t prop;
+
+        /**
+         * The cached hash of the parent URI and property
+         */
+        size_t hash;
+
+        /**
+         * The child URIs, in no particular order
+         */
+        std::vector<URI> children;
+    };
+
+    /**
+     * The child entries, stored densely so that they can be walked
+     * without chasing hash table nodes
+     */
+    std::vector<ChildEntry> child_entries;
+
+    /**
+     * An open-addressing table with linear probing that maps a
+     * (parent, property) key to its index in child_entries.  Empty
+     * slots hold NO_ENTRY.
      */
-    uri_prop_uri_map_t child_map;
+    std::vector<uint32_t> child_slots;
+
+    /**
+     * The link from a child to its parent, along with the position of
+     * the child in its child entry so it can be removed in constant
+     * time
+     */
+    struct ParentLink {
+        ParentLink(const URI& parent_uri, prop_id_t parent_prop,
+                   size_t index_)
+            : parent(parent_uri, parent_prop), index(index_) {}
+
+        /**
+         * The parent URI and property
+         */
+        std::pair<URI, prop_id_t> parent;
+
+        /**
+         * The index of the child in ChildEntry::children
+         */
+        size_t index;
+    };
+    typedef std::unordered_map<URI, ParentLink> uri_parent_map_t;
 
     /**
      * Maps child URIs to their parents.
      */
-    uri_prop_map_t parent_map;
+    uri_parent_map_t parent_map;
+
+    static const uint32_t NO_ENTRY;
+    static size_t childHash(const URI& parent, prop_id_t prop);
+    size_t findChildSlot(const URI& parent, prop_id_t prop,
+                         size_t hash) const;
+    ChildEntry* findChildEntry(const URI& parent, prop_id_t prop);
+    const ChildEntry* findChildEntry(const URI& parent,
+                                     prop_id_t prop) const;
+    ChildEntry& insertChildEntry(const URI& parent, prop_id_t prop);
+    void eraseChildEntry(const URI& parent, prop_id_t prop);
+    void growChildSlots();
 
     /**
      * The instance map gives us a list of all managed objects of this
@@ -152,6 +316,37 @@ private:
      */
     std::unordered_set<URI> instance_map;
 
+    /**
+     * A secondary index from property value keys to the instances
+     * that contain them
+     */
+    struct PropIndex {
+        PropIndex(PropertyInfo::property_type_t type_,
+                  PropertyInfo::cardinality_t cardinality_)
+            : type(type_), cardinality(cardinality_) {}
+
+        /**
+         * The type of the indexed property
+         */
+        PropertyInfo::property_type_t type;
+
+        /**
+         * The cardinality of the indexed property
+         */
+        PropertyInfo::cardinality_t cardinality;
+
+        /**
+         * Instances for each value key
+         */
+        std::unordered_map<std::string, uri_set_t> values;
+    };
+    typedef std::unordered_map<prop_id_t, PropIndex> prop_index_map_t;
+
+    /**
+     * Secondary indexes on the properties of this class
+     */
+    prop_index_map_t prop_indexes;
+
 };
 
 } /* namespace modb */
@@ -15,11 +15,18 @@
 #define MODB_OBJECTSTORE_H
 
 #include <mutex>
+#include <atomic>
+#include <set>
 #include <boost/noncopyable.hpp>
+#include <boost/thread/shared_mutex.hpp>
 #include <list>
+#include <memory>
+#include <vector>
+#include <uv.h>
 
 #include "opflex/modb/ModelMetadata.h"
 #include "opflex/modb/ClassInfo.h"
+#include "opflex/modb/ClassStats.h"
 #include "opflex/modb/ObjectListener.h"
 #include "opflex/modb/mo-internal/StoreClient.h"
 #include "opflex/modb/internal/Region.h"
@@ -120,6 +127,29 @@ public:
      */
     void unregisterListener(class_id_t class_id, ObjectListener* listener);
 
+    /**
+     * Set the number of threads used to deliver notifications to
+     * listeners.  With one worker, the default, every listener is
+     * called from a single thread.  With more workers, one thread
+     * remains dedicated to listeners that are not thread-safe, and
+     * notifications for thread-safe listeners are partitioned by URI
+     * hash over the remaining workers so that a slow listener does not
+     * delay the others.  This must be called before start().
+     *
+     * @param workers the number of notification workers
+     * @throws std::invalid_argument if workers is zero
+     * @throws std::logic_error if the store is already started
+     * @see ObjectListener::isThreadSafe
+     */
+    void setNotificationWorkers(size_t workers);
+
+    /**
+     * Get the number of notification workers
+     *
+     * @return the number of notification workers
+     */
+    size_t getNotificationWorkers() const;
+
     /**
      * Get a store client for the specified owner.
      *
@@ -172,11 +202,256 @@ public:
      */
     void getOwners(/* out */ std::unordered_set<std::string>& output);
 
+    /**
+     * Maintain a secondary index on a property of the given class so
+     * that its objects can be found by property value using
+     * StoreClient::findByProperty().  The index is populated from any
+     * objects already in the store.
+     *
+     * @param class_id the class ID
+     * @param prop_id the property to index
+     * @throws std::out_of_range if there is no such class or property
+     * @throws std::invalid_argument if the property cannot be indexed
+     */
+    void addIndex(class_id_t class_id, prop_id_t prop_id);
+
+    /**
+     * Compute approximate memory accounting for every class in the
+     * store.  This walks all objects in the store.
+     *
+     * @param output a map from class name to the stats for the
+     * class
+     */
+    void getClassStats(/* out */ class_stats_map_t& output);
+
+    /**
+     * Hold a commit open on the store for the lifetime of the object.
+     * All writes made while a commit is open are published to
+     * snapshots as a single new version when the outermost guard is
+     * destroyed.  A thread may nest guards.
+     *
+     * Commits on different threads run concurrently and only wait
+     * for each other on the region locks, so two commits writing the
+     * same objects may interleave; snapshots still see each commit as
+     * a whole.  Commits wait for a snapshot that is being acquired or
+     * released.  The locks are taken in
+     * the order commit, then region, so a thread must not open a
+     * commit while it holds a region lock.
+     *
+     * @throws std::logic_error if the calling thread holds a region
+     * read lock
+     */
+    class CommitGuard : private boost::noncopyable {
+    public:
+        /**
+         * Open a commit on the given store
+         *
+         * @param store the store to commit to
+         */
+        CommitGuard(ObjectStore& store);
+
+        /**
+         * Close the commit, publishing a new version if this is the
+         * outermost guard
+         */
+        ~CommitGuard();
+    private:
+        ObjectStore& store;
+    };
+
+    /**
+     * Get the version of the most recently published commit
+     *
+     * @return the current store version
+     */
+    uint64_t getVersion() const;
+
+    /**
+     * The default limit on the number of prior object values kept
+     * for snapshots
+     */
+    static const size_t DEFAULT_SNAPSHOT_HISTORY = 1 << 20;
+
+    /**
+     * Set the limit on the number of prior object values kept for
+     * the active snapshots.  When a commit would exceed the limit,
+     * every snapshot held at that point expires and reads the latest
+     * state from then on, and the history it was keeping is
+     * discarded.
+     *
+     * @param limit the maximum number of prior values to keep
+     */
+    void setSnapshotHistoryLimit(size_t limit);
+
+    /**
+     * Check whether a snapshot has expired because the history it
+     * needed exceeded the limit.
+     *
+     * @param version the version returned by acquireSnapshot()
+     * @return true if reads at the version see the latest state
+     */
+    bool isSnapshotExpired(uint64_t version) const {
+        return version < expired_below;
+    }
+
+    /**
+     * Acquire a snapshot of the store at the current version.  The
+     * state of every object as of that version is retained until
+     * the snapshot is released with releaseSnapshot(), unless the
+     * snapshot expires first.  Waits for the commits in progress,
+     * so it must not be called with a commit open or a region lock
+     * held on the calling thread.
+     *
+     * @return the version of the snapshot
+     */
+    uint64_t acquireSnapshot();
+
+    /**
+     * Release a snapshot that was acquired with acquireSnapshot(),
+     * allowing the history it was keeping alive to be discarded.
+     *
+     * @param version the version returned by acquireSnapshot()
+     */
+    void releaseSnapshot(uint64_t version);
+
+    /**
+     * Set the snapshot version that reads through store clients on
+     * the calling thread should use.
+     *
+     * @param version a pointer to the snapshot version, or NULL to
+     * read the latest state.  The memory is owned by the caller and
+     * must remain valid until it is replaced or cleared.
+     */
+    void setThreadSnapshot(const uint64_t* version);
+
+    /**
+     * Get the snapshot version set for the calling thread with
+     * setThreadSnapshot()
+     *
+     * @return a pointer to the snapshot version or NULL if none is
+     * set
+     */
+    const uint64_t* getThreadSnapshot();
+
+    /**
+     * Take a snapshot of the store and read from it on the calling
+     * thread for the lifetime of the object.  The view that was in
+     * effect on the thread before the guard was created is restored
+     * when it is destroyed.
+     */
+    class SnapshotGuard : private boost::noncopyable {
+    public:
+        /**
+         * Acquire a snapshot of the given store and register it for
+         * reads on the calling thread
+         *
+         * @param store the store to read from
+         */
+        SnapshotGuard(ObjectStore& store);
+
+        /**
+         * Restore the previous view and release the snapshot
+         */
+        ~SnapshotGuard();
+
+        /**
+         * Get the store version the guard is reading at
+         */
+        uint64_t getVersion() const { return version; }
+
+        /**
+         * Check whether the snapshot has expired and the guard is
+         * reading the latest state
+         */
+        bool isExpired() const { return store.isSnapshotExpired(version); }
+    private:
+        ObjectStore& store;
+        uint64_t version;
+        const uint64_t* previous;
+    };
+
+    /**
+     * A single entry in the change journal
+     */
+    struct Change {
+        /**
+         * The kind of change recorded
+         */
+        enum op_t {
+            /** The object was added or updated */
+            UPDATED,
+            /** The object was removed */
+            REMOVED
+        };
+
+        /**
+         * The sequence number of the change.  Sequence numbers start
+         * at 1 and increase by one with each recorded change.
+         */
+        uint64_t seq;
+        /** The class ID of the object */
+        class_id_t class_id;
+        /** The URI of the object */
+        URI uri;
+        /** The kind of change */
+        op_t op;
+    };
+
+    /**
+     * Set the number of changes retained in the change journal.  The
+     * journal is a ring buffer recording every object update and
+     * removal with a sequence number, where adding or removing a
+     * child counts as an update of the parent, so that a consumer that has
+     * seen changes up to some sequence number can catch up with only
+     * the changes since, rather than walking the whole store.
+     * Changing the size discards the current contents; setting it to
+     * zero, the default, disables the journal.
+     *
+     * @param size the maximum number of changes to retain
+     */
+    void setJournalSize(size_t size);
+
+    /**
+     * Get the number of changes retained in the change journal
+     *
+     * @return the journal size, or zero if the journal is disabled
+     */
+    size_t getJournalSize();
+
+    /**
+     * Get the sequence number of the most recently recorded change
+     *
+     * @return the last journal sequence number, or zero if nothing
+     * has been recorded
+     */
+    uint64_t getJournalSeq();
+
+    /**
+     * Get the changes recorded after the given sequence number, in
+     * order.  The same object may appear more than once.
+     *
+     * @param seq the sequence number of the last change already seen
+     * by the caller
+     * @param output a vector to which the changes are appended
+     * @return true if every change since seq was available, or false
+     * if some have already fallen off the journal, in which case the
+     * caller must fall back to a full walk of the store starting
+     * from getJournalSeq()
+     */
+    bool getChangesSince(uint64_t seq, /* out */ std::vector<Change>& output);
+
 private:
     struct ClassContext {
+        ClassContext() : safeListeners(0), unsafeListeners(0) {}
+
         ClassInfo classInfo;
         std::list<ObjectListener*> listeners;
         Region* region;
+
+        // counts of registered listeners by thread safety, read
+        // without the listener lock to route notifications
+        std::atomic<uint32_t> safeListeners;
+        std::atomic<uint32_t> unsafeListeners;
     };
 
     typedef std::unordered_map<std::string, Region*> region_owner_map_t;
@@ -218,22 +493,60 @@ private:
      */
     class NotifQueueProc : public URIQueue::QProcessor {
     public:
-        NotifQueueProc(ObjectStore* store);
+        /**
+         * Which listeners a notification queue delivers to
+         */
+        enum mode_t {
+            /** every listener */
+            ALL,
+            /** listeners that are not thread-safe */
+            SERIAL,
+            /** thread-safe listeners */
+            PARALLEL
+        };
+
+        NotifQueueProc(ObjectStore* store, const std::string& name,
+                       mode_t mode);
 
         // notify all the listeners
         virtual void processItem(const URI& uri,
                                  const boost::any& data);
+        // notify each listener once with all its updates
+        virtual void processItems(const URIQueue::item_batch_t& items);
         virtual const std::string& taskName();
+        void setMode(mode_t mode) { this->mode = mode; }
     private:
         ObjectStore* store;
+        std::string name;
+        mode_t mode;
+
+        bool accepts(const ObjectListener* listener) const;
     };
 
     /**
-     * A URI queue to hold notifications to be processed
+     * Thread manager used to run the notification workers
+     */
+    util::ThreadManager& threadManager;
+
+    /**
+     * A URI queue to hold notifications to be processed on the
+     * serial notification thread
      */
     NotifQueueProc notif_proc;
     URIQueue notif_queue;
 
+    /**
+     * Additional notification queues for thread-safe listeners, each
+     * handling a partition of the URI space
+     */
+    std::vector<std::unique_ptr<NotifQueueProc> > worker_procs;
+    std::vector<std::unique_ptr<URIQueue> > worker_queues;
+
+    /**
+     * True while the notification queues are running
+     */
+    bool started;
+
     /**
      * Mutex for accessing listeners
      */
@@ -244,7 +557,110 @@ private:
      */
     void queueNotification(class_id_t class_id, const URI& uri);
 
+    /**
+     * Held shared by each open commit and exclusively while the
+     * snapshot set changes, so that a snapshot never sees part of a
+     * commit.  It guards the snapshot set.  Lock order: commit_mutex,
+     * then the region locks; no region lock is held while it is
+     * taken.
+     */
+    boost::shared_mutex commit_mutex;
+
+    /**
+     * Thread-local nesting depth of the commit open on the thread
+     */
+    uv_key_t commit_key;
+
+    /**
+     * Version of the most recently published commit
+     */
+    std::atomic<uint64_t> version;
+
+    /**
+     * Versions of the active snapshots
+     */
+    std::multiset<uint64_t> snapshots;
+
+    /**
+     * Limit and current count of the prior values kept for snapshots
+     */
+    size_t history_limit;
+    std::atomic<size_t> history_size;
+
+    /**
+     * Snapshots below this version have expired
+     */
+    std::atomic<uint64_t> expired_below;
+
+    /**
+     * Set when snapshots expired during a commit, so that the history
+     * they kept is discarded once the commit closes
+     */
+    std::atomic<bool> prune_pending;
+
+    /**
+     * Thread-local snapshot version used for reads
+     */
+    uv_key_t snapshot_key;
+
+    void beginCommit();
+    void endCommit();
+
+    /**
+     * Account for a prior value about to be kept for snapshots.  If
+     * the history is full, expire the active snapshots instead.
+     * Called with a commit open and a region lock held.
+     *
+     * @return true if the value should be kept
+     */
+    bool reserveHistory();
+
+    /**
+     * Discard the history no snapshot at or after the given version
+     * needs.  Must be called without any region lock held.
+     */
+    void pruneHistory(uint64_t version);
+
+    /**
+     * Guards the change journal
+     */
+    std::mutex journal_mutex;
+
+    /**
+     * Ring buffer of recent changes; journal_head is the index of
+     * the oldest entry once the ring is full
+     */
+    std::vector<Change> journal;
+    size_t journal_size;
+    size_t journal_head;
+
+    /**
+     * Sequence number of the most recently recorded change
+     */
+    uint64_t journal_seq;
+
+    /**
+     * Record a change in the journal, if it is enabled
+     */
+    void recordChange(class_id_t class_id, const URI& uri, Change::op_t op);
+
+    /**
+     * Get the version that writes in the open commit will be
+     * published as.  Must be called with commit_mutex held.
+     */
+    uint64_t getCommitVersion() const { return version + 1; }
+
+    /**
+     * Check whether any snapshots need the history of objects
+     * modified in the open commit.  Must be called with commit_mutex
+     * held.
+     */
+    bool hasSnapshots() const {
+        return !snapshots.empty() && *snapshots.rbegin() >= expired_below;
+    }
+
     friend class mointernal::StoreClient;
+    friend class Region;
 };
 
 } /* namespace modb */
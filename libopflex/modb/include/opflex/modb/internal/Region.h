@@ -14,9 +14,12 @@
 #ifndef MODB_REGION_H
 #define MODB_REGION_H
 
-#include <mutex>
 #include <string>
 
+#include <pthread.h>
+#include <uv.h>
+
+#include "opflex/modb/ClassStats.h"
 #include "opflex/modb/mo-internal/ObjectInstance.h"
 #include "opflex/modb/mo-internal/StoreClient.h"
 #include "opflex/modb/internal/ClassIndex.h"
@@ -29,7 +32,9 @@ namespace modb {
  *
  * The owner of the data stored in a region is the only writer allowed
  * to modify the data in the region, and must ensure that it does not
- * do so concurrently.
+ * do so concurrently.  Any number of readers may access the region
+ * concurrently with each other; readers are only excluded while a
+ * write is in progress.
  */
 class Region {
 public:
@@ -64,6 +69,25 @@ public:
      */
     void addClass(const ClassInfo& class_info);
 
+    /**
+     * Check whether the calling thread holds a read lock on any
+     * region
+     */
+    static bool isReading();
+
+    /**
+     * Take the region lock shared on the calling thread until the
+     * matching call to endRead().  Reads on the thread in between do
+     * not take the lock again, and a modification of the region on
+     * the thread throws std::logic_error.
+     */
+    void beginRead();
+
+    /**
+     * Release the shared lock taken by beginRead()
+     */
+    void endRead();
+
     /**
      * Check whether an item exists in the region.  Note that it could
      * be deleted between checking for presense and calling get().
@@ -94,6 +118,29 @@ public:
     bool get(const URI& uri,
              /*out*/ std::shared_ptr<const mointernal::ObjectInstance>& oi);
 
+    /**
+     * Get the object instance associated with the specified URI as
+     * of the given snapshot version
+     *
+     * @param uri the URI to look up
+     * @param version a snapshot version acquired from the object
+     * store and not yet released
+     * @param if object is found, a shared ptr to an object instance that
+     * must not be modified.
+     * @return true if object is found.
+     */
+    bool get(const URI& uri, uint64_t version,
+             /*out*/ std::shared_ptr<const mointernal::ObjectInstance>& oi);
+
+    /**
+     * Discard the history that is no longer visible to any snapshot
+     * at or after the given version
+     *
+     * @param version the oldest active snapshot version
+     * @return the number of prior values discarded
+     */
+    size_t pruneHistory(uint64_t version);
+
     /**
      * Set the specified URI to the provided object instance,
      * replacing any existing value
@@ -131,6 +178,20 @@ public:
      */
     bool remove(class_id_t class_id, const URI& uri);
 
+    /**
+     * Remove a batch of objects from the region along with the
+     * relationships to their parents, taking the region lock once.
+     * The relationships are removed even for objects that are not
+     * present.
+     *
+     * @param objects the class IDs and URIs of the objects to remove
+     * @param removed an output vector that will get the objects that
+     * were present and removed
+     * @throws std::out_of_range if a class ID is not registered
+     */
+    void removeAll(const std::vector<reference_t>& objects,
+                   /* out */ std::vector<reference_t>& removed);
+
     /**
      * Add a parent/child relationship between a parent URI (from any
      * region) to a child URI (in this region).
@@ -187,6 +248,29 @@ public:
                      class_id_t child_class,
                      /* out */ std::vector<URI>& output);
 
+    /**
+     * Invoke the visitor for each child of the parent URI and
+     * property while holding the region lock, without copying the
+     * children.  The visitor sees a consistent view of the region and
+     * may read from the store, but must not modify it.  This reads
+     * the live index; StoreClient applies the snapshot of the thread.
+     * Other regions read from the visitor are locked separately.
+     *
+     * @param parent_class the class ID of the parent
+     * @param parent_uri the URI of the parent object
+     * @param parent_prop the property ID in the parent object
+     * @param child_class the class ID of the child
+     * @param visitor the visitor to invoke for each child
+     * @return false if the visitor stopped the iteration early
+     * @throws std::out_of_range If no such class ID is registered
+     * @throws std::logic_error if the visitor modifies the store
+     */
+    bool forEachChild(class_id_t parent_class,
+                      const URI& parent_uri,
+                      prop_id_t parent_prop,
+                      class_id_t child_class,
+                      const uri_visitor_t& visitor);
+
     /**
      * Get the parent for the given child URI.
      *
@@ -236,21 +320,89 @@ public:
     void getObjectsForClass(class_id_t class_id,
                             /* out */ std::unordered_set<URI>& output);
 
+    /**
+     * Invoke the visitor for each object with the given class ID
+     * while holding the region lock, without copying the instance
+     * set.  The visitor sees a consistent view of the region and may
+     * read from the store, but must not modify it.  This reads the
+     * live index; StoreClient applies the snapshot of the thread.
+     * Other regions read from the visitor are locked separately.
+     *
+     * @param class_id the class_id to look up
+     * @param visitor the visitor to invoke for each URI
+     * @return false if the visitor stopped the iteration early
+     * @throws std::out_of_range if the class is not found
+     * @throws std::logic_error if the visitor modifies the store
+     */
+    bool forEachObjectOfClass(class_id_t class_id,
+                              const uri_visitor_t& visitor);
+
+    /**
+     * Add a secondary index on a property of the given class and
+     * populate it from the objects already in the region
+     *
+     * @param class_id the class ID
+     * @param prop the property to index
+     * @return true if the index was added, or false if it already
+     * existed
+     * @throws std::out_of_range if the class is not found
+     */
+    bool addIndex(class_id_t class_id, const PropertyInfo& prop);
+
+    /**
+     * Compute approximate memory accounting for each class in the
+     * region
+     *
+     * @param output a map from class ID to the stats for the class
+     */
+    void getClassStats(/* out */ std::unordered_map<class_id_t,
+                                                    ClassStats>& output);
+
+    /**
+     * Find the objects of the given class whose indexed property
+     * contains the value with the given index key
+     *
+     * @param class_id the class ID
+     * @param prop_id the indexed property
+     * @param key the index key from ClassIndex::indexKey()
+     * @param output an unordered set that will get the output
+     * @throws std::out_of_range if the class is not found or the
+     * property is not indexed
+     */
+    void findByProperty(class_id_t class_id, prop_id_t prop_id,
+                        const std::string& key,
+                        /* out */ std::unordered_set<URI>& output);
+
 private:
     /**
      * The store client associated with this region
      */
     mointernal::StoreClient client;
 
+    /**
+     * The object store that owns the region
+     */
+    ObjectStore* store;
+
     /**
      * The owner identifier for this region
      */
     std::string owner;
 
     /**
-     * Mutex for serializing access to the region
+     * Lock for access to the region.  Read-only operations take the
+     * lock shared while modifications take it exclusively.  Writers
+     * are preferred so that a steady stream of readers cannot starve
+     * the region owner.
      */
-    std::mutex region_mutex;
+    pthread_rwlock_t region_lock;
+
+    /**
+     * Per-thread count of read locks held on the region, so that
+     * readers such as visitors can nest without reacquiring a lock
+     * that a waiting writer would block.
+     */
+    uv_key_t read_depth;
 
     typedef std::unordered_map<class_id_t, ClassIndex> class_map_t;
     typedef std::unordered_map <URI,
@@ -258,6 +410,29 @@ private:
 
     class_map_t class_map;
     uri_map_t uri_map;
+
+    /**
+     * Prior values of an object, each paired with the version that
+     * replaced it, in increasing version order.  A null value means
+     * the object was not present.
+     */
+    typedef std::vector<std::pair<uint64_t,
+                                  std::shared_ptr<const mointernal
+                                                  ::ObjectInstance> > >
+    history_t;
+    typedef std::unordered_map<URI, history_t> history_map_t;
+
+    /**
+     * History of objects modified while snapshots are active
+     */
+    history_map_t history;
+
+    /**
+     * Save the current value of the URI so that active snapshots
+     * continue to see it.  Must be called with the region lock held
+     * exclusively, before the value is replaced.
+     */
+    void recordHistory(const URI& uri);
     obj_set_t roots;
 };
 
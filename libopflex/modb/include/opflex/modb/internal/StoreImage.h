@@ -0,0 +1,100 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*!
+ * @file StoreImage.h
+ * @brief Interface definition file for StoreImage
+ */
+/*
+ * Copyright (c) 2014 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#ifndef MODB_STOREIMAGE_H
+#define MODB_STOREIMAGE_H
+
+#include <cstdio>
+#include <string>
+
+#include "opflex/modb/internal/ObjectStore.h"
+#include "opflex/modb/mo-internal/StoreClient.h"
+
+namespace opflex {
+namespace modb {
+
+/**
+ * @brief Read and write binary images of the managed object
+ * database.
+ *
+ * An image is a versioned, native-endian file that can be mapped
+ * into memory and loaded without parsing.  Objects are grouped by
+ * class and stored as fixed-size records; URIs and string values are
+ * interned in a single string table and referenced by index, and
+ * vector property values live in a shared value pool.  This makes
+ * loading an image much cheaper than reading the equivalent JSON
+ * dump.
+ */
+class StoreImage {
+public:
+    /**
+     * Construct a store image reader/writer for the given store
+     *
+     * @param store the object store
+     */
+    StoreImage(ObjectStore* store);
+
+    /**
+     * Write every object in the store to the given file as a binary
+     * image
+     *
+     * @param file the file to write to
+     * @return true if the image was written successfully
+     */
+    bool write(FILE* file);
+
+    /**
+     * Write every object in the store to the given file name as a
+     * binary image
+     *
+     * @param file the name of the file to write
+     * @return true if the image was written successfully
+     */
+    bool write(const std::string& file);
+
+    /**
+     * Load the managed objects in the given image file into the
+     * store.  The whole load happens as a single commit.  Properties
+     * that no longer match the model are skipped.
+     *
+     * @param file the name of the image file
+     * @param client the store client to use
+     * @param notifs an optional map that will hold update
+     * notifications that should be dispatched as a result of the load
+     * @return the number of managed objects loaded
+     */
+    size_t load(const std::string& file,
+                mointernal::StoreClient& client,
+                /* out */ mointernal::StoreClient::notif_t* notifs = NULL);
+
+    /**
+     * Check whether the given file starts with a store image header
+     *
+     * @param file the name of the file to check
+     * @return true if the file looks like a store image
+     */
+    static bool isImage(const std::string& file);
+
+    /**
+     * The current image format version
+     */
+    static const uint32_t VERSION;
+
+private:
+    ObjectStore* store;
+};
+
+} /* namespace modb */
+} /* namespace opflex */
+
+#endif /* MODB_STOREIMAGE_H */
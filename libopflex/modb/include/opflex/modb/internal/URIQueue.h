@@ -15,15 +15,14 @@
 #define MODB_URIQUEUE_H
 
 #include <mutex>
+#include <vector>
+#include <unordered_set>
 #include <boost/atomic.hpp>
-#include <boost/multi_index_container.hpp>
-#include <boost/multi_index/sequenced_index.hpp>
-#include <boost/multi_index/hashed_index.hpp>
-#include <boost/multi_index/member.hpp>
 #include <boost/any.hpp>
 #include <uv.h>
 
 #include "opflex/modb/URI.h"
+#include "opflex/modb/TraceContext.h"
 #include "opflex/util/ThreadManager.h"
 
 namespace opflex {
@@ -36,9 +35,54 @@ namespace modb {
  * Adding a URI to the queue that is already in the queue may not
  * change the queue.  This ensures the queue length is bounded by the
  * number of unique URIs
+ *
+ * Producers check for duplicates in a set split into shards by the
+ * hash of the URI, each with its own lock, and push new items onto a
+ * lock-free list, so that concurrent producers rarely contend.  The
+ * processor thread takes every queued item in one exchange and hands
+ * them to the processor in batches.
  */
 class URIQueue {
 public:
+    /**
+     * The data stored in a queue item
+     */
+    struct item {
+        /**
+         * Construct an empty item
+         */
+        item() : uri("") {}
+
+        /**
+         * Construct an item for the given URI and data, carrying the
+         * trace context of the calling thread
+         */
+        item(const URI& uri_, const boost::any& data_)
+            : uri(uri_), data(data_),
+              origin(TraceContext::getOrigin()) { }
+
+        /**
+         * The URI for the item
+         */
+        URI uri;
+
+        /**
+         * The data associated with the item
+         */
+        boost::any data;
+
+        /**
+         * The trace origin of the change that queued the item
+         */
+        TraceContext::clock::time_point origin;
+    };
+
+    /**
+     * A batch of items drained from the queue.  The items are owned
+     * by the queue and are valid only for the duration of the call.
+     */
+    typedef std::vector<const item*> item_batch_t;
+
     /**
      * @brief An abstract base class for registering a processor
      * function
@@ -63,6 +107,15 @@ public:
          */
         virtual void processItem(const URI& uri,
                                  const boost::any& data) = 0;
+
+        /**
+         * Process a batch of items drained from the queue together,
+         * in queue order.  The default implementation calls
+         * processItem() on each item.
+         *
+         * @param items the items to process
+         */
+        virtual void processItems(const item_batch_t& items);
     };
 
     /**
@@ -105,34 +158,40 @@ private:
     util::ThreadManager& threadManager;
 
     /**
-     * The data stored in a queue item
+     * An item in the list of queued items
      */
-    struct item {
-        item() : uri("") {}
-        item(const URI& uri_, const boost::any& data_)
-            : uri(uri_), data(data_) { }
+    struct node {
+        node(const URI& uri, const boost::any& data)
+            : it(uri, data), next(nullptr) {}
 
-        URI uri;
-        boost::any data;
+        item it;
+        node* next;
+    };
+
+    /**
+     * A shard of the set of queued URIs
+     */
+    struct shard {
+        std::mutex mutex;
+        std::unordered_set<URI> uris;
     };
 
-    typedef boost::multi_index::multi_index_container<
-        item,
-        boost::multi_index::indexed_by<
-            boost::multi_index::sequenced<>,
-            boost::multi_index::hashed_unique<
-                boost::multi_index::member<item,
-                                           URI,
-                                           &item::uri> >
-            >
-        > item_queue_t;
+    static const size_t SHARDS = 16;
+
+    shard& getShard(const URI& uri);
 
     /**
-     * A notification queue that will be have duplicates removed
+     * The URIs that are queued and not yet taken by the processor
+     * thread, used to remove duplicates
      */
-    item_queue_t item_queue;
+    shard queued[SHARDS];
+
+    /**
+     * The queued items, most recent first
+     */
+    boost::atomic<node*> item_head;
+
     uv_loop_t* item_loop;
-    std::mutex item_mutex;
     uv_async_t item_async;
     uv_async_t cleanup_async;
 
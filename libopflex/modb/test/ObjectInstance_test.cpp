@@ -170,4 +170,128 @@ BOOST_AUTO_TEST_CASE( vector ) {
 
 }
 
+BOOST_AUTO_TEST_CASE( order_and_copy ) {
+    ObjectInstance o1(1);
+    o1.setUInt64(7, 7);
+    o1.setString(3, "three");
+    const std::vector<MAC> macv =
+        list_of(MAC("11:22:33:44:55:66"))(MAC("77:88:99:AA:BB:CC"));
+    o1.setMAC(5, macv);
+    o1.setUInt64(1, 1);
+
+    ObjectInstance o2(1);
+    o2.setUInt64(1, 1);
+    o2.setMAC(5, macv);
+    o2.setString(3, "three");
+    o2.setUInt64(7, 7);
+    BOOST_CHECK(o1 == o2);
+
+    ObjectInstance o3(o1);
+    BOOST_CHECK(o1 == o3);
+    BOOST_CHECK_EQUAL(2, o3.getMACSize(5));
+    BOOST_CHECK_EQUAL(MAC("77:88:99:AA:BB:CC"), o3.getMAC(5, 1));
+    BOOST_CHECK_EQUAL(7, o3.getUInt64(7));
+    BOOST_CHECK_THROW(o3.getUInt64(3), std::out_of_range);
+
+    o3.unset(3, PropertyInfo::STRING, PropertyInfo::SCALAR);
+    BOOST_CHECK(o1 != o3);
+    BOOST_CHECK_EQUAL("three", o1.getString(3));
+}
+
+BOOST_AUTO_TEST_CASE( find ) {
+    ObjectInstance oi(1);
+    BOOST_CHECK(oi.findUInt64(1) == NULL);
+    oi.setUInt64(1, 42);
+    oi.setInt64(2, -42);
+    oi.setString(3, "test");
+    oi.setReference(4, 2, URI("/ref/"));
+    oi.setMAC(5, MAC("aa:bb:cc:dd:ee:ff"));
+    oi.addUInt64(6, 1);
+
+    BOOST_REQUIRE(oi.findUInt64(1) != NULL);
+    BOOST_CHECK_EQUAL(42, *oi.findUInt64(1));
+    BOOST_REQUIRE(oi.findInt64(2) != NULL);
+    BOOST_CHECK_EQUAL(-42, *oi.findInt64(2));
+    BOOST_REQUIRE(oi.findString(3) != NULL);
+    BOOST_CHECK_EQUAL("test", *oi.findString(3));
+    BOOST_REQUIRE(oi.findReference(4) != NULL);
+    BOOST_CHECK_EQUAL(URI("/ref/"), oi.findReference(4)->second);
+    BOOST_REQUIRE(oi.findMAC(5) != NULL);
+    BOOST_CHECK_EQUAL(MAC("aa:bb:cc:dd:ee:ff"), *oi.findMAC(5));
+
+    // wrong type or cardinality is not found
+    BOOST_CHECK(oi.findInt64(1) == NULL);
+    BOOST_CHECK(oi.findUInt64(6) == NULL);
+
+    // deltas read through to the base
+    std::shared_ptr<const ObjectInstance> base =
+        std::make_shared<ObjectInstance>(oi);
+    ObjectInstance d(base);
+    BOOST_REQUIRE(d.findUInt64(1) != NULL);
+    BOOST_CHECK_EQUAL(42, *d.findUInt64(1));
+    d.unset(1, PropertyInfo::U64, PropertyInfo::SCALAR);
+    BOOST_CHECK(d.findUInt64(1) == NULL);
+}
+
+BOOST_AUTO_TEST_CASE( delta ) {
+    std::shared_ptr<ObjectInstance> base =
+        std::make_shared<ObjectInstance>(1, false);
+    base->setUInt64(1, 1);
+    base->setString(3, "three");
+    base->addString(4, "a");
+
+    std::shared_ptr<ObjectInstance> d =
+        std::make_shared<ObjectInstance>(
+            std::shared_ptr<const ObjectInstance>(base));
+    BOOST_CHECK(d->isDelta());
+    BOOST_CHECK(!d->isLocal());
+    BOOST_CHECK(!d->hasChanges());
+
+    // unmodified properties read through to the base
+    BOOST_CHECK_EQUAL(1, d->getUInt64(1));
+    BOOST_CHECK_EQUAL("three", d->getString(3));
+
+    // setting the same value is not a change
+    d->setUInt64(1, 1);
+    BOOST_CHECK(!d->hasChanges());
+
+    // vector adds copy the base property first
+    d->addString(4, "b");
+    BOOST_CHECK(d->hasChanges());
+    BOOST_CHECK_EQUAL(2, d->getStringSize(4));
+    BOOST_CHECK_EQUAL(1, base->getStringSize(4));
+
+    BOOST_CHECK(d->unset(3, PropertyInfo::STRING, PropertyInfo::SCALAR));
+    BOOST_CHECK(!d->isSet(3, PropertyInfo::STRING));
+    BOOST_CHECK_EQUAL("three", base->getString(3));
+
+    std::shared_ptr<ObjectInstance> merged = d->merge();
+    BOOST_CHECK(!merged->isDelta());
+    BOOST_CHECK(!merged->isLocal());
+    BOOST_CHECK_EQUAL(1, merged->getUInt64(1));
+    BOOST_CHECK(!merged->isSet(3, PropertyInfo::STRING));
+    BOOST_CHECK_EQUAL("b", merged->getString(4, 1));
+    BOOST_CHECK(*merged == *d->merge());
+    BOOST_CHECK(*merged != *d);
+
+    // deltas with the same effect are still different deltas
+    std::shared_ptr<ObjectInstance> d2 =
+        std::make_shared<ObjectInstance>(
+            std::shared_ptr<const ObjectInstance>(base));
+    d2->addString(4, "b");
+    d2->unset(3, PropertyInfo::STRING, PropertyInfo::SCALAR);
+    BOOST_CHECK(*d2->merge() == *d->merge());
+    BOOST_CHECK(*d2 != *d);
+    d2->setUInt64(1, 1);
+    BOOST_CHECK(*d2 == *d);
+
+    // rebasing keeps the recorded changes
+    std::shared_ptr<ObjectInstance> base2 =
+        std::make_shared<ObjectInstance>(*merged);
+    base2->setUInt64(5, 5);
+    d->rebase(base2);
+    BOOST_CHECK(!d->hasChanges());
+    BOOST_CHECK_EQUAL(5, d->merge()->getUInt64(5));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -19,8 +19,13 @@
 #include <vector>
 #include <algorithm>
 #include <unistd.h>
+#include <thread>
+#include <atomic>
 
 #include "opflex/modb/internal/ObjectStore.h"
+#include "opflex/modb/internal/StoreImage.h"
+#include "opflex/modb/URIBuilder.h"
+#include "opflex/modb/TraceContext.h"
 #include "BaseFixture.h"
 #include "TestListener.h"
 
@@ -179,4 +184,825 @@ BOOST_FIXTURE_TEST_CASE( tree, BaseFixture ) {
     output.clear();
 }
 
+BOOST_FIXTURE_TEST_CASE( remove_subtree, BaseFixture ) {
+    mointernal::StoreClient& sysClient = db.getStoreClient("_SYSTEM_");
+    URI uri1("/");
+    sysClient.put(1, uri1, std::make_shared<ObjectInstance>(1));
+
+    vector<URI> uris2, uris3;
+    for (int i = 0; i < 200; ++i) {
+        URI uri2(URIBuilder().addElement("prop3").addElement(i).build());
+        URI uri3(URIBuilder(uri2).addElement("prop5").addElement(i).build());
+        sysClient.put(2, uri2, std::make_shared<ObjectInstance>(2));
+        sysClient.put(3, uri3, std::make_shared<ObjectInstance>(3));
+        sysClient.addChild(1, uri1, 3, 2, uri2);
+        sysClient.addChild(2, uri2, 5, 3, uri3);
+        uris2.push_back(uri2);
+        uris3.push_back(uri3);
+    }
+
+    // a client that doesn't own the whole subtree can't remove it,
+    // and nothing is removed
+    BOOST_CHECK_THROW(client1->removeChildren(1, uri1, NULL),
+                      invalid_argument);
+    BOOST_CHECK(sysClient.isPresent(2, uris2[0]));
+    BOOST_CHECK(sysClient.isPresent(3, uris3[0]));
+
+    mointernal::StoreClient::notif_t notifs;
+    BOOST_CHECK(sysClient.remove(1, uri1, true, &notifs));
+    BOOST_CHECK_EQUAL(400, notifs.size());
+    for (int i = 0; i < 200; ++i) {
+        BOOST_CHECK(!sysClient.isPresent(2, uris2[i]));
+        BOOST_CHECK(!sysClient.isPresent(3, uris3[i]));
+        BOOST_CHECK_EQUAL(2, notifs.at(uris2[i]));
+        BOOST_CHECK_EQUAL(3, notifs.at(uris3[i]));
+    }
+
+    vector<URI> output;
+    sysClient.getChildren(1, uri1, 3, 2, output);
+    BOOST_CHECK(output.empty());
+    sysClient.getChildren(2, uris2[0], 5, 3, output);
+    BOOST_CHECK(output.empty());
+
+    // the removed objects are not left behind as roots
+    Region::obj_set_t roots;
+    db.getRegion(2)->getRoots(roots);
+    db.getRegion(3)->getRoots(roots);
+    BOOST_CHECK(roots.empty());
+}
+
+BOOST_FIXTURE_TEST_CASE( concurrent_read, BaseFixture ) {
+    URI uri1("/");
+    URI uri2("/prop3/42");
+    std::shared_ptr<ObjectInstance> oi1 =
+        std::shared_ptr<ObjectInstance>(new ObjectInstance(1));
+    std::shared_ptr<ObjectInstance> oi2 =
+        std::shared_ptr<ObjectInstance>(new ObjectInstance(2));
+    oi2->setInt64(4, 0);
+    client1->put(1, uri1, oi1);
+    client1->put(2, uri2, oi2);
+    client1->addChild(1, uri1, 3, 2, uri2);
+
+    std::atomic<bool> done(false);
+    std::atomic<int> errors(0);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&]() {
+            while (!done) {
+                std::shared_ptr<const ObjectInstance> oi;
+                if (!client2->get(2, uri2, oi) || oi->getInt64(4) < 0)
+                    errors += 1;
+                vector<URI> output;
+                client2->getChildren(1, uri1, 3, 2, output);
+                if (output.size() != 1)
+                    errors += 1;
+            }
+        });
+    }
+
+    for (int64_t i = 1; i <= 1000; ++i) {
+        std::shared_ptr<ObjectInstance> noi =
+            std::shared_ptr<ObjectInstance>(new ObjectInstance(*oi2));
+        noi->setInt64(4, i);
+        client1->put(2, uri2, noi);
+    }
+    done = true;
+    for (std::thread& t : readers)
+        t.join();
+
+    BOOST_CHECK_EQUAL(0, errors);
+    BOOST_CHECK_EQUAL(1000, client2->get(2, uri2)->getInt64(4));
+}
+
+BOOST_FIXTURE_TEST_CASE( get_all, BaseFixture ) {
+    URI uri1("/");
+    URI uri2("/prop3/1");
+    URI uri3("/prop3/2");
+    std::shared_ptr<ObjectInstance> oi1(new ObjectInstance(1));
+    oi1->setUInt64(1, 1);
+    client1->put(1, uri1, oi1);
+    client1->put(2, uri2,
+                 std::shared_ptr<ObjectInstance>(new ObjectInstance(2)));
+
+    vector<reference_t> refs;
+    refs.push_back(std::make_pair(2, uri2));
+    refs.push_back(std::make_pair(1, uri1));
+    refs.push_back(std::make_pair(2, uri3));
+    refs.push_back(std::make_pair(999, uri1));
+    vector<std::shared_ptr<const ObjectInstance> > ois;
+    client2->getAll(refs, ois);
+    BOOST_REQUIRE_EQUAL(4, ois.size());
+    BOOST_CHECK(ois[0]);
+    BOOST_REQUIRE(ois[1]);
+    BOOST_CHECK_EQUAL(1, ois[1]->getUInt64(1));
+    BOOST_CHECK(!ois[2]);
+    BOOST_CHECK(!ois[3]);
+
+    {
+        // reads honor the snapshot of the thread
+        const ObjectStore::SnapshotGuard guard(db);
+        client1->remove(2, uri2, false);
+        client2->getAll(refs, ois);
+        BOOST_CHECK(ois[0]);
+    }
+    client2->getAll(refs, ois);
+    BOOST_CHECK(!ois[0]);
+
+    // reads nest inside a region read, but modifications do not
+    Region* region = db.getRegion("owner1");
+    region->beginRead();
+    region->beginRead();
+    BOOST_CHECK(client2->isPresent(1, uri1));
+    region->endRead();
+    BOOST_CHECK_THROW(client1->put(2, uri2, std::shared_ptr<ObjectInstance>
+                                   (new ObjectInstance(2))),
+                      std::logic_error);
+    region->endRead();
+    client1->put(2, uri2,
+                 std::shared_ptr<ObjectInstance>(new ObjectInstance(2)));
+    BOOST_CHECK(client2->isPresent(2, uri2));
+}
+
+class BatchTestListener : public TestListener {
+public:
+    BatchTestListener() : single(0), batched(0) {}
+
+    virtual void objectUpdated(class_id_t class_id, const URI& uri) {
+        single += 1;
+        TestListener::objectUpdated(class_id, uri);
+    }
+
+    virtual void objectsUpdated(const update_list_t& updates) {
+        const std::lock_guard<std::mutex> lock(uri_mutex);
+        for (const update_list_t::value_type& u : updates) {
+            notifs.insert(u.second);
+            batched += 1;
+        }
+    }
+
+    std::atomic<int> single;
+    std::atomic<int> batched;
+};
+
+BOOST_FIXTURE_TEST_CASE( batch_notify, BaseFixture ) {
+    BatchTestListener listener;
+    db.registerListener(1, &listener);
+    db.registerListener(2, &listener);
+
+    URI uri1("/");
+    client1->put(1, uri1,
+                 std::shared_ptr<ObjectInstance>(new ObjectInstance(1)));
+    std::unordered_map<URI, class_id_t> notifs;
+    client1->queueNotification(1, uri1, notifs);
+
+    vector<URI> uris;
+    for (int i = 0; i < 100; ++i) {
+        URI uri(URIBuilder().addElement("prop3").addElement(i).build());
+        client1->put(2, uri,
+                     std::shared_ptr<ObjectInstance>(new ObjectInstance(2)));
+        client1->addChild(1, uri1, 3, 2, uri);
+        client1->queueNotification(2, uri, notifs);
+        uris.push_back(uri);
+    }
+    client1->deliverNotifications(notifs);
+
+    WAIT_FOR(listener.batched == 101, 500);
+    for (const URI& uri : uris)
+        BOOST_CHECK(listener.contains(uri));
+    BOOST_CHECK(listener.contains(uri1));
+    BOOST_CHECK_EQUAL(0, listener.single);
+
+    db.unregisterListener(1, &listener);
+    db.unregisterListener(2, &listener);
+}
+
+class TraceTestListener : public TestListener {
+public:
+    virtual void objectUpdated(class_id_t class_id, const URI& uri) {
+        const std::lock_guard<std::mutex> lock(uri_mutex);
+        origin = TraceContext::getOrigin();
+        notifs.insert(uri);
+    }
+
+    TraceContext::clock::time_point origin;
+};
+
+BOOST_FIXTURE_TEST_CASE( trace_context, BaseFixture ) {
+    TraceTestListener listener;
+    db.registerListener(1, &listener);
+
+    BOOST_CHECK(!TraceContext::isTraced());
+    const TraceContext::clock::time_point origin =
+        TraceContext::clock::now() - std::chrono::milliseconds(5);
+    URI uri1("/");
+    {
+        const TraceContext::Scope trace(origin);
+        BOOST_CHECK(TraceContext::isTraced());
+        BOOST_CHECK(TraceContext::getOrigin() == origin);
+        BOOST_CHECK(TraceContext::getStart() >= origin);
+        client1->put(1, uri1,
+                     std::shared_ptr<ObjectInstance>(new ObjectInstance(1)));
+        std::unordered_map<URI, class_id_t> notifs;
+        client1->queueNotification(1, uri1, notifs);
+        client1->deliverNotifications(notifs);
+    }
+    BOOST_CHECK(!TraceContext::isTraced());
+
+    WAIT_FOR(listener.contains(uri1), 500);
+    {
+        const std::lock_guard<std::mutex> lock(listener.uri_mutex);
+        BOOST_CHECK(listener.origin == origin);
+    }
+
+    db.unregisterListener(1, &listener);
+}
+
+BOOST_FIXTURE_TEST_CASE( snapshot, BaseFixture ) {
+    URI uri1("/");
+    URI uri2("/prop3/1");
+    std::shared_ptr<ObjectInstance> oi1(new ObjectInstance(1));
+    oi1->setUInt64(1, 1);
+    client1->put(1, uri1, oi1);
+    uint64_t v1 = db.getVersion();
+
+    uint64_t snap1 = db.acquireSnapshot();
+    BOOST_CHECK_EQUAL(v1, snap1);
+
+    {
+        // changes made in one commit become visible together
+        const ObjectStore::CommitGuard commit(db);
+        std::shared_ptr<ObjectInstance> oi2(new ObjectInstance(*oi1));
+        oi2->setUInt64(1, 2);
+        client1->put(1, uri1, oi2);
+        oi2.reset(new ObjectInstance(*oi1));
+        oi2->setUInt64(1, 3);
+        client1->put(1, uri1, oi2);
+        client1->put(2, uri2,
+                     std::shared_ptr<ObjectInstance>(new ObjectInstance(2)));
+    }
+    BOOST_CHECK_EQUAL(v1 + 1, db.getVersion());
+    uint64_t snap2 = db.acquireSnapshot();
+    client1->remove(1, uri1, false);
+
+    BOOST_CHECK_EQUAL(false, client1->isPresent(1, uri1));
+    db.setThreadSnapshot(&snap1);
+    BOOST_CHECK_EQUAL(1, client1->get(1, uri1)->getUInt64(1));
+    BOOST_CHECK_EQUAL(false, client1->isPresent(2, uri2));
+    BOOST_CHECK_THROW(client1->get(2, uri2), out_of_range);
+
+    db.setThreadSnapshot(&snap2);
+    BOOST_CHECK_EQUAL(3, client1->get(1, uri1)->getUInt64(1));
+    BOOST_CHECK_EQUAL(true, client1->isPresent(2, uri2));
+
+    // releasing the older snapshot keeps the history the newer needs
+    db.releaseSnapshot(snap1);
+    BOOST_CHECK_EQUAL(3, client1->get(1, uri1)->getUInt64(1));
+
+    db.setThreadSnapshot(NULL);
+    db.releaseSnapshot(snap2);
+    BOOST_CHECK_EQUAL(false, client1->isPresent(1, uri1));
+    BOOST_CHECK_EQUAL(true, client1->isPresent(2, uri2));
+
+    {
+        // a guard reads at its own version until it is destroyed
+        const ObjectStore::SnapshotGuard guard(db);
+        BOOST_CHECK(db.getThreadSnapshot() != NULL);
+        client1->remove(2, uri2, false);
+        BOOST_CHECK_EQUAL(true, client1->isPresent(2, uri2));
+    }
+    BOOST_CHECK(db.getThreadSnapshot() == NULL);
+    BOOST_CHECK_EQUAL(false, client1->isPresent(2, uri2));
+}
+
+BOOST_FIXTURE_TEST_CASE( snapshot_history_limit, BaseFixture ) {
+    URI uri1("/");
+    URI uri2("/prop3/1");
+    std::shared_ptr<ObjectInstance> oi1(new ObjectInstance(1));
+    oi1->setUInt64(1, 1);
+    client1->put(1, uri1, oi1);
+    db.setSnapshotHistoryLimit(1);
+
+    uint64_t snap1 = db.acquireSnapshot();
+    std::shared_ptr<ObjectInstance> oi2(new ObjectInstance(*oi1));
+    oi2->setUInt64(1, 2);
+    client1->put(1, uri1, oi2);
+    BOOST_CHECK(!db.isSnapshotExpired(snap1));
+    db.setThreadSnapshot(&snap1);
+    BOOST_CHECK_EQUAL(1, client1->get(1, uri1)->getUInt64(1));
+
+    // a second prior value is over the limit, so the snapshot
+    // expires and reads the latest state
+    client1->put(2, uri2,
+                 std::shared_ptr<ObjectInstance>(new ObjectInstance(2)));
+    BOOST_CHECK(db.isSnapshotExpired(snap1));
+    BOOST_CHECK_EQUAL(2, client1->get(1, uri1)->getUInt64(1));
+    BOOST_CHECK_EQUAL(true, client1->isPresent(2, uri2));
+    db.setThreadSnapshot(NULL);
+
+    {
+        // the expired history was discarded, so a new snapshot can
+        // keep its own
+        const ObjectStore::SnapshotGuard guard(db);
+        client1->remove(2, uri2, false);
+        BOOST_CHECK(!guard.isExpired());
+        BOOST_CHECK_EQUAL(true, client1->isPresent(2, uri2));
+    }
+    db.releaseSnapshot(snap1);
+    BOOST_CHECK_EQUAL(false, client1->isPresent(2, uri2));
+}
+
+BOOST_FIXTURE_TEST_CASE( commit_lock_order, BaseFixture ) {
+    URI uri1("/");
+    URI uri3("/class3/1");
+
+    // commits in different regions do not wait for each other
+    std::atomic<bool> done(false);
+    std::thread writer;
+    {
+        const ObjectStore::CommitGuard commit(db);
+        client1->put(1, uri1,
+                     std::shared_ptr<ObjectInstance>(new ObjectInstance(1)));
+        writer = std::thread([&]() {
+                client2->put(3, uri3, std::shared_ptr<ObjectInstance>
+                             (new ObjectInstance(3)));
+                done = true;
+            });
+        WAIT_FOR(done, 1000);
+    }
+    writer.join();
+
+    // a snapshot waits for the open commits
+    done = false;
+    std::thread reader;
+    {
+        const ObjectStore::CommitGuard commit(db);
+        reader = std::thread([&]() {
+                const ObjectStore::SnapshotGuard guard(db);
+                done = true;
+            });
+        usleep(50000);
+        BOOST_CHECK(!done);
+    }
+    reader.join();
+    BOOST_CHECK(done);
+
+    // the commit lock is taken before any region lock
+    Region* region = db.getRegion("owner2");
+    region->beginRead();
+    BOOST_CHECK_THROW(client1->put(1, uri1, std::shared_ptr<ObjectInstance>
+                                   (new ObjectInstance(1))),
+                      std::logic_error);
+    BOOST_CHECK_THROW(db.acquireSnapshot(), std::logic_error);
+    region->endRead();
+
+    // writers in both regions, snapshot readers and snapshot releases
+    // running together neither deadlock nor see a partial commit
+    std::vector<URI> uris2, uris3;
+    for (int t = 0; t < 2; ++t) {
+        uris2.push_back(URIBuilder().addElement("class2")
+                        .addElement(t).build());
+        uris3.push_back(URIBuilder().addElement("class3")
+                        .addElement(t).build());
+    }
+    std::atomic<bool> stop(false);
+    std::atomic<size_t> torn(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 2; ++t) {
+        threads.emplace_back([&, t]() {
+                for (int64_t i = 0; !stop; ++i) {
+                    const ObjectStore::CommitGuard commit(db);
+                    std::shared_ptr<ObjectInstance>
+                        oi2(new ObjectInstance(2));
+                    oi2->setInt64(4, i);
+                    client1->put(2, uris2[t], oi2);
+                    std::shared_ptr<ObjectInstance>
+                        oi3(new ObjectInstance(3));
+                    oi3->setInt64(6, i);
+                    client2->put(3, uris3[t], oi3);
+                }
+            });
+    }
+    for (int t = 0; t < 2; ++t) {
+        threads.emplace_back([&]() {
+                while (!stop) {
+                    const ObjectStore::SnapshotGuard guard(db);
+                    for (int w = 0; w < 2; ++w) {
+                        std::shared_ptr<const ObjectInstance> oi2, oi3;
+                        bool p2 = client1->get(2, uris2[w], oi2);
+                        bool p3 = client2->get(3, uris3[w], oi3);
+                        if (p2 != p3 ||
+                            (p2 && oi2->getInt64(4) != oi3->getInt64(6)))
+                            torn += 1;
+                    }
+                }
+            });
+    }
+    usleep(200000);
+    stop = true;
+    for (std::thread& t : threads)
+        t.join();
+    BOOST_CHECK_EQUAL(0, torn);
+}
+
+BOOST_FIXTURE_TEST_CASE( property_index, BaseFixture ) {
+    URI uri1("/");
+    URI uri2("/prop3/1");
+    URI uri3("/prop3/2");
+    std::shared_ptr<ObjectInstance> oi1(new ObjectInstance(1));
+    oi1->setUInt64(1, 42);
+    oi1->addString(2, "a");
+    oi1->addString(2, "b");
+    client1->put(1, uri1, oi1);
+
+    // existing objects are indexed when the index is added
+    db.addIndex(1, 1);
+    db.addIndex(1, 2);
+    db.addIndex(2, 15);
+    BOOST_CHECK_THROW(db.addIndex(1, 3), invalid_argument);
+    BOOST_CHECK_THROW(db.addIndex(1, 4), out_of_range);
+
+    std::unordered_set<URI> found;
+    client1->findByProperty(1, 1, (uint64_t)42, found);
+    BOOST_CHECK_EQUAL(1, found.size());
+    BOOST_CHECK(found.count(uri1));
+    found.clear();
+    client1->findByProperty(1, 2, std::string("b"), found);
+    BOOST_CHECK_EQUAL(1, found.size());
+    found.clear();
+    BOOST_CHECK_THROW(client1->findByProperty(2, 4, (uint64_t)1, found),
+                      out_of_range);
+
+    MAC mac("aa:bb:cc:dd:ee:ff");
+    std::shared_ptr<ObjectInstance> oi2(new ObjectInstance(2));
+    oi2->setMAC(15, mac);
+    client1->put(2, uri2, oi2);
+    client1->putIfModified(2, uri3, oi2);
+    client1->findByProperty(2, 15, mac, found);
+    BOOST_CHECK_EQUAL(2, found.size());
+    found.clear();
+
+    // modifications move the object to its new value
+    std::shared_ptr<ObjectInstance> oi3(new ObjectInstance(*oi1));
+    oi3->setUInt64(1, 43);
+    oi3->setString(2, std::vector<std::string>());
+    client1->putIfModified(1, uri1, oi3);
+    client1->findByProperty(1, 1, (uint64_t)42, found);
+    BOOST_CHECK_EQUAL(0, found.size());
+    client1->findByProperty(1, 2, std::string("b"), found);
+    BOOST_CHECK_EQUAL(0, found.size());
+    client1->findByProperty(1, 1, (uint64_t)43, found);
+    BOOST_CHECK_EQUAL(1, found.size());
+    found.clear();
+
+    client1->remove(2, uri2, false);
+    client1->findByProperty(2, 15, mac, found);
+    BOOST_CHECK_EQUAL(1, found.size());
+    BOOST_CHECK(found.count(uri3));
+}
+
+BOOST_FIXTURE_TEST_CASE( class_stats, BaseFixture ) {
+    URI uri1("/");
+    std::shared_ptr<ObjectInstance> oi1(new ObjectInstance(1));
+    oi1->setUInt64(1, 42);
+    client1->put(1, uri1, oi1);
+    for (int i = 0; i < 10; ++i) {
+        URI uri(URIBuilder().addElement("prop3").addElement(i).build());
+        client1->put(2, uri,
+                     std::shared_ptr<ObjectInstance>(new ObjectInstance(2)));
+        client1->addChild(1, uri1, 3, 2, uri);
+    }
+
+    class_stats_map_t stats;
+    db.getClassStats(stats);
+    BOOST_CHECK_EQUAL(1, stats["class1"].instances);
+    BOOST_CHECK_EQUAL(10, stats["class2"].instances);
+    BOOST_CHECK_EQUAL(0, stats["class3"].instances);
+    BOOST_CHECK(stats["class1"].propBytes >= oi1->getMemoryUsage());
+    BOOST_CHECK(stats["class2"].indexBytes > stats["class1"].indexBytes);
+
+    // a longer string property is accounted for
+    uint64_t before = stats["class1"].propBytes;
+    std::shared_ptr<ObjectInstance> oi2(new ObjectInstance(*oi1));
+    oi2->addString(2, std::string(1000, 'a'));
+    client1->put(1, uri1, oi2);
+    stats.clear();
+    db.getClassStats(stats);
+    BOOST_CHECK(stats["class1"].propBytes >= before + 1000);
+    BOOST_CHECK_EQUAL(stats["class1"].propBytes +
+                      stats["class1"].indexBytes +
+                      stats["class1"].uriBytes,
+                      stats["class1"].getBytes());
+}
+
+BOOST_FIXTURE_TEST_CASE( store_image, BaseFixture ) {
+    URI uri1("/");
+    std::shared_ptr<ObjectInstance> oi1(new ObjectInstance(1));
+    oi1->setUInt64(1, 42);
+    oi1->addString(2, "test1");
+    oi1->addString(2, "test2");
+    client1->put(1, uri1, oi1);
+
+    URI uri2(URIBuilder().addElement("prop3").addElement(1).build());
+    std::shared_ptr<ObjectInstance> oi2(new ObjectInstance(2));
+    oi2->setInt64(4, -17);
+    oi2->setMAC(15, MAC("aa:bb:cc:dd:ee:ff"));
+    client1->put(2, uri2, oi2);
+    client1->addChild(1, uri1, 3, 2, uri2);
+
+    URI uri5(URIBuilder().addElement("class5").addElement("r").build());
+    std::shared_ptr<ObjectInstance> oi5(new ObjectInstance(5));
+    oi5->setString(10, "test1");
+    oi5->addReference(11, 4, URI("/class4/a"));
+    oi5->addReference(11, 4, URI("/class4/b"));
+    client2->put(5, uri5, oi5);
+    client2->addChild(1, uri1, 24, 5, uri5);
+
+    // an empty vector is set, unlike a vector that was never set
+    URI uri5e(URIBuilder().addElement("class5").addElement("e").build());
+    std::shared_ptr<ObjectInstance> oi5e(new ObjectInstance(5));
+    oi5e->setReference(11, vector<reference_t>());
+    client2->put(5, uri5e, oi5e);
+    client2->addChild(1, uri1, 24, 5, uri5e);
+
+    char path[] = "/tmp/modb-image-XXXXXX";
+    int fd = mkstemp(path);
+    BOOST_REQUIRE(fd >= 0);
+    close(fd);
+    BOOST_REQUIRE(StoreImage(&db).write(std::string(path)));
+    BOOST_CHECK(StoreImage::isImage(path));
+
+    opflex::util::ThreadManager threadManager2;
+    ObjectStore db2(threadManager2);
+    db2.init(md);
+    db2.start();
+    mointernal::StoreClient& sysClient = db2.getStoreClient("_SYSTEM_");
+    mointernal::StoreClient::notif_t notifs;
+    BOOST_CHECK_EQUAL(4, StoreImage(&db2).load(path, sysClient, &notifs));
+    BOOST_CHECK_EQUAL(4, notifs.size());
+
+    BOOST_CHECK(*oi1 == *sysClient.get(1, uri1));
+    BOOST_CHECK(*oi2 == *sysClient.get(2, uri2));
+    BOOST_CHECK(*oi5 == *sysClient.get(5, uri5));
+    BOOST_CHECK(*oi5e == *sysClient.get(5, uri5e));
+    BOOST_CHECK(sysClient.get(5, uri5e)->isSet(11, PropertyInfo::REFERENCE,
+                                               PropertyInfo::VECTOR));
+    std::pair<URI, prop_id_t> parent(URI::ROOT, 0);
+    BOOST_CHECK(sysClient.getParent(2, uri2, parent));
+    BOOST_CHECK_EQUAL(uri1, parent.first);
+    BOOST_CHECK_EQUAL(3, parent.second);
+    BOOST_CHECK(sysClient.getParent(5, uri5, parent));
+    BOOST_CHECK_EQUAL(24, parent.second);
+    db2.stop();
+
+    // a truncated image is rejected
+    BOOST_REQUIRE(truncate(path, 64) == 0);
+    opflex::util::ThreadManager threadManager3;
+    ObjectStore db3(threadManager3);
+    db3.init(md);
+    db3.start();
+    BOOST_CHECK_EQUAL(0, StoreImage(&db3).load(path,
+                                               db3.getStoreClient("_SYSTEM_")));
+    db3.stop();
+    unlink(path);
+}
+
+BOOST_FIXTURE_TEST_CASE( visitors, BaseFixture ) {
+    URI uri1("/");
+    client1->put(1, uri1, std::make_shared<ObjectInstance>(1));
+    std::unordered_set<URI> expected;
+    for (int i = 0; i < 5; ++i) {
+        URI uri(URIBuilder().addElement("prop3").addElement(i).build());
+        client1->put(2, uri, std::make_shared<ObjectInstance>(2));
+        client1->addChild(1, uri1, 3, 2, uri);
+        expected.insert(uri);
+    }
+
+    std::unordered_set<URI> seen;
+    BOOST_CHECK(client1->forEachObjectOfClass(2, [&](const URI& uri) {
+                return seen.insert(uri).second;
+            }));
+    BOOST_CHECK(expected == seen);
+
+    // visitors may read from the region being visited
+    seen.clear();
+    BOOST_CHECK(client1->forEachChild(1, uri1, 3, 2, [&](const URI& uri) {
+                BOOST_CHECK(client1->isPresent(2, uri));
+                seen.insert(uri);
+                return true;
+            }));
+    BOOST_CHECK(expected == seen);
+
+    // returning false stops the iteration
+    size_t count = 0;
+    BOOST_CHECK(!client1->forEachChild(1, uri1, 3, 2, [&](const URI&) {
+                return ++count < 2;
+            }));
+    BOOST_CHECK_EQUAL(2, count);
+
+    BOOST_CHECK(client1->forEachChild(1, URI("/nothing"), 3, 2,
+                                      [](const URI&) { return false; }));
+
+    // but must not modify it
+    BOOST_CHECK_THROW(client1->forEachObjectOfClass(2, [&](const URI& uri) {
+                client1->remove(2, uri, false);
+                return true;
+            }), std::logic_error);
+    BOOST_CHECK(client1->isPresent(2, *expected.begin()));
+    BOOST_CHECK_THROW(client1->forEachObjectOfClass(42, [](const URI&) {
+                return true;
+            }), out_of_range);
+
+    {
+        // objects created after the snapshot of the thread are skipped
+        const ObjectStore::SnapshotGuard guard(db);
+        URI added(URIBuilder().addElement("prop3").addElement(5).build());
+        client1->put(2, added, std::make_shared<ObjectInstance>(2));
+        client1->addChild(1, uri1, 3, 2, added);
+
+        seen.clear();
+        BOOST_CHECK(client1->forEachObjectOfClass(2, [&](const URI& uri) {
+                    return seen.insert(uri).second;
+                }));
+        BOOST_CHECK(expected == seen);
+        seen.clear();
+        BOOST_CHECK(client1->forEachChild(1, uri1, 3, 2, [&](const URI& uri) {
+                    return seen.insert(uri).second;
+                }));
+        BOOST_CHECK(expected == seen);
+
+        std::vector<URI> children;
+        client1->getChildren(1, uri1, 3, 2, children);
+        BOOST_CHECK_EQUAL(expected.size(), children.size());
+        BOOST_CHECK(std::find(children.begin(), children.end(), added) ==
+                    children.end());
+        seen.clear();
+        client1->getObjectsForClass(2, seen);
+        BOOST_CHECK(expected == seen);
+    }
+    seen.clear();
+    client1->getObjectsForClass(2, seen);
+    BOOST_CHECK_EQUAL(expected.size() + 1, seen.size());
+}
+
+BOOST_FIXTURE_TEST_CASE( journal, BaseFixture ) {
+    typedef ObjectStore::Change Change;
+    URI uri1("/");
+    std::shared_ptr<ObjectInstance> oi1(new ObjectInstance(1));
+
+    // disabled by default
+    client1->put(1, uri1, oi1);
+    BOOST_CHECK_EQUAL(0, db.getJournalSeq());
+
+    db.setJournalSize(5);
+    std::vector<Change> changes;
+    BOOST_CHECK(db.getChangesSince(0, changes));
+    BOOST_CHECK(changes.empty());
+
+    oi1->setUInt64(1, 1);
+    client1->put(1, uri1, oi1);
+    BOOST_CHECK(!client1->putIfModified(1, uri1, oi1));
+    URI uri2(URIBuilder().addElement("prop3").addElement(1).build());
+    client1->put(2, uri2, std::make_shared<ObjectInstance>(2));
+    client1->addChild(1, uri1, 3, 2, uri2);
+    // adding an existing child again changes nothing
+    client1->addChild(1, uri1, 3, 2, uri2);
+    client1->remove(1, uri1, true);
+    BOOST_CHECK_EQUAL(5, db.getJournalSeq());
+
+    BOOST_CHECK(db.getChangesSince(0, changes));
+    BOOST_REQUIRE_EQUAL(5, changes.size());
+    BOOST_CHECK_EQUAL(1, changes[0].seq);
+    BOOST_CHECK_EQUAL(uri1, changes[0].uri);
+    BOOST_CHECK_EQUAL(Change::UPDATED, changes[0].op);
+    BOOST_CHECK_EQUAL(2, changes[1].class_id);
+    BOOST_CHECK_EQUAL(Change::UPDATED, changes[1].op);
+    // the new child is an update of the parent
+    BOOST_CHECK_EQUAL(1, changes[2].class_id);
+    BOOST_CHECK_EQUAL(uri1, changes[2].uri);
+    BOOST_CHECK_EQUAL(Change::UPDATED, changes[2].op);
+    BOOST_CHECK_EQUAL(Change::REMOVED, changes[3].op);
+    BOOST_CHECK_EQUAL(Change::REMOVED, changes[4].op);
+    std::unordered_set<URI> removed({changes[3].uri, changes[4].uri});
+    BOOST_CHECK(removed.count(uri1) && removed.count(uri2));
+
+    changes.clear();
+    BOOST_CHECK(db.getChangesSince(4, changes));
+    BOOST_REQUIRE_EQUAL(1, changes.size());
+    BOOST_CHECK_EQUAL(5, changes[0].seq);
+    changes.clear();
+    BOOST_CHECK(db.getChangesSince(5, changes));
+    BOOST_CHECK(changes.empty());
+    BOOST_CHECK(!db.getChangesSince(6, changes));
+
+    // the oldest change falls off the ring
+    client1->put(1, uri1, oi1);
+    BOOST_CHECK(!db.getChangesSince(0, changes));
+    BOOST_CHECK(db.getChangesSince(1, changes));
+    BOOST_REQUIRE_EQUAL(5, changes.size());
+    BOOST_CHECK_EQUAL(2, changes[0].seq);
+    BOOST_CHECK_EQUAL(6, changes[4].seq);
+}
+
+BOOST_AUTO_TEST_CASE( child_index ) {
+    ClassIndex index;
+    std::vector<URI> parents;
+    for (int i = 0; i < 50; ++i)
+        parents.push_back(URIBuilder().addElement("p").addElement(i).build());
+
+    // enough (parent, property) keys to force several table resizes
+    for (int i = 0; i < 50; ++i) {
+        for (prop_id_t prop = 1; prop <= 3; ++prop) {
+            for (int j = 0; j < 4; ++j) {
+                URI child(URIBuilder(parents[i]).addElement("c")
+                          .addElement(prop).addElement(j).build());
+                BOOST_CHECK(index.addChild(parents[i], prop, child));
+                BOOST_CHECK(!index.addChild(parents[i], prop, child));
+            }
+        }
+    }
+
+    // remove every other parent's children for property 2
+    for (int i = 0; i < 50; i += 2) {
+        for (int j = 0; j < 4; ++j) {
+            URI child(URIBuilder(parents[i]).addElement("c")
+                      .addElement(2).addElement(j).build());
+            BOOST_CHECK(index.delChild(parents[i], 2, child));
+            BOOST_CHECK(!index.delChild(parents[i], 2, child));
+            BOOST_CHECK(!index.hasParent(child));
+        }
+    }
+
+    for (int i = 0; i < 50; ++i) {
+        for (prop_id_t prop = 1; prop <= 3; ++prop) {
+            std::vector<URI> children;
+            index.getChildren(parents[i], prop, children);
+            size_t expected = (prop == 2 && i % 2 == 0) ? 0 : 4;
+            BOOST_CHECK_EQUAL(expected, children.size());
+            for (const URI& child : children) {
+                const std::pair<URI, prop_id_t>& p = index.getParent(child);
+                BOOST_CHECK_EQUAL(parents[i], p.first);
+                BOOST_CHECK_EQUAL(prop, p.second);
+            }
+        }
+    }
+
+    // moving a child to a new parent removes the old link
+    URI moved(URIBuilder(parents[1]).addElement("c")
+              .addElement(1).addElement(0).build());
+    BOOST_CHECK(index.addChild(parents[3], 1, moved));
+    std::vector<URI> children;
+    index.getChildren(parents[1], 1, children);
+    BOOST_CHECK_EQUAL(3, children.size());
+    BOOST_CHECK(std::find(children.begin(), children.end(), moved) ==
+                children.end());
+    BOOST_CHECK_EQUAL(parents[3], index.getParent(moved).first);
+}
+
+BOOST_FIXTURE_TEST_CASE( notification_workers, MDFixture ) {
+    opflex::util::ThreadManager threadManager;
+    ObjectStore store(threadManager);
+    store.init(md);
+    BOOST_CHECK_THROW(store.setNotificationWorkers(0),
+                      std::invalid_argument);
+    store.setNotificationWorkers(4);
+    BOOST_CHECK_EQUAL(4, store.getNotificationWorkers());
+    store.start();
+    BOOST_CHECK_THROW(store.setNotificationWorkers(2), std::logic_error);
+
+    TestListener serial;
+    TestListener parallel(true);
+    store.registerListener(1, &serial);
+    store.registerListener(2, &parallel);
+    store.registerListener(2, &serial);
+
+    mointernal::StoreClient& client = store.getStoreClient("owner1");
+    URI root("/");
+    client.put(1, root, std::make_shared<ObjectInstance>(1));
+    std::vector<URI> uris;
+    for (int i = 0; i < 20; ++i) {
+        URI uri(URIBuilder().addElement("class2").addElement(i).build());
+        client.put(2, uri, std::make_shared<ObjectInstance>(2));
+        client.addChild(1, root, 3, 2, uri);
+        uris.push_back(uri);
+    }
+
+    mointernal::StoreClient::notif_t notifs;
+    for (const URI& uri : uris)
+        client.queueNotification(2, uri, notifs);
+    client.deliverNotifications(notifs);
+
+    for (const URI& uri : uris) {
+        WAIT_FOR(parallel.contains(uri), 1000);
+        WAIT_FOR(serial.contains(uri), 1000);
+    }
+    WAIT_FOR(serial.contains(root), 1000);
+    // class 1 has no thread-safe listener
+    BOOST_CHECK(!parallel.contains(root));
+
+    store.unregisterListener(1, &serial);
+    store.unregisterListener(2, &serial);
+    store.unregisterListener(2, &parallel);
+    store.stop();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
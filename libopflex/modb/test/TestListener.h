@@ -23,17 +23,19 @@ namespace modb {
 
 class TestListener : public ObjectListener {
 public:
-    TestListener() {}
+    TestListener(bool threadSafe_ = false) : threadSafe(threadSafe_) {}
 
     virtual void objectUpdated(class_id_t class_id, const URI& uri) {
         const std::lock_guard<std::mutex> lock(uri_mutex);
         notifs.insert(uri);
     }
+    virtual bool isThreadSafe() const { return threadSafe; }
     bool contains(const URI& uri) {
         const std::lock_guard<std::mutex> lock(uri_mutex);
         return notifs.find(uri) != notifs.end();
     }
 
+    bool threadSafe;
     std::mutex uri_mutex;
     std::unordered_set<URI> notifs;
 };
@@ -15,6 +15,8 @@
 #endif
 
 
+#include <limits>
+
 #include <boost/test/unit_test.hpp>
 
 #include "opflex/modb/URIBuilder.h"
@@ -33,6 +35,14 @@ BOOST_AUTO_TEST_CASE( ints ) {
         .addElement((int64_t)-75);
     BOOST_CHECK_EQUAL("/prop1/75/-75/", builder.build().toString());
 
+    URIBuilder limits;
+    limits
+        .addElement(std::numeric_limits<uint64_t>::max())
+        .addElement(std::numeric_limits<int64_t>::min())
+        .addElement(std::numeric_limits<int32_t>::min())
+        .addElement((uint32_t)0);
+    BOOST_CHECK_EQUAL("/18446744073709551615/-9223372036854775808/"
+                      "-2147483648/0/", limits.build().toString());
 }
 
 BOOST_AUTO_TEST_CASE( string ) {
@@ -71,6 +81,21 @@ BOOST_AUTO_TEST_CASE( string ) {
     }
 }
 
+BOOST_AUTO_TEST_CASE( reuse ) {
+    // builders are recycled; each must start from a clean buffer
+    for (int i = 0; i < 8; ++i) {
+        URIBuilder outer;
+        URI inner(URIBuilder().addElement("inner").addElement(i).build());
+        outer.addElement("outer").addElement(inner);
+        BOOST_CHECK_EQUAL("/inner/" + std::to_string(i) + "/",
+                          inner.toString());
+        BOOST_CHECK_EQUAL("/outer/%2finner%2f" + std::to_string(i) + "%2f/",
+                          outer.build().toString());
+    }
+    URIBuilder fromUri(URI("/a/"));
+    BOOST_CHECK_EQUAL("/a/b/", fromUri.addElement("b").build().toString());
+}
+
 BOOST_AUTO_TEST_CASE( mac ) {
     URIBuilder builder;
     builder
@@ -135,4 +160,42 @@ BOOST_AUTO_TEST_CASE( getelements ) {
     BOOST_CHECK_EQUAL(",./<>?;':\"[]\\{}|~!@#$%^&*()_-+=/", elements.at(1));
 }
 
+BOOST_AUTO_TEST_CASE( intern ) {
+    URI::setInterning(true);
+    size_t base = URI::getInternedCount();
+    {
+        URI u1("/PolicyUniverse/PolicySpace/test/GbpEpGroup/epg/");
+        URI u2 = URIBuilder()
+            .addElement("PolicyUniverse")
+            .addElement("PolicySpace")
+            .addElement("test")
+            .addElement("GbpEpGroup")
+            .addElement("epg").build();
+        URI u3("/PolicyUniverse/PolicySpace/test/GbpEpGroup/epg2/");
+        BOOST_CHECK_EQUAL(u1, u2);
+        BOOST_CHECK(u1 != u3);
+        BOOST_CHECK_EQUAL(&u1.toString(), &u2.toString());
+        BOOST_CHECK_EQUAL(base + 2, URI::getInternedCount());
+    }
+    BOOST_CHECK_EQUAL(base, URI::getInternedCount());
+    URI::setInterning(false);
+
+    {
+        URI u1("/PolicyUniverse/PolicySpace/test/");
+        URI u2 = URIBuilder().addElement("PolicyUniverse")
+            .addElement("PolicySpace").addElement("test").buildInterned();
+        URI u3 = URI::intern("/PolicyUniverse/PolicySpace/test/");
+        BOOST_CHECK_EQUAL(u1, u2);
+        BOOST_CHECK(&u1.toString() != &u2.toString());
+        BOOST_CHECK_EQUAL(&u2.toString(), &u3.toString());
+        BOOST_CHECK_EQUAL(base + 1, URI::getInternedCount());
+    }
+
+    URI u4("/PolicyUniverse/");
+    URI u5("/PolicyUniverse/");
+    BOOST_CHECK_EQUAL(u4, u5);
+    BOOST_CHECK(&u4.toString() != &u5.toString());
+    BOOST_CHECK_EQUAL(base, URI::getInternedCount());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
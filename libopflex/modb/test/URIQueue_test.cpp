@@ -0,0 +1,119 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Test suite for URIQueue class.
+ *
+ * Copyright (c) 2014 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <boost/test/unit_test.hpp>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <string>
+
+#include "opflex/modb/internal/URIQueue.h"
+#include "opflex/util/ThreadManager.h"
+#include "TestListener.h"
+
+using namespace opflex::modb;
+using opflex::util::ThreadManager;
+
+BOOST_AUTO_TEST_SUITE(URIQueue_test)
+
+class RecordingProc : public URIQueue::QProcessor {
+public:
+    virtual const std::string& taskName() { return name; }
+
+    virtual void processItem(const URI& uri, const boost::any& data) {
+        std::lock_guard<std::mutex> guard(mutex);
+        uris.push_back(uri.toString());
+        values.push_back(boost::any_cast<int>(data));
+    }
+
+    size_t count() {
+        std::lock_guard<std::mutex> guard(mutex);
+        return uris.size();
+    }
+
+    std::string name = "urique_test";
+    std::mutex mutex;
+    std::vector<std::string> uris;
+    std::vector<int> values;
+};
+
+BOOST_AUTO_TEST_CASE(dedup) {
+    ThreadManager threadManager;
+    RecordingProc proc;
+    URIQueue queue(&proc, threadManager);
+
+    // items queued before start are kept in order, and an item
+    // already queued is not queued again
+    queue.queueItem(URI("/a/"), 1);
+    queue.queueItem(URI("/b/"), 2);
+    queue.queueItem(URI("/a/"), 3);
+    queue.queueItem(URI("/c/"), 4);
+    queue.start();
+
+    WAIT_FOR(proc.count() == 3, 1000);
+    {
+        std::lock_guard<std::mutex> guard(proc.mutex);
+        BOOST_CHECK_EQUAL("/a/", proc.uris[0]);
+        BOOST_CHECK_EQUAL("/b/", proc.uris[1]);
+        BOOST_CHECK_EQUAL("/c/", proc.uris[2]);
+        BOOST_CHECK_EQUAL(1, proc.values[0]);
+    }
+
+    // a processed item can be queued again
+    queue.queueItem(URI("/a/"), 5);
+    WAIT_FOR(proc.count() == 4, 1000);
+    {
+        std::lock_guard<std::mutex> guard(proc.mutex);
+        BOOST_CHECK_EQUAL("/a/", proc.uris[3]);
+        BOOST_CHECK_EQUAL(5, proc.values[3]);
+    }
+
+    queue.stop();
+}
+
+BOOST_AUTO_TEST_CASE(producers) {
+    ThreadManager threadManager;
+    RecordingProc proc;
+    URIQueue queue(&proc, threadManager);
+    queue.start();
+
+    const int THREADS = 4;
+    const int ITEMS = 1000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&queue, t]() {
+                for (int i = 0; i < ITEMS; ++i) {
+                    queue.queueItem(URI("/" + std::to_string(t) + "/" +
+                                        std::to_string(i) + "/"), i);
+                }
+            });
+    }
+    for (std::thread& t : threads)
+        t.join();
+
+    WAIT_FOR(proc.count() == THREADS * ITEMS, 5000);
+    queue.stop();
+
+    // the items of each producer are processed in the order queued
+    std::vector<int> last(THREADS, -1);
+    for (size_t i = 0; i < proc.uris.size(); ++i) {
+        int t = std::stoi(proc.uris[i].substr(1));
+        BOOST_CHECK(proc.values[i] > last[t]);
+        last[t] = proc.values[i];
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
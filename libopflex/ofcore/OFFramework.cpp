@@ -15,17 +15,21 @@
 #endif
 
 #include <cstdio>
+#include <thread>
 
 #include <boost/assign.hpp>
+#include <boost/atomic.hpp>
 
 #include "opflex/ofcore/OFFramework.h"
 #include "opflex/engine/Processor.h"
 #include "opflex/engine/Inspector.h"
 #include "opflex/logging/internal/logging.hpp"
 #include "opflex/modb/internal/ObjectStore.h"
+#include "opflex/modb/internal/StoreImage.h"
 #include "opflex/modb/mo-internal/StoreClient.h"
 
 #include "opflex/util/ThreadManager.h"
+#include "opflex/util/ThreadSettings.h"
 
 namespace opflex {
 namespace ofcore {
@@ -40,7 +44,8 @@ class OFFramework::OFFrameworkImpl {
 public:
     OFFrameworkImpl()
         : db(threadManager), processor(&db, threadManager), mutator_key(0),
-          started(false), mode(opflex::ofcore::OFConstants::OpflexElementMode::STITCHED_MODE)
+          started(false), mode(opflex::ofcore::OFConstants::OpflexElementMode::STITCHED_MODE),
+          dumpRunning(false), dumpCancel(false)
           {}
     ~OFFrameworkImpl() {}
 
@@ -52,6 +57,18 @@ public:
     bool started;
     opflex::ofcore::OFConstants::OpflexElementMode mode;
     opflex::modb::MAC tunnelMac;
+
+    // background MODB dump
+    unique_ptr<std::thread> dumpThread;
+    boost::atomic<bool> dumpRunning;
+    boost::atomic<bool> dumpCancel;
+
+    void stopDump() {
+        if (!dumpThread) return;
+        dumpCancel = true;
+        dumpThread->join();
+        dumpThread.reset();
+    }
 };
 
 OFFramework::OFFramework() : pimpl(new OFFrameworkImpl()) {
@@ -111,6 +128,14 @@ void OFFramework::setPrrTimerDuration(const uint64_t duration) {
     pimpl->processor.setPrrTimerDuration(duration);
 }
 
+void OFFramework::setEndpointLease(uint64_t lease) {
+    pimpl->processor.setEndpointLease(lease);
+}
+
+void OFFramework::setRenewalBuckets(size_t buckets) {
+    pimpl->processor.setRenewalBuckets(buckets);
+}
+
 void OFFramework::setHandshakeTimeout(const uint32_t timeout) {
     pimpl->processor.setHandshakeTimeout(timeout);
 }
@@ -119,6 +144,22 @@ void OFFramework::setKeepaliveTimeout(const uint32_t timeout) {
     pimpl->processor.setKeepaliveTimeout(timeout);
 }
 
+void OFFramework::setSendWatermarks(size_t high, size_t low) {
+    pimpl->processor.setWatermarks(high, low);
+}
+
+void OFFramework::setNotificationWorkers(size_t workers) {
+    pimpl->db.setNotificationWorkers(workers);
+}
+
+void OFFramework::setProcessingThreads(size_t threads) {
+    pimpl->processor.setProcessingThreads(threads);
+}
+
+void OFFramework::setJournalSize(size_t size) {
+    pimpl->db.setJournalSize(size);
+}
+
 void OFFramework::start() {
     LOG(DEBUG) << "Starting OpFlex Framework";
     pimpl->started = true;
@@ -136,6 +177,7 @@ MainLoopAdaptor* OFFramework::startSync() {
 
 void OFFramework::stop() {
     LOG(DEBUG) << "Stopping OpFlex Framework";
+    pimpl->stopDump();
     if (pimpl->inspector) {
         LOG(DEBUG) << "Stopping OpFlex Inspector";
         pimpl->inspector->stop();
@@ -161,6 +203,67 @@ void OFFramework::dumpMODB(FILE* file) {
     serializer.dumpMODB(file);
 }
 
+bool OFFramework::dumpMODBAsync(const string& file, bool image) {
+    if (pimpl->dumpRunning.exchange(true)) {
+        LOG(WARNING) << "MODB dump already in progress; not writing "
+                     << file;
+        return false;
+    }
+    // reap the thread of the last dump, which has finished
+    pimpl->stopDump();
+    pimpl->dumpCancel = false;
+
+    OFFrameworkImpl* impl = pimpl;
+    pimpl->dumpThread.reset(new std::thread(
+        util::startThread("modb_dump", [impl, file, image]() {
+            if (image) {
+                const ObjectStore::SnapshotGuard snapshot(impl->db);
+                StoreImage(&impl->db).write(file);
+            } else {
+                FILE* pfile = fopen(file.c_str(), "w");
+                if (pfile == NULL) {
+                    LOG(ERROR) << "Could not open MODB file "
+                               << file << " for writing";
+                } else {
+                    MOSerializer& serializer =
+                        impl->processor.getSerializer();
+                    size_t roots =
+                        serializer.dumpMODBPaced(pfile,
+                                                 MOSerializer::DUMP_CHUNK,
+                                                 MOSerializer::DUMP_PAUSE,
+                                                 &impl->dumpCancel);
+                    fclose(pfile);
+                    LOG(INFO) << "Wrote " << roots << " MODB root objects to "
+                              << file;
+                }
+            }
+            impl->dumpRunning = false;
+        })));
+    return true;
+}
+
+size_t OFFramework::loadMODB(const string& file) {
+    mointernal::StoreClient& client = pimpl->db.getStoreClient("_SYSTEM_");
+    size_t objs = 0;
+    if (StoreImage::isImage(file)) {
+        mointernal::StoreClient::notif_t notifs;
+        objs = StoreImage(&pimpl->db).load(file, client, &notifs);
+        client.deliverNotifications(notifs);
+    } else {
+        FILE* pfile = fopen(file.c_str(), "r");
+        if (pfile == NULL) {
+            LOG(ERROR) << "Could not open MODB file "
+                       << file << " for reading";
+            return 0;
+        }
+        MOSerializer& serializer = pimpl->processor.getSerializer();
+        objs = serializer.readMOs(pfile, client);
+        fclose(pfile);
+    }
+    LOG(INFO) << "Read " << objs << " managed objects from " << file;
+    return objs;
+}
+
 void OFFramework::prettyPrintMODB(std::ostream& output,
                                   bool tree,
                                   bool includeProps,
@@ -284,6 +387,23 @@ void OFFramework::getOpflexPeerStats(std::unordered_map<string, std::shared_ptr<
     pool.getOpflexPeerStats(stats);
 }
 
+void OFFramework::getStoreStats(modb::class_stats_map_t& stats) {
+    pimpl->db.getClassStats(stats);
+}
+
+void OFFramework::getProcessorStats(std::unordered_map<string, uint64_t>& counts) {
+    pimpl->processor.getItemStateCounts(counts);
+}
+
+const OFLatencyHistogram& OFFramework::getProcessTimeStats() {
+    return pimpl->processor.getProcessTime();
+}
+
+void OFFramework::getResolveLatencyStats(std::unordered_map<string,
+                                         std::shared_ptr<const OFLatencyHistogram> >& latency) {
+    pimpl->processor.getResolveLatency(latency);
+}
+
 void OFFramework::overrideObservableReporting(modb::class_id_t class_id, bool enabled) {
     pimpl->processor.overrideObservableReporting(class_id, enabled);
 }
@@ -291,5 +411,48 @@ void OFFramework::overrideObservableReporting(modb::class_id_t class_id, bool en
 void OFFramework::disableObservableReporting() {
     pimpl->processor.disableObservableReporting();
 }
+
+void OFFramework::setStateReportInterval(uint64_t interval) {
+    pimpl->processor.setStateReportInterval(interval);
+}
+
+void OFFramework::overrideStateReportInterval(modb::class_id_t class_id,
+                                              uint64_t interval) {
+    pimpl->processor.overrideStateReportInterval(class_id, interval);
+}
+
+void OFFramework::setStateReportBudget(uint64_t bytesPerSecond) {
+    pimpl->processor.setStateReportBudget(bytesPerSecond);
+}
+
+void OFFramework::setPolicyCache(const std::string& file, uint64_t interval) {
+    pimpl->processor.setPolicyCache(file, interval);
+}
+
+void OFFramework::prefetch(const std::vector<std::pair<modb::class_id_t,
+                                                      modb::URI> >& refs,
+                           uint64_t holdTime) {
+    pimpl->processor.prefetch(refs, holdTime);
+}
+
+void OFFramework::setLoadSharing(bool enabled) {
+    engine::internal::OpflexPool& pool = pimpl->processor.getPool();
+    pool.setLoadSharing(enabled);
+}
+
+void OFFramework::setCompression(bool enabled) {
+    engine::internal::OpflexPool& pool = pimpl->processor.getPool();
+    pool.setCompression(enabled);
+}
+
+void OFFramework::setBinaryEncoding(bool enabled) {
+    engine::internal::OpflexPool& pool = pimpl->processor.getPool();
+    pool.setBinaryEncoding(enabled);
+}
+
+void OFFramework::setParseOffload(size_t threshold) {
+    engine::internal::OpflexPool& pool = pimpl->processor.getPool();
+    pool.setParseOffload(threshold);
+}
 } /* namespace ofcore */
 } /* namespace opflex */
@@ -107,6 +107,90 @@ BOOST_FIXTURE_TEST_CASE( query, InspectorFixture ) {
     WAIT_FOR(itemPresent(&rosClient, 6, c6u), 1000);
 }
 
+BOOST_FIXTURE_TEST_CASE( query_filtered, InspectorFixture ) {
+    URI c5u_1("/class5/test1/");
+    URI c5u_2("/class5/test2/");
+    URI c5u_3("/class5/test3/");
+    std::shared_ptr<ObjectInstance> oi5_1(new ObjectInstance(5));
+    oi5_1->setString(10, "match");
+    std::shared_ptr<ObjectInstance> oi5_2(new ObjectInstance(5));
+    oi5_2->setString(10, "other");
+    std::shared_ptr<ObjectInstance> oi5_3(new ObjectInstance(5));
+    oi5_3->setString(10, "match");
+
+    client2->put(5, c5u_1, oi5_1);
+    client2->put(5, c5u_2, oi5_2);
+    client2->put(5, c5u_3, oi5_3);
+
+    struct stat buffer;
+    WAIT_FOR(stat(SOCK_NAME.c_str(), &buffer) == 0, 500);
+
+    // one object per page, so the query takes several requests
+    client.addFilter("prop10", "match");
+    client.setPageSize(1);
+    client.addClassQuery("class5");
+    client.execute();
+
+    StoreClient& rosClient = client.getStore().getReadOnlyStoreClient();
+    WAIT_FOR(itemPresent(&rosClient, 5, c5u_1), 1000);
+    WAIT_FOR(itemPresent(&rosClient, 5, c5u_3), 1000);
+    BOOST_CHECK(!itemPresent(&rosClient, 5, c5u_2));
+}
+
+BOOST_FIXTURE_TEST_CASE( query_paged, InspectorFixture ) {
+    std::vector<URI> matched;
+    std::vector<URI> other;
+    for (int i = 0; i < 10; ++i) {
+        URI uri("/class5/test" + std::to_string(i) + "/");
+        std::shared_ptr<ObjectInstance> oi(new ObjectInstance(5));
+        oi->setString(10, i % 3 == 1 ? "other" : "match");
+        client2->put(5, uri, oi);
+        (i % 3 == 1 ? other : matched).push_back(uri);
+    }
+
+    struct stat buffer;
+    WAIT_FOR(stat(SOCK_NAME.c_str(), &buffer) == 0, 500);
+
+    client.addFilter("prop10", "match");
+    client.setPageSize(3);
+    client.addClassQuery("class5");
+    client.execute();
+
+    // every matching object is received once, over several pages
+    BOOST_CHECK_EQUAL(3, client.getPagesReceived());
+    BOOST_CHECK_EQUAL(matched.size(), client.getPagedObjectsReceived());
+    StoreClient& rosClient = client.getStore().getReadOnlyStoreClient();
+    for (const URI& uri : matched)
+        BOOST_CHECK(itemPresent(&rosClient, 5, uri));
+    for (const URI& uri : other)
+        BOOST_CHECK(!itemPresent(&rosClient, 5, uri));
+}
+
+BOOST_FIXTURE_TEST_CASE( query_child_class, InspectorFixture ) {
+    URI c4u("/class4/test/");
+    URI c6u("/class4/test/class6/test2/");
+    std::shared_ptr<ObjectInstance> oi4(new ObjectInstance(4));
+    oi4->setString(9, "test");
+    std::shared_ptr<ObjectInstance> oi6(new ObjectInstance(6));
+    oi6->setString(13, "test2");
+    client2->put(4, c4u, oi4);
+    client2->put(6, c6u, oi6);
+    client2->addChild(4, c4u, 12, 6, c6u);
+
+    struct stat buffer;
+    WAIT_FOR(stat(SOCK_NAME.c_str(), &buffer) == 0, 500);
+
+    // the children of other classes are not downloaded
+    client.setRecursive(true);
+    client.addChildClass("class5");
+    client.addQuery("class4", c4u);
+    client.execute();
+
+    StoreClient& rosClient = client.getStore().getReadOnlyStoreClient();
+    BOOST_CHECK(itemPresent(&rosClient, 4, c4u));
+    BOOST_CHECK(!itemPresent(&rosClient, 6, c6u));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } /* namespace ofcore */
@@ -142,4 +142,36 @@ BOOST_FIXTURE_TEST_CASE( model, FrameworkFixture ) {
 
 }
 
+BOOST_FIXTURE_TEST_CASE( delta_mutator, FrameworkFixture ) {
+    std::shared_ptr<testmodel::class1> root;
+    {
+        Mutator mutator(framework, "owner1");
+        root = testmodel::class1::createRootElement(framework);
+        root->setProp1(42);
+        root->addProp2("a");
+        mutator.commit();
+    }
+
+    URI uri1("/");
+    {
+        // writing back the same value is not a change
+        Mutator mutator(framework, "owner1", true);
+        root->setProp1(42);
+        mutator.commit();
+    }
+
+    {
+        Mutator mutator(framework, "owner1", true);
+        root->addProp2("b");
+        root->setProp1(43);
+        mutator.commit();
+    }
+    optional<std::shared_ptr<testmodel::class1> > r1 =
+        testmodel::class1::resolve(framework, uri1);
+    BOOST_REQUIRE(r1);
+    BOOST_CHECK_EQUAL(43, r1.get()->getProp1().get());
+    BOOST_CHECK_EQUAL(2, r1.get()->getProp2Size());
+    BOOST_CHECK_EQUAL("b", r1.get()->getProp2(1));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
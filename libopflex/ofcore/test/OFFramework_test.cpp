@@ -44,6 +44,34 @@ BOOST_AUTO_TEST_CASE( init ) {
     fw.stop();
 }
 
+BOOST_AUTO_TEST_CASE( dump_async ) {
+    using opflex::ofcore::OFFramework;
+
+    OFFramework fw;
+    fw.start();
+    BOOST_CHECK(fw.dumpMODBAsync("/tmp/offramework_modb.json"));
+    fw.stop();
+
+    FILE* pfile = fopen("/tmp/offramework_modb.json", "r");
+    BOOST_REQUIRE(pfile != NULL);
+    char buf[8] = {0};
+    BOOST_CHECK(fgets(buf, sizeof(buf), pfile) != NULL);
+    fclose(pfile);
+    BOOST_CHECK_EQUAL(std::string("[]\n"), std::string(buf));
+}
+
+BOOST_AUTO_TEST_CASE( load_modb ) {
+    using opflex::ofcore::OFFramework;
+
+    OFFramework fw;
+    fw.start();
+    fw.dumpMODB("/tmp/offramework_load.json");
+    // an empty store dumps no objects to load back
+    BOOST_CHECK_EQUAL(0, fw.loadMODB("/tmp/offramework_load.json"));
+    BOOST_CHECK_EQUAL(0, fw.loadMODB("/tmp/offramework_missing.json"));
+    fw.stop();
+}
+
 BOOST_AUTO_TEST_CASE( init_adaptor ) {
     using opflex::ofcore::OFFramework;
 
@@ -71,6 +99,11 @@ BOOST_AUTO_TEST_CASE( test_misc ) {
     fw.getMacProxy(proxy);
     fw.overrideObservableReporting(1, false);
     fw.disableObservableReporting();
+    fw.setStateReportInterval(1000);
+    fw.overrideStateReportInterval(1, 5000);
+    fw.setStateReportBudget(65536);
+    fw.setPolicyCache("", 60000);
+    fw.setLoadSharing(true);
 }
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,150 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation of thread naming and scheduling
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "opflex/util/ThreadSettings.h"
+#include "opflex/logging/internal/logging.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <map>
+#include <mutex>
+
+namespace opflex {
+namespace util {
+
+namespace {
+
+std::mutex settingsMutex;
+std::map<std::string, ThreadSettings> settingsMap;
+
+bool findSettings(const std::string& name, ThreadSettings& settings) {
+    std::lock_guard<std::mutex> guard(settingsMutex);
+    // the map is ordered, so the longest matching prefix is the last
+    // key that is a prefix of the name
+    bool found = false;
+    for (const auto& s : settingsMap) {
+        if (s.first > name) break;
+        if (name.compare(0, s.first.size(), s.first) == 0) {
+            settings = s.second;
+            found = true;
+        }
+    }
+    return found;
+}
+
+#ifdef __linux__
+bool parsePolicy(const std::string& name, int& policy) {
+    static const std::map<std::string, int> policies = {
+        {"other", SCHED_OTHER},
+        {"batch", SCHED_BATCH},
+        {"idle", SCHED_IDLE},
+        {"fifo", SCHED_FIFO},
+        {"rr", SCHED_RR},
+    };
+    auto it = policies.find(name);
+    if (it == policies.end())
+        return false;
+    policy = it->second;
+    return true;
+}
+#endif
+
+} /* anonymous namespace */
+
+void setThreadSettings(const std::string& prefix,
+                       const ThreadSettings& settings) {
+    std::lock_guard<std::mutex> guard(settingsMutex);
+    settingsMap[prefix] = settings;
+}
+
+void clearThreadSettings() {
+    std::lock_guard<std::mutex> guard(settingsMutex);
+    settingsMap.clear();
+}
+
+bool initThread(const std::string& name) {
+#ifdef __linux__
+    pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+
+    ThreadSettings settings;
+    if (!findSettings(name, settings))
+        return true;
+
+    bool ok = true;
+    if (!settings.cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : settings.cpus) {
+            if (cpu >= 0 && cpu < CPU_SETSIZE)
+                CPU_SET(cpu, &set);
+        }
+        int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (rc != 0) {
+            LOG(ERROR) << "Could not set CPU affinity of thread " << name
+                       << ": " << strerror(rc);
+            ok = false;
+        }
+    }
+    if (settings.policy) {
+        int policy;
+        if (!parsePolicy(settings.policy.get(), policy)) {
+            LOG(ERROR) << "Invalid scheduling policy for thread " << name
+                       << ": " << settings.policy.get();
+            ok = false;
+        } else {
+            sched_param param;
+            param.sched_priority =
+                (policy == SCHED_FIFO || policy == SCHED_RR)
+                ? settings.priority : 0;
+            int rc = pthread_setschedparam(pthread_self(), policy, &param);
+            if (rc != 0) {
+                LOG(ERROR) << "Could not set scheduling policy of thread "
+                           << name << ": " << strerror(rc);
+                ok = false;
+            }
+        }
+    }
+    if (settings.nice) {
+        // the nice value is per thread on Linux
+        pid_t tid = syscall(SYS_gettid);
+        if (setpriority(PRIO_PROCESS, tid, settings.nice.get()) != 0) {
+            LOG(ERROR) << "Could not set nice value of thread " << name
+                       << ": " << strerror(errno);
+            ok = false;
+        }
+    }
+    return ok;
+#else
+    (void)name;
+    return true;
+#endif
+}
+
+std::thread startThread(const std::string& name,
+                        const std::function<void()>& func) {
+    return std::thread([name, func]() {
+            initThread(name);
+            func();
+        });
+}
+
+} /* namespace util */
+} /* namespace opflex */